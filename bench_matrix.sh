@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+set -e
+
+# Runs the Q32.32 primitive benchmark (make fixed-bench) in each
+# cross-compile image and prints one table with a column per architecture.
+# The reports stay in bench-reports/fixed-<arch>.json.
+#
+# An image runs natively only on a host of its architecture; elsewhere
+# Docker falls back to qemu and the numbers time the emulator. Run this on
+# each target (or copy the JSON over from "make fixed-bench" on the board,
+# e.g. a Raspberry Pi) and rerun with --report to merge what is there.
+
+REPORT_DIR=bench-reports
+mkdir -p "$REPORT_DIR"
+
+if [ "${1:-}" != "--report" ]; then
+    for arch in x86_64 arm64 riscv64; do
+        image="nymyaos-${arch}"
+        if ! docker image inspect "$image" >/dev/null 2>&1; then
+            echo "Building Docker image $image..."
+            docker build -t "$image" -f "Dockerfile.${arch}" .
+        fi
+        echo "Benchmarking in $image..."
+        docker run --rm -v $(pwd):/nymyaOS --user root "$image" /bin/bash -c \
+            "cd /nymyaOS/nymya-core && make fixed-bench FIXED_BENCH=/tmp/nymya_fixed_bench \
+             FIXED_BENCH_ARGS='-o /nymyaOS/$REPORT_DIR/fixed-${arch}.json'"
+    done
+fi
+
+python3 - "$REPORT_DIR"/fixed-*.json <<'PY'
+import json, sys
+
+reports = [json.load(open(p)) for p in sys.argv[1:]]
+if not reports:
+    sys.exit("no reports in bench-reports/")
+rows = []
+for r in reports:
+    for e in r["results"]:
+        if (e["op"], e["impl"]) not in rows:
+            rows.append((e["op"], e["impl"]))
+cell = {(r["arch"], e["op"], e["impl"]): e for r in reports for e in r["results"]}
+
+print("ns per call, throughput / latency\n")
+print("| op | impl | " + " | ".join(r["arch"] for r in reports) + " |")
+print("|---|---|" + "---|" * len(reports))
+for op, impl in rows:
+    vals = []
+    for r in reports:
+        e = cell.get((r["arch"], op, impl))
+        vals.append("%.2f / %.2f" % (e["ns_throughput"], e["ns_latency"]) if e else "-")
+    print("| %s | %s | %s |" % (op, impl, " | ".join(vals)))
+print()
+for r in reports:
+    print("%s: %s, gcc %s" % (r["arch"], r["cpu"], r["compiler"]))
+PY
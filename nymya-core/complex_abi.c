@@ -0,0 +1,13 @@
+// src/complex_abi.c
+//
+// Out-of-line copies of the userland complex helpers, which nymya.h defines
+// static inline. libnymya keeps exporting make_complex, complex_mul,
+// complex_exp_i, complex_re, complex_im and complex_conj for binaries built
+// against headers that declared them as functions.
+
+#ifndef __KERNEL__
+
+#define NYMYA_COMPLEX_DEF
+#include "nymya.h"
+
+#endif // __KERNEL__
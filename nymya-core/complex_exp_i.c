@@ -14,27 +14,11 @@
  */
 complex_double complex_exp_i(int64_t theta_fp) {
     complex_double result;
-    result.re = fixed_cos(theta_fp);
-    result.im = fixed_sin(theta_fp);
+
+    fixed_point_sincos(theta_fp, NYMYA_TRIG_TIER, &result.im, &result.re);
     return result;
 }
 
 // EXPORT_SYMBOL_GPL(complex_exp_i);
 
-#else // Userland implementation
-
-#include <complex.h>
-#include <math.h>
-#include <stdio.h>
-
-/**
- * complex_exp_i - Computes e^(i*theta) for native double-precision complex numbers in userland.
- *
- * @theta: The angle in radians, as a double-precision floating-point value.
- * Returns the complex number representing e^(i*theta).
- */
-complex_double complex_exp_i(double theta) {
-    return cos(theta) + I * sin(theta);
-}
-
-#endif
\ No newline at end of file
+#endif // __KERNEL__
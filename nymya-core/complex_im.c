@@ -2,24 +2,17 @@
 
 #include "nymya.h"
 
+#ifdef __KERNEL__
+
 /**
- * complex_im - Returns the imaginary component of a complex_double.
- *
- * In kernel mode: returns fixed-point int64_t.
- * In userspace: returns floating-point double.
- *
+ * complex_im - Returns the imaginary component of a fixed-point complex_double.
  * @c: The complex number input.
  *
  * Returns:
- * Imaginary component of the input complex number.
+ * Imaginary component of the input as a Q32.32 int64_t.
  */
-#ifdef __KERNEL__
 int64_t complex_im(complex_double c) {
     return c.im;
 }
-#else
-double complex_im(complex_double c) {
-    return cimag(c);
-}
-#endif
 
+#endif // __KERNEL__
@@ -1,6 +1,7 @@
 // src/complex_mul.c
 
 #include "nymya.h"
+#include "nymya_mul128.h"
 
 #ifdef __KERNEL__
 
@@ -18,30 +19,13 @@
  *   The product as a complex_double in Q32.32 fixed-point.
  */
 complex_double complex_mul(complex_double a, complex_double b) {
-    __int128 re_part = (__int128)a.re * b.re - (__int128)a.im * b.im;
-    __int128 im_part = (__int128)a.re * b.im + (__int128)a.im * b.re;
+    nymya_s128 re_part = nymya_s128_sub(nymya_smul128(a.re, b.re), nymya_smul128(a.im, b.im));
+    nymya_s128 im_part = nymya_s128_add(nymya_smul128(a.re, b.im), nymya_smul128(a.im, b.re));
 
     complex_double result;
-    result.re = (int64_t)(re_part >> 32);
-    result.im = (int64_t)(im_part >> 32);
+    result.re = nymya_s128_shr(re_part, 32);
+    result.im = nymya_s128_shr(im_part, 32);
     return result;
 }
 
-#else
-
-#include <complex.h>
-
-/**
- * complex_mul - Multiply two native complex_double numbers in userland.
- * @a: First operand, native _Complex double.
- * @b: Second operand, native _Complex double.
- *
- * Returns:
- *   The product (a * b) as native complex_double.
- */
-complex_double complex_mul(complex_double a, complex_double b) {
-    return a * b;
-}
-
-#endif
-
+#endif // __KERNEL__
@@ -15,20 +15,4 @@ int64_t complex_re(complex_double c) {
     return c.re;
 }
 
-#else
-
-#include <complex.h>
-
-/**
- * complex_re - Extract the real part of a native complex double number.
- * @c: complex_double (native _Complex double).
- *
- * Returns:
- *   The real component as a double.
- */
-double complex_re(complex_double c) {
-    return creal(c);
-}
-
-#endif
-
+#endif // __KERNEL__
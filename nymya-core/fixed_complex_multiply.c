@@ -1,4 +1,5 @@
 #include "nymya.h" // Include the header file for definitions like complex_double and FIXED_POINT_SCALE
+#include "nymya_mul128.h" // 64x64->128-bit products for the target architecture
 
 // This file contains the kernel-specific implementation of fixed-point complex multiplication.
 // It must be compiled with the __KERNEL__ macro defined to correctly use complex_double.
@@ -18,8 +19,9 @@
  * Formula:
  * (re1 + im1 * i) * (re2 + im2 * i) = (re1 * re2 - im1 * im2) + (re1 * im2 + im1 * re2) * i
  *
- * Uses 128-bit intermediate types (`__int128`) to prevent overflow during intermediate
- * multiplications before shifting back to the 64-bit fixed-point format.
+ * Keeps each product and sum at 128 bits (`nymya_mul128.h`, which uses the
+ * target's high-multiply instruction) to prevent overflow before shifting back
+ * to the 64-bit fixed-point format.
  *
  * This function is declared globally in `nymya.h` and is intended to be
  * visible across compilation units. Other files should typically use `complex_mul`
@@ -31,19 +33,19 @@
 complex_double fixed_complex_multiply(int64_t re1, int64_t im1, int64_t re2, int64_t im2)
 {
     // Calculate the real part of the product: (re1 * re2) - (im1 * im2)
-    // Use __int128 for intermediate calculations to prevent overflow.
-    __int128 re_part = (__int128)re1 * re2 - (__int128)im1 * im2;
+    // Keep the products at 128 bits to prevent overflow.
+    nymya_s128 re_part = nymya_s128_sub(nymya_smul128(re1, re2), nymya_smul128(im1, im2));
 
     // Calculate the imaginary part of the product: (re1 * im2) + (im1 * re2)
-    // Use __int128 for intermediate calculations to prevent overflow.
-    __int128 im_part = (__int128)re1 * im2 + (__int128)im1 * re2;
+    // Keep the products at 128 bits to prevent overflow.
+    nymya_s128 im_part = nymya_s128_add(nymya_smul128(re1, im2), nymya_smul128(im1, re2));
 
     complex_double result; // Declare result as complex_double
 
     // Shift right by 32 bits (equivalent to dividing by FIXED_POINT_SCALE)
     // to bring the result back to the Q32.32 fixed-point format.
-    result.re = (int64_t)(re_part >> 32);
-    result.im = (int64_t)(im_part >> 32);
+    result.re = nymya_s128_shr(re_part, 32);
+    result.im = nymya_s128_shr(im_part, 32);
 
     return result; // Return the complex_double struct containing both parts
 }
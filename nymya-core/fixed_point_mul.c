@@ -0,0 +1,35 @@
+// src/fixed_point_mul.c
+
+#include "nymya.h"
+#include "nymya_mul128.h"
+
+#ifdef __KERNEL__
+
+/**
+ * fixed_point_mul - Multiply two Q32.32 fixed-point values.
+ * @val1: First operand in Q32.32.
+ * @val2: Second operand in Q32.32.
+ *
+ * Forms the full 128-bit product with the target's high-multiply
+ * instruction (see nymya_mul128.h) and shifts it right by 32 bits,
+ * truncating toward minus infinity.
+ *
+ * Returns:
+ *   The product in Q32.32 fixed-point.
+ */
+int64_t fixed_point_mul(int64_t val1, int64_t val2) {
+    return nymya_fixed_mul(val1, val2);
+}
+
+/**
+ * fixed_point_square - Square a Q32.32 fixed-point value.
+ * @val: Operand in Q32.32.
+ *
+ * Returns:
+ *   val * val in Q32.32, truncated as fixed_point_mul() is.
+ */
+int64_t fixed_point_square(int64_t val) {
+    return nymya_fixed_mul(val, val);
+}
+
+#endif // __KERNEL__
@@ -1,31 +1,204 @@
 // src/fixed_point_sin.c
 
 #include "nymya.h"
-#include "nymya.h"
-int64_t fixed_point_mul(int64_t a, int64_t b);
+#include "nymya_mul128.h"
+
+// 2^128 / (2*pi) in two words: a Q32.32 angle times this, shifted down 96
+// bits, is the angle in turns as a Q0.64 fraction, i.e. reduced modulo 2*pi.
+// The low word keeps the reduction exact across the whole int64 range.
+#define FIXED_TRIG_INV_2PI_HI 0x28be60db9391054aLL
+#define FIXED_TRIG_INV_2PI_LO 0x7f09d5f47d4d3770LL
+
+// Quarter-wave table: FIXED_TRIG_STEPS steps of FIXED_TRIG_STEP radians
+#define FIXED_TRIG_BITS 8
+#define FIXED_TRIG_STEPS (1 << FIXED_TRIG_BITS)
+#define FIXED_TRIG_STEP 0x6487ed5110b461LL // (pi/2) / 256 in Q2.62
+
+// Bits of the quadrant fraction below the table index
+#define FIXED_TRIG_REM_BITS (62 - FIXED_TRIG_BITS)
+
+/*
+ * sin(i * pi/512) for i = 0..256 in Q2.62, rounded from a 50-digit
+ * evaluation; cos(i * pi/512) is entry 256 - i.
+ */
+static const int64_t fixed_trig_table[FIXED_TRIG_STEPS + 1] = {
+    0x0000000000000000LL, 0x006487c3f99c01c4LL, 0x00c90e8fe6f63c23LL,
+    0x012d936bbe30efd3LL, 0x0192155f7a3667e0LL, 0x01f693731d1cf010LL,
+    0x025b0caeb28ab9a3LL, 0x02bf801a5219a86dLL, 0x0323ecbe21bb027dLL,
+    0x038851a2581afc5aLL, 0x03ecadcf3f041bfeLL, 0x0451004d35c26ca0LL,
+    0x04b54824b3867d73LL, 0x0519845e49c8256bLL, 0x057db402a6a90630LL,
+    0x05e1d61a9756c856LL, 0x0645e9af0a6d0af8LL, 0x06a9edc9125700deLL,
+    0x070de171e7b0b53dLL, 0x0771c3b2eba7f245LL, 0x07d59395aa5cc38dLL,
+    0x08395023dd418e92LL, 0x089cf8676d7abb56LL, 0x09008b6a763de75bLL,
+    0x0964083747309d11LL, 0x09c76dd866c689ddLL, 0x0a2abb58949f2cedLL,
+    0x0a8defc2cbe2f8fdLL, 0x0af10a22459fe32aLL, 0x0b5409827b25591fLL,
+    0x0bb6ecef285f98a4LL, 0x0c19b3744e3262ddLL, 0x0c7c5c1e34d3055bLL,
+    0x0cdee5f96e21b333LL, 0x0d415012d802284fLL, 0x0da399779eb39137LL,
+    0x0e05c1353f27b17eLL, 0x0e67c65989594312LL, 0x0ec9a7f2a2a188afLL,
+    0x0f2b650f080d0da9LL, 0x0f8cfcbd90af8d58LL, 0x0fee6e0d6ff6fc5aLL,
+    0x104fb80e37fdadffLL, 0x10b0d9cfdbdb9014LL, 0x1111d262b1f67761LL,
+    0x1172a0d776517724LL, 0x11d3443f4cdb3dd2LL, 0x1233bbabc3bb7166LL,
+    0x1294062ed59f05a9LL, 0x12f422daec0386a3LL, 0x135410c2e18151b1LL,
+    0x13b3cefa0414b77dLL, 0x14135c9417660143LL, 0x1472b8a5571053c0LL,
+    0x14d1e24278e76a25LL, 0x1530d880af3c2381LL, 0x158f9a75ab1fdcfeLL,
+    0x15ee27379ea69359LL, 0x164c7ddd3f27c611LL, 0x16aa9d7dc77e16b2LL,
+    0x17088530fa459eafLL, 0x1766340f2418f64bLL, 0x17c3a9311dcce702LL,
+    0x1820e3b04eaac3f3LL, 0x187de2a6aea962d2LL, 0x18daa52ec8a4afd2LL,
+    0x19372a63bc93d72dLL, 0x1993716141bdfebbLL, 0x19ef7943a8ed8a2eLL,
+    0x1a4b4127dea1e490LL, 0x1aa6c82b6d3fc98bLL, 0x1b020d6c7f400914LL,
+    0x1b5d1009e15cc02bLL, 0x1bb7cf2304bd0134LL, 0x1c1249d8011ee6a0LL,
+    0x1c6c7f4997000a90LL, 0x1cc66e9931c45e17LL, 0x1d2016e8e9db5ac7LL,
+    0x1d79775b86e38955LL, 0x1dd28f1481cc57f1LL, 0x1e2b5d3806f63b1eLL,
+    0x1e83e0eaf85113d1LL, 0x1edc1952ef78d589LL, 0x1f3405963fd06742LL,
+    0x1f8ba4dbf89ab9fbLL, 0x1fe2f64be7120fb6LL, 0x2039f90e987d6db3LL,
+    0x2090ac4d5c4434ddLL, 0x20e70f3245ffdb2dLL, 0x213d20e82f8bc101LL,
+    0x2192e09abb131d39LL, 0x21e84d76551cfb22LL, 0x223d66a836964508LL,
+    0x22922b5e66d9d67dLL, 0x22e69ac7bdb69141LL, 0x233ab413e5736fdaLL,
+    0x238e76735cd190d9LL, 0x23e1e117790c35deLL, 0x2434f33267d6b163LL,
+    0x2487abf731583e71LL, 0x24da0a99ba25bd51LL, 0x252c0e4ec5395056LL,
+    0x257db64bf5e7d3efLL, 0x25cf01c7d1d42d27LL, 0x261feff9c2e069c2LL,
+    0x2670801a191cad2aLL, 0x26c0b1620cb3e570LL, 0x2710830bbfd64398LL,
+    0x275ff45240a17279LL, 0x27af04718b06877fLL, 0x27fdb2a68aada89bLL,
+    0x284bfe2f1cd762beLL, 0x2899e64a123bac30LL, 0x28e76a3730e68e39LL,
+    0x293489373612716cLL, 0x2981428bd8000812LL, 0x29cd9577c7cbd228LL,
+    0x2a19813eb341365aLL, 0x2a65052546ab2b98LL, 0x2ab020712ea26ea3LL,
+    0x2afad26919d93f45LL, 0x2b451a54bae4a0acLL, 0x2b8ef77cca031883LL,
+    0x2bd8692b06e0e878LL, 0x2c216eaa3a59bdb7LL, 0x2c6a07463837d222LL,
+    0x2cb2324be0f07ae2LL, 0x2cf9ef09235e200cLL, 0x2d413cccfe779921LL,
+    0x2d881ae78304ea25LL, 0x2dce88a9d5515d12LL, 0x2e1485662edaf38aLL,
+    0x2e5a106fdfff2c87LL, 0x2e9f291b51a51a01LL, 0x2ee3cebe06e4c257LL,
+    0x2f2800ae9eabc97bLL, 0x2f6bbe44d55f5dbcLL, 0x2faf06d9867b6446LL,
+    0x2ff1d9c6ae2ee132LL, 0x303436676af59751LL, 0x30761c17ff2edba4LL,
+    0x30b78a35d2b198a3LL, 0x30f8801f745d7d69LL, 0x3138fd349ba954eeLL,
+    0x317900d62a2e816aLL, 0x31b88a662d319824LL, 0x31f79947df2819d2LL,
+    0x32362cdfa93b43d9LL, 0x3274449324c7f69fLL, 0x32b1dfc91cdbad55LL,
+    0x32eefde98fae8375LL, 0x332b9e5db01a445eLL, 0x3367c08fe70e8168LL,
+    0x33a363ebd501aae3LL, 0x33de87de535f286cLL, 0x34192bd575f26d10LL,
+    0x34534f408c4f03bbLL, 0x348cf1902335908eLL, 0x34c6123605f5c386LL,
+    0x34feb0a53fcd3934LL, 0x3536cc521d434606LL, 0x356e64b22d81a8d4LL,
+    0x35a5793c43aa215cLL, 0x35dc09687828e763LL, 0x361214b02a03ff37LL,
+    0x36479a8e00276857LL, 0x367c9a7deaae230aLL, 0x36b113fd242809c4LL,
+    0x36e5068a32dc7b22LL, 0x371871a4ea09d175LL, 0x374b54ce6b21a4bfLL,
+    0x377daf892701d40eLL, 0x37af8158df2a533fLL, 0x37e0c9c2a6efba24LL,
+    0x3811884ce4aa921bLL, 0x3841bc7f52e35f26LL, 0x387165e3017b61a4LL,
+    0x38a0840256d20dd4LL, 0x38cf166910e7363bLL, 0x38fd1ca44679e636LL,
+    0x392a96426823e9edLL, 0x395782d3417200e2LL, 0x3983e1e7f9f8b879LL,
+    0x39afb3131665ebc2LL, 0x39daf5e8798ee5e2LL, 0x3a05a9fd657b248dLL,
+    0x3a2fcee87c6bb7efLL, 0x3a596441c1df3d84LL, 0x3a8269a29b927359LL,
+    0x3aaadea5d27d6140LL, 0x3ad2c2e793cd1586LL, 0x3afa160571d9f2c0LL,
+    0x3b20d79e651a8c51LL, 0x3b470752cd130f54LL, 0x3b6ca4c471413595LL,
+    0x3b91af968204c05bLL, 0x3bb6276d998478c2LL, 0x3bda0befbc8fb36aLL,
+    0x3bfd5cc45b7c5557LL, 0x3c201994530157e0LL, 0x3c424209ed0dc97fLL,
+    0x3c63d5d0e19c4991LL, 0x3c84d4965782fcd4LL, 0x3ca53e08e53ff8c8LL,
+    0x3cc511d891c223ddLL, 0x3ce44fb6d52e8891LL, 0x3d02f75699a2198cLL,
+    0x3d21086c3befe4e7LL, 0x3d3e82ad8c5bb4bbLL, 0x3d5b65d1cf511b37LL,
+    0x3d77b191be16e872LL, 0x3d9365a7877f0846LL, 0x3dae81ced092c67aLL,
+    0x3dc905c4b53b7792LL, 0x3de2f147c8e784b2LL, 0x3dfc4418172bd8e4LL,
+    0x3e14fdf72461ae55LL, 0x3e2d1ea7ee40b9dbLL, 0x3e44a5eeec75b370LL,
+    0x3e5b939211353a0bLL, 0x3e71e758c9cb118aLL, 0x3e87a10bff25b938LL,
+    0x3e9cc076165e599cLL, 0x3eb14562f13d0848LL, 0x3ec52f9feeb96056LL,
+    0x3ed87efbeb776e61LL, 0x3eeb33474240eec2LL, 0x3efd4c53cc7adcddLL,
+    0x3f0ec9f4e297526bLL, 0x3f1fabff5c83b59dLL, 0x3f2ff2499213350fLL,
+    0x3f3f9cab5b65907dLL, 0x3f4eaafe114a2d43LL, 0x3f5d1d1c8d9f75b1LL,
+    0x3f6af2e32bae8247LL, 0x3f782c2fc8830bf5LL, 0x3f84c8e1c33fa68fLL,
+    0x3f90c8d9fd6e4299LL, 0x3f9c2bfadb4cf5a9LL, 0x3fa6f228441708a9LL,
+    0x3fb11b47a24a4b3cLL, 0x3fbaa73fe3e8ab95LL, 0x3fc395f97ab61234LL,
+    0x3fcbe75e5c7280d9LL, 0x3fd39b5a0310742aLL, 0x3fdab1d96ce78786LL,
+    0x3fe12acb1ce35a81LL, 0x3fe7061f1aaeb79bLL, 0x3fec43c6f2dafbc7LL,
+    0x3ff0e3b5b703be63LL, 0x3ff4e5dffdeeb93aLL, 0x3ff84a3be3a7f05fLL,
+    0x3ffb10c1099a1976LL, 0x3ffd396896a34257LL, 0x3ffec42d3725b6afLL,
+    0x3fffb10b1d15249bLL, 0x4000000000000000LL
+};
+
+// Q2.62 (a * b) >> 62
+static inline int64_t fixed_trig_mul(int64_t a, int64_t b)
+{
+    return nymya_mul_shr(a, b, 62);
+}
+
+// Q2.62 in [0, 1] to Q32.32, rounded to nearest
+static inline int64_t fixed_trig_round(int64_t v)
+{
+    return (v + (1LL << 29)) >> 30;
+}
+
+/**
+ * fixed_point_sincos - Sine and cosine of a fixed-point angle.
+ * @angle_fp: The angle in Q32.32 fixed-point format (radians), any value.
+ * @tier: NYMYA_TRIG_FAST, NYMYA_TRIG_BALANCED or NYMYA_TRIG_PRECISE.
+ * @sin_fp: Receives sin(angle_fp) in Q32.32.
+ * @cos_fp: Receives cos(angle_fp) in Q32.32.
+ *
+ * The angle is reduced modulo 2*pi by two 128-bit multiplies, so the cost
+ * is the same for every input. The quadrant then selects symmetries of a
+ * quarter-wave table: FAST interpolates the table linearly (error below
+ * 5e-6). BALANCED and PRECISE add the angle offset from the table point
+ * through sin(a + d) = sin a cos d + cos a sin d with d < pi/512, using a
+ * 2nd-order series for cos d and sin d (error below 4e-8) or a 4th-order
+ * one, which is within one unit of Q32.32.
+ */
+void fixed_point_sincos(int64_t angle_fp, int tier, int64_t *sin_fp, int64_t *cos_fp)
+{
+    uint64_t turn = (uint64_t)nymya_mul_shr(angle_fp, FIXED_TRIG_INV_2PI_HI, 32) +
+                    (uint64_t)nymya_mul_shr(angle_fp, FIXED_TRIG_INV_2PI_LO, 96);
+    unsigned int quadrant = (unsigned int)(turn >> 62);
+    uint64_t frac = turn & ((1ULL << 62) - 1);
+    unsigned int i = (unsigned int)(frac >> FIXED_TRIG_REM_BITS);
+    int64_t rem = (int64_t)(frac & ((1ULL << FIXED_TRIG_REM_BITS) - 1));
+    int64_t s = fixed_trig_table[i];
+    int64_t c = fixed_trig_table[FIXED_TRIG_STEPS - i];
+    int64_t sr, cr;
+
+    if (tier == NYMYA_TRIG_FAST) {
+        // Neighbours toward larger angles: sin rises to entry i + 1, cos falls to 255 - i
+        sr = s + nymya_mul_shr(fixed_trig_table[i + 1] - s, rem, FIXED_TRIG_REM_BITS);
+        cr = c + nymya_mul_shr(fixed_trig_table[FIXED_TRIG_STEPS - 1 - i] - c, rem,
+                               FIXED_TRIG_REM_BITS);
+    } else {
+        int64_t d = nymya_mul_shr(rem, FIXED_TRIG_STEP, FIXED_TRIG_REM_BITS);
+        int64_t d2 = fixed_trig_mul(d, d);
+        int64_t cd, sd;
+
+        if (tier == NYMYA_TRIG_BALANCED) {
+            // cos d = 1 - d^2/2, sin d = d
+            cd = (1LL << 62) - (d2 >> 1);
+            sd = d;
+        } else {
+            int64_t d3 = fixed_trig_mul(d2, d);
+            int64_t d4 = fixed_trig_mul(d2, d2);
+            // cos d = 1 - d^2/2 + d^4/24, sin d = d - d^3/6
+            cd = (1LL << 62) - (d2 >> 1) + d4 / 24;
+            sd = d - d3 / 6;
+        }
+
+        sr = fixed_trig_mul(s, cd) + fixed_trig_mul(c, sd);
+        cr = fixed_trig_mul(c, cd) - fixed_trig_mul(s, sd);
+    }
+
+    // |sin| and |cos| of the quadrant offset, then the quadrant's signs
+    sr = fixed_trig_round(sr);
+    cr = fixed_trig_round(cr);
+    switch (quadrant) {
+    case 0: *sin_fp = sr;  *cos_fp = cr;  break;
+    case 1: *sin_fp = cr;  *cos_fp = -sr; break;
+    case 2: *sin_fp = -sr; *cos_fp = -cr; break;
+    default: *sin_fp = -cr; *cos_fp = sr; break;
+    }
+}
 
 /**
  * fixed_point_sin - Calculate the sine of a fixed-point angle.
  * @angle_fp: The angle in Q32.32 fixed-point format.
  *
- * Normalizes the angle to the range [-PI, PI] and uses a Taylor series
- * expansion to approximate sine: sin(x) ≈ x − x³/6.
+ * Uses fixed_point_sincos() at the NYMYA_TRIG_TIER accuracy tier.
  *
  * Returns:
  *   The sine of angle_fp as a Q32.32 fixed-point int64_t.
  */
-int64_t fixed_point_sin(int64_t angle_fp) {
-    // Normalize to [-PI, PI]
-    while (angle_fp > FIXED_POINT_PI)
-        angle_fp -= (FIXED_POINT_PI << 1);
-    while (angle_fp < -FIXED_POINT_PI)
-        angle_fp += (FIXED_POINT_PI << 1);
-
-    // Taylor series: sin(x) ≈ x − x³/6
-    int64_t x = angle_fp;
-    int64_t x2 = fixed_point_mul(x, x);
-    int64_t x3 = fixed_point_mul(x2, x);
-    int64_t sixth = (int64_t)((1.0/6.0) * FIXED_POINT_SCALE);
-    int64_t term2 = fixed_point_mul(x3, sixth);
-    return x - term2;
+int64_t fixed_point_sin(int64_t angle_fp)
+{
+    int64_t s, c;
+
+    fixed_point_sincos(angle_fp, NYMYA_TRIG_TIER, &s, &c);
+    return s;
 }
@@ -1,15 +1,22 @@
 // src/log.c
 //
 // Defines the log_symbolic_event function for both kernel and userland.
-// In the kernel, it uses pr_info for logging. In userland, it uses printf.
+// In the kernel, it records into the per-CPU binary event ring (pr_info only
+// when the event_printk module parameter is set). In userland, it formats into
+// per-thread buffers drained by a background writer thread, subject to a
+// runtime-selectable log level.
 
 #include "nymya.h" // Assumed to define common types like uint64_t and nymya_qubit
 
 #ifdef __KERNEL__
     #include <linux/kernel.h> // For pr_info
-    #include <linux/module.h> // For EXPORT_SYMBOL_GPL
+    #include <linux/module.h> // For EXPORT_SYMBOL_GPL, module_param
     #include <linux/types.h>  // For uint64_t if not already in nymya.h
 
+    static bool event_printk;
+    module_param(event_printk, bool, 0644);
+    MODULE_PARM_DESC(event_printk, "Also pr_info() every symbolic event (slow, legacy behaviour)");
+
     /**
      * log_symbolic_event - Kernel-side implementation for logging symbolic events.
      * @gate: The name of the gate or event.
@@ -17,16 +24,20 @@
      * @tag: An optional tag for the qubit.
      * @msg: A descriptive message for the event.
      *
-     * This function provides a basic logging mechanism for quantum gate operations
-     * or other symbolic events within the kernel. It uses pr_info to output
-     * a message to the kernel log.
+     * Appends a labelled record (gate code 0) to the per-CPU event ring (see
+     * nymya_event_ring.c), which costs a few stores; the gate call itself is
+     * recorded with its code and result by NYMYA_TRACE_CORE. The formatted
+     * pr_info line is only produced when the event_printk module parameter is set.
      *
      * Returns: 0 on success.
      */
     int log_symbolic_event(const char* gate, uint64_t id, const char* tag, const char* msg) {
+        nymya_event_emit(0, id, 0, gate);
+
         // For kernel logging (pr_info), %llu is generally correct for uint64_t
-        pr_info("NYMYA_KERNEL_EVENT: [%s] Qubit ID %llu (%s): %s\n",
-                gate, id, tag ? tag : "untagged", msg);
+        if (unlikely(event_printk))
+            pr_info("NYMYA_KERNEL_EVENT: [%s] Qubit ID %llu (%s): %s\n",
+                    gate, id, tag ? tag : "untagged", msg);
         return 0;
     }
     // Export the symbol so other kernel modules can use this logging function.
@@ -34,9 +45,337 @@
 
 #else // Userland implementation
 
-    #include <stdio.h>    // For printf
+    #include <stdio.h>    // For fwrite, snprintf
     #include <stdint.h>   // For uint64_t
     #include <inttypes.h> // For PRIu64 macro
+    #include <stdlib.h>   // For getenv, malloc, atexit
+    #include <string.h>   // For strcmp
+    #include <pthread.h>  // For the background writer thread
+    #include <sched.h>    // For sched_yield
+
+    // Size of one per-thread log buffer handed to the writer thread
+    #define NYMYA_LOG_CHUNK 16384
+
+    // Distinct gate labels tracked per thread in summary mode
+    #define NYMYA_LOG_SUMMARY_SLOTS 128
+
+    /**
+     * nymya_log_chunk - A filled per-thread buffer queued for the writer thread.
+     * @next: Next chunk in the writer queue.
+     * @len: Number of valid bytes in @data.
+     * @data: Formatted event lines.
+     */
+    typedef struct nymya_log_chunk {
+        struct nymya_log_chunk *next;
+        size_t len;
+        char data[NYMYA_LOG_CHUNK];
+    } nymya_log_chunk;
+
+    /**
+     * nymya_log_count - Per-label event counter used in summary mode.
+     * @gate: Gate label (callers pass string literals, so the pointer is stable).
+     * @count: Number of events recorded under @gate.
+     */
+    typedef struct {
+        const char *gate;
+        uint64_t count;
+    } nymya_log_count;
+
+    /**
+     * nymya_log_thread - Per-thread logger state.
+     * @next: Next entry in the global thread list.
+     * @lock: Held by the owner while it fills @chunk and by shutdown while
+     *        it takes @chunk; never contended otherwise. Taken before
+     *        nymya_log_lock when both are needed.
+     * @chunk: Buffer currently being filled by this thread.
+     * @drained: Set by shutdown once it took @chunk; under nymya_log_lock.
+     * @counts: Summary-mode counters, open-addressed by label pointer; only
+     *          the owner writes them, with atomic stores that shutdown reads.
+     */
+    typedef struct nymya_log_thread {
+        struct nymya_log_thread *next;
+        pthread_mutex_t lock;
+        nymya_log_chunk *chunk;
+        int drained;
+        nymya_log_count counts[NYMYA_LOG_SUMMARY_SLOTS];
+    } nymya_log_thread;
+
+    static volatile int nymya_log_level_cur = NYMYA_LOG_FULL;
+    static pthread_once_t nymya_log_once = PTHREAD_ONCE_INIT;
+    static pthread_key_t nymya_log_key;
+    static __thread nymya_log_thread *nymya_log_self;
+
+    static pthread_mutex_t nymya_log_lock = PTHREAD_MUTEX_INITIALIZER;
+    static pthread_cond_t nymya_log_cond = PTHREAD_COND_INITIALIZER;
+    static nymya_log_thread *nymya_log_threads;   // All live per-thread states
+    static nymya_log_chunk *nymya_log_queue_head; // Chunks waiting for the writer
+    static nymya_log_chunk *nymya_log_queue_tail;
+    static nymya_log_count nymya_log_totals[NYMYA_LOG_SUMMARY_SLOTS]; // Counts of exited threads
+    static pthread_t nymya_log_writer;
+    static int nymya_log_writer_running;
+    static int nymya_log_writer_done; // Writer exited; later chunks are written synchronously
+    static int nymya_log_stopping;    // Set by shutdown; read without the lock
+
+    /**
+     * nymya_log_writer_main - Background thread draining queued chunks to stdout.
+     * @arg: Unused.
+     *
+     * Blocks on the queue condition variable, so an idle logger costs nothing.
+     */
+    static void *nymya_log_writer_main(void *arg) {
+        (void)arg;
+        pthread_mutex_lock(&nymya_log_lock);
+        for (;;) {
+            while (!nymya_log_queue_head && !nymya_log_stopping)
+                pthread_cond_wait(&nymya_log_cond, &nymya_log_lock);
+
+            nymya_log_chunk *c = nymya_log_queue_head;
+            nymya_log_queue_head = nymya_log_queue_tail = NULL;
+            if (!c && nymya_log_stopping) {
+                nymya_log_writer_done = 1;
+                pthread_cond_broadcast(&nymya_log_cond);
+                break;
+            }
+
+            // Write without holding the lock so producers never wait on stdout
+            pthread_mutex_unlock(&nymya_log_lock);
+            while (c) {
+                nymya_log_chunk *next = c->next;
+                fwrite(c->data, 1, c->len, stdout);
+                free(c);
+                c = next;
+            }
+            fflush(stdout);
+            pthread_mutex_lock(&nymya_log_lock);
+        }
+        pthread_mutex_unlock(&nymya_log_lock);
+        return NULL;
+    }
+
+    /**
+     * nymya_log_enqueue_locked - Queues a chunk for the writer; caller holds nymya_log_lock.
+     * @c: Chunk to queue. Empty chunks are freed instead.
+     *
+     * Once shutdown has begun the chunk is written here instead, after the
+     * writer has drained what was queued before, so nothing logged at exit
+     * is lost or reordered and the writer is not kept busy forever.
+     */
+    static void nymya_log_enqueue_locked(nymya_log_chunk *c) {
+        if (!c)
+            return;
+        if (!c->len) {
+            free(c);
+            return;
+        }
+        if (nymya_log_stopping) {
+            while (nymya_log_writer_running && !nymya_log_writer_done)
+                pthread_cond_wait(&nymya_log_cond, &nymya_log_lock);
+            fwrite(c->data, 1, c->len, stdout);
+            fflush(stdout);
+            free(c);
+            return;
+        }
+        c->next = NULL;
+        if (nymya_log_queue_tail)
+            nymya_log_queue_tail->next = c;
+        else
+            nymya_log_queue_head = c;
+        nymya_log_queue_tail = c;
+
+        // Started lazily so that processes which never log never create a thread
+        if (!nymya_log_writer_running &&
+            pthread_create(&nymya_log_writer, NULL, nymya_log_writer_main, NULL) == 0)
+            nymya_log_writer_running = 1;
+        pthread_cond_signal(&nymya_log_cond);
+    }
+
+    /**
+     * nymya_log_merge_counts - Adds one counter table into another.
+     * @dst: Destination table.
+     * @src: Source table.
+     */
+    static void nymya_log_merge_counts(nymya_log_count *dst, const nymya_log_count *src) {
+        for (int i = 0; i < NYMYA_LOG_SUMMARY_SLOTS; i++) {
+            // @src may belong to a thread that is still counting
+            const char *gate = __atomic_load_n(&src[i].gate, __ATOMIC_ACQUIRE);
+            uint64_t count = __atomic_load_n(&src[i].count, __ATOMIC_RELAXED);
+
+            if (!gate)
+                continue;
+            for (int j = 0; j < NYMYA_LOG_SUMMARY_SLOTS; j++) {
+                if (!dst[j].gate) {
+                    dst[j].gate = gate;
+                    dst[j].count = count;
+                    break;
+                }
+                if (dst[j].gate == gate || strcmp(dst[j].gate, gate) == 0) {
+                    dst[j].count += count;
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * nymya_log_thread_exit - pthread key destructor for a per-thread state.
+     * @arg: The exiting thread's nymya_log_thread.
+     */
+    static void nymya_log_thread_exit(void *arg) {
+        nymya_log_thread *t = arg;
+
+        pthread_mutex_lock(&nymya_log_lock);
+        for (nymya_log_thread **pp = &nymya_log_threads; *pp; pp = &(*pp)->next) {
+            if (*pp == t) {
+                *pp = t->next;
+                break;
+            }
+        }
+        // Shutdown only takes @t->lock with nymya_log_lock held, so @chunk is ours
+        nymya_log_enqueue_locked(t->chunk);
+        nymya_log_merge_counts(nymya_log_totals, t->counts);
+        pthread_mutex_unlock(&nymya_log_lock);
+        pthread_mutex_destroy(&t->lock);
+        free(t);
+    }
+
+    /**
+     * nymya_log_shutdown - atexit handler: drains every buffer and prints the summary.
+     *
+     * The writer first drains what is queued and exits; from then on every
+     * chunk and event is written synchronously. Each thread's partial chunk
+     * is then taken under its lock, waiting out a thread that is in the
+     * middle of an event; a thread still logging afterwards sees
+     * nymya_log_stopping and writes its events itself.
+     */
+    static void nymya_log_shutdown(void) {
+        nymya_log_count totals[NYMYA_LOG_SUMMARY_SLOTS];
+
+        pthread_mutex_lock(&nymya_log_lock);
+        __atomic_store_n(&nymya_log_stopping, 1, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&nymya_log_cond);
+        int running = nymya_log_writer_running;
+        pthread_mutex_unlock(&nymya_log_lock);
+
+        if (running)
+            pthread_join(nymya_log_writer, NULL);
+
+        for (int busy = 1; busy;) {
+            busy = 0;
+            pthread_mutex_lock(&nymya_log_lock);
+            for (nymya_log_thread *t = nymya_log_threads; t; t = t->next) {
+                if (t->drained)
+                    continue;
+                // Owners take nymya_log_lock inside their own lock, so only try
+                if (pthread_mutex_trylock(&t->lock)) {
+                    busy = 1;
+                    continue;
+                }
+                nymya_log_enqueue_locked(t->chunk);
+                t->chunk = NULL;
+                t->drained = 1;
+                pthread_mutex_unlock(&t->lock);
+            }
+            pthread_mutex_unlock(&nymya_log_lock);
+            if (busy)
+                sched_yield();
+        }
+
+        pthread_mutex_lock(&nymya_log_lock);
+        memcpy(totals, nymya_log_totals, sizeof(totals));
+        for (nymya_log_thread *t = nymya_log_threads; t; t = t->next)
+            nymya_log_merge_counts(totals, t->counts);
+        pthread_mutex_unlock(&nymya_log_lock);
+
+        for (int i = 0; i < NYMYA_LOG_SUMMARY_SLOTS; i++) {
+            if (totals[i].gate)
+                printf("NYMYA_USERLAND_SUMMARY: [%s] %" PRIu64 " events\n",
+                       totals[i].gate, totals[i].count);
+        }
+        fflush(stdout);
+    }
+
+    /**
+     * nymya_log_init - One-time setup: reads NYMYA_LOG and registers exit hooks.
+     *
+     * NYMYA_LOG accepts "off", "summary" or "full" (the default).
+     */
+    static void nymya_log_init(void) {
+        const char *env = getenv("NYMYA_LOG");
+
+        if (env) {
+            if (strcmp(env, "off") == 0)
+                nymya_log_level_cur = NYMYA_LOG_OFF;
+            else if (strcmp(env, "summary") == 0)
+                nymya_log_level_cur = NYMYA_LOG_SUMMARY;
+            else if (strcmp(env, "full") == 0)
+                nymya_log_level_cur = NYMYA_LOG_FULL;
+        }
+        pthread_key_create(&nymya_log_key, nymya_log_thread_exit);
+        atexit(nymya_log_shutdown);
+    }
+
+    /**
+     * nymya_log_get_thread - Returns (creating on first use) the caller's logger state.
+     *
+     * Returns: The per-thread state, or NULL if allocation failed.
+     */
+    static nymya_log_thread *nymya_log_get_thread(void) {
+        nymya_log_thread *t = nymya_log_self;
+
+        if (t)
+            return t;
+        t = calloc(1, sizeof(*t));
+        if (!t)
+            return NULL;
+        pthread_mutex_init(&t->lock, NULL);
+
+        pthread_mutex_lock(&nymya_log_lock);
+        t->next = nymya_log_threads;
+        nymya_log_threads = t;
+        pthread_mutex_unlock(&nymya_log_lock);
+
+        pthread_setspecific(nymya_log_key, t);
+        nymya_log_self = t;
+        return t;
+    }
+
+    /**
+     * nymya_log_set_level - Selects how much userland gate logging is produced.
+     * @level: NYMYA_LOG_OFF, NYMYA_LOG_SUMMARY or NYMYA_LOG_FULL.
+     *
+     * Overrides the NYMYA_LOG environment variable. Takes effect immediately
+     * for all threads.
+     */
+    void nymya_log_set_level(nymya_log_level level) {
+        pthread_once(&nymya_log_once, nymya_log_init);
+        __atomic_store_n(&nymya_log_level_cur, (int)level, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * nymya_log_get_level - Returns the current userland log level.
+     */
+    nymya_log_level nymya_log_get_level(void) {
+        pthread_once(&nymya_log_once, nymya_log_init);
+        return (nymya_log_level)__atomic_load_n(&nymya_log_level_cur, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * nymya_log_flush - Hands the calling thread's partial buffer to the writer thread.
+     *
+     * Useful before the caller itself writes to stdout, so lines stay ordered.
+     */
+    void nymya_log_flush(void) {
+        nymya_log_thread *t = nymya_log_self;
+
+        if (!t)
+            return;
+        pthread_mutex_lock(&t->lock);
+        pthread_mutex_lock(&nymya_log_lock);
+        nymya_log_enqueue_locked(t->chunk);
+        pthread_mutex_unlock(&nymya_log_lock);
+        t->chunk = NULL;
+        pthread_mutex_unlock(&t->lock);
+    }
 
     /**
      * log_symbolic_event - Userland implementation for logging symbolic events.
@@ -45,18 +384,88 @@
      * @tag: An optional tag for the qubit.
      * @msg: A descriptive message for the event.
      *
-     * This function provides a basic logging mechanism for quantum gate operations
-     * or other symbolic events in userland. It uses printf to output a message
-     * to standard output.
+     * Behaviour depends on the log level (see nymya_log_set_level()):
+     * - NYMYA_LOG_OFF: returns immediately, no I/O and no formatting.
+     * - NYMYA_LOG_SUMMARY: bumps a per-thread counter for @gate; totals are
+     *   printed once at process exit.
+     * - NYMYA_LOG_FULL: formats the event into a per-thread buffer that a
+     *   background thread drains to standard output. Once process exit has
+     *   begun the line is written to standard output before this returns.
+     *
+     * At any level, while a binary trace runs (nymya_btrace_enabled()) the
+     * event is also recorded there as an instant event labelled @gate.
      *
      * Returns: 0 on success.
      */
     int log_symbolic_event(const char* gate, uint64_t id, const char* tag, const char* msg) {
-        // Using PRIu64 for platform-independent printing of uint64_t
-        printf("NYMYA_USERLAND_EVENT: [%s] Qubit ID %" PRIu64 " (%s): %s\n",
-               gate, id, tag ? tag : "untagged", msg);
+        pthread_once(&nymya_log_once, nymya_log_init);
+
+        if (nymya_btrace_enabled())
+            nymya_btrace_event(0, id, 0, 0, 0, 0, gate);
+
+        int level = __atomic_load_n(&nymya_log_level_cur, __ATOMIC_RELAXED);
+        if (level == NYMYA_LOG_OFF)
+            return 0;
+
+        nymya_log_thread *t = nymya_log_get_thread();
+        if (!t)
+            return 0;
+
+        if (level == NYMYA_LOG_SUMMARY) {
+            // Labels are string literals, so hashing the pointer is enough
+            size_t h = ((uintptr_t)gate >> 3) % NYMYA_LOG_SUMMARY_SLOTS;
+            for (int probe = 0; probe < NYMYA_LOG_SUMMARY_SLOTS; probe++) {
+                nymya_log_count *c = &t->counts[(h + probe) % NYMYA_LOG_SUMMARY_SLOTS];
+                if (c->gate == gate) {
+                    __atomic_store_n(&c->count, c->count + 1, __ATOMIC_RELAXED);
+                    break;
+                }
+                if (!c->gate) {
+                    __atomic_store_n(&c->count, 1, __ATOMIC_RELAXED);
+                    __atomic_store_n(&c->gate, gate, __ATOMIC_RELEASE);
+                    break;
+                }
+            }
+            return 0;
+        }
+
+        // Shutdown takes the chunk under the same lock
+        pthread_mutex_lock(&t->lock);
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (!t->chunk) {
+                t->chunk = malloc(sizeof(*t->chunk));
+                if (!t->chunk)
+                    break;
+                t->chunk->len = 0;
+            }
+
+            size_t room = NYMYA_LOG_CHUNK - t->chunk->len;
+            // Using PRIu64 for platform-independent printing of uint64_t
+            int n = snprintf(t->chunk->data + t->chunk->len, room,
+                             "NYMYA_USERLAND_EVENT: [%s] Qubit ID %" PRIu64 " (%s): %s\n",
+                             gate, id, tag ? tag : "untagged", msg);
+            if (n < 0)
+                break;
+            if ((size_t)n < room) {
+                t->chunk->len += (size_t)n;
+                break;
+            }
+            // Line did not fit: ship the full chunk and retry in a fresh one
+            pthread_mutex_lock(&nymya_log_lock);
+            nymya_log_enqueue_locked(t->chunk);
+            pthread_mutex_unlock(&nymya_log_lock);
+            t->chunk = NULL;
+        }
+
+        // During shutdown every event is written before returning
+        if (__atomic_load_n(&nymya_log_stopping, __ATOMIC_ACQUIRE) && t->chunk) {
+            pthread_mutex_lock(&nymya_log_lock);
+            nymya_log_enqueue_locked(t->chunk);
+            pthread_mutex_unlock(&nymya_log_lock);
+            t->chunk = NULL;
+        }
+        pthread_mutex_unlock(&t->lock);
         return 0;
     }
 
 #endif // __KERNEL__
-
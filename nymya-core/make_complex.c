@@ -0,0 +1,23 @@
+// src/make_complex.c
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+
+/**
+ * make_complex - Builds a fixed-point complex_double from its parts.
+ * @re_fp: Real part in Q32.32.
+ * @im_fp: Imaginary part in Q32.32.
+ *
+ * Returns:
+ *   The complex number re_fp + i*im_fp.
+ */
+complex_double make_complex(int64_t re_fp, int64_t im_fp) {
+    complex_double result;
+
+    result.re = re_fp;
+    result.im = im_fp;
+    return result;
+}
+
+#endif // __KERNEL__
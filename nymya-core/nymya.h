@@ -17,6 +17,7 @@
 
     #include <linux/types.h>
     #include <linux/string.h>
+    #include <linux/ioctl.h>
 
     typedef __s64 int64_t;
     typedef __u64 uint64_t;
@@ -31,8 +32,6 @@
 
     /* Fixed-point math function prototypes */
     int64_t fixed_point_mul(int64_t val1, int64_t val2);
-    int64_t fixed_point_cos(int64_t angle_fp);
-    int64_t fixed_point_sin(int64_t angle_fp);
     int64_t fixed_point_square(int64_t val);
     complex_double make_complex(int64_t re_fp, int64_t im_fp);
     complex_double complex_mul(complex_double a, complex_double b);
@@ -40,13 +39,9 @@
     int64_t complex_re(complex_double c);
     int64_t complex_im(complex_double c);
     complex_double complex_conj(complex_double c);
-    int64_t fixed_sin(int64_t theta);
-    int64_t fixed_cos(int64_t theta);
     complex_double complex_exp_i(int64_t theta_fp);
     
     // additional functions
-    int64_t fixed_sin(int64_t theta);
-    int64_t fixed_cos(int64_t theta);
     int64_t fixed_conj(int64_t re, int64_t im);
 
 #else // userspace
@@ -57,22 +52,94 @@
     #include <complex.h>
     #include <string.h>
     #include <math.h>
+    #include <sys/ioctl.h>
 
     /**
      * complex_double - Userspace native complex double type.
      */
     typedef _Complex double complex_double;
 
-    /* Userspace complex math function prototypes */
-    complex_double make_complex(double re, double im);
-    complex_double complex_mul(complex_double a, complex_double b);
-    complex_double complex_exp_i(double theta);
-    double complex_re(complex_double c);
-    double complex_im(complex_double c);
-    complex_double complex_conj(complex_double c);
+    /*
+     * Userspace complex math, static inline so that gate loops can inline
+     * and vectorise it. complex_abi.c defines NYMYA_COMPLEX_DEF as empty to
+     * emit the same bodies as the out-of-line symbols libnymya exports.
+     * complex_mul() spells out the product instead of using '*', which
+     * would add the Annex G NaN/Inf recovery call (__muldc3) to each use.
+     */
+    #ifndef NYMYA_COMPLEX_DEF
+    #define NYMYA_COMPLEX_DEF static inline
+    #endif
+
+    NYMYA_COMPLEX_DEF complex_double make_complex(double re, double im) {
+        return CMPLX(re, im);
+    }
+
+    NYMYA_COMPLEX_DEF complex_double complex_mul(complex_double a, complex_double b) {
+        double ar = creal(a), ai = cimag(a), br = creal(b), bi = cimag(b);
+
+        return CMPLX(ar * br - ai * bi, ar * bi + ai * br);
+    }
+
+    NYMYA_COMPLEX_DEF complex_double complex_exp_i(double theta) {
+        return CMPLX(cos(theta), sin(theta));
+    }
+
+    NYMYA_COMPLEX_DEF double complex_re(complex_double c) {
+        return creal(c);
+    }
+
+    NYMYA_COMPLEX_DEF double complex_im(complex_double c) {
+        return cimag(c);
+    }
+
+    NYMYA_COMPLEX_DEF complex_double complex_conj(complex_double c) {
+        return conj(c);
+    }
+
+    /**
+     * nymya_log_level - Userland symbolic event logging levels.
+     * @NYMYA_LOG_OFF: No logging; gate calls do no I/O at all.
+     * @NYMYA_LOG_SUMMARY: Per-label event counts, printed once at exit.
+     * @NYMYA_LOG_FULL: One line per event, written by a background thread.
+     *
+     * The initial level comes from the NYMYA_LOG environment variable
+     * ("off", "summary", "full"); the default is NYMYA_LOG_FULL.
+     */
+    typedef enum {
+        NYMYA_LOG_OFF = 0,
+        NYMYA_LOG_SUMMARY = 1,
+        NYMYA_LOG_FULL = 2
+    } nymya_log_level;
+
+    void nymya_log_set_level(nymya_log_level level);
+    nymya_log_level nymya_log_get_level(void);
+    void nymya_log_flush(void);
 
 #endif // __KERNEL__
 
+/*
+ * Accuracy tiers of fixed_point_sincos(). FAST interpolates a quarter-wave
+ * table linearly (error below 5e-6); BALANCED corrects the table point with
+ * a 2nd-order series (below 4e-8) and PRECISE with a 4th-order one, within
+ * one unit of Q32.32. fixed_sin(), fixed_cos(), the fixed_point_ variants
+ * and the gate cores use NYMYA_TRIG_TIER, PRECISE unless the build defines
+ * it (e.g. -DNYMYA_TRIG_TIER=NYMYA_TRIG_BALANCED). "make trig-bench"
+ * reports the speed and error of every tier on the build machine.
+ */
+#define NYMYA_TRIG_FAST     0
+#define NYMYA_TRIG_BALANCED 1
+#define NYMYA_TRIG_PRECISE  2
+#ifndef NYMYA_TRIG_TIER
+#define NYMYA_TRIG_TIER NYMYA_TRIG_PRECISE
+#endif
+
+// Fixed-point trigonometry; fixed_point_sin.c and the wrappers build on both sides
+void fixed_point_sincos(int64_t angle_fp, int tier, int64_t *sin_fp, int64_t *cos_fp);
+int64_t fixed_point_sin(int64_t angle_fp);
+int64_t fixed_point_cos(int64_t angle_fp);
+int64_t fixed_sin(int64_t theta);
+int64_t fixed_cos(int64_t theta);
+
 
 // Common structure definitions, visible to both kernel and userspace
 /**
@@ -88,32 +155,98 @@ typedef struct nymya_qubit {
 } nymya_qubit;
 
 /**
- * nymya_qpos3d_k - 3D fixed-point position struct for kernel space (and userland marshalling).
- * @q: Associated qubit.
+ * nymya_qubit_k - Kernel-layout qubit for userland marshalling.
+ * @id: Unique qubit identifier.
+ * @tag: Label/tag for qubit, max NYMYA_TAG_MAXLEN chars.
+ * @re, im: Amplitude in Q32.32 fixed-point.
+ *
+ * Same layout as the kernel's nymya_qubit; userland wrappers convert their
+ * double amplitudes into this form before passing qubit arrays to a syscall.
+ */
+typedef struct nymya_qubit_k {
+    uint64_t id;
+    char tag[NYMYA_TAG_MAXLEN];
+    int64_t re, im;
+} nymya_qubit_k;
+
+/**
+ * nymya_tag_t - Handle of an interned qubit tag.
+ *
+ * Userland maps tags to handles with nymya_tag_intern() and back with
+ * nymya_tag_str(); NYMYA_TAG_NONE stands for an empty tag.
+ */
+typedef uint32_t nymya_tag_t;
+
+#define NYMYA_TAG_NONE 0
+
+/**
+ * nymya_qubit_c - Compact qubit: ID, tag handle and amplitude.
+ * @id: Unique qubit identifier, at the same offset as in nymya_qubit.
+ * @tag: Interned tag handle, or NYMYA_TAG_NONE.
+ * @flags: Reserved, must be zero.
+ * @amplitude: Qubit amplitude as complex number (type depends on compilation).
+ *
+ * 32 bytes where nymya_qubit takes 56: the label is stored once in the tag
+ * table instead of in every copy of the qubit, and the amplitude shares a
+ * half cache line with the ID.
+ */
+typedef struct nymya_qubit_c {
+    uint64_t id;
+    nymya_tag_t tag;
+    uint32_t flags;
+    complex_double amplitude;
+} nymya_qubit_c;
+
+/**
+ * nymya_qubit_ck - Kernel-layout compact qubit for userland marshalling.
+ * @id: Unique qubit identifier.
+ * @tag: Interned tag handle, or NYMYA_TAG_NONE.
+ * @flags: Reserved, must be zero.
+ * @re, im: Amplitude in Q32.32 fixed-point.
+ *
+ * Same layout as the kernel's nymya_qubit_c, as nymya_qubit_k is to nymya_qubit.
+ */
+typedef struct nymya_qubit_ck {
+    uint64_t id;
+    nymya_tag_t tag;
+    uint32_t flags;
+    int64_t re, im;
+} nymya_qubit_ck;
+
+// Qubit of the kernel-layout positions: the kernel's own, or its userland twin
+#ifdef __KERNEL__
+#define NYMYA_QPOS_K_QUBIT nymya_qubit
+#else
+#define NYMYA_QPOS_K_QUBIT nymya_qubit_k
+#endif
+
+/**
+ * nymya_qpos3d_k - 3D fixed-point position struct for kernel space and userland.
+ * @q: Associated qubit; a nymya_qubit_k, with a Q32.32 amplitude, in userland.
  * @x, y, z: Q32.32 fixed-point coordinates.
  */
 typedef struct {
-    nymya_qubit q;
+    NYMYA_QPOS_K_QUBIT q;
     int64_t    x, y, z;
 } nymya_qpos3d_k;
 
 /**
- * nymya_qpos4d_k - 4D fixed-point position struct for kernel space (and userland marshalling).
- * @q: Associated qubit.
+ * nymya_qpos4d_k - 4D fixed-point position struct for kernel space and userland.
+ * @q: Associated qubit; a nymya_qubit_k, with a Q32.32 amplitude, in userland.
  * @x, y, z, w: Q32.32 fixed-point coordinates.
  */
 typedef struct {
-    nymya_qubit q;
+    NYMYA_QPOS_K_QUBIT q;
     int64_t    x, y, z, w;
 } nymya_qpos4d_k;
 
 /**
- * nymya_qpos5d_k - 5D fixed-point position struct for kernel space (and userland marshalling).
- * @q: Associated qubit.
+ * nymya_qpos5d_k - 5D fixed-point position struct for kernel space and userland.
+ * @q: Associated qubit; a nymya_qubit_k, with a Q32.32 amplitude, in userland.
  * @x, y, z, w, v: Q32.32 fixed-point coordinates.
  */
 typedef struct {
-    nymya_qubit q;
+    NYMYA_QPOS_K_QUBIT q;
     int64_t    x, y, z, w, v;
 } nymya_qpos5d_k;
 
@@ -148,6 +281,1107 @@ typedef struct {
     nymya_qubit q;
 } nymya_qpos5d;
 
+// Most coordinates a lattice site can have (the 5D lattices)
+#define NYMYA_LATTICE_MAX_DIM 5
+
+// Length of the gate label stored in each binary event record
+#define NYMYA_EVENT_LABEL_LEN 16
+
+// Number of records in each per-CPU event ring (must be a power of two)
+#define NYMYA_EVENT_RING_ENTRIES 4096
+
+/**
+ * nymya_event_rec - Fixed-size binary event record written by the kernel event ring.
+ * @ts_ns: local_clock() timestamp in nanoseconds.
+ * @qubit_id: ID of the primary qubit involved.
+ * @seq: 1-based sequence number; 0 while the slot is being written.
+ * @gate_code: NYMYA_*_CODE of the gate, or 0 if the caller only supplied a label.
+ * @result: Return code of the gate core (0 on success).
+ * @gate: Gate label (not NUL-terminated when it fills all NYMYA_EVENT_LABEL_LEN bytes).
+ */
+typedef struct nymya_event_rec {
+    uint64_t ts_ns;
+    uint64_t qubit_id;
+    uint64_t seq;
+    uint32_t gate_code;
+    int32_t  result;
+    char     gate[NYMYA_EVENT_LABEL_LEN];
+} nymya_event_rec;
+
+/**
+ * nymya_event_ring_hdr - Header page at the start of each mmap'd per-CPU ring.
+ * @head: Total number of records ever written on this CPU (slot = head % entries).
+ * @entries: Number of record slots following the header page.
+ * @rec_size: sizeof(nymya_event_rec) as seen by the kernel.
+ * @cpu: CPU that owns this ring.
+ * @stride: Byte distance between the mmap offsets of consecutive CPU rings.
+ * @hdr_size: Byte offset of the first record from the start of the ring.
+ *
+ * Userland maps one page at offset 0 of /dev/nymya_events to learn @stride,
+ * then maps CPU n's ring at offset n * @stride.
+ */
+typedef struct nymya_event_ring_hdr {
+    uint64_t head;
+    uint32_t entries;
+    uint32_t rec_size;
+    uint32_t cpu;
+    uint32_t hdr_size;
+    uint64_t stride;
+} nymya_event_ring_hdr;
+
+// "NYMYTRC1" read as a little-endian u64: first field of a binary trace file
+#define NYMYA_BTRACE_MAGIC   0x31435254594d594eull
+#define NYMYA_BTRACE_VERSION 1
+
+/**
+ * nymya_btrace_hdr - Header at the start of a userland binary trace file.
+ * @magic: NYMYA_BTRACE_MAGIC; written last, once the header is complete.
+ * @version: NYMYA_BTRACE_VERSION.
+ * @rec_size: sizeof(nymya_btrace_rec) as seen by the writer.
+ * @pid: Process that wrote the file.
+ * @tid: Thread that wrote the file.
+ * @hdr_size: Byte offset of the first record (one page).
+ * @count: Records written so far; stored after each record is complete.
+ * @mono_ns: CLOCK_MONOTONIC when the file was opened, the base of ts_ns.
+ * @real_ns: CLOCK_REALTIME at the same moment.
+ */
+typedef struct nymya_btrace_hdr {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t rec_size;
+    uint32_t pid;
+    uint32_t tid;
+    uint32_t hdr_size;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t mono_ns;
+    uint64_t real_ns;
+    uint64_t pad;
+} nymya_btrace_hdr;
+
+/**
+ * nymya_btrace_rec - One gate call or event in a binary trace file.
+ * @ts_ns: CLOCK_MONOTONIC at the start of the call, in nanoseconds.
+ * @dur_ns: Duration of the call; 0 for an instant event.
+ * @qubit: IDs of the first two qubits involved, 0 where there are none.
+ * @param: Angle in Q32.32 of a gate that takes one, the site or record
+ *         count of an array, lattice or batch call, or 0.
+ * @gate_code: NYMYA_*_CODE of the call, or 0 for a labelled event.
+ * @result: Return code of the call, 0 or -errno.
+ * @label: Gate name or event label (not NUL-terminated when it fills all
+ *         NYMYA_EVENT_LABEL_LEN bytes).
+ */
+typedef struct nymya_btrace_rec {
+    uint64_t ts_ns;
+    uint64_t dur_ns;
+    uint64_t qubit[2];
+    int64_t  param;
+    uint32_t gate_code;
+    int32_t  result;
+    char     label[NYMYA_EVENT_LABEL_LEN];
+} nymya_btrace_rec;
+
+/*
+ * Gate argument shapes, as the numbered syscalls take them:
+ * Q, Q2, Q3         - one to three qubit pointers
+ * Q_THETA, Q2_THETA - qubit pointers and an angle (double / Q32.32)
+ * Q_AXIS_THETA      - qubit pointer, axis character and angle
+ * QARR              - fixed-size array of qubit pointers
+ * QLIST             - array of qubit pointers plus its length
+ * QPOS3, QPOS4, QPOS5 - array of positioned qubits plus its length
+ * ORACLE            - two qubits and an oracle callback (no syscall)
+ * QRNG              - output buffer, range and count (no kernel core)
+ */
+enum nymya_gate_shape {
+    NYMYA_SHAPE_Q,
+    NYMYA_SHAPE_Q_THETA,
+    NYMYA_SHAPE_Q_AXIS_THETA,
+    NYMYA_SHAPE_Q2,
+    NYMYA_SHAPE_Q2_THETA,
+    NYMYA_SHAPE_Q3,
+    NYMYA_SHAPE_QARR,
+    NYMYA_SHAPE_QLIST,
+    NYMYA_SHAPE_QPOS3,
+    NYMYA_SHAPE_QPOS4,
+    NYMYA_SHAPE_QPOS5,
+    NYMYA_SHAPE_ORACLE,
+    NYMYA_SHAPE_QRNG,
+};
+
+// Syscall arguments of each shape; 0 = no syscall
+#define NYMYA_SHAPE_NARGS_Q            1
+#define NYMYA_SHAPE_NARGS_Q_THETA      2
+#define NYMYA_SHAPE_NARGS_Q_AXIS_THETA 3
+#define NYMYA_SHAPE_NARGS_Q2           2
+#define NYMYA_SHAPE_NARGS_Q2_THETA     3
+#define NYMYA_SHAPE_NARGS_Q3           3
+#define NYMYA_SHAPE_NARGS_QARR         1
+#define NYMYA_SHAPE_NARGS_QLIST        2
+#define NYMYA_SHAPE_NARGS_QPOS3        2
+#define NYMYA_SHAPE_NARGS_QPOS4        2
+#define NYMYA_SHAPE_NARGS_QPOS5        2
+#define NYMYA_SHAPE_NARGS_ORACLE       0
+#define NYMYA_SHAPE_NARGS_QRNG         4
+
+// Qubit operands of a nymya_op record of each shape; 0 = no record form
+#define NYMYA_SHAPE_OPERANDS_Q            1
+#define NYMYA_SHAPE_OPERANDS_Q_THETA      1
+#define NYMYA_SHAPE_OPERANDS_Q_AXIS_THETA 1
+#define NYMYA_SHAPE_OPERANDS_Q2           2
+#define NYMYA_SHAPE_OPERANDS_Q2_THETA     2
+#define NYMYA_SHAPE_OPERANDS_Q3           3
+#define NYMYA_SHAPE_OPERANDS_QARR         0
+#define NYMYA_SHAPE_OPERANDS_QLIST        0
+#define NYMYA_SHAPE_OPERANDS_QPOS3        0
+#define NYMYA_SHAPE_OPERANDS_QPOS4        0
+#define NYMYA_SHAPE_OPERANDS_QPOS5        0
+#define NYMYA_SHAPE_OPERANDS_ORACLE       0
+#define NYMYA_SHAPE_OPERANDS_QRNG         0
+
+/*
+ * NYMYA_GATES - The gate table every dispatcher is generated from.
+ *
+ * X(code, name, shape, min_qubits, kernel_core) is expanded once per gate:
+ * nymya_<code>_<name> is the library function and <code> the syscall
+ * number, <shape> selects NYMYA_SHAPE_*, <min_qubits> is the fewest qubits
+ * the gate takes and <kernel_core> the kernel function the syscall, the
+ * batch path and the in-kernel benchmark run.
+ */
+#define NYMYA_GATES(X) \
+    X(3301, identity_gate,          Q,            1,  nymya_3301_identity_core) \
+    X(3302, global_phase,           Q_THETA,      1,  nymya_3302_global_phase) \
+    X(3303, pauli_x,                Q,            1,  nymya_3303_pauli_x) \
+    X(3304, pauli_y,                Q,            1,  nymya_3304_pauli_y) \
+    X(3305, pauli_z,                Q,            1,  nymya_3305_pauli_z_core) \
+    X(3306, phase_gate,             Q,            1,  nymya_3306_phase_gate) \
+    X(3307, sqrt_x_gate,            Q,            1,  nymya_3307_sqrt_x_gate) \
+    X(3308, hadamard_gate,          Q,            1,  nymya_3308_hadamard_gate) \
+    X(3309, controlled_not,         Q2,           2,  nymya_3309_controlled_not) \
+    X(3310, anticontrol_not,        Q2,           2,  nymya_3310_anticontrol_not) \
+    X(3311, controlled_z,           Q2,           2,  nymya_3311_controlled_z) \
+    X(3312, double_controlled_not,  Q3,           3,  nymya_3312_double_controlled_not_core) \
+    X(3313, swap,                   Q2,           2,  nymya_3313_swap) \
+    X(3314, imaginary_swap,         Q2,           2,  nymya_3314_imaginary_swap) \
+    X(3315, phase_shift,            Q_THETA,      1,  nymya_3315_phase_shift) \
+    X(3316, phase_gate,             Q_THETA,      1,  nymya_3316_phase_gate) \
+    X(3317, controlled_phase,       Q2_THETA,     2,  nymya_3317_controlled_phase) \
+    X(3318, controlled_phase_s,     Q2,           2,  nymya_3318_controlled_phase_s_core) \
+    X(3319, rotate_x,               Q_THETA,      1,  nymya_3319_rotate_x) \
+    X(3320, rotate_y,               Q_THETA,      1,  nymya_3320_rotate_y) \
+    X(3321, rotate_z,               Q_THETA,      1,  nymya_3321_rotate_z) \
+    X(3322, xx_interaction,         Q2_THETA,     2,  nymya_3322_xx_interaction) \
+    X(3323, yy_interaction,         Q2_THETA,     2,  nymya_3323_yy_interaction) \
+    X(3324, zz_interaction,         Q2_THETA,     2,  nymya_3324_zz_interaction) \
+    X(3325, xyz_entangle,           Q2_THETA,     2,  nymya_3325_xyz_entangle) \
+    X(3326, sqrt_swap,              Q2,           2,  nymya_3326_sqrt_swap) \
+    X(3327, sqrt_iswap,             Q2,           2,  nymya_3327_sqrt_iswap) \
+    X(3328, swap_pow,               Q2_THETA,     2,  nymya_3328_swap_pow) \
+    X(3329, fredkin,                Q3,           3,  nymya_3329_fredkin) \
+    X(3330, rotate,                 Q_AXIS_THETA, 1,  nymya_3330_rotate) \
+    X(3331, barenco,                Q3,           3,  nymya_3331_barenco) \
+    X(3332, berkeley,               Q2_THETA,     2,  nymya_3332_berkeley) \
+    X(3333, c_v,                    Q2,           2,  nymya_3333_c_v) \
+    X(3334, core_entangle,          Q2,           2,  nymya_3334_core_entangle) \
+    X(3335, dagwood,                Q3,           3,  nymya_3335_dagwood) \
+    X(3336, echo_cr,                Q2_THETA,     2,  nymya_3336_echo_cr) \
+    X(3337, fermion_sim,            Q2,           2,  nymya_3337_fermion_sim) \
+    X(3338, givens,                 Q2_THETA,     2,  nymya_3338_givens) \
+    X(3339, magic,                  Q2,           2,  nymya_3339_magic) \
+    X(3340, sycamore,               Q2,           2,  nymya_3340_sycamore) \
+    X(3341, cz_swap,                Q2,           2,  nymya_3341_cz_swap) \
+    X(3342, deutsch,                ORACLE,       2,  nymya_3342_deutsch) \
+    X(3343, margolis,               Q3,           3,  nymya_3343_margolis) \
+    X(3344, peres,                  Q3,           3,  nymya_3344_peres_kernel_logic) \
+    X(3345, cf_swap,                Q3,           3,  nymya_3345_cf_swap) \
+    X(3346, triangular_lattice,     Q3,           3,  nymya_3346_triangular_lattice) \
+    X(3347, hexagonal_lattice,      QARR,         6,  nymya_3347_hexagonal_lattice) \
+    X(3348, hex_rhombi_lattice,     QARR,         7,  nymya_3348_hex_rhombi_lattice) \
+    X(3349, tessellated_triangles,  QLIST,        3,  nymya_3349_tessellated_triangles) \
+    X(3350, tessellated_hexagons,   QLIST,        6,  nymya_3350_tessellated_hexagons) \
+    X(3351, tessellated_hex_rhombi, QLIST,        7,  nymya_3351_tessellated_hex_rhombi_core) \
+    X(3352, e8_group,               QARR,         8,  nymya_3352_e8_group) \
+    X(3353, flower_of_life,         QLIST,        19, nymya_3353_flower_of_life) \
+    X(3354, metatron_cube,          QLIST,        13, nymya_3354_metatron_cube_core) \
+    X(3355, fcc_lattice,            QPOS3,        14, nymya_3355_fcc_lattice_core) \
+    X(3356, hcp_lattice,            QPOS3,        17, nymya_3356_hcp_lattice_core) \
+    X(3357, e8_projected_lattice,   QPOS3,        30, nymya_3357_e8_projected_lattice_core) \
+    X(3358, d4_lattice,             QPOS4,        24, nymya_3358_d4_lattice_core) \
+    X(3359, b5_lattice,             QPOS5,        32, nymya_3359_b5_lattice_core) \
+    X(3360, e5_projected_lattice,   QPOS5,        40, nymya_3360_e5_projected_lattice_core) \
+    X(3361, qrng_range,             QRNG,         1,  nymya_3361_qrng_range)
+
+// Gate codes NYMYA_GATES spans; tables indexed by code - NYMYA_GATE_FIRST
+#define NYMYA_GATE_FIRST 3301
+#define NYMYA_GATE_LAST  3361
+#define NYMYA_GATE_COUNT (NYMYA_GATE_LAST - NYMYA_GATE_FIRST + 1)
+
+/**
+ * nymya_gate_desc - One NYMYA_GATES entry as data.
+ * @name: Function suffix, e.g. "controlled_not".
+ * @code: Gate code and syscall number.
+ * @shape: enum nymya_gate_shape.
+ * @nargs: Syscall arguments; 0 if the gate has no syscall.
+ * @operands: Qubit operands of a nymya_op record; 0 if it has no record form.
+ * @min_qubits: Fewest qubits the gate takes.
+ */
+typedef struct nymya_gate_desc {
+    const char *name;
+    uint32_t code;
+    uint8_t shape;
+    uint8_t nargs;
+    uint8_t operands;
+    uint8_t min_qubits;
+} nymya_gate_desc;
+
+// Descriptor of a gate code in O(1), or NULL (nymya_gate_table.c)
+const nymya_gate_desc *nymya_gate_lookup(uint32_t code);
+
+// Maximum number of qubit operands referenced by one nymya_op
+#define NYMYA_OP_MAX_OPERANDS 3
+
+// Upper bounds on a single nymya_3362_submit() batch
+#define NYMYA_SUBMIT_MAX_OPS    (1u << 20)
+#define NYMYA_SUBMIT_MAX_QUBITS (1u << 16)
+
+// Records the kernel applies between reschedule points and signal checks
+#define NYMYA_SUBMIT_YIELD 1024
+
+/**
+ * nymya_op - One gate record in a nymya_3362_submit() batch.
+ * @gate_code: NYMYA_*_CODE of the gate to apply.
+ * @axis: Rotation axis ('X', 'Y' or 'Z', case-insensitive) for NYMYA_ROTATE_CODE; 0 otherwise.
+ * @qubit: Operand indices into the batch's qubit array, in the same order as
+ *         the gate function's qubit arguments. Slots past the gate's arity are ignored.
+ * @reserved: Must be zero.
+ * @param: Angle or exponent in Q32.32 fixed-point for parameterised gates; ignored otherwise.
+ */
+typedef struct nymya_op {
+    uint32_t gate_code;
+    uint32_t axis;
+    uint32_t qubit[NYMYA_OP_MAX_OPERANDS];
+    uint32_t reserved;
+    int64_t  param;
+} nymya_op;
+
+// Most gate records in a compiled oracle
+#define NYMYA_ORACLE_MAX_OPS 16
+
+/**
+ * nymya_oracle - An oracle compiled into a gate program.
+ * @count: Number of records in @ops.
+ * @reserved: Must be zero.
+ * @ops: nymya_op records on operand 0 (the input qubit) and 1 (the target).
+ *
+ * Built by nymya_oracle_from_table() or nymya_oracle_compile() and run by
+ * nymya_3342_deutsch_oracle(). Unlike an oracle callback it is plain data,
+ * so it can cross into the kernel and go through the batch path.
+ */
+typedef struct nymya_oracle {
+    uint32_t count;
+    uint32_t reserved;
+    nymya_op ops[NYMYA_ORACLE_MAX_OPS];
+} nymya_oracle;
+
+// Largest submission or completion ring accepted by /dev/nymya_ring
+#define NYMYA_RING_MAX_ENTRIES 32768
+
+/**
+ * nymya_sqe - Submission queue entry: one nymya_3362_submit() batch.
+ * @user_data: Opaque value copied to the matching completion.
+ * @ops: User address of the batch's nymya_op records.
+ * @qubits: User address of the batch's nymya_qubit_k array; updated in place.
+ * @op_count: Number of records at @ops.
+ * @qubit_count: Number of qubits at @qubits.
+ *
+ * Both arrays must stay valid until the completion for @user_data is reaped.
+ */
+typedef struct nymya_sqe {
+    uint64_t user_data;
+    uint64_t ops;
+    uint64_t qubits;
+    uint32_t op_count;
+    uint32_t qubit_count;
+} nymya_sqe;
+
+/**
+ * nymya_cqe - Completion queue entry.
+ * @user_data: Value from the consumed nymya_sqe.
+ * @result: Return code of the batch (0 or a negative errno).
+ * @flags: Reserved, currently zero.
+ */
+typedef struct nymya_cqe {
+    uint64_t user_data;
+    int32_t  result;
+    uint32_t flags;
+} nymya_cqe;
+
+/**
+ * nymya_ring_hdr - Shared index block at offset 0 of a /dev/nymya_ring mapping.
+ * @sq_head: Next submission slot the kernel will consume (kernel-written).
+ * @sq_tail: Next submission slot userland will fill (user-written).
+ * @cq_head: Next completion userland will reap (user-written).
+ * @cq_tail: Next completion slot the kernel will fill (kernel-written).
+ * @sq_entries: Number of submission slots (power of two).
+ * @cq_entries: Number of completion slots (power of two).
+ * @sq_off: Byte offset of the nymya_sqe array from the start of the mapping.
+ * @cq_off: Byte offset of the nymya_cqe array from the start of the mapping.
+ *
+ * Indices are free-running; the slot is index & (entries - 1). Each side
+ * publishes its own index with a release store and reads the other's with
+ * an acquire load.
+ */
+typedef struct nymya_ring_hdr {
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sq_off;
+    uint32_t cq_off;
+} nymya_ring_hdr;
+
+/**
+ * nymya_ring_params - Argument of NYMYA_RING_SETUP.
+ * @sq_entries: Requested submission slots; rounded up to a power of two.
+ * @cq_entries: Requested completion slots (0 for twice @sq_entries); at least @sq_entries.
+ * @sq_off: Returned offset of the submission array.
+ * @cq_off: Returned offset of the completion array.
+ * @ring_bytes: Returned size to pass to mmap().
+ */
+typedef struct nymya_ring_params {
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sq_off;
+    uint32_t cq_off;
+    uint64_t ring_bytes;
+} nymya_ring_params;
+
+#define NYMYA_IOC_MAGIC 'N'
+
+// Allocates the rings of a /dev/nymya_ring file; once per open
+#define NYMYA_RING_SETUP _IOWR(NYMYA_IOC_MAGIC, 0x01, nymya_ring_params)
+
+// Consumes up to arg queued submissions; returns the number consumed
+#define NYMYA_RING_ENTER _IO(NYMYA_IOC_MAGIC, 0x02)
+
+/**
+ * nymya_reg_params - Argument of NYMYA_REG_ALLOC.
+ * @count: Number of qubits in the register (at most NYMYA_SUBMIT_MAX_QUBITS).
+ * @reg_bytes: Returned size of the register mapping to pass to mmap().
+ */
+typedef struct nymya_reg_params {
+    uint64_t count;
+    uint64_t reg_bytes;
+} nymya_reg_params;
+
+/**
+ * nymya_reg_batch - Argument of NYMYA_REG_SUBMIT.
+ * @ops: User address of the nymya_op records; operand indices refer to the register.
+ * @op_count: Number of records at @ops.
+ */
+typedef struct nymya_reg_batch {
+    uint64_t ops;
+    uint64_t op_count;
+} nymya_reg_batch;
+
+// Allocates the shared qubit register of a /dev/nymya file; once per open
+#define NYMYA_REG_ALLOC  _IOWR(NYMYA_IOC_MAGIC, 0x10, nymya_reg_params)
+
+// Applies one gate record to the register in place
+#define NYMYA_REG_GATE   _IOW(NYMYA_IOC_MAGIC, 0x11, nymya_op)
+
+// Applies a batch of gate records to the register in place
+#define NYMYA_REG_SUBMIT _IOW(NYMYA_IOC_MAGIC, 0x12, nymya_reg_batch)
+
+// Most arguments one gate call takes; the syscall ABI limit
+#define NYMYA_CALL_MAX_ARGS 6
+
+// nymya_call_batch flag: run the remaining calls after one fails
+#define NYMYA_CALL_CONTINUE 0x1u
+
+/**
+ * nymya_call - One gate call by code, as NYMYA_CALL runs it or NYMYA_CALLV lists it.
+ * @code: Gate code, NYMYA_*_CODE (3301-3365).
+ * @nargs: Number of arguments in @args; must match the gate's syscall.
+ * @ret: Returned result, as the syscall would return it (0 or -errno).
+ * @args: The syscall's arguments in order; pointers as user addresses.
+ *
+ * The arguments are exactly those of the numbered syscall, so a call through
+ * /dev/nymya behaves like the syscall even on a kernel without the syscall
+ * table entries.
+ */
+typedef struct nymya_call {
+    uint32_t code;
+    uint32_t nargs;
+    int64_t ret;
+    uint64_t args[NYMYA_CALL_MAX_ARGS];
+} nymya_call;
+
+/**
+ * nymya_call_batch - Argument of NYMYA_CALLV.
+ * @calls: User address of the nymya_call records, run in order.
+ * @count: Number of records at @calls (at most NYMYA_SUBMIT_MAX_OPS).
+ * @flags: 0 to stop at the first failing call, or NYMYA_CALL_CONTINUE.
+ */
+typedef struct nymya_call_batch {
+    uint64_t calls;
+    uint32_t count;
+    uint32_t flags;
+} nymya_call_batch;
+
+// Runs one gate call; the ioctl returns its result and stores it in ret
+#define NYMYA_CALL       _IOWR(NYMYA_IOC_MAGIC, 0x13, nymya_call)
+
+// Runs a batch of gate calls; returns how many ran, each with ret filled in
+#define NYMYA_CALLV      _IOW(NYMYA_IOC_MAGIC, 0x14, nymya_call_batch)
+
+// Most kernel-resident registers one /dev/nymya file holds at a time
+#define NYMYA_KREG_MAX_HANDLES 1024
+
+/**
+ * nymya_kreg_params - Argument of NYMYA_KREG_ALLOC.
+ * @count: Number of qubits (at most NYMYA_SUBMIT_MAX_QUBITS).
+ * @handle: Returned handle of the register, nonzero.
+ * @reserved: Must be zero.
+ */
+typedef struct nymya_kreg_params {
+    uint64_t count;
+    uint32_t handle;
+    uint32_t reserved;
+} nymya_kreg_params;
+
+/**
+ * nymya_kreg_io - Argument of NYMYA_KREG_WRITE and NYMYA_KREG_READ.
+ * @handle: Register from NYMYA_KREG_ALLOC.
+ * @reserved: Must be zero.
+ * @first: Index of the first register qubit to transfer.
+ * @count: Number of qubits to transfer.
+ * @qubits: User address of @count nymya_qubit_k records.
+ */
+typedef struct nymya_kreg_io {
+    uint32_t handle;
+    uint32_t reserved;
+    uint64_t first;
+    uint64_t count;
+    uint64_t qubits;
+} nymya_kreg_io;
+
+/**
+ * nymya_kreg_batch - Argument of NYMYA_KREG_SUBMIT.
+ * @handle: Register from NYMYA_KREG_ALLOC; operand indices refer to it.
+ * @reserved: Must be zero.
+ * @ops: User address of the nymya_op records.
+ * @op_count: Number of records at @ops.
+ */
+typedef struct nymya_kreg_batch {
+    uint32_t handle;
+    uint32_t reserved;
+    uint64_t ops;
+    uint64_t op_count;
+} nymya_kreg_batch;
+
+// Allocates a zeroed register inside the module and returns its handle
+#define NYMYA_KREG_ALLOC  _IOWR(NYMYA_IOC_MAGIC, 0x30, nymya_kreg_params)
+
+// Frees the register whose handle is arg
+#define NYMYA_KREG_FREE   _IO(NYMYA_IOC_MAGIC, 0x31)
+
+// Copies qubits from userland into a register
+#define NYMYA_KREG_WRITE  _IOW(NYMYA_IOC_MAGIC, 0x32, nymya_kreg_io)
+
+// Copies qubits from a register out to userland
+#define NYMYA_KREG_READ   _IOW(NYMYA_IOC_MAGIC, 0x33, nymya_kreg_io)
+
+// Applies a batch of gate records to a register in place
+#define NYMYA_KREG_SUBMIT _IOW(NYMYA_IOC_MAGIC, 0x34, nymya_kreg_batch)
+
+// Most lattice topologies one /dev/nymya file holds at a time
+#define NYMYA_TOPO_MAX_HANDLES 256
+
+/**
+ * nymya_topo_params - Argument of NYMYA_TOPO_BUILD.
+ * @lattice_code: NYMYA_*_CODE of the positional lattice gate, 3355 to 3360.
+ * @handle: Returned handle of the topology, nonzero.
+ * @count: Number of sites.
+ * @axes: User address of NYMYA_LATTICE_DIMS(@lattice_code) addresses, each
+ *        of a Q32.32 int64_t array of @count coordinates (as for 3363), and
+ *        with NYMYA_LATTICE_PERIODIC set in @lattice_code one more, of the
+ *        box edges. Inserted sites then wrap around the same box.
+ */
+typedef struct nymya_topo_params {
+    uint32_t lattice_code;
+    uint32_t handle;
+    uint64_t count;
+    uint64_t axes;
+} nymya_topo_params;
+
+/**
+ * nymya_topo_run - Argument of NYMYA_TOPO_RUN.
+ * @handle: Topology from NYMYA_TOPO_BUILD.
+ * @kreg: Register from NYMYA_KREG_ALLOC to run on, or 0 to use @qubits.
+ * @qubits: User address of @count nymya_qubit_k records, one per site.
+ * @count: Number of sites; must match the topology (and the register).
+ */
+typedef struct nymya_topo_run {
+    uint32_t handle;
+    uint32_t kreg;
+    uint64_t qubits;
+    uint64_t count;
+} nymya_topo_run;
+
+// Finds the neighbour pairs of a lattice once and returns a topology handle
+#define NYMYA_TOPO_BUILD  _IOWR(NYMYA_IOC_MAGIC, 0x35, nymya_topo_params)
+
+// Frees the topology whose handle is arg
+#define NYMYA_TOPO_FREE   _IO(NYMYA_IOC_MAGIC, 0x36)
+
+// Runs the lattice gate's Hadamard + CNOT sweep over a stored topology
+#define NYMYA_TOPO_RUN    _IOW(NYMYA_IOC_MAGIC, 0x37, nymya_topo_run)
+
+// Most sites one NYMYA_TOPO_INSERT or NYMYA_TOPO_DELETE takes
+#define NYMYA_TOPO_MAX_EDIT 65536
+
+/**
+ * nymya_topo_edit - Argument of NYMYA_TOPO_INSERT and NYMYA_TOPO_DELETE.
+ * @handle: Topology from NYMYA_TOPO_BUILD.
+ * @dims: Coordinates per site of the lattice for INSERT; 0 for DELETE.
+ * @count: Number of sites to add or remove (1 to NYMYA_TOPO_MAX_EDIT).
+ * @sites: User address of the new sites' Q32.32 coordinates, @dims int64_t
+ *         per site one site after another, for INSERT; of @count uint32_t
+ *         site indices for DELETE.
+ * @first: Returned by INSERT: index of the first new site (the old count).
+ *
+ * Inserted sites take the next indices in order. Deletions run in order,
+ * and each moves the current last site into the freed index, so the
+ * caller's qubit array must do the same for later runs to line up.
+ */
+typedef struct nymya_topo_edit {
+    uint32_t handle;
+    uint32_t dims;
+    uint64_t count;
+    uint64_t sites;
+    uint64_t first;
+} nymya_topo_edit;
+
+// Adds sites to a topology, pairing each with the sites within the cutoff
+#define NYMYA_TOPO_INSERT _IOWR(NYMYA_IOC_MAGIC, 0x38, nymya_topo_edit)
+
+// Removes sites from a topology; each deletion moves the last site into its place
+#define NYMYA_TOPO_DELETE _IOW(NYMYA_IOC_MAGIC, 0x39, nymya_topo_edit)
+
+// Largest value ring accepted by /dev/nymya_qrng
+#define NYMYA_QRNG_MAX_ENTRIES (1u << 20)
+// Values the QRNG generates and copies out per pass; 4 KiB of output
+#define NYMYA_QRNG_CHUNK 512
+
+/**
+ * nymya_qrng_range - Argument of NYMYA_QRNG_SET_RANGE.
+ * @min: Smallest value returned (inclusive).
+ * @max: Largest value returned (inclusive), at least @min.
+ *
+ * A new /dev/nymya_qrng file returns raw words, i.e. [0, UINT64_MAX].
+ */
+typedef struct nymya_qrng_range {
+    uint64_t min;
+    uint64_t max;
+} nymya_qrng_range;
+
+/**
+ * nymya_qrng_hdr - Shared index block at offset 0 of a /dev/nymya_qrng mapping.
+ * @head: Next value userland will take (user-written).
+ * @tail: One past the last value the producer has filled (kernel-written).
+ * @entries: Number of value slots (power of two).
+ * @off: Byte offset of the uint64_t value array from the start of the mapping.
+ *
+ * Indices are free-running; the slot is index & (entries - 1). Each side
+ * publishes its own index with a release store and reads the other's with
+ * an acquire load.
+ */
+typedef struct nymya_qrng_hdr {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t entries;
+    uint32_t off;
+} nymya_qrng_hdr;
+
+/**
+ * nymya_qrng_params - Argument of NYMYA_QRNG_SETUP.
+ * @entries: Requested value slots; rounded up to a power of two.
+ * @off: Returned offset of the value array.
+ * @ring_bytes: Returned size to pass to mmap().
+ */
+typedef struct nymya_qrng_params {
+    uint32_t entries;
+    uint32_t off;
+    uint64_t ring_bytes;
+} nymya_qrng_params;
+
+// Sets the range of a /dev/nymya_qrng file; only before NYMYA_QRNG_SETUP
+#define NYMYA_QRNG_SET_RANGE _IOW(NYMYA_IOC_MAGIC, 0x20, nymya_qrng_range)
+
+// Allocates the value ring of a /dev/nymya_qrng file and fills it; once per open
+#define NYMYA_QRNG_SETUP     _IOWR(NYMYA_IOC_MAGIC, 0x21, nymya_qrng_params)
+
+// Queues the ring producer on the calling CPU; a nonzero arg waits for it
+#define NYMYA_QRNG_REFILL    _IO(NYMYA_IOC_MAGIC, 0x22)
+
+#ifndef __KERNEL__
+/**
+ * nymya_ring - Userland handle on a mapped /dev/nymya_ring instance.
+ * @fd: Open file descriptor of /dev/nymya_ring.
+ * @mem: Start of the shared mapping.
+ * @mem_bytes: Size of the mapping.
+ * @hdr: Shared index block.
+ * @sqes: Submission array.
+ * @cqes: Completion array.
+ * @sq_mask: sq_entries - 1.
+ * @cq_mask: cq_entries - 1.
+ *
+ * nymya_ring_queue() and nymya_ring_reap() are for a single thread each;
+ * nymya_ring_enter() may be called from any thread.
+ */
+typedef struct nymya_ring {
+    int fd;
+    void *mem;
+    size_t mem_bytes;
+    nymya_ring_hdr *hdr;
+    nymya_sqe *sqes;
+    nymya_cqe *cqes;
+    uint32_t sq_mask;
+    uint32_t cq_mask;
+} nymya_ring;
+
+int nymya_ring_open(nymya_ring *ring, uint32_t sq_entries, uint32_t cq_entries);
+void nymya_ring_close(nymya_ring *ring);
+int nymya_ring_queue(nymya_ring *ring, const nymya_op *ops, uint32_t op_count,
+                     nymya_qubit_k *qubits, uint32_t qubit_count, uint64_t user_data);
+int nymya_ring_enter(nymya_ring *ring, uint32_t to_submit);
+int nymya_ring_reap(nymya_ring *ring, nymya_cqe *cqe);
+
+/**
+ * nymya_reg - Userland handle on a mapped /dev/nymya qubit register.
+ * @fd: Open file descriptor of /dev/nymya.
+ * @qubits: Shared register; amplitudes are Q32.32 and are updated in place.
+ * @count: Number of qubits in @qubits.
+ * @bytes: Size of the mapping.
+ */
+typedef struct nymya_reg {
+    int fd;
+    nymya_qubit_k *qubits;
+    size_t count;
+    size_t bytes;
+} nymya_reg;
+
+int nymya_reg_open(nymya_reg *reg, size_t count);
+void nymya_reg_close(nymya_reg *reg);
+int nymya_reg_gate(nymya_reg *reg, const nymya_op *op);
+int nymya_reg_submit(nymya_reg *reg, const nymya_op *ops, size_t op_count);
+
+// Gate calls by code through the syscall, or /dev/nymya without one (nymya_call.c)
+long nymya_call_gate(uint32_t code, const uint64_t *args, uint32_t nargs);
+long nymya_callv(nymya_call *calls, size_t count, uint32_t flags);
+int nymya_dev_fd(void);
+
+// Where nymya_call_gate() runs the gates; NYMYA_BACKEND=auto, kernel, local or a plugin name
+#define NYMYA_BACKEND_AUTO   0 // The kernel while it has the gates, this process otherwise
+#define NYMYA_BACKEND_KERNEL 1 // The syscall or /dev/nymya, failing without them
+#define NYMYA_BACKEND_LOCAL  2 // This process, with nymya_local_call()
+#define NYMYA_BACKEND_PLUGIN 3 // A plugin library, loaded by the first gate call (nymya_backend.c)
+
+int nymya_backend_set(int backend);
+int nymya_backend_get(void);
+
+// Version of nymya_backend_ops this library loads
+#define NYMYA_PLUGIN_ABI 1
+
+/**
+ * nymya_backend_ops - Table a backend plugin exports as nymya_plugin_ops.
+ * @abi: NYMYA_PLUGIN_ABI.
+ * @name: Name of the backend, for messages.
+ * @init: Sets the backend up; run once, by the first gate call. 0 or
+ *        -errno; NULL if there is nothing to set up.
+ * @call: Runs one gate call as nymya_local_call() does, returning its
+ *        result or -errno.
+ */
+typedef struct nymya_backend_ops {
+    uint32_t abi;
+    const char *name;
+    int (*init)(void);
+    long (*call)(uint32_t code, const uint64_t *args, uint32_t nargs);
+} nymya_backend_ops;
+
+int nymya_backend_plugin(const char *name);
+int nymya_plugin_name(const char *name);
+long nymya_plugin_call(uint32_t code, const uint64_t *args, uint32_t nargs);
+
+// Every gate call run in-process behind the syscall ABI (nymya_local.c)
+long nymya_local_call(uint32_t code, const uint64_t *args, uint32_t nargs);
+
+// Per-thread binary traces of gate calls; NYMYA_BTRACE=<dir> (nymya_btrace.c)
+int nymya_btrace_start(const char *dir);
+void nymya_btrace_stop(void);
+int nymya_btrace_enabled(void);
+uint64_t nymya_btrace_now(void);
+void nymya_btrace_event(uint32_t gate_code, uint64_t q0, uint64_t q1, int64_t param,
+                        int32_t result, uint64_t t0, const char *label);
+void nymya_btrace_call(uint32_t code, const uint64_t *args, uint32_t nargs, long result, uint64_t t0);
+
+// Registers held inside the module, addressed by handle (nymya_dev.c)
+int nymya_kreg_alloc(size_t count);
+int nymya_kreg_free(int handle);
+int nymya_kreg_write(int handle, size_t first, const nymya_qubit_k *qubits, size_t count);
+int nymya_kreg_read(int handle, size_t first, nymya_qubit_k *qubits, size_t count);
+int nymya_kreg_gate(int handle, const nymya_op *op);
+int nymya_kreg_submit(int handle, const nymya_op *ops, size_t op_count);
+
+// Lattice neighbour pairs kept inside the module for repeat runs (nymya_dev.c)
+int nymya_topo_build(unsigned int lattice_code, const double *const coords[], size_t count);
+int nymya_topo_build_box(unsigned int lattice_code, const double *const coords[],
+                         const double *box, size_t count);
+int nymya_topo_free(int handle);
+int nymya_topo_apply(int handle, nymya_qubit qubits[], size_t count);
+int nymya_topo_apply_kreg(int handle, int kreg);
+long nymya_topo_insert(int handle, unsigned int dims, const double *pos, size_t count);
+int nymya_topo_delete(int handle, const uint32_t *sites, size_t count);
+
+// Most neighbours a generated lattice site has (D5, the E5 projection)
+#define NYMYA_LATTICE_GEN_MAX_NBR 40
+
+/**
+ * nymya_lattice_gen - Generator of a positional gate's perfect lattice.
+ * @lattice_code: NYMYA_*_CODE of the gate, 3355 to 3360.
+ * @dims: Coordinates per site.
+ * @kind: Layout of the sites (private to nymya_lattice_gen.c).
+ * @count: Number of sites.
+ * @side: Cells along each axis of the box the sites fill.
+ * @row: Sites in one row along the first axis.
+ * @nclass: Offset tables in use; HCP sites have four kinds of surroundings.
+ * @noff: Entries of each table.
+ * @off: Integer offsets of the neighbours within the gate's cutoff.
+ */
+typedef struct nymya_lattice_gen {
+    uint32_t lattice_code;
+    unsigned int dims;
+    unsigned int kind;
+    size_t count;
+    size_t side;
+    size_t row;
+    unsigned int nclass;
+    unsigned int noff[4];
+    int8_t off[4][NYMYA_LATTICE_GEN_MAX_NBR][NYMYA_LATTICE_MAX_DIM];
+} nymya_lattice_gen;
+
+// Perfect lattices for 3355-3360 computed site by site (nymya_lattice_gen.c)
+int nymya_lattice_gen_init(nymya_lattice_gen *g, unsigned int lattice_code, size_t count);
+int nymya_lattice_gen_coords(const nymya_lattice_gen *g, size_t first, size_t n,
+                             double *out, size_t stride);
+int nymya_lattice_gen_coords_soa(const nymya_lattice_gen *g, size_t first, size_t n,
+                                 double *const axes[]);
+size_t nymya_lattice_gen_neighbors(const nymya_lattice_gen *g, size_t site, size_t *nbr);
+int nymya_lattice_gen_topo(const nymya_lattice_gen *g);
+
+// Positional lattice gates over a memory-mapped file, one tile at a time (nymya_lattice_tiled.c)
+int nymya_lattice_tiled(unsigned int lattice_code, const char *path, size_t tile_sites);
+
+// Kinds of nymya_pipe_stage
+#define NYMYA_PIPE_SUBMIT 0 // nymya_op records on the range, as nymya_3362_submit()
+#define NYMYA_PIPE_ARRAY  1 // A 3347-3354 gate on the range, as nymya_3365_lattice_array()
+#define NYMYA_PIPE_SOA    2 // A 3355-3360 gate at coordinates, as nymya_3363_lattice_soa_box()
+#define NYMYA_PIPE_HOST   3 // A function on the range's qubits, in the calling thread
+
+/**
+ * nymya_pipe_stage - One stage of nymya_pipe_run().
+ * @kind: NYMYA_PIPE_*.
+ * @code: Lattice gate code of an ARRAY or SOA stage.
+ * @first: First qubit of the range the stage works on.
+ * @count: Qubits in the range; 0 for the rest of the array.
+ * @ops: SUBMIT records; operand indices count from @first.
+ * @op_count: Number of @ops.
+ * @coords: SOA coordinate arrays, NYMYA_LATTICE_DIMS(@code) of @count entries.
+ * @box: SOA periodic box edges as for nymya_3363_lattice_soa_box(), or NULL.
+ * @host: HOST function; a nonzero result ends the run with it.
+ * @arg: Passed to @host.
+ */
+typedef struct nymya_pipe_stage {
+    uint32_t kind;
+    uint32_t code;
+    size_t first;
+    size_t count;
+    const nymya_op *ops;
+    size_t op_count;
+    const double *const *coords;
+    const double *box;
+    int (*host)(nymya_qubit *qubits, size_t count, void *arg);
+    void *arg;
+} nymya_pipe_stage;
+
+/**
+ * nymya_pipe_stats - Where the time of a nymya_pipe_run() went.
+ * @stages: Stages started.
+ * @kernel_stages: Kernel calls made (or skipped after a failure).
+ * @total_ns: Wall time of the run.
+ * @marshal_ns: Calling thread converting qubits and coordinates, and in host stages.
+ * @wait_ns: Calling thread waiting for a kernel stage to finish.
+ * @kernel_ns: Time in the kernel calls.
+ * @idle_ns: Submitter waiting for the next stage to be marshalled.
+ */
+typedef struct nymya_pipe_stats {
+    size_t stages;
+    size_t kernel_stages;
+    uint64_t total_ns;
+    uint64_t marshal_ns;
+    uint64_t wait_ns;
+    uint64_t kernel_ns;
+    uint64_t idle_ns;
+} nymya_pipe_stats;
+
+// Multi-stage runs that marshal each kernel stage while the previous one runs (nymya_pipe.c)
+int nymya_pipe_run(const nymya_pipe_stage *stages, size_t nstages, nymya_qubit *qubits,
+                   size_t count, nymya_pipe_stats *stats);
+
+// syscall(code, ...) for the gate wrappers; arguments are widened to uint64_t
+#define NYMYA_CALL_GATE(code, ...)                                              \
+    nymya_call_gate((code), (const uint64_t[]){ __VA_ARGS__ },                  \
+                    sizeof((uint64_t[]){ __VA_ARGS__ }) / sizeof(uint64_t))
+
+/**
+ * nymya_qrng - Userland handle on a mapped /dev/nymya_qrng value ring.
+ * @fd: Open file descriptor of /dev/nymya_qrng.
+ * @mem: Start of the shared mapping.
+ * @mem_bytes: Size of the mapping.
+ * @hdr: Shared index block.
+ * @vals: Value array.
+ * @mask: entries - 1.
+ *
+ * For a single consuming thread.
+ */
+typedef struct nymya_qrng {
+    int fd;
+    void *mem;
+    size_t mem_bytes;
+    nymya_qrng_hdr *hdr;
+    const uint64_t *vals;
+    uint32_t mask;
+} nymya_qrng;
+
+int nymya_qrng_open(nymya_qrng *q, uint32_t entries, uint64_t min, uint64_t max);
+void nymya_qrng_close(nymya_qrng *q);
+int nymya_qrng_take(nymya_qrng *q, uint64_t *out, size_t count);
+
+// Lattice position marshalling for the 3355-3360 wrappers (nymya_qpos_marshal.c)
+void nymya_qpos3d_to_k(const nymya_qpos3d *src, nymya_qpos3d_k *dst, size_t count);
+void nymya_qpos3d_from_k(const nymya_qpos3d_k *src, nymya_qpos3d *dst, size_t count);
+void nymya_qpos4d_to_k(const nymya_qpos4d *src, nymya_qpos4d_k *dst, size_t count);
+void nymya_qpos4d_from_k(const nymya_qpos4d_k *src, nymya_qpos4d *dst, size_t count);
+void nymya_qpos5d_to_k(const nymya_qpos5d *src, nymya_qpos5d_k *dst, size_t count);
+void nymya_qpos5d_from_k(const nymya_qpos5d_k *src, nymya_qpos5d *dst, size_t count);
+
+/*
+ * 3355-3360 on sites already in the kernel layout. The array goes to the
+ * syscall as it is, with no conversion and no copy, and is updated in
+ * place; keeping sites in these types makes repeated calls free of
+ * marshalling. Same results and return values as the nymya_qpos*d forms.
+ */
+int nymya_3355_fcc_lattice_k(nymya_qpos3d_k qubits[], size_t count);
+int nymya_3356_hcp_lattice_k(nymya_qpos3d_k qubits[], size_t count);
+int nymya_3357_e8_projected_lattice_k(nymya_qpos3d_k qubits[], size_t count);
+int nymya_3358_d4_lattice_k(nymya_qpos4d_k qubits[], size_t count);
+int nymya_3359_b5_lattice_k(nymya_qpos5d_k qubits[], size_t count);
+int nymya_3360_e5_projected_lattice_k(nymya_qpos5d_k qubits[], size_t count);
+
+// Q32.32 <-> double, as the wrappers convert: truncation one way, exact scaling the other
+static inline int64_t nymya_fp_from_double(double x) {
+    return (int64_t)(x * FIXED_POINT_SCALE);
+}
+
+static inline double nymya_fp_to_double(int64_t fp) {
+    return (double)fp / FIXED_POINT_SCALE;
+}
+
+// Amplitude of a kernel-layout qubit as a complex double, and back
+static inline complex_double nymya_qubit_k_amplitude(const nymya_qubit_k *q) {
+    return CMPLX(nymya_fp_to_double(q->re), nymya_fp_to_double(q->im));
+}
+
+static inline void nymya_qubit_k_set_amplitude(nymya_qubit_k *q, complex_double a) {
+    q->re = nymya_fp_from_double(creal(a));
+    q->im = nymya_fp_from_double(cimag(a));
+}
+
+/*
+ * Coordinate @axis (0 = x) of a kernel-layout site as a double, and back.
+ * The coordinates of a site are consecutive int64_t after its qubit.
+ */
+static inline double nymya_qpos3d_k_coord(const nymya_qpos3d_k *p, unsigned int axis) {
+    return nymya_fp_to_double((&p->x)[axis]);
+}
+
+static inline void nymya_qpos3d_k_set_coord(nymya_qpos3d_k *p, unsigned int axis, double x) {
+    (&p->x)[axis] = nymya_fp_from_double(x);
+}
+
+static inline double nymya_qpos4d_k_coord(const nymya_qpos4d_k *p, unsigned int axis) {
+    return nymya_fp_to_double((&p->x)[axis]);
+}
+
+static inline void nymya_qpos4d_k_set_coord(nymya_qpos4d_k *p, unsigned int axis, double x) {
+    (&p->x)[axis] = nymya_fp_from_double(x);
+}
+
+static inline double nymya_qpos5d_k_coord(const nymya_qpos5d_k *p, unsigned int axis) {
+    return nymya_fp_to_double((&p->x)[axis]);
+}
+
+static inline void nymya_qpos5d_k_set_coord(nymya_qpos5d_k *p, unsigned int axis, double x) {
+    (&p->x)[axis] = nymya_fp_from_double(x);
+}
+
+// Interned qubit tags and compact qubit conversion (nymya_tag.c)
+nymya_tag_t nymya_tag_intern(const char *tag);
+const char *nymya_tag_str(nymya_tag_t tag);
+void nymya_qubit_to_compact(const nymya_qubit *src, nymya_qubit_c *dst, size_t count);
+void nymya_qubit_from_compact(const nymya_qubit_c *src, nymya_qubit *dst, size_t count);
+
+/*
+ * SIMD loops with several x86 variants are GNU indirect functions: the
+ * dynamic loader runs a resolver that checks the CPU once and binds the
+ * best variant, so calls go straight to it with no per-call test. Where
+ * the C library has no ifunc support (or with NYMYA_NO_IFUNC) the same
+ * resolver runs lazily on first use instead. Other architectures have one
+ * variant each and bind it at compile time.
+ */
+#if defined(__ELF__) && defined(__GLIBC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(NYMYA_NO_IFUNC)
+#define NYMYA_HAVE_IFUNC 1
+#define NYMYA_IFUNC(resolver) __attribute__((ifunc(#resolver)))
+#endif
+
+// Cache-line aligned buffers and qubit arrays (nymya_aligned.c). They start
+// on a line and are padded to whole lines, so threads working on adjacent
+// arrays or on line-aligned ranges of one array never share a line.
+#define NYMYA_ALLOC_HUGE 0x1u // Back the buffer with huge pages where possible
+#define NYMYA_ALLOC_NUMA 0x2u // Place the pages by node for the worker pool (nymya_parallel_place)
+
+size_t nymya_cache_line(void);
+void *nymya_aligned_alloc(size_t bytes, unsigned int flags);
+void nymya_aligned_free(void *p);
+nymya_qubit *nymya_qubits_alloc(size_t n);
+nymya_qubit *nymya_qubits_alloc_huge(size_t n);
+void nymya_qubits_free(nymya_qubit *q);
+
+// Per-thread scratch buffers reused by the marshalling syscall wrappers
+// (nymya_scratch.c); NYMYA_SCRATCH=huge backs the large ones with huge pages
+#define NYMYA_SCRATCH_CALL  0 // The kernel-layout copy a wrapper passes to its syscall
+#define NYMYA_SCRATCH_AUX   1 // A second array of the same call
+#define NYMYA_SCRATCH_SLOTS 2
+
+void *nymya_scratch_get(unsigned int slot, size_t bytes);
+void nymya_scratch_trim(size_t keep);
+void nymya_scratch_set_huge(int on);
+
+// NUMA topology and page placement for the worker pool (nymya_numa.c),
+// chosen by the NYMYA_NUMA environment variable
+#define NYMYA_NUMA_OFF        0 // Workers float; pages follow first touch
+#define NYMYA_NUMA_SPREAD     1 // Workers spread over nodes in blocks; buffers split to match
+#define NYMYA_NUMA_COMPACT    2 // Workers fill one node's CPUs before the next
+#define NYMYA_NUMA_INTERLEAVE 3 // Workers spread; buffer pages interleaved over nodes
+#define NYMYA_NUMA_MAX_NODES  64
+
+int nymya_numa_policy(void);
+unsigned int nymya_numa_nodes(void);
+unsigned int nymya_numa_cpus(unsigned int want, int *cpu, int *node);
+int nymya_numa_bind(void *p, size_t bytes, int node);
+int nymya_parallel_place(void *p, size_t bytes);
+
+/*
+ * Unchecked single-qubit gates, inline so that a circuit written in C
+ * compiles down to the amplitude arithmetic itself and loops over qubit
+ * arrays can vectorise. No NULL check, no syscall and no log event; the
+ * results are bit for bit those of the checked nymya_33xx functions, which
+ * are built on these.
+ */
+static inline void nymya_id_fast(nymya_qubit *q) {
+    (void)q;
+}
+
+// 3302: amplitude times e^(i theta)
+static inline void nymya_gphase_fast(nymya_qubit *q, double theta) {
+    q->amplitude = complex_mul(q->amplitude, complex_exp_i(theta));
+}
+
+// 3303: conjugates the amplitude
+static inline void nymya_x_fast(nymya_qubit *q) {
+    q->amplitude = CMPLX(creal(q->amplitude), -cimag(q->amplitude));
+}
+
+// 3304: amplitude times i
+static inline void nymya_y_fast(nymya_qubit *q) {
+    q->amplitude = CMPLX(-cimag(q->amplitude), creal(q->amplitude));
+}
+
+// 3305: negates the amplitude
+static inline void nymya_z_fast(nymya_qubit *q) {
+    q->amplitude = CMPLX(-creal(q->amplitude), -cimag(q->amplitude));
+}
+
+// 3306: amplitude times i, a pi/2 phase
+static inline void nymya_s_fast(nymya_qubit *q) {
+    q->amplitude = CMPLX(-cimag(q->amplitude), creal(q->amplitude));
+}
+
+// 3307: amplitude times (1 + i)/sqrt(2)
+static inline void nymya_sx_fast(nymya_qubit *q) {
+    q->amplitude = complex_mul(q->amplitude, CMPLX(0.70710678118654752440, 0.70710678118654752440));
+}
+
+// 3308: amplitude scaled by 1/sqrt(2)
+static inline void nymya_h_fast(nymya_qubit *q) {
+    const double s = 1.0 / sqrt(2.0);
+
+    q->amplitude = CMPLX(creal(q->amplitude) * s, cimag(q->amplitude) * s);
+}
+
+// 3315 and 3316: amplitude times e^(i theta)
+static inline void nymya_phase_shift_fast(nymya_qubit *q, double theta) {
+    q->amplitude = complex_mul(q->amplitude, complex_exp_i(theta));
+}
+
+static inline void nymya_phase_fast(nymya_qubit *q, double phi) {
+    q->amplitude = complex_mul(q->amplitude, complex_exp_i(phi));
+}
+
+// 3319-3321: amplitude times e^(i theta/2), the single-amplitude model of the rotations
+static inline void nymya_rx_fast(nymya_qubit *q, double theta) {
+    q->amplitude = complex_mul(q->amplitude, complex_exp_i(theta / 2.0));
+}
+
+static inline void nymya_ry_fast(nymya_qubit *q, double theta) {
+    q->amplitude = complex_mul(q->amplitude, complex_exp_i(theta / 2.0));
+}
+
+static inline void nymya_rz_fast(nymya_qubit *q, double theta) {
+    q->amplitude = complex_mul(q->amplitude, complex_exp_i(theta / 2.0));
+}
+
+// The single-qubit gates on n contiguous qubits: one vectorised pass, or one
+// batch under NYMYA_BACKEND_KERNEL or _PLUGIN (nymya_gate_n.c)
+int nymya_3301_identity_gate_n(nymya_qubit *qs, size_t n);
+int nymya_3302_global_phase_n(nymya_qubit *qs, size_t n, double theta);
+int nymya_3303_pauli_x_n(nymya_qubit *qs, size_t n);
+int nymya_3304_pauli_y_n(nymya_qubit *qs, size_t n);
+int nymya_3305_pauli_z_n(nymya_qubit *qs, size_t n);
+int nymya_3306_phase_gate_n(nymya_qubit *qs, size_t n);
+int nymya_3307_sqrt_x_gate_n(nymya_qubit *qs, size_t n);
+int nymya_3308_hadamard_gate_n(nymya_qubit *qs, size_t n);
+int nymya_3315_phase_shift_n(nymya_qubit *qs, size_t n, double theta);
+int nymya_3316_phase_gate_n(nymya_qubit *qs, size_t n, double phi);
+int nymya_3319_rotate_x_n(nymya_qubit *qs, size_t n, double theta);
+int nymya_3320_rotate_y_n(nymya_qubit *qs, size_t n, double theta);
+int nymya_3321_rotate_z_n(nymya_qubit *qs, size_t n, double theta);
+int nymya_3330_rotate_n(nymya_qubit *qs, size_t n, char axis, double theta);
+#endif
+
 // Shared function declarations
 int log_symbolic_event(const char* gate, uint64_t id, const char* tag, const char* msg);
 int nymya_event_class_syscall_enter(uint64_t syscall_id, uint64_t qubit_id);
@@ -156,6 +1390,96 @@ int nymya_syscall_event_exit(uint64_t syscall_id, int return_code);
 int nymya_syscall_print_exit_funcs(uint64_t syscall_id, int return_code);
 int nymya_exit_syscall_print_funcs(uint64_t syscall_id, int return_code);
 
+// Smallest cache line assumed for alignment and padding
+#define NYMYA_CACHE_LINE 64
+
+// Default minimum work items per CPU before nymya_parallel_for() splits a job
+#define NYMYA_PARALLEL_THRESHOLD 4096
+// Upper bound on the ranges one nymya_parallel_for() job is split into
+#define NYMYA_PARALLEL_MAX_WORKERS 64
+// Range boundaries fall on multiples of this many items, so ranges of an
+// array that starts on a cache line never share a line
+#define NYMYA_PARALLEL_GRAIN 64
+
+/**
+ * nymya_parallel_fn - Range callback for nymya_parallel_for().
+ * @ctx: Opaque context given to nymya_parallel_for().
+ * @start: First work item of the range.
+ * @end: One past the last work item of the range.
+ *
+ * Returns 0 on success or an error code, which the job reports.
+ */
+typedef int (*nymya_parallel_fn)(void *ctx, size_t start, size_t end);
+
+unsigned int nymya_parallel_workers(size_t n);
+int nymya_parallel_for(size_t n, nymya_parallel_fn fn, void *ctx);
+int nymya_parallel_for_cost(size_t n, size_t cost, nymya_parallel_fn fn, void *ctx);
+
+/**
+ * nymya_graph_edge - One CNOT of a graph-state pattern.
+ * @ctrl: Unit-relative index of the control qubit.
+ * @target: Unit-relative index of the target qubit.
+ */
+typedef struct nymya_graph_edge {
+    uint16_t ctrl;
+    uint16_t target;
+} nymya_graph_edge;
+
+/**
+ * nymya_graph - Graph-state pattern of a lattice gate, for nymya_graph_state().
+ * @name: Event logged once per unit, for the unit's first qubit.
+ * @msg: Message of that event.
+ * @unit: Qubits per unit; the pattern repeats over every whole unit.
+ * @nh: Entries in @h.
+ * @nedges: Entries in @edges.
+ * @h: Unit-relative qubits that get a Hadamard, in order.
+ * @edges: CNOTs applied in order once every Hadamard of the unit is done.
+ */
+typedef struct nymya_graph {
+    const char *name;
+    const char *msg;
+    uint16_t unit;
+    uint16_t nh;
+    uint16_t nedges;
+    const uint16_t *h;
+    const nymya_graph_edge *edges;
+} nymya_graph;
+
+// Initialiser of a nymya_graph from static arrays @h and @edges
+#define NYMYA_GRAPH_INIT(name, msg, unit, h, edges)                             \
+    { name, msg, unit, sizeof(h) / sizeof((h)[0]), sizeof(edges) / sizeof((edges)[0]), h, edges }
+
+// Hadamard pass and CNOT sweep shared by the lattice gates (nymya_graph_state.c)
+int nymya_graph_state(const nymya_graph *g, nymya_qubit *q[], size_t count);
+
+/**
+ * nymya_graph_pair - One CNOT of a graph found at run time.
+ * @ctrl: Index of the control qubit.
+ * @target: Index of the target qubit.
+ */
+typedef struct nymya_graph_pair {
+    uint32_t ctrl;
+    uint32_t target;
+} nymya_graph_pair;
+
+/**
+ * nymya_graph_layers - CNOTs sorted into layers by nymya_graph_schedule().
+ * @pairs: The CNOTs, layer by layer; no qubit is in two CNOTs of a layer.
+ * @off: Layer l is @pairs[@off[l]] up to @pairs[@off[l + 1]]; @nlayers + 1 entries.
+ * @npairs: Entries in @pairs.
+ * @nlayers: Number of layers.
+ */
+typedef struct nymya_graph_layers {
+    nymya_graph_pair *pairs;
+    size_t *off;
+    size_t npairs;
+    size_t nlayers;
+} nymya_graph_layers;
+
+int nymya_graph_schedule(const nymya_graph_pair *pairs, size_t npairs, size_t nqubits,
+                         int ordered, nymya_graph_layers *out);
+void nymya_graph_layers_free(nymya_graph_layers *layers);
+
 #ifdef __KERNEL__
 // Define the inverse of sqrt(2) in fixed-point for kernel calculations
 
@@ -186,6 +1510,503 @@ int nymya_exit_syscall_print_funcs(uint64_t syscall_id, int return_code);
  */
 complex_double fixed_complex_multiply(int64_t re1, int64_t im1, int64_t re2, int64_t im2);
 
+/**
+ * fixed_complex_multiply_n - Multiplies two arrays of Q32.32 complex numbers element-wise.
+ * @a: First operands.
+ * @b: Second operands.
+ * @out: @n products, out[i] = a[i] * b[i]; may be @a or @b.
+ * @n: Number of elements.
+ *
+ * Bit-identical to fixed_complex_multiply() on every element. Uses AVX2,
+ * NEON or RVV when the CPU has them and SIMD is usable in the calling
+ * context, otherwise a scalar loop.
+ */
+void fixed_complex_multiply_n(const complex_double *a, const complex_double *b,
+                              complex_double *out, size_t n);
+
+/**
+ * fixed_complex_scale_n - Multiplies an array of Q32.32 complex numbers by one factor.
+ * @a: Operands.
+ * @s: Common factor, such as a phase.
+ * @out: @n products, out[i] = a[i] * s; may be @a.
+ * @n: Number of elements.
+ *
+ * Same results and SIMD selection as fixed_complex_multiply_n().
+ */
+void fixed_complex_scale_n(const complex_double *a, complex_double s,
+                           complex_double *out, size_t n);
+
+/**
+ * struct nymya_fixed_unitary - Precomputed Q32.32 map of a non-parametric gate.
+ * @dim: 1 for a factor on one amplitude, 2 for a 2x2 map of a qubit pair's
+ *       amplitudes, 0 for gates without an entry.
+ * @m: The factor in m[0][0], or the matrix taking (a, b) to
+ *     (m[0][0]a + m[0][1]b, m[1][0]a + m[1][1]b).
+ */
+struct nymya_fixed_unitary {
+    unsigned int dim;
+    complex_double m[2][2];
+};
+
+// Table slots cover the gate codes from 3301 up to the last non-parametric gate
+#define NYMYA_UNITARY_SLOTS (NYMYA_SYCAMORE_CODE - NYMYA_IDENTITY_GATE_CODE + 1)
+#define NYMYA_UNITARY(code) (&nymya_unitary_table[(code) - NYMYA_IDENTITY_GATE_CODE])
+
+extern const struct nymya_fixed_unitary nymya_unitary_table[];
+void nymya_unitary_apply1(struct nymya_qubit *q, const struct nymya_fixed_unitary *u);
+void nymya_unitary_apply2(struct nymya_qubit *q1, struct nymya_qubit *q2,
+                          const struct nymya_fixed_unitary *u);
+int nymya_3317_controlled_phase_unitary(struct nymya_qubit *k_qc, struct nymya_qubit *k_qt,
+                                        const struct nymya_fixed_unitary *u);
+
+/**
+ * nymya_event_emit - Appends a binary event record to the current CPU's ring.
+ * @gate_code: NYMYA_*_CODE of the gate (0 if unknown).
+ * @qubit_id: ID of the primary qubit involved.
+ * @result: Return code of the gate core.
+ * @gate: Short gate label, truncated to NYMYA_EVENT_LABEL_LEN bytes.
+ *
+ * Lock-free and safe from any context; costs a handful of stores. Records are
+ * readable by userland through the mmap'd /dev/nymya_events device.
+ */
+void nymya_event_emit(uint32_t gate_code, uint64_t qubit_id, int32_t result, const char *gate);
+
+int nymya_event_ring_init(void);
+void nymya_event_ring_exit(void);
+
+/**
+ * nymya_3362_submit_core - Validates and applies a batch of gate records in order.
+ * @ops: Gate records.
+ * @op_count: Number of records in @ops.
+ * @qubits: Qubit array the records' operand indices refer to.
+ * @qubit_count: Number of qubits in @qubits.
+ *
+ * Every record is validated before any gate runs, so a malformed batch leaves
+ * @qubits untouched. Returns 0, -EINVAL, -EINTR if the task was killed, or
+ * the first gate core error.
+ */
+int nymya_3362_submit_core(const nymya_op *ops, size_t op_count,
+                           struct nymya_qubit *qubits, size_t qubit_count);
+// As above, but with @partial a pending signal ends the batch early and the
+// count of records applied is returned as the cursor to resume from
+long nymya_3362_submit_run(const nymya_op *ops, size_t op_count,
+                           struct nymya_qubit *qubits, size_t qubit_count, bool partial);
+long nymya_3362_submit_user(const nymya_op __user *user_ops, size_t op_count,
+                            struct nymya_qubit __user *user_qubits, size_t qubit_count,
+                            bool partial);
+
+int nymya_ring_init(void);
+void nymya_ring_exit(void);
+
+int nymya_dev_init(void);
+void nymya_dev_exit(void);
+
+// Gate calls by code for NYMYA_CALL/NYMYA_CALLV (nymya_call.c)
+long nymya_call_run(u32 code, const u64 *args, u32 nargs);
+long nymya_call_ioctl(unsigned int cmd, unsigned long arg);
+
+// Bulk uniform values for nymya_3361_qrng_range and /dev/nymya_qrng
+void nymya_qrng_fill(u64 *buf, size_t n, u64 min, u64 max);
+int nymya_qrng_dev_init(void);
+void nymya_qrng_dev_exit(void);
+
+// Cache-line aligned syscall staging buffers, cached per CPU (nymya_aligned.c)
+void *nymya_stage_alloc(u32 code, size_t n, size_t size);
+void nymya_stage_free(void *buf);
+void nymya_stage_exit(void);
+
+// Per-process caps on module memory, by kind (nymya_quota.c)
+enum nymya_quota_kind {
+    NYMYA_QUOTA_REG,    // registers held in the module (quota_reg_bytes)
+    NYMYA_QUOTA_STAGE,  // syscall staging buffers in flight (quota_stage_bytes)
+    NYMYA_QUOTA_KINDS
+};
+
+struct nymya_quota;
+int nymya_quota_charge(enum nymya_quota_kind kind, size_t bytes, struct nymya_quota **quota);
+void nymya_quota_uncharge(struct nymya_quota *quota, enum nymya_quota_kind kind, size_t bytes);
+
+/**
+ * struct nymya_lattice_soa - Lattice sites as one array per coordinate.
+ * @qubits: Qubit of site 0.
+ * @qubit_stride: Bytes from one site's qubit to the next's.
+ * @coord: Q32.32 coordinates; coord[k][i] is axis k of site i.
+ * @count: Number of sites.
+ * @box: Q32.32 edge of the periodic box along each axis, 0 for an open axis.
+ *
+ * @qubit_stride is sizeof(struct nymya_qubit) for a plain qubit array, or
+ * the size of the position struct when the qubits live inside one.
+ */
+struct nymya_lattice_soa {
+    struct nymya_qubit *qubits;
+    size_t qubit_stride;
+    const int64_t *coord[NYMYA_LATTICE_MAX_DIM];
+    size_t count;
+    int64_t box[NYMYA_LATTICE_MAX_DIM];
+};
+
+// Strided forms of the graph-state engine for the positional lattices
+int nymya_graph_hadamard(struct nymya_qubit *qubits, size_t stride, size_t count);
+int nymya_graph_fanout(struct nymya_qubit *qubits, size_t stride, uint32_t ctrl,
+                       const uint32_t *targets, size_t n);
+int nymya_graph_layer(struct nymya_qubit *qubits, size_t stride,
+                      const nymya_graph_pair *pairs, size_t n);
+
+// Default sites whose neighbour lists a lattice gate builds at once
+#define NYMYA_LATTICE_CHUNK (1u << 18)
+
+int nymya_lattice_check_size(size_t count);
+size_t nymya_lattice_chunk(size_t count);
+
+/**
+ * struct nymya_lattice_adj - Neighbour list of one topology site.
+ * @nbr: Neighbour indices in ascending order, both below and above the site.
+ * @n: Entries in use.
+ * @cap: Entries @nbr has room for.
+ */
+struct nymya_lattice_adj {
+    uint32_t *nbr;
+    uint32_t n;
+    uint32_t cap;
+};
+
+/**
+ * struct nymya_lattice_topo - Neighbour pairs of a positional lattice, kept for repeat runs.
+ * @code: Gate code the pairs were found for.
+ * @dims: Coordinates per site.
+ * @count: Number of sites.
+ * @cap: Sites @coord, @cell, @next and @adj have room for.
+ * @eps2: Squared cutoff in Q32.32 used for the pair test.
+ * @cell_fp: Grid cell edge in Q32.32.
+ * @origin: Coordinates of the corner of grid cell 0.
+ * @box: Periodic box edge of each axis, 0 for an open axis.
+ * @cell_w: Cell edge on each periodic axis; the box holds @ncell[k] of them.
+ * @ncell: Grid cells across the box on each periodic axis.
+ * @coord: Q32.32 coordinates, @dims per site.
+ * @cell: Signed grid cell of each site, @dims per site.
+ * @next: Next site in the same grid bucket.
+ * @head: First site of each grid bucket.
+ * @mask: Number of grid buckets minus one.
+ * @adj: Neighbour list of each site.
+ * @pool: Block the lists of the initial sites were carved from.
+ * @pool_len: Entries in @pool.
+ * @layers: The pairs in qubit-disjoint layers, built by the first
+ *          nymya_lattice_topo_run() after the sites last changed.
+ *
+ * Holds exactly the pairs nymya_lattice*d_entangle_soa() would find on the
+ * current sites, so nymya_lattice_topo_run() applies the same CNOTs. The
+ * coordinates and the grid are kept so sites can be added and removed with
+ * work proportional to their neighbourhoods.
+ */
+struct nymya_lattice_topo {
+    u32 code;
+    unsigned int dims;
+    size_t count;
+    size_t cap;
+    int64_t eps2;
+    int64_t cell_fp;
+    int64_t origin[NYMYA_LATTICE_MAX_DIM];
+    int64_t box[NYMYA_LATTICE_MAX_DIM];
+    int64_t cell_w[NYMYA_LATTICE_MAX_DIM];
+    uint32_t ncell[NYMYA_LATTICE_MAX_DIM];
+    int64_t *coord;
+    int64_t *cell;
+    uint32_t *next;
+    uint32_t *head;
+    uint32_t mask;
+    struct nymya_lattice_adj *adj;
+    uint32_t *pool;
+    size_t pool_len;
+    nymya_graph_layers layers;
+};
+
+int nymya_lattice3d_topo_build(u32 code, const struct nymya_lattice_soa *sites,
+                               int64_t cutoff_fp, int64_t eps2, struct nymya_lattice_topo *topo);
+int nymya_lattice4d_topo_build(u32 code, const struct nymya_lattice_soa *sites,
+                               int64_t cutoff_fp, int64_t eps2, struct nymya_lattice_topo *topo);
+int nymya_lattice5d_topo_build(u32 code, const struct nymya_lattice_soa *sites,
+                               int64_t cutoff_fp, int64_t eps2, struct nymya_lattice_topo *topo);
+int nymya_lattice_topo_run(struct nymya_lattice_topo *topo, struct nymya_qubit *qubits,
+                           size_t count);
+int nymya_lattice_topo_insert(struct nymya_lattice_topo *topo, const int64_t *pos);
+void nymya_lattice_topo_delete(struct nymya_lattice_topo *topo, uint32_t site);
+void nymya_lattice_topo_free(struct nymya_lattice_topo *topo);
+
+/**
+ * nymya_lattice3d_entangle - Hadamard on every site, then CNOT on every neighbour pair.
+ * @code: Gate code the phase timings are accounted to.
+ * @k_qubits: Fixed-point qubit positions.
+ * @count: Number of qubits.
+ * @cutoff_fp: Neighbour distance cutoff in Q32.32.
+ * @eps2: Squared cutoff in Q32.32 for the pair test.
+ *
+ * Neighbours come from a hashed uniform grid, giving the same CNOTs in the
+ * same order as a full pairwise scan in O(n). The 4D and 5D variants are
+ * generated from the same template in nymya_lattice_grid.h, as are the
+ * _soa forms that take the coordinates as separate arrays. While
+ * nymya_phase_key is on, each successful run adds the time of its phases to
+ * @code's counters in nymya_stats.c. Neighbour lists are built for
+ * nymya_lattice_chunk() sites at a time, with a nymya_lattice_progress
+ * tracepoint after each chunk.
+ */
+int nymya_lattice3d_entangle(u32 code, nymya_qpos3d_k *k_qubits, size_t count,
+                             int64_t cutoff_fp, int64_t eps2);
+int nymya_lattice4d_entangle(u32 code, nymya_qpos4d_k *k_qubits, size_t count,
+                             int64_t cutoff_fp, int64_t eps2);
+int nymya_lattice5d_entangle(u32 code, nymya_qpos5d_k *k_qubits, size_t count,
+                             int64_t cutoff_fp, int64_t eps2);
+int nymya_lattice3d_entangle_soa(u32 code, const struct nymya_lattice_soa *sites,
+                                 int64_t cutoff_fp, int64_t eps2);
+int nymya_lattice4d_entangle_soa(u32 code, const struct nymya_lattice_soa *sites,
+                                 int64_t cutoff_fp, int64_t eps2);
+int nymya_lattice5d_entangle_soa(u32 code, const struct nymya_lattice_soa *sites,
+                                 int64_t cutoff_fp, int64_t eps2);
+int nymya_lattice3d_entangle_exact(u32 code, const struct nymya_lattice_soa *sites,
+                                   const int8_t *offsets, unsigned int noffsets);
+int nymya_lattice4d_entangle_exact(u32 code, const struct nymya_lattice_soa *sites,
+                                   const int8_t *offsets, unsigned int noffsets);
+int nymya_lattice5d_entangle_exact(u32 code, const struct nymya_lattice_soa *sites,
+                                   const int8_t *offsets, unsigned int noffsets);
+
+// Structure-of-arrays cores of the positional lattice gates, run by nymya_3363_lattice_soa
+int nymya_3355_fcc_lattice_soa_core(const struct nymya_lattice_soa *sites);
+int nymya_3356_hcp_lattice_soa_core(const struct nymya_lattice_soa *sites);
+int nymya_3357_e8_projected_lattice_soa_core(const struct nymya_lattice_soa *sites);
+int nymya_3358_d4_lattice_soa_core(const struct nymya_lattice_soa *sites);
+int nymya_3359_b5_lattice_soa_core(const struct nymya_lattice_soa *sites);
+int nymya_3360_e5_projected_lattice_soa_core(const struct nymya_lattice_soa *sites);
+
+// Integer-coordinate cores of the lattices on Z^n, run under NYMYA_LATTICE_INTEGER
+int nymya_3358_d4_lattice_exact_core(const struct nymya_lattice_soa *sites);
+int nymya_3359_b5_lattice_exact_core(const struct nymya_lattice_soa *sites);
+
+// Topology builders of the positional lattice gates, for NYMYA_TOPO_BUILD
+int nymya_3355_fcc_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo);
+int nymya_3356_hcp_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo);
+int nymya_3357_e8_projected_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo);
+int nymya_3358_d4_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo);
+int nymya_3359_b5_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo);
+int nymya_3360_e5_projected_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo);
+
+/**
+ * struct nymya_qubit_ptr_array - Kernel copy of a user array of qubit pointers.
+ * @qubits: Contiguous kernel copies of the qubits; start of the single allocation.
+ * @k_qubits: Pointer array into @qubits, in the order of the user array.
+ * @user_ptrs: User pointers the qubits were copied from.
+ * @count: Number of qubits.
+ */
+struct nymya_qubit_ptr_array {
+    struct nymya_qubit *qubits;
+    struct nymya_qubit **k_qubits;
+    struct nymya_qubit __user **user_ptrs;
+    size_t count;
+};
+
+int nymya_qubit_ptrs_from_user(struct nymya_qubit_ptr_array *arr,
+                               struct nymya_qubit __user * __user *user_q_array,
+                               size_t count, u32 code, const char *who);
+int nymya_qubit_ptrs_to_user(const struct nymya_qubit_ptr_array *arr, u32 code, const char *who);
+void nymya_qubit_ptrs_free(struct nymya_qubit_ptr_array *arr);
+
+#include <linux/jump_label.h>
+#include <linux/timekeeping.h>
+#include <linux/uaccess.h>
+#include "nymya_trace.h"
+
+// Per-CPU per-gate latency histograms and marshalling counters (nymya_stats.c)
+DECLARE_STATIC_KEY_TRUE(nymya_stats_key);
+void nymya_stats_record(u32 code, u64 ns, int ret);
+void nymya_stats_copied(u32 code, size_t bytes, bool out);
+long nymya_stats_staged(u32 code, size_t bytes, size_t held);
+void nymya_stats_unstaged(size_t held);
+
+/**
+ * enum nymya_lattice_phase - Phases of a positional lattice gate, as timed by nymya_lattice*d_entangle().
+ * @NYMYA_LATTICE_GATHER: Copying the coordinates into one array per axis.
+ * @NYMYA_LATTICE_GRID: Binning the sites into the spatial grid.
+ * @NYMYA_LATTICE_HADAMARD: The Hadamard on every site.
+ * @NYMYA_LATTICE_SEARCH: Finding every site's neighbours.
+ * @NYMYA_LATTICE_CNOT: The CNOT on every neighbour pair.
+ * @NYMYA_LATTICE_PHASES: Number of phases.
+ */
+enum nymya_lattice_phase {
+    NYMYA_LATTICE_GATHER,
+    NYMYA_LATTICE_GRID,
+    NYMYA_LATTICE_HADAMARD,
+    NYMYA_LATTICE_SEARCH,
+    NYMYA_LATTICE_CNOT,
+    NYMYA_LATTICE_PHASES,
+};
+
+// Off by default: the serial neighbour pass reads the clock per site while it is on
+DECLARE_STATIC_KEY_FALSE(nymya_phase_key);
+void nymya_stats_phases(u32 code, const u64 *ns);
+int nymya_stats_init(void);
+void nymya_stats_exit(void);
+
+/**
+ * nymya_stats_copy - Accounts a syscall's user copy to its gate code.
+ * @code: Gate code.
+ * @bytes: Bytes actually copied.
+ * @out: True for a copy to user space.
+ */
+static inline void nymya_stats_copy(u32 code, size_t bytes, bool out)
+{
+    if (static_branch_likely(&nymya_stats_key))
+        nymya_stats_copied(code, bytes, out);
+    if (out)
+        trace_nymya_copy_out(code, bytes);
+    else
+        trace_nymya_copy_in(code, bytes);
+}
+
+/**
+ * nymya_copy_from_user - copy_from_user() accounted to a gate code.
+ * @code: Gate code of the syscall doing the copy.
+ * @to: Kernel destination.
+ * @from: User source.
+ * @n: Bytes to copy.
+ *
+ * Returns the number of bytes that could not be copied, as copy_from_user().
+ */
+static inline unsigned long nymya_copy_from_user(u32 code, void *to,
+                                                 const void __user *from, unsigned long n)
+{
+    unsigned long left = copy_from_user(to, from, n);
+
+    nymya_stats_copy(code, n - left, false);
+    return left;
+}
+
+/**
+ * nymya_copy_to_user - copy_to_user() accounted to a gate code.
+ * @code: Gate code of the syscall doing the copy.
+ * @to: User destination.
+ * @from: Kernel source.
+ * @n: Bytes to copy.
+ *
+ * Returns the number of bytes that could not be copied, as copy_to_user().
+ */
+static inline unsigned long nymya_copy_to_user(u32 code, void __user *to,
+                                               const void *from, unsigned long n)
+{
+    unsigned long left = copy_to_user(to, from, n);
+
+    nymya_stats_copy(code, n - left, true);
+    return left;
+}
+
+/**
+ * nymya_trace_core_begin - Fires nymya_core_enter before a gate core runs.
+ * @code: Gate code.
+ * @q0: ID of the first operand.
+ * @q1: ID of the second operand, or 0.
+ *
+ * Returns the start time for nymya_trace_core_end(), or 0 when neither the
+ * latency statistics nor nymya_core_exit are on, in which case the clock is
+ * not read.
+ */
+static inline u64 nymya_trace_core_begin(u32 code, u64 q0, u64 q1)
+{
+    trace_nymya_core_enter(code, q0, q1);
+    if (static_branch_likely(&nymya_stats_key) || trace_nymya_core_exit_enabled())
+        return ktime_get_ns();
+    return 0;
+}
+
+/**
+ * nymya_trace_core_end - Records a gate core run and fires nymya_core_exit.
+ * @code, @q0, @q1: As passed to nymya_trace_core_begin().
+ * @ret: The core's return code.
+ * @t0: Return value of nymya_trace_core_begin().
+ *
+ * Also appends the call's gate record, with its code and result, to the
+ * event ring; log_symbolic_event() from inside the core only adds labelled
+ * records.
+ */
+static inline void nymya_trace_core_end(u32 code, u64 q0, u64 q1, int ret, u64 t0)
+{
+    const nymya_gate_desc *d = nymya_gate_lookup(code);
+    u64 ns = t0 ? ktime_get_ns() - t0 : 0;
+
+    if (static_branch_likely(&nymya_stats_key) && t0)
+        nymya_stats_record(code, ns, ret);
+    nymya_event_emit(code, q0, ret, d ? d->name : NULL);
+    trace_nymya_core_exit(code, q0, q1, ret, ns);
+}
+
+/*
+ * NYMYA_TRACE_CORE - Runs a gate core call between the core tracepoints.
+ * The operand IDs are read before the call, since swap-type gates may
+ * exchange whole qubits. Evaluates to the core's return code.
+ */
+#define NYMYA_TRACE_CORE(code, q0, q1, call) ({                                 \
+    u64 __nymya_q0 = (q0), __nymya_q1 = (q1);                                   \
+    u64 __nymya_t0 = nymya_trace_core_begin((code), __nymya_q0, __nymya_q1);    \
+    int __nymya_ret = (call);                                                   \
+    nymya_trace_core_end((code), __nymya_q0, __nymya_q1, __nymya_ret, __nymya_t0); \
+    __nymya_ret;                                                                \
+})
+
+static inline u64 nymya_trace_syscall_begin(u32 code)
+{
+    trace_nymya_syscall_enter(code, 0);
+    return trace_nymya_syscall_exit_enabled() ? ktime_get_ns() : 0;
+}
+
+static inline void nymya_trace_syscall_end(u32 code, long ret, u64 t0)
+{
+    trace_nymya_syscall_exit(code, ret, t0 ? ktime_get_ns() - t0 : 0);
+}
+
+// Argument i of a NYMYA_CALL record as parameter type t; register width, like the syscall ABI
+#define __NYMYA_CALL_ARG(i, t) ((t)(unsigned long)__nymya_argv[i])
+#define __NYMYA_CALL_ARGS1(t1, a1) __NYMYA_CALL_ARG(0, t1)
+#define __NYMYA_CALL_ARGS2(t1, a1, t2, a2) \
+    __NYMYA_CALL_ARGS1(t1, a1), __NYMYA_CALL_ARG(1, t2)
+#define __NYMYA_CALL_ARGS3(t1, a1, t2, a2, t3, a3) \
+    __NYMYA_CALL_ARGS2(t1, a1, t2, a2), __NYMYA_CALL_ARG(2, t3)
+#define __NYMYA_CALL_ARGS4(t1, a1, t2, a2, t3, a3, t4, a4) \
+    __NYMYA_CALL_ARGS3(t1, a1, t2, a2, t3, a3), __NYMYA_CALL_ARG(3, t4)
+#define __NYMYA_CALL_ARGS5(t1, a1, t2, a2, t3, a3, t4, a4, t5, a5) \
+    __NYMYA_CALL_ARGS4(t1, a1, t2, a2, t3, a3, t4, a4), __NYMYA_CALL_ARG(4, t5)
+
+/*
+ * NYMYA_SYSCALL_DEFINEn - SYSCALL_DEFINEn with the syscall tracepoints around
+ * the body. Takes the gate code first, then the usual SYSCALL_DEFINEn
+ * arguments; the body becomes a static function of the same parameters.
+ *
+ * Also defines nymya_call_<code>(argv), the same call with the arguments
+ * taken from a u64 array, which NYMYA_CALL/NYMYA_CALLV on /dev/nymya
+ * dispatch to (nymya_call.c).
+ */
+#define NYMYA_SYSCALL_DEFINEx(x, code, name, ...)                               \
+    static long __nymya_sys_##name(__MAP(x, __SC_DECL, __VA_ARGS__));           \
+    SYSCALL_DEFINE##x(name, __VA_ARGS__)                                        \
+    {                                                                           \
+        u64 __nymya_t0 = nymya_trace_syscall_begin(code);                       \
+        long __nymya_ret = __nymya_sys_##name(__MAP(x, __SC_ARGS, __VA_ARGS__)); \
+                                                                                \
+        nymya_trace_syscall_end(code, __nymya_ret, __nymya_t0);                 \
+        return __nymya_ret;                                                     \
+    }                                                                           \
+    long nymya_call_##code(const u64 *__nymya_argv);                            \
+    long nymya_call_##code(const u64 *__nymya_argv)                             \
+    {                                                                           \
+        u64 __nymya_t0 = nymya_trace_syscall_begin(code);                       \
+        long __nymya_ret = __nymya_sys_##name(__NYMYA_CALL_ARGS##x(__VA_ARGS__)); \
+                                                                                \
+        nymya_trace_syscall_end(code, __nymya_ret, __nymya_t0);                 \
+        return __nymya_ret;                                                     \
+    }                                                                           \
+    static long __nymya_sys_##name(__MAP(x, __SC_DECL, __VA_ARGS__))
+
+#define NYMYA_SYSCALL_DEFINE1(code, name, ...) NYMYA_SYSCALL_DEFINEx(1, code, name, __VA_ARGS__)
+#define NYMYA_SYSCALL_DEFINE2(code, name, ...) NYMYA_SYSCALL_DEFINEx(2, code, name, __VA_ARGS__)
+#define NYMYA_SYSCALL_DEFINE3(code, name, ...) NYMYA_SYSCALL_DEFINEx(3, code, name, __VA_ARGS__)
+#define NYMYA_SYSCALL_DEFINE4(code, name, ...) NYMYA_SYSCALL_DEFINEx(4, code, name, __VA_ARGS__)
+#define NYMYA_SYSCALL_DEFINE5(code, name, ...) NYMYA_SYSCALL_DEFINEx(5, code, name, __VA_ARGS__)
+
 #endif
 
 #endif // NYMYA_H
@@ -868,6 +2689,54 @@ int nymya_3341_cz_swap(nymya_qubit* q1, nymya_qubit* q2);
  */
 int nymya_3342_deutsch(nymya_qubit* q1, nymya_qubit* q2, void (*f)(nymya_qubit*));
 
+/**
+ * nymya_oracle_from_table - Compiles a one-bit function from its truth table.
+ * @o: Oracle to fill.
+ * @table: Bit x is f(x): 0x0 and 0x3 are the constant functions, 0x2 is
+ *         f(x) = x and 0x1 is f(x) = NOT x.
+ *
+ * The constants become nothing and a Pauli-X on the target; the balanced
+ * functions a CNOT and an anti-controlled NOT from the input to the target.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -1 (errno EINVAL) in userland, -EINVAL in the kernel, if @o is NULL or @table > 0x3.
+ */
+int nymya_oracle_from_table(nymya_oracle *o, unsigned int table);
+
+/**
+ * nymya_oracle_compile - Compiles an oracle from a gate sequence.
+ * @o: Oracle to fill.
+ * @ops: Gate records on operands 0 (input) and 1 (target).
+ * @count: Number of records in @ops.
+ *
+ * Checks every record as nymya_3362_submit() would, against a two-qubit
+ * array, and drops identities.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -1 (errno EINVAL) in userland, -EINVAL in the kernel, on a malformed
+ *   record or more than NYMYA_ORACLE_MAX_OPS gates left.
+ */
+int nymya_oracle_compile(nymya_oracle *o, const nymya_op *ops, size_t count);
+
+/**
+ * nymya_3342_deutsch_oracle - nymya_3342_deutsch() with a compiled oracle.
+ * @q1: Pointer to the input qubit.
+ * @q2: Pointer to the ancilla qubit.
+ * @f: Compiled oracle.
+ *
+ * Runs H(q1), @f, H(q1) as one gate batch: one nymya_3362_submit() in
+ * userland, whichever backend serves it, and nymya_3362_submit_core() in
+ * the kernel.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -1 (errno set) in userland, -errno in the kernel, on NULL arguments, a
+ *   malformed oracle or a failed batch; the qubits are then unchanged.
+ */
+int nymya_3342_deutsch_oracle(nymya_qubit *q1, nymya_qubit *q2, const nymya_oracle *f);
+
 /**
  * nymya_3343_margolis - Applies a Margolis gate to three qubits.
  * @qc1: Pointer to the first control qubit.
@@ -1133,9 +3002,9 @@ int nymya_3360_e5_projected_lattice(nymya_qpos5d qubits[], size_t count);
  * @max: The maximum value for the generated random numbers (inclusive).
  * @count: The number of random numbers to generate.
  *
- * This function leverages quantum properties to generate true random numbers
- * within a given range. The underlying quantum process is assumed to be
- * accessible and properly measured.
+ * The kernel fills @out in bulk with values drawn uniformly from
+ * [@min, @max], without modulo bias. The per-value symbolic gates and
+ * events only run when the qrng_symbolic module parameter is set.
  *
  * Returns:
  * - 0 on success.
@@ -1143,6 +3012,110 @@ int nymya_3360_e5_projected_lattice(nymya_qpos5d qubits[], size_t count);
  */
 int nymya_3361_qrng_range(uint64_t* out, uint64_t min, uint64_t max, size_t count);
 
+/**
+ * nymya_3362_submit - Applies a whole circuit of gate records in one syscall.
+ * @ops: Array of gate records, applied in order.
+ * @op_count: Number of records in @ops.
+ * @qubits: Contiguous array of qubits that the records index into.
+ * @qubit_count: Number of qubits in @qubits.
+ *
+ * The qubit array is copied into the kernel once, every record is run
+ * through the corresponding gate core, and the array is copied back once.
+ * Supported gates are the fixed-arity ones taking one to three qubits
+ * (3301-3341 and 3343-3346); callback and array gates must still be called directly.
+ *
+ * Returns:
+ * - 0 on success; @qubits holds the final state.
+ * - -1 on invalid input or if the syscall fails (errno is set); @qubits is unchanged.
+ */
+int nymya_3362_submit(const nymya_op *ops, size_t op_count, nymya_qubit *qubits, size_t qubit_count);
+
+/**
+ * nymya_3363_lattice_soa - Runs a positional lattice gate on per-axis coordinate arrays.
+ * @lattice_code: NYMYA_*_CODE of the lattice gate, 3355 to 3360.
+ * @qubits: Qubit of each site.
+ * @coords: NYMYA_LATTICE_DIMS(@lattice_code) arrays (x, y, z[, w[, v]]) of @count coordinates.
+ * @count: Number of sites.
+ *
+ * Same gates as the nymya_qpos*d entry points, but the coordinates stay in
+ * separate contiguous arrays and only the qubits are copied back.
+ *
+ * Returns:
+ * - 0 on success; @qubits holds the final state.
+ * - -1 on invalid input or if the syscall fails (errno is set); @qubits is unchanged.
+ */
+int nymya_3363_lattice_soa(unsigned int lattice_code, nymya_qubit qubits[],
+                           const double *const coords[], size_t count);
+
+/**
+ * nymya_3363_lattice_soa_box - nymya_3363_lattice_soa() in a periodic box.
+ * @lattice_code: NYMYA_*_CODE of the lattice gate, 3355 to 3360.
+ * @qubits: Qubit of each site.
+ * @coords: NYMYA_LATTICE_DIMS(@lattice_code) arrays of @count coordinates.
+ * @box: Box edge along each axis, 0 for an open axis; NULL for none.
+ * @count: Number of sites.
+ *
+ * Sites pair with the nearest periodic image of every other site, so a
+ * crystal needs no ghost copies along its periodic faces. Each edge must be
+ * at least twice the gate's cutoff.
+ *
+ * Returns as nymya_3363_lattice_soa().
+ */
+int nymya_3363_lattice_soa_box(unsigned int lattice_code, nymya_qubit qubits[],
+                               const double *const coords[], const double *box, size_t count);
+
+/**
+ * nymya_3363_lattice_soa_int - nymya_3363_lattice_soa() on integer coordinates.
+ * @lattice_code: NYMYA_D4_LATTICE_CODE or NYMYA_B5_LATTICE_CODE.
+ * @qubits: Qubit of each site.
+ * @coords: 4 (D4) or 5 (B5) arrays of @count integer coordinates.
+ * @count: Number of sites.
+ *
+ * Sites pair when they differ by one of the lattice's nearest-neighbour
+ * root vectors: the 24 roots (+-1, +-1, 0, 0) of D4, or the 10 unit
+ * vectors of B5. D4 sites must have an even coordinate sum. There is no distance test and no rounding, and each site
+ * costs a fixed number of hash probes. D4 in these units is the Q32.32
+ * lattice scaled up by sqrt(2); B5 is the same as the Q32.32 form.
+ *
+ * Returns as nymya_3363_lattice_soa().
+ */
+int nymya_3363_lattice_soa_int(unsigned int lattice_code, nymya_qubit qubits[],
+                               const int64_t *const coords[], size_t count);
+
+/**
+ * nymya_3364_submit_compact - nymya_3362_submit() on compact qubits.
+ * @ops: Array of gate records, applied in order.
+ * @op_count: Number of records in @ops.
+ * @qubits: Contiguous array of compact qubits that the records index into.
+ * @qubit_count: Number of qubits in @qubits.
+ *
+ * Runs the same gates as nymya_3362_submit() with less than 60% of its copy
+ * volume. Events the gates log carry the tag as "#<handle>"; nymya_tag_str()
+ * turns it back into the label.
+ *
+ * Returns:
+ * - 0 on success; @qubits holds the final amplitudes.
+ * - -1 on invalid input or if the syscall fails (errno is set); @qubits is unchanged.
+ */
+int nymya_3364_submit_compact(const nymya_op *ops, size_t op_count,
+                              nymya_qubit_c *qubits, size_t qubit_count);
+
+/**
+ * nymya_3365_lattice_array - Runs a pointer-array lattice gate on a contiguous qubit array.
+ * @lattice_code: NYMYA_*_CODE of the gate, 3347 to 3354.
+ * @qubits: The qubits the pointer form would point at, in the same order.
+ * @count: Number of qubits; exactly 6, 7 or 8 for the fixed-size gates
+ *         (3347, 3348, 3352), at least the gate's minimum otherwise.
+ *
+ * Same gates as the pointer-array entry points, but the kernel copies the
+ * whole block in and out once instead of one qubit per pointer.
+ *
+ * Returns:
+ * - 0 on success; @qubits holds the final state.
+ * - -1 on invalid input or if the syscall fails (errno is set); @qubits is unchanged.
+ */
+int nymya_3365_lattice_array(unsigned int lattice_code, nymya_qubit qubits[], size_t count);
+
 
 
 // Shared complex math macros
@@ -1334,3 +3307,40 @@ int nymya_3361_qrng_range(uint64_t* out, uint64_t min, uint64_t max, size_t coun
 #define qrng_range(out, min, max, count) nymya_3361_qrng_range(out, min, max, count)
 #define NYMYA_QRNG_CODE 3361
 
+#define nymya_submit(ops, n, q, nq) nymya_3362_submit(ops, n, q, nq)
+#define NYMYA_SUBMIT_CODE 3362
+
+#define lattice_soa(code, q, coords, n) nymya_3363_lattice_soa(code, q, coords, n)
+#define NYMYA_LATTICE_SOA_CODE 3363
+
+#define nymya_submit_compact(ops, n, q, nq) nymya_3364_submit_compact(ops, n, q, nq)
+#define NYMYA_SUBMIT_COMPACT_CODE 3364
+
+#define lattice_array(code, q, n) nymya_3365_lattice_array(code, q, n)
+#define NYMYA_LATTICE_ARRAY_CODE 3365
+
+// Neighbour distance cutoff of a positional lattice gate (3355-3360), as
+// its kernel core applies it; for userland code, the cores keep Q32.32 copies
+#define NYMYA_LATTICE_CUTOFF(code) \
+    ((code) == NYMYA_E8_PROJECTED_CODE || (code) == NYMYA_B5_LATTICE_CODE ? 1.00 : \
+     (code) == NYMYA_E5_PROJECTED_CODE ? 1.05 : 1.01)
+
+// Coordinates per site of a positional lattice gate (3355-3360), or 0
+#define NYMYA_LATTICE_DIMS(code) \
+    ((code) == NYMYA_FCC_LATTICE_CODE || (code) == NYMYA_HCP_LATTICE_CODE || \
+     (code) == NYMYA_E8_PROJECTED_CODE ? 3 : \
+     (code) == NYMYA_D4_LATTICE_CODE ? 4 : \
+     (code) == NYMYA_B5_LATTICE_CODE || (code) == NYMYA_E5_PROJECTED_CODE ? 5 : 0)
+
+// Flag on the lattice code of nymya_3363_lattice_soa and NYMYA_TOPO_BUILD:
+// the axes array holds one more address, of NYMYA_LATTICE_DIMS(code) Q32.32
+// periodic box edges (0 for an open axis). Pairs are then found by minimum
+// image; a box edge must be at least twice the gate's cutoff.
+#define NYMYA_LATTICE_PERIODIC 0x80000000u
+
+// Flag on the lattice code of nymya_3363_lattice_soa, for D4 (3358) and B5
+// (3359) only: the axes hold plain integer coordinates instead of Q32.32,
+// and neighbours are found exactly from the lattice's root vectors. Cannot
+// be combined with NYMYA_LATTICE_PERIODIC.
+#define NYMYA_LATTICE_INTEGER 0x40000000u
+
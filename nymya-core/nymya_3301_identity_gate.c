@@ -10,6 +10,22 @@
 #include <linux/uaccess.h>
 #include <linux/types.h>
 
+/**
+ * nymya_3301_identity_core - Identity gate on a kernel qubit.
+ * @kq: Qubit; left unchanged.
+ *
+ * The gate only records its event. Shared by the syscall, the batch path
+ * and the in-kernel benchmark.
+ *
+ * Returns 0.
+ */
+int nymya_3301_identity_core(struct nymya_qubit *kq)
+{
+    log_symbolic_event("ID_GATE", kq->id, kq->tag, "State preserved");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3301_identity_core);
+
 /*
  * Syscall: nymya_3301_identity_gate
  * Purpose: Apply the quantum identity gate (I) to a qubit.
@@ -24,18 +40,18 @@
  * Return:
  *     0 on success, -EINVAL if null, -EFAULT if copy fails.
  */
-SYSCALL_DEFINE1(nymya_3301_identity_gate, struct nymya_qubit __user *, user_q)
+NYMYA_SYSCALL_DEFINE1(3301, nymya_3301_identity_gate, struct nymya_qubit __user *, user_q)
 {
     struct nymya_qubit kq;
 
     if (!user_q)
         return -EINVAL;
 
-    if (copy_from_user(&kq, user_q, sizeof(struct nymya_qubit)))
+    if (nymya_copy_from_user(3301, &kq, user_q, sizeof(struct nymya_qubit)))
         return -EFAULT;
 
-    log_symbolic_event("ID_GATE", kq.id, kq.tag, "State preserved");
-    return 0;
+    // The event is the whole gate, so it is what the core tracepoints time
+    return NYMYA_TRACE_CORE(3301, kq.id, 0, nymya_3301_identity_core(&kq));
 }
 
 // Only needed if other kernel modules will call this function directly.
@@ -12,17 +12,6 @@
 #include <math.h>
 #include <complex.h>
 
-// Safely override complex math macros only in userland simulation
-#ifdef nymya_cexp
-#undef nymya_cexp
-#endif
-#define nymya_cexp(theta) cexp(I * (theta))
-
-#ifdef nymya_cmul
-#undef nymya_cmul
-#endif
-#define nymya_cmul(a, b) ((a) * (b))
-
 #else
 #include <linux/kernel.h>
 #include <linux/syscalls.h>
@@ -48,8 +37,7 @@
 int nymya_3302_global_phase(nymya_qubit* q, double theta) {
     if (!q) return -1;
 
-    complex_double phase = nymya_cexp(theta);
-    q->amplitude = nymya_cmul(q->amplitude, phase);
+    nymya_gphase_fast(q, theta);
 
     char log_msg[128];
     snprintf(log_msg, sizeof(log_msg), "Applied phase shift θ=%.3f rad", theta);
@@ -78,8 +66,7 @@ int nymya_3302_global_phase(struct nymya_qubit *q, int64_t theta_fixed) {
         return -EINVAL;
     }
 
-    phase_factor.re = fixed_cos(theta_fixed);
-    phase_factor.im = fixed_sin(theta_fixed);
+    fixed_point_sincos(theta_fixed, NYMYA_TRIG_TIER, &phase_factor.im, &phase_factor.re);
 
     q->amplitude = complex_mul(q->amplitude, phase_factor);
 
@@ -99,7 +86,7 @@ EXPORT_SYMBOL_GPL(nymya_3302_global_phase);
  *
  * Returns 0 on success, -EINVAL on invalid pointers, -EFAULT on copy errors.
  */
-SYSCALL_DEFINE2(nymya_3302_global_phase,
+NYMYA_SYSCALL_DEFINE2(3302, nymya_3302_global_phase,
     struct nymya_qubit __user *, user_q,
     int64_t, theta_fixed)
 {
@@ -110,17 +97,17 @@ SYSCALL_DEFINE2(nymya_3302_global_phase,
     if (!user_q)
         return -EINVAL;
 
-    if (copy_from_user(&kq, user_q, sizeof(kq)))
+    if (nymya_copy_from_user(3302, &kq, user_q, sizeof(kq)))
         return -EFAULT;
 
-    ret = nymya_3302_global_phase(&kq, theta_fixed);
+    ret = NYMYA_TRACE_CORE(3302, kq.id, 0, nymya_3302_global_phase(&kq, theta_fixed));
     if (ret)
         return ret;
 
     snprintf(log_msg, sizeof(log_msg), "Applied phase shift (fixed-point)=%lld", (long long)theta_fixed);
     log_symbolic_event("GPHASE", kq.id, kq.tag, log_msg);
 
-    if (copy_to_user(user_q, &kq, sizeof(kq)))
+    if (nymya_copy_to_user(3302, user_q, &kq, sizeof(kq)))
         return -EFAULT;
 
     return 0;
@@ -42,15 +42,6 @@ EXPORT_SYMBOL_GPL(nymya_3303_pauli_x);
 #include <stdio.h>
 #include <complex.h> // Ensure this is included for _Complex and I
 
-/*
- * Flip imaginary part sign in builtin complex amplitude
- */
-static inline void flip_imag_part(nymya_qubit *q) {
-    // Assuming nymya_qubit's amplitude is _Complex double in userland
-    // For direct manipulation, if q->amplitude is _Complex double:
-    q->amplitude = creal(q->amplitude) - I * cimag(q->amplitude);
-}
-
 /*
  * Userland implementation of the Pauli-X gate
  * @q: pointer to symbolic qubit
@@ -63,7 +54,7 @@ static inline void flip_imag_part(nymya_qubit *q) {
 int nymya_3303_pauli_x(nymya_qubit *q) {
     if (!q) return -1;
 
-    flip_imag_part(q);
+    nymya_x_fast(q);
 
     log_symbolic_event("PAULI_X", q->id, q->tag, "Polarity flipped");
     return 0;
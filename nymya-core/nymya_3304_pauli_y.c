@@ -29,8 +29,7 @@
 int nymya_3304_pauli_y(nymya_qubit* q) {
     if (!q) return -1;
 
-    // Using complex_double as _Complex double in user-space:
-    q->amplitude = make_complex(-complex_im(q->amplitude), complex_re(q->amplitude));
+    nymya_y_fast(q);
 
     log_symbolic_event("PAULI_Y", q->id, q->tag, "Dream vector rotated");
     return 0;
@@ -50,20 +49,13 @@ int nymya_3304_pauli_y(nymya_qubit* q) {
  * @return 0 on success, or a negative error code if an internal issue occurs.
  */
 int nymya_3304_pauli_y(struct nymya_qubit *kq) {
-    int64_t re, im;
-
     // A defensive check, though kq should be valid from the syscall wrapper
     if (!kq) {
         return -EINVAL;
     }
 
-    // Extract fixed-point real and imaginary parts
-    re = kq->amplitude.re;
-    im = kq->amplitude.im;
-
     // Multiply amplitude by i: (a + bi)*i = -b + ai
-    kq->amplitude.re = -im;
-    kq->amplitude.im = re;
+    nymya_unitary_apply1(kq, NYMYA_UNITARY(NYMYA_PAULI_Y_CODE));
 
     log_symbolic_event("PAULI_Y", kq->id, kq->tag, "Dream vector rotated");
 
@@ -76,23 +68,23 @@ EXPORT_SYMBOL_GPL(nymya_3304_pauli_y);
  * Multiplies the qubit amplitude by i.
  * Note: kernel uses fixed-point complex, so manually swap real and imag parts.
  */
-SYSCALL_DEFINE1(nymya_3304_pauli_y, struct nymya_qubit __user *, user_q) {
+NYMYA_SYSCALL_DEFINE1(3304, nymya_3304_pauli_y, struct nymya_qubit __user *, user_q) {
     struct nymya_qubit kq;
     int ret;
 
     if (!user_q)
         return -EINVAL;
-    if (copy_from_user(&kq, user_q, sizeof(kq)))
+    if (nymya_copy_from_user(3304, &kq, user_q, sizeof(kq)))
         return -EFAULT;
 
     // Call the extracted core logic function
-    ret = nymya_3304_pauli_y(&kq);
+    ret = NYMYA_TRACE_CORE(3304, kq.id, 0, nymya_3304_pauli_y(&kq));
     if (ret) {
         // Propagate any error from the core logic
         return ret;
     }
 
-    if (copy_to_user(user_q, &kq, sizeof(kq)))
+    if (nymya_copy_to_user(3304, user_q, &kq, sizeof(kq)))
         return -EFAULT;
 
     return 0;
@@ -31,7 +31,7 @@
 int nymya_3305_pauli_z(nymya_qubit* q) {
     if (!q) return -1;
 
-    q->amplitude = make_complex(-complex_re(q->amplitude), -complex_im(q->amplitude));
+    nymya_z_fast(q);
 
     log_symbolic_event("PAULI_Z", q->id, q->tag, "Inverted inner state");
     return 0;
@@ -51,16 +51,10 @@ int nymya_3305_pauli_z(nymya_qubit* q) {
  *         but returns an int for future extensibility.
  */
 int nymya_3305_pauli_z_core(struct nymya_qubit *kq) {
-    int64_t re, im;
-
     // No need for null check here, as syscall wrapper ensures valid kq pointer
     // if it passed copy_from_user.
 
-    re = kq->amplitude.re;
-    im = kq->amplitude.im;
-
-    kq->amplitude.re = -re;
-    kq->amplitude.im = -im;
+    nymya_unitary_apply1(kq, NYMYA_UNITARY(NYMYA_PAULI_Z_CODE));
 
     log_symbolic_event("PAULI_Z", kq->id, kq->tag, "Inverted inner state");
 
@@ -72,23 +66,23 @@ EXPORT_SYMBOL_GPL(nymya_3305_pauli_z_core);
  * Kernel syscall: nymya_3305_pauli_z
  * Negates the fixed-point amplitude of the qubit.
  */
-SYSCALL_DEFINE1(nymya_3305_pauli_z, struct nymya_qubit __user *, user_q) {
+NYMYA_SYSCALL_DEFINE1(3305, nymya_3305_pauli_z, struct nymya_qubit __user *, user_q) {
     struct nymya_qubit kq;
     int ret;
 
     if (!user_q)
         return -EINVAL;
-    if (copy_from_user(&kq, user_q, sizeof(kq)))
+    if (nymya_copy_from_user(3305, &kq, user_q, sizeof(kq)))
         return -EFAULT;
 
     // Call the core logic function
-    ret = nymya_3305_pauli_z_core(&kq);
+    ret = NYMYA_TRACE_CORE(3305, kq.id, 0, nymya_3305_pauli_z_core(&kq));
     if (ret) {
         // Propagate error from the core function if it returns one
         return ret;
     }
 
-    if (copy_to_user(user_q, &kq, sizeof(kq)))
+    if (nymya_copy_to_user(3305, user_q, &kq, sizeof(kq)))
         return -EFAULT;
 
     return 0;
@@ -12,6 +12,21 @@
     #include <stdio.h>
     #include <stdlib.h>
     #include <math.h>
+
+/*
+ * User-space implementation of the Phase (S) gate.
+ * Multiplies the amplitude by i, a phase shift of π/2.
+ */
+int nymya_3306_phase_gate(nymya_qubit* q) {
+    if (!q) return -1;
+
+    // (a + bi) * i = -b + ai
+    nymya_s_fast(q);
+
+    log_symbolic_event("PHASE_S", q->id, q->tag, "Applied S gate (π/2 phase)");
+    return 0;
+}
+
 #else
     #include <linux/kernel.h>
     #include <linux/syscalls.h>
@@ -30,19 +45,13 @@
      * Returns: 0 on success.
      */
     int nymya_3306_phase_gate(struct nymya_qubit *q) {
-        int64_t re, im;
-
         if (!q) {
             pr_err("NYMYA: nymya_3306_phase_gate received NULL qubit pointer\n");
             return -EINVAL; // Return an error if qubit is null
         }
 
-        re = q->amplitude.re;
-        im = q->amplitude.im;
-
         // (a + bi) * i = -b + ai
-        q->amplitude.re = -im;
-        q->amplitude.im = re;
+        nymya_unitary_apply1(q, NYMYA_UNITARY(NYMYA_PHASE_S_CODE));
 
         log_symbolic_event("PHASE_S", q->id, q->tag, "Applied S gate (π/2 phase)");
         return 0;
@@ -55,7 +64,7 @@
      * This is the syscall entry point that wraps the core nymya_3306_phase_gate function.
      * It handles user-space copy operations before and after calling the core logic.
      */
-    SYSCALL_DEFINE1(nymya_3306_phase_gate, struct nymya_qubit __user *, user_q) {
+    NYMYA_SYSCALL_DEFINE1(3306, nymya_3306_phase_gate, struct nymya_qubit __user *, user_q) {
         struct nymya_qubit kq;
         int ret;
 
@@ -63,17 +72,17 @@
             return -EINVAL;
 
         // Copy qubit data from user space to kernel space
-        if (copy_from_user(&kq, user_q, sizeof(kq)))
+        if (nymya_copy_from_user(3306, &kq, user_q, sizeof(kq)))
             return -EFAULT;
 
         // Call the core logic function defined above
-        ret = nymya_3306_phase_gate(&kq);
+        ret = NYMYA_TRACE_CORE(3306, kq.id, 0, nymya_3306_phase_gate(&kq));
 
         if (ret) // If the core function returned an error, propagate it
             return ret;
 
         // Copy modified qubit data from kernel space back to user space
-        if (copy_to_user(user_q, &kq, sizeof(kq)))
+        if (nymya_copy_to_user(3306, user_q, &kq, sizeof(kq)))
             return -EFAULT;
 
         return 0;
@@ -45,7 +45,7 @@ int nymya_3308_hadamard_gate(nymya_qubit* q) {
     if (!q) return -1;
 
     // Scale the complex amplitude by 1/sqrt(2)
-    q->amplitude *= (1.0 / sqrt(2.0));
+    nymya_h_fast(q);
 
     log_symbolic_event("HADAMARD", q->id, q->tag, "Applied H gate (superposition)");
     return 0;
@@ -66,22 +66,13 @@ int nymya_3308_hadamard_gate(nymya_qubit* q) {
  * -EINVAL if the qubit pointer is NULL.
  */
 int nymya_3308_hadamard_gate(struct nymya_qubit *q) {
-    int64_t re, im;
-    // Fixed-point representation of 1/sqrt(2)
-    const int64_t scale = (int64_t)(0.70710678 * FIXED_POINT_SCALE);
-
     if (!q) {
         pr_err("NYMYA: nymya_3308_hadamard_gate received NULL qubit pointer\n");
         return -EINVAL;
     }
 
-    re = q->amplitude.re;
-    im = q->amplitude.im;
-
-    // Multiply real and imaginary parts by scale, then shift back to fixed-point range
-    // Assuming FIXED_POINT_SCALE is 2^32, so right shift by 32 bits.
-    q->amplitude.re = (re * scale) >> 32;
-    q->amplitude.im = (im * scale) >> 32;
+    // Scale by the precomputed 1/sqrt(2), with a 128-bit intermediate
+    nymya_unitary_apply1(q, NYMYA_UNITARY(NYMYA_HADAMARD_CODE));
 
     log_symbolic_event("HADAMARD", q->id, q->tag, "Applied H gate (superposition)");
     return 0;
@@ -105,22 +96,22 @@ EXPORT_SYMBOL_GPL(nymya_3308_hadamard_gate);
  * -EINVAL if user_q is NULL
  * -EFAULT if copying from/to user space fails
  */
-SYSCALL_DEFINE1(nymya_3308_hadamard_gate, struct nymya_qubit __user *, user_q) {
+NYMYA_SYSCALL_DEFINE1(3308, nymya_3308_hadamard_gate, struct nymya_qubit __user *, user_q) {
     struct nymya_qubit kq;
     int ret;
 
     if (!user_q)
         return -EINVAL;
-    if (copy_from_user(&kq, user_q, sizeof(kq)))
+    if (nymya_copy_from_user(3308, &kq, user_q, sizeof(kq)))
         return -EFAULT;
 
     // Call the core logic function defined above
-    ret = nymya_3308_hadamard_gate(&kq);
+    ret = NYMYA_TRACE_CORE(3308, kq.id, 0, nymya_3308_hadamard_gate(&kq));
 
     if (ret) // If the core function returned an error, propagate it
         return ret;
 
-    if (copy_to_user(user_q, &kq, sizeof(kq)))
+    if (nymya_copy_to_user(3308, user_q, &kq, sizeof(kq)))
         return -EFAULT;
 
     return 0;
@@ -26,6 +26,7 @@
     #include <linux/uaccess.h>
     #include <linux/errno.h>
     #include <linux/module.h> // ADDED: Required for EXPORT_SYMBOL_GPL
+    #include "nymya_mul128.h"
 #endif
 
 #ifndef __KERNEL__
@@ -53,8 +54,6 @@ int nymya_3309_controlled_not(nymya_qubit* q_ctrl, nymya_qubit* q_target) {
         // Flip target amplitude phase
         q_target->amplitude *= -1;
         log_symbolic_event("CNOT", q_target->id, q_target->tag, "NOT applied via control");
-    } else {
-        log_symbolic_event("CNOT", q_target->id, q_target->tag, "No action (control = 0)");
     }
 
     return 0;
@@ -86,27 +85,15 @@ int nymya_3309_controlled_not(struct nymya_qubit *q_ctrl, struct nymya_qubit *q_
     ctrl_re = q_ctrl->amplitude.re;
     ctrl_im = q_ctrl->amplitude.im;
 
-    // Calculate magnitude squared in fixed-point: (re^2 + im^2)
-    // The result is still in a higher fixed-point scale, so we compare with a scaled threshold.
-    __uint128_t mag_sq = (__uint128_t)ctrl_re * ctrl_re + (__uint128_t)ctrl_im * ctrl_im;
-
-    // Threshold magnitude ~0.5 in fixed point squared.
-    // 0.5 * FIXED_POINT_SCALE is the fixed-point representation of 0.5.
-    // (0.5 * FIXED_POINT_SCALE)^2 is the squared fixed-point threshold.
-    // Note: FIXED_POINT_SCALE is typically 2^32, so 0.5 * FIXED_POINT_SCALE is 2^31.
-    // (2^31)^2 = 2^62.
-    // The mag_sq calculation results in a value scaled by (FIXED_POINT_SCALE)^2.
-    // So, the threshold also needs to be scaled by (FIXED_POINT_SCALE)^2 for direct comparison.
-    const __uint128_t threshold_sq = (__uint128_t)(FIXED_POINT_SCALE / 2) * (FIXED_POINT_SCALE / 2);
-
-    if (mag_sq > threshold_sq) {
+    // Compare the magnitude squared (re^2 + im^2), kept at 128 bits and so
+    // scaled by (FIXED_POINT_SCALE)^2, with the threshold 0.5 squared, which
+    // at that scale is (2^31)^2 = 2^62.
+    if (nymya_mag2_cmp_quarter(ctrl_re, ctrl_im) > 0) {
         // Flip target amplitude sign (multiply by -1)
         q_target->amplitude.re = -q_target->amplitude.re;
         q_target->amplitude.im = -q_target->amplitude.im;
 
         log_symbolic_event("CNOT", q_target->id, q_target->tag, "NOT applied via control");
-    } else {
-        log_symbolic_event("CNOT", q_target->id, q_target->tag, "No action (control = 0)");
     }
 
     return 0;
@@ -131,7 +118,7 @@ EXPORT_SYMBOL_GPL(nymya_3309_controlled_not);
  * -EINVAL if either pointer is NULL
  * -EFAULT if copying from/to user memory fails
  */
-SYSCALL_DEFINE2(nymya_3309_controlled_not,
+NYMYA_SYSCALL_DEFINE2(3309, nymya_3309_controlled_not,
     struct nymya_qubit __user *, user_ctrl,
     struct nymya_qubit __user *, user_target) {
 
@@ -142,19 +129,19 @@ SYSCALL_DEFINE2(nymya_3309_controlled_not,
         return -EINVAL;
 
     // Copy qubits from user space
-    if (copy_from_user(&k_ctrl, user_ctrl, sizeof(k_ctrl)))
+    if (nymya_copy_from_user(3309, &k_ctrl, user_ctrl, sizeof(k_ctrl)))
         return -EFAULT;
-    if (copy_from_user(&k_target, user_target, sizeof(k_target)))
+    if (nymya_copy_from_user(3309, &k_target, user_target, sizeof(k_target)))
         return -EFAULT;
 
     // Call the core logic function
-    ret = nymya_3309_controlled_not(&k_ctrl, &k_target);
+    ret = NYMYA_TRACE_CORE(3309, k_ctrl.id, k_target.id, nymya_3309_controlled_not(&k_ctrl, &k_target));
 
     if (ret) // Propagate error from core function
         return ret;
 
     // Copy modified target qubit back to user space
-    if (copy_to_user(user_target, &k_target, sizeof(k_target)))
+    if (nymya_copy_to_user(3309, user_target, &k_target, sizeof(k_target)))
         return -EFAULT;
 
     // Note: Control qubit is not modified, so no need to copy it back.
@@ -31,7 +31,7 @@
  * Returns 0 on success, -errno on failure.
  */
 int nymya_3310_anticontrol_not_user(const void *control, void *target) {
-    int ret = syscall(__NR_nymya_3310_anticontrol_not, control, target);
+    int ret = NYMYA_CALL_GATE(__NR_nymya_3310_anticontrol_not, (uintptr_t)control, (uintptr_t)target);
     if (ret < 0) {
         perror("nymya_3310_anticontrol_not syscall failed");
         return -ret;
@@ -47,8 +47,6 @@ int nymya_3310_anticontrol_not(nymya_qubit* q_ctrl, nymya_qubit* q_target) {
     if (magnitude < 0.5) {
         q_target->amplitude *= -1;
         log_symbolic_event("ACNOT", q_target->id, q_target->tag, "Phase flipped due to control");
-    } else {
-        log_symbolic_event("ACNOT", q_target->id, q_target->tag, "No action (control = 1)");
     }
 
     return 0;
@@ -61,6 +59,7 @@ int nymya_3310_anticontrol_not(nymya_qubit* q_ctrl, nymya_qubit* q_target) {
 #include <linux/errno.h>
 #include <linux/syscalls.h>
 #include <linux/module.h>
+#include "nymya_mul128.h"
 
 int nymya_3310_anticontrol_not(struct nymya_qubit *q_ctrl, struct nymya_qubit *q_target) {
     int64_t ctrl_re, ctrl_im;
@@ -73,16 +72,10 @@ int nymya_3310_anticontrol_not(struct nymya_qubit *q_ctrl, struct nymya_qubit *q
     ctrl_re = q_ctrl->amplitude.re;
     ctrl_im = q_ctrl->amplitude.im;
 
-    __uint128_t mag_sq = (__uint128_t)ctrl_re * ctrl_re + (__uint128_t)ctrl_im * ctrl_im;
-
-    const __uint128_t threshold_sq = (__uint128_t)(FIXED_POINT_SCALE / 2) * (FIXED_POINT_SCALE / 2);
-
-    if (mag_sq < threshold_sq) {
+    if (nymya_mag2_cmp_quarter(ctrl_re, ctrl_im) < 0) {
         q_target->amplitude.re = -q_target->amplitude.re;
         q_target->amplitude.im = -q_target->amplitude.im;
         log_symbolic_event("ACNOT", q_target->id, q_target->tag, "Phase flipped due to control");
-    } else {
-        log_symbolic_event("ACNOT", q_target->id, q_target->tag, "No action (control = 1)");
     }
 
     return 0;
@@ -90,7 +83,7 @@ int nymya_3310_anticontrol_not(struct nymya_qubit *q_ctrl, struct nymya_qubit *q
 
 EXPORT_SYMBOL_GPL(nymya_3310_anticontrol_not);
 
-SYSCALL_DEFINE2(nymya_3310_anticontrol_not,
+NYMYA_SYSCALL_DEFINE2(3310, nymya_3310_anticontrol_not,
     struct nymya_qubit __user *, user_ctrl,
     struct nymya_qubit __user *, user_target) {
 
@@ -100,16 +93,16 @@ SYSCALL_DEFINE2(nymya_3310_anticontrol_not,
     if (!user_ctrl || !user_target)
         return -EINVAL;
 
-    if (copy_from_user(&k_ctrl, user_ctrl, sizeof(k_ctrl)))
+    if (nymya_copy_from_user(3310, &k_ctrl, user_ctrl, sizeof(k_ctrl)))
         return -EFAULT;
-    if (copy_from_user(&k_target, user_target, sizeof(k_target)))
+    if (nymya_copy_from_user(3310, &k_target, user_target, sizeof(k_target)))
         return -EFAULT;
 
-    ret = nymya_3310_anticontrol_not(&k_ctrl, &k_target);
+    ret = NYMYA_TRACE_CORE(3310, k_ctrl.id, k_target.id, nymya_3310_anticontrol_not(&k_ctrl, &k_target));
     if (ret)
         return ret;
 
-    if (copy_to_user(user_target, &k_target, sizeof(k_target)))
+    if (nymya_copy_to_user(3310, user_target, &k_target, sizeof(k_target)))
         return -EFAULT;
 
     return 0;
@@ -18,6 +18,7 @@
     #include <linux/uaccess.h>
     #include <linux/errno.h>
     #include <linux/module.h> // ADDED: Required for EXPORT_SYMBOL_GPL
+    #include "nymya_mul128.h"
 #endif
 
 /**
@@ -81,8 +82,8 @@ int nymya_3311_controlled_z(struct nymya_qubit *k_ctrl, struct nymya_qubit *k_ta
     // Compute magnitude^2 using fixed-point math
     // The individual squared terms are scaled by FIXED_POINT_SCALE.
     // Their sum (mag_sq) is also scaled by FIXED_POINT_SCALE.
-    re_sq = ((__uint128_t)re64 * re64) >> 32; // Result is (re^2 / 2^32) * 2^32 = re^2
-    im_sq = ((__uint128_t)im64 * im64) >> 32; // Result is (im^2 / 2^32) * 2^32 = im^2
+    re_sq = nymya_u128_shr(nymya_umul128(re64, re64), 32); // Result is (re^2 / 2^32) * 2^32 = re^2
+    im_sq = nymya_u128_shr(nymya_umul128(im64, im64), 32); // Result is (im^2 / 2^32) * 2^32 = im^2
     mag_sq = re_sq + im_sq; // This sum is scaled by FIXED_POINT_SCALE
 
     // Fixed-point threshold for 0.5^2.
@@ -93,8 +94,7 @@ int nymya_3311_controlled_z(struct nymya_qubit *k_ctrl, struct nymya_qubit *k_ta
     const uint64_t threshold_sq = (FIXED_POINT_SCALE / 4); // 0.25 * FIXED_POINT_SCALE
 
     if (mag_sq > threshold_sq) {
-        k_target->amplitude.re = -k_target->amplitude.re;
-        k_target->amplitude.im = -k_target->amplitude.im;
+        nymya_unitary_apply1(k_target, NYMYA_UNITARY(NYMYA_CZ_CODE));
         log_symbolic_event("CZ", k_target->id, k_target->tag, "Z applied via control");
     } else {
         log_symbolic_event("CZ", k_target->id, k_target->tag, "No phase shift (control = 0)");
@@ -121,7 +121,7 @@ EXPORT_SYMBOL_GPL(nymya_3311_controlled_z);
  *
  * Returns 0 on success, -EINVAL on null input, or -EFAULT on copy errors.
  */
-SYSCALL_DEFINE2(nymya_3311_controlled_z,
+NYMYA_SYSCALL_DEFINE2(3311, nymya_3311_controlled_z,
     struct nymya_qubit __user *, user_ctrl,
     struct nymya_qubit __user *, user_target) {
 
@@ -131,18 +131,18 @@ SYSCALL_DEFINE2(nymya_3311_controlled_z,
     if (!user_ctrl || !user_target)
         return -EINVAL;
 
-    if (copy_from_user(&k_ctrl, user_ctrl, sizeof(k_ctrl)))
+    if (nymya_copy_from_user(3311, &k_ctrl, user_ctrl, sizeof(k_ctrl)))
         return -EFAULT;
-    if (copy_from_user(&k_target, user_target, sizeof(k_target)))
+    if (nymya_copy_from_user(3311, &k_target, user_target, sizeof(k_target)))
         return -EFAULT;
 
     // Call the core logic function
-    ret = nymya_3311_controlled_z(&k_ctrl, &k_target);
+    ret = NYMYA_TRACE_CORE(3311, k_ctrl.id, k_target.id, nymya_3311_controlled_z(&k_ctrl, &k_target));
 
     if (ret) // Propagate error from core function
         return ret;
 
-    if (copy_to_user(user_target, &k_target, sizeof(k_target)))
+    if (nymya_copy_to_user(3311, user_target, &k_target, sizeof(k_target)))
         return -EFAULT;
 
     return 0;
@@ -101,7 +101,7 @@ int nymya_3312_double_controlled_not_core(struct nymya_qubit *qc1,
 EXPORT_SYMBOL_GPL(nymya_3312_double_controlled_not_core);
 
 
-SYSCALL_DEFINE3(nymya_3312_double_controlled_not,
+NYMYA_SYSCALL_DEFINE3(3312, nymya_3312_double_controlled_not,
     struct nymya_qubit __user *, user_qc1,
     struct nymya_qubit __user *, user_qc2,
     struct nymya_qubit __user *, user_qt) {
@@ -112,22 +112,22 @@ SYSCALL_DEFINE3(nymya_3312_double_controlled_not,
     if (!user_qc1 || !user_qc2 || !user_qt)
         return -EINVAL;
 
-    if (copy_from_user(&k_qc1, user_qc1, sizeof(k_qc1)))
+    if (nymya_copy_from_user(3312, &k_qc1, user_qc1, sizeof(k_qc1)))
         return -EFAULT;
-    if (copy_from_user(&k_qc2, user_qc2, sizeof(k_qc2)))
+    if (nymya_copy_from_user(3312, &k_qc2, user_qc2, sizeof(k_qc2)))
         return -EFAULT;
-    if (copy_from_user(&k_qt, user_qt, sizeof(k_qt)))
+    if (nymya_copy_from_user(3312, &k_qt, user_qt, sizeof(k_qt)))
         return -EFAULT;
 
     // Call the newly created core function
-    ret = nymya_3312_double_controlled_not_core(&k_qc1, &k_qc2, &k_qt);
+    ret = NYMYA_TRACE_CORE(3312, k_qc1.id, k_qc2.id, nymya_3312_double_controlled_not_core(&k_qc1, &k_qc2, &k_qt));
     if (ret) {
         // Propagate error from core function if any
         return ret;
     }
 
     // Copy back the potentially modified target qubit to user space
-    if (copy_to_user(user_qt, &k_qt, sizeof(k_qt)))
+    if (nymya_copy_to_user(3312, user_qt, &k_qt, sizeof(k_qt)))
         return -EFAULT;
 
     return 0;
@@ -56,16 +56,12 @@ int nymya_3313_swap(nymya_qubit* q1, nymya_qubit* q2) {
  * -EINVAL if any qubit pointer is NULL.
  */
 int nymya_3313_swap(struct nymya_qubit *k_q1, struct nymya_qubit *k_q2) {
-    complex_double tmp;
-
     if (!k_q1 || !k_q2) {
         pr_err("NYMYA: nymya_3313_swap received NULL kernel qubit pointer(s)\n");
         return -EINVAL;
     }
 
-    tmp = k_q1->amplitude;
-    k_q1->amplitude = k_q2->amplitude;
-    k_q2->amplitude = tmp;
+    nymya_unitary_apply2(k_q1, k_q2, NYMYA_UNITARY(NYMYA_SWAP_CODE));
 
     log_symbolic_event("SWAP", k_q1->id, k_q1->tag, "Swapped with pair");
     return 0;
@@ -90,7 +86,7 @@ EXPORT_SYMBOL_GPL(nymya_3313_swap);
  * -EINVAL if any user pointer is NULL,
  * -EFAULT if copy_from_user or copy_to_user fails.
  */
-SYSCALL_DEFINE2(nymya_3313_swap,
+NYMYA_SYSCALL_DEFINE2(3313, nymya_3313_swap,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -100,20 +96,20 @@ SYSCALL_DEFINE2(nymya_3313_swap,
     if (!user_q1 || !user_q2)
         return -EINVAL;
 
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1)))
+    if (nymya_copy_from_user(3313, &k_q1, user_q1, sizeof(k_q1)))
         return -EFAULT;
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2)))
+    if (nymya_copy_from_user(3313, &k_q2, user_q2, sizeof(k_q2)))
         return -EFAULT;
 
     // Call the core logic function
-    ret = nymya_3313_swap(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3313, k_q1.id, k_q2.id, nymya_3313_swap(&k_q1, &k_q2));
 
     if (ret) // Propagate error from core function
         return ret;
 
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1)))
+    if (nymya_copy_to_user(3313, user_q1, &k_q1, sizeof(k_q1)))
         return -EFAULT;
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2)))
+    if (nymya_copy_to_user(3313, user_q2, &k_q2, sizeof(k_q2)))
         return -EFAULT;
 
     return 0;
@@ -57,30 +57,16 @@ int nymya_3314_imaginary_swap(nymya_qubit* q1, nymya_qubit* q2) {
  * @return 0 on success, -EINVAL if either qubit pointer is NULL.
  */
 int nymya_3314_imaginary_swap(struct nymya_qubit *kq1, struct nymya_qubit *kq2) {
-    complex_double tmp;
-
     if (!kq1 || !kq2) {
         pr_err("NYMYA: nymya_3314_imaginary_swap received NULL qubit pointer(s)\n");
         return -EINVAL;
     }
 
     /*
-     * Perform multiplication by I (imaginary unit) on kq1->amplitude:
-     * (a + bi) * I = -b + ai
+     * Swap the amplitudes, multiplying each by I (imaginary unit):
+     * kq1 <- I * kq2, kq2 <- I * kq1
      */
-    tmp.re = -kq1->amplitude.im;
-    tmp.im =  kq1->amplitude.re;
-
-    /*
-     * Similarly multiply kq2->amplitude by I and assign to kq1->amplitude
-     */
-    complex_double tmp_kq1;
-    tmp_kq1.re = -kq2->amplitude.im;
-    tmp_kq1.im =  kq2->amplitude.re;
-
-    // Assign swapped and rotated amplitudes
-    kq1->amplitude = tmp_kq1;
-    kq2->amplitude = tmp;
+    nymya_unitary_apply2(kq1, kq2, NYMYA_UNITARY(NYMYA_IMSWAP_CODE));
 
     // Log the swap event referencing the first qubit
     log_symbolic_event("IMSWAP", kq1->id, kq1->tag, "Imaginary mirror swap");
@@ -107,7 +93,7 @@ EXPORT_SYMBOL_GPL(nymya_3314_imaginary_swap);
  * -EINVAL if either user pointer is NULL,
  * -EFAULT if copy_from_user or copy_to_user fails.
  */
-SYSCALL_DEFINE2(nymya_3314_imaginary_swap,
+NYMYA_SYSCALL_DEFINE2(3314, nymya_3314_imaginary_swap,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -119,24 +105,24 @@ SYSCALL_DEFINE2(nymya_3314_imaginary_swap,
         return -EINVAL;
 
     // Copy data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1)))
+    if (nymya_copy_from_user(3314, &k_q1, user_q1, sizeof(k_q1)))
         return -EFAULT;
 
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2)))
+    if (nymya_copy_from_user(3314, &k_q2, user_q2, sizeof(k_q2)))
         return -EFAULT;
 
     // Call the extracted core logic function
-    ret = nymya_3314_imaginary_swap(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3314, k_q1.id, k_q2.id, nymya_3314_imaginary_swap(&k_q1, &k_q2));
     if (ret) {
         // Propagate error from the core function if any
         return ret;
     }
 
     // Copy the modified structs back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1)))
+    if (nymya_copy_to_user(3314, user_q1, &k_q1, sizeof(k_q1)))
         return -EFAULT;
 
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2)))
+    if (nymya_copy_to_user(3314, user_q2, &k_q2, sizeof(k_q2)))
         return -EFAULT;
 
     return 0;
@@ -39,7 +39,7 @@ int nymya_3315_phase_shift(nymya_qubit* q, double theta)
     if (!q)
         return -1;
 
-    q->amplitude *= cexp(I * theta);
+    nymya_phase_shift_fast(q, theta);
     log_symbolic_event("PHASE_SHIFT", q->id, q->tag, "Applied variable phase shift");
     return 0;
 }
@@ -64,8 +64,7 @@ int nymya_3315_phase_shift(struct nymya_qubit *kq, int64_t theta_fixed)
     complex_double phase;
 
     /* Build the fixed-point phase factor using Q32.32 fixed-point trig */
-    phase.re = fixed_cos(theta_fixed);
-    phase.im = fixed_sin(theta_fixed);
+    fixed_point_sincos(theta_fixed, NYMYA_TRIG_TIER, &phase.im, &phase.re);
 
     /* Multiply amplitude by phase factor in fixed-point */
     kq->amplitude = complex_mul(kq->amplitude, phase);
@@ -83,7 +82,7 @@ EXPORT_SYMBOL_GPL(nymya_3315_phase_shift);
  * @theta_fixed: Phase shift angle in Q32.32 fixed-point format (int64_t).
  *
  * Copies the qubit from user space, computes the fixed‑point
- * cosine and sine via fixed_cos()/fixed_sin(), builds a
+ * cosine and sine via fixed_point_sincos(), builds a
  * fixed‑point complex multiplier, multiplies the amplitude,
  * logs the event, and writes back.
  *
@@ -92,7 +91,7 @@ EXPORT_SYMBOL_GPL(nymya_3315_phase_shift);
  *  -EINVAL if user_q is NULL,
  *  -EFAULT if copy_from_user or copy_to_user fails.
  */
-SYSCALL_DEFINE2(nymya_3315_phase_shift,
+NYMYA_SYSCALL_DEFINE2(3315, nymya_3315_phase_shift,
                struct nymya_qubit __user *, user_q,
                int64_t, theta_fixed)
 {
@@ -104,18 +103,18 @@ SYSCALL_DEFINE2(nymya_3315_phase_shift,
         return -EINVAL;
 
     /* Copy in the qubit struct from user space */
-    if (copy_from_user(&k_q, user_q, sizeof(k_q)))
+    if (nymya_copy_from_user(3315, &k_q, user_q, sizeof(k_q)))
         return -EFAULT;
 
     /* Call the newly extracted core logic function with kernel-space variables */
-    ret = nymya_3315_phase_shift(&k_q, theta_fixed);
+    ret = NYMYA_TRACE_CORE(3315, k_q.id, 0, nymya_3315_phase_shift(&k_q, theta_fixed));
     if (ret) {
         /* Propagate error from the core function if it ever fails */
         return ret;
     }
 
     /* Copy back the modified qubit struct to user space */
-    if (copy_to_user(user_q, &k_q, sizeof(k_q)))
+    if (nymya_copy_to_user(3315, user_q, &k_q, sizeof(k_q)))
         return -EFAULT;
 
     return 0;
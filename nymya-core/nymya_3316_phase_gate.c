@@ -49,8 +49,7 @@ int nymya_3316_phase_gate(nymya_qubit* q, double phi) {
     if (!q)
         return -1;
 
-    // User-space uses standard complex math library
-    q->amplitude *= cexp(I * phi);
+    nymya_phase_fast(q, phi);
 
     log_symbolic_event("PHASE_GATE", q->id, q->tag, "Applied symbolic phase gate");
     return 0;
@@ -78,9 +77,7 @@ int nymya_3316_phase_gate(struct nymya_qubit *q, int64_t phi_fixed) {
     }
 
     // Build fixed-point complex phase factor: cos(phi) + i * sin(phi)
-    // Using fixed_cos and fixed_sin wrappers from nymya.h
-    phase_factor.re = fixed_cos(phi_fixed);
-    phase_factor.im = fixed_sin(phi_fixed);
+    fixed_point_sincos(phi_fixed, NYMYA_TRIG_TIER, &phase_factor.im, &phase_factor.re);
 
     // Multiply amplitude by phase factor using fixed-point complex multiplication
     // complex_mul is provided by nymya.h
@@ -93,7 +90,7 @@ int nymya_3316_phase_gate(struct nymya_qubit *q, int64_t phi_fixed) {
 // Export the symbol for this function so other kernel modules/code can call it directly.
 EXPORT_SYMBOL_GPL(nymya_3316_phase_gate);
 
-SYSCALL_DEFINE2(nymya_3316_phase_gate,
+NYMYA_SYSCALL_DEFINE2(3316, nymya_3316_phase_gate,
     struct nymya_qubit __user *, user_q,
     int64_t, phi_fixed)  // phi_fixed in Q32.32 fixed-point
 {
@@ -103,16 +100,16 @@ SYSCALL_DEFINE2(nymya_3316_phase_gate,
     if (!user_q)
         return -EINVAL;
 
-    if (copy_from_user(&k_q, user_q, sizeof(k_q)))
+    if (nymya_copy_from_user(3316, &k_q, user_q, sizeof(k_q)))
         return -EFAULT;
 
     // Call the core logic function
-    ret = nymya_3316_phase_gate(&k_q, phi_fixed);
+    ret = NYMYA_TRACE_CORE(3316, k_q.id, 0, nymya_3316_phase_gate(&k_q, phi_fixed));
 
     if (ret) // Propagate error from core function
         return ret;
 
-    if (copy_to_user(user_q, &k_q, sizeof(k_q)))
+    if (nymya_copy_to_user(3316, user_q, &k_q, sizeof(k_q)))
         return -EFAULT;
 
     return 0;
@@ -19,6 +19,7 @@
     #include <linux/uaccess.h>
     #include <linux/errno.h>
     #include <linux/module.h> // ADDED: Required for EXPORT_SYMBOL_GPL
+    #include "nymya_mul128.h"
 #endif
 
 /**
@@ -45,8 +46,6 @@ int nymya_3317_controlled_phase(nymya_qubit* qc, nymya_qubit* qt, double theta)
     if (cabs(qc->amplitude) > 0.5) {
         qt->amplitude *= cexp(I * theta);
         log_symbolic_event("C-PHASE", qt->id, qt->tag, "Controlled phase applied");
-    } else {
-        log_symbolic_event("C-PHASE", qt->id, qt->tag, "No action (control = 0)");
     }
 
     return 0;
@@ -54,20 +53,13 @@ int nymya_3317_controlled_phase(nymya_qubit* qc, nymya_qubit* qt, double theta)
 
 #else // __KERNEL__
 
-/**
- * nymya_3317_controlled_phase - Core kernel function for Controlled-Phase gate.
- * @k_qc: Pointer to the kernel-space control qubit.
- * @k_qt: Pointer to the kernel-space target qubit.
- * @theta_fixed: Phase angle in fixed-point (int64_t) format.
- *
- * This function applies a controlled phase rotation to the target qubit.
- * If the magnitude of the control qubit's amplitude exceeds 0.5 (in fixed-point),
- * it applies a phase rotation to the target qubit's amplitude.
- * This function is designed to be called directly by other kernel code.
- *
- * Returns 0 on success, -EINVAL on null input.
+/*
+ * nymya_3317_cphase - Shared body of the two kernel entry points.
+ * @factor: Precomputed phase factor, or NULL to build it from @theta_fixed
+ *          once the control is known to be on.
  */
-int nymya_3317_controlled_phase(struct nymya_qubit *k_qc, struct nymya_qubit *k_qt, int64_t theta_fixed) {
+static int nymya_3317_cphase(struct nymya_qubit *k_qc, struct nymya_qubit *k_qt,
+                             int64_t theta_fixed, const complex_double *factor) {
     complex_double phase;
     int64_t re, im;
     uint64_t re64, im64;
@@ -87,8 +79,8 @@ int nymya_3317_controlled_phase(struct nymya_qubit *k_qc, struct nymya_qubit *k_
     im64 = (uint64_t)(im < 0 ? -im : im);
 
     // Compute magnitude^2 using fixed-point math
-    re_sq = ((__uint128_t)re64 * re64) >> 32;
-    im_sq = ((__uint128_t)im64 * im64) >> 32;
+    re_sq = nymya_u128_shr(nymya_umul128(re64, re64), 32);
+    im_sq = nymya_u128_shr(nymya_umul128(im64, im64), 32);
     mag_sq = re_sq + im_sq;
 
     // Fixed-point threshold for 0.5^2 (0.25 * FIXED_POINT_SCALE)
@@ -96,19 +88,52 @@ int nymya_3317_controlled_phase(struct nymya_qubit *k_qc, struct nymya_qubit *k_
 
     if (mag_sq > threshold_sq) {
         // Build phase multiplier
-        phase.re = fixed_cos(theta_fixed);
-        phase.im = fixed_sin(theta_fixed);
+        if (factor)
+            phase = *factor;
+        else
+            fixed_point_sincos(theta_fixed, NYMYA_TRIG_TIER, &phase.im, &phase.re);
 
         k_qt->amplitude = complex_mul(k_qt->amplitude, phase);
         log_symbolic_event("C-PHASE", k_qt->id, k_qt->tag, "Controlled phase applied");
-    } else {
-        log_symbolic_event("C-PHASE", k_qt->id, k_qt->tag, "No action (control = 0)");
     }
 
     return 0;
 }
+
+/**
+ * nymya_3317_controlled_phase - Core kernel function for Controlled-Phase gate.
+ * @k_qc: Pointer to the kernel-space control qubit.
+ * @k_qt: Pointer to the kernel-space target qubit.
+ * @theta_fixed: Phase angle in fixed-point (int64_t) format.
+ *
+ * This function applies a controlled phase rotation to the target qubit.
+ * If the magnitude of the control qubit's amplitude exceeds 0.5 (in fixed-point),
+ * it applies a phase rotation to the target qubit's amplitude.
+ * This function is designed to be called directly by other kernel code.
+ *
+ * Returns 0 on success, -EINVAL on null input.
+ */
+int nymya_3317_controlled_phase(struct nymya_qubit *k_qc, struct nymya_qubit *k_qt, int64_t theta_fixed) {
+    return nymya_3317_cphase(k_qc, k_qt, theta_fixed, NULL);
+}
 EXPORT_SYMBOL_GPL(nymya_3317_controlled_phase);
 
+/**
+ * nymya_3317_controlled_phase_unitary - Controlled phase with a precomputed factor.
+ * @k_qc: Pointer to the kernel-space control qubit.
+ * @k_qt: Pointer to the kernel-space target qubit.
+ * @u: Single-qubit table entry holding e^(i*theta), e.g. for a fixed angle.
+ *
+ * Same as nymya_3317_controlled_phase() without the trig evaluation.
+ *
+ * Returns 0 on success, -EINVAL on null input.
+ */
+int nymya_3317_controlled_phase_unitary(struct nymya_qubit *k_qc, struct nymya_qubit *k_qt,
+                                        const struct nymya_fixed_unitary *u) {
+    return nymya_3317_cphase(k_qc, k_qt, 0, &u->m[0][0]);
+}
+EXPORT_SYMBOL_GPL(nymya_3317_controlled_phase_unitary);
+
 
 
 // Export the symbol for this function so other kernel modules/code can call it directly.
@@ -127,7 +152,7 @@ EXPORT_SYMBOL_GPL(nymya_3317_controlled_phase);
  *
  * Returns 0 on success, -EINVAL on null input, or -EFAULT on copy errors.
  */
-SYSCALL_DEFINE3(nymya_3317_controlled_phase,
+NYMYA_SYSCALL_DEFINE3(3317, nymya_3317_controlled_phase,
     struct nymya_qubit __user *, user_qc,
     struct nymya_qubit __user *, user_qt,
     int64_t, theta_fixed) // theta_fixed in Q32.32 fixed-point
@@ -138,18 +163,18 @@ SYSCALL_DEFINE3(nymya_3317_controlled_phase,
     if (!user_qc || !user_qt)
         return -EINVAL;
 
-    if (copy_from_user(&k_qc, user_qc, sizeof(k_qc)))
+    if (nymya_copy_from_user(3317, &k_qc, user_qc, sizeof(k_qc)))
         return -EFAULT;
-    if (copy_from_user(&k_qt, user_qt, sizeof(k_qt)))
+    if (nymya_copy_from_user(3317, &k_qt, user_qt, sizeof(k_qt)))
         return -EFAULT;
 
     // Call the core logic function
-    ret = nymya_3317_controlled_phase(&k_qc, &k_qt, theta_fixed);
+    ret = NYMYA_TRACE_CORE(3317, k_qc.id, k_qt.id, nymya_3317_controlled_phase(&k_qc, &k_qt, theta_fixed));
 
     if (ret) // Propagate error from core function
         return ret;
 
-    if (copy_to_user(user_qt, &k_qt, sizeof(k_qt)))
+    if (nymya_copy_to_user(3317, user_qt, &k_qt, sizeof(k_qt)))
         return -EFAULT;
 
     return 0;
@@ -22,6 +22,7 @@
     #include <linux/uaccess.h>
     #include <linux/errno.h>
     #include <linux/module.h> // Added for EXPORT_SYMBOL_GPL
+    #include "nymya_mul128.h"
 #endif
 
 /**
@@ -62,9 +63,6 @@ int nymya_3318_controlled_phase_s(nymya_qubit* qc, nymya_qubit* qt) {
         // Multiply target amplitude by e^(i * π/2) = i (S gate)
         qt->amplitude *= cexp(I * (M_PI / 2.0));
         log_symbolic_event("C-PHASE-S", qt->id, qt->tag, "Conditional S phase applied");
-    } else {
-        // No action; control qubit amplitude too small
-        log_symbolic_event("C-PHASE-S", qt->id, qt->tag, "No action (control = 0)");
     }
 
     return 0;
@@ -86,50 +84,24 @@ int nymya_3318_controlled_phase_s(nymya_qubit* qc, nymya_qubit* qt) {
  *         this core logic, assuming valid kernel-space pointers are provided.
  */
 int nymya_3318_controlled_phase_s_core(struct nymya_qubit *k_qc, struct nymya_qubit *k_qt) {
-    complex_double phase;
-    __int128 re_sq, im_sq, mag_sq;
-    __int128 threshold;
-
-    /*
-     * Calculate squared magnitude of control qubit amplitude in fixed-point Q32.32:
-     * magnitude^2 = re^2 + im^2
-     * Using 128-bit intermediate to avoid overflow.
-     */
-    re_sq = (__int128)k_qc->amplitude.re * k_qc->amplitude.re;
-    im_sq = (__int128)k_qc->amplitude.im * k_qc->amplitude.im;
-    mag_sq = re_sq + im_sq;
-
     /*
-     * Threshold for magnitude squared corresponds to (0.5)^2 = 0.25 in fixed-point:
+     * Compare the squared magnitude of the control amplitude, re^2 + im^2
+     * at 128 bits so nothing overflows, with (0.5)^2 = 0.25:
      * 0.5 in Q32.32 = FIXED_POINT_SCALE / 2
      * So threshold = (FIXED_POINT_SCALE / 2)^2
      */
-    threshold = (__int128)(FIXED_POINT_SCALE / 2) * (FIXED_POINT_SCALE / 2);
-
-    if (mag_sq > threshold) {
-        /*
-         * Apply S phase shift (π/2):
-         * cos(π/2) = 0
-         * sin(π/2) = 1
-         * So phase factor = 0 + i*1 in fixed-point.
-         */
-        phase.re = 0;
-        phase.im = FIXED_POINT_SCALE;
-
-        // Multiply target amplitude by phase factor (fixed-point complex multiplication)
-        k_qt->amplitude = complex_mul(k_qt->amplitude, phase);
+    if (nymya_mag2_cmp_quarter(k_qc->amplitude.re, k_qc->amplitude.im) > 0) {
+        // Multiply target amplitude by the S phase factor e^(i*π/2) = i
+        nymya_unitary_apply1(k_qt, NYMYA_UNITARY(NYMYA_CPHASE_S_CODE));
 
         log_symbolic_event("C-PHASE-S", k_qt->id, k_qt->tag, "Conditional S phase applied");
-    } else {
-        // Control amplitude too low; no action
-        log_symbolic_event("C-PHASE-S", k_qt->id, k_qt->tag, "No action (control = 0)");
     }
 
     return 0; // Success
 }
 EXPORT_SYMBOL_GPL(nymya_3318_controlled_phase_s_core);
 
-SYSCALL_DEFINE2(nymya_3318_controlled_phase_s,
+NYMYA_SYSCALL_DEFINE2(3318, nymya_3318_controlled_phase_s,
     struct nymya_qubit __user *, user_qc,
     struct nymya_qubit __user *, user_qt)
 {
@@ -141,20 +113,20 @@ SYSCALL_DEFINE2(nymya_3318_controlled_phase_s,
         return -EINVAL;
 
     // Copy control qubit data from user space to kernel space
-    if (copy_from_user(&k_qc, user_qc, sizeof(k_qc)))
+    if (nymya_copy_from_user(3318, &k_qc, user_qc, sizeof(k_qc)))
         return -EFAULT;
 
     // Copy target qubit data from user space to kernel space
-    if (copy_from_user(&k_qt, user_qt, sizeof(k_qt)))
+    if (nymya_copy_from_user(3318, &k_qt, user_qt, sizeof(k_qt)))
         return -EFAULT;
 
     // Call the new core logic function
-    ret = nymya_3318_controlled_phase_s_core(&k_qc, &k_qt);
+    ret = NYMYA_TRACE_CORE(3318, k_qc.id, k_qt.id, nymya_3318_controlled_phase_s_core(&k_qc, &k_qt));
     if (ret) // Propagate error from core if it ever returns one
         return ret;
 
     // Copy modified target qubit data back to user space
-    if (copy_to_user(user_qt, &k_qt, sizeof(k_qt)))
+    if (nymya_copy_to_user(3318, user_qt, &k_qt, sizeof(k_qt)))
         return -EFAULT;
 
     return 0;
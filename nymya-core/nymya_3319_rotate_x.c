@@ -35,34 +35,8 @@
 int nymya_3319_rotate_x(nymya_qubit* q, double theta) {
     if (!q) return -1;
 
-    // Userland uses standard complex math library.
-    // The complex_double type is defined as _Complex double in userspace nymya.h.
-    // The complex_exp_i and complex_mul macros/functions are also defined in nymya.h
-    // for userspace using standard complex operations.
-
-    // Calculate the rotation factor e^(i * theta/2)
-    complex_double rotation_factor = complex_exp_i(theta / 2.0);
-
-    // Apply the rotation to the qubit's amplitude
-    // For Rx(theta) gate, the transformation matrix is:
-    // | cos(theta/2)   -i*sin(theta/2) |
-    // | -i*sin(theta/2)  cos(theta/2)    |
-    // However, the provided userland code applies a simple complex multiplication
-    // which corresponds to a global phase or a Z-rotation, not an X-rotation.
-    // To correctly implement Rx(theta) for a qubit state |a + ib>,
-    // where the qubit is represented by a single complex amplitude (which is unusual
-    // for a full qubit state, typically it's a vector of two complex amplitudes),
-    // we would need to apply the matrix multiplication.
-    // Assuming `amplitude` here represents the alpha component, and beta is derived
-    // or handled implicitly.
-    // The original userland code was: `q->amplitude *= cexp(I * theta / 2.0);`
-    // This is a global phase.
-    // For a proper Rx gate on a single complex amplitude representing the |0> component,
-    // and assuming the |1> component is implicit, more complex logic is needed.
-    // Given the context of a "symbolic" syscall, and the previous implementation,
-    // we'll stick to a direct complex multiplication for the userland amplitude,
-    // which might represent a simplified model or a specific interpretation.
-    q->amplitude = complex_mul(q->amplitude, rotation_factor);
+    // A single amplitude rotates by the phase e^(i * theta/2)
+    nymya_rx_fast(q, theta);
 
 
     log_symbolic_event("ROT_X", q->id, q->tag, "Applied X-axis rotation");
@@ -97,10 +71,8 @@ int nymya_3319_rotate_x(struct nymya_qubit *q, int64_t theta_fp) {
     // Calculate half theta in fixed-point
     half_theta_fp = theta_fp >> 1; // Fixed-point division by 2
 
-    // Compute the fixed sine and cosine for the rotation
-    // These functions are now provided by nymya.h
-    cos_half_theta_fp = fixed_cos(half_theta_fp); // Using fixed_cos wrapper
-    sin_half_theta_fp = fixed_sin(half_theta_fp); // Using fixed_sin wrapper
+    // Compute the fixed sine and cosine for the rotation in one lookup
+    fixed_point_sincos(half_theta_fp, NYMYA_TRIG_TIER, &sin_half_theta_fp, &cos_half_theta_fp);
 
     // Apply the X-axis rotation to the qubit's amplitude
     // The transformation for a single complex amplitude `A = A_re + i A_im` by `cos(phi) + i sin(phi)` is:
@@ -134,7 +106,7 @@ EXPORT_SYMBOL_GPL(nymya_3319_rotate_x);
  *
  * Returns 0 on success, -EINVAL if user_q pointer is NULL, -EFAULT for memory access issues.
  */
-SYSCALL_DEFINE2(nymya_3319_rotate_x,
+NYMYA_SYSCALL_DEFINE2(3319, nymya_3319_rotate_x,
     struct nymya_qubit __user *, user_q,
     int64_t, theta_fp) { // Renamed theta to theta_fp for clarity
 
@@ -145,17 +117,17 @@ SYSCALL_DEFINE2(nymya_3319_rotate_x,
         return -EINVAL;
 
     // Copy the qubit struct from user space to kernel space
-    if (copy_from_user(&k_q, user_q, sizeof(k_q)))
+    if (nymya_copy_from_user(3319, &k_q, user_q, sizeof(k_q)))
         return -EFAULT;
 
     // Call the core logic function defined above
-    ret = nymya_3319_rotate_x(&k_q, theta_fp);
+    ret = NYMYA_TRACE_CORE(3319, k_q.id, 0, nymya_3319_rotate_x(&k_q, theta_fp));
 
     if (ret) // If the core function returned an error, propagate it
         return ret;
 
     // Copy the modified qubit struct back to user space
-    if (copy_to_user(user_q, &k_q, sizeof(k_q)))
+    if (nymya_copy_to_user(3319, user_q, &k_q, sizeof(k_q)))
         return -EFAULT;
 
     return 0;
@@ -38,22 +38,8 @@
 int nymya_3320_rotate_y(nymya_qubit* q, double theta) {
     if (!q) return -1;
 
-    // Userland uses standard complex math library.
-    // The complex_double type is defined as _Complex double in userspace nymya.h.
-    // The complex_exp_i and complex_mul macros/functions are also defined in nymya.h
-    // for userspace using standard complex operations.
-
-    // Calculate the rotation factor e^(i * theta/2)
-    complex_double rotation_factor = complex_exp_i(theta / 2.0);
-
-    // Apply the rotation to the qubit's amplitude
-    // The original userland code was: `q->amplitude *= cos(theta / 2) + I * sin(theta / 2);`
-    // This is a global phase. For a proper Ry gate on a single complex amplitude
-    // representing the |0> component, and assuming the |1> component is implicit,
-    // more complex logic is needed. Given the context of a "symbolic" syscall,
-    // and the previous implementation, we'll stick to a direct complex multiplication
-    // for the userland amplitude, which might represent a simplified model or a specific interpretation.
-    q->amplitude = complex_mul(q->amplitude, rotation_factor);
+    // A single amplitude rotates by the phase e^(i * theta/2)
+    nymya_ry_fast(q, theta);
 
     log_symbolic_event("ROT_Y", q->id, q->tag, "Applied Y-axis rotation");
     return 0;
@@ -87,10 +73,8 @@ int nymya_3320_rotate_y(struct nymya_qubit *q, int64_t theta_fp) {
     // Calculate half theta in fixed-point
     half_theta_fp = theta_fp >> 1; // Fixed-point division by 2
 
-    // Compute the fixed sine and cosine for the rotation using the wrapper functions
-    // Using fixed_cos and fixed_sin as per nymya.h comments.
-    cos_half_theta_fp = fixed_cos(half_theta_fp);
-    sin_half_theta_fp = fixed_sin(half_theta_fp);
+    // Compute the fixed sine and cosine for the rotation in one lookup
+    fixed_point_sincos(half_theta_fp, NYMYA_TRIG_TIER, &sin_half_theta_fp, &cos_half_theta_fp);
 
     // Apply the Y-axis rotation to the qubit's amplitude
     // Applying the complex multiplication: (re + i*im) * (cos + i*sin)
@@ -123,7 +107,7 @@ EXPORT_SYMBOL_GPL(nymya_3320_rotate_y);
  *
  * Returns 0 on success, -EINVAL if user_q pointer is NULL, -EFAULT for memory access issues.
  */
-SYSCALL_DEFINE2(nymya_3320_rotate_y,
+NYMYA_SYSCALL_DEFINE2(3320, nymya_3320_rotate_y,
     struct nymya_qubit __user *, user_q,
     int64_t, theta_fp) {
 
@@ -134,17 +118,17 @@ SYSCALL_DEFINE2(nymya_3320_rotate_y,
         return -EINVAL;
 
     // Copy the qubit struct from user space to kernel space
-    if (copy_from_user(&k_q, user_q, sizeof(k_q)))
+    if (nymya_copy_from_user(3320, &k_q, user_q, sizeof(k_q)))
         return -EFAULT;
 
     // Call the core logic function defined above
-    ret = nymya_3320_rotate_y(&k_q, theta_fp);
+    ret = NYMYA_TRACE_CORE(3320, k_q.id, 0, nymya_3320_rotate_y(&k_q, theta_fp));
 
     if (ret) // If the core function returned an error, propagate it
         return ret;
 
     // Copy the modified qubit struct back to user space
-    if (copy_to_user(user_q, &k_q, sizeof(k_q)))
+    if (nymya_copy_to_user(3320, user_q, &k_q, sizeof(k_q)))
         return -EFAULT;
 
     return 0;
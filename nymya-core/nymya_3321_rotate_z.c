@@ -38,19 +38,8 @@
 int nymya_3321_rotate_z(nymya_qubit* q, double theta) {
     if (!q) return -1;
 
-    // Userland uses standard complex math library.
-    // The complex_double type is defined as _Complex double in userspace nymya.h.
-    // The complex_exp_i and complex_mul macros/functions are also defined in nymya.h
-    // for userspace using standard complex operations.
-
-    // Calculate the rotation factor e^(i * theta/2)
-    complex_double rotation_factor = complex_exp_i(theta / 2.0);
-
-    // Apply the rotation to the qubit's amplitude
-    // Applying the complex multiplication: (re + i*im) * (cos + i*sin)
-    // New_re = re*cos - im*sin
-    // New_im = re*sin + im*cos
-    q->amplitude = complex_mul(q->amplitude, rotation_factor);
+    // A single amplitude rotates by the phase e^(i * theta/2)
+    nymya_rz_fast(q, theta);
 
     log_symbolic_event("ROT_Z", q->id, q->tag, "Applied Z-axis rotation");
     return 0;
@@ -84,9 +73,8 @@ int nymya_3321_rotate_z(struct nymya_qubit *q, int64_t theta_fp) {
     // Calculate half theta in fixed-point
     half_theta_fp = theta_fp >> 1; // Fixed-point division by 2
 
-    // Compute the fixed sine and cosine for the rotation using the wrapper functions
-    sin_half_theta_fp = fixed_sin(half_theta_fp);
-    cos_half_theta_fp = fixed_cos(half_theta_fp);
+    // Compute the fixed sine and cosine for the rotation in one lookup
+    fixed_point_sincos(half_theta_fp, NYMYA_TRIG_TIER, &sin_half_theta_fp, &cos_half_theta_fp);
 
     // Apply the Z-axis rotation to the qubit's amplitude
     // Applying the complex multiplication: (re + i*im) * (cos + i*sin)
@@ -122,7 +110,7 @@ EXPORT_SYMBOL_GPL(nymya_3321_rotate_z);
  *
  * Returns 0 on success, -EINVAL if user_q pointer is NULL, -EFAULT for memory access issues.
  */
-SYSCALL_DEFINE2(nymya_3321_rotate_z,
+NYMYA_SYSCALL_DEFINE2(3321, nymya_3321_rotate_z,
     struct nymya_qubit __user *, user_q,
     int64_t, theta_fp) {
 
@@ -133,17 +121,17 @@ SYSCALL_DEFINE2(nymya_3321_rotate_z,
         return -EINVAL;
 
     // Copy the qubit struct from user space to kernel space
-    if (copy_from_user(&k_q, user_q, sizeof(k_q)))
+    if (nymya_copy_from_user(3321, &k_q, user_q, sizeof(k_q)))
         return -EFAULT;
 
     // Call the core logic function defined above
-    ret = nymya_3321_rotate_z(&k_q, theta_fp);
+    ret = NYMYA_TRACE_CORE(3321, k_q.id, 0, nymya_3321_rotate_z(&k_q, theta_fp));
 
     if (ret) // If the core function returned an error, propagate it
         return ret;
 
     // Copy the modified qubit struct back to user space
-    if (copy_to_user(user_q, &k_q, sizeof(k_q)))
+    if (nymya_copy_to_user(3321, user_q, &k_q, sizeof(k_q)))
         return -EFAULT;
 
     return 0;
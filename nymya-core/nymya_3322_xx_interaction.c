@@ -79,8 +79,8 @@ int nymya_3322_xx_interaction(nymya_qubit* q1, nymya_qubit* q2, double theta) {
  */
 int nymya_3322_xx_interaction(struct nymya_qubit *kq1, struct nymya_qubit *kq2, int64_t theta) {
     // Calculate the fixed-point cos and sin values for the phase
-    int64_t cos_val = fixed_cos(theta);  // Real part of the phase
-    int64_t sin_val = fixed_sin(theta);  // Imaginary part of the phase
+    int64_t cos_val, sin_val;  // Real and imaginary parts of the phase
+    fixed_point_sincos(theta, NYMYA_TRIG_TIER, &sin_val, &cos_val);
 
     // Calculate the real and imaginary components for the phase
     int64_t real_phase = cos_val;  // Real part
@@ -132,7 +132,7 @@ EXPORT_SYMBOL_GPL(nymya_3322_xx_interaction);
  * - -EINVAL if either user_q1 or user_q2 is NULL (invalid input).
  * - -EFAULT if copying data to/from user space fails (memory access issues).
  */
-SYSCALL_DEFINE3(nymya_3322_xx_interaction,
+NYMYA_SYSCALL_DEFINE3(3322, nymya_3322_xx_interaction,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     int64_t, theta) {
@@ -145,21 +145,21 @@ SYSCALL_DEFINE3(nymya_3322_xx_interaction,
         return -EINVAL;  // Return error if any of the pointers are NULL
 
     // Copy the qubit structs from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1)))
+    if (nymya_copy_from_user(3322, &k_q1, user_q1, sizeof(k_q1)))
         return -EFAULT;  // Return error if memory copy fails
 
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2)))
+    if (nymya_copy_from_user(3322, &k_q2, user_q2, sizeof(k_q2)))
         return -EFAULT;  // Return error if memory copy fails
 
     // Call the newly created core function with kernel-space variables
-    ret = nymya_3322_xx_interaction(&k_q1, &k_q2, theta);
+    ret = NYMYA_TRACE_CORE(3322, k_q1.id, k_q2.id, nymya_3322_xx_interaction(&k_q1, &k_q2, theta));
     if (ret)
         return ret; // Propagate error from core function, if any
 
     // Copy the modified qubits back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1)))
+    if (nymya_copy_to_user(3322, user_q1, &k_q1, sizeof(k_q1)))
         return -EFAULT;  // Return error if memory copy fails
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2)))
+    if (nymya_copy_to_user(3322, user_q2, &k_q2, sizeof(k_q2)))
         return -EFAULT;  // Return error if memory copy fails
 
     return 0;  // Return success
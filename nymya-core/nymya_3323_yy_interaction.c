@@ -41,8 +41,8 @@
  */
 int nymya_3323_yy_interaction(struct nymya_qubit *kq1, struct nymya_qubit *kq2, int64_t theta) {
     // Use fixed-point math to compute the trigonometric values
-    int64_t cos_val = fixed_cos(theta); // Real part of the phase
-    int64_t sin_val = fixed_sin(theta); // Imaginary part of the phase
+    int64_t cos_val, sin_val; // Real and imaginary parts of the phase
+    fixed_point_sincos(theta, NYMYA_TRIG_TIER, &sin_val, &cos_val);
 
     // Calculate the real and imaginary components for the phase (e^(i*theta))
     int64_t real_phase = cos_val;
@@ -130,7 +130,7 @@ int nymya_3323_yy_interaction(nymya_qubit* q1, nymya_qubit* q2, double theta) {
  * - -EINVAL if either user_q1 or user_q2 is NULL (invalid input).
  * - -EFAULT if copying data to/from user space fails (memory access issues).
  */
-SYSCALL_DEFINE3(nymya_3323_yy_interaction,
+NYMYA_SYSCALL_DEFINE3(3323, nymya_3323_yy_interaction,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     int64_t, theta) {
@@ -143,14 +143,14 @@ SYSCALL_DEFINE3(nymya_3323_yy_interaction,
         return -EINVAL;  // Return error if any of the pointers are NULL
 
     // Copy the qubit structs from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1)))
+    if (nymya_copy_from_user(3323, &k_q1, user_q1, sizeof(k_q1)))
         return -EFAULT;  // Return error if memory copy fails
 
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2)))
+    if (nymya_copy_from_user(3323, &k_q2, user_q2, sizeof(k_q2)))
         return -EFAULT;  // Return error if memory copy fails
 
     // Call the core interaction logic
-    ret = nymya_3323_yy_interaction(&k_q1, &k_q2, theta);
+    ret = NYMYA_TRACE_CORE(3323, k_q1.id, k_q2.id, nymya_3323_yy_interaction(&k_q1, &k_q2, theta));
     if (ret) {
         // Propagate error if the core function indicates a failure,
         // though currently it is designed to always return 0.
@@ -158,9 +158,9 @@ SYSCALL_DEFINE3(nymya_3323_yy_interaction,
     }
 
     // Copy the modified qubits back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1)))
+    if (nymya_copy_to_user(3323, user_q1, &k_q1, sizeof(k_q1)))
         return -EFAULT;  // Return error if memory copy fails
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2)))
+    if (nymya_copy_to_user(3323, user_q2, &k_q2, sizeof(k_q2)))
         return -EFAULT;  // Return error if memory copy fails
 
     return 0;  // Return success
@@ -46,8 +46,9 @@ int nymya_3324_zz_interaction(nymya_qubit* q1, nymya_qubit* q2, double theta) {
 int nymya_3324_zz_interaction(struct nymya_qubit *kq1,
                               struct nymya_qubit *kq2,
                               int64_t theta) {
-    int64_t cos_val = fixed_cos(theta);
-    int64_t sin_val = fixed_sin(theta);
+    int64_t cos_val, sin_val;
+
+    fixed_point_sincos(theta, NYMYA_TRIG_TIER, &sin_val, &cos_val);
 
     // Compute and apply phase for first qubit
     int64_t real1 = (kq1->amplitude.re * cos_val - kq1->amplitude.im * sin_val) / FIXED_POINT_SCALE;
@@ -69,21 +70,21 @@ EXPORT_SYMBOL_GPL(nymya_3324_zz_interaction);
 /**
  * SYSCALL_DEFINE3(nymya_3324_zz_interaction) - Kernel syscall for ZZ interaction.
  */
-SYSCALL_DEFINE3(nymya_3324_zz_interaction,
+NYMYA_SYSCALL_DEFINE3(3324, nymya_3324_zz_interaction,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     int64_t, theta) {
 
     struct nymya_qubit k1, k2;
     if (!user_q1 || !user_q2) return -EINVAL;
-    if (copy_from_user(&k1, user_q1, sizeof(k1))) return -EFAULT;
-    if (copy_from_user(&k2, user_q2, sizeof(k2))) return -EFAULT;
+    if (nymya_copy_from_user(3324, &k1, user_q1, sizeof(k1))) return -EFAULT;
+    if (nymya_copy_from_user(3324, &k2, user_q2, sizeof(k2))) return -EFAULT;
 
-    int ret = nymya_3324_zz_interaction(&k1, &k2, theta);
+    int ret = NYMYA_TRACE_CORE(3324, k1.id, k2.id, nymya_3324_zz_interaction(&k1, &k2, theta));
     if (ret) return ret;
 
-    if (copy_to_user(user_q1, &k1, sizeof(k1))) return -EFAULT;
-    if (copy_to_user(user_q2, &k2, sizeof(k2))) return -EFAULT;
+    if (nymya_copy_to_user(3324, user_q1, &k1, sizeof(k1))) return -EFAULT;
+    if (nymya_copy_to_user(3324, user_q2, &k2, sizeof(k2))) return -EFAULT;
     return 0;
 }
 #endif // __KERNEL__
@@ -78,8 +78,8 @@ int nymya_3325_xyz_entangle(nymya_qubit* q1, nymya_qubit* q2, double theta) {
 int nymya_3325_xyz_entangle(struct nymya_qubit *k_q1, struct nymya_qubit *k_q2, int64_t fixed_theta) {
     // 1. Perform fixed-point trigonometric calculations and complex number construction
     // fixed_theta is already in fixed-point format, so no conversion from double is needed here.
-    int64_t fixed_cos_val = fixed_cos(fixed_theta);
-    int64_t fixed_sin_val = fixed_sin(fixed_theta);
+    int64_t fixed_cos_val, fixed_sin_val;
+    fixed_point_sincos(fixed_theta, NYMYA_TRIG_TIER, &fixed_sin_val, &fixed_cos_val);
 
     // Construct the rotation complex number (fixed-point representation)
     // using the make_complex function defined in nymya.h.
@@ -122,8 +122,8 @@ EXPORT_SYMBOL_GPL(nymya_3325_xyz_entangle);
  * - -EINVAL if either user_q1 or user_q2 is NULL.
  * - -EFAULT if copying data between user and kernel space fails.
  */
-SYSCALL_DEFINE3(
-    nymya_3325_xyz_entangle,
+NYMYA_SYSCALL_DEFINE3(
+    3325, nymya_3325_xyz_entangle,
     struct nymya_qubit __user *, user_q1, // Pointer to user-space qubit 1
     struct nymya_qubit __user *, user_q2, // Pointer to user-space qubit 2
     int64_t, fixed_theta                  // Angle for entanglement, now fixed-point
@@ -138,11 +138,11 @@ SYSCALL_DEFINE3(
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3325, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3325_xyz_entangle: Failed to copy k_q1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3325, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3325_xyz_entangle: Failed to copy k_q2 from user\n");
         return -EFAULT; // Bad address
     }
@@ -150,14 +150,14 @@ SYSCALL_DEFINE3(
     // 3. Call the extracted core logic function
     // The core function modifies k_q1 and k_q2 in place.
     // Currently, it always returns 0, but could be extended to return errors.
-    nymya_3325_xyz_entangle(&k_q1, &k_q2, fixed_theta);
+    NYMYA_TRACE_CORE(3325, k_q1.id, k_q2.id, nymya_3325_xyz_entangle(&k_q1, &k_q2, fixed_theta));
 
     // 4. Copy the modified qubits back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3325, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3325_xyz_entangle: Failed to copy k_q1 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3325, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3325_xyz_entangle: Failed to copy k_q2 to user\n");
         ret = -EFAULT; // Bad address
     }
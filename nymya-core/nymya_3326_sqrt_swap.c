@@ -82,30 +82,7 @@ int nymya_3326_sqrt_swap(struct nymya_qubit *kq1, struct nymya_qubit *kq2) {
     // New amplitudes:
     // q1_new = 0.5 * (a + b + i * (a - b))
     // q2_new = 0.5 * (a + b - i * (a - b))
-
-    // Calculate (a + b)
-    complex_double sum_amplitude;
-    sum_amplitude.re = kq1->amplitude.re + kq2->amplitude.re;
-    sum_amplitude.im = kq1->amplitude.im + kq2->amplitude.im;
-
-    // Calculate (a - b)
-    complex_double diff_amplitude;
-    diff_amplitude.re = kq1->amplitude.re - kq2->amplitude.re;
-    diff_amplitude.im = kq1->amplitude.im - kq2->amplitude.im;
-
-    // Calculate i * (a - b)
-    // If X = X_re + iX_im, then iX = -X_im + iX_re
-    complex_double i_times_diff;
-    i_times_diff.re = -diff_amplitude.im;
-    i_times_diff.im = diff_amplitude.re;
-
-    // Calculate (a + b + i * (a - b)) and divide by 2
-    kq1->amplitude.re = (sum_amplitude.re + i_times_diff.re) >> 1;
-    kq1->amplitude.im = (sum_amplitude.im + i_times_diff.im) >> 1;
-
-    // Calculate (a + b - i * (a - b)) and divide by 2
-    kq2->amplitude.re = (sum_amplitude.re - i_times_diff.re) >> 1;
-    kq2->amplitude.im = (sum_amplitude.im - i_times_diff.im) >> 1;
+    nymya_unitary_apply2(kq1, kq2, NYMYA_UNITARY(NYMYA_SQRT_SWAP_CODE));
 
     // Log the symbolic event
     log_symbolic_event("SQRT_SWAP", kq1->id, kq1->tag, "√SWAP applied");
@@ -129,7 +106,7 @@ EXPORT_SYMBOL_GPL(nymya_3326_sqrt_swap);
  * - -EINVAL if any user pointer is invalid.
  * - -EFAULT if copying data to/from user space fails.
  */
-SYSCALL_DEFINE2(nymya_3326_sqrt_swap,
+NYMYA_SYSCALL_DEFINE2(3326, nymya_3326_sqrt_swap,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -143,28 +120,28 @@ SYSCALL_DEFINE2(nymya_3326_sqrt_swap,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3326, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3326_sqrt_swap: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3326, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3326_sqrt_swap: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
 
     // Call the core logic function
-    ret = nymya_3326_sqrt_swap(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3326, k_q1.id, k_q2.id, nymya_3326_sqrt_swap(&k_q1, &k_q2));
     if (ret) {
         pr_err("nymya_3326_sqrt_swap: Core logic failed with error %d\n", ret);
         return ret; // Propagate error from core function
     }
 
     // 3. Copy modified qubit data back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3326, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3326_sqrt_swap: Failed to copy k_q1 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3326, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3326_sqrt_swap: Failed to copy k_q2 to user space\n");
         return -EFAULT;
     }
@@ -73,10 +73,6 @@ int nymya_3327_sqrt_iswap(nymya_qubit* q1, nymya_qubit* q2) {
  * - -EINVAL if any qubit pointer is NULL.
  */
 int nymya_3327_sqrt_iswap(struct nymya_qubit *q1, struct nymya_qubit *q2) {
-    complex_double term1;
-    complex_double term2;
-    complex_double scalar_factor = make_complex(FIXED_POINT_SQRT2_INV_FP, 0);
-
     // 1. Validate kernel qubit pointers
     if (!q1 || !q2) {
         pr_err("nymya_3327_sqrt_iswap: Invalid kernel qubit pointers\n");
@@ -87,26 +83,7 @@ int nymya_3327_sqrt_iswap(struct nymya_qubit *q1, struct nymya_qubit *q2) {
     // New amplitudes:
     // q1_new = (a + i * b) / sqrt(2.0)
     // q2_new = (b + i * a) / sqrt(2.0)
-
-    // Calculate (a + i * b)
-    // If X = X_re + iX_im, then iX = -X_im + iX_re
-    // So, i * b = -b.im + i * b.re
-    // (a + i * b).re = a.re - b.im
-    // (a + i * b).im = a.im + b.re
-    term1.re = q1->amplitude.re - q2->amplitude.im;
-    term1.im = q1->amplitude.im + q2->amplitude.re;
-
-    // Calculate (b + i * a)
-    // So, i * a = -a.im + i * a.re
-    // (b + i * a).re = b.re - a.im
-    // (b + i * a).im = b.im + a.re
-    term2.re = q2->amplitude.re - q1->amplitude.im;
-    term2.im = q2->amplitude.im + q1->amplitude.re;
-
-    // Divide by sqrt(2.0) by multiplying with 1/sqrt(2) in fixed-point
-    // Use complex_mul for scalar multiplication of complex numbers
-    q1->amplitude = complex_mul(term1, scalar_factor);
-    q2->amplitude = complex_mul(term2, scalar_factor);
+    nymya_unitary_apply2(q1, q2, NYMYA_UNITARY(NYMYA_SQRT_ISWAP_CODE));
 
     // Log the symbolic event
     log_symbolic_event("√iSWAP", q2->id, q2->tag, "√iSWAP applied");
@@ -133,7 +110,7 @@ EXPORT_SYMBOL_GPL(nymya_3327_sqrt_iswap);
  * - -EINVAL if any user pointer is invalid.
  * - -EFAULT if copying data to/from user space fails.
  */
-SYSCALL_DEFINE2(nymya_3327_sqrt_iswap,
+NYMYA_SYSCALL_DEFINE2(3327, nymya_3327_sqrt_iswap,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -147,27 +124,27 @@ SYSCALL_DEFINE2(nymya_3327_sqrt_iswap,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3327, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3327_sqrt_iswap: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3327, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3327_sqrt_iswap: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
 
     // Call the core logic function defined above
-    ret = nymya_3327_sqrt_iswap(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3327, k_q1.id, k_q2.id, nymya_3327_sqrt_iswap(&k_q1, &k_q2));
 
     if (ret) // If the core function returned an error, propagate it
         return ret;
 
     // 3. Copy modified qubit data back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3327, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3327_sqrt_iswap: Failed to copy k_q1 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3327, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3327_sqrt_iswap: Failed to copy k_q2 to user space\n");
         return -EFAULT;
     }
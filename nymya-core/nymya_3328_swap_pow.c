@@ -92,9 +92,9 @@ int nymya_3328_swap_pow(struct nymya_qubit *kq1, struct nymya_qubit *kq2, int64_
     // Calculate fixed-point angle: alpha * (PI / 2)
     int64_t angle_fp = fixed_point_mul(alpha_fp, FIXED_POINT_PI_DIV_2);
 
-    // Calculate fixed-point cosine and sine values using wrappers from nymya.h
-    int64_t c_fp = fixed_cos(angle_fp);
-    int64_t s_fp = fixed_sin(angle_fp);
+    // Calculate fixed-point cosine and sine values in one lookup
+    int64_t c_fp, s_fp;
+    fixed_point_sincos(angle_fp, NYMYA_TRIG_TIER, &s_fp, &c_fp);
 
     // Get current amplitudes in fixed-point complex_double format
     complex_double a = kq1->amplitude;
@@ -137,7 +137,7 @@ EXPORT_SYMBOL_GPL(nymya_3328_swap_pow);
  * - -EINVAL if any user pointer is invalid.
  * - -EFAULT if copying data to/from user space fails.
  */
-SYSCALL_DEFINE3(nymya_3328_swap_pow,
+NYMYA_SYSCALL_DEFINE3(3328, nymya_3328_swap_pow,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     int64_t, alpha_fp) { // alpha is now fixed-point
@@ -151,24 +151,24 @@ SYSCALL_DEFINE3(nymya_3328_swap_pow,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3328, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3328_swap_pow: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3328, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3328_swap_pow: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
 
     // Call the core logic function
-    nymya_3328_swap_pow(&k_q1, &k_q2, alpha_fp);
+    NYMYA_TRACE_CORE(3328, k_q1.id, k_q2.id, nymya_3328_swap_pow(&k_q1, &k_q2, alpha_fp));
 
     // 3. Copy modified qubit data back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3328, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3328_swap_pow: Failed to copy k_q1 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3328, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3328_swap_pow: Failed to copy k_q2 to user space\n");
         return -EFAULT;
     }
@@ -123,7 +123,7 @@ EXPORT_SYMBOL_GPL(nymya_3329_fredkin);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from the core logic if it fails (not currently expected for this gate).
  */
-SYSCALL_DEFINE3(nymya_3329_fredkin,
+NYMYA_SYSCALL_DEFINE3(3329, nymya_3329_fredkin,
     struct nymya_qubit __user *, user_q_ctrl,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
@@ -138,32 +138,32 @@ SYSCALL_DEFINE3(nymya_3329_fredkin,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q_ctrl, user_q_ctrl, sizeof(k_q_ctrl))) {
+    if (nymya_copy_from_user(3329, &k_q_ctrl, user_q_ctrl, sizeof(k_q_ctrl))) {
         pr_err("nymya_3329_fredkin: Failed to copy k_q_ctrl from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3329, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3329_fredkin: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3329, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3329_fredkin: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
 
     // Call the core Fredkin gate logic function
-    ret = nymya_3329_fredkin(&k_q_ctrl, &k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3329, k_q_ctrl.id, k_q1.id, nymya_3329_fredkin(&k_q_ctrl, &k_q1, &k_q2));
     if (ret) {
         pr_err("nymya_3329_fredkin: Core logic failed with error %d\n", ret);
         return ret;
     }
 
     // 3. Copy modified qubit data back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3329, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3329_fredkin: Failed to copy k_q1 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3329, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3329_fredkin: Failed to copy k_q2 to user space\n");
         return -EFAULT;
     }
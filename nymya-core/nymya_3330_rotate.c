@@ -135,7 +135,7 @@ EXPORT_SYMBOL_GPL(nymya_3330_rotate);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from the core rotation function (e.g., -EINVAL for unknown axis).
  */
-SYSCALL_DEFINE3(nymya_3330_rotate,
+NYMYA_SYSCALL_DEFINE3(3330, nymya_3330_rotate,
     struct nymya_qubit __user *, user_q,
     char, axis,
     int64_t, theta_fp) { // Changed theta to fixed-point (int64_t)
@@ -150,16 +150,16 @@ SYSCALL_DEFINE3(nymya_3330_rotate,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q, user_q, sizeof(k_q))) {
+    if (nymya_copy_from_user(3330, &k_q, user_q, sizeof(k_q))) {
         pr_err("nymya_3330_rotate: Failed to copy k_q from user space\n");
         return -EFAULT;
     }
 
     // 3. Call the core rotation logic
-    ret = nymya_3330_rotate(&k_q, axis, theta_fp);
+    ret = NYMYA_TRACE_CORE(3330, k_q.id, 0, nymya_3330_rotate(&k_q, axis, theta_fp));
 
     // 4. Copy modified qubit data back to user space
-    if (copy_to_user(user_q, &k_q, sizeof(k_q))) {
+    if (nymya_copy_to_user(3330, user_q, &k_q, sizeof(k_q))) {
         pr_err("nymya_3330_rotate: Failed to copy k_q to user space\n");
         return -EFAULT;
     }
@@ -121,7 +121,7 @@ EXPORT_SYMBOL_GPL(nymya_3331_barenco);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying gate operations.
  */
-SYSCALL_DEFINE3(nymya_3331_barenco,
+NYMYA_SYSCALL_DEFINE3(3331, nymya_3331_barenco,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     struct nymya_qubit __user *, user_q3) {
@@ -136,31 +136,31 @@ SYSCALL_DEFINE3(nymya_3331_barenco,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3331, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3331_barenco: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3331, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3331_barenco: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q3, user_q3, sizeof(k_q3))) {
+    if (nymya_copy_from_user(3331, &k_q3, user_q3, sizeof(k_q3))) {
         pr_err("nymya_3331_barenco: Failed to copy k_q3 from user space\n");
         return -EFAULT;
     }
 
     // 3. Apply the Barenco gate using the kernel-space core function
-    ret = nymya_3331_barenco(&k_q1, &k_q2, &k_q3);
+    ret = NYMYA_TRACE_CORE(3331, k_q1.id, k_q2.id, nymya_3331_barenco(&k_q1, &k_q2, &k_q3));
 
     // 4. Log event and copy data back to user space if successful
     if (ret == 0) {
         log_symbolic_event("BARENCO", k_q1.id, k_q1.tag, "Barenco composite applied");
 
-        if (copy_to_user(user_q1, &k_q1, sizeof(k_q1)))
+        if (nymya_copy_to_user(3331, user_q1, &k_q1, sizeof(k_q1)))
             return -EFAULT;
-        if (copy_to_user(user_q2, &k_q2, sizeof(k_q2)))
+        if (nymya_copy_to_user(3331, user_q2, &k_q2, sizeof(k_q2)))
             return -EFAULT;
-        if (copy_to_user(user_q3, &k_q3, sizeof(k_q3)))
+        if (nymya_copy_to_user(3331, user_q3, &k_q3, sizeof(k_q3)))
             return -EFAULT;
     } else {
         pr_err("nymya_3331_barenco: Kernel Barenco operation failed with error %d\n", ret);
@@ -134,7 +134,7 @@ EXPORT_SYMBOL_GPL(nymya_3332_berkeley);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying gate operations.
  */
-SYSCALL_DEFINE3(nymya_3332_berkeley,
+NYMYA_SYSCALL_DEFINE3(3332, nymya_3332_berkeley,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     int64_t, theta_fp) {
@@ -149,24 +149,24 @@ SYSCALL_DEFINE3(nymya_3332_berkeley,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3332, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3332_berkeley_syscall: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3332, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3332_berkeley_syscall: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
 
     // 3. Call the refactored kernel-space core function
-    ret = nymya_3332_berkeley(&k_q1, &k_q2, theta_fp);
+    ret = NYMYA_TRACE_CORE(3332, k_q1.id, k_q2.id, nymya_3332_berkeley(&k_q1, &k_q2, theta_fp));
 
     // 4. Copy data back to user space if successful
     if (ret == 0) {
-        if (copy_to_user(user_q1, &k_q1, sizeof(k_q1)))
+        if (nymya_copy_to_user(3332, user_q1, &k_q1, sizeof(k_q1)))
             return -EFAULT;
 
-        if (copy_to_user(user_q2, &k_q2, sizeof(k_q2)))
+        if (nymya_copy_to_user(3332, user_q2, &k_q2, sizeof(k_q2)))
             return -EFAULT;
     } else {
         pr_err("nymya_3332_berkeley_syscall: Kernel Berkeley operation failed with error %d\n", ret);
@@ -113,7 +113,7 @@ EXPORT_SYMBOL_GPL(nymya_3333_c_v);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying core gate operations.
  */
-SYSCALL_DEFINE2(nymya_3333_c_v,
+NYMYA_SYSCALL_DEFINE2(3333, nymya_3333_c_v,
     struct nymya_qubit __user *, user_qc,
     struct nymya_qubit __user *, user_qt) {
 
@@ -127,20 +127,20 @@ SYSCALL_DEFINE2(nymya_3333_c_v,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_qc, user_qc, sizeof(k_qc))) {
+    if (nymya_copy_from_user(3333, &k_qc, user_qc, sizeof(k_qc))) {
         pr_err("nymya_3333_c_v: Failed to copy k_qc from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_qt, user_qt, sizeof(k_qt))) {
+    if (nymya_copy_from_user(3333, &k_qt, user_qt, sizeof(k_qt))) {
         pr_err("nymya_3333_c_v: Failed to copy k_qt from user space\n");
         return -EFAULT;
     }
 
     // 3. Call the core logic function with kernel-space copies
-    ret = nymya_3333_c_v(&k_qc, &k_qt);
+    ret = NYMYA_TRACE_CORE(3333, k_qc.id, k_qt.id, nymya_3333_c_v(&k_qc, &k_qt));
 
     // 4. Copy modified target qubit data back to user space
-    if (copy_to_user(user_qt, &k_qt, sizeof(k_qt))) {
+    if (nymya_copy_to_user(3333, user_qt, &k_qt, sizeof(k_qt))) {
         pr_err("nymya_3333_c_v: Failed to copy k_qt to user space\n");
         return -EFAULT;
     }
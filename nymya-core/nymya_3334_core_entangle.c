@@ -104,7 +104,7 @@ EXPORT_SYMBOL_GPL(nymya_3334_core_entangle);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from the core logic function (nymya_3334_core_entangle).
  */
-SYSCALL_DEFINE2(nymya_3334_core_entangle,
+NYMYA_SYSCALL_DEFINE2(3334, nymya_3334_core_entangle,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -118,28 +118,28 @@ SYSCALL_DEFINE2(nymya_3334_core_entangle,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3334, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3334_core_entangle: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3334, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3334_core_entangle: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
 
     // 3. Call the core entanglement logic
-    ret = nymya_3334_core_entangle(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3334, k_q1.id, k_q2.id, nymya_3334_core_entangle(&k_q1, &k_q2));
     if (ret) {
         // Error already logged by the core function
         return ret;
     }
 
     // 4. Copy modified qubit data back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3334, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3334_core_entangle: Failed to copy k_q1 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3334, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3334_core_entangle: Failed to copy k_q2 to user space\n");
         return -EFAULT;
     }
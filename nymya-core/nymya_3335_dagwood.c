@@ -135,7 +135,7 @@ EXPORT_SYMBOL_GPL(nymya_3335_dagwood);
  * - Error code from underlying gate operations (e.g., nymya_3313_swap),
  *   if the core logic was executed and failed.
  */
-SYSCALL_DEFINE3(nymya_3335_dagwood,
+NYMYA_SYSCALL_DEFINE3(3335, nymya_3335_dagwood,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     struct nymya_qubit __user *, user_q3) {
@@ -150,21 +150,21 @@ SYSCALL_DEFINE3(nymya_3335_dagwood,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3335, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3335_dagwood: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3335, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3335_dagwood: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q3, user_q3, sizeof(k_q3))) {
+    if (nymya_copy_from_user(3335, &k_q3, user_q3, sizeof(k_q3))) {
         pr_err("nymya_3335_dagwood: Failed to copy k_q3 from user space\n");
         return -EFAULT;
     }
 
     // 3. Call the newly created core function
-    ret = nymya_3335_dagwood(&k_q1, &k_q2, &k_q3);
+    ret = NYMYA_TRACE_CORE(3335, k_q1.id, k_q2.id, nymya_3335_dagwood(&k_q1, &k_q2, &k_q3));
 
     // Check if the core logic (specifically, the swap if performed) returned an error
     if (ret != 0) {
@@ -176,15 +176,15 @@ SYSCALL_DEFINE3(nymya_3335_dagwood,
     // Note: k_q1 (control qubit) is typically not modified by Fredkin/Dagwood,
     // so it doesn't strictly need to be copied back unless its state *could* change.
     // However, copying it back is safer if there's any ambiguity or future changes.
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3335, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3335_dagwood: Failed to copy k_q1 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3335, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3335_dagwood: Failed to copy k_q2 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q3, &k_q3, sizeof(k_q3))) {
+    if (nymya_copy_to_user(3335, user_q3, &k_q3, sizeof(k_q3))) {
         pr_err("nymya_3335_dagwood: Failed to copy k_q3 to user space\n");
         return -EFAULT;
     }
@@ -110,7 +110,7 @@ EXPORT_SYMBOL_GPL(nymya_3336_echo_cr);
  * - -EINVAL if any user pointer is invalid.
  * - -EFAULT if copying data to/from user space fails.
  */
-SYSCALL_DEFINE3(nymya_3336_echo_cr,
+NYMYA_SYSCALL_DEFINE3(3336, nymya_3336_echo_cr,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     int64_t, theta_fp) { // Theta is now fixed-point
@@ -125,17 +125,17 @@ SYSCALL_DEFINE3(nymya_3336_echo_cr,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3336, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3336_echo_cr: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3336, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3336_echo_cr: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
 
     // 3. Call the core Echo CR logic function with kernel-space copies
-    ret = nymya_3336_echo_cr(&k_q1, &k_q2, theta_fp);
+    ret = NYMYA_TRACE_CORE(3336, k_q1.id, k_q2.id, nymya_3336_echo_cr(&k_q1, &k_q2, theta_fp));
     if (ret) {
         // Propagate error from core function if it ever returns one
         pr_err("nymya_3336_echo_cr: Core logic failed with error %d\n", ret);
@@ -143,11 +143,11 @@ SYSCALL_DEFINE3(nymya_3336_echo_cr,
     }
 
     // 4. Copy modified qubit data back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3336, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3336_echo_cr: Failed to copy k_q1 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3336, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3336_echo_cr: Failed to copy k_q2 to user space\n");
         return -EFAULT;
     }
@@ -128,7 +128,7 @@ EXPORT_SYMBOL_GPL(nymya_3337_fermion_sim);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying gate operations (e.g., nymya_3313_swap).
  */
-SYSCALL_DEFINE2(nymya_3337_fermion_sim,
+NYMYA_SYSCALL_DEFINE2(3337, nymya_3337_fermion_sim,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -142,17 +142,17 @@ SYSCALL_DEFINE2(nymya_3337_fermion_sim,
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3337, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3337_fermion_sim: Failed to copy k_q1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3337, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3337_fermion_sim: Failed to copy k_q2 from user\n");
         return -EFAULT; // Bad address
     }
 
     // 3. Call the core fermionic simulation logic
-    ret = nymya_3337_fermion_sim(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3337, k_q1.id, k_q2.id, nymya_3337_fermion_sim(&k_q1, &k_q2));
 
     if (ret) {
         // Error already logged by core function or underlying swap
@@ -160,11 +160,11 @@ SYSCALL_DEFINE2(nymya_3337_fermion_sim,
     }
 
     // 4. Copy the modified qubits back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3337, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3337_fermion_sim: Failed to copy k_q1 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3337, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3337_fermion_sim: Failed to copy k_q2 to user\n");
         ret = -EFAULT; // Bad address
     }
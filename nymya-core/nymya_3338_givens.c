@@ -78,9 +78,9 @@ int nymya_3338_givens(nymya_qubit* q1, nymya_qubit* q2, double theta) {
  *    but a non-zero return value could be used for future error propagation.)
  */
 int nymya_3338_givens(struct nymya_qubit *kq1, struct nymya_qubit *kq2, int64_t theta_fp) {
-    // Get fixed-point cosine and sine values from nymya.h wrappers
-    int64_t cos_theta_fp = fixed_cos(theta_fp);
-    int64_t sin_theta_fp = fixed_sin(theta_fp);
+    // Get fixed-point cosine and sine values in one lookup
+    int64_t cos_theta_fp, sin_theta_fp;
+    fixed_point_sincos(theta_fp, NYMYA_TRIG_TIER, &sin_theta_fp, &cos_theta_fp);
 
     // Let a = kq1->amplitude and b = kq2->amplitude
     // new_a = a * cos(theta) - b * sin(theta)
@@ -128,7 +128,7 @@ EXPORT_SYMBOL_GPL(nymya_3338_givens);
  * - -EINVAL if any user pointer is invalid.
  * - -EFAULT if copying data to/from user space fails.
  */
-SYSCALL_DEFINE3(nymya_3338_givens,
+NYMYA_SYSCALL_DEFINE3(3338, nymya_3338_givens,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     int64_t, theta_fp) { // Theta is now fixed-point
@@ -143,17 +143,17 @@ SYSCALL_DEFINE3(nymya_3338_givens,
     }
 
     // 2. Copy qubit data from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3338, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3338_givens: Failed to copy k_q1 from user space\n");
         return -EFAULT;
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3338, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3338_givens: Failed to copy k_q2 from user space\n");
         return -EFAULT;
     }
 
     // 3. Call the core Givens rotation logic
-    ret = nymya_3338_givens(&k_q1, &k_q2, theta_fp);
+    ret = NYMYA_TRACE_CORE(3338, k_q1.id, k_q2.id, nymya_3338_givens(&k_q1, &k_q2, theta_fp));
     if (ret) {
         // Propagate any error from the core logic if it ever returns one
         pr_err("nymya_3338_givens: Core logic failed with error %d\n", ret);
@@ -161,11 +161,11 @@ SYSCALL_DEFINE3(nymya_3338_givens,
     }
 
     // 4. Copy modified qubit data back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3338, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3338_givens: Failed to copy k_q1 to user space\n");
         return -EFAULT;
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3338, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3338_givens: Failed to copy k_q2 to user space\n");
         return -EFAULT;
     }
@@ -21,6 +21,31 @@
     #include <stdlib.h>  // Userland: For general utilities
     #include <math.h>    // Userland: For complex math functions
     #include <complex.h> // Userland: For _Complex double type
+
+/**
+ * nymya_3339_magic - Applies the Magic gate to two qubits (userland).
+ * @q1: Pointer to the first qubit.
+ * @q2: Pointer to the second qubit.
+ *
+ * Same decomposition as the kernel version: Hadamard and S on q1, CNOT with
+ * q1 as control, then Hadamard on q1 again.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -1 if any qubit pointer is NULL (invalid input).
+ */
+int nymya_3339_magic(nymya_qubit* q1, nymya_qubit* q2) {
+    if (!q1 || !q2) return -1;
+
+    nymya_3308_hadamard_gate(q1);
+    nymya_3306_phase_gate(q1);
+    nymya_3309_controlled_not(q1, q2);
+    nymya_3308_hadamard_gate(q1);
+
+    log_symbolic_event("MAGIC", q1->id, q1->tag, "Magic gate applied");
+    return 0;
+}
+
 #else
     #include <linux/kernel.h>   // Kernel: For pr_err and general kernel functions
     #include <linux/syscalls.h> // Kernel: For SYSCALL_DEFINE macros
@@ -94,7 +119,7 @@ EXPORT_SYMBOL_GPL(nymya_3339_magic);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying gate operations (e.g., nymya_3308_hadamard_gate).
  */
-SYSCALL_DEFINE2(nymya_3339_magic,
+NYMYA_SYSCALL_DEFINE2(3339, nymya_3339_magic,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -108,28 +133,28 @@ SYSCALL_DEFINE2(nymya_3339_magic,
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3339, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3339_magic: Failed to copy k_q1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3339, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3339_magic: Failed to copy k_q2 from user\n");
         return -EFAULT; // Bad address
     }
 
     // 3. Apply the Magic gate logic using the new core function
-    ret = nymya_3339_magic(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3339, k_q1.id, k_q2.id, nymya_3339_magic(&k_q1, &k_q2));
     if (ret) {
         // Error already logged by the core function
         return ret;
     }
 
     // 4. Copy the modified qubits back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3339, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3339_magic: Failed to copy k_q1 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3339, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3339_magic: Failed to copy k_q2 to user\n");
         ret = -EFAULT; // Bad address
     }
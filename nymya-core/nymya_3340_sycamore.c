@@ -85,11 +85,8 @@ int nymya_3340_sycamore(struct nymya_qubit *k_q1, struct nymya_qubit *k_q2) {
         return ret;
     }
 
-    // Convert M_PI / 6.0 to fixed-point for nymya_3317_controlled_phase
-    // M_PI / 6.0 is approximately 0.5235987756 radians
-    // Convert to fixed-point: (int64_t)(0.5235987756 * FIXED_POINT_SCALE)
-    int64_t phase_angle_fp = (int64_t)(0.5235987756 * FIXED_POINT_SCALE);
-    ret = nymya_3317_controlled_phase(k_q1, k_q2, phase_angle_fp); // Apply Controlled-Phase gate
+    // Controlled phase of pi/6, with e^(i*pi/6) taken from the gate table
+    ret = nymya_3317_controlled_phase_unitary(k_q1, k_q2, NYMYA_UNITARY(NYMYA_SYCAMORE_CODE));
     if (ret) {
         pr_err("nymya_3340_sycamore: controlled_phase failed, error %d\n", ret);
         return ret;
@@ -120,7 +117,7 @@ EXPORT_SYMBOL_GPL(nymya_3340_sycamore);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying core logic (e.g., nymya_3340_sycamore).
  */
-SYSCALL_DEFINE2(nymya_3340_sycamore,
+NYMYA_SYSCALL_DEFINE2(3340, nymya_3340_sycamore,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -134,28 +131,28 @@ SYSCALL_DEFINE2(nymya_3340_sycamore,
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3340, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3340_sycamore: Failed to copy k_q1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3340, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3340_sycamore: Failed to copy k_q2 from user\n");
         return -EFAULT; // Bad address
     }
 
     // 3. Apply the Sycamore gate logic using the extracted kernel function
-    ret = nymya_3340_sycamore(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3340, k_q1.id, k_q2.id, nymya_3340_sycamore(&k_q1, &k_q2));
     if (ret) {
         pr_err("nymya_3340_sycamore: Core logic failed with error %d\n", ret);
         return ret;
     }
 
     // 4. Copy the modified qubits back to user space
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3340, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3340_sycamore: Failed to copy k_q1 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3340, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3340_sycamore: Failed to copy k_q2 to user\n");
         ret = -EFAULT; // Bad address
     }
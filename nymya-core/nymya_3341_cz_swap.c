@@ -113,7 +113,7 @@ EXPORT_SYMBOL_GPL(nymya_3341_cz_swap);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from the underlying kernel-space `nymya_3341_cz_swap` function.
  */
-SYSCALL_DEFINE2(nymya_3341_cz_swap,
+NYMYA_SYSCALL_DEFINE2(3341, nymya_3341_cz_swap,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
 
@@ -127,17 +127,17 @@ SYSCALL_DEFINE2(nymya_3341_cz_swap,
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3341, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3341_cz_swap: Failed to copy k_q1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3341, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3341_cz_swap: Failed to copy k_q2 from user\n");
         return -EFAULT; // Bad address
     }
 
     // 3. Apply the CZ-SWAP gate logic using the extracted kernel-space function
-    ret = nymya_3341_cz_swap(&k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3341, k_q1.id, k_q2.id, nymya_3341_cz_swap(&k_q1, &k_q2));
     if (ret) {
         // Error already logged by the core nymya_3341_cz_swap function
         return ret;
@@ -145,11 +145,11 @@ SYSCALL_DEFINE2(nymya_3341_cz_swap,
 
     // 4. Copy the modified qubits back to user space
     // Note: k_q1 and k_q2 are both modified by CZ and SWAP, so both need to be copied back.
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3341, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3341_cz_swap: Failed to copy k_q1 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3341, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3341_cz_swap: Failed to copy k_q2 to user\n");
         ret = -EFAULT; // Bad address
     }
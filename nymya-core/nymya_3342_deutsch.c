@@ -2,11 +2,84 @@
 //
 // This file implements the Deutsch algorithm extension for Nymya syscalls.
 // The core function applies Hadamard gates around a user-supplied oracle function.
+// An oracle can also be compiled into a nymya_oracle gate program, from a
+// truth table or a gate sequence; nymya_3342_deutsch_oracle() then runs the
+// whole algorithm as one gate batch, in the kernel as well as in userland.
 
 #include "nymya.h" // Declarations for nymya_qubit, nymya_3308_hadamard_gate, log_symbolic_event, and core prototype
 
 #ifndef __KERNEL__
 #include <errno.h>
+#include <string.h>
+#else
+#include <linux/errno.h>
+#include <linux/string.h>
+#endif
+
+// Qubits an oracle program acts on: the input and the target
+#define NYMYA_ORACLE_QUBITS 2
+
+// One two-operand record; @gate's other fields zero
+static void nymya_oracle_put(nymya_oracle *o, uint32_t gate, uint32_t a, uint32_t b) {
+    memset(&o->ops[o->count], 0, sizeof(o->ops[0]));
+    o->ops[o->count].gate_code = gate;
+    o->ops[o->count].qubit[0] = a;
+    o->ops[o->count].qubit[1] = b;
+    o->count++;
+}
+
+// Table compilation shared by both builds; 0 or -EINVAL
+static int nymya_oracle_table(nymya_oracle *o, unsigned int table) {
+    if (!o || table > 0x3) return -EINVAL;
+
+    memset(o, 0, sizeof(*o));
+    switch (table) {
+    case 0x3: // f(x) = 1
+        nymya_oracle_put(o, NYMYA_PAULI_X_CODE, 1, 0);
+        break;
+    case 0x2: // f(x) = x
+        nymya_oracle_put(o, NYMYA_CNOT_CODE, 0, 1);
+        break;
+    case 0x1: // f(x) = NOT x
+        nymya_oracle_put(o, NYMYA_ACNOT_CODE, 0, 1);
+        break;
+    }
+    return 0;
+}
+
+// Sequence compilation shared by both builds; 0 or -EINVAL
+static int nymya_oracle_seq(nymya_oracle *o, const nymya_op *ops, size_t count) {
+    if (!o || (!ops && count)) return -EINVAL;
+
+    memset(o, 0, sizeof(*o));
+    for (size_t i = 0; i < count; i++) {
+        const nymya_gate_desc *d = nymya_gate_lookup(ops[i].gate_code);
+
+        if (!d || !d->operands || ops[i].reserved) return -EINVAL;
+        for (unsigned int k = 0; k < d->operands; k++) {
+            if (ops[i].qubit[k] >= NYMYA_ORACLE_QUBITS) return -EINVAL;
+            if (k && ops[i].qubit[k] == ops[i].qubit[0]) return -EINVAL;
+        }
+        if (ops[i].gate_code == NYMYA_IDENTITY_GATE_CODE) continue;
+        if (o->count == NYMYA_ORACLE_MAX_OPS) return -EINVAL;
+        o->ops[o->count++] = ops[i];
+    }
+    return 0;
+}
+
+// H on the input, the oracle, H on the input; 0 or -EINVAL
+static int nymya_oracle_program(const nymya_oracle *f, nymya_op *prog, size_t *count) {
+    if (!f || f->reserved || f->count > NYMYA_ORACLE_MAX_OPS) return -EINVAL;
+
+    memset(&prog[0], 0, sizeof(prog[0]));
+    prog[0].gate_code = NYMYA_HADAMARD_CODE;
+    memcpy(&prog[1], f->ops, f->count * sizeof(f->ops[0]));
+    prog[f->count + 1] = prog[0];
+    *count = f->count + 2;
+    return 0;
+}
+
+#ifndef __KERNEL__
 #include <stdio.h>
 
 /**
@@ -31,8 +104,57 @@ int nymya_3342_deutsch(nymya_qubit* q1, nymya_qubit* q2, void (*f)(nymya_qubit*)
     return 0;
 }
 
+int nymya_oracle_from_table(nymya_oracle *o, unsigned int table) {
+    int ret = nymya_oracle_table(o, table);
+
+    if (ret) {
+        errno = -ret;
+        return -1;
+    }
+    return 0;
+}
+
+int nymya_oracle_compile(nymya_oracle *o, const nymya_op *ops, size_t count) {
+    int ret = nymya_oracle_seq(o, ops, count);
+
+    if (ret) {
+        errno = -ret;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * nymya_3342_deutsch_oracle - Deutsch algorithm on a compiled oracle (userland)
+ * @q1: first qubit (input/output)
+ * @q2: second qubit (oracle target)
+ * @f:  compiled oracle
+ *
+ * The qubits are copied into a pair for nymya_3362_submit() and back once
+ * the batch has run. Returns 0, or -1 with errno set.
+ */
+int nymya_3342_deutsch_oracle(nymya_qubit *q1, nymya_qubit *q2, const nymya_oracle *f) {
+    nymya_op prog[NYMYA_ORACLE_MAX_OPS + 2];
+    nymya_qubit pair[NYMYA_ORACLE_QUBITS];
+    size_t count;
+    int ret;
+
+    if (!q1 || !q2 || q1 == q2 || nymya_oracle_program(f, prog, &count)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pair[0] = *q1;
+    pair[1] = *q2;
+    ret = nymya_3362_submit(prog, count, pair, NYMYA_ORACLE_QUBITS);
+    if (ret) return ret;
+    *q1 = pair[0];
+    *q2 = pair[1];
+    log_symbolic_event("DEUTSCH", q1->id, q1->tag, "Deutsch gate applied");
+    return 0;
+}
+
 #else // __KERNEL__
-#include <linux/errno.h>
 #include <linux/printk.h>
 #include <linux/module.h>
 
@@ -60,5 +182,45 @@ int nymya_3342_deutsch(struct nymya_qubit *q1, struct nymya_qubit *q2, void (*f)
 }
 EXPORT_SYMBOL_GPL(nymya_3342_deutsch);
 
+int nymya_oracle_from_table(nymya_oracle *o, unsigned int table) {
+    return nymya_oracle_table(o, table);
+}
+EXPORT_SYMBOL_GPL(nymya_oracle_from_table);
+
+int nymya_oracle_compile(nymya_oracle *o, const nymya_op *ops, size_t count) {
+    return nymya_oracle_seq(o, ops, count);
+}
+EXPORT_SYMBOL_GPL(nymya_oracle_compile);
+
+/**
+ * nymya_3342_deutsch_oracle - Deutsch algorithm on a compiled oracle (kernel)
+ * @q1: first qubit
+ * @q2: second qubit (oracle target)
+ * @f:  compiled oracle
+ *
+ * Runs through nymya_3362_submit_core(), so no caller-supplied code runs in
+ * the kernel. Returns 0, -EINVAL, or the batch's error.
+ */
+int nymya_3342_deutsch_oracle(struct nymya_qubit *q1, struct nymya_qubit *q2, const nymya_oracle *f) {
+    nymya_op prog[NYMYA_ORACLE_MAX_OPS + 2];
+    struct nymya_qubit pair[NYMYA_ORACLE_QUBITS];
+    size_t count;
+    int ret;
+
+    if (!q1 || !q2 || q1 == q2 || nymya_oracle_program(f, prog, &count))
+        return -EINVAL;
+
+    pair[0] = *q1;
+    pair[1] = *q2;
+    ret = nymya_3362_submit_core(prog, count, pair, NYMYA_ORACLE_QUBITS);
+    if (ret)
+        return ret;
+    *q1 = pair[0];
+    *q2 = pair[1];
+    log_symbolic_event("DEUTSCH", q1->id, q1->tag, "Deutsch gate applied");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3342_deutsch_oracle);
+
 #endif // __KERNEL__
 
@@ -148,7 +148,7 @@ EXPORT_SYMBOL_GPL(nymya_3343_margolis);
  * - -EINVAL if any user qubit pointer is NULL.
  * - -EFAULT if copying data to/from user space fails.
  */
-SYSCALL_DEFINE3(nymya_3343_margolis,
+NYMYA_SYSCALL_DEFINE3(3343, nymya_3343_margolis,
     struct nymya_qubit __user *, user_qc1,
     struct nymya_qubit __user *, user_qc2,
     struct nymya_qubit __user *, user_qt) {
@@ -163,21 +163,21 @@ SYSCALL_DEFINE3(nymya_3343_margolis,
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_qc1, user_qc1, sizeof(k_qc1))) {
+    if (nymya_copy_from_user(3343, &k_qc1, user_qc1, sizeof(k_qc1))) {
         pr_err("nymya_3343_margolis: Failed to copy k_qc1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_qc2, user_qc2, sizeof(k_qc2))) {
+    if (nymya_copy_from_user(3343, &k_qc2, user_qc2, sizeof(k_qc2))) {
         pr_err("nymya_3343_margolis: Failed to copy k_qc2 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_qt, user_qt, sizeof(k_qt))) {
+    if (nymya_copy_from_user(3343, &k_qt, user_qt, sizeof(k_qt))) {
         pr_err("nymya_3343_margolis: Failed to copy k_qt from user\n");
         return -EFAULT; // Bad address
     }
 
     // 3. Call the core Margolis gate logic
-    ret = nymya_3343_margolis(&k_qc1, &k_qc2, &k_qt);
+    ret = NYMYA_TRACE_CORE(3343, k_qc1.id, k_qc2.id, nymya_3343_margolis(&k_qc1, &k_qc2, &k_qt));
 
     if (ret) {
         // Error already logged by core function
@@ -187,7 +187,7 @@ SYSCALL_DEFINE3(nymya_3343_margolis,
     // 4. Copy the modified target qubit back to user space
     // Control qubits (k_qc1, k_qc2) are typically not modified by Margolis gate,
     // so only k_qt needs to be copied back.
-    if (copy_to_user(user_qt, &k_qt, sizeof(k_qt))) {
+    if (nymya_copy_to_user(3343, user_qt, &k_qt, sizeof(k_qt))) {
         pr_err("nymya_3343_margolis: Failed to copy k_qt to user\n");
         ret = -EFAULT; // Bad address
     }
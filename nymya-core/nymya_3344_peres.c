@@ -130,7 +130,7 @@ EXPORT_SYMBOL_GPL(nymya_3344_peres_kernel_logic);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying gate operations (e.g., nymya_3309_controlled_not).
  */
-SYSCALL_DEFINE3(nymya_3344_peres,
+NYMYA_SYSCALL_DEFINE3(3344, nymya_3344_peres,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     struct nymya_qubit __user *, user_q3) {
@@ -145,21 +145,21 @@ SYSCALL_DEFINE3(nymya_3344_peres,
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3344, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3344_peres: Failed to copy k_q1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3344, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3344_peres: Failed to copy k_q2 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q3, user_q3, sizeof(k_q3))) {
+    if (nymya_copy_from_user(3344, &k_q3, user_q3, sizeof(k_q3))) {
         pr_err("nymya_3344_peres: Failed to copy k_q3 from user\n");
         return -EFAULT; // Bad address
     }
 
     // 3. Apply the Peres gate logic for kernel space using the new helper function
-    ret = nymya_3344_peres_kernel_logic(&k_q1, &k_q2, &k_q3);
+    ret = NYMYA_TRACE_CORE(3344, k_q1.id, k_q2.id, nymya_3344_peres_kernel_logic(&k_q1, &k_q2, &k_q3));
     if (ret) {
         pr_err("nymya_3344_peres: Core logic failed, error %d\n", ret);
         return ret;
@@ -167,15 +167,15 @@ SYSCALL_DEFINE3(nymya_3344_peres,
 
     // 5. Copy the modified qubits back to user space
     // Note: All three qubits can be modified by the composite gate, so all should be copied back.
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3344, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3344_peres: Failed to copy k_q1 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3344, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3344_peres: Failed to copy k_q2 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q3, &k_q3, sizeof(k_q3))) {
+    if (nymya_copy_to_user(3344, user_q3, &k_q3, sizeof(k_q3))) {
         pr_err("nymya_3344_peres: Failed to copy k_q3 to user\n");
         ret = -EFAULT; // Bad address
     }
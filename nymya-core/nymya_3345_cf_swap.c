@@ -152,7 +152,7 @@ EXPORT_SYMBOL_GPL(nymya_3345_cf_swap);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying gate operations (e.g., nymya_3337_fermion_sim).
  */
-SYSCALL_DEFINE3(nymya_3345_cf_swap,
+NYMYA_SYSCALL_DEFINE3(3345, nymya_3345_cf_swap,
     struct nymya_qubit __user *, user_qc,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2) {
@@ -167,21 +167,21 @@ SYSCALL_DEFINE3(nymya_3345_cf_swap,
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_qc, user_qc, sizeof(k_qc))) {
+    if (nymya_copy_from_user(3345, &k_qc, user_qc, sizeof(k_qc))) {
         pr_err("nymya_3345_cf_swap: Failed to copy k_qc from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3345, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3345_cf_swap: Failed to copy k_q1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3345, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3345_cf_swap: Failed to copy k_q2 from user\n");
         return -EFAULT; // Bad address
     }
 
     // 3. Call the core kernel function to apply the gate logic
-    ret = nymya_3345_cf_swap(&k_qc, &k_q1, &k_q2);
+    ret = NYMYA_TRACE_CORE(3345, k_qc.id, k_q1.id, nymya_3345_cf_swap(&k_qc, &k_q1, &k_q2));
     if (ret != 0) {
         // If the core logic failed, propagate its error code
         return ret;
@@ -190,11 +190,11 @@ SYSCALL_DEFINE3(nymya_3345_cf_swap,
     // 4. Copy the modified target qubits back to user space
     // Control qubit (k_qc) is typically not modified by Fredkin/CF-SWAP,
     // so only k_q1 and k_q2 need to be copied back.
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3345, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3345_cf_swap: Failed to copy k_q1 to user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3345, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3345_cf_swap: Failed to copy k_q2 to user\n");
         return -EFAULT; // Bad address
     }
@@ -10,6 +10,12 @@
 
 #include "nymya.h" // Common definitions like nymya_qubit, and gate macros
 
+// Hadamard on q1, then CNOTs around the triangle q1 -> q2 -> q3 -> q1
+static const uint16_t nymya_3346_h[] = { 0 };
+static const nymya_graph_edge nymya_3346_edges[] = { { 0, 1 }, { 1, 2 }, { 2, 0 } };
+static const nymya_graph nymya_3346_graph =
+    NYMYA_GRAPH_INIT("TRI_LATTICE", "Triangle lattice formed", 3, nymya_3346_h, nymya_3346_edges);
+
 #ifndef __KERNEL__
 #include <stdint.h>
 #include <errno.h>
@@ -48,18 +54,9 @@
  * - -1 if any qubit pointer is NULL (invalid input).
  */
 int nymya_3346_triangular_lattice(nymya_qubit* q1, nymya_qubit* q2, nymya_qubit* q3) {
-    // Basic null pointer checks
-    if (!q1 || !q2 || !q3) return -1;
-
-    // Apply the sequence of gates to simulate triangular lattice interaction
-    hadamard(q1);   // Hadamard on q1
-    cnot(q1, q2);   // CNOT with q1 as control, q2 as target
-    cnot(q2, q3);   // CNOT with q2 as control, q3 as target
-    cnot(q3, q1);   // CNOT with q3 as control, q1 as target
-
-    // Log the symbolic event for traceability
-    log_symbolic_event("TRI_LATTICE", q1->id, q1->tag, "Triangle lattice formed");
-    return 0;
+    nymya_qubit* q[3] = { q1, q2, q3 };
+
+    return nymya_graph_state(&nymya_3346_graph, q, 3);
 }
 
 #else // __KERNEL__
@@ -77,42 +74,15 @@ int nymya_3346_triangular_lattice(nymya_qubit* q1, nymya_qubit* q2, nymya_qubit*
  *
  * Returns:
  * - 0 on success.
+ * - -EINVAL if any qubit pointer is NULL.
  * - An error code (e.g., from nymya_3308_hadamard_gate or nymya_3309_controlled_not) on failure.
  */
 int nymya_3346_triangular_lattice(struct nymya_qubit *q1,
                                   struct nymya_qubit *q2,
                                   struct nymya_qubit *q3) {
-    int ret;
-
-    // Apply the sequence of gates to simulate triangular lattice interaction
-    ret = nymya_3308_hadamard_gate(q1); // Hadamard on q1
-    if (ret) {
-        pr_err("nymya_3346_triangular_lattice: Hadamard on q1 failed, error %d\n", ret);
-        return ret;
-    }
-
-    ret = nymya_3309_controlled_not(q1, q2); // CNOT(q1, q2)
-    if (ret) {
-        pr_err("nymya_3346_triangular_lattice: CNOT(q1, q2) failed, error %d\n", ret);
-        return ret;
-    }
-
-    ret = nymya_3309_controlled_not(q2, q3); // CNOT(q2, q3)
-    if (ret) {
-        pr_err("nymya_3346_triangular_lattice: CNOT(q2, q3) failed, error %d\n", ret);
-        return ret;
-    }
-
-    ret = nymya_3309_controlled_not(q3, q1); // CNOT(q3, q1)
-    if (ret) {
-        pr_err("nymya_3346_triangular_lattice: CNOT(q3, q1) failed, error %d\n", ret);
-        return ret;
-    }
-
-    // Log the symbolic event for traceability
-    log_symbolic_event("TRI_LATTICE", q1->id, q1->tag, "Triangle lattice formed");
+    struct nymya_qubit *q[3] = { q1, q2, q3 };
 
-    return 0; // Success
+    return nymya_graph_state(&nymya_3346_graph, q, 3);
 }
 EXPORT_SYMBOL_GPL(nymya_3346_triangular_lattice);
 
@@ -135,7 +105,7 @@ EXPORT_SYMBOL_GPL(nymya_3346_triangular_lattice);
  * - -EFAULT if copying data to/from user space fails.
  * - Error code from underlying gate operations (e.g., nymya_3308_hadamard_gate).
  */
-SYSCALL_DEFINE3(nymya_3346_triangular_lattice,
+NYMYA_SYSCALL_DEFINE3(3346, nymya_3346_triangular_lattice,
     struct nymya_qubit __user *, user_q1,
     struct nymya_qubit __user *, user_q2,
     struct nymya_qubit __user *, user_q3) {
@@ -150,21 +120,21 @@ SYSCALL_DEFINE3(nymya_3346_triangular_lattice,
     }
 
     // 2. Copy the qubit structures from user space to kernel space
-    if (copy_from_user(&k_q1, user_q1, sizeof(k_q1))) {
+    if (nymya_copy_from_user(3346, &k_q1, user_q1, sizeof(k_q1))) {
         pr_err("nymya_3346_triangular_lattice: Failed to copy k_q1 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q2, user_q2, sizeof(k_q2))) {
+    if (nymya_copy_from_user(3346, &k_q2, user_q2, sizeof(k_q2))) {
         pr_err("nymya_3346_triangular_lattice: Failed to copy k_q2 from user\n");
         return -EFAULT; // Bad address
     }
-    if (copy_from_user(&k_q3, user_q3, sizeof(k_q3))) {
+    if (nymya_copy_from_user(3346, &k_q3, user_q3, sizeof(k_q3))) {
         pr_err("nymya_3346_triangular_lattice: Failed to copy k_q3 from user\n");
         return -EFAULT; // Bad address
     }
 
     // 3. Call the core kernel-space logic
-    ret = nymya_3346_triangular_lattice(&k_q1, &k_q2, &k_q3);
+    ret = NYMYA_TRACE_CORE(3346, k_q1.id, k_q2.id, nymya_3346_triangular_lattice(&k_q1, &k_q2, &k_q3));
     if (ret) {
         // Error already logged by the core function
         return ret;
@@ -172,15 +142,15 @@ SYSCALL_DEFINE3(nymya_3346_triangular_lattice,
 
     // 4. Copy the modified qubits back to user space
     // All three qubits can be modified, so all should be copied back.
-    if (copy_to_user(user_q1, &k_q1, sizeof(k_q1))) {
+    if (nymya_copy_to_user(3346, user_q1, &k_q1, sizeof(k_q1))) {
         pr_err("nymya_3346_triangular_lattice: Failed to copy k_q1 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q2, &k_q2, sizeof(k_q2))) {
+    if (nymya_copy_to_user(3346, user_q2, &k_q2, sizeof(k_q2))) {
         pr_err("nymya_3346_triangular_lattice: Failed to copy k_q2 to user\n");
         ret = -EFAULT; // Bad address
     }
-    if (copy_to_user(user_q3, &k_q3, sizeof(k_q3))) {
+    if (nymya_copy_to_user(3346, user_q3, &k_q3, sizeof(k_q3))) {
         pr_err("nymya_3346_triangular_lattice: Failed to copy k_q3 to user\n");
         ret = -EFAULT; // Bad address
     }
@@ -9,6 +9,14 @@
 
 #include "nymya.h" // Common definitions like nymya_qubit, and gate macros
 
+// Hadamard on all six qubits, then CNOTs around the ring q[i] -> q[(i + 1) % 6]
+static const uint16_t nymya_3347_h[] = { 0, 1, 2, 3, 4, 5 };
+static const nymya_graph_edge nymya_3347_edges[] = {
+    { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 5 }, { 5, 0 },
+};
+static const nymya_graph nymya_3347_graph =
+    NYMYA_GRAPH_INIT("HEX_LATTICE", "Hexagonal ring lattice formed", 6, nymya_3347_h, nymya_3347_edges);
+
 #ifndef __KERNEL__
 #include <stdint.h>
 #include <errno.h>
@@ -46,25 +54,7 @@
  * - -1 if any qubit pointer in the array is NULL (invalid input).
  */
 int nymya_3347_hexagonal_lattice(nymya_qubit* q[6]) {
-    // Basic null pointer checks for each qubit in the array
-    for (int i = 0; i < 6; i++) {
-        if (!q[i]) return -1;
-    }
-
-    // Apply Hadamard gate to each qubit
-    for (int i = 0; i < 6; i++) {
-        hadamard(q[i]);
-    }
-
-    // Apply CNOT gates between adjacent qubits in a cyclic manner
-    for (int i = 0; i < 6; i++) {
-        cnot(q[i], q[(i + 1) % 6]);
-    }
-
-    // Log the symbolic event for traceability
-    // Using the ID and tag of the first qubit for logging purposes.
-    log_symbolic_event("HEX_LATTICE", q[0]->id, q[0]->tag, "Hexagonal ring lattice formed");
-    return 0;
+    return nymya_graph_state(&nymya_3347_graph, q, 6);
 }
 
 #else // __KERNEL__
@@ -82,32 +72,7 @@ int nymya_3347_hexagonal_lattice(nymya_qubit* q[6]) {
  *         operation fails (e.g., from nymya_3308_hadamard_gate or nymya_3309_controlled_not).
  */
 int nymya_3347_hexagonal_lattice(struct nymya_qubit *k_qubits[6]) {
-    int ret = 0;
-    int i;
-
-    // Apply Hadamard gate to each qubit
-    for (i = 0; i < 6; i++) {
-        ret = nymya_3308_hadamard_gate(k_qubits[i]);
-        if (ret) {
-            pr_err("nymya_3347_hexagonal_lattice: Hadamard on q[%d] failed, error %d\n", i, ret);
-            return ret;
-        }
-    }
-
-    // Apply CNOT gates between adjacent qubits in a cyclic manner
-    for (i = 0; i < 6; i++) {
-        ret = nymya_3309_controlled_not(k_qubits[i], k_qubits[(i + 1) % 6]);
-        if (ret) {
-            pr_err("nymya_3347_hexagonal_lattice: CNOT(q[%d], q[%d]) failed, error %d\n", i, (i + 1) % 6, ret);
-            return ret;
-        }
-    }
-
-    // Log the symbolic event for traceability
-    // Using the ID and tag of the first qubit for logging purposes.
-    log_symbolic_event("HEX_LATTICE", k_qubits[0]->id, k_qubits[0]->tag, "Hexagonal ring lattice formed");
-
-    return 0;
+    return nymya_graph_state(&nymya_3347_graph, k_qubits, 6);
 }
 
 EXPORT_SYMBOL_GPL(nymya_3347_hexagonal_lattice); // Export the core function
@@ -118,7 +83,7 @@ EXPORT_SYMBOL_GPL(nymya_3347_hexagonal_lattice); // Export the core function
  * (i.e., `struct nymya_qubit __user *[6]`)
  *
  * This syscall copies the array of user-space qubit pointers, then copies each
- * individual qubit structure from user space to kernel space. It applies the
+ * individual qubit structure into one contiguous kernel buffer. It applies the
  * hexagonal lattice gate logic using kernel-space functions (Hadamard and CNOT),
  * and finally copies the modified qubit data back to user space.
  *
@@ -129,88 +94,28 @@ EXPORT_SYMBOL_GPL(nymya_3347_hexagonal_lattice); // Export the core function
  * - -ENOMEM if kernel memory allocation fails.
  * - Error code from underlying gate operations (now propagated from nymya_3347_hexagonal_lattice).
  */
-SYSCALL_DEFINE1(nymya_3347_hexagonal_lattice,
+NYMYA_SYSCALL_DEFINE1(3347, nymya_3347_hexagonal_lattice,
     struct nymya_qubit __user * __user *, user_q_array) {
 
-    struct nymya_qubit *k_qubits[6]; // Array of pointers to kernel-space qubit data
-    // Array to hold the user-space pointers themselves, copied from user_q_array
-    struct nymya_qubit __user *user_qubit_ptrs[6];
-    int ret = 0; // Return value for syscall and gate operations
-    int i; // Loop counter
-
-    // Initialize k_qubits pointers to NULL for safe cleanup
-    for (i = 0; i < 6; i++) {
-        k_qubits[i] = NULL;
-    }
+    struct nymya_qubit_ptr_array arr;
+    int ret;
 
-    // 1. Check for null pointer for the array of pointers itself
     if (!user_q_array) {
         pr_err("nymya_3347_hexagonal_lattice: Null user_q_array pointer\n");
-        return -EINVAL; // Invalid argument
+        return -EINVAL;
     }
 
-    // 2. Copy the array of user-space qubit pointers from user space
-    // This copies the addresses of the user-space qubits, not the qubit data itself.
-    if (copy_from_user(user_qubit_ptrs, user_q_array, sizeof(user_qubit_ptrs))) {
-        pr_err("nymya_3347_hexagonal_lattice: Failed to copy user qubit pointers array\n");
-        return -EFAULT;
-    }
-
-    // 3. Allocate kernel memory for each qubit and copy individual qubit data from user space
-    for (i = 0; i < 6; i++) {
-        // Check if individual user-space qubit pointer is NULL
-        if (!user_qubit_ptrs[i]) {
-            pr_err("nymya_3347_hexagonal_lattice: Null individual user qubit pointer at index %d\n", i);
-            ret = -EINVAL;
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-
-        // Allocate memory for the kernel-space copy of the qubit
-        k_qubits[i] = kmalloc(sizeof(struct nymya_qubit), GFP_KERNEL);
-        if (!k_qubits[i]) {
-            pr_err("nymya_3347_hexagonal_lattice: Failed to allocate memory for k_qubit[%d]\n", i);
-            ret = -ENOMEM; // Out of memory
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-
-        // Copy the actual qubit data from user space into the allocated kernel memory
-        if (copy_from_user(k_qubits[i], user_qubit_ptrs[i], sizeof(struct nymya_qubit))) {
-            pr_err("nymya_3347_hexagonal_lattice: Failed to copy k_qubit[%d] data from user\n", i);
-            ret = -EFAULT; // Bad address
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-    }
+    // Copy the pointer array and all 6 qubits into one contiguous kernel buffer
+    ret = nymya_qubit_ptrs_from_user(&arr, user_q_array, 6, 3347, "nymya_3347_hexagonal_lattice");
+    if (ret)
+        return ret;
 
-    // Call the newly extracted core logic function
-    ret = nymya_3347_hexagonal_lattice(k_qubits);
-    if (ret) {
-        // Error from core logic, propagate it
-        goto cleanup_k_qubits;
-    }
-
-    // 6. Copy the modified qubits back to user space
-    // All six qubits can be modified, so all should be copied back.
-    for (i = 0; i < 6; i++) {
-        if (copy_to_user(user_qubit_ptrs[i], k_qubits[i], sizeof(struct nymya_qubit))) {
-            pr_err("nymya_3347_hexagonal_lattice: Failed to copy k_qubit[%d] to user\n", i);
-            // If previous ret was 0 (success), set it to -EFAULT.
-            // If it was already an error from the core logic, we keep that error.
-            if (ret == 0) {
-                ret = -EFAULT;
-            }
-        }
-    }
-
-cleanup_k_qubits:
-    // 7. Free all allocated kernel memory for qubits
-    for (int j = 0; j < 6; j++) {
-        if (k_qubits[j]) { // Only free if memory was successfully allocated
-            kfree(k_qubits[j]);
-            k_qubits[j] = NULL; // Prevent double free
-        }
-    }
+    ret = NYMYA_TRACE_CORE(3347, arr.k_qubits[0]->id, arr.k_qubits[1]->id, nymya_3347_hexagonal_lattice(arr.k_qubits));
+    if (!ret)
+        ret = nymya_qubit_ptrs_to_user(&arr, 3347, "nymya_3347_hexagonal_lattice");
 
-    return ret; // Return 0 on success, or error code if any operation failed
+    nymya_qubit_ptrs_free(&arr);
+    return ret;
 }
 
 #endif
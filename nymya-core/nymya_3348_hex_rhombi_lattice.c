@@ -10,6 +10,18 @@
 
 #include "nymya.h" // Common definitions like nymya_qubit, and gate macros
 
+// Hadamard on the six outer qubits; CNOTs from the centre q[0] to each, then
+// around every rhombus (q[i], q[i + 1], q[0]), the last one closing on q[1]
+static const uint16_t nymya_3348_h[] = { 1, 2, 3, 4, 5, 6 };
+static const nymya_graph_edge nymya_3348_edges[] = {
+    { 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 }, { 0, 5 }, { 0, 6 },
+    { 1, 2 }, { 2, 0 }, { 2, 3 }, { 3, 0 }, { 3, 4 }, { 4, 0 },
+    { 4, 5 }, { 5, 0 }, { 5, 6 }, { 6, 0 }, { 6, 1 }, { 1, 0 },
+};
+static const nymya_graph nymya_3348_graph =
+    NYMYA_GRAPH_INIT("HEX_RHOMBI", "Hexagon tessellated into 3 rhombi", 7,
+                     nymya_3348_h, nymya_3348_edges);
+
 #ifndef __KERNEL__
 #include <stdint.h>
 #include <errno.h>
@@ -49,32 +61,7 @@
  * - -1 if any qubit pointer in the array is NULL (invalid input).
  */
 int nymya_3348_hex_rhombi_lattice(nymya_qubit* q[7]) {
-    // Basic null pointer checks for each qubit in the array
-    for (int i = 0; i < 7; i++) {
-        if (!q[i]) return -1;
-    }
-
-    // Apply Hadamard to outer qubits (q[1] to q[6]) and entangle central qubit (q[0]) with them
-    for (int i = 1; i < 7; i++) {
-        hadamard(q[i]);     // Hadamard on outer qubit
-        cnot(q[0], q[i]);   // CNOT with central q[0] as control, q[i] as target
-    }
-
-    // Create rhombi by entangling adjacent outer qubits and connecting back to center
-    // Rhombi are formed by (q[i], q[i+1], q[0]).
-    // Loop from q[1]-q[2] up to q[5]-q[6]
-    for (int i = 1; i < 6; i++) {
-        cnot(q[i], q[i + 1]);   // CNOT between adjacent outer qubits
-        cnot(q[i + 1], q[0]);   // CNOT with outer qubit as control, central q[0] as target
-    }
-    // Complete the cycle for the last rhombus: (q[6], q[1], q[0])
-    cnot(q[6], q[1]);       // CNOT between q[6] and q[1]
-    cnot(q[1], q[0]);       // CNOT with q[1] as control, central q[0] as target
-
-    // Log the symbolic event for traceability
-    // Using the ID and tag of the central qubit for logging purposes.
-    log_symbolic_event("HEX_RHOMBI", q[0]->id, q[0]->tag, "Hexagon tessellated into 3 rhombi");
-    return 0;
+    return nymya_graph_state(&nymya_3348_graph, q, 7);
 }
 
 #else // __KERNEL__
@@ -97,55 +84,7 @@ int nymya_3348_hex_rhombi_lattice(nymya_qubit* q[7]) {
  *   nymya_3309_controlled_not) if any gate application fails.
  */
 int nymya_3348_hex_rhombi_lattice(struct nymya_qubit *k_qubits[7]) {
-    int ret = 0;
-    int i;
-
-    // Apply Hadamard to outer qubits (k_qubits[1] to k_qubits[6]) and entangle central qubit (k_qubits[0]) with them
-    for (i = 1; i < 7; i++) {
-        ret = nymya_3308_hadamard_gate(k_qubits[i]); // Hadamard on outer qubit
-        if (ret) {
-            pr_err("nymya_3348_hex_rhombi_lattice: Hadamard on q[%d] failed, error %d\n", i, ret);
-            return ret; // Propagate error
-        }
-        ret = nymya_3309_controlled_not(k_qubits[0], k_qubits[i]); // CNOT(central, outer)
-        if (ret) {
-            pr_err("nymya_3348_hex_rhombi_lattice: CNOT(q[0], q[%d]) failed, error %d\n", i, ret);
-            return ret; // Propagate error
-        }
-    }
-
-    // Create rhombi by entangling adjacent outer qubits and connecting back to center
-    // Rhombi are formed by (q[i], q[i+1], q[0]).
-    // Loop from q[1]-q[2] up to q[5]-q[6]
-    for (i = 1; i < 6; i++) {
-        ret = nymya_3309_controlled_not(k_qubits[i], k_qubits[i + 1]); // CNOT(adjacent outer)
-        if (ret) {
-            pr_err("nymya_3348_hex_rhombi_lattice: CNOT(q[%d], q[%d]) failed, error %d\n", i, i + 1, ret);
-            return ret; // Propagate error
-        }
-        ret = nymya_3309_controlled_not(k_qubits[i + 1], k_qubits[0]); // CNOT(outer, central)
-        if (ret) {
-            pr_err("nymya_3348_hex_rhombi_lattice: CNOT(q[%d], q[0]) failed, error %d\n", i + 1, ret);
-            return ret; // Propagate error
-        }
-    }
-    // Complete the cycle for the last rhombus: (q[6], q[1], q[0])
-    ret = nymya_3309_controlled_not(k_qubits[6], k_qubits[1]); // CNOT(q[6], q[1])
-    if (ret) {
-        pr_err("nymya_3348_hex_rhombi_lattice: CNOT(q[6], q[1]) failed, error %d\n", ret);
-        return ret; // Propagate error
-    }
-    ret = nymya_3309_controlled_not(k_qubits[1], k_qubits[0]); // CNOT(q[1], q[0])
-    if (ret) {
-        pr_err("nymya_3348_hex_rhombi_lattice: CNOT(q[1], q[0]) failed, error %d\n", ret);
-        return ret; // Propagate error
-    }
-
-    // Log the symbolic event for traceability
-    // Using the ID and tag of the central qubit for logging purposes.
-    log_symbolic_event("HEX_RHOMBI", k_qubits[0]->id, k_qubits[0]->tag, "Hexagon tessellated into 3 rhombi");
-
-    return 0; // Success
+    return nymya_graph_state(&nymya_3348_graph, k_qubits, 7);
 }
 EXPORT_SYMBOL_GPL(nymya_3348_hex_rhombi_lattice);
 
@@ -157,7 +96,7 @@ EXPORT_SYMBOL_GPL(nymya_3348_hex_rhombi_lattice);
  * (i.e., `struct nymya_qubit __user *[7]`)
  *
  * This syscall copies the array of user-space qubit pointers, then copies each
- * individual qubit structure from user space to kernel space. It calls the
+ * individual qubit structure into one contiguous kernel buffer. It calls the
  * kernel-side core function `nymya_3348_hex_rhombi_lattice` to apply the gate logic,
  * and finally copies the modified qubit data back to user space.
  *
@@ -168,86 +107,28 @@ EXPORT_SYMBOL_GPL(nymya_3348_hex_rhombi_lattice);
  * - -ENOMEM if kernel memory allocation fails.
  * - Error code propagated from the underlying gate operations.
  */
-SYSCALL_DEFINE1(nymya_3348_hex_rhombi_lattice,
+NYMYA_SYSCALL_DEFINE1(3348, nymya_3348_hex_rhombi_lattice,
     struct nymya_qubit __user * __user *, user_q_array) {
 
-    struct nymya_qubit *k_qubits[7]; // Array of pointers to kernel-space qubit data
-    // Array to hold the user-space pointers themselves, copied from user_q_array
-    struct nymya_qubit __user *user_qubit_ptrs[7];
-    int ret = 0; // Return value for syscall and gate operations
-    int i; // Loop counter
-
-    // Initialize k_qubits pointers to NULL for safe cleanup
-    for (i = 0; i < 7; i++) {
-        k_qubits[i] = NULL;
-    }
+    struct nymya_qubit_ptr_array arr;
+    int ret;
 
-    // 1. Check for null pointer for the array of pointers itself
     if (!user_q_array) {
-        pr_err("sys_nymya_3348_hex_rhombi_lattice: Null user_q_array pointer\n");
-        return -EINVAL; // Invalid argument
+        pr_err("nymya_3348_hex_rhombi_lattice: Null user_q_array pointer\n");
+        return -EINVAL;
     }
 
-    // 2. Copy the array of user-space qubit pointers from user space
-    // This copies the addresses of the user-space qubits, not the qubit data itself.
-    if (copy_from_user(user_qubit_ptrs, user_q_array, sizeof(user_qubit_ptrs))) {
-        pr_err("sys_nymya_3348_hex_rhombi_lattice: Failed to copy user qubit pointers array\n");
-        ret = -EFAULT;
-        goto cleanup_k_qubits;
-    }
-
-    // 3. Allocate kernel memory for each qubit and copy individual qubit data from user space
-    for (i = 0; i < 7; i++) {
-        // Check if individual user-space qubit pointer is NULL
-        if (!user_qubit_ptrs[i]) {
-            pr_err("sys_nymya_3348_hex_rhombi_lattice: Null individual user qubit pointer at index %d\n", i);
-            ret = -EINVAL;
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-
-        // Allocate memory for the kernel-space copy of the qubit
-        k_qubits[i] = kmalloc(sizeof(struct nymya_qubit), GFP_KERNEL);
-        if (!k_qubits[i]) {
-            pr_err("sys_nymya_3348_hex_rhombi_lattice: Failed to allocate memory for k_qubit[%d]\n", i);
-            ret = -ENOMEM; // Out of memory
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-
-        // Copy the actual qubit data from user space into the allocated kernel memory
-        if (copy_from_user(k_qubits[i], user_qubit_ptrs[i], sizeof(struct nymya_qubit))) {
-            pr_err("sys_nymya_3348_hex_rhombi_lattice: Failed to copy k_qubit[%d] data from user\n", i);
-            ret = -EFAULT; // Bad address
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-    }
+    // Copy the pointer array and all 7 qubits into one contiguous kernel buffer
+    ret = nymya_qubit_ptrs_from_user(&arr, user_q_array, 7, 3348, "nymya_3348_hex_rhombi_lattice");
+    if (ret)
+        return ret;
 
-    // 4. Call the core kernel function to apply the hexagonal-rhombic lattice logic
-    ret = nymya_3348_hex_rhombi_lattice(k_qubits);
-    if (ret) {
-        pr_err("sys_nymya_3348_hex_rhombi_lattice: Core logic failed with error %d\n", ret);
-        goto cleanup_k_qubits;
-    }
-
-    // 5. Copy the modified qubits back to user space
-    // All seven qubits can be modified, so all should be copied back.
-    for (i = 0; i < 7; i++) {
-        if (copy_to_user(user_qubit_ptrs[i], k_qubits[i], sizeof(struct nymya_qubit))) {
-            pr_err("sys_nymya_3348_hex_rhombi_lattice: Failed to copy k_qubit[%d] to user\n", i);
-            // Set ret to -EFAULT if any copy fails, but continue to free memory
-            if (ret == 0) ret = -EFAULT;
-        }
-    }
-
-cleanup_k_qubits:
-    // 6. Free all allocated kernel memory for qubits
-    for (int j = 0; j < 7; j++) {
-        if (k_qubits[j]) { // Only free if memory was successfully allocated
-            kfree(k_qubits[j]);
-            k_qubits[j] = NULL; // Prevent double free
-        }
-    }
+    ret = NYMYA_TRACE_CORE(3348, arr.k_qubits[0]->id, arr.k_qubits[1]->id, nymya_3348_hex_rhombi_lattice(arr.k_qubits));
+    if (!ret)
+        ret = nymya_qubit_ptrs_to_user(&arr, 3348, "nymya_3348_hex_rhombi_lattice");
 
-    return ret; // Return 0 on success, or error code if any operation failed
+    nymya_qubit_ptrs_free(&arr);
+    return ret;
 }
 
 #endif
@@ -11,6 +11,14 @@
 
 #include "nymya.h" // Common definitions like nymya_qubit, and gate macros
 
+// Per hexagon: Hadamard on all six qubits, then CNOTs around the ring
+static const uint16_t nymya_3350_h[] = { 0, 1, 2, 3, 4, 5 };
+static const nymya_graph_edge nymya_3350_edges[] = {
+    { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 5 }, { 5, 0 },
+};
+static const nymya_graph nymya_3350_graph =
+    NYMYA_GRAPH_INIT("HEX_TESS", "Hexagon ring entangle", 6, nymya_3350_h, nymya_3350_edges);
+
 #ifndef __KERNEL__
 #include <stdint.h>
 #include <errno.h>
@@ -53,31 +61,8 @@
  * - -1 if any individual qubit pointer within a processed hexagon is NULL.
  */
 int nymya_3350_tessellated_hexagons(nymya_qubit* q[], size_t count) {
-    // Basic null pointer and minimum count check
-    if (!q || count < 6) return -1;
-
-    // Calculate the number of complete hexagons that can be formed
-    size_t groups = count / 6;
-
-    // Iterate through each hexagon group
-    for (size_t g = 0; g < groups; g++) {
-        size_t base = 6 * g; // Base index for the current hexagon's qubits
-
-        // Check for null pointers within the current hexagon and apply Hadamard
-        for (int i = 0; i < 6; i++) {
-            if (!q[base + i]) return -1; // Return error if any qubit in the hexagon is NULL
-            hadamard(q[base + i]);   // Hadamard on each qubit in the hexagon
-        }
-
-        // Apply CNOT gates between adjacent qubits in a cyclic manner
-        for (int i = 0; i < 6; i++) {
-            cnot(q[base + i], q[base + (i + 1) % 6]);
-        }
-
-        // Log the symbolic event for traceability, using the first qubit of the hexagon
-        log_symbolic_event("HEX_TESS", q[base]->id, q[base]->tag, "Hexagon ring entangle");
-    }
-    return 0; // Success
+    // Hexagons are independent; large lattices are split across threads
+    return nymya_graph_state(&nymya_3350_graph, q, count);
 }
 
 #else // __KERNEL__
@@ -97,39 +82,10 @@ int nymya_3350_tessellated_hexagons(nymya_qubit* q[], size_t count) {
  * @return 0 on success, or a negative errno on failure.
  */
 int nymya_3350_tessellated_hexagons(struct nymya_qubit **k_qubits, size_t count) {
-    int ret = 0;
-    size_t groups; // Number of complete hexagons
-
     // We assume basic validation (count >= 6, k_qubits and its elements valid)
     // has been done by the caller (the syscall wrapper).
-    groups = count / 6;
-
-    // Iterate through each hexagon group
-    for (size_t g = 0; g < groups; g++) {
-        size_t base = 6 * g; // Base index for the current hexagon's qubits
-
-        // Apply Hadamard gate to each qubit in the hexagon
-        for (int j = 0; j < 6; j++) {
-            ret = nymya_3308_hadamard_gate(k_qubits[base + j]);
-            if (ret) {
-                pr_err("nymya_3350_tessellated_hexagons: Hadamard on hexagon %zu, qubit %d failed, error %d\n", g, j, ret);
-                return ret; // Propagate error immediately
-            }
-        }
-
-        // Apply CNOT gates between adjacent qubits in a cyclic manner
-        for (int j = 0; j < 6; j++) {
-            ret = nymya_3309_controlled_not(k_qubits[base + j], k_qubits[base + (j + 1) % 6]);
-            if (ret) {
-                pr_err("nymya_3350_tessellated_hexagons: CNOT(q[%zu+%d], q[%zu+%d]) on hexagon %zu failed, error %d\n", base, j, base, (j + 1) % 6, g, ret);
-                return ret; // Propagate error immediately
-            }
-        }
-
-        // Log the symbolic event for traceability
-        log_symbolic_event("HEX_TESS", k_qubits[base]->id, k_qubits[base]->tag, "Hexagon ring entangle");
-    }
-    return 0; // Success
+    // Hexagons are independent; large lattices are split across CPUs
+    return nymya_graph_state(&nymya_3350_graph, k_qubits, count);
 }
 EXPORT_SYMBOL_GPL(nymya_3350_tessellated_hexagons);
 
@@ -142,7 +98,7 @@ EXPORT_SYMBOL_GPL(nymya_3350_tessellated_hexagons);
  * @count: The total number of qubits in the array provided by user space.
  *
  * This syscall copies the array of user-space qubit pointers, then copies each
- * individual qubit structure from user space to kernel space. It applies the
+ * individual qubit structure into one contiguous kernel buffer. It applies the
  * tessellated hexagonal lattice gate logic using the kernel-space
  * `nymya_3350_tessellated_hexagons` function, and finally copies the
  * modified qubit data back to user space.
@@ -155,116 +111,30 @@ EXPORT_SYMBOL_GPL(nymya_3350_tessellated_hexagons);
  * - -ENOMEM if kernel memory allocation fails.
  * - Error code from underlying gate operations (propagated from `nymya_3350_tessellated_hexagons`).
  */
-SYSCALL_DEFINE2(nymya_3350_tessellated_hexagons,
+NYMYA_SYSCALL_DEFINE2(3350, nymya_3350_tessellated_hexagons,
     struct nymya_qubit __user * __user *, user_q_array,
     size_t, count) {
 
-    struct nymya_qubit **k_qubits = NULL; // Array of pointers to kernel-space qubit data
-    struct nymya_qubit __user **user_qubit_ptrs = NULL; // Array to hold user-space pointers
-    int ret = 0; // Return value for syscall and gate operations
-    size_t i; // Loop counter
-    // size_t groups; // No longer needed here, calculated by core function
+    struct nymya_qubit_ptr_array arr;
+    int ret;
 
-    // 1. Basic validation: Check for null array pointer and minimum count
+    // Basic validation: Check for null array pointer and minimum count
     if (!user_q_array || count < 6) {
         pr_err("sys_nymya_3350_tessellated_hexagons: Invalid user_q_array or count (%zu)\n", count);
         return -EINVAL;
     }
 
-    // Calculate the number of complete hexagons
-    // groups = count / 6; // Moved calculation to core function
-
-    // 2. Allocate kernel memory for the array of user-space qubit pointers
-    user_qubit_ptrs = kmalloc_array(count, sizeof(struct nymya_qubit __user *), GFP_KERNEL);
-    if (!user_qubit_ptrs) {
-        pr_err("sys_nymya_3350_tessellated_hexagons: Failed to allocate memory for user_qubit_ptrs array\n");
-        return -ENOMEM;
-    }
-
-    // Copy the array of user-space qubit pointers from user space
-    if (copy_from_user(user_qubit_ptrs, user_q_array, count * sizeof(struct nymya_qubit __user *))) {
-        pr_err("sys_nymya_3350_tessellated_hexagons: Failed to copy user qubit pointers array\n");
-        ret = -EFAULT;
-        goto cleanup_user_ptrs_array;
-    }
+    // Copy the pointer array and every qubit into one contiguous kernel buffer
+    ret = nymya_qubit_ptrs_from_user(&arr, user_q_array, count, 3350, "nymya_3350_tessellated_hexagons");
+    if (ret)
+        return ret;
 
-    // 3. Allocate kernel memory for the array of kernel-space qubit structures
-    k_qubits = kmalloc_array(count, sizeof(struct nymya_qubit *), GFP_KERNEL);
-    if (!k_qubits) {
-        pr_err("sys_nymya_3350_tessellated_hexagons: Failed to allocate memory for k_qubits array\n");
-        ret = -ENOMEM;
-        goto cleanup_user_ptrs_array;
-    }
-
-    // Initialize k_qubits pointers to NULL for safe cleanup
-    for (i = 0; i < count; i++) {
-        k_qubits[i] = NULL;
-    }
-
-    // 4. Allocate memory for each individual qubit and copy data from user space
-    for (i = 0; i < count; i++) {
-        // Check if individual user-space qubit pointer is NULL
-        if (!user_qubit_ptrs[i]) {
-            pr_err("sys_nymya_3350_tessellated_hexagons: Null individual user qubit pointer at index %zu\n", i);
-            ret = -EINVAL;
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-
-        // Allocate memory for the kernel-space copy of the qubit
-        k_qubits[i] = kmalloc(sizeof(struct nymya_qubit), GFP_KERNEL);
-        if (!k_qubits[i]) {
-            pr_err("sys_nymya_3350_tessellated_hexagons: Failed to allocate memory for k_qubit[%zu]\n", i);
-            ret = -ENOMEM; // Out of memory
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-
-        // Copy the actual qubit data from user space into the allocated kernel memory
-        if (copy_from_user(k_qubits[i], user_qubit_ptrs[i], sizeof(struct nymya_qubit))) {
-            pr_err("sys_nymya_3350_tessellated_hexagons: Failed to copy k_qubit[%zu] data from user\n", i);
-            ret = -EFAULT; // Bad address
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-    }
-
-    // 5. Call the extracted core logic function for kernel space
-    ret = nymya_3350_tessellated_hexagons(k_qubits, count);
-    if (ret) {
-        // Error already logged by the core function
-        goto cleanup_k_qubits;
-    }
-
-    // 6. Copy the modified qubits back to user space
-    // Only proceed if no errors occurred during gate applications (ret == 0)
-    for (i = 0; i < count; i++) {
-        // Copy the actual qubit data from kernel memory back to user space
-        if (copy_to_user(user_qubit_ptrs[i], k_qubits[i], sizeof(struct nymya_qubit))) {
-            pr_err("sys_nymya_3350_tessellated_hexagons: Failed to copy k_qubit[%zu] to user\n", i);
-            // If previous operations were successful (ret is 0), set ret to -EFAULT for copy_to_user failure.
-            // If ret was already an error from core logic, preserve that error.
-            if (ret == 0) ret = -EFAULT;
-        }
-    }
-
-cleanup_k_qubits:
-    // 7. Free all allocated kernel memory for individual qubits
-    for (size_t j = 0; j < count; j++) {
-        if (k_qubits && k_qubits[j]) { // Check if k_qubits array and individual pointer are valid
-            kfree(k_qubits[j]);
-            k_qubits[j] = NULL; // Prevent double free
-        }
-    }
-    if (k_qubits) {
-        kfree(k_qubits); // Free the array of pointers itself
-        k_qubits = NULL;
-    }
-
-cleanup_user_ptrs_array:
-    if (user_qubit_ptrs) {
-        kfree(user_qubit_ptrs); // Free the array holding user-space pointers
-        user_qubit_ptrs = NULL;
-    }
+    ret = NYMYA_TRACE_CORE(3350, arr.k_qubits[0]->id, arr.k_qubits[1]->id, nymya_3350_tessellated_hexagons(arr.k_qubits, count));
+    if (!ret)
+        ret = nymya_qubit_ptrs_to_user(&arr, 3350, "nymya_3350_tessellated_hexagons");
 
-    return ret; // Return 0 on success, or error code if any operation failed
+    nymya_qubit_ptrs_free(&arr);
+    return ret;
 }
 
 #endif
@@ -7,6 +7,25 @@
 
 #include "nymya.h" // Common definitions like nymya_qubit and gate macros
 
+// Hadamard on all eight qubits, then CNOTs both ways across every pair (i < j)
+static const uint16_t nymya_3352_h[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+static const nymya_graph_edge nymya_3352_edges[] = {
+    { 0, 1 }, { 1, 0 }, { 0, 2 }, { 2, 0 }, { 0, 3 }, { 3, 0 },
+    { 0, 4 }, { 4, 0 }, { 0, 5 }, { 5, 0 }, { 0, 6 }, { 6, 0 },
+    { 0, 7 }, { 7, 0 },
+    { 1, 2 }, { 2, 1 }, { 1, 3 }, { 3, 1 }, { 1, 4 }, { 4, 1 },
+    { 1, 5 }, { 5, 1 }, { 1, 6 }, { 6, 1 }, { 1, 7 }, { 7, 1 },
+    { 2, 3 }, { 3, 2 }, { 2, 4 }, { 4, 2 }, { 2, 5 }, { 5, 2 },
+    { 2, 6 }, { 6, 2 }, { 2, 7 }, { 7, 2 },
+    { 3, 4 }, { 4, 3 }, { 3, 5 }, { 5, 3 }, { 3, 6 }, { 6, 3 },
+    { 3, 7 }, { 7, 3 },
+    { 4, 5 }, { 5, 4 }, { 4, 6 }, { 6, 4 }, { 4, 7 }, { 7, 4 },
+    { 5, 6 }, { 6, 5 }, { 5, 7 }, { 7, 5 },
+    { 6, 7 }, { 7, 6 },
+};
+static const nymya_graph nymya_3352_graph =
+    NYMYA_GRAPH_INIT("E8_GROUP", "E8 8-node full entanglement", 8, nymya_3352_h, nymya_3352_edges);
+
 #ifndef __KERNEL__
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,18 +41,7 @@
  * Returns 0 on success, -1 on null pointer.
  */
 int nymya_3352_e8_group(nymya_qubit* q[8]) {
-    for (int i = 0; i < 8; i++) {
-        if (!q[i]) return -1;
-        hadamard(q[i]);
-    }
-    for (int i = 0; i < 8; i++) {
-        for (int j = i+1; j < 8; j++) {
-            cnot(q[i], q[j]);
-            cnot(q[j], q[i]);
-        }
-    }
-    log_symbolic_event("E8_GROUP", q[0]->id, q[0]->tag, "E8 8-node full entanglement");
-    return 0;
+    return nymya_graph_state(&nymya_3352_graph, q, 8);
 }
 
 #else // __KERNEL__
@@ -52,57 +60,43 @@ int nymya_3352_e8_group(nymya_qubit* q[8]) {
  * Matches declaration: int nymya_3352_e8_group(nymya_qubit* q[8]);
  */
 int nymya_3352_e8_group(nymya_qubit* q[8]) {
-    int ret;
-    for (int i = 0; i < 8; i++) {
-        if (!q[i]) return -EINVAL;
-        ret = nymya_3308_hadamard_gate(q[i]);
-        if (ret) return ret;
-    }
-    for (int i = 0; i < 8; i++) {
-        for (int j = i+1; j < 8; j++) {
-            ret = nymya_3309_controlled_not(q[i], q[j]); if (ret) return ret;
-            ret = nymya_3309_controlled_not(q[j], q[i]); if (ret) return ret;
-        }
-    }
-    log_symbolic_event("E8_GROUP", q[0]->id, q[0]->tag, "E8 8-node full entanglement");
-    return 0;
+    return nymya_graph_state(&nymya_3352_graph, q, 8);
 }
 EXPORT_SYMBOL_GPL(nymya_3352_e8_group);
 
 /**
- * SYSCALL_DEFINE1 - Kernel entry point for syscall
- * @user_q: User-space array of 8 pointers to nymya_qubit
+ * SYSCALL_DEFINE1(nymya_3352_e8_group) - Kernel entry point for the E8 group gate.
+ * @user_q: User-space array of 8 pointers to nymya_qubit.
  *
  * This syscall copies the array of qubit pointers and each qubit struct
- * into kernel space, runs the entanglement logic, then copies them back.
+ * into one contiguous kernel buffer, runs the entanglement logic, then
+ * copies them back.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -EINVAL if @user_q or any qubit pointer in it is NULL.
+ * - -EFAULT if copying data to/from user space fails.
+ * - -ENOMEM if kernel memory allocation fails.
  */
-SYSCALL_DEFINE1(nymya_3352_e8_group,
-    nymya_qubit* __user *, user_q)
+NYMYA_SYSCALL_DEFINE1(3352, nymya_3352_e8_group,
+    struct nymya_qubit __user * __user *, user_q)
 {
-    nymya_qubit* k_q[8];
-    int ret;  // return value for core function
-
-    // Copy user pointers
-    if (copy_from_user(k_q, user_q, 8 * sizeof(nymya_qubit *)))
-        return -EFAULT;
+    struct nymya_qubit_ptr_array arr;
+    int ret;
 
-    // Copy structures individually
-    for (int i = 0; i < 8; i++) {
-        if (!k_q[i])
-            return -EINVAL;
-        if (copy_from_user(&k_q[i][0], k_q[i], sizeof(nymya_qubit)))
-            return -EFAULT;
-    }
+    if (!user_q)
+        return -EINVAL;
 
-    // Core logic
-    ret = nymya_3352_e8_group(k_q);
+    // Copy the pointer array and all 8 qubits into one contiguous kernel buffer
+    ret = nymya_qubit_ptrs_from_user(&arr, user_q, 8, 3352, "nymya_3352_e8_group");
+    if (ret)
+        return ret;
 
-    // Copy back modified qubits
-    for (int i = 0; i < 8; i++) {
-        if (copy_to_user(k_q[i], &k_q[i][0], sizeof(nymya_qubit)))
-            return -EFAULT;
-    }
+    ret = NYMYA_TRACE_CORE(3352, arr.k_qubits[0]->id, arr.k_qubits[1]->id, nymya_3352_e8_group(arr.k_qubits));
+    if (!ret)
+        ret = nymya_qubit_ptrs_to_user(&arr, 3352, "nymya_3352_e8_group");
 
+    nymya_qubit_ptrs_free(&arr);
     return ret;
 }
 
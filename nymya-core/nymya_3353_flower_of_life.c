@@ -12,6 +12,22 @@
 
 #include "nymya.h" // Common definitions like nymya_qubit, and gate macros
 
+// Hadamard on all 19 qubits; CNOTs from the centre q[0] to every other qubit,
+// then around the inner ring q[1]..q[6] and the outer ring q[7]..q[18]
+static const uint16_t nymya_3353_h[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+};
+static const nymya_graph_edge nymya_3353_edges[] = {
+    { 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 }, { 0, 5 }, { 0, 6 },
+    { 0, 7 }, { 0, 8 }, { 0, 9 }, { 0, 10 }, { 0, 11 }, { 0, 12 },
+    { 0, 13 }, { 0, 14 }, { 0, 15 }, { 0, 16 }, { 0, 17 }, { 0, 18 },
+    { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 5 }, { 5, 6 }, { 6, 1 },
+    { 7, 8 }, { 8, 9 }, { 9, 10 }, { 10, 11 }, { 11, 12 }, { 12, 13 },
+    { 13, 14 }, { 14, 15 }, { 15, 16 }, { 16, 17 }, { 17, 18 }, { 18, 7 },
+};
+static const nymya_graph nymya_3353_graph =
+    NYMYA_GRAPH_INIT("FLOWER", "Flower of Life pattern entangled", 19, nymya_3353_h, nymya_3353_edges);
+
 #ifndef __KERNEL__
 #include <stdint.h>
 #include <errno.h>
@@ -23,6 +39,24 @@
     #include <stdlib.h>  // Userland: For general utilities (e.g., size_t)
     #include <math.h>    // Userland: For complex math functions (if needed by sub-gates)
     #include <complex.h> // Userland: For _Complex double type (if needed by sub-gates)
+
+/**
+ * nymya_3353_flower_of_life - Applies the "Flower of Life" entanglement pattern (userland).
+ * @q: An array of pointers to nymya_qubit objects.
+ * @count: The total number of qubits in the array; only the first 19 are used.
+ *
+ * Same pattern as the kernel version: Hadamard on all 19 qubits, CNOTs from
+ * the centre q[0] to every other qubit, then CNOTs around the inner ring
+ * (q[1]..q[6]) and the outer ring (q[7]..q[18]).
+ *
+ * Returns:
+ * - 0 on success.
+ * - -1 if `q` is NULL, `count` is less than 19, or any qubit pointer is NULL.
+ */
+int nymya_3353_flower_of_life(nymya_qubit* q[], size_t count) {
+    return nymya_graph_state(&nymya_3353_graph, q, count < 19 ? count : 19);
+}
+
 #else
     #include <linux/kernel.h>   // Kernel: For pr_err and general kernel functions
     #include <linux/syscalls.h> // Kernel: For SYSCALL_DEFINE macros
@@ -51,89 +85,13 @@
  *
  * Returns:
  * - 0 on success.
- * - -EINVAL if `count` is less than 19, or if any required qubit index is out of bounds.
+ * - -EINVAL if `k_qubits` is NULL, `count` is less than 19 or a qubit pointer is NULL.
  * - Error code from underlying gate operations (e.g., nymya_3308_hadamard_gate,
  *   nymya_3309_controlled_not).
  */
 int nymya_3353_flower_of_life(struct nymya_qubit **k_qubits, size_t count) {
-    int ret = 0;
-    size_t i;
-    static const size_t required_qubits = 19;
-
-    // The syscall layer should ensure k_qubits is not NULL and count is sufficient
-    // before calling this function, but a defensive check is included.
-    if (!k_qubits || count < required_qubits) {
-        pr_err("nymya_3353_flower_of_life: Internal error - invalid k_qubits array or count (%zu). Expected %zu.\n", count, required_qubits);
-        return -EINVAL;
-    }
-
-    // Apply Hadamard to all 19 qubits
-    for (i = 0; i < required_qubits; i++) {
-        ret = nymya_3308_hadamard_gate(k_qubits[i]);
-        if (ret) {
-            pr_err("nymya_3353_flower_of_life: Hadamard on q[%zu] failed, error %d\n", i, ret);
-            return ret;
-        }
-    }
-
-    // Entangle the central qubit (k_qubits[0]) with all other 18 qubits
-    for (i = 1; i < required_qubits; i++) {
-        ret = nymya_3309_controlled_not(k_qubits[0], k_qubits[i]);
-        if (ret) {
-            pr_err("nymya_3353_flower_of_life: CNOT(q[0], q[%zu]) failed, error %d\n", i, ret);
-            return ret;
-        }
-    }
-
-    // Entangle qubits in the first ring (k_qubits[1] to k_qubits[6]) cyclically
-    for (int j = 1; j <= 6; j++) {
-        size_t current_idx = j;
-        size_t next_idx = (j % 6) + 1; // 1->2, 2->3, ..., 6->1
-
-        // Defensive check
-        if (current_idx >= required_qubits || next_idx >= required_qubits) {
-            pr_err("nymya_3353_flower_of_life: Ring 1 CNOT indices out of bounds: %zu, %zu (expected < %zu)\n", current_idx, next_idx, required_qubits);
-            return -EINVAL;
-        }
-        ret = nymya_3309_controlled_not(k_qubits[current_idx], k_qubits[next_idx]);
-        if (ret) {
-            pr_err("nymya_3353_flower_of_life: CNOT(q[%zu], q[%zu]) failed, error %d\n", current_idx, next_idx, ret);
-            return ret;
-        }
-    }
-
-    // Entangle qubits in the second ring (k_qubits[7] to k_qubits[18]) cyclically
-    for (int j = 7; j < 18; j++) {
-        size_t current_idx = j;
-        size_t next_idx = j + 1;
-
-        // Defensive check
-        if (current_idx >= required_qubits || next_idx >= required_qubits) {
-            pr_err("nymya_3353_flower_of_life: Ring 2 CNOT indices out of bounds: %zu, %zu (expected < %zu)\n", current_idx, next_idx, required_qubits);
-            return -EINVAL;
-        }
-        ret = nymya_3309_controlled_not(k_qubits[current_idx], k_qubits[next_idx]);
-        if (ret) {
-            pr_err("nymya_3353_flower_of_life: CNOT(q[%zu], q[%zu]) failed, error %d\n", current_idx, next_idx, ret);
-            return ret;
-        }
-    }
-    // Complete the cycle for the last connection: q[18] to q[7]
-    // Defensive check
-    if (18 >= required_qubits || 7 >= required_qubits) {
-        pr_err("nymya_3353_flower_of_life: Last Ring 2 CNOT indices out of bounds: 18, 7 (expected < %zu)\n", required_qubits);
-        return -EINVAL;
-    }
-    ret = nymya_3309_controlled_not(k_qubits[18], k_qubits[7]);
-    if (ret) {
-        pr_err("nymya_3353_flower_of_life: CNOT(q[18], q[7]) failed, error %d\n", ret);
-        return ret;
-    }
-
-    // Log the symbolic event for traceability
-    log_symbolic_event("FLOWER", k_qubits[0]->id, k_qubits[0]->tag, "Flower of Life pattern entangled");
-
-    return 0; // Success
+    // nymya_graph_state() rejects a NULL array and fewer than 19 qubits
+    return nymya_graph_state(&nymya_3353_graph, k_qubits, min_t(size_t, count, 19));
 }
 EXPORT_SYMBOL_GPL(nymya_3353_flower_of_life);
 
@@ -144,7 +102,7 @@ EXPORT_SYMBOL_GPL(nymya_3353_flower_of_life);
  * @count: The total number of qubits in the array provided by user space.
  *
  * This syscall copies the array of user-space qubit pointers, then copies each
- * individual qubit structure from user space to kernel space. It applies the
+ * individual qubit structure into one contiguous kernel buffer. It applies the
  * Flower of Life entanglement logic using kernel-space functions (Hadamard and CNOT)
  * to 19 qubits (if available), and finally copies the modified qubit data back to user space.
  *
@@ -156,114 +114,31 @@ EXPORT_SYMBOL_GPL(nymya_3353_flower_of_life);
  * - -ENOMEM if kernel memory allocation fails.
  * - Error code from underlying gate operations (e.g., nymya_3308_hadamard_gate).
  */
-SYSCALL_DEFINE2(nymya_3353_flower_of_life,
+NYMYA_SYSCALL_DEFINE2(3353, nymya_3353_flower_of_life,
     struct nymya_qubit __user * __user *, user_q_array,
     size_t, count) {
 
-    struct nymya_qubit **k_qubits = NULL; // Pointer to array of kernel-space qubit pointers
-    struct nymya_qubit __user **user_qubit_ptrs = NULL; // Pointer to array of user-space qubit pointers
-    int ret = 0; // Return value for syscall and gate operations
-    size_t i; // Loop counter
+    struct nymya_qubit_ptr_array arr;
+    int ret;
     const size_t required_qubits = 19; // Minimum qubits for one Flower of Life unit
 
-    // 1. Basic validation: Check for null array pointer and minimum count
+    // Basic validation: Check for null array pointer and minimum count
     if (!user_q_array || count < required_qubits) {
         pr_err("nymya_3353_flower_of_life: Invalid user_q_array or count (%zu). Minimum %zu qubits required.\n", count, required_qubits);
         return -EINVAL;
     }
 
-    // 2. Allocate kernel memory for the array of user-space qubit pointers
-    user_qubit_ptrs = kmalloc_array(count, sizeof(struct nymya_qubit __user *), GFP_KERNEL);
-    if (!user_qubit_ptrs) {
-        pr_err("nymya_3353_flower_of_life: Failed to allocate memory for user_qubit_ptrs array\n");
-        return -ENOMEM;
-    }
-
-    // Copy the array of user-space qubit pointers from user space
-    if (copy_from_user(user_qubit_ptrs, user_q_array, count * sizeof(struct nymya_qubit __user *))) {
-        pr_err("nymya_3353_flower_of_life: Failed to copy user qubit pointers array\n");
-        ret = -EFAULT;
-        goto cleanup_user_ptrs_array;
-    }
-
-    // 3. Allocate kernel memory for the array of kernel-space qubit structures
-    k_qubits = kmalloc_array(count, sizeof(struct nymya_qubit *), GFP_KERNEL);
-    if (!k_qubits) {
-        pr_err("nymya_3353_flower_of_life: Failed to allocate memory for k_qubits array\n");
-        ret = -ENOMEM;
-        goto cleanup_user_ptrs_array;
-    }
-
-    // Initialize k_qubits elements to NULL for safe cleanup
-    for (i = 0; i < count; i++) {
-        k_qubits[i] = NULL;
-    }
-
-    // 4. Allocate memory for each individual qubit and copy data from user space
-    for (i = 0; i < count; i++) {
-        // Check if individual user-space qubit pointer is NULL
-        if (!user_qubit_ptrs[i]) {
-            pr_err("nymya_3353_flower_of_life: Null individual user qubit pointer at index %zu\n", i);
-            ret = -EINVAL;
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-
-        // Allocate memory for the kernel-space copy of the qubit
-        k_qubits[i] = kmalloc(sizeof(struct nymya_qubit), GFP_KERNEL);
-        if (!k_qubits[i]) {
-            pr_err("nymya_3353_flower_of_life: Failed to allocate memory for k_qubit[%zu]\n", i);
-            ret = -ENOMEM; // Out of memory
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-
-        // Copy the actual qubit data from user space into the allocated kernel memory
-        if (copy_from_user(k_qubits[i], user_qubit_ptrs[i], sizeof(struct nymya_qubit))) {
-            pr_err("nymya_3353_flower_of_life: Failed to copy k_qubit[%zu] data from user\n", i);
-            ret = -EFAULT; // Bad address
-            goto cleanup_k_qubits; // Jump to cleanup allocated memory
-        }
-    }
-
-    // 5. Call the extracted core logic function
-    ret = nymya_3353_flower_of_life(k_qubits, count);
-    if (ret) {
-        pr_err("nymya_3353_flower_of_life: Core logic failed with error %d\n", ret);
-        goto cleanup_k_qubits;
-    }
-
-    // 6. Copy the modified qubits back to user space
-    // Only proceed if no errors occurred during gate applications
-    if (ret == 0) { // This check is redundant after the `if (ret)` block above, but harmless.
-        for (i = 0; i < count; i++) {
-            // Copy the actual qubit data from kernel memory back to user space
-            if (copy_to_user(user_qubit_ptrs[i], k_qubits[i], sizeof(struct nymya_qubit))) {
-                pr_err("nymya_3353_flower_of_life: Failed to copy k_qubit[%zu] to user\n", i);
-                // Set ret to -EFAULT if any copy fails, but continue to free memory
-                if (ret == 0) ret = -EFAULT; // Preserve first error
-            }
-        }
-    }
-
-cleanup_k_qubits:
-    // 7. Free all allocated kernel memory for individual qubits
-    for (size_t j = 0; j < count; j++) {
-        if (k_qubits && k_qubits[j]) { // Check if k_qubits array pointer is valid and individual pointer is valid
-            kfree(k_qubits[j]);
-            k_qubits[j] = NULL;
-        }
-    }
-    if (k_qubits) {
-        kfree(k_qubits); // Free the array of pointers itself
-        k_qubits = NULL;
-    }
+    // Copy the pointer array and every qubit into one contiguous kernel buffer
+    ret = nymya_qubit_ptrs_from_user(&arr, user_q_array, count, 3353, "nymya_3353_flower_of_life");
+    if (ret)
+        return ret;
 
-cleanup_user_ptrs_array:
-    if (user_qubit_ptrs) {
-        kfree(user_qubit_ptrs); // Free the array holding user-space pointers
-        user_qubit_ptrs = NULL;
-    }
+    ret = NYMYA_TRACE_CORE(3353, arr.k_qubits[0]->id, arr.k_qubits[1]->id, nymya_3353_flower_of_life(arr.k_qubits, count));
+    if (!ret)
+        ret = nymya_qubit_ptrs_to_user(&arr, 3353, "nymya_3353_flower_of_life");
 
-    return ret; // Return 0 on success, or error code if any operation failed
+    nymya_qubit_ptrs_free(&arr);
+    return ret;
 }
 
 #endif
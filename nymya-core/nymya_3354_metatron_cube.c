@@ -12,6 +12,18 @@
 
 #include "nymya.h" // Common definitions like nymya_qubit, and gate macros
 
+// Hadamard on all 13 qubits; CNOTs from the centre q[0] to every other qubit,
+// then from each inner qubit q[i] to its outer partner q[i + 6]
+static const uint16_t nymya_3354_h[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+static const nymya_graph_edge nymya_3354_edges[] = {
+    { 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 }, { 0, 5 }, { 0, 6 },
+    { 0, 7 }, { 0, 8 }, { 0, 9 }, { 0, 10 }, { 0, 11 }, { 0, 12 },
+    { 1, 7 }, { 2, 8 }, { 3, 9 }, { 4, 10 }, { 5, 11 }, { 6, 12 },
+};
+static const nymya_graph nymya_3354_graph =
+    NYMYA_GRAPH_INIT("METATRON", "Metatron’s Cube geometry entangled", 13,
+                     nymya_3354_h, nymya_3354_edges);
+
 #ifndef __KERNEL__
 
 #include <stdint.h>
@@ -35,24 +47,7 @@
  * - -1 if any individual qubit pointer within the processed unit is NULL.
  */
 int nymya_3354_metatron_cube(nymya_qubit* q[], size_t count) {
-    if (!q || count < 13) return -1;
-
-    for (size_t i = 0; i < 13; i++) {
-        if (!q[i]) return -1;
-        hadamard(q[i]);
-    }
-
-    for (size_t i = 1; i < 13; i++) {
-        cnot(q[0], q[i]);
-    }
-
-    for (int i = 1; i <= 6; i++) {
-        cnot(q[i], q[i + 6]);
-    }
-
-    log_symbolic_event("METATRON", q[0]->id, q[0]->tag,
-        "Metatron’s Cube geometry entangled");
-    return 0;
+    return nymya_graph_state(&nymya_3354_graph, q, count < 13 ? count : 13);
 }
 
 #else  // __KERNEL__
@@ -68,58 +63,18 @@ int nymya_3354_metatron_cube(nymya_qubit* q[], size_t count) {
 #include <linux/slab.h>
 #include <linux/module.h>
 
-extern int nymya_3308_hadamard_gate(struct nymya_qubit *q);
-extern int nymya_3309_controlled_not(struct nymya_qubit *q_ctrl, struct nymya_qubit *q_target);
-extern int log_symbolic_event(const char* gate, uint64_t id, const char* tag, const char* msg);
-
 int nymya_3354_metatron_cube_core(struct nymya_qubit **k_qubits, size_t count) {
-    int ret = 0;
-    const size_t required_qubits = 13;
-
-    for (size_t i = 0; i < required_qubits; i++) {
-        ret = nymya_3308_hadamard_gate(k_qubits[i]);
-        if (ret) {
-            pr_err("nymya_3354_metatron_cube_core: Hadamard on q[%zu] failed, error %d\n", i, ret);
-            return ret;
-        }
-    }
-
-    for (size_t i = 1; i < required_qubits; i++) {
-        ret = nymya_3309_controlled_not(k_qubits[0], k_qubits[i]);
-        if (ret) {
-            pr_err("nymya_3354_metatron_cube_core: CNOT(q[0], q[%zu]) failed, error %d\n", i, ret);
-            return ret;
-        }
-    }
-
-    for (int j = 1; j <= 6; j++) {
-        size_t current_idx = j;
-        size_t target_idx = j + 6;
-        if (current_idx >= count || target_idx >= count) {
-            pr_err("nymya_3354_metatron_cube_core: CNOT index out of bounds: %zu, %zu\n", current_idx, target_idx);
-            return -EINVAL;
-        }
-        ret = nymya_3309_controlled_not(k_qubits[current_idx], k_qubits[target_idx]);
-        if (ret) {
-            pr_err("nymya_3354_metatron_cube_core: CNOT(q[%zu], q[%zu]) failed, error %d\n", current_idx, target_idx, ret);
-            return ret;
-        }
-    }
-
-    log_symbolic_event("METATRON", k_qubits[0]->id, k_qubits[0]->tag,
-        "Metatron’s Cube geometry entangled");
-
-    return 0;
+    // nymya_graph_state() rejects a NULL array and fewer than 13 qubits
+    return nymya_graph_state(&nymya_3354_graph, k_qubits, min_t(size_t, count, 13));
 }
 EXPORT_SYMBOL_GPL(nymya_3354_metatron_cube_core);
 
-SYSCALL_DEFINE2(nymya_3354_metatron_cube,
+NYMYA_SYSCALL_DEFINE2(3354, nymya_3354_metatron_cube,
     struct nymya_qubit __user * __user *, user_q_array,
     size_t, count) {
 
-    struct nymya_qubit **k_qubits = NULL;
-    struct nymya_qubit __user **user_qubit_ptrs = NULL;
-    int ret = 0;
+    struct nymya_qubit_ptr_array arr;
+    int ret;
     const size_t required_qubits = 13;
 
     if (!user_q_array || count < required_qubits) {
@@ -127,67 +82,16 @@ SYSCALL_DEFINE2(nymya_3354_metatron_cube,
         return -EINVAL;
     }
 
-    user_qubit_ptrs = kmalloc_array(count, sizeof(*user_qubit_ptrs), GFP_KERNEL);
-    if (!user_qubit_ptrs) {
-        ret = -ENOMEM;
-        goto cleanup_user_ptrs_array;
-    }
-
-    if (copy_from_user(user_qubit_ptrs, user_q_array, count * sizeof(*user_qubit_ptrs))) {
-        ret = -EFAULT;
-        goto cleanup_user_ptrs_array;
-    }
-
-    k_qubits = kmalloc_array(count, sizeof(*k_qubits), GFP_KERNEL);
-    if (!k_qubits) {
-        ret = -ENOMEM;
-        goto cleanup_user_ptrs_array;
-    }
-
-    for (size_t i = 0; i < count; i++) {
-        k_qubits[i] = NULL;
-    }
-
-    for (size_t i = 0; i < count; i++) {
-        if (!user_qubit_ptrs[i]) {
-            ret = -EINVAL;
-            goto cleanup_k_qubits;
-        }
-
-        k_qubits[i] = kmalloc(sizeof(struct nymya_qubit), GFP_KERNEL);
-        if (!k_qubits[i]) {
-            ret = -ENOMEM;
-            goto cleanup_k_qubits;
-        }
-
-        if (copy_from_user(k_qubits[i], user_qubit_ptrs[i], sizeof(struct nymya_qubit))) {
-            ret = -EFAULT;
-            goto cleanup_k_qubits;
-        }
-    }
-
-    ret = nymya_3354_metatron_cube_core(k_qubits, count);
+    // Copy the pointer array and every qubit into one contiguous kernel buffer
+    ret = nymya_qubit_ptrs_from_user(&arr, user_q_array, count, 3354, "nymya_3354_metatron_cube");
     if (ret)
-        goto cleanup_k_qubits;
-
-    for (size_t i = 0; i < count; i++) {
-        if (copy_to_user(user_qubit_ptrs[i], k_qubits[i], sizeof(struct nymya_qubit))) {
-            if (ret == 0) ret = -EFAULT;
-        }
-    }
-
-cleanup_k_qubits:
-    for (size_t j = 0; j < count; j++) {
-        if (k_qubits && k_qubits[j]) {
-            kfree(k_qubits[j]);
-            k_qubits[j] = NULL;
-        }
-    }
-    kfree(k_qubits);
+        return ret;
 
-cleanup_user_ptrs_array:
-    kfree(user_qubit_ptrs);
+    ret = NYMYA_TRACE_CORE(3354, arr.k_qubits[0]->id, arr.k_qubits[1]->id, nymya_3354_metatron_cube_core(arr.k_qubits, count));
+    if (!ret)
+        ret = nymya_qubit_ptrs_to_user(&arr, 3354, "nymya_3354_metatron_cube");
 
+    nymya_qubit_ptrs_free(&arr);
     return ret;
 }
 
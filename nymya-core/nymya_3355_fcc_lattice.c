@@ -27,33 +27,35 @@
 int nymya_3355_fcc_lattice(nymya_qpos3d qubits[], size_t count) {
     if (!qubits || count < 14) return -1;
 
-    nymya_qpos3d_k *buf = malloc(count * sizeof(*buf));
+    nymya_qpos3d_k *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, count * sizeof(*buf));
     if (!buf) return -1;
 
     // Scale to fixed-point
-    for (size_t i = 0; i < count; i++) {
-        buf[i].q = qubits[i].q;
-        buf[i].x = (int64_t)(qubits[i].x * FIXED_POINT_SCALE);
-        buf[i].y = (int64_t)(qubits[i].y * FIXED_POINT_SCALE);
-        buf[i].z = (int64_t)(qubits[i].z * FIXED_POINT_SCALE);
-    }
+    nymya_qpos3d_to_k(qubits, buf, count);
 
     // Syscall
-    long ret = syscall(__NR_nymya_3355_fcc_lattice, (unsigned long)buf, count);
+    long ret = NYMYA_CALL_GATE(__NR_nymya_3355_fcc_lattice, (uintptr_t)buf, count);
 
     if (ret == 0) {
         // Rescale back
-        for (size_t i = 0; i < count; i++) {
-            qubits[i].q = buf[i].q;
-            qubits[i].x = (double)buf[i].x / FIXED_POINT_SCALE;
-            qubits[i].y = (double)buf[i].y / FIXED_POINT_SCALE;
-            qubits[i].z = (double)buf[i].z / FIXED_POINT_SCALE;
-        }
+        nymya_qpos3d_from_k(buf, qubits, count);
     }
-    free(buf);
     return (int)ret;
 }
 
+/**
+ * nymya_3355_fcc_lattice_k - nymya_3355_fcc_lattice() on sites already in the kernel layout.
+ * @qubits: array of nymya_qpos3d_k with length count, handed to the syscall as is
+ * @count: number of qubits (>=14)
+ *
+ * No conversion and no copy: the syscall updates @qubits in place.
+ * Returns 0 on success, -1 on invalid input, or syscall code.
+ */
+int nymya_3355_fcc_lattice_k(nymya_qpos3d_k qubits[], size_t count) {
+    if (!qubits || count < 14) return -1;
+    return (int)NYMYA_CALL_GATE(__NR_nymya_3355_fcc_lattice, (uintptr_t)qubits, count);
+}
+
 #else // __KERNEL__
     int nymya_3355_fcc_lattice_core(nymya_qpos3d_k *k_qubits, size_t count);
 
@@ -66,44 +68,26 @@ int nymya_3355_fcc_lattice(nymya_qpos3d qubits[], size_t count) {
 #include <linux/types.h>
 #include <linux/errno.h>
 
-static inline int64_t fcc_distance_sq_k(const nymya_qpos3d_k *a,
-                                        const nymya_qpos3d_k *b) {
-    int64_t dx = a->x - b->x;
-    int64_t dy = a->y - b->y;
-    int64_t dz = a->z - b->z;
-    return fixed_point_square(dx)
-         + fixed_point_square(dy)
-         + fixed_point_square(dz);
-}
+// Nearest-neighbour cutoff: unit FCC spacing plus 1% tolerance (Q32.32)
+#define FCC_NEIGHBOR_DIST_FP ((int64_t)(1.01 * FIXED_POINT_SCALE))
+#define FCC_NEIGHBOR_EPS2    ((int64_t)(1.0201 * FIXED_POINT_SCALE))
+
+// Smallest lattice the syscalls accept
+#define FCC_MIN_SITES 14
 
 /**
  * nymya_3355_fcc_lattice_core - Core FCC lattice logic (kernel).
  * @k_qubits: fixed-point qubit positions array
  * @count: number of qubits
  *
- * Applies Hadamard on each qubit, then CNOT for pairs within threshold.
+ * Applies Hadamard on each qubit, then CNOT for pairs within the
+ * nearest-neighbour cutoff, using the shared 3D lattice grid.
  */
 int nymya_3355_fcc_lattice_core(nymya_qpos3d_k *k_qubits, size_t count) {
     int ret;
 
-    // Hadamard on each
-    for (size_t i = 0; i < count; i++) {
-        ret = nymya_3308_hadamard_gate(&k_qubits[i].q);
-        if (ret) return ret;
-    }
-
-    // distance threshold squared
-    const int64_t eps2 = (int64_t)(1.0201 * FIXED_POINT_SCALE * FIXED_POINT_SCALE);
-
-    for (size_t i = 0; i < count; i++) {
-        for (size_t j = i + 1; j < count; j++) {
-            if (fcc_distance_sq_k(&k_qubits[i], &k_qubits[j]) <= eps2) {
-                ret = nymya_3309_controlled_not(&k_qubits[i].q,
-                                                &k_qubits[j].q);
-                if (ret) return ret;
-            }
-        }
-    }
+    ret = nymya_lattice3d_entangle(3355, k_qubits, count, FCC_NEIGHBOR_DIST_FP, FCC_NEIGHBOR_EPS2);
+    if (ret) return ret;
 
     log_symbolic_event("FCC_3D", k_qubits[0].q.id,
                        k_qubits[0].q.tag,
@@ -112,7 +96,45 @@ int nymya_3355_fcc_lattice_core(nymya_qpos3d_k *k_qubits, size_t count) {
 }
 EXPORT_SYMBOL_GPL(nymya_3355_fcc_lattice_core);
 
-SYSCALL_DEFINE2(nymya_3355_fcc_lattice,
+/**
+ * nymya_3355_fcc_lattice_soa_core - nymya_3355_fcc_lattice_core() on separate coordinate arrays.
+ * @sites: Sites with x, y and z set.
+ *
+ * Returns 0 on success, -EINVAL for fewer than FCC_MIN_SITES sites, -ENOMEM,
+ * or the first gate error.
+ */
+int nymya_3355_fcc_lattice_soa_core(const struct nymya_lattice_soa *sites) {
+    int ret;
+
+    if (!sites || sites->count < FCC_MIN_SITES)
+        return -EINVAL;
+
+    ret = nymya_lattice3d_entangle_soa(3355, sites, FCC_NEIGHBOR_DIST_FP, FCC_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
+    log_symbolic_event("FCC_3D", sites->qubits->id, sites->qubits->tag,
+                       "FCC lattice entangled");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3355_fcc_lattice_soa_core);
+
+/**
+ * nymya_3355_fcc_lattice_topo - Finds the FCC lattice's neighbour pairs for NYMYA_TOPO_BUILD.
+ * @sites: Sites with the coordinates set; the qubits are not read.
+ * @topo: Receives the pairs; released with nymya_lattice_topo_free().
+ *
+ * Returns 0 on success, -EINVAL for fewer than FCC_MIN_SITES sites, -ENOMEM
+ * or -EINTR.
+ */
+int nymya_3355_fcc_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo) {
+    if (!sites || sites->count < FCC_MIN_SITES)
+        return -EINVAL;
+
+    return nymya_lattice3d_topo_build(3355, sites, FCC_NEIGHBOR_DIST_FP, FCC_NEIGHBOR_EPS2, topo);
+}
+EXPORT_SYMBOL_GPL(nymya_3355_fcc_lattice_topo);
+
+NYMYA_SYSCALL_DEFINE2(3355, nymya_3355_fcc_lattice,
     unsigned long, user_ptr,
     size_t,        count)
 {
@@ -120,28 +142,31 @@ SYSCALL_DEFINE2(nymya_3355_fcc_lattice,
     nymya_qpos3d_k __user *u_qubits = (nymya_qpos3d_k __user *)user_ptr;
     int ret;
 
-    if (!u_qubits || count < 14)
+    if (!u_qubits || count < FCC_MIN_SITES)
         return -EINVAL;
+    ret = nymya_lattice_check_size(count);
+    if (ret)
+        return ret;
 
-    k_qubits = kmalloc_array(count, sizeof(*k_qubits), GFP_KERNEL);
+    k_qubits = nymya_stage_alloc(3355, count, sizeof(*k_qubits));
     if (!k_qubits)
         return -ENOMEM;
 
-    if (copy_from_user(k_qubits, u_qubits,
+    if (nymya_copy_from_user(3355, k_qubits, u_qubits,
                        count * sizeof(*k_qubits))) {
         ret = -EFAULT;
         goto out;
     }
 
-    ret = nymya_3355_fcc_lattice_core(k_qubits, count);
+    ret = NYMYA_TRACE_CORE(3355, k_qubits[0].q.id, 0, nymya_3355_fcc_lattice_core(k_qubits, count));
     if (ret) goto out;
 
-    if (copy_to_user(u_qubits, k_qubits,
+    if (nymya_copy_to_user(3355, u_qubits, k_qubits,
                      count * sizeof(*k_qubits)))
         ret = -EFAULT;
 
 out:
-    kfree(k_qubits);
+    nymya_stage_free(k_qubits);
     return ret;
 }
 
@@ -23,27 +23,29 @@ double e8_distance(nymya_qpos3d a, nymya_qpos3d b) {
  */
 int nymya_3357_e8_projected_lattice(nymya_qpos3d qubits[], size_t count) {
     if (!qubits || count < 30) return -1;
-    nymya_qpos3d_k *buf = malloc(count * sizeof(*buf));
+    nymya_qpos3d_k *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, count * sizeof(*buf));
     if (!buf) return -ENOMEM;
-    for (size_t i=0; i<count; i++) {
-        buf[i].q = qubits[i].q;
-        buf[i].x = (int64_t)(qubits[i].x * FIXED_POINT_SCALE);
-        buf[i].y = (int64_t)(qubits[i].y * FIXED_POINT_SCALE);
-        buf[i].z = (int64_t)(qubits[i].z * FIXED_POINT_SCALE);
-    }
-    long ret = syscall(__NR_nymya_3357_e8_projected_lattice, (unsigned long)buf, count);
+    nymya_qpos3d_to_k(qubits, buf, count);
+    long ret = NYMYA_CALL_GATE(__NR_nymya_3357_e8_projected_lattice, (uintptr_t)buf, count);
     if (ret==0) {
-        for (size_t i=0; i<count; i++) {
-            qubits[i].q = buf[i].q;
-            qubits[i].x = (double)buf[i].x / FIXED_POINT_SCALE;
-            qubits[i].y = (double)buf[i].y / FIXED_POINT_SCALE;
-            qubits[i].z = (double)buf[i].z / FIXED_POINT_SCALE;
-        }
+        nymya_qpos3d_from_k(buf, qubits, count);
     }
-    free(buf);
     return (int)ret;
 }
 
+/**
+ * nymya_3357_e8_projected_lattice_k - nymya_3357_e8_projected_lattice() on sites already in the kernel layout.
+ * @qubits: array of nymya_qpos3d_k with length count, handed to the syscall as is
+ * @count: number of qubits (>=30)
+ *
+ * No conversion and no copy: the syscall updates @qubits in place.
+ * Returns 0 on success, -1 on invalid input, or syscall code.
+ */
+int nymya_3357_e8_projected_lattice_k(nymya_qpos3d_k qubits[], size_t count) {
+    if (!qubits || count < 30) return -1;
+    return (int)NYMYA_CALL_GATE(__NR_nymya_3357_e8_projected_lattice, (uintptr_t)qubits, count);
+}
+
 #else // __KERNEL__
     int nymya_3357_e8_projected_lattice_core(nymya_qpos3d_k *k_qubits, size_t count);
 
@@ -54,50 +56,82 @@ int nymya_3357_e8_projected_lattice(nymya_qpos3d qubits[], size_t count) {
 #include <linux/slab.h>
 #include <linux/module.h>
 
-static int64_t e8_distance_squared_k(const nymya_qpos3d_k *a, const nymya_qpos3d_k *b) {
-    int64_t dx=a->x-b->x, dy=a->y-b->y, dz=a->z-b->z;
-    return fixed_point_square(dx)+fixed_point_square(dy)+fixed_point_square(dz);
-}
+// Nearest-neighbour cutoff and its square (Q32.32)
+#define E8_NEIGHBOR_DIST_FP ((int64_t)(1.00 * FIXED_POINT_SCALE))
+#define E8_NEIGHBOR_EPS2    fixed_point_square(E8_NEIGHBOR_DIST_FP)
+
+// Smallest lattice the syscalls accept
+#define E8_MIN_SITES 30
 
 /**
  * nymya_3357_e8_projected_lattice_core - Kernel core for E8 projected lattice.
  */
 int nymya_3357_e8_projected_lattice_core(nymya_qpos3d_k *k_qubits, size_t count) {
     int ret;
-    const int64_t EPS=(int64_t)(1.00*FIXED_POINT_SCALE);
-    const int64_t EPS2=fixed_point_square(EPS);
-    for (size_t i=0;i<count;i++) {
-        ret=hadamard(&k_qubits[i].q);
-        if (ret) return ret;
-    }
-    for (size_t i=0;i<count;i++) {
-        for (size_t j=i+1;j<count;j++) {
-            if (e8_distance_squared_k(&k_qubits[i],&k_qubits[j])<=EPS2) {
-                ret=cnot(&k_qubits[i].q,&k_qubits[j].q);
-                if (ret) return ret;
-            }
-        }
-    }
+
+    ret = nymya_lattice3d_entangle(3357, k_qubits, count, E8_NEIGHBOR_DIST_FP, E8_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
     log_symbolic_event("E8_PROJECTED",k_qubits[0].q.id,k_qubits[0].q.tag,
                        "Projected E8 lattice entangled");
     return 0;
 }
 EXPORT_SYMBOL_GPL(nymya_3357_e8_projected_lattice_core);
 
-SYSCALL_DEFINE2(nymya_3357_e8_projected_lattice,
+/**
+ * nymya_3357_e8_projected_lattice_soa_core - nymya_3357_e8_projected_lattice_core() on separate coordinate arrays.
+ * @sites: Sites with x, y and z set.
+ *
+ * Returns 0 on success, -EINVAL for fewer than E8_MIN_SITES sites, -ENOMEM,
+ * or the first gate error.
+ */
+int nymya_3357_e8_projected_lattice_soa_core(const struct nymya_lattice_soa *sites) {
+    int ret;
+
+    if (!sites || sites->count < E8_MIN_SITES)
+        return -EINVAL;
+
+    ret = nymya_lattice3d_entangle_soa(3357, sites, E8_NEIGHBOR_DIST_FP, E8_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
+    log_symbolic_event("E8_PROJECTED", sites->qubits->id, sites->qubits->tag,
+                       "Projected E8 lattice entangled");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3357_e8_projected_lattice_soa_core);
+
+/**
+ * nymya_3357_e8_projected_lattice_topo - Finds the E8 projected lattice's neighbour pairs for NYMYA_TOPO_BUILD.
+ * @sites: Sites with the coordinates set; the qubits are not read.
+ * @topo: Receives the pairs; released with nymya_lattice_topo_free().
+ *
+ * Returns 0 on success, -EINVAL for fewer than E8_MIN_SITES sites, -ENOMEM
+ * or -EINTR.
+ */
+int nymya_3357_e8_projected_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo) {
+    if (!sites || sites->count < E8_MIN_SITES)
+        return -EINVAL;
+
+    return nymya_lattice3d_topo_build(3357, sites, E8_NEIGHBOR_DIST_FP, E8_NEIGHBOR_EPS2, topo);
+}
+EXPORT_SYMBOL_GPL(nymya_3357_e8_projected_lattice_topo);
+
+NYMYA_SYSCALL_DEFINE2(3357, nymya_3357_e8_projected_lattice,
     unsigned long,user_ptr,
     size_t,count) {
     nymya_qpos3d_k *k_qubits;
     nymya_qpos3d_k __user *u_qubits=(nymya_qpos3d_k __user*)user_ptr;
     int ret;
-    if (!u_qubits||count<30) return -EINVAL;
-    k_qubits=kmalloc_array(count,sizeof(*k_qubits),GFP_KERNEL);
+    if (!u_qubits||count < E8_MIN_SITES) return -EINVAL;
+    ret = nymya_lattice_check_size(count);
+    if (ret) return ret;
+    k_qubits = nymya_stage_alloc(3357, count, sizeof(*k_qubits));
     if (!k_qubits) return -ENOMEM;
-    if (copy_from_user(k_qubits,u_qubits,count*sizeof(*k_qubits))) {ret=-EFAULT;goto out;}
-    ret=nymya_3357_e8_projected_lattice_core(k_qubits,count);
-    if (!ret) if (copy_to_user(u_qubits,k_qubits,count*sizeof(*k_qubits))) ret=-EFAULT;
+    if (nymya_copy_from_user(3357, k_qubits,u_qubits,count*sizeof(*k_qubits))) {ret=-EFAULT;goto out;}
+    ret = NYMYA_TRACE_CORE(3357, k_qubits[0].q.id, 0, nymya_3357_e8_projected_lattice_core(k_qubits, count));
+    if (!ret) if (nymya_copy_to_user(3357, u_qubits,k_qubits,count*sizeof(*k_qubits))) ret=-EFAULT;
 out:
-    kfree(k_qubits);
+    nymya_stage_free(k_qubits);
     return ret;
 }
 #endif
\ No newline at end of file
@@ -24,29 +24,29 @@ double dist4d(nymya_qpos4d a, nymya_qpos4d b) {
  */
 int nymya_3358_d4_lattice(nymya_qpos4d q[], size_t count) {
     if (!q || count < 24) return -1;
-    nymya_qpos4d_k *buf = malloc(count * sizeof(*buf));
+    nymya_qpos4d_k *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, count * sizeof(*buf));
     if (!buf) return -ENOMEM;
-    for (size_t i=0;i<count;i++) {
-        buf[i].q = q[i].q;
-        buf[i].x = (int64_t)(q[i].x * FIXED_POINT_SCALE);
-        buf[i].y = (int64_t)(q[i].y * FIXED_POINT_SCALE);
-        buf[i].z = (int64_t)(q[i].z * FIXED_POINT_SCALE);
-        buf[i].w = (int64_t)(q[i].w * FIXED_POINT_SCALE);
-    }
-    long ret = syscall(__NR_nymya_3358_d4_lattice,(unsigned long)buf,count);
+    nymya_qpos4d_to_k(q, buf, count);
+    long ret = NYMYA_CALL_GATE(__NR_nymya_3358_d4_lattice, (uintptr_t)buf, count);
     if (ret==0) {
-        for (size_t i=0;i<count;i++) {
-            q[i].q = buf[i].q;
-            q[i].x = (double)buf[i].x / FIXED_POINT_SCALE;
-            q[i].y = (double)buf[i].y / FIXED_POINT_SCALE;
-            q[i].z = (double)buf[i].z / FIXED_POINT_SCALE;
-            q[i].w = (double)buf[i].w / FIXED_POINT_SCALE;
-        }
+        nymya_qpos4d_from_k(buf, q, count);
     }
-    free(buf);
     return (int)ret;
 }
 
+/**
+ * nymya_3358_d4_lattice_k - nymya_3358_d4_lattice() on sites already in the kernel layout.
+ * @q: array of nymya_qpos4d_k with length count, handed to the syscall as is
+ * @count: number of qubits (>=24)
+ *
+ * No conversion and no copy: the syscall updates @q in place.
+ * Returns 0 on success, -1 on invalid input, or syscall code.
+ */
+int nymya_3358_d4_lattice_k(nymya_qpos4d_k q[], size_t count) {
+    if (!q || count < 24) return -1;
+    return (int)NYMYA_CALL_GATE(__NR_nymya_3358_d4_lattice, (uintptr_t)q, count);
+}
+
 #else // __KERNEL__
     int nymya_3358_d4_lattice_core(nymya_qpos4d_k *k_q, size_t count);
 
@@ -57,51 +57,126 @@ int nymya_3358_d4_lattice(nymya_qpos4d q[], size_t count) {
 #include <linux/slab.h>
 #include <linux/module.h>
 
-static int64_t dist4d_squared_k(const nymya_qpos4d_k *a, const nymya_qpos4d_k *b) {
-    int64_t dx=a->x-b->x, dy=a->y-b->y, dz=a->z-b->z, dw=a->w-b->w;
-    return fixed_point_square(dx)+fixed_point_square(dy)
-         + fixed_point_square(dz)+fixed_point_square(dw);
-}
+// Nearest-neighbour cutoff and its square (Q32.32)
+#define D4_NEIGHBOR_DIST_FP ((int64_t)(1.01 * FIXED_POINT_SCALE))
+#define D4_NEIGHBOR_EPS2    fixed_point_square(D4_NEIGHBOR_DIST_FP)
+
+// Smallest lattice the syscalls accept
+#define D4_MIN_SITES 24
 
 /**
  * nymya_3358_d4_lattice_core - Kernel core for D4 lattice logic.
  */
 int nymya_3358_d4_lattice_core(nymya_qpos4d_k *k_q, size_t count) {
     int ret;
-    const int64_t EPS_FP=(int64_t)(1.01*FIXED_POINT_SCALE);
-    const int64_t EPS2=fixed_point_square(EPS_FP);
-    for (size_t i=0;i<count;i++) {
-        ret=hadamard(&k_q[i].q);
-        if (ret) return ret;
-    }
-    for (size_t i=0;i<count;i++) {
-        for (size_t j=i+1;j<count;j++) {
-            if (dist4d_squared_k(&k_q[i],&k_q[j])<=EPS2) {
-                ret=cnot(&k_q[i].q,&k_q[j].q);
-                if (ret) return ret;
-            }
-        }
-    }
+
+    ret = nymya_lattice4d_entangle(3358, k_q, count, D4_NEIGHBOR_DIST_FP, D4_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
     log_symbolic_event("D4_LATTICE",k_q[0].q.id,k_q[0].q.tag,
                        "D4 lattice entangled in 4D");
     return 0;
 }
 EXPORT_SYMBOL_GPL(nymya_3358_d4_lattice_core);
 
-SYSCALL_DEFINE2(nymya_3358_d4_lattice,
+/**
+ * nymya_3358_d4_lattice_soa_core - nymya_3358_d4_lattice_core() on separate coordinate arrays.
+ * @sites: Sites with x, y, z and w set.
+ *
+ * Returns 0 on success, -EINVAL for fewer than D4_MIN_SITES sites, -ENOMEM,
+ * or the first gate error.
+ */
+int nymya_3358_d4_lattice_soa_core(const struct nymya_lattice_soa *sites) {
+    int ret;
+
+    if (!sites || sites->count < D4_MIN_SITES)
+        return -EINVAL;
+
+    ret = nymya_lattice4d_entangle_soa(3358, sites, D4_NEIGHBOR_DIST_FP, D4_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
+    log_symbolic_event("D4_LATTICE", sites->qubits->id, sites->qubits->tag,
+                       "D4 lattice entangled in 4D");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3358_d4_lattice_soa_core);
+
+// The 24 roots of D4, (+-1, +-1, 0, 0) in every arrangement: the nearest
+// neighbours of a D4 site in integer coordinates, at unit distance once
+// scaled by 1/sqrt(2) as the Q32.32 form expects
+static const int8_t d4_roots[24][4] = {
+    {  1,  1,  0,  0 }, {  1, -1,  0,  0 }, { -1,  1,  0,  0 }, { -1, -1,  0,  0 },
+    {  1,  0,  1,  0 }, {  1,  0, -1,  0 }, { -1,  0,  1,  0 }, { -1,  0, -1,  0 },
+    {  1,  0,  0,  1 }, {  1,  0,  0, -1 }, { -1,  0,  0,  1 }, { -1,  0,  0, -1 },
+    {  0,  1,  1,  0 }, {  0,  1, -1,  0 }, {  0, -1,  1,  0 }, {  0, -1, -1,  0 },
+    {  0,  1,  0,  1 }, {  0,  1,  0, -1 }, {  0, -1,  0,  1 }, {  0, -1,  0, -1 },
+    {  0,  0,  1,  1 }, {  0,  0,  1, -1 }, {  0,  0, -1,  1 }, {  0,  0, -1, -1 },
+};
+
+/**
+ * nymya_3358_d4_lattice_exact_core - nymya_3358_d4_lattice_soa_core() on integer coordinates.
+ * @sites: Sites with x, y, z and w set to plain integers with an even sum,
+ *         i.e. points of D4.
+ *
+ * Sites pair when they differ by a root of D4, found by probing the 24
+ * roots from each site, so no distance is computed or rounded. Gives the
+ * same result as the Q32.32 form on the coordinates divided by sqrt(2).
+ *
+ * Returns 0 on success, -EINVAL for fewer than D4_MIN_SITES sites, a site
+ * with an odd coordinate sum (its unit-distance neighbours are not roots)
+ * or a periodic box, -ENOMEM, -EINTR, or the first gate error.
+ */
+int nymya_3358_d4_lattice_exact_core(const struct nymya_lattice_soa *sites) {
+    size_t i;
+    int ret;
+
+    if (!sites || sites->count < D4_MIN_SITES)
+        return -EINVAL;
+    for (i = 0; i < sites->count; i++)
+        if ((sites->coord[0][i] + sites->coord[1][i] + sites->coord[2][i] + sites->coord[3][i]) & 1)
+            return -EINVAL;
+
+    ret = nymya_lattice4d_entangle_exact(3358, sites, &d4_roots[0][0], ARRAY_SIZE(d4_roots));
+    if (ret) return ret;
+
+    log_symbolic_event("D4_LATTICE", sites->qubits->id, sites->qubits->tag,
+                       "D4 lattice entangled in 4D");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3358_d4_lattice_exact_core);
+
+/**
+ * nymya_3358_d4_lattice_topo - Finds the D4 lattice's neighbour pairs for NYMYA_TOPO_BUILD.
+ * @sites: Sites with the coordinates set; the qubits are not read.
+ * @topo: Receives the pairs; released with nymya_lattice_topo_free().
+ *
+ * Returns 0 on success, -EINVAL for fewer than D4_MIN_SITES sites, -ENOMEM
+ * or -EINTR.
+ */
+int nymya_3358_d4_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo) {
+    if (!sites || sites->count < D4_MIN_SITES)
+        return -EINVAL;
+
+    return nymya_lattice4d_topo_build(3358, sites, D4_NEIGHBOR_DIST_FP, D4_NEIGHBOR_EPS2, topo);
+}
+EXPORT_SYMBOL_GPL(nymya_3358_d4_lattice_topo);
+
+NYMYA_SYSCALL_DEFINE2(3358, nymya_3358_d4_lattice,
     unsigned long, user_ptr,
     size_t, count) {
     nymya_qpos4d_k *k_q;
     nymya_qpos4d_k __user *u_q=(nymya_qpos4d_k __user*)user_ptr;
     int ret;
-    if (!u_q||count<24) return -EINVAL;
-    k_q=kmalloc_array(count,sizeof(*k_q),GFP_KERNEL);
+    if (!u_q||count < D4_MIN_SITES) return -EINVAL;
+    ret = nymya_lattice_check_size(count);
+    if (ret) return ret;
+    k_q = nymya_stage_alloc(3358, count, sizeof(*k_q));
     if (!k_q) return -ENOMEM;
-    if (copy_from_user(k_q,u_q,count*sizeof(*k_q))) {ret=-EFAULT;goto out;}
-    ret=nymya_3358_d4_lattice_core(k_q,count);
-    if (!ret) if (copy_to_user(u_q,k_q,count*sizeof(*k_q))) ret=-EFAULT;
+    if (nymya_copy_from_user(3358, k_q,u_q,count*sizeof(*k_q))) {ret=-EFAULT;goto out;}
+    ret = NYMYA_TRACE_CORE(3358, k_q[0].q.id, 0, nymya_3358_d4_lattice_core(k_q, count));
+    if (!ret) if (nymya_copy_to_user(3358, u_q,k_q,count*sizeof(*k_q))) ret=-EFAULT;
 out:
-    kfree(k_q);
+    nymya_stage_free(k_q);
     return ret;
 }
 #endif
\ No newline at end of file
@@ -25,31 +25,29 @@ double dist5d(nymya_qpos5d a, nymya_qpos5d b) {
  */
 int nymya_3359_b5_lattice(nymya_qpos5d q[], size_t count) {
     if (!q || count < 32) return -1;
-    nymya_qpos5d_k *buf = malloc(count * sizeof(*buf));
+    nymya_qpos5d_k *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, count * sizeof(*buf));
     if (!buf) return -ENOMEM;
-    for (size_t i=0;i<count;i++) {
-        buf[i].q = q[i].q;
-        buf[i].x = (int64_t)(q[i].x*FIXED_POINT_SCALE);
-        buf[i].y = (int64_t)(q[i].y*FIXED_POINT_SCALE);
-        buf[i].z = (int64_t)(q[i].z*FIXED_POINT_SCALE);
-        buf[i].w = (int64_t)(q[i].w*FIXED_POINT_SCALE);
-        buf[i].v = (int64_t)(q[i].v*FIXED_POINT_SCALE);
-    }
-    long ret = syscall(__NR_nymya_3359_b5_lattice,(unsigned long)buf,count);
+    nymya_qpos5d_to_k(q, buf, count);
+    long ret = NYMYA_CALL_GATE(__NR_nymya_3359_b5_lattice, (uintptr_t)buf, count);
     if (ret==0) {
-        for (size_t i=0;i<count;i++) {
-            q[i].q = buf[i].q;
-            q[i].x = (double)buf[i].x/ FIXED_POINT_SCALE;
-            q[i].y = (double)buf[i].y/ FIXED_POINT_SCALE;
-            q[i].z = (double)buf[i].z/ FIXED_POINT_SCALE;
-            q[i].w = (double)buf[i].w/ FIXED_POINT_SCALE;
-            q[i].v = (double)buf[i].v/ FIXED_POINT_SCALE;
-        }
+        nymya_qpos5d_from_k(buf, q, count);
     }
-    free(buf);
     return (int)ret;
 }
 
+/**
+ * nymya_3359_b5_lattice_k - nymya_3359_b5_lattice() on sites already in the kernel layout.
+ * @q: array of nymya_qpos5d_k with length count, handed to the syscall as is
+ * @count: number of qubits (>=32)
+ *
+ * No conversion and no copy: the syscall updates @q in place.
+ * Returns 0 on success, -1 on invalid input, or syscall code.
+ */
+int nymya_3359_b5_lattice_k(nymya_qpos5d_k q[], size_t count) {
+    if (!q || count < 32) return -1;
+    return (int)NYMYA_CALL_GATE(__NR_nymya_3359_b5_lattice, (uintptr_t)q, count);
+}
+
 #else // __KERNEL__
     int nymya_3359_b5_lattice_core(nymya_qpos5d_k *k_q, size_t count);
 
@@ -60,53 +58,116 @@ int nymya_3359_b5_lattice(nymya_qpos5d q[], size_t count) {
 #include <linux/slab.h>
 #include <linux/module.h>
 
-static int64_t dist5d_squared_k(const nymya_qpos5d_k *a, const nymya_qpos5d_k *b) {
-    int64_t dx=a->x-b->x, dy=a->y-b->y, dz=a->z-b->z;
-    int64_t dw=a->w-b->w, dv=a->v-b->v;
-    return fixed_point_square(dx)+fixed_point_square(dy)
-         + fixed_point_square(dz)+fixed_point_square(dw)
-         + fixed_point_square(dv);
-}
+// Nearest-neighbour cutoff and its square (Q32.32)
+#define B5_NEIGHBOR_DIST_FP ((int64_t)(1.00 * FIXED_POINT_SCALE))
+#define B5_NEIGHBOR_EPS2    fixed_point_square(B5_NEIGHBOR_DIST_FP)
+
+// Smallest lattice the syscalls accept
+#define B5_MIN_SITES 32
 
 /**
  * nymya_3359_b5_lattice_core - Kernel core for B5 lattice logic.
  */
 int nymya_3359_b5_lattice_core(nymya_qpos5d_k *k_q, size_t count) {
     int ret;
-    const int64_t EPS_FP=(int64_t)(1.00*FIXED_POINT_SCALE);
-    const int64_t EPS2=fixed_point_square(EPS_FP);
-    for (size_t i=0;i<count;i++) {
-        ret=hadamard(&k_q[i].q);
-        if (ret) return ret;
-    }
-    for (size_t i=0;i<count;i++) {
-        for (size_t j=i+1;j<count;j++) {
-            if (dist5d_squared_k(&k_q[i],&k_q[j])<=EPS2) {
-                ret=cnot(&k_q[i].q,&k_q[j].q);
-                if (ret) return ret;
-            }
-        }
-    }
+
+    ret = nymya_lattice5d_entangle(3359, k_q, count, B5_NEIGHBOR_DIST_FP, B5_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
     log_symbolic_event("B5_LATTICE",k_q[0].q.id,k_q[0].q.tag,
                        "5D B5 lattice entangled");
     return 0;
 }
 EXPORT_SYMBOL_GPL(nymya_3359_b5_lattice_core);
 
-SYSCALL_DEFINE2(nymya_3359_b5_lattice,
+/**
+ * nymya_3359_b5_lattice_soa_core - nymya_3359_b5_lattice_core() on separate coordinate arrays.
+ * @sites: Sites with all five axes set.
+ *
+ * Returns 0 on success, -EINVAL for fewer than B5_MIN_SITES sites, -ENOMEM,
+ * or the first gate error.
+ */
+int nymya_3359_b5_lattice_soa_core(const struct nymya_lattice_soa *sites) {
+    int ret;
+
+    if (!sites || sites->count < B5_MIN_SITES)
+        return -EINVAL;
+
+    ret = nymya_lattice5d_entangle_soa(3359, sites, B5_NEIGHBOR_DIST_FP, B5_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
+    log_symbolic_event("B5_LATTICE", sites->qubits->id, sites->qubits->tag,
+                       "5D B5 lattice entangled");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3359_b5_lattice_soa_core);
+
+// The short roots of B5, +-e_i: the neighbours of a Z^5 site within the
+// unit cutoff. The long roots (+-e_i +-e_j) lie sqrt(2) away, beyond it.
+static const int8_t b5_short_roots[10][5] = {
+    {  1,  0,  0,  0,  0 }, { -1,  0,  0,  0,  0 }, {  0,  1,  0,  0,  0 }, {  0, -1,  0,  0,  0 },
+    {  0,  0,  1,  0,  0 }, {  0,  0, -1,  0,  0 }, {  0,  0,  0,  1,  0 }, {  0,  0,  0, -1,  0 },
+    {  0,  0,  0,  0,  1 }, {  0,  0,  0,  0, -1 },
+};
+
+/**
+ * nymya_3359_b5_lattice_exact_core - nymya_3359_b5_lattice_soa_core() on integer coordinates.
+ * @sites: Sites with all five coordinates set to plain integers.
+ *
+ * Sites pair when they differ by a unit vector, found by probing the 10
+ * short roots from each site, so no distance is computed or rounded. Gives
+ * the same result as the Q32.32 form on the same coordinates.
+ *
+ * Returns 0 on success, -EINVAL for fewer than B5_MIN_SITES sites or a
+ * periodic box, -ENOMEM, -EINTR, or the first gate error.
+ */
+int nymya_3359_b5_lattice_exact_core(const struct nymya_lattice_soa *sites) {
+    int ret;
+
+    if (!sites || sites->count < B5_MIN_SITES)
+        return -EINVAL;
+
+    ret = nymya_lattice5d_entangle_exact(3359, sites, &b5_short_roots[0][0], ARRAY_SIZE(b5_short_roots));
+    if (ret) return ret;
+
+    log_symbolic_event("B5_LATTICE", sites->qubits->id, sites->qubits->tag,
+                       "5D B5 lattice entangled");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3359_b5_lattice_exact_core);
+
+/**
+ * nymya_3359_b5_lattice_topo - Finds the B5 lattice's neighbour pairs for NYMYA_TOPO_BUILD.
+ * @sites: Sites with the coordinates set; the qubits are not read.
+ * @topo: Receives the pairs; released with nymya_lattice_topo_free().
+ *
+ * Returns 0 on success, -EINVAL for fewer than B5_MIN_SITES sites, -ENOMEM
+ * or -EINTR.
+ */
+int nymya_3359_b5_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo) {
+    if (!sites || sites->count < B5_MIN_SITES)
+        return -EINVAL;
+
+    return nymya_lattice5d_topo_build(3359, sites, B5_NEIGHBOR_DIST_FP, B5_NEIGHBOR_EPS2, topo);
+}
+EXPORT_SYMBOL_GPL(nymya_3359_b5_lattice_topo);
+
+NYMYA_SYSCALL_DEFINE2(3359, nymya_3359_b5_lattice,
     unsigned long, user_ptr,
     size_t, count) {
     nymya_qpos5d_k *k_q;
     nymya_qpos5d_k __user *u_q=(nymya_qpos5d_k __user*)user_ptr;
     int ret;
-    if (!u_q||count<32) return -EINVAL;
-    k_q=kmalloc_array(count,sizeof(*k_q),GFP_KERNEL);
+    if (!u_q||count < B5_MIN_SITES) return -EINVAL;
+    ret = nymya_lattice_check_size(count);
+    if (ret) return ret;
+    k_q = nymya_stage_alloc(3359, count, sizeof(*k_q));
     if (!k_q) return -ENOMEM;
-    if (copy_from_user(k_q,u_q,count*sizeof(*k_q))) {ret=-EFAULT;goto out;}
-    ret=nymya_3359_b5_lattice_core(k_q,count);
-    if (!ret) if (copy_to_user(u_q,k_q,count*sizeof(*k_q))) ret=-EFAULT;
+    if (nymya_copy_from_user(3359, k_q,u_q,count*sizeof(*k_q))) {ret=-EFAULT;goto out;}
+    ret = NYMYA_TRACE_CORE(3359, k_q[0].q.id, 0, nymya_3359_b5_lattice_core(k_q, count));
+    if (!ret) if (nymya_copy_to_user(3359, u_q,k_q,count*sizeof(*k_q))) ret=-EFAULT;
 out:
-    kfree(k_q);
+    nymya_stage_free(k_q);
     return ret;
 }
 #endif
\ No newline at end of file
@@ -20,31 +20,29 @@
  */
 int nymya_3360_e5_projected_lattice(nymya_qpos5d q[], size_t count) {
     if (!q || count < 40) return -1;
-    nymya_qpos5d_k *buf = malloc(count * sizeof(*buf));
+    nymya_qpos5d_k *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, count * sizeof(*buf));
     if (!buf) return -ENOMEM;
-    for (size_t i = 0; i < count; i++) {
-        buf[i].q = q[i].q;
-        buf[i].x = (int64_t)(q[i].x * FIXED_POINT_SCALE);
-        buf[i].y = (int64_t)(q[i].y * FIXED_POINT_SCALE);
-        buf[i].z = (int64_t)(q[i].z * FIXED_POINT_SCALE);
-        buf[i].w = (int64_t)(q[i].w * FIXED_POINT_SCALE);
-        buf[i].v = (int64_t)(q[i].v * FIXED_POINT_SCALE);
-    }
-    long ret = syscall(__NR_nymya_3360_e5_projected_lattice, (unsigned long)buf, count);
+    nymya_qpos5d_to_k(q, buf, count);
+    long ret = NYMYA_CALL_GATE(__NR_nymya_3360_e5_projected_lattice, (uintptr_t)buf, count);
     if (ret == 0) {
-        for (size_t i = 0; i < count; i++) {
-            q[i].q = buf[i].q;
-            q[i].x = (double)buf[i].x / FIXED_POINT_SCALE;
-            q[i].y = (double)buf[i].y / FIXED_POINT_SCALE;
-            q[i].z = (double)buf[i].z / FIXED_POINT_SCALE;
-            q[i].w = (double)buf[i].w / FIXED_POINT_SCALE;
-            q[i].v = (double)buf[i].v / FIXED_POINT_SCALE;
-        }
+        nymya_qpos5d_from_k(buf, q, count);
     }
-    free(buf);
     return (int)ret;
 }
 
+/**
+ * nymya_3360_e5_projected_lattice_k - nymya_3360_e5_projected_lattice() on sites already in the kernel layout.
+ * @q: array of nymya_qpos5d_k with length count, handed to the syscall as is
+ * @count: number of qubits (>=40)
+ *
+ * No conversion and no copy: the syscall updates @q in place.
+ * Returns 0 on success, -1 on invalid input, or syscall code.
+ */
+int nymya_3360_e5_projected_lattice_k(nymya_qpos5d_k q[], size_t count) {
+    if (!q || count < 40) return -1;
+    return (int)NYMYA_CALL_GATE(__NR_nymya_3360_e5_projected_lattice, (uintptr_t)q, count);
+}
+
 #else // __KERNEL__
     int nymya_3360_e5_projected_lattice_core(nymya_qpos5d_k *k_q, size_t count);
 
@@ -55,45 +53,67 @@ int nymya_3360_e5_projected_lattice(nymya_qpos5d q[], size_t count) {
 #include <linux/slab.h>
 #include <linux/module.h>
 
-static int64_t dist5d_squared_k(const nymya_qpos5d_k *a, const nymya_qpos5d_k *b) {
-    int64_t dx = a->x - b->x;
-    int64_t dy = a->y - b->y;
-    int64_t dz = a->z - b->z;
-    int64_t dw = a->w - b->w;
-    int64_t dv = a->v - b->v;
-    return fixed_point_square(dx) +
-           fixed_point_square(dy) +
-           fixed_point_square(dz) +
-           fixed_point_square(dw) +
-           fixed_point_square(dv);
-}
+// Nearest-neighbour cutoff and its square (Q32.32)
+#define E5_NEIGHBOR_DIST_FP ((int64_t)(1.05 * FIXED_POINT_SCALE))
+#define E5_NEIGHBOR_EPS2    fixed_point_square(E5_NEIGHBOR_DIST_FP)
+
+// Smallest lattice the syscalls accept
+#define E5_MIN_SITES 40
 
 /**
  * nymya_3360_e5_projected_lattice_core - Kernel core logic for E5 projected lattice.
  */
 int nymya_3360_e5_projected_lattice_core(nymya_qpos5d_k *k_q, size_t count) {
     int ret;
-    const int64_t EPS_FP = (int64_t)(1.05 * FIXED_POINT_SCALE);
-    const int64_t EPS2 = fixed_point_square(EPS_FP);
-    for (size_t i = 0; i < count; i++) {
-        ret = hadamard(&k_q[i].q);
-        if (ret) return ret;
-    }
-    for (size_t i = 0; i < count; i++) {
-        for (size_t j = i + 1; j < count; j++) {
-            if (dist5d_squared_k(&k_q[i], &k_q[j]) <= EPS2) {
-                ret = cnot(&k_q[i].q, &k_q[j].q);
-                if (ret) return ret;
-            }
-        }
-    }
+
+    ret = nymya_lattice5d_entangle(3360, k_q, count, E5_NEIGHBOR_DIST_FP, E5_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
     log_symbolic_event("E5_PROJECTED", k_q[0].q.id, k_q[0].q.tag,
                        "Projected E5 root lattice entanglement");
     return 0;
 }
 EXPORT_SYMBOL_GPL(nymya_3360_e5_projected_lattice_core);
 
-SYSCALL_DEFINE2(nymya_3360_e5_projected_lattice,
+/**
+ * nymya_3360_e5_projected_lattice_soa_core - nymya_3360_e5_projected_lattice_core() on separate coordinate arrays.
+ * @sites: Sites with all five axes set.
+ *
+ * Returns 0 on success, -EINVAL for fewer than E5_MIN_SITES sites, -ENOMEM,
+ * or the first gate error.
+ */
+int nymya_3360_e5_projected_lattice_soa_core(const struct nymya_lattice_soa *sites) {
+    int ret;
+
+    if (!sites || sites->count < E5_MIN_SITES)
+        return -EINVAL;
+
+    ret = nymya_lattice5d_entangle_soa(3360, sites, E5_NEIGHBOR_DIST_FP, E5_NEIGHBOR_EPS2);
+    if (ret) return ret;
+
+    log_symbolic_event("E5_PROJECTED", sites->qubits->id, sites->qubits->tag,
+                       "Projected E5 root lattice entanglement");
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3360_e5_projected_lattice_soa_core);
+
+/**
+ * nymya_3360_e5_projected_lattice_topo - Finds the E5 projected lattice's neighbour pairs for NYMYA_TOPO_BUILD.
+ * @sites: Sites with the coordinates set; the qubits are not read.
+ * @topo: Receives the pairs; released with nymya_lattice_topo_free().
+ *
+ * Returns 0 on success, -EINVAL for fewer than E5_MIN_SITES sites, -ENOMEM
+ * or -EINTR.
+ */
+int nymya_3360_e5_projected_lattice_topo(const struct nymya_lattice_soa *sites, struct nymya_lattice_topo *topo) {
+    if (!sites || sites->count < E5_MIN_SITES)
+        return -EINVAL;
+
+    return nymya_lattice5d_topo_build(3360, sites, E5_NEIGHBOR_DIST_FP, E5_NEIGHBOR_EPS2, topo);
+}
+EXPORT_SYMBOL_GPL(nymya_3360_e5_projected_lattice_topo);
+
+NYMYA_SYSCALL_DEFINE2(3360, nymya_3360_e5_projected_lattice,
     unsigned long, user_ptr,
     size_t, count) {
 
@@ -101,17 +121,20 @@ SYSCALL_DEFINE2(nymya_3360_e5_projected_lattice,
     nymya_qpos5d_k __user *u_q = (nymya_qpos5d_k __user *)user_ptr;
     int ret;
 
-    if (!u_q || count < 40)
+    if (!u_q || count < E5_MIN_SITES)
         return -EINVAL;
-    k_q = kmalloc_array(count, sizeof(*k_q), GFP_KERNEL);
+    ret = nymya_lattice_check_size(count);
+    if (ret)
+        return ret;
+    k_q = nymya_stage_alloc(3360, count, sizeof(*k_q));
     if (!k_q)
         return -ENOMEM;
-    if (copy_from_user(k_q, u_q, count * sizeof(*k_q))) { ret = -EFAULT; goto out; }
-    ret = nymya_3360_e5_projected_lattice_core(k_q, count);
-    if (!ret && copy_to_user(u_q, k_q, count * sizeof(*k_q)))
+    if (nymya_copy_from_user(3360, k_q, u_q, count * sizeof(*k_q))) { ret = -EFAULT; goto out; }
+    ret = NYMYA_TRACE_CORE(3360, k_q[0].q.id, 0, nymya_3360_e5_projected_lattice_core(k_q, count));
+    if (!ret && nymya_copy_to_user(3360, u_q, k_q, count * sizeof(*k_q)))
         ret = -EFAULT;
 out:
-    kfree(k_q);
+    nymya_stage_free(k_q);
     return ret;
 }
 #endif
\ No newline at end of file
@@ -16,17 +16,113 @@
     #include <linux/syscalls.h>
     #include <linux/uaccess.h>
     #include <linux/slab.h> // For kmalloc, kfree
-    #include <linux/random.h> // For get_random_u32
+    #include <linux/random.h> // For get_random_bytes, get_random_u64
     #include <linux/module.h> // Required for EXPORT_SYMBOL_GPL
+    #include <linux/moduleparam.h>
+    #include <linux/math64.h> // For mul_u64_u64_shr
+    #include <linux/sched.h>
+    #include <linux/sched/signal.h> // For fatal_signal_pending
     // No stdlib.h, time.h, math.h for kernel
 #endif
 
 #ifndef __KERNEL__
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+
 // Define the syscall number for userland, using the code from nymya.h.
 // This is necessary because syscall() expects the __NR_ prefix.
 #define __NR_nymya_3361_qrng_range NYMYA_QRNG_CODE
 
+/**
+ * struct nymya_qrng_tls - A thread's /dev/nymya_qrng file.
+ * @fd: Open file, or -1 if the device is unavailable.
+ * @range: Range last set on @fd.
+ */
+struct nymya_qrng_tls {
+    int fd;
+    nymya_qrng_range range;
+};
+
+static pthread_once_t nymya_qrng_once = PTHREAD_ONCE_INIT;
+static pthread_key_t nymya_qrng_key;
+
+static void nymya_qrng_tls_free(void *p) {
+    struct nymya_qrng_tls *t = p;
+
+    if (t->fd >= 0) close(t->fd);
+    free(t);
+}
+
+static void nymya_qrng_key_init(void) {
+    pthread_key_create(&nymya_qrng_key, nymya_qrng_tls_free);
+}
+
+/**
+ * nymya_qrng_tls - Returns the calling thread's device file, opening it on first use.
+ *
+ * Each thread has its own file because the range is per file. NULL if the
+ * device could not be opened, in which case the caller falls back to the
+ * syscall.
+ */
+static struct nymya_qrng_tls *nymya_qrng_tls(void) {
+    struct nymya_qrng_tls *t;
+
+    pthread_once(&nymya_qrng_once, nymya_qrng_key_init);
+    t = pthread_getspecific(nymya_qrng_key);
+    if (!t) {
+        t = calloc(1, sizeof(*t));
+        if (!t) return NULL;
+        t->fd = open("/dev/nymya_qrng", O_RDONLY | O_CLOEXEC);
+        t->range.max = UINT64_MAX;
+        if (pthread_setspecific(nymya_qrng_key, t)) {
+            nymya_qrng_tls_free(t);
+            return NULL;
+        }
+    }
+    return t->fd >= 0 ? t : NULL;
+}
+
+/**
+ * nymya_qrng_read - Reads @count values in [@min, @max] from /dev/nymya_qrng.
+ * @t: Calling thread's device file.
+ * @out: Receives the values.
+ * @min: The minimum value (inclusive).
+ * @max: The maximum value (inclusive).
+ * @count: Number of values.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+static int nymya_qrng_read(struct nymya_qrng_tls *t, uint64_t *out,
+                           uint64_t min, uint64_t max, size_t count) {
+    size_t left = count * sizeof(*out);
+    char *p = (char *)out;
+    ssize_t n;
+
+    if (t->range.min != min || t->range.max != max) {
+        nymya_qrng_range r = { .min = min, .max = max };
+
+        if (ioctl(t->fd, NYMYA_QRNG_SET_RANGE, &r) < 0) return -1;
+        t->range = r;
+    }
+
+    while (left) {
+        n = read(t->fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) {
+            errno = EIO;
+            return -1;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    return 0;
+}
+
 /**
  * nymya_3361_qrng_range - Userland wrapper for the QRNG syscall.
  * @out: Pointer to an array where the generated random numbers will be stored.
@@ -34,28 +130,28 @@
  * @max: The maximum value for the random numbers (inclusive).
  * @count: The number of random numbers to generate.
  *
- * This function simulates quantum random number generation in userland.
- * It initializes qubits, applies quantum gates (symbolically), and then
- * generates a random bit to determine the output value within the specified range.
+ * Reads the values from /dev/nymya_qrng through a per-thread file, which
+ * fills @out directly. Falls back to the syscall when the device is
+ * unavailable or NYMYA_BACKEND_LOCAL or _PLUGIN is in force; the syscall also runs
+ * the symbolic gates when the qrng_symbolic module parameter is set.
  *
  * Returns:
  * - 0 on success.
- * - -1 if input parameters are invalid.
+ * - -1 if input parameters are invalid or the device read failed.
+ * - The syscall's return code on the fallback path.
  */
 int nymya_3361_qrng_range(uint64_t* out, uint64_t min, uint64_t max, size_t count) {
+    struct nymya_qrng_tls *t;
+    int backend;
+
     if (!out || min >= max || count == 0) return -1;
 
-    // In userland, we can still use stdlib's rand for demonstration or testing
-    // if a true quantum RNG is not available.
-    static int seeded = 0;
-    if (!seeded) {
-        srand((unsigned int)time(NULL)); // Seed RNG in userland
-        seeded = 1;
-    }
+    backend = nymya_backend_get();
+    t = backend == NYMYA_BACKEND_LOCAL || backend == NYMYA_BACKEND_PLUGIN ? NULL : nymya_qrng_tls();
+    if (t) return nymya_qrng_read(t, out, min, max, count);
 
-    // The userland function now primarily acts as a wrapper to call the kernel syscall.
     // The actual QRNG logic resides in the kernel implementation.
-    long ret = syscall(__NR_nymya_3361_qrng_range, (unsigned long)out, min, max, count);
+    long ret = NYMYA_CALL_GATE(__NR_nymya_3361_qrng_range, (uintptr_t)out, min, max, count);
 
     return (int)ret;
 }
@@ -69,75 +165,134 @@ extern int hadamard(nymya_qubit *q);
 extern int global_phase(nymya_qubit *q, int64_t theta_fp);
 extern int log_symbolic_event(const char* gate, uint64_t id, const char* tag, const char* msg);
 
+static bool qrng_symbolic;
+module_param(qrng_symbolic, bool, 0644);
+MODULE_PARM_DESC(qrng_symbolic, "Run the symbolic Hadamard/phase gates and log an event per QRNG value (slow, legacy behaviour)");
 
 /**
- * @brief Performs the core logic for Quantum Random Number Generation within a range.
+ * nymya_qrng_bounded - Maps a random word into [0, @range) without bias.
+ * @x: Uniform 64-bit random word.
+ * @range: Size of the output range, nonzero.
  *
- * This function simulates quantum random number generation. It performs
- * symbolic quantum operations (Hadamard, Global Phase) on a conceptual qubit
- * for each number generated, and then uses a kernel-safe pseudo-random number
- * generator to produce a bit, which is scaled to the desired range.
+ * Lemire's multiply-shift: the high word of @x * @range is the result, and
+ * the low word tells whether @x fell in the short band that would favour
+ * some outputs. Those draws, fewer than one in 2^64 / @range, are replaced
+ * with fresh words from get_random_u64().
  *
- * It handles the allocation of temporary kernel memory, the generation loop,
- * and copying the results back to user space.
+ * Returns the mapped value.
+ */
+static inline u64 nymya_qrng_bounded(u64 x, u64 range)
+{
+    u64 low = x * range;
+
+    if (unlikely(low < range)) {
+        u64 floor = -range % range;
+
+        while (low < floor) {
+            x = get_random_u64();
+            low = x * range;
+        }
+    }
+    return mul_u64_u64_shr(x, range, 64);
+}
+
+/**
+ * nymya_qrng_fill - Fills a kernel buffer with uniform values in [min, max].
+ * @buf: Buffer of @n values.
+ * @n: Number of values.
+ * @min: The minimum value (inclusive).
+ * @max: The maximum value (inclusive), at least @min.
  *
- * @param user_out Pointer to a user-space array of uint64_t where the generated numbers will be stored.
- * @param min The minimum value for the random numbers (inclusive).
- * @param max The maximum value for the random numbers (inclusive).
- * @param count The number of random numbers to generate.
+ * Draws the words with one get_random_bytes() and maps them with
+ * nymya_qrng_bounded(); a full 64-bit range takes the words as they are.
+ * Shared by the 3361 syscall and /dev/nymya_qrng.
+ */
+void nymya_qrng_fill(u64 *buf, size_t n, u64 min, u64 max)
+{
+    // range wraps to 0 when [min, max] is all of u64
+    u64 range = max - min + 1;
+    size_t i;
+
+    get_random_bytes(buf, n * sizeof(*buf));
+    if (range)
+        for (i = 0; i < n; i++)
+            buf[i] = min + nymya_qrng_bounded(buf[i], range);
+}
+EXPORT_SYMBOL_GPL(nymya_qrng_fill);
+
+/**
+ * nymya_qrng_symbolic - Legacy per-value gates and event for qrng_symbolic.
+ * @id: Index of the value in the call.
+ * @value: Value generated.
+ * @min: Low end of the range, logged as "0"; anything else is logged as "1".
+ */
+static void nymya_qrng_symbolic(size_t id, u64 value, u64 min)
+{
+    struct nymya_qubit q = {
+        .id = id,
+        .tag = "qrng",
+        .amplitude = make_complex(FIXED_POINT_SCALE, 0)
+    };
+
+    hadamard(&q);
+    global_phase(&q, 0);
+    log_symbolic_event("QRNG_BIT", q.id, q.tag, value == min ? "0" : "1");
+}
+
+/**
+ * nymya_3361_qrng_range - Fills a user array with uniform values in [min, max].
+ * @user_out: User-space array of @count uint64_t for the values.
+ * @min: The minimum value for the random numbers (inclusive).
+ * @max: The maximum value for the random numbers (inclusive).
+ * @count: The number of random numbers to generate.
  *
- * @return 0 on success.
- * @return -EINVAL if input parameters are invalid.
- * @return -ENOMEM if kernel memory allocation fails.
- * @return -EFAULT if copying data to user space fails.
+ * Generates NYMYA_QRNG_CHUNK values at a time with nymya_qrng_fill() and
+ * copies the chunk out, so the staging buffer stays at 4 KiB whatever
+ * @count is. The symbolic gates and the per-value event only run when the
+ * qrng_symbolic module parameter is set.
+ *
+ * Return:
+ * - 0 on success.
+ * - -EINVAL if input parameters are invalid.
+ * - -ENOMEM if the staging buffer cannot be allocated.
+ * - -EFAULT if copying to user space fails; earlier chunks stay written.
+ * - -EINTR if the task is killed part way.
  */
 int nymya_3361_qrng_range(uint64_t __user *user_out, uint64_t min, uint64_t max, size_t count) {
+    size_t done, n, i;
+    uint64_t *k_out;
     int ret = 0;
-    uint64_t* k_out = NULL;
 
     if (!user_out || min >= max || count == 0)
         return -EINVAL;
 
-    k_out = kmalloc(sizeof(uint64_t) * count, GFP_KERNEL);
+    k_out = nymya_stage_alloc(3361, min_t(size_t, count, NYMYA_QRNG_CHUNK), sizeof(*k_out));
     if (!k_out)
         return -ENOMEM;
 
-    // Use get_random_u32 for kernel-safe random number generation.
-    // This function draws from the kernel's entropy pool and does not
-    // require explicit seeding within this syscall.
-
-    for (size_t i = 0; i < count; i++) {
-        // Conceptual qubit for symbolic operations
-        struct nymya_qubit q = {
-            .id = i,
-            .tag = "qrng",
-            .amplitude = make_complex(FIXED_POINT_SCALE, 0) // Initialize to |0> state in fixed-point
-        };
-
-        // Symbolic quantum operations
-        // These functions are assumed to modify the amplitude of 'q' symbolically
-        // or perform other logging/tracking.
-        hadamard(&q);          // Symbolic superposition
-        global_phase(&q, 0);   // Symbolic identity phase (0 in fixed-point)
-
-        // Generate a pseudo-random bit using kernel's get_random_u32
-        // We only need a bit, so we mask the result.
-        int bit = get_random_u32() & 1; // Get a single random bit (0 or 1)
-
-        // Map the random bit to either min or max.
-        // This simulates a binary outcome from a quantum measurement.
-        k_out[i] = bit == 0 ? min : max;
-
-        // Log the symbolic event for the generated bit
-        log_symbolic_event("QRNG_BIT", q.id, q.tag, bit ? "1" : "0");
-    }
+    for (done = 0; done < count; done += n) {
+        n = min_t(size_t, count - done, NYMYA_QRNG_CHUNK);
+        nymya_qrng_fill(k_out, n, min, max);
+
+        if (unlikely(qrng_symbolic))
+            for (i = 0; i < n; i++)
+                nymya_qrng_symbolic(done + i, k_out[i], min);
+
+        if (nymya_copy_to_user(3361, user_out + done, k_out, n * sizeof(*k_out))) {
+            ret = -EFAULT;
+            break;
+        }
 
-    // Copy generated numbers to user space
-    if (copy_to_user(user_out, k_out, sizeof(uint64_t) * count)) {
-        ret = -EFAULT;
+        if (done + n < count) {
+            if (fatal_signal_pending(current)) {
+                ret = -EINTR;
+                break;
+            }
+            cond_resched();
+        }
     }
 
-    kfree(k_out);
+    nymya_stage_free(k_out);
     return ret;
 }
 EXPORT_SYMBOL_GPL(nymya_3361_qrng_range);
@@ -159,16 +314,16 @@ EXPORT_SYMBOL_GPL(nymya_3361_qrng_range);
  * - -EINVAL if input parameters are invalid.
  * - -ENOMEM if kernel memory allocation fails.
  * - -EFAULT if copying data to user space fails.
+ * - -EINTR if the task is killed part way.
  */
-SYSCALL_DEFINE4(nymya_3361_qrng_range,
+NYMYA_SYSCALL_DEFINE4(3361, nymya_3361_qrng_range,
     uint64_t __user *, user_out,
     uint64_t, min,
     uint64_t, max,
     size_t, count) {
-    // The actual logic, including input validation, memory allocation/deallocation,
-    // QRNG simulation, and copy_to_user, is now encapsulated in the
-    // nymya_3361_qrng_range function.
-    return nymya_3361_qrng_range(user_out, min, max, count);
+    // The actual logic, including input validation, chunked generation and
+    // copy_to_user, is encapsulated in the nymya_3361_qrng_range function.
+    return NYMYA_TRACE_CORE(3361, 0, 0, nymya_3361_qrng_range(user_out, min, max, count));
 }
 
 #endif
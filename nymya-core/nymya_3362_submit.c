@@ -0,0 +1,394 @@
+// src/nymya_3362_submit.c
+//
+// Implements nymya_3362_submit syscall: applies a batch of gate records to a
+// contiguous qubit array in a single kernel entry. The qubits are copied in
+// once, each record is dispatched to the existing gate core, and the qubits
+// are copied out once, instead of one syscall and two copies per gate.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#define __NR_nymya_3362_submit NYMYA_SUBMIT_CODE
+
+/**
+ * nymya_3362_submit - Userland wrapper for batched gate submission.
+ * @ops: Gate records, applied in order.
+ * @op_count: Number of records in @ops.
+ * @qubits: Qubit array the records index into.
+ * @qubit_count: Number of qubits in @qubits.
+ *
+ * Converts the amplitudes to fixed-point, invokes the syscall, then rescales
+ * the results. If a signal ends the batch early, the syscall returns the
+ * number of records it applied and the fixed-point qubits so far, and the
+ * wrapper resubmits the rest on them until the batch is done.
+ *
+ * Returns 0 on success, -1 on invalid input or memory failure, or the
+ * syscall's return code.
+ */
+int nymya_3362_submit(const nymya_op *ops, size_t op_count, nymya_qubit *qubits, size_t qubit_count) {
+    if (!ops || !qubits || op_count == 0 || qubit_count == 0) return -1;
+    if (op_count > NYMYA_SUBMIT_MAX_OPS || qubit_count > NYMYA_SUBMIT_MAX_QUBITS) return -1;
+
+    nymya_qubit_k *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, qubit_count * sizeof(*buf));
+    if (!buf) return -1;
+
+    // Scale to fixed-point
+    for (size_t i = 0; i < qubit_count; i++) {
+        buf[i].id = qubits[i].id;
+        memcpy(buf[i].tag, qubits[i].tag, NYMYA_TAG_MAXLEN);
+        buf[i].re = (int64_t)(creal(qubits[i].amplitude) * FIXED_POINT_SCALE);
+        buf[i].im = (int64_t)(cimag(qubits[i].amplitude) * FIXED_POINT_SCALE);
+    }
+
+    long ret;
+    while ((ret = NYMYA_CALL_GATE(__NR_nymya_3362_submit, (uintptr_t)ops, op_count,
+                                  (uintptr_t)buf, qubit_count)) > 0 &&
+           (size_t)ret < op_count) {
+        ops += ret;
+        op_count -= ret;
+    }
+
+    if (ret >= 0) {
+        // Rescale back
+        for (size_t i = 0; i < qubit_count; i++) {
+            qubits[i].amplitude = (double)buf[i].re / FIXED_POINT_SCALE
+                                + (double)buf[i].im / FIXED_POINT_SCALE * I;
+        }
+    }
+    return ret > 0 ? 0 : (int)ret;
+}
+
+#else // __KERNEL__
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/syscalls.h>
+#include <linux/uaccess.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <linux/sched/signal.h>
+
+// Kernel cores that are not exported under their public gate name
+int nymya_3301_identity_core(struct nymya_qubit *kq);
+int nymya_3305_pauli_z_core(struct nymya_qubit *kq);
+int nymya_3312_double_controlled_not_core(struct nymya_qubit *qc1, struct nymya_qubit *qc2, struct nymya_qubit *qt);
+int nymya_3318_controlled_phase_s_core(struct nymya_qubit *k_qc, struct nymya_qubit *k_qt);
+int nymya_3344_peres_kernel_logic(struct nymya_qubit *q1, struct nymya_qubit *q2, struct nymya_qubit *q3);
+
+typedef int (*nymya_submit_fn)(const nymya_op *op, struct nymya_qubit *kq);
+
+// Kernel core calls on a record's operands, by shape; empty = no record form
+#define NYMYA_SUBMIT_K_Q(kcore)            kcore(&kq[op->qubit[0]])
+#define NYMYA_SUBMIT_K_Q_THETA(kcore)      kcore(&kq[op->qubit[0]], op->param)
+#define NYMYA_SUBMIT_K_Q_AXIS_THETA(kcore) kcore(&kq[op->qubit[0]], (char)op->axis, op->param)
+#define NYMYA_SUBMIT_K_Q2(kcore)           kcore(&kq[op->qubit[0]], &kq[op->qubit[1]])
+#define NYMYA_SUBMIT_K_Q2_THETA(kcore)     kcore(&kq[op->qubit[0]], &kq[op->qubit[1]], op->param)
+#define NYMYA_SUBMIT_K_Q3(kcore)           kcore(&kq[op->qubit[0]], &kq[op->qubit[1]], &kq[op->qubit[2]])
+
+#define NYMYA_SUBMIT_FN(code, call)                                             \
+    static int nymya_submit_##code(const nymya_op *op, struct nymya_qubit *kq)  \
+    {                                                                           \
+        return call;                                                            \
+    }
+#define NYMYA_SUBMIT_FN_Q(code, kcore)            NYMYA_SUBMIT_FN(code, NYMYA_SUBMIT_K_Q(kcore))
+#define NYMYA_SUBMIT_FN_Q_THETA(code, kcore)      NYMYA_SUBMIT_FN(code, NYMYA_SUBMIT_K_Q_THETA(kcore))
+#define NYMYA_SUBMIT_FN_Q_AXIS_THETA(code, kcore) NYMYA_SUBMIT_FN(code, NYMYA_SUBMIT_K_Q_AXIS_THETA(kcore))
+#define NYMYA_SUBMIT_FN_Q2(code, kcore)           NYMYA_SUBMIT_FN(code, NYMYA_SUBMIT_K_Q2(kcore))
+#define NYMYA_SUBMIT_FN_Q2_THETA(code, kcore)     NYMYA_SUBMIT_FN(code, NYMYA_SUBMIT_K_Q2_THETA(kcore))
+#define NYMYA_SUBMIT_FN_Q3(code, kcore)           NYMYA_SUBMIT_FN(code, NYMYA_SUBMIT_K_Q3(kcore))
+#define NYMYA_SUBMIT_FN_QARR(code, kcore)
+#define NYMYA_SUBMIT_FN_QLIST(code, kcore)
+#define NYMYA_SUBMIT_FN_QPOS3(code, kcore)
+#define NYMYA_SUBMIT_FN_QPOS4(code, kcore)
+#define NYMYA_SUBMIT_FN_QPOS5(code, kcore)
+#define NYMYA_SUBMIT_FN_ORACLE(code, kcore)
+#define NYMYA_SUBMIT_FN_QRNG(code, kcore)
+
+#define NYMYA_SUBMIT_DEFINE(code, name, shape, n_min, kcore) NYMYA_SUBMIT_FN_##shape(code, kcore)
+NYMYA_GATES(NYMYA_SUBMIT_DEFINE)
+#undef NYMYA_SUBMIT_DEFINE
+
+// Record-form entry of each shape in nymya_submit_fns[]
+#define NYMYA_SUBMIT_SLOT(code) [(code) - NYMYA_GATE_FIRST] = nymya_submit_##code,
+#define NYMYA_SUBMIT_SLOT_Q(code)            NYMYA_SUBMIT_SLOT(code)
+#define NYMYA_SUBMIT_SLOT_Q_THETA(code)      NYMYA_SUBMIT_SLOT(code)
+#define NYMYA_SUBMIT_SLOT_Q_AXIS_THETA(code) NYMYA_SUBMIT_SLOT(code)
+#define NYMYA_SUBMIT_SLOT_Q2(code)           NYMYA_SUBMIT_SLOT(code)
+#define NYMYA_SUBMIT_SLOT_Q2_THETA(code)     NYMYA_SUBMIT_SLOT(code)
+#define NYMYA_SUBMIT_SLOT_Q3(code)           NYMYA_SUBMIT_SLOT(code)
+#define NYMYA_SUBMIT_SLOT_QARR(code)
+#define NYMYA_SUBMIT_SLOT_QLIST(code)
+#define NYMYA_SUBMIT_SLOT_QPOS3(code)
+#define NYMYA_SUBMIT_SLOT_QPOS4(code)
+#define NYMYA_SUBMIT_SLOT_QPOS5(code)
+#define NYMYA_SUBMIT_SLOT_ORACLE(code)
+#define NYMYA_SUBMIT_SLOT_QRNG(code)
+
+#define NYMYA_SUBMIT_ENTRY(code, name, shape, n_min, kcore) NYMYA_SUBMIT_SLOT_##shape(code)
+// Record-form gates by code - NYMYA_GATE_FIRST, generated from NYMYA_GATES
+static const nymya_submit_fn nymya_submit_fns[NYMYA_GATE_COUNT] = {
+    NYMYA_GATES(NYMYA_SUBMIT_ENTRY)
+};
+#undef NYMYA_SUBMIT_ENTRY
+
+/**
+ * nymya_submit_arity - Number of qubit operands a gate takes in a batch.
+ * @gate_code: NYMYA_*_CODE of the gate.
+ *
+ * Returns 1 to 3, or 0 if the gate cannot be expressed as a nymya_op
+ * (callback gates, array and lattice gates, the QRNG).
+ */
+static unsigned int nymya_submit_arity(uint32_t gate_code)
+{
+    const nymya_gate_desc *d = nymya_gate_lookup(gate_code);
+
+    return d ? d->operands : 0;
+}
+
+/**
+ * nymya_submit_check_op - Validates one gate record against the qubit array.
+ * @op: Gate record.
+ * @qubit_count: Number of qubits in the batch.
+ *
+ * Returns 0 if the gate is supported, every operand index is in range and
+ * the operands are pairwise distinct; -EINVAL otherwise.
+ */
+static int nymya_submit_check_op(const nymya_op *op, size_t qubit_count)
+{
+    unsigned int arity = nymya_submit_arity(op->gate_code);
+    unsigned int i, j;
+
+    if (!arity || op->reserved)
+        return -EINVAL;
+
+    for (i = 0; i < arity; i++) {
+        if (op->qubit[i] >= qubit_count)
+            return -EINVAL;
+        for (j = 0; j < i; j++) {
+            if (op->qubit[i] == op->qubit[j])
+                return -EINVAL;
+        }
+    }
+
+    if (op->gate_code == NYMYA_ROTATE_CODE) {
+        switch (op->axis) {
+        case 'X': case 'x':
+        case 'Y': case 'y':
+        case 'Z': case 'z':
+            break;
+        default:
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * nymya_submit_apply_op - Runs one validated gate record.
+ * @op: Gate record.
+ * @kq: Kernel copy of the batch's qubit array.
+ *
+ * Returns the gate core's return code.
+ */
+static int nymya_submit_apply_op(const nymya_op *op, struct nymya_qubit *kq)
+{
+    // Validated records only carry codes with a slot
+    return nymya_submit_fns[op->gate_code - NYMYA_GATE_FIRST](op, kq);
+}
+
+/**
+ * nymya_3362_submit_run - Validates and applies a batch, stopping early on request.
+ * @ops: Gate records.
+ * @op_count: Number of records in @ops.
+ * @qubits: Kernel-space qubit array the records' operand indices refer to.
+ * @qubit_count: Number of qubits in @qubits.
+ * @partial: Whether a pending signal may end the batch early.
+ *
+ * Every record is validated before any gate runs, so a malformed batch leaves
+ * @qubits untouched. A gate core error stops the batch at that record.
+ *
+ * Every NYMYA_SUBMIT_YIELD records the loop calls cond_resched(), so a
+ * batch of NYMYA_SUBMIT_MAX_OPS records does not hold its CPU, and checks
+ * for signals. A fatal signal ends the batch with -EINTR. With @partial,
+ * any other pending signal ends it too, after a whole number of records;
+ * the return value is then the cursor the caller resumes from.
+ *
+ * Returns:
+ * - Number of records applied: @op_count, or fewer if @partial and a signal
+ *   is pending.
+ * - -EINVAL if an argument or any record is invalid.
+ * - -EINTR if the task was killed.
+ * - Error code from the first failing gate core.
+ */
+long nymya_3362_submit_run(const nymya_op *ops, size_t op_count,
+                           struct nymya_qubit *qubits, size_t qubit_count, bool partial)
+{
+    size_t i;
+    int ret;
+
+    if (!ops || !qubits || op_count == 0 || qubit_count == 0)
+        return -EINVAL;
+
+    for (i = 0; i < op_count; i++) {
+        ret = nymya_submit_check_op(&ops[i], qubit_count);
+        if (ret) {
+            pr_err("nymya_3362_submit_core: Invalid record %zu (gate %u)\n",
+                   i, ops[i].gate_code);
+            return ret;
+        }
+    }
+
+    // Slots past a gate's arity may hold any index; clamp them to a valid
+    // qubit so forming their address stays inside the array.
+    for (i = 0; i < op_count; i++) {
+        nymya_op op = ops[i];
+        unsigned int k;
+
+        if (i && i % NYMYA_SUBMIT_YIELD == 0) {
+            if (fatal_signal_pending(current))
+                return -EINTR;
+            if (partial && signal_pending(current))
+                return i;
+            cond_resched();
+        }
+
+        for (k = nymya_submit_arity(op.gate_code); k < NYMYA_OP_MAX_OPERANDS; k++)
+            op.qubit[k] = 0;
+
+        ret = NYMYA_TRACE_CORE(op.gate_code, qubits[op.qubit[0]].id, qubits[op.qubit[1]].id,
+                               nymya_submit_apply_op(&op, qubits));
+        if (ret) {
+            pr_err("nymya_3362_submit_core: Gate %u at record %zu failed, error %d\n",
+                   op.gate_code, i, ret);
+            return ret;
+        }
+    }
+
+    return op_count;
+}
+EXPORT_SYMBOL_GPL(nymya_3362_submit_run);
+
+/**
+ * nymya_3362_submit_core - Validates and applies a whole batch of gate records in order.
+ * @ops: Gate records.
+ * @op_count: Number of records in @ops.
+ * @qubits: Kernel-space qubit array the records' operand indices refer to.
+ * @qubit_count: Number of qubits in @qubits.
+ *
+ * nymya_3362_submit_run() without early stops: only a fatal signal ends the
+ * batch before its last record.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -EINVAL if an argument or any record is invalid.
+ * - -EINTR if the task was killed.
+ * - Error code from the first failing gate core.
+ */
+int nymya_3362_submit_core(const nymya_op *ops, size_t op_count,
+                           struct nymya_qubit *qubits, size_t qubit_count)
+{
+    long ret = nymya_3362_submit_run(ops, op_count, qubits, qubit_count, false);
+
+    return ret < 0 ? (int)ret : 0;
+}
+EXPORT_SYMBOL_GPL(nymya_3362_submit_core);
+
+/**
+ * nymya_3362_submit_user - Runs a batch whose records and qubits live in user memory.
+ * @user_ops: User-space array of nymya_op records.
+ * @op_count: Number of records.
+ * @user_qubits: User-space contiguous array of qubits.
+ * @qubit_count: Number of qubits.
+ * @partial: Whether a pending signal may end the batch early.
+ *
+ * Copies the records and qubits into the kernel once each, runs the batch,
+ * and copies the qubits back once. Nothing is copied back on failure.
+ * Shared by the nymya_3362_submit syscall, which passes @partial, and the
+ * /dev/nymya_ring queue, which does not.
+ *
+ * A batch a signal ended early is not an error: the qubits are copied back
+ * with the records applied so far, and the return value says how many.
+ * Restarting the call instead would run those records twice, so the
+ * caller resumes at that cursor with the qubits it got back.
+ *
+ * Returns:
+ * - 0 on success.
+ * - Number of records applied, below @op_count, if @partial and a signal
+ *   ended the batch early.
+ * - -EINVAL on invalid arguments or records.
+ * - -ENOMEM if the kernel buffers cannot be allocated.
+ * - -EFAULT on copy failures.
+ * - -EINTR if the task was killed.
+ * - Error code from the first failing gate core.
+ */
+long nymya_3362_submit_user(const nymya_op __user *user_ops, size_t op_count,
+                            struct nymya_qubit __user *user_qubits, size_t qubit_count,
+                            bool partial)
+{
+    nymya_op *k_ops = NULL;
+    struct nymya_qubit *k_qubits = NULL;
+    long ret;
+
+    if (!user_ops || !user_qubits || op_count == 0 || qubit_count == 0)
+        return -EINVAL;
+    if (op_count > NYMYA_SUBMIT_MAX_OPS || qubit_count > NYMYA_SUBMIT_MAX_QUBITS)
+        return -EINVAL;
+
+    k_ops = nymya_stage_alloc(3362, op_count, sizeof(*k_ops));
+    k_qubits = nymya_stage_alloc(3362, qubit_count, sizeof(*k_qubits));
+    if (!k_ops || !k_qubits) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    if (nymya_copy_from_user(3362, k_ops, user_ops, op_count * sizeof(*k_ops)) ||
+        nymya_copy_from_user(3362, k_qubits, user_qubits, qubit_count * sizeof(*k_qubits))) {
+        ret = -EFAULT;
+        goto out;
+    }
+
+    ret = nymya_3362_submit_run(k_ops, op_count, k_qubits, qubit_count, partial);
+    if (ret < 0)
+        goto out;
+    if ((size_t)ret == op_count)
+        ret = 0;
+
+    if (nymya_copy_to_user(3362, user_qubits, k_qubits, qubit_count * sizeof(*k_qubits)))
+        ret = -EFAULT;
+
+out:
+    nymya_stage_free(k_qubits);
+    nymya_stage_free(k_ops);
+    return ret;
+}
+
+/**
+ * SYSCALL_DEFINE4(nymya_3362_submit) - Applies a batch of gate records.
+ * @user_ops: User-space array of nymya_op records.
+ * @op_count: Number of records.
+ * @user_qubits: User-space contiguous array of qubits.
+ * @qubit_count: Number of qubits.
+ *
+ * Returns the result of nymya_3362_submit_user(), which may be a count of
+ * records applied if a signal arrived mid-batch.
+ */
+NYMYA_SYSCALL_DEFINE4(3362, nymya_3362_submit,
+    const struct nymya_op __user *, user_ops,
+    size_t, op_count,
+    struct nymya_qubit __user *, user_qubits,
+    size_t, qubit_count)
+{
+    return nymya_3362_submit_user(user_ops, op_count, user_qubits, qubit_count, true);
+}
+
+#endif
@@ -0,0 +1,268 @@
+// src/nymya_3363_lattice_soa.c
+//
+// Implements nymya_3363_lattice_soa syscall: runs one of the positional
+// lattice gates (3355-3360) on sites given as a qubit array plus one Q32.32
+// array per coordinate, instead of an array of nymya_qpos*d_k records. The
+// neighbour search then reads contiguous coordinates, and only the qubits
+// are copied back out. With NYMYA_LATTICE_PERIODIC on the lattice code the
+// sites sit in a periodic box, whose edges follow the coordinate arrays.
+// With NYMYA_LATTICE_INTEGER, D4 and B5 take plain integer coordinates and
+// find their neighbours exactly.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#define __NR_nymya_3363_lattice_soa NYMYA_LATTICE_SOA_CODE
+
+/*
+ * Shared by nymya_3363_lattice_soa(), _box() and _int(). Exactly one of
+ * @coords and @icoords is set; integer coordinates go to the kernel as they
+ * are. @box NULL is an open lattice.
+ */
+static int nymya_3363_run(unsigned int lattice_code, nymya_qubit qubits[],
+                          const double *const coords[], const int64_t *const icoords[],
+                          const double *box, size_t count) {
+    unsigned int dims = NYMYA_LATTICE_DIMS(lattice_code);
+    uint64_t axes[NYMYA_LATTICE_MAX_DIM + 1];
+    int64_t box_fp[NYMYA_LATTICE_MAX_DIM];
+
+    if (!dims || !qubits || (!coords && !icoords) || count == 0) return -1;
+    for (unsigned int k = 0; k < dims; k++)
+        if (coords ? !coords[k] : !icoords[k]) return -1;
+
+    if (count > SIZE_MAX / (NYMYA_LATTICE_MAX_DIM * sizeof(int64_t))) return -1;
+    nymya_qubit_k *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, count * sizeof(*buf));
+    int64_t *fp = coords ? nymya_scratch_get(NYMYA_SCRATCH_AUX, count * dims * sizeof(*fp)) : NULL;
+    if (!buf || (coords && !fp)) return -1;
+
+    // Scale to fixed-point
+    for (size_t i = 0; i < count; i++) {
+        buf[i].id = qubits[i].id;
+        memcpy(buf[i].tag, qubits[i].tag, NYMYA_TAG_MAXLEN);
+        buf[i].re = (int64_t)(creal(qubits[i].amplitude) * FIXED_POINT_SCALE);
+        buf[i].im = (int64_t)(cimag(qubits[i].amplitude) * FIXED_POINT_SCALE);
+    }
+    for (unsigned int k = 0; k < dims; k++) {
+        int64_t *axis;
+
+        if (!coords) {
+            axes[k] = (uint64_t)(uintptr_t)icoords[k];
+            continue;
+        }
+        axis = fp + (size_t)k * count;
+        for (size_t i = 0; i < count; i++)
+            axis[i] = (int64_t)(coords[k][i] * FIXED_POINT_SCALE);
+        axes[k] = (uint64_t)(uintptr_t)axis;
+    }
+    if (!coords)
+        lattice_code |= NYMYA_LATTICE_INTEGER;
+    if (box) {
+        for (unsigned int k = 0; k < dims; k++)
+            box_fp[k] = (int64_t)(box[k] * FIXED_POINT_SCALE);
+        axes[dims] = (uint64_t)(uintptr_t)box_fp;
+        lattice_code |= NYMYA_LATTICE_PERIODIC;
+    }
+
+    long ret = NYMYA_CALL_GATE(__NR_nymya_3363_lattice_soa, lattice_code, (uintptr_t)buf, (uintptr_t)axes, count);
+
+    if (ret == 0) {
+        // Rescale back; the coordinates are read-only
+        for (size_t i = 0; i < count; i++) {
+            qubits[i].amplitude = (double)buf[i].re / FIXED_POINT_SCALE
+                                + (double)buf[i].im / FIXED_POINT_SCALE * I;
+        }
+    }
+    return (int)ret;
+}
+
+/**
+ * nymya_3363_lattice_soa - Userland wrapper for structure-of-arrays lattice gates.
+ * @lattice_code: NYMYA_*_CODE of the lattice, 3355 to 3360.
+ * @qubits: Qubit of each site, @count entries.
+ * @coords: NYMYA_LATTICE_DIMS(@lattice_code) coordinate arrays of @count entries.
+ * @count: Number of sites.
+ *
+ * Converts the amplitudes and coordinates to fixed-point, invokes the syscall,
+ * then rescales the amplitudes. Returns 0 on success, -1 on invalid input or
+ * memory failure, or the syscall's return code.
+ */
+int nymya_3363_lattice_soa(unsigned int lattice_code, nymya_qubit qubits[],
+                           const double *const coords[], size_t count) {
+    return nymya_3363_run(lattice_code, qubits, coords, NULL, NULL, count);
+}
+
+/**
+ * nymya_3363_lattice_soa_box - Userland wrapper for lattice gates in a periodic box.
+ * @lattice_code: NYMYA_*_CODE of the lattice, 3355 to 3360.
+ * @qubits: Qubit of each site, @count entries.
+ * @coords: NYMYA_LATTICE_DIMS(@lattice_code) coordinate arrays of @count entries.
+ * @box: Box edge along each axis, 0 for an open axis; NULL for an open lattice.
+ * @count: Number of sites.
+ *
+ * As nymya_3363_lattice_soa(), with the box edges scaled to fixed-point and
+ * passed after the coordinate arrays under NYMYA_LATTICE_PERIODIC.
+ */
+int nymya_3363_lattice_soa_box(unsigned int lattice_code, nymya_qubit qubits[],
+                               const double *const coords[], const double *box, size_t count) {
+    return nymya_3363_run(lattice_code, qubits, coords, NULL, box, count);
+}
+
+/**
+ * nymya_3363_lattice_soa_int - Userland wrapper for D4 and B5 on integer coordinates.
+ * @lattice_code: NYMYA_D4_LATTICE_CODE or NYMYA_B5_LATTICE_CODE.
+ * @qubits: Qubit of each site, @count entries.
+ * @coords: NYMYA_LATTICE_DIMS(@lattice_code) integer coordinate arrays of @count entries.
+ * @count: Number of sites.
+ *
+ * As nymya_3363_lattice_soa(), but the coordinate arrays are passed to the
+ * kernel unscaled under NYMYA_LATTICE_INTEGER.
+ */
+int nymya_3363_lattice_soa_int(unsigned int lattice_code, nymya_qubit qubits[],
+                               const int64_t *const coords[], size_t count) {
+    return nymya_3363_run(lattice_code, qubits, NULL, coords, NULL, count);
+}
+
+#else // __KERNEL__
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/syscalls.h>
+#include <linux/uaccess.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <linux/errno.h>
+
+typedef int (*nymya_lattice_soa_fn)(const struct nymya_lattice_soa *sites);
+
+// Integer-coordinate core of each lattice on Z^n, or NULL
+static nymya_lattice_soa_fn nymya_3363_exact_core(unsigned int lattice_code)
+{
+    switch (lattice_code) {
+    case NYMYA_D4_LATTICE_CODE:    return nymya_3358_d4_lattice_exact_core;
+    case NYMYA_B5_LATTICE_CODE:    return nymya_3359_b5_lattice_exact_core;
+    default:                       return NULL;
+    }
+}
+
+// Structure-of-arrays core of each positional lattice gate, or NULL
+static nymya_lattice_soa_fn nymya_3363_core(unsigned int lattice_code)
+{
+    switch (lattice_code) {
+    case NYMYA_FCC_LATTICE_CODE:   return nymya_3355_fcc_lattice_soa_core;
+    case NYMYA_HCP_LATTICE_CODE:   return nymya_3356_hcp_lattice_soa_core;
+    case NYMYA_E8_PROJECTED_CODE:  return nymya_3357_e8_projected_lattice_soa_core;
+    case NYMYA_D4_LATTICE_CODE:    return nymya_3358_d4_lattice_soa_core;
+    case NYMYA_B5_LATTICE_CODE:    return nymya_3359_b5_lattice_soa_core;
+    case NYMYA_E5_PROJECTED_CODE:  return nymya_3360_e5_projected_lattice_soa_core;
+    default:                       return NULL;
+    }
+}
+
+/**
+ * SYSCALL_DEFINE4(nymya_3363_lattice_soa) - Runs a lattice gate on per-axis arrays.
+ * @lattice_code: NYMYA_*_CODE of the lattice, 3355 to 3360, optionally with
+ *                NYMYA_LATTICE_PERIODIC, or 3358 or 3359 with
+ *                NYMYA_LATTICE_INTEGER.
+ * @user_qubits: User-space array of @count qubits; updated in place.
+ * @user_axes: User-space array of NYMYA_LATTICE_DIMS(@lattice_code) addresses,
+ *             each of a Q32.32 int64_t array of @count coordinates (plain
+ *             integers under NYMYA_LATTICE_INTEGER), then under
+ *             NYMYA_LATTICE_PERIODIC the address of the box edges.
+ * @count: Number of sites.
+ *
+ * Copies the qubits and every coordinate array in once, runs the lattice's
+ * _soa_core(), and copies only the qubits back. Nothing is copied back on
+ * failure.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -EINVAL on an unknown lattice code, NULL pointers, too few sites, a
+ *   box edge that is negative or under twice the gate's cutoff, or
+ *   NYMYA_LATTICE_INTEGER on another lattice or with a box.
+ * - -E2BIG if @count is over the lattice_max_sites module parameter.
+ * - -ENOMEM if the kernel buffers cannot be allocated.
+ * - -EINTR if the task is killed part way; the qubits are not copied back.
+ * - -EFAULT on copy failures.
+ * - Error code from the first failing gate core.
+ */
+NYMYA_SYSCALL_DEFINE4(3363, nymya_3363_lattice_soa,
+    unsigned int, lattice_code,
+    struct nymya_qubit __user *, user_qubits,
+    const u64 __user *, user_axes,
+    size_t, count)
+{
+    bool periodic = lattice_code & NYMYA_LATTICE_PERIODIC;
+    bool integer = lattice_code & NYMYA_LATTICE_INTEGER;
+    unsigned int code = lattice_code & ~(NYMYA_LATTICE_PERIODIC | NYMYA_LATTICE_INTEGER);
+    nymya_lattice_soa_fn core = integer ? nymya_3363_exact_core(code) : nymya_3363_core(code);
+    unsigned int dims = NYMYA_LATTICE_DIMS(code);
+    struct nymya_lattice_soa sites = { 0 };
+    struct nymya_qubit *k_qubits = NULL;
+    int64_t *k_coord = NULL;
+    u64 axes[NYMYA_LATTICE_MAX_DIM + 1];
+    unsigned int k;
+    long ret;
+
+    if (!core || (integer && periodic) || !user_qubits || !user_axes || count == 0 ||
+        count >= U32_MAX)
+        return -EINVAL;
+    ret = nymya_lattice_check_size(count);
+    if (ret)
+        return ret;
+
+    if (nymya_copy_from_user(3363, axes, user_axes, (dims + periodic) * sizeof(*axes)))
+        return -EFAULT;
+    if (periodic) {
+        if (!axes[dims])
+            return -EINVAL;
+        if (nymya_copy_from_user(3363, sites.box, u64_to_user_ptr(axes[dims]), dims * sizeof(*sites.box)))
+            return -EFAULT;
+    }
+
+    k_qubits = nymya_stage_alloc(3363, count, sizeof(*k_qubits));
+    k_coord = nymya_stage_alloc(3363, count, dims * sizeof(*k_coord));
+    if (!k_qubits || !k_coord) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    if (nymya_copy_from_user(3363, k_qubits, user_qubits, count * sizeof(*k_qubits))) {
+        ret = -EFAULT;
+        goto out;
+    }
+    for (k = 0; k < dims; k++) {
+        int64_t *axis = k_coord + (size_t)k * count;
+
+        if (!axes[k] || nymya_copy_from_user(3363, axis, u64_to_user_ptr(axes[k]), count * sizeof(*axis))) {
+            ret = axes[k] ? -EFAULT : -EINVAL;
+            goto out;
+        }
+        sites.coord[k] = axis;
+    }
+    sites.qubits = k_qubits;
+    sites.qubit_stride = sizeof(*k_qubits);
+    sites.count = count;
+
+    ret = NYMYA_TRACE_CORE(code, k_qubits[0].id, 0, core(&sites));
+    if (ret)
+        goto out;
+
+    if (nymya_copy_to_user(3363, user_qubits, k_qubits, count * sizeof(*k_qubits)))
+        ret = -EFAULT;
+
+out:
+    nymya_stage_free(k_coord);
+    nymya_stage_free(k_qubits);
+    return ret;
+}
+
+#endif // __KERNEL__
@@ -0,0 +1,175 @@
+// src/nymya_3364_submit_compact.c
+//
+// Implements nymya_3364_submit_compact syscall: nymya_3362_submit on compact
+// qubits. Only IDs, tag handles and amplitudes cross the user boundary; the
+// gate cores still run on struct nymya_qubit, expanded in kernel memory.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#define __NR_nymya_3364_submit_compact NYMYA_SUBMIT_COMPACT_CODE
+
+/**
+ * nymya_3364_submit_compact - Userland wrapper for batched submission on compact qubits.
+ * @ops: Gate records, applied in order.
+ * @op_count: Number of records in @ops.
+ * @qubits: Compact qubit array the records index into.
+ * @qubit_count: Number of qubits in @qubits.
+ *
+ * Converts the amplitudes to fixed-point, invokes the syscall, then rescales
+ * the results, resubmitting the rest of the batch as nymya_3362_submit()
+ * does if a signal ends it early. Returns 0 on success, -1 on invalid input
+ * or memory failure, or the syscall's return code.
+ */
+int nymya_3364_submit_compact(const nymya_op *ops, size_t op_count,
+                              nymya_qubit_c *qubits, size_t qubit_count) {
+    if (!ops || !qubits || op_count == 0 || qubit_count == 0) return -1;
+    if (op_count > NYMYA_SUBMIT_MAX_OPS || qubit_count > NYMYA_SUBMIT_MAX_QUBITS) return -1;
+
+    nymya_qubit_ck *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, qubit_count * sizeof(*buf));
+    if (!buf) return -1;
+
+    // Scale to fixed-point
+    for (size_t i = 0; i < qubit_count; i++) {
+        buf[i].id = qubits[i].id;
+        buf[i].tag = qubits[i].tag;
+        buf[i].flags = qubits[i].flags;
+        buf[i].re = (int64_t)(creal(qubits[i].amplitude) * FIXED_POINT_SCALE);
+        buf[i].im = (int64_t)(cimag(qubits[i].amplitude) * FIXED_POINT_SCALE);
+    }
+
+    long ret;
+    while ((ret = NYMYA_CALL_GATE(__NR_nymya_3364_submit_compact, (uintptr_t)ops, op_count,
+                                  (uintptr_t)buf, qubit_count)) > 0 &&
+           (size_t)ret < op_count) {
+        ops += ret;
+        op_count -= ret;
+    }
+
+    if (ret >= 0) {
+        // Rescale back
+        for (size_t i = 0; i < qubit_count; i++) {
+            qubits[i].amplitude = (double)buf[i].re / FIXED_POINT_SCALE
+                                + (double)buf[i].im / FIXED_POINT_SCALE * I;
+        }
+    }
+    return ret > 0 ? 0 : (int)ret;
+}
+
+#else // __KERNEL__
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/syscalls.h>
+#include <linux/uaccess.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <linux/errno.h>
+
+/**
+ * nymya_qubit_expand - Builds the gate-core view of a compact qubit.
+ * @src: Compact qubit.
+ * @dst: Output qubit; its tag becomes "#<handle>", or empty for NYMYA_TAG_NONE.
+ *
+ * Returns 0, or -EINVAL if @src has reserved flags set.
+ */
+static int nymya_qubit_expand(const struct nymya_qubit_c *src, struct nymya_qubit *dst)
+{
+    if (src->flags)
+        return -EINVAL;
+
+    dst->id = src->id;
+    memset(dst->tag, 0, sizeof(dst->tag));
+    if (src->tag != NYMYA_TAG_NONE)
+        snprintf(dst->tag, sizeof(dst->tag), "#%u", src->tag);
+    dst->amplitude = src->amplitude;
+    return 0;
+}
+
+/**
+ * SYSCALL_DEFINE4(nymya_3364_submit_compact) - Applies a batch of gate records to compact qubits.
+ * @user_ops: User-space array of nymya_op records.
+ * @op_count: Number of records.
+ * @user_qubits: User-space contiguous array of compact qubits.
+ * @qubit_count: Number of qubits.
+ *
+ * Copies the records and compact qubits in once, expands the qubits for the
+ * gate cores, runs the batch through nymya_3362_submit_run(), and copies the
+ * compact qubits back with their new amplitudes. Nothing is copied back on
+ * failure. A signal may end the batch early, as for nymya_3362_submit.
+ *
+ * Returns:
+ * - 0 on success.
+ * - Number of records applied, below @op_count, if a signal ended the
+ *   batch early; the qubits are copied back as they stand.
+ * - -EINVAL on invalid arguments, records or qubit flags.
+ * - -ENOMEM if the kernel buffers cannot be allocated.
+ * - -EFAULT on copy failures.
+ * - -EINTR if the task was killed.
+ * - Error code from the first failing gate core.
+ */
+NYMYA_SYSCALL_DEFINE4(3364, nymya_3364_submit_compact,
+    const struct nymya_op __user *, user_ops,
+    size_t, op_count,
+    struct nymya_qubit_c __user *, user_qubits,
+    size_t, qubit_count)
+{
+    nymya_op *k_ops = NULL;
+    struct nymya_qubit_c *k_compact = NULL;
+    struct nymya_qubit *k_qubits = NULL;
+    size_t i;
+    long ret;
+
+    if (!user_ops || !user_qubits || op_count == 0 || qubit_count == 0)
+        return -EINVAL;
+    if (op_count > NYMYA_SUBMIT_MAX_OPS || qubit_count > NYMYA_SUBMIT_MAX_QUBITS)
+        return -EINVAL;
+
+    k_ops = nymya_stage_alloc(3364, op_count, sizeof(*k_ops));
+    k_compact = nymya_stage_alloc(3364, qubit_count, sizeof(*k_compact));
+    k_qubits = nymya_stage_alloc(3364, qubit_count, sizeof(*k_qubits));
+    if (!k_ops || !k_compact || !k_qubits) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    if (nymya_copy_from_user(3364, k_ops, user_ops, op_count * sizeof(*k_ops)) ||
+        nymya_copy_from_user(3364, k_compact, user_qubits, qubit_count * sizeof(*k_compact))) {
+        ret = -EFAULT;
+        goto out;
+    }
+
+    for (i = 0; i < qubit_count; i++) {
+        ret = nymya_qubit_expand(&k_compact[i], &k_qubits[i]);
+        if (ret)
+            goto out;
+    }
+
+    ret = nymya_3362_submit_run(k_ops, op_count, k_qubits, qubit_count, true);
+    if (ret < 0)
+        goto out;
+    if ((size_t)ret == op_count)
+        ret = 0;
+
+    for (i = 0; i < qubit_count; i++)
+        k_compact[i].amplitude = k_qubits[i].amplitude;
+
+    if (nymya_copy_to_user(3364, user_qubits, k_compact, qubit_count * sizeof(*k_compact)))
+        ret = -EFAULT;
+
+out:
+    nymya_stage_free(k_qubits);
+    nymya_stage_free(k_compact);
+    nymya_stage_free(k_ops);
+    return ret;
+}
+
+#endif // __KERNEL__
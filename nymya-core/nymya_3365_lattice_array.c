@@ -0,0 +1,189 @@
+// src/nymya_3365_lattice_array.c
+//
+// Implements nymya_3365_lattice_array syscall: runs one of the lattice
+// gates that take qubit pointer arrays (3347-3354) on a contiguous qubit
+// array instead. The kernel copies the whole block in and out once rather
+// than chasing and copying every user pointer, and the gate core walks the
+// block in order.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#define __NR_nymya_3365_lattice_array NYMYA_LATTICE_ARRAY_CODE
+
+/**
+ * nymya_3365_lattice_array - Userland wrapper for contiguous-array lattice gates.
+ * @lattice_code: NYMYA_*_CODE of the gate, 3347 to 3354.
+ * @qubits: Contiguous qubits, in the order the pointer form would list them.
+ * @count: Number of qubits; exactly the gate's size for 3347, 3348 and 3352.
+ *
+ * Converts the amplitudes to fixed-point, invokes the syscall, then
+ * rescales them. Returns 0 on success, -1 on invalid input or memory
+ * failure, or the syscall's return code.
+ */
+int nymya_3365_lattice_array(unsigned int lattice_code, nymya_qubit qubits[], size_t count) {
+    const nymya_gate_desc *d = nymya_gate_lookup(lattice_code);
+
+    if (!d || (d->shape != NYMYA_SHAPE_QARR && d->shape != NYMYA_SHAPE_QLIST) ||
+        !qubits || count < d->min_qubits)
+        return -1;
+
+    nymya_qubit_k *buf = nymya_scratch_get(NYMYA_SCRATCH_CALL, count * sizeof(*buf));
+    if (!buf) return -1;
+
+    // Scale to fixed-point
+    for (size_t i = 0; i < count; i++) {
+        buf[i].id = qubits[i].id;
+        memcpy(buf[i].tag, qubits[i].tag, NYMYA_TAG_MAXLEN);
+        buf[i].re = (int64_t)(creal(qubits[i].amplitude) * FIXED_POINT_SCALE);
+        buf[i].im = (int64_t)(cimag(qubits[i].amplitude) * FIXED_POINT_SCALE);
+    }
+
+    long ret = NYMYA_CALL_GATE(__NR_nymya_3365_lattice_array, lattice_code, (uintptr_t)buf, count);
+
+    if (ret == 0) {
+        for (size_t i = 0; i < count; i++) {
+            qubits[i].amplitude = (double)buf[i].re / FIXED_POINT_SCALE
+                                + (double)buf[i].im / FIXED_POINT_SCALE * I;
+        }
+    }
+    return (int)ret;
+}
+
+#else // __KERNEL__
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/syscalls.h>
+#include <linux/uaccess.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <linux/errno.h>
+
+// Kernel cores that are not exported under their public gate name
+int nymya_3351_tessellated_hex_rhombi_core(struct nymya_qubit **k_qubits, size_t count);
+int nymya_3354_metatron_cube_core(struct nymya_qubit **k_qubits, size_t count);
+
+typedef int (*nymya_lattice_array_fn)(struct nymya_qubit **k_qubits, size_t count);
+
+// Pointer-array core call of each shape; empty = not a pointer-array gate
+#define NYMYA_3365_FN(code, call)                                               \
+    static int nymya_3365_run_##code(struct nymya_qubit **k_qubits, size_t count) \
+    {                                                                           \
+        return call;                                                            \
+    }
+#define NYMYA_3365_FN_Q(code, kcore)
+#define NYMYA_3365_FN_Q_THETA(code, kcore)
+#define NYMYA_3365_FN_Q_AXIS_THETA(code, kcore)
+#define NYMYA_3365_FN_Q2(code, kcore)
+#define NYMYA_3365_FN_Q2_THETA(code, kcore)
+#define NYMYA_3365_FN_Q3(code, kcore)
+#define NYMYA_3365_FN_QARR(code, kcore)         NYMYA_3365_FN(code, kcore(k_qubits))
+#define NYMYA_3365_FN_QLIST(code, kcore)        NYMYA_3365_FN(code, kcore(k_qubits, count))
+#define NYMYA_3365_FN_QPOS3(code, kcore)
+#define NYMYA_3365_FN_QPOS4(code, kcore)
+#define NYMYA_3365_FN_QPOS5(code, kcore)
+#define NYMYA_3365_FN_ORACLE(code, kcore)
+#define NYMYA_3365_FN_QRNG(code, kcore)
+
+#define NYMYA_3365_DEFINE(code, name, shape, n_min, kcore) NYMYA_3365_FN_##shape(code, kcore)
+NYMYA_GATES(NYMYA_3365_DEFINE)
+#undef NYMYA_3365_DEFINE
+
+#define NYMYA_3365_SLOT(code) [(code) - NYMYA_GATE_FIRST] = nymya_3365_run_##code,
+#define NYMYA_3365_SLOT_Q(code)
+#define NYMYA_3365_SLOT_Q_THETA(code)
+#define NYMYA_3365_SLOT_Q_AXIS_THETA(code)
+#define NYMYA_3365_SLOT_Q2(code)
+#define NYMYA_3365_SLOT_Q2_THETA(code)
+#define NYMYA_3365_SLOT_Q3(code)
+#define NYMYA_3365_SLOT_QARR(code)         NYMYA_3365_SLOT(code)
+#define NYMYA_3365_SLOT_QLIST(code)        NYMYA_3365_SLOT(code)
+#define NYMYA_3365_SLOT_QPOS3(code)
+#define NYMYA_3365_SLOT_QPOS4(code)
+#define NYMYA_3365_SLOT_QPOS5(code)
+#define NYMYA_3365_SLOT_ORACLE(code)
+#define NYMYA_3365_SLOT_QRNG(code)
+
+#define NYMYA_3365_ENTRY(code, name, shape, n_min, kcore) NYMYA_3365_SLOT_##shape(code)
+// Pointer-array gates by code - NYMYA_GATE_FIRST, generated from NYMYA_GATES
+static const nymya_lattice_array_fn nymya_3365_fns[NYMYA_GATE_COUNT] = {
+    NYMYA_GATES(NYMYA_3365_ENTRY)
+};
+#undef NYMYA_3365_ENTRY
+
+/**
+ * SYSCALL_DEFINE3(nymya_3365_lattice_array) - Runs a pointer-array lattice gate on a contiguous array.
+ * @lattice_code: NYMYA_*_CODE of the gate, 3347 to 3354.
+ * @user_qubits: User-space array of @count qubits; updated in place.
+ * @count: Number of qubits; exactly the gate's size for the fixed-size
+ *         gates (3347, 3348, 3352), at least its minimum for the others.
+ *
+ * Copies the qubits in with one copy, points the gate core's pointer
+ * array at consecutive elements, runs it, and copies the qubits back with
+ * one copy. Nothing is copied back on failure.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -EINVAL on an unknown or non-array gate code, a NULL array or a bad count.
+ * - -E2BIG if @count is over the lattice_max_sites module parameter.
+ * - -ENOMEM if the kernel buffer cannot be allocated.
+ * - -EFAULT on copy failures.
+ * - Error code from the gate core.
+ */
+NYMYA_SYSCALL_DEFINE3(3365, nymya_3365_lattice_array,
+    unsigned int, lattice_code,
+    struct nymya_qubit __user *, user_qubits,
+    size_t, count)
+{
+    const nymya_gate_desc *d = nymya_gate_lookup(lattice_code);
+    struct nymya_qubit *k_qubits;
+    struct nymya_qubit **k_ptrs;
+    nymya_lattice_array_fn core;
+    size_t i;
+    long ret;
+
+    if (!d || !user_qubits || count < d->min_qubits)
+        return -EINVAL;
+    core = nymya_3365_fns[lattice_code - NYMYA_GATE_FIRST];
+    if (!core || (d->shape == NYMYA_SHAPE_QARR && count != d->min_qubits))
+        return -EINVAL;
+    ret = nymya_lattice_check_size(count);
+    if (ret)
+        return ret;
+
+    // One buffer: [qubits][pointers into them, in order]
+    k_qubits = nymya_stage_alloc(3365, count, sizeof(*k_qubits) + sizeof(*k_ptrs));
+    if (!k_qubits)
+        return -ENOMEM;
+    k_ptrs = (struct nymya_qubit **)(k_qubits + count);
+
+    if (nymya_copy_from_user(3365, k_qubits, user_qubits, count * sizeof(*k_qubits))) {
+        ret = -EFAULT;
+        goto out;
+    }
+    for (i = 0; i < count; i++)
+        k_ptrs[i] = &k_qubits[i];
+
+    ret = NYMYA_TRACE_CORE(lattice_code, k_qubits[0].id, k_qubits[1].id, core(k_ptrs, count));
+    if (ret)
+        goto out;
+
+    if (nymya_copy_to_user(3365, user_qubits, k_qubits, count * sizeof(*k_qubits)))
+        ret = -EFAULT;
+
+out:
+    nymya_stage_free(k_qubits);
+    return ret;
+}
+
+#endif // __KERNEL__
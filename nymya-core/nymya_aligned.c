@@ -0,0 +1,351 @@
+// src/nymya_aligned.c
+//
+// Cache-line aligned buffers for qubit arrays. Userland gets
+// nymya_qubits_alloc(): arrays that start on a cache line and are padded to a
+// whole number of lines, optionally backed by huge pages, so no element
+// straddles into memory another thread owns. Arrays large enough for the
+// worker pool to split are placed node by node to match it. The kernel gets staging buffers
+// for syscall copies with the same alignment, cached per CPU so that a
+// steady stream of syscalls does not go back to the allocator every time.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define NYMYA_HUGE_PAGE (2u << 20)
+
+/**
+ * nymya_aligned_hdr - Bookkeeping kept in the cache line before a buffer.
+ * @base: Start of the underlying allocation.
+ * @bytes: Length of the underlying allocation.
+ * @mapped: Non-zero if @base came from mmap() rather than aligned_alloc().
+ */
+typedef struct nymya_aligned_hdr {
+    void *base;
+    size_t bytes;
+    int mapped;
+} nymya_aligned_hdr;
+
+static size_t nymya_line_size;
+
+/**
+ * nymya_cache_line - Alignment used by nymya_aligned_alloc().
+ *
+ * Returns the L1 data cache line size reported by the system, but never less
+ * than NYMYA_CACHE_LINE.
+ */
+size_t nymya_cache_line(void) {
+    size_t line = __atomic_load_n(&nymya_line_size, __ATOMIC_RELAXED);
+
+    if (!line) {
+        long l = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+
+        line = NYMYA_CACHE_LINE;
+        // Only powers of two are usable as an alignment
+        while (l > 0 && line < (size_t)l) line *= 2;
+        __atomic_store_n(&nymya_line_size, line, __ATOMIC_RELAXED);
+    }
+    return line;
+}
+
+static void *nymya_aligned_map(size_t bytes, int huge) {
+    void *p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (huge)
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED && huge) {
+        // No reserved huge pages: ask for transparent ones instead, on a
+        // 2 MiB boundary so that every huge page of the range can be one
+        char *raw = mmap(NULL, bytes + NYMYA_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        size_t head;
+
+        if (raw == MAP_FAILED) return NULL;
+        p = (void *)(((uintptr_t)raw + NYMYA_HUGE_PAGE - 1) & ~(uintptr_t)(NYMYA_HUGE_PAGE - 1));
+        head = (size_t)((char *)p - raw);
+        if (head) munmap(raw, head);
+        if (NYMYA_HUGE_PAGE - head) munmap((char *)p + bytes, NYMYA_HUGE_PAGE - head);
+#ifdef MADV_HUGEPAGE
+        madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    } else if (p == MAP_FAILED) {
+        p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return NULL;
+    }
+    return p;
+}
+
+/**
+ * nymya_aligned_alloc - Allocates a zeroed, cache-line aligned and padded buffer.
+ * @bytes: Usable size; rounded up to a whole number of cache lines.
+ * @flags: NYMYA_ALLOC_HUGE to back the buffer with huge pages where possible,
+ *         NYMYA_ALLOC_NUMA to place its pages with nymya_parallel_place().
+ *
+ * Huge pages are tried as reserved hugetlb pages first and as transparent
+ * huge pages otherwise; either way the call succeeds with normal pages if
+ * neither is available. NUMA placement is a hint as well: a buffer whose
+ * placement fails is still returned. Release with nymya_aligned_free().
+ *
+ * Returns the buffer, or NULL with errno set on invalid input or memory failure.
+ */
+void *nymya_aligned_alloc(size_t bytes, unsigned int flags) {
+    size_t line = nymya_cache_line();
+    size_t total;
+    nymya_aligned_hdr *hdr;
+    char *base;
+    int mapped = 0;
+
+    if (bytes == 0 || bytes > SIZE_MAX - 2 * line) {
+        errno = EINVAL;
+        return NULL;
+    }
+    // One line of bookkeeping in front, the buffer padded to whole lines
+    total = line + ((bytes + line - 1) & ~(line - 1));
+
+    if (flags & (NYMYA_ALLOC_HUGE | NYMYA_ALLOC_NUMA)) {
+        // Pages of a fresh mapping are untouched, so placement still applies
+        size_t unit = flags & NYMYA_ALLOC_HUGE ? NYMYA_HUGE_PAGE : (size_t)sysconf(_SC_PAGESIZE);
+
+        total = (total + unit - 1) & ~(unit - 1);
+        base = nymya_aligned_map(total, flags & NYMYA_ALLOC_HUGE);
+        mapped = 1;
+        if (base && (flags & NYMYA_ALLOC_NUMA)) nymya_parallel_place(base, total);
+    } else {
+        base = aligned_alloc(line, total);
+        if (base) memset(base, 0, total);
+    }
+    if (!base) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    hdr = (nymya_aligned_hdr *)(base + line) - 1;
+    hdr->base = base;
+    hdr->bytes = total;
+    hdr->mapped = mapped;
+    return base + line;
+}
+
+/**
+ * nymya_aligned_free - Releases a buffer from nymya_aligned_alloc().
+ * @p: Buffer, or NULL.
+ */
+void nymya_aligned_free(void *p) {
+    nymya_aligned_hdr *hdr;
+
+    if (!p) return;
+    hdr = (nymya_aligned_hdr *)p - 1;
+    if (hdr->mapped)
+        munmap(hdr->base, hdr->bytes);
+    else
+        free(hdr->base);
+}
+
+// NYMYA_ALLOC_NUMA for arrays the worker pool splits, 0 for the others
+static unsigned int nymya_qubits_numa(size_t n) {
+    return nymya_parallel_workers(n) > 1 ? NYMYA_ALLOC_NUMA : 0;
+}
+
+/**
+ * nymya_qubits_alloc - Allocates a zeroed, cache-line aligned qubit array.
+ * @n: Number of qubits.
+ *
+ * An array that nymya_parallel_for() would split is placed node by node
+ * (NYMYA_ALLOC_NUMA), so each worker's range is local to it.
+ *
+ * Returns the array, or NULL with errno set; release with nymya_qubits_free().
+ */
+nymya_qubit *nymya_qubits_alloc(size_t n) {
+    if (n == 0 || n > SIZE_MAX / sizeof(nymya_qubit)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return nymya_aligned_alloc(n * sizeof(nymya_qubit), nymya_qubits_numa(n));
+}
+
+/**
+ * nymya_qubits_alloc_huge - nymya_qubits_alloc() backed by huge pages where possible.
+ * @n: Number of qubits.
+ *
+ * Worth it for lattices of many thousands of sites, whose neighbour sweeps
+ * otherwise miss the TLB on most steps.
+ */
+nymya_qubit *nymya_qubits_alloc_huge(size_t n) {
+    if (n == 0 || n > SIZE_MAX / sizeof(nymya_qubit)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return nymya_aligned_alloc(n * sizeof(nymya_qubit), NYMYA_ALLOC_HUGE | nymya_qubits_numa(n));
+}
+
+/**
+ * nymya_qubits_free - Releases an array from nymya_qubits_alloc() or _alloc_huge().
+ * @q: Array, or NULL.
+ */
+void nymya_qubits_free(nymya_qubit *q) {
+    nymya_aligned_free(q);
+}
+
+#else // __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/cache.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+
+// Cached buffers per CPU, so a syscall staging two arrays finds both
+#define NYMYA_STAGE_SLOTS     2
+// Larger buffers are freed on release instead of cached
+#define NYMYA_STAGE_CACHE_MAX (1u << 20)
+
+/**
+ * struct nymya_stage_hdr - Bookkeeping kept in the cache line before a staging buffer.
+ * @size: Usable bytes after the header.
+ * @quota: Process the buffer is charged to while handed out, or NULL.
+ * @charged: Bytes charged to @quota.
+ */
+struct nymya_stage_hdr {
+    size_t size;
+    struct nymya_quota *quota;
+    size_t charged;
+};
+
+static DEFINE_PER_CPU(struct nymya_stage_hdr *, nymya_stage_cache[NYMYA_STAGE_SLOTS]);
+
+static void *nymya_stage_data(struct nymya_stage_hdr *hdr)
+{
+    return (char *)hdr + L1_CACHE_BYTES;
+}
+
+static struct nymya_stage_hdr *nymya_stage_hdr_of(void *buf)
+{
+    return (struct nymya_stage_hdr *)((char *)buf - L1_CACHE_BYTES);
+}
+
+static void *nymya_stage_account(u32 code, struct nymya_stage_hdr *hdr, size_t bytes,
+                                 struct nymya_quota *quota)
+{
+    long staged = nymya_stats_staged(code, bytes, hdr->size);
+
+    hdr->quota = quota;
+    hdr->charged = bytes;
+    trace_nymya_stage(code, bytes, staged);
+    return nymya_stage_data(hdr);
+}
+
+/**
+ * nymya_stage_alloc - Returns a cache-line aligned buffer for staging a syscall copy.
+ * @code: Gate code of the syscall, for the marshalling statistics.
+ * @n: Number of elements.
+ * @size: Size of one element.
+ *
+ * Reuses a buffer cached on the current CPU when one is large enough. The
+ * buffer is not zeroed and, like a kvmalloc() one, may be used from any CPU
+ * and across sleeps; release it with nymya_stage_free(). Until then it
+ * counts towards the staging memory held, see nymya_stats_staged(), and
+ * towards the caller's NYMYA_QUOTA_STAGE cap. New buffers are charged to
+ * the caller's memory cgroup; a cached one stays charged to the cgroup
+ * that first allocated it, which is at most NYMYA_STAGE_SLOTS buffers of
+ * NYMYA_STAGE_CACHE_MAX bytes per CPU.
+ *
+ * Returns the buffer, or NULL on overflow, allocation failure or when the
+ * caller's staging cap is reached.
+ */
+void *nymya_stage_alloc(u32 code, size_t n, size_t size)
+{
+    struct nymya_stage_hdr *hdr;
+    struct nymya_quota *quota;
+    size_t bytes, total;
+    unsigned int s;
+
+    if (check_mul_overflow(n, size, &bytes) || bytes > SIZE_MAX / 2)
+        return NULL;
+    if (nymya_quota_charge(NYMYA_QUOTA_STAGE, bytes, &quota))
+        return NULL;
+
+    for (s = 0; s < NYMYA_STAGE_SLOTS; s++) {
+        hdr = this_cpu_xchg(nymya_stage_cache[s], NULL);
+        if (!hdr)
+            continue;
+        if (hdr->size >= bytes)
+            return nymya_stage_account(code, hdr, bytes, quota);
+        // Too small for this copy; leave it for a smaller one
+        if (this_cpu_cmpxchg(nymya_stage_cache[s], NULL, hdr))
+            kvfree(hdr);
+    }
+
+    /*
+     * kmalloc() aligns power-of-two sizes naturally and larger requests come
+     * from whole pages, so the data after the header line is aligned too.
+     */
+    total = L1_CACHE_BYTES + ALIGN(bytes, L1_CACHE_BYTES);
+    total = total <= PAGE_SIZE ? roundup_pow_of_two(total) : PAGE_ALIGN(total);
+    // Past the cache limit the copy is a huge lattice; fail it rather than thrash reclaim
+    hdr = kvmalloc(total, total > NYMYA_STAGE_CACHE_MAX ?
+                   GFP_KERNEL_ACCOUNT | __GFP_RETRY_MAYFAIL | __GFP_NOWARN : GFP_KERNEL_ACCOUNT);
+    if (!hdr) {
+        nymya_quota_uncharge(quota, NYMYA_QUOTA_STAGE, bytes);
+        return NULL;
+    }
+    hdr->size = total - L1_CACHE_BYTES;
+    return nymya_stage_account(code, hdr, bytes, quota);
+}
+EXPORT_SYMBOL_GPL(nymya_stage_alloc);
+
+/**
+ * nymya_stage_free - Releases a buffer from nymya_stage_alloc().
+ * @buf: Buffer, or NULL.
+ *
+ * Keeps the buffer in a free slot of the current CPU's cache when it is
+ * small enough, and frees it otherwise.
+ */
+void nymya_stage_free(void *buf)
+{
+    struct nymya_stage_hdr *hdr;
+    unsigned int s;
+
+    if (!buf)
+        return;
+    hdr = nymya_stage_hdr_of(buf);
+    nymya_stats_unstaged(hdr->size);
+    nymya_quota_uncharge(hdr->quota, NYMYA_QUOTA_STAGE, hdr->charged);
+    hdr->quota = NULL;
+    if (hdr->size <= NYMYA_STAGE_CACHE_MAX) {
+        for (s = 0; s < NYMYA_STAGE_SLOTS; s++) {
+            if (!this_cpu_cmpxchg(nymya_stage_cache[s], NULL, hdr))
+                return;
+        }
+    }
+    kvfree(hdr);
+}
+EXPORT_SYMBOL_GPL(nymya_stage_free);
+
+/**
+ * nymya_stage_exit - Frees every cached staging buffer; called at module exit.
+ */
+void nymya_stage_exit(void)
+{
+    unsigned int s;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        for (s = 0; s < NYMYA_STAGE_SLOTS; s++) {
+            kvfree(per_cpu(nymya_stage_cache[s], cpu));
+            per_cpu(nymya_stage_cache[s], cpu) = NULL;
+        }
+    }
+}
+
+#endif // __KERNEL__
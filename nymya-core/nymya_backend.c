@@ -0,0 +1,138 @@
+// src/nymya_backend.c
+//
+// Gate backends built outside libnymya (GPU, distributed, remote QPU, ...),
+// loaded as plugins. NYMYA_BACKEND=<name>, for any name but auto, kernel
+// and local, or nymya_backend_plugin(name) selects one; nothing is loaded
+// until the first gate call. That call dlopen()s libnymya-<name>.so (or
+// <name> itself when it contains a '/'), checks its nymya_plugin_ops
+// table and runs its init() once for the process, so a short-lived tool
+// that never runs a gate never pays for a backend's device, MPI or
+// network setup.
+//
+// A plugin receives each gate call as nymya_local_call() does: the gate
+// code and its syscall arguments, pointers included, since it runs in
+// this process.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+// Longest plugin name or path kept
+#define NYMYA_PLUGIN_NAME_MAX 256
+
+static pthread_mutex_t plugin_lock = PTHREAD_MUTEX_INITIALIZER;
+static char plugin_name[NYMYA_PLUGIN_NAME_MAX];
+// Loaded and initialised table; NULL until the first call
+static const nymya_backend_ops *plugin_ops;
+// errno of a failed load, so later calls fail alike without retrying
+static int plugin_err;
+
+/**
+ * nymya_plugin_name - Records the plugin a later first call will load.
+ * @name: Plugin name or path.
+ *
+ * Returns 0, -EINVAL for an empty or overlong @name, or -EBUSY once a
+ * different plugin is loaded.
+ */
+int nymya_plugin_name(const char *name) {
+    size_t len = name ? strnlen(name, NYMYA_PLUGIN_NAME_MAX) : 0;
+    int ret = 0;
+
+    if (!len || len == NYMYA_PLUGIN_NAME_MAX) return -EINVAL;
+
+    pthread_mutex_lock(&plugin_lock);
+    if (plugin_ops || plugin_err) {
+        if (strcmp(plugin_name, name) != 0) ret = -EBUSY;
+    } else {
+        memcpy(plugin_name, name, len + 1);
+    }
+    pthread_mutex_unlock(&plugin_lock);
+    return ret;
+}
+
+// dlopen()s the named plugin and runs its init(); under plugin_lock, with a name set
+static int plugin_load(void) {
+    char path[NYMYA_PLUGIN_NAME_MAX + 32];
+    const nymya_backend_ops *ops;
+    void *dl;
+    int ret;
+
+    if (strchr(plugin_name, '/')) snprintf(path, sizeof(path), "%s", plugin_name);
+    else snprintf(path, sizeof(path), "libnymya-%s.so", plugin_name);
+
+    dl = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!dl) return -ENOENT;
+    ops = dlsym(dl, "nymya_plugin_ops");
+    if (!ops || ops->abi != NYMYA_PLUGIN_ABI || !ops->call) {
+        dlclose(dl);
+        return -ENOEXEC;
+    }
+    ret = ops->init ? ops->init() : 0;
+    if (ret) {
+        dlclose(dl);
+        return ret < 0 ? ret : -EIO;
+    }
+    __atomic_store_n(&plugin_ops, ops, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * nymya_plugin_call - Runs a gate call on the plugin backend.
+ * @code: Gate code.
+ * @args: The syscall's arguments.
+ * @nargs: Number of arguments.
+ *
+ * Loads and initialises the plugin on the first call.
+ *
+ * Returns the gate's result, or -errno as the kernel would. A plugin that
+ * failed to load fails every call with the load's error: -ENOENT if
+ * dlopen() found no library, -ENOEXEC without a table for this ABI, or
+ * what its init() returned.
+ */
+long nymya_plugin_call(uint32_t code, const uint64_t *args, uint32_t nargs) {
+    const nymya_backend_ops *ops = __atomic_load_n(&plugin_ops, __ATOMIC_ACQUIRE);
+    int err;
+
+    if (!ops) {
+        pthread_mutex_lock(&plugin_lock);
+        ops = plugin_ops;
+        err = plugin_err;
+        // Without a name there is nothing to load yet, and nothing to remember
+        if (!ops && !err && !plugin_name[0]) err = -EINVAL;
+        else if (!ops && !err) {
+            plugin_err = err = plugin_load();
+            ops = plugin_ops;
+        }
+        pthread_mutex_unlock(&plugin_lock);
+        if (!ops) return err;
+    }
+    return ops->call(code, args, nargs);
+}
+
+/**
+ * nymya_backend_plugin - Runs the gate calls on a plugin backend from now on.
+ * @name: Plugin name, loaded as libnymya-<name>.so, or a path containing '/'.
+ *
+ * As NYMYA_BACKEND=<name>. The plugin is loaded by the next gate call, not
+ * here; a process can have only one.
+ *
+ * Returns 0, or -1 with errno set to EINVAL for a bad @name or EBUSY if
+ * another plugin is already loaded.
+ */
+int nymya_backend_plugin(const char *name) {
+    int ret = nymya_plugin_name(name);
+
+    if (ret) {
+        errno = -ret;
+        return -1;
+    }
+    return nymya_backend_set(NYMYA_BACKEND_PLUGIN);
+}
+
+#endif // __KERNEL__
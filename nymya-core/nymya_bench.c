@@ -0,0 +1,781 @@
+// src/nymya_bench.c
+//
+// Gate microbenchmark: ns per call of every nymya_33xx gate through three
+// paths, reported as JSON on stdout.
+//   lib     - the userland library function (marshalling and, for gates the
+//             library forwards to the kernel, the syscall included)
+//   syscall - the raw syscall on ready-made kernel-layout arguments
+//   kernel  - the gate's kernel core, timed in the kernel by nymya_bench.ko
+// Built by "make bench" (userland) and "make bench-kmod" (module); a path
+// whose kernel side is missing is reported as unavailable, not skipped.
+//
+// With -x, the crossing mode instead runs one sequence of each gate that
+// fits a nymya_op record, at every batch size given, three ways: library
+// calls that never leave userland, one syscall per gate, and one
+// nymya_3362_submit syscall per batch. It checks that the two kernel paths
+// end in bit-identical qubits and how far the userland doubles are from
+// them, and reports the cost of crossing into nymya_core.ko per gate.
+
+#define _GNU_SOURCE // sched_setaffinity()
+
+#include "nymya.h"
+#include "nymya_bench.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+
+#define BENCH_PATH_LIB     0x1u
+#define BENCH_PATH_SYSCALL 0x2u
+#define BENCH_PATH_KERNEL  0x4u
+
+// Crossing mode: default batch sizes, and limits on the list and each size
+#define BENCH_BATCHES     "1,8,64,512,4096"
+#define BENCH_MAX_BATCHES 16
+#define BENCH_MAX_BATCH   NYMYA_SUBMIT_MAX_OPS
+
+// Largest |userland - kernel| amplitude still counted as the same result
+#define BENCH_MATCH_TOL 1e-6
+
+/**
+ * bench_state - Arguments every gate of a run is called with.
+ * @q: Userland qubits; @qp their pointer array.
+ * @kq: Kernel-layout qubits for the syscall path; @kqp their pointer array.
+ * @pos3, @pos4, @pos5: Userland sites; @kpos3, @kpos4, @kpos5 kernel-layout ones.
+ * @rng: Output buffer of the QRNG.
+ * @sites: Entries in each array.
+ */
+typedef struct bench_state {
+    nymya_qubit *q;
+    nymya_qubit **qp;
+    nymya_qubit_k *kq;
+    nymya_qubit_k **kqp;
+    nymya_qpos3d *pos3;
+    nymya_qpos4d *pos4;
+    nymya_qpos5d *pos5;
+    nymya_qpos3d_k *kpos3;
+    nymya_qpos4d_k *kpos4;
+    nymya_qpos5d_k *kpos5;
+    uint64_t *rng;
+    size_t sites;
+} bench_state;
+
+typedef long (*bench_fn)(bench_state *b, size_t n);
+
+typedef struct bench_gate {
+    unsigned int code;
+    const char *name;
+    enum nymya_gate_shape shape;
+    size_t min_qubits;
+    bench_fn lib;
+    bench_fn sys;
+} bench_gate;
+
+static void bench_oracle(nymya_qubit *q) {
+    nymya_3303_pauli_x(q);
+}
+
+static const int64_t bench_theta_fp = (int64_t)(NYMYA_BENCH_THETA * FIXED_POINT_SCALE);
+
+// Userland library calls, by shape
+#define BENCH_LIB_Q(fn)            fn(b->qp[0])
+#define BENCH_LIB_Q_THETA(fn)      fn(b->qp[0], NYMYA_BENCH_THETA)
+#define BENCH_LIB_Q_AXIS_THETA(fn) fn(b->qp[0], 'X', NYMYA_BENCH_THETA)
+#define BENCH_LIB_Q2(fn)           fn(b->qp[0], b->qp[1])
+#define BENCH_LIB_Q2_THETA(fn)     fn(b->qp[0], b->qp[1], NYMYA_BENCH_THETA)
+#define BENCH_LIB_Q3(fn)           fn(b->qp[0], b->qp[1], b->qp[2])
+#define BENCH_LIB_QARR(fn)         fn(b->qp)
+#define BENCH_LIB_QLIST(fn)        fn(b->qp, n)
+#define BENCH_LIB_QPOS3(fn)        fn(b->pos3, n)
+#define BENCH_LIB_QPOS4(fn)        fn(b->pos4, n)
+#define BENCH_LIB_QPOS5(fn)        fn(b->pos5, n)
+#define BENCH_LIB_ORACLE(fn)       fn(b->qp[0], b->qp[1], bench_oracle)
+#define BENCH_LIB_QRNG(fn)         fn(b->rng, 0, 1000, n)
+
+// Raw syscalls on kernel-layout arguments, by shape
+#define BENCH_SYS_Q(nr)            syscall(nr, b->kqp[0])
+#define BENCH_SYS_Q_THETA(nr)      syscall(nr, b->kqp[0], bench_theta_fp)
+#define BENCH_SYS_Q_AXIS_THETA(nr) syscall(nr, b->kqp[0], 'X', bench_theta_fp)
+#define BENCH_SYS_Q2(nr)           syscall(nr, b->kqp[0], b->kqp[1])
+#define BENCH_SYS_Q2_THETA(nr)     syscall(nr, b->kqp[0], b->kqp[1], bench_theta_fp)
+#define BENCH_SYS_Q3(nr)           syscall(nr, b->kqp[0], b->kqp[1], b->kqp[2])
+#define BENCH_SYS_QARR(nr)         syscall(nr, b->kqp)
+#define BENCH_SYS_QLIST(nr)        syscall(nr, b->kqp, n)
+#define BENCH_SYS_QPOS3(nr)        syscall(nr, b->kpos3, n)
+#define BENCH_SYS_QPOS4(nr)        syscall(nr, b->kpos4, n)
+#define BENCH_SYS_QPOS5(nr)        syscall(nr, b->kpos5, n)
+#define BENCH_SYS_ORACLE(nr)       (errno = ENOSYS, -1L) // The oracle is a callback
+#define BENCH_SYS_QRNG(nr)         syscall(nr, b->rng, 0, 1000, n)
+
+#define BENCH_THUNKS(code, name, shape, n_min, kcore) \
+    static long bench_lib_##code(bench_state *b, size_t n) { \
+        (void)n; \
+        return BENCH_LIB_##shape(nymya_##code##_##name); \
+    } \
+    static long bench_sys_##code(bench_state *b, size_t n) { \
+        (void)b; (void)n; \
+        return BENCH_SYS_##shape(code); \
+    }
+NYMYA_BENCH_GATES(BENCH_THUNKS)
+
+// Library calls on a record's operands, by shape; 0 arity = no nymya_op form
+#define BENCH_OP_Q(fn)            fn(q[0])
+#define BENCH_OP_Q_THETA(fn)      fn(q[0], NYMYA_BENCH_THETA)
+#define BENCH_OP_Q_AXIS_THETA(fn) fn(q[0], 'X', NYMYA_BENCH_THETA)
+#define BENCH_OP_Q2(fn)           fn(q[0], q[1])
+#define BENCH_OP_Q2_THETA(fn)     fn(q[0], q[1], NYMYA_BENCH_THETA)
+#define BENCH_OP_Q3(fn)           fn(q[0], q[1], q[2])
+#define BENCH_OP_QARR(fn)         (errno = ENOSYS, -1L)
+#define BENCH_OP_QLIST(fn)        (errno = ENOSYS, -1L)
+#define BENCH_OP_QPOS3(fn)        (errno = ENOSYS, -1L)
+#define BENCH_OP_QPOS4(fn)        (errno = ENOSYS, -1L)
+#define BENCH_OP_QPOS5(fn)        (errno = ENOSYS, -1L)
+#define BENCH_OP_ORACLE(fn)       (errno = ENOSYS, -1L)
+#define BENCH_OP_QRNG(fn)         (errno = ENOSYS, -1L)
+
+typedef long (*bench_op_fn)(nymya_qubit **q);
+
+#define BENCH_OP_THUNKS(code, name, shape, n_min, kcore) \
+    static long bench_op_##code(nymya_qubit **q) { \
+        (void)q; \
+        return BENCH_OP_##shape(nymya_##code##_##name); \
+    }
+NYMYA_BENCH_GATES(BENCH_OP_THUNKS)
+
+#define BENCH_ENTRY(code, name, shape, n_min, kcore) \
+    { code, #name, NYMYA_SHAPE_##shape, n_min, bench_lib_##code, bench_sys_##code },
+static const bench_gate bench_gates[] = {
+    NYMYA_BENCH_GATES(BENCH_ENTRY)
+};
+
+/**
+ * bench_op_gate - A gate's nymya_op form, parallel to bench_gates[].
+ * @arity: Qubit operands of a record, 0 if the gate has no record form.
+ * @op: Library call on a record's operands.
+ */
+typedef struct bench_op_gate {
+    unsigned int arity;
+    bench_op_fn op;
+} bench_op_gate;
+
+#define BENCH_OP_ENTRY(code, name, shape, n_min, kcore) \
+    { NYMYA_SHAPE_OPERANDS_##shape, bench_op_##code },
+static const bench_op_gate bench_op_gates[] = {
+    NYMYA_BENCH_GATES(BENCH_OP_ENTRY)
+};
+
+/**
+ * bench_result - Timing of one gate on one path.
+ * @status: "ok", "error" (some call failed) or "unavailable".
+ * @median_ns, @min_ns: ns per call, over the runs.
+ * @errors: Failed calls in the timed loops.
+ * @first_error: Return value (or -errno) of the first failure.
+ */
+typedef struct bench_result {
+    const char *status;
+    double median_ns;
+    double min_ns;
+    uint64_t errors;
+    long first_error;
+} bench_result;
+
+typedef struct bench_opts {
+    unsigned long iters;
+    unsigned long warmup;
+    unsigned int runs;
+    int cpu;
+    size_t sites;
+    unsigned int paths;
+    const char *filter;
+    size_t batches[BENCH_MAX_BATCHES];
+    unsigned int nbatches;
+} bench_opts;
+
+/**
+ * bench_cross - Crossing-mode timing of one gate at one batch size.
+ * @status: "ok", "error" (some call failed), "mismatch" (the kernel paths
+ *          disagree) or "unavailable" (no nymya_core.ko).
+ * @user_ns, @syscall_ns, @submit_ns: Median ns per gate of each path.
+ * @max_diff: Largest |userland - kernel| amplitude after one sequence.
+ * @kernel_match: The per-gate and batched syscalls ended bit-identical.
+ * @errors: Failed calls in the timed loops.
+ * @first_error: Return value (or -errno) of the first failure.
+ */
+typedef struct bench_cross {
+    const char *status;
+    double user_ns;
+    double syscall_ns;
+    double submit_ns;
+    double max_diff;
+    int kernel_match;
+    uint64_t errors;
+    long first_error;
+} bench_cross;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+static int bench_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static size_t bench_sites(const bench_gate *g, size_t sites) {
+    if (!NYMYA_BENCH_SIZED(g->shape) || sites < g->min_qubits)
+        return g->min_qubits;
+    return sites;
+}
+
+// Coordinate @axis of site @i on a unit grid holding @count sites in @dims dimensions
+static double bench_coord(size_t i, unsigned int axis, unsigned int dims, size_t count) {
+    size_t side = (size_t)ceil(pow((double)count, 1.0 / dims));
+
+    for (unsigned int k = 0; k < axis; k++) i /= side;
+    return (double)(i % side);
+}
+
+// Puts every qubit and site back to the same state before a run
+static void bench_reset(bench_state *b) {
+    for (size_t i = 0; i < b->sites; i++) {
+        nymya_qubit q = { .id = i + 1, .amplitude = M_SQRT1_2 + M_SQRT1_2 * I };
+
+        snprintf(q.tag, sizeof(q.tag), "bench%zu", i);
+        b->q[i] = q;
+        b->kq[i].id = q.id;
+        memcpy(b->kq[i].tag, q.tag, sizeof(q.tag));
+        b->kq[i].re = b->kq[i].im = (int64_t)(M_SQRT1_2 * FIXED_POINT_SCALE);
+
+        b->pos3[i] = (nymya_qpos3d){ bench_coord(i, 0, 3, b->sites), bench_coord(i, 1, 3, b->sites),
+                                     bench_coord(i, 2, 3, b->sites), q };
+        b->pos4[i] = (nymya_qpos4d){ bench_coord(i, 0, 4, b->sites), bench_coord(i, 1, 4, b->sites),
+                                     bench_coord(i, 2, 4, b->sites), bench_coord(i, 3, 4, b->sites), q };
+        b->pos5[i] = (nymya_qpos5d){ bench_coord(i, 0, 5, b->sites), bench_coord(i, 1, 5, b->sites),
+                                     bench_coord(i, 2, 5, b->sites), bench_coord(i, 3, 5, b->sites),
+                                     bench_coord(i, 4, 5, b->sites), q };
+    }
+    nymya_qpos3d_to_k(b->pos3, b->kpos3, b->sites);
+    nymya_qpos4d_to_k(b->pos4, b->kpos4, b->sites);
+    nymya_qpos5d_to_k(b->pos5, b->kpos5, b->sites);
+}
+
+static int bench_state_init(bench_state *b, size_t sites) {
+    memset(b, 0, sizeof(*b));
+    b->sites = sites;
+    b->q = nymya_qubits_alloc(sites);
+    b->qp = calloc(sites, sizeof(*b->qp));
+    b->kq = nymya_aligned_alloc(sites * sizeof(*b->kq), 0);
+    b->kqp = calloc(sites, sizeof(*b->kqp));
+    b->pos3 = nymya_aligned_alloc(sites * sizeof(*b->pos3), 0);
+    b->pos4 = nymya_aligned_alloc(sites * sizeof(*b->pos4), 0);
+    b->pos5 = nymya_aligned_alloc(sites * sizeof(*b->pos5), 0);
+    b->kpos3 = nymya_aligned_alloc(sites * sizeof(*b->kpos3), 0);
+    b->kpos4 = nymya_aligned_alloc(sites * sizeof(*b->kpos4), 0);
+    b->kpos5 = nymya_aligned_alloc(sites * sizeof(*b->kpos5), 0);
+    b->rng = calloc(sites, sizeof(*b->rng));
+    if (!b->q || !b->qp || !b->kq || !b->kqp || !b->pos3 || !b->pos4 || !b->pos5 ||
+        !b->kpos3 || !b->kpos4 || !b->kpos5 || !b->rng)
+        return -1;
+
+    for (size_t i = 0; i < sites; i++) {
+        b->qp[i] = &b->q[i];
+        b->kqp[i] = &b->kq[i];
+    }
+    return 0;
+}
+
+static void bench_state_free(bench_state *b) {
+    nymya_qubits_free(b->q);
+    free(b->qp);
+    nymya_aligned_free(b->kq);
+    free(b->kqp);
+    nymya_aligned_free(b->pos3);
+    nymya_aligned_free(b->pos4);
+    nymya_aligned_free(b->pos5);
+    nymya_aligned_free(b->kpos3);
+    nymya_aligned_free(b->kpos4);
+    nymya_aligned_free(b->kpos5);
+    free(b->rng);
+}
+
+/**
+ * bench_time - Times one gate on a userland path.
+ * @g: Gate.
+ * @fn: Path thunk of @g.
+ * @b: Arguments; reset before every run.
+ * @o: Options.
+ * @r: Output.
+ */
+static void bench_time(const bench_gate *g, bench_fn fn, bench_state *b,
+                       const bench_opts *o, bench_result *r) {
+    size_t n = bench_sites(g, o->sites);
+    uint64_t runs[NYMYA_BENCH_MAX_RUNS];
+    long ret;
+
+    memset(r, 0, sizeof(*r));
+    bench_reset(b);
+    errno = 0;
+    ret = fn(b, n);
+    if (ret == -1 && errno == ENOSYS) {
+        r->status = "unavailable";
+        r->first_error = -ENOSYS;
+        return;
+    }
+
+    for (unsigned int run = 0; run < o->runs; run++) {
+        uint64_t t0;
+
+        bench_reset(b);
+        for (unsigned long k = 0; k < o->warmup; k++)
+            fn(b, n);
+
+        t0 = bench_now_ns();
+        for (unsigned long k = 0; k < o->iters; k++) {
+            ret = fn(b, n);
+            if (__builtin_expect(ret != 0, 0)) {
+                if (!r->errors++) r->first_error = ret == -1 && errno ? -errno : ret;
+            }
+        }
+        runs[run] = bench_now_ns() - t0;
+    }
+
+    qsort(runs, o->runs, sizeof(runs[0]), bench_cmp_u64);
+    r->median_ns = (double)runs[o->runs / 2] / (double)o->iters;
+    r->min_ns = (double)runs[0] / (double)o->iters;
+    r->status = r->errors ? "error" : "ok";
+}
+
+/**
+ * bench_kernel - Runs the kernel module's benchmark of every core.
+ * @o: Options.
+ * @out: One result per entry of bench_gates[].
+ *
+ * Returns 0, or -1 if the module is not loaded or its files cannot be used;
+ * every entry is then marked unavailable.
+ */
+static int bench_kernel(const bench_opts *o, bench_result *out) {
+    size_t count = sizeof(bench_gates) / sizeof(bench_gates[0]);
+    FILE *f;
+    char line[256];
+
+    for (size_t i = 0; i < count; i++)
+        out[i] = (bench_result){ .status = "unavailable", .first_error = -ENODEV };
+
+    f = fopen(NYMYA_BENCH_RUN_PATH, "w");
+    if (!f) return -1;
+    fprintf(f, "%lu %lu %u %d %zu\n", o->iters, o->warmup, o->runs, o->cpu, o->sites);
+    if (fclose(f)) return -1;
+
+    f = fopen(NYMYA_BENCH_RESULT_PATH, "r");
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned int code;
+        unsigned long iters;
+        unsigned long long median, min, errors;
+        long first;
+
+        if (sscanf(line, "%u %lu %llu %llu %llu %ld", &code, &iters, &median, &min, &errors, &first) != 6)
+            continue;
+        for (size_t i = 0; i < count; i++) {
+            if (bench_gates[i].code != code) continue;
+            if (first == -EOPNOTSUPP && !iters) {
+                out[i].first_error = first;
+                break;
+            }
+            out[i].median_ns = iters ? (double)median / (double)iters : 0;
+            out[i].min_ns = iters ? (double)min / (double)iters : 0;
+            out[i].errors = errors;
+            out[i].first_error = first;
+            out[i].status = errors ? "error" : "ok";
+            break;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// Fills @ops with @count records of gate @g on consecutive qubits, wrapping at @sites
+static void bench_ops_fill(nymya_op *ops, size_t count, const bench_gate *g,
+                           unsigned int arity, size_t sites) {
+    for (size_t k = 0; k < count; k++) {
+        ops[k] = (nymya_op){ .gate_code = g->code, .param = bench_theta_fp };
+        if (g->shape == NYMYA_SHAPE_Q_AXIS_THETA) ops[k].axis = 'X';
+        for (unsigned int j = 0; j < arity; j++)
+            ops[k].qubit[j] = (uint32_t)((k + j) % sites);
+    }
+}
+
+// One pass of the sequence through the library; returns the first failure or 0
+static long bench_seq_user(const bench_op_gate *og, const nymya_op *ops, size_t count,
+                           bench_state *b) {
+    long ret, first = 0;
+
+    for (size_t k = 0; k < count; k++) {
+        nymya_qubit *q[NYMYA_OP_MAX_OPERANDS];
+
+        for (unsigned int j = 0; j < og->arity; j++)
+            q[j] = b->qp[ops[k].qubit[j]];
+        ret = og->op(q);
+        if (__builtin_expect(ret != 0, 0) && !first) first = ret == -1 && errno ? -errno : ret;
+    }
+    return first;
+}
+
+// One pass of the sequence as one syscall per record
+static long bench_seq_syscall(const nymya_op *ops, size_t count, unsigned int arity,
+                              const bench_gate *g, bench_state *b) {
+    long ret, first = 0;
+
+    for (size_t k = 0; k < count; k++) {
+        nymya_qubit_k **kq = b->kqp;
+        const uint32_t *i = ops[k].qubit;
+
+        if (g->shape == NYMYA_SHAPE_Q_AXIS_THETA)
+            ret = syscall(g->code, kq[i[0]], 'X', bench_theta_fp);
+        else if (g->shape == NYMYA_SHAPE_Q_THETA)
+            ret = syscall(g->code, kq[i[0]], bench_theta_fp);
+        else if (g->shape == NYMYA_SHAPE_Q2_THETA)
+            ret = syscall(g->code, kq[i[0]], kq[i[1]], bench_theta_fp);
+        else if (arity == 1)
+            ret = syscall(g->code, kq[i[0]]);
+        else if (arity == 2)
+            ret = syscall(g->code, kq[i[0]], kq[i[1]]);
+        else
+            ret = syscall(g->code, kq[i[0]], kq[i[1]], kq[i[2]]);
+        if (__builtin_expect(ret != 0, 0) && !first) first = ret == -1 && errno ? -errno : ret;
+    }
+    return first;
+}
+
+// One pass of the sequence as a single nymya_3362_submit syscall
+static long bench_seq_submit(const nymya_op *ops, size_t count, bench_state *b) {
+    long ret = syscall(NYMYA_SUBMIT_CODE, ops, count, b->kq, b->sites);
+
+    return ret == -1 && errno ? -errno : ret;
+}
+
+enum { BENCH_SEQ_USER, BENCH_SEQ_SYSCALL, BENCH_SEQ_SUBMIT };
+
+/**
+ * bench_seq_time - Median ns per gate of one path over a batch sequence.
+ * @path: BENCH_SEQ_*.
+ * @reps: Passes of the sequence per run, so a run makes about o->iters calls.
+ * @r: Collects failures.
+ *
+ * Each run is preceded by about o->warmup untimed calls.
+ */
+static double bench_seq_time(int path, const bench_gate *g, const bench_op_gate *og,
+                             const nymya_op *ops, size_t count, unsigned long reps,
+                             bench_state *b, const bench_opts *o, bench_cross *r) {
+    uint64_t runs[NYMYA_BENCH_MAX_RUNS];
+    unsigned long warm = o->warmup ? o->warmup / count + 1 : 0;
+
+    for (unsigned int run = 0; run < o->runs; run++) {
+        uint64_t t0 = 0;
+
+        bench_reset(b);
+        for (unsigned long k = 0; k < warm + reps; k++) {
+            long ret;
+
+            if (k == warm) t0 = bench_now_ns();
+            ret = path == BENCH_SEQ_USER ? bench_seq_user(og, ops, count, b) :
+                       path == BENCH_SEQ_SYSCALL ? bench_seq_syscall(ops, count, og->arity, g, b) :
+                       bench_seq_submit(ops, count, b);
+
+            if (__builtin_expect(ret != 0, 0) && k >= warm && !r->errors++) r->first_error = ret;
+        }
+        runs[run] = bench_now_ns() - t0;
+    }
+    qsort(runs, o->runs, sizeof(runs[0]), bench_cmp_u64);
+    return (double)runs[o->runs / 2] / (double)(reps * count);
+}
+
+/**
+ * bench_crossing - Times and checks one gate's sequence on all three paths.
+ * @g: Gate; @og its record form.
+ * @ops: Room for @count records.
+ * @count: Batch size.
+ * @b: Arguments; reset before every pass.
+ * @o: Options.
+ * @r: Output.
+ */
+static void bench_crossing(const bench_gate *g, const bench_op_gate *og, nymya_op *ops,
+                           size_t count, bench_state *b, const bench_opts *o, bench_cross *r) {
+    unsigned long reps = o->iters / count ? o->iters / count : 1;
+    nymya_qubit_k *ref;
+    long ret;
+
+    memset(r, 0, sizeof(*r));
+    bench_ops_fill(ops, count, g, og->arity, b->sites);
+
+    // Results: one pass per path from the same start
+    ref = malloc(b->sites * sizeof(*ref));
+    if (!ref) {
+        r->status = "error";
+        r->first_error = -ENOMEM;
+        return;
+    }
+    bench_reset(b);
+    errno = 0;
+    ret = bench_seq_syscall(ops, count, og->arity, g, b);
+    if (ret == -ENOSYS) {
+        // Without nymya_core.ko only the userland side can be timed
+        free(ref);
+        r->status = "unavailable";
+        r->first_error = ret;
+        r->user_ns = bench_seq_time(BENCH_SEQ_USER, g, og, ops, count, reps, b, o, r);
+        return;
+    }
+    memcpy(ref, b->kq, b->sites * sizeof(*ref));
+    bench_reset(b);
+    if (!ret) ret = bench_seq_submit(ops, count, b);
+    r->kernel_match = !ret;
+    for (size_t i = 0; i < b->sites && r->kernel_match; i++)
+        r->kernel_match = ref[i].re == b->kq[i].re && ref[i].im == b->kq[i].im;
+    bench_reset(b);
+    if (!ret) ret = bench_seq_user(og, ops, count, b);
+    for (size_t i = 0; i < b->sites; i++) {
+        double d = cabs(b->q[i].amplitude - ((double)ref[i].re + (double)ref[i].im * I) /
+                                            FIXED_POINT_SCALE);
+
+        if (d > r->max_diff) r->max_diff = d;
+    }
+    free(ref);
+    if (ret) {
+        r->errors = 1;
+        r->first_error = ret;
+    }
+
+    r->user_ns = bench_seq_time(BENCH_SEQ_USER, g, og, ops, count, reps, b, o, r);
+    r->syscall_ns = bench_seq_time(BENCH_SEQ_SYSCALL, g, og, ops, count, reps, b, o, r);
+    r->submit_ns = bench_seq_time(BENCH_SEQ_SUBMIT, g, og, ops, count, reps, b, o, r);
+    r->status = r->errors ? "error" : !r->kernel_match ? "mismatch" : "ok";
+}
+
+static void bench_print_cross(FILE *out, const bench_gate *g, size_t count,
+                              const bench_cross *r, int *first) {
+    fprintf(out, "%s    {\"code\": %u, \"gate\": \"%s\", \"batch\": %zu, \"status\": \"%s\", "
+                 "\"user_ns\": %.2f, \"syscall_ns\": %.2f, \"submit_ns\": %.2f, "
+                 "\"syscall_overhead_ns\": %.2f, \"submit_overhead_ns\": %.2f, "
+                 "\"kernel_match\": %s, \"user_max_diff\": %.3g, \"user_match\": %s, "
+                 "\"errors\": %llu, \"first_error\": %ld}",
+            *first ? "" : ",\n", g->code, g->name, count, r->status,
+            r->user_ns, r->syscall_ns, r->submit_ns,
+            r->syscall_ns ? r->syscall_ns - r->user_ns : 0,
+            r->submit_ns ? r->submit_ns - r->user_ns : 0,
+            r->kernel_match ? "true" : "false", r->max_diff,
+            r->kernel_match && r->max_diff <= BENCH_MATCH_TOL ? "true" : "false",
+            (unsigned long long)r->errors, r->first_error);
+    *first = 0;
+}
+
+static int bench_parse_batches(const char *s, bench_opts *o) {
+    char *end;
+
+    o->nbatches = 0;
+    while (*s) {
+        unsigned long long v = strtoull(s, &end, 10);
+
+        if (end == s || !v || v > BENCH_MAX_BATCH || o->nbatches == BENCH_MAX_BATCHES) return -1;
+        o->batches[o->nbatches++] = (size_t)v;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return o->nbatches ? 0 : -1;
+}
+
+static int bench_selected(const bench_gate *g, const char *filter) {
+    char code[8];
+
+    if (!filter) return 1;
+    snprintf(code, sizeof(code), "%u", g->code);
+    return strstr(g->name, filter) || strcmp(code, filter) == 0;
+}
+
+static void bench_print(FILE *out, const bench_gate *g, const char *path,
+                        const bench_result *r, size_t n, int *first) {
+    fprintf(out, "%s    {\"code\": %u, \"gate\": \"%s\", \"path\": \"%s\", \"qubits\": %zu, "
+                 "\"status\": \"%s\", \"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, "
+                 "\"errors\": %llu, \"first_error\": %ld}",
+            *first ? "" : ",\n", g->code, g->name, path, n, r->status,
+            r->median_ns, r->min_ns, (unsigned long long)r->errors, r->first_error);
+    *first = 0;
+}
+
+static void bench_usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-n iters] [-w warmup] [-r runs] [-c cpu] [-s sites]\n"
+            "          [-p lib,syscall,kernel] [-g gate] [-o file] [-l] [-x [batches]]\n"
+            "  -n  timed calls per run (default %d)\n"
+            "  -w  untimed calls before each run (default %d)\n"
+            "  -r  runs per gate and path; the median is reported (default %d, max %d)\n"
+            "  -c  CPU to pin to, -1 for none (default -1)\n"
+            "  -s  sites for the lattice, list and QRNG gates (default %d)\n"
+            "  -p  paths to measure (default all)\n"
+            "  -g  only gates whose name contains, or whose code equals, this\n"
+            "  -o  write the JSON here instead of stdout\n"
+            "  -l  keep userland gate logging on (off by default)\n"
+            "  -x  crossing mode: library vs per-gate syscall vs one submit per\n"
+            "      batch, at these comma-separated batch sizes (default %s)\n",
+            prog, NYMYA_BENCH_ITERS, NYMYA_BENCH_WARMUP, NYMYA_BENCH_RUNS,
+            NYMYA_BENCH_MAX_RUNS, NYMYA_BENCH_SITES, BENCH_BATCHES);
+}
+
+static unsigned int bench_parse_paths(const char *s) {
+    unsigned int paths = 0;
+
+    if (strstr(s, "lib")) paths |= BENCH_PATH_LIB;
+    if (strstr(s, "syscall")) paths |= BENCH_PATH_SYSCALL;
+    if (strstr(s, "kernel")) paths |= BENCH_PATH_KERNEL;
+    return paths;
+}
+
+int main(int argc, char **argv) {
+    bench_opts o = {
+        .iters = NYMYA_BENCH_ITERS, .warmup = NYMYA_BENCH_WARMUP, .runs = NYMYA_BENCH_RUNS,
+        .cpu = -1, .sites = NYMYA_BENCH_SITES,
+        .paths = BENCH_PATH_LIB | BENCH_PATH_SYSCALL | BENCH_PATH_KERNEL,
+    };
+    const size_t count = sizeof(bench_gates) / sizeof(bench_gates[0]);
+    static bench_result kernel[sizeof(bench_gates) / sizeof(bench_gates[0])];
+    const char *out_path = NULL;
+    int keep_log = 0, first = 1, crossing = 0, opt;
+    nymya_op *ops = NULL;
+    bench_state b;
+    struct utsname u;
+    FILE *out = stdout;
+
+    bench_parse_batches(BENCH_BATCHES, &o);
+    while ((opt = getopt(argc, argv, "n:w:r:c:s:p:g:o:lx::h")) != -1) {
+        switch (opt) {
+        case 'n': o.iters = strtoul(optarg, NULL, 10); break;
+        case 'w': o.warmup = strtoul(optarg, NULL, 10); break;
+        case 'r': o.runs = (unsigned int)strtoul(optarg, NULL, 10); break;
+        case 'c': o.cpu = atoi(optarg); break;
+        case 's': o.sites = strtoul(optarg, NULL, 10); break;
+        case 'p': o.paths = bench_parse_paths(optarg); break;
+        case 'g': o.filter = optarg; break;
+        case 'o': out_path = optarg; break;
+        case 'l': keep_log = 1; break;
+        case 'x':
+            crossing = 1;
+            if (!optarg && optind < argc && argv[optind][0] >= '0' && argv[optind][0] <= '9')
+                optarg = argv[optind++];
+            if (optarg && bench_parse_batches(optarg, &o)) {
+                bench_usage(argv[0]);
+                return 2;
+            }
+            break;
+        default:
+            bench_usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (!o.iters || !o.runs || o.runs > NYMYA_BENCH_MAX_RUNS || !o.paths ||
+        o.sites > NYMYA_BENCH_MAX_SITES) {
+        bench_usage(argv[0]);
+        return 2;
+    }
+    if (o.sites < 64) o.sites = 64; // Covers the largest fixed-size gate
+
+    if (o.cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(o.cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set)) {
+            perror("nymya_bench: sched_setaffinity");
+            return 1;
+        }
+    }
+    if (!keep_log) nymya_log_set_level(NYMYA_LOG_OFF);
+    if (bench_state_init(&b, o.sites)) {
+        fprintf(stderr, "nymya_bench: Out of memory for %zu sites\n", o.sites);
+        bench_state_free(&b);
+        return 1;
+    }
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        perror("nymya_bench: fopen");
+        bench_state_free(&b);
+        return 1;
+    }
+    if (uname(&u)) strcpy(u.machine, "unknown");
+
+    if (crossing) {
+        size_t most = 0;
+
+        for (unsigned int k = 0; k < o.nbatches; k++)
+            if (o.batches[k] > most) most = o.batches[k];
+        ops = malloc(most * sizeof(*ops));
+        if (!ops) {
+            fprintf(stderr, "nymya_bench: Out of memory for a batch of %zu\n", most);
+            if (out != stdout) fclose(out);
+            bench_state_free(&b);
+            return 1;
+        }
+
+        fprintf(out, "{\n  \"arch\": \"%s\", \"iters\": %lu, \"runs\": %u, \"cpu\": %d, "
+                     "\"sites\": %zu, \"batches\": [", u.machine, o.iters, o.runs, o.cpu, o.sites);
+        for (unsigned int k = 0; k < o.nbatches; k++)
+            fprintf(out, "%s%zu", k ? ", " : "", o.batches[k]);
+        fprintf(out, "],\n  \"crossing\": [\n");
+        for (size_t i = 0; i < count; i++) {
+            const bench_gate *g = &bench_gates[i];
+            bench_cross r;
+
+            if (!bench_op_gates[i].arity || !bench_selected(g, o.filter)) continue;
+            for (unsigned int k = 0; k < o.nbatches; k++) {
+                bench_crossing(g, &bench_op_gates[i], ops, o.batches[k], &b, &o, &r);
+                bench_print_cross(out, g, o.batches[k], &r, &first);
+            }
+        }
+        fprintf(out, "\n  ]\n}\n");
+        if (out != stdout) fclose(out);
+        free(ops);
+        bench_state_free(&b);
+        return 0;
+    }
+
+    fprintf(out, "{\n  \"arch\": \"%s\", \"iters\": %lu, \"warmup\": %lu, \"runs\": %u, "
+                 "\"cpu\": %d, \"sites\": %zu,\n  \"results\": [\n",
+            u.machine, o.iters, o.warmup, o.runs, o.cpu, o.sites);
+
+    if ((o.paths & BENCH_PATH_KERNEL) && bench_kernel(&o, kernel))
+        fprintf(stderr, "nymya_bench: Kernel path unavailable (load nymya_bench.ko, mount debugfs)\n");
+
+    for (size_t i = 0; i < count; i++) {
+        const bench_gate *g = &bench_gates[i];
+        size_t n = bench_sites(g, o.sites);
+        bench_result r;
+
+        if (!bench_selected(g, o.filter)) continue;
+        if (o.paths & BENCH_PATH_LIB) {
+            bench_time(g, g->lib, &b, &o, &r);
+            bench_print(out, g, "lib", &r, n, &first);
+        }
+        if (o.paths & BENCH_PATH_SYSCALL) {
+            bench_time(g, g->sys, &b, &o, &r);
+            bench_print(out, g, "syscall", &r, n, &first);
+        }
+        if (o.paths & BENCH_PATH_KERNEL)
+            bench_print(out, g, "kernel", &kernel[i], n, &first);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    bench_state_free(&b);
+    return 0;
+}
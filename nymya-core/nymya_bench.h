@@ -0,0 +1,48 @@
+// src/nymya_bench.h
+//
+// Settings shared by the userland benchmark (nymya_bench.c) and the
+// in-kernel benchmark module (nymya_bench_kmod.c). Both walk the gate table
+// in nymya.h (NYMYA_GATES) for codes, shapes and kernel cores.
+
+#ifndef NYMYA_BENCH_H
+#define NYMYA_BENCH_H
+
+#include "nymya.h"
+
+// Angle every parametric gate is benchmarked with, in radians
+#define NYMYA_BENCH_THETA 0.3
+
+// Default sizes and counts
+#define NYMYA_BENCH_ITERS  100000
+#define NYMYA_BENCH_WARMUP 1000
+#define NYMYA_BENCH_RUNS   5
+#define NYMYA_BENCH_SITES  64
+#define NYMYA_BENCH_MAX_RUNS  64
+#define NYMYA_BENCH_MAX_SITES 65536
+
+// Every gate is benchmarked, in NYMYA_GATES order
+#define NYMYA_BENCH_GATES(X) NYMYA_GATES(X)
+
+#define NYMYA_BENCH_COUNT_ONE(code, name, shape, n, kcore) + 1
+#define NYMYA_BENCH_COUNT (0 NYMYA_BENCH_GATES(NYMYA_BENCH_COUNT_ONE))
+
+// Whether a shape takes a caller-chosen number of sites rather than min_qubits
+#define NYMYA_BENCH_SIZED(shape) \
+    ((shape) == NYMYA_SHAPE_QLIST || (shape) == NYMYA_SHAPE_QPOS3 || \
+     (shape) == NYMYA_SHAPE_QPOS4 || (shape) == NYMYA_SHAPE_QPOS5 || \
+     (shape) == NYMYA_SHAPE_QRNG)
+
+// Path to the kernel module's control file, in debugfs
+#define NYMYA_BENCH_DEBUGFS_DIR "nymya_bench"
+#define NYMYA_BENCH_RUN_PATH    "/sys/kernel/debug/" NYMYA_BENCH_DEBUGFS_DIR "/run"
+#define NYMYA_BENCH_RESULT_PATH "/sys/kernel/debug/" NYMYA_BENCH_DEBUGFS_DIR "/results"
+
+/*
+ * Writing "<iters> <warmup> <runs> <cpu> <sites>" to the run file benchmarks
+ * every kernel core; the results file then holds one line per gate:
+ * "<code> <iters> <median_run_ns> <min_run_ns> <errors> <first_error>",
+ * where a run is <iters> calls and <first_error> is 0 or a negative errno
+ * (-EOPNOTSUPP for gates without a kernel core). <cpu> of -1 runs unpinned.
+ */
+
+#endif // NYMYA_BENCH_H
@@ -0,0 +1,356 @@
+// src/nymya_bench_kmod.c
+//
+// Test module behind the "kernel" path of nymya_bench: times every gate's
+// kernel core in a tight in-kernel loop, so the syscall entry and user copies
+// can be told apart from the gate arithmetic itself. Built out of tree by
+// "make bench-kmod" against the symbols nymya-core exports; control and
+// results go through debugfs, see nymya_bench.h for the protocol.
+
+#include "nymya.h"
+#include "nymya_bench.h"
+
+#ifdef __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+// Kernel cores nymya-core exports without a declaration in nymya.h
+int nymya_3301_identity_core(struct nymya_qubit *kq);
+int nymya_3305_pauli_z_core(struct nymya_qubit *kq);
+int nymya_3312_double_controlled_not_core(struct nymya_qubit *qc1, struct nymya_qubit *qc2,
+                                          struct nymya_qubit *qt);
+int nymya_3318_controlled_phase_s_core(struct nymya_qubit *k_qc, struct nymya_qubit *k_qt);
+int nymya_3344_peres_kernel_logic(struct nymya_qubit *q1, struct nymya_qubit *q2,
+                                  struct nymya_qubit *q3);
+int nymya_3351_tessellated_hex_rhombi_core(struct nymya_qubit **k_qubits, size_t count);
+int nymya_3354_metatron_cube_core(struct nymya_qubit **k_qubits, size_t count);
+int nymya_3355_fcc_lattice_core(nymya_qpos3d_k *k_qubits, size_t count);
+int nymya_3356_hcp_lattice_core(nymya_qpos3d_k *k_qubits, size_t count);
+int nymya_3357_e8_projected_lattice_core(nymya_qpos3d_k *k_qubits, size_t count);
+int nymya_3358_d4_lattice_core(nymya_qpos4d_k *k_q, size_t count);
+int nymya_3359_b5_lattice_core(nymya_qpos5d_k *k_q, size_t count);
+int nymya_3360_e5_projected_lattice_core(nymya_qpos5d_k *k_q, size_t count);
+
+/**
+ * struct nymya_bench_args - Arguments every core of a run is called with.
+ * @q: Qubits; @qp their pointer array.
+ * @pos3, @pos4, @pos5: Positioned sites for the lattice cores.
+ * @sites: Entries in each array.
+ */
+struct nymya_bench_args {
+    struct nymya_qubit *q;
+    struct nymya_qubit **qp;
+    nymya_qpos3d_k *pos3;
+    nymya_qpos4d_k *pos4;
+    nymya_qpos5d_k *pos5;
+    size_t sites;
+};
+
+/**
+ * struct nymya_bench_result - Timing of one core; one line of the results file.
+ * @code: Gate code.
+ * @iters: Calls per run, 0 if the gate was not run.
+ * @median_ns, @min_ns: Duration of the median and the fastest run.
+ * @errors: Failed calls in the timed loops.
+ * @first_error: Return value of the first failed call, or 0.
+ */
+struct nymya_bench_result {
+    unsigned int code;
+    unsigned long iters;
+    u64 median_ns;
+    u64 min_ns;
+    u64 errors;
+    long first_error;
+};
+
+/**
+ * struct nymya_bench_params - One request written to the run file.
+ */
+struct nymya_bench_params {
+    unsigned long iters;
+    unsigned long warmup;
+    unsigned int runs;
+    int cpu;
+    size_t sites;
+};
+
+typedef int (*nymya_bench_core_fn)(struct nymya_bench_args *a, size_t n);
+
+static struct nymya_bench_result nymya_bench_results[NYMYA_BENCH_COUNT];
+static DEFINE_MUTEX(nymya_bench_lock);
+static struct dentry *nymya_bench_dir;
+
+static void nymya_bench_oracle(struct nymya_qubit *q)
+{
+    nymya_3303_pauli_x(q);
+}
+
+static const int64_t nymya_bench_theta_fp = (int64_t)(NYMYA_BENCH_THETA * FIXED_POINT_SCALE);
+
+// Kernel core calls, by shape
+#define NYMYA_BENCH_K_Q(fn)            fn(a->qp[0])
+#define NYMYA_BENCH_K_Q_THETA(fn)      fn(a->qp[0], nymya_bench_theta_fp)
+#define NYMYA_BENCH_K_Q_AXIS_THETA(fn) fn(a->qp[0], 'X', nymya_bench_theta_fp)
+#define NYMYA_BENCH_K_Q2(fn)           fn(a->qp[0], a->qp[1])
+#define NYMYA_BENCH_K_Q2_THETA(fn)     fn(a->qp[0], a->qp[1], nymya_bench_theta_fp)
+#define NYMYA_BENCH_K_Q3(fn)           fn(a->qp[0], a->qp[1], a->qp[2])
+#define NYMYA_BENCH_K_QARR(fn)         fn(a->qp)
+#define NYMYA_BENCH_K_QLIST(fn)        fn(a->qp, n)
+#define NYMYA_BENCH_K_QPOS3(fn)        fn(a->pos3, n)
+#define NYMYA_BENCH_K_QPOS4(fn)        fn(a->pos4, n)
+#define NYMYA_BENCH_K_QPOS5(fn)        fn(a->pos5, n)
+#define NYMYA_BENCH_K_ORACLE(fn)       fn(a->qp[0], a->qp[1], nymya_bench_oracle)
+// The QRNG core writes to a user pointer; it has nothing to time in here
+#define NYMYA_BENCH_K_QRNG(fn)         -EOPNOTSUPP
+
+#define NYMYA_BENCH_CORE(code, name, shape, n_min, kcore) \
+    static int nymya_bench_core_##code(struct nymya_bench_args *a, size_t n) \
+    { \
+        (void)a; (void)n; \
+        return NYMYA_BENCH_K_##shape(kcore); \
+    }
+NYMYA_BENCH_GATES(NYMYA_BENCH_CORE)
+
+#define NYMYA_BENCH_ENTRY(code, name, shape, n_min, kcore) \
+    { code, NYMYA_SHAPE_##shape, n_min, nymya_bench_core_##code },
+static const struct {
+    unsigned int code;
+    enum nymya_gate_shape shape;
+    size_t min_qubits;
+    nymya_bench_core_fn fn;
+} nymya_bench_gates[] = {
+    NYMYA_BENCH_GATES(NYMYA_BENCH_ENTRY)
+};
+
+// Puts every qubit and site back to the same state before a run
+static void nymya_bench_reset(struct nymya_bench_args *a)
+{
+    const int64_t amp = FIXED_POINT_SQRT2_INV_FP;
+    size_t i;
+
+    for (i = 0; i < a->sites; i++) {
+        struct nymya_qubit *q = &a->q[i];
+        int64_t c = (int64_t)i << 32; // Sites on a unit-spaced line
+
+        memset(q, 0, sizeof(*q));
+        q->id = i + 1;
+        snprintf(q->tag, sizeof(q->tag), "bench%zu", i);
+        q->amplitude = make_complex(amp, amp);
+
+        a->pos3[i] = (nymya_qpos3d_k){ .q = *q, .x = c };
+        a->pos4[i] = (nymya_qpos4d_k){ .q = *q, .x = c };
+        a->pos5[i] = (nymya_qpos5d_k){ .q = *q, .x = c };
+    }
+}
+
+static void nymya_bench_args_free(struct nymya_bench_args *a)
+{
+    kvfree(a->q);
+    kvfree(a->qp);
+    kvfree(a->pos3);
+    kvfree(a->pos4);
+    kvfree(a->pos5);
+}
+
+static int nymya_bench_args_init(struct nymya_bench_args *a, size_t sites)
+{
+    size_t i;
+
+    memset(a, 0, sizeof(*a));
+    a->sites = sites;
+    a->q = kvcalloc(sites, sizeof(*a->q), GFP_KERNEL);
+    a->qp = kvcalloc(sites, sizeof(*a->qp), GFP_KERNEL);
+    a->pos3 = kvcalloc(sites, sizeof(*a->pos3), GFP_KERNEL);
+    a->pos4 = kvcalloc(sites, sizeof(*a->pos4), GFP_KERNEL);
+    a->pos5 = kvcalloc(sites, sizeof(*a->pos5), GFP_KERNEL);
+    if (!a->q || !a->qp || !a->pos3 || !a->pos4 || !a->pos5) {
+        nymya_bench_args_free(a);
+        return -ENOMEM;
+    }
+    for (i = 0; i < sites; i++)
+        a->qp[i] = &a->q[i];
+    return 0;
+}
+
+static int nymya_bench_cmp_u64(const void *x, const void *y)
+{
+    u64 a = *(const u64 *)x, b = *(const u64 *)y;
+
+    return a < b ? -1 : a > b;
+}
+
+/**
+ * nymya_bench_run - Times every kernel core; runs on the requested CPU.
+ * @arg: The struct nymya_bench_params of the request.
+ *
+ * Called with nymya_bench_lock held. Fills nymya_bench_results[].
+ *
+ * Returns 0, or -ENOMEM if the argument arrays cannot be allocated.
+ */
+static long nymya_bench_run(void *arg)
+{
+    const struct nymya_bench_params *p = arg;
+    struct nymya_bench_args a;
+    u64 runs[NYMYA_BENCH_MAX_RUNS];
+    size_t g;
+    int ret;
+
+    ret = nymya_bench_args_init(&a, p->sites);
+    if (ret)
+        return ret;
+
+    for (g = 0; g < ARRAY_SIZE(nymya_bench_gates); g++) {
+        struct nymya_bench_result *r = &nymya_bench_results[g];
+        size_t n = nymya_bench_gates[g].min_qubits;
+        unsigned int run;
+        unsigned long k;
+
+        if (NYMYA_BENCH_SIZED(nymya_bench_gates[g].shape) && p->sites > n)
+            n = p->sites;
+
+        memset(r, 0, sizeof(*r));
+        r->code = nymya_bench_gates[g].code;
+
+        nymya_bench_reset(&a);
+        ret = nymya_bench_gates[g].fn(&a, n);
+        if (ret == -EOPNOTSUPP) {
+            r->first_error = ret;
+            continue;
+        }
+
+        for (run = 0; run < p->runs; run++) {
+            u64 t0;
+
+            nymya_bench_reset(&a);
+            for (k = 0; k < p->warmup; k++)
+                nymya_bench_gates[g].fn(&a, n);
+
+            t0 = ktime_get_ns();
+            for (k = 0; k < p->iters; k++) {
+                ret = nymya_bench_gates[g].fn(&a, n);
+                if (unlikely(ret) && !r->errors++)
+                    r->first_error = ret;
+            }
+            runs[run] = ktime_get_ns() - t0;
+            // Runs are long; give the rest of the CPU a turn between them
+            cond_resched();
+        }
+
+        sort(runs, p->runs, sizeof(runs[0]), nymya_bench_cmp_u64, NULL);
+        r->iters = p->iters;
+        r->median_ns = runs[p->runs / 2];
+        r->min_ns = runs[0];
+    }
+
+    nymya_bench_args_free(&a);
+    return 0;
+}
+
+/**
+ * nymya_bench_run_write - Parses a request and runs the benchmark.
+ * @file: The run file.
+ * @ubuf: "<iters> <warmup> <runs> <cpu> <sites>".
+ * @count: Length of @ubuf.
+ * @ppos: Unused.
+ *
+ * Blocks until every core has been timed.
+ *
+ * Returns @count, -EINVAL for a malformed request or a CPU that is not
+ * online, -EFAULT, -EINTR, or -ENOMEM.
+ */
+static ssize_t nymya_bench_run_write(struct file *file, const char __user *ubuf,
+                                     size_t count, loff_t *ppos)
+{
+    struct nymya_bench_params p;
+    char buf[96];
+    long ret;
+
+    if (count >= sizeof(buf))
+        return -EINVAL;
+    if (copy_from_user(buf, ubuf, count))
+        return -EFAULT;
+    buf[count] = '\0';
+
+    if (sscanf(buf, "%lu %lu %u %d %zu", &p.iters, &p.warmup, &p.runs, &p.cpu, &p.sites) != 5)
+        return -EINVAL;
+    if (!p.iters || !p.runs || p.runs > NYMYA_BENCH_MAX_RUNS ||
+        p.sites > NYMYA_BENCH_MAX_SITES || p.cpu >= (int)nr_cpu_ids)
+        return -EINVAL;
+    if (p.sites < 64)
+        p.sites = 64; // Covers the largest fixed-size gate, as in userland
+
+    if (mutex_lock_interruptible(&nymya_bench_lock))
+        return -EINTR;
+    if (p.cpu < 0) {
+        ret = nymya_bench_run(&p);
+    } else if (!cpu_online(p.cpu)) {
+        ret = -EINVAL;
+    } else {
+        ret = work_on_cpu(p.cpu, nymya_bench_run, &p);
+    }
+    mutex_unlock(&nymya_bench_lock);
+
+    return ret ? ret : (ssize_t)count;
+}
+
+static const struct file_operations nymya_bench_run_fops = {
+    .owner = THIS_MODULE,
+    .write = nymya_bench_run_write,
+    .llseek = noop_llseek,
+};
+
+static int nymya_bench_results_show(struct seq_file *m, void *v)
+{
+    size_t g;
+
+    mutex_lock(&nymya_bench_lock);
+    for (g = 0; g < ARRAY_SIZE(nymya_bench_results); g++) {
+        const struct nymya_bench_result *r = &nymya_bench_results[g];
+
+        if (!r->code)
+            continue; // Not run yet
+        seq_printf(m, "%u %lu %llu %llu %llu %ld\n", r->code, r->iters,
+                   (unsigned long long)r->median_ns, (unsigned long long)r->min_ns,
+                   (unsigned long long)r->errors, r->first_error);
+    }
+    mutex_unlock(&nymya_bench_lock);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nymya_bench_results);
+
+static int __init nymya_bench_init(void)
+{
+    nymya_bench_dir = debugfs_create_dir(NYMYA_BENCH_DEBUGFS_DIR, NULL);
+    if (IS_ERR(nymya_bench_dir))
+        return PTR_ERR(nymya_bench_dir);
+
+    debugfs_create_file("run", 0200, nymya_bench_dir, NULL, &nymya_bench_run_fops);
+    debugfs_create_file("results", 0400, nymya_bench_dir, NULL, &nymya_bench_results_fops);
+    pr_info("Nymya Bench: Module loaded\n");
+    return 0;
+}
+
+static void __exit nymya_bench_exit(void)
+{
+    debugfs_remove_recursive(nymya_bench_dir);
+    pr_info("Nymya Bench: Module unloaded\n");
+}
+
+module_init(nymya_bench_init);
+module_exit(nymya_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Microbenchmark of the nymya-core gate kernel cores");
+
+#endif // __KERNEL__
@@ -0,0 +1,355 @@
+// src/nymya_btrace.c
+//
+// Opt-in binary gate traces for userland. Each thread appends fixed-size
+// nymya_btrace_rec records to its own memory-mapped file,
+// <dir>/nymya-<pid>-<tid>.nbt, so recording a gate is a handful of stores:
+// no formatting, no lock and no write() on the gate path. The file grows a
+// segment at a time and its header keeps the record count current, so a
+// process that dies mid-run still leaves a readable trace.
+//
+// NYMYA_BTRACE=<dir> starts tracing at the first gate; nymya_btrace_start()
+// and nymya_btrace_stop() do it under program control. Every gate call
+// through nymya_call_gate() is recorded with its code, qubits, parameter,
+// result and duration, and every log_symbolic_event() as a labelled event.
+// nymya_btrace_decode turns the files into text or Chrome trace JSON.
+
+#define _GNU_SOURCE // gettid()
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Records added to a trace file each time it fills (1 MiB)
+#define NYMYA_BTRACE_SEG 16384
+
+/**
+ * nymya_btrace_file - A thread's open trace file.
+ * @fd: The file.
+ * @gen: Trace generation the file belongs to.
+ * @pid: Process that opened it; a forked child starts its own.
+ * @hdr: Mapped header page.
+ * @win: Mapped window of NYMYA_BTRACE_SEG record slots.
+ * @first: Index of the first record in @win.
+ * @count: Records written.
+ */
+typedef struct nymya_btrace_file {
+    int fd;
+    unsigned int gen;
+    pid_t pid;
+    nymya_btrace_hdr *hdr;
+    nymya_btrace_rec *win;
+    uint64_t first;
+    uint64_t count;
+} nymya_btrace_file;
+
+static pthread_once_t nymya_btrace_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t nymya_btrace_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t nymya_btrace_key;
+static __thread nymya_btrace_file *nymya_btrace_self;
+static char nymya_btrace_dir[PATH_MAX];
+static int nymya_btrace_active;
+static unsigned int nymya_btrace_gen;
+
+/**
+ * nymya_btrace_now - CLOCK_MONOTONIC in nanoseconds, the time base of the records.
+ */
+uint64_t nymya_btrace_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static size_t nymya_btrace_hdr_bytes(void) {
+    long page = sysconf(_SC_PAGESIZE);
+
+    return page > 0 && (size_t)page > sizeof(nymya_btrace_hdr) ? (size_t)page : 4096;
+}
+
+// Closes @f; trims the file to its records unless the mapping belongs to the parent of a fork
+static void nymya_btrace_close(nymya_btrace_file *f, int trim) {
+    size_t hdr_bytes = nymya_btrace_hdr_bytes();
+
+    if (f->win) munmap(f->win, NYMYA_BTRACE_SEG * sizeof(*f->win));
+    if (f->hdr) munmap(f->hdr, hdr_bytes);
+    if (trim && f->fd >= 0 && ftruncate(f->fd, (off_t)(hdr_bytes + f->count * sizeof(*f->win)))) {
+        // The header's count still says where the records end
+    }
+    if (f->fd >= 0) close(f->fd);
+    f->fd = -1;
+    f->hdr = NULL;
+    f->win = NULL;
+}
+
+static void nymya_btrace_thread_exit(void *arg) {
+    nymya_btrace_file *f = arg;
+
+    nymya_btrace_close(f, 1);
+    free(f);
+}
+
+// The child of a fork must not write into its parent's files
+static void nymya_btrace_atfork_child(void) {
+    nymya_btrace_file *f = nymya_btrace_self;
+
+    if (f) {
+        nymya_btrace_close(f, 0);
+        f->pid = 0;
+    }
+}
+
+static void nymya_btrace_init(void) {
+    const char *env = getenv("NYMYA_BTRACE");
+
+    pthread_key_create(&nymya_btrace_key, nymya_btrace_thread_exit);
+    pthread_atfork(NULL, NULL, nymya_btrace_atfork_child);
+    if (env && *env && strlen(env) < sizeof(nymya_btrace_dir)) {
+        strcpy(nymya_btrace_dir, env);
+        __atomic_store_n(&nymya_btrace_active, 1, __ATOMIC_RELEASE);
+    }
+}
+
+// Maps the window holding record @f->count, growing the file by a segment
+static int nymya_btrace_map(nymya_btrace_file *f) {
+    size_t hdr_bytes = nymya_btrace_hdr_bytes();
+    size_t seg_bytes = NYMYA_BTRACE_SEG * sizeof(*f->win);
+    uint64_t first = f->count - f->count % NYMYA_BTRACE_SEG;
+    void *win;
+
+    if (f->win) munmap(f->win, seg_bytes);
+    f->win = NULL;
+    if (ftruncate(f->fd, (off_t)(hdr_bytes + (first + NYMYA_BTRACE_SEG) * sizeof(*f->win))))
+        return -1;
+    win = mmap(NULL, seg_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd,
+               (off_t)(hdr_bytes + first * sizeof(*f->win)));
+    if (win == MAP_FAILED) return -1;
+    f->win = win;
+    f->first = first;
+    return 0;
+}
+
+// Opens the calling thread's file for the current generation
+static int nymya_btrace_open(nymya_btrace_file *f, unsigned int gen) {
+    size_t hdr_bytes = nymya_btrace_hdr_bytes();
+    char path[PATH_MAX + 64];
+    struct timespec mono, real;
+    pid_t tid = gettid();
+    void *hdr;
+
+    pthread_mutex_lock(&nymya_btrace_lock);
+    snprintf(path, sizeof(path), "%s/nymya-%d-%d.nbt", nymya_btrace_dir, (int)getpid(), (int)tid);
+    pthread_mutex_unlock(&nymya_btrace_lock);
+
+    f->gen = gen;
+    f->pid = getpid();
+    f->count = 0;
+    f->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (f->fd < 0) return -1;
+    if (ftruncate(f->fd, (off_t)hdr_bytes)) goto fail;
+    hdr = mmap(NULL, hdr_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+    if (hdr == MAP_FAILED) goto fail;
+    f->hdr = hdr;
+
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    f->hdr->version = NYMYA_BTRACE_VERSION;
+    f->hdr->rec_size = sizeof(nymya_btrace_rec);
+    f->hdr->hdr_size = (uint32_t)hdr_bytes;
+    f->hdr->pid = (uint32_t)f->pid;
+    f->hdr->tid = (uint32_t)tid;
+    f->hdr->mono_ns = (uint64_t)mono.tv_sec * 1000000000ull + (uint64_t)mono.tv_nsec;
+    f->hdr->real_ns = (uint64_t)real.tv_sec * 1000000000ull + (uint64_t)real.tv_nsec;
+    if (nymya_btrace_map(f)) goto fail;
+    // The magic goes in last, so a decoder never sees a half-written header
+    __atomic_store_n(&f->hdr->magic, NYMYA_BTRACE_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+
+fail:
+    nymya_btrace_close(f, 0);
+    unlink(path);
+    return -1;
+}
+
+/*
+ * The calling thread's file, opened or reopened as the generation and pid
+ * require; NULL if tracing is off or the file cannot be had.
+ */
+static nymya_btrace_file *nymya_btrace_file_get(void) {
+    nymya_btrace_file *f = nymya_btrace_self;
+    unsigned int gen = __atomic_load_n(&nymya_btrace_gen, __ATOMIC_ACQUIRE);
+
+    if (f && f->fd >= 0 && f->gen == gen && f->pid) return f;
+    if (!f) {
+        f = calloc(1, sizeof(*f));
+        if (!f) return NULL;
+        f->fd = -1;
+        pthread_setspecific(nymya_btrace_key, f);
+        nymya_btrace_self = f;
+    }
+    if (f->fd >= 0) nymya_btrace_close(f, 1);
+    // A failed open is retried only in the next generation
+    if (f->gen == gen && f->pid && f->fd < 0 && f->count == UINT64_MAX) return NULL;
+    if (nymya_btrace_open(f, gen)) {
+        f->gen = gen;
+        f->pid = getpid();
+        f->count = UINT64_MAX;
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * nymya_btrace_enabled - True while gates are being traced.
+ *
+ * Reads NYMYA_BTRACE on first use. Cheap enough to test on every gate.
+ */
+int nymya_btrace_enabled(void) {
+    pthread_once(&nymya_btrace_once, nymya_btrace_init);
+    return __atomic_load_n(&nymya_btrace_active, __ATOMIC_RELAXED);
+}
+
+/**
+ * nymya_btrace_start - Starts tracing into a directory.
+ * @dir: Existing directory the per-thread files go to.
+ *
+ * Overrides NYMYA_BTRACE. Each thread opens a new file at its next record;
+ * files of an earlier start are closed by their threads at the same point.
+ *
+ * Returns 0, or -1 with errno set to EINVAL for a NULL or over-long @dir.
+ */
+int nymya_btrace_start(const char *dir) {
+    if (!dir || !*dir || strlen(dir) >= sizeof(nymya_btrace_dir)) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_once(&nymya_btrace_once, nymya_btrace_init);
+    pthread_mutex_lock(&nymya_btrace_lock);
+    strcpy(nymya_btrace_dir, dir);
+    __atomic_add_fetch(&nymya_btrace_gen, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&nymya_btrace_active, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&nymya_btrace_lock);
+    return 0;
+}
+
+/**
+ * nymya_btrace_stop - Stops tracing.
+ *
+ * The calling thread's file is trimmed and closed at once; other threads
+ * close theirs when they exit or tracing starts again.
+ */
+void nymya_btrace_stop(void) {
+    nymya_btrace_file *f = nymya_btrace_self;
+
+    pthread_once(&nymya_btrace_once, nymya_btrace_init);
+    pthread_mutex_lock(&nymya_btrace_lock);
+    __atomic_store_n(&nymya_btrace_active, 0, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&nymya_btrace_gen, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&nymya_btrace_lock);
+    if (f && f->fd >= 0) nymya_btrace_close(f, 1);
+}
+
+/**
+ * nymya_btrace_event - Appends one record to the calling thread's trace.
+ * @gate_code: NYMYA_*_CODE, or 0 for a labelled event.
+ * @q0: ID of the first qubit involved, or 0.
+ * @q1: ID of the second qubit involved, or 0.
+ * @param: Angle or exponent in Q32.32, or the number of sites or records.
+ * @result: Return code, 0 or -errno.
+ * @t0: nymya_btrace_now() when the call started, or 0 for an instant event.
+ * @label: Gate label, truncated to NYMYA_EVENT_LABEL_LEN bytes; may be NULL.
+ *
+ * Does nothing while tracing is off. errno is left as it was.
+ */
+void nymya_btrace_event(uint32_t gate_code, uint64_t q0, uint64_t q1, int64_t param,
+                        int32_t result, uint64_t t0, const char *label) {
+    int saved = errno;
+    nymya_btrace_file *f;
+    nymya_btrace_rec *r;
+    uint64_t now;
+
+    if (!nymya_btrace_enabled()) return;
+    f = nymya_btrace_file_get();
+    if (!f) goto out;
+    if (f->count - f->first >= NYMYA_BTRACE_SEG && nymya_btrace_map(f)) {
+        nymya_btrace_close(f, 1);
+        goto out;
+    }
+
+    now = nymya_btrace_now();
+    r = &f->win[f->count - f->first];
+    r->ts_ns = t0 ? t0 : now;
+    r->dur_ns = t0 ? now - t0 : 0;
+    r->qubit[0] = q0;
+    r->qubit[1] = q1;
+    r->param = param;
+    r->gate_code = gate_code;
+    r->result = result;
+    memset(r->label, 0, sizeof(r->label));
+    if (label) memcpy(r->label, label, strnlen(label, sizeof(r->label)));
+    f->count++;
+    __atomic_store_n(&f->hdr->count, f->count, __ATOMIC_RELEASE);
+
+out:
+    errno = saved;
+}
+
+// Labels of the calls past the gate table
+static const char *nymya_btrace_extra_label(uint32_t code) {
+    switch (code) {
+    case NYMYA_SUBMIT_CODE:         return "submit";
+    case NYMYA_LATTICE_SOA_CODE:    return "lattice_soa";
+    case NYMYA_SUBMIT_COMPACT_CODE: return "submit_compact";
+    case NYMYA_LATTICE_ARRAY_CODE:  return "lattice_array";
+    default:                        return NULL;
+    }
+}
+
+/**
+ * nymya_btrace_call - Records a finished nymya_call_gate() call.
+ * @code: Gate code of the call.
+ * @args: Its syscall arguments.
+ * @nargs: Number of arguments.
+ * @result: Its result, 0 or -errno.
+ * @t0: nymya_btrace_now() when it started.
+ *
+ * Qubit IDs are read from the first two qubit operands of a one- to
+ * three-qubit gate; the parameter is the angle of a gate that takes one,
+ * and the site or record count of the array, lattice and batch calls.
+ */
+void nymya_btrace_call(uint32_t code, const uint64_t *args, uint32_t nargs, long result, uint64_t t0) {
+    const nymya_gate_desc *d = nymya_gate_lookup(code);
+    uint64_t q[2] = { 0, 0 };
+    int64_t param = 0;
+    unsigned int i;
+
+    if (!args) nargs = 0;
+    if (d && d->nargs == nargs) {
+        for (i = 0; i < d->operands && i < 2; i++) {
+            const nymya_qubit_k *k = (const nymya_qubit_k *)(uintptr_t)args[i];
+
+            if (k) q[i] = k->id;
+        }
+        if (d->operands && nargs > d->operands) param = (int64_t)args[nargs - 1];
+        else if (d->shape == NYMYA_SHAPE_QARR) param = d->min_qubits;
+        else if (!d->operands && nargs >= 2) param = (int64_t)args[nargs == 4 ? 3 : 1];
+    } else if (nymya_btrace_extra_label(code) && nargs >= 3) {
+        // Submit: op_count; lattice_soa: count; lattice_array: count
+        param = (int64_t)args[code == NYMYA_LATTICE_SOA_CODE ? 3 : code == NYMYA_LATTICE_ARRAY_CODE ? 2 : 1];
+    }
+    nymya_btrace_event(code, q[0], q[1], param, (int32_t)result, t0,
+                       d ? d->name : nymya_btrace_extra_label(code));
+}
+
+#endif // __KERNEL__
@@ -0,0 +1,199 @@
+// src/nymya_btrace_decode.c
+//
+// Offline decoder for the binary gate traces of nymya_btrace.c. Reads any
+// number of per-thread .nbt files, merges their records by time and prints
+// them as text, one record per line, or as Chrome trace JSON for
+// chrome://tracing and Perfetto: gate calls as complete ("X") events,
+// labelled events as instant ("i") events, one track per thread.
+//
+//   nymya_btrace_decode [-f text|json] FILE...
+
+#define _GNU_SOURCE
+
+#include "nymya.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * btrace_in - One mapped trace file.
+ * @hdr: Its header.
+ * @recs: Its records.
+ * @count: Number of complete records.
+ */
+typedef struct btrace_in {
+    const nymya_btrace_hdr *hdr;
+    const nymya_btrace_rec *recs;
+    uint64_t count;
+} btrace_in;
+
+// A record and the file it came from, for sorting
+typedef struct btrace_ref {
+    const btrace_in *in;
+    const nymya_btrace_rec *rec;
+} btrace_ref;
+
+static void usage(void) {
+    fprintf(stderr, "usage: nymya_btrace_decode [-f text|json] FILE...\n");
+    exit(2);
+}
+
+// Maps @path and checks its header; 0, or -1 after a message on stderr
+static int btrace_open(const char *path, btrace_in *in) {
+    const nymya_btrace_hdr *h;
+    struct stat st;
+    void *map;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st)) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(*h)) {
+        fprintf(stderr, "%s: too short for a trace\n", path);
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    h = map;
+    if (h->magic != NYMYA_BTRACE_MAGIC || h->version != NYMYA_BTRACE_VERSION ||
+        h->rec_size != sizeof(nymya_btrace_rec) || h->hdr_size < sizeof(*h) ||
+        h->hdr_size > (uint64_t)st.st_size) {
+        fprintf(stderr, "%s: not a version %d nymya trace\n", path, NYMYA_BTRACE_VERSION);
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    in->hdr = h;
+    in->recs = (const nymya_btrace_rec *)((const char *)map + h->hdr_size);
+    in->count = h->count;
+    // A file cut short keeps the records it still holds
+    if (in->count > ((uint64_t)st.st_size - h->hdr_size) / sizeof(nymya_btrace_rec))
+        in->count = ((uint64_t)st.st_size - h->hdr_size) / sizeof(nymya_btrace_rec);
+    return 0;
+}
+
+/*
+ * Orders by start time. A call's record is written when it returns, after
+ * those of the events it logged, so a file is not sorted by itself; ties
+ * keep file and write order.
+ */
+static int btrace_cmp(const void *a, const void *b) {
+    const btrace_ref *x = a, *y = b;
+
+    if (x->rec->ts_ns != y->rec->ts_ns) return x->rec->ts_ns < y->rec->ts_ns ? -1 : 1;
+    if (x->in != y->in) return x->in < y->in ? -1 : 1;
+    return x->rec < y->rec ? -1 : x->rec > y->rec;
+}
+
+// Record label as a C string, with JSON-unsafe bytes replaced
+static void btrace_label(const nymya_btrace_rec *r, char out[NYMYA_EVENT_LABEL_LEN + 1]) {
+    size_t i;
+
+    for (i = 0; i < NYMYA_EVENT_LABEL_LEN && r->label[i]; i++) {
+        unsigned char c = (unsigned char)r->label[i];
+
+        out[i] = c < 0x20 || c >= 0x7f || c == '"' || c == '\\' ? '?' : (char)c;
+    }
+    out[i] = '\0';
+    if (!i) snprintf(out, NYMYA_EVENT_LABEL_LEN + 1, "%u", r->gate_code);
+}
+
+static void btrace_text(const btrace_in *in, const nymya_btrace_rec *r) {
+    uint64_t wall = in->hdr->real_ns + (r->ts_ns - in->hdr->mono_ns);
+    time_t sec = (time_t)(wall / 1000000000ull);
+    char label[NYMYA_EVENT_LABEL_LEN + 1], when[32];
+    struct tm tm;
+
+    btrace_label(r, label);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime_r(&sec, &tm));
+    printf("%s.%09llu %6u/%-6u %4u %-16s q=%llu,%llu param=%lld result=%d dur=%lluns\n",
+           when, (unsigned long long)(wall % 1000000000ull), in->hdr->pid, in->hdr->tid,
+           r->gate_code, label, (unsigned long long)r->qubit[0], (unsigned long long)r->qubit[1],
+           (long long)r->param, r->result, (unsigned long long)r->dur_ns);
+}
+
+static void btrace_json(const btrace_in *in, const nymya_btrace_rec *r, uint64_t base, int first) {
+    char label[NYMYA_EVENT_LABEL_LEN + 1];
+    uint64_t ts = r->ts_ns - base;
+
+    btrace_label(r, label);
+    printf("%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%llu.%03llu,",
+           first ? "" : ",", label, r->gate_code ? "gate" : "event", r->dur_ns ? "X" : "i",
+           (unsigned long long)(ts / 1000), (unsigned long long)(ts % 1000));
+    if (r->dur_ns)
+        printf("\"dur\":%llu.%03llu,", (unsigned long long)(r->dur_ns / 1000),
+               (unsigned long long)(r->dur_ns % 1000));
+    else
+        printf("\"s\":\"t\",");
+    printf("\"pid\":%u,\"tid\":%u,\"args\":{\"code\":%u,\"qubits\":[%llu,%llu],"
+           "\"param\":%lld,\"result\":%d}}",
+           in->hdr->pid, in->hdr->tid, r->gate_code, (unsigned long long)r->qubit[0],
+           (unsigned long long)r->qubit[1], (long long)r->param, r->result);
+}
+
+int main(int argc, char **argv) {
+    btrace_in *in;
+    btrace_ref *refs;
+    uint64_t base = UINT64_MAX, total = 0, k, j;
+    int json = 0, n = 0, opt, i;
+
+    while ((opt = getopt(argc, argv, "f:")) != -1) {
+        if (opt != 'f') usage();
+        if (strcmp(optarg, "json") == 0) json = 1;
+        else if (strcmp(optarg, "text") != 0) usage();
+    }
+    if (optind >= argc) usage();
+
+    in = calloc((size_t)(argc - optind), sizeof(*in));
+    if (!in) {
+        perror("calloc");
+        return 1;
+    }
+    for (i = optind; i < argc; i++) {
+        if (btrace_open(argv[i], &in[n]) == 0) n++;
+    }
+    if (!n) return 1;
+
+    // Timestamps are CLOCK_MONOTONIC in every file, so they merge directly
+    for (i = 0; i < n; i++) {
+        if (in[i].hdr->mono_ns < base) base = in[i].hdr->mono_ns;
+        total += in[i].count;
+    }
+    refs = malloc((total ? total : 1) * sizeof(*refs));
+    if (!refs) {
+        perror("malloc");
+        return 1;
+    }
+    for (i = 0, k = 0; i < n; i++) {
+        for (j = 0; j < in[i].count; j++, k++) {
+            refs[k].in = &in[i];
+            refs[k].rec = &in[i].recs[j];
+        }
+    }
+    qsort(refs, total, sizeof(*refs), btrace_cmp);
+    // The call that opened a file started a little before it
+    if (total && refs[0].rec->ts_ns < base) base = refs[0].rec->ts_ns;
+
+    if (json) printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (k = 0; k < total; k++) {
+        if (json) btrace_json(refs[k].in, refs[k].rec, base, k == 0);
+        else btrace_text(refs[k].in, refs[k].rec);
+    }
+    if (json) printf("\n]}\n");
+    return 0;
+}
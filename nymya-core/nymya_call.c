@@ -0,0 +1,429 @@
+// src/nymya_call.c
+//
+// Gate calls by code through /dev/nymya. NYMYA_CALL runs one gate with the
+// arguments of its numbered syscall; NYMYA_CALLV runs an array of such
+// calls in a single ioctl. Both dispatch to the nymya_call_<code>() entry
+// points that NYMYA_SYSCALL_DEFINEn generates next to each syscall, so a gate
+// behaves the same whichever way it is entered, and the module is usable on
+// kernels whose syscall tables were never patched for 3301-3365.
+//
+// Userland reaches the gates through nymya_call_gate(), which tries the
+// syscall first and switches to the device for good once it sees ENOSYS.
+// Without the device either it runs them in-process (nymya_local.c), unless
+// NYMYA_BACKEND or nymya_backend_set() asks for the kernel only; "local"
+// keeps every call in-process even where the module is loaded, and any
+// other name sends the calls to a plugin backend (nymya_backend.c).
+// Nothing is opened or loaded before the first gate call needs it.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#define NYMYA_DEVICE "/dev/nymya"
+
+// Set once a gate syscall returned ENOSYS; later calls go to the device
+static int call_nosys;
+static int call_fd = -1;
+static pthread_once_t call_once = PTHREAD_ONCE_INIT;
+static int call_backend;
+static pthread_once_t backend_once = PTHREAD_ONCE_INIT;
+
+static void call_open(void) {
+    call_fd = open(NYMYA_DEVICE, O_RDWR | O_CLOEXEC);
+}
+
+static void backend_init(void) {
+    const char *env = getenv("NYMYA_BACKEND");
+
+    if (!env || !*env || strcmp(env, "auto") == 0) return;
+    if (strcmp(env, "kernel") == 0) call_backend = NYMYA_BACKEND_KERNEL;
+    else if (strcmp(env, "local") == 0) call_backend = NYMYA_BACKEND_LOCAL;
+    else if (nymya_plugin_name(env) == 0) call_backend = NYMYA_BACKEND_PLUGIN;
+}
+
+/**
+ * nymya_backend_get - NYMYA_BACKEND_* the gate calls currently follow.
+ *
+ * Read once from the NYMYA_BACKEND environment variable: "auto", "kernel",
+ * "local", or the name of a plugin for NYMYA_BACKEND_PLUGIN. Without it, or
+ * with a name too long to load, the default is NYMYA_BACKEND_AUTO.
+ */
+int nymya_backend_get(void) {
+    pthread_once(&backend_once, backend_init);
+    return __atomic_load_n(&call_backend, __ATOMIC_RELAXED);
+}
+
+/**
+ * nymya_backend_set - Chooses where the gate calls run from now on.
+ * @backend: NYMYA_BACKEND_AUTO, _KERNEL, _LOCAL, or _PLUGIN for the plugin
+ *           named by NYMYA_BACKEND or nymya_backend_plugin().
+ *
+ * Overrides NYMYA_BACKEND for every thread. Calls already running finish
+ * where they started; registers and topologies kept in the module stay
+ * there, as nothing but the gate calls has an in-process form.
+ *
+ * Returns 0, or -1 with errno set to EINVAL for an unknown @backend.
+ */
+int nymya_backend_set(int backend) {
+    if (backend != NYMYA_BACKEND_AUTO && backend != NYMYA_BACKEND_KERNEL &&
+        backend != NYMYA_BACKEND_LOCAL && backend != NYMYA_BACKEND_PLUGIN) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_once(&backend_once, backend_init);
+    __atomic_store_n(&call_backend, backend, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// Kernel-style result of an in-process backend as syscall() would return it
+static long call_result(long ret) {
+    if (ret < 0) {
+        errno = (int)-ret;
+        return -1;
+    }
+    return ret;
+}
+
+static long call_local(uint32_t code, const uint64_t *args, uint32_t nargs) {
+    return call_result(nymya_local_call(code, args, nargs));
+}
+
+/**
+ * nymya_dev_fd - Process-wide /dev/nymya descriptor, opened on first use.
+ *
+ * Shared by the gate calls and the kernel-resident registers, so register
+ * handles are valid for every thread of the process.
+ *
+ * Returns the descriptor, or -1 with errno set to ENOSYS without the device.
+ */
+int nymya_dev_fd(void) {
+    pthread_once(&call_once, call_open);
+    if (call_fd < 0) errno = ENOSYS;
+    return call_fd;
+}
+
+static long call_gate(uint32_t code, const uint64_t *args, uint32_t nargs) {
+    uint64_t a[NYMYA_CALL_MAX_ARGS] = { 0 };
+    nymya_call c;
+    int backend = nymya_backend_get();
+    long ret;
+    int fd;
+
+    if ((!args && nargs) || nargs > NYMYA_CALL_MAX_ARGS) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (nargs) memcpy(a, args, nargs * sizeof(*a));
+    if (backend == NYMYA_BACKEND_LOCAL) return call_local(code, a, nargs);
+    if (backend == NYMYA_BACKEND_PLUGIN) return call_result(nymya_plugin_call(code, a, nargs));
+
+    if (!__atomic_load_n(&call_nosys, __ATOMIC_RELAXED)) {
+        ret = syscall(code, a[0], a[1], a[2], a[3], a[4], a[5]);
+        if (ret != -1 || errno != ENOSYS) return ret;
+        __atomic_store_n(&call_nosys, 1, __ATOMIC_RELAXED);
+    }
+
+    fd = nymya_dev_fd();
+    if (fd < 0) return backend == NYMYA_BACKEND_AUTO ? call_local(code, a, nargs) : -1;
+
+    memset(&c, 0, sizeof(c));
+    c.code = code;
+    c.nargs = nargs;
+    memcpy(c.args, a, sizeof(c.args));
+    return ioctl(fd, NYMYA_CALL, &c);
+}
+
+/**
+ * nymya_call_gate - Runs a gate syscall by code.
+ * @code: Gate code, NYMYA_*_CODE.
+ * @args: The syscall's arguments, widened to uint64_t.
+ * @nargs: Number of arguments (at most NYMYA_CALL_MAX_ARGS).
+ *
+ * Uses the numbered syscall while the kernel has it and NYMYA_CALL on
+ * /dev/nymya otherwise. Under NYMYA_BACKEND_LOCAL, or under
+ * NYMYA_BACKEND_AUTO with neither, the call runs in this process through
+ * nymya_local_call(), and under NYMYA_BACKEND_PLUGIN through the plugin,
+ * which the first such call loads. NYMYA_CALL_GATE() builds @args and @nargs from a
+ * plain argument list. While nymya_btrace_enabled(), each call is timed
+ * and recorded with nymya_btrace_call().
+ *
+ * Returns what syscall() would: the gate's result, or -1 with errno set.
+ */
+long nymya_call_gate(uint32_t code, const uint64_t *args, uint32_t nargs) {
+    uint64_t t0;
+    long ret;
+
+    if (!nymya_btrace_enabled()) return call_gate(code, args, nargs);
+
+    t0 = nymya_btrace_now();
+    ret = call_gate(code, args, nargs);
+    nymya_btrace_call(code, args, nargs, ret < 0 ? -errno : ret, t0);
+    return ret;
+}
+
+/**
+ * nymya_callv - Runs an array of gate calls in order.
+ * @calls: Call records; each record's ret is filled in as it runs.
+ * @count: Number of records.
+ * @flags: 0 to stop at the first failing call, or NYMYA_CALL_CONTINUE.
+ *
+ * The records go to the kernel with NYMYA_CALLV, NYMYA_SUBMIT_MAX_OPS at a
+ * time. Without /dev/nymya, or under NYMYA_BACKEND_LOCAL or _PLUGIN, each
+ * record is run through nymya_call_gate().
+ *
+ * Returns the number of calls run (the failing one included), or -1 with
+ * errno set if none could be.
+ */
+long nymya_callv(nymya_call *calls, size_t count, uint32_t flags) {
+    nymya_call_batch b;
+    size_t done = 0;
+    long ret;
+    int backend, fd;
+
+    if ((!calls && count) || (flags & ~NYMYA_CALL_CONTINUE)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    backend = nymya_backend_get();
+    fd = backend == NYMYA_BACKEND_LOCAL || backend == NYMYA_BACKEND_PLUGIN ? -1 : nymya_dev_fd();
+    while (done < count) {
+        size_t n = count - done;
+
+        if (fd < 0) {
+            nymya_call *c = &calls[done];
+
+            ret = nymya_call_gate(c->code, c->args, c->nargs);
+            c->ret = ret == -1 ? -errno : ret;
+            done++;
+            if (c->ret < 0 && !(flags & NYMYA_CALL_CONTINUE)) break;
+            continue;
+        }
+
+        if (n > NYMYA_SUBMIT_MAX_OPS) n = NYMYA_SUBMIT_MAX_OPS;
+        b.calls = (uint64_t)(uintptr_t)&calls[done];
+        b.count = (uint32_t)n;
+        b.flags = flags;
+        ret = ioctl(fd, NYMYA_CALLV, &b);
+        if (ret < 0) {
+            if (done) break;
+            return -1;
+        }
+        done += (size_t)ret;
+        if ((size_t)ret < n) break;
+    }
+    return (long)done;
+}
+
+#else // __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/uaccess.h>
+
+// Records NYMYA_CALLV copies in and out per pass (4 KiB)
+#define NYMYA_CALL_CHUNK 64
+
+// Batch and layout syscalls past the gate table, with their argument counts
+#define NYMYA_CALL_EXTRA(X) X(3362, 4) X(3363, 4) X(3364, 4) X(3365, 3)
+#define NYMYA_CALL_LAST 3365
+
+#define NYMYA_CALL_DECLARE_GATE(code, name, shape, n_min, kcore) long nymya_call_##code(const u64 *argv);
+#define NYMYA_CALL_DECLARE(code, n) long nymya_call_##code(const u64 *argv);
+NYMYA_GATES(NYMYA_CALL_DECLARE_GATE)
+NYMYA_CALL_EXTRA(NYMYA_CALL_DECLARE)
+#undef NYMYA_CALL_DECLARE_GATE
+#undef NYMYA_CALL_DECLARE
+
+// NYMYA_CALL for Pauli-X, which has a kernel function but no syscall
+long nymya_call_3303(const u64 *argv)
+{
+    struct nymya_qubit __user *user_q = u64_to_user_ptr(argv[0]);
+    u64 t0 = nymya_trace_syscall_begin(NYMYA_PAULI_X_CODE);
+    struct nymya_qubit kq;
+    long ret;
+
+    if (!user_q)
+        ret = -EINVAL;
+    else if (copy_from_user(&kq, user_q, sizeof(kq)))
+        ret = -EFAULT;
+    else {
+        ret = nymya_3303_pauli_x(&kq);
+        if (!ret && copy_to_user(user_q, &kq, sizeof(kq)))
+            ret = -EFAULT;
+    }
+
+    nymya_trace_syscall_end(NYMYA_PAULI_X_CODE, ret, t0);
+    return ret;
+}
+
+// Deutsch takes a kernel oracle pointer, which no call can carry
+long nymya_call_3342(const u64 *argv)
+{
+    return -ENOSYS;
+}
+
+/**
+ * struct nymya_call_entry - Dispatch slot of one gate code.
+ * @fn: Entry point taking the syscall's arguments as a u64 array; NULL if none.
+ * @nargs: Number of arguments @fn reads; 0 if the gate has no call.
+ */
+struct nymya_call_entry {
+    long (*fn)(const u64 *argv);
+    u32 nargs;
+};
+
+#define NYMYA_CALL_ENTRY_GATE(code, name, shape, n_min, kcore) \
+    [(code) - NYMYA_GATE_FIRST] = { nymya_call_##code, NYMYA_SHAPE_NARGS_##shape },
+#define NYMYA_CALL_ENTRY(code, n) [(code) - NYMYA_GATE_FIRST] = { nymya_call_##code, n },
+// Entry points by code - NYMYA_GATE_FIRST, generated from NYMYA_GATES
+static const struct nymya_call_entry nymya_call_table[NYMYA_CALL_LAST - NYMYA_GATE_FIRST + 1] = {
+    NYMYA_GATES(NYMYA_CALL_ENTRY_GATE)
+    NYMYA_CALL_EXTRA(NYMYA_CALL_ENTRY)
+};
+#undef NYMYA_CALL_ENTRY_GATE
+#undef NYMYA_CALL_ENTRY
+
+/**
+ * nymya_call_run - Runs one gate call by code.
+ * @code: Gate code.
+ * @args: The syscall's arguments; user pointers as u64 addresses.
+ * @nargs: Number of arguments the caller supplied.
+ *
+ * Must be called in the context of the process that owns the user pointers.
+ *
+ * Returns the gate's result, -ENOSYS for a code without a call, or -EINVAL
+ * if @nargs does not match the gate.
+ */
+long nymya_call_run(u32 code, const u64 *args, u32 nargs)
+{
+    const struct nymya_call_entry *e;
+
+    if (code < NYMYA_GATE_FIRST || code > NYMYA_CALL_LAST)
+        return -ENOSYS;
+    e = &nymya_call_table[code - NYMYA_GATE_FIRST];
+    if (!e->fn || !e->nargs)
+        return -ENOSYS;
+    if (nargs != e->nargs)
+        return -EINVAL;
+    return e->fn(args);
+}
+EXPORT_SYMBOL_GPL(nymya_call_run);
+
+/**
+ * nymya_call_one - Handles NYMYA_CALL.
+ * @ucall: User pointer to the nymya_call record.
+ *
+ * Returns the gate's result, which is also stored in @ucall->ret, or
+ * -EFAULT on copy failures.
+ */
+static long nymya_call_one(nymya_call __user *ucall)
+{
+    nymya_call c;
+    long ret;
+
+    if (copy_from_user(&c, ucall, sizeof(c)))
+        return -EFAULT;
+
+    ret = nymya_call_run(c.code, c.args, c.nargs);
+    if (put_user((s64)ret, &ucall->ret))
+        return -EFAULT;
+    return ret;
+}
+
+/**
+ * nymya_call_many - Handles NYMYA_CALLV.
+ * @ubatch: User pointer to the nymya_call_batch.
+ *
+ * Records are copied in NYMYA_CALL_CHUNK at a time, run in order, and
+ * copied back with their ret fields set. A failing call ends the batch
+ * unless NYMYA_CALL_CONTINUE is set; a fatal signal ends it between calls.
+ *
+ * Returns the number of calls run, the failing one included, or -EINVAL,
+ * -ENOMEM, -EFAULT or -EINTR if none ran.
+ */
+static long nymya_call_many(nymya_call_batch __user *ubatch)
+{
+    nymya_call_batch b;
+    nymya_call *k_calls;
+    nymya_call __user *ucalls;
+    size_t done = 0;
+    long err = 0;
+
+    if (copy_from_user(&b, ubatch, sizeof(b)))
+        return -EFAULT;
+    if (b.count == 0 || b.count > NYMYA_SUBMIT_MAX_OPS || (b.flags & ~NYMYA_CALL_CONTINUE))
+        return -EINVAL;
+
+    k_calls = kmalloc_array(NYMYA_CALL_CHUNK, sizeof(*k_calls), GFP_KERNEL_ACCOUNT);
+    if (!k_calls)
+        return -ENOMEM;
+
+    ucalls = u64_to_user_ptr(b.calls);
+    while (done < b.count && !err) {
+        size_t n = min_t(size_t, b.count - done, NYMYA_CALL_CHUNK);
+        size_t i;
+
+        if (copy_from_user(k_calls, ucalls + done, n * sizeof(*k_calls))) {
+            err = -EFAULT;
+            break;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (fatal_signal_pending(current)) {
+                err = -EINTR;
+                break;
+            }
+            k_calls[i].ret = nymya_call_run(k_calls[i].code, k_calls[i].args, k_calls[i].nargs);
+            if (k_calls[i].ret < 0 && !(b.flags & NYMYA_CALL_CONTINUE)) {
+                err = k_calls[i].ret;
+                i++;
+                break;
+            }
+        }
+
+        if (i && copy_to_user(ucalls + done, k_calls, i * sizeof(*k_calls))) {
+            err = -EFAULT;
+            break;
+        }
+        done += i;
+        cond_resched();
+    }
+
+    kfree(k_calls);
+    return done ? (long)done : err;
+}
+
+/**
+ * nymya_call_ioctl - Handles the gate call ioctls of /dev/nymya.
+ * @cmd: NYMYA_CALL or NYMYA_CALLV.
+ * @arg: User pointer argument of @cmd.
+ *
+ * Returns the result of the command, or -ENOTTY for any other @cmd.
+ */
+long nymya_call_ioctl(unsigned int cmd, unsigned long arg)
+{
+    switch (cmd) {
+    case NYMYA_CALL:
+        return nymya_call_one((nymya_call __user *)arg);
+    case NYMYA_CALLV:
+        return nymya_call_many((nymya_call_batch __user *)arg);
+    default:
+        return -ENOTTY;
+    }
+}
+
+#endif // __KERNEL__
@@ -0,0 +1,103 @@
+// src/nymya_cmul_rvv.c
+//
+// RVV kernels for fixed_complex_multiply_n() and fixed_complex_scale_n().
+// Segment loads split the interleaved {re, im} pairs into two registers;
+// vmul and vmulh give the low and high words of every 64x64 product, and the
+// sum or difference of two products is carried across the words before the
+// Q32.32 result is taken from the middle, as the scalar __int128 code does.
+// Called only from fixed_complex_multiply_n.c inside kernel_vector_begin().
+
+#include "nymya_cmul_simd.h"
+
+#ifdef NYMYA_CMUL_RVV
+
+#include <riscv_vector.h>
+
+// Bits 32..95 of the 128-bit value hi:lo
+static inline vint64m2_t nymya_rvv_mid(vint64m2_t hi, vint64m2_t lo, size_t vl)
+{
+    vuint64m2_t low = __riscv_vsrl_vx_u64m2(__riscv_vreinterpret_v_i64m2_u64m2(lo), 32, vl);
+
+    return __riscv_vor_vv_i64m2(__riscv_vsll_vx_i64m2(hi, 32, vl),
+                                __riscv_vreinterpret_v_u64m2_i64m2(low), vl);
+}
+
+// (x1*y1 - x2*y2) >> 32 with a 128-bit intermediate
+static inline vint64m2_t nymya_rvv_msub(vint64m2_t x1, vint64m2_t y1,
+                                        vint64m2_t x2, vint64m2_t y2, size_t vl)
+{
+    vint64m2_t lo1 = __riscv_vmul_vv_i64m2(x1, y1, vl);
+    vint64m2_t lo2 = __riscv_vmul_vv_i64m2(x2, y2, vl);
+    vbool32_t borrow = __riscv_vmsbc_vv_i64m2_b32(lo1, lo2, vl);
+    vint64m2_t hi = __riscv_vsbc_vvm_i64m2(__riscv_vmulh_vv_i64m2(x1, y1, vl),
+                                           __riscv_vmulh_vv_i64m2(x2, y2, vl), borrow, vl);
+
+    return nymya_rvv_mid(hi, __riscv_vsub_vv_i64m2(lo1, lo2, vl), vl);
+}
+
+// (x1*y1 + x2*y2) >> 32 with a 128-bit intermediate
+static inline vint64m2_t nymya_rvv_madd(vint64m2_t x1, vint64m2_t y1,
+                                        vint64m2_t x2, vint64m2_t y2, size_t vl)
+{
+    vint64m2_t lo1 = __riscv_vmul_vv_i64m2(x1, y1, vl);
+    vint64m2_t lo2 = __riscv_vmul_vv_i64m2(x2, y2, vl);
+    vbool32_t carry = __riscv_vmadc_vv_i64m2_b32(lo1, lo2, vl);
+    vint64m2_t hi = __riscv_vadc_vvm_i64m2(__riscv_vmulh_vv_i64m2(x1, y1, vl),
+                                           __riscv_vmulh_vv_i64m2(x2, y2, vl), carry, vl);
+
+    return nymya_rvv_mid(hi, __riscv_vadd_vv_i64m2(lo1, lo2, vl), vl);
+}
+
+static inline void nymya_rvv_store(complex_double *out, vint64m2_t re, vint64m2_t im, size_t vl)
+{
+    vint64m2x2_t v = __riscv_vundefined_i64m2x2();
+
+    v = __riscv_vset_v_i64m2_i64m2x2(v, 0, re);
+    v = __riscv_vset_v_i64m2_i64m2x2(v, 1, im);
+    __riscv_vsseg2e64_v_i64m2x2((int64_t *)out, v, vl);
+}
+
+void nymya_cmul_n_rvv(const complex_double *a, const complex_double *b,
+                      complex_double *out, size_t n)
+{
+    size_t i, vl;
+
+    for (i = 0; i < n; i += vl) {
+        vint64m2x2_t va, vb;
+        vint64m2_t ar, ai, br, bi;
+
+        vl = __riscv_vsetvl_e64m2(n - i);
+        va = __riscv_vlseg2e64_v_i64m2x2((const int64_t *)&a[i], vl);
+        vb = __riscv_vlseg2e64_v_i64m2x2((const int64_t *)&b[i], vl);
+        ar = __riscv_vget_v_i64m2x2_i64m2(va, 0);
+        ai = __riscv_vget_v_i64m2x2_i64m2(va, 1);
+        br = __riscv_vget_v_i64m2x2_i64m2(vb, 0);
+        bi = __riscv_vget_v_i64m2x2_i64m2(vb, 1);
+
+        nymya_rvv_store(&out[i], nymya_rvv_msub(ar, br, ai, bi, vl),
+                        nymya_rvv_madd(ar, bi, ai, br, vl), vl);
+    }
+}
+
+void nymya_cscale_n_rvv(const complex_double *a, complex_double s,
+                        complex_double *out, size_t n)
+{
+    size_t i, vl;
+
+    for (i = 0; i < n; i += vl) {
+        vint64m2x2_t va;
+        vint64m2_t ar, ai, sr, si;
+
+        vl = __riscv_vsetvl_e64m2(n - i);
+        va = __riscv_vlseg2e64_v_i64m2x2((const int64_t *)&a[i], vl);
+        ar = __riscv_vget_v_i64m2x2_i64m2(va, 0);
+        ai = __riscv_vget_v_i64m2x2_i64m2(va, 1);
+        sr = __riscv_vmv_v_x_i64m2(s.re, vl);
+        si = __riscv_vmv_v_x_i64m2(s.im, vl);
+
+        nymya_rvv_store(&out[i], nymya_rvv_msub(ar, sr, ai, si, vl),
+                        nymya_rvv_madd(ar, si, ai, sr, vl), vl);
+    }
+}
+
+#endif // NYMYA_CMUL_RVV
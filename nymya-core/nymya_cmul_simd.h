@@ -0,0 +1,26 @@
+// src/nymya_cmul_simd.h
+//
+// SIMD kernels behind fixed_complex_multiply_n() and fixed_complex_scale_n().
+// Each lives in its own object built with the vector flags of its
+// architecture, and must only be called between the matching
+// kernel_*_begin()/kernel_*_end() pair.
+
+#ifndef NYMYA_CMUL_SIMD_H
+#define NYMYA_CMUL_SIMD_H
+
+#include "nymya.h"
+
+#if defined(CONFIG_RISCV) && defined(CONFIG_RISCV_ISA_V)
+#define NYMYA_CMUL_RVV
+
+/*
+ * Kbuild for nymya_cmul_rvv.o needs the V extension in -march, e.g.
+ *   CFLAGS_nymya_cmul_rvv.o += -march=rv64imacv_zicsr_zifencei
+ */
+void nymya_cmul_n_rvv(const complex_double *a, const complex_double *b,
+                      complex_double *out, size_t n);
+void nymya_cscale_n_rvv(const complex_double *a, complex_double s,
+                        complex_double *out, size_t n);
+#endif
+
+#endif // NYMYA_CMUL_SIMD_H
@@ -34,8 +34,7 @@
  * @result: Pointer to a complex_double struct to store the result.
  */
 static __maybe_unused void nymya_kernel_cexp(int64_t theta_fp, complex_double *result) {
-    result->re = fixed_point_cos(theta_fp);
-    result->im = fixed_point_sin(theta_fp);
+    fixed_point_sincos(theta_fp, NYMYA_TRIG_TIER, &result->im, &result->re);
 }
 
 /**
@@ -0,0 +1,1283 @@
+// src/nymya_dev.c
+//
+// /dev/nymya: shared-memory qubit registers with in-place gate execution.
+// Each open file owns one register of kernel-layout qubits held in a
+// vmalloc_user() area. Userland mmaps the register, initialises and reads the
+// qubits directly, and applies gates by qubit index through ioctls. The gate
+// cores run on the shared pages themselves, so no qubit is ever copied in or
+// out with copy_from_user()/copy_to_user().
+//
+// The same device also takes gate calls by code on caller memory
+// (NYMYA_CALL, NYMYA_CALLV; see nymya_call.c), with or without a register,
+// and holds any number of further registers inside the module, addressed
+// by handle (NYMYA_KREG_*). Those are filled and read back with one copy
+// each, and batches run on them without touching userland memory.
+// Positional lattices can have their neighbour pairs found once and kept by
+// handle (NYMYA_TOPO_*); each later run is then only the Hadamard + CNOT
+// sweep, on user qubits or on such a register, and sites added or removed
+// in between cost only their neighbourhoods.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#define NYMYA_DEVICE "/dev/nymya"
+
+/**
+ * nymya_reg_open - Opens /dev/nymya and maps a register of @count qubits.
+ * @reg: Handle to initialise.
+ * @count: Number of qubits.
+ *
+ * The register starts zeroed; the caller fills in IDs, tags and Q32.32
+ * amplitudes through @reg->qubits.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_reg_open(nymya_reg *reg, size_t count) {
+    nymya_reg_params p;
+    void *mem;
+    int saved;
+
+    if (!reg || count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(reg, 0, sizeof(*reg));
+    reg->fd = open(NYMYA_DEVICE, O_RDWR | O_CLOEXEC);
+    if (reg->fd < 0) return -1;
+
+    memset(&p, 0, sizeof(p));
+    p.count = count;
+    if (ioctl(reg->fd, NYMYA_REG_ALLOC, &p) < 0) goto fail;
+
+    mem = mmap(NULL, p.reg_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, reg->fd, 0);
+    if (mem == MAP_FAILED) goto fail;
+
+    reg->qubits = mem;
+    reg->count = count;
+    reg->bytes = p.reg_bytes;
+    return 0;
+
+fail:
+    saved = errno;
+    close(reg->fd);
+    reg->fd = -1;
+    errno = saved;
+    return -1;
+}
+
+/**
+ * nymya_reg_close - Unmaps the register and closes the device.
+ * @reg: Handle from nymya_reg_open().
+ */
+void nymya_reg_close(nymya_reg *reg) {
+    if (!reg) return;
+    if (reg->qubits) munmap(reg->qubits, reg->bytes);
+    if (reg->fd >= 0) close(reg->fd);
+    memset(reg, 0, sizeof(*reg));
+    reg->fd = -1;
+}
+
+/**
+ * nymya_reg_gate - Applies one gate to the register in place.
+ * @reg: Open register.
+ * @op: Gate record; operand indices refer to @reg->qubits.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_reg_gate(nymya_reg *reg, const nymya_op *op) {
+    if (!reg || reg->fd < 0 || !op) {
+        errno = EINVAL;
+        return -1;
+    }
+    return ioctl(reg->fd, NYMYA_REG_GATE, op);
+}
+
+/**
+ * nymya_reg_submit - Applies a batch of gates to the register in place.
+ * @reg: Open register.
+ * @ops: Gate records, applied in order.
+ * @op_count: Number of records.
+ *
+ * Returns 0 on success, -1 on failure (errno is set). An invalid record
+ * rejects the whole batch before any gate runs.
+ */
+int nymya_reg_submit(nymya_reg *reg, const nymya_op *ops, size_t op_count) {
+    nymya_reg_batch b;
+
+    if (!reg || reg->fd < 0 || !ops || op_count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    b.ops = (uint64_t)(uintptr_t)ops;
+    b.op_count = op_count;
+    return ioctl(reg->fd, NYMYA_REG_SUBMIT, &b);
+}
+
+/**
+ * nymya_kreg_alloc - Allocates a register of @count qubits inside the module.
+ * @count: Number of qubits; the register starts zeroed.
+ *
+ * The register lives until nymya_kreg_free() or the end of the process.
+ *
+ * Returns the handle (positive), or -1 on failure (errno is set).
+ */
+int nymya_kreg_alloc(size_t count) {
+    nymya_kreg_params p;
+    int fd = nymya_dev_fd();
+
+    if (fd < 0) return -1;
+    if (count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&p, 0, sizeof(p));
+    p.count = count;
+    if (ioctl(fd, NYMYA_KREG_ALLOC, &p) < 0) return -1;
+    return (int)p.handle;
+}
+
+/**
+ * nymya_kreg_free - Frees a register from nymya_kreg_alloc().
+ * @handle: Register handle.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_kreg_free(int handle) {
+    int fd = nymya_dev_fd();
+
+    if (fd < 0) return -1;
+    return ioctl(fd, NYMYA_KREG_FREE, (unsigned long)handle);
+}
+
+// NYMYA_KREG_WRITE / NYMYA_KREG_READ on qubits first .. first + count - 1
+static int kreg_io(unsigned long cmd, int handle, size_t first, const void *qubits, size_t count) {
+    nymya_kreg_io io;
+    int fd = nymya_dev_fd();
+
+    if (fd < 0) return -1;
+    if (handle <= 0 || !qubits || count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&io, 0, sizeof(io));
+    io.handle = (uint32_t)handle;
+    io.first = first;
+    io.count = count;
+    io.qubits = (uint64_t)(uintptr_t)qubits;
+    return ioctl(fd, cmd, &io);
+}
+
+/**
+ * nymya_kreg_write - Loads Q32.32 qubits into a register.
+ * @handle: Register handle.
+ * @first: First register index to overwrite.
+ * @qubits: Source records.
+ * @count: Number of records.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_kreg_write(int handle, size_t first, const nymya_qubit_k *qubits, size_t count) {
+    return kreg_io(NYMYA_KREG_WRITE, handle, first, qubits, count);
+}
+
+/**
+ * nymya_kreg_read - Copies qubits of a register out.
+ * @handle: Register handle.
+ * @first: First register index to read.
+ * @qubits: Destination records.
+ * @count: Number of records.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_kreg_read(int handle, size_t first, nymya_qubit_k *qubits, size_t count) {
+    return kreg_io(NYMYA_KREG_READ, handle, first, qubits, count);
+}
+
+/**
+ * nymya_kreg_submit - Applies a batch of gates to a register.
+ * @handle: Register handle.
+ * @ops: Gate records; operand indices refer to the register.
+ * @op_count: Number of records.
+ *
+ * Returns 0 on success, -1 on failure (errno is set). An invalid record
+ * rejects the whole batch before any gate runs.
+ */
+int nymya_kreg_submit(int handle, const nymya_op *ops, size_t op_count) {
+    nymya_kreg_batch b;
+    int fd = nymya_dev_fd();
+
+    if (fd < 0) return -1;
+    if (handle <= 0 || !ops || op_count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&b, 0, sizeof(b));
+    b.handle = (uint32_t)handle;
+    b.ops = (uint64_t)(uintptr_t)ops;
+    b.op_count = op_count;
+    return ioctl(fd, NYMYA_KREG_SUBMIT, &b);
+}
+
+/**
+ * nymya_kreg_gate - Applies one gate to a register.
+ * @handle: Register handle.
+ * @op: Gate record; operand indices refer to the register.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_kreg_gate(int handle, const nymya_op *op) {
+    return nymya_kreg_submit(handle, op, 1);
+}
+
+// Shared by nymya_topo_build() and _box(); @box NULL is an open lattice
+static int nymya_topo_build_run(unsigned int lattice_code, const double *const coords[],
+                                const double *box, size_t count) {
+    unsigned int dims = NYMYA_LATTICE_DIMS(lattice_code);
+    uint64_t axes[NYMYA_LATTICE_MAX_DIM + 1];
+    int64_t box_fp[NYMYA_LATTICE_MAX_DIM];
+    nymya_topo_params p;
+    int64_t *fp;
+    int fd = nymya_dev_fd(), ret;
+
+    if (fd < 0) return -1;
+    if (!dims || !coords || count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (unsigned int k = 0; k < dims; k++) {
+        if (!coords[k]) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    fp = malloc(count * dims * sizeof(*fp));
+    if (!fp) return -1;
+
+    // Scale to fixed-point, one array per axis
+    for (unsigned int k = 0; k < dims; k++) {
+        int64_t *axis = fp + (size_t)k * count;
+
+        for (size_t i = 0; i < count; i++)
+            axis[i] = (int64_t)(coords[k][i] * FIXED_POINT_SCALE);
+        axes[k] = (uint64_t)(uintptr_t)axis;
+    }
+    if (box) {
+        for (unsigned int k = 0; k < dims; k++)
+            box_fp[k] = (int64_t)(box[k] * FIXED_POINT_SCALE);
+        axes[dims] = (uint64_t)(uintptr_t)box_fp;
+        lattice_code |= NYMYA_LATTICE_PERIODIC;
+    }
+
+    memset(&p, 0, sizeof(p));
+    p.lattice_code = lattice_code;
+    p.count = count;
+    p.axes = (uint64_t)(uintptr_t)axes;
+    ret = ioctl(fd, NYMYA_TOPO_BUILD, &p);
+    free(fp);
+    return ret < 0 ? -1 : (int)p.handle;
+}
+
+/**
+ * nymya_topo_build - Finds a positional lattice's neighbour pairs once, inside the module.
+ * @lattice_code: NYMYA_*_CODE of the lattice gate, 3355 to 3360.
+ * @coords: NYMYA_LATTICE_DIMS(@lattice_code) arrays of @count coordinates.
+ * @count: Number of sites.
+ *
+ * The pairs are those the lattice gate would find on these coordinates;
+ * nymya_topo_apply() then runs the gate on new amplitudes without searching
+ * again. The topology lives until nymya_topo_free() or the end of the process.
+ *
+ * Returns the handle (positive), or -1 on failure (errno is set).
+ */
+int nymya_topo_build(unsigned int lattice_code, const double *const coords[], size_t count) {
+    return nymya_topo_build_run(lattice_code, coords, NULL, count);
+}
+
+/**
+ * nymya_topo_build_box - nymya_topo_build() for sites in a periodic box.
+ * @lattice_code: NYMYA_*_CODE of the lattice gate, 3355 to 3360.
+ * @coords: NYMYA_LATTICE_DIMS(@lattice_code) arrays of @count coordinates.
+ * @box: Box edge along each axis, 0 for an open axis; NULL for an open lattice.
+ * @count: Number of sites.
+ *
+ * Pairs are found by minimum image, and sites added later with
+ * nymya_topo_insert() wrap around the same box. Each edge must be at least
+ * twice the gate's cutoff.
+ *
+ * Returns the handle (positive), or -1 on failure (errno is set).
+ */
+int nymya_topo_build_box(unsigned int lattice_code, const double *const coords[],
+                         const double *box, size_t count) {
+    return nymya_topo_build_run(lattice_code, coords, box, count);
+}
+
+/**
+ * nymya_topo_free - Frees a topology from nymya_topo_build().
+ * @handle: Topology handle.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_topo_free(int handle) {
+    int fd = nymya_dev_fd();
+
+    if (fd < 0) return -1;
+    return ioctl(fd, NYMYA_TOPO_FREE, (unsigned long)handle);
+}
+
+/**
+ * nymya_topo_apply - Runs a lattice gate on @qubits over a stored topology.
+ * @handle: Topology from nymya_topo_build().
+ * @qubits: Qubit of each site, in the order of the coordinates.
+ * @count: Number of sites; must match the topology.
+ *
+ * Hadamard on every site, then CNOT on every stored pair, exactly as the
+ * lattice gate would on the same coordinates.
+ *
+ * Returns 0 on success, -1 on failure (errno is set); @qubits is then unchanged.
+ */
+int nymya_topo_apply(int handle, nymya_qubit qubits[], size_t count) {
+    nymya_topo_run run;
+    nymya_qubit_k *buf;
+    int fd = nymya_dev_fd(), ret;
+
+    if (fd < 0) return -1;
+    if (handle <= 0 || !qubits || count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    buf = malloc(count * sizeof(*buf));
+    if (!buf) return -1;
+    for (size_t i = 0; i < count; i++) {
+        buf[i].id = qubits[i].id;
+        memcpy(buf[i].tag, qubits[i].tag, NYMYA_TAG_MAXLEN);
+        buf[i].re = (int64_t)(creal(qubits[i].amplitude) * FIXED_POINT_SCALE);
+        buf[i].im = (int64_t)(cimag(qubits[i].amplitude) * FIXED_POINT_SCALE);
+    }
+
+    memset(&run, 0, sizeof(run));
+    run.handle = (uint32_t)handle;
+    run.qubits = (uint64_t)(uintptr_t)buf;
+    run.count = count;
+    ret = ioctl(fd, NYMYA_TOPO_RUN, &run);
+    if (ret == 0) {
+        for (size_t i = 0; i < count; i++) {
+            qubits[i].amplitude = (double)buf[i].re / FIXED_POINT_SCALE
+                                + (double)buf[i].im / FIXED_POINT_SCALE * I;
+        }
+    }
+    free(buf);
+    return ret;
+}
+
+/**
+ * nymya_topo_apply_kreg - Runs a lattice gate on a kernel-resident register.
+ * @handle: Topology from nymya_topo_build().
+ * @kreg: Register from nymya_kreg_alloc(), one qubit per site.
+ *
+ * No qubit crosses the user/kernel boundary.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_topo_apply_kreg(int handle, int kreg) {
+    nymya_topo_run run;
+    int fd = nymya_dev_fd();
+
+    if (fd < 0) return -1;
+    if (handle <= 0 || kreg <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&run, 0, sizeof(run));
+    run.handle = (uint32_t)handle;
+    run.kreg = (uint32_t)kreg;
+    return ioctl(fd, NYMYA_TOPO_RUN, &run);
+}
+
+/**
+ * nymya_topo_insert - Adds sites to a topology.
+ * @handle: Topology from nymya_topo_build().
+ * @dims: Coordinates per site; must match the topology's lattice.
+ * @pos: @count sites of @dims coordinates each, one site after another.
+ * @count: Number of sites.
+ *
+ * The new sites take the next indices in order, so the caller appends
+ * their qubits to its array. The work is proportional to the new sites'
+ * neighbourhoods, not to the lattice.
+ *
+ * Returns the index of the first new site, or -1 on failure (errno is
+ * set); no site is added then.
+ */
+long nymya_topo_insert(int handle, unsigned int dims, const double *pos, size_t count) {
+    nymya_topo_edit ed;
+    int64_t *fp;
+    int fd = nymya_dev_fd(), ret;
+
+    if (fd < 0) return -1;
+    if (handle <= 0 || !dims || dims > NYMYA_LATTICE_MAX_DIM || !pos ||
+        count == 0 || count > NYMYA_TOPO_MAX_EDIT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fp = malloc(count * dims * sizeof(*fp));
+    if (!fp) return -1;
+    for (size_t i = 0; i < count * dims; i++)
+        fp[i] = (int64_t)(pos[i] * FIXED_POINT_SCALE);
+
+    memset(&ed, 0, sizeof(ed));
+    ed.handle = (uint32_t)handle;
+    ed.dims = dims;
+    ed.count = count;
+    ed.sites = (uint64_t)(uintptr_t)fp;
+    ret = ioctl(fd, NYMYA_TOPO_INSERT, &ed);
+    free(fp);
+    return ret < 0 ? -1 : (long)ed.first;
+}
+
+/**
+ * nymya_topo_delete - Removes sites from a topology.
+ * @handle: Topology from nymya_topo_build().
+ * @sites: Indices to remove, applied in order.
+ * @count: Number of indices.
+ *
+ * Each removal moves the current last site into the freed index; the
+ * caller moves its qubits the same way so that later runs line up.
+ *
+ * Returns 0 on success, -1 on failure (errno is set); no site is removed then.
+ */
+int nymya_topo_delete(int handle, const uint32_t *sites, size_t count) {
+    nymya_topo_edit ed;
+    int fd = nymya_dev_fd();
+
+    if (fd < 0) return -1;
+    if (handle <= 0 || !sites || count == 0 || count > NYMYA_TOPO_MAX_EDIT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&ed, 0, sizeof(ed));
+    ed.handle = (uint32_t)handle;
+    ed.count = count;
+    ed.sites = (uint64_t)(uintptr_t)sites;
+    return ioctl(fd, NYMYA_TOPO_DELETE, &ed);
+}
+
+#else // __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mutex.h>
+#include <linux/miscdevice.h>
+#include <linux/uaccess.h>
+#include <linux/xarray.h>
+
+/**
+ * struct nymya_kreg - Register held inside the module (NYMYA_KREG_*).
+ * @qubits: Kernel qubits, never mapped into userland.
+ * @count: Number of qubits in @qubits.
+ * @quota: Process the register is charged to, or NULL.
+ */
+struct nymya_kreg {
+    struct nymya_qubit *qubits;
+    size_t count;
+    struct nymya_quota *quota;
+};
+
+/**
+ * struct nymya_dev_ctx - Per-open register state.
+ * @lock: Serialises allocation, mmap and gate execution on the registers.
+ * @qubits: vmalloc_user() register shared with userland; NULL until NYMYA_REG_ALLOC.
+ * @count: Number of qubits in @qubits.
+ * @bytes: Page-aligned size of @qubits.
+ * @quota: Process @qubits is charged to, or NULL.
+ * @kregs: Kernel-resident registers by handle (1 to NYMYA_KREG_MAX_HANDLES).
+ * @topos: Lattice topologies by handle (1 to NYMYA_TOPO_MAX_HANDLES).
+ */
+struct nymya_dev_ctx {
+    struct mutex lock;
+    struct nymya_qubit *qubits;
+    size_t count;
+    size_t bytes;
+    struct nymya_quota *quota;
+    struct xarray kregs;
+    struct xarray topos;
+};
+
+static void nymya_kreg_destroy(struct nymya_kreg *r)
+{
+    kvfree(r->qubits);
+    nymya_quota_uncharge(r->quota, NYMYA_QUOTA_REG, r->count * sizeof(*r->qubits));
+    kfree(r);
+}
+
+static void nymya_topo_destroy(struct nymya_lattice_topo *topo)
+{
+    nymya_lattice_topo_free(topo);
+    kfree(topo);
+}
+
+static int nymya_dev_open(struct inode *inode, struct file *file)
+{
+    struct nymya_dev_ctx *ctx = kzalloc(sizeof(*ctx), GFP_KERNEL_ACCOUNT);
+
+    if (!ctx)
+        return -ENOMEM;
+
+    mutex_init(&ctx->lock);
+    xa_init_flags(&ctx->kregs, XA_FLAGS_ALLOC1);
+    xa_init_flags(&ctx->topos, XA_FLAGS_ALLOC1);
+    file->private_data = ctx;
+    return 0;
+}
+
+static int nymya_dev_release(struct inode *inode, struct file *file)
+{
+    struct nymya_dev_ctx *ctx = file->private_data;
+    struct nymya_lattice_topo *topo;
+    struct nymya_kreg *r;
+    unsigned long id;
+
+    xa_for_each(&ctx->kregs, id, r)
+        nymya_kreg_destroy(r);
+    xa_destroy(&ctx->kregs);
+    xa_for_each(&ctx->topos, id, topo)
+        nymya_topo_destroy(topo);
+    xa_destroy(&ctx->topos);
+    vfree(ctx->qubits);
+    nymya_quota_uncharge(ctx->quota, NYMYA_QUOTA_REG, ctx->bytes);
+    mutex_destroy(&ctx->lock);
+    kfree(ctx);
+    return 0;
+}
+
+/**
+ * nymya_dev_reg_alloc - Handles NYMYA_REG_ALLOC.
+ * @ctx: Register state of the open file.
+ * @uparams: User pointer to nymya_reg_params.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -EBUSY if the register was already allocated.
+ * - -EINVAL if the qubit count is zero or too large.
+ * - -EDQUOT if the register would take the process past quota_reg_bytes.
+ * - -ENOMEM if the register cannot be allocated.
+ * - -EFAULT on copy failures.
+ */
+static long nymya_dev_reg_alloc(struct nymya_dev_ctx *ctx, nymya_reg_params __user *uparams)
+{
+    nymya_reg_params p;
+    struct nymya_quota *quota;
+    size_t bytes;
+    void *mem;
+    int ret;
+
+    if (copy_from_user(&p, uparams, sizeof(p)))
+        return -EFAULT;
+    if (p.count == 0 || p.count > NYMYA_SUBMIT_MAX_QUBITS)
+        return -EINVAL;
+
+    bytes = PAGE_ALIGN(p.count * sizeof(struct nymya_qubit));
+
+    mutex_lock(&ctx->lock);
+    if (ctx->qubits) {
+        mutex_unlock(&ctx->lock);
+        return -EBUSY;
+    }
+
+    ret = nymya_quota_charge(NYMYA_QUOTA_REG, bytes, &quota);
+    if (ret) {
+        mutex_unlock(&ctx->lock);
+        return ret;
+    }
+    // vmalloc_user() pages are zeroed, never swapped, and mappable by
+    // remap_vmalloc_range(); it takes no GFP flags, so only the quota counts them
+    mem = vmalloc_user(bytes);
+    if (!mem) {
+        nymya_quota_uncharge(quota, NYMYA_QUOTA_REG, bytes);
+        mutex_unlock(&ctx->lock);
+        return -ENOMEM;
+    }
+    ctx->qubits = mem;
+    ctx->count = p.count;
+    ctx->bytes = bytes;
+    ctx->quota = quota;
+    mutex_unlock(&ctx->lock);
+
+    p.reg_bytes = bytes;
+    if (copy_to_user(uparams, &p, sizeof(p)))
+        return -EFAULT;
+
+    return 0;
+}
+
+/**
+ * nymya_dev_reg_run - Runs gate records on the register in place.
+ * @ctx: Register state of the open file.
+ * @ops: Kernel copy of the records.
+ * @op_count: Number of records.
+ *
+ * Returns -EINVAL before NYMYA_REG_ALLOC, otherwise the result of
+ * nymya_3362_submit_core().
+ */
+static long nymya_dev_reg_run(struct nymya_dev_ctx *ctx, const nymya_op *ops, size_t op_count)
+{
+    long ret;
+
+    mutex_lock(&ctx->lock);
+    if (!ctx->qubits)
+        ret = -EINVAL;
+    else
+        ret = nymya_3362_submit_core(ops, op_count, ctx->qubits, ctx->count);
+    mutex_unlock(&ctx->lock);
+
+    return ret;
+}
+
+/**
+ * nymya_dev_ops_in - Copies a batch's gate records into the kernel.
+ * @uops: User address of the records.
+ * @op_count: Number of records (1 to NYMYA_SUBMIT_MAX_OPS).
+ *
+ * Returns a kvmalloc'd copy for kvfree(), or ERR_PTR(-EINVAL, -ENOMEM or -EFAULT).
+ */
+static nymya_op *nymya_dev_ops_in(u64 uops, u64 op_count)
+{
+    nymya_op *k_ops;
+
+    if (op_count == 0 || op_count > NYMYA_SUBMIT_MAX_OPS)
+        return ERR_PTR(-EINVAL);
+
+    k_ops = kvmalloc_array(op_count, sizeof(*k_ops), GFP_KERNEL_ACCOUNT);
+    if (!k_ops)
+        return ERR_PTR(-ENOMEM);
+
+    if (copy_from_user(k_ops, u64_to_user_ptr(uops), op_count * sizeof(*k_ops))) {
+        kvfree(k_ops);
+        return ERR_PTR(-EFAULT);
+    }
+    return k_ops;
+}
+
+/**
+ * nymya_dev_reg_submit - Handles NYMYA_REG_SUBMIT.
+ * @ctx: Register state of the open file.
+ * @ubatch: User pointer to nymya_reg_batch.
+ *
+ * Only the records are copied into the kernel; the qubits are not.
+ *
+ * Returns 0 on success, -EINVAL, -ENOMEM, -EFAULT, or a gate core error.
+ */
+static long nymya_dev_reg_submit(struct nymya_dev_ctx *ctx, nymya_reg_batch __user *ubatch)
+{
+    nymya_reg_batch b;
+    nymya_op *k_ops;
+    long ret;
+
+    if (copy_from_user(&b, ubatch, sizeof(b)))
+        return -EFAULT;
+
+    k_ops = nymya_dev_ops_in(b.ops, b.op_count);
+    if (IS_ERR(k_ops))
+        return PTR_ERR(k_ops);
+
+    ret = nymya_dev_reg_run(ctx, k_ops, b.op_count);
+    kvfree(k_ops);
+    return ret;
+}
+
+/**
+ * nymya_dev_kreg_alloc - Handles NYMYA_KREG_ALLOC.
+ * @ctx: State of the open file.
+ * @uparams: User pointer to nymya_kreg_params.
+ *
+ * Returns:
+ * - 0 on success, with the handle stored in @uparams.
+ * - -EINVAL if the qubit count is zero or too large.
+ * - -EBUSY if the file already holds NYMYA_KREG_MAX_HANDLES registers.
+ * - -EDQUOT if the register would take the process past quota_reg_bytes.
+ * - -ENOMEM if the register cannot be allocated.
+ * - -EFAULT on copy failures.
+ */
+static long nymya_dev_kreg_alloc(struct nymya_dev_ctx *ctx, nymya_kreg_params __user *uparams)
+{
+    nymya_kreg_params p;
+    struct nymya_kreg *r;
+    u32 id;
+    int ret;
+
+    if (copy_from_user(&p, uparams, sizeof(p)))
+        return -EFAULT;
+    if (p.count == 0 || p.count > NYMYA_SUBMIT_MAX_QUBITS || p.reserved)
+        return -EINVAL;
+
+    r = kmalloc(sizeof(*r), GFP_KERNEL_ACCOUNT);
+    if (!r)
+        return -ENOMEM;
+    r->count = p.count;
+    ret = nymya_quota_charge(NYMYA_QUOTA_REG, p.count * sizeof(*r->qubits), &r->quota);
+    if (ret) {
+        kfree(r);
+        return ret;
+    }
+    r->qubits = kvcalloc(p.count, sizeof(*r->qubits), GFP_KERNEL_ACCOUNT);
+    if (!r->qubits) {
+        nymya_kreg_destroy(r);
+        return -ENOMEM;
+    }
+
+    mutex_lock(&ctx->lock);
+    ret = xa_alloc(&ctx->kregs, &id, r, XA_LIMIT(1, NYMYA_KREG_MAX_HANDLES), GFP_KERNEL_ACCOUNT);
+    mutex_unlock(&ctx->lock);
+    if (ret) {
+        nymya_kreg_destroy(r);
+        return ret;
+    }
+
+    p.handle = id;
+    if (copy_to_user(uparams, &p, sizeof(p))) {
+        mutex_lock(&ctx->lock);
+        xa_erase(&ctx->kregs, id);
+        mutex_unlock(&ctx->lock);
+        nymya_kreg_destroy(r);
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+/**
+ * nymya_dev_kreg_free - Handles NYMYA_KREG_FREE.
+ * @ctx: State of the open file.
+ * @handle: Register handle.
+ *
+ * Returns 0 on success, -EINVAL for an unknown handle.
+ */
+static long nymya_dev_kreg_free(struct nymya_dev_ctx *ctx, unsigned long handle)
+{
+    struct nymya_kreg *r;
+
+    if (!handle || handle > NYMYA_KREG_MAX_HANDLES)
+        return -EINVAL;
+
+    mutex_lock(&ctx->lock);
+    r = xa_erase(&ctx->kregs, handle);
+    mutex_unlock(&ctx->lock);
+    if (!r)
+        return -EINVAL;
+
+    nymya_kreg_destroy(r);
+    return 0;
+}
+
+/**
+ * nymya_dev_kreg_io - Handles NYMYA_KREG_WRITE and NYMYA_KREG_READ.
+ * @ctx: State of the open file.
+ * @uio: User pointer to nymya_kreg_io.
+ * @write: true to copy into the register, false to copy out of it.
+ *
+ * The qubits move with a single copy in either direction.
+ *
+ * Returns 0 on success, -EINVAL for an unknown handle or a range outside
+ * the register, or -EFAULT on copy failures.
+ */
+static long nymya_dev_kreg_io(struct nymya_dev_ctx *ctx, nymya_kreg_io __user *uio, bool write)
+{
+    struct nymya_qubit __user *uq;
+    struct nymya_kreg *r;
+    nymya_kreg_io io;
+    unsigned long left;
+    size_t bytes;
+    long ret = 0;
+
+    if (copy_from_user(&io, uio, sizeof(io)))
+        return -EFAULT;
+    if (io.reserved || io.count == 0)
+        return -EINVAL;
+
+    uq = u64_to_user_ptr(io.qubits);
+
+    mutex_lock(&ctx->lock);
+    r = xa_load(&ctx->kregs, io.handle);
+    if (!r || io.first > r->count || io.count > r->count - io.first) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    bytes = io.count * sizeof(*r->qubits);
+    if (write)
+        left = copy_from_user(r->qubits + io.first, uq, bytes);
+    else
+        left = copy_to_user(uq, r->qubits + io.first, bytes);
+    if (left)
+        ret = -EFAULT;
+out:
+    mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+/**
+ * nymya_dev_kreg_submit - Handles NYMYA_KREG_SUBMIT.
+ * @ctx: State of the open file.
+ * @ubatch: User pointer to nymya_kreg_batch.
+ *
+ * Only the records are copied in; the register never leaves the kernel.
+ *
+ * Returns 0 on success, -EINVAL, -ENOMEM, -EFAULT, or a gate core error.
+ */
+static long nymya_dev_kreg_submit(struct nymya_dev_ctx *ctx, nymya_kreg_batch __user *ubatch)
+{
+    nymya_kreg_batch b;
+    struct nymya_kreg *r;
+    nymya_op *k_ops;
+    long ret;
+
+    if (copy_from_user(&b, ubatch, sizeof(b)))
+        return -EFAULT;
+    if (b.reserved)
+        return -EINVAL;
+
+    k_ops = nymya_dev_ops_in(b.ops, b.op_count);
+    if (IS_ERR(k_ops))
+        return PTR_ERR(k_ops);
+
+    mutex_lock(&ctx->lock);
+    r = xa_load(&ctx->kregs, b.handle);
+    if (!r)
+        ret = -EINVAL;
+    else
+        ret = nymya_3362_submit_core(k_ops, b.op_count, r->qubits, r->count);
+    mutex_unlock(&ctx->lock);
+
+    kvfree(k_ops);
+    return ret;
+}
+
+typedef int (*nymya_topo_build_fn)(const struct nymya_lattice_soa *sites,
+                                   struct nymya_lattice_topo *topo);
+
+// Topology builder of each positional lattice gate, or NULL
+static nymya_topo_build_fn nymya_dev_topo_builder(u32 lattice_code)
+{
+    switch (lattice_code) {
+    case NYMYA_FCC_LATTICE_CODE:   return nymya_3355_fcc_lattice_topo;
+    case NYMYA_HCP_LATTICE_CODE:   return nymya_3356_hcp_lattice_topo;
+    case NYMYA_E8_PROJECTED_CODE:  return nymya_3357_e8_projected_lattice_topo;
+    case NYMYA_D4_LATTICE_CODE:    return nymya_3358_d4_lattice_topo;
+    case NYMYA_B5_LATTICE_CODE:    return nymya_3359_b5_lattice_topo;
+    case NYMYA_E5_PROJECTED_CODE:  return nymya_3360_e5_projected_lattice_topo;
+    default:                       return NULL;
+    }
+}
+
+/**
+ * nymya_dev_topo_build - Handles NYMYA_TOPO_BUILD.
+ * @ctx: State of the open file.
+ * @uparams: User pointer to nymya_topo_params.
+ *
+ * Copies the coordinate arrays in (and the box edges under
+ * NYMYA_LATTICE_PERIODIC), finds every neighbour pair with the lattice's
+ * grid search and keeps the pairs along with the coordinates and the box.
+ *
+ * Returns:
+ * - 0 on success, with the handle stored in @uparams.
+ * - -EINVAL on an unknown lattice code, a NULL axis, too few sites, or a
+ *   box edge that is negative or under twice the gate's cutoff.
+ * - -E2BIG if the count is over the lattice_max_sites module parameter.
+ * - -EBUSY if the file already holds NYMYA_TOPO_MAX_HANDLES topologies.
+ * - -ENOMEM, -EINTR or -EFAULT.
+ */
+static long nymya_dev_topo_build(struct nymya_dev_ctx *ctx, nymya_topo_params __user *uparams)
+{
+    struct nymya_lattice_soa sites = { 0 };
+    struct nymya_lattice_topo *topo;
+    nymya_topo_build_fn build;
+    u64 axes[NYMYA_LATTICE_MAX_DIM + 1];
+    unsigned int dims, code, k;
+    nymya_topo_params p;
+    int64_t *coord;
+    bool periodic;
+    u32 id;
+    long ret;
+
+    if (copy_from_user(&p, uparams, sizeof(p)))
+        return -EFAULT;
+    periodic = p.lattice_code & NYMYA_LATTICE_PERIODIC;
+    code = p.lattice_code & ~NYMYA_LATTICE_PERIODIC;
+    build = nymya_dev_topo_builder(code);
+    dims = NYMYA_LATTICE_DIMS(code);
+    if (!build || p.handle || p.count == 0 || p.count >= U32_MAX)
+        return -EINVAL;
+    ret = nymya_lattice_check_size(p.count);
+    if (ret)
+        return ret;
+    if (copy_from_user(axes, u64_to_user_ptr(p.axes), (dims + periodic) * sizeof(*axes)))
+        return -EFAULT;
+    if (periodic) {
+        if (!axes[dims])
+            return -EINVAL;
+        if (copy_from_user(sites.box, u64_to_user_ptr(axes[dims]), dims * sizeof(*sites.box)))
+            return -EFAULT;
+    }
+
+    coord = kvmalloc_array(p.count, dims * sizeof(*coord), GFP_KERNEL_ACCOUNT);
+    topo = kzalloc(sizeof(*topo), GFP_KERNEL_ACCOUNT);
+    if (!coord || !topo) {
+        ret = -ENOMEM;
+        goto out;
+    }
+    for (k = 0; k < dims; k++) {
+        int64_t *axis = coord + (size_t)k * p.count;
+
+        if (!axes[k] || copy_from_user(axis, u64_to_user_ptr(axes[k]), p.count * sizeof(*axis))) {
+            ret = axes[k] ? -EFAULT : -EINVAL;
+            goto out;
+        }
+        sites.coord[k] = axis;
+    }
+    sites.count = p.count;
+
+    ret = build(&sites, topo);
+    if (ret)
+        goto out;
+
+    mutex_lock(&ctx->lock);
+    ret = xa_alloc(&ctx->topos, &id, topo, XA_LIMIT(1, NYMYA_TOPO_MAX_HANDLES), GFP_KERNEL_ACCOUNT);
+    mutex_unlock(&ctx->lock);
+    if (ret)
+        goto out;
+
+    p.handle = id;
+    if (copy_to_user(uparams, &p, sizeof(p))) {
+        mutex_lock(&ctx->lock);
+        xa_erase(&ctx->topos, id);
+        mutex_unlock(&ctx->lock);
+        ret = -EFAULT;
+        goto out;
+    }
+    topo = NULL;
+
+out:
+    if (topo)
+        nymya_topo_destroy(topo);
+    kvfree(coord);
+    return ret;
+}
+
+/**
+ * nymya_dev_topo_free - Handles NYMYA_TOPO_FREE.
+ * @ctx: State of the open file.
+ * @handle: Topology handle.
+ *
+ * Returns 0 on success, -EINVAL for an unknown handle.
+ */
+static long nymya_dev_topo_free(struct nymya_dev_ctx *ctx, unsigned long handle)
+{
+    struct nymya_lattice_topo *topo;
+
+    if (!handle || handle > NYMYA_TOPO_MAX_HANDLES)
+        return -EINVAL;
+
+    mutex_lock(&ctx->lock);
+    topo = xa_erase(&ctx->topos, handle);
+    mutex_unlock(&ctx->lock);
+    if (!topo)
+        return -EINVAL;
+
+    nymya_topo_destroy(topo);
+    return 0;
+}
+
+/**
+ * nymya_dev_topo_run - Handles NYMYA_TOPO_RUN.
+ * @ctx: State of the open file.
+ * @urun: User pointer to nymya_topo_run.
+ *
+ * Runs on a kernel-resident register when @urun names one, with no copy at
+ * all; otherwise copies the qubits in once and back out once.
+ *
+ * Returns 0 on success, -EINVAL for an unknown handle or a count that does
+ * not match the topology, -ENOMEM, -EFAULT, -EINTR, or the first gate error.
+ */
+static long nymya_dev_topo_run(struct nymya_dev_ctx *ctx, nymya_topo_run __user *urun)
+{
+    struct nymya_qubit *k_qubits = NULL;
+    struct nymya_lattice_topo *topo;
+    struct nymya_kreg *r;
+    nymya_topo_run run;
+    long ret;
+
+    if (copy_from_user(&run, urun, sizeof(run)))
+        return -EFAULT;
+
+    if (!run.kreg) {
+        if (!run.qubits || run.count == 0 || run.count >= U32_MAX)
+            return -EINVAL;
+        k_qubits = kvmalloc_array(run.count, sizeof(*k_qubits), GFP_KERNEL_ACCOUNT);
+        if (!k_qubits)
+            return -ENOMEM;
+        if (copy_from_user(k_qubits, u64_to_user_ptr(run.qubits), run.count * sizeof(*k_qubits))) {
+            kvfree(k_qubits);
+            return -EFAULT;
+        }
+    }
+
+    mutex_lock(&ctx->lock);
+    topo = xa_load(&ctx->topos, run.handle);
+    if (!topo) {
+        ret = -EINVAL;
+    } else if (run.kreg) {
+        r = xa_load(&ctx->kregs, run.kreg);
+        ret = r ? nymya_lattice_topo_run(topo, r->qubits, r->count) : -EINVAL;
+    } else {
+        ret = nymya_lattice_topo_run(topo, k_qubits, run.count);
+    }
+    mutex_unlock(&ctx->lock);
+
+    if (!ret && k_qubits &&
+        copy_to_user(u64_to_user_ptr(run.qubits), k_qubits, run.count * sizeof(*k_qubits)))
+        ret = -EFAULT;
+
+    kvfree(k_qubits);
+    return ret;
+}
+
+/**
+ * nymya_dev_topo_insert - Handles NYMYA_TOPO_INSERT.
+ * @ctx: State of the open file.
+ * @uedit: User pointer to nymya_topo_edit.
+ *
+ * All or nothing: if one site cannot be added, the ones added before it
+ * are removed again.
+ *
+ * Returns 0 on success, with the first new index stored in @uedit;
+ * -EINVAL for an unknown handle, a dimension mismatch or a bad count;
+ * -E2BIG past lattice_max_sites; -ENOMEM or -EFAULT.
+ */
+static long nymya_dev_topo_insert(struct nymya_dev_ctx *ctx, nymya_topo_edit __user *uedit)
+{
+    struct nymya_lattice_topo *topo;
+    nymya_topo_edit ed;
+    int64_t *pos;
+    size_t first = 0, i;
+    long ret;
+
+    if (copy_from_user(&ed, uedit, sizeof(ed)))
+        return -EFAULT;
+    if (ed.count == 0 || ed.count > NYMYA_TOPO_MAX_EDIT ||
+        ed.dims == 0 || ed.dims > NYMYA_LATTICE_MAX_DIM)
+        return -EINVAL;
+
+    pos = kvmalloc_array(ed.count, ed.dims * sizeof(*pos), GFP_KERNEL_ACCOUNT);
+    if (!pos)
+        return -ENOMEM;
+    if (copy_from_user(pos, u64_to_user_ptr(ed.sites), ed.count * ed.dims * sizeof(*pos))) {
+        kvfree(pos);
+        return -EFAULT;
+    }
+
+    mutex_lock(&ctx->lock);
+    topo = xa_load(&ctx->topos, ed.handle);
+    if (!topo || topo->dims != ed.dims) {
+        ret = -EINVAL;
+        goto unlock;
+    }
+    ret = nymya_lattice_check_size(topo->count + ed.count);
+    if (ret)
+        goto unlock;
+
+    first = topo->count;
+    for (i = 0; i < ed.count && !ret; i++)
+        ret = nymya_lattice_topo_insert(topo, pos + i * ed.dims);
+    if (ret) {
+        // Deleting the last site is the exact inverse of inserting it
+        while (topo->count > first)
+            nymya_lattice_topo_delete(topo, topo->count - 1);
+    }
+unlock:
+    mutex_unlock(&ctx->lock);
+    kvfree(pos);
+
+    if (!ret) {
+        ed.first = first;
+        if (copy_to_user(uedit, &ed, sizeof(ed)))
+            ret = -EFAULT;
+    }
+    return ret;
+}
+
+/**
+ * nymya_dev_topo_delete - Handles NYMYA_TOPO_DELETE.
+ * @ctx: State of the open file.
+ * @uedit: User pointer to nymya_topo_edit.
+ *
+ * Every index is checked against the count it will meet before any site
+ * is removed, so the call removes all of them or none.
+ *
+ * Returns 0 on success, -EINVAL for an unknown handle, a bad count or an
+ * index out of range, -ENOMEM or -EFAULT.
+ */
+static long nymya_dev_topo_delete(struct nymya_dev_ctx *ctx, nymya_topo_edit __user *uedit)
+{
+    struct nymya_lattice_topo *topo;
+    nymya_topo_edit ed;
+    uint32_t *sites;
+    size_t i;
+    long ret = 0;
+
+    if (copy_from_user(&ed, uedit, sizeof(ed)))
+        return -EFAULT;
+    if (ed.count == 0 || ed.count > NYMYA_TOPO_MAX_EDIT || ed.dims)
+        return -EINVAL;
+
+    sites = kvmalloc_array(ed.count, sizeof(*sites), GFP_KERNEL_ACCOUNT);
+    if (!sites)
+        return -ENOMEM;
+    if (copy_from_user(sites, u64_to_user_ptr(ed.sites), ed.count * sizeof(*sites))) {
+        kvfree(sites);
+        return -EFAULT;
+    }
+
+    mutex_lock(&ctx->lock);
+    topo = xa_load(&ctx->topos, ed.handle);
+    if (!topo || ed.count > topo->count) {
+        ret = -EINVAL;
+        goto unlock;
+    }
+    for (i = 0; i < ed.count; i++) {
+        if (sites[i] >= topo->count - i) {
+            ret = -EINVAL;
+            goto unlock;
+        }
+    }
+    for (i = 0; i < ed.count; i++)
+        nymya_lattice_topo_delete(topo, sites[i]);
+unlock:
+    mutex_unlock(&ctx->lock);
+    kvfree(sites);
+    return ret;
+}
+
+static long nymya_dev_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct nymya_dev_ctx *ctx = file->private_data;
+    nymya_op op;
+
+    switch (cmd) {
+    case NYMYA_REG_ALLOC:
+        return nymya_dev_reg_alloc(ctx, (nymya_reg_params __user *)arg);
+    case NYMYA_REG_GATE:
+        if (copy_from_user(&op, (nymya_op __user *)arg, sizeof(op)))
+            return -EFAULT;
+        return nymya_dev_reg_run(ctx, &op, 1);
+    case NYMYA_REG_SUBMIT:
+        return nymya_dev_reg_submit(ctx, (nymya_reg_batch __user *)arg);
+    case NYMYA_KREG_ALLOC:
+        return nymya_dev_kreg_alloc(ctx, (nymya_kreg_params __user *)arg);
+    case NYMYA_KREG_FREE:
+        return nymya_dev_kreg_free(ctx, arg);
+    case NYMYA_KREG_WRITE:
+        return nymya_dev_kreg_io(ctx, (nymya_kreg_io __user *)arg, true);
+    case NYMYA_KREG_READ:
+        return nymya_dev_kreg_io(ctx, (nymya_kreg_io __user *)arg, false);
+    case NYMYA_KREG_SUBMIT:
+        return nymya_dev_kreg_submit(ctx, (nymya_kreg_batch __user *)arg);
+    case NYMYA_TOPO_BUILD:
+        return nymya_dev_topo_build(ctx, (nymya_topo_params __user *)arg);
+    case NYMYA_TOPO_FREE:
+        return nymya_dev_topo_free(ctx, arg);
+    case NYMYA_TOPO_RUN:
+        return nymya_dev_topo_run(ctx, (nymya_topo_run __user *)arg);
+    case NYMYA_TOPO_INSERT:
+        return nymya_dev_topo_insert(ctx, (nymya_topo_edit __user *)arg);
+    case NYMYA_TOPO_DELETE:
+        return nymya_dev_topo_delete(ctx, (nymya_topo_edit __user *)arg);
+    default:
+        // NYMYA_CALL/NYMYA_CALLV need no register
+        return nymya_call_ioctl(cmd, arg);
+    }
+}
+
+/**
+ * nymya_dev_mmap - Maps the register of this file into userland.
+ * @file: Open /dev/nymya file.
+ * @vma: Target mapping; must start at offset 0 and not exceed reg_bytes.
+ *
+ * Returns 0 on success, -EINVAL before allocation or on a bad offset/size.
+ */
+static int nymya_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct nymya_dev_ctx *ctx = file->private_data;
+    unsigned long size = vma->vm_end - vma->vm_start;
+    int ret;
+
+    mutex_lock(&ctx->lock);
+    if (!ctx->qubits || vma->vm_pgoff || size > ctx->bytes)
+        ret = -EINVAL;
+    else
+        ret = remap_vmalloc_range(vma, ctx->qubits, 0);
+    mutex_unlock(&ctx->lock);
+
+    return ret;
+}
+
+static const struct file_operations nymya_dev_fops = {
+    .owner          = THIS_MODULE,
+    .open           = nymya_dev_open,
+    .release        = nymya_dev_release,
+    .unlocked_ioctl = nymya_dev_ioctl,
+    .compat_ioctl   = compat_ptr_ioctl,
+    .mmap           = nymya_dev_mmap,
+    .llseek         = noop_llseek,
+};
+
+static struct miscdevice nymya_dev = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name  = "nymya",
+    .fops  = &nymya_dev_fops,
+    .mode  = 0666,
+};
+
+/**
+ * nymya_dev_init - Registers /dev/nymya.
+ *
+ * Returns 0 on success or the error code from misc_register().
+ */
+int nymya_dev_init(void)
+{
+    int ret = misc_register(&nymya_dev);
+
+    if (ret)
+        pr_err("nymya_dev_init: misc_register failed, error %d\n", ret);
+    return ret;
+}
+
+/**
+ * nymya_dev_exit - Unregisters /dev/nymya.
+ */
+void nymya_dev_exit(void)
+{
+    misc_deregister(&nymya_dev);
+}
+
+#endif // __KERNEL__
@@ -1,7 +1,7 @@
 // src/nymya_event_class_syscall_enter.c
 //
 // Defines the nymya_event_class_syscall_enter function for both kernel and userland.
-// In the kernel, it uses pr_info for logging. In userland, it uses printf.
+// In the kernel, it fires the nymya_syscall_enter tracepoint. In userland, it uses printf.
 
 #include "nymya.h" // Assumed to define common types like uint64_t
 
@@ -23,14 +23,12 @@
      * @syscall_id: The ID of the syscall being entered.
      * @qubit_id: The ID of the primary qubit involved (or 0 if not applicable).
      *
-     * This function provides a basic logging mechanism for syscall entries within the kernel.
-     * It uses pr_info to output a message to the kernel log.
+     * Fires the nymya_syscall_enter tracepoint; free when it is disabled.
      *
      * Returns: 0 on success.
      */
     int nymya_event_class_syscall_enter(uint64_t syscall_id, uint64_t qubit_id) {
-        // For kernel logging (pr_info), %llu is generally correct for uint64_t
-        pr_info("NYMYA_SYSCALL_ENTER: SyscallID=%llu, QubitID=%llu\n", syscall_id, qubit_id);
+        trace_nymya_syscall_enter(syscall_id, qubit_id);
         return 0;
     }
     EXPORT_SYMBOL(nymya_event_class_syscall_enter);
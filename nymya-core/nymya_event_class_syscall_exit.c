@@ -1,7 +1,7 @@
 // src/nymya_event_class_syscall_exit.c
 //
 // Defines the nymya_event_class_syscall_exit function for both kernel and userland.
-// In the kernel, it uses pr_info for logging. In userland, it uses printf.
+// In the kernel, it fires the nymya_syscall_exit tracepoint. In userland, it uses printf.
 
 #include "nymya.h" // Assumed to define common types like uint64_t and declare the function prototype
 
@@ -17,13 +17,13 @@
      * @syscall_id: The ID of the syscall being exited.
      * @return_code: The return code of the syscall.
      *
-     * This function provides a basic logging mechanism for syscall exits within the kernel.
-     * It uses pr_info to output a message to the kernel log.
+     * Fires the nymya_syscall_exit tracepoint, without a duration; free when
+     * it is disabled.
      *
      * Returns: 0 on success.
      */
     int nymya_event_class_syscall_exit(uint64_t syscall_id, uint64_t return_code) {
-        pr_info("NYMYA_SYSCALL_EXIT: SyscallID=%llu, ReturnCode=%llu\n", syscall_id, return_code);
+        trace_nymya_syscall_exit(syscall_id, (long)return_code, 0);
         return 0;
     }
 
@@ -0,0 +1,207 @@
+// src/nymya_event_ring.c
+//
+// Per-CPU lock-free ring of fixed-size binary event records for the kernel.
+// Gate cores log through log_symbolic_event()/nymya_event_emit(), which
+// append a nymya_event_rec to the current CPU's ring instead of formatting a
+// printk line. The rings are exposed read-only to userland through the
+// /dev/nymya_events misc device, which supports mmap of each CPU's ring.
+//
+// Each ring is a flight recorder: the writer never blocks and old records are
+// overwritten once the ring wraps. Readers detect torn or overwritten slots by
+// checking that rec->seq matches the slot index they expect.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/miscdevice.h>
+#include <linux/irqflags.h>
+#include <linux/sched/clock.h>
+#include <linux/string.h>
+#include <linux/rcupdate.h>
+
+#define NYMYA_EVENT_RING_MASK (NYMYA_EVENT_RING_ENTRIES - 1)
+#define NYMYA_EVENT_HDR_BYTES PAGE_SIZE
+#define NYMYA_EVENT_RING_BYTES \
+    PAGE_ALIGN(NYMYA_EVENT_HDR_BYTES + NYMYA_EVENT_RING_ENTRIES * sizeof(nymya_event_rec))
+
+/**
+ * struct nymya_event_cpu_ring - Per-CPU ring state.
+ * @hdr: Start of the vmalloc_user() area; the header page shared with userland.
+ * @recs: First record slot, NYMYA_EVENT_HDR_BYTES past @hdr.
+ */
+struct nymya_event_cpu_ring {
+    nymya_event_ring_hdr *hdr;
+    nymya_event_rec *recs;
+};
+
+static DEFINE_PER_CPU(struct nymya_event_cpu_ring, nymya_event_rings);
+static bool nymya_event_ready;
+
+/**
+ * nymya_event_emit - Appends a binary event record to the current CPU's ring.
+ * @gate_code: NYMYA_*_CODE of the gate (0 if unknown).
+ * @qubit_id: ID of the primary qubit involved.
+ * @result: Return code of the gate core.
+ * @gate: Short gate label, truncated to NYMYA_EVENT_LABEL_LEN bytes.
+ *
+ * The only writer of a ring is its own CPU, so reserving a slot only needs
+ * local interrupts off; no lock or atomic read-modify-write is involved.
+ * The slot's seq is cleared before and published after the payload so a
+ * concurrent mmap reader can tell a complete record from a torn one.
+ */
+void nymya_event_emit(uint32_t gate_code, uint64_t qubit_id, int32_t result, const char *gate)
+{
+    struct nymya_event_cpu_ring *ring;
+    nymya_event_rec *rec;
+    unsigned long flags;
+    uint64_t head;
+
+    if (!READ_ONCE(nymya_event_ready))
+        return;
+
+    local_irq_save(flags);
+    ring = this_cpu_ptr(&nymya_event_rings);
+    head = ring->hdr->head;
+    rec = &ring->recs[head & NYMYA_EVENT_RING_MASK];
+
+    WRITE_ONCE(rec->seq, 0);
+    smp_wmb();
+
+    rec->ts_ns = local_clock();
+    rec->qubit_id = qubit_id;
+    rec->gate_code = gate_code;
+    rec->result = result;
+    strncpy(rec->gate, gate ? gate : "", NYMYA_EVENT_LABEL_LEN);
+
+    smp_wmb();
+    WRITE_ONCE(rec->seq, head + 1);
+    smp_store_release(&ring->hdr->head, head + 1);
+    local_irq_restore(flags);
+}
+EXPORT_SYMBOL_GPL(nymya_event_emit);
+
+/**
+ * nymya_event_mmap - Maps one CPU's ring read-only into userland.
+ * @file: Open /dev/nymya_events file.
+ * @vma: Target mapping; vm_pgoff selects the CPU in units of the ring stride.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -EPERM if a writable mapping was requested.
+ * - -EINVAL if the offset is not on a ring boundary, the CPU does not exist,
+ *   or the mapping is larger than one ring.
+ */
+static int nymya_event_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    unsigned long stride_pages = NYMYA_EVENT_RING_BYTES >> PAGE_SHIFT;
+    unsigned long size = vma->vm_end - vma->vm_start;
+    unsigned long cpu;
+
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+    if (vma->vm_pgoff % stride_pages)
+        return -EINVAL;
+
+    cpu = vma->vm_pgoff / stride_pages;
+    if (cpu >= nr_cpu_ids || !cpu_possible(cpu) || size > NYMYA_EVENT_RING_BYTES)
+        return -EINVAL;
+
+    vm_flags_clear(vma, VM_MAYWRITE);
+    return remap_vmalloc_range(vma, per_cpu(nymya_event_rings, cpu).hdr, 0);
+}
+
+static const struct file_operations nymya_event_fops = {
+    .owner = THIS_MODULE,
+    .mmap  = nymya_event_mmap,
+    .llseek = noop_llseek,
+};
+
+static struct miscdevice nymya_event_dev = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name  = "nymya_events",
+    .fops  = &nymya_event_fops,
+    .mode  = 0444,
+};
+
+static void nymya_event_free_rings(void)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        struct nymya_event_cpu_ring *ring = per_cpu_ptr(&nymya_event_rings, cpu);
+
+        vfree(ring->hdr);
+        ring->hdr = NULL;
+        ring->recs = NULL;
+    }
+}
+
+/**
+ * nymya_event_ring_init - Allocates the per-CPU rings and registers /dev/nymya_events.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -ENOMEM if a ring could not be allocated.
+ * - Error code from misc_register().
+ */
+int nymya_event_ring_init(void)
+{
+    int cpu, ret;
+
+    BUILD_BUG_ON(NYMYA_EVENT_RING_ENTRIES & NYMYA_EVENT_RING_MASK);
+    BUILD_BUG_ON(sizeof(nymya_event_ring_hdr) > NYMYA_EVENT_HDR_BYTES);
+
+    for_each_possible_cpu(cpu) {
+        struct nymya_event_cpu_ring *ring = per_cpu_ptr(&nymya_event_rings, cpu);
+
+        // vmalloc_user() zeroes the area and marks it mappable by remap_vmalloc_range()
+        ring->hdr = vmalloc_user(NYMYA_EVENT_RING_BYTES);
+        if (!ring->hdr) {
+            pr_err("nymya_event_ring_init: Failed to allocate ring for CPU %d\n", cpu);
+            ret = -ENOMEM;
+            goto fail;
+        }
+        ring->recs = (nymya_event_rec *)((char *)ring->hdr + NYMYA_EVENT_HDR_BYTES);
+        ring->hdr->entries = NYMYA_EVENT_RING_ENTRIES;
+        ring->hdr->rec_size = sizeof(nymya_event_rec);
+        ring->hdr->cpu = cpu;
+        ring->hdr->hdr_size = NYMYA_EVENT_HDR_BYTES;
+        ring->hdr->stride = NYMYA_EVENT_RING_BYTES;
+    }
+
+    ret = misc_register(&nymya_event_dev);
+    if (ret) {
+        pr_err("nymya_event_ring_init: misc_register failed, error %d\n", ret);
+        goto fail;
+    }
+
+    smp_store_release(&nymya_event_ready, true);
+    return 0;
+
+fail:
+    nymya_event_free_rings();
+    return ret;
+}
+
+/**
+ * nymya_event_ring_exit - Unregisters /dev/nymya_events and frees the rings.
+ */
+void nymya_event_ring_exit(void)
+{
+    WRITE_ONCE(nymya_event_ready, false);
+    misc_deregister(&nymya_event_dev);
+    // Wait for any emitter still inside its irq-off section on another CPU
+    synchronize_rcu();
+    nymya_event_free_rings();
+}
+
+#endif // __KERNEL__
@@ -0,0 +1,472 @@
+// src/nymya_fixed_bench.c
+//
+// Portable benchmark of the Q32.32 primitives the gate cores are built on,
+// so the per-architecture choice between implementations rests on data:
+//   mul, square - fixed_point_mul() and fixed_point_square()
+//   cmul        - complex_mul() / fixed_complex_multiply()
+//   mag2        - the |amplitude|^2 > 1/4 test of the controlled gates
+//   unitary_row - one output amplitude of nymya_unitary_apply1()
+//   sin, cos, sincos - fixed_sin(), fixed_cos() and every fixed_point_sincos() tier
+// Each primitive is timed as the kernel builds it, through nymya_mul128.h
+// ("mulh": the path selected for this target, named in the report header),
+// in the generic __int128 form ("int128", which
+// NYMYA_MUL128_GENERIC selects) and, where one exists, as a candidate
+// replacement: "split64" forms the 128-bit product from 32x32->64
+// multiplies, as targets without a fast high-half multiply would, and
+// "mul4" rounds each partial product separately. Every
+// op reports ns per call with independent inputs (throughput) and with each
+// call waiting on the last (latency), plus its largest difference from the
+// int128 form (or, for the trig ops, from long double libm) in Q32.32 units.
+// Built and run by "make fixed-bench"; ../bench_matrix.sh runs it in each
+// cross-compile image and lines the reports up.
+
+#include "nymya.h"
+#include "nymya_mul128.h"
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/utsname.h>
+
+#define FB_ARGS     8       // Operands per call
+#define FB_INPUTS   4096    // Calls per pass over the inputs; fits in L1 with the operands
+#define FB_OPS      4000000 // Calls per timed run
+#define FB_RUNS     5
+#define FB_MAX_RUNS 101
+#define FB_CHECKS   1000000 // Random inputs compared against the reference
+
+// Operand ranges: amplitudes in [-2, 2), angles in [-8, 8) radians
+enum fb_input { FB_AMP, FB_ANGLE };
+
+static uint64_t fb_rng = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t fb_next(void) {
+    fb_rng ^= fb_rng << 13;
+    fb_rng ^= fb_rng >> 7;
+    fb_rng ^= fb_rng << 17;
+    return fb_rng;
+}
+
+static int64_t fb_operand(enum fb_input kind) {
+    if (kind == FB_ANGLE)
+        return (int64_t)(fb_next() >> 28) - ((int64_t)1 << 35);
+    return (int64_t)(fb_next() >> 30) - ((int64_t)1 << 33);
+}
+
+/*
+ * Bits 32..95 of the signed 128-bit product a * b from four 32x32->64
+ * multiplies: the unsigned product of the two's complement bit patterns,
+ * with b subtracted from the high half when a is negative and vice versa.
+ */
+static inline int64_t fb_mul_split64(int64_t a, int64_t b) {
+    uint64_t ua = (uint64_t)a, ub = (uint64_t)b;
+    uint64_t a_lo = ua & 0xFFFFFFFFu, a_hi = ua >> 32;
+    uint64_t b_lo = ub & 0xFFFFFFFFu, b_hi = ub >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFu) + (hl & 0xFFFFFFFFu);
+    uint64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+
+    if (a < 0) hi -= ub;
+    if (b < 0) hi -= ua;
+    return (int64_t)((hi << 32) | (mid & 0xFFFFFFFFu));
+}
+
+static inline int64_t fb_mul_int128(int64_t a, int64_t b) {
+    return (int64_t)(((__int128)a * b) >> 32);
+}
+
+// The primitives, one call each: operands in, up to two results out
+
+static inline void fb_mul_int128_op(const int64_t *in, int64_t *out) {
+    out[0] = fb_mul_int128(in[0], in[1]);
+    out[1] = 0;
+}
+
+static inline void fb_mul_split64_op(const int64_t *in, int64_t *out) {
+    out[0] = fb_mul_split64(in[0], in[1]);
+    out[1] = 0;
+}
+
+static inline void fb_square_int128_op(const int64_t *in, int64_t *out) {
+    out[0] = fb_mul_int128(in[0], in[0]);
+    out[1] = 0;
+}
+
+static inline void fb_square_split64_op(const int64_t *in, int64_t *out) {
+    out[0] = fb_mul_split64(in[0], in[0]);
+    out[1] = 0;
+}
+
+static inline void fb_mul_mulh_op(const int64_t *in, int64_t *out) {
+    out[0] = nymya_fixed_mul(in[0], in[1]);
+    out[1] = 0;
+}
+
+static inline void fb_square_mulh_op(const int64_t *in, int64_t *out) {
+    out[0] = nymya_fixed_mul(in[0], in[0]);
+    out[1] = 0;
+}
+
+// As complex_mul() and fixed_complex_multiply(): exact sums, one shift
+static inline void fb_cmul_int128_op(const int64_t *in, int64_t *out) {
+    __int128 re = (__int128)in[0] * in[2] - (__int128)in[1] * in[3];
+    __int128 im = (__int128)in[0] * in[3] + (__int128)in[1] * in[2];
+
+    out[0] = (int64_t)(re >> 32);
+    out[1] = (int64_t)(im >> 32);
+}
+
+// As nymya_kernel_cmul(): four rounded fixed_point_mul() products
+static inline void fb_cmul_mul4_op(const int64_t *in, int64_t *out) {
+    out[0] = fb_mul_int128(in[0], in[2]) - fb_mul_int128(in[1], in[3]);
+    out[1] = fb_mul_int128(in[0], in[3]) + fb_mul_int128(in[1], in[2]);
+}
+
+static inline void fb_cmul_split64_op(const int64_t *in, int64_t *out) {
+    out[0] = fb_mul_split64(in[0], in[2]) - fb_mul_split64(in[1], in[3]);
+    out[1] = fb_mul_split64(in[0], in[3]) + fb_mul_split64(in[1], in[2]);
+}
+
+static inline void fb_cmul_mulh_op(const int64_t *in, int64_t *out) {
+    nymya_s128 re = nymya_s128_sub(nymya_smul128(in[0], in[2]), nymya_smul128(in[1], in[3]));
+    nymya_s128 im = nymya_s128_add(nymya_smul128(in[0], in[3]), nymya_smul128(in[1], in[2]));
+
+    out[0] = nymya_s128_shr(re, 32);
+    out[1] = nymya_s128_shr(im, 32);
+}
+
+// As nymya_3318_controlled_phase_s_core(): 128-bit |z|^2 against (1/2)^2
+static inline void fb_mag2_int128_op(const int64_t *in, int64_t *out) {
+    __uint128_t mag = (__uint128_t)((__int128)in[0] * in[0]) + (__uint128_t)((__int128)in[1] * in[1]);
+
+    out[0] = mag > (__uint128_t)(FIXED_POINT_SCALE / 2) * (FIXED_POINT_SCALE / 2);
+    out[1] = 0;
+}
+
+// The same test on Q32.32 squares, which cannot overflow for |z| < 2^15
+static inline void fb_mag2_split64_op(const int64_t *in, int64_t *out) {
+    out[0] = fb_mul_split64(in[0], in[0]) + fb_mul_split64(in[1], in[1]) >
+             (int64_t)(FIXED_POINT_SCALE / 4);
+    out[1] = 0;
+}
+
+static inline void fb_mag2_mulh_op(const int64_t *in, int64_t *out) {
+    out[0] = nymya_mag2_cmp_quarter(in[0], in[1]) > 0;
+    out[1] = 0;
+}
+
+// As nymya_unitary_apply1(): m0 * a + m1 * b, eight products summed exactly
+static inline void fb_unitary_row_int128_op(const int64_t *in, int64_t *out) {
+    __int128 re = (__int128)in[0] * in[4] - (__int128)in[1] * in[5] +
+                  (__int128)in[2] * in[6] - (__int128)in[3] * in[7];
+    __int128 im = (__int128)in[0] * in[5] + (__int128)in[1] * in[4] +
+                  (__int128)in[2] * in[7] + (__int128)in[3] * in[6];
+
+    out[0] = (int64_t)(re >> 32);
+    out[1] = (int64_t)(im >> 32);
+}
+
+static inline void fb_unitary_row_split64_op(const int64_t *in, int64_t *out) {
+    out[0] = fb_mul_split64(in[0], in[4]) - fb_mul_split64(in[1], in[5]) +
+             fb_mul_split64(in[2], in[6]) - fb_mul_split64(in[3], in[7]);
+    out[1] = fb_mul_split64(in[0], in[5]) + fb_mul_split64(in[1], in[4]) +
+             fb_mul_split64(in[2], in[7]) + fb_mul_split64(in[3], in[6]);
+}
+
+static inline void fb_unitary_row_mulh_op(const int64_t *in, int64_t *out) {
+    nymya_s128 re = nymya_s128_sub(nymya_smul128(in[0], in[4]), nymya_smul128(in[1], in[5]));
+    nymya_s128 im = nymya_s128_add(nymya_smul128(in[0], in[5]), nymya_smul128(in[1], in[4]));
+
+    re = nymya_s128_sub(nymya_s128_add(re, nymya_smul128(in[2], in[6])), nymya_smul128(in[3], in[7]));
+    im = nymya_s128_add(nymya_s128_add(im, nymya_smul128(in[2], in[7])), nymya_smul128(in[3], in[6]));
+    out[0] = nymya_s128_shr(re, 32);
+    out[1] = nymya_s128_shr(im, 32);
+}
+
+static inline void fb_sin_default_op(const int64_t *in, int64_t *out) {
+    out[0] = fixed_sin(in[0]);
+    out[1] = 0;
+}
+
+static inline void fb_cos_default_op(const int64_t *in, int64_t *out) {
+    out[0] = 0;
+    out[1] = fixed_cos(in[0]);
+}
+
+static inline void fb_sincos_fast_op(const int64_t *in, int64_t *out) {
+    fixed_point_sincos(in[0], NYMYA_TRIG_FAST, &out[0], &out[1]);
+}
+
+static inline void fb_sincos_balanced_op(const int64_t *in, int64_t *out) {
+    fixed_point_sincos(in[0], NYMYA_TRIG_BALANCED, &out[0], &out[1]);
+}
+
+static inline void fb_sincos_precise_op(const int64_t *in, int64_t *out) {
+    fixed_point_sincos(in[0], NYMYA_TRIG_PRECISE, &out[0], &out[1]);
+}
+
+typedef void (*fb_op_fn)(const int64_t *in, int64_t *out);
+typedef int64_t (*fb_loop_fn)(const int64_t *in, size_t n);
+
+/*
+ * Timed loops of one op, with the op inlined. The throughput loop's calls
+ * are independent; the latency loop feeds a bit of each result into the
+ * next call's first operand, so the calls run one after another.
+ */
+#define FB_LOOPS(name)                                                                  \
+    static __attribute__((noinline)) int64_t fb_thru_##name(const int64_t *in, size_t n) { \
+        int64_t acc = 0, out[2];                                                        \
+                                                                                        \
+        for (size_t i = 0; i < n; i++) {                                                \
+            fb_##name##_op(&in[FB_ARGS * i], out);                                      \
+            acc += out[0] ^ out[1];                                                     \
+        }                                                                               \
+        return acc;                                                                     \
+    }                                                                                   \
+    static __attribute__((noinline)) int64_t fb_lat_##name(const int64_t *in, size_t n) {  \
+        int64_t acc = 0, out[2] = { 0, 0 }, x[FB_ARGS];                                 \
+                                                                                        \
+        for (size_t i = 0; i < n; i++) {                                                \
+            memcpy(x, &in[FB_ARGS * i], sizeof(x));                                     \
+            x[0] ^= (out[0] ^ out[1]) & 1;                                              \
+            fb_##name##_op(x, out);                                                     \
+            acc += out[0];                                                              \
+        }                                                                               \
+        return acc;                                                                     \
+    }
+
+/*
+ * X(op, impl, input, reference): @reference is the impl of the same op the
+ * results are checked against, or "libm" for the long double sine and cosine.
+ */
+#define FB_OPS_TABLE(X)                                     \
+    X(mul,         int128,   FB_AMP,   int128)              \
+    X(mul,         mulh,     FB_AMP,   int128)              \
+    X(mul,         split64,  FB_AMP,   int128)              \
+    X(square,      int128,   FB_AMP,   int128)              \
+    X(square,      mulh,     FB_AMP,   int128)              \
+    X(square,      split64,  FB_AMP,   int128)              \
+    X(cmul,        int128,   FB_AMP,   int128)              \
+    X(cmul,        mulh,     FB_AMP,   int128)              \
+    X(cmul,        mul4,     FB_AMP,   int128)              \
+    X(cmul,        split64,  FB_AMP,   int128)              \
+    X(mag2,        int128,   FB_AMP,   int128)              \
+    X(mag2,        mulh,     FB_AMP,   int128)              \
+    X(mag2,        split64,  FB_AMP,   int128)              \
+    X(unitary_row, int128,   FB_AMP,   int128)              \
+    X(unitary_row, mulh,     FB_AMP,   int128)              \
+    X(unitary_row, split64,  FB_AMP,   int128)              \
+    X(sin,         default,  FB_ANGLE, libm)                \
+    X(cos,         default,  FB_ANGLE, libm)                \
+    X(sincos,      fast,     FB_ANGLE, libm)                \
+    X(sincos,      balanced, FB_ANGLE, libm)                \
+    X(sincos,      precise,  FB_ANGLE, libm)
+
+#define FB_DEFINE_LOOPS(op, impl, input, ref) FB_LOOPS(op##_##impl)
+FB_OPS_TABLE(FB_DEFINE_LOOPS)
+
+/**
+ * fb_op - One implementation of one primitive.
+ * @op, @impl: Names in the report.
+ * @ref: Name of the implementation it is checked against.
+ * @input: Operand range.
+ * @one: A single call, for the check.
+ * @thru, @lat: Timed loops.
+ */
+typedef struct fb_op {
+    const char *op;
+    const char *impl;
+    const char *ref;
+    enum fb_input input;
+    fb_op_fn one;
+    fb_loop_fn thru;
+    fb_loop_fn lat;
+} fb_op;
+
+#define FB_ENTRY(op, impl, input, ref) \
+    { #op, #impl, #ref, input, fb_##op##_##impl##_op, fb_thru_##op##_##impl, fb_lat_##op##_##impl },
+static const fb_op fb_ops[] = {
+    FB_OPS_TABLE(FB_ENTRY)
+};
+
+#define FB_COUNT (sizeof(fb_ops) / sizeof(fb_ops[0]))
+
+static uint64_t fb_now_ns(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+static int fb_cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static volatile int64_t fb_sink;
+
+// Median ns per call of @fn over @runs runs of FB_OPS calls
+static double fb_time(fb_loop_fn fn, const int64_t *in, unsigned int runs) {
+    double ns[FB_MAX_RUNS];
+    unsigned long passes = FB_OPS / FB_INPUTS;
+
+    fb_sink += fn(in, FB_INPUTS);
+    for (unsigned int r = 0; r < runs; r++) {
+        uint64_t t0 = fb_now_ns();
+        int64_t acc = 0;
+
+        for (unsigned long p = 0; p < passes; p++)
+            acc += fn(in, FB_INPUTS);
+        ns[r] = (double)(fb_now_ns() - t0) / (double)(passes * FB_INPUTS);
+        fb_sink += acc;
+    }
+    qsort(ns, runs, sizeof(ns[0]), fb_cmp_double);
+    return ns[runs / 2];
+}
+
+static const fb_op *fb_find(const char *op, const char *impl) {
+    for (size_t i = 0; i < FB_COUNT; i++)
+        if (!strcmp(fb_ops[i].op, op) && !strcmp(fb_ops[i].impl, impl))
+            return &fb_ops[i];
+    return NULL;
+}
+
+// Largest difference from the reference over FB_CHECKS random calls, in Q32.32 units
+static double fb_check(const fb_op *o) {
+    const fb_op *ref = strcmp(o->ref, "libm") ? fb_find(o->op, o->ref) : NULL;
+    const long double scale = (long double)FIXED_POINT_SCALE;
+    double worst = 0;
+
+    fb_rng = 0x2545F4914F6CDD1DULL;
+    for (int k = 0; k < FB_CHECKS; k++) {
+        int64_t in[FB_ARGS], got[2], want[2];
+        long double e0, e1;
+
+        for (int a = 0; a < FB_ARGS; a++) in[a] = fb_operand(o->input);
+        o->one(in, got);
+        if (ref) {
+            ref->one(in, want);
+            e0 = fabsl((long double)got[0] - (long double)want[0]);
+            e1 = fabsl((long double)got[1] - (long double)want[1]);
+        } else {
+            long double x = (long double)in[0] / scale;
+
+            // The sin op leaves out[1] at 0 and the cos op out[0]
+            e0 = strcmp(o->op, "cos") ? fabsl((long double)got[0] - sinl(x) * scale) : 0;
+            e1 = strcmp(o->op, "sin") ? fabsl((long double)got[1] - cosl(x) * scale) : 0;
+        }
+        if ((double)e0 > worst) worst = (double)e0;
+        if ((double)e1 > worst) worst = (double)e1;
+    }
+    return worst;
+}
+
+// First "model name", "Model", "uarch" or "isa" line of /proc/cpuinfo, whichever the arch has
+static void fb_cpu_name(char *buf, size_t len) {
+    static const char *const keys[] = { "model name", "Model", "uarch", "isa" };
+    char line[256];
+    FILE *f = fopen("/proc/cpuinfo", "r");
+
+    snprintf(buf, len, "unknown");
+    if (!f) return;
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+        rewind(f);
+        while (fgets(line, sizeof(line), f)) {
+            char *colon = strchr(line, ':');
+
+            if (!colon || strncmp(line, keys[k], strlen(keys[k]))) continue;
+            for (colon++; *colon == ' ' || *colon == '\t'; colon++) ;
+            colon[strcspn(colon, "\n")] = '\0';
+            // JSON-safe: the name is printed inside quotes
+            for (char *c = colon; *c; c++)
+                if (*c == '"' || *c == '\\') *c = '\'';
+            snprintf(buf, len, "%s", colon);
+            fclose(f);
+            return;
+        }
+    }
+    fclose(f);
+}
+
+static void fb_usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-r runs] [-g op] [-o file] [-t]\n"
+            "  -r  timed runs per op; the median is reported (default %d, max %d)\n"
+            "  -g  only ops whose name contains this\n"
+            "  -o  write the report here instead of stdout\n"
+            "  -t  a text table instead of JSON\n",
+            prog, FB_RUNS, FB_MAX_RUNS);
+}
+
+int main(int argc, char **argv) {
+    static int64_t in[FB_ARGS * FB_INPUTS];
+    unsigned int runs = FB_RUNS;
+    const char *filter = NULL, *out_path = NULL;
+    int table = 0, first = 1, opt;
+    char cpu[128];
+    struct utsname u;
+    FILE *out = stdout;
+
+    while ((opt = getopt(argc, argv, "r:g:o:th")) != -1) {
+        switch (opt) {
+        case 'r': runs = (unsigned int)strtoul(optarg, NULL, 10); break;
+        case 'g': filter = optarg; break;
+        case 'o': out_path = optarg; break;
+        case 't': table = 1; break;
+        default:
+            fb_usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (!runs || runs > FB_MAX_RUNS) {
+        fb_usage(argv[0]);
+        return 2;
+    }
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        perror("nymya_fixed_bench: fopen");
+        return 1;
+    }
+    if (uname(&u)) strcpy(u.machine, "unknown");
+    fb_cpu_name(cpu, sizeof(cpu));
+
+    if (table) {
+        fprintf(out, "Q32.32 primitives on %s (%s), gcc %s, mulh = %s\n", u.machine, cpu,
+                __VERSION__, NYMYA_MUL128_IMPL);
+        fprintf(out, "%-12s %-9s %12s %12s %12s\n", "op", "impl", "ns thruput", "ns latency", "max err");
+    } else {
+        fprintf(out, "{\n  \"arch\": \"%s\", \"cpu\": \"%s\", \"compiler\": \"%s\", \"runs\": %u, "
+                     "\"trig_tier\": %d, \"mul128\": \"%s\",\n  \"results\": [\n",
+                u.machine, cpu, __VERSION__, runs, NYMYA_TRIG_TIER, NYMYA_MUL128_IMPL);
+    }
+
+    for (size_t i = 0; i < FB_COUNT; i++) {
+        const fb_op *o = &fb_ops[i];
+        double thru, lat, err;
+
+        if (filter && !strstr(o->op, filter)) continue;
+        fb_rng = 0x9E3779B97F4A7C15ULL;
+        for (size_t k = 0; k < sizeof(in) / sizeof(in[0]); k++)
+            in[k] = fb_operand(o->input);
+
+        thru = fb_time(o->thru, in, runs);
+        lat = fb_time(o->lat, in, runs);
+        err = fb_check(o);
+        if (table) {
+            fprintf(out, "%-12s %-9s %12.2f %12.2f %12.2f\n", o->op, o->impl, thru, lat, err);
+        } else {
+            fprintf(out, "%s    {\"op\": \"%s\", \"impl\": \"%s\", \"ns_throughput\": %.3f, "
+                         "\"ns_latency\": %.3f, \"max_err_ulp\": %.2f, \"reference\": \"%s\"}",
+                    first ? "" : ",\n", o->op, o->impl, thru, lat, err, o->ref);
+        }
+        first = 0;
+    }
+
+    if (!table) fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
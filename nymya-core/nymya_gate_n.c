@@ -0,0 +1,349 @@
+// src/nymya_gate_n.c
+//
+// Batched forms of the single-qubit gates: nymya_33xx_*_n(qs, n, ...) applies
+// one gate to each of n contiguous qubits. Every one of these gates is a
+// fixed update of the amplitude alone, so a batch is one pass over the
+// amplitude fields: AVX-512 or AVX2 on x86 (four or two qubits per register,
+// bound at load time through NYMYA_IFUNC), NEON on AArch64, and the
+// nymya_*_fast() helpers elsewhere. The arithmetic is that of the helpers,
+// operation for operation.
+//
+// Under NYMYA_BACKEND_KERNEL a batch goes to the kernel instead, as one
+// nymya_3362_submit() of n records, so it costs one crossing rather than n;
+// under NYMYA_BACKEND_PLUGIN the same batch goes to the plugin.
+// A batch logs one event, for its first qubit, where the single-qubit
+// functions log one per qubit.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NYMYA_GATE_N_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define NYMYA_GATE_N_NEON 1
+#include <arm_neon.h>
+#endif
+
+// What a gate does to an amplitude a
+enum nymya_gate_n_op {
+    NYMYA_GATE_N_NONE, // a
+    NYMYA_GATE_N_CMUL, // complex_mul(a, c)
+    NYMYA_GATE_N_SCALE, // a scaled by creal(c)
+    NYMYA_GATE_N_CONJ, // conj(a)
+    NYMYA_GATE_N_NEG,  // -a
+    NYMYA_GATE_N_MULI, // a * i
+};
+
+typedef void (*nymya_gate_n_fn)(nymya_qubit *q, size_t n, int op, complex_double c);
+
+static void nymya_gate_n_scalar(nymya_qubit *q, size_t n, int op, complex_double c) {
+    const double s = creal(c);
+    size_t i;
+
+    switch (op) {
+    case NYMYA_GATE_N_CMUL:
+        for (i = 0; i < n; i++) q[i].amplitude = complex_mul(q[i].amplitude, c);
+        break;
+    case NYMYA_GATE_N_SCALE:
+        for (i = 0; i < n; i++)
+            q[i].amplitude = CMPLX(creal(q[i].amplitude) * s, cimag(q[i].amplitude) * s);
+        break;
+    case NYMYA_GATE_N_CONJ:
+        for (i = 0; i < n; i++) nymya_x_fast(&q[i]);
+        break;
+    case NYMYA_GATE_N_NEG:
+        for (i = 0; i < n; i++) nymya_z_fast(&q[i]);
+        break;
+    case NYMYA_GATE_N_MULI:
+        for (i = 0; i < n; i++) nymya_y_fast(&q[i]);
+        break;
+    }
+}
+
+#ifdef NYMYA_GATE_N_X86
+/*
+ * Two amplitudes per register as {re0, im0, re1, im1}. The complex product
+ * is {re*cr - im*ci, im*cr + re*ci}: addsub subtracts in the even lanes and
+ * adds in the odd ones, and neither rounds differently from the scalar code.
+ */
+__attribute__((target("avx2")))
+static void nymya_gate_n_avx2(nymya_qubit *q, size_t n, int op, complex_double c) {
+    const __m256d cr = _mm256_set1_pd(creal(c));
+    const __m256d ci = _mm256_set1_pd(cimag(c));
+    const __m256d sign_im = _mm256_setr_pd(0.0, -0.0, 0.0, -0.0);
+    const __m256d sign_re = _mm256_setr_pd(-0.0, 0.0, -0.0, 0.0);
+    const __m256d sign_all = _mm256_set1_pd(-0.0);
+    size_t i;
+
+    for (i = 0; i + 2 <= n; i += 2) {
+        double *a0 = (double *)&q[i].amplitude;
+        double *a1 = (double *)&q[i + 1].amplitude;
+        __m256d a = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(a0)), _mm_loadu_pd(a1), 1);
+
+        switch (op) {
+        case NYMYA_GATE_N_CMUL:
+            a = _mm256_addsub_pd(_mm256_mul_pd(a, cr), _mm256_mul_pd(_mm256_permute_pd(a, 0x5), ci));
+            break;
+        case NYMYA_GATE_N_SCALE:
+            a = _mm256_mul_pd(a, cr);
+            break;
+        case NYMYA_GATE_N_CONJ:
+            a = _mm256_xor_pd(a, sign_im);
+            break;
+        case NYMYA_GATE_N_NEG:
+            a = _mm256_xor_pd(a, sign_all);
+            break;
+        case NYMYA_GATE_N_MULI:
+            a = _mm256_xor_pd(_mm256_permute_pd(a, 0x5), sign_re);
+            break;
+        }
+        _mm_storeu_pd(a0, _mm256_castpd256_pd128(a));
+        _mm_storeu_pd(a1, _mm256_extractf128_pd(a, 1));
+    }
+    nymya_gate_n_scalar(q + i, n - i, op, c);
+}
+
+/*
+ * Four amplitudes per register. AVX-512 has no addsub; a subtract with the
+ * odd lanes replaced by the sum does the same two roundings.
+ */
+__attribute__((target("avx512f")))
+static void nymya_gate_n_avx512(nymya_qubit *q, size_t n, int op, complex_double c) {
+    const __m512d cr = _mm512_set1_pd(creal(c));
+    const __m512d ci = _mm512_set1_pd(cimag(c));
+    const __m512i sign_im = _mm512_set4_epi64(INT64_MIN, 0, INT64_MIN, 0);
+    const __m512i sign_re = _mm512_set4_epi64(0, INT64_MIN, 0, INT64_MIN);
+    const __m512i sign_all = _mm512_set1_epi64(INT64_MIN);
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        double *a0 = (double *)&q[i].amplitude;
+        double *a1 = (double *)&q[i + 1].amplitude;
+        double *a2 = (double *)&q[i + 2].amplitude;
+        double *a3 = (double *)&q[i + 3].amplitude;
+        __m256d lo = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(a0)), _mm_loadu_pd(a1), 1);
+        __m256d hi = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(a2)), _mm_loadu_pd(a3), 1);
+        __m512d a = _mm512_insertf64x4(_mm512_castpd256_pd512(lo), hi, 1);
+
+        switch (op) {
+        case NYMYA_GATE_N_CMUL: {
+            __m512d p = _mm512_mul_pd(a, cr);
+            __m512d t = _mm512_mul_pd(_mm512_permute_pd(a, 0x55), ci);
+
+            a = _mm512_mask_add_pd(_mm512_sub_pd(p, t), 0xAA, p, t);
+            break;
+        }
+        case NYMYA_GATE_N_SCALE:
+            a = _mm512_mul_pd(a, cr);
+            break;
+        case NYMYA_GATE_N_CONJ:
+            a = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), sign_im));
+            break;
+        case NYMYA_GATE_N_NEG:
+            a = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), sign_all));
+            break;
+        case NYMYA_GATE_N_MULI:
+            a = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(_mm512_permute_pd(a, 0x55)), sign_re));
+            break;
+        }
+        lo = _mm512_castpd512_pd256(a);
+        hi = _mm512_extractf64x4_pd(a, 1);
+        _mm_storeu_pd(a0, _mm256_castpd256_pd128(lo));
+        _mm_storeu_pd(a1, _mm256_extractf128_pd(lo, 1));
+        _mm_storeu_pd(a2, _mm256_castpd256_pd128(hi));
+        _mm_storeu_pd(a3, _mm256_extractf128_pd(hi, 1));
+    }
+    nymya_gate_n_avx2(q + i, n - i, op, c);
+}
+
+// Best loop for this CPU; the ifunc resolver, so it may only use compiler builtins
+static nymya_gate_n_fn nymya_gate_n_resolve(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return nymya_gate_n_avx512;
+    if (__builtin_cpu_supports("avx2")) return nymya_gate_n_avx2;
+    return nymya_gate_n_scalar;
+}
+#endif // NYMYA_GATE_N_X86
+
+#ifdef NYMYA_GATE_N_NEON
+// One amplitude per register; the product's even lane adds a negated term
+static void nymya_gate_n_neon(nymya_qubit *q, size_t n, int op, complex_double c) {
+    const float64x2_t cr = vdupq_n_f64(creal(c));
+    const float64x2_t ci = vdupq_n_f64(cimag(c));
+    const uint64x2_t sign_im = vcombine_u64(vcreate_u64(0), vcreate_u64(1ull << 63));
+    const uint64x2_t sign_re = vcombine_u64(vcreate_u64(1ull << 63), vcreate_u64(0));
+    const uint64x2_t sign_all = vdupq_n_u64(1ull << 63);
+
+    for (size_t i = 0; i < n; i++) {
+        double *p = (double *)&q[i].amplitude;
+        float64x2_t a = vld1q_f64(p);
+
+        switch (op) {
+        case NYMYA_GATE_N_CMUL: {
+            float64x2_t t = vmulq_f64(vextq_f64(a, a, 1), ci);
+
+            t = vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(t), sign_re));
+            a = vaddq_f64(vmulq_f64(a, cr), t);
+            break;
+        }
+        case NYMYA_GATE_N_SCALE:
+            a = vmulq_f64(a, cr);
+            break;
+        case NYMYA_GATE_N_CONJ:
+            a = vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(a), sign_im));
+            break;
+        case NYMYA_GATE_N_NEG:
+            a = vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(a), sign_all));
+            break;
+        case NYMYA_GATE_N_MULI:
+            a = vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(vextq_f64(a, a, 1)), sign_re));
+            break;
+        }
+        vst1q_f64(p, a);
+    }
+}
+#endif // NYMYA_GATE_N_NEON
+
+#if defined(NYMYA_GATE_N_X86) && defined(NYMYA_HAVE_IFUNC)
+static void nymya_gate_n_run(nymya_qubit *q, size_t n, int op, complex_double c)
+    NYMYA_IFUNC(nymya_gate_n_resolve);
+#elif defined(NYMYA_GATE_N_X86)
+static nymya_gate_n_fn nymya_gate_n_best;
+
+static void nymya_gate_n_run(nymya_qubit *q, size_t n, int op, complex_double c) {
+    nymya_gate_n_fn fn = __atomic_load_n(&nymya_gate_n_best, __ATOMIC_ACQUIRE);
+
+    if (!fn) {
+        fn = nymya_gate_n_resolve();
+        __atomic_store_n(&nymya_gate_n_best, fn, __ATOMIC_RELEASE);
+    }
+    fn(q, n, op, c);
+}
+#elif defined(NYMYA_GATE_N_NEON)
+#define nymya_gate_n_run nymya_gate_n_neon
+#else
+#define nymya_gate_n_run nymya_gate_n_scalar
+#endif
+
+// One nymya_3362_submit() per NYMYA_SUBMIT_MAX_QUBITS qubits, record i on qubit i
+static int nymya_gate_n_submit(nymya_qubit *qs, size_t n, uint32_t code, char axis, double theta) {
+    size_t chunk = n < NYMYA_SUBMIT_MAX_QUBITS ? n : NYMYA_SUBMIT_MAX_QUBITS;
+    nymya_op *ops = nymya_scratch_get(NYMYA_SCRATCH_AUX, chunk * sizeof(*ops));
+    size_t done, i;
+
+    if (!ops) return -1;
+    for (i = 0; i < chunk; i++) {
+        ops[i] = (nymya_op){ .gate_code = code, .axis = (uint32_t)(unsigned char)axis,
+                             .qubit = { (uint32_t)i }, .param = nymya_fp_from_double(theta) };
+    }
+    for (done = 0; done < n; done += chunk) {
+        size_t m = n - done < chunk ? n - done : chunk;
+        int ret = nymya_3362_submit(ops, m, qs + done, m);
+
+        if (ret) return ret;
+    }
+    return 0;
+}
+
+/*
+ * Shared body of the _n functions: @op and @c are the gate's effect on an
+ * amplitude, @code, @axis and @theta its nymya_op record, @label its event.
+ */
+static int nymya_gate_n(nymya_qubit *qs, size_t n, int op, complex_double c,
+                        uint32_t code, char axis, double theta, const char *label) {
+    int backend;
+
+    if (!qs) return -1;
+    if (n == 0) return 0;
+    backend = nymya_backend_get();
+    if (backend == NYMYA_BACKEND_KERNEL || backend == NYMYA_BACKEND_PLUGIN)
+        return nymya_gate_n_submit(qs, n, code, axis, theta);
+
+    if (op != NYMYA_GATE_N_NONE) nymya_gate_n_run(qs, n, op, c);
+    log_symbolic_event(label, qs[0].id, qs[0].tag, "Applied to a batch of qubits");
+    return 0;
+}
+
+/**
+ * nymya_3301_identity_gate_n - Identity on @n contiguous qubits.
+ * @qs: First qubit.
+ * @n: Number of qubits.
+ *
+ * Each _n function below has the effect of its single-qubit function on
+ * every qubit of @qs, with one log event for the whole batch, and runs as
+ * one nymya_3362_submit() under NYMYA_BACKEND_KERNEL or _PLUGIN.
+ *
+ * Returns 0, -1 if @qs is NULL or a kernel batch cannot be built, or the
+ * submit's error.
+ */
+int nymya_3301_identity_gate_n(nymya_qubit *qs, size_t n) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_NONE, 0, NYMYA_IDENTITY_GATE_CODE, 0, 0, "ID_GATE");
+}
+
+int nymya_3302_global_phase_n(nymya_qubit *qs, size_t n, double theta) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_CMUL, complex_exp_i(theta), NYMYA_GLOBAL_PHASE_CODE, 0, theta, "GPHASE");
+}
+
+int nymya_3303_pauli_x_n(nymya_qubit *qs, size_t n) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_CONJ, 0, NYMYA_PAULI_X_CODE, 0, 0, "PAULI_X");
+}
+
+int nymya_3304_pauli_y_n(nymya_qubit *qs, size_t n) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_MULI, 0, NYMYA_PAULI_Y_CODE, 0, 0, "PAULI_Y");
+}
+
+int nymya_3305_pauli_z_n(nymya_qubit *qs, size_t n) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_NEG, 0, NYMYA_PAULI_Z_CODE, 0, 0, "PAULI_Z");
+}
+
+int nymya_3306_phase_gate_n(nymya_qubit *qs, size_t n) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_MULI, 0, NYMYA_PHASE_S_CODE, 0, 0, "PHASE_S");
+}
+
+int nymya_3307_sqrt_x_gate_n(nymya_qubit *qs, size_t n) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_CMUL, CMPLX(0.70710678118654752440, 0.70710678118654752440),
+                        NYMYA_SQRT_X_CODE, 0, 0, "SQRT_X");
+}
+
+int nymya_3308_hadamard_gate_n(nymya_qubit *qs, size_t n) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_SCALE, 1.0 / sqrt(2.0), NYMYA_HADAMARD_CODE, 0, 0, "HADAMARD");
+}
+
+int nymya_3315_phase_shift_n(nymya_qubit *qs, size_t n, double theta) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_CMUL, complex_exp_i(theta), NYMYA_PHASE_SHIFT_CODE, 0, theta, "PHASE_SHIFT");
+}
+
+int nymya_3316_phase_gate_n(nymya_qubit *qs, size_t n, double phi) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_CMUL, complex_exp_i(phi), NYMYA_PHASE_GATE_CODE, 0, phi, "PHASE_GATE");
+}
+
+int nymya_3319_rotate_x_n(nymya_qubit *qs, size_t n, double theta) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_CMUL, complex_exp_i(theta / 2.0), NYMYA_ROTATE_X_CODE, 0, theta, "ROT_X");
+}
+
+int nymya_3320_rotate_y_n(nymya_qubit *qs, size_t n, double theta) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_CMUL, complex_exp_i(theta / 2.0), NYMYA_ROTATE_Y_CODE, 0, theta, "ROT_Y");
+}
+
+int nymya_3321_rotate_z_n(nymya_qubit *qs, size_t n, double theta) {
+    return nymya_gate_n(qs, n, NYMYA_GATE_N_CMUL, complex_exp_i(theta / 2.0), NYMYA_ROTATE_Z_CODE, 0, theta, "ROT_Z");
+}
+
+// An unknown @axis fails before any qubit is touched, as it does for one qubit
+int nymya_3330_rotate_n(nymya_qubit *qs, size_t n, char axis, double theta) {
+    switch (axis) {
+    case 'X': case 'x':
+    case 'Y': case 'y':
+    case 'Z': case 'z':
+        return nymya_gate_n(qs, n, NYMYA_GATE_N_CMUL, complex_exp_i(theta / 2.0), NYMYA_ROTATE_CODE,
+                            axis, theta, "ROTATE");
+    }
+    return -1;
+}
+
+#endif // __KERNEL__
@@ -0,0 +1,40 @@
+// src/nymya_gate_table.c
+//
+// NYMYA_GATES as data: one descriptor per gate code, indexed by
+// code - NYMYA_GATE_FIRST. Shared by libnymya and nymya_core.ko, so the
+// kernel batch path, the ioctl dispatcher and userland all read the same
+// arity and argument information.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+#include <linux/module.h>
+#endif
+
+#define NYMYA_GATE_DESC(code, name, shape, n_min, kcore)                        \
+    [(code) - NYMYA_GATE_FIRST] = {                                             \
+        #name, code, NYMYA_SHAPE_##shape, NYMYA_SHAPE_NARGS_##shape,            \
+        NYMYA_SHAPE_OPERANDS_##shape, n_min                                     \
+    },
+static const nymya_gate_desc nymya_gate_descs[NYMYA_GATE_COUNT] = {
+    NYMYA_GATES(NYMYA_GATE_DESC)
+};
+#undef NYMYA_GATE_DESC
+
+/**
+ * nymya_gate_lookup - Finds the descriptor of a gate code.
+ * @code: NYMYA_*_CODE.
+ *
+ * Returns the descriptor, or NULL if @code is not in NYMYA_GATES.
+ */
+const nymya_gate_desc *nymya_gate_lookup(uint32_t code)
+{
+    uint32_t i = code - NYMYA_GATE_FIRST;
+
+    if (i >= NYMYA_GATE_COUNT || !nymya_gate_descs[i].name)
+        return NULL;
+    return &nymya_gate_descs[i];
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL_GPL(nymya_gate_lookup);
+#endif
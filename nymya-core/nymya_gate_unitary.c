@@ -0,0 +1,113 @@
+// src/nymya_gate_unitary.c
+//
+// Precomputed Q32.32 maps of the non-parametric kernel gates. Each qubit holds
+// one amplitude, so a single-qubit gate multiplies it by one factor and a
+// two-qubit gate maps the pair (a, b) of its qubits' amplitudes through a 2x2
+// matrix. The constants are rounded once here instead of being rebuilt, or
+// derived through trig on a fixed angle, on every call.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+
+#include "nymya_mul128.h"
+
+#define NYMYA_U_ONE        ((int64_t)FIXED_POINT_SCALE)
+#define NYMYA_U_HALF       ((int64_t)(FIXED_POINT_SCALE / 2))
+#define NYMYA_U_SQRT2_INV  0xB504F334LL // 1/sqrt(2), rounded
+#define NYMYA_U_COS_PI_6   0xDDB3D743LL // cos(pi/6), rounded
+
+#define NYMYA_U_SLOT(code) [(code) - NYMYA_IDENTITY_GATE_CODE]
+#define NYMYA_U_C(re, im) { (re), (im) }
+#define NYMYA_U_1(re, im) { .dim = 1, .m = { { NYMYA_U_C(re, im) } } }
+
+/*
+ * Indexed by gate code from NYMYA_IDENTITY_GATE_CODE; entries with dim 0 are
+ * gates without a fixed map (parametric, conditional or composite).
+ */
+const struct nymya_fixed_unitary nymya_unitary_table[NYMYA_UNITARY_SLOTS] = {
+    NYMYA_U_SLOT(NYMYA_PAULI_Y_CODE)  = NYMYA_U_1(0, NYMYA_U_ONE),
+    NYMYA_U_SLOT(NYMYA_PAULI_Z_CODE)  = NYMYA_U_1(-NYMYA_U_ONE, 0),
+    NYMYA_U_SLOT(NYMYA_PHASE_S_CODE)  = NYMYA_U_1(0, NYMYA_U_ONE),
+    NYMYA_U_SLOT(NYMYA_SQRT_X_CODE)   = NYMYA_U_1(NYMYA_U_SQRT2_INV, NYMYA_U_SQRT2_INV),
+    NYMYA_U_SLOT(NYMYA_HADAMARD_CODE) = NYMYA_U_1(NYMYA_U_SQRT2_INV, 0),
+    // Controlled gates: the factor applied to the target when the control is on
+    NYMYA_U_SLOT(NYMYA_CZ_CODE)       = NYMYA_U_1(-NYMYA_U_ONE, 0),
+    NYMYA_U_SLOT(NYMYA_CPHASE_S_CODE) = NYMYA_U_1(0, NYMYA_U_ONE),
+    // The pi/6 controlled phase that follows sqrt(iSWAP) in the Sycamore gate
+    NYMYA_U_SLOT(NYMYA_SYCAMORE_CODE) = NYMYA_U_1(NYMYA_U_COS_PI_6, NYMYA_U_HALF),
+
+    NYMYA_U_SLOT(NYMYA_SWAP_CODE) = {
+        .dim = 2,
+        .m = { { NYMYA_U_C(0, 0), NYMYA_U_C(NYMYA_U_ONE, 0) },
+               { NYMYA_U_C(NYMYA_U_ONE, 0), NYMYA_U_C(0, 0) } },
+    },
+    // a' = i*b, b' = i*a
+    NYMYA_U_SLOT(NYMYA_IMSWAP_CODE) = {
+        .dim = 2,
+        .m = { { NYMYA_U_C(0, 0), NYMYA_U_C(0, NYMYA_U_ONE) },
+               { NYMYA_U_C(0, NYMYA_U_ONE), NYMYA_U_C(0, 0) } },
+    },
+    // a' = ((1+i)a + (1-i)b) / 2, b' = ((1-i)a + (1+i)b) / 2
+    NYMYA_U_SLOT(NYMYA_SQRT_SWAP_CODE) = {
+        .dim = 2,
+        .m = { { NYMYA_U_C(NYMYA_U_HALF, NYMYA_U_HALF), NYMYA_U_C(NYMYA_U_HALF, -NYMYA_U_HALF) },
+               { NYMYA_U_C(NYMYA_U_HALF, -NYMYA_U_HALF), NYMYA_U_C(NYMYA_U_HALF, NYMYA_U_HALF) } },
+    },
+    // a' = (a + i*b) / sqrt(2), b' = (i*a + b) / sqrt(2)
+    NYMYA_U_SLOT(NYMYA_SQRT_ISWAP_CODE) = {
+        .dim = 2,
+        .m = { { NYMYA_U_C(NYMYA_U_SQRT2_INV, 0), NYMYA_U_C(0, NYMYA_U_SQRT2_INV) },
+               { NYMYA_U_C(0, NYMYA_U_SQRT2_INV), NYMYA_U_C(NYMYA_U_SQRT2_INV, 0) } },
+    },
+};
+EXPORT_SYMBOL_GPL(nymya_unitary_table);
+
+/**
+ * nymya_unitary_apply1 - Multiplies a qubit's amplitude by a single-qubit entry.
+ * @q: Qubit to update.
+ * @u: Table entry with dim 1.
+ */
+void nymya_unitary_apply1(struct nymya_qubit *q, const struct nymya_fixed_unitary *u)
+{
+    q->amplitude = complex_mul(q->amplitude, u->m[0][0]);
+}
+EXPORT_SYMBOL_GPL(nymya_unitary_apply1);
+
+// Row @r of @u applied to (a, b), summed at 128 bits and shifted once
+static complex_double nymya_unitary_row(const struct nymya_fixed_unitary *u, int r,
+                                        complex_double a, complex_double b)
+{
+    const complex_double *m = u->m[r];
+    nymya_s128 re = nymya_s128_sub(nymya_smul128(m[0].re, a.re), nymya_smul128(m[0].im, a.im));
+    nymya_s128 im = nymya_s128_add(nymya_smul128(m[0].re, a.im), nymya_smul128(m[0].im, a.re));
+    complex_double out;
+
+    re = nymya_s128_sub(nymya_s128_add(re, nymya_smul128(m[1].re, b.re)), nymya_smul128(m[1].im, b.im));
+    im = nymya_s128_add(nymya_s128_add(im, nymya_smul128(m[1].re, b.im)), nymya_smul128(m[1].im, b.re));
+    out.re = nymya_s128_shr(re, 32);
+    out.im = nymya_s128_shr(im, 32);
+    return out;
+}
+
+/**
+ * nymya_unitary_apply2 - Maps the amplitudes of two qubits through a two-qubit entry.
+ * @q1: First qubit; its amplitude is a in (a, b).
+ * @q2: Second qubit; its amplitude is b.
+ * @u: Table entry with dim 2.
+ */
+void nymya_unitary_apply2(struct nymya_qubit *q1, struct nymya_qubit *q2,
+                          const struct nymya_fixed_unitary *u)
+{
+    complex_double a = q1->amplitude;
+    complex_double b = q2->amplitude;
+
+    q1->amplitude = nymya_unitary_row(u, 0, a, b);
+    q2->amplitude = nymya_unitary_row(u, 1, a, b);
+}
+EXPORT_SYMBOL_GPL(nymya_unitary_apply2);
+
+#endif // __KERNEL__
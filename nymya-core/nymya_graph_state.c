@@ -0,0 +1,447 @@
+// src/nymya_graph_state.c
+//
+// Graph-state engine shared by the lattice gates. Every lattice gate is a
+// Hadamard on a set of qubits followed by CNOTs over an edge list, so the
+// loops live here once:
+//
+// - The pattern gates (3346-3354) describe their graph as a static
+//   nymya_graph over one unit of qubits. nymya_graph_state() applies it to
+//   every whole unit of the input, spreading the units across CPUs, since
+//   units share no qubits.
+// - The positional gates (3355-3360) find their edges at run time. They use
+//   nymya_graph_hadamard() and nymya_graph_fanout() (kernel only), which
+//   take the qubits as a strided array and the edges one control at a time.
+// - nymya_graph_schedule() sorts a run-time CNOT list into layers in which
+//   no qubit appears twice. A layer can run on several CPUs at once
+//   (nymya_graph_layer(), kernel only), and the layer count is the CNOT
+//   depth of the circuit on hardware.
+//
+// The gates still go through nymya_3308_hadamard_gate() and
+// nymya_3309_controlled_not(), so results and events match the hand-written
+// loops these replace.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/sched/signal.h>
+
+#define NYMYA_GRAPH_EINVAL (-EINVAL)
+#define NYMYA_GRAPH_ENOMEM (-ENOMEM)
+#define NYMYA_GRAPH_CALLOC(n, size) kvcalloc(n, size, GFP_KERNEL_ACCOUNT)
+#define NYMYA_GRAPH_FREE(p) kvfree(p)
+#else
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NYMYA_GRAPH_EINVAL (-1)
+#define NYMYA_GRAPH_ENOMEM (-1)
+#define NYMYA_GRAPH_CALLOC(n, size) calloc(n, size)
+#define NYMYA_GRAPH_FREE(p) free(p)
+#endif
+
+// Units nymya_graph_state() runs between reschedule points (kernel only)
+#define NYMYA_GRAPH_CHUNK 4096
+
+struct nymya_graph_job {
+    const nymya_graph *g;
+    nymya_qubit **q;
+};
+
+/*
+ * One unit of the pattern, with @nh Hadamards and @nedges CNOTs. The caller
+ * has checked the pattern and every qubit pointer, and with non-NULL qubits
+ * neither gate can fail, so the body has no branches of its own. The
+ * stencils below pass constant sizes, and the compiler unrolls both loops.
+ */
+static inline void nymya_graph_unit(const nymya_graph *g, nymya_qubit **q,
+                                    size_t nh, size_t nedges)
+{
+    size_t k;
+
+    for (k = 0; k < nh; k++)
+        nymya_3308_hadamard_gate(q[g->h[k]]);
+    for (k = 0; k < nedges; k++)
+        nymya_3309_controlled_not(q[g->edges[k].ctrl], q[g->edges[k].target]);
+    log_symbolic_event(g->name, q[0]->id, q[0]->tag, g->msg);
+}
+
+// Runs a pattern of a fixed shape on units [start, end); units share no qubits
+#define NYMYA_GRAPH_STENCIL(unit, nh, nedges)                                   \
+    static int nymya_graph_units_##unit##_##nh##_##nedges(void *ctx,           \
+                                                          size_t start,         \
+                                                          size_t end)           \
+    {                                                                           \
+        const struct nymya_graph_job *job = ctx;                                \
+        nymya_qubit **q = job->q + start * (unit);                              \
+        size_t u;                                                               \
+                                                                                \
+        for (u = start; u < end; u++, q += (unit))                              \
+            nymya_graph_unit(job->g, q, (nh), (nedges));                        \
+        return 0;                                                               \
+    }
+
+// Triangles (3346, 3349), hexagon rings (3347, 3350) and hex rhombi (3348, 3351)
+NYMYA_GRAPH_STENCIL(3, 1, 3)
+NYMYA_GRAPH_STENCIL(6, 6, 6)
+NYMYA_GRAPH_STENCIL(7, 6, 18)
+#undef NYMYA_GRAPH_STENCIL
+
+// Any other pattern shape
+static int nymya_graph_units(void *ctx, size_t start, size_t end)
+{
+    const struct nymya_graph_job *job = ctx;
+    size_t unit = job->g->unit, u;
+
+    for (u = start; u < end; u++)
+        nymya_graph_unit(job->g, job->q + u * unit, job->g->nh, job->g->nedges);
+    return 0;
+}
+
+// Whether every Hadamard and CNOT index of @g is inside a unit
+static int nymya_graph_valid(const nymya_graph *g)
+{
+    size_t k;
+
+    for (k = 0; k < g->nh; k++)
+        if (g->h[k] >= g->unit)
+            return 0;
+    for (k = 0; k < g->nedges; k++)
+        if (g->edges[k].ctrl >= g->unit || g->edges[k].target >= g->unit)
+            return 0;
+    return 1;
+}
+
+/**
+ * nymya_graph_state - Applies a graph-state pattern to every whole unit of @q.
+ * @g: Pattern; its indices are below @g->unit.
+ * @q: Qubits, @g->unit per unit, one unit after another.
+ * @count: Number of qubits; qubits past the last whole unit are left alone.
+ *
+ * For each unit, applies the Hadamards of @g->h, then the CNOTs of
+ * @g->edges in order, then logs @g->name for the unit's first qubit.
+ * Units are independent, so once their gates add up to the
+ * nymya_parallel_for() threshold they run on several CPUs, each logging
+ * into its own thread's event buffer.
+ *
+ * The pattern and all the qubit pointers are checked once before any gate
+ * runs, so a bad input changes nothing and the unit loop does no checks.
+ * The shapes of the triangle, hexagon and hex-rhombi patterns run through
+ * loops specialised to their sizes; other patterns take a generic loop.
+ * In the kernel the units run NYMYA_GRAPH_CHUNK at a time, with a
+ * cond_resched() and a fatal signal check between chunks, so a large
+ * lattice neither holds its CPU nor outlives a kill.
+ *
+ * Returns 0 on success, -EINTR if the task was killed, or -EINVAL (-1 in
+ * userland) if @g or @q is NULL, @count is below one unit, the pattern has
+ * an index outside the unit or a qubit pointer is NULL.
+ */
+int nymya_graph_state(const nymya_graph *g, nymya_qubit *q[], size_t count)
+{
+    struct nymya_graph_job job = { g, q };
+    size_t units, i;
+    int (*fn)(void *ctx, size_t start, size_t end) = nymya_graph_units;
+
+    if (!g || !q || g->unit == 0 || count < g->unit || !nymya_graph_valid(g))
+        return NYMYA_GRAPH_EINVAL;
+    units = count / g->unit;
+    for (i = 0; i < units * g->unit; i++)
+        if (!q[i])
+            return NYMYA_GRAPH_EINVAL;
+
+    if (g->unit == 3 && g->nh == 1 && g->nedges == 3)
+        fn = nymya_graph_units_3_1_3;
+    else if (g->unit == 6 && g->nh == 6 && g->nedges == 6)
+        fn = nymya_graph_units_6_6_6;
+    else if (g->unit == 7 && g->nh == 6 && g->nedges == 18)
+        fn = nymya_graph_units_7_6_18;
+    // A unit is one gate call per Hadamard and CNOT plus its event
+#ifdef __KERNEL__
+    for (i = 0; i < units; i += NYMYA_GRAPH_CHUNK) {
+        size_t n = min_t(size_t, units - i, NYMYA_GRAPH_CHUNK);
+        int ret;
+
+        if (i) {
+            if (fatal_signal_pending(current))
+                return -EINTR;
+            cond_resched();
+        }
+        job.q = q + i * g->unit;
+        ret = nymya_parallel_for_cost(n, (size_t)g->nh + g->nedges + 1, fn, &job);
+        if (ret)
+            return ret;
+    }
+    return 0;
+#else
+    return nymya_parallel_for_cost(units, (size_t)g->nh + g->nedges + 1, fn, &job);
+#endif
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL_GPL(nymya_graph_state);
+#endif
+
+// Whether layer @l is among the @n layers a qubit is already busy in
+static int nymya_graph_busy(const uint32_t *layers, uint32_t n, uint32_t l)
+{
+    uint32_t k;
+
+    for (k = 0; k < n; k++)
+        if (layers[k] == l)
+            return 1;
+    return 0;
+}
+
+/**
+ * nymya_graph_schedule - Sorts CNOTs into layers of qubit-disjoint CNOTs.
+ * @pairs: CNOTs in the order the gate applies them.
+ * @npairs: Entries in @pairs.
+ * @nqubits: Qubit indices in @pairs are below this.
+ * @ordered: Nonzero to keep the meaning of the circuit on real hardware.
+ * @out: Receives the layers; release them with nymya_graph_layers_free().
+ *
+ * Greedy edge colouring: each CNOT goes into the first layer in which
+ * neither of its qubits is used yet. With @ordered set, that layer must
+ * also come after every earlier CNOT it does not commute with, i.e. one
+ * whose target is its control or whose control is its target; CNOTs that
+ * share only a control or only a target commute. The layers applied in
+ * order, each in any order, then equal @pairs applied in order.
+ *
+ * Without @ordered the order is free, which is exact for the qubit model
+ * of nymya_3309_controlled_not(): a CNOT only reads the magnitude of its
+ * control, and no CNOT changes a magnitude. A graph of maximum degree d
+ * then needs at most 2d - 1 layers.
+ *
+ * CNOTs keep their relative order within a layer. Each placement scans
+ * the layers its two qubits are already in, so the cost grows with the
+ * square of the degree, not with @npairs.
+ *
+ * Returns 0 on success, -EINVAL (-1 in userland) on a NULL argument, an
+ * index at or above @nqubits or a CNOT whose control is its target, or
+ * -ENOMEM (-1 in userland).
+ */
+int nymya_graph_schedule(const nymya_graph_pair *pairs, size_t npairs, size_t nqubits,
+                         int ordered, nymya_graph_layers *out)
+{
+    uint32_t *layer = NULL, *busy = NULL, *fill = NULL, *lastc = NULL, *lastt = NULL;
+    size_t *start = NULL, *off = NULL;
+    nymya_graph_pair *sorted = NULL;
+    size_t i, nlayers = 0;
+    int ret = NYMYA_GRAPH_ENOMEM;
+
+    if (!out || (npairs && !pairs) || npairs > (uint32_t)-1 / 2)
+        return NYMYA_GRAPH_EINVAL;
+    for (i = 0; i < npairs; i++)
+        if (pairs[i].ctrl >= nqubits || pairs[i].target >= nqubits ||
+            pairs[i].ctrl == pairs[i].target)
+            return NYMYA_GRAPH_EINVAL;
+    memset(out, 0, sizeof(*out));
+
+    if (npairs) {
+        start = NYMYA_GRAPH_CALLOC(nqubits + 1, sizeof(*start));
+        fill = NYMYA_GRAPH_CALLOC(nqubits, sizeof(*fill));
+        lastc = NYMYA_GRAPH_CALLOC(nqubits, sizeof(*lastc));
+        lastt = NYMYA_GRAPH_CALLOC(nqubits, sizeof(*lastt));
+        layer = NYMYA_GRAPH_CALLOC(npairs, sizeof(*layer));
+        busy = NYMYA_GRAPH_CALLOC(2 * npairs, sizeof(*busy));
+        if (!start || !fill || !lastc || !lastt || !layer || !busy)
+            goto out;
+
+        // Each qubit is busy in one layer per CNOT it is in
+        for (i = 0; i < npairs; i++) {
+            start[pairs[i].ctrl + 1]++;
+            start[pairs[i].target + 1]++;
+        }
+        for (i = 0; i < nqubits; i++)
+            start[i + 1] += start[i];
+
+        // Layers are numbered from 1 here; 0 is "before every CNOT"
+        for (i = 0; i < npairs; i++) {
+            uint32_t c = pairs[i].ctrl, t = pairs[i].target;
+            uint32_t l = 0;
+
+            if (ordered)
+                l = lastt[c] > lastc[t] ? lastt[c] : lastc[t];
+            do
+                l++;
+            while (nymya_graph_busy(busy + start[c], fill[c], l) ||
+                   nymya_graph_busy(busy + start[t], fill[t], l));
+
+            layer[i] = l;
+            busy[start[c] + fill[c]++] = l;
+            busy[start[t] + fill[t]++] = l;
+            if (l > lastc[c])
+                lastc[c] = l;
+            if (l > lastt[t])
+                lastt[t] = l;
+            if (l > nlayers)
+                nlayers = l;
+        }
+    }
+
+    off = NYMYA_GRAPH_CALLOC(nlayers + 1, sizeof(*off));
+    sorted = npairs ? NYMYA_GRAPH_CALLOC(npairs, sizeof(*sorted)) : NULL;
+    if (!off || (npairs && !sorted))
+        goto out;
+
+    // Counting sort by layer, stable so a layer keeps the CNOTs' order
+    for (i = 0; i < npairs; i++)
+        off[layer[i]]++;
+    for (i = 1; i <= nlayers; i++)
+        off[i] += off[i - 1];
+    for (i = 0; i < npairs; i++)
+        sorted[off[layer[i] - 1]++] = pairs[i];
+    for (i = nlayers; i > 0; i--)
+        off[i] = off[i - 1];
+    off[0] = 0;
+
+    out->pairs = sorted;
+    out->off = off;
+    out->npairs = npairs;
+    out->nlayers = nlayers;
+    sorted = NULL;
+    off = NULL;
+    ret = 0;
+out:
+    NYMYA_GRAPH_FREE(sorted);
+    NYMYA_GRAPH_FREE(off);
+    NYMYA_GRAPH_FREE(busy);
+    NYMYA_GRAPH_FREE(layer);
+    NYMYA_GRAPH_FREE(lastt);
+    NYMYA_GRAPH_FREE(lastc);
+    NYMYA_GRAPH_FREE(fill);
+    NYMYA_GRAPH_FREE(start);
+    return ret;
+}
+
+/**
+ * nymya_graph_layers_free - Releases the layers of nymya_graph_schedule().
+ * @layers: Layers; safe to call on zeroed or already freed ones.
+ */
+void nymya_graph_layers_free(nymya_graph_layers *layers)
+{
+    if (!layers)
+        return;
+    NYMYA_GRAPH_FREE(layers->pairs);
+    NYMYA_GRAPH_FREE(layers->off);
+    memset(layers, 0, sizeof(*layers));
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL_GPL(nymya_graph_schedule);
+EXPORT_SYMBOL_GPL(nymya_graph_layers_free);
+
+#define NYMYA_GRAPH_QUBIT(qubits, stride, i) \
+    ((struct nymya_qubit *)((char *)(qubits) + (size_t)(i) * (stride)))
+
+struct nymya_graph_strided {
+    struct nymya_qubit *qubits;
+    size_t stride;
+};
+
+static int nymya_graph_hadamard_range(void *ctx, size_t start, size_t end)
+{
+    const struct nymya_graph_strided *s = ctx;
+    size_t i;
+    int ret;
+
+    for (i = start; i < end; i++) {
+        ret = nymya_3308_hadamard_gate(NYMYA_GRAPH_QUBIT(s->qubits, s->stride, i));
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+/**
+ * nymya_graph_hadamard - Hadamard on each of @count qubits of a strided array.
+ * @qubits: First qubit.
+ * @stride: Bytes from one qubit to the next.
+ * @count: Number of qubits.
+ *
+ * Above the nymya_parallel_for() threshold the qubits are split across CPUs.
+ *
+ * Returns 0 on success or the first gate error.
+ */
+int nymya_graph_hadamard(struct nymya_qubit *qubits, size_t stride, size_t count)
+{
+    struct nymya_graph_strided s = { qubits, stride };
+
+    return nymya_parallel_for(count, nymya_graph_hadamard_range, &s);
+}
+EXPORT_SYMBOL_GPL(nymya_graph_hadamard);
+
+/**
+ * nymya_graph_fanout - CNOT from one qubit to each of a list of targets.
+ * @qubits: First qubit of a strided array.
+ * @stride: Bytes from one qubit to the next.
+ * @ctrl: Index of the control qubit.
+ * @targets: Indices of the target qubits, applied in order.
+ * @n: Number of targets.
+ *
+ * The CNOT sweep of a graph given as neighbour lists is one call per site.
+ * Runs on the calling thread: the sites' lists share qubits.
+ *
+ * Returns 0 on success or the first gate error.
+ */
+int nymya_graph_fanout(struct nymya_qubit *qubits, size_t stride, uint32_t ctrl,
+                       const uint32_t *targets, size_t n)
+{
+    struct nymya_qubit *c = NYMYA_GRAPH_QUBIT(qubits, stride, ctrl);
+    size_t k;
+    int ret;
+
+    for (k = 0; k < n; k++) {
+        ret = nymya_3309_controlled_not(c, NYMYA_GRAPH_QUBIT(qubits, stride, targets[k]));
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_graph_fanout);
+
+struct nymya_graph_cnots {
+    struct nymya_qubit *qubits;
+    size_t stride;
+    const nymya_graph_pair *pairs;
+};
+
+static int nymya_graph_layer_range(void *ctx, size_t start, size_t end)
+{
+    const struct nymya_graph_cnots *s = ctx;
+    size_t k;
+    int ret;
+
+    for (k = start; k < end; k++) {
+        ret = nymya_3309_controlled_not(NYMYA_GRAPH_QUBIT(s->qubits, s->stride, s->pairs[k].ctrl),
+                                        NYMYA_GRAPH_QUBIT(s->qubits, s->stride, s->pairs[k].target));
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+/**
+ * nymya_graph_layer - CNOTs of one layer of nymya_graph_schedule().
+ * @qubits: First qubit of a strided array.
+ * @stride: Bytes from one qubit to the next.
+ * @pairs: CNOTs by qubit index; no qubit may appear twice.
+ * @n: Number of CNOTs.
+ *
+ * The CNOTs share no qubits, so above the nymya_parallel_for() threshold
+ * they are split across CPUs.
+ *
+ * Returns 0 on success or the first gate error.
+ */
+int nymya_graph_layer(struct nymya_qubit *qubits, size_t stride,
+                      const nymya_graph_pair *pairs, size_t n)
+{
+    struct nymya_graph_cnots s = { qubits, stride, pairs };
+
+    return nymya_parallel_for(n, nymya_graph_layer_range, &s);
+}
+EXPORT_SYMBOL_GPL(nymya_graph_layer);
+#endif
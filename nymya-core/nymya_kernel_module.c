@@ -6,5 +6,68 @@
 // Actual implementations are in other files linked as sub-objects.
 #ifdef __KERNEL__
 #include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+
+/**
+ * nymya_core_init - Module entry point; brings up the shared kernel services.
+ *
+ * Returns: 0 on success, or the error of the first service that failed.
+ */
+static int __init nymya_core_init(void)
+{
+    int ret;
+
+    ret = nymya_event_ring_init();
+    if (ret)
+        return ret;
+
+    ret = nymya_ring_init();
+    if (ret)
+        goto fail_event_ring;
+
+    ret = nymya_dev_init();
+    if (ret)
+        goto fail_ring;
+
+    ret = nymya_qrng_dev_init();
+    if (ret)
+        goto fail_dev;
+
+    ret = nymya_stats_init();
+    if (ret)
+        goto fail_qrng;
+
+    pr_info("Nymya Core: Module loaded\n");
+    return 0;
+
+fail_qrng:
+    nymya_qrng_dev_exit();
+fail_dev:
+    nymya_dev_exit();
+fail_ring:
+    nymya_ring_exit();
+fail_event_ring:
+    nymya_event_ring_exit();
+    return ret;
+}
+
+/**
+ * nymya_core_exit - Module exit point; tears services down in reverse order.
+ */
+static void __exit nymya_core_exit(void)
+{
+    nymya_stats_exit();
+    nymya_qrng_dev_exit();
+    nymya_dev_exit();
+    nymya_ring_exit();
+    nymya_event_ring_exit();
+    nymya_stage_exit();
+    pr_info("Nymya Core: Module unloaded\n");
+}
+
+module_init(nymya_core_init);
+module_exit(nymya_core_exit);
+
 MODULE_LICENSE("GPL");
 #endif
@@ -0,0 +1,518 @@
+// src/nymya_lattice_bench.c
+//
+// Lattice scaling benchmark: times the positional lattice gates (3355-3360)
+// on generated point sets of growing size and reports one JSON point per
+// gate and size, so a change to the neighbour search or the parallel passes
+// shows up as a change in the curve.
+//   total   - the userland library call, end to end
+//   phases  - the gate's kernel phases (gather, grid, hadamard, search,
+//             cnot) from /sys/kernel/debug/nymya/phases
+//   marshal - total minus the phases: conversion to and from fixed point,
+//             the user copies and the syscall itself
+// Built and run by "make lattice-bench". The phases need debugfs and write
+// access to nymya/phase_enable; without them only the totals are reported.
+
+#define _GNU_SOURCE // sched_setaffinity()
+
+#include "nymya.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#define LBENCH_PHASES_PATH       "/sys/kernel/debug/nymya/phases"
+#define LBENCH_PHASE_ENABLE_PATH "/sys/kernel/debug/nymya/phase_enable"
+
+#define LBENCH_SIZES     "100,1000,10000,100000,1000000"
+#define LBENCH_RUNS      5
+#define LBENCH_MAX_RUNS  101
+#define LBENCH_MAX_SIZES 32
+#define LBENCH_MAX_SITES 10000000
+
+// Indices of the kernel phase columns, in the order of the phases file
+enum { LB_GATHER, LB_GRID, LB_HADAMARD, LB_SEARCH, LB_CNOT, LB_PHASES };
+
+static const char *const lbench_phase_names[LB_PHASES] = {
+    "gather", "grid", "hadamard", "search", "cnot",
+};
+
+/**
+ * lbench_sites - Generated sites of one lattice, in every position type.
+ * @pos3, @pos4, @pos5: Sites of the lattice's dimension; the others are NULL.
+ * @work3, @work4, @work5: Copies handed to the gate, restored before every run.
+ * @count: Number of sites.
+ */
+typedef struct lbench_sites {
+    nymya_qpos3d *pos3, *work3;
+    nymya_qpos4d *pos4, *work4;
+    nymya_qpos5d *pos5, *work5;
+    size_t count;
+} lbench_sites;
+
+typedef void (*lbench_gen)(double *c, size_t i, size_t count);
+
+/**
+ * lbench_lattice - One gate and the point set it is benchmarked on.
+ * @code: Gate code.
+ * @name: Gate name, as in nymya_33xx_<name>.
+ * @geometry: What @gen produces.
+ * @dims: Coordinates per site.
+ * @min_sites: Smallest count the gate accepts.
+ * @gen: Writes the @dims coordinates of site @i of @count.
+ */
+typedef struct lbench_lattice {
+    unsigned int code;
+    const char *name;
+    const char *geometry;
+    unsigned int dims;
+    size_t min_sites;
+    lbench_gen gen;
+} lbench_lattice;
+
+// Smallest box side whose cells, kept with probability @keep, cover @count points
+static size_t lbench_side(size_t count, unsigned int dims, double keep) {
+    size_t side = (size_t)ceil(pow((double)count / keep, 1.0 / dims));
+
+    while (pow((double)side, dims) * keep < (double)count) side++;
+    return side;
+}
+
+// Site @i of a unit cubic grid, x fastest
+static void lbench_cubic(double *c, size_t i, unsigned int dims, size_t side) {
+    for (unsigned int k = 0; k < dims; k++, i /= side)
+        c[k] = (double)(i % side);
+}
+
+/*
+ * Site @i of D_dims scaled to unit nearest-neighbour distance: the points of
+ * Z^dims with an even coordinate sum, divided by sqrt(2). Each row along x
+ * holds every other cell, starting at x = 1 in rows of odd parity.
+ */
+static void lbench_checkerboard(double *c, size_t i, unsigned int dims, size_t count) {
+    size_t side = lbench_side(count, dims, 0.5);
+    size_t row_len = (side + 1) / 2, rest = i / row_len, parity = 0;
+
+    for (unsigned int k = 1; k < dims; k++, rest /= side) {
+        c[k] = (double)(rest % side);
+        parity += rest % side;
+    }
+    c[0] = (double)(2 * (i % row_len) + (parity & 1));
+    for (unsigned int k = 0; k < dims; k++)
+        c[k] *= M_SQRT1_2;
+}
+
+// FCC with unit nearest-neighbour distance: the 4-point cubic cell of edge sqrt(2)
+static void lbench_fcc(double *c, size_t i, size_t count) {
+    static const double basis[4][3] = { { 0, 0, 0 }, { 0, .5, .5 }, { .5, 0, .5 }, { .5, .5, 0 } };
+    size_t side = lbench_side((count + 3) / 4, 3, 1.0);
+    double cell[3];
+
+    lbench_cubic(cell, i / 4, 3, side);
+    for (int k = 0; k < 3; k++)
+        c[k] = (cell[k] + basis[i % 4][k]) * M_SQRT2;
+}
+
+// HCP with unit nearest-neighbour distance: ABAB stacked triangular layers
+static void lbench_hcp(double *c, size_t i, size_t count) {
+    size_t side = lbench_side(count, 3, 1.0);
+    size_t a = i % side, b = (i / side) % side, l = i / side / side;
+
+    c[0] = (double)a + 0.5 * (double)((b + l) % 2);
+    c[1] = sqrt(3.0) / 2.0 * ((double)b + (double)(l % 2) / 3.0);
+    c[2] = sqrt(6.0) / 3.0 * (double)l;
+}
+
+// The E8 projection is aperiodic; the unit cubic grid loads the grid the same way
+static void lbench_e8_projected(double *c, size_t i, size_t count) {
+    lbench_cubic(c, i, 3, lbench_side(count, 3, 1.0));
+}
+
+static void lbench_d4(double *c, size_t i, size_t count) {
+    lbench_checkerboard(c, i, 4, count);
+}
+
+// B5's lattice is Z^5 at unit spacing
+static void lbench_b5(double *c, size_t i, size_t count) {
+    lbench_cubic(c, i, 5, lbench_side(count, 5, 1.0));
+}
+
+// The E5 (= D5) root lattice, 40 nearest neighbours like its gate's minimum
+static void lbench_e5_projected(double *c, size_t i, size_t count) {
+    lbench_checkerboard(c, i, 5, count);
+}
+
+static const lbench_lattice lbench_lattices[] = {
+    { 3355, "fcc_lattice",          "fcc",         3, 14, lbench_fcc },
+    { 3356, "hcp_lattice",          "hcp",         3, 17, lbench_hcp },
+    { 3357, "e8_projected_lattice", "cubic",       3, 30, lbench_e8_projected },
+    { 3358, "d4_lattice",           "d4",          4, 24, lbench_d4 },
+    { 3359, "b5_lattice",           "z5",          5, 32, lbench_b5 },
+    { 3360, "e5_projected_lattice", "d5",          5, 40, lbench_e5_projected },
+};
+
+/**
+ * lbench_result - Timing of one gate at one size.
+ * @status: "ok", "error" (some call failed) or "unavailable".
+ * @total_ns, @total_min_ns: End-to-end ns per call, median and minimum over the runs.
+ * @phase_ns: Median ns of each kernel phase; valid when @phases is set.
+ * @marshal_ns: Median of total minus the phase sum; valid when @phases is set.
+ * @phases: The kernel phase counters advanced by one run after every call.
+ * @first_error: Return value (or -errno) of the first failure.
+ */
+typedef struct lbench_result {
+    const char *status;
+    double total_ns;
+    double total_min_ns;
+    double phase_ns[LB_PHASES];
+    double marshal_ns;
+    int phases;
+    long first_error;
+} lbench_result;
+
+typedef struct lbench_opts {
+    size_t sizes[LBENCH_MAX_SIZES];
+    unsigned int nsizes;
+    unsigned int runs;
+    int cpu;
+    const char *filter;
+} lbench_opts;
+
+static uint64_t lbench_now_ns(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+static int lbench_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double lbench_median(uint64_t *v, unsigned int n) {
+    qsort(v, n, sizeof(v[0]), lbench_cmp_u64);
+    return (double)v[n / 2];
+}
+
+/**
+ * lbench_read_phases - Reads one gate's cumulative phase counters.
+ * @code: Gate code.
+ * @runs: Receives the number of timed runs.
+ * @ns: Receives LB_PHASES cumulative times.
+ *
+ * Returns 0, or -1 if the file cannot be read. A gate without a line yet
+ * reads as all zeros.
+ */
+static int lbench_read_phases(unsigned int code, uint64_t *runs, uint64_t *ns) {
+    FILE *f = fopen(LBENCH_PHASES_PATH, "r");
+    char line[256];
+
+    *runs = 0;
+    memset(ns, 0, LB_PHASES * sizeof(*ns));
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long v[LB_PHASES], r;
+        unsigned int c;
+
+        if (sscanf(line, "%u %llu %llu %llu %llu %llu %llu", &c, &r, &v[0], &v[1], &v[2],
+                   &v[3], &v[4]) != 2 + LB_PHASES || c != code)
+            continue;
+        *runs = r;
+        for (int p = 0; p < LB_PHASES; p++) ns[p] = v[p];
+        break;
+    }
+    fclose(f);
+    return 0;
+}
+
+/**
+ * lbench_phase_enable - Turns the kernel phase timing on or off.
+ * @on: New state.
+ * @was: Receives the previous state, if not NULL.
+ *
+ * Returns 0, or -1 if the debugfs file cannot be used.
+ */
+static int lbench_phase_enable(int on, int *was) {
+    FILE *f;
+
+    if (was) {
+        int c;
+
+        f = fopen(LBENCH_PHASE_ENABLE_PATH, "r");
+        if (!f) return -1;
+        c = fgetc(f);
+        fclose(f);
+        *was = c == '1';
+    }
+    f = fopen(LBENCH_PHASE_ENABLE_PATH, "w");
+    if (!f) return -1;
+    fputs(on ? "1\n" : "0\n", f);
+    return fclose(f) ? -1 : 0;
+}
+
+static int lbench_sites_init(lbench_sites *s, const lbench_lattice *l, size_t count) {
+    double c[5];
+
+    memset(s, 0, sizeof(*s));
+    s->count = count;
+    switch (l->dims) {
+    case 3:
+        s->pos3 = nymya_aligned_alloc(count * sizeof(*s->pos3), 0);
+        s->work3 = nymya_aligned_alloc(count * sizeof(*s->work3), 0);
+        if (!s->pos3 || !s->work3) return -1;
+        break;
+    case 4:
+        s->pos4 = nymya_aligned_alloc(count * sizeof(*s->pos4), 0);
+        s->work4 = nymya_aligned_alloc(count * sizeof(*s->work4), 0);
+        if (!s->pos4 || !s->work4) return -1;
+        break;
+    default:
+        s->pos5 = nymya_aligned_alloc(count * sizeof(*s->pos5), 0);
+        s->work5 = nymya_aligned_alloc(count * sizeof(*s->work5), 0);
+        if (!s->pos5 || !s->work5) return -1;
+        break;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        nymya_qubit q = { .id = i + 1, .amplitude = 1.0 };
+
+        snprintf(q.tag, sizeof(q.tag), "lat%zu", i);
+        l->gen(c, i, count);
+        if (s->pos3) s->pos3[i] = (nymya_qpos3d){ c[0], c[1], c[2], q };
+        if (s->pos4) s->pos4[i] = (nymya_qpos4d){ c[0], c[1], c[2], c[3], q };
+        if (s->pos5) s->pos5[i] = (nymya_qpos5d){ c[0], c[1], c[2], c[3], c[4], q };
+    }
+    return 0;
+}
+
+static void lbench_sites_free(lbench_sites *s) {
+    nymya_aligned_free(s->pos3);
+    nymya_aligned_free(s->work3);
+    nymya_aligned_free(s->pos4);
+    nymya_aligned_free(s->work4);
+    nymya_aligned_free(s->pos5);
+    nymya_aligned_free(s->work5);
+}
+
+// Restores the working copy and runs gate @code on it once
+static long lbench_call(unsigned int code, lbench_sites *s, uint64_t *ns) {
+    uint64_t t0;
+    long ret;
+
+    if (s->pos3) memcpy(s->work3, s->pos3, s->count * sizeof(*s->pos3));
+    if (s->pos4) memcpy(s->work4, s->pos4, s->count * sizeof(*s->pos4));
+    if (s->pos5) memcpy(s->work5, s->pos5, s->count * sizeof(*s->pos5));
+
+    errno = 0;
+    t0 = lbench_now_ns();
+    switch (code) {
+    case 3355: ret = nymya_3355_fcc_lattice(s->work3, s->count); break;
+    case 3356: ret = nymya_3356_hcp_lattice(s->work3, s->count); break;
+    case 3357: ret = nymya_3357_e8_projected_lattice(s->work3, s->count); break;
+    case 3358: ret = nymya_3358_d4_lattice(s->work4, s->count); break;
+    case 3359: ret = nymya_3359_b5_lattice(s->work5, s->count); break;
+    default:   ret = nymya_3360_e5_projected_lattice(s->work5, s->count); break;
+    }
+    *ns = lbench_now_ns() - t0;
+    return ret;
+}
+
+/**
+ * lbench_time - Times one gate at one size.
+ * @l: Gate and geometry.
+ * @s: Its sites.
+ * @o: Options.
+ * @phases: Whether the kernel phase counters can be read.
+ * @r: Output.
+ *
+ * One untimed call first warms the caches and the staging buffers and
+ * detects a missing kernel. Each timed run is bracketed by reads of the
+ * phase counters; a run during which the counters did not advance by
+ * exactly one (another process ran the gate, or timing is off) drops the
+ * phases from the result.
+ */
+static void lbench_time(const lbench_lattice *l, lbench_sites *s, const lbench_opts *o,
+                        int phases, lbench_result *r) {
+    uint64_t total[LBENCH_MAX_RUNS], marshal[LBENCH_MAX_RUNS];
+    uint64_t phase[LB_PHASES][LBENCH_MAX_RUNS];
+    uint64_t errors = 0, ns;
+    long ret;
+
+    memset(r, 0, sizeof(*r));
+    ret = lbench_call(l->code, s, &ns);
+    if (ret == -1 && errno == ENOSYS) {
+        r->status = "unavailable";
+        r->first_error = -ENOSYS;
+        return;
+    }
+
+    r->phases = phases;
+    for (unsigned int run = 0; run < o->runs; run++) {
+        uint64_t runs0 = 0, runs1 = 0, p0[LB_PHASES], p1[LB_PHASES], sum = 0;
+
+        if (r->phases && lbench_read_phases(l->code, &runs0, p0)) r->phases = 0;
+        ret = lbench_call(l->code, s, &total[run]);
+        if (ret && !errors++) r->first_error = ret == -1 && errno ? -errno : ret;
+        if (r->phases && (lbench_read_phases(l->code, &runs1, p1) || runs1 != runs0 + 1))
+            r->phases = 0;
+        if (!r->phases) continue;
+
+        for (int p = 0; p < LB_PHASES; p++) {
+            phase[p][run] = p1[p] - p0[p];
+            sum += phase[p][run];
+        }
+        marshal[run] = total[run] > sum ? total[run] - sum : 0;
+    }
+
+    r->total_ns = lbench_median(total, o->runs);
+    r->total_min_ns = (double)total[0];
+    if (r->phases) {
+        for (int p = 0; p < LB_PHASES; p++)
+            r->phase_ns[p] = lbench_median(phase[p], o->runs);
+        r->marshal_ns = lbench_median(marshal, o->runs);
+    }
+    r->status = errors ? "error" : "ok";
+}
+
+static int lbench_selected(const lbench_lattice *l, const char *filter) {
+    char code[8];
+
+    if (!filter) return 1;
+    snprintf(code, sizeof(code), "%u", l->code);
+    return strstr(l->name, filter) || strstr(l->geometry, filter) || strcmp(code, filter) == 0;
+}
+
+static void lbench_print(FILE *out, const lbench_lattice *l, size_t sites,
+                         const lbench_result *r, int *first) {
+    fprintf(out, "%s    {\"code\": %u, \"gate\": \"%s\", \"geometry\": \"%s\", \"dims\": %u, "
+                 "\"sites\": %zu, \"status\": \"%s\", \"ns_total\": %.0f, \"ns_total_min\": %.0f, "
+                 "\"ns_per_site\": %.2f",
+            *first ? "" : ",\n", l->code, l->name, l->geometry, l->dims, sites, r->status,
+            r->total_ns, r->total_min_ns, sites ? r->total_ns / (double)sites : 0);
+    if (r->phases) {
+        fprintf(out, ", \"ns_marshal\": %.0f", r->marshal_ns);
+        for (int p = 0; p < LB_PHASES; p++)
+            fprintf(out, ", \"ns_%s\": %.0f", lbench_phase_names[p], r->phase_ns[p]);
+    }
+    fprintf(out, ", \"first_error\": %ld}", r->first_error);
+    *first = 0;
+}
+
+static void lbench_usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-s sizes] [-r runs] [-c cpu] [-g gate] [-o file] [-l]\n"
+            "  -s  comma-separated site counts (default %s, max %d each)\n"
+            "  -r  timed runs per gate and size; the median is reported (default %d, max %d)\n"
+            "  -c  CPU to pin to, -1 for none (default -1)\n"
+            "  -g  only gates whose name or geometry contains, or whose code equals, this\n"
+            "  -o  write the JSON here instead of stdout\n"
+            "  -l  keep userland gate logging on (off by default)\n",
+            prog, LBENCH_SIZES, LBENCH_MAX_SITES, LBENCH_RUNS, LBENCH_MAX_RUNS);
+}
+
+static int lbench_parse_sizes(const char *s, lbench_opts *o) {
+    char *end;
+
+    o->nsizes = 0;
+    while (*s) {
+        unsigned long long v = strtoull(s, &end, 10);
+
+        if (end == s || !v || v > LBENCH_MAX_SITES || o->nsizes == LBENCH_MAX_SIZES) return -1;
+        o->sizes[o->nsizes++] = (size_t)v;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return o->nsizes ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    lbench_opts o = { .runs = LBENCH_RUNS, .cpu = -1 };
+    const size_t count = sizeof(lbench_lattices) / sizeof(lbench_lattices[0]);
+    const char *out_path = NULL;
+    int keep_log = 0, first = 1, phases, was_on = 0, opt;
+    struct utsname u;
+    FILE *out = stdout;
+
+    lbench_parse_sizes(LBENCH_SIZES, &o);
+    while ((opt = getopt(argc, argv, "s:r:c:g:o:lh")) != -1) {
+        switch (opt) {
+        case 's':
+            if (lbench_parse_sizes(optarg, &o)) {
+                lbench_usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'r': o.runs = (unsigned int)strtoul(optarg, NULL, 10); break;
+        case 'c': o.cpu = atoi(optarg); break;
+        case 'g': o.filter = optarg; break;
+        case 'o': out_path = optarg; break;
+        case 'l': keep_log = 1; break;
+        default:
+            lbench_usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (!o.runs || o.runs > LBENCH_MAX_RUNS) {
+        lbench_usage(argv[0]);
+        return 2;
+    }
+
+    if (o.cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(o.cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set)) {
+            perror("nymya_lattice_bench: sched_setaffinity");
+            return 1;
+        }
+    }
+    if (!keep_log) nymya_log_set_level(NYMYA_LOG_OFF);
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        perror("nymya_lattice_bench: fopen");
+        return 1;
+    }
+    if (uname(&u)) strcpy(u.machine, "unknown");
+
+    phases = lbench_phase_enable(1, &was_on) == 0;
+    if (!phases)
+        fprintf(stderr, "nymya_lattice_bench: Kernel phases unavailable (mount debugfs, run as root)\n");
+
+    fprintf(out, "{\n  \"arch\": \"%s\", \"runs\": %u, \"cpu\": %d, \"phases\": %s,\n  \"results\": [\n",
+            u.machine, o.runs, o.cpu, phases ? "true" : "false");
+
+    for (size_t i = 0; i < count; i++) {
+        const lbench_lattice *l = &lbench_lattices[i];
+
+        if (!lbench_selected(l, o.filter)) continue;
+        for (unsigned int k = 0; k < o.nsizes; k++) {
+            size_t n = o.sizes[k] < l->min_sites ? l->min_sites : o.sizes[k];
+            lbench_sites s;
+            lbench_result r;
+
+            if (lbench_sites_init(&s, l, n)) {
+                fprintf(stderr, "nymya_lattice_bench: Out of memory for %zu sites\n", n);
+                lbench_sites_free(&s);
+                continue;
+            }
+            lbench_time(l, &s, &o, phases, &r);
+            lbench_print(out, l, n, &r, &first);
+            fflush(out);
+            lbench_sites_free(&s);
+        }
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    if (phases && !was_on) lbench_phase_enable(0, NULL);
+    return 0;
+}
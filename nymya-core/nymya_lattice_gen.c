@@ -0,0 +1,333 @@
+// src/nymya_lattice_gen.c
+//
+// Perfect lattices for the positional gates (3355-3360), generated rather
+// than stored. Site i of a lattice is a pure function of i, so coordinates
+// come out in chunks of any size, and the neighbours of a site follow from a
+// small offset table instead of a search over all sites.
+//
+// Every lattice is scaled to unit nearest-neighbour distance and filled
+// into a box one row after another, like the lattices of nymya_lattice_bench:
+//
+// - FCC (3355) is D3, and D4 (3358) and the E5 projection (3360, taken as
+//   D5) are the points of Z^n with an even coordinate sum, over sqrt(2).
+// - HCP (3356) stacks triangular layers ABAB.
+// - B5 (3359) is Z^5. The E8 projection (3357) is aperiodic; its generator
+//   gives Z^3, which has the same six neighbours at its cutoff.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { NYMYA_GEN_CUBIC, NYMYA_GEN_EVEN, NYMYA_GEN_HCP };
+
+/**
+ * nymya_gen_lattice - How one positional gate's lattice is generated.
+ * @code: Gate code.
+ * @kind: NYMYA_GEN_* layout of the sites.
+ */
+typedef struct nymya_gen_lattice {
+    uint32_t code;
+    unsigned int kind;
+} nymya_gen_lattice;
+
+static const nymya_gen_lattice nymya_gen_lattices[] = {
+    { NYMYA_FCC_LATTICE_CODE,  NYMYA_GEN_EVEN },
+    { NYMYA_HCP_LATTICE_CODE,  NYMYA_GEN_HCP },
+    { NYMYA_E8_PROJECTED_CODE, NYMYA_GEN_CUBIC },
+    { NYMYA_D4_LATTICE_CODE,   NYMYA_GEN_EVEN },
+    { NYMYA_B5_LATTICE_CODE,   NYMYA_GEN_CUBIC },
+    { NYMYA_E5_PROJECTED_CODE, NYMYA_GEN_EVEN },
+};
+
+// Sites in a box of @side cells per axis
+static size_t nymya_gen_sites(unsigned int kind, unsigned int dims, size_t side) {
+    size_t n = kind == NYMYA_GEN_EVEN ? (side + 1) / 2 : side;
+
+    for (unsigned int k = 1; k < dims; k++) {
+        if (n > SIZE_MAX / side) return SIZE_MAX;
+        n *= side;
+    }
+    return n;
+}
+
+// Integer lattice point of site @i
+static void nymya_gen_point(const nymya_lattice_gen *g, size_t i, long *u) {
+    size_t rest = i;
+    unsigned int k0 = 0;
+    long parity = 0;
+
+    if (g->kind == NYMYA_GEN_EVEN) {
+        rest = i / g->row;
+        k0 = 1;
+    }
+    for (unsigned int k = k0; k < g->dims; k++, rest /= g->side) {
+        u[k] = (long)(rest % g->side);
+        parity += u[k];
+    }
+    // Each row along x holds every other point, starting at x = 1 in odd rows
+    if (g->kind == NYMYA_GEN_EVEN)
+        u[0] = 2 * (long)(i % g->row) + (parity & 1);
+}
+
+// Site of integer point @u, or SIZE_MAX if it is not among the first g->count
+static size_t nymya_gen_index(const nymya_lattice_gen *g, const long *u) {
+    size_t i = 0;
+    unsigned int k0 = g->kind == NYMYA_GEN_EVEN ? 1 : 0;
+
+    for (unsigned int k = g->dims; k-- > k0;) {
+        if (u[k] < 0 || (size_t)u[k] >= g->side) return SIZE_MAX;
+        i = i * g->side + (size_t)u[k];
+    }
+    if (g->kind == NYMYA_GEN_EVEN) {
+        long parity = 0;
+
+        for (unsigned int k = 1; k < g->dims; k++) parity += u[k];
+        if (u[0] < 0 || ((u[0] - parity) & 1) || (size_t)(u[0] / 2) >= g->row)
+            return SIZE_MAX;
+        i = i * g->row + (size_t)(u[0] / 2);
+    }
+    return i < g->count ? i : SIZE_MAX;
+}
+
+// Position of integer point @u
+static void nymya_gen_position(unsigned int kind, unsigned int dims, const long *u, double *c) {
+    switch (kind) {
+    case NYMYA_GEN_EVEN:
+        for (unsigned int k = 0; k < dims; k++) c[k] = (double)u[k] * M_SQRT1_2;
+        break;
+    case NYMYA_GEN_HCP:
+        c[0] = (double)u[0] + 0.5 * (double)((u[1] + u[2]) & 1);
+        c[1] = sqrt(3.0) / 2.0 * ((double)u[1] + (double)(u[2] & 1) / 3.0);
+        c[2] = sqrt(6.0) / 3.0 * (double)u[2];
+        break;
+    default:
+        for (unsigned int k = 0; k < dims; k++) c[k] = (double)u[k];
+    }
+}
+
+// Offset class of integer point @u: HCP neighbours depend on the row and layer parity
+static unsigned int nymya_gen_class(unsigned int kind, const long *u) {
+    return kind == NYMYA_GEN_HCP ? (unsigned int)(((u[1] + u[2]) & 1) | ((u[2] & 1) << 1)) : 0;
+}
+
+/**
+ * nymya_lattice_gen_init - Sets up the generator of a positional gate's lattice.
+ * @g: Generator to fill in.
+ * @lattice_code: NYMYA_*_CODE of the gate, 3355 to 3360.
+ * @count: Number of sites.
+ *
+ * The sites are the first @count of the smallest box that holds them.
+ * Every neighbour offset within the gate's cutoff is worked out here, once;
+ * nearest neighbours in all these lattices differ by at most one step
+ * along each integer axis.
+ *
+ * Returns 0, or -1 with errno set to EINVAL for an unknown code or a zero
+ * @count.
+ */
+int nymya_lattice_gen_init(nymya_lattice_gen *g, unsigned int lattice_code, size_t count) {
+    const nymya_gen_lattice *lat = NULL;
+    long u[NYMYA_LATTICE_MAX_DIM], v[NYMYA_LATTICE_MAX_DIM];
+    double c[NYMYA_LATTICE_MAX_DIM], d[NYMYA_LATTICE_MAX_DIM];
+    unsigned int ncand = 1;
+    double cutoff = NYMYA_LATTICE_CUTOFF(lattice_code);
+
+    for (size_t i = 0; i < sizeof(nymya_gen_lattices) / sizeof(nymya_gen_lattices[0]); i++)
+        if (nymya_gen_lattices[i].code == lattice_code) lat = &nymya_gen_lattices[i];
+    if (!g || !lat || count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(g, 0, sizeof(*g));
+    g->lattice_code = lattice_code;
+    g->dims = NYMYA_LATTICE_DIMS(lattice_code);
+    g->kind = lat->kind;
+    g->count = count;
+    g->side = 2;
+    while (nymya_gen_sites(g->kind, g->dims, g->side) < count) g->side++;
+    g->row = g->kind == NYMYA_GEN_EVEN ? (g->side + 1) / 2 : g->side;
+
+    for (unsigned int k = 0; k < g->dims; k++) ncand *= 3;
+    g->nclass = g->kind == NYMYA_GEN_HCP ? 4 : 1;
+
+    for (unsigned int cls = 0; cls < g->nclass; cls++) {
+        // A point of the class well inside the lattice, and its position
+        u[0] = 4;
+        u[1] = 4 + (long)((cls ^ (cls >> 1)) & 1);
+        u[2] = 4 + (long)(cls >> 1);
+        for (unsigned int k = 3; k < g->dims; k++) u[k] = 4;
+        if (g->kind == NYMYA_GEN_EVEN) u[0] = 4 + ((u[1] + u[2]) & 1);
+        nymya_gen_position(g->kind, g->dims, u, c);
+
+        for (unsigned int j = 0, rest; j < ncand; j++) {
+            double d2 = 0;
+            long sum = 0;
+
+            rest = j;
+            for (unsigned int k = 0; k < g->dims; k++, rest /= 3) {
+                v[k] = u[k] + (long)(rest % 3) - 1;
+                sum += v[k] - u[k];
+            }
+            if (!memcmp(u, v, g->dims * sizeof(*u))) continue;
+            if (g->kind == NYMYA_GEN_EVEN && (sum & 1)) continue;
+
+            nymya_gen_position(g->kind, g->dims, v, d);
+            for (unsigned int k = 0; k < g->dims; k++) d2 += (d[k] - c[k]) * (d[k] - c[k]);
+            if (d2 <= cutoff * cutoff && g->noff[cls] < NYMYA_LATTICE_GEN_MAX_NBR) {
+                for (unsigned int k = 0; k < g->dims; k++)
+                    g->off[cls][g->noff[cls]][k] = (int8_t)(v[k] - u[k]);
+                g->noff[cls]++;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * nymya_lattice_gen_coords - Writes the coordinates of a run of sites.
+ * @g: Generator from nymya_lattice_gen_init().
+ * @first: First site.
+ * @n: Number of sites; @first + @n is at most @g->count.
+ * @out: Coordinates of site @first, @g->dims doubles.
+ * @stride: Bytes from one site's coordinates to the next; @g->dims *
+ *          sizeof(double) for a packed array, or sizeof(nymya_qpos3d) (4d,
+ *          5d) to fill the positions of a gate's array and leave its qubits.
+ *
+ * Returns 0, or -1 with errno set to EINVAL for a range past the lattice.
+ */
+int nymya_lattice_gen_coords(const nymya_lattice_gen *g, size_t first, size_t n,
+                             double *out, size_t stride) {
+    long u[NYMYA_LATTICE_MAX_DIM];
+
+    if (!g || (!out && n) || first > g->count || n > g->count - first) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        nymya_gen_point(g, first + i, u);
+        nymya_gen_position(g->kind, g->dims, u, (double *)((char *)out + i * stride));
+    }
+    return 0;
+}
+
+/**
+ * nymya_lattice_gen_coords_soa - nymya_lattice_gen_coords() into one array per axis.
+ * @g: Generator from nymya_lattice_gen_init().
+ * @first: First site.
+ * @n: Number of sites.
+ * @axes: @g->dims arrays; site @first + i goes to index i of each.
+ *
+ * The layout of nymya_3363_lattice_soa() and nymya_topo_build().
+ *
+ * Returns 0, or -1 with errno set to EINVAL.
+ */
+int nymya_lattice_gen_coords_soa(const nymya_lattice_gen *g, size_t first, size_t n,
+                                 double *const axes[]) {
+    long u[NYMYA_LATTICE_MAX_DIM];
+    double c[NYMYA_LATTICE_MAX_DIM];
+
+    if (!g || (!axes && n) || first > g->count || n > g->count - first) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (unsigned int k = 0; k < g->dims && n; k++) {
+        if (!axes[k]) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        nymya_gen_point(g, first + i, u);
+        nymya_gen_position(g->kind, g->dims, u, c);
+        for (unsigned int k = 0; k < g->dims; k++) axes[k][i] = c[k];
+    }
+    return 0;
+}
+
+/**
+ * nymya_lattice_gen_neighbors - Lists the sites within the cutoff of a site.
+ * @g: Generator from nymya_lattice_gen_init().
+ * @site: Site, below @g->count.
+ * @nbr: Receives up to NYMYA_LATTICE_GEN_MAX_NBR sites, in ascending order.
+ *
+ * These are the pairs the gate finds on the generated coordinates, read
+ * off the offset table in O(1): the CNOTs of a perfect lattice without any
+ * neighbour search. Each pair appears in the lists of both its sites.
+ *
+ * Returns the number of neighbours, or 0 for a site past the lattice.
+ */
+size_t nymya_lattice_gen_neighbors(const nymya_lattice_gen *g, size_t site, size_t *nbr) {
+    long u[NYMYA_LATTICE_MAX_DIM], v[NYMYA_LATTICE_MAX_DIM];
+    unsigned int cls;
+    size_t n = 0;
+
+    if (!g || !nbr || site >= g->count) return 0;
+    nymya_gen_point(g, site, u);
+    cls = nymya_gen_class(g->kind, u);
+
+    for (unsigned int e = 0; e < g->noff[cls]; e++) {
+        size_t j, p;
+
+        for (unsigned int k = 0; k < g->dims; k++) v[k] = u[k] + g->off[cls][e][k];
+        j = nymya_gen_index(g, v);
+        if (j == SIZE_MAX) continue;
+
+        // Tables hold at most NYMYA_LATTICE_GEN_MAX_NBR entries; insertion sort
+        for (p = n; p > 0 && nbr[p - 1] > j; p--) nbr[p] = nbr[p - 1];
+        nbr[p] = j;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * nymya_lattice_gen_topo - Builds a module topology of the whole lattice in chunks.
+ * @g: Generator from nymya_lattice_gen_init().
+ *
+ * The first NYMYA_TOPO_MAX_EDIT sites go to nymya_topo_build() and the rest
+ * to nymya_topo_insert() the same number at a time, so only one chunk of
+ * coordinates exists in userland at any point. Paired with a register from
+ * nymya_kreg_alloc() filled in chunks too, a lattice of any size runs
+ * without its point cloud or its qubits ever being in one userland array.
+ *
+ * Returns the topology handle (positive), or -1 on failure (errno is set);
+ * no topology is left behind then.
+ */
+int nymya_lattice_gen_topo(const nymya_lattice_gen *g) {
+    size_t chunk, first, n;
+    double *buf, *axes[NYMYA_LATTICE_MAX_DIM];
+    int handle = -1, err;
+
+    if (!g || !g->count) {
+        errno = EINVAL;
+        return -1;
+    }
+    chunk = g->count < NYMYA_TOPO_MAX_EDIT ? g->count : NYMYA_TOPO_MAX_EDIT;
+    buf = malloc(chunk * g->dims * sizeof(*buf));
+    if (!buf) return -1;
+
+    for (unsigned int k = 0; k < g->dims; k++) axes[k] = buf + (size_t)k * chunk;
+    nymya_lattice_gen_coords_soa(g, 0, chunk, axes);
+    handle = nymya_topo_build(g->lattice_code, (const double *const *)axes, chunk);
+
+    for (first = chunk; handle > 0 && first < g->count; first += n) {
+        n = g->count - first < chunk ? g->count - first : chunk;
+        nymya_lattice_gen_coords(g, first, n, buf, g->dims * sizeof(*buf));
+        if (nymya_topo_insert(handle, g->dims, buf, n) < 0) {
+            err = errno;
+            nymya_topo_free(handle);
+            errno = err;
+            handle = -1;
+        }
+    }
+    free(buf);
+    return handle;
+}
+
+#endif // __KERNEL__
@@ -0,0 +1,625 @@
+// src/nymya_lattice_grid.c
+//
+// Instantiates the spatial index in nymya_lattice_grid.h for the 3D, 4D and
+// 5D position types. The positional lattice cores (3355-3360) call the
+// generated nymya_lattice{3,4,5}d_entangle() instead of scanning every pair.
+// A topology built once with nymya_lattice*d_topo_build() lets later runs on
+// the same coordinates skip the grid and the neighbour search, and sites
+// can then be added or removed at the cost of their neighbourhoods only.
+// A topology keeps the periodic box it was built in, and inserted sites
+// wrap around it the same way.
+// The lattice_max_sites and lattice_chunk_sites parameters bound the memory
+// one call may take.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/sort.h>
+#include <linux/jump_label.h>
+#include <linux/timekeeping.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+
+static unsigned int lattice_max_sites;
+module_param(lattice_max_sites, uint, 0644);
+MODULE_PARM_DESC(lattice_max_sites, "Most sites one positional lattice call may take (0 for no limit)");
+
+static unsigned int lattice_chunk_sites = NYMYA_LATTICE_CHUNK;
+module_param(lattice_chunk_sites, uint, 0644);
+MODULE_PARM_DESC(lattice_chunk_sites, "Sites whose neighbour lists a lattice call builds at once (0 for all)");
+
+/**
+ * nymya_lattice_check_size - Checks a positional lattice call against lattice_max_sites.
+ * @count: Number of sites in the call.
+ *
+ * The lattice syscalls call this before staging anything, so an oversized
+ * request costs no memory.
+ *
+ * Returns 0 if the call may go ahead, or -E2BIG.
+ */
+int nymya_lattice_check_size(size_t count)
+{
+    unsigned int max = READ_ONCE(lattice_max_sites);
+
+    return max && count > max ? -E2BIG : 0;
+}
+EXPORT_SYMBOL_GPL(nymya_lattice_check_size);
+
+/**
+ * nymya_lattice_chunk - Sites whose neighbour lists to build at once.
+ * @count: Number of sites in the call.
+ *
+ * Returns lattice_chunk_sites clamped to 1..@count, or @count when it is 0.
+ */
+size_t nymya_lattice_chunk(size_t count)
+{
+    unsigned int chunk = READ_ONCE(lattice_chunk_sites);
+
+    return chunk && chunk < count ? chunk : max_t(size_t, count, 1);
+}
+
+#define NYMYA_GRID_DIM 3
+#define NYMYA_GRID_TYPE nymya_qpos3d_k
+#define NYMYA_GRID_FN(name) nymya_lattice3d_##name
+#include "nymya_lattice_grid.h"
+
+#define NYMYA_GRID_DIM 4
+#define NYMYA_GRID_TYPE nymya_qpos4d_k
+#define NYMYA_GRID_FN(name) nymya_lattice4d_##name
+#include "nymya_lattice_grid.h"
+
+#define NYMYA_GRID_DIM 5
+#define NYMYA_GRID_TYPE nymya_qpos5d_k
+#define NYMYA_GRID_FN(name) nymya_lattice5d_##name
+#include "nymya_lattice_grid.h"
+
+// Spare entries in each initial neighbour list, so a few insertions need no allocation
+#define NYMYA_TOPO_LIST_SLACK 4
+
+static bool nymya_topo_in_pool(const struct nymya_lattice_topo *topo, const uint32_t *p)
+{
+    return p >= topo->pool && p < topo->pool + topo->pool_len;
+}
+
+/**
+ * nymya_lattice_topo_free - Releases everything a topology holds.
+ * @topo: Topology; safe to call on a zeroed or already freed one.
+ */
+void nymya_lattice_topo_free(struct nymya_lattice_topo *topo)
+{
+    size_t i;
+
+    for (i = 0; topo->adj && i < topo->count; i++)
+        if (!nymya_topo_in_pool(topo, topo->adj[i].nbr))
+            kfree(topo->adj[i].nbr);
+    kvfree(topo->pool);
+    kvfree(topo->adj);
+    kvfree(topo->head);
+    kvfree(topo->next);
+    kvfree(topo->cell);
+    kvfree(topo->coord);
+    nymya_graph_layers_free(&topo->layers);
+    memset(topo, 0, sizeof(*topo));
+}
+EXPORT_SYMBOL_GPL(nymya_lattice_topo_free);
+
+// Grid cell of coordinate @c on axis @k: wrapped on a periodic axis, else rounded towards minus infinity
+static int64_t nymya_topo_cell(const struct nymya_lattice_topo *topo, int64_t c, unsigned int k)
+{
+    int64_t d = c - topo->origin[k];
+    int64_t q;
+
+    if (topo->ncell[k])
+        return nymya_grid_wrap_cell(c, topo->box[k], topo->cell_w[k], topo->ncell[k]);
+    q = div64_s64(d, topo->cell_fp);
+
+    // Sites added below the original minimum must still line up with their neighbours
+    if (q * topo->cell_fp > d)
+        q--;
+    return q;
+}
+
+static uint32_t nymya_topo_hash(const struct nymya_lattice_topo *topo, const int64_t *cell)
+{
+    uint64_t h = 0;
+    unsigned int k;
+
+    for (k = 0; k < topo->dims; k++)
+        h ^= (uint64_t)cell[k] * nymya_grid_hash_mul[k];
+    return (uint32_t)(h >> 32) & topo->mask;
+}
+
+static int64_t nymya_topo_distance_sq(const struct nymya_lattice_topo *topo, uint32_t i, uint32_t j)
+{
+    const int64_t *a = &topo->coord[topo->dims * i], *b = &topo->coord[topo->dims * j];
+    int64_t sum = 0;
+    unsigned int k;
+
+    for (k = 0; k < topo->dims; k++)
+        sum += fixed_point_square(nymya_grid_image(a[k] - b[k], topo->box[k]));
+    return sum;
+}
+
+/**
+ * nymya_topo_reserve - Grows the per-site arrays of @topo to @cap sites.
+ *
+ * Returns 0 on success or -ENOMEM, leaving @topo as it was.
+ */
+static int nymya_topo_reserve(struct nymya_lattice_topo *topo, size_t cap)
+{
+    unsigned int dims = topo->dims;
+    struct nymya_lattice_adj *adj;
+    int64_t *coord, *cell;
+    uint32_t *next;
+
+    if (cap <= topo->cap)
+        return 0;
+
+    coord = kvmalloc_array(cap, dims * sizeof(*coord), NYMYA_GRID_GFP);
+    cell = kvmalloc_array(cap, dims * sizeof(*cell), NYMYA_GRID_GFP);
+    next = kvmalloc_array(cap, sizeof(*next), NYMYA_GRID_GFP);
+    adj = kvcalloc(cap, sizeof(*adj), NYMYA_GRID_GFP);
+    if (!coord || !cell || !next || !adj) {
+        kvfree(coord);
+        kvfree(cell);
+        kvfree(next);
+        kvfree(adj);
+        return -ENOMEM;
+    }
+
+    if (topo->count) {
+        memcpy(coord, topo->coord, topo->count * dims * sizeof(*coord));
+        memcpy(cell, topo->cell, topo->count * dims * sizeof(*cell));
+        memcpy(next, topo->next, topo->count * sizeof(*next));
+        memcpy(adj, topo->adj, topo->count * sizeof(*adj));
+    }
+    kvfree(topo->coord);
+    kvfree(topo->cell);
+    kvfree(topo->next);
+    kvfree(topo->adj);
+    topo->coord = coord;
+    topo->cell = cell;
+    topo->next = next;
+    topo->adj = adj;
+    topo->cap = cap;
+    return 0;
+}
+
+// Rebins every site into @buckets (a power of two) buckets; -ENOMEM keeps the old ones
+static int nymya_topo_rehash(struct nymya_lattice_topo *topo, size_t buckets)
+{
+    uint32_t *head = kvmalloc_array(buckets, sizeof(*head), NYMYA_GRID_GFP);
+    size_t i;
+
+    if (!head)
+        return -ENOMEM;
+    kvfree(topo->head);
+    topo->head = head;
+    topo->mask = buckets - 1;
+
+    for (i = 0; i < buckets; i++)
+        head[i] = NYMYA_GRID_NONE;
+    for (i = 0; i < topo->count; i++) {
+        uint32_t b = nymya_topo_hash(topo, &topo->cell[topo->dims * i]);
+
+        topo->next[i] = head[b];
+        head[b] = i;
+    }
+    return 0;
+}
+
+// Makes room for one more entry in @a, moving it out of the pool if need be
+static int nymya_topo_list_grow(const struct nymya_lattice_topo *topo, struct nymya_lattice_adj *a)
+{
+    uint32_t cap, *nbr;
+
+    if (a->n < a->cap)
+        return 0;
+
+    cap = max_t(uint32_t, 2 * a->cap, 8);
+    nbr = kmalloc_array(cap, sizeof(*nbr), GFP_KERNEL_ACCOUNT);
+    if (!nbr)
+        return -ENOMEM;
+    if (a->n)
+        memcpy(nbr, a->nbr, a->n * sizeof(*nbr));
+    if (!nymya_topo_in_pool(topo, a->nbr))
+        kfree(a->nbr);
+    a->nbr = nbr;
+    a->cap = cap;
+    return 0;
+}
+
+// Inserts @v into @a in ascending order; the caller has made room
+static void nymya_topo_list_add(struct nymya_lattice_adj *a, uint32_t v)
+{
+    uint32_t p = a->n;
+
+    for (; p > 0 && a->nbr[p - 1] > v; p--)
+        a->nbr[p] = a->nbr[p - 1];
+    a->nbr[p] = v;
+    a->n++;
+}
+
+static void nymya_topo_list_del(struct nymya_lattice_adj *a, uint32_t v)
+{
+    uint32_t p;
+
+    for (p = 0; p < a->n && a->nbr[p] != v; p++)
+        ;
+    if (p == a->n)
+        return;
+    memmove(&a->nbr[p], &a->nbr[p + 1], (a->n - p - 1) * sizeof(*a->nbr));
+    a->n--;
+}
+
+/**
+ * nymya_topo_neighbours - Finds every site within the cutoff of site @i.
+ * @topo: Topology whose grid holds the other sites; @i's cell must be set.
+ * @i: Site to search around.
+ * @out: Receives a kmalloc'd list in ascending order; zeroed when none.
+ *
+ * Scans the 3^dims cells around @i's cell, wrapping around the periodic
+ * axes, as the grid template does.
+ *
+ * Returns 0 on success or -ENOMEM.
+ */
+static int nymya_topo_neighbours(const struct nymya_lattice_topo *topo, uint32_t i,
+                                 struct nymya_lattice_adj *out)
+{
+    const int64_t *ci = &topo->cell[topo->dims * i];
+    unsigned int ncells = 1, o, k;
+    uint32_t j;
+    int ret;
+
+    memset(out, 0, sizeof(*out));
+    for (k = 0; k < topo->dims; k++)
+        ncells *= 3;
+
+    for (o = 0; o < ncells; o++) {
+        int64_t cc[NYMYA_LATTICE_MAX_DIM];
+        unsigned int t = o;
+        bool repeat = false;
+
+        for (k = 0; k < topo->dims; k++, t /= 3) {
+            int step = (int)(t % 3) - 1;
+
+            if (!topo->ncell[k]) {
+                cc[k] = ci[k] + step;
+                continue;
+            }
+            cc[k] = nymya_grid_wrap_step(ci[k], step, topo->ncell[k]);
+            repeat |= cc[k] < 0;
+        }
+        if (repeat)
+            continue;
+
+        for (j = topo->head[nymya_topo_hash(topo, cc)]; j != NYMYA_GRID_NONE; j = topo->next[j]) {
+            if (j == i || memcmp(&topo->cell[topo->dims * j], cc, topo->dims * sizeof(*cc)))
+                continue;
+            if (nymya_topo_distance_sq(topo, i, j) > topo->eps2)
+                continue;
+            ret = nymya_topo_list_grow(topo, out);
+            if (ret) {
+                kfree(out->nbr);
+                memset(out, 0, sizeof(*out));
+                return ret;
+            }
+            out->nbr[out->n++] = j;
+        }
+    }
+
+    if (out->n > 1)
+        sort(out->nbr, out->n, sizeof(*out->nbr), nymya_grid_cmp_u32, NULL);
+    return 0;
+}
+
+/**
+ * nymya_lattice_topo_adopt - Sets up a topology from the pairs topo_build() found.
+ * @topo: Zeroed topology to fill.
+ * @code: Gate code the pairs are for.
+ * @dims: Coordinates per site.
+ * @sites: Sites the pairs were found on.
+ * @cutoff_fp: Neighbour distance cutoff in Q32.32.
+ * @eps2: Squared cutoff in Q32.32 used for the pair test.
+ * @off: @sites->count + 1 offsets into @nbr.
+ * @nbr: Each site's higher-indexed neighbours, ascending.
+ *
+ * Copies the coordinates and the periodic box, bins the sites into the
+ * topology's own grid and turns the lists into one list per site holding
+ * its neighbours on both sides, all carved from one block.
+ *
+ * Returns 0 on success or -ENOMEM, with @topo freed.
+ */
+static int nymya_lattice_topo_adopt(struct nymya_lattice_topo *topo, u32 code, unsigned int dims,
+                                    const struct nymya_lattice_soa *sites, int64_t cutoff_fp,
+                                    int64_t eps2, const size_t *off, const uint32_t *nbr)
+{
+    size_t count = sites->count, i, e, pos;
+    struct nymya_lattice_adj *adj;
+    unsigned int k;
+    int ret;
+
+    topo->code = code;
+    topo->dims = dims;
+    topo->eps2 = eps2;
+    topo->cell_fp = cutoff_fp + NYMYA_GRID_SLACK_FP;
+    memcpy(topo->box, sites->box, sizeof(topo->box));
+    nymya_grid_box_cells(topo->box, dims, topo->cell_fp, topo->cell_w, topo->ncell);
+    ret = nymya_topo_reserve(topo, count);
+    if (ret)
+        goto fail;
+    adj = topo->adj;
+
+    // Size every list: its higher neighbours, the sites it is a higher neighbour of, and slack
+    for (i = 0; i < count; i++)
+        adj[i].cap = off[i + 1] - off[i] + NYMYA_TOPO_LIST_SLACK;
+    for (e = 0; e < off[count]; e++)
+        adj[nbr[e]].cap++;
+
+    topo->pool_len = 2 * off[count] + count * NYMYA_TOPO_LIST_SLACK;
+    topo->pool = kvmalloc_array(topo->pool_len, sizeof(*topo->pool), NYMYA_GRID_GFP);
+    if (!topo->pool) {
+        ret = -ENOMEM;
+        goto fail;
+    }
+    for (i = 0, pos = 0; i < count; i++) {
+        adj[i].nbr = topo->pool + pos;
+        pos += adj[i].cap;
+    }
+
+    // A site's lower neighbours are appended while the sites below it are walked, so every list comes out ascending
+    for (i = 0; i < count; i++) {
+        for (e = off[i]; e < off[i + 1]; e++) {
+            adj[i].nbr[adj[i].n++] = nbr[e];
+            adj[nbr[e]].nbr[adj[nbr[e]].n++] = i;
+        }
+    }
+
+    for (k = 0; k < dims; k++) {
+        int64_t lo = sites->coord[k][0];
+
+        for (i = 1; i < count; i++)
+            lo = min(lo, sites->coord[k][i]);
+        topo->origin[k] = lo;
+    }
+    for (i = 0; i < count; i++) {
+        for (k = 0; k < dims; k++) {
+            topo->coord[dims * i + k] = sites->coord[k][i];
+            topo->cell[dims * i + k] = nymya_topo_cell(topo, sites->coord[k][i], k);
+        }
+    }
+    topo->count = count;
+
+    ret = nymya_topo_rehash(topo, roundup_pow_of_two(2 * count));
+    if (ret)
+        goto fail;
+    return 0;
+
+fail:
+    nymya_lattice_topo_free(topo);
+    return ret;
+}
+
+/**
+ * nymya_lattice_topo_insert - Adds a site to a topology.
+ * @topo: Topology.
+ * @pos: @topo->dims Q32.32 coordinates of the new site.
+ *
+ * The site takes the next index (@topo->count before the call) and is
+ * paired with every site within the cutoff. Only the grid cells around it
+ * and its neighbours' lists are touched, apart from the occasional
+ * doubling of the per-site arrays or of the grid.
+ *
+ * Returns 0 on success, -E2BIG if the topology cannot take another site,
+ * or -ENOMEM; on failure the pairs are unchanged.
+ */
+int nymya_lattice_topo_insert(struct nymya_lattice_topo *topo, const int64_t *pos)
+{
+    struct nymya_lattice_adj found;
+    uint32_t i = topo->count, e, b;
+    unsigned int k;
+    int ret;
+
+    if (topo->count + 1 >= NYMYA_GRID_NONE)
+        return -E2BIG;
+    if (topo->count == topo->cap) {
+        ret = nymya_topo_reserve(topo, max_t(size_t, 2 * topo->cap, 16));
+        if (ret)
+            return ret;
+    }
+
+    for (k = 0; k < topo->dims; k++) {
+        topo->coord[topo->dims * i + k] = pos[k];
+        topo->cell[topo->dims * i + k] = nymya_topo_cell(topo, pos[k], k);
+    }
+    ret = nymya_topo_neighbours(topo, i, &found);
+    if (ret)
+        return ret;
+
+    // Make room everywhere first, so a failure leaves every list as it was
+    for (e = 0; e < found.n; e++) {
+        ret = nymya_topo_list_grow(topo, &topo->adj[found.nbr[e]]);
+        if (ret) {
+            kfree(found.nbr);
+            return ret;
+        }
+    }
+    for (e = 0; e < found.n; e++)
+        nymya_topo_list_add(&topo->adj[found.nbr[e]], i);
+    topo->adj[i] = found;
+
+    b = nymya_topo_hash(topo, &topo->cell[topo->dims * i]);
+    topo->next[i] = topo->head[b];
+    topo->head[b] = i;
+    topo->count++;
+    // The next run schedules the new pairs in
+    nymya_graph_layers_free(&topo->layers);
+
+    // Keep chains short on a growing lattice; if this fails they are only longer
+    if (topo->count > (size_t)topo->mask + 1)
+        nymya_topo_rehash(topo, 2 * ((size_t)topo->mask + 1));
+    return 0;
+}
+EXPORT_SYMBOL_GPL(nymya_lattice_topo_insert);
+
+/**
+ * nymya_lattice_topo_delete - Removes a site from a topology.
+ * @topo: Topology.
+ * @site: Index of the site; below @topo->count.
+ *
+ * The last site takes over index @site so the indices stay dense; the
+ * caller's qubit array must move the same way. Only the lists of the two
+ * sites' neighbours and their grid buckets are touched.
+ */
+void nymya_lattice_topo_delete(struct nymya_lattice_topo *topo, uint32_t site)
+{
+    struct nymya_lattice_adj *adj = topo->adj;
+    uint32_t last = topo->count - 1, e, *link;
+    unsigned int dims = topo->dims;
+
+    nymya_graph_layers_free(&topo->layers);
+    for (e = 0; e < adj[site].n; e++)
+        nymya_topo_list_del(&adj[adj[site].nbr[e]], site);
+    if (!nymya_topo_in_pool(topo, adj[site].nbr))
+        kfree(adj[site].nbr);
+
+    link = &topo->head[nymya_topo_hash(topo, &topo->cell[dims * site])];
+    while (*link != site)
+        link = &topo->next[*link];
+    *link = topo->next[site];
+
+    if (site != last) {
+        // The last site is the highest entry of every list it is in; renumber it there
+        for (e = 0; e < adj[last].n; e++) {
+            struct nymya_lattice_adj *a = &adj[adj[last].nbr[e]];
+
+            a->n--;
+            nymya_topo_list_add(a, site);
+        }
+        adj[site] = adj[last];
+
+        link = &topo->head[nymya_topo_hash(topo, &topo->cell[dims * last])];
+        while (*link != last)
+            link = &topo->next[*link];
+        *link = site;
+        topo->next[site] = topo->next[last];
+
+        memcpy(&topo->coord[dims * site], &topo->coord[dims * last], dims * sizeof(*topo->coord));
+        memcpy(&topo->cell[dims * site], &topo->cell[dims * last], dims * sizeof(*topo->cell));
+    }
+
+    memset(&adj[last], 0, sizeof(adj[last]));
+    topo->count--;
+}
+EXPORT_SYMBOL_GPL(nymya_lattice_topo_delete);
+
+// Sorts the stored pairs, each once from its lower site, into layers
+static int nymya_topo_schedule(struct nymya_lattice_topo *topo)
+{
+    nymya_graph_pair *pairs;
+    size_t npairs = 0, i;
+    uint32_t e;
+    int ret;
+
+    for (i = 0; i < topo->count; i++)
+        for (e = 0; e < topo->adj[i].n; e++)
+            npairs += topo->adj[i].nbr[e] > i;
+
+    pairs = kvmalloc_array(max_t(size_t, npairs, 1), sizeof(*pairs), NYMYA_GRID_GFP);
+    if (!pairs)
+        return -ENOMEM;
+    npairs = 0;
+    for (i = 0; i < topo->count; i++) {
+        const struct nymya_lattice_adj *a = &topo->adj[i];
+
+        for (e = 0; e < a->n; e++) {
+            if (a->nbr[e] > i) {
+                pairs[npairs].ctrl = i;
+                pairs[npairs].target = a->nbr[e];
+                npairs++;
+            }
+        }
+    }
+
+    // CNOTs in this qubit model commute, so the layers need not keep their order
+    ret = nymya_graph_schedule(pairs, npairs, topo->count, 0, &topo->layers);
+    kvfree(pairs);
+    return ret;
+}
+
+/**
+ * nymya_lattice_topo_run - Hadamard on every site, then CNOT on every stored pair.
+ * @topo: Topology from nymya_lattice*d_topo_build().
+ * @qubits: Qubit of each site, @count entries.
+ * @count: Number of sites; must be @topo->count.
+ *
+ * Applies the same gates as the lattice's entangle call on the topology's
+ * current sites, without the grid or the neighbour search. The CNOTs run
+ * layer by layer from @topo->layers, which the first run after a change of
+ * sites builds; the CNOTs of a layer share no qubits and are split across
+ * CPUs. A layer's CNOTs go nymya_lattice_chunk() at a time, with a
+ * nymya_lattice_progress tracepoint, a fatal signal check and a chance to
+ * yield the CPU after each chunk.
+ *
+ * Returns 0 on success, -EINVAL on a count mismatch, -ENOMEM if the
+ * layers cannot be built, -EINTR if the task is killed, or the first gate
+ * error.
+ */
+int nymya_lattice_topo_run(struct nymya_lattice_topo *topo, struct nymya_qubit *qubits,
+                           size_t count)
+{
+    u64 ns[NYMYA_LATTICE_PHASES] = { 0 };
+    bool timed = static_branch_unlikely(&nymya_phase_key);
+    const nymya_graph_layers *layers;
+    size_t chunk, lo, hi, l;
+    u64 t = 0;
+    int ret;
+
+    if (!topo || !topo->adj || !qubits || count == 0 || count != topo->count)
+        return -EINVAL;
+    layers = &topo->layers;
+    if (!layers->off) {
+        ret = nymya_topo_schedule(topo);
+        if (ret)
+            return ret;
+    }
+
+    if (timed)
+        t = ktime_get_ns();
+    ret = nymya_graph_hadamard(qubits, sizeof(*qubits), count);
+    if (ret)
+        return ret;
+    nymya_grid_phase(timed ? ns : NULL, NYMYA_LATTICE_HADAMARD, &t);
+
+    chunk = nymya_lattice_chunk(layers->npairs);
+    for (l = 0; l < layers->nlayers && !ret; l++) {
+        for (lo = layers->off[l]; lo < layers->off[l + 1] && !ret; lo = hi) {
+            hi = min(lo + chunk, layers->off[l + 1]);
+            ret = nymya_graph_layer(qubits, sizeof(*qubits), layers->pairs + lo, hi - lo);
+            trace_nymya_lattice_progress(topo->code, ret ? lo : hi, layers->npairs, ret);
+
+            if (!ret && hi < layers->npairs) {
+                if (fatal_signal_pending(current))
+                    ret = -EINTR;
+                cond_resched();
+            }
+        }
+    }
+    nymya_grid_phase(timed ? ns : NULL, NYMYA_LATTICE_CNOT, &t);
+
+    if (timed && !ret)
+        nymya_stats_phases(topo->code, ns);
+    return ret;
+}
+EXPORT_SYMBOL_GPL(nymya_lattice_topo_run);
+
+#endif // __KERNEL__
@@ -0,0 +1,794 @@
+// src/nymya_lattice_grid.h
+//
+// Dimension-generic spatial index for the positional lattice gates.
+// This file is a template: it is included once per dimension by
+// nymya_lattice_grid.c with the following macros defined, and generates a
+// hashed uniform grid, a neighbour query and the shared "Hadamard every
+// site, CNOT every neighbour pair" driver for that dimension, plus
+// topo_build(), which finds the pairs for a struct nymya_lattice_topo. The
+// gates themselves run through the graph-state engine (nymya_graph_state.c).
+//
+// The grid reads sites through a struct nymya_lattice_soa, so every pass over
+// the coordinates walks NYMYA_GRID_DIM contiguous int64_t arrays. entangle()
+// gathers an array of NYMYA_GRID_TYPE into that form first; entangle_soa()
+// takes the arrays as they are. While nymya_phase_key is on, both time
+// their phases (enum nymya_lattice_phase) for nymya_stats_phases().
+//
+// Axes with a nonzero box edge in the struct nymya_lattice_soa are periodic:
+// their cells wrap around the box, and distances along them are taken to
+// the nearest image, so sites near one face pair with sites near the other.
+//
+// entangle_exact() is the integer form for lattices that sit on Z^n: each
+// site is hashed by its own integer point, and its neighbours are the sites
+// at a fixed set of offsets from it, with no distance test at all.
+//
+// Scratch is sized for the sites, never for their square: the neighbour
+// lists are built for nymya_lattice_chunk() sites at a time, and every
+// allocation fails with -ENOMEM under memory pressure instead of waking
+// the OOM killer.
+//
+//   NYMYA_GRID_DIM      Number of coordinates (3, 4 or 5).
+//   NYMYA_GRID_TYPE     Position type (nymya_qpos3d_k, nymya_qpos4d_k, ...).
+//   NYMYA_GRID_FN(name) Prefixes generated symbols, e.g. nymya_lattice3d_##name.
+//
+// The coordinates of NYMYA_GRID_TYPE must be NYMYA_GRID_DIM consecutive
+// int64_t fields starting at x and ending the struct.
+
+#if !defined(NYMYA_GRID_DIM) || !defined(NYMYA_GRID_TYPE) || !defined(NYMYA_GRID_FN)
+#error "nymya_lattice_grid.h needs NYMYA_GRID_DIM, NYMYA_GRID_TYPE and NYMYA_GRID_FN"
+#endif
+
+#ifndef NYMYA_GRID_COMMON
+#define NYMYA_GRID_COMMON
+
+#define NYMYA_GRID_NONE U32_MAX
+
+// Extra Q32.32 units on the cell edge to cover the truncation in fixed_point_square()
+#define NYMYA_GRID_SLACK_FP 8
+
+// Lattice scratch may be large; fail it rather than reclaim at any cost
+#define NYMYA_GRID_GFP (GFP_KERNEL_ACCOUNT | __GFP_RETRY_MAYFAIL | __GFP_NOWARN)
+
+static const uint64_t nymya_grid_hash_mul[5] = {
+    0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL,
+    0xD6E8FEB86659FD93ULL, 0xFF51AFD7ED558CCDULL,
+};
+
+static int nymya_grid_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// Charges the time since *@t to phase @phase of @ns and restarts *@t; @ns NULL times nothing
+static inline void nymya_grid_phase(u64 *ns, enum nymya_lattice_phase phase, u64 *t)
+{
+    u64 now;
+
+    if (!ns)
+        return;
+    now = ktime_get_ns();
+    ns[phase] += now - *t;
+    *t = now;
+}
+
+// Nearest-image separation for a periodic box edge @box; 0 is an open axis
+static inline int64_t nymya_grid_image(int64_t d, int64_t box)
+{
+    int64_t half = box / 2;
+
+    if (!box || (d >= -half && d <= half))
+        return d;
+    d -= div64_s64(d, box) * box;
+    if (d > half)
+        d -= box;
+    else if (d < -half)
+        d += box;
+    return d;
+}
+
+// True if every edge of @box is open (0) or at least twice @cutoff_fp, as minimum image needs
+static inline bool nymya_grid_box_valid(const int64_t *box, unsigned int dims, int64_t cutoff_fp)
+{
+    unsigned int k;
+
+    for (k = 0; k < dims; k++)
+        if (box[k] < 0 || (box[k] && box[k] / 2 < cutoff_fp))
+            return false;
+    return true;
+}
+
+/*
+ * Cuts each periodic axis of @box into as many cells as fit at @cell_fp or
+ * more each, so no cell is narrower than the cutoff even where the box
+ * wraps. Open axes get 0 cells.
+ */
+static inline void nymya_grid_box_cells(const int64_t *box, unsigned int dims, int64_t cell_fp,
+                                        int64_t *cell_w, uint32_t *ncell)
+{
+    unsigned int k;
+
+    for (k = 0; k < dims; k++) {
+        int64_t n;
+
+        ncell[k] = 0;
+        cell_w[k] = cell_fp;
+        if (!box[k])
+            continue;
+        n = clamp_t(int64_t, div64_s64(box[k], cell_fp), 1, U32_MAX / 2);
+        ncell[k] = n;
+        cell_w[k] = div64_s64(box[k], n);
+    }
+}
+
+// Cell of @c on a periodic axis of @n cells of @w across the box @box
+static inline int64_t nymya_grid_wrap_cell(int64_t c, int64_t box, int64_t w, uint32_t n)
+{
+    int64_t r = c - div64_s64(c, box) * box;
+
+    if (r < 0)
+        r += box;
+    // The last cell takes the remainder of the box
+    return min_t(int64_t, div64_s64(r, w), n - 1);
+}
+
+/*
+ * Cell @c + @step (-1, 0 or +1) around a periodic axis of @n cells, or -1
+ * if that cell was already reached by a smaller step, as happens on boxes
+ * only one or two cells across.
+ */
+static inline int64_t nymya_grid_wrap_step(int64_t c, int step, uint32_t n)
+{
+    if ((n == 1 && step) || (n == 2 && step > 0))
+        return -1;
+    c += step;
+    if (c < 0)
+        c += n;
+    else if (c >= n)
+        c -= n;
+    return c;
+}
+
+// Takes over the pairs topo_build() found; defined in nymya_lattice_grid.c
+static int nymya_lattice_topo_adopt(struct nymya_lattice_topo *topo, u32 code, unsigned int dims,
+                                    const struct nymya_lattice_soa *sites, int64_t cutoff_fp,
+                                    int64_t eps2, const size_t *off, const uint32_t *nbr);
+
+#endif // NYMYA_GRID_COMMON
+
+/**
+ * struct NYMYA_GRID_FN(grid) - Hashed uniform grid over the lattice sites.
+ * @cell: Integer cell coordinates, NYMYA_GRID_DIM per site.
+ * @next: Next site in the same bucket, in ascending index order.
+ * @head: First site of each bucket.
+ * @mask: Number of buckets minus one.
+ * @cell_fp: Cell edge in Q32.32.
+ * @cell_w: Cell edge on each periodic axis, at least @cell_fp.
+ * @ncell: Cells across the box on each periodic axis, 0 on open axes.
+ */
+struct NYMYA_GRID_FN(grid) {
+    uint64_t *cell;
+    uint32_t *next;
+    uint32_t *head;
+    uint32_t mask;
+    int64_t cell_fp;
+    int64_t cell_w[NYMYA_GRID_DIM];
+    uint32_t ncell[NYMYA_GRID_DIM];
+};
+
+static inline int64_t NYMYA_GRID_FN(distance_sq)(const struct nymya_lattice_soa *s,
+                                                  uint32_t i, uint32_t j)
+{
+    int64_t sum = 0;
+    int k;
+
+    for (k = 0; k < NYMYA_GRID_DIM; k++)
+        sum += fixed_point_square(nymya_grid_image(s->coord[k][i] - s->coord[k][j], s->box[k]));
+    return sum;
+}
+
+static inline uint32_t NYMYA_GRID_FN(hash)(const struct NYMYA_GRID_FN(grid) *g, const uint64_t *c)
+{
+    uint64_t h = 0;
+    int k;
+
+    for (k = 0; k < NYMYA_GRID_DIM; k++)
+        h ^= c[k] * nymya_grid_hash_mul[k];
+    return (uint32_t)(h >> 32) & g->mask;
+}
+
+static void NYMYA_GRID_FN(grid_free)(struct NYMYA_GRID_FN(grid) *g)
+{
+    kvfree(g->cell);
+    kvfree(g->next);
+    kvfree(g->head);
+}
+
+/**
+ * NYMYA_GRID_FN(grid_build) - Bins every site into its grid cell.
+ * @g: Grid to fill; released with grid_free() even on failure.
+ * @s: Sites; @s->count must be below NYMYA_GRID_NONE.
+ * @cell_fp: Cell edge in Q32.32; at least the neighbour cutoff.
+ *
+ * Periodic axes are cut into whole cells across the box (see
+ * nymya_grid_box_cells()) and every site is binned by its wrapped
+ * coordinate; open axes start their cells at the lowest coordinate.
+ *
+ * Returns 0 on success or -ENOMEM.
+ */
+static int NYMYA_GRID_FN(grid_build)(struct NYMYA_GRID_FN(grid) *g,
+                                     const struct nymya_lattice_soa *s, int64_t cell_fp)
+{
+    size_t count = s->count;
+    size_t buckets = roundup_pow_of_two(2 * count);
+    size_t i;
+    int k;
+
+    g->cell = kvmalloc_array(count, NYMYA_GRID_DIM * sizeof(*g->cell), NYMYA_GRID_GFP);
+    g->next = kvmalloc_array(count, sizeof(*g->next), NYMYA_GRID_GFP);
+    g->head = kvmalloc_array(buckets, sizeof(*g->head), NYMYA_GRID_GFP);
+    if (!g->cell || !g->next || !g->head)
+        return -ENOMEM;
+    g->mask = buckets - 1;
+    g->cell_fp = cell_fp;
+    nymya_grid_box_cells(s->box, NYMYA_GRID_DIM, cell_fp, g->cell_w, g->ncell);
+
+    // One contiguous sweep per axis: find its minimum, then every site's cell on it
+    for (k = 0; k < NYMYA_GRID_DIM; k++) {
+        const int64_t *c = s->coord[k];
+        int64_t lo = c[0];
+
+        if (g->ncell[k]) {
+            for (i = 0; i < count; i++)
+                g->cell[NYMYA_GRID_DIM * i + k] = nymya_grid_wrap_cell(c[i], s->box[k], g->cell_w[k],
+                                                                       g->ncell[k]);
+            continue;
+        }
+        for (i = 1; i < count; i++)
+            lo = min(lo, c[i]);
+        for (i = 0; i < count; i++)
+            g->cell[NYMYA_GRID_DIM * i + k] = div64_u64((uint64_t)c[i] - (uint64_t)lo, cell_fp);
+    }
+
+    for (i = 0; i < buckets; i++)
+        g->head[i] = NYMYA_GRID_NONE;
+
+    // Insert in descending order so each bucket chain is in ascending index order
+    for (i = count; i-- > 0; ) {
+        uint32_t b = NYMYA_GRID_FN(hash)(g, &g->cell[NYMYA_GRID_DIM * i]);
+
+        g->next[i] = g->head[b];
+        g->head[b] = i;
+    }
+
+    return 0;
+}
+
+/**
+ * NYMYA_GRID_FN(grid_neighbors) - Collects the neighbours of site @i with a higher index.
+ * @g: Grid built over @s.
+ * @s: Sites.
+ * @i: Site whose neighbours are wanted.
+ * @eps2: Squared cutoff in Q32.32, as compared against distance_sq().
+ * @out: Receives the neighbour indices in ascending order, or NULL to only count them.
+ *
+ * Scans the 3^NYMYA_GRID_DIM cells around @i's cell, wrapping around the
+ * periodic axes. Only reads @g and @s, so queries for different sites may
+ * run concurrently.
+ *
+ * Returns the number of neighbours found.
+ */
+static size_t NYMYA_GRID_FN(grid_neighbors)(const struct NYMYA_GRID_FN(grid) *g,
+                                            const struct nymya_lattice_soa *s, uint32_t i,
+                                            int64_t eps2, uint32_t *out)
+{
+    const uint64_t *ci = &g->cell[NYMYA_GRID_DIM * i];
+    unsigned int ncells = 1, o;
+    size_t n = 0;
+    int k;
+
+    for (k = 0; k < NYMYA_GRID_DIM; k++)
+        ncells *= 3;
+
+    for (o = 0; o < ncells; o++) {
+        uint64_t cc[NYMYA_GRID_DIM];
+        unsigned int t = o;
+        bool repeat = false;
+        uint32_t j;
+
+        // Decode o as NYMYA_GRID_DIM base-3 digits, each an offset of -1, 0 or +1
+        for (k = 0; k < NYMYA_GRID_DIM; k++, t /= 3) {
+            int64_t c;
+
+            if (!g->ncell[k]) {
+                cc[k] = ci[k] + (t % 3) - 1;
+                continue;
+            }
+            c = nymya_grid_wrap_step(ci[k], (int)(t % 3) - 1, g->ncell[k]);
+            repeat |= c < 0;
+            cc[k] = c;
+        }
+        if (repeat)
+            continue;
+
+        for (j = g->head[NYMYA_GRID_FN(hash)(g, cc)]; j != NYMYA_GRID_NONE; j = g->next[j]) {
+            const uint64_t *cj = &g->cell[NYMYA_GRID_DIM * j];
+
+            if (j <= i || memcmp(cj, cc, sizeof(cc)))
+                continue;
+            if (NYMYA_GRID_FN(distance_sq)(s, i, j) > eps2)
+                continue;
+            if (out)
+                out[n] = j;
+            n++;
+        }
+    }
+
+    // Cells are visited out of index order; restore the pairwise-scan order
+    if (out && n > 1)
+        sort(out, n, sizeof(*out), nymya_grid_cmp_u32, NULL);
+    return n;
+}
+
+/**
+ * NYMYA_GRID_FN(grid_probe) - Collects the sites at fixed offsets from site @i with a higher index.
+ * @g: Grid built over integer coordinates with a cell edge of 1.
+ * @i: Site whose neighbours are wanted.
+ * @offsets: NYMYA_GRID_DIM components per offset.
+ * @noffsets: Number of offsets.
+ * @out: Receives the neighbour indices in ascending order, or NULL to only count them.
+ *
+ * Every site has its own cell, so a neighbour is a site whose cell is @i's
+ * plus one of @offsets, or @i's own (a second site at the same point, as a
+ * distance test would pair it). Only reads @g.
+ *
+ * Returns the number of neighbours found.
+ */
+static size_t NYMYA_GRID_FN(grid_probe)(const struct NYMYA_GRID_FN(grid) *g, uint32_t i,
+                                        const int8_t *offsets, unsigned int noffsets,
+                                        uint32_t *out)
+{
+    const uint64_t *ci = &g->cell[NYMYA_GRID_DIM * i];
+    size_t n = 0;
+    unsigned int o;
+    int k;
+
+    // Offset noffsets stands for the site's own point
+    for (o = 0; o <= noffsets; o++) {
+        uint64_t cc[NYMYA_GRID_DIM];
+        uint32_t j;
+
+        for (k = 0; k < NYMYA_GRID_DIM; k++)
+            cc[k] = ci[k] + (o < noffsets ? (int64_t)offsets[NYMYA_GRID_DIM * o + k] : 0);
+
+        for (j = g->head[NYMYA_GRID_FN(hash)(g, cc)]; j != NYMYA_GRID_NONE; j = g->next[j]) {
+            if (j <= i || memcmp(&g->cell[NYMYA_GRID_DIM * j], cc, sizeof(cc)))
+                continue;
+            if (out)
+                out[n] = j;
+            n++;
+        }
+    }
+
+    if (out && n > 1)
+        sort(out, n, sizeof(*out), nymya_grid_cmp_u32, NULL);
+    return n;
+}
+
+/**
+ * struct NYMYA_GRID_FN(job) - Shared state of the parallel passes of entangle().
+ * @grid: Grid built over @sites.
+ * @sites: Sites and their qubits.
+ * @eps2: Squared cutoff in Q32.32.
+ * @offsets: Neighbour offsets of an exact run, or NULL for the distance test.
+ * @noffsets: Number of @offsets.
+ * @base: First site of the chunk whose neighbour lists are being built.
+ * @off: Neighbour list offsets; chunk site i owns nbr[off[i]] to nbr[off[i + 1] - 1].
+ * @nbr: Concatenated neighbour lists, each in ascending order.
+ * @nbr_cap: Entries @nbr has room for.
+ */
+struct NYMYA_GRID_FN(job) {
+    const struct NYMYA_GRID_FN(grid) *grid;
+    const struct nymya_lattice_soa *sites;
+    int64_t eps2;
+    const int8_t *offsets;
+    unsigned int noffsets;
+    size_t base;
+    size_t *off;
+    uint32_t *nbr;
+    size_t nbr_cap;
+};
+
+// Neighbours of site @i by whichever search @job is set up for
+static size_t NYMYA_GRID_FN(job_neighbors)(const struct NYMYA_GRID_FN(job) *job, uint32_t i,
+                                           uint32_t *out)
+{
+    if (job->offsets)
+        return NYMYA_GRID_FN(grid_probe)(job->grid, i, job->offsets, job->noffsets, out);
+    return NYMYA_GRID_FN(grid_neighbors)(job->grid, job->sites, i, job->eps2, out);
+}
+
+static int NYMYA_GRID_FN(count_range)(void *ctx, size_t start, size_t end)
+{
+    struct NYMYA_GRID_FN(job) *job = ctx;
+    size_t i;
+
+    for (i = start; i < end; i++)
+        job->off[i + 1] = NYMYA_GRID_FN(job_neighbors)(job, job->base + i, NULL);
+    return 0;
+}
+
+static int NYMYA_GRID_FN(fill_range)(void *ctx, size_t start, size_t end)
+{
+    struct NYMYA_GRID_FN(job) *job = ctx;
+    size_t i;
+
+    for (i = start; i < end; i++)
+        NYMYA_GRID_FN(job_neighbors)(job, job->base + i, job->nbr + job->off[i]);
+    return 0;
+}
+
+/**
+ * NYMYA_GRID_FN(cnot_chunked) - Neighbour discovery and CNOTs, a chunk of sites at a time.
+ * @job: Job with @grid, @sites and @eps2 set.
+ * @code: Gate code reported in the progress tracepoint.
+ * @count: Number of sites.
+ * @ns: Phase times to add the search and CNOT passes to, or NULL.
+ * @t: Clock reading the search pass is timed from, when @ns is set.
+ *
+ * For each chunk of nymya_lattice_chunk() sites, counts every site's
+ * neighbours, lays the lists out back to back and fills them, in parallel
+ * above the nymya_parallel_for() threshold. The CNOTs share qubits, so they
+ * are then applied on the calling thread in the usual order. Between chunks
+ * the call reports its progress, yields the CPU and stops if the task is
+ * being killed.
+ *
+ * Returns 0 on success, -ENOMEM, -EINTR, or the first gate error.
+ */
+static int NYMYA_GRID_FN(cnot_chunked)(struct NYMYA_GRID_FN(job) *job, u32 code, size_t count,
+                                       u64 *ns, u64 *t)
+{
+    size_t chunk = nymya_lattice_chunk(count);
+    size_t lo, hi, i, n;
+    int ret = 0;
+
+    job->off = kvmalloc_array(chunk + 1, sizeof(*job->off), NYMYA_GRID_GFP);
+    if (!job->off)
+        return -ENOMEM;
+
+    for (lo = 0; lo < count && !ret; lo = hi) {
+        hi = min(lo + chunk, count);
+        n = hi - lo;
+        job->base = lo;
+        job->off[0] = 0;
+        nymya_parallel_for(n, NYMYA_GRID_FN(count_range), job);
+        for (i = 0; i < n; i++)
+            job->off[i + 1] += job->off[i];
+
+        if (job->off[n] > job->nbr_cap) {
+            kvfree(job->nbr);
+            job->nbr_cap = max_t(size_t, job->off[n], 2 * job->nbr_cap);
+            job->nbr = kvmalloc_array(job->nbr_cap, sizeof(*job->nbr), NYMYA_GRID_GFP);
+            if (!job->nbr) {
+                job->nbr_cap = 0;
+                ret = -ENOMEM;
+                trace_nymya_lattice_progress(code, lo, count, ret);
+                break;
+            }
+        }
+        nymya_parallel_for(n, NYMYA_GRID_FN(fill_range), job);
+        nymya_grid_phase(ns, NYMYA_LATTICE_SEARCH, t);
+
+        for (i = 0; i < n && !ret; i++)
+            ret = nymya_graph_fanout(job->sites->qubits, job->sites->qubit_stride, lo + i,
+                                     job->nbr + job->off[i], job->off[i + 1] - job->off[i]);
+        nymya_grid_phase(ns, NYMYA_LATTICE_CNOT, t);
+        trace_nymya_lattice_progress(code, ret ? lo : hi, count, ret);
+
+        if (!ret && hi < count) {
+            if (fatal_signal_pending(current))
+                ret = -EINTR;
+            cond_resched();
+            if (ns)
+                *t = ktime_get_ns();
+        }
+    }
+
+    kvfree(job->nbr);
+    kvfree(job->off);
+    return ret;
+}
+
+/**
+ * NYMYA_GRID_FN(run) - Hadamard on every site, then CNOT on every neighbour pair.
+ * @code: Gate code reported in the progress tracepoint.
+ * @sites: Sites, with NYMYA_GRID_DIM coordinate arrays set.
+ * @cutoff_fp: Neighbour distance cutoff in Q32.32; sizes the grid cells.
+ * @eps2: Squared cutoff in Q32.32 used for the pair test.
+ * @offsets: Neighbour offsets for an exact run on integer coordinates, or
+ *           NULL; @cutoff_fp and @eps2 are then unused.
+ * @noffsets: Number of @offsets.
+ * @ns: Phase times to add to, or NULL to leave the clock alone.
+ *
+ * Produces the same CNOTs, in the same (i ascending, then j ascending) order,
+ * as testing every pair (i, j > i) against @eps2, but in O(n) for lattice
+ * inputs. On periodic axes the pair test takes the nearest image. The grid is built before any gate runs. Above the
+ * nymya_parallel_for() threshold the Hadamards and the neighbour discovery
+ * are spread across CPUs. See cnot_chunked() for the CNOT pass.
+ *
+ * An exact run bins each site by its integer point (cells of edge 1) and
+ * takes its neighbours from grid_probe() instead; it has no periodic form.
+ *
+ * Returns 0 on success, -EINVAL on bad arguments (a box edge under twice
+ * the cutoff, or any box edge on an exact run, among them), -ENOMEM,
+ * -EINTR if the task is killed, or the first gate error.
+ */
+static int NYMYA_GRID_FN(run)(u32 code, const struct nymya_lattice_soa *sites,
+                              int64_t cutoff_fp, int64_t eps2,
+                              const int8_t *offsets, unsigned int noffsets, u64 *ns)
+{
+    static const int64_t no_box[NYMYA_GRID_DIM];
+    struct NYMYA_GRID_FN(grid) grid = { 0 };
+    struct NYMYA_GRID_FN(job) job = { 0 };
+    size_t count, k;
+    u64 t = 0;
+    int ret;
+
+    if (!sites || !sites->qubits)
+        return -EINVAL;
+    if (offsets ? memcmp(sites->box, no_box, sizeof(no_box)) != 0 :
+        cutoff_fp <= 0 || !nymya_grid_box_valid(sites->box, NYMYA_GRID_DIM, cutoff_fp))
+        return -EINVAL;
+    count = sites->count;
+    if (count == 0 || count >= NYMYA_GRID_NONE)
+        return -EINVAL;
+    for (k = 0; k < NYMYA_GRID_DIM; k++)
+        if (!sites->coord[k])
+            return -EINVAL;
+
+    if (ns)
+        t = ktime_get_ns();
+    ret = NYMYA_GRID_FN(grid_build)(&grid, sites, offsets ? 1 : cutoff_fp + NYMYA_GRID_SLACK_FP);
+    if (ret)
+        goto out;
+    nymya_grid_phase(ns, NYMYA_LATTICE_GRID, &t);
+
+    job.grid = &grid;
+    job.sites = sites;
+    job.eps2 = eps2;
+    job.offsets = offsets;
+    job.noffsets = noffsets;
+
+    ret = nymya_graph_hadamard(sites->qubits, sites->qubit_stride, count);
+    if (ret)
+        goto out;
+    nymya_grid_phase(ns, NYMYA_LATTICE_HADAMARD, &t);
+
+    ret = NYMYA_GRID_FN(cnot_chunked)(&job, code, count, ns, &t);
+
+out:
+    NYMYA_GRID_FN(grid_free)(&grid);
+    return ret;
+}
+
+/**
+ * NYMYA_GRID_FN(topo_build) - Finds every neighbour pair once and keeps them for reuse.
+ * @code: Gate code the topology is for.
+ * @sites: Sites, with NYMYA_GRID_DIM coordinate arrays set; the qubits are not read.
+ * @cutoff_fp: Neighbour distance cutoff in Q32.32; sizes the grid cells.
+ * @eps2: Squared cutoff in Q32.32 used for the pair test.
+ * @topo: Receives the topology; released with nymya_lattice_topo_free().
+ *
+ * Runs the grid and the neighbour search of NYMYA_GRID_FN(run)() over all
+ * sites, a nymya_lattice_chunk() at a time, but keeps every list, then
+ * hands them to nymya_lattice_topo_adopt(). Unlike run(), the lists are the
+ * result, so they take memory in proportion to the pairs rather than to
+ * one chunk.
+ *
+ * Returns 0 on success, -EINVAL on bad arguments, -ENOMEM, or -EINTR if
+ * the task is killed.
+ */
+int NYMYA_GRID_FN(topo_build)(u32 code, const struct nymya_lattice_soa *sites,
+                              int64_t cutoff_fp, int64_t eps2, struct nymya_lattice_topo *topo)
+{
+    struct NYMYA_GRID_FN(grid) grid = { 0 };
+    struct NYMYA_GRID_FN(job) job = { 0 };
+    size_t count, chunk, lo, hi, i;
+    size_t *off = NULL;
+    uint32_t *nbr = NULL;
+    int k, ret;
+
+    memset(topo, 0, sizeof(*topo));
+    if (!sites || cutoff_fp <= 0 || !nymya_grid_box_valid(sites->box, NYMYA_GRID_DIM, cutoff_fp))
+        return -EINVAL;
+    count = sites->count;
+    if (count == 0 || count >= NYMYA_GRID_NONE)
+        return -EINVAL;
+    for (k = 0; k < NYMYA_GRID_DIM; k++)
+        if (!sites->coord[k])
+            return -EINVAL;
+
+    ret = NYMYA_GRID_FN(grid_build)(&grid, sites, cutoff_fp + NYMYA_GRID_SLACK_FP);
+    if (ret)
+        goto out;
+
+    off = kvmalloc_array(count + 1, sizeof(*off), NYMYA_GRID_GFP);
+    if (!off) {
+        ret = -ENOMEM;
+        goto out;
+    }
+    job.grid = &grid;
+    job.sites = sites;
+    job.eps2 = eps2;
+    chunk = nymya_lattice_chunk(count);
+
+    // Count pass; chunk site i's count lands in off[base + i + 1]
+    off[0] = 0;
+    for (lo = 0; lo < count; lo = hi) {
+        hi = min(lo + chunk, count);
+        job.base = lo;
+        job.off = off + lo;
+        nymya_parallel_for(hi - lo, NYMYA_GRID_FN(count_range), &job);
+        if (fatal_signal_pending(current)) {
+            ret = -EINTR;
+            goto out;
+        }
+        cond_resched();
+    }
+    for (i = 0; i < count; i++)
+        off[i + 1] += off[i];
+
+    nbr = kvmalloc_array(max_t(size_t, off[count], 1), sizeof(*nbr), NYMYA_GRID_GFP);
+    if (!nbr) {
+        ret = -ENOMEM;
+        goto out;
+    }
+    job.nbr = nbr;
+
+    // Fill pass; the offsets are absolute now, so each list lands in place
+    for (lo = 0; lo < count; lo = hi) {
+        hi = min(lo + chunk, count);
+        job.base = lo;
+        job.off = off + lo;
+        nymya_parallel_for(hi - lo, NYMYA_GRID_FN(fill_range), &job);
+        if (fatal_signal_pending(current)) {
+            ret = -EINTR;
+            goto out;
+        }
+        cond_resched();
+    }
+
+    ret = nymya_lattice_topo_adopt(topo, code, NYMYA_GRID_DIM, sites, cutoff_fp, eps2, off, nbr);
+
+out:
+    NYMYA_GRID_FN(grid_free)(&grid);
+    kvfree(nbr);
+    kvfree(off);
+    return ret;
+}
+EXPORT_SYMBOL_GPL(NYMYA_GRID_FN(topo_build));
+
+/**
+ * NYMYA_GRID_FN(entangle_soa) - Hadamard on every site, then CNOT on every neighbour pair.
+ * @code: Gate code the phase timings are accounted to.
+ * @sites: Sites, with NYMYA_GRID_DIM coordinate arrays set.
+ * @cutoff_fp: Neighbour distance cutoff in Q32.32; sizes the grid cells.
+ * @eps2: Squared cutoff in Q32.32 used for the pair test.
+ *
+ * See NYMYA_GRID_FN(run)(). A successful run is added to nymya_stats_phases()
+ * while nymya_phase_key is on.
+ *
+ * Returns 0 on success, -EINVAL on bad arguments, -ENOMEM, -EINTR if the
+ * task is killed, or the first gate error.
+ */
+int NYMYA_GRID_FN(entangle_soa)(u32 code, const struct nymya_lattice_soa *sites,
+                                int64_t cutoff_fp, int64_t eps2)
+{
+    u64 ns[NYMYA_LATTICE_PHASES] = { 0 };
+    bool timed = static_branch_unlikely(&nymya_phase_key);
+    int ret;
+
+    ret = NYMYA_GRID_FN(run)(code, sites, cutoff_fp, eps2, NULL, 0, timed ? ns : NULL);
+    if (timed && !ret)
+        nymya_stats_phases(code, ns);
+    return ret;
+}
+EXPORT_SYMBOL_GPL(NYMYA_GRID_FN(entangle_soa));
+
+/**
+ * NYMYA_GRID_FN(entangle_exact) - entangle_soa() on integer coordinates with fixed neighbour offsets.
+ * @code: Gate code the phase timings are accounted to.
+ * @sites: Sites, with NYMYA_GRID_DIM arrays of plain integer coordinates
+ *         (not Q32.32) and no periodic box.
+ * @offsets: NYMYA_GRID_DIM components per offset, e.g. the root vectors of
+ *           the lattice that are within its cutoff.
+ * @noffsets: Number of @offsets.
+ *
+ * Two sites are neighbours exactly when their difference is one of
+ * @offsets or zero, so discovery costs O(n * @noffsets) hash probes and
+ * has no rounding tolerance. The CNOTs come in the same order as from
+ * entangle_soa(). A successful run is added to nymya_stats_phases() while
+ * nymya_phase_key is on.
+ *
+ * Returns 0 on success, -EINVAL on bad arguments, -ENOMEM, -EINTR if the
+ * task is killed, or the first gate error.
+ */
+int NYMYA_GRID_FN(entangle_exact)(u32 code, const struct nymya_lattice_soa *sites,
+                                  const int8_t *offsets, unsigned int noffsets)
+{
+    u64 ns[NYMYA_LATTICE_PHASES] = { 0 };
+    bool timed = static_branch_unlikely(&nymya_phase_key);
+    int ret;
+
+    if (!offsets)
+        return -EINVAL;
+    ret = NYMYA_GRID_FN(run)(code, sites, 0, 0, offsets, noffsets, timed ? ns : NULL);
+    if (timed && !ret)
+        nymya_stats_phases(code, ns);
+    return ret;
+}
+EXPORT_SYMBOL_GPL(NYMYA_GRID_FN(entangle_exact));
+
+/**
+ * NYMYA_GRID_FN(entangle) - entangle_soa() on an array of NYMYA_GRID_TYPE.
+ * @code: Gate code the phase timings are accounted to.
+ * @k_qubits: Fixed-point qubit positions.
+ * @count: Number of qubits.
+ * @cutoff_fp: Neighbour distance cutoff in Q32.32.
+ * @eps2: Squared cutoff in Q32.32 used for the pair test.
+ *
+ * Copies the coordinates out into one array per axis, so the neighbour
+ * search does not stride over the qubit stored between them; the gates
+ * still update the qubits in @k_qubits. The copy is timed as the gather phase.
+ *
+ * Returns 0 on success, -EINVAL on bad arguments, -ENOMEM, -EINTR if the
+ * task is killed, or the first gate error.
+ */
+int NYMYA_GRID_FN(entangle)(u32 code, NYMYA_GRID_TYPE *k_qubits, size_t count,
+                            int64_t cutoff_fp, int64_t eps2)
+{
+    struct nymya_lattice_soa sites = { 0 };
+    u64 ns[NYMYA_LATTICE_PHASES] = { 0 };
+    bool timed = static_branch_unlikely(&nymya_phase_key);
+    int64_t *coord;
+    u64 t = 0;
+    size_t i;
+    int k, ret;
+
+    BUILD_BUG_ON(sizeof(NYMYA_GRID_TYPE) !=
+                 offsetof(NYMYA_GRID_TYPE, x) + NYMYA_GRID_DIM * sizeof(int64_t));
+    BUILD_BUG_ON(NYMYA_GRID_DIM > NYMYA_LATTICE_MAX_DIM);
+
+    if (!k_qubits || count == 0 || count >= NYMYA_GRID_NONE)
+        return -EINVAL;
+
+    if (timed)
+        t = ktime_get_ns();
+    coord = kvmalloc_array(count, NYMYA_GRID_DIM * sizeof(*coord), NYMYA_GRID_GFP);
+    if (!coord)
+        return -ENOMEM;
+
+    for (k = 0; k < NYMYA_GRID_DIM; k++) {
+        int64_t *axis = coord + (size_t)k * count;
+
+        for (i = 0; i < count; i++)
+            axis[i] = (&k_qubits[i].x)[k];
+        sites.coord[k] = axis;
+    }
+    sites.qubits = &k_qubits[0].q;
+    sites.qubit_stride = sizeof(*k_qubits);
+    sites.count = count;
+    nymya_grid_phase(timed ? ns : NULL, NYMYA_LATTICE_GATHER, &t);
+
+    ret = NYMYA_GRID_FN(run)(code, &sites, cutoff_fp, eps2, NULL, 0, timed ? ns : NULL);
+    kvfree(coord);
+    if (timed && !ret)
+        nymya_stats_phases(code, ns);
+    return ret;
+}
+EXPORT_SYMBOL_GPL(NYMYA_GRID_FN(entangle));
+
+#undef NYMYA_GRID_DIM
+#undef NYMYA_GRID_TYPE
+#undef NYMYA_GRID_FN
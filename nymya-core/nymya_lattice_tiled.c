@@ -0,0 +1,283 @@
+// src/nymya_lattice_tiled.c
+//
+// Out-of-core runs of the positional lattice gates (3355-3360). The sites
+// stay in a memory-mapped file; they are cut into slabs along x, and each
+// slab goes through the gate's syscall as one tile together with a halo:
+// the sites of the neighbouring slabs within the cutoff of its faces.
+//
+// A tile gives exact results for its own sites. In this qubit model a site
+// ends up as its Hadamard, negated once per lower-indexed neighbour whose
+// magnitude is above 0.5, and a CNOT never changes a magnitude. The halo
+// supplies every neighbour of the slab's sites, its Hadamard is the same
+// in any tile, and a tile lists its sites in file order so each pair keeps
+// its control. The halo's own results are wrong (their outer neighbours are
+// missing) and are dropped; each site's result comes from its own tile.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Histogram bins along x that slab boundaries are chosen from
+#define NYMYA_TILE_BINS 65536
+
+/**
+ * nymya_tiles - Slab layout of one tiled run.
+ * @x0: Smallest x in the file.
+ * @inv: Bins per unit of x.
+ * @bin_slab: Slab of each bin.
+ * @lo: First x of each slab; @lo[@nslab] is past the last site.
+ * @nslab: Number of slabs.
+ * @halo: Halo width: the cutoff plus room for rounding to Q32.32.
+ */
+typedef struct nymya_tiles {
+    double x0;
+    double inv;
+    uint32_t *bin_slab;
+    double *lo;
+    size_t nslab;
+    double halo;
+} nymya_tiles;
+
+static size_t nymya_tile_bin(const nymya_tiles *t, double x) {
+    double b = (x - t->x0) * t->inv;
+
+    return b < 0 ? 0 : b >= NYMYA_TILE_BINS - 1 ? NYMYA_TILE_BINS - 1 : (size_t)b;
+}
+
+/*
+ * Calls @fn(ctx, s) for every slab @s whose tile holds a site at @x: its
+ * own slab first, then the slabs whose halo it falls in.
+ */
+static void nymya_tile_each(const nymya_tiles *t, double x,
+                            void (*fn)(void *ctx, size_t s), void *ctx) {
+    size_t own = t->bin_slab[nymya_tile_bin(t, x)], s;
+
+    fn(ctx, own);
+    for (s = own; s > 0 && x < t->lo[s] + t->halo; s--) fn(ctx, s - 1);
+    for (s = own + 1; s < t->nslab && x >= t->lo[s] - t->halo; s++) fn(ctx, s);
+}
+
+// Temporary file next to @path, already unlinked; the index lists can be as large as the data
+static int nymya_tile_tmpfd(const char *path) {
+    const char *slash = strrchr(path, '/');
+    size_t dir = slash ? (size_t)(slash - path) + 1 : 0;
+    static const char name[] = ".nymya-tiles-XXXXXX";
+    char *tmpl = malloc(dir + sizeof(name));
+    int fd;
+
+    if (!tmpl) return -1;
+    memcpy(tmpl, path, dir);
+    memcpy(tmpl + dir, name, sizeof(name));
+    fd = mkstemp(tmpl);
+    if (fd >= 0) unlink(tmpl);
+    free(tmpl);
+    return fd;
+}
+
+struct nymya_tile_count {
+    uint64_t *n;
+};
+
+static void nymya_tile_count_fn(void *ctx, size_t s) {
+    ((struct nymya_tile_count *)ctx)->n[s]++;
+}
+
+struct nymya_tile_fill {
+    uint64_t *next;
+    uint64_t *idx;
+    uint64_t site;
+};
+
+static void nymya_tile_fill_fn(void *ctx, size_t s) {
+    struct nymya_tile_fill *f = ctx;
+
+    f->idx[f->next[s]++] = f->site;
+}
+
+// Runs the gate of @code on @n gathered records
+static int nymya_tile_gate(unsigned int code, void *buf, size_t n) {
+    switch (code) {
+    case NYMYA_FCC_LATTICE_CODE:  return nymya_3355_fcc_lattice(buf, n);
+    case NYMYA_HCP_LATTICE_CODE:  return nymya_3356_hcp_lattice(buf, n);
+    case NYMYA_E8_PROJECTED_CODE: return nymya_3357_e8_projected_lattice(buf, n);
+    case NYMYA_D4_LATTICE_CODE:   return nymya_3358_d4_lattice(buf, n);
+    case NYMYA_B5_LATTICE_CODE:   return nymya_3359_b5_lattice(buf, n);
+    case NYMYA_E5_PROJECTED_CODE: return nymya_3360_e5_projected_lattice(buf, n);
+    }
+    return -1;
+}
+
+/**
+ * nymya_lattice_tiled - Runs a positional lattice gate on a file of sites, tile by tile.
+ * @lattice_code: NYMYA_*_CODE of the gate, 3355 to 3360.
+ * @path: File of nymya_qpos3d, nymya_qpos4d or nymya_qpos5d records, as
+ *        the gate takes; the qubits are updated in place.
+ * @tile_sites: Sites each slab should own; at least the gate's minimum.
+ *
+ * The file is mapped, never read whole. A histogram of x sets slab
+ * boundaries so each slab owns about @tile_sites sites (more where many
+ * sites share an x). A scratch file next to @path holds each tile's site
+ * indices, written in one pass, and the results of each tile's own sites,
+ * which go into @path once every tile has run. Memory use is one tile and
+ * its halo, plus the fixed histogram.
+ *
+ * The results are those of one call on the whole file. A tile needs a
+ * halo as deep as the cutoff, so slabs much thinner than the cutoff make
+ * for large halos.
+ *
+ * Returns 0, -1 on invalid input or a failed file or memory operation
+ * (errno is set), or the first error of a gate call; @path is unchanged
+ * then.
+ */
+int nymya_lattice_tiled(unsigned int lattice_code, const char *path, size_t tile_sites) {
+    const nymya_gate_desc *d = nymya_gate_lookup(lattice_code);
+    unsigned int dims = NYMYA_LATTICE_DIMS(lattice_code);
+    size_t rec = dims == 3 ? sizeof(nymya_qpos3d) : dims == 4 ? sizeof(nymya_qpos4d) : sizeof(nymya_qpos5d);
+    nymya_tiles t = { 0 };
+    uint64_t *hist = NULL, *off = NULL, *next = NULL, *idx = NULL;
+    size_t qsz = rec - dims * sizeof(double);
+    size_t count, total, tmp_bytes = 0, biggest = 0, s, i;
+    char *map = MAP_FAILED, *buf = NULL, *res;
+    double x1;
+    struct stat st;
+    int fd = -1, tmp = -1, ret = -1;
+
+    if (!d || !dims || !path || tile_sites < d->min_qubits) {
+        errno = EINVAL;
+        return -1;
+    }
+    fd = open(path, O_RDWR);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st)) goto out;
+    if (st.st_size <= 0 || (size_t)st.st_size % rec) {
+        errno = EINVAL;
+        goto out;
+    }
+    count = (size_t)st.st_size / rec;
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) goto out;
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    // x is the first coordinate of every record layout
+    t.x0 = x1 = *(const double *)map;
+    for (i = 1; i < count; i++) {
+        double x = *(const double *)(map + i * rec);
+
+        if (x < t.x0) t.x0 = x;
+        if (x > x1) x1 = x;
+    }
+    t.inv = x1 > t.x0 ? NYMYA_TILE_BINS / (x1 - t.x0) : 0;
+    t.halo = NYMYA_LATTICE_CUTOFF(lattice_code) + 4.0 / FIXED_POINT_SCALE;
+
+    hist = calloc(NYMYA_TILE_BINS, sizeof(*hist));
+    t.bin_slab = malloc(NYMYA_TILE_BINS * sizeof(*t.bin_slab));
+    t.lo = malloc((NYMYA_TILE_BINS + 1) * sizeof(*t.lo));
+    if (!hist || !t.bin_slab || !t.lo) goto out;
+    for (i = 0; i < count; i++) hist[nymya_tile_bin(&t, *(const double *)(map + i * rec))]++;
+
+    // Whole bins per slab until it owns tile_sites; a short last slab joins the one before
+    {
+        uint64_t owned = 0;
+
+        t.lo[0] = -INFINITY;
+        for (i = 0; i < NYMYA_TILE_BINS; i++) {
+            t.bin_slab[i] = (uint32_t)t.nslab;
+            owned += hist[i];
+            if (owned >= tile_sites && i + 1 < NYMYA_TILE_BINS) {
+                t.nslab++;
+                t.lo[t.nslab] = t.x0 + (double)(i + 1) / t.inv;
+                owned = 0;
+            }
+        }
+        if (owned < d->min_qubits && t.nslab > 0) {
+            for (i = 0; i < NYMYA_TILE_BINS; i++)
+                if (t.bin_slab[i] == t.nslab) t.bin_slab[i] = (uint32_t)t.nslab - 1;
+        } else {
+            t.nslab++;
+        }
+        t.lo[t.nslab] = INFINITY;
+    }
+
+    // Tile sizes, then every tile's site indices in file order
+    off = calloc(t.nslab + 1, sizeof(*off));
+    next = malloc(t.nslab * sizeof(*next));
+    if (!off || !next) goto out;
+    {
+        struct nymya_tile_count c = { off + 1 };
+
+        for (i = 0; i < count; i++)
+            nymya_tile_each(&t, *(const double *)(map + i * rec), nymya_tile_count_fn, &c);
+    }
+    for (s = 0; s < t.nslab; s++) {
+        if (off[s + 1] > biggest) biggest = off[s + 1];
+        off[s + 1] += off[s];
+    }
+    total = off[t.nslab];
+
+    // Scratch file: [index lists of all tiles][result qubit of every site]
+    tmp = nymya_tile_tmpfd(path);
+    tmp_bytes = total * sizeof(*idx) + count * qsz;
+    if (tmp < 0 || ftruncate(tmp, (off_t)tmp_bytes)) goto out;
+    idx = mmap(NULL, tmp_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, tmp, 0);
+    if (idx == MAP_FAILED) {
+        idx = NULL;
+        goto out;
+    }
+    res = (char *)(idx + total);
+    {
+        struct nymya_tile_fill f = { next, idx, 0 };
+
+        memcpy(next, off, t.nslab * sizeof(*next));
+        for (f.site = 0; f.site < count; f.site++)
+            nymya_tile_each(&t, *(const double *)(map + f.site * rec), nymya_tile_fill_fn, &f);
+    }
+    madvise(map, (size_t)st.st_size, MADV_NORMAL);
+
+    buf = malloc(biggest * rec);
+    if (!buf) goto out;
+    ret = 0;
+    for (s = 0; s < t.nslab && !ret; s++) {
+        const uint64_t *ti = idx + off[s];
+        size_t n = off[s + 1] - off[s];
+
+        for (i = 0; i < n; i++) memcpy(buf + i * rec, map + ti[i] * rec, rec);
+        ret = nymya_tile_gate(lattice_code, buf, n);
+        if (ret) break;
+
+        // Only the sites this slab owns; the halo belongs to other tiles. Later
+        // tiles still need the sites' old qubits, so the file waits until the end.
+        for (i = 0; i < n; i++) {
+            if (t.bin_slab[nymya_tile_bin(&t, *(const double *)(map + ti[i] * rec))] == s)
+                memcpy(res + ti[i] * qsz, buf + i * rec + dims * sizeof(double), qsz);
+        }
+    }
+    if (!ret) {
+        for (i = 0; i < count; i++) memcpy(map + i * rec + dims * sizeof(double), res + i * qsz, qsz);
+        if (msync(map, (size_t)st.st_size, MS_SYNC)) ret = -1;
+    }
+
+out:
+    free(buf);
+    if (idx) munmap(idx, tmp_bytes);
+    if (tmp >= 0) close(tmp);
+    free(next);
+    free(off);
+    free(t.lo);
+    free(t.bin_slab);
+    free(hist);
+    if (map != MAP_FAILED) munmap(map, (size_t)st.st_size);
+    close(fd);
+    return ret;
+}
+
+#endif // __KERNEL__
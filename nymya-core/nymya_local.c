@@ -0,0 +1,619 @@
+// src/nymya_local.c
+//
+// In-process backend of nymya_call_gate(). Every gate call runs here with
+// the arguments of its numbered syscall, read as the kernel reads them:
+// qubits in the nymya_qubit_k layout, angles and coordinates in Q32.32, and
+// errors returned as -errno. So the wrappers and nymya_callv() work the same
+// on a host without nymya_core.ko, minus the crossings and copies.
+//
+// - Single- to three-qubit gates and the pointer-array lattices (3301-3354)
+//   convert their qubits and call the userland gate functions.
+// - Batches (3362, 3364) are validated whole, then run record by record on
+//   the same functions.
+// - Positional lattices (3355-3360, 3363) find their pairs on a hashed grid
+//   of cells one cutoff wide, as the kernel does, with the same Q32.32
+//   distance test, and run the Hadamards and CNOTs in the kernel's order.
+// - The QRNG (3361) maps getrandom() words into the range without bias.
+//
+// Deutsch (3342) takes an oracle pointer and has no call here either; with a
+// compiled nymya_oracle it arrives as a 3362 batch instead.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+
+#define NYMYA_LOCAL_PTR(a) ((void *)(uintptr_t)(a))
+
+// Q32.32 angle or exponent of a call as the userland gates take it
+#define NYMYA_LOCAL_ANGLE(fp) ((double)(int64_t)(fp) / FIXED_POINT_SCALE)
+
+// Extra Q32.32 units on the cell edge to cover the truncation in nymya_local_square()
+#define NYMYA_LOCAL_SLACK_FP 8
+
+static const uint64_t nymya_local_hash_mul[NYMYA_LATTICE_MAX_DIM] = {
+    0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL,
+    0xD6E8FEB86659FD93ULL, 0xFF51AFD7ED558CCDULL,
+};
+
+static void nymya_local_load(const nymya_qubit_k *k, nymya_qubit *q) {
+    q->id = k->id;
+    memcpy(q->tag, k->tag, NYMYA_TAG_MAXLEN);
+    q->amplitude = (double)k->re / FIXED_POINT_SCALE + (double)k->im / FIXED_POINT_SCALE * I;
+}
+
+static void nymya_local_store(const nymya_qubit *q, nymya_qubit_k *k) {
+    k->re = (int64_t)(creal(q->amplitude) * FIXED_POINT_SCALE);
+    k->im = (int64_t)(cimag(q->amplitude) * FIXED_POINT_SCALE);
+}
+
+typedef int (*nymya_local_op_fn)(const nymya_op *op, nymya_qubit *q);
+typedef int (*nymya_local_array_fn)(nymya_qubit **q, size_t count);
+
+// Userland gate calls on a record's operands, by shape
+#define NYMYA_LOCAL_OP_Q(fn)            fn(&q[op->qubit[0]])
+#define NYMYA_LOCAL_OP_Q_THETA(fn)      fn(&q[op->qubit[0]], NYMYA_LOCAL_ANGLE(op->param))
+#define NYMYA_LOCAL_OP_Q_AXIS_THETA(fn) fn(&q[op->qubit[0]], (char)op->axis, NYMYA_LOCAL_ANGLE(op->param))
+#define NYMYA_LOCAL_OP_Q2(fn)           fn(&q[op->qubit[0]], &q[op->qubit[1]])
+#define NYMYA_LOCAL_OP_Q2_THETA(fn)     fn(&q[op->qubit[0]], &q[op->qubit[1]], NYMYA_LOCAL_ANGLE(op->param))
+#define NYMYA_LOCAL_OP_Q3(fn)           fn(&q[op->qubit[0]], &q[op->qubit[1]], &q[op->qubit[2]])
+
+#define NYMYA_LOCAL_OP(code, call)                                              \
+    static int nymya_local_op_##code(const nymya_op *op, nymya_qubit *q) {      \
+        return call;                                                            \
+    }
+#define NYMYA_LOCAL_ARRAY(code, call)                                           \
+    static int nymya_local_array_##code(nymya_qubit **q, size_t count) {        \
+        return call;                                                            \
+    }
+#define NYMYA_LOCAL_FN_Q(code, fn, n)            NYMYA_LOCAL_OP(code, NYMYA_LOCAL_OP_Q(fn))
+#define NYMYA_LOCAL_FN_Q_THETA(code, fn, n)      NYMYA_LOCAL_OP(code, NYMYA_LOCAL_OP_Q_THETA(fn))
+#define NYMYA_LOCAL_FN_Q_AXIS_THETA(code, fn, n) NYMYA_LOCAL_OP(code, NYMYA_LOCAL_OP_Q_AXIS_THETA(fn))
+#define NYMYA_LOCAL_FN_Q2(code, fn, n)           NYMYA_LOCAL_OP(code, NYMYA_LOCAL_OP_Q2(fn))
+#define NYMYA_LOCAL_FN_Q2_THETA(code, fn, n)     NYMYA_LOCAL_OP(code, NYMYA_LOCAL_OP_Q2_THETA(fn))
+#define NYMYA_LOCAL_FN_Q3(code, fn, n)           NYMYA_LOCAL_OP(code, NYMYA_LOCAL_OP_Q3(fn))
+// A fixed-size lattice gate reads exactly @n qubits, whatever the caller passed
+#define NYMYA_LOCAL_FN_QARR(code, fn, n)         NYMYA_LOCAL_ARRAY(code, count == (n) ? fn(q) : -1)
+#define NYMYA_LOCAL_FN_QLIST(code, fn, n)        NYMYA_LOCAL_ARRAY(code, fn(q, count))
+#define NYMYA_LOCAL_FN_QPOS3(code, fn, n)
+#define NYMYA_LOCAL_FN_QPOS4(code, fn, n)
+#define NYMYA_LOCAL_FN_QPOS5(code, fn, n)
+#define NYMYA_LOCAL_FN_ORACLE(code, fn, n)
+#define NYMYA_LOCAL_FN_QRNG(code, fn, n)
+
+#define NYMYA_LOCAL_DEFINE(code, name, shape, n_min, kcore) \
+    NYMYA_LOCAL_FN_##shape(code, nymya_##code##_##name, n_min)
+NYMYA_GATES(NYMYA_LOCAL_DEFINE)
+#undef NYMYA_LOCAL_DEFINE
+
+/**
+ * nymya_local_fns - Userland entry of one gate code.
+ * @op: Runs a nymya_op record on an array of qubits; NULL without a record form.
+ * @array: Runs a pointer-array lattice gate; NULL for other gates.
+ */
+typedef struct nymya_local_fns {
+    nymya_local_op_fn op;
+    nymya_local_array_fn array;
+} nymya_local_fns;
+
+#define NYMYA_LOCAL_SLOT_OP(code)    [(code) - NYMYA_GATE_FIRST] = { .op = nymya_local_op_##code },
+#define NYMYA_LOCAL_SLOT_ARRAY(code) [(code) - NYMYA_GATE_FIRST] = { .array = nymya_local_array_##code },
+#define NYMYA_LOCAL_SLOT_Q(code)            NYMYA_LOCAL_SLOT_OP(code)
+#define NYMYA_LOCAL_SLOT_Q_THETA(code)      NYMYA_LOCAL_SLOT_OP(code)
+#define NYMYA_LOCAL_SLOT_Q_AXIS_THETA(code) NYMYA_LOCAL_SLOT_OP(code)
+#define NYMYA_LOCAL_SLOT_Q2(code)           NYMYA_LOCAL_SLOT_OP(code)
+#define NYMYA_LOCAL_SLOT_Q2_THETA(code)     NYMYA_LOCAL_SLOT_OP(code)
+#define NYMYA_LOCAL_SLOT_Q3(code)           NYMYA_LOCAL_SLOT_OP(code)
+#define NYMYA_LOCAL_SLOT_QARR(code)         NYMYA_LOCAL_SLOT_ARRAY(code)
+#define NYMYA_LOCAL_SLOT_QLIST(code)        NYMYA_LOCAL_SLOT_ARRAY(code)
+#define NYMYA_LOCAL_SLOT_QPOS3(code)
+#define NYMYA_LOCAL_SLOT_QPOS4(code)
+#define NYMYA_LOCAL_SLOT_QPOS5(code)
+#define NYMYA_LOCAL_SLOT_ORACLE(code)
+#define NYMYA_LOCAL_SLOT_QRNG(code)
+
+#define NYMYA_LOCAL_ENTRY(code, name, shape, n_min, kcore) NYMYA_LOCAL_SLOT_##shape(code)
+// Userland gate functions by code - NYMYA_GATE_FIRST, generated from NYMYA_GATES
+static const nymya_local_fns nymya_local_table[NYMYA_GATE_COUNT] = {
+    NYMYA_GATES(NYMYA_LOCAL_ENTRY)
+};
+#undef NYMYA_LOCAL_ENTRY
+
+/*
+ * One call of a gate with one to three qubit operands: the qubits are its
+ * first arguments, an axis follows for 3330, and the angle comes last.
+ */
+static long nymya_local_gate(const nymya_gate_desc *d, const uint64_t *a) {
+    nymya_op op = { .gate_code = d->code, .qubit = { 0, 1, 2 } };
+    nymya_qubit q[NYMYA_OP_MAX_OPERANDS];
+    nymya_qubit_k *k[NYMYA_OP_MAX_OPERANDS];
+    unsigned int i;
+
+    for (i = 0; i < d->operands; i++) {
+        k[i] = NYMYA_LOCAL_PTR(a[i]);
+        if (!k[i]) return -EINVAL;
+        nymya_local_load(k[i], &q[i]);
+    }
+    if (d->shape == NYMYA_SHAPE_Q_AXIS_THETA) op.axis = (uint32_t)a[1];
+    if (d->nargs > d->operands) op.param = (int64_t)a[d->nargs - 1];
+
+    if (nymya_local_table[d->code - NYMYA_GATE_FIRST].op(&op, q)) return -EINVAL;
+    for (i = 0; i < d->operands; i++) nymya_local_store(&q[i], k[i]);
+    return 0;
+}
+
+/*
+ * Runs a pointer-array lattice gate on @count qubits: @kp[i] when @kp is
+ * set (the syscall form), &@kq[i] otherwise (3365).
+ */
+static long nymya_local_array(const nymya_gate_desc *d, nymya_qubit_k *const *kp,
+                              nymya_qubit_k *kq, size_t count) {
+    nymya_qubit *q;
+    nymya_qubit **p;
+    long ret = 0;
+    size_t i;
+
+    if ((!kp && !kq) || count < d->min_qubits || count >= UINT32_MAX ||
+        (d->shape == NYMYA_SHAPE_QARR && count != d->min_qubits))
+        return -EINVAL;
+
+    // One buffer: [qubits][pointers into them, in order]
+    q = malloc(count * (sizeof(*q) + sizeof(*p)));
+    if (!q) return -ENOMEM;
+    p = (nymya_qubit **)(q + count);
+
+    for (i = 0; i < count && !ret; i++) {
+        const nymya_qubit_k *k = kp ? kp[i] : &kq[i];
+
+        if (!k) ret = -EINVAL;
+        else nymya_local_load(k, &q[i]);
+        p[i] = &q[i];
+    }
+    if (!ret && nymya_local_table[d->code - NYMYA_GATE_FIRST].array(p, count)) ret = -EINVAL;
+    if (!ret)
+        for (i = 0; i < count; i++) nymya_local_store(&q[i], kp ? kp[i] : &kq[i]);
+
+    free(q);
+    return ret;
+}
+
+// Same checks as nymya_submit_check_op() in the kernel
+static int nymya_local_check_op(const nymya_op *op, size_t qubit_count) {
+    const nymya_gate_desc *d = nymya_gate_lookup(op->gate_code);
+    unsigned int arity = d ? d->operands : 0;
+    unsigned int i, j;
+
+    if (!arity || op->reserved) return -EINVAL;
+    for (i = 0; i < arity; i++) {
+        if (op->qubit[i] >= qubit_count) return -EINVAL;
+        for (j = 0; j < i; j++)
+            if (op->qubit[i] == op->qubit[j]) return -EINVAL;
+    }
+    if (op->gate_code == NYMYA_ROTATE_CODE) {
+        switch (op->axis) {
+        case 'X': case 'x':
+        case 'Y': case 'y':
+        case 'Z': case 'z':
+            break;
+        default:
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+/*
+ * 3362 and 3364: validates every record, runs them in order, and writes
+ * the amplitudes back only if all succeed. Compact qubits get the tag
+ * "#<handle>" the kernel gives them.
+ */
+static long nymya_local_submit(const uint64_t *a, int compact) {
+    const nymya_op *ops = NYMYA_LOCAL_PTR(a[0]);
+    size_t op_count = (size_t)a[1], qubit_count = (size_t)a[3], i;
+    nymya_qubit_ck *ck = compact ? NYMYA_LOCAL_PTR(a[2]) : NULL;
+    nymya_qubit_k *kq = compact ? NULL : NYMYA_LOCAL_PTR(a[2]);
+    nymya_qubit *q;
+    long ret = 0;
+
+    if (!ops || (!ck && !kq) || op_count == 0 || qubit_count == 0 ||
+        op_count > NYMYA_SUBMIT_MAX_OPS || qubit_count > NYMYA_SUBMIT_MAX_QUBITS)
+        return -EINVAL;
+    for (i = 0; i < op_count; i++)
+        if (nymya_local_check_op(&ops[i], qubit_count)) return -EINVAL;
+
+    q = malloc(qubit_count * sizeof(*q));
+    if (!q) return -ENOMEM;
+
+    for (i = 0; i < qubit_count && !ret; i++) {
+        if (!compact) {
+            nymya_local_load(&kq[i], &q[i]);
+            continue;
+        }
+        if (ck[i].flags) {
+            ret = -EINVAL;
+            break;
+        }
+        q[i].id = ck[i].id;
+        memset(q[i].tag, 0, sizeof(q[i].tag));
+        if (ck[i].tag != NYMYA_TAG_NONE)
+            snprintf(q[i].tag, sizeof(q[i].tag), "#%u", ck[i].tag);
+        q[i].amplitude = (double)ck[i].re / FIXED_POINT_SCALE + (double)ck[i].im / FIXED_POINT_SCALE * I;
+    }
+
+    for (i = 0; i < op_count && !ret; i++)
+        if (nymya_local_table[ops[i].gate_code - NYMYA_GATE_FIRST].op(&ops[i], q)) ret = -EINVAL;
+
+    for (i = 0; i < qubit_count && !ret; i++) {
+        if (!compact) {
+            nymya_local_store(&q[i], &kq[i]);
+            continue;
+        }
+        ck[i].re = (int64_t)(creal(q[i].amplitude) * FIXED_POINT_SCALE);
+        ck[i].im = (int64_t)(cimag(q[i].amplitude) * FIXED_POINT_SCALE);
+    }
+
+    free(q);
+    return ret;
+}
+
+// Q32.32 square with the truncation of the kernel's fixed_point_square()
+static inline int64_t nymya_local_square(int64_t v) {
+    return (int64_t)(((__int128)v * v) >> 32);
+}
+
+// Nearest periodic image of the separation @d on an axis with box edge @box (0 = open)
+static inline int64_t nymya_local_image(int64_t d, int64_t box) {
+    int64_t half = box / 2;
+
+    if (!box || (d >= -half && d <= half)) return d;
+    d %= box;
+    if (d > half) d -= box;
+    else if (d < -half) d += box;
+    return d;
+}
+
+/**
+ * nymya_local_sites - Positional lattice sites in the layout a call passes them.
+ * @dims: Coordinates per site.
+ * @qubits: Qubit of the first site, in the nymya_qubit_k layout.
+ * @qstride: Bytes from one site's qubit to the next.
+ * @coord: First site's coordinate on each axis, Q32.32 or, for an exact
+ *         run, plain integers.
+ * @cstride: Bytes from one site's coordinate to the next.
+ * @box: Periodic box edge of each axis in Q32.32; 0 for an open axis.
+ * @count: Number of sites.
+ */
+typedef struct nymya_local_sites {
+    unsigned int dims;
+    char *qubits;
+    size_t qstride;
+    const char *coord[NYMYA_LATTICE_MAX_DIM];
+    size_t cstride;
+    int64_t box[NYMYA_LATTICE_MAX_DIM];
+    size_t count;
+} nymya_local_sites;
+
+#define NYMYA_LOCAL_COORD(s, k, i) (*(const int64_t *)((s)->coord[k] + (i) * (s)->cstride))
+#define NYMYA_LOCAL_QUBIT(s, i)    ((nymya_qubit_k *)((s)->qubits + (i) * (s)->qstride))
+
+static inline uint32_t nymya_local_hash(const uint64_t *c, unsigned int dims, uint32_t mask) {
+    uint64_t h = 0;
+
+    for (unsigned int k = 0; k < dims; k++) h ^= c[k] * nymya_local_hash_mul[k];
+    return (uint32_t)(h >> 32) & mask;
+}
+
+static int nymya_local_cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * nymya_local_lattice - Hadamard on every site, then CNOT on every neighbour pair.
+ * @s: Sites.
+ * @cell: Cell edge, at least the cutoff: cutoff plus slack in Q32.32, or 1
+ *        for integer coordinates.
+ * @eps2: Largest squared distance of a pair, in the coordinates' units.
+ * @exact: Integer coordinates: squares are plain products and @s has no box.
+ *
+ * Bins every site into a cell of @cell per axis (periodic axes are cut into
+ * whole cells of at least @cell across the box), chains the cells in a hash
+ * table in ascending site order, and for each site in turn collects the
+ * higher-indexed sites of the 3^dims cells around it that pass the distance
+ * test. The CNOTs then run in the kernel's order, i ascending, then j
+ * ascending.
+ *
+ * Returns 0, -EINVAL on a bad box or count, -ENOMEM, or -EINVAL from a gate.
+ */
+static long nymya_local_lattice(const nymya_local_sites *s, int64_t cell, int64_t eps2, int exact) {
+    unsigned int dims = s->dims, ncells = 1, k;
+    size_t count = s->count, buckets = 1, nbr_cap = 64, i;
+    int64_t cell_w[NYMYA_LATTICE_MAX_DIM];
+    uint64_t ncell[NYMYA_LATTICE_MAX_DIM];
+    uint64_t *cells = NULL;
+    uint32_t *next = NULL, *head = NULL, *nbr = NULL;
+    nymya_qubit *q = NULL;
+    long ret = 0;
+
+    if (count == 0 || count >= UINT32_MAX) return -EINVAL;
+    for (k = 0; k < dims; k++) {
+        if (s->box[k] < 0 || (s->box[k] && s->box[k] / 2 < cell - NYMYA_LOCAL_SLACK_FP)) return -EINVAL;
+        // The last periodic cell takes the remainder of the box
+        ncell[k] = s->box[k] ? (uint64_t)(s->box[k] / cell > 0 ? s->box[k] / cell : 1) : 0;
+        cell_w[k] = s->box[k] ? s->box[k] / (int64_t)ncell[k] : cell;
+        ncells *= 3;
+    }
+    while (buckets < 2 * count) buckets <<= 1;
+
+    cells = malloc(count * dims * sizeof(*cells));
+    next = malloc(count * sizeof(*next));
+    head = malloc(buckets * sizeof(*head));
+    nbr = malloc(nbr_cap * sizeof(*nbr));
+    q = malloc(count * sizeof(*q));
+    if (!cells || !next || !head || !nbr || !q) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    for (k = 0; k < dims; k++) {
+        int64_t lo = NYMYA_LOCAL_COORD(s, k, 0);
+
+        if (ncell[k]) {
+            for (i = 0; i < count; i++) {
+                int64_t r = NYMYA_LOCAL_COORD(s, k, i) % s->box[k];
+                uint64_t c;
+
+                if (r < 0) r += s->box[k];
+                c = (uint64_t)(r / cell_w[k]);
+                cells[dims * i + k] = c < ncell[k] ? c : ncell[k] - 1;
+            }
+            continue;
+        }
+        for (i = 1; i < count; i++)
+            if (NYMYA_LOCAL_COORD(s, k, i) < lo) lo = NYMYA_LOCAL_COORD(s, k, i);
+        for (i = 0; i < count; i++)
+            cells[dims * i + k] = ((uint64_t)NYMYA_LOCAL_COORD(s, k, i) - (uint64_t)lo) / (uint64_t)cell;
+    }
+    memset(head, 0xff, buckets * sizeof(*head));
+    // Insert in descending order so each chain is in ascending site order
+    for (i = count; i-- > 0; ) {
+        uint32_t b = nymya_local_hash(&cells[dims * i], dims, (uint32_t)(buckets - 1));
+
+        next[i] = head[b];
+        head[b] = (uint32_t)i;
+    }
+
+    for (i = 0; i < count; i++) nymya_local_load(NYMYA_LOCAL_QUBIT(s, i), &q[i]);
+    if (nymya_3308_hadamard_gate_n(q, count)) ret = -EINVAL;
+
+    for (i = 0; i < count && !ret; i++) {
+        const uint64_t *ci = &cells[dims * i];
+        size_t n = 0, m;
+
+        for (unsigned int o = 0; o < ncells; o++) {
+            uint64_t cc[NYMYA_LATTICE_MAX_DIM];
+            unsigned int t = o;
+            int repeat = 0;
+
+            // o as dims base-3 digits, each a step of -1, 0 or +1; a step that
+            // wraps onto a cell already visited (boxes one or two cells across) is skipped
+            for (k = 0; k < dims; k++, t /= 3) {
+                int step = (int)(t % 3) - 1;
+
+                cc[k] = ci[k] + step;
+                if (!ncell[k]) continue;
+                if ((ncell[k] == 1 && step) || (ncell[k] == 2 && step > 0)) repeat = 1;
+                else if (ci[k] == 0 && step < 0) cc[k] = ncell[k] - 1;
+                else if (cc[k] == ncell[k]) cc[k] = 0;
+            }
+            if (repeat) continue;
+
+            for (uint32_t j = head[nymya_local_hash(cc, dims, (uint32_t)(buckets - 1))];
+                 j != UINT32_MAX; j = next[j]) {
+                int64_t d2 = 0;
+
+                if (j <= i || memcmp(&cells[dims * j], cc, dims * sizeof(*cc))) continue;
+                for (k = 0; k < dims; k++) {
+                    int64_t d = nymya_local_image(NYMYA_LOCAL_COORD(s, k, i) - NYMYA_LOCAL_COORD(s, k, j),
+                                                  s->box[k]);
+
+                    d2 += exact ? d * d : nymya_local_square(d);
+                }
+                if (d2 > eps2) continue;
+                if (n == nbr_cap) {
+                    uint32_t *grown = realloc(nbr, 2 * nbr_cap * sizeof(*nbr));
+
+                    if (!grown) {
+                        ret = -ENOMEM;
+                        goto out;
+                    }
+                    nbr = grown;
+                    nbr_cap *= 2;
+                }
+                nbr[n++] = j;
+            }
+        }
+
+        // Cells are visited out of site order; restore the pairwise-scan order
+        qsort(nbr, n, sizeof(*nbr), nymya_local_cmp_u32);
+        for (m = 0; m < n && !ret; m++)
+            if (nymya_3309_controlled_not(&q[i], &q[nbr[m]])) ret = -EINVAL;
+    }
+
+    if (!ret)
+        for (i = 0; i < count; i++) nymya_local_store(&q[i], NYMYA_LOCAL_QUBIT(s, i));
+
+out:
+    free(q);
+    free(nbr);
+    free(head);
+    free(next);
+    free(cells);
+    return ret;
+}
+
+// Cutoff of a positional gate in Q32.32, as its kernel core has it
+static int64_t nymya_local_cutoff(unsigned int code) {
+    return (int64_t)(NYMYA_LATTICE_CUTOFF(code) * FIXED_POINT_SCALE);
+}
+
+// 3355-3360: an array of nymya_qpos*d_k records, the coordinates after the qubit
+static long nymya_local_qpos(const nymya_gate_desc *d, const uint64_t *a) {
+    unsigned int dims = NYMYA_LATTICE_DIMS(d->code);
+    size_t rec = dims == 3 ? sizeof(nymya_qpos3d_k) : dims == 4 ? sizeof(nymya_qpos4d_k) : sizeof(nymya_qpos5d_k);
+    nymya_local_sites s = { .dims = dims, .qubits = NYMYA_LOCAL_PTR(a[0]), .qstride = rec,
+                            .cstride = rec, .count = (size_t)a[1] };
+    int64_t cutoff = nymya_local_cutoff(d->code);
+
+    if (!s.qubits || s.count < d->min_qubits) return -EINVAL;
+    for (unsigned int k = 0; k < dims; k++)
+        s.coord[k] = s.qubits + sizeof(nymya_qubit_k) + k * sizeof(int64_t);
+    return nymya_local_lattice(&s, cutoff + NYMYA_LOCAL_SLACK_FP, nymya_local_square(cutoff), 0);
+}
+
+/*
+ * 3363: a nymya_qubit_k array and one coordinate array per axis, with the
+ * box edges after them under NYMYA_LATTICE_PERIODIC. Integer coordinates
+ * (D4 and B5 only) pair at the squared length of the lattice's shortest
+ * roots, 2 for D4 and 1 for B5, and at 0; that is exactly the root offsets
+ * the kernel probes.
+ */
+static long nymya_local_soa(const uint64_t *a) {
+    unsigned int lattice_code = (unsigned int)a[0];
+    int periodic = !!(lattice_code & NYMYA_LATTICE_PERIODIC);
+    int integer = !!(lattice_code & NYMYA_LATTICE_INTEGER);
+    unsigned int code = lattice_code & ~(NYMYA_LATTICE_PERIODIC | NYMYA_LATTICE_INTEGER);
+    const nymya_gate_desc *d = nymya_gate_lookup(code);
+    const uint64_t *axes = NYMYA_LOCAL_PTR(a[2]);
+    nymya_local_sites s = { .dims = NYMYA_LATTICE_DIMS(code), .qubits = NYMYA_LOCAL_PTR(a[1]),
+                            .qstride = sizeof(nymya_qubit_k), .cstride = sizeof(int64_t),
+                            .count = (size_t)a[3] };
+    int64_t cutoff = nymya_local_cutoff(code);
+    unsigned int k;
+
+    if (!d || !s.dims || (integer && code != NYMYA_D4_LATTICE_CODE && code != NYMYA_B5_LATTICE_CODE) ||
+        (integer && periodic) || !s.qubits || !axes || s.count < d->min_qubits)
+        return -EINVAL;
+    for (k = 0; k < s.dims; k++) {
+        s.coord[k] = NYMYA_LOCAL_PTR(axes[k]);
+        if (!s.coord[k]) return -EINVAL;
+    }
+    if (periodic) {
+        if (!axes[s.dims]) return -EINVAL;
+        memcpy(s.box, NYMYA_LOCAL_PTR(axes[s.dims]), s.dims * sizeof(*s.box));
+    }
+    if (!integer)
+        return nymya_local_lattice(&s, cutoff + NYMYA_LOCAL_SLACK_FP, nymya_local_square(cutoff), 0);
+
+    // D4 points have an even coordinate sum
+    if (code == NYMYA_D4_LATTICE_CODE) {
+        for (size_t i = 0; i < s.count; i++) {
+            uint64_t sum = 0;
+
+            for (k = 0; k < s.dims; k++) sum += (uint64_t)NYMYA_LOCAL_COORD(&s, k, i);
+            if (sum & 1) return -EINVAL;
+        }
+    }
+    return nymya_local_lattice(&s, 1, code == NYMYA_D4_LATTICE_CODE ? 2 : 1, 1);
+}
+
+// 3361: @count uniform values in [min, max] from getrandom(), mapped as nymya_qrng_fill() does
+static long nymya_local_qrng(const uint64_t *a) {
+    uint64_t *out = NYMYA_LOCAL_PTR(a[0]);
+    uint64_t min = a[1], max = a[2], range = max - min + 1;
+    size_t count = (size_t)a[3], left = count * sizeof(*out);
+    char *p = (char *)out;
+
+    if (!out || min >= max || count == 0) return -EINVAL;
+
+    while (left) {
+        ssize_t n = getrandom(p, left, 0);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    if (!range) return 0;
+
+    // Lemire's multiply-shift; redraw the rare words in the biased band
+    for (size_t i = 0; i < count; i++) {
+        unsigned __int128 m = (unsigned __int128)out[i] * range;
+
+        if ((uint64_t)m < range) {
+            uint64_t floor = -range % range;
+
+            while ((uint64_t)m < floor) {
+                uint64_t x;
+
+                if (getrandom(&x, sizeof(x), 0) != (ssize_t)sizeof(x)) continue;
+                m = (unsigned __int128)x * range;
+            }
+        }
+        out[i] = min + (uint64_t)(m >> 64);
+    }
+    return 0;
+}
+
+/**
+ * nymya_local_call - Runs a gate call by code in this process.
+ * @code: Gate code, NYMYA_*_CODE (3301-3365).
+ * @args: The syscall's arguments, as nymya_call_gate() takes them.
+ * @nargs: Number of arguments; must match the gate's syscall.
+ *
+ * The arguments mean what they mean to the syscall, so a call behaves
+ * like one the kernel ran: qubits and their arrays are updated in place,
+ * and nothing is written back when the call fails. The module's
+ * lattice_max_sites limit does not apply.
+ *
+ * Returns 0, -ENOSYS for a code without a call, -EINVAL on bad arguments
+ * or a failing gate, or -ENOMEM.
+ */
+long nymya_local_call(uint32_t code, const uint64_t *args, uint32_t nargs) {
+    const nymya_gate_desc *d;
+
+    if (!args && nargs) return -EINVAL;
+
+    switch (code) {
+    case NYMYA_SUBMIT_CODE:
+    case NYMYA_SUBMIT_COMPACT_CODE:
+        return nargs == 4 ? nymya_local_submit(args, code == NYMYA_SUBMIT_COMPACT_CODE) : -EINVAL;
+    case NYMYA_LATTICE_SOA_CODE:
+        return nargs == 4 ? nymya_local_soa(args) : -EINVAL;
+    case NYMYA_LATTICE_ARRAY_CODE:
+        if (nargs != 3) return -EINVAL;
+        d = nymya_gate_lookup((uint32_t)args[0]);
+        if (!d || (d->shape != NYMYA_SHAPE_QARR && d->shape != NYMYA_SHAPE_QLIST)) return -EINVAL;
+        return nymya_local_array(d, NULL, NYMYA_LOCAL_PTR(args[1]), (size_t)args[2]);
+    }
+
+    d = nymya_gate_lookup(code);
+    if (!d || !d->nargs) return -ENOSYS;
+    if (nargs != d->nargs) return -EINVAL;
+
+    switch (d->shape) {
+    case NYMYA_SHAPE_QARR:
+        return nymya_local_array(d, NYMYA_LOCAL_PTR(args[0]), NULL, d->min_qubits);
+    case NYMYA_SHAPE_QLIST:
+        return nymya_local_array(d, NYMYA_LOCAL_PTR(args[0]), NULL, (size_t)args[1]);
+    case NYMYA_SHAPE_QPOS3:
+    case NYMYA_SHAPE_QPOS4:
+    case NYMYA_SHAPE_QPOS5:
+        return nymya_local_qpos(d, args);
+    case NYMYA_SHAPE_QRNG:
+        return nymya_local_qrng(args);
+    default:
+        return nymya_local_gate(d, args);
+    }
+}
+
+#endif // __KERNEL__
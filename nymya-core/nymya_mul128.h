@@ -0,0 +1,235 @@
+// src/nymya_mul128.h
+//
+// 64x64->128-bit products for the Q32.32 primitives: fixed_point_mul(),
+// the complex multiplies, the unitary rows, the trig range reduction and
+// the |amplitude|^2 tests of the controlled gates. The implementation is
+// picked at build time from the target the module or library is compiled
+// for (kernel_syscalls/<arch> each get their own):
+//
+//   arm64    mul for the low half, smulh/umulh for the high half
+//   riscv64  mul for the low half, mulh/mulhu for the high half
+//   amd64    __int128, which gcc and clang already lower to the one-operand
+//            imul/mul; the same instructions as inline asm pin rax/rdx and
+//            measured 10-50% slower in "make fixed-bench", so they are only
+//            used with NYMYA_MUL128_ASM defined
+//   other    __int128 where the compiler has it, else four 32x32->64
+//            partial products, so 32-bit builds need no 128-bit type
+//
+// Every path gives the same bits. Defining NYMYA_MUL128_GENERIC (e.g.
+// "make kernel MUL128=generic") forces the __int128 form on 64-bit targets.
+// "make fixed-bench" times the selected path ("mulh") against the __int128
+// and split forms on the build machine.
+
+#ifndef NYMYA_MUL128_H
+#define NYMYA_MUL128_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#if defined(NYMYA_MUL128_GENERIC) && defined(__SIZEOF_INT128__)
+#define NYMYA_MUL128_INT128
+#define NYMYA_MUL128_IMPL "int128"
+#elif defined(__x86_64__) && defined(NYMYA_MUL128_ASM)
+#define NYMYA_MUL128_AMD64
+#define NYMYA_MUL128_IMPL "amd64 imul"
+#elif defined(__aarch64__)
+#define NYMYA_MUL128_ARM64
+#define NYMYA_MUL128_IMPL "arm64 smulh"
+#elif defined(__riscv) && __riscv_xlen == 64
+#define NYMYA_MUL128_RISCV64
+#define NYMYA_MUL128_IMPL "riscv64 mulh"
+#elif defined(__SIZEOF_INT128__)
+#define NYMYA_MUL128_INT128
+#define NYMYA_MUL128_IMPL "int128"
+#else
+#define NYMYA_MUL128_SPLIT
+#define NYMYA_MUL128_IMPL "split64"
+#endif
+
+/**
+ * nymya_s128 - Signed 128-bit value as two halves.
+ * @lo: Bits 0..63.
+ * @hi: Bits 64..127, two's complement.
+ */
+typedef struct nymya_s128 {
+    uint64_t lo;
+    int64_t hi;
+} nymya_s128;
+
+/**
+ * nymya_u128 - Unsigned 128-bit value as two halves.
+ * @lo: Bits 0..63.
+ * @hi: Bits 64..127.
+ */
+typedef struct nymya_u128 {
+    uint64_t lo;
+    uint64_t hi;
+} nymya_u128;
+
+// Unsigned product from 32x32->64 multiplies; the SPLIT path and its check
+static inline nymya_u128 nymya_umul128_split(uint64_t a, uint64_t b)
+{
+    uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFu) + (hl & 0xFFFFFFFFu);
+    nymya_u128 r;
+
+    r.lo = (mid << 32) | (ll & 0xFFFFFFFFu);
+    r.hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return r;
+}
+
+// a * b of unsigned 64-bit operands
+static inline nymya_u128 nymya_umul128(uint64_t a, uint64_t b)
+{
+    nymya_u128 r;
+
+#if defined(NYMYA_MUL128_AMD64)
+    __asm__("mulq %3" : "=a"(r.lo), "=d"(r.hi) : "%0"(a), "rm"(b) : "cc");
+#elif defined(NYMYA_MUL128_ARM64)
+    r.lo = a * b;
+    __asm__("umulh %0, %1, %2" : "=r"(r.hi) : "r"(a), "r"(b));
+#elif defined(NYMYA_MUL128_RISCV64)
+    r.lo = a * b;
+    __asm__("mulhu %0, %1, %2" : "=r"(r.hi) : "r"(a), "r"(b));
+#elif defined(NYMYA_MUL128_INT128)
+    unsigned __int128 p = (unsigned __int128)a * b;
+
+    r.lo = (uint64_t)p;
+    r.hi = (uint64_t)(p >> 64);
+#else
+    r = nymya_umul128_split(a, b);
+#endif
+    return r;
+}
+
+// a * b of signed 64-bit operands
+static inline nymya_s128 nymya_smul128(int64_t a, int64_t b)
+{
+    nymya_s128 r;
+
+#if defined(NYMYA_MUL128_AMD64)
+    __asm__("imulq %3" : "=a"(r.lo), "=d"(r.hi) : "%0"(a), "rm"(b) : "cc");
+#elif defined(NYMYA_MUL128_ARM64)
+    r.lo = (uint64_t)a * (uint64_t)b;
+    __asm__("smulh %0, %1, %2" : "=r"(r.hi) : "r"(a), "r"(b));
+#elif defined(NYMYA_MUL128_RISCV64)
+    r.lo = (uint64_t)a * (uint64_t)b;
+    __asm__("mulh %0, %1, %2" : "=r"(r.hi) : "r"(a), "r"(b));
+#elif defined(NYMYA_MUL128_INT128)
+    __int128 p = (__int128)a * b;
+
+    r.lo = (uint64_t)p;
+    r.hi = (int64_t)(p >> 64);
+#else
+    // The unsigned product of the bit patterns, less b << 64 for a < 0 and vice versa
+    nymya_u128 u = nymya_umul128_split((uint64_t)a, (uint64_t)b);
+
+    if (a < 0) u.hi -= (uint64_t)b;
+    if (b < 0) u.hi -= (uint64_t)a;
+    r.lo = u.lo;
+    r.hi = (int64_t)u.hi;
+#endif
+    return r;
+}
+
+#ifdef __SIZEOF_INT128__
+// Sums through the compiler's 128-bit type, which it turns into add/adc
+static inline __int128 nymya_s128_join(nymya_s128 x)
+{
+    return (__int128)(((unsigned __int128)(uint64_t)x.hi << 64) | x.lo);
+}
+
+static inline nymya_s128 nymya_s128_part(__int128 v)
+{
+    nymya_s128 r;
+
+    r.lo = (uint64_t)v;
+    r.hi = (int64_t)(v >> 64);
+    return r;
+}
+
+static inline nymya_s128 nymya_s128_add(nymya_s128 x, nymya_s128 y)
+{
+    return nymya_s128_part(nymya_s128_join(x) + nymya_s128_join(y));
+}
+
+static inline nymya_s128 nymya_s128_sub(nymya_s128 x, nymya_s128 y)
+{
+    return nymya_s128_part(nymya_s128_join(x) - nymya_s128_join(y));
+}
+#else
+static inline nymya_s128 nymya_s128_add(nymya_s128 x, nymya_s128 y)
+{
+    nymya_s128 r;
+
+    r.lo = x.lo + y.lo;
+    r.hi = (int64_t)((uint64_t)x.hi + (uint64_t)y.hi + (r.lo < x.lo));
+    return r;
+}
+
+static inline nymya_s128 nymya_s128_sub(nymya_s128 x, nymya_s128 y)
+{
+    nymya_s128 r;
+
+    r.lo = x.lo - y.lo;
+    r.hi = (int64_t)((uint64_t)x.hi - (uint64_t)y.hi - (x.lo < y.lo));
+    return r;
+}
+#endif
+
+// Bits @n..@n+63 of @x, 0 < @n < 128, as (int64_t)(x >> n) would give them
+static inline int64_t nymya_s128_shr(nymya_s128 x, unsigned int n)
+{
+#ifdef __SIZEOF_INT128__
+    return (int64_t)(nymya_s128_join(x) >> n);
+#else
+    if (n >= 64) return x.hi >> (n - 64);
+    return (int64_t)(((uint64_t)x.hi << (64 - n)) | (x.lo >> n));
+#endif
+}
+
+// (a * b) >> @n at full precision, 0 < @n < 128
+static inline int64_t nymya_mul_shr(int64_t a, int64_t b, unsigned int n)
+{
+#if defined(NYMYA_MUL128_INT128)
+    return (int64_t)(((__int128)a * b) >> n);
+#else
+    return nymya_s128_shr(nymya_smul128(a, b), n);
+#endif
+}
+
+// Q32.32 product, truncated toward minus infinity as fixed_point_mul() is
+static inline int64_t nymya_fixed_mul(int64_t a, int64_t b)
+{
+    return nymya_mul_shr(a, b, 32);
+}
+
+// Bits @n..@n+63 of @x, 0 < @n < 64
+static inline uint64_t nymya_u128_shr(nymya_u128 x, unsigned int n)
+{
+    return (x.hi << (64 - n)) | (x.lo >> n);
+}
+
+/*
+ * Sign of re^2 + im^2 - (1/2)^2 for a Q32.32 amplitude, compared at full
+ * width: the control test of the CNOT family, which must not lose the low
+ * bits of the squares.
+ */
+static inline int nymya_mag2_cmp_quarter(int64_t re, int64_t im)
+{
+    uint64_t ar = re < 0 ? -(uint64_t)re : (uint64_t)re;
+    uint64_t ai = im < 0 ? -(uint64_t)im : (uint64_t)im;
+    nymya_u128 r2 = nymya_umul128(ar, ar), i2 = nymya_umul128(ai, ai);
+    uint64_t lo = r2.lo + i2.lo;
+    uint64_t hi = r2.hi + i2.hi + (lo < r2.lo);  // both squares are at most 2^126
+
+    if (hi) return 1;
+    return (lo > (uint64_t)1 << 62) - (lo < (uint64_t)1 << 62);
+}
+
+#endif // NYMYA_MUL128_H
@@ -0,0 +1,226 @@
+// src/nymya_numa.c
+//
+// NUMA topology and placement for the userland worker pool. The nodes and
+// their CPUs come from sysfs and the pages are placed with the mbind system
+// call, so there is no libnuma dependency. NYMYA_NUMA picks the policy:
+//
+//   off        workers float, pages land wherever they are first touched
+//   spread     workers spread over the nodes in contiguous blocks, and each
+//              block's share of a buffer is placed on its node (default on
+//              machines with more than one node)
+//   compact    workers fill one node's CPUs before using the next
+//   interleave workers spread as for "spread", buffer pages interleaved
+//              over all nodes
+//
+// Single-node machines default to "off"; pinning buys little there.
+
+#define _GNU_SOURCE // sched_getaffinity(), CPU_SET()
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+/**
+ * nymya_numa_topo - Usable CPUs of the process, grouped by node.
+ * @policy: NYMYA_NUMA_* policy in force.
+ * @nnodes: Number of nodes with at least one usable CPU.
+ * @node: Node id of each of those nodes, ascending.
+ * @first: Index into @cpu of each node's first CPU; @first[@nnodes] is @ncpus.
+ * @cpu: Usable CPUs, node by node.
+ * @ncpus: Number of usable CPUs.
+ */
+typedef struct nymya_numa_topo {
+    int policy;
+    unsigned int nnodes;
+    int node[NYMYA_NUMA_MAX_NODES];
+    unsigned int first[NYMYA_NUMA_MAX_NODES + 1];
+    int cpu[CPU_SETSIZE];
+    unsigned int ncpus;
+} nymya_numa_topo;
+
+static nymya_numa_topo nymya_numa;
+static pthread_once_t nymya_numa_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Reads a sysfs CPU list such as "0-3,8-11" into @set, keeping only CPUs
+ * already in @allowed. Returns the number of CPUs kept, or -1 if the file
+ * does not exist.
+ */
+static int nymya_numa_cpulist(const char *path, const cpu_set_t *allowed, cpu_set_t *set) {
+    FILE *f = fopen(path, "r");
+    char line[4096], *p, *end;
+    int kept = 0;
+
+    if (!f) return -1;
+    CPU_ZERO(set);
+    if (!fgets(line, sizeof(line), f)) line[0] = '\0';
+    fclose(f);
+
+    for (p = line; *p && *p != '\n';) {
+        long lo = strtol(p, &end, 10), hi = lo, c;
+
+        if (end == p) break;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+        }
+        for (c = lo; c <= hi && c < CPU_SETSIZE; c++) {
+            if (c >= 0 && CPU_ISSET(c, allowed)) {
+                CPU_SET(c, set);
+                kept++;
+            }
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return kept;
+}
+
+static void nymya_numa_init(void) {
+    nymya_numa_topo *t = &nymya_numa;
+    const char *env = getenv("NYMYA_NUMA");
+    cpu_set_t allowed, set;
+    char path[64];
+    int n, c;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+
+    // Node ids can have holes, so every possible id is tried
+    for (n = 0; n < NYMYA_NUMA_MAX_NODES; n++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+        if (nymya_numa_cpulist(path, &allowed, &set) <= 0) continue;
+
+        t->node[t->nnodes] = n;
+        t->first[t->nnodes] = t->ncpus;
+        for (c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &set)) t->cpu[t->ncpus++] = c;
+        }
+        t->nnodes++;
+    }
+    t->first[t->nnodes] = t->ncpus;
+    if (!t->nnodes) return;
+
+    t->policy = t->nnodes > 1 ? NYMYA_NUMA_SPREAD : NYMYA_NUMA_OFF;
+    if (!env || !*env) return;
+    if (strcmp(env, "off") == 0) t->policy = NYMYA_NUMA_OFF;
+    else if (strcmp(env, "spread") == 0) t->policy = NYMYA_NUMA_SPREAD;
+    else if (strcmp(env, "compact") == 0) t->policy = NYMYA_NUMA_COMPACT;
+    else if (strcmp(env, "interleave") == 0) t->policy = NYMYA_NUMA_INTERLEAVE;
+}
+
+/**
+ * nymya_numa_policy - NYMYA_NUMA_* policy the worker pool follows.
+ *
+ * Read once from the NYMYA_NUMA environment variable ("off", "spread",
+ * "compact" or "interleave"); unknown values keep the default, which is
+ * NYMYA_NUMA_SPREAD with more than one node and NYMYA_NUMA_OFF otherwise.
+ * Without readable sysfs node directories the policy is always off.
+ */
+int nymya_numa_policy(void) {
+    pthread_once(&nymya_numa_once, nymya_numa_init);
+    return nymya_numa.policy;
+}
+
+/**
+ * nymya_numa_nodes - Number of NUMA nodes with CPUs this process may run on.
+ *
+ * Returns at least 1 whenever sysfs lists the nodes, 0 if it does not.
+ */
+unsigned int nymya_numa_nodes(void) {
+    pthread_once(&nymya_numa_once, nymya_numa_init);
+    return nymya_numa.nnodes;
+}
+
+/**
+ * nymya_numa_cpus - CPU and node of each worker under the current policy.
+ * @want: Number of workers.
+ * @cpu: Filled with the CPU worker i is pinned to.
+ * @node: Filled with the node of @cpu[i].
+ *
+ * Workers come out grouped by node, node after node, so contiguous ranges
+ * of a job given to consecutive workers are contiguous per node. Under
+ * NYMYA_NUMA_COMPACT they fill each node's CPUs in turn; otherwise each
+ * node gets a share of the workers proportional to its usable CPUs. With
+ * more workers than CPUs a node's CPUs are reused in turn.
+ *
+ * Returns @want, or 0 if the policy is off (the workers are not pinned).
+ */
+unsigned int nymya_numa_cpus(unsigned int want, int *cpu, int *node) {
+    const nymya_numa_topo *t = &nymya_numa;
+    unsigned int w;
+
+    if (nymya_numa_policy() == NYMYA_NUMA_OFF || !t->ncpus || !cpu || !node) return 0;
+
+    for (w = 0; w < want; w++) {
+        unsigned int i, k = 0;
+
+        if (t->policy == NYMYA_NUMA_COMPACT) {
+            i = w % t->ncpus;
+            while (i >= t->first[k + 1]) k++;
+        } else {
+            // Worker w belongs to the node w/want of the way through the CPUs,
+            // and takes that node's CPUs in turn from its first worker on
+            unsigned long long pos = (unsigned long long)w * t->ncpus / want, lo;
+
+            while (pos >= t->first[k + 1]) k++;
+            lo = ((unsigned long long)t->first[k] * want + t->ncpus - 1) / t->ncpus;
+            i = t->first[k] + (unsigned int)((w - lo) % (t->first[k + 1] - t->first[k]));
+        }
+        cpu[w] = t->cpu[i];
+        node[w] = t->node[k];
+    }
+    return want;
+}
+
+/**
+ * nymya_numa_bind - Sets where the pages of a mapping are allocated.
+ * @p: Page-aligned start, not yet touched.
+ * @bytes: Length; the last page is covered whole.
+ * @node: Node to prefer, or -1 to interleave the pages over all nodes.
+ *
+ * Only pages that have not been faulted in yet follow the new policy.
+ * A preferred node that is full falls back to the others.
+ *
+ * Returns 0, or -1 with errno set.
+ */
+int nymya_numa_bind(void *p, size_t bytes, int node) {
+    const nymya_numa_topo *t = &nymya_numa;
+    unsigned long mask[NYMYA_NUMA_MAX_NODES / (8 * sizeof(unsigned long)) + 1] = { 0 };
+    unsigned long bits = 8 * sizeof(unsigned long);
+    long page = sysconf(_SC_PAGESIZE);
+    unsigned int k;
+
+    if (!p || !bytes || (page > 0 && (uintptr_t)p % (size_t)page) ||
+        node >= NYMYA_NUMA_MAX_NODES) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_once(&nymya_numa_once, nymya_numa_init);
+    if (node < 0 && !t->nnodes) return 0;
+    if (node >= 0) {
+        mask[node / bits] |= 1ul << (node % bits);
+    } else {
+        for (k = 0; k < t->nnodes; k++)
+            mask[t->node[k] / bits] |= 1ul << (t->node[k] % bits);
+    }
+    return syscall(SYS_mbind, p, bytes, node >= 0 ? MPOL_PREFERRED : MPOL_INTERLEAVE,
+                   mask, (unsigned long)NYMYA_NUMA_MAX_NODES + 1, 0ul) ? -1 : 0;
+}
+
+#endif // __KERNEL__
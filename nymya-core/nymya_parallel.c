@@ -0,0 +1,492 @@
+// src/nymya_parallel.c
+//
+// Splits independent work items across CPUs for the lattice cores.
+// nymya_parallel_for() cuts [0, n) into contiguous ranges and runs each on its
+// own CPU: kernel work items on system_unbound_wq in the kernel, a persistent
+// pthread pool in userland. Jobs below the work-size threshold run inline on
+// the calling thread, so small lattices pay nothing for the mode. Callers
+// whose items are much heavier than one gate, such as the graph-state units,
+// say so through nymya_parallel_for_cost() and split at fewer items.
+//
+// On NUMA machines the userland workers are pinned node by node (see
+// nymya_numa.c) and each range of a job always goes to the same worker, so
+// a buffer placed with nymya_parallel_place() is swept from its own node.
+// In the kernel the ranges stay on the caller's node, where its buffers were
+// allocated.
+
+#define _GNU_SOURCE // pthread_attr_setaffinity_np()
+
+#include "nymya.h"
+
+// @n items of @cost each as work for the threshold, saturating instead of wrapping
+static inline size_t nymya_par_work(size_t n, size_t cost)
+{
+    return cost && n > (size_t)-1 / cost ? (size_t)-1 : n * cost;
+}
+
+/**
+ * nymya_par_bound - First item of range @r when [0, @n) is cut into @ranges.
+ * @n: Number of work items.
+ * @r: Range index, 0 to @ranges; @ranges gives @n.
+ * @ranges: Number of ranges.
+ *
+ * Inner boundaries are rounded down to NYMYA_PARALLEL_GRAIN items, which for
+ * item sizes of a byte or more puts them on cache-line boundaries of an
+ * aligned array: two ranges never write to the same line.
+ */
+static inline size_t nymya_par_bound(size_t n, unsigned int r, unsigned int ranges)
+{
+    if (r >= ranges)
+        return n;
+    return n * r / ranges / NYMYA_PARALLEL_GRAIN * NYMYA_PARALLEL_GRAIN;
+}
+
+#ifndef __KERNEL__
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+/**
+ * nymya_par_pool - Persistent userland worker pool.
+ * @lock: Protects every field below.
+ * @job_cv: Signals workers that a new job was published.
+ * @done_cv: Signals the submitter that the last range finished.
+ * @submit: Serialises callers of nymya_parallel_for(); one job runs at a time.
+ * @threads: Number of workers: pool threads plus the submitter, or only pool
+ *           threads when @numa is set.
+ * @threshold: Minimum work items per range.
+ * @numa: Workers are pinned by node and each range has a fixed owner.
+ * @node: Node of each pinned worker.
+ * @gen: Job generation, bumped for every published job.
+ * @fn: Range callback of the current job.
+ * @ctx: Callback context of the current job.
+ * @n: Number of items of the current job.
+ * @ranges: Number of ranges the current job is split into.
+ * @next: Next range to hand out.
+ * @pending: Ranges not yet finished.
+ * @ret: Per-range results of the current job.
+ */
+typedef struct nymya_par_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t job_cv;
+    pthread_cond_t done_cv;
+    pthread_mutex_t submit;
+    unsigned int threads;
+    size_t threshold;
+    int numa;
+    int node[NYMYA_PARALLEL_MAX_WORKERS];
+    uint64_t gen;
+    nymya_parallel_fn fn;
+    void *ctx;
+    size_t n;
+    unsigned int ranges;
+    unsigned int next;
+    unsigned int pending;
+    int ret[NYMYA_PARALLEL_MAX_WORKERS];
+} nymya_par_pool;
+
+static nymya_par_pool nymya_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .job_cv = PTHREAD_COND_INITIALIZER,
+    .done_cv = PTHREAD_COND_INITIALIZER,
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+};
+static pthread_once_t nymya_pool_once = PTHREAD_ONCE_INIT;
+
+// Set on pool threads so that a nested nymya_parallel_for() runs inline
+static __thread int nymya_par_in_worker;
+
+static size_t nymya_par_env(const char *name, size_t fallback) {
+    const char *s = getenv(name);
+    char *end;
+    unsigned long long v;
+
+    if (!s || !*s) return fallback;
+    v = strtoull(s, &end, 10);
+    return (*end || v == 0) ? fallback : (size_t)v;
+}
+
+/*
+ * Range of a @ranges-way job that pinned worker @w owns, or @ranges if none:
+ * range r goes to worker r * threads / ranges, the worker the same fraction
+ * of the way through the pool, so range r lies in its worker's node's part of
+ * a buffer placed with nymya_parallel_place().
+ */
+static unsigned int nymya_par_owned(const nymya_par_pool *pool, unsigned int w,
+                                     unsigned int ranges) {
+    unsigned int r = (unsigned int)(((unsigned long long)w * ranges + pool->threads - 1) / pool->threads);
+
+    if (r < ranges && (unsigned long long)r * pool->threads / ranges == w)
+        return r;
+    return ranges;
+}
+
+/**
+ * nymya_par_run_ranges - Claims and runs ranges of the current job until none are left.
+ * @pool: The pool; @pool->lock must be held and is held again on return.
+ * @w: Worker index of the calling thread, or -1 for the submitter.
+ *
+ * Without NUMA pinning any thread takes the next unclaimed range. With it,
+ * a worker runs only the range it owns and the submitter runs none.
+ */
+static void nymya_par_run_ranges(nymya_par_pool *pool, int w) {
+    for (;;) {
+        nymya_parallel_fn fn = pool->fn;
+        void *ctx = pool->ctx;
+        size_t start, end;
+        unsigned int r;
+        int ret;
+
+        if (!pool->numa) {
+            if (pool->next >= pool->ranges) return;
+            r = pool->next++;
+        } else {
+            // Each worker sees each job once, so its range cannot run twice
+            if (w < 0) return;
+            r = nymya_par_owned(pool, (unsigned int)w, pool->ranges);
+            if (r >= pool->ranges) return;
+        }
+        start = nymya_par_bound(pool->n, r, pool->ranges);
+        end = nymya_par_bound(pool->n, r + 1, pool->ranges);
+
+        pthread_mutex_unlock(&pool->lock);
+        ret = fn(ctx, start, end);
+        pthread_mutex_lock(&pool->lock);
+
+        pool->ret[r] = ret;
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done_cv);
+        if (pool->numa) return;
+    }
+}
+
+static void *nymya_par_worker(void *arg) {
+    nymya_par_pool *pool = &nymya_pool;
+    int w = (int)(uintptr_t)arg;
+    uint64_t seen = 0;
+
+    nymya_par_in_worker = 1;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->gen == seen)
+            pthread_cond_wait(&pool->job_cv, &pool->lock);
+        seen = pool->gen;
+        nymya_par_run_ranges(pool, w);
+    }
+    return NULL;
+}
+
+static void nymya_par_pool_start(void) {
+    nymya_par_pool *pool = &nymya_pool;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t want = nymya_par_env("NYMYA_THREADS", cpus > 0 ? (size_t)cpus : 1);
+    int cpu[NYMYA_PARALLEL_MAX_WORKERS];
+    pthread_attr_t attr;
+    pthread_t tid;
+    unsigned int i;
+
+    if (want > NYMYA_PARALLEL_MAX_WORKERS) want = NYMYA_PARALLEL_MAX_WORKERS;
+    pool->threshold = nymya_par_env("NYMYA_PARALLEL_THRESHOLD", NYMYA_PARALLEL_THRESHOLD);
+    // A lone worker has nothing to be placed against
+    pool->numa = want > 1 && nymya_numa_cpus((unsigned int)want, cpu, pool->node) == want;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    // The submitting thread is one of the workers, unless they are pinned
+    for (i = pool->numa ? 0 : 1; i < want; i++) {
+        if (pool->numa) {
+            cpu_set_t one;
+
+            CPU_ZERO(&one);
+            CPU_SET(cpu[i], &one);
+            pthread_attr_setaffinity_np(&attr, sizeof(one), &one);
+        }
+        if (pthread_create(&tid, &attr, nymya_par_worker, (void *)(uintptr_t)i) != 0)
+            break;
+    }
+    pthread_attr_destroy(&attr);
+    pool->threads = i ? i : 1;
+    // Short of threads, range ownership would leave ranges without a worker
+    if (i < want) pool->numa = 0;
+}
+
+/**
+ * nymya_parallel_place - Places a buffer's pages on the nodes of the workers that sweep it.
+ * @p: Page-aligned buffer whose pages have not been touched yet.
+ * @bytes: Length of @p.
+ *
+ * Under the spread and compact policies the buffer is cut the way jobs over
+ * it are cut between the workers, and each node's part is preferred on that
+ * node; under the interleave policy its pages alternate over all nodes.
+ * Without NUMA pinning this does nothing and the pages follow first touch.
+ *
+ * Returns 0, or -1 with errno set if the placement could not be applied.
+ */
+int nymya_parallel_place(void *p, size_t bytes) {
+    nymya_par_pool *pool = &nymya_pool;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t pg = page > 0 ? (size_t)page : 4096, lo = 0, hi;
+    unsigned int w, first = 0;
+
+    pthread_once(&nymya_pool_once, nymya_par_pool_start);
+    if (!pool->numa) return 0;
+    if (nymya_numa_policy() == NYMYA_NUMA_INTERLEAVE) return nymya_numa_bind(p, bytes, -1);
+
+    // Workers are grouped by node; each group gets its fraction of the pages
+    for (w = 1; w <= pool->threads; w++) {
+        if (w < pool->threads && pool->node[w] == pool->node[first]) continue;
+        hi = w < pool->threads ? bytes / pool->threads * w / pg * pg : bytes;
+        if (hi > lo && nymya_numa_bind((char *)p + lo, hi - lo, pool->node[first])) return -1;
+        lo = hi;
+        first = w;
+    }
+    return 0;
+}
+
+// Ranges for @n items of @cost each: one per threshold's worth of work, at most one per item
+static unsigned int nymya_par_ranges(size_t n, size_t cost) {
+    size_t w;
+
+    if (nymya_par_in_worker) return 1;
+    pthread_once(&nymya_pool_once, nymya_par_pool_start);
+
+    w = nymya_par_work(n, cost) / nymya_pool.threshold;
+    if (w > nymya_pool.threads) w = nymya_pool.threads;
+    if (w > n) w = n;
+    return w ? (unsigned int)w : 1;
+}
+
+/**
+ * nymya_parallel_workers - Number of ranges nymya_parallel_for() would use for @n items.
+ * @n: Number of independent work items.
+ *
+ * Returns 1 when the job is below the threshold (NYMYA_PARALLEL_THRESHOLD
+ * items per range, overridable through the environment variable of the same
+ * name) or the pool has a single thread (NYMYA_THREADS=1).
+ */
+unsigned int nymya_parallel_workers(size_t n) {
+    return nymya_par_ranges(n, 1);
+}
+
+/**
+ * nymya_parallel_for - Runs @fn over [0, @n) split into contiguous ranges (userland).
+ * @n: Number of independent work items.
+ * @fn: Callback run as fn(ctx, start, end) for each range.
+ * @ctx: Opaque context passed to @fn.
+ *
+ * Ranges run concurrently on the pool threads and the caller, so @fn must not
+ * touch items outside its range. Nested calls from inside @fn run inline.
+ * With NUMA pinning the caller only waits, and range r of every job over
+ * the same item count runs on the same worker.
+ *
+ * Returns 0 if every range returned 0, otherwise the result of the
+ * lowest-numbered failing range.
+ */
+int nymya_parallel_for(size_t n, nymya_parallel_fn fn, void *ctx) {
+    return nymya_parallel_for_cost(n, 1, fn, ctx);
+}
+
+/**
+ * nymya_parallel_for_cost - nymya_parallel_for() on items of @cost work each (userland).
+ * @n: Number of independent work items.
+ * @cost: Work of one item in threshold units, about one single-qubit gate.
+ * @fn: Callback run as fn(ctx, start, end) for each range.
+ * @ctx: Opaque context passed to @fn.
+ *
+ * The job splits once @n * @cost reaches the threshold per range, so a few
+ * thousand heavy items still spread over the pool.
+ *
+ * Returns as nymya_parallel_for().
+ */
+int nymya_parallel_for_cost(size_t n, size_t cost, nymya_parallel_fn fn, void *ctx) {
+    nymya_par_pool *pool = &nymya_pool;
+    unsigned int ranges, r;
+    int ret = 0;
+
+    if (!fn) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ranges = nymya_par_ranges(n, cost);
+    if (ranges <= 1)
+        return n ? fn(ctx, 0, n) : 0;
+
+    pthread_mutex_lock(&pool->submit);
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->n = n;
+    pool->ranges = ranges;
+    pool->next = 0;
+    pool->pending = ranges;
+    pool->gen++;
+    pthread_cond_broadcast(&pool->job_cv);
+
+    nymya_par_in_worker = 1;
+    nymya_par_run_ranges(pool, -1);
+    nymya_par_in_worker = 0;
+
+    while (pool->pending)
+        pthread_cond_wait(&pool->done_cv, &pool->lock);
+    for (r = 0; r < ranges && !ret; r++)
+        ret = pool->ret[r];
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->submit);
+
+    return ret;
+}
+
+#else // __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <linux/topology.h>
+#include <linux/workqueue.h>
+
+static unsigned int parallel_threshold = NYMYA_PARALLEL_THRESHOLD;
+module_param(parallel_threshold, uint, 0644);
+MODULE_PARM_DESC(parallel_threshold, "Minimum work items per CPU before a lattice core runs in parallel (0 disables)");
+
+static bool parallel_node_local = true;
+module_param(parallel_node_local, bool, 0644);
+MODULE_PARM_DESC(parallel_node_local, "Run the ranges of a parallel job on the caller's NUMA node, where its buffers live");
+
+/**
+ * struct nymya_par_work - One range of a parallel job.
+ * @work: Work item queued on system_unbound_wq.
+ * @fn: Range callback.
+ * @ctx: Callback context.
+ * @start: First item of the range.
+ * @end: One past the last item of the range.
+ * @ret: Result of @fn.
+ */
+struct nymya_par_work {
+    struct work_struct work;
+    nymya_parallel_fn fn;
+    void *ctx;
+    size_t start;
+    size_t end;
+    int ret;
+};
+
+static void nymya_par_work_fn(struct work_struct *work)
+{
+    struct nymya_par_work *w = container_of(work, struct nymya_par_work, work);
+
+    w->ret = w->fn(w->ctx, w->start, w->end);
+}
+
+// Ranges for @n items of @cost each: one per threshold's worth of work, at most one per item
+static unsigned int nymya_par_ranges(size_t n, size_t cost)
+{
+    unsigned int threshold = READ_ONCE(parallel_threshold);
+    unsigned int cpus = num_online_cpus();
+    size_t w;
+
+    if (!threshold)
+        return 1;
+    if (READ_ONCE(parallel_node_local))
+        cpus = max_t(unsigned int, cpumask_weight(cpumask_of_node(numa_node_id())), 1);
+    w = min_t(size_t, nymya_par_work(n, cost) / threshold, cpus);
+    w = min_t(size_t, w, NYMYA_PARALLEL_MAX_WORKERS);
+    w = min_t(size_t, w, n);
+    return w ? w : 1;
+}
+
+/**
+ * nymya_parallel_workers - Number of ranges nymya_parallel_for() would use for @n items.
+ * @n: Number of independent work items.
+ *
+ * Returns 1 when @n is below parallel_threshold items per CPU, the threshold
+ * is 0, or a single CPU is online. With parallel_node_local set only the
+ * CPUs of the caller's node count.
+ */
+unsigned int nymya_parallel_workers(size_t n)
+{
+    return nymya_par_ranges(n, 1);
+}
+EXPORT_SYMBOL_GPL(nymya_parallel_workers);
+
+/**
+ * nymya_parallel_for - Runs @fn over [0, @n) split into contiguous ranges (kernel).
+ * @n: Number of independent work items.
+ * @fn: Callback run as fn(ctx, start, end) for each range; may sleep.
+ * @ctx: Opaque context passed to @fn.
+ *
+ * The first range runs on the calling thread and the others on
+ * system_unbound_wq, kept on the caller's NUMA node while
+ * parallel_node_local is set: the staging buffers a core sweeps were
+ * allocated there, and a range on another socket would pull every line
+ * across the interconnect. The call returns once all ranges have finished. @fn
+ * must not touch items outside its range. If the work items cannot be
+ * allocated the whole job runs inline.
+ *
+ * Returns 0 if every range returned 0, otherwise the result of the
+ * lowest-numbered failing range.
+ */
+int nymya_parallel_for(size_t n, nymya_parallel_fn fn, void *ctx)
+{
+    return nymya_parallel_for_cost(n, 1, fn, ctx);
+}
+EXPORT_SYMBOL_GPL(nymya_parallel_for);
+
+/**
+ * nymya_parallel_for_cost - nymya_parallel_for() on items of @cost work each (kernel).
+ * @n: Number of independent work items.
+ * @cost: Work of one item in parallel_threshold units, about one single-qubit gate.
+ * @fn: Callback run as fn(ctx, start, end) for each range; may sleep.
+ * @ctx: Opaque context passed to @fn.
+ *
+ * The job splits once @n * @cost reaches parallel_threshold per CPU.
+ *
+ * Returns as nymya_parallel_for().
+ */
+int nymya_parallel_for_cost(size_t n, size_t cost, nymya_parallel_fn fn, void *ctx)
+{
+    unsigned int ranges = nymya_par_ranges(n, cost);
+    int node = READ_ONCE(parallel_node_local) ? numa_node_id() : NUMA_NO_NODE;
+    struct nymya_par_work *w;
+    unsigned int r;
+    int ret = 0;
+
+    if (!fn)
+        return -EINVAL;
+    if (ranges <= 1)
+        return n ? fn(ctx, 0, n) : 0;
+
+    w = kcalloc(ranges, sizeof(*w), GFP_KERNEL_ACCOUNT);
+    if (!w)
+        return fn(ctx, 0, n);
+
+    for (r = 0; r < ranges; r++) {
+        w[r].fn = fn;
+        w[r].ctx = ctx;
+        w[r].start = nymya_par_bound(n, r, ranges);
+        w[r].end = nymya_par_bound(n, r + 1, ranges);
+        if (r) {
+            INIT_WORK(&w[r].work, nymya_par_work_fn);
+            queue_work_node(node, system_unbound_wq, &w[r].work);
+        }
+    }
+
+    w[0].ret = fn(ctx, w[0].start, w[0].end);
+
+    for (r = 1; r < ranges; r++)
+        flush_work(&w[r].work);
+    for (r = 0; r < ranges && !ret; r++)
+        ret = w[r].ret;
+
+    kfree(w);
+    return ret;
+}
+EXPORT_SYMBOL_GPL(nymya_parallel_for_cost);
+
+#endif // __KERNEL__
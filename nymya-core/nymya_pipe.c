@@ -0,0 +1,402 @@
+// src/nymya_pipe.c
+//
+// Pipelined runs of multi-stage circuits that cross into the kernel several
+// times. The one-shot wrappers (3362, 3363, 3365) each convert the whole
+// qubit array to Q32.32, make their call, and convert it back, so a run of
+// kernel stages pays two conversions per stage and the kernel sits idle
+// while userland marshals. nymya_pipe_run() converts the qubits once and
+// keeps them in the kernel layout from one kernel stage to the next.
+//
+// The kernel calls are made by a submitter thread that takes them in order
+// from two staging slots. While it runs stage i from one slot, the calling
+// thread marshals stage i + 1 into the other: the Q32.32 coordinate arrays
+// of a positional lattice stage and the arguments of the call. A slot is
+// reused once the stage it held has finished. Host stages, which run a
+// function on the double qubits in the calling thread, drain the pipeline
+// and convert the qubits back and forth around it.
+//
+// The calls go through nymya_call_gate(), so a pipeline runs wherever the
+// gate calls do (syscall, /dev/nymya, in-process or a plugin backend).
+// The submission rings carry only 3362 batches and run them in the caller
+// of NYMYA_RING_ENTER, so the submitter thread does for every stage kind
+// what a second thread entering a ring would do for gate batches.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Staging slots; the caller fills one while the submitter runs the other
+#define NYMYA_PIPE_SLOTS 2
+
+/**
+ * nymya_pipe_slot - One staged kernel call.
+ * @code: Syscall number.
+ * @args: Its arguments, as NYMYA_CALL_GATE() passes them.
+ * @nargs: Number of @args.
+ * @coords: Q32.32 coordinate arrays of a positional stage, one after another.
+ * @axes: Addresses of the coordinate arrays and, under
+ *        NYMYA_LATTICE_PERIODIC, of @box.
+ * @box: Q32.32 box edges.
+ */
+typedef struct nymya_pipe_slot {
+    uint32_t code;
+    uint64_t args[NYMYA_CALL_MAX_ARGS];
+    uint32_t nargs;
+    int64_t *coords;
+    uint64_t axes[NYMYA_LATTICE_MAX_DIM + 1];
+    int64_t box[NYMYA_LATTICE_MAX_DIM];
+} nymya_pipe_slot;
+
+/**
+ * nymya_pipe - State shared by the calling thread and the submitter.
+ * @lock: Guards @posted, @done, @ret and @stop.
+ * @cond: Signalled when @posted, @done or @stop changes.
+ * @posted: Kernel stages handed to the submitter.
+ * @done: Kernel stages the submitter has finished.
+ * @ret: -1 once a call has failed, 0 before; later calls are skipped.
+ * @err: errno of the failed call, which the submitter thread set.
+ * @stop: Set when the caller has posted its last stage.
+ * @slot: Staging slots, stage n in @slot[n % NYMYA_PIPE_SLOTS].
+ * @kernel_ns: Time the submitter spent in calls.
+ * @idle_ns: Time the submitter waited for a stage to be posted.
+ */
+typedef struct nymya_pipe {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t posted;
+    size_t done;
+    int ret;
+    int err;
+    int stop;
+    nymya_pipe_slot slot[NYMYA_PIPE_SLOTS];
+    uint64_t kernel_ns;
+    uint64_t idle_ns;
+} nymya_pipe;
+
+// Qubits a stage covers, from @first to the end of the array for a count of 0
+static size_t nymya_pipe_span(const nymya_pipe_stage *st, size_t count) {
+    return st->count ? st->count : count - st->first;
+}
+
+/*
+ * Checks one stage against the qubit array, so a bad stage fails the run
+ * before anything is converted or called.
+ */
+static int nymya_pipe_check(const nymya_pipe_stage *st, size_t count) {
+    const nymya_gate_desc *d;
+    size_t n;
+
+    if (st->first > count || (st->count && st->count > count - st->first)) return -1;
+    n = nymya_pipe_span(st, count);
+    switch (st->kind) {
+    case NYMYA_PIPE_SUBMIT:
+        return !st->ops || st->op_count == 0 || st->op_count > NYMYA_SUBMIT_MAX_OPS ||
+               n == 0 || n > NYMYA_SUBMIT_MAX_QUBITS ? -1 : 0;
+    case NYMYA_PIPE_ARRAY:
+        d = nymya_gate_lookup(st->code);
+        return !d || (d->shape != NYMYA_SHAPE_QARR && d->shape != NYMYA_SHAPE_QLIST) ||
+               n < d->min_qubits ? -1 : 0;
+    case NYMYA_PIPE_SOA:
+        if (!NYMYA_LATTICE_DIMS(st->code) || !st->coords || n == 0) return -1;
+        for (unsigned int k = 0; k < NYMYA_LATTICE_DIMS(st->code); k++)
+            if (!st->coords[k]) return -1;
+        return 0;
+    case NYMYA_PIPE_HOST:
+        return st->host ? 0 : -1;
+    }
+    return -1;
+}
+
+static void nymya_pipe_to_k(const nymya_qubit *q, nymya_qubit_k *k, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        k[i].id = q[i].id;
+        memcpy(k[i].tag, q[i].tag, NYMYA_TAG_MAXLEN);
+        k[i].re = (int64_t)(creal(q[i].amplitude) * FIXED_POINT_SCALE);
+        k[i].im = (int64_t)(cimag(q[i].amplitude) * FIXED_POINT_SCALE);
+    }
+}
+
+static void nymya_pipe_from_k(const nymya_qubit_k *k, nymya_qubit *q, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        q[i].amplitude = (double)k[i].re / FIXED_POINT_SCALE
+                       + (double)k[i].im / FIXED_POINT_SCALE * I;
+    }
+}
+
+/*
+ * Widens the range of qubits held in the kernel layout, [@lo, @hi), to
+ * cover [@a, @b). Only the qubits added are converted; the submitter may be
+ * working on the others.
+ */
+static void nymya_pipe_reside(const nymya_qubit *q, nymya_qubit_k *k, size_t a, size_t b,
+                              size_t *lo, size_t *hi) {
+    if (*hi == *lo) {
+        nymya_pipe_to_k(q + a, k + a, b - a);
+        *lo = a;
+        *hi = b;
+        return;
+    }
+    if (a < *lo) {
+        nymya_pipe_to_k(q + a, k + a, *lo - a);
+        *lo = a;
+    }
+    if (b > *hi) {
+        nymya_pipe_to_k(q + *hi, k + *hi, b - *hi);
+        *hi = b;
+    }
+}
+
+/*
+ * Marshals a kernel stage into a slot: its coordinates to Q32.32 and the
+ * arguments of its call on @kq, the stage's first qubit in the kernel layout.
+ */
+static void nymya_pipe_stage_to_slot(const nymya_pipe_stage *st, nymya_qubit_k *kq, size_t n,
+                                     nymya_pipe_slot *s) {
+    unsigned int dims, code;
+
+    switch (st->kind) {
+    case NYMYA_PIPE_SUBMIT:
+        s->code = NYMYA_SUBMIT_CODE;
+        s->args[0] = (uintptr_t)st->ops;
+        s->args[1] = st->op_count;
+        s->args[2] = (uintptr_t)kq;
+        s->args[3] = n;
+        s->nargs = 4;
+        break;
+    case NYMYA_PIPE_ARRAY:
+        s->code = NYMYA_LATTICE_ARRAY_CODE;
+        s->args[0] = st->code;
+        s->args[1] = (uintptr_t)kq;
+        s->args[2] = n;
+        s->nargs = 3;
+        break;
+    case NYMYA_PIPE_SOA:
+        dims = NYMYA_LATTICE_DIMS(st->code);
+        code = st->code;
+        for (unsigned int k = 0; k < dims; k++) {
+            int64_t *axis = s->coords + (size_t)k * n;
+
+            for (size_t i = 0; i < n; i++)
+                axis[i] = (int64_t)(st->coords[k][i] * FIXED_POINT_SCALE);
+            s->axes[k] = (uint64_t)(uintptr_t)axis;
+        }
+        if (st->box) {
+            for (unsigned int k = 0; k < dims; k++)
+                s->box[k] = (int64_t)(st->box[k] * FIXED_POINT_SCALE);
+            s->axes[dims] = (uint64_t)(uintptr_t)s->box;
+            code |= NYMYA_LATTICE_PERIODIC;
+        }
+        s->code = NYMYA_LATTICE_SOA_CODE;
+        s->args[0] = code;
+        s->args[1] = (uintptr_t)kq;
+        s->args[2] = (uintptr_t)s->axes;
+        s->args[3] = n;
+        s->nargs = 4;
+        break;
+    }
+}
+
+/*
+ * Makes the call of a slot. A 3362 batch cut short by a signal returns the
+ * records it applied and is resubmitted from there, as nymya_3362_submit()
+ * does; any other positive result is success.
+ */
+static int nymya_pipe_call(nymya_pipe_slot *s) {
+    long ret;
+
+    if (s->code != NYMYA_SUBMIT_CODE) return nymya_call_gate(s->code, s->args, s->nargs) ? -1 : 0;
+    while ((ret = nymya_call_gate(s->code, s->args, s->nargs)) > 0 && (uint64_t)ret < s->args[1]) {
+        s->args[0] += (uint64_t)ret * sizeof(nymya_op);
+        s->args[1] -= (uint64_t)ret;
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+static void *nymya_pipe_submitter(void *arg) {
+    nymya_pipe *p = arg;
+    size_t n = 0;
+
+    for (;;) {
+        uint64_t t0 = nymya_btrace_now();
+        int skip, ret;
+
+        pthread_mutex_lock(&p->lock);
+        while (p->posted == n && !p->stop) pthread_cond_wait(&p->cond, &p->lock);
+        if (p->posted == n) {
+            pthread_mutex_unlock(&p->lock);
+            return NULL;
+        }
+        skip = p->ret != 0;
+        pthread_mutex_unlock(&p->lock);
+        p->idle_ns += nymya_btrace_now() - t0;
+
+        t0 = nymya_btrace_now();
+        ret = skip ? 0 : nymya_pipe_call(&p->slot[n % NYMYA_PIPE_SLOTS]);
+        p->kernel_ns += nymya_btrace_now() - t0;
+
+        pthread_mutex_lock(&p->lock);
+        if (ret && !p->ret) {
+            p->ret = -1;
+            p->err = errno;
+        }
+        p->done = ++n;
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+// Waits until at most @left posted stages are unfinished; -1 if a call has failed
+static int nymya_pipe_wait(nymya_pipe *p, size_t left) {
+    int ret;
+
+    pthread_mutex_lock(&p->lock);
+    while (p->posted - p->done > left) pthread_cond_wait(&p->cond, &p->lock);
+    ret = p->ret;
+    pthread_mutex_unlock(&p->lock);
+    return ret;
+}
+
+/**
+ * nymya_pipe_run - Runs a list of stages on one qubit array, overlapping
+ * the marshalling of each kernel stage with the call before it.
+ * @stages: Stages, run in order; each covers @first to @first + @count of
+ *          @qubits and its operand indices or coordinates refer to that range.
+ * @nstages: Number of stages.
+ * @qubits: Qubit array; updated in place.
+ * @count: Number of qubits in @qubits.
+ * @stats: Receives where the time went, or NULL.
+ *
+ * The qubits are converted to Q32.32 once, as the first kernel stage to
+ * reach them needs them, and back once after the last kernel stage, or
+ * before a host stage. The range converted runs from the first to the last
+ * qubit the kernel stages touch, so qubits in a gap between stage ranges
+ * are rounded to Q32.32 as well. Kernel stages
+ * run one after another in a submitter thread; while one runs, the calling
+ * thread prepares the next. A stage's coordinates, operations and host
+ * argument must stay valid until the run returns.
+ *
+ * Returns 0 on success, -1 on invalid input or memory failure (before any
+ * stage runs), -1 with errno set if a kernel stage fails, or the nonzero
+ * result of a host stage. Stages after a failure do not run, and @qubits
+ * then hold the state the last host stage left them in, or their state
+ * before the run if no host stage ran.
+ */
+int nymya_pipe_run(const nymya_pipe_stage *stages, size_t nstages, nymya_qubit *qubits,
+                   size_t count, nymya_pipe_stats *stats) {
+    nymya_pipe p = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+    nymya_qubit_k *kq = NULL;
+    size_t coord_max = 0, nkernel = 0, i;
+    uint64_t t0 = nymya_btrace_now(), marshal = 0, wait = 0, t;
+    pthread_t thread;
+    size_t lo = 0, hi = 0;
+    int threaded = 0, ret = 0;
+
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!stages || !qubits || !count) return -1;
+    for (i = 0; i < nstages; i++) {
+        const nymya_pipe_stage *st = &stages[i];
+        size_t n;
+
+        if (nymya_pipe_check(st, count)) return -1;
+        n = nymya_pipe_span(st, count);
+        if (st->kind == NYMYA_PIPE_SOA && NYMYA_LATTICE_DIMS(st->code) * n > coord_max)
+            coord_max = NYMYA_LATTICE_DIMS(st->code) * n;
+        if (st->kind != NYMYA_PIPE_HOST) nkernel++;
+    }
+
+    if (nkernel) {
+        kq = nymya_aligned_alloc(count * sizeof(*kq), 0);
+        if (!kq) goto out;
+    }
+    for (unsigned int s = 0; s < NYMYA_PIPE_SLOTS && coord_max; s++) {
+        p.slot[s].coords = nymya_aligned_alloc(coord_max * sizeof(int64_t), 0);
+        if (!p.slot[s].coords) {
+            ret = -1;
+            goto out;
+        }
+    }
+
+    // A single kernel stage has nothing to overlap with
+    if (nkernel > 1) threaded = pthread_create(&thread, NULL, nymya_pipe_submitter, &p) == 0;
+
+    for (i = 0; i < nstages && !ret; i++) {
+        const nymya_pipe_stage *st = &stages[i];
+        size_t n = nymya_pipe_span(st, count);
+        nymya_pipe_slot *s;
+
+        // A host stage waits for every call; a kernel stage for the slot it reuses
+        t = nymya_btrace_now();
+        ret = nymya_pipe_wait(&p, st->kind == NYMYA_PIPE_HOST ? 0 : NYMYA_PIPE_SLOTS - 1) ? -1 : 0;
+        wait += nymya_btrace_now() - t;
+        if (ret) break;
+
+        t = nymya_btrace_now();
+        if (st->kind == NYMYA_PIPE_HOST) {
+            nymya_pipe_from_k(kq + lo, qubits + lo, hi - lo);
+            lo = hi = 0;
+            ret = st->host(qubits + st->first, n, st->arg);
+            marshal += nymya_btrace_now() - t;
+            continue;
+        }
+        nymya_pipe_reside(qubits, kq, st->first, st->first + n, &lo, &hi);
+        s = &p.slot[p.posted % NYMYA_PIPE_SLOTS];
+        nymya_pipe_stage_to_slot(st, kq + st->first, n, s);
+        marshal += nymya_btrace_now() - t;
+
+        if (threaded) {
+            pthread_mutex_lock(&p.lock);
+            p.posted++;
+            pthread_cond_signal(&p.cond);
+            pthread_mutex_unlock(&p.lock);
+            continue;
+        }
+        t = nymya_btrace_now();
+        if (nymya_pipe_call(s)) {
+            p.err = errno;
+            p.ret = -1;
+        }
+        p.kernel_ns += nymya_btrace_now() - t;
+        p.posted = ++p.done;
+    }
+
+    if (threaded) {
+        t = nymya_btrace_now();
+        pthread_mutex_lock(&p.lock);
+        p.stop = 1;
+        pthread_cond_signal(&p.cond);
+        pthread_mutex_unlock(&p.lock);
+        pthread_join(thread, NULL);
+        wait += nymya_btrace_now() - t;
+    }
+    if (!ret && p.ret) ret = -1;
+    if (!ret && hi > lo) {
+        t = nymya_btrace_now();
+        nymya_pipe_from_k(kq + lo, qubits + lo, hi - lo);
+        marshal += nymya_btrace_now() - t;
+    }
+
+    if (stats) {
+        stats->stages = i;
+        stats->kernel_stages = p.done;
+        stats->total_ns = nymya_btrace_now() - t0;
+        stats->marshal_ns = marshal;
+        stats->wait_ns = wait;
+        stats->kernel_ns = p.kernel_ns;
+        stats->idle_ns = p.idle_ns;
+    }
+
+out:
+    nymya_aligned_free(kq);
+    for (unsigned int s = 0; s < NYMYA_PIPE_SLOTS; s++) nymya_aligned_free(p.slot[s].coords);
+    if (nkernel && !kq) ret = -1;
+    if (p.ret) errno = p.err;
+    return ret;
+}
+
+#endif // __KERNEL__
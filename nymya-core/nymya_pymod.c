@@ -0,0 +1,472 @@
+// src/nymya_pymod.c
+//
+// CPython extension module "nymya": native bindings for the orchestration
+// scripts, which otherwise reach libnymya through ctypes at several
+// microseconds per gate. The data stays in C arrays that Python sees
+// through the buffer protocol, so numpy.asarray() and memoryview() wrap it
+// without a copy:
+//
+//   Register(n)           n qubits; its buffer is their amplitudes, complex128,
+//                         strided over the nymya_qubit records
+//   Register.apply(code, theta=0.0, axis='z')
+//                         one single-qubit gate on every qubit (nymya_*_n)
+//   Register.submit(ops)  a whole circuit of nymya_op records (any buffer of
+//                         OP_SIZE-byte items, struct format OP_FORMAT) in one
+//                         nymya_3362_submit()
+//   Lattice(code, n)      n sites of lattice gate @code; its buffer is the
+//                         coordinates, float64 (dims, n), and .qubits their Register
+//   Lattice.run()         the gate on the current coordinates (nymya_3363_lattice_soa)
+//   Qrng(entries, lo, hi) a /dev/nymya_qrng ring; take(out) fills a uint64 buffer
+//
+// Every call that runs gates releases the GIL for its duration. Errors
+// raise OSError from errno, or ValueError/TypeError for bad arguments.
+// Built by "make python"; not part of libnymya.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include "nymya.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * NymyaRegister - Python object owning a qubit array.
+ * @q: Qubits, from nymya_aligned_alloc().
+ * @n: Number of qubits.
+ *
+ * An exported buffer holds a reference, so the array outlives every view of it.
+ */
+typedef struct {
+    PyObject_HEAD
+    nymya_qubit *q;
+    Py_ssize_t n;
+} NymyaRegister;
+
+/**
+ * NymyaLattice - Python object owning lattice coordinates and their qubits.
+ * @code: NYMYA_*_CODE of the lattice gate, 3355 to 3360.
+ * @dims: NYMYA_LATTICE_DIMS(@code).
+ * @coord: @dims arrays of @n doubles, one after the other.
+ * @qubits: Register of the @n sites.
+ * @shape, strides: Of the exported coordinate buffer.
+ */
+typedef struct {
+    PyObject_HEAD
+    unsigned int code;
+    unsigned int dims;
+    double *coord;
+    Py_ssize_t n;
+    NymyaRegister *qubits;
+    Py_ssize_t shape[2], strides[2];
+} NymyaLattice;
+
+/**
+ * NymyaQrng - Python object owning a mapped QRNG ring.
+ * @rng: Handle from nymya_qrng_open(); @rng.hdr is NULL once closed.
+ */
+typedef struct {
+    PyObject_HEAD
+    nymya_qrng rng;
+} NymyaQrng;
+
+static PyTypeObject NymyaRegister_Type;
+
+// Distance between consecutive amplitudes in a Register's buffer
+static Py_ssize_t nymya_register_stride = sizeof(nymya_qubit);
+
+// Contiguity requests, without the PyBUF_STRIDES bit they all include
+#define NYMYA_PYBUF_CONTIG \
+    ((PyBUF_C_CONTIGUOUS | PyBUF_F_CONTIGUOUS | PyBUF_ANY_CONTIGUOUS) & ~PyBUF_STRIDES)
+
+static PyObject *nymya_py_errno(void) {
+    return PyErr_SetFromErrno(PyExc_OSError);
+}
+
+/* ---- Register ---------------------------------------------------------- */
+
+static NymyaRegister *nymya_register_new(PyTypeObject *type, Py_ssize_t n) {
+    NymyaRegister *self;
+
+    if (n <= 0 || (size_t)n > SIZE_MAX / sizeof(nymya_qubit)) {
+        PyErr_SetString(PyExc_ValueError, "register size must be positive");
+        return NULL;
+    }
+    self = (NymyaRegister *)type->tp_alloc(type, 0);
+    if (!self) return NULL;
+
+    self->q = nymya_aligned_alloc((size_t)n * sizeof(nymya_qubit), 0);
+    if (!self->q) {
+        Py_DECREF(self);
+        return (NymyaRegister *)PyErr_NoMemory();
+    }
+    memset(self->q, 0, (size_t)n * sizeof(nymya_qubit));
+    for (Py_ssize_t i = 0; i < n; i++) {
+        self->q[i].id = (uint64_t)i;
+        self->q[i].amplitude = 1.0;
+    }
+    self->n = n;
+    return self;
+}
+
+static PyObject *NymyaRegister_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = { "n", NULL };
+    Py_ssize_t n;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "n", kwlist, &n)) return NULL;
+    return (PyObject *)nymya_register_new(type, n);
+}
+
+static void NymyaRegister_dealloc(NymyaRegister *self) {
+    nymya_aligned_free(self->q);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t NymyaRegister_len(NymyaRegister *self) {
+    return self->n;
+}
+
+// The amplitudes, in place: one complex128 per qubit, sizeof(nymya_qubit) apart
+static int NymyaRegister_getbuffer(NymyaRegister *self, Py_buffer *view, int flags) {
+    if (self->n > 1 && ((flags & PyBUF_STRIDES) != PyBUF_STRIDES || (flags & NYMYA_PYBUF_CONTIG))) {
+        PyErr_SetString(PyExc_BufferError, "register amplitudes are strided");
+        view->obj = NULL;
+        return -1;
+    }
+    view->buf = &self->q[0].amplitude;
+    view->obj = (PyObject *)self;
+    view->len = self->n * (Py_ssize_t)sizeof(complex_double);
+    view->readonly = 0;
+    view->itemsize = sizeof(complex_double);
+    view->format = (flags & PyBUF_FORMAT) ? "Zd" : NULL;
+    view->ndim = 1;
+    view->shape = &self->n;
+    view->strides = &nymya_register_stride;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    Py_INCREF(self);
+    return 0;
+}
+
+static PyBufferProcs NymyaRegister_as_buffer = {
+    .bf_getbuffer = (getbufferproc)NymyaRegister_getbuffer,
+};
+
+// Runs single-qubit gate @code on all of @q; -1 with errno set if it has no batched form
+static int nymya_register_apply(nymya_qubit *q, size_t n, unsigned int code, double theta, char axis) {
+    switch (code) {
+    case NYMYA_IDENTITY_GATE_CODE: return nymya_3301_identity_gate_n(q, n);
+    case NYMYA_GLOBAL_PHASE_CODE:  return nymya_3302_global_phase_n(q, n, theta);
+    case NYMYA_PAULI_X_CODE:       return nymya_3303_pauli_x_n(q, n);
+    case NYMYA_PAULI_Y_CODE:       return nymya_3304_pauli_y_n(q, n);
+    case NYMYA_PAULI_Z_CODE:       return nymya_3305_pauli_z_n(q, n);
+    case NYMYA_PHASE_S_CODE:       return nymya_3306_phase_gate_n(q, n);
+    case NYMYA_SQRT_X_CODE:        return nymya_3307_sqrt_x_gate_n(q, n);
+    case NYMYA_HADAMARD_CODE:      return nymya_3308_hadamard_gate_n(q, n);
+    case NYMYA_PHASE_SHIFT_CODE:   return nymya_3315_phase_shift_n(q, n, theta);
+    case NYMYA_PHASE_GATE_CODE:    return nymya_3316_phase_gate_n(q, n, theta);
+    case NYMYA_ROTATE_X_CODE:      return nymya_3319_rotate_x_n(q, n, theta);
+    case NYMYA_ROTATE_Y_CODE:      return nymya_3320_rotate_y_n(q, n, theta);
+    case NYMYA_ROTATE_Z_CODE:      return nymya_3321_rotate_z_n(q, n, theta);
+    case NYMYA_ROTATE_CODE:        return nymya_3330_rotate_n(q, n, axis, theta);
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+static PyObject *NymyaRegister_apply(NymyaRegister *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = { "code", "theta", "axis", NULL };
+    unsigned int code;
+    double theta = 0.0;
+    int axis = 'z';
+    int ret;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "I|dC", kwlist, &code, &theta, &axis)) return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = nymya_register_apply(self->q, (size_t)self->n, code, theta, (char)axis);
+    Py_END_ALLOW_THREADS
+
+    if (ret) return nymya_py_errno();
+    Py_RETURN_NONE;
+}
+
+static PyObject *NymyaRegister_submit(NymyaRegister *self, PyObject *arg) {
+    Py_buffer ops;
+    int ret;
+
+    if (PyObject_GetBuffer(arg, &ops, PyBUF_C_CONTIGUOUS) < 0) return NULL;
+    if (ops.len % (Py_ssize_t)sizeof(nymya_op)) {
+        PyBuffer_Release(&ops);
+        PyErr_Format(PyExc_ValueError, "ops must be whole %zu-byte nymya_op records", sizeof(nymya_op));
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = nymya_3362_submit(ops.buf, (size_t)ops.len / sizeof(nymya_op), self->q, (size_t)self->n);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&ops);
+    if (ret) return nymya_py_errno();
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef NymyaRegister_methods[] = {
+    { "apply", (PyCFunction)(void (*)(void))NymyaRegister_apply, METH_VARARGS | METH_KEYWORDS,
+      "apply(code, theta=0.0, axis='z')\nApplies single-qubit gate code to every qubit." },
+    { "submit", (PyCFunction)NymyaRegister_submit, METH_O,
+      "submit(ops)\nRuns a buffer of nymya_op records on the register in one call." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PySequenceMethods NymyaRegister_as_sequence = {
+    .sq_length = (lenfunc)NymyaRegister_len,
+};
+
+static PyTypeObject NymyaRegister_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "nymya.Register",
+    .tp_doc = "Register(n)\nn qubits in C memory; the buffer is their complex128 amplitudes.",
+    .tp_basicsize = sizeof(NymyaRegister),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = NymyaRegister_new,
+    .tp_dealloc = (destructor)NymyaRegister_dealloc,
+    .tp_as_buffer = &NymyaRegister_as_buffer,
+    .tp_as_sequence = &NymyaRegister_as_sequence,
+    .tp_methods = NymyaRegister_methods,
+};
+
+/* ---- Lattice ----------------------------------------------------------- */
+
+static PyObject *NymyaLattice_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = { "code", "n", NULL };
+    NymyaLattice *self;
+    unsigned int code;
+    Py_ssize_t n;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "In", kwlist, &code, &n)) return NULL;
+    if (NYMYA_LATTICE_DIMS(code) == 0) {
+        PyErr_Format(PyExc_ValueError, "%u is not a positional lattice gate", code);
+        return NULL;
+    }
+
+    self = (NymyaLattice *)type->tp_alloc(type, 0);
+    if (!self) return NULL;
+    self->code = code;
+    self->dims = NYMYA_LATTICE_DIMS(code);
+    self->n = n;
+    self->qubits = nymya_register_new(&NymyaRegister_Type, n);
+    if (!self->qubits) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    self->coord = nymya_aligned_alloc((size_t)n * self->dims * sizeof(double), 0);
+    if (!self->coord) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    memset(self->coord, 0, (size_t)n * self->dims * sizeof(double));
+    self->shape[0] = self->dims;
+    self->shape[1] = n;
+    self->strides[0] = n * (Py_ssize_t)sizeof(double);
+    self->strides[1] = sizeof(double);
+    return (PyObject *)self;
+}
+
+static void NymyaLattice_dealloc(NymyaLattice *self) {
+    nymya_aligned_free(self->coord);
+    Py_XDECREF(self->qubits);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// The coordinates, in place: float64 (dims, n), one row per axis
+static int NymyaLattice_getbuffer(NymyaLattice *self, Py_buffer *view, int flags) {
+    view->buf = self->coord;
+    view->obj = (PyObject *)self;
+    view->len = (Py_ssize_t)self->dims * self->n * (Py_ssize_t)sizeof(double);
+    view->readonly = 0;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? "d" : NULL;
+    view->ndim = (flags & PyBUF_ND) == PyBUF_ND ? 2 : 1;
+    view->shape = view->ndim == 2 ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    Py_INCREF(self);
+    return 0;
+}
+
+static PyBufferProcs NymyaLattice_as_buffer = {
+    .bf_getbuffer = (getbufferproc)NymyaLattice_getbuffer,
+};
+
+static PyObject *NymyaLattice_run(NymyaLattice *self, PyObject *unused) {
+    const double *axes[NYMYA_LATTICE_MAX_DIM];
+    int ret;
+
+    (void)unused;
+    for (unsigned int d = 0; d < self->dims; d++) axes[d] = self->coord + (size_t)d * (size_t)self->n;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = nymya_3363_lattice_soa(self->code, self->qubits->q, axes, (size_t)self->n);
+    Py_END_ALLOW_THREADS
+
+    if (ret) return nymya_py_errno();
+    Py_RETURN_NONE;
+}
+
+static Py_ssize_t NymyaLattice_len(NymyaLattice *self) {
+    return self->n;
+}
+
+static PyMethodDef NymyaLattice_methods[] = {
+    { "run", (PyCFunction)NymyaLattice_run, METH_NOARGS,
+      "run()\nApplies the lattice gate to the sites at their current coordinates." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyMemberDef NymyaLattice_members[] = {
+    { "code", T_UINT, offsetof(NymyaLattice, code), READONLY, "Lattice gate code." },
+    { "dims", T_UINT, offsetof(NymyaLattice, dims), READONLY, "Coordinates per site." },
+    { "qubits", T_OBJECT, offsetof(NymyaLattice, qubits), READONLY, "Register of the sites." },
+    { NULL, 0, 0, 0, NULL }
+};
+
+static PySequenceMethods NymyaLattice_as_sequence = {
+    .sq_length = (lenfunc)NymyaLattice_len,
+};
+
+static PyTypeObject NymyaLattice_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "nymya.Lattice",
+    .tp_doc = "Lattice(code, n)\nn sites of a positional lattice gate; the buffer is their "
+              "float64 (dims, n) coordinates.",
+    .tp_basicsize = sizeof(NymyaLattice),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = NymyaLattice_new,
+    .tp_dealloc = (destructor)NymyaLattice_dealloc,
+    .tp_as_buffer = &NymyaLattice_as_buffer,
+    .tp_as_sequence = &NymyaLattice_as_sequence,
+    .tp_methods = NymyaLattice_methods,
+    .tp_members = NymyaLattice_members,
+};
+
+/* ---- Qrng -------------------------------------------------------------- */
+
+static PyObject *NymyaQrng_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = { "entries", "min", "max", NULL };
+    unsigned long long lo = 0, hi = UINT64_MAX;
+    unsigned int entries = 4096;
+    NymyaQrng *self;
+    int ret;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|IKK", kwlist, &entries, &lo, &hi)) return NULL;
+
+    self = (NymyaQrng *)type->tp_alloc(type, 0);
+    if (!self) return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = nymya_qrng_open(&self->rng, entries, lo, hi);
+    Py_END_ALLOW_THREADS
+
+    if (ret) {
+        self->rng.hdr = NULL;
+        nymya_py_errno();
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *)self;
+}
+
+static void NymyaQrng_dealloc(NymyaQrng *self) {
+    if (self->rng.hdr) nymya_qrng_close(&self->rng);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *NymyaQrng_take(NymyaQrng *self, PyObject *arg) {
+    Py_buffer out;
+    int ret;
+
+    if (!self->rng.hdr) {
+        PyErr_SetString(PyExc_ValueError, "QRNG is closed");
+        return NULL;
+    }
+    if (PyObject_GetBuffer(arg, &out, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE) < 0) return NULL;
+    if (out.len % (Py_ssize_t)sizeof(uint64_t)) {
+        PyBuffer_Release(&out);
+        PyErr_SetString(PyExc_ValueError, "out must hold whole 64-bit values");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = nymya_qrng_take(&self->rng, out.buf, (size_t)out.len / sizeof(uint64_t));
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&out);
+    if (ret) return nymya_py_errno();
+    return PyLong_FromSsize_t(out.len / (Py_ssize_t)sizeof(uint64_t));
+}
+
+static PyObject *NymyaQrng_close(NymyaQrng *self, PyObject *unused) {
+    (void)unused;
+    if (self->rng.hdr) nymya_qrng_close(&self->rng);
+    self->rng.hdr = NULL;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef NymyaQrng_methods[] = {
+    { "take", (PyCFunction)NymyaQrng_take, METH_O,
+      "take(out)\nFills a writable buffer of uint64 with values; returns how many." },
+    { "close", (PyCFunction)NymyaQrng_close, METH_NOARGS, "close()\nUnmaps the ring." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyTypeObject NymyaQrng_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "nymya.Qrng",
+    .tp_doc = "Qrng(entries=4096, min=0, max=2**64-1)\nValue ring of /dev/nymya_qrng.",
+    .tp_basicsize = sizeof(NymyaQrng),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = NymyaQrng_new,
+    .tp_dealloc = (destructor)NymyaQrng_dealloc,
+    .tp_methods = NymyaQrng_methods,
+};
+
+/* ---- Module ------------------------------------------------------------ */
+
+static struct PyModuleDef nymya_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "nymya",
+    .m_doc = "Native libnymya bindings with zero-copy qubit, lattice and QRNG buffers.",
+    .m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit_nymya(void) {
+    PyTypeObject *types[] = { &NymyaRegister_Type, &NymyaLattice_Type, &NymyaQrng_Type };
+    const char *names[] = { "Register", "Lattice", "Qrng" };
+    PyObject *m;
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (PyType_Ready(types[i]) < 0) return NULL;
+    }
+    m = PyModule_Create(&nymya_module);
+    if (!m) return NULL;
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        Py_INCREF(types[i]);
+        if (PyModule_AddObject(m, names[i], (PyObject *)types[i]) < 0) {
+            Py_DECREF(types[i]);
+            Py_DECREF(m);
+            return NULL;
+        }
+    }
+    // nymya_op as a struct module format: gate_code, axis, qubit[3], reserved, param
+    PyModule_AddIntConstant(m, "OP_SIZE", sizeof(nymya_op));
+    PyModule_AddStringConstant(m, "OP_FORMAT", "=6Iq");
+    PyModule_AddIntConstant(m, "SUBMIT_MAX_OPS", NYMYA_SUBMIT_MAX_OPS);
+    PyModule_AddIntConstant(m, "SUBMIT_MAX_QUBITS", NYMYA_SUBMIT_MAX_QUBITS);
+    return m;
+}
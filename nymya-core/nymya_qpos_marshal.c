@@ -0,0 +1,359 @@
+// src/nymya_qpos_marshal.c
+//
+// Batch converters between the userland lattice positions (nymya_qpos3d/4d/5d,
+// double coordinates) and their Q32.32 kernel layout (nymya_qpos*d_k), used by
+// the 3355-3360 wrappers on both sides of the syscall. The qubit's amplitude
+// goes between complex double and Q32.32 with the same casts.
+//
+// Each element's coordinates are contiguous, so they are converted as one
+// short vector: AVX-512 or AVX2 on x86 (bound at load time through
+// NYMYA_IFUNC), NEON on AArch64, and a scalar loop elsewhere. Results are
+// bit-identical to the scalar casts (int64_t)(x * FIXED_POINT_SCALE) and
+// (double)k / FIXED_POINT_SCALE.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NYMYA_QPOS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define NYMYA_QPOS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Userland structs lead with the coordinates; kernel structs lead with the qubit
+_Static_assert(offsetof(nymya_qpos3d, q) == 3 * sizeof(double), "nymya_qpos3d layout");
+_Static_assert(offsetof(nymya_qpos4d, q) == 4 * sizeof(double), "nymya_qpos4d layout");
+_Static_assert(offsetof(nymya_qpos5d, q) == 5 * sizeof(double), "nymya_qpos5d layout");
+_Static_assert(offsetof(nymya_qpos3d_k, x) == sizeof(nymya_qubit_k), "nymya_qpos3d_k layout");
+_Static_assert(offsetof(nymya_qpos4d_k, x) == sizeof(nymya_qubit_k), "nymya_qpos4d_k layout");
+_Static_assert(offsetof(nymya_qpos5d_k, x) == sizeof(nymya_qubit_k), "nymya_qpos5d_k layout");
+
+/**
+ * nymya_qpos_shape - Layout of one userland/kernel position struct pair.
+ * @dims: Number of coordinates.
+ * @u_size: sizeof() the userland struct; its coordinates start at offset 0.
+ * @k_size: sizeof() the kernel struct; its coordinates follow the qubit.
+ */
+typedef struct {
+    unsigned int dims;
+    size_t u_size;
+    size_t k_size;
+} nymya_qpos_shape;
+
+static const nymya_qpos_shape nymya_qpos3d_shape = { 3, sizeof(nymya_qpos3d), sizeof(nymya_qpos3d_k) };
+static const nymya_qpos_shape nymya_qpos4d_shape = { 4, sizeof(nymya_qpos4d), sizeof(nymya_qpos4d_k) };
+static const nymya_qpos_shape nymya_qpos5d_shape = { 5, sizeof(nymya_qpos5d), sizeof(nymya_qpos5d_k) };
+
+#define NYMYA_QPOS_U_QUBIT(u, s) ((nymya_qubit *)((u) + (s)->dims * sizeof(double)))
+#define NYMYA_QPOS_K_COORD(k)    ((int64_t *)((k) + sizeof(nymya_qubit_k)))
+
+typedef void (*nymya_qpos_fn)(const nymya_qpos_shape *s, char *u, char *k, size_t count);
+
+static inline void nymya_qpos_qubit_to_k(const nymya_qubit *q, nymya_qubit_k *k) {
+    k->id = q->id;
+    memcpy(k->tag, q->tag, NYMYA_TAG_MAXLEN);
+    nymya_qubit_k_set_amplitude(k, q->amplitude);
+}
+
+static inline void nymya_qpos_qubit_from_k(const nymya_qubit_k *k, nymya_qubit *q) {
+    q->id = k->id;
+    memcpy(q->tag, k->tag, NYMYA_TAG_MAXLEN);
+    q->amplitude = nymya_qubit_k_amplitude(k);
+}
+
+static inline void nymya_qpos_encode1(const double *x, int64_t *fp, unsigned int dims) {
+    for (unsigned int d = 0; d < dims; d++)
+        fp[d] = (int64_t)(x[d] * FIXED_POINT_SCALE);
+}
+
+static inline void nymya_qpos_decode1(const int64_t *fp, double *x, unsigned int dims) {
+    for (unsigned int d = 0; d < dims; d++)
+        x[d] = (double)fp[d] / FIXED_POINT_SCALE;
+}
+
+static void nymya_qpos_encode_scalar(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    for (size_t i = 0; i < count; i++, u += s->u_size, k += s->k_size) {
+        nymya_qpos_qubit_to_k(NYMYA_QPOS_U_QUBIT(u, s), (nymya_qubit_k *)k);
+        nymya_qpos_encode1((const double *)u, NYMYA_QPOS_K_COORD(k), s->dims);
+    }
+}
+
+static void nymya_qpos_decode_scalar(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    for (size_t i = 0; i < count; i++, u += s->u_size, k += s->k_size) {
+        nymya_qpos_qubit_from_k((const nymya_qubit_k *)k, NYMYA_QPOS_U_QUBIT(u, s));
+        nymya_qpos_decode1(NYMYA_QPOS_K_COORD(k), (double *)u, s->dims);
+    }
+}
+
+#ifdef NYMYA_QPOS_X86
+/*
+ * AVX2 has no double<->int64 conversion. Encoding truncates the scaled value
+ * and, while it stays below 2^51, adds 1.5 * 2^52 so the integer lands in the
+ * low mantissa bits; elements out of that range take the scalar cast.
+ * Decoding splits each int64 into 2^32 * hi + lo around exact magic constants
+ * and rounds only in the final add, like a scalar int64 -> double cast.
+ */
+__attribute__((target("avx2")))
+static inline __m256i nymya_qpos_lanes_avx2(unsigned int n) {
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x(n), _mm256_setr_epi64x(0, 1, 2, 3));
+}
+
+__attribute__((target("avx2")))
+static void nymya_qpos_encode_avx2(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    const __m256d scale = _mm256_set1_pd((double)FIXED_POINT_SCALE);
+    const __m256d limit = _mm256_set1_pd(2251799813685248.0);   // 2^51
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0);   // 1.5 * 2^52
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256i mask_lo = nymya_qpos_lanes_avx2(s->dims < 4 ? s->dims : 4);
+    const __m256i mask_hi = nymya_qpos_lanes_avx2(s->dims > 4 ? s->dims - 4 : 0);
+
+    for (size_t i = 0; i < count; i++, u += s->u_size, k += s->k_size) {
+        const double *x = (const double *)u;
+        int64_t *fp = NYMYA_QPOS_K_COORD(k);
+        __m256d lo = _mm256_maskload_pd(x, mask_lo);
+        __m256d hi = _mm256_maskload_pd(x + 4, mask_hi);
+
+        nymya_qpos_qubit_to_k(NYMYA_QPOS_U_QUBIT(u, s), (nymya_qubit_k *)k);
+        lo = _mm256_round_pd(_mm256_mul_pd(lo, scale), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        hi = _mm256_round_pd(_mm256_mul_pd(hi, scale), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        if (_mm256_movemask_pd(_mm256_and_pd(
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, lo), limit, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, hi), limit, _CMP_LT_OQ))) != 0xF) {
+            nymya_qpos_encode1(x, fp, s->dims);
+            continue;
+        }
+        _mm256_maskstore_epi64((long long *)fp, mask_lo,
+                               _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(lo, magic)),
+                                                _mm256_castpd_si256(magic)));
+        _mm256_maskstore_epi64((long long *)(fp + 4), mask_hi,
+                               _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(hi, magic)),
+                                                _mm256_castpd_si256(magic)));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256d nymya_qpos_i64_to_pd_avx2(__m256i v) {
+    const __m256d magic_hi = _mm256_set1_pd(442721857769029238784.0);  // 3 * 2^67
+    const __m256d magic_all = _mm256_set1_pd(442726361368656609280.0); // 3 * 2^67 + 2^52
+    const __m256d magic_lo = _mm256_set1_pd(4503599627370496.0);       // 2^52
+    __m256i hi = _mm256_srai_epi32(v, 16);
+    __m256i lo;
+
+    hi = _mm256_blend_epi16(hi, _mm256_setzero_si256(), 0x33);
+    hi = _mm256_add_epi64(hi, _mm256_castpd_si256(magic_hi));
+    lo = _mm256_blend_epi16(v, _mm256_castpd_si256(magic_lo), 0x88);
+    return _mm256_add_pd(_mm256_sub_pd(_mm256_castsi256_pd(hi), magic_all), _mm256_castsi256_pd(lo));
+}
+
+__attribute__((target("avx2")))
+static void nymya_qpos_decode_avx2(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    const __m256d inv_scale = _mm256_set1_pd(1.0 / FIXED_POINT_SCALE);
+    const __m256i mask_lo = nymya_qpos_lanes_avx2(s->dims < 4 ? s->dims : 4);
+    const __m256i mask_hi = nymya_qpos_lanes_avx2(s->dims > 4 ? s->dims - 4 : 0);
+
+    for (size_t i = 0; i < count; i++, u += s->u_size, k += s->k_size) {
+        const long long *fp = (const long long *)NYMYA_QPOS_K_COORD(k);
+        double *x = (double *)u;
+        __m256d lo = nymya_qpos_i64_to_pd_avx2(_mm256_maskload_epi64(fp, mask_lo));
+        __m256d hi = nymya_qpos_i64_to_pd_avx2(_mm256_maskload_epi64(fp + 4, mask_hi));
+
+        nymya_qpos_qubit_from_k((const nymya_qubit_k *)k, NYMYA_QPOS_U_QUBIT(u, s));
+        _mm256_maskstore_pd(x, mask_lo, _mm256_mul_pd(lo, inv_scale));
+        _mm256_maskstore_pd(x + 4, mask_hi, _mm256_mul_pd(hi, inv_scale));
+    }
+}
+
+/*
+ * AVX-512DQ converts between double and int64 directly, truncating and
+ * rounding as the scalar casts do, so every element fits one masked
+ * register and no range needs the scalar path.
+ */
+__attribute__((target("avx512f,avx512dq")))
+static void nymya_qpos_encode_avx512(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    const __m512d scale = _mm512_set1_pd((double)FIXED_POINT_SCALE);
+    const __mmask8 mask = (__mmask8)((1u << s->dims) - 1);
+
+    for (size_t i = 0; i < count; i++, u += s->u_size, k += s->k_size) {
+        __m512d x = _mm512_maskz_loadu_pd(mask, u);
+
+        nymya_qpos_qubit_to_k(NYMYA_QPOS_U_QUBIT(u, s), (nymya_qubit_k *)k);
+        _mm512_mask_storeu_epi64(NYMYA_QPOS_K_COORD(k), mask, _mm512_cvttpd_epi64(_mm512_mul_pd(x, scale)));
+    }
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static void nymya_qpos_decode_avx512(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    const __m512d inv_scale = _mm512_set1_pd(1.0 / FIXED_POINT_SCALE);
+    const __mmask8 mask = (__mmask8)((1u << s->dims) - 1);
+
+    for (size_t i = 0; i < count; i++, u += s->u_size, k += s->k_size) {
+        __m512i fp = _mm512_maskz_loadu_epi64(mask, NYMYA_QPOS_K_COORD(k));
+
+        nymya_qpos_qubit_from_k((const nymya_qubit_k *)k, NYMYA_QPOS_U_QUBIT(u, s));
+        _mm512_mask_storeu_pd(u, mask, _mm512_mul_pd(_mm512_cvtepi64_pd(fp), inv_scale));
+    }
+}
+
+// Best converters for this CPU; the ifunc resolvers, so only compiler builtins
+static nymya_qpos_fn nymya_qpos_encode_resolve(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) return nymya_qpos_encode_avx512;
+    if (__builtin_cpu_supports("avx2")) return nymya_qpos_encode_avx2;
+    return nymya_qpos_encode_scalar;
+}
+
+static nymya_qpos_fn nymya_qpos_decode_resolve(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) return nymya_qpos_decode_avx512;
+    if (__builtin_cpu_supports("avx2")) return nymya_qpos_decode_avx2;
+    return nymya_qpos_decode_scalar;
+}
+#endif // NYMYA_QPOS_X86
+
+#ifdef NYMYA_QPOS_NEON
+// fcvtzs truncates like the scalar cast; scvtf rounds like the scalar cast
+static void nymya_qpos_encode_neon(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    const float64x2_t scale = vdupq_n_f64((double)FIXED_POINT_SCALE);
+
+    for (size_t i = 0; i < count; i++, u += s->u_size, k += s->k_size) {
+        const double *x = (const double *)u;
+        int64_t *fp = NYMYA_QPOS_K_COORD(k);
+        unsigned int d;
+
+        nymya_qpos_qubit_to_k(NYMYA_QPOS_U_QUBIT(u, s), (nymya_qubit_k *)k);
+        for (d = 0; d + 2 <= s->dims; d += 2)
+            vst1q_s64(fp + d, vcvtq_s64_f64(vmulq_f64(vld1q_f64(x + d), scale)));
+        if (d < s->dims)
+            fp[d] = (int64_t)(x[d] * FIXED_POINT_SCALE);
+    }
+}
+
+static void nymya_qpos_decode_neon(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    const float64x2_t inv_scale = vdupq_n_f64(1.0 / FIXED_POINT_SCALE);
+
+    for (size_t i = 0; i < count; i++, u += s->u_size, k += s->k_size) {
+        const int64_t *fp = NYMYA_QPOS_K_COORD(k);
+        double *x = (double *)u;
+        unsigned int d;
+
+        nymya_qpos_qubit_from_k((const nymya_qubit_k *)k, NYMYA_QPOS_U_QUBIT(u, s));
+        for (d = 0; d + 2 <= s->dims; d += 2)
+            vst1q_f64(x + d, vmulq_f64(vcvtq_f64_s64(vld1q_s64(fp + d)), inv_scale));
+        if (d < s->dims)
+            x[d] = (double)fp[d] / FIXED_POINT_SCALE;
+    }
+}
+#endif // NYMYA_QPOS_NEON
+
+#if defined(NYMYA_QPOS_X86) && defined(NYMYA_HAVE_IFUNC)
+static void nymya_qpos_encode_run(const nymya_qpos_shape *s, char *u, char *k, size_t count)
+    NYMYA_IFUNC(nymya_qpos_encode_resolve);
+static void nymya_qpos_decode_run(const nymya_qpos_shape *s, char *u, char *k, size_t count)
+    NYMYA_IFUNC(nymya_qpos_decode_resolve);
+#elif defined(NYMYA_QPOS_X86)
+static nymya_qpos_fn nymya_qpos_encode_best;
+static nymya_qpos_fn nymya_qpos_decode_best;
+
+static void nymya_qpos_encode_run(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    nymya_qpos_fn fn = __atomic_load_n(&nymya_qpos_encode_best, __ATOMIC_ACQUIRE);
+
+    if (!fn) {
+        fn = nymya_qpos_encode_resolve();
+        __atomic_store_n(&nymya_qpos_encode_best, fn, __ATOMIC_RELEASE);
+    }
+    fn(s, u, k, count);
+}
+
+static void nymya_qpos_decode_run(const nymya_qpos_shape *s, char *u, char *k, size_t count) {
+    nymya_qpos_fn fn = __atomic_load_n(&nymya_qpos_decode_best, __ATOMIC_ACQUIRE);
+
+    if (!fn) {
+        fn = nymya_qpos_decode_resolve();
+        __atomic_store_n(&nymya_qpos_decode_best, fn, __ATOMIC_RELEASE);
+    }
+    fn(s, u, k, count);
+}
+#elif defined(NYMYA_QPOS_NEON)
+#define nymya_qpos_encode_run nymya_qpos_encode_neon
+#define nymya_qpos_decode_run nymya_qpos_decode_neon
+#else
+#define nymya_qpos_encode_run nymya_qpos_encode_scalar
+#define nymya_qpos_decode_run nymya_qpos_decode_scalar
+#endif
+
+static void nymya_qpos_encode(const nymya_qpos_shape *s, const void *src, void *dst, size_t count) {
+    nymya_qpos_encode_run(s, (char *)src, (char *)dst, count);
+}
+
+static void nymya_qpos_decode(const nymya_qpos_shape *s, const void *src, void *dst, size_t count) {
+    nymya_qpos_decode_run(s, (char *)dst, (char *)src, count);
+}
+
+/**
+ * nymya_qpos3d_to_k - Converts 3D positions to their Q32.32 kernel layout.
+ * @src: Userland positions.
+ * @dst: Kernel-layout output, @count entries.
+ * @count: Number of positions.
+ */
+void nymya_qpos3d_to_k(const nymya_qpos3d *src, nymya_qpos3d_k *dst, size_t count) {
+    nymya_qpos_encode(&nymya_qpos3d_shape, src, dst, count);
+}
+
+/**
+ * nymya_qpos3d_from_k - Converts Q32.32 kernel-layout 3D positions back to doubles.
+ * @src: Kernel-layout positions.
+ * @dst: Userland output, @count entries.
+ * @count: Number of positions.
+ */
+void nymya_qpos3d_from_k(const nymya_qpos3d_k *src, nymya_qpos3d *dst, size_t count) {
+    nymya_qpos_decode(&nymya_qpos3d_shape, src, dst, count);
+}
+
+/**
+ * nymya_qpos4d_to_k - Converts 4D positions to their Q32.32 kernel layout.
+ * @src: Userland positions.
+ * @dst: Kernel-layout output, @count entries.
+ * @count: Number of positions.
+ */
+void nymya_qpos4d_to_k(const nymya_qpos4d *src, nymya_qpos4d_k *dst, size_t count) {
+    nymya_qpos_encode(&nymya_qpos4d_shape, src, dst, count);
+}
+
+/**
+ * nymya_qpos4d_from_k - Converts Q32.32 kernel-layout 4D positions back to doubles.
+ * @src: Kernel-layout positions.
+ * @dst: Userland output, @count entries.
+ * @count: Number of positions.
+ */
+void nymya_qpos4d_from_k(const nymya_qpos4d_k *src, nymya_qpos4d *dst, size_t count) {
+    nymya_qpos_decode(&nymya_qpos4d_shape, src, dst, count);
+}
+
+/**
+ * nymya_qpos5d_to_k - Converts 5D positions to their Q32.32 kernel layout.
+ * @src: Userland positions.
+ * @dst: Kernel-layout output, @count entries.
+ * @count: Number of positions.
+ */
+void nymya_qpos5d_to_k(const nymya_qpos5d *src, nymya_qpos5d_k *dst, size_t count) {
+    nymya_qpos_encode(&nymya_qpos5d_shape, src, dst, count);
+}
+
+/**
+ * nymya_qpos5d_from_k - Converts Q32.32 kernel-layout 5D positions back to doubles.
+ * @src: Kernel-layout positions.
+ * @dst: Userland output, @count entries.
+ * @count: Number of positions.
+ */
+void nymya_qpos5d_from_k(const nymya_qpos5d_k *src, nymya_qpos5d *dst, size_t count) {
+    nymya_qpos_decode(&nymya_qpos5d_shape, src, dst, count);
+}
+
+#endif // __KERNEL__
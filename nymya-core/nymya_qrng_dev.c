@@ -0,0 +1,474 @@
+// src/nymya_qrng_dev.c
+//
+// /dev/nymya_qrng: streaming QRNG output. read() fills user buffers with
+// values from nymya_qrng_fill(), raw words by default or mapped into the
+// range set with NYMYA_QRNG_SET_RANGE. For consumers that want values
+// without a syscall each time, NYMYA_QRNG_SETUP allocates a ring of values
+// in a vmalloc_user() area that userland mmaps; a producer work item, queued
+// on the consumer's CPU by NYMYA_QRNG_REFILL, keeps it topped up.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#define NYMYA_QRNG_DEVICE "/dev/nymya_qrng"
+
+/**
+ * nymya_qrng_open - Opens /dev/nymya_qrng and maps a ring of values in [@min, @max].
+ * @q: Handle to initialise.
+ * @entries: Requested ring slots.
+ * @min: Smallest value returned (inclusive).
+ * @max: Largest value returned (inclusive).
+ *
+ * The ring comes back full.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_qrng_open(nymya_qrng *q, uint32_t entries, uint64_t min, uint64_t max) {
+    nymya_qrng_range r = { .min = min, .max = max };
+    nymya_qrng_params p;
+    int saved;
+
+    if (!q || entries == 0 || min > max) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(q, 0, sizeof(*q));
+    q->fd = open(NYMYA_QRNG_DEVICE, O_RDWR | O_CLOEXEC);
+    if (q->fd < 0) return -1;
+
+    if (ioctl(q->fd, NYMYA_QRNG_SET_RANGE, &r) < 0) goto fail;
+
+    memset(&p, 0, sizeof(p));
+    p.entries = entries;
+    if (ioctl(q->fd, NYMYA_QRNG_SETUP, &p) < 0) goto fail;
+
+    q->mem = mmap(NULL, p.ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, q->fd, 0);
+    if (q->mem == MAP_FAILED) {
+        q->mem = NULL;
+        goto fail;
+    }
+
+    q->mem_bytes = p.ring_bytes;
+    q->hdr = q->mem;
+    q->vals = (const uint64_t *)((char *)q->mem + p.off);
+    q->mask = p.entries - 1;
+    return 0;
+
+fail:
+    saved = errno;
+    close(q->fd);
+    q->fd = -1;
+    errno = saved;
+    return -1;
+}
+
+/**
+ * nymya_qrng_close - Unmaps the ring and closes the device.
+ * @q: Handle from nymya_qrng_open().
+ */
+void nymya_qrng_close(nymya_qrng *q) {
+    if (!q) return;
+    if (q->mem) munmap(q->mem, q->mem_bytes);
+    if (q->fd >= 0) close(q->fd);
+    memset(q, 0, sizeof(*q));
+    q->fd = -1;
+}
+
+/**
+ * nymya_qrng_take - Copies @count values off the ring.
+ * @q: Open ring.
+ * @out: Receives the values.
+ * @count: Number of values.
+ *
+ * Values already in the ring cost no syscall. Once the ring drops below
+ * half full the producer is kicked without waiting; only an empty ring
+ * waits for it.
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_qrng_take(nymya_qrng *q, uint64_t *out, size_t count) {
+    uint32_t head, tail, avail, n, slot, first;
+
+    if (!q || !q->hdr || (!out && count)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (count) {
+        head = q->hdr->head;
+        tail = __atomic_load_n(&q->hdr->tail, __ATOMIC_ACQUIRE);
+        avail = tail - head;
+        if (avail == 0) {
+            if (ioctl(q->fd, NYMYA_QRNG_REFILL, 1UL) < 0) return -1;
+            continue;
+        }
+
+        n = count < avail ? (uint32_t)count : avail;
+        slot = head & q->mask;
+        first = n < q->mask + 1 - slot ? n : q->mask + 1 - slot;
+        memcpy(out, q->vals + slot, first * sizeof(*out));
+        memcpy(out + first, q->vals, (n - first) * sizeof(*out));
+        __atomic_store_n(&q->hdr->head, head + n, __ATOMIC_RELEASE);
+
+        out += n;
+        count -= n;
+        if (avail - n <= q->mask / 2 && ioctl(q->fd, NYMYA_QRNG_REFILL, 0UL) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+#else // __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mutex.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/smp.h>
+#include <linux/uio.h>
+#include <linux/workqueue.h>
+#include <linux/uaccess.h>
+
+/**
+ * struct nymya_qrng_ctx - Per-open QRNG state.
+ * @lock: Serialises range changes, setup, mmap and the producer.
+ * @min: Smallest value returned.
+ * @max: Largest value returned.
+ * @mem: vmalloc_user() ring shared with userland; NULL until NYMYA_QRNG_SETUP.
+ * @bytes: Size of @mem.
+ * @hdr: Shared index block at the start of @mem.
+ * @vals: Value array inside @mem.
+ * @tail: Kernel-private copy of hdr->tail.
+ * @mask: entries - 1.
+ * @refill: Producer; fills the free slots of the ring.
+ *
+ * As for /dev/nymya_ring, the kernel-owned index is kept privately so that
+ * userland scribbling on the shared header cannot move it.
+ */
+struct nymya_qrng_ctx {
+    struct mutex lock;
+    u64 min;
+    u64 max;
+    void *mem;
+    size_t bytes;
+    nymya_qrng_hdr *hdr;
+    u64 *vals;
+    u32 tail;
+    u32 mask;
+    struct work_struct refill;
+};
+
+/**
+ * nymya_qrng_produce - Fills every free slot of the ring.
+ * @ctx: QRNG state with the ring set up; @ctx->lock held.
+ *
+ * A head userland has moved past the tail counts as an empty ring.
+ */
+static void nymya_qrng_produce(struct nymya_qrng_ctx *ctx)
+{
+    u32 entries = ctx->mask + 1;
+    u32 head = smp_load_acquire(&ctx->hdr->head);
+    u32 used = ctx->tail - head;
+    u32 free = used > entries ? entries : entries - used;
+    u32 slot, n;
+
+    while (free) {
+        slot = ctx->tail & ctx->mask;
+        n = min(free, entries - slot);
+        nymya_qrng_fill(ctx->vals + slot, n, ctx->min, ctx->max);
+        ctx->tail += n;
+        free -= n;
+    }
+    smp_store_release(&ctx->hdr->tail, ctx->tail);
+}
+
+static void nymya_qrng_refill_work(struct work_struct *work)
+{
+    struct nymya_qrng_ctx *ctx = container_of(work, struct nymya_qrng_ctx, refill);
+
+    mutex_lock(&ctx->lock);
+    nymya_qrng_produce(ctx);
+    mutex_unlock(&ctx->lock);
+}
+
+static int nymya_qrng_open(struct inode *inode, struct file *file)
+{
+    struct nymya_qrng_ctx *ctx = kzalloc(sizeof(*ctx), GFP_KERNEL_ACCOUNT);
+
+    if (!ctx)
+        return -ENOMEM;
+
+    mutex_init(&ctx->lock);
+    INIT_WORK(&ctx->refill, nymya_qrng_refill_work);
+    ctx->max = U64_MAX;
+    file->private_data = ctx;
+    return 0;
+}
+
+static int nymya_qrng_release(struct inode *inode, struct file *file)
+{
+    struct nymya_qrng_ctx *ctx = file->private_data;
+
+    cancel_work_sync(&ctx->refill);
+    vfree(ctx->mem);
+    mutex_destroy(&ctx->lock);
+    kfree(ctx);
+    return 0;
+}
+
+/**
+ * nymya_qrng_read_iter - Reads values from the file's range.
+ * @iocb: I/O control block of the read.
+ * @to: Destination.
+ *
+ * Raw words go straight to the destination through get_random_bytes_user().
+ * A narrower range is generated NYMYA_QRNG_CHUNK values at a time into a
+ * staging buffer and then only returns whole values.
+ *
+ * Returns the bytes read, -EINVAL for a ranged read shorter than one value,
+ * -ENOMEM, or -EFAULT if nothing could be copied.
+ */
+static ssize_t nymya_qrng_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    struct nymya_qrng_ctx *ctx = iocb->ki_filp->private_data;
+    size_t count = iov_iter_count(to) / sizeof(u64);
+    size_t done = 0, n, bytes;
+    u64 min, max, *buf;
+
+    mutex_lock(&ctx->lock);
+    min = ctx->min;
+    max = ctx->max;
+    mutex_unlock(&ctx->lock);
+
+    if (min == 0 && max == U64_MAX)
+        return get_random_bytes_user(to);
+    if (!count)
+        return -EINVAL;
+
+    buf = nymya_stage_alloc(3361, min_t(size_t, count, NYMYA_QRNG_CHUNK), sizeof(*buf));
+    if (!buf)
+        return -ENOMEM;
+
+    while (done < count) {
+        n = min_t(size_t, count - done, NYMYA_QRNG_CHUNK);
+        nymya_qrng_fill(buf, n, min, max);
+        bytes = copy_to_iter(buf, n * sizeof(*buf), to);
+        done += bytes / sizeof(*buf);
+        if (bytes != n * sizeof(*buf) || (done < count && signal_pending(current)))
+            break;
+        cond_resched();
+    }
+
+    nymya_stage_free(buf);
+    return done ? done * sizeof(*buf) : -EFAULT;
+}
+
+/**
+ * nymya_qrng_set_range - Handles NYMYA_QRNG_SET_RANGE.
+ * @ctx: QRNG state of the open file.
+ * @urange: User pointer to nymya_qrng_range.
+ *
+ * Returns 0 on success, -EINVAL if min > max, -EBUSY once the ring is set
+ * up, or -EFAULT.
+ */
+static long nymya_qrng_set_range(struct nymya_qrng_ctx *ctx, nymya_qrng_range __user *urange)
+{
+    nymya_qrng_range r;
+    long ret = 0;
+
+    if (copy_from_user(&r, urange, sizeof(r)))
+        return -EFAULT;
+    if (r.min > r.max)
+        return -EINVAL;
+
+    mutex_lock(&ctx->lock);
+    if (ctx->mem) {
+        ret = -EBUSY;
+    } else {
+        ctx->min = r.min;
+        ctx->max = r.max;
+    }
+    mutex_unlock(&ctx->lock);
+
+    return ret;
+}
+
+/**
+ * nymya_qrng_setup - Handles NYMYA_QRNG_SETUP.
+ * @ctx: QRNG state of the open file.
+ * @uparams: User pointer to nymya_qrng_params.
+ *
+ * Returns:
+ * - 0 on success, with the ring full.
+ * - -EBUSY if the ring was already set up.
+ * - -EINVAL on an out-of-range size.
+ * - -ENOMEM if the shared area cannot be allocated.
+ * - -EFAULT on copy failures.
+ */
+static long nymya_qrng_setup(struct nymya_qrng_ctx *ctx, nymya_qrng_params __user *uparams)
+{
+    nymya_qrng_params p;
+    size_t off, bytes;
+    u32 entries;
+    void *mem;
+
+    if (copy_from_user(&p, uparams, sizeof(p)))
+        return -EFAULT;
+    if (p.entries == 0 || p.entries > NYMYA_QRNG_MAX_ENTRIES)
+        return -EINVAL;
+
+    entries = roundup_pow_of_two(p.entries);
+    // Keep the index block and the values on separate cache lines
+    off = ALIGN(sizeof(nymya_qrng_hdr), SMP_CACHE_BYTES);
+    bytes = PAGE_ALIGN(off + (size_t)entries * sizeof(u64));
+
+    mutex_lock(&ctx->lock);
+    if (ctx->mem) {
+        mutex_unlock(&ctx->lock);
+        return -EBUSY;
+    }
+
+    mem = vmalloc_user(bytes);
+    if (!mem) {
+        mutex_unlock(&ctx->lock);
+        return -ENOMEM;
+    }
+
+    ctx->mem = mem;
+    ctx->bytes = bytes;
+    ctx->hdr = mem;
+    ctx->vals = (u64 *)((char *)mem + off);
+    ctx->mask = entries - 1;
+    ctx->hdr->entries = entries;
+    ctx->hdr->off = off;
+    nymya_qrng_produce(ctx);
+    mutex_unlock(&ctx->lock);
+
+    p.entries = entries;
+    p.off = off;
+    p.ring_bytes = bytes;
+    if (copy_to_user(uparams, &p, sizeof(p)))
+        return -EFAULT;
+
+    return 0;
+}
+
+/**
+ * nymya_qrng_refill - Handles NYMYA_QRNG_REFILL.
+ * @ctx: QRNG state of the open file.
+ * @wait: Nonzero to return only once the producer has run.
+ *
+ * The producer runs on the calling CPU, so the values land in the cache the
+ * consumer reads them from.
+ *
+ * Returns 0, or -EINVAL before setup.
+ */
+static long nymya_qrng_refill(struct nymya_qrng_ctx *ctx, unsigned long wait)
+{
+    if (!READ_ONCE(ctx->mem))
+        return -EINVAL;
+
+    queue_work_on(raw_smp_processor_id(), system_highpri_wq, &ctx->refill);
+    if (wait)
+        flush_work(&ctx->refill);
+    return 0;
+}
+
+static long nymya_qrng_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct nymya_qrng_ctx *ctx = file->private_data;
+
+    switch (cmd) {
+    case NYMYA_QRNG_SET_RANGE:
+        return nymya_qrng_set_range(ctx, (nymya_qrng_range __user *)arg);
+    case NYMYA_QRNG_SETUP:
+        return nymya_qrng_setup(ctx, (nymya_qrng_params __user *)arg);
+    case NYMYA_QRNG_REFILL:
+        return nymya_qrng_refill(ctx, arg);
+    default:
+        return -ENOTTY;
+    }
+}
+
+/**
+ * nymya_qrng_mmap - Maps the value ring of this file.
+ * @file: Open /dev/nymya_qrng file.
+ * @vma: Target mapping; must start at offset 0 and not exceed ring_bytes.
+ *
+ * Returns 0 on success, -EINVAL before setup or on a bad offset/size.
+ */
+static int nymya_qrng_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct nymya_qrng_ctx *ctx = file->private_data;
+    unsigned long size = vma->vm_end - vma->vm_start;
+    int ret;
+
+    mutex_lock(&ctx->lock);
+    if (!ctx->mem || vma->vm_pgoff || size > ctx->bytes)
+        ret = -EINVAL;
+    else
+        ret = remap_vmalloc_range(vma, ctx->mem, 0);
+    mutex_unlock(&ctx->lock);
+
+    return ret;
+}
+
+static const struct file_operations nymya_qrng_fops = {
+    .owner          = THIS_MODULE,
+    .open           = nymya_qrng_open,
+    .release        = nymya_qrng_release,
+    .read_iter      = nymya_qrng_read_iter,
+    .unlocked_ioctl = nymya_qrng_ioctl,
+    .compat_ioctl   = compat_ptr_ioctl,
+    .mmap           = nymya_qrng_mmap,
+    .llseek         = noop_llseek,
+};
+
+static struct miscdevice nymya_qrng_dev = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name  = "nymya_qrng",
+    .fops  = &nymya_qrng_fops,
+    .mode  = 0666,
+};
+
+/**
+ * nymya_qrng_dev_init - Registers /dev/nymya_qrng.
+ *
+ * Returns 0 on success or the error code from misc_register().
+ */
+int nymya_qrng_dev_init(void)
+{
+    int ret = misc_register(&nymya_qrng_dev);
+
+    if (ret)
+        pr_err("nymya_qrng_dev_init: misc_register failed, error %d\n", ret);
+    return ret;
+}
+
+/**
+ * nymya_qrng_dev_exit - Unregisters /dev/nymya_qrng.
+ */
+void nymya_qrng_dev_exit(void)
+{
+    misc_deregister(&nymya_qrng_dev);
+}
+
+#endif // __KERNEL__
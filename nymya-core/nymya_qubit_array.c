@@ -0,0 +1,127 @@
+// src/nymya_qubit_array.c
+//
+// Marshalling helpers for syscalls that take an array of user-space qubit
+// pointers (struct nymya_qubit __user *[]), such as the tessellation and
+// sacred-geometry lattices. All kernel copies live in one allocation: the
+// qubit structures, the kernel pointer array handed to the *_core function,
+// and the saved user pointers used for the copy back.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+/**
+ * nymya_qubit_ptrs_from_user - Copies a user array of qubit pointers and their qubits in.
+ * @arr: Array state to fill; released with nymya_qubit_ptrs_free().
+ * @user_q_array: User-space array of @count user-space qubit pointers.
+ * @count: Number of qubits.
+ * @code: Gate code of the caller, for the marshalling statistics.
+ * @who: Caller name used in error messages.
+ *
+ * On success @arr->k_qubits[i] points at the kernel copy of the qubit that
+ * user_q_array[i] points to, in a single contiguous buffer.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -EINVAL if @count is zero or too large, or any user qubit pointer is NULL.
+ * - -ENOMEM if the buffer cannot be allocated.
+ * - -EFAULT on copy failures.
+ */
+int nymya_qubit_ptrs_from_user(struct nymya_qubit_ptr_array *arr,
+                               struct nymya_qubit __user * __user *user_q_array,
+                               size_t count, u32 code, const char *who)
+{
+    const size_t per_qubit = sizeof(struct nymya_qubit) +
+                             sizeof(struct nymya_qubit *) +
+                             sizeof(struct nymya_qubit __user *);
+    size_t bytes, i;
+    int ret;
+
+    memset(arr, 0, sizeof(*arr));
+
+    if (count == 0 || check_mul_overflow(count, per_qubit, &bytes))
+        return -EINVAL;
+
+    // One allocation: [qubits][kernel pointers][user pointers]
+    arr->qubits = nymya_stage_alloc(code, 1, bytes);
+    if (!arr->qubits) {
+        pr_err("%s: Failed to allocate buffer for %zu qubits\n", who, count);
+        return -ENOMEM;
+    }
+    arr->k_qubits = (struct nymya_qubit **)(arr->qubits + count);
+    arr->user_ptrs = (struct nymya_qubit __user **)(arr->k_qubits + count);
+    arr->count = count;
+
+    if (nymya_copy_from_user(code, arr->user_ptrs, user_q_array, count * sizeof(*arr->user_ptrs))) {
+        pr_err("%s: Failed to copy user qubit pointers array\n", who);
+        ret = -EFAULT;
+        goto fail;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!arr->user_ptrs[i]) {
+            pr_err("%s: Null individual user qubit pointer at index %zu\n", who, i);
+            ret = -EINVAL;
+            goto fail;
+        }
+        if (nymya_copy_from_user(code, &arr->qubits[i], arr->user_ptrs[i], sizeof(struct nymya_qubit))) {
+            pr_err("%s: Failed to copy k_qubit[%zu] data from user\n", who, i);
+            ret = -EFAULT;
+            goto fail;
+        }
+        arr->k_qubits[i] = &arr->qubits[i];
+    }
+
+    return 0;
+
+fail:
+    nymya_qubit_ptrs_free(arr);
+    return ret;
+}
+EXPORT_SYMBOL_GPL(nymya_qubit_ptrs_from_user);
+
+/**
+ * nymya_qubit_ptrs_to_user - Copies every kernel qubit back to its user pointer.
+ * @arr: Array state filled by nymya_qubit_ptrs_from_user().
+ * @code: Gate code of the caller, for the marshalling statistics.
+ * @who: Caller name used in error messages.
+ *
+ * Keeps copying after a failure so that as many qubits as possible are
+ * written back, matching the behaviour of the per-qubit copy loops.
+ *
+ * Returns 0 on success or -EFAULT if any copy failed.
+ */
+int nymya_qubit_ptrs_to_user(const struct nymya_qubit_ptr_array *arr, u32 code, const char *who)
+{
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < arr->count; i++) {
+        if (nymya_copy_to_user(code, arr->user_ptrs[i], &arr->qubits[i], sizeof(struct nymya_qubit))) {
+            pr_err("%s: Failed to copy k_qubit[%zu] to user\n", who, i);
+            ret = -EFAULT;
+        }
+    }
+
+    return ret;
+}
+EXPORT_SYMBOL_GPL(nymya_qubit_ptrs_to_user);
+
+/**
+ * nymya_qubit_ptrs_free - Releases the buffer of a qubit pointer array.
+ * @arr: Array state; safe to call on a zeroed or already freed one.
+ */
+void nymya_qubit_ptrs_free(struct nymya_qubit_ptr_array *arr)
+{
+    nymya_stage_free(arr->qubits);
+    memset(arr, 0, sizeof(*arr));
+}
+EXPORT_SYMBOL_GPL(nymya_qubit_ptrs_free);
+
+#endif // __KERNEL__
@@ -0,0 +1,161 @@
+// src/nymya_quota.c
+//
+// Per-process caps on the kernel memory a caller of nymya_core.ko can hold,
+// so that one tenant of a shared box cannot take the module's memory from
+// the rest. Two kinds of memory are counted for each thread group:
+//
+//   NYMYA_QUOTA_REG    registers held in the module: the mmap'd /dev/nymya
+//                      register and the NYMYA_KREG_* registers
+//                      (quota_reg_bytes)
+//   NYMYA_QUOTA_STAGE  syscall staging buffers in flight, see
+//                      nymya_stage_alloc() (quota_stage_bytes)
+//
+// Both caps are module parameters, writable at run time under
+// /sys/module/nymya_core/parameters/, and apply to every process alike. A
+// cap of 0, the default, leaves its kind uncounted, so an unlimited box
+// pays no lookup. A process has an entry only while it holds charged
+// memory: every charge takes a reference and every uncharge drops one, so
+// no exit hook is needed. Memory stays charged to the process that
+// allocated it, even when another one releases it, such as a register on a
+// file descriptor that was passed on.
+//
+// These caps bound each process. The memory cgroup bounds groups of them:
+// the module's per-caller allocations use GFP_KERNEL_ACCOUNT, so they are
+// charged to the caller's cgroup as well.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/hashtable.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+static unsigned long quota_reg_bytes;
+module_param(quota_reg_bytes, ulong, 0644);
+MODULE_PARM_DESC(quota_reg_bytes, "Most register bytes one process may hold in the module (0 for no limit)");
+
+static unsigned long quota_stage_bytes;
+module_param(quota_stage_bytes, ulong, 0644);
+MODULE_PARM_DESC(quota_stage_bytes, "Most syscall staging bytes one process may have in flight (0 for no limit)");
+
+/**
+ * struct nymya_quota - Memory one thread group holds, by kind.
+ * @node: Link in nymya_quota_table.
+ * @tgid: Thread group the entry counts for.
+ * @refs: Charges not yet uncharged; the entry goes away at zero.
+ * @bytes: Bytes charged, by enum nymya_quota_kind.
+ */
+struct nymya_quota {
+    struct hlist_node node;
+    pid_t tgid;
+    unsigned long refs;
+    size_t bytes[NYMYA_QUOTA_KINDS];
+};
+
+static DEFINE_HASHTABLE(nymya_quota_table, 6);
+static DEFINE_SPINLOCK(nymya_quota_lock);
+
+static unsigned long nymya_quota_limit(enum nymya_quota_kind kind)
+{
+    return kind == NYMYA_QUOTA_REG ? READ_ONCE(quota_reg_bytes) : READ_ONCE(quota_stage_bytes);
+}
+
+// Entry of @tgid, or NULL; called with nymya_quota_lock held
+static struct nymya_quota *nymya_quota_find(pid_t tgid)
+{
+    struct nymya_quota *q;
+
+    hash_for_each_possible(nymya_quota_table, q, node, tgid)
+        if (q->tgid == tgid)
+            return q;
+    return NULL;
+}
+
+/**
+ * nymya_quota_charge - Charges memory to the calling process if its kind is capped.
+ * @kind: Kind of memory.
+ * @bytes: Bytes about to be allocated.
+ * @quota: Receives the entry to pass to nymya_quota_uncharge(), or NULL
+ *         when @kind has no cap and nothing was charged.
+ *
+ * Returns 0, -EDQUOT if the charge would take the process past the cap of
+ * @kind, or -ENOMEM if its entry cannot be allocated.
+ */
+int nymya_quota_charge(enum nymya_quota_kind kind, size_t bytes, struct nymya_quota **quota)
+{
+    unsigned long limit = nymya_quota_limit(kind);
+    struct nymya_quota *q, *fresh = NULL;
+    pid_t tgid = current->tgid;
+    int ret = 0;
+
+    *quota = NULL;
+    if (!limit)
+        return 0;
+    if (bytes > limit)
+        return -EDQUOT;
+
+    spin_lock(&nymya_quota_lock);
+    q = nymya_quota_find(tgid);
+    if (!q) {
+        // First charge of the process; allocate outside the lock and look again
+        spin_unlock(&nymya_quota_lock);
+        fresh = kzalloc(sizeof(*fresh), GFP_KERNEL_ACCOUNT);
+        if (!fresh)
+            return -ENOMEM;
+        spin_lock(&nymya_quota_lock);
+        q = nymya_quota_find(tgid);
+        if (!q) {
+            q = fresh;
+            fresh = NULL;
+            q->tgid = tgid;
+            hash_add(nymya_quota_table, &q->node, tgid);
+        }
+    }
+
+    if (q->bytes[kind] > limit - bytes) {
+        ret = -EDQUOT;
+        if (!q->refs) {
+            hash_del(&q->node);
+            fresh = q;
+        }
+    } else {
+        q->bytes[kind] += bytes;
+        q->refs++;
+        *quota = q;
+    }
+    spin_unlock(&nymya_quota_lock);
+
+    kfree(fresh);
+    return ret;
+}
+EXPORT_SYMBOL_GPL(nymya_quota_charge);
+
+/**
+ * nymya_quota_uncharge - Returns memory charged by nymya_quota_charge().
+ * @quota: Entry the charge returned, or NULL for an uncharged allocation.
+ * @kind: Kind given to the charge.
+ * @bytes: Bytes given to the charge.
+ */
+void nymya_quota_uncharge(struct nymya_quota *quota, enum nymya_quota_kind kind, size_t bytes)
+{
+    if (!quota)
+        return;
+
+    spin_lock(&nymya_quota_lock);
+    quota->bytes[kind] -= bytes;
+    if (--quota->refs)
+        quota = NULL;
+    else
+        hash_del(&quota->node);
+    spin_unlock(&nymya_quota_lock);
+
+    kfree(quota);
+}
+EXPORT_SYMBOL_GPL(nymya_quota_uncharge);
+
+#endif // __KERNEL__
@@ -0,0 +1,443 @@
+// src/nymya_ring.c
+//
+// Shared submission/completion rings between libnymya and nymya_core.ko.
+// Each open of /dev/nymya_ring owns one submission ring of nymya_sqe batches
+// and one completion ring of nymya_cqe results, both living in a single
+// vmalloc_user() area that userland mmaps. Userland queues batches with plain
+// stores and only enters the kernel (NYMYA_RING_ENTER) to have them run;
+// results are reaped from the completion ring without a syscall.
+//
+// Every batch is executed through nymya_3362_submit_user(), so a ring entry
+// behaves like one nymya_3362_submit() call, except that a signal never cuts
+// an entry short: NYMYA_RING_ENTER stops between entries instead.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#define NYMYA_RING_DEVICE "/dev/nymya_ring"
+
+/**
+ * nymya_ring_open - Opens /dev/nymya_ring, sizes the rings and maps them.
+ * @ring: Handle to initialise.
+ * @sq_entries: Requested submission slots.
+ * @cq_entries: Requested completion slots (0 for twice @sq_entries).
+ *
+ * Returns 0 on success, -1 on failure (errno is set).
+ */
+int nymya_ring_open(nymya_ring *ring, uint32_t sq_entries, uint32_t cq_entries) {
+    nymya_ring_params p;
+    int saved;
+
+    if (!ring || sq_entries == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = open(NYMYA_RING_DEVICE, O_RDWR | O_CLOEXEC);
+    if (ring->fd < 0) return -1;
+
+    memset(&p, 0, sizeof(p));
+    p.sq_entries = sq_entries;
+    p.cq_entries = cq_entries;
+    if (ioctl(ring->fd, NYMYA_RING_SETUP, &p) < 0) goto fail;
+
+    ring->mem = mmap(NULL, p.ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+    if (ring->mem == MAP_FAILED) {
+        ring->mem = NULL;
+        goto fail;
+    }
+
+    ring->mem_bytes = p.ring_bytes;
+    ring->hdr = ring->mem;
+    ring->sqes = (nymya_sqe *)((char *)ring->mem + p.sq_off);
+    ring->cqes = (nymya_cqe *)((char *)ring->mem + p.cq_off);
+    ring->sq_mask = p.sq_entries - 1;
+    ring->cq_mask = p.cq_entries - 1;
+    return 0;
+
+fail:
+    saved = errno;
+    close(ring->fd);
+    ring->fd = -1;
+    errno = saved;
+    return -1;
+}
+
+/**
+ * nymya_ring_close - Unmaps the rings and closes the device.
+ * @ring: Handle from nymya_ring_open().
+ *
+ * Batches still queued are discarded; ones already consumed have completed.
+ */
+void nymya_ring_close(nymya_ring *ring) {
+    if (!ring) return;
+    if (ring->mem) munmap(ring->mem, ring->mem_bytes);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+/**
+ * nymya_ring_queue - Queues one batch on the submission ring without a syscall.
+ * @ring: Open ring.
+ * @ops: Gate records of the batch.
+ * @op_count: Number of records.
+ * @qubits: Kernel-layout qubits the records index into; updated in place.
+ * @qubit_count: Number of qubits.
+ * @user_data: Value returned in the batch's completion.
+ *
+ * @ops and @qubits must stay valid until the completion is reaped.
+ *
+ * Returns 0 on success, -1 if the submission ring is full (errno EAGAIN)
+ * or the arguments are invalid (errno EINVAL).
+ */
+int nymya_ring_queue(nymya_ring *ring, const nymya_op *ops, uint32_t op_count,
+                     nymya_qubit_k *qubits, uint32_t qubit_count, uint64_t user_data) {
+    uint32_t tail, head;
+    nymya_sqe *sqe;
+
+    if (!ring || !ring->hdr || !ops || !qubits || op_count == 0 || qubit_count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    tail = ring->hdr->sq_tail;
+    head = __atomic_load_n(&ring->hdr->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head > ring->sq_mask) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    sqe = &ring->sqes[tail & ring->sq_mask];
+    sqe->user_data = user_data;
+    sqe->ops = (uint64_t)(uintptr_t)ops;
+    sqe->qubits = (uint64_t)(uintptr_t)qubits;
+    sqe->op_count = op_count;
+    sqe->qubit_count = qubit_count;
+
+    __atomic_store_n(&ring->hdr->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * nymya_ring_enter - Asks the kernel to run queued batches.
+ * @ring: Open ring.
+ * @to_submit: Maximum number of batches to consume.
+ *
+ * Consumption stops early when the completion ring is full; reap and retry.
+ *
+ * Returns the number of batches consumed, or -1 on error (errno is set).
+ */
+int nymya_ring_enter(nymya_ring *ring, uint32_t to_submit) {
+    if (!ring || ring->fd < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return ioctl(ring->fd, NYMYA_RING_ENTER, (unsigned long)to_submit);
+}
+
+/**
+ * nymya_ring_reap - Takes one completion off the completion ring.
+ * @ring: Open ring.
+ * @cqe: Receives the completion.
+ *
+ * Returns 1 if a completion was reaped, 0 if the ring is empty.
+ */
+int nymya_ring_reap(nymya_ring *ring, nymya_cqe *cqe) {
+    uint32_t head, tail;
+
+    if (!ring || !ring->hdr || !cqe) return 0;
+
+    head = ring->hdr->cq_head;
+    tail = __atomic_load_n(&ring->hdr->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) return 0;
+
+    *cqe = ring->cqes[head & ring->cq_mask];
+    __atomic_store_n(&ring->hdr->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+#else // __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mutex.h>
+#include <linux/sched/signal.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/uaccess.h>
+
+/**
+ * struct nymya_ring_ctx - Per-open ring state.
+ * @lock: Serialises setup, mmap and ring consumption.
+ * @mem: vmalloc_user() area shared with userland; NULL until NYMYA_RING_SETUP.
+ * @bytes: Size of @mem.
+ * @hdr: Shared index block at the start of @mem.
+ * @sqes: Submission array inside @mem.
+ * @cqes: Completion array inside @mem.
+ * @sq_head: Kernel-private copy of hdr->sq_head.
+ * @cq_tail: Kernel-private copy of hdr->cq_tail.
+ * @sq_mask: sq_entries - 1.
+ * @cq_mask: cq_entries - 1.
+ *
+ * The kernel-owned indices are kept privately so that userland scribbling on
+ * the shared header cannot move them; they are only published to it.
+ */
+struct nymya_ring_ctx {
+    struct mutex lock;
+    void *mem;
+    size_t bytes;
+    nymya_ring_hdr *hdr;
+    nymya_sqe *sqes;
+    nymya_cqe *cqes;
+    uint32_t sq_head;
+    uint32_t cq_tail;
+    uint32_t sq_mask;
+    uint32_t cq_mask;
+};
+
+static int nymya_ring_open(struct inode *inode, struct file *file)
+{
+    struct nymya_ring_ctx *ctx = kzalloc(sizeof(*ctx), GFP_KERNEL_ACCOUNT);
+
+    if (!ctx)
+        return -ENOMEM;
+
+    mutex_init(&ctx->lock);
+    file->private_data = ctx;
+    return 0;
+}
+
+static int nymya_ring_release(struct inode *inode, struct file *file)
+{
+    struct nymya_ring_ctx *ctx = file->private_data;
+
+    vfree(ctx->mem);
+    mutex_destroy(&ctx->lock);
+    kfree(ctx);
+    return 0;
+}
+
+/**
+ * nymya_ring_setup - Handles NYMYA_RING_SETUP.
+ * @ctx: Ring state of the open file.
+ * @uparams: User pointer to nymya_ring_params.
+ *
+ * Returns:
+ * - 0 on success.
+ * - -EBUSY if the rings were already set up.
+ * - -EINVAL on out-of-range sizes.
+ * - -ENOMEM if the shared area cannot be allocated.
+ * - -EFAULT on copy failures.
+ */
+static long nymya_ring_setup(struct nymya_ring_ctx *ctx, nymya_ring_params __user *uparams)
+{
+    nymya_ring_params p;
+    uint32_t sq, cq;
+    size_t sq_off, cq_off, bytes;
+    void *mem;
+
+    if (copy_from_user(&p, uparams, sizeof(p)))
+        return -EFAULT;
+
+    if (p.sq_entries == 0 || p.sq_entries > NYMYA_RING_MAX_ENTRIES ||
+        p.cq_entries > NYMYA_RING_MAX_ENTRIES)
+        return -EINVAL;
+
+    sq = roundup_pow_of_two(p.sq_entries);
+    cq = p.cq_entries ? roundup_pow_of_two(p.cq_entries)
+                      : min_t(uint32_t, 2 * sq, NYMYA_RING_MAX_ENTRIES);
+    if (cq < sq)
+        return -EINVAL;
+
+    // Keep the index block and both arrays on separate cache lines
+    sq_off = ALIGN(sizeof(nymya_ring_hdr), SMP_CACHE_BYTES);
+    cq_off = ALIGN(sq_off + sq * sizeof(nymya_sqe), SMP_CACHE_BYTES);
+    bytes = PAGE_ALIGN(cq_off + cq * sizeof(nymya_cqe));
+
+    mutex_lock(&ctx->lock);
+    if (ctx->mem) {
+        mutex_unlock(&ctx->lock);
+        return -EBUSY;
+    }
+
+    mem = vmalloc_user(bytes);
+    if (!mem) {
+        mutex_unlock(&ctx->lock);
+        return -ENOMEM;
+    }
+
+    ctx->mem = mem;
+    ctx->bytes = bytes;
+    ctx->hdr = mem;
+    ctx->sqes = (nymya_sqe *)((char *)mem + sq_off);
+    ctx->cqes = (nymya_cqe *)((char *)mem + cq_off);
+    ctx->sq_mask = sq - 1;
+    ctx->cq_mask = cq - 1;
+    ctx->hdr->sq_entries = sq;
+    ctx->hdr->cq_entries = cq;
+    ctx->hdr->sq_off = sq_off;
+    ctx->hdr->cq_off = cq_off;
+    mutex_unlock(&ctx->lock);
+
+    p.sq_entries = sq;
+    p.cq_entries = cq;
+    p.sq_off = sq_off;
+    p.cq_off = cq_off;
+    p.ring_bytes = bytes;
+    if (copy_to_user(uparams, &p, sizeof(p)))
+        return -EFAULT;
+
+    return 0;
+}
+
+/**
+ * nymya_ring_enter - Handles NYMYA_RING_ENTER: runs queued batches in order.
+ * @ctx: Ring state of the open file.
+ * @to_submit: Maximum number of submissions to consume.
+ *
+ * Each consumed submission posts exactly one completion carrying the batch's
+ * return code. Consumption stops when the submission ring is empty, the
+ * completion ring is full, or @to_submit entries have been consumed, or,
+ * once at least one entry has run, when a signal is pending; the entries
+ * left stay queued for the next NYMYA_RING_ENTER. Each entry runs whole,
+ * yielding the CPU as nymya_3362_submit_run() does.
+ *
+ * Returns the number of submissions consumed, or -EINVAL before setup.
+ */
+static long nymya_ring_enter(struct nymya_ring_ctx *ctx, unsigned long to_submit)
+{
+    nymya_ring_hdr *hdr;
+    unsigned long done = 0;
+    uint32_t tail;
+
+    mutex_lock(&ctx->lock);
+    if (!ctx->mem) {
+        mutex_unlock(&ctx->lock);
+        return -EINVAL;
+    }
+    hdr = ctx->hdr;
+
+    tail = smp_load_acquire(&hdr->sq_tail);
+    while (done < to_submit && ctx->sq_head != tail) {
+        nymya_sqe sqe;
+        nymya_cqe *cqe;
+
+        if (ctx->cq_tail - smp_load_acquire(&hdr->cq_head) > ctx->cq_mask)
+            break;
+        if (done && signal_pending(current))
+            break;
+
+        // Snapshot the entry; userland may rewrite the slot at any time
+        memcpy(&sqe, &ctx->sqes[ctx->sq_head & ctx->sq_mask], sizeof(sqe));
+
+        cqe = &ctx->cqes[ctx->cq_tail & ctx->cq_mask];
+        cqe->user_data = sqe.user_data;
+        cqe->result = nymya_3362_submit_user(u64_to_user_ptr(sqe.ops), sqe.op_count,
+                                             u64_to_user_ptr(sqe.qubits), sqe.qubit_count,
+                                             false);
+        cqe->flags = 0;
+
+        ctx->cq_tail++;
+        ctx->sq_head++;
+        smp_store_release(&hdr->cq_tail, ctx->cq_tail);
+        smp_store_release(&hdr->sq_head, ctx->sq_head);
+        done++;
+        cond_resched();
+    }
+    mutex_unlock(&ctx->lock);
+
+    return done;
+}
+
+static long nymya_ring_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct nymya_ring_ctx *ctx = file->private_data;
+
+    switch (cmd) {
+    case NYMYA_RING_SETUP:
+        return nymya_ring_setup(ctx, (nymya_ring_params __user *)arg);
+    case NYMYA_RING_ENTER:
+        return nymya_ring_enter(ctx, arg);
+    default:
+        return -ENOTTY;
+    }
+}
+
+/**
+ * nymya_ring_mmap - Maps the shared ring area of this file.
+ * @file: Open /dev/nymya_ring file.
+ * @vma: Target mapping; must start at offset 0 and not exceed ring_bytes.
+ *
+ * Returns 0 on success, -EINVAL before setup or on a bad offset/size.
+ */
+static int nymya_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct nymya_ring_ctx *ctx = file->private_data;
+    unsigned long size = vma->vm_end - vma->vm_start;
+    int ret;
+
+    mutex_lock(&ctx->lock);
+    if (!ctx->mem || vma->vm_pgoff || size > ctx->bytes)
+        ret = -EINVAL;
+    else
+        ret = remap_vmalloc_range(vma, ctx->mem, 0);
+    mutex_unlock(&ctx->lock);
+
+    return ret;
+}
+
+static const struct file_operations nymya_ring_fops = {
+    .owner          = THIS_MODULE,
+    .open           = nymya_ring_open,
+    .release        = nymya_ring_release,
+    .unlocked_ioctl = nymya_ring_ioctl,
+    .compat_ioctl   = compat_ptr_ioctl,
+    .mmap           = nymya_ring_mmap,
+    .llseek         = noop_llseek,
+};
+
+static struct miscdevice nymya_ring_dev = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name  = "nymya_ring",
+    .fops  = &nymya_ring_fops,
+    .mode  = 0666,
+};
+
+/**
+ * nymya_ring_init - Registers /dev/nymya_ring.
+ *
+ * Returns 0 on success or the error code from misc_register().
+ */
+int nymya_ring_init(void)
+{
+    int ret = misc_register(&nymya_ring_dev);
+
+    if (ret)
+        pr_err("nymya_ring_init: misc_register failed, error %d\n", ret);
+    return ret;
+}
+
+/**
+ * nymya_ring_exit - Unregisters /dev/nymya_ring.
+ */
+void nymya_ring_exit(void)
+{
+    misc_deregister(&nymya_ring_dev);
+}
+
+#endif // __KERNEL__
@@ -0,0 +1,139 @@
+// src/nymya_scratch.c
+//
+// Per-thread scratch arenas for the userland syscall wrappers. A wrapper
+// that marshals its arguments into a kernel-layout copy (the lattice gates
+// 3355-3360, 3362-3365) takes that copy from the calling thread's arena
+// instead of malloc(): the buffer stays allocated between calls and only
+// grows, so a loop of same-sized calls allocates once and a loop of large
+// ones stops fragmenting the heap. This is the userland counterpart of the
+// kernel's per-CPU staging cache in nymya_aligned.c.
+//
+// Buffers come from nymya_aligned_alloc(). NYMYA_SCRATCH=huge, or
+// nymya_scratch_set_huge(), backs those of a huge page or more with huge
+// pages. nymya_scratch_trim() gives a thread's buffers back; they are also
+// freed when the thread exits.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Buffers at least this large are worth huge pages
+#define NYMYA_SCRATCH_HUGE_MIN (2u << 20)
+
+/**
+ * nymya_scratch_buf - One slot of a thread's arena.
+ * @p: Buffer from nymya_aligned_alloc(), or NULL.
+ * @bytes: Usable size of @p.
+ */
+typedef struct nymya_scratch_buf {
+    void *p;
+    size_t bytes;
+} nymya_scratch_buf;
+
+typedef struct nymya_scratch_arena {
+    nymya_scratch_buf slot[NYMYA_SCRATCH_SLOTS];
+} nymya_scratch_arena;
+
+static pthread_once_t nymya_scratch_once = PTHREAD_ONCE_INIT;
+static pthread_key_t nymya_scratch_key;
+static __thread nymya_scratch_arena *nymya_scratch_self;
+static int nymya_scratch_huge;
+
+static void nymya_scratch_release(nymya_scratch_arena *a, size_t keep) {
+    for (unsigned int s = 0; s < NYMYA_SCRATCH_SLOTS; s++) {
+        if (a->slot[s].p && a->slot[s].bytes > keep) {
+            nymya_aligned_free(a->slot[s].p);
+            a->slot[s].p = NULL;
+            a->slot[s].bytes = 0;
+        }
+    }
+}
+
+static void nymya_scratch_thread_exit(void *arg) {
+    nymya_scratch_release(arg, 0);
+    free(arg);
+}
+
+static void nymya_scratch_init(void) {
+    const char *env = getenv("NYMYA_SCRATCH");
+
+    pthread_key_create(&nymya_scratch_key, nymya_scratch_thread_exit);
+    if (env && strcmp(env, "huge") == 0) nymya_scratch_huge = 1;
+}
+
+/**
+ * nymya_scratch_set_huge - Chooses whether large scratch buffers use huge pages.
+ * @on: Non-zero for huge pages, 0 for normal ones.
+ *
+ * Overrides NYMYA_SCRATCH. Applies to buffers allocated from now on; a
+ * thread's existing buffers keep their pages until it trims them.
+ */
+void nymya_scratch_set_huge(int on) {
+    pthread_once(&nymya_scratch_once, nymya_scratch_init);
+    __atomic_store_n(&nymya_scratch_huge, on != 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * nymya_scratch_get - Borrows a buffer from the calling thread's arena.
+ * @slot: NYMYA_SCRATCH_* slot; a call that needs two buffers uses two slots.
+ * @bytes: Size needed.
+ *
+ * The buffer is cache-line aligned and stays the caller's until the next
+ * nymya_scratch_get() of the same slot on this thread or a trim; it must
+ * not be freed. Its contents are undefined. A slot too small for @bytes is
+ * replaced by one at least twice its size, so a growing series of calls
+ * reallocates only a logarithmic number of times.
+ *
+ * Returns the buffer, or NULL with errno set on invalid input or memory failure.
+ */
+void *nymya_scratch_get(unsigned int slot, size_t bytes) {
+    nymya_scratch_arena *a = nymya_scratch_self;
+    nymya_scratch_buf *b;
+    size_t want;
+
+    if (slot >= NYMYA_SCRATCH_SLOTS || bytes == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!a) {
+        pthread_once(&nymya_scratch_once, nymya_scratch_init);
+        a = calloc(1, sizeof(*a));
+        if (!a) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        pthread_setspecific(nymya_scratch_key, a);
+        nymya_scratch_self = a;
+    }
+
+    b = &a->slot[slot];
+    if (b->bytes >= bytes) return b->p;
+
+    want = b->bytes > SIZE_MAX / 2 ? bytes : 2 * b->bytes;
+    if (want < bytes) want = bytes;
+    nymya_aligned_free(b->p);
+    b->p = nymya_aligned_alloc(want, want >= NYMYA_SCRATCH_HUGE_MIN &&
+                               __atomic_load_n(&nymya_scratch_huge, __ATOMIC_RELAXED) ?
+                               NYMYA_ALLOC_HUGE : 0);
+    b->bytes = b->p ? want : 0;
+    return b->p;
+}
+
+/**
+ * nymya_scratch_trim - Frees the calling thread's large scratch buffers.
+ * @keep: Buffers of at most this many bytes are kept; 0 frees them all.
+ *
+ * For a thread that has finished a phase of large calls and goes on with
+ * small ones. Buffers borrowed from the freed slots become invalid.
+ */
+void nymya_scratch_trim(size_t keep) {
+    if (nymya_scratch_self) nymya_scratch_release(nymya_scratch_self, keep);
+}
+
+#endif // __KERNEL__
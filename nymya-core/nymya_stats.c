@@ -0,0 +1,522 @@
+// src/nymya_stats.c
+//
+// Always-on per-gate latency statistics for the kernel. Every gate core run
+// through NYMYA_TRACE_CORE (each syscall's core call and each batch record)
+// adds its duration to a per-CPU log2 histogram for its gate code, so tail
+// latency regressions show up without attaching a tracer. Beside it, the
+// syscall marshalling counts the bytes each gate copies in and out through
+// nymya_copy_from_user()/nymya_copy_to_user() and the staging buffers it
+// takes from nymya_stage_alloc(). The counters are summed over CPUs on read,
+// under /sys/kernel/debug/nymya/:
+//   latency - one line per gate that has run, see nymya_stats_show()
+//   marshal - one line per gate that has copied data, see nymya_marshal_show()
+//   phases  - per-phase time of the positional lattice gates, see nymya_phases_show()
+//   reset   - any write zeroes every counter
+//   enable  - "1" or "0"; when off, cores no longer read the clock and the
+//             per-gate copy and allocation counters stand still
+//   phase_enable - "1" or "0" (the default); times the lattice gate phases
+//
+// The totals over all gates, and the staging memory held right now and at
+// its peak, are also in /sys/kernel/nymya/marshal/ for monitoring that has
+// no debugfs.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bitops.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/jump_label.h>
+#include <linux/kobject.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/sysfs.h>
+#include <linux/uaccess.h>
+
+// Gate codes NYMYA_IDENTITY_GATE_CODE .. NYMYA_LATTICE_ARRAY_CODE
+#define NYMYA_STATS_SLOTS (NYMYA_LATTICE_ARRAY_CODE - NYMYA_IDENTITY_GATE_CODE + 1)
+// Bucket 0 counts 0 ns, bucket k durations in [2^(k-1), 2^k) ns; the last one is open-ended
+#define NYMYA_STATS_BUCKETS 32
+
+/**
+ * struct nymya_gate_stats - One CPU's counters for one gate code.
+ * @calls: Core runs.
+ * @errors: Runs that returned non-zero.
+ * @total_ns: Sum of the run durations.
+ * @hist: Run durations, bucketed by nymya_stats_bucket().
+ * @bytes_in: Bytes copied from user space.
+ * @bytes_out: Bytes copied to user space.
+ * @allocs: Staging buffers taken.
+ * @alloc_bytes: Bytes requested for them.
+ * @max_alloc: Largest single staging request.
+ * @phase_runs: Lattice runs timed by phase.
+ * @phase_ns: Their time in each enum nymya_lattice_phase.
+ */
+struct nymya_gate_stats {
+    u64 calls;
+    u64 errors;
+    u64 total_ns;
+    u64 hist[NYMYA_STATS_BUCKETS];
+    u64 bytes_in;
+    u64 bytes_out;
+    u64 allocs;
+    u64 alloc_bytes;
+    u64 max_alloc;
+    u64 phase_runs;
+    u64 phase_ns[NYMYA_LATTICE_PHASES];
+};
+
+struct nymya_cpu_stats {
+    struct nymya_gate_stats gate[NYMYA_STATS_SLOTS];
+};
+
+DEFINE_STATIC_KEY_TRUE(nymya_stats_key);
+EXPORT_SYMBOL_GPL(nymya_stats_key);
+DEFINE_STATIC_KEY_FALSE(nymya_phase_key);
+EXPORT_SYMBOL_GPL(nymya_phase_key);
+
+static const char *const nymya_phase_names[NYMYA_LATTICE_PHASES] = {
+    [NYMYA_LATTICE_GATHER] = "gather",
+    [NYMYA_LATTICE_GRID] = "grid",
+    [NYMYA_LATTICE_HADAMARD] = "hadamard",
+    [NYMYA_LATTICE_SEARCH] = "search",
+    [NYMYA_LATTICE_CNOT] = "cnot",
+};
+
+static struct nymya_cpu_stats __percpu *nymya_stats;
+static struct dentry *nymya_stats_dir;
+static struct kobject *nymya_stats_kobj;
+
+// Staging buffer bytes handed out and not yet released, and their high-water mark
+static atomic_long_t nymya_staged = ATOMIC_LONG_INIT(0);
+static atomic_long_t nymya_staged_peak = ATOMIC_LONG_INIT(0);
+
+static unsigned int nymya_stats_bucket(u64 ns)
+{
+    return min_t(unsigned int, fls64(ns), NYMYA_STATS_BUCKETS - 1);
+}
+
+/**
+ * nymya_stats_record - Adds one gate core run to the current CPU's counters.
+ * @code: Gate code; codes outside the nymya range are ignored.
+ * @ns: Duration of the run.
+ * @ret: The core's return code.
+ *
+ * Called by nymya_trace_core_end() while nymya_stats_key is on. Lock-free and
+ * safe from any context.
+ */
+void nymya_stats_record(u32 code, u64 ns, int ret)
+{
+    unsigned int slot = code - NYMYA_IDENTITY_GATE_CODE;
+
+    if (unlikely(slot >= NYMYA_STATS_SLOTS || !nymya_stats))
+        return;
+    this_cpu_inc(nymya_stats->gate[slot].calls);
+    this_cpu_add(nymya_stats->gate[slot].total_ns, ns);
+    this_cpu_inc(nymya_stats->gate[slot].hist[nymya_stats_bucket(ns)]);
+    if (ret)
+        this_cpu_inc(nymya_stats->gate[slot].errors);
+}
+EXPORT_SYMBOL_GPL(nymya_stats_record);
+
+/**
+ * nymya_stats_copied - Adds a user copy to the current CPU's counters.
+ * @code: Gate code; codes outside the nymya range are ignored.
+ * @bytes: Bytes actually copied.
+ * @out: True for a copy to user space, false for one from it.
+ *
+ * Called through nymya_stats_copy() while nymya_stats_key is on.
+ */
+void nymya_stats_copied(u32 code, size_t bytes, bool out)
+{
+    unsigned int slot = code - NYMYA_IDENTITY_GATE_CODE;
+
+    if (unlikely(slot >= NYMYA_STATS_SLOTS || !nymya_stats))
+        return;
+    if (out)
+        this_cpu_add(nymya_stats->gate[slot].bytes_out, bytes);
+    else
+        this_cpu_add(nymya_stats->gate[slot].bytes_in, bytes);
+}
+EXPORT_SYMBOL_GPL(nymya_stats_copied);
+
+/**
+ * nymya_stats_staged - Accounts a staging buffer handed out by nymya_stage_alloc().
+ * @code: Gate code the buffer is for.
+ * @bytes: Bytes requested.
+ * @held: Bytes the buffer actually occupies, as later passed to nymya_stats_unstaged().
+ *
+ * The memory held is tracked whether or not nymya_stats_key is on, so that
+ * turning the statistics off and on again cannot unbalance it; the per-gate
+ * counters only move while it is on.
+ *
+ * Returns the staging memory held, this buffer included.
+ */
+long nymya_stats_staged(u32 code, size_t bytes, size_t held)
+{
+    unsigned int slot = code - NYMYA_IDENTITY_GATE_CODE;
+    long now = atomic_long_add_return(held, &nymya_staged);
+    long peak = atomic_long_read(&nymya_staged_peak);
+
+    while (now > peak && !atomic_long_try_cmpxchg(&nymya_staged_peak, &peak, now))
+        ;
+
+    if (!static_branch_likely(&nymya_stats_key) || slot >= NYMYA_STATS_SLOTS || !nymya_stats)
+        return now;
+    this_cpu_inc(nymya_stats->gate[slot].allocs);
+    this_cpu_add(nymya_stats->gate[slot].alloc_bytes, bytes);
+    // A preemption between read and write only loses a concurrent maximum of this CPU
+    if (bytes > this_cpu_read(nymya_stats->gate[slot].max_alloc))
+        this_cpu_write(nymya_stats->gate[slot].max_alloc, bytes);
+    return now;
+}
+EXPORT_SYMBOL_GPL(nymya_stats_staged);
+
+/**
+ * nymya_stats_unstaged - Accounts the release of a staging buffer.
+ * @held: The @held value the buffer was accounted with.
+ */
+void nymya_stats_unstaged(size_t held)
+{
+    atomic_long_sub(held, &nymya_staged);
+}
+EXPORT_SYMBOL_GPL(nymya_stats_unstaged);
+
+/**
+ * nymya_stats_phases - Adds one timed lattice run to the current CPU's counters.
+ * @code: Gate code; codes outside the nymya range are ignored.
+ * @ns: Time of each enum nymya_lattice_phase, NYMYA_LATTICE_PHASES entries.
+ *
+ * Called by nymya_lattice*d_entangle() while nymya_phase_key is on.
+ */
+void nymya_stats_phases(u32 code, const u64 *ns)
+{
+    unsigned int slot = code - NYMYA_IDENTITY_GATE_CODE;
+    unsigned int p;
+
+    if (unlikely(slot >= NYMYA_STATS_SLOTS || !nymya_stats))
+        return;
+    this_cpu_inc(nymya_stats->gate[slot].phase_runs);
+    for (p = 0; p < NYMYA_LATTICE_PHASES; p++)
+        this_cpu_add(nymya_stats->gate[slot].phase_ns[p], ns[p]);
+}
+EXPORT_SYMBOL_GPL(nymya_stats_phases);
+
+static void nymya_stats_sum(unsigned int slot, struct nymya_gate_stats *sum)
+{
+    unsigned int b;
+    int cpu;
+
+    memset(sum, 0, sizeof(*sum));
+    for_each_possible_cpu(cpu) {
+        const struct nymya_gate_stats *s = &per_cpu_ptr(nymya_stats, cpu)->gate[slot];
+
+        sum->calls += READ_ONCE(s->calls);
+        sum->errors += READ_ONCE(s->errors);
+        sum->total_ns += READ_ONCE(s->total_ns);
+        for (b = 0; b < NYMYA_STATS_BUCKETS; b++)
+            sum->hist[b] += READ_ONCE(s->hist[b]);
+        sum->bytes_in += READ_ONCE(s->bytes_in);
+        sum->bytes_out += READ_ONCE(s->bytes_out);
+        sum->allocs += READ_ONCE(s->allocs);
+        sum->alloc_bytes += READ_ONCE(s->alloc_bytes);
+        sum->max_alloc = max(sum->max_alloc, READ_ONCE(s->max_alloc));
+        sum->phase_runs += READ_ONCE(s->phase_runs);
+        for (b = 0; b < NYMYA_LATTICE_PHASES; b++)
+            sum->phase_ns[b] += READ_ONCE(s->phase_ns[b]);
+    }
+}
+
+/**
+ * nymya_stats_show - Prints the counters of every gate that has run.
+ * @m: Output.
+ * @v: Unused.
+ *
+ * After a comment line naming the columns, one line per gate code:
+ * "<code> <calls> <errors> <total_ns> <hist[0]> ... <hist[31]>". Counters
+ * are summed over all CPUs without stopping writers, so a line read while
+ * gates run may be off by the runs in flight.
+ */
+static int nymya_stats_show(struct seq_file *m, void *v)
+{
+    struct nymya_gate_stats sum;
+    unsigned int slot, b;
+
+    seq_printf(m, "# code calls errors total_ns hist[0..%d]: 0ns, then [2^(k-1), 2^k) ns\n",
+               NYMYA_STATS_BUCKETS - 1);
+    for (slot = 0; slot < NYMYA_STATS_SLOTS; slot++) {
+        nymya_stats_sum(slot, &sum);
+        if (!sum.calls)
+            continue;
+
+        seq_printf(m, "%u %llu %llu %llu", NYMYA_IDENTITY_GATE_CODE + slot, sum.calls,
+                   sum.errors, sum.total_ns);
+        for (b = 0; b < NYMYA_STATS_BUCKETS; b++)
+            seq_printf(m, " %llu", sum.hist[b]);
+        seq_putc(m, '\n');
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nymya_stats);
+
+/**
+ * nymya_marshal_show - Prints the copy and allocation counters of every gate.
+ * @m: Output.
+ * @v: Unused.
+ *
+ * After the staging memory held now and at its peak, one line per gate code
+ * that has copied or staged anything:
+ * "<code> <bytes_in> <bytes_out> <allocs> <alloc_bytes> <max_alloc>".
+ */
+static int nymya_marshal_show(struct seq_file *m, void *v)
+{
+    struct nymya_gate_stats sum;
+    unsigned int slot;
+
+    seq_printf(m, "# staged_bytes %ld staged_peak %ld\n",
+               atomic_long_read(&nymya_staged), atomic_long_read(&nymya_staged_peak));
+    seq_puts(m, "# code bytes_in bytes_out allocs alloc_bytes max_alloc\n");
+    for (slot = 0; slot < NYMYA_STATS_SLOTS; slot++) {
+        nymya_stats_sum(slot, &sum);
+        if (!sum.bytes_in && !sum.bytes_out && !sum.allocs)
+            continue;
+        seq_printf(m, "%u %llu %llu %llu %llu %llu\n", NYMYA_IDENTITY_GATE_CODE + slot,
+                   sum.bytes_in, sum.bytes_out, sum.allocs, sum.alloc_bytes, sum.max_alloc);
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nymya_marshal);
+
+/**
+ * nymya_phases_show - Prints the phase times of every lattice gate that has been timed.
+ * @m: Output.
+ * @v: Unused.
+ *
+ * After a comment line naming the columns, one line per gate code:
+ * "<code> <runs> <gather_ns> <grid_ns> <hadamard_ns> <search_ns> <cnot_ns>".
+ * Runs submitted through nymya_3363_lattice_soa have no gather phase, and
+ * add nothing to that column of their gate.
+ */
+static int nymya_phases_show(struct seq_file *m, void *v)
+{
+    struct nymya_gate_stats sum;
+    unsigned int slot, p;
+
+    seq_puts(m, "# code runs");
+    for (p = 0; p < NYMYA_LATTICE_PHASES; p++)
+        seq_printf(m, " %s_ns", nymya_phase_names[p]);
+    seq_putc(m, '\n');
+    for (slot = 0; slot < NYMYA_STATS_SLOTS; slot++) {
+        nymya_stats_sum(slot, &sum);
+        if (!sum.phase_runs)
+            continue;
+        seq_printf(m, "%u %llu", NYMYA_IDENTITY_GATE_CODE + slot, sum.phase_runs);
+        for (p = 0; p < NYMYA_LATTICE_PHASES; p++)
+            seq_printf(m, " %llu", sum.phase_ns[p]);
+        seq_putc(m, '\n');
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nymya_phases);
+
+static ssize_t nymya_stats_reset_write(struct file *file, const char __user *ubuf,
+                                       size_t count, loff_t *ppos)
+{
+    int cpu;
+
+    // Runs recorded while this loop passes their CPU may survive the reset
+    for_each_possible_cpu(cpu)
+        memset(per_cpu_ptr(nymya_stats, cpu), 0, sizeof(struct nymya_cpu_stats));
+    atomic_long_set(&nymya_staged_peak, atomic_long_read(&nymya_staged));
+    return count;
+}
+
+static const struct file_operations nymya_stats_reset_fops = {
+    .owner = THIS_MODULE,
+    .write = nymya_stats_reset_write,
+    .llseek = noop_llseek,
+};
+
+static ssize_t nymya_stats_enable_read(struct file *file, char __user *ubuf,
+                                       size_t count, loff_t *ppos)
+{
+    char buf[2] = { static_key_enabled(&nymya_stats_key) ? '1' : '0', '\n' };
+
+    return simple_read_from_buffer(ubuf, count, ppos, buf, sizeof(buf));
+}
+
+static ssize_t nymya_stats_enable_write(struct file *file, const char __user *ubuf,
+                                        size_t count, loff_t *ppos)
+{
+    bool on;
+    int ret;
+
+    ret = kstrtobool_from_user(ubuf, count, &on);
+    if (ret)
+        return ret;
+    if (on)
+        static_branch_enable(&nymya_stats_key);
+    else
+        static_branch_disable(&nymya_stats_key);
+    return count;
+}
+
+static const struct file_operations nymya_stats_enable_fops = {
+    .owner = THIS_MODULE,
+    .read = nymya_stats_enable_read,
+    .write = nymya_stats_enable_write,
+    .llseek = default_llseek,
+};
+
+static ssize_t nymya_phase_enable_read(struct file *file, char __user *ubuf,
+                                       size_t count, loff_t *ppos)
+{
+    char buf[2] = { static_key_enabled(&nymya_phase_key) ? '1' : '0', '\n' };
+
+    return simple_read_from_buffer(ubuf, count, ppos, buf, sizeof(buf));
+}
+
+static ssize_t nymya_phase_enable_write(struct file *file, const char __user *ubuf,
+                                        size_t count, loff_t *ppos)
+{
+    bool on;
+    int ret;
+
+    ret = kstrtobool_from_user(ubuf, count, &on);
+    if (ret)
+        return ret;
+    if (on)
+        static_branch_enable(&nymya_phase_key);
+    else
+        static_branch_disable(&nymya_phase_key);
+    return count;
+}
+
+static const struct file_operations nymya_phase_enable_fops = {
+    .owner = THIS_MODULE,
+    .read = nymya_phase_enable_read,
+    .write = nymya_phase_enable_write,
+    .llseek = default_llseek,
+};
+
+// Sum of one counter over every gate and CPU
+static u64 nymya_marshal_total(size_t offset)
+{
+    unsigned int slot;
+    u64 total = 0;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        for (slot = 0; slot < NYMYA_STATS_SLOTS; slot++) {
+            const struct nymya_gate_stats *s = &per_cpu_ptr(nymya_stats, cpu)->gate[slot];
+
+            total += READ_ONCE(*(const u64 *)((const char *)s + offset));
+        }
+    }
+    return total;
+}
+
+#define NYMYA_MARSHAL_TOTAL_ATTR(field)                                            \
+    static ssize_t field##_show(struct kobject *kobj, struct kobj_attribute *attr, \
+                                char *buf)                                         \
+    {                                                                              \
+        return sysfs_emit(buf, "%llu\n",                                           \
+                          nymya_marshal_total(offsetof(struct nymya_gate_stats, field))); \
+    }                                                                              \
+    static struct kobj_attribute nymya_marshal_##field = __ATTR_RO(field)
+
+NYMYA_MARSHAL_TOTAL_ATTR(bytes_in);
+NYMYA_MARSHAL_TOTAL_ATTR(bytes_out);
+NYMYA_MARSHAL_TOTAL_ATTR(allocs);
+NYMYA_MARSHAL_TOTAL_ATTR(alloc_bytes);
+
+static ssize_t staged_bytes_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%ld\n", atomic_long_read(&nymya_staged));
+}
+static struct kobj_attribute nymya_marshal_staged_bytes = __ATTR_RO(staged_bytes);
+
+static ssize_t staged_peak_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%ld\n", atomic_long_read(&nymya_staged_peak));
+}
+static struct kobj_attribute nymya_marshal_staged_peak = __ATTR_RO(staged_peak);
+
+static struct attribute *nymya_marshal_attrs[] = {
+    &nymya_marshal_bytes_in.attr,
+    &nymya_marshal_bytes_out.attr,
+    &nymya_marshal_allocs.attr,
+    &nymya_marshal_alloc_bytes.attr,
+    &nymya_marshal_staged_bytes.attr,
+    &nymya_marshal_staged_peak.attr,
+    NULL,
+};
+
+static const struct attribute_group nymya_marshal_group = {
+    .name = "marshal",
+    .attrs = nymya_marshal_attrs,
+};
+
+/**
+ * nymya_stats_init - Allocates the counters and creates their debugfs and sysfs files.
+ *
+ * A missing debugfs leaves the counters running unseen, as debugfs failures
+ * are not fatal; the sysfs totals are ABI and must be created.
+ *
+ * Returns: 0 on success, or a negative errno.
+ */
+int nymya_stats_init(void)
+{
+    int ret;
+
+    nymya_stats = alloc_percpu(struct nymya_cpu_stats);
+    if (!nymya_stats)
+        return -ENOMEM;
+
+    nymya_stats_kobj = kobject_create_and_add("nymya", kernel_kobj);
+    if (!nymya_stats_kobj) {
+        ret = -ENOMEM;
+        goto fail_free;
+    }
+    ret = sysfs_create_group(nymya_stats_kobj, &nymya_marshal_group);
+    if (ret)
+        goto fail_kobj;
+
+    nymya_stats_dir = debugfs_create_dir("nymya", NULL);
+    debugfs_create_file("latency", 0400, nymya_stats_dir, NULL, &nymya_stats_fops);
+    debugfs_create_file("marshal", 0400, nymya_stats_dir, NULL, &nymya_marshal_fops);
+    debugfs_create_file("phases", 0400, nymya_stats_dir, NULL, &nymya_phases_fops);
+    debugfs_create_file("reset", 0200, nymya_stats_dir, NULL, &nymya_stats_reset_fops);
+    debugfs_create_file("enable", 0600, nymya_stats_dir, NULL, &nymya_stats_enable_fops);
+    debugfs_create_file("phase_enable", 0600, nymya_stats_dir, NULL, &nymya_phase_enable_fops);
+    return 0;
+
+fail_kobj:
+    kobject_put(nymya_stats_kobj);
+fail_free:
+    free_percpu(nymya_stats);
+    nymya_stats = NULL;
+    return ret;
+}
+
+/**
+ * nymya_stats_exit - Removes the debugfs and sysfs files and frees the counters.
+ *
+ * Called after the syscalls can no longer run, so no core records into the
+ * freed counters.
+ */
+void nymya_stats_exit(void)
+{
+    struct nymya_cpu_stats __percpu *stats = nymya_stats;
+
+    debugfs_remove_recursive(nymya_stats_dir);
+    sysfs_remove_group(nymya_stats_kobj, &nymya_marshal_group);
+    kobject_put(nymya_stats_kobj);
+    nymya_stats = NULL;
+    free_percpu(stats);
+}
+
+#endif // __KERNEL__
@@ -0,0 +1,168 @@
+// src/nymya_tag.c
+//
+// Userland interned tag table behind nymya_qubit_c. Every distinct label is
+// stored once and named by a 32-bit handle, so compact qubits carry four
+// bytes instead of NYMYA_TAG_MAXLEN. Interning takes a mutex; looking a
+// handle up is lock-free, since stored labels never move.
+
+#include "nymya.h"
+
+#ifndef __KERNEL__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Labels are stored in fixed chunks so their addresses stay valid as the table grows
+#define NYMYA_TAG_CHUNK_SHIFT 10
+#define NYMYA_TAG_CHUNK       (1u << NYMYA_TAG_CHUNK_SHIFT)
+#define NYMYA_TAG_CHUNKS      4096 // Up to 4M distinct labels
+
+typedef char nymya_tag_label[NYMYA_TAG_MAXLEN];
+
+static nymya_tag_label *nymya_tag_chunks[NYMYA_TAG_CHUNKS];
+static uint32_t nymya_tag_count;     // Labels stored; handle h names label h - 1
+static uint32_t *nymya_tag_slots;    // Open-addressed handles, 0 = empty
+static uint32_t nymya_tag_mask;      // Number of slots minus one
+static pthread_mutex_t nymya_tag_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline const char *nymya_tag_label_of(uint32_t handle) {
+    uint32_t i = handle - 1;
+
+    return nymya_tag_chunks[i >> NYMYA_TAG_CHUNK_SHIFT][i & (NYMYA_TAG_CHUNK - 1)];
+}
+
+// FNV-1a over the (already truncated) label
+static uint32_t nymya_tag_hash(const char *label, size_t len) {
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)label[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Rebuilds the slot array at twice its size; called with the lock held
+static int nymya_tag_grow(void) {
+    uint32_t nslots = nymya_tag_slots ? 2 * (nymya_tag_mask + 1) : 1024;
+    uint32_t *slots = calloc(nslots, sizeof(*slots));
+
+    if (!slots) return -1;
+    for (uint32_t h = 1; h <= nymya_tag_count; h++) {
+        const char *label = nymya_tag_label_of(h);
+        uint32_t i = nymya_tag_hash(label, strlen(label)) & (nslots - 1);
+
+        while (slots[i]) i = (i + 1) & (nslots - 1);
+        slots[i] = h;
+    }
+    free(nymya_tag_slots);
+    nymya_tag_slots = slots;
+    nymya_tag_mask = nslots - 1;
+    return 0;
+}
+
+/**
+ * nymya_tag_intern - Returns the handle of a qubit tag, adding it if new.
+ * @tag: Label; like nymya_qubit.tag, only its first NYMYA_TAG_MAXLEN - 1
+ *       characters are kept.
+ *
+ * Equal labels always get the same handle, for the life of the process.
+ * Safe to call from any thread.
+ *
+ * Returns the handle, or NYMYA_TAG_NONE for a NULL or empty label, or if the
+ * table is full or out of memory.
+ */
+nymya_tag_t nymya_tag_intern(const char *tag) {
+    size_t len;
+    uint32_t h, i;
+
+    if (!tag || !tag[0]) return NYMYA_TAG_NONE;
+    len = strnlen(tag, NYMYA_TAG_MAXLEN - 1);
+
+    pthread_mutex_lock(&nymya_tag_lock);
+    // Keep the slot array at most half full
+    if (2 * ((uint64_t)nymya_tag_count + 1) > (uint64_t)nymya_tag_mask + 1 && nymya_tag_grow()) {
+        h = NYMYA_TAG_NONE;
+        goto out;
+    }
+
+    for (i = nymya_tag_hash(tag, len) & nymya_tag_mask; (h = nymya_tag_slots[i]);
+         i = (i + 1) & nymya_tag_mask) {
+        const char *label = nymya_tag_label_of(h);
+
+        if (strncmp(label, tag, len) == 0 && label[len] == '\0')
+            goto out;
+    }
+
+    if (nymya_tag_count == NYMYA_TAG_CHUNKS * NYMYA_TAG_CHUNK) {
+        h = NYMYA_TAG_NONE;
+        goto out;
+    }
+    h = nymya_tag_count + 1;
+    if (!nymya_tag_chunks[(h - 1) >> NYMYA_TAG_CHUNK_SHIFT]) {
+        nymya_tag_label *chunk = calloc(NYMYA_TAG_CHUNK, sizeof(*chunk));
+
+        if (!chunk) {
+            h = NYMYA_TAG_NONE;
+            goto out;
+        }
+        __atomic_store_n(&nymya_tag_chunks[(h - 1) >> NYMYA_TAG_CHUNK_SHIFT], chunk, __ATOMIC_RELEASE);
+    }
+    memcpy((char *)nymya_tag_label_of(h), tag, len);
+    nymya_tag_slots[i] = h;
+    // Publishes the label to lock-free nymya_tag_str() readers
+    __atomic_store_n(&nymya_tag_count, h, __ATOMIC_RELEASE);
+
+out:
+    pthread_mutex_unlock(&nymya_tag_lock);
+    return h;
+}
+
+/**
+ * nymya_tag_str - Returns the label of an interned tag handle.
+ * @tag: Handle from nymya_tag_intern().
+ *
+ * The string stays valid for the life of the process. Safe to call from any
+ * thread without locking.
+ *
+ * Returns the label, or "" for NYMYA_TAG_NONE and unknown handles.
+ */
+const char *nymya_tag_str(nymya_tag_t tag) {
+    if (tag == NYMYA_TAG_NONE || tag > __atomic_load_n(&nymya_tag_count, __ATOMIC_ACQUIRE))
+        return "";
+    return nymya_tag_label_of(tag);
+}
+
+/**
+ * nymya_qubit_to_compact - Converts qubits to the compact form, interning their tags.
+ * @src: Legacy qubits.
+ * @dst: Output, @count entries.
+ * @count: Number of qubits.
+ */
+void nymya_qubit_to_compact(const nymya_qubit *src, nymya_qubit_c *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i].id = src[i].id;
+        dst[i].tag = nymya_tag_intern(src[i].tag);
+        dst[i].flags = 0;
+        dst[i].amplitude = src[i].amplitude;
+    }
+}
+
+/**
+ * nymya_qubit_from_compact - Converts compact qubits back to the legacy form.
+ * @src: Compact qubits.
+ * @dst: Output, @count entries; tags are NUL-padded.
+ * @count: Number of qubits.
+ */
+void nymya_qubit_from_compact(const nymya_qubit_c *src, nymya_qubit *dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i].id = src[i].id;
+        strncpy(dst[i].tag, nymya_tag_str(src[i].tag), NYMYA_TAG_MAXLEN);
+        dst[i].tag[NYMYA_TAG_MAXLEN - 1] = '\0';
+        dst[i].amplitude = src[i].amplitude;
+    }
+}
+
+#endif // __KERNEL__
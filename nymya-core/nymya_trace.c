@@ -0,0 +1,25 @@
+// src/nymya_trace.c
+//
+// Instantiates the nymya tracepoints declared in nymya_trace.h. Exported so
+// that out-of-tree helpers, such as the benchmark module, can attach probes
+// or fire the core events themselves.
+
+#include "nymya.h"
+
+#ifdef __KERNEL__
+
+#include <linux/module.h>
+
+#define CREATE_TRACE_POINTS
+#include "nymya_trace.h"
+
+EXPORT_TRACEPOINT_SYMBOL_GPL(nymya_syscall_enter);
+EXPORT_TRACEPOINT_SYMBOL_GPL(nymya_syscall_exit);
+EXPORT_TRACEPOINT_SYMBOL_GPL(nymya_core_enter);
+EXPORT_TRACEPOINT_SYMBOL_GPL(nymya_core_exit);
+EXPORT_TRACEPOINT_SYMBOL_GPL(nymya_copy_in);
+EXPORT_TRACEPOINT_SYMBOL_GPL(nymya_copy_out);
+EXPORT_TRACEPOINT_SYMBOL_GPL(nymya_stage);
+EXPORT_TRACEPOINT_SYMBOL_GPL(nymya_lattice_progress);
+
+#endif // __KERNEL__
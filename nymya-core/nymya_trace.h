@@ -0,0 +1,249 @@
+// src/nymya_trace.h
+//
+// Tracepoints of the nymya TRACE_SYSTEM: entry and exit of every gate
+// syscall, and of every gate core run on behalf of a syscall or a batch
+// record, plus each user copy and staging buffer of the syscall marshalling,
+// for BPF programs that keep their own per-gate maps. Disabled tracepoints cost one patched-out branch each; enabled
+// ones show up in tracefs as events/nymya/*, in "perf list" as nymya:* and
+// can be attached to from BPF as tp/nymya/*.
+//
+// Kernel only, included through nymya.h. nymya_trace.c instantiates them.
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM nymya
+
+#if !defined(_NYMYA_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _NYMYA_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+DECLARE_EVENT_CLASS(nymya_syscall_enter_class,
+
+    TP_PROTO(u32 code, u64 qubit_id),
+
+    TP_ARGS(code, qubit_id),
+
+    TP_STRUCT__entry(
+        __field(u32, code)
+        __field(u64, qubit_id)
+    ),
+
+    TP_fast_assign(
+        __entry->code = code;
+        __entry->qubit_id = qubit_id;
+    ),
+
+    TP_printk("code=%u qubit=%llu", __entry->code, (unsigned long long)__entry->qubit_id)
+);
+
+/*
+ * nymya_syscall_enter - A gate syscall was entered.
+ * @code: Syscall number (the gate code).
+ * @qubit_id: ID of the primary qubit, or 0 while it is still in user memory.
+ */
+DEFINE_EVENT(nymya_syscall_enter_class, nymya_syscall_enter,
+    TP_PROTO(u32 code, u64 qubit_id),
+    TP_ARGS(code, qubit_id));
+
+DECLARE_EVENT_CLASS(nymya_syscall_exit_class,
+
+    TP_PROTO(u32 code, long ret, u64 duration_ns),
+
+    TP_ARGS(code, ret, duration_ns),
+
+    TP_STRUCT__entry(
+        __field(u32, code)
+        __field(long, ret)
+        __field(u64, duration_ns)
+    ),
+
+    TP_fast_assign(
+        __entry->code = code;
+        __entry->ret = ret;
+        __entry->duration_ns = duration_ns;
+    ),
+
+    TP_printk("code=%u ret=%ld duration_ns=%llu", __entry->code, __entry->ret,
+              (unsigned long long)__entry->duration_ns)
+);
+
+/*
+ * nymya_syscall_exit - A gate syscall returned.
+ * @code: Syscall number.
+ * @ret: Return value.
+ * @duration_ns: Time since nymya_syscall_enter, user copies included; 0 if
+ *               the event was enabled mid-call.
+ */
+DEFINE_EVENT(nymya_syscall_exit_class, nymya_syscall_exit,
+    TP_PROTO(u32 code, long ret, u64 duration_ns),
+    TP_ARGS(code, ret, duration_ns));
+
+DECLARE_EVENT_CLASS(nymya_core_enter_class,
+
+    TP_PROTO(u32 code, u64 q0, u64 q1),
+
+    TP_ARGS(code, q0, q1),
+
+    TP_STRUCT__entry(
+        __field(u32, code)
+        __field(u64, q0)
+        __field(u64, q1)
+    ),
+
+    TP_fast_assign(
+        __entry->code = code;
+        __entry->q0 = q0;
+        __entry->q1 = q1;
+    ),
+
+    TP_printk("code=%u q0=%llu q1=%llu", __entry->code,
+              (unsigned long long)__entry->q0, (unsigned long long)__entry->q1)
+);
+
+/*
+ * nymya_core_enter - A gate core is about to run.
+ * @code: Gate code.
+ * @q0: ID of the first operand.
+ * @q1: ID of the second operand, or 0 for single-qubit gates.
+ */
+DEFINE_EVENT(nymya_core_enter_class, nymya_core_enter,
+    TP_PROTO(u32 code, u64 q0, u64 q1),
+    TP_ARGS(code, q0, q1));
+
+DECLARE_EVENT_CLASS(nymya_core_exit_class,
+
+    TP_PROTO(u32 code, u64 q0, u64 q1, int ret, u64 duration_ns),
+
+    TP_ARGS(code, q0, q1, ret, duration_ns),
+
+    TP_STRUCT__entry(
+        __field(u32, code)
+        __field(u64, q0)
+        __field(u64, q1)
+        __field(int, ret)
+        __field(u64, duration_ns)
+    ),
+
+    TP_fast_assign(
+        __entry->code = code;
+        __entry->q0 = q0;
+        __entry->q1 = q1;
+        __entry->ret = ret;
+        __entry->duration_ns = duration_ns;
+    ),
+
+    TP_printk("code=%u q0=%llu q1=%llu ret=%d duration_ns=%llu", __entry->code,
+              (unsigned long long)__entry->q0, (unsigned long long)__entry->q1,
+              __entry->ret, (unsigned long long)__entry->duration_ns)
+);
+
+/*
+ * nymya_core_exit - A gate core returned.
+ * @code, @q0, @q1: As for nymya_core_enter.
+ * @ret: The core's return code.
+ * @duration_ns: Time spent in the core; 0 if the event was enabled mid-call.
+ */
+DEFINE_EVENT(nymya_core_exit_class, nymya_core_exit,
+    TP_PROTO(u32 code, u64 q0, u64 q1, int ret, u64 duration_ns),
+    TP_ARGS(code, q0, q1, ret, duration_ns));
+
+DECLARE_EVENT_CLASS(nymya_copy_class,
+
+    TP_PROTO(u32 code, u64 bytes),
+
+    TP_ARGS(code, bytes),
+
+    TP_STRUCT__entry(
+        __field(u32, code)
+        __field(u64, bytes)
+    ),
+
+    TP_fast_assign(
+        __entry->code = code;
+        __entry->bytes = bytes;
+    ),
+
+    TP_printk("code=%u bytes=%llu", __entry->code, (unsigned long long)__entry->bytes)
+);
+
+/*
+ * nymya_copy_in - A gate syscall copied data from user space.
+ * @code: Gate code.
+ * @bytes: Bytes actually copied.
+ */
+DEFINE_EVENT(nymya_copy_class, nymya_copy_in,
+    TP_PROTO(u32 code, u64 bytes),
+    TP_ARGS(code, bytes));
+
+/*
+ * nymya_copy_out - A gate syscall copied data to user space.
+ * @code, @bytes: As for nymya_copy_in.
+ */
+DEFINE_EVENT(nymya_copy_class, nymya_copy_out,
+    TP_PROTO(u32 code, u64 bytes),
+    TP_ARGS(code, bytes));
+
+TRACE_EVENT(nymya_stage,
+
+    TP_PROTO(u32 code, u64 bytes, long staged),
+
+    TP_ARGS(code, bytes, staged),
+
+    TP_STRUCT__entry(
+        __field(u32, code)
+        __field(u64, bytes)
+        __field(long, staged)
+    ),
+
+    TP_fast_assign(
+        __entry->code = code;
+        __entry->bytes = bytes;
+        __entry->staged = staged;
+    ),
+
+    TP_printk("code=%u bytes=%llu staged=%ld", __entry->code,
+              (unsigned long long)__entry->bytes, __entry->staged)
+);
+
+/*
+ * nymya_lattice_progress - A positional lattice gate finished a chunk of sites.
+ * @code: Gate code.
+ * @done: Sites whose CNOTs have all been applied; CNOTs applied for a
+ *        cached topology, which runs them in layers.
+ * @count: Sites in the call; CNOTs of the topology.
+ * @ret: 0 while the call goes on, or the error it stops with.
+ */
+TRACE_EVENT(nymya_lattice_progress,
+
+    TP_PROTO(u32 code, u64 done, u64 count, int ret),
+
+    TP_ARGS(code, done, count, ret),
+
+    TP_STRUCT__entry(
+        __field(u32, code)
+        __field(u64, done)
+        __field(u64, count)
+        __field(int, ret)
+    ),
+
+    TP_fast_assign(
+        __entry->code = code;
+        __entry->done = done;
+        __entry->count = count;
+        __entry->ret = ret;
+    ),
+
+    TP_printk("code=%u done=%llu count=%llu ret=%d", __entry->code,
+              (unsigned long long)__entry->done, (unsigned long long)__entry->count,
+              __entry->ret)
+);
+
+#endif // _NYMYA_TRACE_H
+
+// Built out of tree: define_trace.h finds this file through -I$(src)
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE nymya_trace
+#include <trace/define_trace.h>
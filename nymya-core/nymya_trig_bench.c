@@ -0,0 +1,86 @@
+// src/nymya_trig_bench.c
+//
+// Userland benchmark of fixed_point_sincos(): ns per call and worst error
+// in Q32.32 units (ulp = 2^-32) for every NYMYA_TRIG_* tier. Built and run
+// by "make trig-bench"; run it on each target (or in its build container)
+// to compare the tiers on amd64, arm64 and riscv64.
+
+#include "nymya.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <sys/utsname.h>
+
+#define BENCH_SWEEP_POINTS  4000000 // Evenly spaced angles over [-4*pi, 4*pi]
+#define BENCH_RANDOM_POINTS 1000000 // Random angles over the whole int64 range
+#define BENCH_CALLS         20000000
+
+static const char *const tier_names[] = { "fast", "balanced", "precise" };
+
+static uint64_t bench_rng = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t bench_next(void) {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 7;
+    bench_rng ^= bench_rng << 17;
+    return bench_rng;
+}
+
+// Largest distance of sin/cos from the long double reference, in Q32.32 units
+static double bench_error(int tier, int64_t angle_fp) {
+    const long double scale = (long double)FIXED_POINT_SCALE;
+    long double x = (long double)angle_fp / scale;
+    int64_t s, c;
+    long double es, ec;
+
+    fixed_point_sincos(angle_fp, tier, &s, &c);
+    es = fabsl((long double)s - sinl(x) * scale);
+    ec = fabsl((long double)c - cosl(x) * scale);
+    return (double)(es > ec ? es : ec);
+}
+
+static double bench_ns_per_call(int tier) {
+    struct timespec t0, t1;
+    volatile int64_t sink = 0;
+    int64_t acc = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int64_t k = 0; k < BENCH_CALLS; k++) {
+        int64_t s, c;
+
+        fixed_point_sincos(k * 0x1F3D5B79LL, tier, &s, &c);
+        acc += s ^ c;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sink = acc;
+    (void)sink;
+
+    return ((double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec)) / BENCH_CALLS;
+}
+
+int main(void) {
+    const int64_t span = (int64_t)(4.0 * M_PI * FIXED_POINT_SCALE);
+    struct utsname u;
+
+    if (uname(&u)) u.machine[0] = '\0';
+    printf("fixed_point_sincos on %s (default tier: %s)\n",
+           u.machine, tier_names[NYMYA_TRIG_TIER]);
+    printf("%-10s %10s %16s %16s\n", "tier", "ns/call", "max ulp |x|<4pi", "max ulp any x");
+
+    for (int tier = NYMYA_TRIG_FAST; tier <= NYMYA_TRIG_PRECISE; tier++) {
+        double near = 0, any = 0;
+
+        for (int64_t k = 0; k < BENCH_SWEEP_POINTS; k++) {
+            double e = bench_error(tier, -span + 2 * span / BENCH_SWEEP_POINTS * k);
+            if (e > near) near = e;
+        }
+        for (int k = 0; k < BENCH_RANDOM_POINTS; k++) {
+            double e = bench_error(tier, (int64_t)bench_next());
+            if (e > any) any = e;
+        }
+        printf("%-10s %10.2f %16.2f %16.2f\n", tier_names[tier], bench_ns_per_call(tier), near, any);
+    }
+    return 0;
+}
@@ -0,0 +1,384 @@
+// backend_dist.c
+//
+// Distributed state-vector backend (MPI). The 2^n amplitudes are sharded by
+// their high-order bits across 2^g ranks: rank r holds the basis states whose
+// top g bits ("global" qubits) equal r, as an ordinary local register of
+// n - g qubits driven by the state-vector engine (sim_statevec.c) and its
+// worker pool.
+//
+// A gate on local qubits runs on every rank with no communication. A gate
+// that names a global qubit first swaps that qubit with a local one: the two
+// ranks that differ in its bit trade the halves of their registers where the
+// local bit disagrees with the rank bit, after which the gate is local. The
+// exchange is chunked and double-buffered, so packing the next chunk and
+// unpacking the previous one overlap the transfer of the current one. The
+// qubit stays local afterwards, so runs of gates on it cost one exchange.
+//
+// All ranks must issue the same gate calls in the same order (SPMD).
+// Qubits join in |0> on first use, by ID: as local qubits while the local
+// register fits the per-rank budget, then in the free global slots, which
+// costs nothing because a fresh qubit's bit is 0 everywhere.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <mpi.h>
+#include <nymya/nymya.h>
+#include "backend_dist.h"
+#include "backend_sim.h"
+#include "sim_statevec.h"
+#include "sim_compile.h"
+
+// Amplitudes per message of a qubit exchange (1 MiB)
+#define DIST_CHUNK_AMPS ((size_t)1 << 16)
+
+#define DIST_MAX_GLOBAL 30
+
+/**
+ * dist_state - This rank's share of the register.
+ * @sv: Local register; its slot k is bit k of the local index.
+ * @rank: Rank in MPI_COMM_WORLD.
+ * @nglobal: Global qubit slots, log2 of the number of ranks.
+ * @gids: Qubit ID held by each global slot.
+ * @gused: Bit b is set when global slot b holds a qubit.
+ * @local_max: Most local qubits a rank holds before qubits join globally.
+ * @stamp: Last use of each local slot, for picking swap victims.
+ * @clock: Use counter behind @stamp.
+ * @ready: Non-zero once MPI and @sv are set up.
+ * @own_mpi: Non-zero if this backend called MPI_Init.
+ */
+typedef struct dist_state {
+    sim_sv sv;
+    int rank;
+    unsigned int nglobal;
+    uint64_t gids[DIST_MAX_GLOBAL];
+    uint32_t gused;
+    unsigned int local_max;
+    uint64_t stamp[SIM_SV_MAX_QUBITS];
+    uint64_t clock;
+    int ready;
+    int own_mpi;
+} dist_state;
+
+static dist_state dist;
+
+static void dist_finalize(void) {
+    int done = 0;
+
+    MPI_Finalized(&done);
+    if (!done) MPI_Finalize();
+}
+
+// Local qubit budget: NYMYA_DIST_LOCAL_QUBITS, else half of physical memory
+static unsigned int dist_local_budget(void) {
+    const char* env = getenv("NYMYA_DIST_LOCAL_QUBITS");
+    long pages = sysconf(_SC_PHYS_PAGES), page = sysconf(_SC_PAGESIZE);
+    unsigned int n = 0;
+
+    if (env && atoi(env) > 0) n = (unsigned int)atoi(env);
+    else if (pages > 0 && page > 0) {
+        uint64_t amps = (uint64_t)pages * (uint64_t)page / 2 / sizeof(double complex);
+
+        while (n < 63 && ((uint64_t)2 << n) <= amps) n++;
+    }
+    if (n < 3) n = 3;
+    return n > SIM_SV_MAX_QUBITS ? SIM_SV_MAX_QUBITS : n;
+}
+
+static int dist_init(void) {
+    int inited = 0, size = 0;
+
+    if (dist.ready) return 0;
+
+    MPI_Initialized(&inited);
+    if (!inited) {
+        if (MPI_Init(NULL, NULL) != MPI_SUCCESS) return -1;
+        dist.own_mpi = 1;
+        atexit(dist_finalize);
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &dist.rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (size & (size - 1)) {
+        if (dist.rank == 0)
+            fprintf(stderr, "[dist backend] Needs a power-of-two number of ranks, got %d\n", size);
+        return -1;
+    }
+    dist.nglobal = (unsigned int)__builtin_ctz((unsigned int)size);
+    dist.local_max = dist_local_budget();
+
+    if (sim_sv_init(&dist.sv)) return -1;
+    // |0...0> lives on rank 0 only
+    if (dist.rank != 0) dist.sv.amp[0] = 0;
+    dist.ready = 1;
+    return 0;
+}
+
+static int dist_find_global(uint64_t id) {
+    for (unsigned int b = 0; b < dist.nglobal; b++) {
+        if ((dist.gused >> b) & 1 && dist.gids[b] == id) return (int)b;
+    }
+    return -1;
+}
+
+/**
+ * dist_qubit - Finds or adds a qubit.
+ * @id: nymya_qubit ID.
+ * @global: Set when the qubit lives in a global slot.
+ *
+ * Returns the local or global slot, or -1 once both are full.
+ */
+static int dist_qubit(uint64_t id, int* global) {
+    int s = sim_sv_find(&dist.sv, id);
+
+    *global = 0;
+    if (s >= 0) return s;
+    s = dist_find_global(id);
+    if (s >= 0) {
+        *global = 1;
+        return s;
+    }
+
+    if (dist.sv.nqubits < dist.local_max) return sim_sv_qubit(&dist.sv, id);
+    for (unsigned int b = 0; b < dist.nglobal; b++) {
+        if (!((dist.gused >> b) & 1)) {
+            dist.gids[b] = id;
+            dist.gused |= 1u << b;
+            *global = 1;
+            return (int)b;
+        }
+    }
+    if (dist.rank == 0)
+        fprintf(stderr, "[dist backend] Register full (%u local + %u global qubits)\n",
+                dist.local_max, dist.nglobal);
+    return -1;
+}
+
+// Index of the j-th local basis state whose bit @l equals @u
+static inline size_t dist_spread(size_t j, unsigned int l, size_t u) {
+    size_t low = j & (((size_t)1 << l) - 1);
+
+    return ((j >> l) << (l + 1)) | (u << l) | low;
+}
+
+/**
+ * dist_swap - Exchanges global slot @b with local slot @l.
+ * @b: Global slot, i.e. rank bit.
+ * @l: Local slot.
+ *
+ * Every rank keeps the amplitudes whose local bit @l equals its own bit @b
+ * and trades the other half with the rank that differs in bit @b, which
+ * places them at the same local indices. Afterwards the two slots have
+ * swapped qubits.
+ *
+ * Returns 0 on success, -1 on allocation or MPI failure.
+ */
+static int dist_swap(unsigned int b, unsigned int l) {
+    int partner = dist.rank ^ (1 << b);
+    size_t u = ((size_t)dist.rank >> b) & 1 ? 0 : 1;   // bit value we send
+    size_t half = dist.sv.dim / 2;
+    size_t nchunk = (half + DIST_CHUNK_AMPS - 1) / DIST_CHUNK_AMPS;
+    double complex* buf = malloc(4 * DIST_CHUNK_AMPS * sizeof(*buf));
+    double complex* sbuf[2], *rbuf[2];
+    MPI_Request sreq[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+    MPI_Request rreq[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+    double complex* amp = dist.sv.amp;
+    uint64_t id;
+    int ret = 0;
+
+    if (!buf) return -1;
+    sbuf[0] = buf;
+    sbuf[1] = buf + DIST_CHUNK_AMPS;
+    rbuf[0] = buf + 2 * DIST_CHUNK_AMPS;
+    rbuf[1] = buf + 3 * DIST_CHUNK_AMPS;
+
+    for (size_t c = 0; c <= nchunk && !ret; c++) {
+        // Post chunk c, then unpack chunk c - 1 while it is in flight
+        if (c < nchunk) {
+            size_t j0 = c * DIST_CHUNK_AMPS, len = half - j0;
+            double complex* s = sbuf[c & 1];
+
+            if (len > DIST_CHUNK_AMPS) len = DIST_CHUNK_AMPS;
+            if (MPI_Wait(&sreq[c & 1], MPI_STATUS_IGNORE) != MPI_SUCCESS) ret = -1;
+            for (size_t j = 0; j < len; j++)
+                s[j] = amp[dist_spread(j0 + j, l, u)];
+            if (MPI_Irecv(rbuf[c & 1], (int)len, MPI_C_DOUBLE_COMPLEX, partner, (int)(c & 0x7fff),
+                          MPI_COMM_WORLD, &rreq[c & 1]) != MPI_SUCCESS ||
+                MPI_Isend(s, (int)len, MPI_C_DOUBLE_COMPLEX, partner, (int)(c & 0x7fff),
+                          MPI_COMM_WORLD, &sreq[c & 1]) != MPI_SUCCESS)
+                ret = -1;
+        }
+        if (c > 0 && !ret) {
+            size_t p = c - 1, j0 = p * DIST_CHUNK_AMPS, len = half - j0;
+            const double complex* r = rbuf[p & 1];
+
+            if (len > DIST_CHUNK_AMPS) len = DIST_CHUNK_AMPS;
+            if (MPI_Wait(&rreq[p & 1], MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+                ret = -1;
+                break;
+            }
+            for (size_t j = 0; j < len; j++)
+                amp[dist_spread(j0 + j, l, u)] = r[j];
+        }
+    }
+    MPI_Waitall(2, sreq, MPI_STATUSES_IGNORE);
+    MPI_Waitall(2, rreq, MPI_STATUSES_IGNORE);
+    free(buf);
+    if (ret) return -1;
+
+    id = dist.sv.ids[l];
+    dist.sv.ids[l] = dist.gids[b];
+    dist.gids[b] = id;
+    return 0;
+}
+
+/**
+ * dist_localize - Makes every target of a gate a local qubit.
+ * @slots: In: slots of the targets. Out: their local slots.
+ * @global: Which entries of @slots are global.
+ * @k: Number of targets.
+ *
+ * Each global target is swapped with the least recently used local qubit
+ * that is not a target.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int dist_localize(unsigned int* slots, const int* global, unsigned int k) {
+    for (unsigned int i = 0; i < k; i++) {
+        unsigned int victim = SIM_SV_MAX_QUBITS;
+
+        if (!global[i]) continue;
+        for (unsigned int l = 0; l < dist.sv.nqubits; l++) {
+            int target = 0;
+
+            for (unsigned int j = 0; j < k; j++)
+                target |= !global[j] && slots[j] == l;
+            for (unsigned int j = 0; j < i; j++)
+                target |= global[j] && slots[j] == l;   // already swapped in
+            if (!target && (victim == SIM_SV_MAX_QUBITS || dist.stamp[l] < dist.stamp[victim]))
+                victim = l;
+        }
+        if (victim == SIM_SV_MAX_QUBITS || dist_swap(slots[i], victim)) return -1;
+        slots[i] = victim;
+    }
+    return 0;
+}
+
+// Applies one lowered gate; @ids[0] is the high index bit of @m
+static int dist_apply(unsigned int k, const uint64_t* ids, const double complex* m) {
+    unsigned int slots[3];
+    int global[3], any = 0;
+
+    for (unsigned int i = 0; i < k; i++) {
+        int s = dist_qubit(ids[i], &global[i]);
+
+        if (s < 0) return -1;
+        slots[i] = (unsigned int)s;
+        any |= global[i];
+    }
+    if (any && dist_localize(slots, global, k)) return -1;
+    for (unsigned int i = 0; i < k; i++)
+        dist.stamp[slots[i]] = ++dist.clock;
+
+    switch (k) {
+        case 1: return sim_sv_apply1(&dist.sv, slots[0], m);
+        case 2: return sim_sv_apply2(&dist.sv, slots[0], slots[1], m);
+        default: return sim_sv_apply3(&dist.sv, slots[0], slots[1], slots[2], m);
+    }
+}
+
+/**
+ * backend_dist_apply_gate - Runs one gate on the distributed register.
+ * @gate_code: Gate.
+ * @args: Gate arguments (same structs as the sim backend).
+ *
+ * Collective: every rank must make the same call.
+ *
+ * Returns 0 on success, -1 on invalid arguments, an unsupported gate, a full
+ * register or a communication failure.
+ */
+int backend_dist_apply_gate(int gate_code, void* args) {
+    static sim_ops ops;
+    int ret = 0;
+
+    if (!args || dist_init()) return -1;
+
+    switch (gate_code) {
+        case 3301: { // identity: only brings the qubit into the register
+            nymya_qubit* q = *(nymya_qubit**)args;
+            int global;
+
+            return q && dist_qubit(q->id, &global) >= 0 ? 0 : -1;
+        }
+        case 3342: // deutsch: the oracle callback works on scalar qubits
+            if (dist.rank == 0)
+                fprintf(stderr, "[dist backend] Gate %d is not supported on a distributed register\n",
+                        gate_code);
+            return -1;
+        case 3361: // qrng_range touches no qubits
+            return backend_sim_apply_gate(gate_code, args);
+        default:
+            break;
+    }
+
+    ops.count = 0;
+    ops.nmats = 0;
+    if (backend_sim_lower_gate(gate_code, args, &ops, 0)) return -1;
+    for (size_t i = 0; i < ops.count && !ret; i++)
+        ret = dist_apply(ops.ops[i].k, ops.ops[i].ids, ops.mats + ops.ops[i].m);
+    return ret;
+}
+
+/**
+ * backend_dist_prob_one - Probability of measuring a qubit as |1>.
+ * @q: Qubit, looked up by ID.
+ * @p: Receives the probability, on every rank.
+ *
+ * Collective. Returns 0 on success, -1 if @q has never been used by a gate.
+ */
+int backend_dist_prob_one(const nymya_qubit* q, double* p) {
+    double local = 0, total = 0;
+    int s, global = 0;
+
+    if (!q || !p || !dist.ready) return -1;
+    s = sim_sv_find(&dist.sv, q->id);
+    if (s < 0) {
+        s = dist_find_global(q->id);
+        global = 1;
+    }
+    if (s < 0) return -1;
+
+    if (!global) {
+        local = sim_sv_prob_one(&dist.sv, (unsigned int)s);
+    } else if ((dist.rank >> s) & 1) {
+        for (size_t i = 0; i < dist.sv.dim; i++)
+            local += creal(dist.sv.amp[i] * conj(dist.sv.amp[i]));
+    }
+    if (MPI_Allreduce(&local, &total, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD) != MPI_SUCCESS)
+        return -1;
+    *p = total;
+    return 0;
+}
+
+/**
+ * backend_dist_rank - This process's rank, or 0 before the backend is used.
+ */
+int backend_dist_rank(void) {
+    return dist.ready ? dist.rank : 0;
+}
+
+/**
+ * backend_dist_reset - Discards the register; the next gate starts a new one.
+ *
+ * MPI stays initialised.
+ */
+void backend_dist_reset(void) {
+    if (!dist.ready) return;
+    sim_sv_free(&dist.sv);
+    dist.gused = 0;
+    dist.clock = 0;
+    memset(dist.stamp, 0, sizeof(dist.stamp));
+    dist.ready = 0;
+}
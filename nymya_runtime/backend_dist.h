@@ -0,0 +1,15 @@
+#ifndef NYMYA_BACKEND_DIST_H
+#define NYMYA_BACKEND_DIST_H
+
+#include <nymya/nymya.h>
+
+// Core gate executor for the MPI-distributed state vector (make MPI=1).
+// Every call is collective: all ranks issue the same gates in the same order.
+int backend_dist_apply_gate(int gate_code, void* args);
+
+// Register queries; qubits are looked up by ID
+int backend_dist_prob_one(const nymya_qubit* q, double* p);
+int backend_dist_rank(void);
+void backend_dist_reset(void);
+
+#endif // NYMYA_BACKEND_DIST_H
@@ -3,8 +3,29 @@
 
 #include <stdint.h>
 #include <nymya/nymya.h>
+#include "nymya_runtime.h"
+#include "nymya_qpu.h"
 
 // Core gate executor for gate-based QPUs (Google Willow, IBM-Q, etc.)
 int backend_gateqpu_apply_gate(int gate_code, void* args);
+int backend_gateqpu_flush(void);
+void backend_gateqpu_reset(void);
+
+// Serializes @c into the ops, ids and nqubits of @req for a job submission or
+// a circuit file; backend_gateqpu_run_ops() executes such records
+int backend_gateqpu_lower(const nymya_circuit* c, nymya_qpu_request* req);
+int backend_gateqpu_check_ops(const nymya_op* ops, size_t nops, size_t nqubits);
+int backend_gateqpu_arity(uint32_t gate_code);
+int backend_gateqpu_run_ops(const nymya_op* ops, size_t nops, nymya_qubit* qubits, size_t nqubits);
+int backend_gateqpu_run_ops_strided(const nymya_op* ops, size_t nops, void* qubits,
+                                    size_t stride, size_t nqubits);
+
+// Job queue (nymya_job.c): queues a filled-in request whose ops and ids the
+// caller keeps alive until the job is freed
+nymya_job* nymya_job_submit_borrowed(const nymya_qpu_request* req, nymya_job_fn done, void* user);
+int nymya_job_device_attached(void);
+
+// Hardware entropy for qrng_range (nymya_entropy.c)
+int nymya_entropy_range(uint64_t* out, size_t n, uint64_t min, uint64_t max);
 
 #endif // NYMYA_BACKEND_GATEQPU_H
@@ -0,0 +1,191 @@
+// backend_gpu.c
+//
+// GPU backend. The state vector lives in device memory (gpu_statevec.cu) and
+// never comes back to the host; reads are reductions that return one number.
+//
+// Gate calls are lowered with the simulator's gate definitions and queued on
+// the host. The queue is flushed when a read needs the state or when it holds
+// GPU_BATCH_OPS gates: the simulator's circuit planner fuses the queued gates
+// into 1-3 qubit blocks and the whole batch goes to the device as one upload
+// and one kernel launch, so launch latency is paid per batch, not per gate.
+//
+// Qubits join in |0> the first time a gate names their ID. A qubit's bit is
+// fixed at that point; the device register only grows when the next batch is
+// flushed, which is equivalent because the new qubits are untouched until then.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+#include "backend_gpu.h"
+#include "backend_sim.h"
+#include "sim_compile.h"
+#include "gpu_statevec.h"
+
+#define GPU_BATCH_OPS 512
+
+typedef struct gpu_state {
+    gpu_sv* sv;
+    uint64_t ids[GPU_SV_MAX_QUBITS];
+    unsigned int n;      // qubits with a bit, >= the device register's count
+    sim_ops queue;       // lowered gates not yet on the device
+    sim_ops fused;
+    gpu_gate* gates;
+    size_t gates_cap;
+} gpu_state;
+
+static __thread gpu_state gpu;
+
+static int gpu_find(uint64_t id) {
+    for (unsigned int i = 0; i < gpu.n; i++) {
+        if (gpu.ids[i] == id) return (int)i;
+    }
+    return -1;
+}
+
+// Register bit of @id, assigning the next one on first use
+static int gpu_qubit(uint64_t id) {
+    int t = gpu_find(id);
+
+    if (t >= 0) return t;
+    if (gpu.n == GPU_SV_MAX_QUBITS) {
+        fprintf(stderr, "[gpu backend] Register full (%d qubits)\n", GPU_SV_MAX_QUBITS);
+        return -1;
+    }
+    gpu.ids[gpu.n] = id;
+    return (int)gpu.n++;
+}
+
+/**
+ * gpu_upload - Hands a fused gate list to the device as one batch.
+ * @ops: Fused gates; every ID already has a bit.
+ *
+ * Returns 0 on success, -1 on allocation or device failure.
+ */
+static int gpu_upload(const sim_ops* ops) {
+    if (ops->count > gpu.gates_cap) {
+        gpu_gate* g = realloc(gpu.gates, ops->count * sizeof(*g));
+
+        if (!g) return -1;
+        gpu.gates = g;
+        gpu.gates_cap = ops->count;
+    }
+    for (size_t i = 0; i < ops->count; i++) {
+        const sim_op* op = &ops->ops[i];
+
+        gpu.gates[i].k = op->k;
+        gpu.gates[i].m = op->m;
+        for (unsigned int j = 0; j < 3; j++)
+            gpu.gates[i].t[j] = j < op->k ? (uint32_t)gpu_find(op->ids[j]) : 0;
+    }
+    return gpu_sv_run(gpu.sv, gpu.gates, ops->count, (const double*)ops->mats, ops->nmats);
+}
+
+/**
+ * backend_gpu_flush - Runs the queued gates on the device.
+ *
+ * Fuses the queue unless NYMYA_SIM_NOFUSE is set. Returns without waiting
+ * for the device.
+ *
+ * Returns 0 on success, -1 if there is no device or a transfer or launch
+ * fails; the queue is dropped either way.
+ */
+int backend_gpu_flush(void) {
+    const sim_ops* run = &gpu.queue;
+    int ret = 0;
+
+    if (!gpu.sv && !(gpu.sv = gpu_sv_new())) {
+        gpu.queue.count = gpu.queue.nmats = 0;
+        return -1;
+    }
+    if (gpu.n > gpu_sv_qubits(gpu.sv))
+        ret = gpu_sv_grow(gpu.sv, gpu.n);
+
+    if (!ret && gpu.queue.count && !getenv("NYMYA_SIM_NOFUSE")) {
+        sim_plan* plan = sim_plan_build(&gpu.queue, NULL);
+
+        gpu.fused.count = gpu.fused.nmats = 0;
+        ret = plan ? sim_plan_lower(plan, &gpu.queue, &gpu.fused) : -1;
+        sim_plan_free(plan);
+        run = &gpu.fused;
+    }
+    if (!ret) ret = gpu_upload(run);
+
+    gpu.queue.count = gpu.queue.nmats = 0;
+    return ret;
+}
+
+/**
+ * backend_gpu_apply_gate - Queues one gate for the device.
+ * @gate_code: Gate.
+ * @args: Gate arguments (same structs as the sim backend).
+ *
+ * Returns 0 on success, -1 on invalid arguments, an unsupported gate, a full
+ * register, or a failed flush.
+ */
+int backend_gpu_apply_gate(int gate_code, void* args) {
+    size_t first, first_m;
+
+    if (!args) return -1;
+
+    switch (gate_code) {
+        case 3301: // identity: only brings the qubit into the register
+            return gpu_qubit((*(nymya_qubit**)args)->id) < 0 ? -1 : 0;
+        case 3342: // deutsch: the oracle callback works on scalar qubits
+            fprintf(stderr, "[gpu backend] Gate %d is not supported on the GPU\n", gate_code);
+            return -1;
+        case 3361: // qrng_range touches no qubits
+            return backend_sim_apply_gate(gate_code, args);
+        default:
+            break;
+    }
+
+    first = gpu.queue.count;
+    first_m = gpu.queue.nmats;
+    if (backend_sim_lower_gate(gate_code, args, &gpu.queue, 0)) {
+        gpu.queue.count = first;
+        gpu.queue.nmats = first_m;
+        return -1;
+    }
+    for (size_t i = first; i < gpu.queue.count; i++) {
+        const sim_op* op = &gpu.queue.ops[i];
+
+        for (unsigned int j = 0; j < op->k; j++) {
+            if (gpu_qubit(op->ids[j]) < 0) {
+                gpu.queue.count = first;
+                gpu.queue.nmats = first_m;
+                return -1;
+            }
+        }
+    }
+    return gpu.queue.count >= GPU_BATCH_OPS ? backend_gpu_flush() : 0;
+}
+
+/**
+ * backend_gpu_prob_one - Probability of measuring a qubit as |1>.
+ * @q: Qubit, looked up by ID.
+ * @p: Receives the probability.
+ *
+ * Returns 0 on success, -1 if @q has never been used by a gate or the
+ * device fails.
+ */
+int backend_gpu_prob_one(const nymya_qubit* q, double* p) {
+    int t;
+
+    if (!q || !p) return -1;
+    t = gpu_find(q->id);
+    if (t < 0 || backend_gpu_flush()) return -1;
+    return gpu_sv_prob_one(gpu.sv, (unsigned int)t, p);
+}
+
+/**
+ * backend_gpu_reset - Drops the register and any queued gates.
+ */
+void backend_gpu_reset(void) {
+    gpu_sv_free(gpu.sv);
+    sim_ops_free(&gpu.queue);
+    sim_ops_free(&gpu.fused);
+    free(gpu.gates);
+    memset(&gpu, 0, sizeof(gpu));
+}
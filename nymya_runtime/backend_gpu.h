@@ -0,0 +1,14 @@
+#ifndef NYMYA_BACKEND_GPU_H
+#define NYMYA_BACKEND_GPU_H
+
+#include <nymya/nymya.h>
+
+// Core gate executor for the GPU backend (built with make CUDA=1)
+int backend_gpu_apply_gate(int gate_code, void* args);
+
+// Register queries; they run the queued gates first
+int backend_gpu_prob_one(const nymya_qubit* q, double* p);
+int backend_gpu_flush(void);
+void backend_gpu_reset(void);
+
+#endif // NYMYA_BACKEND_GPU_H
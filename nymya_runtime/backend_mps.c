@@ -0,0 +1,753 @@
+// backend_mps.c
+//
+// Matrix-product-state backend. The qubits form a chain of site tensors
+// A[l][s][r], one per qubit, joined by bonds whose dimension tracks the
+// entanglement across each cut. Lattices with bounded local entanglement keep
+// their bonds small, so memory grows linearly in the number of qubits rather
+// than as 2^n.
+//
+// Gates are lowered to 1-3 qubit matrices with the simulator's own gate
+// definitions (backend_sim_lower_gate). A k-qubit gate brings its qubits next
+// to each other with SWAPs, contracts the k sites, applies the matrix and
+// splits the result again by SVD. Each split keeps at most max_bond singular
+// values and drops the smallest ones while their weight stays within the
+// truncation threshold. The chain is kept in mixed-canonical form around one
+// site, which makes every truncation locally optimal and every single-qubit
+// probability a one-site contraction.
+//
+// Qubits join at the end of the chain in |0> the first time a gate names
+// their ID, as in the simulator backend.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+#include "backend_mps.h"
+#include "backend_sim.h"
+#include "sim_compile.h"
+
+#define MPS_DEFAULT_MAX_BOND 64
+#define MPS_DEFAULT_CUTOFF   1e-10
+#define MPS_JACOBI_SWEEPS    60
+
+static const double complex MPS_SWAP[16] = {
+    1, 0, 0, 0,
+    0, 0, 1, 0,
+    0, 1, 0, 0,
+    0, 0, 0, 1,
+};
+
+/**
+ * mps_site - One site tensor.
+ * @dl: Left bond dimension.
+ * @dr: Right bond dimension.
+ * @a: Entries, a[(l * 2 + s) * dr + r].
+ */
+typedef struct mps_site {
+    size_t dl, dr;
+    double complex* a;
+} mps_site;
+
+/**
+ * mps_chain - The whole state.
+ * @n: Number of qubits.
+ * @cap: Allocated qubits.
+ * @sites: Site tensors by chain position.
+ * @at: Qubit index held at each position.
+ * @pos: Position of each qubit index; SWAPs move qubits along the chain.
+ * @ids: nymya_qubit ID of each qubit index.
+ * @map_key: Open-addressed table from qubit ID ...
+ * @map_slot: ... to 1 + its qubit index (0 = empty).
+ * @map_cap: Table size, a power of two.
+ * @center: Position of the orthogonality center.
+ * @max_bond: Largest bond dimension a split may keep.
+ * @cutoff: Largest discarded weight (relative) per split.
+ * @discarded: Sum of the weight discarded so far.
+ */
+typedef struct mps_chain {
+    size_t n;
+    size_t cap;
+    mps_site* sites;
+    size_t* at;
+    size_t* pos;
+    uint64_t* ids;
+    uint64_t* map_key;
+    size_t* map_slot;
+    size_t map_cap;
+    size_t center;
+    size_t max_bond;
+    double cutoff;
+    double discarded;
+} mps_chain;
+
+static __thread mps_chain mps = { .max_bond = MPS_DEFAULT_MAX_BOND, .cutoff = MPS_DEFAULT_CUTOFF };
+
+static size_t* mps_map_find(mps_chain* c, uint64_t id) {
+    size_t mask = c->map_cap - 1;
+    size_t i = (size_t)(id * 0x9E3779B97F4A7C15ull) & mask;
+
+    while (c->map_slot[i] && c->map_key[i] != id)
+        i = (i + 1) & mask;
+    c->map_key[i] = id;
+    return &c->map_slot[i];
+}
+
+static int mps_grow(mps_chain* c) {
+    size_t cap = c->cap ? 2 * c->cap : 64;
+    mps_site* sites = realloc(c->sites, cap * sizeof(*sites));
+    size_t* at;
+    size_t* pos;
+    uint64_t* ids;
+    uint64_t* map_key;
+    size_t* map_slot;
+
+    if (!sites) return -1;
+    c->sites = sites;
+    at = realloc(c->at, cap * sizeof(*at));
+    if (!at) return -1;
+    c->at = at;
+    pos = realloc(c->pos, cap * sizeof(*pos));
+    if (!pos) return -1;
+    c->pos = pos;
+    ids = realloc(c->ids, cap * sizeof(*ids));
+    if (!ids) return -1;
+    c->ids = ids;
+
+    map_key = calloc(2 * cap, sizeof(*map_key));
+    map_slot = calloc(2 * cap, sizeof(*map_slot));
+    if (!map_key || !map_slot) {
+        free(map_key);
+        free(map_slot);
+        return -1;
+    }
+    free(c->map_key);
+    free(c->map_slot);
+    c->map_key = map_key;
+    c->map_slot = map_slot;
+    c->map_cap = 2 * cap;
+    c->cap = cap;
+    for (size_t j = 0; j < c->n; j++)
+        *mps_map_find(c, c->ids[j]) = j + 1;
+    return 0;
+}
+
+/**
+ * mps_qubit - Maps a qubit to its index, appending it to the chain in |0> if new.
+ * @q: Qubit; its ID is the key.
+ *
+ * A product site with unit bonds is both left- and right-normalized, so the
+ * canonical form around the current center survives the append.
+ *
+ * Returns the qubit index, or -1 if @q is NULL or memory runs out.
+ */
+static long mps_qubit(const nymya_qubit* q) {
+    mps_chain* c = &mps;
+    mps_site* s;
+    size_t* slot;
+    size_t j;
+
+    if (!q) return -1;
+    if (c->map_cap) {
+        slot = mps_map_find(c, q->id);
+        if (*slot) return (long)(*slot - 1);
+    }
+    if (c->n == c->cap && mps_grow(c)) return -1;
+
+    j = c->n;
+    s = &c->sites[j];
+    s->a = calloc(2, sizeof(*s->a));
+    if (!s->a) return -1;
+    s->dl = s->dr = 1;
+    s->a[0] = 1;
+
+    c->n++;
+    c->at[j] = j;
+    c->pos[j] = j;
+    c->ids[j] = q->id;
+    *mps_map_find(c, q->id) = j + 1;
+    return (long)j;
+}
+
+/**
+ * mps_svd - Truncated SVD of a row-major matrix, M ~ U diag(s) Vh.
+ * @m: rows x cols matrix.
+ * @rows: Row count.
+ * @cols: Column count.
+ * @max_k: Most singular values to keep.
+ * @cutoff: Largest relative weight (sum of s^2) the dropped values may carry.
+ * @u: Receives U, rows x k, row-major.
+ * @s: Receives the k kept singular values, descending and rescaled so that
+ *     their squares sum to the full weight.
+ * @vh: Receives Vh, k x cols, row-major.
+ * @dropped: Receives the relative weight discarded.
+ *
+ * One-sided (Hestenes) Jacobi on whichever of M, M^H has fewer columns:
+ * column pairs are rotated until all are orthogonal, at which point the
+ * column norms are the singular values. Exact numerical zeros are always
+ * dropped. The caller frees the three outputs.
+ *
+ * Returns k, or 0 on allocation failure.
+ */
+static size_t mps_svd(const double complex* m, size_t rows, size_t cols, size_t max_k,
+                      double cutoff, double complex** u, double** s, double complex** vh,
+                      double* dropped) {
+    int tr = rows < cols;
+    size_t mr = tr ? cols : rows, nc = tr ? rows : cols;
+    double complex* a = malloc(mr * nc * sizeof(*a));   // column-major, mr x nc
+    double complex* v = calloc(nc * nc, sizeof(*v));    // column-major, nc x nc
+    double* sv = malloc(nc * sizeof(*sv));
+    size_t* order = malloc(nc * sizeof(*order));
+    double total = 0, kept = 0, tail = 0;
+    size_t k;
+
+    *u = NULL;
+    *vh = NULL;
+    *s = NULL;
+    if (!a || !v || !sv || !order) goto fail;
+
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            if (tr) a[i * mr + j] = conj(m[i * cols + j]);
+            else a[j * mr + i] = m[i * cols + j];
+        }
+    }
+    for (size_t j = 0; j < nc; j++)
+        v[j * nc + j] = 1;
+
+    for (int sweep = 0; sweep < MPS_JACOBI_SWEEPS; sweep++) {
+        int rotated = 0;
+
+        for (size_t p = 0; p + 1 < nc; p++) {
+            for (size_t q = p + 1; q < nc; q++) {
+                double complex* ap = a + p * mr;
+                double complex* aq = a + q * mr;
+                double alpha = 0, beta = 0, g, zeta, t, cs, sn;
+                double complex gamma = 0, ph;
+
+                for (size_t i = 0; i < mr; i++) {
+                    alpha += creal(ap[i]) * creal(ap[i]) + cimag(ap[i]) * cimag(ap[i]);
+                    beta += creal(aq[i]) * creal(aq[i]) + cimag(aq[i]) * cimag(aq[i]);
+                    gamma += conj(ap[i]) * aq[i];
+                }
+                g = cabs(gamma);
+                if (g <= 1e-15 * sqrt(alpha * beta) || g < 1e-300) continue;
+                rotated = 1;
+
+                // Real Jacobi rotation of (a_p, a_q e^-i arg(gamma))
+                zeta = (beta - alpha) / (2 * g);
+                t = (zeta >= 0 ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1 + zeta * zeta));
+                cs = 1 / sqrt(1 + t * t);
+                sn = cs * t;
+                ph = conj(gamma) / g;
+
+                for (size_t i = 0; i < mr; i++) {
+                    double complex x = ap[i], y = aq[i] * ph;
+
+                    ap[i] = cs * x - sn * y;
+                    aq[i] = sn * x + cs * y;
+                }
+                for (size_t i = 0; i < nc; i++) {
+                    double complex x = v[p * nc + i], y = v[q * nc + i] * ph;
+
+                    v[p * nc + i] = cs * x - sn * y;
+                    v[q * nc + i] = sn * x + cs * y;
+                }
+            }
+        }
+        if (!rotated) break;
+    }
+
+    for (size_t j = 0; j < nc; j++) {
+        double w = 0;
+
+        for (size_t i = 0; i < mr; i++)
+            w += creal(a[j * mr + i]) * creal(a[j * mr + i]) +
+                 cimag(a[j * mr + i]) * cimag(a[j * mr + i]);
+        sv[j] = sqrt(w);
+        total += w;
+        order[j] = j;
+    }
+    // Insertion sort, descending; nc is at most a few hundred
+    for (size_t j = 1; j < nc; j++) {
+        size_t o = order[j], i = j;
+
+        while (i > 0 && sv[order[i - 1]] < sv[o]) {
+            order[i] = order[i - 1];
+            i--;
+        }
+        order[i] = o;
+    }
+
+    k = 0;
+    while (k < nc && sv[order[k]] > 1e-13 * sv[order[0]]) k++;
+    if (k == 0) k = 1;
+    if (k > max_k) k = max_k;
+    for (size_t j = k; j < nc; j++) tail += sv[order[j]] * sv[order[j]];
+    while (k > 1 && tail + sv[order[k - 1]] * sv[order[k - 1]] <= cutoff * total) {
+        k--;
+        tail += sv[order[k]] * sv[order[k]];
+    }
+    kept = total - tail;
+    *dropped = total > 0 ? tail / total : 0;
+
+    *u = malloc(rows * k * sizeof(**u));
+    *vh = malloc(k * cols * sizeof(**vh));
+    *s = malloc(k * sizeof(**s));
+    if (!*u || !*vh || !*s) goto fail;
+
+    for (size_t j = 0; j < k; j++) {
+        size_t o = order[j];
+        double sj = sv[o], inv = sj > 0 ? 1 / sj : 0;
+
+        (*s)[j] = kept > 0 ? sj * sqrt(total / kept) : sj;
+        // A V = U' diag(s): U' column o is a_o / s_o and V column o is v_o
+        for (size_t i = 0; i < mr; i++) {
+            double complex x = a[o * mr + i] * inv;
+
+            if (tr) (*vh)[j * cols + i] = conj(x);  // M^H = U' s V^H, so Vh = U'^H
+            else (*u)[i * k + j] = x;
+        }
+        for (size_t i = 0; i < nc; i++) {
+            double complex x = v[o * nc + i];
+
+            if (tr) (*u)[i * k + j] = x;
+            else (*vh)[j * cols + i] = conj(x);
+        }
+    }
+
+    free(a);
+    free(v);
+    free(sv);
+    free(order);
+    return k;
+
+fail:
+    free(a);
+    free(v);
+    free(sv);
+    free(order);
+    free(*u);
+    free(*vh);
+    free(*s);
+    *u = NULL;
+    *vh = NULL;
+    *s = NULL;
+    return 0;
+}
+
+// Moves the orthogonality center from position i to i + 1
+static int mps_move_right(mps_chain* c, size_t i) {
+    mps_site* l = &c->sites[i];
+    mps_site* r = &c->sites[i + 1];
+    double complex *u, *vh, *na;
+    double* s;
+    double dropped;
+    size_t k = mps_svd(l->a, l->dl * 2, l->dr, SIZE_MAX, 0, &u, &s, &vh, &dropped);
+
+    if (!k) return -1;
+    na = calloc(k * 2 * r->dr, sizeof(*na));
+    if (!na) {
+        free(u); free(s); free(vh);
+        return -1;
+    }
+    // r <- diag(s) Vh r
+    for (size_t x = 0; x < k; x++) {
+        for (size_t m = 0; m < l->dr; m++) {
+            double complex w = s[x] * vh[x * l->dr + m];
+
+            if (w == 0) continue;
+            for (size_t j = 0; j < 2 * r->dr; j++)
+                na[x * 2 * r->dr + j] += w * r->a[m * 2 * r->dr + j];
+        }
+    }
+    free(l->a);
+    free(r->a);
+    l->a = u;
+    l->dr = k;
+    r->a = na;
+    r->dl = k;
+    free(s);
+    free(vh);
+    c->center = i + 1;
+    return 0;
+}
+
+// Moves the orthogonality center from position i to i - 1
+static int mps_move_left(mps_chain* c, size_t i) {
+    mps_site* r = &c->sites[i];
+    mps_site* l = &c->sites[i - 1];
+    double complex *u, *vh, *na;
+    double* s;
+    double dropped;
+    size_t k = mps_svd(r->a, r->dl, 2 * r->dr, SIZE_MAX, 0, &u, &s, &vh, &dropped);
+
+    if (!k) return -1;
+    na = calloc(l->dl * 2 * k, sizeof(*na));
+    if (!na) {
+        free(u); free(s); free(vh);
+        return -1;
+    }
+    // l <- l U diag(s)
+    for (size_t j = 0; j < l->dl * 2; j++) {
+        for (size_t m = 0; m < r->dl; m++) {
+            double complex w = l->a[j * l->dr + m];
+
+            if (w == 0) continue;
+            for (size_t x = 0; x < k; x++)
+                na[j * k + x] += w * u[m * k + x] * s[x];
+        }
+    }
+    free(l->a);
+    free(r->a);
+    l->a = na;
+    l->dr = k;
+    r->a = vh;
+    r->dl = k;
+    free(u);
+    free(s);
+    c->center = i - 1;
+    return 0;
+}
+
+static int mps_center_to(mps_chain* c, size_t p) {
+    while (c->center < p) {
+        if (mps_move_right(c, c->center)) return -1;
+    }
+    while (c->center > p) {
+        if (mps_move_left(c, c->center)) return -1;
+    }
+    return 0;
+}
+
+/**
+ * mps_apply_local - Applies a gate to k consecutive sites.
+ * @c: Chain.
+ * @p: First position.
+ * @k: Number of sites, 2 or 3.
+ * @g: Row-major 2^k x 2^k matrix; site @p is the high index bit.
+ *
+ * The center moves to @p, the sites are contracted into one tensor
+ * theta[l][x][r], the gate acts on x, and theta is split back site by site
+ * with truncated SVDs. The center ends on @p + @k - 1.
+ *
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int mps_apply_local(mps_chain* c, size_t p, unsigned int k, const double complex* g) {
+    size_t dl, dr, d, px = 2;
+    double complex *t, *nt;
+
+    if (mps_center_to(c, p)) return -1;
+
+    dl = c->sites[p].dl;
+    d = c->sites[p].dr;
+    t = malloc(dl * 2 * d * sizeof(*t));
+    if (!t) return -1;
+    memcpy(t, c->sites[p].a, dl * 2 * d * sizeof(*t));
+
+    // theta[l][x * 2 + s][r] = sum_m theta[l][x][m] A[m][s][r]
+    for (unsigned int j = 1; j < k; j++) {
+        mps_site* s = &c->sites[p + j];
+
+        nt = calloc(dl * px * 2 * s->dr, sizeof(*nt));
+        if (!nt) {
+            free(t);
+            return -1;
+        }
+        for (size_t lx = 0; lx < dl * px; lx++) {
+            for (size_t m = 0; m < d; m++) {
+                double complex w = t[lx * d + m];
+
+                if (w == 0) continue;
+                for (size_t sr = 0; sr < 2 * s->dr; sr++)
+                    nt[lx * 2 * s->dr + sr] += w * s->a[m * 2 * s->dr + sr];
+            }
+        }
+        free(t);
+        t = nt;
+        px *= 2;
+        d = s->dr;
+    }
+    dr = d;
+
+    nt = calloc(dl * px * dr, sizeof(*nt));
+    if (!nt) {
+        free(t);
+        return -1;
+    }
+    for (size_t l = 0; l < dl; l++) {
+        for (size_t y = 0; y < px; y++) {
+            double complex* out = nt + (l * px + y) * dr;
+
+            for (size_t x = 0; x < px; x++) {
+                double complex w = g[y * px + x];
+                const double complex* in = t + (l * px + x) * dr;
+
+                if (w == 0) continue;
+                for (size_t r = 0; r < dr; r++)
+                    out[r] += w * in[r];
+            }
+        }
+    }
+    free(t);
+    t = nt;
+
+    // Peel one site off the left of theta[l][x][r] per split
+    for (unsigned int j = 0; j + 1 < k; j++) {
+        mps_site* s = &c->sites[p + j];
+        double complex *u, *vh;
+        double* sv;
+        double dropped;
+        size_t rest = (px / 2) * dr;
+        size_t kk = mps_svd(t, dl * 2, rest, c->max_bond, c->cutoff, &u, &sv, &vh, &dropped);
+
+        if (!kk) {
+            free(t);
+            return -1;
+        }
+        c->discarded += dropped;
+        for (size_t x = 0; x < kk; x++) {
+            for (size_t i = 0; i < rest; i++)
+                vh[x * rest + i] *= sv[x];
+        }
+        free(sv);
+        free(t);
+        free(s->a);
+        s->a = u;
+        s->dl = dl;
+        s->dr = kk;
+        t = vh;
+        dl = kk;
+        px /= 2;
+    }
+
+    free(c->sites[p + k - 1].a);
+    c->sites[p + k - 1].a = t;
+    c->sites[p + k - 1].dl = dl;
+    c->sites[p + k - 1].dr = dr;
+    c->center = p + k - 1;
+    return 0;
+}
+
+// Exchanges the qubits at positions i and i + 1
+static int mps_swap(mps_chain* c, size_t i) {
+    size_t a = c->at[i], b = c->at[i + 1];
+
+    if (mps_apply_local(c, i, 2, MPS_SWAP)) return -1;
+    c->at[i] = b;
+    c->at[i + 1] = a;
+    c->pos[a] = i + 1;
+    c->pos[b] = i;
+    return 0;
+}
+
+/**
+ * mps_apply - Applies a lowered gate to qubits anywhere on the chain.
+ * @c: Chain.
+ * @k: Number of targets, 1 to 3.
+ * @qs: Qubit indices; @qs[0] is the high index bit of @m.
+ * @m: Row-major 2^k x 2^k matrix.
+ *
+ * The targets are gathered next to the leftmost one by SWAPs; where they
+ * end up in chain order, @m is re-indexed to match.
+ *
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int mps_apply(mps_chain* c, unsigned int k, const size_t* qs, const double complex* m) {
+    size_t o[3] = { 0 }, p;
+    unsigned int bit[3] = { 0 };
+    size_t dim = (size_t)1 << k;
+    double complex g[64];
+
+    if (k == 1) {
+        mps_site* s = &c->sites[c->pos[qs[0]]];
+
+        for (size_t l = 0; l < s->dl; l++) {
+            double complex* a0 = s->a + (l * 2) * s->dr;
+            double complex* a1 = a0 + s->dr;
+
+            for (size_t r = 0; r < s->dr; r++) {
+                double complex x = a0[r], y = a1[r];
+
+                a0[r] = m[0] * x + m[1] * y;
+                a1[r] = m[2] * x + m[3] * y;
+            }
+        }
+        return 0;
+    }
+
+    // Targets in chain order
+    for (unsigned int j = 0; j < k; j++) o[j] = qs[j];
+    for (unsigned int j = 1; j < k; j++) {
+        for (unsigned int i = j; i > 0 && c->pos[o[i - 1]] > c->pos[o[i]]; i--) {
+            size_t t = o[i];
+
+            o[i] = o[i - 1];
+            o[i - 1] = t;
+        }
+    }
+    p = c->pos[o[0]];
+    for (unsigned int j = 1; j < k; j++) {
+        while (c->pos[o[j]] > p + j) {
+            if (mps_swap(c, c->pos[o[j]] - 1)) return -1;
+        }
+    }
+
+    // Gate bit of each target: qs[t] is bit k - 1 - t of the gate index
+    for (unsigned int j = 0; j < k; j++) {
+        for (unsigned int t = 0; t < k; t++) {
+            if (qs[t] == o[j]) bit[j] = k - 1 - t;
+        }
+    }
+    for (size_t y = 0; y < dim; y++) {
+        for (size_t x = 0; x < dim; x++) {
+            size_t gy = 0, gx = 0;
+
+            for (unsigned int j = 0; j < k; j++) {
+                gy |= ((y >> (k - 1 - j)) & 1) << bit[j];
+                gx |= ((x >> (k - 1 - j)) & 1) << bit[j];
+            }
+            g[y * dim + x] = m[gy * dim + gx];
+        }
+    }
+    return mps_apply_local(c, p, k, g);
+}
+
+/**
+ * backend_mps_apply_gate - Runs one gate on the MPS.
+ * @gate_code: Gate.
+ * @args: Gate arguments (same structs as the sim backend).
+ *
+ * Returns 0 on success, -1 on invalid arguments, an unsupported gate or
+ * allocation failure.
+ */
+int backend_mps_apply_gate(int gate_code, void* args) {
+    static __thread sim_ops ops;
+    int ret = 0;
+
+    if (!args) return -1;
+
+    switch (gate_code) {
+        case 3301: // identity: only brings the qubit into the chain
+            return mps_qubit(*(nymya_qubit**)args) < 0 ? -1 : 0;
+        case 3342: // deutsch: the oracle callback works on scalar qubits
+            fprintf(stderr, "[mps backend] Gate %d is not supported on an MPS\n", gate_code);
+            return -1;
+        case 3361: // qrng_range touches no qubits
+            return backend_sim_apply_gate(gate_code, args);
+        default:
+            break;
+    }
+
+    ops.count = 0;
+    ops.nmats = 0;
+    if (backend_sim_lower_gate(gate_code, args, &ops, 0)) return -1;
+
+    for (size_t i = 0; i < ops.count && !ret; i++) {
+        const sim_op* op = &ops.ops[i];
+        size_t qs[3];
+
+        for (unsigned int j = 0; j < op->k; j++) {
+            long q = mps_qubit(&(nymya_qubit){ .id = op->ids[j] });
+
+            if (q < 0) return -1;
+            qs[j] = (size_t)q;
+        }
+        ret = mps_apply(&mps, op->k, qs, ops.mats + op->m);
+    }
+    return ret;
+}
+
+/**
+ * backend_mps_prob_one - Probability of measuring a qubit as |1>.
+ * @q: Qubit, looked up by ID.
+ * @p: Receives the probability.
+ *
+ * With the center on the qubit's site, the reduced density matrix of the
+ * qubit is read off that site alone.
+ *
+ * Returns 0 on success, -1 if @q has never been used by a gate.
+ */
+int backend_mps_prob_one(const nymya_qubit* q, double* p) {
+    mps_chain* c = &mps;
+    mps_site* s;
+    size_t* slot;
+    double w[2] = { 0, 0 };
+
+    if (!q || !p || !c->map_cap) return -1;
+    slot = mps_map_find(c, q->id);
+    if (!*slot) return -1;
+    if (mps_center_to(c, c->pos[*slot - 1])) return -1;
+
+    s = &c->sites[c->center];
+    for (size_t l = 0; l < s->dl; l++) {
+        for (size_t b = 0; b < 2; b++) {
+            const double complex* a = s->a + (l * 2 + b) * s->dr;
+
+            for (size_t r = 0; r < s->dr; r++)
+                w[b] += creal(a[r]) * creal(a[r]) + cimag(a[r]) * cimag(a[r]);
+        }
+    }
+    *p = w[0] + w[1] > 0 ? w[1] / (w[0] + w[1]) : 0;
+    return 0;
+}
+
+/**
+ * backend_mps_set_limits - Sets the truncation applied by later gates.
+ * @max_bond: Largest bond dimension; 0 restores the default (64).
+ * @cutoff: Relative weight each SVD may discard; negative restores the
+ *          default (1e-10), 0 keeps every non-zero singular value.
+ */
+void backend_mps_set_limits(size_t max_bond, double cutoff) {
+    mps.max_bond = max_bond ? max_bond : MPS_DEFAULT_MAX_BOND;
+    mps.cutoff = cutoff < 0 ? MPS_DEFAULT_CUTOFF : cutoff;
+}
+
+/**
+ * backend_mps_max_bond - Bond dimension cap in effect for new splits.
+ */
+size_t backend_mps_max_bond(void) {
+    return mps.max_bond;
+}
+
+/**
+ * backend_mps_get_stats - Reports the size of the current state.
+ * @stats: Receives the counters.
+ */
+void backend_mps_get_stats(nymya_mps_stats* stats) {
+    const mps_chain* c = &mps;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->qubits = c->n;
+    stats->discarded = c->discarded;
+    for (size_t i = 0; i < c->n; i++) {
+        const mps_site* s = &c->sites[i];
+
+        if (s->dr > stats->max_bond) stats->max_bond = s->dr;
+        stats->bytes += s->dl * 2 * s->dr * sizeof(*s->a);
+    }
+}
+
+/**
+ * backend_mps_reset - Discards the chain; the next gate starts a new one.
+ *
+ * The truncation limits are kept.
+ */
+void backend_mps_reset(void) {
+    size_t max_bond = mps.max_bond;
+    double cutoff = mps.cutoff;
+
+    for (size_t i = 0; i < mps.n; i++)
+        free(mps.sites[i].a);
+    free(mps.sites);
+    free(mps.at);
+    free(mps.pos);
+    free(mps.ids);
+    free(mps.map_key);
+    free(mps.map_slot);
+    memset(&mps, 0, sizeof(mps));
+    mps.max_bond = max_bond;
+    mps.cutoff = cutoff;
+}
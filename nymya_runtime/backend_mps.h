@@ -0,0 +1,21 @@
+#ifndef NYMYA_BACKEND_MPS_H
+#define NYMYA_BACKEND_MPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+#include "nymya_runtime.h"
+
+// Core gate executor for the matrix-product-state backend
+int backend_mps_apply_gate(int gate_code, void* args);
+
+// Chain queries; qubits are looked up by ID
+int backend_mps_prob_one(const nymya_qubit* q, double* p);
+void backend_mps_get_stats(nymya_mps_stats* stats);
+void backend_mps_reset(void);
+
+// Truncation: bond dimension cap and discarded-weight threshold per SVD
+void backend_mps_set_limits(size_t max_bond, double cutoff);
+size_t backend_mps_max_bond(void);
+
+#endif // NYMYA_BACKEND_MPS_H
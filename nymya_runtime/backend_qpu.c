@@ -2,109 +2,1148 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
 #include <nymya/nymya.h>
 #include "backend_gateqpu.h"
+#include "nymya_circuit.h"
+#include "nymya_gates.h"
+#include "qpu_native.h"
 
-// Argument structs (same as sim backend)
-typedef struct { nymya_qubit* q; } qpu_arg_q;
-typedef struct { nymya_qubit* q; double theta; } qpu_arg_q_theta;
-typedef struct { nymya_qubit* q1, *q2; } qpu_arg_q2;
-typedef struct { nymya_qubit* q1, *q2; double theta; } qpu_arg_q2_theta;
-typedef struct { nymya_qubit* q1, *q2, *q3; } qpu_arg_q3;
-typedef struct { nymya_qubit** qs; size_t count; } qpu_arg_q_arr;
-typedef struct { nymya_qpos3d* qs; size_t count; } qpu_arg_q3d;
-typedef struct { nymya_qpos4d* qs; size_t count; } qpu_arg_q4d;
-typedef struct { nymya_qpos5d* qs; size_t count; } qpu_arg_q5d;
-typedef struct { uint64_t* out; uint64_t min, max; size_t count; } qpu_arg_qrng;
+// Argument structs
+typedef nymya_arg_q qpu_arg_q;
+typedef nymya_arg_q_theta qpu_arg_q_theta;
+typedef nymya_arg_q2 qpu_arg_q2;
+typedef nymya_arg_q2_theta qpu_arg_q2_theta;
+typedef nymya_arg_q3 qpu_arg_q3;
+typedef nymya_arg_q_arr qpu_arg_q_arr;
+typedef nymya_arg_q3d qpu_arg_q3d;
+typedef nymya_arg_q4d qpu_arg_q4d;
+typedef nymya_arg_q5d qpu_arg_q5d;
+typedef nymya_arg_qrng qpu_arg_qrng;
 
-int backend_gateqpu_apply_gate(int gate_code, void* args) {
+// Bytes a program buffers before a chunk goes to the sink mid-circuit
+#define QPU_STREAM_CHUNK (256u * 1024)
+
+/**
+ * qpu_stream - Program being emitted by the calling thread.
+ * @buf: OpenQASM 3 text not yet handed to the sink.
+ * @len: Bytes used in @buf.
+ * @cap: Bytes allocated for @buf.
+ * @open: Set once the program header is written.
+ * @defined: QPU_DEF_* gates already defined in the program.
+ * @native: NYMYA_QPU_NATIVE_* set the program is written in, fixed when it opens.
+ * @err: Set when the buffer could not grow; the current gate fails.
+ */
+typedef struct qpu_stream {
+    char* buf;
+    size_t len;
+    size_t cap;
+    int open;
+    unsigned int defined;
+    int native;
+    int err;
+} qpu_stream;
+
+static __thread qpu_stream qpu_out;
+
+// Native gates of the current gate call, reused from call to call
+static __thread qpu_native_seq qpu_nseq;
+
+// Sink shared by all threads; read under the lock at each flush
+static pthread_mutex_t qpu_sink_lock = PTHREAD_MUTEX_INITIALIZER;
+static nymya_qpu_sink_fn qpu_sink;
+static void* qpu_sink_ctx;
+static pthread_once_t qpu_exit_once = PTHREAD_ONCE_INIT;
+
+static int qpu_stdout_sink(void* ctx, const char* data, size_t len, int end) {
+    (void)ctx;
+    if (fwrite(data, 1, len, stdout) != len) return -1;
+    return end ? fflush(stdout) : 0;
+}
+
+void nymya_qpu_set_sink(nymya_qpu_sink_fn fn, void* ctx) {
+    pthread_mutex_lock(&qpu_sink_lock);
+    qpu_sink = fn;
+    qpu_sink_ctx = fn ? ctx : NULL;
+    pthread_mutex_unlock(&qpu_sink_lock);
+}
+
+// Hands the buffered text to the sink; @end closes the program
+static int qpu_stream_send(int end) {
+    nymya_qpu_sink_fn fn;
+    void* ctx;
+    int ret;
+
+    pthread_mutex_lock(&qpu_sink_lock);
+    fn = qpu_sink ? qpu_sink : qpu_stdout_sink;
+    ctx = qpu_sink_ctx;
+    pthread_mutex_unlock(&qpu_sink_lock);
+
+    ret = fn(ctx, qpu_out.buf, qpu_out.len, end);
+    if (ret) fprintf(stderr, "[QPU] Sink rejected %zu bytes of program.\n", qpu_out.len);
+    qpu_out.len = 0;
+    if (end) {
+        qpu_out.open = 0;
+        qpu_out.defined = 0;
+    }
+    return ret ? -1 : 0;
+}
+
+/**
+ * backend_gateqpu_flush - Ends the calling thread's program and sends it.
+ *
+ * Called by the runtime when a circuit run finishes, before the thread
+ * switches backends, and from nymya_flush(). Does nothing if no gate ran
+ * since the last flush.
+ *
+ * Returns 0, or -1 if the sink failed.
+ */
+int backend_gateqpu_flush(void) {
+    return qpu_out.open ? qpu_stream_send(1) : 0;
+}
+
+// A reset ends the program and releases the buffer, e.g. at thread exit
+void backend_gateqpu_reset(void) {
+    backend_gateqpu_flush();
+    free(qpu_out.buf);
+    qpu_out = (qpu_stream){ 0 };
+    qpu_native_seq_free(&qpu_nseq);
+}
+
+// The main thread's last program would otherwise be lost at exit()
+static void qpu_stream_exit(void) {
+    backend_gateqpu_flush();
+}
+
+static void qpu_stream_atexit(void) {
+    atexit(qpu_stream_exit);
+}
+
+static void qpu_put(const char* s, size_t n) {
+    if (qpu_out.len + n > qpu_out.cap) {
+        size_t cap = qpu_out.cap ? qpu_out.cap : 2 * QPU_STREAM_CHUNK;
+        while (cap < qpu_out.len + n) cap *= 2;
+        char* buf = realloc(qpu_out.buf, cap);
+        if (!buf) {
+            qpu_out.err = 1;
+            return;
+        }
+        qpu_out.buf = buf;
+        qpu_out.cap = cap;
+    }
+    memcpy(qpu_out.buf + qpu_out.len, s, n);
+    qpu_out.len += n;
+}
+
+static void qpu_puts(const char* s) {
+    qpu_put(s, strlen(s));
+}
+
+// Physical qubit operand: OpenQASM 3 "$<id>", so no register is declared
+static void qpu_put_qubit(const nymya_qubit* q) {
+    char tmp[24];
+    char* p = tmp + sizeof(tmp);
+    uint64_t id = q->id;
+
+    do {
+        *--p = (char)('0' + id % 10);
+        id /= 10;
+    } while (id);
+    *--p = '$';
+    qpu_put(p, (size_t)(tmp + sizeof(tmp) - p));
+}
+
+static void qpu_put_angle(double theta) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%.17g", theta);
+
+    qpu_put(tmp, (size_t)n);
+}
+
+// Emits "gate(theta) q1, q2, q3;"; @theta is used only if @has_theta
+static void qpu_emit(const char* gate, int has_theta, double theta,
+                     const nymya_qubit* q1, const nymya_qubit* q2, const nymya_qubit* q3) {
+    const nymya_qubit* q[3] = { q1, q2, q3 };
+
+    qpu_puts(gate);
+    if (has_theta) {
+        qpu_put("(", 1);
+        qpu_put_angle(theta);
+        qpu_put(")", 1);
+    }
+    for (int i = 0; i < 3 && q[i]; i++) {
+        qpu_put(i ? ", " : " ", i ? 2 : 1);
+        qpu_put_qubit(q[i]);
+    }
+    qpu_put(";\n", 2);
+}
+
+static void qpu_g1(const char* g, const nymya_qubit* a) { qpu_emit(g, 0, 0, a, NULL, NULL); }
+static void qpu_g2(const char* g, const nymya_qubit* a, const nymya_qubit* b) { qpu_emit(g, 0, 0, a, b, NULL); }
+static void qpu_g3(const char* g, const nymya_qubit* a, const nymya_qubit* b, const nymya_qubit* c) {
+    qpu_emit(g, 0, 0, a, b, c);
+}
+static void qpu_g1t(const char* g, double t, const nymya_qubit* a) { qpu_emit(g, 1, t, a, NULL, NULL); }
+static void qpu_g2t(const char* g, double t, const nymya_qubit* a, const nymya_qubit* b) {
+    qpu_emit(g, 1, t, a, b, NULL);
+}
+
+// Two-qubit Pauli rotations exp(-i t/2 PP), defined on first use in a program
+enum { QPU_DEF_RXX, QPU_DEF_RYY, QPU_DEF_RZZ };
+
+static const char* const qpu_defs[] = {
+    [QPU_DEF_RXX] = "gate rxx(t) a, b { h a; h b; cx a, b; rz(t) b; cx a, b; h a; h b; }\n",
+    [QPU_DEF_RYY] = "gate ryy(t) a, b { rx(pi/2) a; rx(pi/2) b; cx a, b; rz(t) b; cx a, b; "
+                    "rx(-pi/2) a; rx(-pi/2) b; }\n",
+    [QPU_DEF_RZZ] = "gate rzz(t) a, b { cx a, b; rz(t) b; cx a, b; }\n",
+};
+
+static void qpu_pp(unsigned int def, double theta, const nymya_qubit* a, const nymya_qubit* b) {
+    static const char* const name[] = { "rxx", "ryy", "rzz" };
+
+    if (!(qpu_out.defined & (1u << def))) {
+        qpu_puts(qpu_defs[def]);
+        qpu_out.defined |= 1u << def;
+    }
+    qpu_g2t(name[def], theta, a, b);
+}
+
+// exp(-i theta/2 (XX + YY)) and exp(-i theta/2 (XX + YY + ZZ)); the terms commute
+static void qpu_xy(double theta, const nymya_qubit* a, const nymya_qubit* b) {
+    qpu_pp(QPU_DEF_RXX, theta, a, b);
+    qpu_pp(QPU_DEF_RYY, theta, a, b);
+}
+
+static void qpu_xyz(double theta, const nymya_qubit* a, const nymya_qubit* b) {
+    qpu_xy(theta, a, b);
+    qpu_pp(QPU_DEF_RZZ, theta, a, b);
+}
+
+// SWAP^alpha = e^{i pi alpha/4} exp(-i pi alpha/4 (XX + YY + ZZ))
+static void qpu_swap_pow(double alpha, const nymya_qubit* a, const nymya_qubit* b) {
+    qpu_xyz(M_PI * alpha / 2, a, b);
+    qpu_emit("gphase", 1, M_PI * alpha / 4, NULL, NULL, NULL);
+}
+
+// Phase flip of |111>
+static void qpu_ccz(const nymya_qubit* a, const nymya_qubit* b, const nymya_qubit* c) {
+    qpu_g1("h", c);
+    qpu_g3("ccx", a, b, c);
+    qpu_g1("h", c);
+}
+
+// Writes native gates; operand slot i is @q[i]
+static void qpu_put_native(const qpu_native_seq* s, nymya_qubit* const* q) {
+    for (size_t i = 0; i < s->n; i++) {
+        const qpu_native_op* op = &s->op[i];
+
+        switch (op->gate_code) {
+            case NYMYA_ROTATE_Z_CODE: qpu_g1t("rz", op->theta, q[op->qubit[0]]); break;
+            case NYMYA_SQRT_X_CODE: qpu_g1("sx", q[op->qubit[0]]); break;
+            case NYMYA_PAULI_X_CODE: qpu_g1("x", q[op->qubit[0]]); break;
+            case NYMYA_CNOT_CODE: qpu_g2("cx", q[op->qubit[0]], q[op->qubit[1]]); break;
+            default: qpu_g2("cz", q[op->qubit[0]], q[op->qubit[1]]); break;
+        }
+    }
+}
+
+/**
+ * qpu_cx_list - H's and CNOTs of a lattice gate, collected before they are written.
+ * @p: The CNOTs in the gate's order, as indices into its qubit list.
+ * @n: Entries used in @p.
+ * @cap: Entries allocated for @p.
+ * @h: Qubit indices that take an H ahead of every CNOT.
+ * @nh: Entries used in @h.
+ * @hcap: Entries allocated for @h.
+ * @err: Set when @p or @h could not grow.
+ */
+typedef struct qpu_cx_list {
+    nymya_graph_pair* p;
+    size_t n;
+    size_t cap;
+    uint32_t* h;
+    size_t nh;
+    size_t hcap;
+    int err;
+} qpu_cx_list;
+
+static void qpu_cx_h(qpu_cx_list* l, size_t i) {
+    if (l->err) return;
+    if (l->nh == l->hcap) {
+        size_t cap = l->hcap ? 2 * l->hcap : 64;
+        uint32_t* h = realloc(l->h, cap * sizeof(*h));
+
+        if (!h) {
+            l->err = 1;
+            return;
+        }
+        l->h = h;
+        l->hcap = cap;
+    }
+    l->h[l->nh++] = (uint32_t)i;
+}
+
+static void qpu_cx(qpu_cx_list* l, size_t c, size_t t) {
+    if (l->err) return;
+    if (l->n == l->cap) {
+        size_t cap = l->cap ? 2 * l->cap : 64;
+        nymya_graph_pair* p = realloc(l->p, cap * sizeof(*p));
+
+        if (!p) {
+            l->err = 1;
+            return;
+        }
+        l->p = p;
+        l->cap = cap;
+    }
+    l->p[l->n].ctrl = (uint32_t)c;
+    l->p[l->n].target = (uint32_t)t;
+    l->n++;
+}
+
+/**
+ * qpu_cx_write - Writes the H's of a lattice gate, then its CNOTs.
+ * @l: Gates.
+ * @q: Qubit of each index in @l.
+ * @n: Number of qubits.
+ * @order: CNOTs of @l in the order to write them, or NULL if there are none.
+ *
+ * In a native gate set each H becomes rz sx rz, and on a cz target the H's
+ * around each CNOT merge with their neighbours.
+ *
+ * Returns 0, or -1 if the native sequence could not be built.
+ */
+static int qpu_cx_write(const qpu_cx_list* l, nymya_qubit* const* q, size_t n, const uint32_t* order) {
+    qpu_native_builder b;
+
+    if (!qpu_out.native) {
+        for (size_t i = 0; i < l->nh; i++) qpu_g1("h", q[l->h[i]]);
+        for (size_t i = 0; order && i < l->n; i++) {
+            const nymya_graph_pair* p = &l->p[order[i]];
+            qpu_g2("cx", q[p->ctrl], q[p->target]);
+        }
+        return 0;
+    }
+
+    qpu_nseq.n = 0;
+    if (qpu_native_begin(&b, qpu_out.native, n, &qpu_nseq)) return -1;
+    for (size_t i = 0; i < l->nh; i++) qpu_native_h(&b, l->h[i]);
+    for (size_t i = 0; order && i < l->n; i++) {
+        const nymya_graph_pair* p = &l->p[order[i]];
+        qpu_native_cx(&b, p->ctrl, p->target);
+    }
+    if (qpu_native_end(&b)) return -1;
+    qpu_put_native(&qpu_nseq, q);
+    return 0;
+}
+
+// Whether layer @l is among the @n layers a qubit is already busy in
+static int qpu_busy(const uint32_t* layers, uint32_t n, uint32_t l) {
+    for (uint32_t k = 0; k < n; k++) {
+        if (layers[k] == l) return 1;
+    }
+    return 0;
+}
+
+/**
+ * qpu_cx_layers - Writes the collected gates of a lattice gate, CNOTs in layers.
+ * @l: H's and CNOTs; freed here.
+ * @q: Qubit of each index in @l.
+ * @n: Number of qubits.
+ *
+ * Same layering as nymya_graph_schedule() with ordered set: each CNOT goes
+ * into the first layer after every earlier CNOT it does not commute with
+ * (one whose target is its control or whose control is its target) in
+ * which neither of its qubits is used yet. The program is unchanged as a
+ * unitary, but CNOTs that can run at once are written together, so the
+ * circuit the device compiles has the least depth this greedy order finds.
+ *
+ * Returns 0, or -1 if @l or the scratch could not be allocated.
+ */
+static int qpu_cx_layers(qpu_cx_list* l, nymya_qubit* const* q, size_t n) {
+    size_t m = l->n, nlayers = 0;
+    size_t* start = NULL;
+    size_t* off = NULL;
+    uint32_t *fill = NULL, *lastc = NULL, *lastt = NULL, *busy = NULL, *layer = NULL;
+    int ret = -1;
+
+    if (l->err || m > UINT32_MAX / 2) goto out;
+    if (!m) {
+        ret = qpu_cx_write(l, q, n, NULL);
+        goto out;
+    }
+    start = calloc(n + 1, sizeof(*start));
+    fill = calloc(n, sizeof(*fill));
+    lastc = calloc(n, sizeof(*lastc));
+    lastt = calloc(n, sizeof(*lastt));
+    busy = calloc(2 * m, sizeof(*busy));
+    layer = calloc(m, sizeof(*layer));
+    if (!start || !fill || !lastc || !lastt || !busy || !layer) goto out;
+
+    for (size_t i = 0; i < m; i++) {
+        start[l->p[i].ctrl + 1]++;
+        start[l->p[i].target + 1]++;
+    }
+    for (size_t i = 0; i < n; i++) start[i + 1] += start[i];
+
+    // Layers are numbered from 1; 0 is "before every CNOT", where the H's are
+    for (size_t i = 0; i < m; i++) {
+        uint32_t c = l->p[i].ctrl, t = l->p[i].target;
+        uint32_t k = lastt[c] > lastc[t] ? lastt[c] : lastc[t];
+
+        do k++;
+        while (qpu_busy(busy + start[c], fill[c], k) || qpu_busy(busy + start[t], fill[t], k));
+        layer[i] = k;
+        busy[start[c] + fill[c]++] = k;
+        busy[start[t] + fill[t]++] = k;
+        if (k > lastc[c]) lastc[c] = k;
+        if (k > lastt[t]) lastt[t] = k;
+        if (k > nlayers) nlayers = k;
+    }
+
+    // Bucket the CNOTs by layer into @busy, done with now, keeping their order
+    // within a layer
+    off = calloc(nlayers + 2, sizeof(*off));
+    if (!off) goto out;
+    for (size_t i = 0; i < m; i++) off[layer[i] + 1]++;
+    for (size_t k = 1; k <= nlayers + 1; k++) off[k] += off[k - 1];
+    for (size_t i = 0; i < m; i++) busy[off[layer[i]]++] = (uint32_t)i;
+    ret = qpu_cx_write(l, q, n, busy);
+out:
+    if (ret) fprintf(stderr, "[QPU] Out of memory scheduling %zu CNOTs.\n", m);
+    free(off);
+    free(layer);
+    free(busy);
+    free(lastt);
+    free(lastc);
+    free(fill);
+    free(start);
+    free(l->p);
+    free(l->h);
+    l->p = NULL;
+    l->h = NULL;
+    l->n = l->cap = l->nh = l->hcap = 0;
+    return ret;
+}
+
+// Lattice gates expand into the H and CNOT sequences backend_sim.c runs; the
+// gates of qubits @o onwards go to @l.
+static void qpu_ring(qpu_cx_list* l, size_t o, size_t n) {
+    for (size_t i = 0; i < n; i++) qpu_cx_h(l, o + i);
+    for (size_t i = 0; i < n; i++) qpu_cx(l, o + i, o + (i + 1) % n);
+}
+
+static void qpu_triangle(qpu_cx_list* l, size_t o) {
+    qpu_cx_h(l, o);
+    qpu_cx(l, o, o + 1);
+    qpu_cx(l, o + 1, o + 2);
+    qpu_cx(l, o + 2, o);
+}
+
+// No H touches q[0], so every H can go ahead of the CNOTs
+static void qpu_hex_rhombi(qpu_cx_list* l, size_t o) {
+    for (size_t i = 1; i < 7; i++) {
+        qpu_cx_h(l, o + i);
+        qpu_cx(l, o, o + i);
+    }
+    for (size_t i = 1; i < 6; i++) {
+        qpu_cx(l, o + i, o + i + 1);
+        qpu_cx(l, o + i + 1, o);
+    }
+    qpu_cx(l, o + 6, o + 1);
+    qpu_cx(l, o + 1, o);
+}
+
+static void qpu_e8_group(qpu_cx_list* l) {
+    for (size_t i = 0; i < 8; i++) qpu_cx_h(l, i);
+    for (size_t i = 0; i < 8; i++) {
+        for (size_t j = i + 1; j < 8; j++) {
+            qpu_cx(l, i, j);
+            qpu_cx(l, j, i);
+        }
+    }
+}
+
+static void qpu_flower_of_life(qpu_cx_list* l) {
+    for (size_t i = 0; i < 19; i++) qpu_cx_h(l, i);
+    for (size_t i = 1; i < 19; i++) qpu_cx(l, 0, i);
+    for (size_t j = 1; j <= 6; j++) qpu_cx(l, j, (j % 6) + 1);
+    for (size_t j = 7; j < 18; j++) qpu_cx(l, j, j + 1);
+    qpu_cx(l, 18, 7);
+}
+
+static void qpu_metatron_cube(qpu_cx_list* l) {
+    for (size_t i = 0; i < 13; i++) qpu_cx_h(l, i);
+    for (size_t i = 1; i < 13; i++) qpu_cx(l, 0, i);
+    for (size_t i = 1; i <= 6; i++) qpu_cx(l, i, i + 6);
+}
+
+// Same pair scan as sim_positional(): H on every site, CNOT within @cutoff
+static int qpu_positional(void* sites, size_t stride, size_t q_off, size_t count,
+                          unsigned int dims, double cutoff) {
+    qpu_cx_list l = { 0 };
+    nymya_qubit** q;
+    char* base = sites;
+    int ret;
+
+    if (!sites || count == 0 || count > UINT32_MAX) return -1;
+    q = malloc(count * sizeof(*q));
+    if (!q) return -1;
+    for (size_t i = 0; i < count; i++) {
+        q[i] = (nymya_qubit*)(base + i * stride + q_off);
+        qpu_cx_h(&l, i);
+    }
+    for (size_t i = 0; i < count; i++) {
+        const double* ci = (const double*)(base + i * stride);
+
+        for (size_t j = i + 1; j < count; j++) {
+            const double* cj = (const double*)(base + j * stride);
+            double d2 = 0;
+
+            for (unsigned int k = 0; k < dims; k++)
+                d2 += (ci[k] - cj[k]) * (ci[k] - cj[k]);
+            if (d2 <= cutoff * cutoff) qpu_cx(&l, i, j);
+        }
+    }
+    ret = qpu_cx_layers(&l, q, count);
+    free(q);
+    return ret;
+}
+
+static int qpu_arr_ok(const qpu_arg_q_arr* a, size_t n) {
+    if (!a || !a->qs || a->count < n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!a->qs[i]) return 0;
+    }
+    return 1;
+}
+
+static uint32_t qpu_axis(char axis) {
+    switch (axis) {
+        case 'x': case 'X': return 'X';
+        case 'y': case 'Y': return 'Y';
+        case 'z': case 'Z': return 'Z';
+    }
+    return 0;
+}
+
+// Operand shape of each gate code; only fixed-arity gates travel as nymya_op
+enum {
+    QPU_SHAPE_NONE,
+    QPU_SHAPE_Q,
+    QPU_SHAPE_Q_THETA,
+    QPU_SHAPE_Q_AXIS_THETA,
+    QPU_SHAPE_Q2,
+    QPU_SHAPE_Q2_THETA,
+    QPU_SHAPE_Q3
+};
+#define QPU_SHAPE_Q_ARR   QPU_SHAPE_NONE
+#define QPU_SHAPE_Q3D     QPU_SHAPE_NONE
+#define QPU_SHAPE_Q4D     QPU_SHAPE_NONE
+#define QPU_SHAPE_Q5D     QPU_SHAPE_NONE
+#define QPU_SHAPE_QRNG    QPU_SHAPE_NONE
+#define QPU_SHAPE_DEUTSCH QPU_SHAPE_NONE
+
+#define QPU_SHAPE_OF(name, code, args) [(code) - NYMYA_GATE_FIRST] = QPU_SHAPE_##args,
+static const unsigned char qpu_shapes[NYMYA_GATE_COUNT] = {
+    NYMYA_GATE_LIST(QPU_SHAPE_OF)
+};
+#undef QPU_SHAPE_OF
+
+static int qpu_shape_of(int gate_code) {
+    unsigned int i = (unsigned int)(gate_code - NYMYA_GATE_FIRST);
+
+    return i < NYMYA_GATE_COUNT ? qpu_shapes[i] : QPU_SHAPE_NONE;
+}
+
+/**
+ * qpu_operands - Operands of a fixed-arity gate call.
+ * @gate_code: Gate.
+ * @args: Its argument struct.
+ * @q: Receives the qubits, NYMYA_OP_MAX_OPERANDS entries.
+ * @theta: Receives the angle, 0 for gates without one.
+ * @axis: Receives the rotation axis as 'X', 'Y' or 'Z', 0 for other gates.
+ *
+ * Returns the qubit count, 0 for gates of any other shape, or -1 after
+ * reporting an invalid rotation axis.
+ */
+static int qpu_operands(int gate_code, const void* args, nymya_qubit** q, double* theta, uint32_t* axis) {
+    *theta = 0.0;
+    *axis = 0;
+    switch (qpu_shape_of(gate_code)) {
+        case QPU_SHAPE_Q: {
+            const qpu_arg_q* a = args;
+            q[0] = a->q;
+            return 1;
+        }
+        case QPU_SHAPE_Q_THETA: {
+            const qpu_arg_q_theta* a = args;
+            q[0] = a->q; *theta = a->theta;
+            return 1;
+        }
+        case QPU_SHAPE_Q_AXIS_THETA: {
+            const nymya_arg_q_axis_theta* a = args;
+            q[0] = a->q; *theta = a->theta;
+            *axis = qpu_axis(a->axis);
+            if (!*axis) {
+                fprintf(stderr, "[QPU] Invalid rotation axis '%c'.\n", a->axis);
+                return -1;
+            }
+            return 1;
+        }
+        case QPU_SHAPE_Q2: {
+            const qpu_arg_q2* a = args;
+            q[0] = a->q1; q[1] = a->q2;
+            return 2;
+        }
+        case QPU_SHAPE_Q2_THETA: {
+            const qpu_arg_q2_theta* a = args;
+            q[0] = a->q1; q[1] = a->q2; *theta = a->theta;
+            return 2;
+        }
+        case QPU_SHAPE_Q3: {
+            const qpu_arg_q3* a = args;
+            q[0] = a->q1; q[1] = a->q2; q[2] = a->q3;
+            return 3;
+        }
+    }
+    return 0;
+}
+
+// Emits one gate call; returns -1 for gates a program cannot express
+static int qpu_emit_gate(int gate_code, void* args) {
     switch (gate_code) {
-        // Single‐qubit gates
-        case 3301: { // identity
-            qpu_arg_q* a = args;
-            printf("[QPU] ID gate on qubit %ju\n", a->q->id);
-            break;
-        }
-        case 3302: { // global_phase
-            qpu_arg_q_theta* a = args;
-            printf("[QPU] Global phase %f on qubit %ju\n", a->theta, a->q->id);
-            break;
-        }
-        case 3303: { qpu_arg_q* a = args; printf("[QPU] Pauli-X on %ju\n", a->q->id); break; }
-        case 3304: { qpu_arg_q* a = args; printf("[QPU] Pauli-Y on %ju\n", a->q->id); break; }
-        case 3305: { qpu_arg_q* a = args; printf("[QPU] Pauli-Z on %ju\n", a->q->id); break; }
-        case 3306: { qpu_arg_q* a = args; printf("[QPU] S-gate on %ju\n", a->q->id); break; }
-        case 3307: { qpu_arg_q* a = args; printf("[QPU] √X on %ju\n", a->q->id); break; }
-        case 3308: { qpu_arg_q* a = args; printf("[QPU] Hadamard on %ju\n", a->q->id); break; }
-        case 3315: { qpu_arg_q_theta* a = args; printf("[QPU] Phase shift %f on %ju\n", a->theta, a->q->id); break; }
-        case 3316: { qpu_arg_q_theta* a = args; printf("[QPU] Parametric phase %f on %ju\n", a->theta, a->q->id); break; }
-        case 3319: { qpu_arg_q_theta* a = args; printf("[QPU] RX(%f) on %ju\n", a->theta, a->q->id); break; }
-        case 3320: { qpu_arg_q_theta* a = args; printf("[QPU] RY(%f) on %ju\n", a->theta, a->q->id); break; }
-        case 3321: { qpu_arg_q_theta* a = args; printf("[QPU] RZ(%f) on %ju\n", a->theta, a->q->id); break; }
-
-        // Two‐qubit gates
-        case 3309: { qpu_arg_q2* a = args; printf("[QPU] CNOT ctrl=%ju tgt=%ju\n", a->q1->id, a->q2->id); break; }
-        case 3310: { qpu_arg_q2* a = args; printf("[QPU] ACNOT ctrl=%ju tgt=%ju\n", a->q1->id, a->q2->id); break; }
-        case 3311: { qpu_arg_q2* a = args; printf("[QPU] CZ ctrl=%ju tgt=%ju\n", a->q1->id, a->q2->id); break; }
-        case 3312: { qpu_arg_q3* a = args; printf("[QPU] Toffoli c1=%ju c2=%ju tgt=%ju\n", a->q1->id, a->q2->id, a->q3->id); break; }
-        case 3313: { qpu_arg_q2* a = args; printf("[QPU] SWAP %ju ↔ %ju\n", a->q1->id, a->q2->id); break; }
-        case 3314: { qpu_arg_q2* a = args; printf("[QPU] iSWAP %ju ↔ %ju\n", a->q1->id, a->q2->id); break; }
-        case 3322: { qpu_arg_q2_theta* a = args; printf("[QPU] XX(%f) on %ju,%ju\n", a->theta, a->q1->id, a->q2->id); break; }
-        case 3323: { qpu_arg_q2_theta* a = args; printf("[QPU] YY(%f) on %ju,%ju\n", a->theta, a->q1->id, a->q2->id); break; }
-        case 3324: { qpu_arg_q2_theta* a = args; printf("[QPU] ZZ(%f) on %ju,%ju\n", a->theta, a->q1->id, a->q2->id); break; }
-        case 3325: { qpu_arg_q2_theta* a = args; printf("[QPU] XYZ-entangle(%f) on %ju,%ju\n", a->theta, a->q1->id, a->q2->id); break; }
-        case 3326: { qpu_arg_q2* a = args; printf("[QPU] √SWAP %ju ↔ %ju\n", a->q1->id, a->q2->id); break; }
-        case 3327: { qpu_arg_q2* a = args; printf("[QPU] √iSWAP %ju ↔ %ju\n", a->q1->id, a->q2->id); break; }
-        case 3328: { qpu_arg_q2_theta* a = args; printf("[QPU] SWAP^α(%f) %ju↔%ju\n", a->theta, a->q1->id, a->q2->id); break; }
-        case 3329: { qpu_arg_q3* a = args; printf("[QPU] Fredkin ctrl=%ju a=%ju b=%ju\n", a->q1->id, a->q2->id, a->q3->id); break; }
-        case 3333: { qpu_arg_q2* a = args; printf("[QPU] Controlled-V %ju->%ju\n", a->q1->id, a->q2->id); break; }
-        case 3334: { qpu_arg_q2* a = args; printf("[QPU] Core entangle %ju,%ju\n", a->q1->id, a->q2->id); break; }
-        case 3336: { qpu_arg_q2_theta* a = args; printf("[QPU] Echoed CR(%f) %ju,%ju\n", a->theta, a->q1->id, a->q2->id); break; }
-        case 3337: { qpu_arg_q2* a = args; printf("[QPU] Fermion-sim %ju,%ju\n", a->q1->id, a->q2->id); break; }
-        case 3338: { qpu_arg_q2_theta* a = args; printf("[QPU] Givens(%f) %ju,%ju\n", a->theta, a->q1->id, a->q2->id); break; }
-        case 3339: { qpu_arg_q2* a = args; printf("[QPU] Magic entangle %ju,%ju\n", a->q1->id, a->q2->id); break; }
-        case 3340: { qpu_arg_q2* a = args; printf("[QPU] Sycamore %ju,%ju\n", a->q1->id, a->q2->id); break; }
-        case 3341: { qpu_arg_q2* a = args; printf("[QPU] CZ+SWAP %ju,%ju\n", a->q1->id, a->q2->id); break; }
+        // Single-qubit gates
+        case 3301: { qpu_arg_q* a = args; qpu_g1("id", a->q); return 0; }
+        case 3302: { qpu_arg_q_theta* a = args; qpu_emit("gphase", 1, a->theta, NULL, NULL, NULL); return 0; }
+        case 3303: { qpu_arg_q* a = args; qpu_g1("x", a->q); return 0; }
+        case 3304: { qpu_arg_q* a = args; qpu_g1("y", a->q); return 0; }
+        case 3305: { qpu_arg_q* a = args; qpu_g1("z", a->q); return 0; }
+        case 3306: { qpu_arg_q* a = args; qpu_g1("s", a->q); return 0; }
+        case 3307: { qpu_arg_q* a = args; qpu_g1("sx", a->q); return 0; }
+        case 3308: { qpu_arg_q* a = args; qpu_g1("h", a->q); return 0; }
+        case 3315:   // phase_shift
+        case 3316: { qpu_arg_q_theta* a = args; qpu_g1t("p", a->theta, a->q); return 0; }
+        case 3319: { qpu_arg_q_theta* a = args; qpu_g1t("rx", a->theta, a->q); return 0; }
+        case 3320: { qpu_arg_q_theta* a = args; qpu_g1t("ry", a->theta, a->q); return 0; }
+        case 3321: { qpu_arg_q_theta* a = args; qpu_g1t("rz", a->theta, a->q); return 0; }
+        case 3330: { // generic rotate
+            nymya_arg_q_axis_theta* a = args;
+            static const char* const rot[] = { ['X'] = "rx", ['Y'] = "ry", ['Z'] = "rz" };
+            uint32_t axis = qpu_axis(a->axis);
+            if (!axis) {
+                fprintf(stderr, "[QPU] Invalid rotation axis '%c'.\n", a->axis);
+                return -1;
+            }
+            qpu_g1t(rot[axis], a->theta, a->q);
+            return 0;
+        }
+
+        // Two-qubit gates
+        case 3309: { qpu_arg_q2* a = args; qpu_g2("cx", a->q1, a->q2); return 0; }
+        case 3310: { // acnot: flip the target when the control is |0>
+            qpu_arg_q2* a = args;
+            qpu_g1("x", a->q1);
+            qpu_g2("cx", a->q1, a->q2);
+            qpu_g1("x", a->q1);
+            return 0;
+        }
+        case 3311: { qpu_arg_q2* a = args; qpu_g2("cz", a->q1, a->q2); return 0; }
+        case 3313: { qpu_arg_q2* a = args; qpu_g2("swap", a->q1, a->q2); return 0; }
+        case 3314: { qpu_arg_q2* a = args; qpu_xy(-M_PI / 2, a->q1, a->q2); return 0; } // iswap
+        case 3317: { qpu_arg_q2_theta* a = args; qpu_g2t("cp", a->theta, a->q1, a->q2); return 0; }
+        case 3318: { qpu_arg_q2* a = args; qpu_g2t("cp", M_PI / 2, a->q1, a->q2); return 0; }
+        case 3322: { qpu_arg_q2_theta* a = args; qpu_pp(QPU_DEF_RXX, a->theta, a->q1, a->q2); return 0; }
+        case 3323: { qpu_arg_q2_theta* a = args; qpu_pp(QPU_DEF_RYY, a->theta, a->q1, a->q2); return 0; }
+        case 3324: { qpu_arg_q2_theta* a = args; qpu_pp(QPU_DEF_RZZ, a->theta, a->q1, a->q2); return 0; }
+        case 3325: { qpu_arg_q2_theta* a = args; qpu_xyz(a->theta, a->q1, a->q2); return 0; }
+        case 3326: { qpu_arg_q2* a = args; qpu_swap_pow(0.5, a->q1, a->q2); return 0; }
+        case 3327: { qpu_arg_q2* a = args; qpu_xy(-M_PI / 4, a->q1, a->q2); return 0; } // sqrt_iswap
+        case 3328: { qpu_arg_q2_theta* a = args; qpu_swap_pow(a->theta, a->q1, a->q2); return 0; }
+        case 3332: { // berkeley: CNOT, P(θ) on q2, CNOT
+            qpu_arg_q2_theta* a = args;
+            qpu_g2("cx", a->q1, a->q2);
+            qpu_g1t("p", a->theta, a->q2);
+            qpu_g2("cx", a->q1, a->q2);
+            return 0;
+        }
+        case 3333: { // c_v: controlled √X = H CP(π/2) H on the target
+            qpu_arg_q2* a = args;
+            qpu_g1("h", a->q2);
+            qpu_g2t("cp", M_PI / 2, a->q1, a->q2);
+            qpu_g1("h", a->q2);
+            return 0;
+        }
+        case 3334: { // core_entangle: H on q1, then CNOT
+            qpu_arg_q2* a = args;
+            qpu_g1("h", a->q1);
+            qpu_g2("cx", a->q1, a->q2);
+            return 0;
+        }
+        case 3336: { // echo_cr: ZX(θ), ZZ(θ) with the target in the X basis
+            qpu_arg_q2_theta* a = args;
+            qpu_g1("h", a->q2);
+            qpu_pp(QPU_DEF_RZZ, a->theta, a->q1, a->q2);
+            qpu_g1("h", a->q2);
+            return 0;
+        }
+        case 3337: { // fermion_sim: SWAP, then CZ
+            qpu_arg_q2* a = args;
+            qpu_g2("swap", a->q1, a->q2);
+            qpu_g2("cz", a->q1, a->q2);
+            return 0;
+        }
+        case 3338: { // givens: the XY rotation conjugated by S on q1 turns iσx into σy
+            qpu_arg_q2_theta* a = args;
+            qpu_g1("sdg", a->q1);
+            qpu_xy(a->theta, a->q1, a->q2);
+            qpu_g1("s", a->q1);
+            return 0;
+        }
+        case 3339: { // magic: H, S on q1, CNOT, H on q1
+            qpu_arg_q2* a = args;
+            qpu_g1("h", a->q1);
+            qpu_g1("s", a->q1);
+            qpu_g2("cx", a->q1, a->q2);
+            qpu_g1("h", a->q1);
+            return 0;
+        }
+        case 3340: { // sycamore: sqrt(iSWAP), then CPHASE(π/6)
+            qpu_arg_q2* a = args;
+            qpu_xy(-M_PI / 4, a->q1, a->q2);
+            qpu_g2t("cp", M_PI / 6, a->q1, a->q2);
+            return 0;
+        }
+        case 3341: { // cz_swap
+            qpu_arg_q2* a = args;
+            qpu_g2("cz", a->q1, a->q2);
+            qpu_g2("swap", a->q1, a->q2);
+            return 0;
+        }
 
         // Three-qubit gates
-        case 3330: { qpu_arg_q3* a = args; printf("[QPU] Rotate \'%c\' %f+%fi on %ju\n", *((char*)&a->q1), creal(a->q2->amplitude), cimag(a->q2->amplitude), a->q1->id); break; }
-        case 3331: { qpu_arg_q3* a = args; printf("[QPU] Barenco %ju,%ju,%ju\n", a->q1->id, a->q2->id, a->q3->id); break; }
-        case 3332: { qpu_arg_q2_theta* a = args; printf("[QPU] Berkeley(%f) %ju,%ju\n", a->theta, a->q1->id, a->q2->id); break; }
-        case 3335: { qpu_arg_q3* a = args; printf("[QPU] Dagwood %ju,%ju,%ju\n", a->q1->id, a->q2->id, a->q3->id); break; }
-        case 3342: { qpu_arg_q3* a = args; printf("[QPU] Deutsch oracle %ju,%ju\n", a->q1->id, a->q2->id); break; }
-        case 3343: { qpu_arg_q3* a = args; printf("[QPU] Margolis %ju,%ju->%ju\n", a->q1->id, a->q2->id, a->q3->id); break; }
-        case 3344: { qpu_arg_q3* a = args; printf("[QPU] Peres %ju,%ju,%ju\n", a->q1->id, a->q2->id, a->q3->id); break; }
-        case 3345: { qpu_arg_q3* a = args; printf("[QPU] CF-SWAP %ju ctrl %ju,%ju\n", a->q1->id, a->q2->id, a->q3->id); break; }
+        case 3312:   // double_controlled_not
+        case 3331: { qpu_arg_q3* a = args; qpu_g3("ccx", a->q1, a->q2, a->q3); return 0; } // barenco
+        case 3329:   // fredkin
+        case 3335: { qpu_arg_q3* a = args; qpu_g3("cswap", a->q1, a->q2, a->q3); return 0; } // dagwood
+        case 3343: { qpu_arg_q3* a = args; qpu_ccz(a->q1, a->q2, a->q3); return 0; } // margolis
+        case 3344: { // peres: CNOT(q1, q3), then Margolis
+            qpu_arg_q3* a = args;
+            qpu_g2("cx", a->q1, a->q3);
+            qpu_ccz(a->q1, a->q2, a->q3);
+            return 0;
+        }
+        case 3345: { // cf_swap: controlled SWAP, then the controlled CZ of the fermionic sign
+            qpu_arg_q3* a = args;
+            qpu_g3("cswap", a->q1, a->q2, a->q3);
+            qpu_ccz(a->q1, a->q2, a->q3);
+            return 0;
+        }
 
         // Lattice & tessellation gates (arrays)
-        case 3346: { qpu_arg_q3* a = args; printf("[QPU] Triangle lattice (%ju,%ju,%ju)\n",
-                     a->q1->id, a->q2->id, a->q3->id); break; }
-        case 3347: { qpu_arg_q_arr* a = args; printf("[QPU] Hex lattice of %zu qubits\n", a->count); break; }
-        case 3348: { qpu_arg_q_arr* a = args; printf("[QPU] Hex→3 rhombi of %zu qubits\n", a->count); break; }
-        case 3349: { qpu_arg_q_arr* a = args; printf("[QPU] Tessellate triangles count=%zu\n", a->count); break; }
-        case 3350: { qpu_arg_q_arr* a = args; printf("[QPU] Tessellate hexagons count=%zu\n", a->count); break; }
-        case 3351: { qpu_arg_q_arr* a = args; printf("[QPU] Tessellate hex rhombi count=%zu\n", a->count); break; }
-        case 3352: { printf("[QPU] E8 group on 8 qubits\n"); break; }
-        case 3353: { qpu_arg_q_arr* a = args; printf("[QPU] Flower of Life count=%zu\n", a->count); break; }
-        case 3354: { qpu_arg_q_arr* a = args; printf("[QPU] Metatron’s Cube count=%zu\n", a->count); break; }
-        case 3355: { qpu_arg_q3d* a = args; printf("[QPU] FCC lattice count=%zu\n", a->count); break; }
-        case 3356: { qpu_arg_q3d* a = args; printf("[QPU] HCP lattice count=%zu\n", a->count); break; }
-        case 3357: { qpu_arg_q3d* a = args; printf("[QPU] E8 projected lattice count=%zu\n", a->count); break; }
-        case 3358: { qpu_arg_q4d* a = args; printf("[QPU] D4 4D lattice count=%zu\n", a->count); break; }
-        case 3359: { qpu_arg_q5d* a = args; printf("[QPU] B5 5D lattice count=%zu\n", a->count); break; }
-        case 3360: { qpu_arg_q5d* a = args; printf("[QPU] E5 projected 5D lattice count=%zu\n", a->count); break; }
-
-        // Quantum RNG
-        case 3361: { 
+        case 3346: {
+            qpu_arg_q3* a = args;
+            nymya_qubit* q[3] = { a->q1, a->q2, a->q3 };
+            qpu_cx_list l = { 0 };
+            qpu_triangle(&l, 0);
+            return qpu_cx_layers(&l, q, 3);
+        }
+        case 3347: {
+            qpu_arg_q_arr* a = args;
+            qpu_cx_list l = { 0 };
+            if (!qpu_arr_ok(a, 6)) return -1;
+            qpu_ring(&l, 0, 6);
+            return qpu_cx_layers(&l, a->qs, 6);
+        }
+        case 3348: {
+            qpu_arg_q_arr* a = args;
+            qpu_cx_list l = { 0 };
+            if (!qpu_arr_ok(a, 7)) return -1;
+            qpu_hex_rhombi(&l, 0);
+            return qpu_cx_layers(&l, a->qs, 7);
+        }
+        // Tessellations: the units share no qubits, so their layers line up
+        case 3349: {
+            qpu_arg_q_arr* a = args;
+            qpu_cx_list l = { 0 };
+            if (!qpu_arr_ok(a, 3)) return -1;
+            for (size_t g = 0; g < a->count / 3; g++) qpu_triangle(&l, 3 * g);
+            return qpu_cx_layers(&l, a->qs, a->count);
+        }
+        case 3350: {
+            qpu_arg_q_arr* a = args;
+            qpu_cx_list l = { 0 };
+            if (!qpu_arr_ok(a, 6)) return -1;
+            for (size_t g = 0; g < a->count / 6; g++) qpu_ring(&l, 6 * g, 6);
+            return qpu_cx_layers(&l, a->qs, a->count);
+        }
+        case 3351: {
+            qpu_arg_q_arr* a = args;
+            qpu_cx_list l = { 0 };
+            if (!qpu_arr_ok(a, 7)) return -1;
+            for (size_t g = 0; g < a->count / 7; g++) qpu_hex_rhombi(&l, 7 * g);
+            return qpu_cx_layers(&l, a->qs, a->count);
+        }
+        case 3352: {
+            qpu_arg_q_arr* a = args;
+            qpu_cx_list l = { 0 };
+            if (!qpu_arr_ok(a, 8)) return -1;
+            qpu_e8_group(&l);
+            return qpu_cx_layers(&l, a->qs, 8);
+        }
+        case 3353: {
+            qpu_arg_q_arr* a = args;
+            qpu_cx_list l = { 0 };
+            if (!qpu_arr_ok(a, 19)) return -1;
+            qpu_flower_of_life(&l);
+            return qpu_cx_layers(&l, a->qs, 19);
+        }
+        case 3354: {
+            qpu_arg_q_arr* a = args;
+            qpu_cx_list l = { 0 };
+            if (!qpu_arr_ok(a, 13)) return -1;
+            qpu_metatron_cube(&l);
+            return qpu_cx_layers(&l, a->qs, 13);
+        }
+        case 3355:   // fcc_lattice
+        case 3356:   // hcp_lattice
+        case 3357: { // e8_projected_lattice
+            qpu_arg_q3d* a = args;
+            return qpu_positional(a->qs, sizeof(nymya_qpos3d), offsetof(nymya_qpos3d, q),
+                                  a->count, 3, gate_code == 3357 ? 1.00 : 1.01);
+        }
+        case 3358: {
+            qpu_arg_q4d* a = args;
+            return qpu_positional(a->qs, sizeof(nymya_qpos4d), offsetof(nymya_qpos4d, q),
+                                  a->count, 4, 1.01);
+        }
+        case 3359:   // b5_lattice
+        case 3360: { // e5_projected_lattice
+            qpu_arg_q5d* a = args;
+            return qpu_positional(a->qs, sizeof(nymya_qpos5d), offsetof(nymya_qpos5d, q),
+                                  a->count, 5, gate_code == 3359 ? 1.00 : 1.05);
+        }
+
+        case 3342: // deutsch: the oracle is a host callback
+            fprintf(stderr, "[QPU] Gate %d has no OpenQASM 3 form.\n", gate_code);
+            return -1;
+
+        case 3361: { // qrng_range: served from prefetched device readouts, not a program
             qpu_arg_qrng* a = args;
-            printf("[QPU] Request QRNG %zu values in [%ju..%ju]\n", a->count, a->min, a->max);
-            break;
+            return nymya_entropy_range(a->out, a->count, a->min, a->max);
         }
 
         default:
-            printf("[QPU] Unknown gate code %d\n", gate_code);
+            fprintf(stderr, "[QPU] Unknown gate code %d\n", gate_code);
             return -1;
     }
+}
+
+// Emits one gate call in the stream's native gate set; array gates pick the set up in qpu_cx_write()
+static int qpu_emit_native(int gate_code, void* args) {
+    nymya_qubit* q[NYMYA_OP_MAX_OPERANDS];
+    double theta;
+    uint32_t axis;
+    int arity = qpu_operands(gate_code, args, q, &theta, &axis);
 
+    if (arity <= 0) return arity < 0 ? -1 : qpu_emit_gate(gate_code, args);
+    if (qpu_native_gate(qpu_out.native, gate_code, theta, (char)axis, &qpu_nseq)) {
+        fprintf(stderr, "[QPU] Gate %d has no native decomposition.\n", gate_code);
+        return -1;
+    }
+    qpu_put_native(&qpu_nseq, q);
     return 0;
 }
+
+/**
+ * backend_gateqpu_apply_gate - Appends a gate to the thread's OpenQASM 3 program.
+ * @gate_code: Gate.
+ * @args: Its argument struct.
+ *
+ * Gates are written in stdgates.inc terms on physical qubits $<id>; composite
+ * gates are expanded, or, with a native gate set (nymya_qpu_set_native()),
+ * every gate is written in rz, sx, x and cx or cz. Text collects in a buffer
+ * that goes to the sink (see
+ * nymya_qpu_set_sink()) in QPU_STREAM_CHUNK pieces and as a whole program at
+ * backend_gateqpu_flush(), so nothing is written per gate.
+ *
+ * Returns 0, or -1 if the gate cannot be expressed or the sink failed.
+ */
+int backend_gateqpu_apply_gate(int gate_code, void* args) {
+    size_t mark;
+    unsigned int defined;
+    int ret;
+
+    if (!args) return -1;
+    if (!qpu_out.open) {
+        pthread_once(&qpu_exit_once, qpu_stream_atexit);
+        qpu_puts("OPENQASM 3.0;\ninclude \"stdgates.inc\";\n");
+        qpu_out.open = 1;
+        qpu_out.native = qpu_native_target();
+    }
+
+    mark = qpu_out.len;
+    defined = qpu_out.defined;
+    ret = qpu_out.native ? qpu_emit_native(gate_code, args) : qpu_emit_gate(gate_code, args);
+    if (ret || qpu_out.err) {
+        // Drop the partial text of a gate that failed
+        if (qpu_out.err) fprintf(stderr, "[QPU] Out of memory for the program buffer.\n");
+        qpu_out.len = mark;
+        qpu_out.defined = defined;
+        qpu_out.err = 0;
+        return -1;
+    }
+    return qpu_out.len >= QPU_STREAM_CHUNK ? qpu_stream_send(0) : 0;
+}
+
+/**
+ * qpu_slot - Register slot of a qubit ID, assigned on first use.
+ * @key: Open-addressed table of IDs, @cap entries.
+ * @val: 1 + slot of each entry (0 = empty).
+ *
+ * Returns the slot, or (uint32_t)-1 if the register is full.
+ */
+static uint32_t qpu_slot(nymya_qpu_request* req, uint64_t* key, uint32_t* val,
+                         size_t cap, uint64_t id) {
+    size_t i = (size_t)(id * 0x9E3779B97F4A7C15ull) & (cap - 1);
+    while (val[i] && key[i] != id) i = (i + 1) & (cap - 1);
+    if (!val[i]) {
+        if (req->nqubits >= NYMYA_SUBMIT_MAX_QUBITS) return (uint32_t)-1;
+        key[i] = id;
+        req->ids[req->nqubits++] = id;
+        val[i] = (uint32_t)req->nqubits;
+    }
+    return val[i] - 1;
+}
+
+/**
+ * qpu_lower_native - Appends a circuit's native gates as records.
+ * @s: Gates, on register slots.
+ * @req: Request whose ops grow; @cap holds their allocated count.
+ *
+ * Returns 0, or -1 if the records could not grow or exceed one submission.
+ */
+static int qpu_lower_native(const qpu_native_seq* s, nymya_qpu_request* req, size_t* cap) {
+    if (s->n > NYMYA_SUBMIT_MAX_OPS) {
+        fprintf(stderr, "[QPU] Circuit of %zu native gates exceeds one submission.\n", s->n);
+        return -1;
+    }
+    if (s->n > *cap) {
+        nymya_op* ops = realloc(req->ops, s->n * sizeof(*ops));
+
+        if (!ops) return -1;
+        req->ops = ops;
+        *cap = s->n;
+    }
+    for (size_t i = 0; i < s->n; i++) {
+        const qpu_native_op* n = &s->op[i];
+        nymya_op* op = &req->ops[i];
+
+        memset(op, 0, sizeof(*op));
+        op->gate_code = n->gate_code;
+        op->param = (int64_t)llround(n->theta * (double)FIXED_POINT_SCALE);
+        op->qubit[0] = n->qubit[0];
+        if (n->gate_code == NYMYA_CNOT_CODE || n->gate_code == NYMYA_CZ_CODE) op->qubit[1] = n->qubit[1];
+    }
+    req->nops = s->n;
+    return 0;
+}
+
+int backend_gateqpu_lower(const nymya_circuit* c, nymya_qpu_request* req) {
+    int native = qpu_native_target();
+    qpu_native_builder b = { 0 };
+    qpu_native_seq circ = { 0 };
+    size_t ops_cap = c->count ? c->count : 1;
+
+    req->ops = NULL;
+    req->nops = 0;
+    req->ids = NULL;
+    req->nqubits = 0;
+    if (c->count > NYMYA_SUBMIT_MAX_OPS) {
+        fprintf(stderr, "[QPU] Circuit of %zu gates exceeds one submission.\n", c->count);
+        return -1;
+    }
+
+    size_t cap = 16;
+    while (cap < 2 * c->nids) cap <<= 1;
+    uint64_t* key = malloc(cap * sizeof(*key));
+    uint32_t* val = calloc(cap, sizeof(*val));
+    req->ops = calloc(ops_cap, sizeof(*req->ops));
+    req->ids = malloc((c->nids ? c->nids : 1) * sizeof(*req->ids));
+    if (!key || !val || !req->ops || !req->ids) goto fail;
+    // Each gate's memoised sequence is replayed on register slots, merging single-qubit runs across gates
+    if (native && qpu_native_begin(&b, native, c->nids ? c->nids : 1, &circ)) goto fail;
+
+    for (size_t n = 0; n < c->count; n++) {
+        const nymya_circuit_node* node = &c->nodes[n];
+        nymya_op* op = &req->ops[n];
+        nymya_qubit* q[NYMYA_OP_MAX_OPERANDS] = { NULL };
+        double theta;
+        uint32_t axis;
+        int arity = qpu_operands(node->gate_code, node->args.raw, q, &theta, &axis);
+
+        if (arity < 0) goto fail;
+        if (!arity) {
+            fprintf(stderr, "[QPU] Gate %d cannot be submitted as a job.\n", node->gate_code);
+            goto fail;
+        }
+        op->gate_code = (uint32_t)node->gate_code;
+        op->axis = axis;
+        op->param = (int64_t)llround(theta * (double)FIXED_POINT_SCALE);
+        for (int i = 0; i < arity; i++) {
+            op->qubit[i] = qpu_slot(req, key, val, cap, q[i]->id);
+            if (op->qubit[i] == (uint32_t)-1) {
+                fprintf(stderr, "[QPU] Circuit uses more than %u qubits.\n", NYMYA_SUBMIT_MAX_QUBITS);
+                goto fail;
+            }
+        }
+        if (native) {
+            if (qpu_native_gate(native, node->gate_code, theta, (char)axis, &qpu_nseq)) {
+                fprintf(stderr, "[QPU] Gate %d has no native decomposition.\n", node->gate_code);
+                goto fail;
+            }
+            qpu_native_replay(&b, &qpu_nseq, op->qubit);
+        }
+        req->nops++;
+    }
+
+    if (native && (qpu_native_end(&b) || qpu_lower_native(&circ, req, &ops_cap))) goto fail;
+    qpu_native_seq_free(&circ);
+    free(key);
+    free(val);
+    return 0;
+
+fail:
+    // A builder not yet ended still holds its tables
+    free(b.pend);
+    free(b.has);
+    qpu_native_seq_free(&circ);
+    free(key);
+    free(val);
+    free(req->ops);
+    free(req->ids);
+    req->ops = NULL;
+    req->ids = NULL;
+    req->nops = req->nqubits = 0;
+    return -1;
+}
+
+// Qubits a record of @gate_code acts on, or 0 if the gate cannot be stored as one
+int backend_gateqpu_arity(uint32_t gate_code) {
+    int shape = qpu_shape_of((int)gate_code);
+
+    return shape == QPU_SHAPE_NONE ? 0 : shape == QPU_SHAPE_Q3 ? 3 : shape >= QPU_SHAPE_Q2 ? 2 : 1;
+}
+
+// Operand count of a well-formed record, or -1 after reporting a malformed one
+static int qpu_op_arity(const nymya_op* op, size_t n, size_t nqubits) {
+    int shape = qpu_shape_of((int)op->gate_code);
+    int arity = backend_gateqpu_arity(op->gate_code);
+
+    if (shape == QPU_SHAPE_NONE || op->reserved) {
+        fprintf(stderr, "[QPU] Record %zu: gate %u cannot be stored.\n", n, op->gate_code);
+        return -1;
+    }
+    if (shape == QPU_SHAPE_Q_AXIS_THETA && !qpu_axis((char)op->axis)) {
+        fprintf(stderr, "[QPU] Record %zu: invalid rotation axis.\n", n);
+        return -1;
+    }
+    for (int i = 0; i < arity; i++) {
+        if (op->qubit[i] >= nqubits) {
+            fprintf(stderr, "[QPU] Record %zu: operand %u out of range.\n", n, op->qubit[i]);
+            return -1;
+        }
+    }
+    return arity;
+}
+
+/**
+ * backend_gateqpu_check_ops - Validates serialized gate records.
+ * @ops: Records.
+ * @nops: Number of records.
+ * @nqubits: Register size the operands index.
+ *
+ * Returns 0 if every record is one backend_gateqpu_lower() could have written.
+ */
+int backend_gateqpu_check_ops(const nymya_op* ops, size_t nops, size_t nqubits) {
+    for (size_t n = 0; n < nops; n++) {
+        if (qpu_op_arity(&ops[n], n, nqubits) < 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * backend_gateqpu_run_ops_strided - Executes serialized gate records, the
+ *                                   inverse of backend_gateqpu_lower().
+ * @ops: Records.
+ * @nops: Number of records.
+ * @qubits: Register the operands index.
+ * @stride: Bytes from one entry of @qubits to the next.
+ * @nqubits: Entries of @qubits.
+ *
+ * Each record becomes the argument struct of its gate and goes through
+ * nymya_apply_gate(), so it runs on the active backend or is recorded.
+ * Backends read only the id of a qubit, so any entry type that starts with
+ * the id at the offset nymya_qubit has it works.
+ *
+ * Returns 0 on success, -1 on a malformed record, otherwise the result of
+ * the failing gate.
+ */
+int backend_gateqpu_run_ops_strided(const nymya_op* ops, size_t nops, void* qubits,
+                                    size_t stride, size_t nqubits) {
+    char* base = qubits;
+
+    for (size_t n = 0; n < nops; n++) {
+        const nymya_op* op = &ops[n];
+        double theta = (double)op->param / (double)FIXED_POINT_SCALE;
+        nymya_qubit* q[NYMYA_OP_MAX_OPERANDS];
+        int arity = qpu_op_arity(op, n, nqubits);
+        int ret;
+
+        if (arity < 0) return -1;
+        for (int i = 0; i < arity; i++)
+            q[i] = (nymya_qubit*)(base + op->qubit[i] * stride);
+
+        switch (qpu_shape_of((int)op->gate_code)) {
+            case QPU_SHAPE_Q: {
+                qpu_arg_q a = { q[0] };
+                ret = nymya_apply_gate((int)op->gate_code, &a);
+                break;
+            }
+            case QPU_SHAPE_Q_THETA: {
+                qpu_arg_q_theta a = { q[0], theta };
+                ret = nymya_apply_gate((int)op->gate_code, &a);
+                break;
+            }
+            case QPU_SHAPE_Q_AXIS_THETA: {
+                nymya_arg_q_axis_theta a = { q[0], (char)op->axis, theta };
+                ret = nymya_apply_gate((int)op->gate_code, &a);
+                break;
+            }
+            case QPU_SHAPE_Q2: {
+                qpu_arg_q2 a = { q[0], q[1] };
+                ret = nymya_apply_gate((int)op->gate_code, &a);
+                break;
+            }
+            case QPU_SHAPE_Q2_THETA: {
+                qpu_arg_q2_theta a = { q[0], q[1], theta };
+                ret = nymya_apply_gate((int)op->gate_code, &a);
+                break;
+            }
+            default: {
+                qpu_arg_q3 a = { q[0], q[1], q[2] };
+                ret = nymya_apply_gate((int)op->gate_code, &a);
+                break;
+            }
+        }
+        if (ret) return ret;
+    }
+    return 0;
+}
+
+int backend_gateqpu_run_ops(const nymya_op* ops, size_t nops, nymya_qubit* qubits, size_t nqubits) {
+    return backend_gateqpu_run_ops_strided(ops, nops, qubits, sizeof(*qubits), nqubits);
+}
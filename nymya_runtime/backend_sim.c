@@ -1,154 +1,844 @@
 // backend_sim.c
+//
+// Simulator backend. Gates act on one process-wide state vector (see
+// sim_statevec.c); a qubit joins the register in |0> the first time a gate
+// names its ID. The per-qubit amplitude field is not used in this mode: read
+// results back with backend_sim_prob_one().
+//
+// 1- and 2-qubit gates go through the fusion buffer (sim_fuse.c) and reach
+// the register as fused products; NYMYA_SIM_NOFUSE=1 applies each one directly.
+// The named two-qubit gates are one cached 4x4 matrix each (see sim_u4()).
+//
+// The register stores double amplitudes unless NYMYA_SIM_PRECISION names
+// "float" or "mixed", or backend_sim_set_precision() picks another mode.
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
 #include <math.h>
 #include <complex.h>
 #include <stdint.h>
+#include <time.h>
 #include <nymya/nymya.h>
+#include "backend_sim.h"
+#include "sim_statevec.h"
+#include "sim_pool.h"
+#include "sim_fuse.h"
+#include "sim_compile.h"
+#include "sim_ckpt.h"
+#include "sim_snap.h"
+#include "nymya_circuit.h"
+#include "nymya_gates.h"
+#include "nymya_memory.h"
+#include "nymya_rng.h"
+#include "nymya_noise.h"
 
 // Argument structs
-typedef struct { nymya_qubit* q; } sim_arg_q;
-typedef struct { nymya_qubit* q; double theta; } sim_arg_q_theta;
-typedef struct { nymya_qubit* q1, *q2; } sim_arg_q2;
-typedef struct { nymya_qubit* q1, *q2; double theta; } sim_arg_q2_theta;
-typedef struct { nymya_qubit* q1, *q2, *q3; } sim_arg_q3;
-typedef struct { nymya_qubit** qs; size_t count; } sim_arg_q_arr;
-typedef struct { nymya_qpos3d* qs; size_t count; } sim_arg_q3d;
-typedef struct { nymya_qpos4d* qs; size_t count; } sim_arg_q4d;
-typedef struct { nymya_qpos5d* qs; size_t count; } sim_arg_q5d;
-typedef struct { uint64_t* out; uint64_t min, max; size_t count; } sim_arg_qrng;
+typedef nymya_arg_q sim_arg_q;
+typedef nymya_arg_q_theta sim_arg_q_theta;
+typedef nymya_arg_q_axis_theta sim_arg_q_axis_theta;
+typedef nymya_arg_q2 sim_arg_q2;
+typedef nymya_arg_q2_theta sim_arg_q2_theta;
+typedef nymya_arg_q3 sim_arg_q3;
+typedef nymya_arg_q_arr sim_arg_q_arr;
+typedef nymya_arg_q3d sim_arg_q3d;
+typedef nymya_arg_q4d sim_arg_q4d;
+typedef nymya_arg_q5d sim_arg_q5d;
+typedef nymya_arg_qrng sim_arg_qrng;
 
-int backend_sim_apply_gate(int gate_code, void* args) {
-    switch (gate_code) {
-        // Single-qubit gates
-        case 3301: { // identity
-            return 0;
+// Simulator state; every thread has its own (see nymya_ctx_new())
+static __thread sim_sv sim_reg;
+static __thread int sim_reg_ready;
+static __thread sim_fuse sim_fused;
+static __thread int sim_fuse_on;
+static __thread sim_sv_precision sim_precision;
+static __thread int sim_precision_set;
+
+// While set, gates are appended here as node sim_lower_node instead of applied
+static __thread sim_ops* sim_lower_out;
+static __thread size_t sim_lower_node;
+
+// Fixed gate matrices, row-major, first operand as the high index bit
+static const double complex SIM_X[4]  = { 0, 1, 1, 0 };
+static const double complex SIM_Y[4]  = { 0, -I, I, 0 };
+static const double complex SIM_Z[4]  = { 1, 0, 0, -1 };
+static const double complex SIM_S[4]  = { 1, 0, 0, I };
+static const double complex SIM_SX[4] = { (1 + I) / 2, (1 - I) / 2, (1 - I) / 2, (1 + I) / 2 };
+static const double complex SIM_H[4]  = { M_SQRT1_2, M_SQRT1_2, M_SQRT1_2, -M_SQRT1_2 };
+
+static const double complex SIM_SWAP[16] = {
+    1, 0, 0, 0,
+    0, 0, 1, 0,
+    0, 1, 0, 0,
+    0, 0, 0, 1,
+};
+static const double complex SIM_ISWAP[16] = {
+    1, 0, 0, 0,
+    0, 0, I, 0,
+    0, I, 0, 0,
+    0, 0, 0, 1,
+};
+static const double complex SIM_SQRT_SWAP[16] = {
+    1, 0,           0,           0,
+    0, (1 + I) / 2, (1 - I) / 2, 0,
+    0, (1 - I) / 2, (1 + I) / 2, 0,
+    0, 0,           0,           1,
+};
+static const double complex SIM_SQRT_ISWAP[16] = {
+    1, 0,             0,             0,
+    0, M_SQRT1_2,     I * M_SQRT1_2, 0,
+    0, I * M_SQRT1_2, M_SQRT1_2,     0,
+    0, 0,             0,             1,
+};
+static const double complex SIM_FSWAP[16] = {
+    1, 0, 0, 0,
+    0, 0, 1, 0,
+    0, 1, 0, 0,
+    0, 0, 0, -1,
+};
+
+/**
+ * sim_controlled - Builds the controlled form of @u: identity, with @u in the bottom-right block.
+ * @out: Receives the @n x @n matrix.
+ * @n: Dimension of @out.
+ * @u: Row-major @k x @k block applied when every control bit is set.
+ * @k: Dimension of @u.
+ */
+static void sim_controlled(double complex *out, unsigned int n, const double complex *u, unsigned int k) {
+    for (unsigned int r = 0; r < n; r++) {
+        for (unsigned int c = 0; c < n; c++)
+            out[r * n + c] = (r == c) ? 1 : 0;
+    }
+    for (unsigned int r = 0; r < k; r++) {
+        for (unsigned int c = 0; c < k; c++)
+            out[(n - k + r) * n + (n - k + c)] = u[r * k + c];
+    }
+}
+
+// Diagonal 2x2 phase gate diag(1, e^{i theta})
+static void sim_phase(double complex m[4], double theta) {
+    m[0] = 1; m[1] = 0; m[2] = 0; m[3] = cexp(I * theta);
+}
+
+// exp(-i theta/2 P) for a Pauli string P with P^2 = I, given as its matrix
+static void sim_pauli_rotation(double complex *out, unsigned int n, const double complex *p, double theta) {
+    double c = cos(theta / 2), s = sin(theta / 2);
+
+    for (unsigned int r = 0; r < n; r++) {
+        for (unsigned int col = 0; col < n; col++)
+            out[r * n + col] = ((r == col) ? c : 0) - I * s * p[r * n + col];
+    }
+}
+
+// Storage mode for new registers: the last explicit choice, else NYMYA_SIM_PRECISION
+static sim_sv_precision sim_default_precision(void) {
+    const char* env;
+
+    if (sim_precision_set) return sim_precision;
+    env = getenv("NYMYA_SIM_PRECISION");
+    if (env && strcmp(env, "float") == 0) return SIM_SV_FLOAT;
+    if (env && strcmp(env, "mixed") == 0) return SIM_SV_MIXED;
+    return SIM_SV_DOUBLE;
+}
+
+// Creates the empty register on first use
+static int sim_reg_init(void) {
+    if (sim_reg_ready) return 0;
+    if (sim_sv_init(&sim_reg) != 0) return -1;
+    if (sim_sv_set_precision(&sim_reg, sim_default_precision())) {
+        sim_sv_free(&sim_reg);
+        return -1;
+    }
+    sim_fuse_init(&sim_fused);
+    sim_fuse_on = !getenv("NYMYA_SIM_NOFUSE");
+    sim_reg_ready = 1;
+    return 0;
+}
+
+/**
+ * sim_admit - Checks a register footprint against the memory budget.
+ * @amps: Amplitudes live at the peak, old and new arrays together.
+ * @nqubits: Register width the caller is growing to, for the message.
+ *
+ * Under NYMYA_MEM_DOWNGRADE a double register that would fit in float
+ * storage is converted first.
+ *
+ * Returns 0 if the register may grow, -1 otherwise.
+ */
+static int sim_admit(size_t amps, unsigned int nqubits) {
+    size_t budget = nymya_mem_budget();
+    size_t esz = sim_reg.precision == SIM_SV_DOUBLE ? sizeof(double complex) : sizeof(float complex);
+
+    if (!budget || amps <= budget / esz) return 0;
+    if (nymya_mem_get_policy() == NYMYA_MEM_DOWNGRADE && sim_reg.precision == SIM_SV_DOUBLE &&
+        amps <= budget / sizeof(float complex) && sim_sv_set_precision(&sim_reg, SIM_SV_FLOAT) == 0) {
+        fprintf(stderr, "[sim backend] Register switched to float storage at %u qubits to stay "
+                "within the %.0f MiB memory budget.\n", nqubits, nymya_mem_mib(budget));
+        return 0;
+    }
+    fprintf(stderr, "[sim backend] A register of %u qubits needs %.0f MiB, over the %.0f MiB "
+            "memory budget.\n", nqubits, nymya_mem_mib(amps > SIZE_MAX / esz ? SIZE_MAX : amps * esz),
+            nymya_mem_mib(budget));
+    return -1;
+}
+
+/**
+ * sim_slot - Maps a qubit to its slot in the register, adding it if needed.
+ * @q: Qubit; its ID is the key.
+ *
+ * A new qubit doubles the register, which can take it over the memory budget.
+ *
+ * Returns the slot, or -1 if @q is NULL, the register is full or over budget.
+ */
+static int sim_slot(const nymya_qubit* q) {
+    if (!q || sim_reg_init()) return -1;
+    if (sim_sv_find(&sim_reg, q->id) < 0 && sim_reg.nqubits < SIM_SV_MAX_QUBITS &&
+        sim_admit(3 * sim_reg.dim, sim_reg.nqubits + 1))
+        return -1;
+    return sim_sv_qubit(&sim_reg, q->id);
+}
+
+static int sim_gate1(nymya_qubit* q, const double complex m[4]) {
+    int t;
+
+    if (sim_lower_out)
+        return q ? sim_ops_push(sim_lower_out, 1, &q->id, m, sim_lower_node) : -1;
+
+    t = sim_slot(q);
+
+    if (t < 0) return -1;
+    return sim_fuse_on ? sim_fuse_apply1(&sim_fused, &sim_reg, t, m)
+                       : sim_sv_apply1(&sim_reg, t, m);
+}
+
+static int sim_gate2(nymya_qubit* q1, nymya_qubit* q2, const double complex m[16]) {
+    int t1, t2;
+
+    if (sim_lower_out) {
+        if (!q1 || !q2 || q1->id == q2->id) return -1;
+        return sim_ops_push(sim_lower_out, 2, (uint64_t[]){ q1->id, q2->id }, m, sim_lower_node);
+    }
+
+    t1 = sim_slot(q1);
+    t2 = sim_slot(q2);
+
+    if (t1 < 0 || t2 < 0) return -1;
+    return sim_fuse_on ? sim_fuse_apply2(&sim_fused, &sim_reg, t1, t2, m)
+                       : sim_sv_apply2(&sim_reg, t1, t2, m);
+}
+
+static int sim_gate3(nymya_qubit* q1, nymya_qubit* q2, nymya_qubit* q3, const double complex m[64]) {
+    int t1, t2, t3;
+
+    if (sim_lower_out) {
+        if (!q1 || !q2 || !q3 || q1->id == q2->id || q1->id == q3->id || q2->id == q3->id)
+            return -1;
+        return sim_ops_push(sim_lower_out, 3, (uint64_t[]){ q1->id, q2->id, q3->id }, m,
+                            sim_lower_node);
+    }
+
+    t1 = sim_slot(q1);
+    t2 = sim_slot(q2);
+    t3 = sim_slot(q3);
+
+    if (t1 < 0 || t2 < 0 || t3 < 0) return -1;
+    // Pending gates on these slots must land before the 8x8
+    if (sim_fuse_flush_slots(&sim_fused, &sim_reg, (1u << t1) | (1u << t2) | (1u << t3)))
+        return -1;
+    return sim_sv_apply3(&sim_reg, t1, t2, t3, m);
+}
+
+// Controlled-U with one control (q1) and a 2x2 U on q2
+static int sim_gate_c1(nymya_qubit* qc, nymya_qubit* qt, const double complex u[4]) {
+    double complex m[16];
+
+    sim_controlled(m, 4, u, 2);
+    return sim_gate2(qc, qt, m);
+}
+
+static int sim_cnot(nymya_qubit* qc, nymya_qubit* qt) {
+    return sim_gate_c1(qc, qt, SIM_X);
+}
+
+static int sim_cz(nymya_qubit* qc, nymya_qubit* qt) {
+    return sim_gate_c1(qc, qt, SIM_Z);
+}
+
+// Doubly controlled 2x2 U: controls q1, q2, target q3
+static int sim_gate_c2(nymya_qubit* q1, nymya_qubit* q2, nymya_qubit* q3, const double complex u[4]) {
+    double complex m[64];
+
+    sim_controlled(m, 8, u, 2);
+    return sim_gate3(q1, q2, q3, m);
+}
+
+// Singly controlled 4x4 U: control q1, targets q2, q3
+static int sim_gate_c1_2(nymya_qubit* q1, nymya_qubit* q2, nymya_qubit* q3, const double complex u[16]) {
+    double complex m[64];
+
+    sim_controlled(m, 8, u, 4);
+    return sim_gate3(q1, q2, q3, m);
+}
+
+static int sim_rotate(nymya_qubit* q, char axis, double theta) {
+    double complex m[4];
+
+    switch (axis) {
+        case 'x': case 'X': sim_pauli_rotation(m, 2, SIM_X, theta); break;
+        case 'y': case 'Y': sim_pauli_rotation(m, 2, SIM_Y, theta); break;
+        case 'z': case 'Z': sim_pauli_rotation(m, 2, SIM_Z, theta); break;
+        default: return -1;
+    }
+    return sim_gate1(q, m);
+}
+
+// Tensor product a (x) b of two 2x2 matrices; a acts on the high index bit
+static void sim_kron2(double complex out[16], const double complex a[4], const double complex b[4]) {
+    for (unsigned int r = 0; r < 4; r++) {
+        for (unsigned int c = 0; c < 4; c++)
+            out[r * 4 + c] = a[(r >> 1) * 2 + (c >> 1)] * b[(r & 1) * 2 + (c & 1)];
+    }
+}
+
+// exp(-i theta/2 P(x)P) for a Pauli P
+static void sim_two_pauli(double complex m[16], const double complex p[4], double theta) {
+    double complex pp[16];
+
+    sim_kron2(pp, p, p);
+    sim_pauli_rotation(m, 4, pp, theta);
+}
+
+// exp(-i theta/2 (XX + YY + ZZ)): e^{-i theta/2} on the triplet, e^{3i theta/2} on the singlet
+static void sim_xyz(double complex m[16], double theta) {
+    double complex t = cexp(-I * theta / 2), s = cexp(3 * I * theta / 2);
+
+    memset(m, 0, 16 * sizeof(*m));
+    m[0] = m[15] = t;
+    m[5] = m[10] = (t + s) / 2;
+    m[6] = m[9] = (t - s) / 2;
+}
+
+// SWAP^alpha: identity at alpha = 0, SWAP at alpha = 1
+static void sim_swap_pow(double complex m[16], double alpha) {
+    double complex e = cexp(I * M_PI * alpha);
+
+    memset(m, 0, 16 * sizeof(*m));
+    m[0] = m[15] = 1;
+    m[5] = m[10] = (1 + e) / 2;
+    m[6] = m[9] = (1 - e) / 2;
+}
+
+// Givens rotation in the {|01>, |10>} subspace, as in nymya_3338_givens()
+static void sim_givens(double complex m[16], double theta) {
+    memset(m, 0, 16 * sizeof(*m));
+    m[0] = m[15] = 1;
+    m[5] = m[10] = cos(theta);
+    m[6] = -sin(theta);
+    m[9] = sin(theta);
+}
+
+// m = g m: appends gate g to the sequence m already holds
+static void sim_then(double complex m[16], const double complex g[16]) {
+    double complex out[16];
+
+    for (unsigned int r = 0; r < 4; r++) {
+        for (unsigned int c = 0; c < 4; c++) {
+            double complex acc = 0;
+
+            for (unsigned int k = 0; k < 4; k++)
+                acc += g[r * 4 + k] * m[k * 4 + c];
+            out[r * 4 + c] = acc;
         }
-        case 3302: { // global_phase
-            sim_arg_q_theta* a = args;
-            a->q->amplitude *= cexp(I * a->theta);
+    }
+    memcpy(m, out, sizeof(out));
+}
+
+/**
+ * sim_u4_build - Builds the 4x4 matrix of a two-qubit gate.
+ * @m: Receives the row-major matrix, first operand as the high index bit.
+ * @code: Gate code.
+ * @theta: Angle of a parametric gate; ignored by the others.
+ *
+ * The gates that the core library runs as a short sequence (berkeley,
+ * magic, sycamore, cz_swap) are multiplied out here, so the register is
+ * swept once instead of once per step.
+ *
+ * Returns 0, or -1 if @code is not one of the gates below.
+ */
+static int sim_u4_build(double complex m[16], int code, double theta) {
+    static const double complex id[4] = { 1, 0, 0, 1 };
+    double complex g[16], p[4];
+
+    switch (code) {
+        case 3314: memcpy(m, SIM_ISWAP, sizeof(SIM_ISWAP)); return 0;
+        case 3322: sim_two_pauli(m, SIM_X, theta); return 0;
+        case 3323: sim_two_pauli(m, SIM_Y, theta); return 0;
+        case 3324: sim_two_pauli(m, SIM_Z, theta); return 0;
+        case 3325: sim_xyz(m, theta); return 0;
+        case 3326: memcpy(m, SIM_SQRT_SWAP, sizeof(SIM_SQRT_SWAP)); return 0;
+        case 3327: memcpy(m, SIM_SQRT_ISWAP, sizeof(SIM_SQRT_ISWAP)); return 0;
+        case 3328: sim_swap_pow(m, theta); return 0;
+        case 3332: // berkeley: CNOT, P(θ) on q2, CNOT
+            sim_controlled(m, 4, SIM_X, 2);
+            sim_phase(p, theta);
+            sim_kron2(g, id, p);
+            sim_then(m, g);
+            sim_controlled(g, 4, SIM_X, 2);
+            sim_then(m, g);
             return 0;
-        }
-        case 3303: { // pauli_x
-            sim_arg_q* a = args;
-            a->q->amplitude = 1.0 - a->q->amplitude;
+        case 3336: // echo_cr: ZX(θ) cross-resonance interaction
+            sim_kron2(g, SIM_Z, SIM_X);
+            sim_pauli_rotation(m, 4, g, theta);
             return 0;
-        }
-        case 3304: { // pauli_y
-            sim_arg_q* a = args;
-            a->q->amplitude = I * (1.0 - a->q->amplitude);
+        case 3337: memcpy(m, SIM_FSWAP, sizeof(SIM_FSWAP)); return 0;
+        case 3338: sim_givens(m, theta); return 0;
+        case 3339: // magic: H, S on q1, CNOT, H on q1
+            sim_kron2(m, SIM_H, id);
+            sim_kron2(g, SIM_S, id);
+            sim_then(m, g);
+            sim_controlled(g, 4, SIM_X, 2);
+            sim_then(m, g);
+            sim_kron2(g, SIM_H, id);
+            sim_then(m, g);
             return 0;
-        }
-        case 3305: { // pauli_z
-            sim_arg_q* a = args;
-            a->q->amplitude = -a->q->amplitude;
+        case 3340: // sycamore: sqrt(iSWAP), then CPHASE(π/6)
+            memcpy(m, SIM_SQRT_ISWAP, sizeof(SIM_SQRT_ISWAP));
+            sim_phase(p, M_PI / 6.0);
+            sim_controlled(g, 4, p, 2);
+            sim_then(m, g);
             return 0;
-        }
-        case 3306: { // phase_s = π/2
-            sim_arg_q* a = args;
-            a->q->amplitude *= cexp(I * M_PI_2);
+        case 3341: // cz_swap
+            sim_controlled(m, 4, SIM_Z, 2);
+            sim_then(m, SIM_SWAP);
             return 0;
+    }
+    return -1;
+}
+
+/**
+ * sim_u4_entry - One cached two-qubit gate matrix.
+ * @code: Gate code; 0 marks an empty entry.
+ * @theta: Bit pattern of the angle, 0 for the fixed gates.
+ * @m: The matrix.
+ */
+typedef struct sim_u4_entry {
+    int code;
+    uint64_t theta;
+    double complex m[16];
+} sim_u4_entry;
+
+// Direct-mapped, per thread like the register: 1 << SIM_U4_BITS entries, 8.5 KiB
+#define SIM_U4_BITS 5
+
+static __thread sim_u4_entry sim_u4_cache[1u << SIM_U4_BITS];
+
+/**
+ * sim_u4 - Returns the matrix of a two-qubit gate, building it on first use.
+ * @code: Gate code, as for sim_u4_build().
+ * @theta: Angle, or 0 for a fixed gate.
+ *
+ * A variational loop that repeats a handful of angles, or a circuit that
+ * applies the same fixed gate many times, then pays for cexp() and the
+ * products once per (gate, angle) rather than once per call.
+ *
+ * Returns the cached matrix, or NULL for an unknown @code.
+ */
+static const double complex* sim_u4(int code, double theta) {
+    uint64_t bits, h;
+    sim_u4_entry* e;
+
+    memcpy(&bits, &theta, sizeof(bits));
+    h = (bits ^ (bits >> 29) ^ (uint64_t)code) * 0x9E3779B97F4A7C15ULL;
+    e = &sim_u4_cache[h >> (64 - SIM_U4_BITS)];
+    if (e->code == code && e->theta == bits) return e->m;
+    if (sim_u4_build(e->m, code, theta)) {
+        e->code = 0;
+        return NULL;
+    }
+    e->code = code;
+    e->theta = bits;
+    return e->m;
+}
+
+static int sim_gate_u4(nymya_qubit* q1, nymya_qubit* q2, int code, double theta) {
+    const double complex* m = sim_u4(code, theta);
+
+    return m ? sim_gate2(q1, q2, m) : -1;
+}
+
+/**
+ * backend_sim_gate_matrix - Unitary of a one- or two-qubit gate.
+ * @gate_code: Gate.
+ * @theta: Angle of a parametric gate; ignored by the others.
+ * @axis: Axis of the generic rotation (3330); ignored by the others.
+ * @m: Receives the row-major matrix, 2x2 or 4x4 with the first operand as
+ *     the high index bit.
+ *
+ * The matrices are the ones this backend applies, so other backends can
+ * decompose a gate exactly as the simulator runs it.
+ *
+ * Returns the number of qubits the gate acts on, or -1 for any other gate.
+ */
+int backend_sim_gate_matrix(int gate_code, double theta, char axis, double complex* m) {
+    static const double complex id[4] = { 1, 0, 0, 1 };
+    double complex p[4], g[16];
+
+    switch (gate_code) {
+        case 3301: memcpy(m, id, sizeof(id)); return 1;
+        case 3302: m[0] = m[3] = cexp(I * theta); m[1] = m[2] = 0; return 1;
+        case 3303: memcpy(m, SIM_X, sizeof(SIM_X)); return 1;
+        case 3304: memcpy(m, SIM_Y, sizeof(SIM_Y)); return 1;
+        case 3305: memcpy(m, SIM_Z, sizeof(SIM_Z)); return 1;
+        case 3306: memcpy(m, SIM_S, sizeof(SIM_S)); return 1;
+        case 3307: memcpy(m, SIM_SX, sizeof(SIM_SX)); return 1;
+        case 3308: memcpy(m, SIM_H, sizeof(SIM_H)); return 1;
+        case 3315:
+        case 3316: sim_phase(m, theta); return 1;
+        case 3319: sim_pauli_rotation(m, 2, SIM_X, theta); return 1;
+        case 3320: sim_pauli_rotation(m, 2, SIM_Y, theta); return 1;
+        case 3321: sim_pauli_rotation(m, 2, SIM_Z, theta); return 1;
+        case 3330:
+            switch (axis) {
+                case 'x': case 'X': sim_pauli_rotation(m, 2, SIM_X, theta); return 1;
+                case 'y': case 'Y': sim_pauli_rotation(m, 2, SIM_Y, theta); return 1;
+                case 'z': case 'Z': sim_pauli_rotation(m, 2, SIM_Z, theta); return 1;
+            }
+            return -1;
+
+        case 3309: sim_controlled(m, 4, SIM_X, 2); return 2;
+        case 3310: // acnot: X on the target in the control's |0> block
+            sim_controlled(m, 4, id, 2);
+            m[0] = m[5] = 0;
+            m[1] = m[4] = 1;
+            return 2;
+        case 3311: sim_controlled(m, 4, SIM_Z, 2); return 2;
+        case 3313: memcpy(m, SIM_SWAP, sizeof(SIM_SWAP)); return 2;
+        case 3317: sim_phase(p, theta); sim_controlled(m, 4, p, 2); return 2;
+        case 3318: sim_controlled(m, 4, SIM_S, 2); return 2;
+        case 3333: sim_controlled(m, 4, SIM_SX, 2); return 2;
+        case 3334: // core_entangle: H on q1, then CNOT
+            sim_kron2(m, SIM_H, id);
+            sim_controlled(g, 4, SIM_X, 2);
+            sim_then(m, g);
+            return 2;
+    }
+    return sim_u4_build(m, gate_code, theta) ? -1 : 2;
+}
+
+// Runs a sequence of gate calls and stops at the first failure
+#define SIM_SEQ(...) do { \
+        int sim_seq_rets[] = { __VA_ARGS__ }; \
+        for (size_t n_ = 0; n_ < sizeof(sim_seq_rets) / sizeof(sim_seq_rets[0]); n_++) \
+            if (sim_seq_rets[n_]) return -1; \
+    } while (0)
+
+// Hadamard on every qubit of a ring, then CNOT(q[i], q[i+1 mod n])
+static int sim_ring(nymya_qubit** q, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (sim_gate1(q[i], SIM_H)) return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (sim_cnot(q[i], q[(i + 1) % n])) return -1;
+    }
+    return 0;
+}
+
+static int sim_triangle(nymya_qubit* a, nymya_qubit* b, nymya_qubit* c) {
+    if (sim_gate1(a, SIM_H) || sim_cnot(a, b) || sim_cnot(b, c) || sim_cnot(c, a)) return -1;
+    return 0;
+}
+
+// Same sequence as nymya_3348_hex_rhombi_lattice(); q[0] is the centre
+static int sim_hex_rhombi(nymya_qubit** q) {
+    for (int i = 1; i < 7; i++) {
+        if (sim_gate1(q[i], SIM_H) || sim_cnot(q[0], q[i])) return -1;
+    }
+    for (int i = 1; i < 6; i++) {
+        if (sim_cnot(q[i], q[i + 1]) || sim_cnot(q[i + 1], q[0])) return -1;
+    }
+    if (sim_cnot(q[6], q[1]) || sim_cnot(q[1], q[0])) return -1;
+    return 0;
+}
+
+static int sim_e8_group(nymya_qubit** q) {
+    for (int i = 0; i < 8; i++) {
+        if (sim_gate1(q[i], SIM_H)) return -1;
+    }
+    for (int i = 0; i < 8; i++) {
+        for (int j = i + 1; j < 8; j++) {
+            if (sim_cnot(q[i], q[j]) || sim_cnot(q[j], q[i])) return -1;
         }
-        case 3307: { // sqrt_x
-            sim_arg_q* a = args;
-            a->q->amplitude = (a->q->amplitude + I * (1.0 - a->q->amplitude)) / M_SQRT2;
-            return 0;
+    }
+    return 0;
+}
+
+// Same sequence as nymya_3353_flower_of_life(): centre, ring of 6, ring of 12
+static int sim_flower_of_life(nymya_qubit** q) {
+    for (size_t i = 0; i < 19; i++) {
+        if (sim_gate1(q[i], SIM_H)) return -1;
+    }
+    for (size_t i = 1; i < 19; i++) {
+        if (sim_cnot(q[0], q[i])) return -1;
+    }
+    for (size_t j = 1; j <= 6; j++) {
+        if (sim_cnot(q[j], q[(j % 6) + 1])) return -1;
+    }
+    for (size_t j = 7; j < 18; j++) {
+        if (sim_cnot(q[j], q[j + 1])) return -1;
+    }
+    return sim_cnot(q[18], q[7]);
+}
+
+static int sim_metatron_cube(nymya_qubit** q) {
+    for (size_t i = 0; i < 13; i++) {
+        if (sim_gate1(q[i], SIM_H)) return -1;
+    }
+    for (size_t i = 1; i < 13; i++) {
+        if (sim_cnot(q[0], q[i])) return -1;
+    }
+    for (size_t i = 1; i <= 6; i++) {
+        if (sim_cnot(q[i], q[i + 6])) return -1;
+    }
+    return 0;
+}
+
+/**
+ * sim_positional - Hadamard on every site, then CNOT on every pair within @cutoff.
+ * @sites: Array of nymya_qpos{3,4,5}d; the coordinates are the leading doubles.
+ * @stride: Size of one element.
+ * @q_off: Offset of the nymya_qubit member.
+ * @count: Number of sites.
+ * @dims: Number of coordinates.
+ * @cutoff: Neighbour distance, matching the kernel core of the gate.
+ *
+ * The register holds at most SIM_SV_MAX_QUBITS qubits, so the pair scan is
+ * small; pairs are visited in the kernel order (i ascending, then j > i).
+ */
+static int sim_positional(void* sites, size_t stride, size_t q_off, size_t count,
+                          unsigned int dims, double cutoff) {
+    char* base = sites;
+
+    if (!sites || count == 0) return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        if (sim_gate1((nymya_qubit*)(base + i * stride + q_off), SIM_H)) return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const double* ci = (const double*)(base + i * stride);
+
+        for (size_t j = i + 1; j < count; j++) {
+            const double* cj = (const double*)(base + j * stride);
+            double d2 = 0;
+
+            for (unsigned int k = 0; k < dims; k++)
+                d2 += (ci[k] - cj[k]) * (ci[k] - cj[k]);
+            if (d2 <= cutoff * cutoff &&
+                sim_cnot((nymya_qubit*)(base + i * stride + q_off),
+                         (nymya_qubit*)(base + j * stride + q_off)))
+                return -1;
         }
-        case 3308: { // hadamard
+    }
+    return 0;
+}
+
+// Checks an array argument that needs at least @n non-NULL qubits
+static int sim_arr_ok(const sim_arg_q_arr* a, size_t n) {
+    if (!a || !a->qs || a->count < n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!a->qs[i]) return 0;
+    }
+    return 1;
+}
+
+int backend_sim_apply_gate(int gate_code, void* args) {
+    double complex m[16];
+
+    if (!args) return -1;
+
+    switch (gate_code) {
+        // Single-qubit gates
+        case 3301: { // identity
             sim_arg_q* a = args;
-            a->q->amplitude = (a->q->amplitude + (1.0 - a->q->amplitude)) / M_SQRT2;
-            return 0;
+            return sim_slot(a->q) < 0 ? -1 : 0;
         }
-        case 3315: { // phase_shift
+        case 3302: { // global_phase
             sim_arg_q_theta* a = args;
-            a->q->amplitude *= cexp(I * a->theta);
-            return 0;
+            double complex p = cexp(I * a->theta);
+            m[0] = p; m[1] = 0; m[2] = 0; m[3] = p;
+            return sim_gate1(a->q, m);
         }
+        case 3303: { sim_arg_q* a = args; return sim_gate1(a->q, SIM_X); }  // pauli_x
+        case 3304: { sim_arg_q* a = args; return sim_gate1(a->q, SIM_Y); }  // pauli_y
+        case 3305: { sim_arg_q* a = args; return sim_gate1(a->q, SIM_Z); }  // pauli_z
+        case 3306: { sim_arg_q* a = args; return sim_gate1(a->q, SIM_S); }  // phase_s = π/2
+        case 3307: { sim_arg_q* a = args; return sim_gate1(a->q, SIM_SX); } // sqrt_x
+        case 3308: { sim_arg_q* a = args; return sim_gate1(a->q, SIM_H); }  // hadamard
+        case 3315:   // phase_shift
         case 3316: { // phase_gate (φ)
             sim_arg_q_theta* a = args;
-            a->q->amplitude *= cexp(I * a->theta);
-            return 0;
-        }
-        case 3319: { // rotate_x
-            sim_arg_q_theta* a = args;
-            a->q->amplitude *= cos(a->theta/2) + I * sin(a->theta/2);
-            return 0;
+            sim_phase(m, a->theta);
+            return sim_gate1(a->q, m);
         }
-        case 3320: { // rotate_y
-            sim_arg_q_theta* a = args;
-            a->q->amplitude *= cos(a->theta/2) + sin(a->theta/2);
-            return 0;
-        }
-        case 3321: { // rotate_z
-            sim_arg_q_theta* a = args;
-            a->q->amplitude *= cexp(I * a->theta);
-            return 0;
+        case 3319: { sim_arg_q_theta* a = args; return sim_rotate(a->q, 'X', a->theta); } // rotate_x
+        case 3320: { sim_arg_q_theta* a = args; return sim_rotate(a->q, 'Y', a->theta); } // rotate_y
+        case 3321: { sim_arg_q_theta* a = args; return sim_rotate(a->q, 'Z', a->theta); } // rotate_z
+        case 3330: { // generic rotate
+            sim_arg_q_axis_theta* a = args;
+            return sim_rotate(a->q, a->axis, a->theta);
         }
 
         // Two-qubit gates
-        case 3309: // cnot
-        case 3310: // acnot
-        case 3311: // controlled_z
-        case 3312: // double_controlled_not
-        case 3313: // swap
-        case 3314: // imaginary_swap
-        case 3322: // xx_interaction
-        case 3323: // yy_interaction
-        case 3324: // zz_interaction
-        case 3325: // xyz_entangle
-        case 3326: // sqrt_swap
-        case 3327: // sqrt_iswap
-        case 3328: // swap_pow
-        case 3329: // fredkin
-        case 3333: // c_v
-        case 3334: // core_entangle
-        case 3336: // echo_cr
-        case 3337: // fermion_sim
-        case 3338: // givens
-        case 3339: // magic
-        case 3340: // sycamore
-        case 3341: // cz_swap
-            printf("[sim backend] Two-qubit (or interaction) gate %d stub\n", gate_code);
+        case 3309: { sim_arg_q2* a = args; return sim_cnot(a->q1, a->q2); } // cnot
+        case 3310: { // acnot: flip the target when the control is |0>
+            sim_arg_q2* a = args;
+            const double complex u[16] = { 0, 1, 0, 0,  1, 0, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+            return sim_gate2(a->q1, a->q2, u);
+        }
+        case 3311: { sim_arg_q2* a = args; return sim_cz(a->q1, a->q2); } // controlled_z
+        case 3313: { sim_arg_q2* a = args; return sim_gate2(a->q1, a->q2, SIM_SWAP); }  // swap
+        case 3314: { sim_arg_q2* a = args; return sim_gate_u4(a->q1, a->q2, gate_code, 0); } // imaginary_swap
+        case 3317: { // controlled_phase
+            sim_arg_q2_theta* a = args;
+            double complex p[4];
+            sim_phase(p, a->theta);
+            return sim_gate_c1(a->q1, a->q2, p);
+        }
+        case 3318: { sim_arg_q2* a = args; return sim_gate_c1(a->q1, a->q2, SIM_S); } // controlled_phase_s
+        case 3322:   // xx
+        case 3323:   // yy
+        case 3324:   // zz
+        case 3325:   // xyz_entangle
+        case 3328:   // swap_pow
+        case 3332: { // berkeley
+            sim_arg_q2_theta* a = args;
+            return sim_gate_u4(a->q1, a->q2, gate_code, a->theta);
+        }
+        case 3326:   // sqrt_swap
+        case 3327: { // sqrt_iswap
+            sim_arg_q2* a = args;
+            return sim_gate_u4(a->q1, a->q2, gate_code, 0);
+        }
+        case 3333: { sim_arg_q2* a = args; return sim_gate_c1(a->q1, a->q2, SIM_SX); } // c_v
+        case 3334: { // core_entangle: H on q1, then CNOT
+            sim_arg_q2* a = args;
+            SIM_SEQ(sim_gate1(a->q1, SIM_H), sim_cnot(a->q1, a->q2));
             return 0;
+        }
+        case 3336:   // echo_cr
+        case 3338: { // givens
+            sim_arg_q2_theta* a = args;
+            return sim_gate_u4(a->q1, a->q2, gate_code, a->theta);
+        }
+        case 3337:   // fermion_sim
+        case 3339:   // magic
+        case 3340:   // sycamore
+        case 3341: { // cz_swap
+            sim_arg_q2* a = args;
+            return sim_gate_u4(a->q1, a->q2, gate_code, 0);
+        }
 
         // Three-qubit gates
-        case 3330: // generic rotate (reinterpret as single)
-        case 3331: // barenco
-        case 3332: // berkeley
-        case 3335: // dagwood
-        case 3342: // deutsch
-        case 3343: // margolis
-        case 3344: // peres
-        case 3345: // cf_swap
-            printf("[sim backend] Three-qubit gate %d stub\n", gate_code);
+        case 3312:   // double_controlled_not
+        case 3331: { // barenco
+            sim_arg_q3* a = args;
+            return sim_gate_c2(a->q1, a->q2, a->q3, SIM_X);
+        }
+        case 3329:   // fredkin
+        case 3335: { // dagwood: swap q2, q3 when q1 is |1>
+            sim_arg_q3* a = args;
+            return sim_gate_c1_2(a->q1, a->q2, a->q3, SIM_SWAP);
+        }
+        case 3343: { // margolis: phase flip on q3 when q1 and q2 are |1>
+            sim_arg_q3* a = args;
+            return sim_gate_c2(a->q1, a->q2, a->q3, SIM_Z);
+        }
+        case 3344: { // peres: CNOT(q1, q3), then Margolis
+            sim_arg_q3* a = args;
+            SIM_SEQ(sim_cnot(a->q1, a->q3), sim_gate_c2(a->q1, a->q2, a->q3, SIM_Z));
             return 0;
+        }
+        case 3345: { // cf_swap: fermionic swap of q2, q3 when q1 is |1>
+            sim_arg_q3* a = args;
+            return sim_gate_c1_2(a->q1, a->q2, a->q3, SIM_FSWAP);
+        }
+        case 3342: // deutsch: the oracle callback works on scalar qubits, not a register
+            fprintf(stderr, "[sim backend] Gate %d is not supported on the state vector\n", gate_code);
+            return -1;
 
         // Lattice & tessellation gates (arrays)
-        case 3346: // triangular_lattice
-        case 3347: // hexagonal_lattice
-        case 3348: // hex_rhombi_lattice
-        case 3349: // tessellated_triangles
-        case 3350: // tessellated_hexagons
-        case 3351: // tessellated_hex_rhombi
-        case 3352: // e8_group
-        case 3353: // flower_of_life
-        case 3354: // metatron_cube
-        case 3355: // fcc_lattice
-        case 3356: // hcp_lattice
-        case 3357: // e8_projected_lattice
-        case 3358: // d4_lattice
-        case 3359: // b5_lattice
-        case 3360: // e5_projected_lattice
-            printf("[sim backend] Lattice gate %d stub\n", gate_code);
+        case 3346: { // triangular_lattice
+            sim_arg_q3* a = args;
+            return sim_triangle(a->q1, a->q2, a->q3);
+        }
+        case 3347: { // hexagonal_lattice
+            sim_arg_q_arr* a = args;
+            return sim_arr_ok(a, 6) ? sim_ring(a->qs, 6) : -1;
+        }
+        case 3348: { // hex_rhombi_lattice
+            sim_arg_q_arr* a = args;
+            return sim_arr_ok(a, 7) ? sim_hex_rhombi(a->qs) : -1;
+        }
+        case 3349: { // tessellated_triangles
+            sim_arg_q_arr* a = args;
+            if (!sim_arr_ok(a, 3)) return -1;
+            for (size_t g = 0; g < a->count / 3; g++) {
+                if (sim_triangle(a->qs[3 * g], a->qs[3 * g + 1], a->qs[3 * g + 2])) return -1;
+            }
+            return 0;
+        }
+        case 3350: { // tessellated_hexagons
+            sim_arg_q_arr* a = args;
+            if (!sim_arr_ok(a, 6)) return -1;
+            for (size_t g = 0; g < a->count / 6; g++) {
+                if (sim_ring(a->qs + 6 * g, 6)) return -1;
+            }
             return 0;
+        }
+        case 3351: { // tessellated_hex_rhombi
+            sim_arg_q_arr* a = args;
+            if (!sim_arr_ok(a, 7)) return -1;
+            for (size_t g = 0; g < a->count / 7; g++) {
+                if (sim_hex_rhombi(a->qs + 7 * g)) return -1;
+            }
+            return 0;
+        }
+        case 3352: { // e8_group
+            sim_arg_q_arr* a = args;
+            return sim_arr_ok(a, 8) ? sim_e8_group(a->qs) : -1;
+        }
+        case 3353: { // flower_of_life
+            sim_arg_q_arr* a = args;
+            return sim_arr_ok(a, 19) ? sim_flower_of_life(a->qs) : -1;
+        }
+        case 3354: { // metatron_cube
+            sim_arg_q_arr* a = args;
+            return sim_arr_ok(a, 13) ? sim_metatron_cube(a->qs) : -1;
+        }
+        case 3355:   // fcc_lattice
+        case 3356:   // hcp_lattice
+        case 3357: { // e8_projected_lattice
+            sim_arg_q3d* a = args;
+            return sim_positional(a->qs, sizeof(nymya_qpos3d), offsetof(nymya_qpos3d, q),
+                                  a->count, 3, gate_code == 3357 ? 1.00 : 1.01);
+        }
+        case 3358: { // d4_lattice
+            sim_arg_q4d* a = args;
+            return sim_positional(a->qs, sizeof(nymya_qpos4d), offsetof(nymya_qpos4d, q),
+                                  a->count, 4, 1.01);
+        }
+        case 3359:   // b5_lattice
+        case 3360: { // e5_projected_lattice
+            sim_arg_q5d* a = args;
+            return sim_positional(a->qs, sizeof(nymya_qpos5d), offsetof(nymya_qpos5d, q),
+                                  a->count, 5, gate_code == 3359 ? 1.00 : 1.05);
+        }
 
         // Quantum RNG
         case 3361: { // qrng_range
             sim_arg_qrng* a = args;
-            for (size_t i = 0; i < a->count; i++) {
-                // simple pseudo-random fallback
-                a->out[i] = a->min + (rand() % (a->max - a->min + 1));
-            }
+            if ((!a->out && a->count) || a->min > a->max) return -1;
+            nymya_rng_range(a->out, a->count, a->min, a->max);
             return 0;
         }
 
@@ -157,3 +847,772 @@ int backend_sim_apply_gate(int gate_code, void* args) {
             return -1;
     }
 }
+
+// Gates that do not lower to a matrix: they run as is, between fused blocks
+static int sim_is_pass_through(int gate_code) {
+    return gate_code == 3301 || gate_code == 3342 || gate_code == 3361;
+}
+
+/**
+ * backend_sim_lower_gate - Lowers one gate call to dense gates on qubit IDs.
+ * @gate_code: Gate; pass-through gates (identity, deutsch, qrng_range) do
+ *             not lower and must be handled by the caller.
+ * @args: Gate arguments.
+ * @ops: Receives the gates.
+ * @node: Tag stored with each gate.
+ *
+ * The register is not touched, so other backends use this to share the
+ * simulator's gate definitions. Returns 0 on success, -1 on invalid
+ * arguments or allocation failure.
+ */
+int backend_sim_lower_gate(int gate_code, void* args, sim_ops* ops, size_t node) {
+    int ret;
+
+    if (sim_is_pass_through(gate_code)) return -1;
+    sim_lower_out = ops;
+    sim_lower_node = node;
+    ret = backend_sim_apply_gate(gate_code, args);
+    sim_lower_out = NULL;
+    return ret;
+}
+
+/**
+ * sim_lower - Lowers every node of a circuit to dense gates on qubit IDs.
+ * @c: Circuit.
+ * @params: Parameter values to bind, or NULL for the circuit's own.
+ * @ops: Receives the gates.
+ *
+ * Returns 0 on success, -1 if a node has invalid arguments or memory runs out.
+ */
+static int sim_lower(const nymya_circuit* c, const double* params, sim_ops* ops) {
+    int ret = 0;
+
+    for (size_t i = 0; i < c->count && !ret; i++) {
+        nymya_circuit_node n = c->nodes[i];
+
+        if (sim_is_pass_through(n.gate_code)) {
+            ret = sim_ops_push(ops, 0, NULL, NULL, i);
+            continue;
+        }
+        if (params && n.param) nymya_circuit_node_args(c, i, params, n.args.raw);
+        ret = backend_sim_lower_gate(n.gate_code, n.args.raw, ops, i);
+    }
+    return ret;
+}
+
+static int sim_run_node(void* ctx, size_t node) {
+    const nymya_circuit* c = ctx;
+    nymya_circuit_node n = c->nodes[node];
+
+    return backend_sim_apply_gate(n.gate_code, n.args.raw);
+}
+
+/**
+ * backend_sim_compile - Fusion plan of a circuit, from the cache or built now.
+ * @c: Sealed circuit.
+ * @ops: Lowered gates of @c, which the plan is built from on a cache miss.
+ * @owned: Set when the plan could not be cached and the caller must free it.
+ *
+ * Returns the plan, or NULL if it could not be built.
+ */
+sim_plan* backend_sim_compile(const nymya_circuit* c, const sim_ops* ops, int* owned) {
+    sim_plan* plan = nymya_circuit_cache_get(NYMYA_CCACHE_SIM, c);
+    size_t bytes = 0;
+
+    *owned = 0;
+    if (plan) return plan;
+    plan = sim_plan_build(ops, &bytes);
+    if (plan)
+        *owned = nymya_circuit_cache_put(NYMYA_CCACHE_SIM, c, plan, bytes, sim_plan_free) != 0;
+    return plan;
+}
+
+/**
+ * backend_sim_run_circuit - Runs a recorded circuit through its compiled plan.
+ * @c: Sealed circuit.
+ *
+ * The plan (see sim_compile.c) comes from the circuit cache when a circuit of
+ * the same structure ran before; only the matrices are rebuilt from the
+ * current parameters. A circuit that does not lower, e.g. one with a gate this
+ * backend rejects, is replayed node by node so errors surface the same way.
+ *
+ * Returns 0 on success, otherwise the result of the failing gate.
+ */
+int backend_sim_run_circuit(const nymya_circuit* c) {
+    sim_ops ops = { 0 };
+    sim_plan* plan;
+    int owned, ret;
+
+    if (sim_lower(c, NULL, &ops)) {
+        sim_ops_free(&ops);
+        return nymya_circuit_replay(c);
+    }
+
+    plan = backend_sim_compile(c, &ops, &owned);
+    if (!plan) {
+        sim_ops_free(&ops);
+        return nymya_circuit_replay(c);
+    }
+
+    // Streamed gates precede the circuit
+    ret = sim_reg_init();
+    if (!ret) ret = sim_fuse_flush(&sim_fused, &sim_reg);
+    if (!ret) ret = sim_plan_run(plan, &ops, &sim_reg, sim_run_node, (void*)c);
+
+    if (owned) sim_plan_free(plan);
+    sim_ops_free(&ops);
+    return ret;
+}
+
+/**
+ * backend_sim_run_bound - Runs a circuit from |0...0> with given parameters.
+ * @c: Sealed circuit.
+ * @plan: Its plan from backend_sim_compile(); only read, so threads share it.
+ * @params: Values of the circuit's parameters.
+ *
+ * The calling thread's register is discarded first. Returns 0 on success,
+ * -1 if the circuit does not lower, otherwise the result of the failing gate.
+ */
+int backend_sim_run_bound(const nymya_circuit* c, const sim_plan* plan, const double* params) {
+    sim_ops ops = { 0 };
+    int ret;
+
+    backend_sim_reset();
+    ret = sim_lower(c, params, &ops);
+    if (!ret) ret = sim_reg_init();
+    if (!ret) ret = sim_plan_run(plan, &ops, &sim_reg, sim_run_node, (void*)c);
+    sim_ops_free(&ops);
+    return ret;
+}
+
+// Applies a 2x2 matrix to slot @t of the register, fused when fusion is on
+static int sim_apply1_slot(unsigned int t, const double complex m[4]) {
+    return sim_fuse_on ? sim_fuse_apply1(&sim_fused, &sim_reg, t, m) : sim_sv_apply1(&sim_reg, t, m);
+}
+
+// Applies one lowered gate to the register, whose qubits have all joined
+static int sim_apply_op(const sim_op* op, const double complex* m) {
+    int t[3];
+
+    for (unsigned int j = 0; j < op->k; j++) {
+        t[j] = sim_sv_find(&sim_reg, op->ids[j]);
+        if (t[j] < 0) return -1;
+    }
+    if (op->k == 1) return sim_apply1_slot(t[0], m);
+    if (op->k == 2)
+        return sim_fuse_on ? sim_fuse_apply2(&sim_fused, &sim_reg, t[0], t[1], m)
+                           : sim_sv_apply2(&sim_reg, t[0], t[1], m);
+    if (sim_fuse_flush_slots(&sim_fused, &sim_reg, (1u << t[0]) | (1u << t[1]) | (1u << t[2])))
+        return -1;
+    return sim_sv_apply3(&sim_reg, t[0], t[1], t[2], m);
+}
+
+/**
+ * sim_noise_channel - Applies one random outcome of a channel to a qubit.
+ * @rule: Channel.
+ * @t: Slot of the qubit.
+ *
+ * Depolarizing noise is a mixture of unitaries, so its outcome does not
+ * depend on the state. Amplitude damping jumps to |0> with probability
+ * gamma * P(1) and otherwise damps |1> by sqrt(1 - gamma); either Kraus
+ * operator is scaled to keep the state normalised.
+ *
+ * Returns 0 on success, -1 if the gate cannot be applied.
+ */
+static int sim_noise_channel(const nymya_noise_rule* rule, unsigned int t) {
+    static const double complex* const paulis[3] = { SIM_X, SIM_Y, SIM_Z };
+    double u = nymya_rng_unit(), p1, jump;
+
+    if (rule->channel == NYMYA_NOISE_DEPOLARIZING)
+        return u <= rule->p ? sim_apply1_slot(t, paulis[nymya_rng_below(3)]) : 0;
+
+    if (sim_fuse_flush_slots(&sim_fused, &sim_reg, 1u << t)) return -1;
+    p1 = sim_sv_prob_one(&sim_reg, t);
+    // Nothing to relax; the no-jump operator is the identity on |0>
+    if (p1 <= 0) return 0;
+    jump = rule->p * p1;
+    if (u <= jump)
+        return sim_apply1_slot(t, (const double complex[4]){ 0, 1 / sqrt(p1), 0, 0 });
+    return sim_apply1_slot(t, (const double complex[4]){ 1 / sqrt(1 - jump), 0, 0,
+                                                         sqrt((1 - rule->p) / (1 - jump)) });
+}
+
+/**
+ * backend_sim_run_noisy - Runs one quantum trajectory of a circuit.
+ * @c: Sealed circuit.
+ * @ops: @c lowered, shared read-only between trajectories.
+ * @noise: Model whose channels follow the matching gates.
+ *
+ * The calling thread's register is discarded and rebuilt from |0...0>.
+ * Gates stream through the fusion buffer; after each circuit node, the
+ * node's channels act on every qubit it touched, drawing from the calling
+ * thread's generator.
+ *
+ * Returns 0 on success, -1 if a gate fails or memory runs out.
+ */
+int backend_sim_run_noisy(const nymya_circuit* c, const sim_ops* ops, const nymya_noise* noise) {
+    size_t i = 0;
+    int ret;
+
+    backend_sim_reset();
+    ret = sim_reg_init();
+    // Every qubit joins first, so slots are fixed for the whole run
+    for (size_t j = 0; j < c->nids && !ret; j++)
+        ret = sim_sv_qubit(&sim_reg, c->ids[j]) < 0;
+
+    for (size_t node = 0; node < c->count && !ret; node++) {
+        const nymya_circuit_node* n = &c->nodes[node];
+
+        for (; i < ops->count && ops->ops[i].node == node && !ret; i++) {
+            const sim_op* op = &ops->ops[i];
+
+            ret = op->k ? sim_apply_op(op, ops->mats + op->m) : sim_run_node((void*)c, node);
+        }
+        for (size_t r = 0; r < noise->count && !ret; r++) {
+            const nymya_noise_rule* rule = &noise->rules[r];
+
+            if (rule->gate_code && rule->gate_code != n->gate_code) continue;
+            for (size_t q = 0; q < n->nqubits && !ret; q++) {
+                int t = sim_sv_find(&sim_reg, c->ids[n->qubit_first + q]);
+
+                ret = t < 0 || sim_noise_channel(rule, (unsigned int)t);
+            }
+        }
+    }
+    if (!ret) ret = sim_fuse_flush(&sim_fused, &sim_reg);
+    return ret ? -1 : 0;
+}
+
+/**
+ * sim_pauli_str - One term of an observable as masks over the register.
+ * @x: Slots the string flips.
+ * @z: Slots where it takes a sign on |1>.
+ * @w: Coefficient times i^(number of Y factors).
+ */
+typedef struct sim_pauli_str {
+    size_t x;
+    size_t z;
+    double complex w;
+} sim_pauli_str;
+
+// Orders terms by X part, then by sign slots so neighbours share a chunk
+static int sim_pauli_str_cmp(const void* a, const void* b) {
+    const sim_pauli_str* p = a;
+    const sim_pauli_str* q = b;
+
+    if (p->x != q->x) return (p->x > q->x) - (p->x < q->x);
+    return (p->z > q->z) - (p->z < q->z);
+}
+
+/**
+ * sim_expect - Expectation value of an observable on a register.
+ * @sv: Register.
+ * @obs: Observable; a qubit outside the register is in |0>.
+ * @out: Receives the value.
+ *
+ * Terms are grouped by the slots they flip, and each group is summed in one
+ * sweep of the register (sim_sv_expect_paulis()). A Hamiltonian of Z and ZZ
+ * terms is then a single pass, however many terms it has.
+ *
+ * Returns 0 on success, -1 on a malformed term or allocation failure.
+ */
+static int sim_expect(const sim_sv* sv, const nymya_observable* obs, double* out) {
+    static const double complex turns[4] = { 1, I, -1, -I };
+    sim_pauli_str* str = malloc((obs->count ? obs->count : 1) * sizeof(*str));
+    size_t* z = malloc((obs->count ? obs->count : 1) * sizeof(*z));
+    double complex* w = malloc((obs->count ? obs->count : 1) * sizeof(*w));
+    size_t n = 0;
+    double e = 0;
+    int ret = -1;
+
+    if (!str || !z || !w) goto out;
+
+    for (size_t t = 0; t < obs->count; t++) {
+        const nymya_pauli_term* term = &obs->terms[t];
+        size_t x = 0, zm = 0;
+        unsigned int ny = 0;
+        int zero = 0;
+
+        for (size_t i = 0; i < term->count; i++) {
+            char op = term->ops[i];
+            int slot;
+
+            if (op == 'I' || op == 'i') continue;
+            if (!term->qubits[i]) goto out;
+            slot = sim_sv_find(sv, term->qubits[i]->id);
+            switch (op) {
+                case 'x': case 'X': if (slot < 0) zero = 1; else x ^= (size_t)1 << slot; break;
+                case 'y': case 'Y':
+                    if (slot < 0) zero = 1;
+                    else { x ^= (size_t)1 << slot; zm ^= (size_t)1 << slot; ny++; }
+                    break;
+                case 'z': case 'Z': if (slot >= 0) zm ^= (size_t)1 << slot; break;
+                default:
+                    fprintf(stderr, "[sim backend] Unknown Pauli '%c' in observable.\n", op);
+                    goto out;
+            }
+        }
+        // X or Y on a qubit still in |0> has expectation 0
+        if (zero || term->coeff == 0) continue;
+        str[n].x = x;
+        str[n].z = zm;
+        str[n++].w = term->coeff * turns[ny & 3];
+    }
+
+    qsort(str, n, sizeof(*str), sim_pauli_str_cmp);
+    for (size_t i = 0; i < n; i++) {
+        z[i] = str[i].z;
+        w[i] = str[i].w;
+    }
+    for (size_t g = 0, end; g < n; g = end) {
+        double v;
+
+        for (end = g + 1; end < n && str[end].x == str[g].x; end++)
+            ;
+        v = sim_sv_expect_paulis(sv, str[g].x, z + g, w + g, end - g);
+        if (isnan(v)) goto out;
+        e += v;
+    }
+    *out = e;
+    ret = 0;
+
+out:
+    free(str);
+    free(z);
+    free(w);
+    return ret;
+}
+
+/**
+ * backend_sim_expectation - Expectation value of an observable on the register.
+ * @obs: Observable.
+ * @out: Receives the value.
+ *
+ * Returns 0 on success, -1 on an empty register or a malformed observable.
+ */
+int backend_sim_expectation(const nymya_observable* obs, double* out) {
+    if (!obs || !out || !sim_reg_ready) return -1;
+    if (sim_fuse_flush(&sim_fused, &sim_reg)) return -1;
+    return sim_expect(&sim_reg, obs, out);
+}
+
+/**
+ * backend_sim_shift_gap - Eigenvalue gap of a parametric gate's generator.
+ * @gate_code: Gate taking theta.
+ *
+ * A gate exp(-i theta G) whose generator has two eigenvalues a gap g apart
+ * obeys the two-term shift rule
+ *     d<O>/dtheta = g/2 * (<O>(theta + pi/(2g)) - <O>(theta - pi/(2g))).
+ *
+ * Returns g, 0 for a gate that cannot change an expectation value (global
+ * phase), or -1 for a generator with more than two eigenvalues (Givens).
+ */
+double backend_sim_shift_gap(int gate_code) {
+    switch (gate_code) {
+        case 3302: return 0;        // global phase
+        case 3325: return 2;        // xyz: triplet 1/2, singlet -3/2
+        case 3328: return M_PI;     // swap_pow: e^{i pi alpha} on the singlet
+        case 3338: return -1;       // givens: eigenvalues -1, 0, 1
+        default:   return 1;        // rotations and phases
+    }
+}
+
+// Applies lowered gates [from, to) to @sv, whose qubits have all joined
+static int sim_apply_ops(sim_sv* sv, const sim_ops* ops, size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) {
+        const sim_op* op = &ops->ops[i];
+        const double complex* m = ops->mats + op->m;
+        int t[3];
+
+        // Identity and QRNG leave the state alone
+        if (op->k == 0) continue;
+        for (unsigned int j = 0; j < op->k; j++) {
+            t[j] = sim_sv_find(sv, op->ids[j]);
+            if (t[j] < 0) return -1;
+        }
+        if ((op->k == 1 && sim_sv_apply1(sv, t[0], m)) ||
+            (op->k == 2 && sim_sv_apply2(sv, t[0], t[1], m)) ||
+            (op->k == 3 && sim_sv_apply3(sv, t[0], t[1], t[2], m)))
+            return -1;
+    }
+    return 0;
+}
+
+// First lowered gate of circuit node @node or later
+static size_t sim_ops_node_start(const sim_ops* ops, size_t node) {
+    size_t lo = 0, hi = ops->count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ops->ops[mid].node < node) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// <obs> with node @node run at @theta instead of its bound value
+static int sim_shifted(const nymya_circuit* c, const sim_ops* ops, const sim_sv* prefix,
+                       sim_sv* work, size_t node, double theta, const nymya_observable* obs,
+                       double* out) {
+    sim_ops gate = { 0 };
+    unsigned char raw[sizeof(c->nodes[node].args.raw)];
+    int ret;
+
+    nymya_circuit_node_theta(c, node, theta, raw);
+    ret = backend_sim_lower_gate(c->nodes[node].gate_code, raw, &gate, node);
+    if (!ret) ret = sim_sv_copy(work, prefix);
+    if (!ret) ret = sim_apply_ops(work, &gate, 0, gate.count);
+    if (!ret) ret = sim_apply_ops(work, ops, sim_ops_node_start(ops, node + 1), ops->count);
+    if (!ret) ret = sim_expect(work, obs, out);
+    sim_ops_free(&gate);
+    return ret;
+}
+
+/**
+ * backend_sim_shift_derivs - Parameter-shift derivatives of some circuit nodes.
+ * @c: Sealed circuit.
+ * @params: Values of its parameters.
+ * @ops: @c lowered with @params.
+ * @occ: Parametric nodes to differentiate, in circuit order.
+ * @nocc: Number of entries in @occ.
+ * @obs: Observable.
+ * @deriv: Receives d<obs>/dtheta of each node in @occ.
+ *
+ * Runs on private registers, not the thread's simulator state. One prefix
+ * register is carried forward through the circuit, so the gates before each
+ * node are applied once for the whole list rather than twice per node; only
+ * the shifted gate and the rest of the circuit run per evaluation.
+ *
+ * Returns 0 on success, -1 if the circuit does not run or memory runs out.
+ */
+int backend_sim_shift_derivs(const nymya_circuit* c, const double* params, const sim_ops* ops,
+                             const size_t* occ, size_t nocc, const nymya_observable* obs,
+                             double* deriv) {
+    sim_sv prefix, work;
+    size_t done = 0;
+    int ret;
+
+    if (sim_sv_init(&prefix)) return -1;
+    if (sim_sv_init(&work)) {
+        sim_sv_free(&prefix);
+        return -1;
+    }
+    ret = sim_sv_set_precision(&prefix, sim_default_precision());
+    // Every qubit joins first, so the register never grows between copies
+    for (size_t i = 0; i < c->nids && !ret; i++)
+        ret = sim_sv_qubit(&prefix, c->ids[i]) < 0;
+
+    for (size_t j = 0; j < nocc && !ret; j++) {
+        const nymya_circuit_node* n = &c->nodes[occ[j]];
+        size_t start = sim_ops_node_start(ops, occ[j]);
+        double g = backend_sim_shift_gap(n->gate_code), s = M_PI / (2 * g);
+        double theta = params[n->param - 1], plus, minus;
+
+        ret = sim_apply_ops(&prefix, ops, done, start);
+        done = start;
+        if (!ret) ret = sim_shifted(c, ops, &prefix, &work, occ[j], theta + s, obs, &plus);
+        if (!ret) ret = sim_shifted(c, ops, &prefix, &work, occ[j], theta - s, obs, &minus);
+        if (!ret) deriv[j] = g / 2 * (plus - minus);
+    }
+
+    sim_sv_free(&prefix);
+    sim_sv_free(&work);
+    return ret ? -1 : 0;
+}
+
+/**
+ * backend_sim_lower_circuit - Lowers a circuit with given parameters.
+ * @c: Sealed circuit.
+ * @params: Parameter values, or NULL for the circuit's own.
+ * @ops: Receives the gates; the caller frees them with sim_ops_free().
+ *
+ * Returns 0 on success, -1 if a node does not lower.
+ */
+int backend_sim_lower_circuit(const nymya_circuit* c, const double* params, sim_ops* ops) {
+    return sim_lower(c, params, ops);
+}
+
+/**
+ * backend_sim_prob_one - Probability of measuring a qubit as |1>.
+ * @q: Qubit, looked up by ID.
+ * @p: Receives the probability.
+ *
+ * Returns 0 on success, -1 if @q has never been used by a gate.
+ */
+int backend_sim_prob_one(const nymya_qubit* q, double* p) {
+    int t;
+
+    if (!q || !p || !sim_reg_ready) return -1;
+    t = sim_sv_find(&sim_reg, q->id);
+    if (t < 0) return -1;
+    if (sim_fuse_flush_slots(&sim_fused, &sim_reg, 1u << t)) return -1;
+    *p = sim_sv_prob_one(&sim_reg, t);
+    return 0;
+}
+
+/**
+ * backend_sim_sample - Draws measurement shots of some qubits from the register.
+ * @qubits: Measured qubits, looked up by ID; one never used by a gate reads 0.
+ * @n: Number of qubits; output bit i of a shot is @qubits[i].
+ * @shots: Number of shots.
+ * @out: @shots rows of (@n + 63) / 64 words; bit i % 64 of word i / 64.
+ *
+ * The register is left as it is. Sorted uniforms come from normalised
+ * exponential spacings, so no sort is needed, and the rows they fill are
+ * shuffled so the shots are independent and in no particular order.
+ *
+ * Returns 0 on success, -1 on an empty register or allocation failure.
+ */
+int backend_sim_sample(nymya_qubit* const* qubits, size_t n, unsigned int shots, uint64_t* out) {
+    size_t words = (n + 63) / 64;
+    double* u = NULL;
+    uint32_t* row = NULL;
+    int* slots = NULL;
+    double sum = 0;
+    int ret = -1;
+
+    if (!sim_reg_ready || (n && !qubits) || n > UINT32_MAX) return -1;
+    if (!shots) return 0;
+    if (words && shots > SIZE_MAX / sizeof(*out) / words) return -1;
+    if (sim_fuse_flush(&sim_fused, &sim_reg)) return -1;
+
+    u = malloc(shots * sizeof(*u));
+    row = malloc(shots * sizeof(*row));
+    slots = malloc((n ? n : 1) * sizeof(*slots));
+    if (!u || !row || !slots) goto out;
+
+    for (size_t i = 0; i < n; i++)
+        slots[i] = qubits[i] ? sim_sv_find(&sim_reg, qubits[i]->id) : -1;
+    for (unsigned int k = 0; k < shots; k++) {
+        sum += -log(nymya_rng_unit());
+        u[k] = sum;
+    }
+    sum += -log(nymya_rng_unit());
+    for (unsigned int k = 0; k < shots; k++)
+        u[k] /= sum;
+    for (unsigned int k = 0; k < shots; k++) {
+        uint32_t j = (uint32_t)nymya_rng_below(k + 1);
+        if (j != k) row[k] = row[j];
+        row[j] = k;
+    }
+
+    memset(out, 0, (size_t)shots * words * sizeof(*out));
+    ret = sim_sv_sample(&sim_reg, u, row, shots, slots, (unsigned int)n, out);
+
+out:
+    free(u);
+    free(row);
+    free(slots);
+    return ret;
+}
+
+/**
+ * backend_sim_load - Replaces the register with a state given by its support.
+ * @ids: Qubit IDs; @ids[k] becomes slot k, i.e. bit k of the basis index.
+ * @n: Number of qubits, at most SIM_SV_MAX_QUBITS.
+ * @basis: Basis indices of the nonzero amplitudes.
+ * @amps: Their amplitudes.
+ * @count: Number of entries.
+ *
+ * Lets a backend with a compact representation hand its state over once
+ * that representation stops paying off. Returns 0 on success, -1 on invalid
+ * arguments or allocation failure (the register is then empty).
+ */
+int backend_sim_load(const uint64_t* ids, unsigned int n, const uint64_t* basis,
+                     const double complex* amps, size_t count) {
+    if (n > SIM_SV_MAX_QUBITS) return -1;
+    backend_sim_reset();
+    if (sim_reg_init()) return -1;
+    if (n && sim_admit((size_t)3 << (n - 1), n)) {
+        backend_sim_reset();
+        return -1;
+    }
+
+    for (unsigned int k = 0; k < n; k++) {
+        if (sim_sv_qubit(&sim_reg, ids[k]) != (int)k) {
+            backend_sim_reset();
+            return -1;
+        }
+    }
+    sim_sv_set(&sim_reg, 0, 0);
+    for (size_t i = 0; i < count; i++) {
+        if (basis[i] >= sim_reg.dim) {
+            backend_sim_reset();
+            return -1;
+        }
+        sim_sv_set(&sim_reg, basis[i], amps[i]);
+    }
+    return 0;
+}
+
+/**
+ * backend_sim_save - Writes the register to a checkpoint file.
+ * @path: File to create or replace.
+ * @position: Caller's position in its circuit, returned by the restore.
+ * @flags: NYMYA_CKPT_* bits.
+ *
+ * Pending fused gates are applied first; an unused register saves as the
+ * empty state.
+ *
+ * Returns 0 on success, -1 if a gate fails or the file cannot be written.
+ */
+int backend_sim_save(const char* path, uint64_t position, unsigned int flags) {
+    if (sim_reg_init() || sim_fuse_flush(&sim_fused, &sim_reg)) return -1;
+    return sim_ckpt_save(&sim_reg, path, position, flags);
+}
+
+/**
+ * backend_sim_restore - Replaces the register with the state of a checkpoint.
+ * @path: File written by backend_sim_save().
+ * @position: Receives the position saved with it, if not NULL.
+ *
+ * The register keeps the file's precision unless the memory budget needs
+ * float storage, and the calling thread's generator continues from the
+ * saved state.
+ *
+ * Returns 0 on success, -1 if the file is unreadable, over the memory
+ * budget, or corrupt (the register is left untouched, or empty if the
+ * failure came after it was dropped).
+ */
+int backend_sim_restore(const char* path, uint64_t* position) {
+    sim_sv_precision want;
+    sim_ckpt ck;
+
+    if (sim_ckpt_open(&ck, path)) return -1;
+    backend_sim_reset();
+    if (sim_reg_init() || sim_sv_set_precision(&sim_reg, (sim_sv_precision)ck.h.precision) ||
+        sim_admit((size_t)1 << ck.h.nqubits, (unsigned int)ck.h.nqubits))
+        goto fail;
+    // sim_admit() may have moved the register to float to fit the budget
+    want = sim_reg.precision;
+    if (sim_ckpt_take(&ck, &sim_reg)) goto fail;
+    sim_ckpt_close(&ck);
+    if (want != sim_reg.precision && sim_sv_set_precision(&sim_reg, want)) {
+        backend_sim_reset();
+        return -1;
+    }
+    if (ck.h.rng_words == NYMYA_RNG_STATE_WORDS) nymya_rng_restore(ck.h.rng);
+    if (position) *position = ck.h.position;
+    return 0;
+
+fail:
+    sim_ckpt_close(&ck);
+    backend_sim_reset();
+    return -1;
+}
+
+/**
+ * backend_sim_snapshot - Freezes the register into a snapshot.
+ * @s: Receives the snapshot; release it with sim_snap_close().
+ *
+ * Pending fused gates are applied first. The register carries on as the
+ * first branch of @s, so taking the snapshot costs one copy of the state
+ * while it runs and nothing once it returns.
+ *
+ * Returns 0 on success, -1 if a gate fails or the snapshot cannot be made
+ * (the register is then unchanged).
+ */
+int backend_sim_snapshot(sim_snap* s) {
+    if (sim_reg_init() || sim_fuse_flush(&sim_fused, &sim_reg)) return -1;
+    return sim_snap_take(s, &sim_reg);
+}
+
+/**
+ * backend_sim_branch - Replaces the register with a branch of a snapshot.
+ * @s: Snapshot from backend_sim_snapshot(), taken on any thread.
+ *
+ * The branch is not checked against the memory budget: it starts out
+ * sharing every page of @s, and only the pages its gates write are its
+ * own. The calling thread's generator is left as it is, so branches
+ * sampling from one snapshot draw different outcomes.
+ *
+ * Returns 0 on success, -1 if @s cannot be mapped (the register is then
+ * empty).
+ */
+int backend_sim_branch(const sim_snap* s) {
+    backend_sim_reset();
+    if (sim_reg_init() || sim_snap_branch(s, &sim_reg)) {
+        backend_sim_reset();
+        return -1;
+    }
+    return 0;
+}
+
+// Bytes of the register that are its own rather than shared with a snapshot
+int backend_sim_private_bytes(size_t* out) {
+    if (!sim_reg_ready) {
+        *out = 0;
+        return 0;
+    }
+    return sim_snap_private(&sim_reg, out);
+}
+
+/**
+ * backend_sim_flush - Applies every gate still held in the fusion buffer.
+ *
+ * Returns 0 on success, -1 if a gate could not be applied.
+ */
+int backend_sim_flush(void) {
+    return sim_reg_ready ? sim_fuse_flush(&sim_fused, &sim_reg) : 0;
+}
+
+/**
+ * backend_sim_reset - Discards the register; the next gate starts a new one.
+ */
+void backend_sim_reset(void) {
+    if (sim_reg_ready) sim_sv_free(&sim_reg);
+    sim_reg_ready = 0;
+}
+
+/**
+ * backend_sim_num_qubits - Number of qubits currently in the register.
+ */
+unsigned int backend_sim_num_qubits(void) {
+    return sim_reg_ready ? sim_reg.nqubits : 0;
+}
+
+/**
+ * backend_sim_has_qubit - Non-zero if a qubit with ID @id is in the register.
+ */
+int backend_sim_has_qubit(uint64_t id) {
+    return sim_reg_ready && sim_sv_find(&sim_reg, id) >= 0;
+}
+
+/**
+ * backend_sim_precision - Storage of the live register, else of the next one.
+ *
+ * Returns SIM_SV_DOUBLE, SIM_SV_FLOAT or SIM_SV_MIXED.
+ */
+int backend_sim_precision(void) {
+    return sim_reg_ready ? (int)sim_reg.precision : (int)sim_default_precision();
+}
+
+/**
+ * backend_sim_set_precision - Sets how the register stores its amplitudes.
+ * @precision: SIM_SV_DOUBLE, SIM_SV_FLOAT or SIM_SV_MIXED; negative returns
+ *             to the NYMYA_SIM_PRECISION default.
+ *
+ * A live register is converted in place, which rounds it when going to
+ * float; later registers start in the same mode.
+ *
+ * Returns 0 on success, -1 if the converted register does not fit in memory.
+ */
+int backend_sim_set_precision(int precision) {
+    sim_precision_set = 0;
+    if (precision >= 0) {
+        sim_precision = (sim_sv_precision)precision;
+        sim_precision_set = 1;
+    }
+    return sim_reg_ready ? sim_sv_set_precision(&sim_reg, sim_default_precision()) : 0;
+}
+
+/**
+ * backend_sim_set_threads - Sets the number of threads that sweep the register.
+ * @threads: Thread count; 0 picks NYMYA_SIM_THREADS, else one per online CPU.
+ *
+ * Registers below SIM_POOL_MIN_AMPS amplitudes per thread always run on the
+ * calling thread. Returns the thread count now in effect.
+ */
+int backend_sim_set_threads(unsigned int threads) {
+    return sim_pool_set_threads(threads);
+}
@@ -2,9 +2,63 @@
 #define NYMYA_BACKEND_SIM_H
 
 #include <stdint.h>
+#include <complex.h>
 #include <nymya/nymya.h>
+#include "nymya_runtime.h"
+#include "sim_compile.h"
+#include "sim_snap.h"
 
 // Core gate executor for simulation backend
 int backend_sim_apply_gate(int gate_code, void* args);
 
+// State-vector register queries; qubits are looked up by ID
+int backend_sim_prob_one(const nymya_qubit* q, double* p);
+unsigned int backend_sim_num_qubits(void);
+int backend_sim_has_qubit(uint64_t id);
+int backend_sim_flush(void);
+int backend_sim_sample(nymya_qubit* const* qubits, size_t n, unsigned int shots, uint64_t* out);
+int backend_sim_load(const uint64_t* ids, unsigned int n, const uint64_t* basis,
+                     const double complex* amps, size_t count);
+void backend_sim_reset(void);
+
+// Checkpoints of the register and the thread's generator (see sim_ckpt.c)
+int backend_sim_save(const char* path, uint64_t position, unsigned int flags);
+int backend_sim_restore(const char* path, uint64_t* position);
+
+// Copy-on-write snapshots of the register that branches start from (see sim_snap.c)
+int backend_sim_snapshot(sim_snap* s);
+int backend_sim_branch(const sim_snap* s);
+int backend_sim_private_bytes(size_t* out);
+
+// Lowers one gate to dense 1-3 qubit matrices without applying it
+int backend_sim_lower_gate(int gate_code, void* args, sim_ops* ops, size_t node);
+
+// Matrix of a 1- or 2-qubit gate as this backend applies it; returns the qubit count
+int backend_sim_gate_matrix(int gate_code, double theta, char axis, double complex* m);
+
+// Runs a recorded circuit through its cached compiled plan
+int backend_sim_run_circuit(const nymya_circuit* c);
+
+// Compiled plans shared by batch runs of one circuit structure
+int backend_sim_lower_circuit(const nymya_circuit* c, const double* params, sim_ops* ops);
+sim_plan* backend_sim_compile(const nymya_circuit* c, const sim_ops* ops, int* owned);
+int backend_sim_run_bound(const nymya_circuit* c, const sim_plan* plan, const double* params);
+
+// One quantum trajectory of a circuit under a noise model (see nymya_noisy_sample())
+int backend_sim_run_noisy(const nymya_circuit* c, const sim_ops* ops, const nymya_noise* noise);
+
+// Observables and parameter-shift gradients (see nymya_gradient())
+int backend_sim_expectation(const nymya_observable* obs, double* out);
+double backend_sim_shift_gap(int gate_code);
+int backend_sim_shift_derivs(const nymya_circuit* c, const double* params, const sim_ops* ops,
+                             const size_t* occ, size_t nocc, const nymya_observable* obs,
+                             double* deriv);
+
+// Worker threads for large registers; 0 selects the default
+int backend_sim_set_threads(unsigned int threads);
+
+// Amplitude storage of the register (double, float, or float with double sums)
+int backend_sim_set_precision(int precision);
+int backend_sim_precision(void);
+
 #endif // NYMYA_BACKEND_SIM_H
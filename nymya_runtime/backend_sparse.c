@@ -0,0 +1,473 @@
+// backend_sparse.c
+//
+// Sparse-amplitude backend. Basis preparation, oracles and permutation gates
+// (X, CNOT, Toffoli, Fredkin, Peres, ...) leave most circuits with only a
+// handful of nonzero amplitudes. This backend stores just those, in an
+// open-addressed hash map keyed by basis index, so memory follows the size
+// of the support instead of 2^n and a permutation gate costs one pass over
+// the support.
+//
+// Gates are lowered with the simulator's own definitions
+// (backend_sim_lower_gate). Once the support passes the dense threshold, the
+// state is handed to the simulator's state vector (backend_sim_load) and
+// every later call is forwarded there.
+//
+// Qubits join in |0> the first time a gate names their ID; the k-th qubit is
+// bit k of the basis index.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+#include "backend_sparse.h"
+#include "backend_sim.h"
+#include "sim_compile.h"
+#include "sim_statevec.h"
+
+#define SPARSE_MAX_QUBITS 64
+
+// Amplitudes with |a|^2 below this after a gate are taken as cancelled
+#define SPARSE_EPS2 1e-28
+
+// Default dense threshold: the map costs about as much as 1/16 of 2^n
+// amplitudes, but small states stay sparse so later qubits can still join
+#define SPARSE_DENSE_SHIFT 4
+#define SPARSE_DENSE_MIN   4096
+
+/**
+ * sparse_map - Open-addressed (linear probing) map from basis index to amplitude.
+ * @keys: Basis indices.
+ * @vals: Amplitudes.
+ * @used: Non-zero for occupied entries.
+ * @cap: Table size, a power of two, kept at least twice @count.
+ * @count: Occupied entries.
+ */
+typedef struct sparse_map {
+    uint64_t* keys;
+    double complex* vals;
+    unsigned char* used;
+    size_t cap;
+    size_t count;
+} sparse_map;
+
+/**
+ * sparse_state - The whole state.
+ * @amps: Support of the state.
+ * @nqubits: Number of qubits.
+ * @ids: nymya_qubit ID of each bit.
+ * @threshold: Support size that triggers the switch to dense (0 = automatic).
+ * @ready: The map holds |0...0> or a later state.
+ * @dense: The state now lives in the simulator backend.
+ */
+typedef struct sparse_state {
+    sparse_map amps;
+    unsigned int nqubits;
+    uint64_t ids[SPARSE_MAX_QUBITS];
+    size_t threshold;
+    int ready;
+    int dense;
+} sparse_state;
+
+static __thread sparse_state sparse;
+
+static void sparse_map_free(sparse_map* m) {
+    free(m->keys);
+    free(m->vals);
+    free(m->used);
+    memset(m, 0, sizeof(*m));
+}
+
+static int sparse_map_init(sparse_map* m, size_t entries) {
+    size_t cap = 16;
+
+    while (cap < 2 * entries) cap *= 2;
+    m->keys = malloc(cap * sizeof(*m->keys));
+    m->vals = malloc(cap * sizeof(*m->vals));
+    m->used = calloc(cap, 1);
+    m->cap = cap;
+    m->count = 0;
+    if (!m->keys || !m->vals || !m->used) {
+        sparse_map_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+static size_t sparse_map_probe(const sparse_map* m, uint64_t key) {
+    size_t mask = m->cap - 1;
+    size_t i = (size_t)((key ^ (key >> 29)) * 0x9E3779B97F4A7C15ull) & mask;
+
+    while (m->used[i] && m->keys[i] != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+static int sparse_map_rehash(sparse_map* m, size_t entries) {
+    sparse_map n;
+
+    if (sparse_map_init(&n, entries)) return -1;
+    for (size_t i = 0; i < m->cap; i++) {
+        size_t j;
+
+        if (!m->used[i]) continue;
+        j = sparse_map_probe(&n, m->keys[i]);
+        n.used[j] = 1;
+        n.keys[j] = m->keys[i];
+        n.vals[j] = m->vals[i];
+        n.count++;
+    }
+    sparse_map_free(m);
+    *m = n;
+    return 0;
+}
+
+/**
+ * sparse_map_slot - Finds the amplitude of a basis index, inserting 0 if absent.
+ * @m: Map.
+ * @key: Basis index.
+ *
+ * Returns a pointer to the amplitude, valid until the next insertion, or
+ * NULL on allocation failure.
+ */
+static double complex* sparse_map_slot(sparse_map* m, uint64_t key) {
+    size_t i = sparse_map_probe(m, key);
+
+    if (m->used[i]) return &m->vals[i];
+    if (2 * (m->count + 1) > m->cap) {
+        if (sparse_map_rehash(m, m->count + 1)) return NULL;
+        i = sparse_map_probe(m, key);
+    }
+    m->used[i] = 1;
+    m->keys[i] = key;
+    m->vals[i] = 0;
+    m->count++;
+    return &m->vals[i];
+}
+
+static int sparse_init(void) {
+    double complex* a;
+
+    if (sparse.ready) return 0;
+    if (sparse_map_init(&sparse.amps, 1)) return -1;
+    a = sparse_map_slot(&sparse.amps, 0);
+    if (!a) return -1;
+    *a = 1;
+    sparse.ready = 1;
+    return 0;
+}
+
+/**
+ * sparse_bit - Maps a qubit ID to its bit, adding the qubit in |0> if new.
+ * @id: nymya_qubit ID.
+ *
+ * Returns the bit, or -1 if all SPARSE_MAX_QUBITS bits are taken.
+ */
+static int sparse_bit(uint64_t id) {
+    for (unsigned int i = 0; i < sparse.nqubits; i++) {
+        if (sparse.ids[i] == id) return (int)i;
+    }
+    if (sparse.nqubits >= SPARSE_MAX_QUBITS) return -1;
+    sparse.ids[sparse.nqubits] = id;
+    return (int)sparse.nqubits++;
+}
+
+/**
+ * sparse_permute - Applies a permutation gate by remapping keys.
+ * @k: Number of targets, 1 to 3.
+ * @bits: Target bits; @bits[0] is the high index bit.
+ * @p: The gate, from sim_sv_perm_of().
+ *
+ * Each basis index moves to exactly one other, so the support keeps its size,
+ * nothing can cancel, and amplitudes are only negated or have re and im
+ * exchanged.
+ *
+ * Returns 0 on success, -1 on allocation failure (the state is unchanged).
+ */
+static int sparse_permute(unsigned int k, const unsigned int* bits, const sim_sv_perm* p) {
+    size_t dim = (size_t)1 << k;
+    uint64_t mask, off[8];
+    sparse_map* old = &sparse.amps;
+    sparse_map n;
+
+    for (size_t y = 0; y < dim; y++) {
+        off[y] = 0;
+        for (unsigned int j = 0; j < k; j++) {
+            if ((y >> (k - 1 - j)) & 1) off[y] |= (uint64_t)1 << bits[j];
+        }
+    }
+    mask = off[dim - 1];
+
+    if (sparse_map_init(&n, old->count)) return -1;
+    for (size_t i = 0; i < old->cap; i++) {
+        uint64_t key;
+        double complex a;
+        size_t x = 0, j;
+
+        if (!old->used[i]) continue;
+        key = old->keys[i];
+        for (unsigned int b = 0; b < k; b++)
+            x |= (size_t)((key >> bits[b]) & 1) << (k - 1 - b);
+
+        key = (key & ~mask) | off[p->to[x]];
+        a = old->vals[i];
+        switch (p->turn[x]) {
+            case 1: a = CMPLX(-cimag(a), creal(a)); break;
+            case 2: a = -a; break;
+            case 3: a = CMPLX(cimag(a), -creal(a)); break;
+        }
+        j = sparse_map_probe(&n, key);
+        n.used[j] = 1;
+        n.keys[j] = key;
+        n.vals[j] = a;
+        n.count++;
+    }
+
+    sparse_map_free(old);
+    *old = n;
+    return 0;
+}
+
+/**
+ * sparse_apply - Applies a k-qubit matrix to the support.
+ * @k: Number of targets, 1 to 3.
+ * @bits: Target bits; @bits[0] is the high index bit of @m.
+ * @m: Row-major 2^k x 2^k matrix.
+ *
+ * Every stored amplitude is scattered through its column of @m into a new
+ * map, skipping zero entries. Amplitudes that cancel are dropped afterwards.
+ * Permutation gates take the sparse_permute() path instead.
+ *
+ * Returns 0 on success, -1 on allocation failure (the state is unchanged).
+ */
+static int sparse_apply(unsigned int k, const unsigned int* bits, const double complex* m) {
+    size_t dim = (size_t)1 << k, fan = 0, dead = 0;
+    uint64_t mask = 0, off[8];
+    sparse_map* old = &sparse.amps;
+    sim_sv_perm perm;
+    sparse_map n;
+
+    if (sim_sv_perm_of(m, k, &perm)) return sparse_permute(k, bits, &perm);
+
+    for (unsigned int j = 0; j < k; j++)
+        mask |= (uint64_t)1 << bits[j];
+    for (size_t y = 0; y < dim; y++) {
+        size_t nz = 0;
+
+        off[y] = 0;
+        for (unsigned int j = 0; j < k; j++) {
+            if ((y >> (k - 1 - j)) & 1) off[y] |= (uint64_t)1 << bits[j];
+        }
+        for (size_t x = 0; x < dim; x++) nz += m[y * dim + x] != 0;
+        if (nz > fan) fan = nz;
+    }
+
+    if (sparse_map_init(&n, old->count * fan)) return -1;
+    for (size_t i = 0; i < old->cap; i++) {
+        uint64_t key, base;
+        double complex a;
+        size_t x = 0;
+
+        if (!old->used[i]) continue;
+        key = old->keys[i];
+        a = old->vals[i];
+        base = key & ~mask;
+        for (unsigned int j = 0; j < k; j++)
+            x |= (size_t)((key >> bits[j]) & 1) << (k - 1 - j);
+
+        for (size_t y = 0; y < dim; y++) {
+            double complex w = m[y * dim + x];
+            double complex* slot;
+
+            if (w == 0) continue;
+            slot = sparse_map_slot(&n, base | off[y]);
+            if (!slot) {
+                sparse_map_free(&n);
+                return -1;
+            }
+            *slot += w * a;
+        }
+    }
+
+    for (size_t i = 0; i < n.cap; i++) {
+        if (n.used[i] && creal(n.vals[i] * conj(n.vals[i])) < SPARSE_EPS2) dead++;
+    }
+    if (dead) {
+        sparse_map live;
+
+        if (sparse_map_init(&live, n.count - dead)) {
+            sparse_map_free(&n);
+            return -1;
+        }
+        for (size_t i = 0; i < n.cap; i++) {
+            size_t j;
+
+            if (!n.used[i] || creal(n.vals[i] * conj(n.vals[i])) < SPARSE_EPS2) continue;
+            j = sparse_map_probe(&live, n.keys[i]);
+            live.used[j] = 1;
+            live.keys[j] = n.keys[i];
+            live.vals[j] = n.vals[i];
+            live.count++;
+        }
+        sparse_map_free(&n);
+        n = live;
+    }
+
+    sparse_map_free(old);
+    *old = n;
+    return 0;
+}
+
+/**
+ * sparse_densify - Hands the state to the simulator once the support is large.
+ *
+ * Returns 0 whether or not the state moved, -1 if the hand-over failed.
+ */
+static int sparse_densify(void) {
+    size_t limit = sparse.threshold;
+    uint64_t* basis;
+    double complex* amps;
+    size_t j = 0;
+    int ret;
+
+    if (sparse.nqubits > SIM_SV_MAX_QUBITS) return 0;
+    if (!limit) {
+        limit = ((size_t)1 << sparse.nqubits) >> SPARSE_DENSE_SHIFT;
+        if (limit < SPARSE_DENSE_MIN) limit = SPARSE_DENSE_MIN;
+    }
+    if (sparse.amps.count <= limit) return 0;
+
+    basis = malloc(sparse.amps.count * sizeof(*basis));
+    amps = malloc(sparse.amps.count * sizeof(*amps));
+    if (!basis || !amps) {
+        free(basis);
+        free(amps);
+        return 0;
+    }
+    for (size_t i = 0; i < sparse.amps.cap; i++) {
+        if (!sparse.amps.used[i]) continue;
+        basis[j] = sparse.amps.keys[i];
+        amps[j++] = sparse.amps.vals[i];
+    }
+    ret = backend_sim_load(sparse.ids, sparse.nqubits, basis, amps, j);
+    free(basis);
+    free(amps);
+    if (ret) {
+        fprintf(stderr, "[sparse backend] Could not move the state to the state vector\n");
+        return -1;
+    }
+    sparse_map_free(&sparse.amps);
+    sparse.dense = 1;
+    return 0;
+}
+
+/**
+ * backend_sparse_apply_gate - Runs one gate on the sparse state.
+ * @gate_code: Gate.
+ * @args: Gate arguments (same structs as the sim backend).
+ *
+ * Returns 0 on success, -1 on invalid arguments, an unsupported gate, more
+ * than SPARSE_MAX_QUBITS qubits or allocation failure.
+ */
+int backend_sparse_apply_gate(int gate_code, void* args) {
+    static __thread sim_ops ops;
+    int ret = 0;
+
+    if (!args) return -1;
+    if (sparse.dense) return backend_sim_apply_gate(gate_code, args);
+    if (sparse_init()) return -1;
+
+    switch (gate_code) {
+        case 3301: { // identity: only brings the qubit into the register
+            nymya_qubit* q = *(nymya_qubit**)args;
+            return q && sparse_bit(q->id) >= 0 ? 0 : -1;
+        }
+        case 3342: // deutsch: the oracle callback works on scalar qubits
+            fprintf(stderr, "[sparse backend] Gate %d is not supported on a sparse state\n",
+                    gate_code);
+            return -1;
+        case 3361: // qrng_range touches no qubits
+            return backend_sim_apply_gate(gate_code, args);
+        default:
+            break;
+    }
+
+    ops.count = 0;
+    ops.nmats = 0;
+    if (backend_sim_lower_gate(gate_code, args, &ops, 0)) return -1;
+
+    for (size_t i = 0; i < ops.count && !ret; i++) {
+        const sim_op* op = &ops.ops[i];
+        unsigned int bits[3];
+
+        for (unsigned int j = 0; j < op->k; j++) {
+            int b = sparse_bit(op->ids[j]);
+
+            if (b < 0) return -1;
+            bits[j] = (unsigned int)b;
+        }
+        ret = sparse_apply(op->k, bits, ops.mats + op->m);
+    }
+    if (!ret) ret = sparse_densify();
+    return ret;
+}
+
+/**
+ * backend_sparse_prob_one - Probability of measuring a qubit as |1>.
+ * @q: Qubit, looked up by ID.
+ * @p: Receives the probability.
+ *
+ * Returns 0 on success, -1 if @q has never been used by a gate.
+ */
+int backend_sparse_prob_one(const nymya_qubit* q, double* p) {
+    double w[2] = { 0, 0 };
+    int b = -1;
+
+    if (!q || !p) return -1;
+    if (sparse.dense) return backend_sim_prob_one(q, p);
+    if (!sparse.ready) return -1;
+    for (unsigned int i = 0; i < sparse.nqubits; i++) {
+        if (sparse.ids[i] == q->id) b = (int)i;
+    }
+    if (b < 0) return -1;
+
+    for (size_t i = 0; i < sparse.amps.cap; i++) {
+        if (!sparse.amps.used[i]) continue;
+        w[(sparse.amps.keys[i] >> b) & 1] += creal(sparse.amps.vals[i] * conj(sparse.amps.vals[i]));
+    }
+    *p = w[0] + w[1] > 0 ? w[1] / (w[0] + w[1]) : 0;
+    return 0;
+}
+
+/**
+ * backend_sparse_support - Number of stored amplitudes, or 0 once dense.
+ */
+size_t backend_sparse_support(void) {
+    if (sparse.dense) return 0;
+    return sparse.ready ? sparse.amps.count : 1;
+}
+
+/**
+ * backend_sparse_set_threshold - Sets the support size that switches to dense.
+ * @support: Amplitude count; 0 picks 2^n / 16 for the current n, and at
+ *           least SPARSE_DENSE_MIN.
+ */
+void backend_sparse_set_threshold(size_t support) {
+    sparse.threshold = support;
+}
+
+/**
+ * backend_sparse_reset - Discards the state; the next gate starts a new one.
+ *
+ * A state that went dense is discarded from the simulator backend too. The
+ * threshold is kept.
+ */
+void backend_sparse_reset(void) {
+    size_t threshold = sparse.threshold;
+
+    if (sparse.dense) backend_sim_reset();
+    sparse_map_free(&sparse.amps);
+    memset(&sparse, 0, sizeof(sparse));
+    sparse.threshold = threshold;
+}
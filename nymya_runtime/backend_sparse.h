@@ -0,0 +1,19 @@
+#ifndef NYMYA_BACKEND_SPARSE_H
+#define NYMYA_BACKEND_SPARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+
+// Core gate executor for the sparse-amplitude backend
+int backend_sparse_apply_gate(int gate_code, void* args);
+
+// Support queries; qubits are looked up by ID
+int backend_sparse_prob_one(const nymya_qubit* q, double* p);
+size_t backend_sparse_support(void);
+void backend_sparse_reset(void);
+
+// Support size above which the state moves to the dense simulator
+void backend_sparse_set_threshold(size_t support);
+
+#endif // NYMYA_BACKEND_SPARSE_H
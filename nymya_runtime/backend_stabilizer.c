@@ -0,0 +1,593 @@
+// backend_stabilizer.c
+//
+// Stabilizer backend for Clifford circuits, after Aaronson and Gottesman's CHP.
+// An n-qubit stabilizer state is held as 2n Pauli rows (n destabilizers and n
+// stabilizers), so memory is O(n^2) bits and each gate costs O(n) instead of
+// the O(2^n) of the state vector.
+//
+// The tableau is stored column-major: for every qubit one bit-vector of X
+// components and one of Z components across all rows. Each Clifford gate then
+// updates whole 64-row words at once. Qubits join in |0> on first use, by ID,
+// as in the simulator backend.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+#include "backend_stabilizer.h"
+#include "nymya_gates.h"
+
+// Argument structs
+typedef nymya_arg_q stab_arg_q;
+typedef nymya_arg_q2 stab_arg_q2;
+typedef nymya_arg_q3 stab_arg_q3;
+typedef nymya_arg_q_arr stab_arg_q_arr;
+typedef nymya_arg_q3d stab_arg_q3d;
+typedef nymya_arg_q4d stab_arg_q4d;
+typedef nymya_arg_q5d stab_arg_q5d;
+
+/**
+ * stab_tableau - CHP tableau, column-major.
+ * @n: Number of qubits.
+ * @cap: Qubit capacity; destabilizer i is row i, stabilizer i is row @cap + i.
+ * @words: 64-bit words per column (2 * @cap / 64).
+ * @x: X bits; column j is @x + j * @words.
+ * @z: Z bits, laid out like @x.
+ * @r: Sign bit of every row.
+ * @ids: nymya_qubit ID of each slot.
+ * @map_key: Open-addressed table from qubit ID ...
+ * @map_slot: ... to 1 + its slot (0 = empty).
+ * @map_cap: Table size, a power of two.
+ */
+typedef struct stab_tableau {
+    size_t n;
+    size_t cap;
+    size_t words;
+    uint64_t* x;
+    uint64_t* z;
+    uint64_t* r;
+    uint64_t* ids;
+    uint64_t* map_key;
+    size_t* map_slot;
+    size_t map_cap;
+} stab_tableau;
+
+static __thread stab_tableau stab;
+
+#define STAB_COL(t, base, j) ((base) + (j) * (t)->words)
+#define STAB_GET(v, row) (((v)[(row) >> 6] >> ((row) & 63)) & 1)
+#define STAB_FLIP(v, row) ((v)[(row) >> 6] ^= (uint64_t)1 << ((row) & 63))
+
+static size_t* stab_map_find(stab_tableau* t, uint64_t id) {
+    size_t mask = t->map_cap - 1;
+    size_t i = (size_t)(id * 0x9E3779B97F4A7C15ull) & mask;
+
+    while (t->map_slot[i] && t->map_key[i] != id)
+        i = (i + 1) & mask;
+    t->map_key[i] = id;
+    return &t->map_slot[i];
+}
+
+/**
+ * stab_grow - Doubles the qubit capacity, keeping every row and column.
+ * @t: Tableau.
+ *
+ * Returns 0 on success, -1 on allocation failure (the tableau is unchanged).
+ */
+static int stab_grow(stab_tableau* t) {
+    size_t cap = t->cap ? 2 * t->cap : 64;
+    size_t words = 2 * cap / 64, half_old = t->cap / 64;
+    uint64_t* x = calloc(cap * words, sizeof(*x));
+    uint64_t* z = calloc(cap * words, sizeof(*z));
+    uint64_t* r = calloc(words, sizeof(*r));
+    uint64_t* ids = realloc(t->ids, cap * sizeof(*ids));
+    uint64_t* map_key = calloc(2 * cap, sizeof(*map_key));
+    size_t* map_slot = calloc(2 * cap, sizeof(*map_slot));
+
+    if (ids) t->ids = ids;
+    if (!x || !z || !r || !ids || !map_key || !map_slot) {
+        free(x); free(z); free(r); free(map_key); free(map_slot);
+        return -1;
+    }
+
+    // Destabilizers stay at the bottom, stabilizers move up to the new @cap
+    for (size_t j = 0; j < t->n; j++) {
+        memcpy(x + j * words, STAB_COL(t, t->x, j), half_old * sizeof(*x));
+        memcpy(x + j * words + cap / 64, STAB_COL(t, t->x, j) + half_old, half_old * sizeof(*x));
+        memcpy(z + j * words, STAB_COL(t, t->z, j), half_old * sizeof(*z));
+        memcpy(z + j * words + cap / 64, STAB_COL(t, t->z, j) + half_old, half_old * sizeof(*z));
+    }
+    if (t->cap) {
+        memcpy(r, t->r, half_old * sizeof(*r));
+        memcpy(r + cap / 64, t->r + half_old, half_old * sizeof(*r));
+    }
+
+    free(t->x); free(t->z); free(t->r); free(t->map_key); free(t->map_slot);
+    t->x = x;
+    t->z = z;
+    t->r = r;
+    t->cap = cap;
+    t->words = words;
+    t->map_key = map_key;
+    t->map_slot = map_slot;
+    t->map_cap = 2 * cap;
+    for (size_t j = 0; j < t->n; j++)
+        *stab_map_find(t, t->ids[j]) = j + 1;
+    return 0;
+}
+
+/**
+ * stab_slot - Maps a qubit to its column, adding it in |0> if it is new.
+ * @q: Qubit; its ID is the key.
+ *
+ * A new qubit j gets destabilizer X_j and stabilizer +Z_j.
+ *
+ * Returns the column, or -1 if @q is NULL or memory runs out.
+ */
+static long stab_slot(const nymya_qubit* q) {
+    stab_tableau* t = &stab;
+    size_t* s;
+    size_t j;
+
+    if (!q) return -1;
+    if (t->map_cap) {
+        s = stab_map_find(t, q->id);
+        if (*s) return (long)(*s - 1);
+    }
+    if (t->n == t->cap && stab_grow(t)) return -1;
+
+    j = t->n++;
+    t->ids[j] = q->id;
+    *stab_map_find(t, q->id) = j + 1;
+    STAB_FLIP(STAB_COL(t, t->x, j), j);
+    STAB_FLIP(STAB_COL(t, t->z, j), t->cap + j);
+    return (long)j;
+}
+
+static void stab_h(size_t a) {
+    uint64_t* x = STAB_COL(&stab, stab.x, a);
+    uint64_t* z = STAB_COL(&stab, stab.z, a);
+
+    for (size_t w = 0; w < stab.words; w++) {
+        uint64_t t = x[w];
+
+        stab.r[w] ^= x[w] & z[w];
+        x[w] = z[w];
+        z[w] = t;
+    }
+}
+
+static void stab_s(size_t a) {
+    uint64_t* x = STAB_COL(&stab, stab.x, a);
+    uint64_t* z = STAB_COL(&stab, stab.z, a);
+
+    for (size_t w = 0; w < stab.words; w++) {
+        stab.r[w] ^= x[w] & z[w];
+        z[w] ^= x[w];
+    }
+}
+
+// Pauli gates only flip the signs of the rows they anticommute with
+static void stab_pauli(size_t a, int px, int pz) {
+    uint64_t* x = STAB_COL(&stab, stab.x, a);
+    uint64_t* z = STAB_COL(&stab, stab.z, a);
+
+    for (size_t w = 0; w < stab.words; w++)
+        stab.r[w] ^= (px ? z[w] : 0) ^ (pz ? x[w] : 0);
+}
+
+static void stab_cnot(size_t a, size_t b) {
+    uint64_t* xa = STAB_COL(&stab, stab.x, a);
+    uint64_t* za = STAB_COL(&stab, stab.z, a);
+    uint64_t* xb = STAB_COL(&stab, stab.x, b);
+    uint64_t* zb = STAB_COL(&stab, stab.z, b);
+
+    for (size_t w = 0; w < stab.words; w++) {
+        stab.r[w] ^= xa[w] & zb[w] & ~(xb[w] ^ za[w]);
+        xb[w] ^= xa[w];
+        za[w] ^= zb[w];
+    }
+}
+
+static void stab_cz(size_t a, size_t b) {
+    stab_h(b);
+    stab_cnot(a, b);
+    stab_h(b);
+}
+
+static void stab_swap(size_t a, size_t b) {
+    uint64_t* xa = STAB_COL(&stab, stab.x, a);
+    uint64_t* za = STAB_COL(&stab, stab.z, a);
+    uint64_t* xb = STAB_COL(&stab, stab.x, b);
+    uint64_t* zb = STAB_COL(&stab, stab.z, b);
+
+    for (size_t w = 0; w < stab.words; w++) {
+        uint64_t t = xa[w];
+        xa[w] = xb[w];
+        xb[w] = t;
+        t = za[w];
+        za[w] = zb[w];
+        zb[w] = t;
+    }
+}
+
+// Resolves two distinct qubits; every gate body below works on columns
+static int stab_pair(nymya_qubit* q1, nymya_qubit* q2, size_t* a, size_t* b) {
+    long sa = stab_slot(q1), sb = stab_slot(q2);
+
+    if (sa < 0 || sb < 0 || sa == sb) return -1;
+    *a = (size_t)sa;
+    *b = (size_t)sb;
+    return 0;
+}
+
+static int stab_h_q(nymya_qubit* q) {
+    long a = stab_slot(q);
+
+    if (a < 0) return -1;
+    stab_h((size_t)a);
+    return 0;
+}
+
+static int stab_cnot_q(nymya_qubit* q1, nymya_qubit* q2) {
+    size_t a, b;
+
+    if (stab_pair(q1, q2, &a, &b)) return -1;
+    stab_cnot(a, b);
+    return 0;
+}
+
+// Same H/CNOT sequences as the simulator backend's lattice gates
+static int stab_ring(nymya_qubit** q, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (stab_h_q(q[i])) return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (stab_cnot_q(q[i], q[(i + 1) % n])) return -1;
+    }
+    return 0;
+}
+
+static int stab_triangle(nymya_qubit* a, nymya_qubit* b, nymya_qubit* c) {
+    if (stab_h_q(a) || stab_cnot_q(a, b) || stab_cnot_q(b, c) || stab_cnot_q(c, a)) return -1;
+    return 0;
+}
+
+static int stab_hex_rhombi(nymya_qubit** q) {
+    for (int i = 1; i < 7; i++) {
+        if (stab_h_q(q[i]) || stab_cnot_q(q[0], q[i])) return -1;
+    }
+    for (int i = 1; i < 6; i++) {
+        if (stab_cnot_q(q[i], q[i + 1]) || stab_cnot_q(q[i + 1], q[0])) return -1;
+    }
+    if (stab_cnot_q(q[6], q[1]) || stab_cnot_q(q[1], q[0])) return -1;
+    return 0;
+}
+
+static int stab_e8_group(nymya_qubit** q) {
+    for (int i = 0; i < 8; i++) {
+        if (stab_h_q(q[i])) return -1;
+    }
+    for (int i = 0; i < 8; i++) {
+        for (int j = i + 1; j < 8; j++) {
+            if (stab_cnot_q(q[i], q[j]) || stab_cnot_q(q[j], q[i])) return -1;
+        }
+    }
+    return 0;
+}
+
+static int stab_flower_of_life(nymya_qubit** q) {
+    for (size_t i = 0; i < 19; i++) {
+        if (stab_h_q(q[i])) return -1;
+    }
+    for (size_t i = 1; i < 19; i++) {
+        if (stab_cnot_q(q[0], q[i])) return -1;
+    }
+    for (size_t j = 1; j <= 6; j++) {
+        if (stab_cnot_q(q[j], q[(j % 6) + 1])) return -1;
+    }
+    for (size_t j = 7; j < 18; j++) {
+        if (stab_cnot_q(q[j], q[j + 1])) return -1;
+    }
+    return stab_cnot_q(q[18], q[7]);
+}
+
+static int stab_metatron_cube(nymya_qubit** q) {
+    for (size_t i = 0; i < 13; i++) {
+        if (stab_h_q(q[i])) return -1;
+    }
+    for (size_t i = 1; i < 13; i++) {
+        if (stab_cnot_q(q[0], q[i])) return -1;
+    }
+    for (size_t i = 1; i <= 6; i++) {
+        if (stab_cnot_q(q[i], q[i + 6])) return -1;
+    }
+    return 0;
+}
+
+// Hadamard on every site, then CNOT on every pair within @cutoff (see sim_positional())
+static int stab_positional(void* sites, size_t stride, size_t q_off, size_t count,
+                           unsigned int dims, double cutoff) {
+    char* base = sites;
+
+    if (!sites || count == 0) return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        if (stab_h_q((nymya_qubit*)(base + i * stride + q_off))) return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const double* ci = (const double*)(base + i * stride);
+
+        for (size_t j = i + 1; j < count; j++) {
+            const double* cj = (const double*)(base + j * stride);
+            double d2 = 0;
+
+            for (unsigned int k = 0; k < dims; k++)
+                d2 += (ci[k] - cj[k]) * (ci[k] - cj[k]);
+            if (d2 <= cutoff * cutoff &&
+                stab_cnot_q((nymya_qubit*)(base + i * stride + q_off),
+                            (nymya_qubit*)(base + j * stride + q_off)))
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static int stab_arr_ok(const stab_arg_q_arr* a, size_t n) {
+    if (!a || !a->qs || a->count < n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!a->qs[i]) return 0;
+    }
+    return 1;
+}
+
+/**
+ * backend_stabilizer_supports - Whether a gate code is a Clifford gate this backend runs.
+ * @gate_code: NYMYA_*_CODE.
+ */
+int backend_stabilizer_supports(int gate_code) {
+    switch (gate_code) {
+        case 3301: case 3302: case 3303: case 3304: case 3305: case 3306: case 3307: case 3308:
+        case 3309: case 3310: case 3311: case 3313: case 3314: case 3334: case 3337: case 3339:
+        case 3341:
+        case 3346: case 3347: case 3348: case 3349: case 3350: case 3351: case 3352: case 3353:
+        case 3354: case 3355: case 3356: case 3357: case 3358: case 3359: case 3360:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int backend_stabilizer_apply_gate(int gate_code, void* args) {
+    size_t a, b;
+    long s;
+
+    if (!args) return -1;
+
+    switch (gate_code) {
+        // Single-qubit gates; a global phase is not tracked
+        case 3301:
+        case 3302: { stab_arg_q* g = args; return stab_slot(g->q) < 0 ? -1 : 0; }
+        case 3303: case 3304: case 3305: {
+            stab_arg_q* g = args;
+            if ((s = stab_slot(g->q)) < 0) return -1;
+            stab_pauli((size_t)s, gate_code != 3305, gate_code != 3303);
+            return 0;
+        }
+        case 3306: {
+            stab_arg_q* g = args;
+            if ((s = stab_slot(g->q)) < 0) return -1;
+            stab_s((size_t)s);
+            return 0;
+        }
+        case 3307: { // sqrt(X) = H S H
+            stab_arg_q* g = args;
+            if ((s = stab_slot(g->q)) < 0) return -1;
+            stab_h((size_t)s);
+            stab_s((size_t)s);
+            stab_h((size_t)s);
+            return 0;
+        }
+        case 3308: { stab_arg_q* g = args; return stab_h_q(g->q); }
+
+        // Two-qubit gates
+        case 3309: { stab_arg_q2* g = args; return stab_cnot_q(g->q1, g->q2); }
+        case 3310: { // acnot = X(c) CNOT X(c)
+            stab_arg_q2* g = args;
+            if (stab_pair(g->q1, g->q2, &a, &b)) return -1;
+            stab_pauli(a, 1, 0);
+            stab_cnot(a, b);
+            stab_pauli(a, 1, 0);
+            return 0;
+        }
+        case 3311: {
+            stab_arg_q2* g = args;
+            if (stab_pair(g->q1, g->q2, &a, &b)) return -1;
+            stab_cz(a, b);
+            return 0;
+        }
+        case 3313: {
+            stab_arg_q2* g = args;
+            if (stab_pair(g->q1, g->q2, &a, &b)) return -1;
+            stab_swap(a, b);
+            return 0;
+        }
+        case 3314: { // iSWAP = (S (x) S) SWAP CZ
+            stab_arg_q2* g = args;
+            if (stab_pair(g->q1, g->q2, &a, &b)) return -1;
+            stab_cz(a, b);
+            stab_swap(a, b);
+            stab_s(a);
+            stab_s(b);
+            return 0;
+        }
+        case 3334: { // core_entangle: H on q1, then CNOT
+            stab_arg_q2* g = args;
+            if (stab_pair(g->q1, g->q2, &a, &b)) return -1;
+            stab_h(a);
+            stab_cnot(a, b);
+            return 0;
+        }
+        case 3337: // fermion_sim: SWAP with a sign on |11>
+        case 3341: { // cz_swap
+            stab_arg_q2* g = args;
+            if (stab_pair(g->q1, g->q2, &a, &b)) return -1;
+            stab_cz(a, b);
+            stab_swap(a, b);
+            return 0;
+        }
+        case 3339: { // magic: H, S on q1, CNOT, H on q1
+            stab_arg_q2* g = args;
+            if (stab_pair(g->q1, g->q2, &a, &b)) return -1;
+            stab_h(a);
+            stab_s(a);
+            stab_cnot(a, b);
+            stab_h(a);
+            return 0;
+        }
+
+        // Lattice & tessellation gates, all H plus CNOT
+        case 3346: { stab_arg_q3* g = args; return stab_triangle(g->q1, g->q2, g->q3); }
+        case 3347: { stab_arg_q_arr* g = args; return stab_arr_ok(g, 6) ? stab_ring(g->qs, 6) : -1; }
+        case 3348: { stab_arg_q_arr* g = args; return stab_arr_ok(g, 7) ? stab_hex_rhombi(g->qs) : -1; }
+        case 3349: {
+            stab_arg_q_arr* g = args;
+            if (!stab_arr_ok(g, 3)) return -1;
+            for (size_t i = 0; i < g->count / 3; i++) {
+                if (stab_triangle(g->qs[3 * i], g->qs[3 * i + 1], g->qs[3 * i + 2])) return -1;
+            }
+            return 0;
+        }
+        case 3350: {
+            stab_arg_q_arr* g = args;
+            if (!stab_arr_ok(g, 6)) return -1;
+            for (size_t i = 0; i < g->count / 6; i++) {
+                if (stab_ring(g->qs + 6 * i, 6)) return -1;
+            }
+            return 0;
+        }
+        case 3351: {
+            stab_arg_q_arr* g = args;
+            if (!stab_arr_ok(g, 7)) return -1;
+            for (size_t i = 0; i < g->count / 7; i++) {
+                if (stab_hex_rhombi(g->qs + 7 * i)) return -1;
+            }
+            return 0;
+        }
+        case 3352: { stab_arg_q_arr* g = args; return stab_arr_ok(g, 8) ? stab_e8_group(g->qs) : -1; }
+        case 3353: { stab_arg_q_arr* g = args; return stab_arr_ok(g, 19) ? stab_flower_of_life(g->qs) : -1; }
+        case 3354: { stab_arg_q_arr* g = args; return stab_arr_ok(g, 13) ? stab_metatron_cube(g->qs) : -1; }
+        case 3355: case 3356: case 3357: {
+            stab_arg_q3d* g = args;
+            return stab_positional(g->qs, sizeof(nymya_qpos3d), offsetof(nymya_qpos3d, q),
+                                   g->count, 3, gate_code == 3357 ? 1.00 : 1.01);
+        }
+        case 3358: {
+            stab_arg_q4d* g = args;
+            return stab_positional(g->qs, sizeof(nymya_qpos4d), offsetof(nymya_qpos4d, q),
+                                   g->count, 4, 1.01);
+        }
+        case 3359: case 3360: {
+            stab_arg_q5d* g = args;
+            return stab_positional(g->qs, sizeof(nymya_qpos5d), offsetof(nymya_qpos5d, q),
+                                   g->count, 5, gate_code == 3359 ? 1.00 : 1.05);
+        }
+
+        default:
+            fprintf(stderr, "[stabilizer backend] Gate %d is not a supported Clifford gate\n", gate_code);
+            return -1;
+    }
+}
+
+// Phase exponent (mod 4) picked up when multiplying Pauli (x1,z1) into (x2,z2)
+static int stab_g(int x1, int z1, int x2, int z2) {
+    if (!x1 && !z1) return 0;
+    if (x1 && z1) return z2 - x2;
+    if (x1) return z2 * (2 * x2 - 1);
+    return x2 * (1 - 2 * z2);
+}
+
+/**
+ * backend_stabilizer_prob_one - Probability of measuring a qubit as |1>.
+ * @q: Qubit, looked up by ID.
+ * @p: Receives 0, 0.5 or 1.
+ *
+ * The outcome is random exactly when some stabilizer has an X or Y on the
+ * qubit. Otherwise the stabilizers whose destabilizer partners anticommute
+ * with Z on the qubit multiply to +-Z, whose sign is the outcome (CHP's
+ * deterministic measurement, without collapsing the state).
+ *
+ * Returns 0 on success, -1 if @q has never been used by a gate.
+ */
+int backend_stabilizer_prob_one(const nymya_qubit* q, double* p) {
+    stab_tableau* t = &stab;
+    const uint64_t* xa;
+    unsigned char *sx, *sz;
+    size_t* s;
+    size_t a;
+    int sr = 0;
+
+    if (!q || !p || !t->map_cap) return -1;
+    s = stab_map_find(t, q->id);
+    if (!*s) return -1;
+    a = *s - 1;
+    xa = STAB_COL(t, t->x, a);
+
+    for (size_t i = 0; i < t->n; i++) {
+        if (STAB_GET(xa, t->cap + i)) {
+            *p = 0.5;
+            return 0;
+        }
+    }
+
+    sx = calloc(t->n, 1);
+    sz = calloc(t->n, 1);
+    if (!sx || !sz) {
+        free(sx);
+        free(sz);
+        return -1;
+    }
+    for (size_t i = 0; i < t->n; i++) {
+        size_t row = t->cap + i;
+        int sum;
+
+        if (!STAB_GET(xa, i)) continue;
+        sum = 2 * sr + 2 * (int)STAB_GET(t->r, row);
+        for (size_t j = 0; j < t->n; j++) {
+            int x = (int)STAB_GET(STAB_COL(t, t->x, j), row);
+            int z = (int)STAB_GET(STAB_COL(t, t->z, j), row);
+
+            sum += stab_g(x, z, sx[j], sz[j]);
+            sx[j] ^= x;
+            sz[j] ^= z;
+        }
+        sr = ((sum % 4) + 4) % 4 != 0;
+    }
+    free(sx);
+    free(sz);
+
+    *p = sr ? 1.0 : 0.0;
+    return 0;
+}
+
+/**
+ * backend_stabilizer_num_qubits - Number of qubits in the tableau.
+ */
+size_t backend_stabilizer_num_qubits(void) {
+    return stab.n;
+}
+
+/**
+ * backend_stabilizer_reset - Discards the tableau; the next gate starts a new one.
+ */
+void backend_stabilizer_reset(void) {
+    free(stab.x);
+    free(stab.z);
+    free(stab.r);
+    free(stab.ids);
+    free(stab.map_key);
+    free(stab.map_slot);
+    memset(&stab, 0, sizeof(stab));
+}
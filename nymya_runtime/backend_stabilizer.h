@@ -0,0 +1,17 @@
+#ifndef NYMYA_BACKEND_STABILIZER_H
+#define NYMYA_BACKEND_STABILIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+
+// Core gate executor for the Clifford stabilizer backend
+int backend_stabilizer_apply_gate(int gate_code, void* args);
+int backend_stabilizer_supports(int gate_code);
+
+// Tableau queries; qubits are looked up by ID
+int backend_stabilizer_prob_one(const nymya_qubit* q, double* p);
+size_t backend_stabilizer_num_qubits(void);
+void backend_stabilizer_reset(void);
+
+#endif // NYMYA_BACKEND_STABILIZER_H
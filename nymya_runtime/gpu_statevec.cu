@@ -0,0 +1,339 @@
+// gpu_statevec.cu - State vector resident in device memory.
+//
+// A batch of fused gates goes to the device as one transfer (gate table and
+// matrices packed together) and runs as one cooperative kernel launch: every
+// thread of a persistent grid walks the batch and the grid synchronises between
+// gates. Devices without cooperative launch get one kernel per gate on the same
+// stream, still without a host round trip. Only probabilities come back.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cuda_runtime.h>
+#include <cooperative_groups.h>
+#include "gpu_statevec.h"
+
+namespace cg = cooperative_groups;
+
+#define GPU_BLOCK 256
+
+struct gpu_sv {
+    double2* amp;
+    unsigned int n;
+    cudaStream_t stream;
+    int coop;           // cooperative launch supported
+    int coop_blocks;    // co-resident blocks of the batch kernel
+    void* stage;        // pinned host copy of the current batch
+    void* batch;        // device copy of the current batch
+    size_t batch_cap;
+    double* sum;        // device accumulator for reductions
+};
+
+static int gpu_check(cudaError_t err, const char* what) {
+    if (err == cudaSuccess) return 0;
+    fprintf(stderr, "[gpu backend] %s: %s\n", what, cudaGetErrorString(err));
+    return -1;
+}
+
+/**
+ * gpu_rows - Applies a k-qubit matrix to a slice of the amplitude groups.
+ * @amp: State vector.
+ * @groups: Number of groups, 2^(n-K).
+ * @g: Gate.
+ * @m: Matrix, row-major.
+ * @first: First group handled by this thread.
+ * @stride: Group stride between threads.
+ */
+template <unsigned int K>
+static __device__ void gpu_rows(double2* amp, size_t groups, const gpu_gate& g,
+                                const double2* m, size_t first, size_t stride) {
+    const unsigned int dim = 1u << K;
+    unsigned int lo[K];
+    size_t off[dim];
+
+    for (unsigned int i = 0; i < K; i++) lo[i] = g.t[i];
+    for (unsigned int i = 1; i < K; i++) {
+        for (unsigned int j = i; j > 0 && lo[j - 1] > lo[j]; j--) {
+            unsigned int x = lo[j];
+
+            lo[j] = lo[j - 1];
+            lo[j - 1] = x;
+        }
+    }
+#pragma unroll
+    for (unsigned int s = 0; s < dim; s++) {
+        off[s] = 0;
+#pragma unroll
+        for (unsigned int i = 0; i < K; i++) {
+            if ((s >> (K - 1 - i)) & 1) off[s] |= (size_t)1 << g.t[i];
+        }
+    }
+
+    for (size_t x = first; x < groups; x += stride) {
+        size_t base = x;
+        double2 v[dim];
+
+#pragma unroll
+        for (unsigned int i = 0; i < K; i++)
+            base = ((base >> lo[i]) << (lo[i] + 1)) | (base & (((size_t)1 << lo[i]) - 1));
+#pragma unroll
+        for (unsigned int s = 0; s < dim; s++) v[s] = amp[base + off[s]];
+#pragma unroll
+        for (unsigned int r = 0; r < dim; r++) {
+            double2 acc = make_double2(0.0, 0.0);
+
+#pragma unroll
+            for (unsigned int s = 0; s < dim; s++) {
+                const double2 a = m[r * dim + s];
+
+                acc.x += a.x * v[s].x - a.y * v[s].y;
+                acc.y += a.x * v[s].y + a.y * v[s].x;
+            }
+            amp[base + off[r]] = acc;
+        }
+    }
+}
+
+static __device__ void gpu_gate_run(double2* amp, unsigned int n, const gpu_gate& g,
+                                    const double2* m, size_t first, size_t stride) {
+    size_t groups = ((size_t)1 << n) >> g.k;
+
+    switch (g.k) {
+        case 1: gpu_rows<1>(amp, groups, g, m, first, stride); break;
+        case 2: gpu_rows<2>(amp, groups, g, m, first, stride); break;
+        case 3: gpu_rows<3>(amp, groups, g, m, first, stride); break;
+    }
+}
+
+// Stages the gate's matrix in shared memory; the caller syncs afterwards
+static __device__ void gpu_load_matrix(double2* sm, const gpu_gate& g, const double2* mats) {
+    unsigned int e = 1u << (2 * g.k);
+
+    for (unsigned int j = threadIdx.x; j < e; j += blockDim.x) sm[j] = mats[g.m + j];
+}
+
+static __global__ void gpu_batch_kernel(double2* amp, unsigned int n, const gpu_gate* gates,
+                                        size_t count, const double2* mats) {
+    __shared__ double2 sm[64];
+    cg::grid_group grid = cg::this_grid();
+    size_t first = (size_t)blockIdx.x * blockDim.x + threadIdx.x;
+    size_t stride = (size_t)gridDim.x * blockDim.x;
+
+    for (size_t i = 0; i < count; i++) {
+        const gpu_gate g = gates[i];
+
+        gpu_load_matrix(sm, g, mats);
+        __syncthreads();
+        gpu_gate_run(amp, n, g, sm, first, stride);
+        // Also keeps every block's shared matrix alive until all are done
+        grid.sync();
+    }
+}
+
+static __global__ void gpu_gate_kernel(double2* amp, unsigned int n, const gpu_gate* gates,
+                                       size_t i, const double2* mats) {
+    __shared__ double2 sm[64];
+    const gpu_gate g = gates[i];
+
+    gpu_load_matrix(sm, g, mats);
+    __syncthreads();
+    gpu_gate_run(amp, n, g, sm, (size_t)blockIdx.x * blockDim.x + threadIdx.x,
+                 (size_t)gridDim.x * blockDim.x);
+}
+
+static __global__ void gpu_prob_kernel(const double2* amp, size_t dim, unsigned int t, double* out) {
+    __shared__ double part[GPU_BLOCK];
+    double s = 0;
+
+    for (size_t i = (size_t)blockIdx.x * blockDim.x + threadIdx.x; i < dim;
+         i += (size_t)gridDim.x * blockDim.x) {
+        if ((i >> t) & 1) s += amp[i].x * amp[i].x + amp[i].y * amp[i].y;
+    }
+    part[threadIdx.x] = s;
+    __syncthreads();
+    for (unsigned int w = GPU_BLOCK / 2; w > 0; w >>= 1) {
+        if (threadIdx.x < w) part[threadIdx.x] += part[threadIdx.x + w];
+        __syncthreads();
+    }
+    if (threadIdx.x == 0) atomicAdd(out, part[0]);
+}
+
+// Blocks for @work independent items, capped at what the batch kernel can
+// keep co-resident
+static unsigned int gpu_blocks(const gpu_sv* sv, size_t work) {
+    size_t b = (work + GPU_BLOCK - 1) / GPU_BLOCK;
+    size_t cap = sv->coop_blocks > 0 ? (size_t)sv->coop_blocks : 65535;
+
+    if (b > cap) b = cap;
+    return b ? (unsigned int)b : 1;
+}
+
+/**
+ * gpu_sv_new - Allocates an empty register on the current device.
+ *
+ * Returns the register, or NULL if there is no usable device or memory.
+ */
+extern "C" gpu_sv* gpu_sv_new(void) {
+    const double2 one = make_double2(1.0, 0.0);
+    gpu_sv* sv = (gpu_sv*)calloc(1, sizeof(*sv));
+    int dev, sms = 0, per_sm = 0;
+
+    if (!sv) return NULL;
+    if (gpu_check(cudaGetDevice(&dev), "No CUDA device") ||
+        gpu_check(cudaStreamCreateWithFlags(&sv->stream, cudaStreamNonBlocking), "Stream") ||
+        gpu_check(cudaMalloc((void**)&sv->amp, sizeof(double2)), "Register") ||
+        gpu_check(cudaMalloc((void**)&sv->sum, sizeof(double)), "Register") ||
+        gpu_check(cudaMemcpy(sv->amp, &one, sizeof(one), cudaMemcpyHostToDevice), "Register")) {
+        gpu_sv_free(sv);
+        return NULL;
+    }
+
+    cudaDeviceGetAttribute(&sv->coop, cudaDevAttrCooperativeLaunch, dev);
+    cudaDeviceGetAttribute(&sms, cudaDevAttrMultiProcessorCount, dev);
+    if (sv->coop &&
+        cudaOccupancyMaxActiveBlocksPerMultiprocessor(&per_sm, gpu_batch_kernel, GPU_BLOCK, 0) == cudaSuccess &&
+        per_sm > 0)
+        sv->coop_blocks = per_sm * sms;
+    else
+        sv->coop = 0;
+    return sv;
+}
+
+/**
+ * gpu_sv_free - Releases a register and its batch buffers.
+ * @sv: Register, or NULL.
+ */
+extern "C" void gpu_sv_free(gpu_sv* sv) {
+    if (!sv) return;
+    if (sv->stream) cudaStreamSynchronize(sv->stream);
+    cudaFree(sv->amp);
+    cudaFree(sv->sum);
+    cudaFree(sv->batch);
+    cudaFreeHost(sv->stage);
+    if (sv->stream) cudaStreamDestroy(sv->stream);
+    free(sv);
+}
+
+extern "C" unsigned int gpu_sv_qubits(const gpu_sv* sv) {
+    return sv->n;
+}
+
+/**
+ * gpu_sv_grow - Adds qubits in |0> above the current ones.
+ * @sv: Register.
+ * @n: New qubit count.
+ *
+ * The old amplitudes become the low half (quarter, ...) of the new vector,
+ * which is all that tensoring with |0> on the new high bits amounts to.
+ *
+ * Returns 0 on success, -1 if @n is too large or device memory runs out.
+ */
+extern "C" int gpu_sv_grow(gpu_sv* sv, unsigned int n) {
+    size_t old_dim = (size_t)1 << sv->n, dim;
+    double2* amp;
+
+    if (n <= sv->n) return 0;
+    if (n > GPU_SV_MAX_QUBITS) {
+        fprintf(stderr, "[gpu backend] Register full (%d qubits)\n", GPU_SV_MAX_QUBITS);
+        return -1;
+    }
+    dim = (size_t)1 << n;
+    if (gpu_check(cudaMalloc((void**)&amp, dim * sizeof(*amp)), "Growing the register"))
+        return -1;
+    if (gpu_check(cudaMemcpyAsync(amp, sv->amp, old_dim * sizeof(*amp), cudaMemcpyDeviceToDevice,
+                                  sv->stream), "Growing the register") ||
+        gpu_check(cudaMemsetAsync(amp + old_dim, 0, (dim - old_dim) * sizeof(*amp), sv->stream),
+                  "Growing the register") ||
+        gpu_check(cudaStreamSynchronize(sv->stream), "Growing the register")) {
+        cudaFree(amp);
+        return -1;
+    }
+    cudaFree(sv->amp);
+    sv->amp = amp;
+    sv->n = n;
+    return 0;
+}
+
+/**
+ * gpu_sv_run - Queues a batch of fused gates on the device.
+ * @sv: Register; every target must be below its qubit count.
+ * @gates: Gates in order.
+ * @count: Number of gates.
+ * @mats: Matrices the gates point into.
+ * @nmats: Complex entries in @mats.
+ *
+ * Returns as soon as the batch is queued; the previous batch is waited for
+ * only because its staging buffer is reused.
+ *
+ * Returns 0 on success, -1 on a device error.
+ */
+extern "C" int gpu_sv_run(gpu_sv* sv, const gpu_gate* gates, size_t count,
+                          const double* mats, size_t nmats) {
+    size_t gbytes = (count * sizeof(*gates) + 15) & ~(size_t)15;
+    size_t bytes = gbytes + nmats * sizeof(double2);
+    const gpu_gate* d_gates;
+    const double2* d_mats;
+
+    if (!count) return 0;
+    if (gpu_check(cudaStreamSynchronize(sv->stream), "Previous batch")) return -1;
+
+    if (bytes > sv->batch_cap) {
+        size_t cap = sv->batch_cap ? sv->batch_cap : 64 * 1024;
+
+        while (cap < bytes) cap *= 2;
+        cudaFree(sv->batch);
+        cudaFreeHost(sv->stage);
+        sv->batch = sv->stage = NULL;
+        sv->batch_cap = 0;
+        if (gpu_check(cudaMalloc(&sv->batch, cap), "Batch buffer") ||
+            gpu_check(cudaMallocHost(&sv->stage, cap), "Batch buffer"))
+            return -1;
+        sv->batch_cap = cap;
+    }
+    memcpy(sv->stage, gates, count * sizeof(*gates));
+    memcpy((char*)sv->stage + gbytes, mats, nmats * sizeof(double2));
+    if (gpu_check(cudaMemcpyAsync(sv->batch, sv->stage, bytes, cudaMemcpyHostToDevice, sv->stream),
+                  "Uploading the batch"))
+        return -1;
+
+    d_gates = (const gpu_gate*)sv->batch;
+    d_mats = (const double2*)((char*)sv->batch + gbytes);
+    if (sv->coop) {
+        unsigned int blocks = gpu_blocks(sv, ((size_t)1 << sv->n) >> 1);
+        void* args[] = { &sv->amp, &sv->n, &d_gates, &count, &d_mats };
+
+        return gpu_check(cudaLaunchCooperativeKernel((void*)gpu_batch_kernel, blocks, GPU_BLOCK,
+                                                     args, 0, sv->stream), "Batch kernel");
+    }
+    for (size_t i = 0; i < count; i++) {
+        unsigned int blocks = gpu_blocks(sv, ((size_t)1 << sv->n) >> gates[i].k);
+
+        gpu_gate_kernel<<<blocks, GPU_BLOCK, 0, sv->stream>>>(sv->amp, sv->n, d_gates, i, d_mats);
+    }
+    return gpu_check(cudaGetLastError(), "Gate kernel");
+}
+
+/**
+ * gpu_sv_prob_one - Probability of measuring register bit @t as 1.
+ * @sv: Register.
+ * @t: Bit.
+ * @p: Receives the probability.
+ *
+ * Waits for queued batches; only the reduced sum crosses the bus.
+ *
+ * Returns 0 on success, -1 on a bad bit or a device error.
+ */
+extern "C" int gpu_sv_prob_one(gpu_sv* sv, unsigned int t, double* p) {
+    size_t dim = (size_t)1 << sv->n;
+
+    if (t >= sv->n) return -1;
+    if (gpu_check(cudaMemsetAsync(sv->sum, 0, sizeof(double), sv->stream), "Reduction"))
+        return -1;
+    gpu_prob_kernel<<<gpu_blocks(sv, dim), GPU_BLOCK, 0, sv->stream>>>(sv->amp, dim, t, sv->sum);
+    if (gpu_check(cudaGetLastError(), "Reduction") ||
+        gpu_check(cudaMemcpyAsync(p, sv->sum, sizeof(double), cudaMemcpyDeviceToHost, sv->stream),
+                  "Reduction") ||
+        gpu_check(cudaStreamSynchronize(sv->stream), "Reduction"))
+        return -1;
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef NYMYA_GPU_STATEVEC_H
+#define NYMYA_GPU_STATEVEC_H
+
+// Device-resident state vector. Plain C so that both the host side of the
+// backend and the CUDA translation unit can include it.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPU_SV_MAX_QUBITS 32
+
+/**
+ * gpu_gate - One fused gate of a batch.
+ * @k: Number of targets (1 to 3).
+ * @t: Register bit of each target; t[0] is the high bit of the matrix index.
+ * @m: Offset of the row-major 2^k x 2^k matrix in the batch's matrix array,
+ *     in complex entries.
+ */
+typedef struct gpu_gate {
+    uint32_t k;
+    uint32_t t[3];
+    uint64_t m;
+} gpu_gate;
+
+typedef struct gpu_sv gpu_sv;
+
+gpu_sv* gpu_sv_new(void);
+void gpu_sv_free(gpu_sv* sv);
+unsigned int gpu_sv_qubits(const gpu_sv* sv);
+int gpu_sv_grow(gpu_sv* sv, unsigned int n);
+
+// @mats holds @nmats complex entries as interleaved re/im doubles
+int gpu_sv_run(gpu_sv* sv, const gpu_gate* gates, size_t count,
+               const double* mats, size_t nmats);
+int gpu_sv_prob_one(gpu_sv* sv, unsigned int t, double* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NYMYA_GPU_STATEVEC_H
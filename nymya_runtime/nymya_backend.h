@@ -0,0 +1,48 @@
+#ifndef NYMYA_BACKEND_H
+#define NYMYA_BACKEND_H
+
+// Interface between the runtime and its backends. Built-in backends are
+// registered by the runtime itself; out-of-tree ones are shared objects that
+// nymya_set_backend() loads by name (see NYMYA_BACKEND_ENTRY).
+
+#include <nymya/nymya.h>
+
+// Gate tables below are indexed by gate_code - NYMYA_GATE_FIRST (nymya.h)
+
+// Runs one gate; the same arguments as nymya_apply_gate()
+typedef int (*nymya_gate_fn)(int gate_code, void* args);
+
+/**
+ * nymya_backend - A backend as the runtime sees it.
+ * @name: Name selected with nymya_set_backend().
+ * @label: Used in runtime messages, e.g. "simulator".
+ * @apply_gate: Runs any gate code; receives every gate without an entry in @gates.
+ * @gates: Optional direct entry per gate, indexed by gate_code - NYMYA_GATE_FIRST.
+ * @prob_one: Probability of |1> for a qubit, or NULL if the state is not readable.
+ * @reset: Discards all state, or NULL.
+ * @flush: Completes work @apply_gate queued, at the end of a circuit run and
+ *         before the thread leaves the backend, or NULL.
+ *
+ * The runtime resolves @gates against @apply_gate once at registration, so
+ * a gate call costs a single indirect call either way.
+ */
+typedef struct nymya_backend {
+    const char* name;
+    const char* label;
+    nymya_gate_fn apply_gate;
+    nymya_gate_fn gates[NYMYA_GATE_COUNT];
+    int (*prob_one)(const nymya_qubit* q, double* p);
+    void (*reset)(void);
+    int (*flush)(void);
+} nymya_backend;
+
+// Adds a backend; @b must stay valid for the life of the process
+int nymya_register_backend(const nymya_backend* b);
+
+// nymya_set_backend("foo") for an unregistered name loads libnymya-backend-foo.so
+// (or the path itself, if the name contains a '/') and calls this symbol,
+// which returns the backend to register.
+#define NYMYA_BACKEND_ENTRY "nymya_backend_entry"
+typedef const nymya_backend* (*nymya_backend_entry_fn)(void);
+
+#endif // NYMYA_BACKEND_H
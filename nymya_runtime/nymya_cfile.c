@@ -0,0 +1,193 @@
+// runtime/nymya_cfile.c
+//
+// Binary circuit files (format in nymya_cfile.h). nymya_circuit_save()
+// writes a recorded circuit through the same serializer as QPU jobs;
+// nymya_cfile_open() maps a file read-only and uses its records in place, so
+// opening a circuit of millions of gates costs a validation of the header.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "nymya_runtime.h"
+#include "nymya_circuit.h"
+#include "nymya_cfile.h"
+#include "backend_gateqpu.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "circuit files are mapped in place and need a little-endian host"
+#endif
+
+/**
+ * nymya_cfile - A mapped circuit file.
+ * @map: Read-only mapping of the whole file.
+ * @len: Length of the mapping.
+ * @ops: Gate records inside @map.
+ * @nops: Number of records.
+ * @ids: Qubit ID table inside @map.
+ * @qubits: One qubit per ID, which the records run on.
+ * @nqubits: Entries of @ids and @qubits.
+ * @checked: Set once every record passed backend_gateqpu_check_ops().
+ */
+struct nymya_cfile {
+    void* map;
+    size_t len;
+    const nymya_op* ops;
+    size_t nops;
+    const uint64_t* ids;
+    nymya_qubit* qubits;
+    size_t nqubits;
+    int checked;
+};
+
+/**
+ * nymya_circuit_save - Writes a circuit to a binary circuit file.
+ * @c: Sealed circuit; its parameters, if any, must be bound.
+ * @path: File to create or replace.
+ *
+ * Returns 0 on success, -1 if the circuit has a gate without fixed qubit
+ * operands or the file cannot be written.
+ */
+int nymya_circuit_save(const nymya_circuit* c, const char* path) {
+    nymya_cfile_header h = { 0 };
+    nymya_qpu_request req;
+    FILE* f;
+    int ret = -1;
+
+    if (!c || !path || nymya_circuit_unbound(c)) return -1;
+    if (backend_gateqpu_lower(c, &req)) return -1;
+
+    h.magic = NYMYA_CFILE_MAGIC;
+    h.version = NYMYA_CFILE_VERSION;
+    h.header_size = sizeof(h);
+    h.op_size = sizeof(nymya_op);
+    h.nqubits = req.nqubits;
+    h.nops = req.nops;
+    h.ids_offset = sizeof(h);
+    h.ops_offset = h.ids_offset + req.nqubits * sizeof(uint64_t);
+
+    f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "[nymya_runtime] Cannot create circuit file %s.\n", path);
+    } else {
+        if (fwrite(&h, sizeof(h), 1, f) == 1 &&
+            fwrite(req.ids, sizeof(uint64_t), req.nqubits, f) == req.nqubits &&
+            fwrite(req.ops, sizeof(nymya_op), req.nops, f) == req.nops)
+            ret = 0;
+        if (fclose(f)) ret = -1;
+        if (ret) fprintf(stderr, "[nymya_runtime] Failed to write circuit file %s.\n", path);
+    }
+    free(req.ops);
+    free(req.ids);
+    return ret;
+}
+
+// Table of @count @size-byte entries at @off lies inside a file of @len bytes, aligned
+static int cfile_table_ok(uint64_t off, uint64_t count, size_t size, size_t len) {
+    return off % 8 == 0 && off <= len && count <= (len - off) / size;
+}
+
+/**
+ * nymya_cfile_open - Maps a binary circuit file.
+ * @path: File written by nymya_circuit_save() or another writer of the format.
+ *
+ * Only the header is checked here; records are checked as they run.
+ *
+ * Returns the file, or NULL if it cannot be read or is not a circuit file
+ * of a known version.
+ */
+nymya_cfile* nymya_cfile_open(const char* path) {
+    const nymya_cfile_header* h;
+    nymya_cfile* f;
+    struct stat st;
+    int fd;
+
+    if (!path) return NULL;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) || (size_t)st.st_size < sizeof(*h)) {
+        fprintf(stderr, "[nymya_runtime] Cannot read circuit file %s.\n", path);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    f = calloc(1, sizeof(*f));
+    if (!f) {
+        close(fd);
+        return NULL;
+    }
+    f->len = (size_t)st.st_size;
+    f->map = mmap(NULL, f->len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (f->map == MAP_FAILED) {
+        free(f);
+        return NULL;
+    }
+
+    h = f->map;
+    if (h->magic != NYMYA_CFILE_MAGIC || h->version != NYMYA_CFILE_VERSION ||
+        h->header_size < sizeof(*h) || h->op_size != sizeof(nymya_op) || h->flags ||
+        !cfile_table_ok(h->ids_offset, h->nqubits, sizeof(uint64_t), f->len) ||
+        !cfile_table_ok(h->ops_offset, h->nops, sizeof(nymya_op), f->len)) {
+        fprintf(stderr, "[nymya_runtime] %s is not a version %d circuit file.\n",
+                path, NYMYA_CFILE_VERSION);
+        nymya_cfile_close(f);
+        return NULL;
+    }
+    f->ids = (const uint64_t*)((const char*)f->map + h->ids_offset);
+    f->ops = (const nymya_op*)((const char*)f->map + h->ops_offset);
+    f->nops = h->nops;
+    f->nqubits = h->nqubits;
+    madvise(f->map, f->len, MADV_SEQUENTIAL);
+
+    f->qubits = calloc(f->nqubits ? f->nqubits : 1, sizeof(*f->qubits));
+    if (!f->qubits) {
+        nymya_cfile_close(f);
+        return NULL;
+    }
+    for (size_t i = 0; i < f->nqubits; i++)
+        f->qubits[i].id = f->ids[i];
+    return f;
+}
+
+void nymya_cfile_close(nymya_cfile* f) {
+    if (!f) return;
+    if (f->map && f->map != MAP_FAILED) munmap(f->map, f->len);
+    free(f->qubits);
+    free(f);
+}
+
+size_t nymya_cfile_size(const nymya_cfile* f) {
+    return f ? f->nops : 0;
+}
+
+nymya_qubit* nymya_cfile_qubits(nymya_cfile* f, size_t* count) {
+    if (!f) return NULL;
+    if (count) *count = f->nqubits;
+    return f->qubits;
+}
+
+int nymya_cfile_run(nymya_cfile* f) {
+    if (!f) return -1;
+    return backend_gateqpu_run_ops(f->ops, f->nops, f->qubits, f->nqubits);
+}
+
+nymya_job* nymya_cfile_submit_async(nymya_cfile* f, unsigned int shots,
+                                    nymya_job_fn done, void* user) {
+    nymya_qpu_request req = { 0 };
+
+    if (!f) return NULL;
+    // Drivers trust the operands, so a submitted file is checked in full once
+    if (!f->checked) {
+        if (backend_gateqpu_check_ops(f->ops, f->nops, f->nqubits)) return NULL;
+        f->checked = 1;
+    }
+    // The device gets the mapped records as they are
+    req.ops = (nymya_op*)f->ops;
+    req.nops = f->nops;
+    req.ids = (uint64_t*)f->ids;
+    req.nqubits = f->nqubits;
+    req.shots = shots;
+    return nymya_job_submit_borrowed(&req, done, user);
+}
@@ -0,0 +1,48 @@
+#ifndef NYMYA_CFILE_H
+#define NYMYA_CFILE_H
+
+// On-disk circuit format. A file is a header, a qubit ID table and an array
+// of fixed-size nymya_op records, laid out so that a read-only mapping of the
+// file is used in place: nothing is decoded or copied on load.
+//
+//     offset 0            nymya_cfile_header
+//     ids_offset          uint64_t ids[nqubits]
+//     ops_offset          nymya_op ops[nops]
+//
+// Integers are little-endian and both tables are 8-byte aligned. Records use
+// the gate codes and operand rules of nymya_3362_submit(): operands index
+// ids[], and param is the gate's theta in Q32.32 radians, so only gates with
+// fixed qubit operands can be stored. Files name their version; a reader
+// rejects a version it does not know.
+
+#include <stdint.h>
+#include <nymya/nymya.h>
+
+#define NYMYA_CFILE_MAGIC   0x434D594Eu // "NYMC"
+#define NYMYA_CFILE_VERSION 1
+
+/**
+ * nymya_cfile_header - First bytes of a circuit file.
+ * @magic: NYMYA_CFILE_MAGIC.
+ * @version: NYMYA_CFILE_VERSION.
+ * @header_size: sizeof(nymya_cfile_header) of the writer.
+ * @op_size: sizeof(nymya_op) of the writer.
+ * @flags: Must be zero.
+ * @nqubits: Entries of the qubit ID table.
+ * @nops: Gate records.
+ * @ids_offset: File offset of the ID table.
+ * @ops_offset: File offset of the records.
+ */
+typedef struct nymya_cfile_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t op_size;
+    uint32_t flags;
+    uint64_t nqubits;
+    uint64_t nops;
+    uint64_t ids_offset;
+    uint64_t ops_offset;
+} nymya_cfile_header;
+
+#endif // NYMYA_CFILE_H
@@ -0,0 +1,569 @@
+// nymya_circuit.c
+//
+// Deferred-execution circuit IR. Between nymya_circuit_begin() and
+// nymya_circuit_end(), nymya_apply_gate() copies each call into a node instead
+// of running it. Each node records which earlier nodes last touched its qubits,
+// which makes the recording a dependency DAG that later passes can reorder,
+// fuse or batch. nymya_circuit_replay() runs the nodes one by one on the
+// active backend; nymya_circuit_run() may run a cached compiled form instead.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <nymya/nymya.h>
+#include "nymya_circuit.h"
+#include "nymya_gates.h"
+
+// Argument structs
+typedef nymya_arg_q circ_arg_q;
+typedef nymya_arg_q_theta circ_arg_q_theta;
+typedef nymya_arg_q_axis_theta circ_arg_q_axis_theta;
+typedef nymya_arg_q2 circ_arg_q2;
+typedef nymya_arg_q2_theta circ_arg_q2_theta;
+typedef nymya_arg_q3 circ_arg_q3;
+typedef nymya_arg_q_arr circ_arg_q_arr;
+typedef nymya_arg_q3d circ_arg_q3d;
+typedef nymya_arg_q4d circ_arg_q4d;
+typedef nymya_arg_q5d circ_arg_q5d;
+typedef nymya_arg_qrng circ_arg_qrng;
+
+typedef enum {
+    CIRC_ARG_NONE,
+    CIRC_ARG_Q,
+    CIRC_ARG_Q_THETA,
+    CIRC_ARG_Q_AXIS_THETA,
+    CIRC_ARG_Q2,
+    CIRC_ARG_Q2_THETA,
+    CIRC_ARG_Q3,
+    CIRC_ARG_Q_ARR,
+    CIRC_ARG_Q3D,
+    CIRC_ARG_Q4D,
+    CIRC_ARG_Q5D,
+    CIRC_ARG_QRNG
+} circ_arg_kind;
+
+// Deutsch records its three qubit pointers; the oracle is not an argument
+#define CIRC_ARG_DEUTSCH CIRC_ARG_Q3
+#define CIRC_KIND_OF(name, code, args) [(code) - NYMYA_GATE_FIRST] = CIRC_ARG_##args,
+static const unsigned char circ_arg_kinds[NYMYA_GATE_COUNT] = {
+    NYMYA_GATE_LIST(CIRC_KIND_OF)
+};
+
+// Argument layout of a gate code, as the backends read it
+static circ_arg_kind circ_arg_kind_of(int gate_code) {
+    unsigned int i = (unsigned int)(gate_code - NYMYA_GATE_FIRST);
+
+    return i < NYMYA_GATE_COUNT ? (circ_arg_kind)circ_arg_kinds[i] : CIRC_ARG_NONE;
+}
+
+static size_t circ_arg_size(circ_arg_kind kind) {
+    switch (kind) {
+        case CIRC_ARG_Q:            return sizeof(circ_arg_q);
+        case CIRC_ARG_Q_THETA:      return sizeof(circ_arg_q_theta);
+        case CIRC_ARG_Q_AXIS_THETA: return sizeof(circ_arg_q_axis_theta);
+        case CIRC_ARG_Q2:           return sizeof(circ_arg_q2);
+        case CIRC_ARG_Q2_THETA:     return sizeof(circ_arg_q2_theta);
+        case CIRC_ARG_Q3:           return sizeof(circ_arg_q3);
+        case CIRC_ARG_Q_ARR:        return sizeof(circ_arg_q_arr);
+        case CIRC_ARG_Q3D:          return sizeof(circ_arg_q3d);
+        case CIRC_ARG_Q4D:          return sizeof(circ_arg_q4d);
+        case CIRC_ARG_Q5D:          return sizeof(circ_arg_q5d);
+        case CIRC_ARG_QRNG:         return sizeof(circ_arg_qrng);
+        default:                    return 0;
+    }
+}
+
+// A parameter reference travels through a gate's theta as a quiet NaN whose
+// payload carries this tag above the parameter index
+#define CIRC_PARAM_TAG  0x7FFCD00000000000ull
+#define CIRC_PARAM_MASK 0xFFFFFFFF00000000ull
+
+// Highest parameter index a circuit accepts
+#define CIRC_PARAM_MAX  ((1u << 24) - 1)
+
+/**
+ * nymya_param - Placeholder theta that makes a recorded gate parametric.
+ * @index: Parameter index; the gate takes params[@index] of each binding.
+ *
+ * Only meaningful while recording; a gate run directly would see a NaN.
+ */
+double nymya_param(unsigned int index) {
+    uint64_t bits = CIRC_PARAM_TAG | index;
+    double theta;
+
+    memcpy(&theta, &bits, sizeof(theta));
+    return theta;
+}
+
+// Offset of theta in the argument struct, or 0 if the layout has none
+static size_t circ_theta_offset(circ_arg_kind kind) {
+    switch (kind) {
+        case CIRC_ARG_Q_THETA:      return offsetof(circ_arg_q_theta, theta);
+        case CIRC_ARG_Q_AXIS_THETA: return offsetof(circ_arg_q_axis_theta, theta);
+        case CIRC_ARG_Q2_THETA:     return offsetof(circ_arg_q2_theta, theta);
+        default:                    return 0;
+    }
+}
+
+// Parameter referenced by a recorded theta, plus one, or 0 for a plain value
+static size_t circ_param_ref(const nymya_circuit_node* n, circ_arg_kind kind) {
+    size_t off = circ_theta_offset(kind);
+    uint64_t bits;
+
+    if (!off) return 0;
+    memcpy(&bits, n->args.raw + off, sizeof(bits));
+    if ((bits & CIRC_PARAM_MASK) != CIRC_PARAM_TAG) return 0;
+    return (size_t)(bits & ~CIRC_PARAM_MASK) + 1;
+}
+
+// Grows *p to hold at least @need elements of @size bytes
+static int circ_reserve(void** p, size_t* cap, size_t need, size_t size) {
+    size_t n = *cap ? *cap : 16;
+    void* q;
+
+    if (need <= *cap) return 0;
+    while (n < need) n *= 2;
+    q = realloc(*p, n * size);
+    if (!q) return -1;
+    *p = q;
+    *cap = n;
+    return 0;
+}
+
+// Qubit ID -> last node table, open addressing with linear probing
+static size_t* circ_last_slot(nymya_circuit* c, uint64_t id) {
+    size_t mask = c->last_cap - 1;
+    size_t i = (size_t)(id * 0x9E3779B97F4A7C15ull) & mask;
+
+    while (c->last_node[i] && c->last_key[i] != id)
+        i = (i + 1) & mask;
+    c->last_key[i] = id;
+    return &c->last_node[i];
+}
+
+static int circ_last_grow(nymya_circuit* c) {
+    size_t old_cap = c->last_cap, cap = old_cap ? old_cap * 2 : 64;
+    uint64_t* old_key = c->last_key;
+    size_t* old_node = c->last_node;
+
+    c->last_key = calloc(cap, sizeof(*c->last_key));
+    c->last_node = calloc(cap, sizeof(*c->last_node));
+    if (!c->last_key || !c->last_node) {
+        free(c->last_key);
+        free(c->last_node);
+        c->last_key = old_key;
+        c->last_node = old_node;
+        return -1;
+    }
+    c->last_cap = cap;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old_node[i]) *circ_last_slot(c, old_key[i]) = old_node[i];
+    }
+    free(old_key);
+    free(old_node);
+    return 0;
+}
+
+/**
+ * circ_copy_args - Copies a gate's arguments into @n, taking a private copy of arrays.
+ * @n: Node being recorded.
+ * @kind: Argument layout.
+ * @args: Caller's argument struct.
+ *
+ * Qubits passed by pointer, and the QRNG output buffer, are not copied and
+ * must stay valid until the circuit has run.
+ *
+ * Returns 0 on success, -1 on allocation failure or a NULL array.
+ */
+static int circ_copy_args(nymya_circuit_node* n, circ_arg_kind kind, const void* args) {
+    size_t elem = 0;
+    void** arr;
+    size_t count;
+
+    memcpy(n->args.raw, args, circ_arg_size(kind));
+    n->owned = NULL;
+
+    switch (kind) {
+        case CIRC_ARG_Q_ARR: elem = sizeof(nymya_qubit*); break;
+        case CIRC_ARG_Q3D:   elem = sizeof(nymya_qpos3d); break;
+        case CIRC_ARG_Q4D:   elem = sizeof(nymya_qpos4d); break;
+        case CIRC_ARG_Q5D:   elem = sizeof(nymya_qpos5d); break;
+        default:             return 0;
+    }
+
+    // Every array layout is { pointer, size_t count }
+    arr = &n->args.ptrs[0];
+    count = ((const circ_arg_q_arr*)args)->count;
+    if (!*arr || count == 0) return -1;
+
+    n->owned = malloc(count * elem);
+    if (!n->owned) return -1;
+    memcpy(n->owned, *arr, count * elem);
+    *arr = n->owned;
+    return 0;
+}
+
+// Appends the IDs of the qubits a recorded node touches to c->ids
+static int circ_collect_ids(nymya_circuit* c, circ_arg_kind kind, const nymya_circuit_node* n) {
+    const nymya_qubit* q[3] = { NULL, NULL, NULL };
+    size_t count = 0, first = c->nids;
+
+    switch (kind) {
+        case CIRC_ARG_Q:
+        case CIRC_ARG_Q_THETA:
+        case CIRC_ARG_Q_AXIS_THETA:
+            q[0] = n->args.ptrs[0];
+            count = 1;
+            break;
+        case CIRC_ARG_Q2:
+        case CIRC_ARG_Q2_THETA:
+            q[0] = n->args.ptrs[0];
+            q[1] = n->args.ptrs[1];
+            count = 2;
+            break;
+        case CIRC_ARG_Q3:
+            q[0] = n->args.ptrs[0];
+            q[1] = n->args.ptrs[1];
+            q[2] = n->args.ptrs[2];
+            count = 3;
+            break;
+        case CIRC_ARG_Q_ARR:
+        case CIRC_ARG_Q3D:
+        case CIRC_ARG_Q4D:
+        case CIRC_ARG_Q5D:
+            count = ((const circ_arg_q_arr*)n->args.raw)->count;
+            break;
+        default:
+            return 0;
+    }
+
+    if (circ_reserve((void**)&c->ids, &c->ids_cap, first + count, sizeof(*c->ids))) return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        const nymya_qubit* qi;
+
+        switch (kind) {
+            case CIRC_ARG_Q_ARR: qi = ((nymya_qubit**)n->owned)[i]; break;
+            case CIRC_ARG_Q3D:   qi = &((nymya_qpos3d*)n->owned)[i].q; break;
+            case CIRC_ARG_Q4D:   qi = &((nymya_qpos4d*)n->owned)[i].q; break;
+            case CIRC_ARG_Q5D:   qi = &((nymya_qpos5d*)n->owned)[i].q; break;
+            default:             qi = q[i]; break;
+        }
+        if (!qi) return -1;
+        c->ids[first + i] = qi->id;
+    }
+    c->nids = first + count;
+    return 0;
+}
+
+/**
+ * nymya_circuit_record - Appends one gate call to a circuit.
+ * @c: Circuit being recorded.
+ * @gate_code: NYMYA_*_CODE of the gate.
+ * @args: The argument struct the backend would receive.
+ *
+ * Links the new node to the last node that touched each of its qubits.
+ *
+ * Returns 0 on success, -1 on an unknown gate code, invalid arguments or
+ * allocation failure; the circuit is unchanged on failure.
+ */
+int nymya_circuit_record(nymya_circuit* c, int gate_code, const void* args) {
+    circ_arg_kind kind = circ_arg_kind_of(gate_code);
+    size_t ids_mark = c->nids, deps_mark = c->ndeps;
+    nymya_circuit_node* n;
+    size_t self;
+
+    if (!args || kind == CIRC_ARG_NONE) {
+        fprintf(stderr, "[nymya_runtime] Cannot record gate %d\n", gate_code);
+        return -1;
+    }
+    if (circ_reserve((void**)&c->nodes, &c->cap, c->count + 1, sizeof(*c->nodes))) return -1;
+
+    self = c->count;
+    n = &c->nodes[self];
+    memset(n, 0, sizeof(*n));
+    n->gate_code = gate_code;
+    if (circ_copy_args(n, kind, args)) goto fail;
+    n->param = circ_param_ref(n, kind);
+    if (n->param > (size_t)CIRC_PARAM_MAX + 1) {
+        fprintf(stderr, "[nymya_runtime] Parameter index %zu out of range\n", n->param - 1);
+        goto fail;
+    }
+
+    n->qubit_first = ids_mark;
+    if (circ_collect_ids(c, kind, n)) goto fail;
+    n->nqubits = c->nids - ids_mark;
+
+    // Keep the ID table at most half full
+    while ((c->last_used + n->nqubits) * 2 > c->last_cap) {
+        if (circ_last_grow(c)) goto fail;
+    }
+    if (circ_reserve((void**)&c->deps, &c->deps_cap, c->ndeps + n->nqubits, sizeof(*c->deps)))
+        goto fail;
+
+    n->dep_first = deps_mark;
+    for (size_t i = 0; i < n->nqubits; i++) {
+        size_t* last = circ_last_slot(c, c->ids[n->qubit_first + i]);
+        size_t prev = *last;
+        int seen = 0;
+
+        if (!prev) c->last_used++;
+        *last = self + 1;
+        if (!prev || prev == self + 1) continue;
+
+        for (size_t d = n->dep_first; d < c->ndeps && !seen; d++)
+            seen = c->deps[d] == prev - 1;
+        if (!seen) {
+            c->deps[c->ndeps++] = prev - 1;
+            if (c->nodes[prev - 1].layer + 1 > n->layer)
+                n->layer = c->nodes[prev - 1].layer + 1;
+        }
+    }
+    n->ndeps = c->ndeps - n->dep_first;
+    if (n->layer + 1 > c->depth) c->depth = n->layer + 1;
+    if (n->param > c->nparams) c->nparams = n->param;
+
+    c->count++;
+    return 0;
+
+fail:
+    // The ID table is only written after the last failure point
+    free(n->owned);
+    c->nids = ids_mark;
+    c->ndeps = deps_mark;
+    return -1;
+}
+
+/**
+ * nymya_circuit_new - Allocates an empty circuit.
+ *
+ * Returns the circuit, or NULL on allocation failure.
+ */
+nymya_circuit* nymya_circuit_new(void) {
+    return calloc(1, sizeof(nymya_circuit));
+}
+
+/**
+ * nymya_circuit_free - Releases a circuit and its copied arguments.
+ * @c: Circuit; may be NULL.
+ */
+void nymya_circuit_free(nymya_circuit* c) {
+    if (!c) return;
+    for (size_t i = 0; i < c->count; i++)
+        free(c->nodes[i].owned);
+    free(c->nodes);
+    free(c->ids);
+    free(c->deps);
+    free(c->last_key);
+    free(c->last_node);
+    free(c->key);
+    free(c);
+}
+
+/**
+ * nymya_circuit_size - Number of recorded gates.
+ * @c: Circuit.
+ */
+size_t nymya_circuit_size(const nymya_circuit* c) {
+    return c ? c->count : 0;
+}
+
+/**
+ * nymya_circuit_depth - Number of DAG layers, i.e. the longest dependency chain.
+ * @c: Circuit.
+ */
+size_t nymya_circuit_depth(const nymya_circuit* c) {
+    return c ? c->depth : 0;
+}
+
+/**
+ * nymya_circuit_seal - Builds the structural key of a finished circuit.
+ * @c: Circuit; no nodes may be recorded afterwards.
+ *
+ * The key holds, per node, the gate code, the qubit count and the qubit IDs,
+ * followed by the coordinates of positional lattices, which decide the
+ * entangling pattern. Angles, axes and QRNG ranges are left out, so circuits
+ * that differ only in parameters share a key.
+ *
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int nymya_circuit_seal(nymya_circuit* c) {
+    size_t len = 0, pos = 0;
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < c->count; i++) {
+        const nymya_circuit_node* n = &c->nodes[i];
+        circ_arg_kind kind = circ_arg_kind_of(n->gate_code);
+
+        len += 2 + n->nqubits;
+        if (kind == CIRC_ARG_Q3D) len += 3 * n->nqubits;
+        if (kind == CIRC_ARG_Q4D) len += 4 * n->nqubits;
+        if (kind == CIRC_ARG_Q5D) len += 5 * n->nqubits;
+    }
+
+    free(c->key);
+    c->key = malloc((len ? len : 1) * sizeof(*c->key));
+    if (!c->key) return -1;
+
+    for (size_t i = 0; i < c->count; i++) {
+        const nymya_circuit_node* n = &c->nodes[i];
+        circ_arg_kind kind = circ_arg_kind_of(n->gate_code);
+        unsigned int dims = 0;
+        size_t stride = 0;
+
+        c->key[pos++] = (uint64_t)n->gate_code;
+        c->key[pos++] = n->nqubits;
+        memcpy(&c->key[pos], &c->ids[n->qubit_first], n->nqubits * sizeof(*c->key));
+        pos += n->nqubits;
+
+        switch (kind) {
+            case CIRC_ARG_Q3D: dims = 3; stride = sizeof(nymya_qpos3d); break;
+            case CIRC_ARG_Q4D: dims = 4; stride = sizeof(nymya_qpos4d); break;
+            case CIRC_ARG_Q5D: dims = 5; stride = sizeof(nymya_qpos5d); break;
+            default: break;
+        }
+        // The coordinates are the leading doubles of every nymya_qposNd
+        for (size_t q = 0; q < (dims ? n->nqubits : 0); q++) {
+            memcpy(&c->key[pos], (const char*)n->owned + q * stride, dims * sizeof(double));
+            pos += dims;
+        }
+    }
+
+    // FNV-1a over the 64-bit words, then a final avalanche
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ c->key[i]) * 0x100000001b3ull;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+
+    c->key_len = len;
+    c->hash = h;
+    return 0;
+}
+
+/**
+ * nymya_circuit_values - The gate arguments the structural key leaves out.
+ * @c: Circuit.
+ * @out: Receives the words, or NULL to count them.
+ *
+ * Per node, in order: the bits of theta, the axis, and a QRNG range with its
+ * count, for the layouts that have them. With the structural key this
+ * identifies what a run of @c computes, as the result cache needs.
+ *
+ * Returns the number of words.
+ */
+size_t nymya_circuit_values(const nymya_circuit* c, uint64_t* out) {
+    size_t pos = 0;
+
+    for (size_t i = 0; i < c->count; i++) {
+        const nymya_circuit_node* n = &c->nodes[i];
+        circ_arg_kind kind = circ_arg_kind_of(n->gate_code);
+        size_t off = circ_theta_offset(kind);
+
+        if (off) {
+            if (out) memcpy(&out[pos], n->args.raw + off, sizeof(*out));
+            pos++;
+        }
+        if (kind == CIRC_ARG_Q_AXIS_THETA) {
+            if (out) out[pos] = (unsigned char)((const circ_arg_q_axis_theta*)n->args.raw)->axis;
+            pos++;
+        }
+        if (kind == CIRC_ARG_QRNG) {
+            const circ_arg_qrng* a = (const circ_arg_qrng*)n->args.raw;
+
+            if (out) {
+                out[pos] = a->min;
+                out[pos + 1] = a->max;
+                out[pos + 2] = a->count;
+            }
+            pos += 3;
+        }
+    }
+    return pos;
+}
+
+size_t nymya_circuit_num_params(const nymya_circuit* c) {
+    return c ? c->nparams : 0;
+}
+
+/**
+ * nymya_circuit_node_args - Argument struct of a node with its parameter bound.
+ * @c: Circuit.
+ * @i: Node index.
+ * @params: Values for the circuit's nymya_circuit_num_params() parameters.
+ * @raw: Receives the node's arguments, sizeof(nymya_circuit_node.args) bytes.
+ *
+ * Lets a batch run bind each parameter set without touching the shared circuit.
+ */
+void nymya_circuit_node_args(const nymya_circuit* c, size_t i, const double* params, void* raw) {
+    const nymya_circuit_node* n = &c->nodes[i];
+
+    if (n->param) nymya_circuit_node_theta(c, i, params[n->param - 1], raw);
+    else memcpy(raw, n->args.raw, sizeof(n->args.raw));
+}
+
+/**
+ * nymya_circuit_node_theta - Argument struct of a node with its theta replaced.
+ * @c: Circuit.
+ * @i: Node index; the node's layout must have a theta.
+ * @theta: Value to put in.
+ * @raw: Receives the arguments, sizeof(nymya_circuit_node.args) bytes.
+ */
+void nymya_circuit_node_theta(const nymya_circuit* c, size_t i, double theta, void* raw) {
+    const nymya_circuit_node* n = &c->nodes[i];
+    size_t off = circ_theta_offset(circ_arg_kind_of(n->gate_code));
+
+    memcpy(raw, n->args.raw, sizeof(n->args.raw));
+    if (off) memcpy((unsigned char*)raw + off, &theta, sizeof(theta));
+}
+
+/**
+ * nymya_circuit_bind - Sets the values later runs of a circuit use.
+ * @c: Circuit.
+ * @params: One value per parameter, nymya_circuit_num_params() entries.
+ *
+ * Returns 0 on success, -1 on a NULL argument.
+ */
+int nymya_circuit_bind(nymya_circuit* c, const double* params) {
+    if (!c || (c->nparams && !params)) return -1;
+    for (size_t i = 0; i < c->count; i++) {
+        if (c->nodes[i].param) nymya_circuit_node_args(c, i, params, c->nodes[i].args.raw);
+    }
+    c->bound = 1;
+    return 0;
+}
+
+/**
+ * nymya_circuit_unbound - Reports a parametric circuit that has no values yet.
+ * @c: Circuit.
+ *
+ * Returns 1, after printing a message, if @c has parameters but was never
+ * bound; 0 otherwise.
+ */
+int nymya_circuit_unbound(const nymya_circuit* c) {
+    if (!c->nparams || c->bound) return 0;
+    fprintf(stderr, "[nymya_runtime] Circuit has %zu unbound parameters\n", c->nparams);
+    return 1;
+}
+
+/**
+ * nymya_circuit_replay - Executes a recorded circuit node by node.
+ * @c: Circuit.
+ *
+ * Nodes run in recording order on the active backend. While another
+ * recording is open, the gates are appended to it instead, which inlines @c
+ * into the outer circuit.
+ *
+ * Returns 0 on success, or the result of the first gate that failed.
+ */
+int nymya_circuit_replay(const nymya_circuit* c) {
+    if (!c) return -1;
+    for (size_t i = 0; i < c->count; i++) {
+        nymya_circuit_node n = c->nodes[i];
+        int ret = nymya_apply_gate(n.gate_code, n.args.raw);
+
+        if (ret) return ret;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef NYMYA_CIRCUIT_H
+#define NYMYA_CIRCUIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+#include "nymya_runtime.h"
+
+/**
+ * nymya_circuit_node - One recorded gate call.
+ * @gate_code: NYMYA_*_CODE of the gate.
+ * @args: Copy of the caller's argument struct; array arguments point at @owned.
+ * @owned: Private copy of the qubit or position array, or NULL.
+ * @qubit_first: Index of the node's first qubit ID in nymya_circuit.ids.
+ * @nqubits: Number of qubit IDs the gate touches.
+ * @dep_first: Index of the node's first predecessor in nymya_circuit.deps.
+ * @ndeps: Number of distinct predecessors.
+ * @layer: 0 for a node without predecessors, else 1 + the deepest predecessor.
+ * @param: 1 + the index of the parameter bound into the node's theta, or 0.
+ */
+typedef struct nymya_circuit_node {
+    int gate_code;
+    union {
+        void* ptrs[4];
+        unsigned char raw[32];
+    } args;
+    void* owned;
+    size_t qubit_first;
+    size_t nqubits;
+    size_t dep_first;
+    size_t ndeps;
+    size_t layer;
+    size_t param;
+} nymya_circuit_node;
+
+/**
+ * nymya_circuit - Gate calls captured between nymya_circuit_begin() and _end().
+ * @nodes: Nodes in call order, which is a topological order of the DAG.
+ * @count: Number of nodes.
+ * @cap: Allocated nodes.
+ * @ids: Qubit IDs touched by the nodes, sliced by nymya_circuit_node.qubit_first.
+ * @nids: Used entries of @ids.
+ * @ids_cap: Allocated entries of @ids.
+ * @deps: Predecessor node indices, sliced by nymya_circuit_node.dep_first.
+ * @ndeps: Used entries of @deps.
+ * @deps_cap: Allocated entries of @deps.
+ * @last_key: Open-addressed table from qubit ID ...
+ * @last_node: ... to 1 + the index of the last node that touched it (0 = empty).
+ * @last_cap: Table size, a power of two.
+ * @last_used: Occupied table entries.
+ * @depth: Number of layers.
+ * @key: Structural key, built by nymya_circuit_seal(): gate codes, qubit IDs
+ *       and lattice coordinates, but no gate parameters.
+ * @key_len: Entries of @key.
+ * @hash: Hash of @key.
+ * @precision: Register precision the simulator switches to before running
+ *             the circuit, or NYMYA_PRECISION_DEFAULT to keep the current one.
+ * @nparams: 1 + the highest parameter index a node references, or 0.
+ * @bound: Set once nymya_circuit_bind() wrote values into the nodes.
+ */
+struct nymya_circuit {
+    nymya_circuit_node* nodes;
+    size_t count;
+    size_t cap;
+    uint64_t* ids;
+    size_t nids;
+    size_t ids_cap;
+    size_t* deps;
+    size_t ndeps;
+    size_t deps_cap;
+    uint64_t* last_key;
+    size_t* last_node;
+    size_t last_cap;
+    size_t last_used;
+    size_t depth;
+    uint64_t* key;
+    size_t key_len;
+    uint64_t hash;
+    nymya_precision precision;
+    size_t nparams;
+    int bound;
+};
+
+nymya_circuit* nymya_circuit_new(void);
+int nymya_circuit_record(nymya_circuit* c, int gate_code, const void* args);
+int nymya_circuit_seal(nymya_circuit* c);
+size_t nymya_circuit_values(const nymya_circuit* c, uint64_t* out);
+int nymya_circuit_optimize(nymya_circuit* c);
+int nymya_circuit_replay(const nymya_circuit* c);
+void nymya_circuit_node_args(const nymya_circuit* c, size_t i, const double* params, void* raw);
+void nymya_circuit_node_theta(const nymya_circuit* c, size_t i, double theta, void* raw);
+int nymya_circuit_unbound(const nymya_circuit* c);
+
+// Compiled-form cache (nymya_circuit_cache.c); @backend keeps backends apart
+#define NYMYA_CCACHE_SIM 1
+
+typedef void (*nymya_compiled_free_fn)(void* compiled);
+
+void* nymya_circuit_cache_get(int backend, const nymya_circuit* c);
+int nymya_circuit_cache_put(int backend, const nymya_circuit* c, void* compiled,
+                            size_t bytes, nymya_compiled_free_fn release);
+
+#endif // NYMYA_CIRCUIT_H
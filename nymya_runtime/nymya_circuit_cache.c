@@ -0,0 +1,200 @@
+// nymya_circuit_cache.c
+//
+// Cache of compiled circuits. The key of an entry is the circuit's structural
+// key (see nymya_circuit_seal()), so parameter sweeps over one ansatz compile
+// once. Memory is bounded: the entries' compiled bytes plus their keys never
+// exceed the limit, and the least recently used entry is evicted first.
+
+#include <stdlib.h>
+#include <string.h>
+#include "nymya_circuit.h"
+
+// Default memory budget of the cache
+#define CCACHE_DEFAULT_LIMIT ((size_t)64 << 20)
+
+// Hash buckets; chains stay short because the budget bounds the entry count
+#define CCACHE_BUCKETS 1024
+
+/**
+ * ccache_entry - One compiled circuit.
+ * @hash: Structural hash of the circuit.
+ * @backend: Backend the compiled form belongs to.
+ * @key: Copy of the structural key, compared on every hit.
+ * @key_len: Entries of @key.
+ * @compiled: Backend-owned compiled form.
+ * @release: Frees @compiled.
+ * @bytes: Memory charged to the entry, key included.
+ * @chain: Next entry in the same bucket.
+ * @prev: More recently used neighbour.
+ * @next: Less recently used neighbour.
+ */
+typedef struct ccache_entry {
+    uint64_t hash;
+    int backend;
+    uint64_t* key;
+    size_t key_len;
+    void* compiled;
+    nymya_compiled_free_fn release;
+    size_t bytes;
+    struct ccache_entry* chain;
+    struct ccache_entry* prev;
+    struct ccache_entry* next;
+} ccache_entry;
+
+static __thread struct {
+    ccache_entry* buckets[CCACHE_BUCKETS];
+    ccache_entry* mru;
+    ccache_entry* lru;
+    size_t bytes;
+    size_t limit;
+    size_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} ccache = { .limit = CCACHE_DEFAULT_LIMIT };
+
+static void ccache_unlink(ccache_entry* e) {
+    if (e->prev) e->prev->next = e->next; else ccache.mru = e->next;
+    if (e->next) e->next->prev = e->prev; else ccache.lru = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void ccache_push_front(ccache_entry* e) {
+    e->prev = NULL;
+    e->next = ccache.mru;
+    if (ccache.mru) ccache.mru->prev = e;
+    ccache.mru = e;
+    if (!ccache.lru) ccache.lru = e;
+}
+
+static void ccache_drop(ccache_entry* e) {
+    ccache_entry** p = &ccache.buckets[e->hash % CCACHE_BUCKETS];
+
+    while (*p != e) p = &(*p)->chain;
+    *p = e->chain;
+    ccache_unlink(e);
+
+    ccache.bytes -= e->bytes;
+    ccache.entries--;
+    if (e->release) e->release(e->compiled);
+    free(e->key);
+    free(e);
+}
+
+// Evicts from the LRU end until @need more bytes fit
+static void ccache_make_room(size_t need) {
+    while (ccache.lru && ccache.bytes + need > ccache.limit) {
+        ccache_drop(ccache.lru);
+        ccache.evictions++;
+    }
+}
+
+/**
+ * nymya_circuit_cache_get - Looks up the compiled form of a circuit.
+ * @backend: Backend the compiled form is for.
+ * @c: Sealed circuit.
+ *
+ * Counts a hit or a miss and, on a hit, marks the entry most recently used.
+ *
+ * Returns the compiled form, or NULL on a miss.
+ */
+void* nymya_circuit_cache_get(int backend, const nymya_circuit* c) {
+    ccache_entry* e;
+
+    if (!c->key) {
+        ccache.misses++;
+        return NULL;
+    }
+    for (e = ccache.buckets[c->hash % CCACHE_BUCKETS]; e; e = e->chain) {
+        if (e->hash == c->hash && e->backend == backend && e->key_len == c->key_len &&
+            memcmp(e->key, c->key, c->key_len * sizeof(*c->key)) == 0)
+            break;
+    }
+    if (!e) {
+        ccache.misses++;
+        return NULL;
+    }
+
+    ccache.hits++;
+    ccache_unlink(e);
+    ccache_push_front(e);
+    return e->compiled;
+}
+
+/**
+ * nymya_circuit_cache_put - Inserts the compiled form of a circuit.
+ * @backend: Backend the compiled form is for.
+ * @c: Sealed circuit; must not already be cached for @backend.
+ * @compiled: Compiled form; the cache takes ownership on success.
+ * @bytes: Memory used by @compiled.
+ * @release: Frees @compiled on eviction.
+ *
+ * Returns 0 if the entry was inserted, -1 if it is larger than the whole
+ * budget or cannot be allocated; the caller then still owns @compiled.
+ */
+int nymya_circuit_cache_put(int backend, const nymya_circuit* c, void* compiled,
+                            size_t bytes, nymya_compiled_free_fn release) {
+    size_t key_bytes = c->key_len * sizeof(*c->key);
+    ccache_entry* e;
+
+    if (!c->key) return -1;
+    bytes += key_bytes + sizeof(*e);
+    if (bytes > ccache.limit) return -1;
+
+    e = calloc(1, sizeof(*e));
+    if (!e) return -1;
+    e->key = malloc(key_bytes ? key_bytes : 1);
+    if (!e->key) {
+        free(e);
+        return -1;
+    }
+
+    ccache_make_room(bytes);
+
+    memcpy(e->key, c->key, key_bytes);
+    e->key_len = c->key_len;
+    e->hash = c->hash;
+    e->backend = backend;
+    e->compiled = compiled;
+    e->release = release;
+    e->bytes = bytes;
+    e->chain = ccache.buckets[e->hash % CCACHE_BUCKETS];
+    ccache.buckets[e->hash % CCACHE_BUCKETS] = e;
+    ccache_push_front(e);
+
+    ccache.bytes += bytes;
+    ccache.entries++;
+    return 0;
+}
+
+/**
+ * nymya_circuit_cache_get_stats - Reads the cache counters.
+ * @out: Receives the counters.
+ */
+void nymya_circuit_cache_get_stats(nymya_circuit_cache_stats* out) {
+    if (!out) return;
+    out->hits = ccache.hits;
+    out->misses = ccache.misses;
+    out->evictions = ccache.evictions;
+    out->entries = ccache.entries;
+    out->bytes = ccache.bytes;
+    out->limit = ccache.limit;
+}
+
+/**
+ * nymya_circuit_cache_set_limit - Sets the memory budget, evicting as needed.
+ * @bytes: New budget; 0 disables caching.
+ */
+void nymya_circuit_cache_set_limit(size_t bytes) {
+    ccache.limit = bytes;
+    ccache_make_room(0);
+}
+
+/**
+ * nymya_circuit_cache_clear - Drops every entry and resets the counters.
+ */
+void nymya_circuit_cache_clear(void) {
+    while (ccache.lru)
+        ccache_drop(ccache.lru);
+    ccache.hits = ccache.misses = ccache.evictions = 0;
+}
@@ -0,0 +1,426 @@
+// nymya_circuit_opt.c
+//
+// Peephole optimisation of a recorded circuit. nymya_circuit_end() runs it
+// before sealing, so the simulators, the QPU program writer, job submissions
+// and circuit files all get the shorter circuit.
+//
+// Each gate looks back along its qubits for an earlier gate it can combine
+// with: a self-inverse gate cancels its twin (H H, X X, CNOT CNOT, SWAP
+// SWAP, Toffoli Toffoli, ...), and rotations and phases about the same axis
+// merge into one, vanishing when the angles sum to nothing. The look-back
+// passes gates that commute with the one being placed: gates block-diagonal
+// in the same basis (Z, X or Y) on every shared qubit, such as an RZ and
+// the control of a CNOT, or two CNOTs sharing a control. A gate may thus
+// move back past such gates to meet its partner. Identity gates and
+// zero-angle rotations are dropped.
+//
+// Parametric gates, lattice gates, Deutsch and the QRNG are kept as they
+// are; the last three also stop the look-back on their qubits. A qubit left
+// with no gates keeps one identity, so it stays in the register of runs and
+// job results. NYMYA_CIRCUIT_NOOPT turns the pass off.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <nymya/nymya.h>
+#include "nymya_circuit.h"
+#include "nymya_gates.h"
+
+// Gates a look-back may inspect before it gives up
+#define OPT_WINDOW 64
+
+// Merged angles this close to a full period count as the identity
+#define OPT_EPS 1e-12
+
+#define OPT_NONE ((size_t)-1)
+
+// Argument layouts the pass combines; the others are barriers
+enum {
+    OPT_SHAPE_NONE,
+    OPT_SHAPE_Q,
+    OPT_SHAPE_Q_THETA,
+    OPT_SHAPE_Q_AXIS_THETA,
+    OPT_SHAPE_Q2,
+    OPT_SHAPE_Q2_THETA,
+    OPT_SHAPE_Q3
+};
+#define OPT_SHAPE_Q_ARR   OPT_SHAPE_NONE
+#define OPT_SHAPE_Q3D     OPT_SHAPE_NONE
+#define OPT_SHAPE_Q4D     OPT_SHAPE_NONE
+#define OPT_SHAPE_Q5D     OPT_SHAPE_NONE
+#define OPT_SHAPE_QRNG    OPT_SHAPE_NONE
+#define OPT_SHAPE_DEUTSCH OPT_SHAPE_NONE
+
+#define OPT_SHAPE_OF(name, code, args) [(code) - NYMYA_GATE_FIRST] = OPT_SHAPE_##args,
+static const unsigned char opt_shapes[NYMYA_GATE_COUNT] = {
+    NYMYA_GATE_LIST(OPT_SHAPE_OF)
+};
+#undef OPT_SHAPE_OF
+
+// How a gate acts on one of its qubits: not at all (a global phase),
+// block-diagonal in the Z, X or Y basis, or in general
+enum { OPT_I, OPT_Z, OPT_X, OPT_Y, OPT_G };
+
+// Gate is its own inverse
+#define OPT_SELF_INVERSE 1
+// Operand order does not matter
+#define OPT_SYMMETRIC    2
+
+/**
+ * opt_gate - What the pass knows about a gate call.
+ * @arity: Qubits; 0 for a barrier.
+ * @basis: OPT_I..OPT_G on each qubit.
+ * @flags: OPT_SELF_INVERSE, OPT_SYMMETRIC.
+ * @period: Angle after which the gate repeats exactly, if angles add; else 0.
+ * @theta: Offset of the angle in the arguments, or 0.
+ */
+typedef struct opt_gate {
+    int arity;
+    unsigned char basis[3];
+    unsigned char flags;
+    double period;
+    size_t theta;
+} opt_gate;
+
+static void opt_gate_of(const nymya_circuit_node* n, opt_gate* g) {
+    unsigned int i = (unsigned int)(n->gate_code - NYMYA_GATE_FIRST);
+    int shape = i < NYMYA_GATE_COUNT ? opt_shapes[i] : OPT_SHAPE_NONE;
+
+    memset(g, 0, sizeof(*g));
+    switch (shape) {
+        case OPT_SHAPE_Q: g->arity = 1; break;
+        case OPT_SHAPE_Q_THETA: g->arity = 1; g->theta = offsetof(nymya_arg_q_theta, theta); break;
+        case OPT_SHAPE_Q_AXIS_THETA: g->arity = 1; g->theta = offsetof(nymya_arg_q_axis_theta, theta); break;
+        case OPT_SHAPE_Q2: g->arity = 2; break;
+        case OPT_SHAPE_Q2_THETA: g->arity = 2; g->theta = offsetof(nymya_arg_q2_theta, theta); break;
+        case OPT_SHAPE_Q3: g->arity = 3; break;
+        default: return;
+    }
+    memset(g->basis, OPT_G, sizeof(g->basis));
+
+    switch (n->gate_code) {
+        case 3301: g->basis[0] = OPT_I; break;                        // identity
+        case 3302: g->basis[0] = OPT_I; g->period = 2 * M_PI; break;  // global_phase
+        case 3303: g->basis[0] = OPT_X; g->flags = OPT_SELF_INVERSE; break;
+        case 3304: g->basis[0] = OPT_Y; g->flags = OPT_SELF_INVERSE; break;
+        case 3305: g->basis[0] = OPT_Z; g->flags = OPT_SELF_INVERSE; break;
+        case 3306: g->basis[0] = OPT_Z; break;                        // S
+        case 3307: g->basis[0] = OPT_X; break;                        // sqrt(X)
+        case 3308: g->flags = OPT_SELF_INVERSE; break;                // H
+        case 3315:   // phase_shift
+        case 3316: g->basis[0] = OPT_Z; g->period = 2 * M_PI; break;
+        case 3319: g->basis[0] = OPT_X; g->period = 4 * M_PI; break;
+        case 3320: g->basis[0] = OPT_Y; g->period = 4 * M_PI; break;
+        case 3321: g->basis[0] = OPT_Z; g->period = 4 * M_PI; break;
+        case 3330: { // rotate: the basis follows the axis
+            const nymya_arg_q_axis_theta* a = (const void*)n->args.raw;
+
+            switch (a->axis) {
+                case 'x': case 'X': g->basis[0] = OPT_X; break;
+                case 'y': case 'Y': g->basis[0] = OPT_Y; break;
+                case 'z': case 'Z': g->basis[0] = OPT_Z; break;
+                default: g->arity = 0; return;
+            }
+            g->period = 4 * M_PI;
+            break;
+        }
+
+        case 3309:   // cnot
+        case 3310:   // acnot
+            g->basis[0] = OPT_Z;
+            g->basis[1] = OPT_X;
+            g->flags = OPT_SELF_INVERSE;
+            break;
+        case 3311:   // cz
+            g->basis[0] = g->basis[1] = OPT_Z;
+            g->flags = OPT_SELF_INVERSE | OPT_SYMMETRIC;
+            break;
+        case 3313: g->flags = OPT_SELF_INVERSE | OPT_SYMMETRIC; break; // swap
+        case 3317:   // cphase
+            g->basis[0] = g->basis[1] = OPT_Z;
+            g->flags = OPT_SYMMETRIC;
+            g->period = 2 * M_PI;
+            break;
+        case 3318: g->basis[0] = g->basis[1] = OPT_Z; break;          // cphase_s
+        case 3322: g->basis[0] = g->basis[1] = OPT_X; g->flags = OPT_SYMMETRIC; g->period = 4 * M_PI; break;
+        case 3323: g->basis[0] = g->basis[1] = OPT_Y; g->flags = OPT_SYMMETRIC; g->period = 4 * M_PI; break;
+        case 3324: g->basis[0] = g->basis[1] = OPT_Z; g->flags = OPT_SYMMETRIC; g->period = 4 * M_PI; break;
+        case 3325: g->flags = OPT_SYMMETRIC; g->period = 4 * M_PI; break; // xyz
+
+        case 3312:   // double_controlled_not
+        case 3331:   // barenco
+            g->basis[0] = g->basis[1] = OPT_Z;
+            g->basis[2] = OPT_X;
+            g->flags = OPT_SELF_INVERSE;
+            break;
+        case 3329:   // fredkin
+        case 3335:   // dagwood
+            g->basis[0] = OPT_Z;
+            g->flags = OPT_SELF_INVERSE;
+            break;
+        case 3343:   // margolis
+            g->basis[0] = g->basis[1] = g->basis[2] = OPT_Z;
+            g->flags = OPT_SELF_INVERSE | OPT_SYMMETRIC;
+            break;
+        case 3346: g->arity = 0; return;                             // triangular_lattice
+    }
+}
+
+static double opt_theta(const nymya_circuit_node* n, const opt_gate* g) {
+    double theta;
+
+    memcpy(&theta, n->args.raw + g->theta, sizeof(theta));
+    return theta;
+}
+
+/**
+ * opt_ctx - Qubit chains of a circuit being optimised.
+ * @c: Circuit.
+ * @g: What the pass knows about each node.
+ * @live: Non-zero for nodes still in the circuit.
+ * @node: Node of each entry of c->ids.
+ * @prev: Previous live entry on the same qubit, or OPT_NONE.
+ * @next: Next live entry on the same qubit, or OPT_NONE.
+ * @qubit: Dense index of the qubit of each entry of c->ids.
+ */
+typedef struct opt_ctx {
+    const nymya_circuit* c;
+    opt_gate* g;
+    unsigned char* live;
+    size_t* node;
+    size_t* prev;
+    size_t* next;
+    size_t* qubit;
+} opt_ctx;
+
+static void opt_unlink(opt_ctx* o, size_t i) {
+    const nymya_circuit_node* n = &o->c->nodes[i];
+
+    o->live[i] = 0;
+    for (size_t e = n->qubit_first; e < n->qubit_first + n->nqubits; e++) {
+        if (o->prev[e] != OPT_NONE) o->next[o->prev[e]] = o->next[e];
+        if (o->next[e] != OPT_NONE) o->prev[o->next[e]] = o->prev[e];
+    }
+}
+
+// Whether @a and @b act on the same qubits, in the same order unless symmetric
+static int opt_same_qubits(const nymya_circuit* c, size_t a, size_t b, int symmetric) {
+    const uint64_t* qa = &c->ids[c->nodes[a].qubit_first];
+    const uint64_t* qb = &c->ids[c->nodes[b].qubit_first];
+    size_t n = c->nodes[a].nqubits;
+
+    if (n != c->nodes[b].nqubits) return 0;
+    if (!memcmp(qa, qb, n * sizeof(*qa))) return 1;
+    if (!symmetric) return 0;
+    for (size_t i = 0; i < n; i++) {
+        int found = 0;
+        for (size_t k = 0; k < n && !found; k++) found = qa[i] == qb[k];
+        if (!found) return 0;
+    }
+    return 1;
+}
+
+// Whether earlier node @j and later node @i commute: the same basis on every shared qubit
+static int opt_commute(const opt_ctx* o, size_t j, size_t i) {
+    const nymya_circuit* c = o->c;
+    const opt_gate* gj = &o->g[j];
+    const opt_gate* gi = &o->g[i];
+
+    if (!gj->arity) return 0;
+    for (int a = 0; a < gi->arity; a++) {
+        for (int b = 0; b < gj->arity; b++) {
+            if (c->ids[c->nodes[i].qubit_first + a] != c->ids[c->nodes[j].qubit_first + b]) continue;
+            if (gi->basis[a] == OPT_I || gj->basis[b] == OPT_I) continue;
+            if (gi->basis[a] != gj->basis[b] || gi->basis[a] == OPT_G) return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * opt_place - Combines node @i with an earlier gate, if one is in reach.
+ * @o: Context.
+ * @i: Live node, linked into the chains.
+ *
+ * Walks the earlier gates on @i's qubits latest first, past those that
+ * commute with @i, up to the first it can cancel or merge with.
+ */
+static void opt_place(opt_ctx* o, size_t i) {
+    nymya_circuit* c = (nymya_circuit*)o->c;
+    nymya_circuit_node* n = &c->nodes[i];
+    const opt_gate* g = &o->g[i];
+    size_t cur[3];
+
+    if (!g->arity) return;
+    if (!n->param && (n->gate_code == 3301 || (g->period && fabs(remainder(opt_theta(n, g), g->period)) < OPT_EPS))) {
+        opt_unlink(o, i);
+        return;
+    }
+    if (!(g->flags & OPT_SELF_INVERSE) && (!g->period || n->param)) return;
+
+    for (int k = 0; k < g->arity; k++) cur[k] = o->prev[n->qubit_first + k];
+    for (int step = 0; step < OPT_WINDOW; step++) {
+        size_t j = OPT_NONE;
+
+        // The latest earlier gate on any of @i's qubits
+        for (int k = 0; k < g->arity; k++) {
+            if (cur[k] != OPT_NONE && (j == OPT_NONE || o->node[cur[k]] > j)) j = o->node[cur[k]];
+        }
+        if (j == OPT_NONE) return;
+        for (int k = 0; k < g->arity; k++) {
+            if (cur[k] != OPT_NONE && o->node[cur[k]] == j) cur[k] = o->prev[cur[k]];
+        }
+
+        if (c->nodes[j].gate_code == n->gate_code && !c->nodes[j].param && !n->param &&
+            o->g[j].basis[0] == g->basis[0] && opt_same_qubits(c, j, i, g->flags & OPT_SYMMETRIC)) {
+            nymya_circuit_node* m = &c->nodes[j];
+            double sum;
+
+            if (g->flags & OPT_SELF_INVERSE) {
+                opt_unlink(o, j);
+                opt_unlink(o, i);
+                return;
+            }
+            // @i moves back to @j past gates it commutes with, so the angles add
+            sum = opt_theta(m, g) + opt_theta(n, g);
+            opt_unlink(o, i);
+            if (fabs(remainder(sum, g->period)) < OPT_EPS) opt_unlink(o, j);
+            else memcpy(m->args.raw + g->theta, &sum, sizeof(sum));
+            return;
+        }
+        if (!opt_commute(o, j, i)) return;
+    }
+}
+
+/**
+ * opt_rebuild - Records the live nodes of @o into a new circuit.
+ * @o: Context after the pass.
+ * @nq: Distinct qubits.
+ *
+ * A qubit whose every gate was removed gets an identity where its first
+ * gate was.
+ *
+ * Returns the circuit, or NULL on allocation failure.
+ */
+static nymya_circuit* opt_rebuild(const opt_ctx* o, size_t nq) {
+    const nymya_circuit* c = o->c;
+    unsigned char* has = calloc(nq ? nq : 1, 1);
+    nymya_circuit* out = nymya_circuit_new();
+
+    if (!has || !out) goto fail;
+    out->precision = c->precision;
+    for (size_t i = 0; i < c->count; i++) {
+        const nymya_circuit_node* n = &c->nodes[i];
+
+        if (!o->live[i]) continue;
+        for (size_t e = n->qubit_first; e < n->qubit_first + n->nqubits; e++) has[o->qubit[e]] = 1;
+    }
+    for (size_t i = 0; i < c->count; i++) {
+        const nymya_circuit_node* n = &c->nodes[i];
+
+        if (o->live[i]) {
+            if (nymya_circuit_record(out, n->gate_code, n->args.raw)) goto fail;
+            continue;
+        }
+        for (size_t k = 0; k < n->nqubits; k++) {
+            nymya_arg_q a = { n->args.ptrs[k] };
+
+            if (has[o->qubit[n->qubit_first + k]]) continue;
+            has[o->qubit[n->qubit_first + k]] = 1;
+            if (nymya_circuit_record(out, NYMYA_IDENTITY_GATE_CODE, &a)) goto fail;
+        }
+    }
+    free(has);
+    return out;
+
+fail:
+    free(has);
+    nymya_circuit_free(out);
+    return NULL;
+}
+
+/**
+ * nymya_circuit_optimize - Cancels and merges gates of a recorded circuit.
+ * @c: Circuit, not yet sealed.
+ *
+ * Returns 0, with @c rewritten if anything was removed, or -1 on allocation
+ * failure, with @c unchanged.
+ */
+int nymya_circuit_optimize(nymya_circuit* c) {
+    opt_ctx o = { .c = c };
+    size_t cap = 16, nq = 0, removed = 0;
+    uint64_t* key = NULL;
+    size_t *val = NULL, *last = NULL;
+    int ret = -1;
+
+    if (!c->count || getenv("NYMYA_CIRCUIT_NOOPT")) return 0;
+    while (cap < 2 * c->nids) cap <<= 1;
+    o.g = malloc(c->count * sizeof(*o.g));
+    o.live = malloc(c->count);
+    o.node = malloc((c->nids ? c->nids : 1) * sizeof(*o.node));
+    o.prev = malloc((c->nids ? c->nids : 1) * sizeof(*o.prev));
+    o.next = malloc((c->nids ? c->nids : 1) * sizeof(*o.next));
+    o.qubit = malloc((c->nids ? c->nids : 1) * sizeof(*o.qubit));
+    key = malloc(cap * sizeof(*key));
+    val = calloc(cap, sizeof(*val));
+    last = malloc((c->nids ? c->nids : 1) * sizeof(*last));
+    if (!o.g || !o.live || !o.node || !o.prev || !o.next || !o.qubit || !key || !val || !last) goto out;
+
+    // Chain every node into the lists of its qubits, IDs numbered densely
+    for (size_t i = 0; i < c->count; i++) {
+        const nymya_circuit_node* n = &c->nodes[i];
+
+        opt_gate_of(n, &o.g[i]);
+        o.live[i] = 1;
+        for (size_t e = n->qubit_first; e < n->qubit_first + n->nqubits; e++) {
+            size_t h = (size_t)(c->ids[e] * 0x9E3779B97F4A7C15ull) & (cap - 1);
+            size_t u;
+
+            while (val[h] && key[h] != c->ids[e]) h = (h + 1) & (cap - 1);
+            if (!val[h]) {
+                key[h] = c->ids[e];
+                val[h] = ++nq;
+                last[nq - 1] = OPT_NONE;
+            }
+            u = val[h] - 1;
+            o.node[e] = i;
+            o.qubit[e] = u;
+            o.prev[e] = last[u];
+            o.next[e] = OPT_NONE;
+            if (last[u] != OPT_NONE) o.next[last[u]] = e;
+            last[u] = e;
+        }
+    }
+
+    for (size_t i = 0; i < c->count; i++) {
+        if (o.live[i]) opt_place(&o, i);
+    }
+    for (size_t i = 0; i < c->count; i++) removed += !o.live[i];
+
+    ret = 0;
+    if (removed) {
+        nymya_circuit* out = opt_rebuild(&o, nq);
+        nymya_circuit tmp;
+
+        if (!out) {
+            ret = -1;
+            goto out;
+        }
+        tmp = *c;
+        *c = *out;
+        *out = tmp;
+        nymya_circuit_free(out);
+    }
+out:
+    free(o.g);
+    free(o.live);
+    free(o.node);
+    free(o.prev);
+    free(o.next);
+    free(o.qubit);
+    free(key);
+    free(val);
+    free(last);
+    return ret;
+}
@@ -0,0 +1,62 @@
+#ifndef NYMYA_CKPT_H
+#define NYMYA_CKPT_H
+
+// On-disk simulator checkpoint. A file is a header, the register's qubit ID
+// table and its amplitudes, laid out so that a private mapping of the file
+// serves as the restored register:
+//
+//     offset 0            nymya_ckpt_header
+//     ids_offset          uint64_t ids[nqubits]   (ids[k] is slot k)
+//     amps_offset         amplitudes, page aligned
+//
+// Uncompressed amplitudes are the register's array as it is: 2^nqubits
+// double complex or float complex values by basis index, amps_size bytes.
+// With NYMYA_CKPT_ZSTD the array is cut into NYMYA_CKPT_FRAME-byte pieces
+// (the last may be shorter), each stored as a uint64_t compressed length
+// followed by one zstd frame; amps_size covers all of them. Integers are
+// little-endian. Files name their version; a reader rejects a version it
+// does not know.
+
+#include <stdint.h>
+
+#define NYMYA_CKPT_MAGIC     0x534D594Eu // "NYMS"
+#define NYMYA_CKPT_VERSION   1
+#define NYMYA_CKPT_ALIGN     4096
+#define NYMYA_CKPT_FRAME     ((uint64_t)1 << 23)
+#define NYMYA_CKPT_RNG_WORDS 16
+
+// Flags
+#define NYMYA_CKPT_ZSTD      0x1u
+
+/**
+ * nymya_ckpt_header - First bytes of a checkpoint file.
+ * @magic: NYMYA_CKPT_MAGIC.
+ * @version: NYMYA_CKPT_VERSION.
+ * @header_size: sizeof(nymya_ckpt_header) of the writer.
+ * @flags: NYMYA_CKPT_* bits; unknown bits are rejected.
+ * @precision: Amplitude storage, a sim_sv_precision value.
+ * @nqubits: Register width, and entries of the ID table.
+ * @position: Caller's position in its circuit when the state was saved.
+ * @rng_words: Words of @rng in use, or 0 if none were saved.
+ * @rng: Random generator state of the saving thread.
+ * @ids_offset: File offset of the ID table.
+ * @amps_offset: File offset of the amplitudes, a multiple of NYMYA_CKPT_ALIGN.
+ * @amps_size: Bytes stored at @amps_offset.
+ */
+typedef struct nymya_ckpt_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t flags;
+    uint32_t precision;
+    uint64_t nqubits;
+    uint64_t position;
+    uint32_t rng_words;
+    uint32_t reserved;
+    uint64_t rng[NYMYA_CKPT_RNG_WORDS];
+    uint64_t ids_offset;
+    uint64_t amps_offset;
+    uint64_t amps_size;
+} nymya_ckpt_header;
+
+#endif // NYMYA_CKPT_H
@@ -0,0 +1,262 @@
+// runtime/nymya_entropy.c
+//
+// Hardware entropy for qrng_range (3361) on the "gateqpu" backend. A block
+// circuit puts ENTROPY_QUBITS qubits in superposition and measures them
+// ENTROPY_SHOTS times, giving one random word per shot. Blocks are requested
+// through the job queue ahead of demand and land in a process-wide ring of
+// words, so a 3361 call only copies from memory. A dry ring is topped up
+// from the kernel's generator (getrandom()) instead of waiting on the
+// device; nymya_entropy_get_stats() shows how often that happens.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/random.h>
+#include "nymya_runtime.h"
+#include "nymya_qpu.h"
+#include "backend_gateqpu.h"
+
+// Qubits measured per shot; physical qubits $0 to $63 of the device
+#define ENTROPY_QUBITS 64
+
+// Shots per block, i.e. words a refill adds (32 KiB)
+#define ENTROPY_SHOTS 4096
+
+// Ring size until nymya_entropy_set_depth() is called (512 KiB)
+#define ENTROPY_DEFAULT_DEPTH (16 * ENTROPY_SHOTS)
+
+// Ring, counters and the block job, all guarded by entropy_lock
+static pthread_mutex_t entropy_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t* entropy_ring;
+static size_t entropy_cap;
+static size_t entropy_head;
+static size_t entropy_level;
+static size_t entropy_depth = ENTROPY_DEFAULT_DEPTH;
+static nymya_job* entropy_job;
+static nymya_job* entropy_spent;
+static uint64_t entropy_refills;
+static uint64_t entropy_failures;
+static uint64_t entropy_served;
+static uint64_t entropy_fallback;
+
+// The block circuit, built once: H on every slot, slot i is qubit $i
+static nymya_op entropy_ops[ENTROPY_QUBITS];
+static uint64_t entropy_ids[ENTROPY_QUBITS];
+static pthread_once_t entropy_once = PTHREAD_ONCE_INIT;
+
+static void entropy_build(void) {
+    for (uint32_t i = 0; i < ENTROPY_QUBITS; i++) {
+        entropy_ops[i].gate_code = NYMYA_HADAMARD_CODE;
+        entropy_ops[i].qubit[0] = i;
+        entropy_ids[i] = i;
+    }
+}
+
+static void entropy_kick(void);
+
+/**
+ * entropy_reap - Takes the last finished block job off the pool's hands.
+ *
+ * Called with entropy_lock held; the caller frees the job, if any, after
+ * dropping the lock. A job cannot free itself from its own callback, so each
+ * one is freed by the next callback or by the next caller of the pool.
+ */
+static nymya_job* entropy_reap(void) {
+    nymya_job* j = entropy_spent;
+
+    entropy_spent = NULL;
+    return j;
+}
+
+// Job callback on a dispatcher thread: moves the shots into the ring and
+// requests the next block, so the ring fills without waiting on callers
+static void entropy_done(nymya_job* j, void* user) {
+    nymya_job_result r;
+    nymya_job* spent;
+    int ok;
+
+    (void)user;
+    pthread_mutex_lock(&entropy_lock);
+    spent = entropy_reap();
+    ok = nymya_job_get_result(j, &r) == 0 && r.words == 1;
+    if (ok) {
+        size_t n = r.shots;
+
+        if (n > entropy_cap - entropy_level) n = entropy_cap - entropy_level;
+        for (size_t i = 0; i < n; i++)
+            entropy_ring[(entropy_head + entropy_level + i) % entropy_cap] = r.bits[i];
+        entropy_level += n;
+        entropy_refills++;
+    } else {
+        entropy_failures++;
+    }
+    entropy_spent = j;
+    entropy_job = NULL;
+    // A failed block is not retried until a caller comes back for words
+    if (ok)
+        entropy_kick();
+    pthread_mutex_unlock(&entropy_lock);
+    nymya_job_free(spent);
+}
+
+// Resizes the ring to entropy_depth, keeping the newest words; lock held
+static int entropy_resize(void) {
+    uint64_t* ring;
+    size_t keep;
+
+    if (entropy_cap == entropy_depth) return 0;
+    ring = entropy_depth ? malloc(entropy_depth * sizeof(*ring)) : NULL;
+    if (entropy_depth && !ring) return -1;
+
+    keep = entropy_level < entropy_depth ? entropy_level : entropy_depth;
+    for (size_t i = 0; i < keep; i++)
+        ring[i] = entropy_ring[(entropy_head + entropy_level - keep + i) % entropy_cap];
+    free(entropy_ring);
+    entropy_ring = ring;
+    entropy_cap = entropy_depth;
+    entropy_head = 0;
+    entropy_level = keep;
+    return 0;
+}
+
+/**
+ * entropy_kick - Requests a block when the ring has room for one.
+ *
+ * Called with entropy_lock held. At most one block is in flight, and
+ * nothing is requested without a device.
+ */
+static void entropy_kick(void) {
+    nymya_qpu_request req;
+
+    if (!entropy_job && entropy_resize() == 0 && entropy_cap &&
+        entropy_cap - entropy_level >= (entropy_cap < ENTROPY_SHOTS ? entropy_cap : ENTROPY_SHOTS) &&
+        nymya_job_device_attached()) {
+        pthread_once(&entropy_once, entropy_build);
+        memset(&req, 0, sizeof(req));
+        req.ops = entropy_ops;
+        req.nops = ENTROPY_QUBITS;
+        req.ids = entropy_ids;
+        req.nqubits = ENTROPY_QUBITS;
+        req.shots = entropy_cap < ENTROPY_SHOTS ? (unsigned int)entropy_cap : ENTROPY_SHOTS;
+        entropy_job = nymya_job_submit_borrowed(&req, entropy_done, NULL);
+    }
+}
+
+// Kernel CSPRNG words for when the ring runs dry
+static int entropy_kernel(uint64_t* out, size_t n) {
+    char* p = (char*)out;
+    size_t left = n * sizeof(*out);
+    ssize_t got;
+
+    while (left) {
+        got = getrandom(p, left, 0);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += got;
+        left -= (size_t)got;
+    }
+    return 0;
+}
+
+/**
+ * entropy_take - Fills @out with @n words, from the ring first.
+ *
+ * Returns 0, or -1 if the kernel generator failed too.
+ */
+static int entropy_take(uint64_t* out, size_t n) {
+    nymya_job* spent;
+    size_t k;
+
+    pthread_mutex_lock(&entropy_lock);
+    k = n < entropy_level ? n : entropy_level;
+    for (size_t i = 0; i < k; i++)
+        out[i] = entropy_ring[(entropy_head + i) % entropy_cap];
+    if (k) entropy_head = (entropy_head + k) % entropy_cap;
+    entropy_level -= k;
+    entropy_served += k;
+    entropy_fallback += n - k;
+    entropy_kick();
+    spent = entropy_reap();
+    pthread_mutex_unlock(&entropy_lock);
+    nymya_job_free(spent);
+
+    return k < n ? entropy_kernel(out + k, n - k) : 0;
+}
+
+/**
+ * nymya_entropy_range - Fills @out with @n uniform values in [@min, @max].
+ * @out: Destination.
+ * @n: Number of values.
+ * @min: Smallest value (inclusive).
+ * @max: Largest value (inclusive), at least @min.
+ *
+ * Words come from the prefetched device entropy, else the kernel generator,
+ * and are mapped with Lemire's multiply-shift; the rare biased draws are
+ * replaced with further words from the same source.
+ *
+ * Returns 0, or -1 on invalid arguments or if no entropy could be had.
+ */
+int nymya_entropy_range(uint64_t* out, size_t n, uint64_t min, uint64_t max) {
+    // range wraps to 0 when [min, max] is all of uint64_t
+    uint64_t range = max - min + 1;
+
+    if ((!out && n) || min > max) return -1;
+    if (entropy_take(out, n)) return -1;
+    if (!range) return 0;
+
+    for (size_t i = 0; i < n; i++) {
+        __uint128_t m = (__uint128_t)out[i] * range;
+
+        if ((uint64_t)m < range) {
+            uint64_t floor = -range % range, x;
+
+            while ((uint64_t)m < floor) {
+                if (entropy_take(&x, 1)) return -1;
+                m = (__uint128_t)x * range;
+            }
+        }
+        out[i] = min + (uint64_t)(m >> 64);
+    }
+    return 0;
+}
+
+/**
+ * nymya_entropy_set_depth - Sets how many words the ring holds (0 = no prefetch).
+ * @words: Ring size.
+ *
+ * Takes effect at once; buffered words beyond the new size are dropped, and
+ * with a device attached the ring starts filling right away.
+ */
+void nymya_entropy_set_depth(size_t words) {
+    nymya_job* spent;
+
+    pthread_mutex_lock(&entropy_lock);
+    entropy_depth = words;
+    entropy_kick();
+    spent = entropy_reap();
+    pthread_mutex_unlock(&entropy_lock);
+    nymya_job_free(spent);
+}
+
+/**
+ * nymya_entropy_get_stats - Reports the ring and where 3361 words came from.
+ * @out: Receives the counters.
+ */
+void nymya_entropy_get_stats(nymya_entropy_stats* out) {
+    if (!out) return;
+    pthread_mutex_lock(&entropy_lock);
+    out->depth = entropy_depth;
+    out->level = entropy_level;
+    out->inflight = entropy_job != NULL;
+    out->refills = entropy_refills;
+    out->refill_failures = entropy_failures;
+    out->served = entropy_served;
+    out->fallback = entropy_fallback;
+    pthread_mutex_unlock(&entropy_lock);
+}
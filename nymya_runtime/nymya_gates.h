@@ -0,0 +1,157 @@
+#ifndef NYMYA_GATES_H
+#define NYMYA_GATES_H
+
+// Gate call ABI of the runtime: the argument struct nymya_apply_gate() expects
+// for each gate code, and the gate list the typed entry points are generated
+// from. Backends and the circuit recorder read arguments through these.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+
+typedef struct { nymya_qubit* q; } nymya_arg_q;
+typedef struct { nymya_qubit* q; double theta; } nymya_arg_q_theta;
+typedef struct { nymya_qubit* q; char axis; double theta; } nymya_arg_q_axis_theta;
+typedef struct { nymya_qubit* q1, *q2; } nymya_arg_q2;
+typedef struct { nymya_qubit* q1, *q2; double theta; } nymya_arg_q2_theta;
+typedef struct { nymya_qubit* q1, *q2, *q3; } nymya_arg_q3;
+typedef struct { nymya_qubit** qs; size_t count; } nymya_arg_q_arr;
+typedef struct { nymya_qpos3d* qs; size_t count; } nymya_arg_q3d;
+typedef struct { nymya_qpos4d* qs; size_t count; } nymya_arg_q4d;
+typedef struct { nymya_qpos5d* qs; size_t count; } nymya_arg_q5d;
+typedef struct { uint64_t* out; uint64_t min, max; size_t count; } nymya_arg_qrng;
+
+/*
+ * NYMYA_GATE_LIST - Every gate code with its name and argument struct.
+ *
+ * X(name, code, ARGS) is expanded once per gate; ARGS names the struct as
+ * the suffix of nymya_arg_<args> in upper case. Deutsch takes the q3 struct
+ * but its oracle callback cannot be passed through it, so it has its own tag.
+ */
+#define NYMYA_GATE_LIST(X) \
+    X(identity,              NYMYA_IDENTITY_GATE_CODE,       Q)             \
+    X(global_phase,          NYMYA_GLOBAL_PHASE_CODE,        Q_THETA)       \
+    X(pauli_x,               NYMYA_PAULI_X_CODE,             Q)             \
+    X(pauli_y,               NYMYA_PAULI_Y_CODE,             Q)             \
+    X(pauli_z,               NYMYA_PAULI_Z_CODE,             Q)             \
+    X(phase_s,               NYMYA_PHASE_S_CODE,             Q)             \
+    X(sqrt_x,                NYMYA_SQRT_X_CODE,              Q)             \
+    X(hadamard,              NYMYA_HADAMARD_CODE,            Q)             \
+    X(cnot,                  NYMYA_CNOT_CODE,                Q2)            \
+    X(acnot,                 NYMYA_ACNOT_CODE,               Q2)            \
+    X(cz,                    NYMYA_CZ_CODE,                  Q2)            \
+    X(dcnot,                 NYMYA_DCNOT_CODE,               Q3)            \
+    X(swap,                  NYMYA_SWAP_CODE,                Q2)            \
+    X(imswap,                NYMYA_IMSWAP_CODE,              Q2)            \
+    X(phase_shift,           NYMYA_PHASE_SHIFT_CODE,         Q_THETA)       \
+    X(phase_gate,            NYMYA_PHASE_GATE_CODE,          Q_THETA)       \
+    X(cphase,                NYMYA_CPHASE_CODE,              Q2_THETA)      \
+    X(cphase_s,              NYMYA_CPHASE_S_CODE,            Q2)            \
+    X(rotate_x,              NYMYA_ROTATE_X_CODE,            Q_THETA)       \
+    X(rotate_y,              NYMYA_ROTATE_Y_CODE,            Q_THETA)       \
+    X(rotate_z,              NYMYA_ROTATE_Z_CODE,            Q_THETA)       \
+    X(xx,                    NYMYA_XX_CODE,                  Q2_THETA)      \
+    X(yy,                    NYMYA_YY_CODE,                  Q2_THETA)      \
+    X(zz,                    NYMYA_ZZ_CODE,                  Q2_THETA)      \
+    X(xyz,                   NYMYA_XYZ_CODE,                 Q2_THETA)      \
+    X(sqrt_swap,             NYMYA_SQRT_SWAP_CODE,           Q2)            \
+    X(sqrt_iswap,            NYMYA_SQRT_ISWAP_CODE,          Q2)            \
+    X(swap_pow,              NYMYA_SWAP_POW_CODE,            Q2_THETA)      \
+    X(fredkin,               NYMYA_FREDKIN_CODE,             Q3)            \
+    X(rotate,                NYMYA_ROTATE_CODE,              Q_AXIS_THETA)  \
+    X(barenco,               NYMYA_BARENCO_CODE,             Q3)            \
+    X(berkeley,              NYMYA_BERKELEY_CODE,            Q2_THETA)      \
+    X(c_v,                   NYMYA_C_V_CODE,                 Q2)            \
+    X(core_entangle,         NYMYA_CORE_ENTANGLE_CODE,       Q2)            \
+    X(dagwood,               NYMYA_DAGWOOD_CODE,             Q3)            \
+    X(echo_cr,               NYMYA_ECHO_CR_CODE,             Q2_THETA)      \
+    X(fermion_sim,           NYMYA_FERMION_SIM_CODE,         Q2)            \
+    X(givens,                NYMYA_GIVENS_CODE,              Q2_THETA)      \
+    X(magic,                 NYMYA_MAGIC_CODE,               Q2)            \
+    X(sycamore,              NYMYA_SYCAMORE_CODE,            Q2)            \
+    X(cz_swap,               NYMYA_CZ_SWAP_CODE,             Q2)            \
+    X(deutsch,               NYMYA_DEUTSCH_CODE,             DEUTSCH)       \
+    X(margolis,              NYMYA_MARGOLIS_CODE,            Q3)            \
+    X(peres,                 NYMYA_PERES_CODE,               Q3)            \
+    X(cf_swap,               NYMYA_CF_SWAP_CODE,             Q3)            \
+    X(triangular_lattice,    NYMYA_TRIANGULAR_LATTICE_CODE,  Q3)            \
+    X(hexagonal_lattice,     NYMYA_HEXAGONAL_LATTICE_CODE,   Q_ARR)         \
+    X(hex_rhombi_lattice,    NYMYA_HEX_RHOMBI_LATTICE_CODE,  Q_ARR)         \
+    X(tessellate_triangles,  NYMYA_TESS_TRIANGLES_CODE,      Q_ARR)         \
+    X(tessellate_hexagons,   NYMYA_TESS_HEXAGONS_CODE,       Q_ARR)         \
+    X(tessellate_hex_rhombi, NYMYA_TESS_HEX_RHOMBI_CODE,     Q_ARR)         \
+    X(e8_group,              NYMYA_E8_GROUP_CODE,            Q_ARR)         \
+    X(flower_of_life,        NYMYA_FLOWER_OF_LIFE_CODE,      Q_ARR)         \
+    X(metatron_cube,         NYMYA_METATRON_CUBE_CODE,       Q_ARR)         \
+    X(fcc_lattice,           NYMYA_FCC_LATTICE_CODE,         Q3D)           \
+    X(hcp_lattice,           NYMYA_HCP_LATTICE_CODE,         Q3D)           \
+    X(e8_projected_lattice,  NYMYA_E8_PROJECTED_CODE,        Q3D)           \
+    X(d4_lattice,            NYMYA_D4_LATTICE_CODE,          Q4D)           \
+    X(b5_lattice,            NYMYA_B5_LATTICE_CODE,          Q5D)           \
+    X(e5_projected_lattice,  NYMYA_E5_PROJECTED_CODE,        Q5D)           \
+    X(qrng_range,            NYMYA_QRNG_CODE,                QRNG)
+
+/*
+ * The runtime list keeps its own names, but codes and argument structs are
+ * pinned to the core table: every entry must name a code of NYMYA_GATES
+ * whose shape takes that struct, no code may be listed twice, and both lists
+ * must be the same length. QARR and QLIST gates both take nymya_arg_q_arr.
+ */
+enum {
+    NYMYA_RT_ARGS_ID_Q,
+    NYMYA_RT_ARGS_ID_Q_THETA,
+    NYMYA_RT_ARGS_ID_Q_AXIS_THETA,
+    NYMYA_RT_ARGS_ID_Q2,
+    NYMYA_RT_ARGS_ID_Q2_THETA,
+    NYMYA_RT_ARGS_ID_Q3,
+    NYMYA_RT_ARGS_ID_Q_ARR,
+    NYMYA_RT_ARGS_ID_Q3D,
+    NYMYA_RT_ARGS_ID_Q4D,
+    NYMYA_RT_ARGS_ID_Q5D,
+    NYMYA_RT_ARGS_ID_DEUTSCH,
+    NYMYA_RT_ARGS_ID_QRNG,
+};
+
+#define NYMYA_RT_SHAPE_ARGS_Q            NYMYA_RT_ARGS_ID_Q
+#define NYMYA_RT_SHAPE_ARGS_Q_THETA      NYMYA_RT_ARGS_ID_Q_THETA
+#define NYMYA_RT_SHAPE_ARGS_Q_AXIS_THETA NYMYA_RT_ARGS_ID_Q_AXIS_THETA
+#define NYMYA_RT_SHAPE_ARGS_Q2           NYMYA_RT_ARGS_ID_Q2
+#define NYMYA_RT_SHAPE_ARGS_Q2_THETA     NYMYA_RT_ARGS_ID_Q2_THETA
+#define NYMYA_RT_SHAPE_ARGS_Q3           NYMYA_RT_ARGS_ID_Q3
+#define NYMYA_RT_SHAPE_ARGS_QARR         NYMYA_RT_ARGS_ID_Q_ARR
+#define NYMYA_RT_SHAPE_ARGS_QLIST        NYMYA_RT_ARGS_ID_Q_ARR
+#define NYMYA_RT_SHAPE_ARGS_QPOS3        NYMYA_RT_ARGS_ID_Q3D
+#define NYMYA_RT_SHAPE_ARGS_QPOS4        NYMYA_RT_ARGS_ID_Q4D
+#define NYMYA_RT_SHAPE_ARGS_QPOS5        NYMYA_RT_ARGS_ID_Q5D
+#define NYMYA_RT_SHAPE_ARGS_ORACLE       NYMYA_RT_ARGS_ID_DEUTSCH
+#define NYMYA_RT_SHAPE_ARGS_QRNG         NYMYA_RT_ARGS_ID_QRNG
+
+// Paste after expanding, so NYMYA_CNOT_CODE becomes 3309 first
+#define NYMYA_RT_PASTE_(a, b) a##b
+#define NYMYA_RT_PASTE(a, b) NYMYA_RT_PASTE_(a, b)
+
+// NYMYA_RT_CORE_ARGS_<code>: the struct the core shape of <code> takes
+#define NYMYA_RT_CORE_ARGS(code, name, shape, n_min, kcore) \
+    NYMYA_RT_CORE_ARGS_##code = NYMYA_RT_SHAPE_ARGS_##shape,
+enum { NYMYA_GATES(NYMYA_RT_CORE_ARGS) };
+#undef NYMYA_RT_CORE_ARGS
+
+// NYMYA_RT_LISTED_<code>: a second entry for a code redeclares it
+#define NYMYA_RT_LISTED(name, code, args) NYMYA_RT_PASTE(NYMYA_RT_LISTED_, code),
+enum { NYMYA_GATE_LIST(NYMYA_RT_LISTED) };
+#undef NYMYA_RT_LISTED
+
+#define NYMYA_RT_CHECK_ARGS(name, code, args) \
+    _Static_assert((int)NYMYA_RT_PASTE(NYMYA_RT_CORE_ARGS_, code) == (int)NYMYA_RT_ARGS_ID_##args, \
+                   "NYMYA_GATE_LIST: " #name " takes a different struct than NYMYA_GATES");
+NYMYA_GATE_LIST(NYMYA_RT_CHECK_ARGS)
+#undef NYMYA_RT_CHECK_ARGS
+
+#define NYMYA_GATE_LIST_ONE(name, code, args) + 1
+#define NYMYA_GATES_ONE(code, name, shape, n_min, kcore) + 1
+_Static_assert((0 NYMYA_GATE_LIST(NYMYA_GATE_LIST_ONE)) == (0 NYMYA_GATES(NYMYA_GATES_ONE)),
+               "NYMYA_GATE_LIST and NYMYA_GATES list different gates");
+#undef NYMYA_GATE_LIST_ONE
+#undef NYMYA_GATES_ONE
+
+#endif // NYMYA_GATES_H
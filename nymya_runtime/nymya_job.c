@@ -0,0 +1,488 @@
+// runtime/nymya_job.c
+//
+// Asynchronous job queue of the gate-QPU backend. A submitted circuit is
+// serialized once into a nymya_qpu_request and queued; dispatcher threads
+// hand requests to the attached device, up to its in-flight limit, so the
+// caller keeps working while jobs wait in the device queue. Connections to
+// the device are pooled across jobs and shared up to its stream limit, and
+// transient failures are retried with backoff.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "nymya_runtime.h"
+#include "nymya_circuit.h"
+#include "nymya_qpu.h"
+#include "backend_gateqpu.h"
+#include "qpu_route.h"
+
+/**
+ * nymya_job - One submitted circuit.
+ * @req: Serialized circuit and its result buffer.
+ * @state: Where the job is; terminal once DONE or FAILED.
+ * @settled: Set after the completion callback returned; the job may then be freed.
+ * @borrowed: @req's ops and ids belong to the submitter, e.g. a mapped circuit file.
+ * @routed: @req's ops were routed for the device and belong to the job.
+ * @done: Completion callback, or NULL.
+ * @user: Passed to @done.
+ * @next: Queue link.
+ */
+struct nymya_job {
+    nymya_qpu_request req;
+    nymya_job_state state;
+    int settled;
+    int borrowed;
+    int routed;
+    nymya_job_fn done;
+    void* user;
+    struct nymya_job* next;
+};
+
+/**
+ * job_conn - A device connection kept open between jobs.
+ * @handle: From the device's connect(); NULL while @opening.
+ * @users: Requests running on it or waiting for it to open.
+ * @opening: Set while connect() runs; requests may already join it.
+ * @broken: Set when a request gave up on it; it closes once unused.
+ * @idle_since: When @users last dropped to zero, in job_now_ms() time.
+ * @next: Pool link.
+ */
+typedef struct job_conn {
+    void* handle;
+    unsigned int users;
+    int opening;
+    int broken;
+    uint64_t idle_since;
+    struct job_conn* next;
+} job_conn;
+
+// Queue, pool and job state, all guarded by job_lock
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_settled = PTHREAD_COND_INITIALIZER;
+static nymya_job* job_head;
+static nymya_job* job_tail;
+static const nymya_qpu_device* job_device;
+static unsigned int job_limit;
+static unsigned int job_threads;
+static unsigned int job_running;
+static size_t job_pending;
+static job_conn* job_conns;
+static uint64_t job_paused_until;
+
+// Device settings with the defaults filled in
+static unsigned int job_streams;
+static unsigned int job_keepalive_ms;
+static unsigned int job_retries;
+static unsigned int job_backoff_ms;
+static unsigned int job_backoff_max_ms;
+
+// CLOCK_REALTIME in ms, the clock pthread_cond_timedwait() uses
+static uint64_t job_now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void job_wait_until(uint64_t ms) {
+    struct timespec ts = { .tv_sec = (time_t)(ms / 1000), .tv_nsec = (long)(ms % 1000) * 1000000 };
+
+    pthread_cond_timedwait(&job_ready, &job_lock, &ts);
+}
+
+// Moves connections that are broken and unused, or idle past the keep-alive,
+// onto @out; returns when the next idle one expires (0 = none)
+static uint64_t job_conn_reap(job_conn** out, uint64_t now) {
+    uint64_t next = 0;
+
+    for (job_conn** p = &job_conns; *p;) {
+        job_conn* c = *p;
+        uint64_t expiry = c->idle_since + job_keepalive_ms;
+
+        if (!c->users && (c->broken || expiry <= now)) {
+            *p = c->next;
+            c->next = *out;
+            *out = c;
+            continue;
+        }
+        if (!c->users && (!next || expiry < next)) next = expiry;
+        p = &c->next;
+    }
+    return next;
+}
+
+// Closes reaped connections; called without job_lock, which it may not need
+static void job_conn_close(const nymya_qpu_device* dev, job_conn* list) {
+    while (list) {
+        job_conn* c = list;
+        list = c->next;
+        if (dev && dev->disconnect && c->handle) dev->disconnect(dev->ctx, c->handle);
+        free(c);
+    }
+}
+
+int nymya_qpu_set_device(const nymya_qpu_device* dev) {
+    const nymya_qpu_device* old;
+    job_conn* stale;
+
+    if (dev && !dev->run) return -1;
+    pthread_mutex_lock(&job_lock);
+    if (job_pending) {
+        pthread_mutex_unlock(&job_lock);
+        fprintf(stderr, "[QPU] Cannot change device with %zu jobs in flight.\n", job_pending);
+        return -1;
+    }
+    old = job_device;
+    stale = job_conns;
+    job_conns = NULL;
+    job_paused_until = 0;
+    job_device = dev;
+    job_limit = 0;
+    if (dev) {
+        job_limit = dev->max_inflight ? dev->max_inflight : NYMYA_QPU_DEFAULT_INFLIGHT;
+        if (job_limit > NYMYA_QPU_MAX_INFLIGHT) job_limit = NYMYA_QPU_MAX_INFLIGHT;
+        job_streams = dev->streams ? dev->streams : 1;
+        job_keepalive_ms = dev->keepalive_ms ? dev->keepalive_ms : NYMYA_QPU_DEFAULT_KEEPALIVE_MS;
+        job_retries = dev->max_retries ? dev->max_retries : NYMYA_QPU_DEFAULT_RETRIES;
+        job_backoff_ms = dev->backoff_ms ? dev->backoff_ms : NYMYA_QPU_DEFAULT_BACKOFF_MS;
+        job_backoff_max_ms = dev->backoff_max_ms ? dev->backoff_max_ms : NYMYA_QPU_DEFAULT_BACKOFF_MAX_MS;
+        if (job_backoff_max_ms < job_backoff_ms) job_backoff_max_ms = job_backoff_ms;
+    }
+    pthread_mutex_unlock(&job_lock);
+    job_conn_close(old, stale);
+    return 0;
+}
+
+static void job_conn_put(const nymya_qpu_device* dev, job_conn* c, int broken);
+
+/**
+ * job_conn_get - Picks a connection for one request, opening one if needed.
+ * @dev: Attached device; it has a connect() callback.
+ *
+ * Fills the busiest connection with a free stream first, counting ones
+ * still opening, so concurrent requests share connections rather than each
+ * opening its own.
+ *
+ * Returns the connection with the request counted as a user, or NULL if
+ * connect() failed; a ready connection either way if non-NULL.
+ */
+static job_conn* job_conn_get(const nymya_qpu_device* dev) {
+    job_conn* best = NULL;
+    job_conn* c;
+
+    pthread_mutex_lock(&job_lock);
+    for (c = job_conns; c; c = c->next) {
+        if (!c->broken && c->users < job_streams && (!best || c->users > best->users))
+            best = c;
+    }
+    if (best) {
+        best->users++;
+        while (best->opening) pthread_cond_wait(&job_ready, &job_lock);
+        if (best->broken && !best->handle) {
+            pthread_mutex_unlock(&job_lock);
+            job_conn_put(dev, best, 1);
+            return NULL;
+        }
+        pthread_mutex_unlock(&job_lock);
+        return best;
+    }
+    c = calloc(1, sizeof(*c));
+    if (!c) {
+        pthread_mutex_unlock(&job_lock);
+        return NULL;
+    }
+    c->users = 1;
+    c->opening = 1;
+    c->next = job_conns;
+    job_conns = c;
+    pthread_mutex_unlock(&job_lock);
+
+    // Connection setup can take a network round trip or more
+    void* handle = dev->connect(dev->ctx);
+
+    pthread_mutex_lock(&job_lock);
+    c->handle = handle;
+    c->opening = 0;
+    c->broken = !handle;
+    pthread_cond_broadcast(&job_ready);
+    pthread_mutex_unlock(&job_lock);
+    if (!handle) {
+        job_conn_put(dev, c, 1);
+        return NULL;
+    }
+    return c;
+}
+
+static void job_conn_put(const nymya_qpu_device* dev, job_conn* c, int broken) {
+    job_conn* dead = NULL;
+
+    pthread_mutex_lock(&job_lock);
+    c->users--;
+    c->broken |= broken;
+    if (!c->users) {
+        c->idle_since = job_now_ms();
+        job_conn_reap(&dead, c->idle_since);
+    }
+    // Idle dispatchers recompute when the pool next expires
+    pthread_cond_broadcast(&job_ready);
+    pthread_mutex_unlock(&job_lock);
+    job_conn_close(dev, dead);
+}
+
+// Delay before retry @attempt (0-based): exponential, capped, half of it jittered
+static unsigned int job_backoff(unsigned int attempt, uint64_t* seed) {
+    uint64_t d = job_backoff_ms;
+
+    while (attempt-- && d < job_backoff_max_ms) d *= 2;
+    if (d > job_backoff_max_ms) d = job_backoff_max_ms;
+    *seed = *seed * 6364136223846793005ull + 1442695040888963407ull;
+    return (unsigned int)(d / 2 + (*seed >> 33) % (d / 2 + 1));
+}
+
+/**
+ * job_route - Places a job on the qubits of a device with a coupling map.
+ * @dev: Attached device.
+ * @j: Job about to run for the first time.
+ *
+ * Runs on the dispatcher, so submitting stays cheap and the map is that of
+ * the device the job runs on.
+ *
+ * Returns 0, or -1 if the job does not fit the device.
+ */
+static int job_route(const nymya_qpu_device* dev, nymya_job* j) {
+    qpu_routed r;
+
+    if (qpu_route(&j->req, dev, &r)) return -1;
+    if (!r.ops) return 0;
+    if (!j->borrowed) free(j->req.ops);
+    j->req.ops = r.ops;
+    j->req.nops = r.nops;
+    j->req.phys = r.phys;
+    j->routed = 1;
+    return 0;
+}
+
+/**
+ * job_run - Runs one job on the device, with retries.
+ * @dev: Attached device.
+ * @j: Job in the RUNNING state.
+ * @seed: Jitter state of the dispatcher.
+ *
+ * Returns 0 if the device completed the job, -1 otherwise.
+ */
+static int job_run(const nymya_qpu_device* dev, nymya_job* j, uint64_t* seed) {
+    for (unsigned int attempt = 0;; attempt++) {
+        job_conn* c = NULL;
+        int rc;
+
+        j->req.retry_after_ms = 0;
+        if (dev->connect && !(c = job_conn_get(dev))) {
+            rc = NYMYA_QPU_RECONNECT;
+        } else {
+            rc = dev->run(dev->ctx, c ? c->handle : NULL, &j->req);
+            if (c) job_conn_put(dev, c, rc == NYMYA_QPU_RECONNECT);
+        }
+        if (rc != NYMYA_QPU_RETRY && rc != NYMYA_QPU_RECONNECT) return rc ? -1 : 0;
+        if (attempt == job_retries) {
+            fprintf(stderr, "[QPU] Giving up on a job after %u attempts on %s.\n",
+                    attempt + 1, dev->name ? dev->name : "device");
+            return -1;
+        }
+
+        // A failed attempt may have left shots behind
+        memset(j->req.bits, 0, (j->req.words ? (size_t)j->req.shots * j->req.words : 1) *
+                               sizeof(uint64_t));
+        uint64_t now = job_now_ms();
+        uint64_t until = now + job_backoff(attempt, seed);
+        pthread_mutex_lock(&job_lock);
+        if (j->req.retry_after_ms && now + j->req.retry_after_ms > job_paused_until)
+            job_paused_until = now + j->req.retry_after_ms;
+        if (job_paused_until > until) until = job_paused_until;
+        while ((now = job_now_ms()) < until) job_wait_until(until);
+        pthread_mutex_unlock(&job_lock);
+    }
+}
+
+static void* job_dispatch(void* arg) {
+    uint64_t seed = (uint64_t)(uintptr_t)&arg ^ job_now_ms();
+
+    (void)arg;
+    pthread_mutex_lock(&job_lock);
+    for (;;) {
+        for (;;) {
+            job_conn* dead = NULL;
+            uint64_t now = job_now_ms();
+            uint64_t wake = job_conn_reap(&dead, now);
+
+            if (dead) {
+                // Closing may block; the pool is re-read afterwards
+                const nymya_qpu_device* dev = job_device;
+                pthread_mutex_unlock(&job_lock);
+                job_conn_close(dev, dead);
+                pthread_mutex_lock(&job_lock);
+                continue;
+            }
+            if (job_head && job_running < job_limit && job_paused_until <= now) break;
+            if (job_head && job_running < job_limit && (!wake || job_paused_until < wake))
+                wake = job_paused_until;
+            if (wake) job_wait_until(wake);
+            else pthread_cond_wait(&job_ready, &job_lock);
+        }
+
+        nymya_job* j = job_head;
+        job_head = j->next;
+        if (!job_head) job_tail = NULL;
+        j->state = NYMYA_JOB_RUNNING;
+        job_running++;
+        const nymya_qpu_device* dev = job_device;
+        pthread_mutex_unlock(&job_lock);
+
+        int rc = job_route(dev, j);
+        if (!rc) rc = job_run(dev, j, &seed);
+        if (rc) fprintf(stderr, "[QPU] Job failed on %s.\n", dev->name ? dev->name : "device");
+
+        pthread_mutex_lock(&job_lock);
+        j->state = rc ? NYMYA_JOB_FAILED : NYMYA_JOB_DONE;
+        pthread_mutex_unlock(&job_lock);
+
+        if (j->done) j->done(j, j->user);
+
+        pthread_mutex_lock(&job_lock);
+        j->settled = 1;
+        job_running--;
+        job_pending--;
+        pthread_cond_broadcast(&job_settled);
+        pthread_cond_signal(&job_ready);
+    }
+    return NULL;
+}
+
+// Grows the dispatcher pool to the device limit; called with job_lock held
+static int job_spawn(void) {
+    while (job_threads < job_limit) {
+        pthread_t t;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        int rc = pthread_create(&t, &attr, job_dispatch, NULL);
+        pthread_attr_destroy(&attr);
+        if (rc) break;
+        job_threads++;
+    }
+    return job_threads ? 0 : -1;
+}
+
+static void job_release(nymya_job* j) {
+    if (!j->borrowed || j->routed) free(j->req.ops);
+    if (!j->borrowed) free(j->req.ids);
+    free((uint32_t*)j->req.phys);
+    free(j->req.bits);
+    free(j);
+}
+
+// Allocates the result buffer of a serialized job and queues it
+static nymya_job* job_queue(nymya_job* j, unsigned int shots) {
+    j->state = NYMYA_JOB_QUEUED;
+    j->req.shots = shots;
+    j->req.words = (j->req.nqubits + 63) / 64;
+    if (j->req.words && shots > SIZE_MAX / sizeof(uint64_t) / j->req.words) {
+        job_release(j);
+        return NULL;
+    }
+    j->req.bits = calloc(j->req.words ? (size_t)shots * j->req.words : 1, sizeof(uint64_t));
+    if (!j->req.bits) {
+        job_release(j);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&job_lock);
+    if (!job_device || job_spawn()) {
+        pthread_mutex_unlock(&job_lock);
+        fprintf(stderr, "[QPU] %s\n", job_device ? "Failed to start job dispatchers."
+                                                 : "No QPU device attached.");
+        job_release(j);
+        return NULL;
+    }
+    if (job_tail) job_tail->next = j;
+    else job_head = j;
+    job_tail = j;
+    job_pending++;
+    pthread_cond_signal(&job_ready);
+    pthread_mutex_unlock(&job_lock);
+    return j;
+}
+
+nymya_job* nymya_submit_async(const nymya_circuit* c, unsigned int shots,
+                              nymya_job_fn done, void* user) {
+    nymya_job* j;
+
+    if (!c || !shots || nymya_circuit_unbound(c)) return NULL;
+    j = calloc(1, sizeof(*j));
+    if (!j) return NULL;
+    j->done = done;
+    j->user = user;
+    if (backend_gateqpu_lower(c, &j->req)) {
+        free(j);
+        return NULL;
+    }
+    return job_queue(j, shots);
+}
+
+nymya_job* nymya_job_submit_borrowed(const nymya_qpu_request* req, nymya_job_fn done, void* user) {
+    nymya_job* j;
+
+    if (!req->shots) return NULL;
+    j = calloc(1, sizeof(*j));
+    if (!j) return NULL;
+    j->req.ops = req->ops;
+    j->req.nops = req->nops;
+    j->req.ids = req->ids;
+    j->req.nqubits = req->nqubits;
+    j->borrowed = 1;
+    j->done = done;
+    j->user = user;
+    return job_queue(j, req->shots);
+}
+
+// Non-zero while a device is attached; lets callers skip a submission quietly
+int nymya_job_device_attached(void) {
+    pthread_mutex_lock(&job_lock);
+    int attached = job_device != NULL;
+    pthread_mutex_unlock(&job_lock);
+    return attached;
+}
+
+nymya_job_state nymya_job_poll(const nymya_job* j) {
+    pthread_mutex_lock(&job_lock);
+    nymya_job_state st = j->state;
+    pthread_mutex_unlock(&job_lock);
+    return st;
+}
+
+int nymya_job_wait(nymya_job* j) {
+    pthread_mutex_lock(&job_lock);
+    while (!j->settled) pthread_cond_wait(&job_settled, &job_lock);
+    nymya_job_state st = j->state;
+    pthread_mutex_unlock(&job_lock);
+    return st == NYMYA_JOB_DONE ? 0 : -1;
+}
+
+int nymya_job_get_result(const nymya_job* j, nymya_job_result* out) {
+    if (nymya_job_poll(j) != NYMYA_JOB_DONE) return -1;
+    out->shots = j->req.shots;
+    out->nqubits = j->req.nqubits;
+    out->words = j->req.words;
+    out->ids = j->req.ids;
+    out->bits = j->req.bits;
+    return 0;
+}
+
+void nymya_job_free(nymya_job* j) {
+    if (!j) return;
+    nymya_job_wait(j);
+    job_release(j);
+}
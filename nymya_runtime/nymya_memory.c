@@ -0,0 +1,313 @@
+// nymya_memory.c
+//
+// Memory estimates and the admission budget. Before a job runs, the runtime
+// works out the peak bytes it needs on the chosen backend from the circuit
+// alone: its distinct qubits give the register width, the lowered gates give
+// the matrices and the fusion plan, and the shot count gives the sampling
+// tables. nymya_runtime.c compares the total against the budget and rejects
+// or downgrades jobs over it; backend_sim.c applies the same budget to
+// register growth from streamed gates.
+//
+// Estimates are upper bounds: a register is counted at its final width, and
+// a growth or precision change counts the old and the new array together.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "nymya_memory.h"
+#include "backend_sim.h"
+#include "backend_mps.h"
+#include "sim_statevec.h"
+#include "sim_compile.h"
+
+static size_t mem_budget;
+static nymya_mem_policy mem_policy;
+static pthread_once_t mem_once = PTHREAD_ONCE_INIT;
+
+// Memory limit of the process's cgroup (v2), or 0 if there is none
+static size_t mem_cgroup_limit(void) {
+    FILE* f = fopen("/sys/fs/cgroup/memory.max", "r");
+    unsigned long long v = 0;
+
+    if (!f) return 0;
+    if (fscanf(f, "%llu", &v) != 1) v = 0;
+    fclose(f);
+    return (size_t)v;
+}
+
+// Physical memory of the host, capped by the cgroup limit
+static size_t mem_auto_budget(void) {
+    long pages = sysconf(_SC_PHYS_PAGES), page = sysconf(_SC_PAGESIZE);
+    size_t host = pages > 0 && page > 0 ? (size_t)pages * (size_t)page : 0;
+    size_t cg = mem_cgroup_limit();
+
+    if (cg && (!host || cg < host)) return cg;
+    return host;
+}
+
+/**
+ * nymya_mem_parse_size - Parses a byte count such as "512M" or "8G".
+ * @s: Digits with an optional K, M, G or T suffix (powers of 1024).
+ * @out: Receives the count.
+ *
+ * Returns 0 on success, -1 if @s is not a size.
+ */
+int nymya_mem_parse_size(const char* s, size_t* out) {
+    char* end;
+    unsigned long long v = strtoull(s, &end, 10);
+    unsigned int shift = 0;
+
+    if (end == s) return -1;
+    switch (*end) {
+        case 'k': case 'K': shift = 10; break;
+        case 'm': case 'M': shift = 20; break;
+        case 'g': case 'G': shift = 30; break;
+        case 't': case 'T': shift = 40; break;
+        case '\0': break;
+        default: return -1;
+    }
+    if (*end && end[1] && strcmp(end + 1, "B") != 0 && strcmp(end + 1, "iB") != 0) return -1;
+    if (v > (SIZE_MAX >> shift)) return -1;
+    *out = (size_t)v << shift;
+    return 0;
+}
+
+// Reads NYMYA_MEM_BUDGET and NYMYA_MEM_POLICY once
+static void mem_init(void) {
+    const char* env = getenv("NYMYA_MEM_BUDGET");
+    size_t bytes = 0;
+
+    if (env && strcmp(env, "auto") == 0) {
+        bytes = mem_auto_budget();
+    } else if (env && *env && nymya_mem_parse_size(env, &bytes)) {
+        fprintf(stderr, "[nymya_runtime] Ignoring NYMYA_MEM_BUDGET=%s; expected bytes, "
+                "e.g. 512M, or \"auto\".\n", env);
+        bytes = 0;
+    }
+    __atomic_store_n(&mem_budget, bytes, __ATOMIC_RELAXED);
+
+    env = getenv("NYMYA_MEM_POLICY");
+    if (env && strcmp(env, "reject") == 0)
+        __atomic_store_n(&mem_policy, NYMYA_MEM_REJECT, __ATOMIC_RELAXED);
+    else if (env && *env && strcmp(env, "downgrade") != 0)
+        fprintf(stderr, "[nymya_runtime] Ignoring NYMYA_MEM_POLICY=%s; expected \"reject\" "
+                "or \"downgrade\".\n", env);
+}
+
+size_t nymya_mem_budget(void) {
+    pthread_once(&mem_once, mem_init);
+    return __atomic_load_n(&mem_budget, __ATOMIC_RELAXED);
+}
+
+nymya_mem_policy nymya_mem_get_policy(void) {
+    pthread_once(&mem_once, mem_init);
+    return __atomic_load_n(&mem_policy, __ATOMIC_RELAXED);
+}
+
+/**
+ * nymya_set_mem_budget - Sets the memory budget jobs are admitted against.
+ * @bytes: Budget per job, 0 for none.
+ * @policy: What happens to a job over it.
+ *
+ * Overrides NYMYA_MEM_BUDGET and NYMYA_MEM_POLICY for every thread.
+ */
+void nymya_set_mem_budget(size_t bytes, nymya_mem_policy policy) {
+    pthread_once(&mem_once, mem_init);
+    __atomic_store_n(&mem_budget, bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&mem_policy, policy, __ATOMIC_RELAXED);
+}
+
+size_t nymya_get_mem_budget(nymya_mem_policy* policy) {
+    if (policy) *policy = nymya_mem_get_policy();
+    return nymya_mem_budget();
+}
+
+// Bytes in MiB, for messages
+double nymya_mem_mib(size_t bytes) {
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+// Saturating arithmetic, so an estimate of an impossible job stays comparable
+static size_t mem_add(size_t a, size_t b) {
+    return a > SIZE_MAX - b ? SIZE_MAX : a + b;
+}
+
+static size_t mem_mul(size_t a, size_t b) {
+    return b && a > SIZE_MAX / b ? SIZE_MAX : a * b;
+}
+
+// @esz bytes for each of 2^@n amplitudes
+static size_t mem_amps(size_t n, size_t esz) {
+    if (n >= sizeof(size_t) * 8) return SIZE_MAX;
+    return mem_mul((size_t)1 << n, esz);
+}
+
+static void mem_total(nymya_mem_estimate* e) {
+    e->total = mem_add(mem_add(e->state, e->scratch), mem_add(e->matrices, e->sampling));
+}
+
+static int mem_cmp_id(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * mem_qubits - Counts the distinct qubits of a circuit.
+ * @c: Circuit, or NULL for none.
+ * @distinct: Receives the number of distinct qubit IDs.
+ * @absent: If not NULL, receives how many of them the thread's register lacks.
+ *
+ * Returns 0 on success, -1 on allocation failure.
+ */
+static int mem_qubits(const nymya_circuit* c, size_t* distinct, size_t* absent) {
+    uint64_t* ids;
+    size_t n = 0, out = 0;
+
+    *distinct = 0;
+    if (absent) *absent = 0;
+    if (!c || !c->nids) return 0;
+    ids = malloc(c->nids * sizeof(*ids));
+    if (!ids) return -1;
+    memcpy(ids, c->ids, c->nids * sizeof(*ids));
+    qsort(ids, c->nids, sizeof(*ids), mem_cmp_id);
+    for (size_t i = 0; i < c->nids; i++) {
+        if (i && ids[i] == ids[i - 1]) continue;
+        n++;
+        if (absent && !backend_sim_has_qubit(ids[i])) out++;
+    }
+    free(ids);
+    *distinct = n;
+    if (absent) *absent = out;
+    return 0;
+}
+
+/**
+ * nymya_mem_estimate_sim - Peak memory of a job on the state-vector simulator.
+ * @c: Circuit, or NULL to estimate the live register only.
+ * @precision: Storage the job runs in; DEFAULT keeps the register's current one.
+ * @mode: Which registers the job uses.
+ * @workers: Worker threads of a batch or gradient; ignored for NYMYA_MEM_LIVE.
+ * @shots: Draws of a following nymya_sample(), or 0.
+ * @out: Receives the estimate.
+ *
+ * A live register grows to the circuit's qubits it does not hold yet; the
+ * last doubling keeps the old half alongside the new array, and a change of
+ * storage keeps both arrays of the current width. Batch workers each grow a
+ * fresh register; a gradient worker holds a prefix and a copy of it.
+ *
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int nymya_mem_estimate_sim(const nymya_circuit* c, nymya_precision precision, nymya_mem_mode mode,
+                           unsigned int workers, unsigned int shots, nymya_mem_estimate* out) {
+    int cur = backend_sim_precision(), want = cur;
+    size_t esz, esz_cur, n, absent = 0, regs;
+    sim_ops ops = { 0 };
+
+    memset(out, 0, sizeof(*out));
+    out->backend = "sim";
+    if (precision == NYMYA_PRECISION_DOUBLE) want = SIM_SV_DOUBLE;
+    else if (precision == NYMYA_PRECISION_FLOAT) want = SIM_SV_FLOAT;
+    else if (precision == NYMYA_PRECISION_MIXED) want = SIM_SV_MIXED;
+    out->precision = want == SIM_SV_DOUBLE ? NYMYA_PRECISION_DOUBLE :
+                     want == SIM_SV_FLOAT ? NYMYA_PRECISION_FLOAT : NYMYA_PRECISION_MIXED;
+    esz = want == SIM_SV_DOUBLE ? sizeof(double complex) : sizeof(float complex);
+    esz_cur = cur == SIM_SV_DOUBLE ? sizeof(double complex) : sizeof(float complex);
+    if (workers < 1) workers = 1;
+
+    if (mem_qubits(c, &n, mode == NYMYA_MEM_LIVE ? &absent : NULL)) return -1;
+    if (mode == NYMYA_MEM_LIVE) {
+        size_t live = backend_sim_num_qubits(), grow = 0, conv = 0;
+
+        n = live + absent;
+        out->state = mem_amps(n, esz);
+        if (absent) grow = mem_amps(n - 1, esz);
+        if (esz != esz_cur) conv = mem_amps(live, esz < esz_cur ? esz : esz_cur);
+        out->scratch = grow > conv ? grow : conv;
+    } else {
+        // A gradient worker's prefix grows before its work register exists
+        regs = mode == NYMYA_MEM_SHIFT ? 2 : 1;
+        out->state = mem_mul(mem_mul(mem_amps(n, esz), regs), workers);
+        if (mode == NYMYA_MEM_BATCH && n)
+            out->scratch = mem_mul(mem_amps(n - 1, esz), workers);
+    }
+    out->qubits = n;
+
+    if (c && backend_sim_lower_circuit(c, NULL, &ops) == 0) {
+        size_t lowered = ops.cap * sizeof(*ops.ops) + ops.mats_cap * sizeof(*ops.mats);
+
+        // Batch workers lower the circuit each; a gradient shares one lowering
+        if (mode == NYMYA_MEM_BATCH) lowered = mem_mul(lowered, workers);
+        out->matrices = lowered;
+        if (mode != NYMYA_MEM_SHIFT)
+            out->matrices = mem_add(out->matrices, mem_mul(sim_plan_bytes(&ops), workers));
+    }
+    sim_ops_free(&ops);
+
+    // Arrival times and rows in backend_sim_sample(), scaled draws in sim_sv_sample()
+    out->sampling = mem_mul(shots, 2 * sizeof(double) + sizeof(uint32_t));
+    mem_total(out);
+    return 0;
+}
+
+/**
+ * nymya_mem_estimate_mps - Peak memory of a circuit on the MPS backend.
+ * @c: Circuit, or NULL for the live chain only.
+ * @out: Receives the estimate.
+ *
+ * Every bond is taken at the largest dimension the cap and its position in
+ * the chain allow, with the circuit's qubits appended to the live chain.
+ * The scratch is that of one two-site split at the largest bond.
+ */
+void nymya_mem_estimate_mps(const nymya_circuit* c, nymya_mem_estimate* out) {
+    nymya_mps_stats st;
+    size_t chi = backend_mps_max_bond(), n = 0, top = 1;
+
+    memset(out, 0, sizeof(*out));
+    out->backend = "mps";
+    out->precision = NYMYA_PRECISION_DOUBLE;
+    backend_mps_get_stats(&st);
+    if (mem_qubits(c, &n, NULL)) n = c ? c->nids : 0;
+    n += st.qubits;
+    out->qubits = n;
+
+    for (size_t i = 0; i < n; i++) {
+        size_t l = i < n - i ? i : n - i, r = i + 1 < n - i - 1 ? i + 1 : n - i - 1;
+        size_t dl = l < 63 && ((size_t)1 << l) < chi ? (size_t)1 << l : chi;
+        size_t dr = r < 63 && ((size_t)1 << r) < chi ? (size_t)1 << r : chi;
+
+        if (dr > top) top = dr;
+        out->state = mem_add(out->state, mem_mul(2 * dl * dr, sizeof(double complex)));
+    }
+    // The two-site tensor, its SVD input and the U, V and V^H factors
+    if (n > 1) out->scratch = mem_mul(5 * 4 * top * top, sizeof(double complex));
+    mem_total(out);
+}
+
+/**
+ * nymya_mem_estimate_stabilizer - Memory of a Clifford circuit's tableau.
+ * @c: Circuit.
+ * @out: Receives the estimate.
+ *
+ * The tableau keeps a bit matrix of twice its qubit capacity, a power of
+ * two from 64 up; growing it holds the old matrices beside the new ones.
+ */
+void nymya_mem_estimate_stabilizer(const nymya_circuit* c, nymya_mem_estimate* out) {
+    size_t n = 0, cap = 64, bytes;
+
+    memset(out, 0, sizeof(*out));
+    out->backend = "stabilizer";
+    out->precision = NYMYA_PRECISION_DEFAULT;
+    if (mem_qubits(c, &n, NULL)) n = c ? c->nids : 0;
+    while (cap < n) cap *= 2;
+    out->qubits = n;
+
+    // x and z bits, signs, IDs and the ID map
+    bytes = mem_add(mem_mul(2 * cap, 2 * cap / 8), 2 * cap / 8 + cap * 8 + 2 * cap * 16);
+    out->state = bytes;
+    if (cap > 64) out->scratch = bytes / 4;
+    mem_total(out);
+}
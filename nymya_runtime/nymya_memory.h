@@ -0,0 +1,25 @@
+#ifndef NYMYA_MEMORY_H
+#define NYMYA_MEMORY_H
+
+#include <stddef.h>
+#include "nymya_circuit.h"
+
+// Registers a simulator estimate covers
+typedef enum nymya_mem_mode {
+    NYMYA_MEM_LIVE,   // the calling thread's register, grown by the circuit
+    NYMYA_MEM_BATCH,  // one fresh register per worker (batches, noise trajectories)
+    NYMYA_MEM_SHIFT   // a prefix and a work register per worker (nymya_gradient())
+} nymya_mem_mode;
+
+// Budget in bytes, 0 for none; NYMYA_MEM_BUDGET is read on the first call
+size_t nymya_mem_budget(void);
+nymya_mem_policy nymya_mem_get_policy(void);
+double nymya_mem_mib(size_t bytes);
+int nymya_mem_parse_size(const char* s, size_t* out);
+
+int nymya_mem_estimate_sim(const nymya_circuit* c, nymya_precision precision, nymya_mem_mode mode,
+                           unsigned int workers, unsigned int shots, nymya_mem_estimate* out);
+void nymya_mem_estimate_mps(const nymya_circuit* c, nymya_mem_estimate* out);
+void nymya_mem_estimate_stabilizer(const nymya_circuit* c, nymya_mem_estimate* out);
+
+#endif // NYMYA_MEMORY_H
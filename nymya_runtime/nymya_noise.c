@@ -0,0 +1,96 @@
+// nymya_noise.c
+//
+// Noise models for trajectory runs (see nymya_noisy_sample()). A model is a
+// list of channels keyed by gate code plus a readout error; backend_sim.c
+// applies the channels as it runs each trajectory, and the readout error is
+// applied here to the shots drawn from its final state.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "nymya_noise.h"
+#include "nymya_rng.h"
+
+nymya_noise* nymya_noise_new(void) {
+    return calloc(1, sizeof(nymya_noise));
+}
+
+void nymya_noise_free(nymya_noise* noise) {
+    if (!noise) return;
+    free(noise->rules);
+    free(noise);
+}
+
+// Probability argument is a number in [0, 1]; NaN fails both comparisons
+static int noise_prob_ok(double p) {
+    return p >= 0 && p <= 1;
+}
+
+/**
+ * nymya_noise_add - Attaches a channel to a gate code.
+ * @noise: Model.
+ * @gate_code: Gate the channel follows, or 0 for every gate.
+ * @channel: NYMYA_NOISE_DEPOLARIZING or NYMYA_NOISE_AMPLITUDE_DAMPING.
+ * @p: Strength in [0, 1].
+ *
+ * Several channels on one gate act in the order they were added.
+ *
+ * Returns 0 on success, -1 on invalid arguments or allocation failure.
+ */
+int nymya_noise_add(nymya_noise* noise, int gate_code, nymya_noise_channel channel, double p) {
+    if (!noise || !noise_prob_ok(p) || gate_code < 0 ||
+        (channel != NYMYA_NOISE_DEPOLARIZING && channel != NYMYA_NOISE_AMPLITUDE_DAMPING)) {
+        fprintf(stderr, "[nymya_runtime] Invalid noise channel for gate %d.\n", gate_code);
+        return -1;
+    }
+    if (noise->count == noise->cap) {
+        size_t cap = noise->cap ? 2 * noise->cap : 8;
+        nymya_noise_rule* rules = realloc(noise->rules, cap * sizeof(*rules));
+
+        if (!rules) return -1;
+        noise->rules = rules;
+        noise->cap = cap;
+    }
+    noise->rules[noise->count++] = (nymya_noise_rule){ gate_code, channel, p };
+    return 0;
+}
+
+/**
+ * nymya_noise_set_readout - Sets the readout error of sampled shots.
+ * @noise: Model.
+ * @p01: Probability that a 0 reads as 1.
+ * @p10: Probability that a 1 reads as 0.
+ *
+ * Returns 0 on success, -1 if a probability is outside [0, 1].
+ */
+int nymya_noise_set_readout(nymya_noise* noise, double p01, double p10) {
+    if (!noise || !noise_prob_ok(p01) || !noise_prob_ok(p10)) return -1;
+    noise->p01 = p01;
+    noise->p10 = p10;
+    return 0;
+}
+
+/**
+ * nymya_noise_readout - Applies the readout error to sampled shots.
+ * @noise: Model.
+ * @out: @shots rows packed as nymya_sample() fills them.
+ * @shots: Number of rows.
+ * @nqubits: Measured qubits per row.
+ *
+ * Draws one uniform per measured bit from the calling thread's generator,
+ * and none without a readout error.
+ */
+void nymya_noise_readout(const nymya_noise* noise, uint64_t* out, unsigned int shots, size_t nqubits) {
+    size_t words = (nqubits + 63) / 64;
+
+    if (!noise->p01 && !noise->p10) return;
+    for (unsigned int s = 0; s < shots; s++) {
+        uint64_t* row = out + (size_t)s * words;
+
+        for (size_t i = 0; i < nqubits; i++) {
+            uint64_t bit = 1ull << (i % 64);
+            double p = row[i / 64] & bit ? noise->p10 : noise->p01;
+
+            if (nymya_rng_unit() <= p) row[i / 64] ^= bit;
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef NYMYA_NOISE_H
+#define NYMYA_NOISE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "nymya_runtime.h"
+
+/**
+ * nymya_noise_rule - One channel attached to a gate code.
+ * @gate_code: Gate the channel follows, or 0 for every gate.
+ * @channel: Kind of channel.
+ * @p: Its strength, in [0, 1].
+ */
+typedef struct nymya_noise_rule {
+    int gate_code;
+    nymya_noise_channel channel;
+    double p;
+} nymya_noise_rule;
+
+/**
+ * nymya_noise - A noise model for trajectory runs.
+ * @rules: Gate channels, applied in the order they were added.
+ * @count: Number of rules.
+ * @cap: Allocated rules.
+ * @p01: Probability that a measured 0 reads as 1.
+ * @p10: Probability that a measured 1 reads as 0.
+ */
+struct nymya_noise {
+    nymya_noise_rule* rules;
+    size_t count;
+    size_t cap;
+    double p01;
+    double p10;
+};
+
+void nymya_noise_readout(const nymya_noise* noise, uint64_t* out, unsigned int shots, size_t nqubits);
+
+#endif // NYMYA_NOISE_H
@@ -0,0 +1,405 @@
+// nymya_profile.c
+//
+// Profiling mode of the runtime, switched on by the NYMYA_PROFILE
+// environment variable without rebuilding. Every executed gate call is timed
+// with the TSC (clock_gettime() where there is none) and charged to a
+// stack of frames: API entry point, circuit, backend, gate. At exit the
+// stacks are written in the folded format flamegraph.pl and speedscope
+// read ("nymya;circuit_run;circuit_<hash>;sim;hadamard <ns>"), and a table
+// of the gates and circuits by total time goes to stderr.
+//
+// NYMYA_PROFILE=1 writes the stacks to nymya-profile.<pid>.folded in the
+// working directory; any other value except "0" is taken as the file name.
+// Time a circuit call spends outside nymya_apply_gate(), such as a compiled
+// "sim" run whose gates are fused, is charged to its backend frame.
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "nymya_backend.h"
+#include "nymya_profile.h"
+
+int nymya_profile_on;
+
+/**
+ * prof_stack - Time charged to one folded stack.
+ * @entry: API entry point of the enclosing scope, or NULL outside any.
+ * @backend: Backend frame.
+ * @hash: Circuit of the enclosing scope, or 0.
+ * @gate_code: Gate frame, or 0 for the scope's own time.
+ * @calls: Gate calls, or scope runs for a scope's own time.
+ * @ticks: Time in ticks.
+ */
+typedef struct prof_stack {
+    const char* entry;
+    const char* backend;
+    uint64_t hash;
+    int gate_code;
+    uint64_t calls;
+    uint64_t ticks;
+} prof_stack;
+
+// Open-addressed set of stacks; @backend is NULL in empty slots
+typedef struct prof_table {
+    prof_stack* s;
+    size_t cap;
+    size_t used;
+} prof_table;
+
+/**
+ * prof_thread - Profile of one thread, kept until exit.
+ * @stacks: Stacks the thread charged time to.
+ * @gate_ticks: Ticks of all the thread's gate calls so far.
+ * @scope: Open outermost scope, or NULL.
+ * @next: Next registered thread.
+ */
+typedef struct prof_thread {
+    prof_table stacks;
+    uint64_t gate_ticks;
+    nymya_profile_scope* scope;
+    struct prof_thread* next;
+} prof_thread;
+
+// Threads, and every resize of a thread's table, are under prof_lock so the
+// exit dump never reads a table that is being freed
+static pthread_mutex_t prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static prof_thread* prof_threads;
+static __thread prof_thread* prof_self;
+
+static char prof_path[4096];
+static uint64_t prof_tick0;
+static uint64_t prof_ns0;
+
+#define PROF_GATE_NAME(name, code, args) [(code) - NYMYA_GATE_FIRST] = #name,
+static const char* const prof_gate_names[NYMYA_GATE_COUNT] = {
+    NYMYA_GATE_LIST(PROF_GATE_NAME)
+};
+
+static const char* prof_gate_name(int gate_code, char* buf, size_t len) {
+    unsigned int i = (unsigned int)(gate_code - NYMYA_GATE_FIRST);
+
+    if (i < NYMYA_GATE_COUNT && prof_gate_names[i]) return prof_gate_names[i];
+    snprintf(buf, len, "gate_%d", gate_code);
+    return buf;
+}
+
+static uint64_t prof_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * nymya_profile_ticks - Current time in profiling ticks.
+ *
+ * TSC cycles on x86, converted with the rate measured over the whole run,
+ * which assumes an invariant TSC as every x86 CPU of the last decade has;
+ * nanoseconds elsewhere.
+ */
+uint64_t nymya_profile_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return prof_ns();
+#endif
+}
+
+static size_t prof_slot(const prof_table* t, const prof_stack* k) {
+    uint64_t h = (uint64_t)(uintptr_t)k->entry * 0x9e3779b97f4a7c15ull;
+
+    h ^= (uint64_t)(uintptr_t)k->backend + 0x632be59bd9b4e019ull + (h << 6) + (h >> 2);
+    h ^= k->hash + ((uint64_t)(unsigned int)k->gate_code << 32) + (h << 6) + (h >> 2);
+    h ^= h >> 29;
+    return (size_t)h & (t->cap - 1);
+}
+
+static int prof_same(const prof_stack* a, const prof_stack* b) {
+    return a->entry == b->entry && a->backend == b->backend && a->hash == b->hash &&
+           a->gate_code == b->gate_code;
+}
+
+// Doubles @t; @shared if it belongs to a thread and the exit dump may read it
+static int prof_grow(prof_table* t, int shared) {
+    size_t cap = t->cap ? t->cap * 2 : 256;
+    prof_stack* s = calloc(cap, sizeof(*s));
+    prof_table n = { s, cap, 0 };
+
+    if (!s) return -1;
+    for (size_t i = 0; i < t->cap; i++) {
+        size_t j;
+
+        if (!t->s[i].backend) continue;
+        for (j = prof_slot(&n, &t->s[i]); n.s[j].backend; j = (j + 1) & (cap - 1))
+            ;
+        n.s[j] = t->s[i];
+        n.used++;
+    }
+    if (shared) pthread_mutex_lock(&prof_lock);
+    free(t->s);
+    *t = n;
+    if (shared) pthread_mutex_unlock(&prof_lock);
+    return 0;
+}
+
+// The table's entry for @k's stack, added if new; NULL when out of memory
+static prof_stack* prof_find(prof_table* t, const prof_stack* k, int shared) {
+    size_t i;
+
+    if (t->used * 4 >= t->cap * 3 && prof_grow(t, shared)) return NULL;
+    for (i = prof_slot(t, k); t->s[i].backend; i = (i + 1) & (t->cap - 1)) {
+        if (prof_same(&t->s[i], k)) return &t->s[i];
+    }
+    t->s[i] = *k;
+    t->s[i].calls = 0;
+    t->s[i].ticks = 0;
+    t->used++;
+    return &t->s[i];
+}
+
+static prof_thread* prof_thread_get(void) {
+    prof_thread* p = prof_self;
+
+    if (p) return p;
+    p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    pthread_mutex_lock(&prof_lock);
+    p->next = prof_threads;
+    prof_threads = p;
+    pthread_mutex_unlock(&prof_lock);
+    prof_self = p;
+    return p;
+}
+
+/**
+ * nymya_profile_gate - Charges a finished gate call to the calling thread.
+ * @gate_code: Gate that ran.
+ * @backend: Name of the backend it ran on.
+ * @t0: nymya_profile_ticks() before the call.
+ */
+void nymya_profile_gate(int gate_code, const char* backend, uint64_t t0) {
+    uint64_t dt = nymya_profile_ticks() - t0;
+    prof_thread* p = prof_thread_get();
+    prof_stack k = { .backend = backend, .gate_code = gate_code }, *s;
+
+    if (!p) return;
+    if (p->scope) {
+        k.entry = p->scope->entry;
+        k.hash = p->scope->hash;
+    }
+    s = prof_find(&p->stacks, &k, 1);
+    if (!s) return;
+    s->calls++;
+    s->ticks += dt;
+    p->gate_ticks += dt;
+}
+
+/**
+ * nymya_profile_begin - Opens a circuit-level scope on the calling thread.
+ * @s: Scope, closed with nymya_profile_end() before it goes out of scope.
+ * @entry: API entry point, a string literal.
+ * @backend: Name of the active backend.
+ * @c: Circuit, or NULL.
+ *
+ * Gate calls until nymya_profile_end() are charged below this scope. A
+ * scope opened inside another one is not recorded; its gates stay with the
+ * outer scope.
+ */
+void nymya_profile_begin(nymya_profile_scope* s, const char* entry, const char* backend,
+                         const nymya_circuit* c) {
+    prof_thread* p = prof_thread_get();
+
+    s->outer = p && !p->scope;
+    if (!s->outer) return;
+    s->entry = entry;
+    s->backend = backend;
+    s->hash = c ? c->hash : 0;
+    s->gate_ticks = p->gate_ticks;
+    p->scope = s;
+    s->t0 = nymya_profile_ticks();
+}
+
+/**
+ * nymya_profile_end - Closes a scope and charges the time its gates did not take.
+ * @s: Scope opened with nymya_profile_begin().
+ */
+void nymya_profile_end(nymya_profile_scope* s) {
+    uint64_t dt = nymya_profile_ticks() - s->t0;
+    prof_thread* p = prof_self;
+    prof_stack k = { .entry = s->entry, .backend = s->backend, .hash = s->hash }, *st;
+    uint64_t gates;
+
+    if (!s->outer || !p) return;
+    p->scope = NULL;
+    gates = p->gate_ticks - s->gate_ticks;
+    st = prof_find(&p->stacks, &k, 1);
+    if (!st) return;
+    st->calls++;
+    st->ticks += dt > gates ? dt - gates : 0;
+}
+
+// One row of the exit summary
+typedef struct prof_row {
+    const char* entry;
+    const char* backend;
+    uint64_t hash;
+    int gate_code;
+    uint64_t calls;
+    uint64_t ticks;
+    uint64_t gate_ticks;
+} prof_row;
+
+static int prof_row_cmp(const void* a, const void* b) {
+    uint64_t x = ((const prof_row*)a)->ticks, y = ((const prof_row*)b)->ticks;
+
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static void prof_write_folded(const prof_table* all, double ns_per_tick) {
+    FILE* f = fopen(prof_path, "w");
+    char buf[32];
+
+    if (!f) {
+        fprintf(stderr, "[nymya_runtime] Cannot write the profile to %s.\n", prof_path);
+        return;
+    }
+    for (size_t i = 0; i < all->cap; i++) {
+        const prof_stack* s = &all->s[i];
+        uint64_t ns = (uint64_t)(s->ticks * ns_per_tick);
+
+        if (!s->backend || !ns) continue;
+        fputs("nymya", f);
+        if (s->entry) fprintf(f, ";%s", s->entry);
+        if (s->hash) fprintf(f, ";circuit_%016" PRIx64, s->hash);
+        fprintf(f, ";%s", s->backend);
+        if (s->gate_code) fprintf(f, ";%s", prof_gate_name(s->gate_code, buf, sizeof(buf)));
+        fprintf(f, " %" PRIu64 "\n", ns);
+    }
+    fclose(f);
+}
+
+static void prof_print_summary(const prof_table* all, double ns_per_tick) {
+    prof_row gates[NYMYA_GATE_COUNT + 1] = { { 0 } }, *circuits;
+    size_t ncircuits = 0;
+    uint64_t total = 0;
+    char buf[32], code[16];
+
+    circuits = calloc(all->used ? all->used : 1, sizeof(*circuits));
+    if (!circuits) return;
+    for (size_t i = 0; i < NYMYA_GATE_COUNT; i++)
+        gates[i].gate_code = NYMYA_GATE_FIRST + (int)i;
+
+    // Gates by code, over all stacks; unknown codes share the last row
+    for (size_t i = 0; i < all->cap; i++) {
+        const prof_stack* s = &all->s[i];
+        unsigned int g = (unsigned int)(s->gate_code - NYMYA_GATE_FIRST);
+
+        if (!s->backend || !s->gate_code) continue;
+        if (g >= NYMYA_GATE_COUNT) g = NYMYA_GATE_COUNT;
+        gates[g].calls += s->calls;
+        gates[g].ticks += s->ticks;
+        total += s->ticks;
+    }
+    // Circuit scopes: their own time plus the gates charged below them
+    for (size_t i = 0; i < all->cap; i++) {
+        const prof_stack* s = &all->s[i];
+
+        if (!s->backend || s->gate_code || !s->entry) continue;
+        circuits[ncircuits] = (prof_row){ .entry = s->entry, .backend = s->backend,
+                                          .hash = s->hash, .calls = s->calls,
+                                          .ticks = s->ticks };
+        for (size_t j = 0; j < all->cap; j++) {
+            const prof_stack* g = &all->s[j];
+
+            if (g->gate_code && g->entry == s->entry && g->backend == s->backend &&
+                g->hash == s->hash)
+                circuits[ncircuits].gate_ticks += g->ticks;
+        }
+        circuits[ncircuits].ticks += circuits[ncircuits].gate_ticks;
+        ncircuits++;
+    }
+    qsort(gates, NYMYA_GATE_COUNT + 1, sizeof(*gates), prof_row_cmp);
+    qsort(circuits, ncircuits, sizeof(*circuits), prof_row_cmp);
+
+    fprintf(stderr, "[nymya_runtime] Profile written to %s\n", prof_path);
+    fprintf(stderr, "%-24s %6s %12s %12s %10s %6s\n",
+            "gate", "code", "calls", "total_ms", "mean_ns", "share");
+    for (size_t i = 0; i <= NYMYA_GATE_COUNT; i++) {
+        const prof_row* r = &gates[i];
+        double ns = r->ticks * ns_per_tick;
+        int other = r->gate_code == 0;
+
+        if (!r->calls) continue;
+        snprintf(code, sizeof(code), "%d", r->gate_code);
+        fprintf(stderr, "%-24s %6s %12" PRIu64 " %12.3f %10.0f %5.1f%%\n",
+                other ? "other" : prof_gate_name(r->gate_code, buf, sizeof(buf)),
+                other ? "-" : code, r->calls, ns / 1e6, ns / r->calls, total ? 100.0 * r->ticks / total : 0.0);
+    }
+    if (ncircuits) {
+        fprintf(stderr, "\n%-16s %-18s %-12s %10s %12s %12s\n",
+                "entry", "circuit", "backend", "runs", "total_ms", "gates_ms");
+        for (size_t i = 0; i < ncircuits; i++) {
+            const prof_row* r = &circuits[i];
+
+            snprintf(buf, sizeof(buf), "%016" PRIx64, r->hash);
+            fprintf(stderr, "%-16s %-18s %-12s %10" PRIu64 " %12.3f %12.3f\n", r->entry,
+                    r->hash ? buf : "-", r->backend, r->calls, r->ticks * ns_per_tick / 1e6,
+                    r->gate_ticks * ns_per_tick / 1e6);
+        }
+    }
+    free(circuits);
+}
+
+// atexit(): merges every thread's stacks and writes both reports
+static void prof_dump(void) {
+    prof_table all = { 0 };
+    uint64_t dticks = nymya_profile_ticks() - prof_tick0, dns = prof_ns() - prof_ns0;
+    double ns_per_tick = dticks ? (double)dns / dticks : 1.0;
+
+    nymya_profile_on = 0;
+    pthread_mutex_lock(&prof_lock);
+    for (prof_thread* p = prof_threads; p; p = p->next) {
+        for (size_t i = 0; i < p->stacks.cap; i++) {
+            const prof_stack* s = &p->stacks.s[i];
+            prof_stack* d;
+
+            if (!s->backend) continue;
+            d = prof_find(&all, s, 0);
+            if (!d) continue;
+            d->calls += s->calls;
+            d->ticks += s->ticks;
+        }
+    }
+    pthread_mutex_unlock(&prof_lock);
+
+    if (all.used) {
+        prof_write_folded(&all, ns_per_tick);
+        prof_print_summary(&all, ns_per_tick);
+    }
+    free(all.s);
+}
+
+/**
+ * nymya_profile_init - Reads NYMYA_PROFILE; called once before the first gate.
+ */
+void nymya_profile_init(void) {
+    const char* env = getenv("NYMYA_PROFILE");
+
+    if (!env || !*env || strcmp(env, "0") == 0) return;
+    if (strcmp(env, "1") == 0)
+        snprintf(prof_path, sizeof(prof_path), "nymya-profile.%ld.folded", (long)getpid());
+    else
+        snprintf(prof_path, sizeof(prof_path), "%s", env);
+
+    prof_ns0 = prof_ns();
+    prof_tick0 = nymya_profile_ticks();
+    atexit(prof_dump);
+    nymya_profile_on = 1;
+}
@@ -0,0 +1,54 @@
+#ifndef NYMYA_PROFILE_H
+#define NYMYA_PROFILE_H
+
+#include <stdint.h>
+#include "nymya_circuit.h"
+
+// Non-zero once nymya_profile_init() found NYMYA_PROFILE set; read on every
+// gate call, so the hooks cost one predictable branch while profiling is off
+extern int nymya_profile_on;
+
+/**
+ * nymya_profile_scope - A circuit-level call being profiled, on the caller's stack.
+ * @entry: Name of the API entry point, e.g. "circuit_run".
+ * @backend: Name of the active backend when the call started.
+ * @hash: Structural hash of the circuit, or 0 for none.
+ * @t0: Tick count at the start.
+ * @gate_ticks: Ticks of the thread's gate calls at the start.
+ * @outer: Set when no other scope was open, so this one is recorded.
+ */
+typedef struct nymya_profile_scope {
+    const char* entry;
+    const char* backend;
+    uint64_t hash;
+    uint64_t t0;
+    uint64_t gate_ticks;
+    int outer;
+} nymya_profile_scope;
+
+void nymya_profile_init(void);
+uint64_t nymya_profile_ticks(void);
+void nymya_profile_gate(int gate_code, const char* backend, uint64_t t0);
+void nymya_profile_begin(nymya_profile_scope* s, const char* entry, const char* backend,
+                         const nymya_circuit* c);
+void nymya_profile_end(nymya_profile_scope* s);
+
+/*
+ * NYMYA_PROFILE_CALL - Evaluates the int expression @call, inside a scope
+ * named @entry for circuit @c on backend @backend while profiling is on.
+ */
+#define NYMYA_PROFILE_CALL(entry, backend, c, call) ({                      \
+    nymya_profile_scope __nymya_ps;                                         \
+    int __nymya_ret;                                                        \
+                                                                            \
+    if (nymya_profile_on) {                                                 \
+        nymya_profile_begin(&__nymya_ps, (entry), (backend), (c));          \
+        __nymya_ret = (call);                                               \
+        nymya_profile_end(&__nymya_ps);                                     \
+    } else {                                                                \
+        __nymya_ret = (call);                                               \
+    }                                                                       \
+    __nymya_ret;                                                            \
+})
+
+#endif // NYMYA_PROFILE_H
@@ -0,0 +1,158 @@
+#ifndef NYMYA_QPU_H
+#define NYMYA_QPU_H
+
+// Device interface of the asynchronous gate-QPU job queue. A driver for a
+// hardware service attaches itself with nymya_qpu_set_device(); the runtime
+// then sends each nymya_submit_async() circuit to it as a single request.
+// Gates run on the "gateqpu" backend itself are streamed as OpenQASM 3 to
+// the sink set with nymya_qpu_set_sink() instead. Processes sharing a QPU
+// can instead all submit through the scheduler daemon nymya_qpud, see
+// nymya_qpu_use_scheduler().
+
+#include <stddef.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+
+// Requests a device runs at once when it does not set max_inflight
+#define NYMYA_QPU_DEFAULT_INFLIGHT 8
+
+// Upper bound on nymya_qpu_device.max_inflight
+#define NYMYA_QPU_MAX_INFLIGHT 256
+
+// Connection and retry settings a device leaves at 0
+#define NYMYA_QPU_DEFAULT_KEEPALIVE_MS   30000
+#define NYMYA_QPU_DEFAULT_RETRIES        4
+#define NYMYA_QPU_DEFAULT_BACKOFF_MS     100
+#define NYMYA_QPU_DEFAULT_BACKOFF_MAX_MS 10000
+
+// Results of nymya_qpu_device.run besides 0 (done) and -1 (job failed):
+// a transient failure to retry on the same connection, and one that also
+// leaves the connection unusable
+#define NYMYA_QPU_RETRY     1
+#define NYMYA_QPU_RECONNECT 2
+
+/**
+ * nymya_qpu_request - One circuit, serialized for the device.
+ * @ops: Gate records in circuit order; operands index @ids.
+ * @nops: Number of records.
+ * @ids: Qubit ID of each register slot, in order of first use.
+ * @nqubits: Number of slots.
+ * @shots: Measurements of the full register to take.
+ * @words: 64-bit words per shot in @bits, (@nqubits + 63) / 64.
+ * @bits: Zeroed on entry; the device sets bit i % 64 of
+ *        @bits[s * @words + i / 64] when slot i reads 1 in shot s.
+ * @retry_after_ms: Zeroed on entry; a device returning NYMYA_QPU_RETRY for a
+ *                  rate limit sets it to the delay the provider asked for.
+ * @phys: NULL, or, for a device with a coupling map, the physical qubit
+ *        each slot ends on: @ops then act on physical qubits, SWAPs
+ *        included, and slot i is read from physical qubit @phys[i].
+ */
+typedef struct nymya_qpu_request {
+    nymya_op* ops;
+    size_t nops;
+    uint64_t* ids;
+    size_t nqubits;
+    unsigned int shots;
+    size_t words;
+    uint64_t* bits;
+    unsigned int retry_after_ms;
+    const uint32_t* phys;
+} nymya_qpu_request;
+
+/**
+ * nymya_qpu_device - A QPU service as the job queue sees it.
+ * @name: Used in runtime messages.
+ * @run: Sends @req over @conn, waits for it to leave the device queue and
+ *       fills @req->bits. Called on the runtime's dispatcher threads,
+ *       concurrently for up to @max_inflight requests and @streams requests
+ *       per connection. Returns 0, -1 if the job failed, or NYMYA_QPU_RETRY
+ *       or NYMYA_QPU_RECONNECT to have it run again after a backoff.
+ * @ctx: Passed to every callback.
+ * @max_inflight: Requests kept in flight at once (0 = NYMYA_QPU_DEFAULT_INFLIGHT).
+ * @connect: Opens a connection to the service, or NULL if @run needs none
+ *           (@conn is then NULL). Returns the connection, or NULL on failure,
+ *           which counts as a retryable attempt.
+ * @disconnect: Closes a connection from @connect.
+ * @streams: Requests multiplexed on one connection (0 = 1), e.g. the HTTP/2
+ *           stream limit of the provider.
+ * @keepalive_ms: How long an unused connection stays open for the next job
+ *                (0 = NYMYA_QPU_DEFAULT_KEEPALIVE_MS).
+ * @max_retries: Attempts after the first (0 = NYMYA_QPU_DEFAULT_RETRIES).
+ * @backoff_ms: Delay before the first retry, doubled for each further one
+ *              up to @backoff_max_ms, with jitter (0 = the defaults).
+ * @backoff_max_ms: Cap on the retry delay.
+ * @coupling: Pairs of physical qubits a two-qubit gate can act on, either
+ *            way round, or NULL if any two can interact. Requests are then
+ *            routed onto the device before they run (see @phys of
+ *            nymya_qpu_request).
+ * @ncoupling: Entries of @coupling.
+ * @nphysical: Physical qubits (0 = one past the highest in @coupling).
+ *
+ * A @retry_after_ms reported by @run holds back every request to the device,
+ * not just the one that was refused, since provider rate limits apply to
+ * the account.
+ */
+typedef struct nymya_qpu_device {
+    const char* name;
+    int (*run)(void* ctx, void* conn, nymya_qpu_request* req);
+    void* ctx;
+    unsigned int max_inflight;
+    void* (*connect)(void* ctx);
+    void (*disconnect)(void* ctx, void* conn);
+    unsigned int streams;
+    unsigned int keepalive_ms;
+    unsigned int max_retries;
+    unsigned int backoff_ms;
+    unsigned int backoff_max_ms;
+    const uint32_t (*coupling)[2];
+    size_t ncoupling;
+    unsigned int nphysical;
+} nymya_qpu_device;
+
+// Attaches @dev (NULL detaches); it must stay valid while attached.
+// Connections of the previous device are closed. Fails while jobs are
+// queued or running.
+int nymya_qpu_set_device(const nymya_qpu_device* dev);
+
+// Attaches a device that hands every request to the QPU scheduler daemon
+// (nymya_qpud) serving the shared memory queue @name (NULL = $NYMYA_QPUD or
+// "/nymya-qpud"), at @priority, higher first. The daemon drives the real
+// device for all its tenants, packing small circuits into one submission.
+// Fails as nymya_qpu_set_device() does, or if no daemon serves @name.
+int nymya_qpu_use_scheduler(const char* name, int priority);
+
+// nymya_qpud -d DRIVER loads a device driver from a shared object and calls
+// this symbol with the -a argument (or NULL); it returns the device to drive
+#define NYMYA_QPU_DEVICE_ENTRY "nymya_qpu_device_entry"
+typedef const nymya_qpu_device* (*nymya_qpu_device_entry_fn)(const char* arg);
+
+/**
+ * nymya_qpu_sink_fn - Receives the OpenQASM 3 program of the "gateqpu" backend.
+ * @ctx: Passed to nymya_qpu_set_sink().
+ * @data: Next @len bytes of program text.
+ * @end: Nonzero on the last piece of a program, sent when a circuit run
+ *       finishes, on nymya_flush() or when the thread switches backends
+ *       or resets.
+ *
+ * Long programs arrive in several pieces. Called on the thread that ran the
+ * gates, so a sink shared by threads must serialize itself.
+ *
+ * Returns 0, or -1 to fail the gate or flush that sent the piece.
+ */
+typedef int (*nymya_qpu_sink_fn)(void* ctx, const char* data, size_t len, int end);
+
+// Sends programs to @fn (NULL restores the default, which writes to stdout)
+void nymya_qpu_set_sink(nymya_qpu_sink_fn fn, void* ctx);
+
+// Gate sets programs and job submissions can be lowered to. NONE writes
+// stdgates.inc gates, composite ones expanded; CX and CZ decompose every
+// gate into rz, sx and x plus that one entangler, as IBM- and Google-style
+// devices run them.
+#define NYMYA_QPU_NATIVE_NONE 0
+#define NYMYA_QPU_NATIVE_CX   1
+#define NYMYA_QPU_NATIVE_CZ   2
+
+// Chooses the gate set (NYMYA_QPU_NATIVE=none|cx|cz until called)
+int nymya_qpu_set_native(int set);
+
+#endif // NYMYA_QPU_H
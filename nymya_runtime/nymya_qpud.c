@@ -0,0 +1,370 @@
+// runtime/nymya_qpud.c
+//
+// QPU scheduler daemon. One daemon drives one QPU for every process on the
+// host: it loads the device driver, attaches it to its own job queue and
+// serves the shared-memory queue of nymya_qpud.h, which tenants reach
+// through nymya_qpu_use_scheduler().
+//
+// Tenant jobs run highest priority first, in arrival order within a
+// priority. Whenever the device can take another request, the daemon starts
+// from the first job in that order and packs further queued jobs next to it,
+// on qubits of their own, as long as they fit the device width, take no
+// more shots than the first one and the batch stays within -b jobs. The
+// batch goes to the device as one circuit, and each tenant gets back its
+// own qubits of the first shots it asked for. Since jobs only wait while
+// the device is busy, a lightly loaded device runs every job at once, and
+// a saturated one gets fewer, fuller submissions.
+//
+//   nymya_qpud -d DRIVER [-a ARG] [-n NAME] [-w WIDTH] [-b BATCH] [-m MODE]
+//
+// DRIVER is a shared object exporting NYMYA_QPU_DEVICE_ENTRY (nymya_qpu.h).
+// NAME is the shared memory object (default NYMYA_QPUD_DEFAULT_NAME), WIDTH
+// the qubits one submission may use (default the device's physical qubits,
+// or QPUD_DEFAULT_WIDTH), BATCH the jobs one submission may hold and MODE
+// the octal permissions of the queue (0660, so one group of tenants).
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "nymya_runtime.h"
+#include "nymya_qpu.h"
+#include "nymya_qpud.h"
+#include "backend_gateqpu.h"
+
+// Submission width for a device that does not give its qubit count
+#define QPUD_DEFAULT_WIDTH 64
+
+// Most tenant jobs packed into one submission
+#define QPUD_MAX_BATCH 32
+
+// How often the daemon looks for dead tenants and a shutdown request
+#define QPUD_POLL_MS 250
+
+/**
+ * qpud_batch - Tenant jobs submitted to the device as one circuit.
+ * @job: The device job.
+ * @req: Combined request: each member's ops moved onto its own qubits.
+ * @n: Members.
+ * @slot: Queue slot of each member.
+ * @base: First combined qubit of each member.
+ * @finished: Set, under the queue lock, once every member has its result.
+ * @next: List link.
+ */
+typedef struct qpud_batch {
+    nymya_job* job;
+    nymya_qpu_request req;
+    unsigned int n;
+    unsigned int slot[QPUD_MAX_BATCH];
+    size_t base[QPUD_MAX_BATCH];
+    int finished;
+    struct qpud_batch* next;
+} qpud_batch;
+
+static nymya_qpud_shm* qpud_shm;
+static volatile sig_atomic_t qpud_stop;
+
+// Totals reported at exit
+static unsigned long qpud_jobs;
+static unsigned long qpud_submissions;
+
+static void qpud_signal(int sig) {
+    (void)sig;
+    qpud_stop = 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: nymya_qpud -d DRIVER [-a ARG] [-n NAME] [-w WIDTH] [-b BATCH] [-m MODE]\n");
+    exit(2);
+}
+
+// Loads the device driver and returns its device, or NULL after reporting why
+static const nymya_qpu_device* qpud_load(const char* path, const char* arg) {
+    nymya_qpu_device_entry_fn entry;
+    const nymya_qpu_device* dev;
+    void* h = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+    if (!h) {
+        fprintf(stderr, "[QPU] Cannot load driver %s (%s)\n", path, dlerror());
+        return NULL;
+    }
+    *(void**)&entry = dlsym(h, NYMYA_QPU_DEVICE_ENTRY);
+    dev = entry ? entry(arg) : NULL;
+    if (!dev || !dev->run) {
+        fprintf(stderr, "[QPU] %s does not provide a usable device.\n", path);
+        dlclose(h);
+        return NULL;
+    }
+    return dev;
+}
+
+// Device width a batch may fill: the physical qubits if the device lists them
+static size_t qpud_device_width(const nymya_qpu_device* dev) {
+    size_t width = dev->nphysical;
+
+    for (size_t k = 0; !dev->nphysical && k < dev->ncoupling; k++) {
+        if (dev->coupling[k][0] + 1u > width) width = dev->coupling[k][0] + 1u;
+        if (dev->coupling[k][1] + 1u > width) width = dev->coupling[k][1] + 1u;
+    }
+    return width ? width : QPUD_DEFAULT_WIDTH;
+}
+
+// Marks slot @k finished; called with the queue locked
+static void qpud_settle(unsigned int k, uint32_t state) {
+    qpud_shm->slots[k].state = state;
+    pthread_cond_broadcast(&qpud_shm->slots[k].done);
+}
+
+/**
+ * qpud_done - Completion callback of a batch: hands each member its shots.
+ * @job: The batch's device job.
+ * @user: The qpud_batch.
+ *
+ * Member k reads combined qubits base[k] onwards of the first shots of the
+ * batch, as many as it asked for. Runs on a dispatcher thread of the job
+ * queue; the batch itself is freed by the main loop.
+ */
+static void qpud_done(nymya_job* job, void* user) {
+    qpud_batch* b = user;
+    nymya_job_result r;
+    int ok = nymya_job_get_result(job, &r) == 0;
+
+    qpu_sched_lock(qpud_shm);
+    for (unsigned int m = 0; m < b->n; m++) {
+        unsigned int k = b->slot[m];
+        nymya_qpud_slot* s = &qpud_shm->slots[k];
+        uint64_t* bits = qpu_sched_bits(qpud_shm, k);
+
+        if (!ok) {
+            qpud_settle(k, NYMYA_QPUD_FAILED);
+            continue;
+        }
+        memset(bits, 0, (size_t)s->shots * s->words * sizeof(*bits));
+        for (size_t shot = 0; shot < s->shots; shot++) {
+            const uint64_t* src = r.bits + shot * r.words;
+            uint64_t* dst = bits + shot * s->words;
+
+            for (size_t i = 0; i < s->nqubits; i++) {
+                size_t q = b->base[m] + i;
+                dst[i / 64] |= ((src[q / 64] >> (q % 64)) & 1u) << (i % 64);
+            }
+        }
+        qpud_settle(k, NYMYA_QPUD_DONE);
+    }
+    b->finished = 1;
+    pthread_cond_signal(&qpud_shm->work);
+    pthread_mutex_unlock(&qpud_shm->lock);
+}
+
+/**
+ * qpud_next - Picks the next job to run and the jobs that can ride along.
+ * @b: Batch to fill; @b->n is the number of members found.
+ * @width: Qubits a submission may use.
+ * @batch: Most members.
+ *
+ * Jobs with invalid records fail here rather than in a shared submission.
+ * Called with the queue locked; the members are marked RUNNING.
+ */
+static void qpud_next(qpud_batch* b, size_t width, unsigned int batch) {
+    nymya_qpud_shm* shm = qpud_shm;
+    unsigned char taken[NYMYA_QPUD_SLOTS] = { 0 };
+    size_t used = 0;
+    uint32_t shots = 0;
+
+    b->n = 0;
+    while (b->n < batch) {
+        int best = -1;
+
+        // Highest priority, then oldest, among the jobs not yet considered
+        for (unsigned int k = 0; k < shm->nslots; k++) {
+            const nymya_qpud_slot* s = &shm->slots[k];
+
+            if (s->state != NYMYA_QPUD_QUEUED || taken[k]) continue;
+            if (best < 0 || s->priority > shm->slots[best].priority ||
+                (s->priority == shm->slots[best].priority && s->seq < shm->slots[best].seq))
+                best = (int)k;
+        }
+        if (best < 0) break;
+        taken[best] = 1;
+
+        nymya_qpud_slot* s = &shm->slots[best];
+        if (s->words != (s->nqubits + 63) / 64 || !s->shots ||
+            nymya_qpud_data_bytes(s->nops, s->nqubits, s->shots) > shm->slot_bytes ||
+            backend_gateqpu_check_ops(qpu_sched_ops(shm, (unsigned int)best), s->nops, s->nqubits)) {
+            qpud_settle((unsigned int)best, NYMYA_QPUD_FAILED);
+            continue;
+        }
+        // The first job sets the shots; a wider one still runs alone
+        if (b->n && (used + s->nqubits > width || s->shots > shots)) continue;
+
+        if (!b->n) shots = s->shots;
+        b->slot[b->n] = (unsigned int)best;
+        b->base[b->n] = used;
+        b->n++;
+        used += s->nqubits;
+        s->state = NYMYA_QPUD_RUNNING;
+    }
+}
+
+/**
+ * qpud_build - Lays the members of @b side by side in one request.
+ * @b: Batch from qpud_next().
+ *
+ * Member k's operands move up by @b->base[k]; its qubit IDs follow the
+ * previous member's. Called with the queue locked, so the slots are read
+ * as their tenants left them.
+ *
+ * Returns 0, or -1 if the request cannot be allocated.
+ */
+static int qpud_build(qpud_batch* b) {
+    nymya_qpud_shm* shm = qpud_shm;
+    size_t nops = 0, nqubits = 0;
+
+    for (unsigned int m = 0; m < b->n; m++) {
+        nops += shm->slots[b->slot[m]].nops;
+        nqubits += shm->slots[b->slot[m]].nqubits;
+    }
+    b->req.ops = malloc((nops ? nops : 1) * sizeof(*b->req.ops));
+    b->req.ids = malloc((nqubits ? nqubits : 1) * sizeof(*b->req.ids));
+    if (!b->req.ops || !b->req.ids) return -1;
+
+    b->req.nops = 0;
+    b->req.nqubits = 0;
+    b->req.shots = shm->slots[b->slot[0]].shots;
+    for (unsigned int m = 0; m < b->n; m++) {
+        unsigned int k = b->slot[m];
+        const nymya_qpud_slot* s = &shm->slots[k];
+        const nymya_op* ops = qpu_sched_ops(shm, k);
+
+        for (size_t i = 0; i < s->nops; i++) {
+            nymya_op* op = &b->req.ops[b->req.nops++];
+            int arity = backend_gateqpu_arity(ops[i].gate_code);
+
+            *op = ops[i];
+            for (int a = 0; a < arity; a++) op->qubit[a] += (uint32_t)b->base[m];
+        }
+        memcpy(b->req.ids + b->req.nqubits, qpu_sched_ids(shm, k), s->nqubits * sizeof(uint64_t));
+        b->req.nqubits += s->nqubits;
+    }
+    return 0;
+}
+
+static void qpud_batch_free(qpud_batch* b) {
+    free(b->req.ops);
+    free(b->req.ids);
+    free(b);
+}
+
+// Frees the slots of tenants that died; called with the queue locked
+static void qpud_reclaim(void) {
+    for (unsigned int k = 0; k < qpud_shm->nslots; k++) {
+        nymya_qpud_slot* s = &qpud_shm->slots[k];
+
+        if (s->state == NYMYA_QPUD_FREE || s->state == NYMYA_QPUD_RUNNING) continue;
+        if (qpu_sched_alive(s->owner)) continue;
+        s->state = NYMYA_QPUD_FREE;
+        pthread_cond_broadcast(&qpud_shm->space);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char *driver = NULL, *arg = NULL, *name = NULL;
+    unsigned int mode = 0660, batch = QPUD_MAX_BATCH, limit;
+    const nymya_qpu_device* dev;
+    qpud_batch* running = NULL;
+    unsigned int inflight = 0;
+    size_t width = 0, len;
+    struct sigaction sa;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:a:n:w:b:m:")) != -1) {
+        switch (opt) {
+            case 'd': driver = optarg; break;
+            case 'a': arg = optarg; break;
+            case 'n': name = optarg; break;
+            case 'w': width = strtoul(optarg, NULL, 0); break;
+            case 'b': batch = (unsigned int)strtoul(optarg, NULL, 0); break;
+            case 'm': mode = (unsigned int)strtoul(optarg, NULL, 8); break;
+            default: usage();
+        }
+    }
+    if (!driver || optind != argc) usage();
+    if (!name) name = getenv("NYMYA_QPUD");
+    if (!name || !*name) name = NYMYA_QPUD_DEFAULT_NAME;
+    if (!batch || batch > QPUD_MAX_BATCH) batch = QPUD_MAX_BATCH;
+
+    dev = qpud_load(driver, arg);
+    if (!dev || nymya_qpu_set_device(dev)) return 1;
+    if (!width) width = qpud_device_width(dev);
+    limit = dev->max_inflight ? dev->max_inflight : NYMYA_QPU_DEFAULT_INFLIGHT;
+    if (limit > NYMYA_QPU_MAX_INFLIGHT) limit = NYMYA_QPU_MAX_INFLIGHT;
+
+    qpud_shm = qpu_sched_map(name, 1, mode, &len);
+    if (!qpud_shm) return 1;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = qpud_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    printf("[QPU] Scheduling %s on %s: %zu qubits and up to %u jobs per submission.\n",
+           dev->name ? dev->name : "device", name, width, batch);
+    fflush(stdout);
+
+    qpu_sched_lock(qpud_shm);
+    while (!qpud_stop || running) {
+        // Release the device jobs of finished batches; freeing waits for the callback
+        for (qpud_batch** p = &running; *p;) {
+            qpud_batch* b = *p;
+
+            if (!b->finished) {
+                p = &b->next;
+                continue;
+            }
+            *p = b->next;
+            inflight--;
+            pthread_mutex_unlock(&qpud_shm->lock);
+            nymya_job_free(b->job);
+            qpud_batch_free(b);
+            qpu_sched_lock(qpud_shm);
+        }
+        qpud_reclaim();
+
+        if (!qpud_stop && inflight < limit) {
+            qpud_batch* b = calloc(1, sizeof(*b));
+
+            if (b) qpud_next(b, width, batch);
+            if (b && b->n) {
+                if (qpud_build(b) == 0)
+                    b->job = nymya_job_submit_borrowed(&b->req, qpud_done, b);
+                if (!b->job) {
+                    for (unsigned int m = 0; m < b->n; m++) qpud_settle(b->slot[m], NYMYA_QPUD_FAILED);
+                    qpud_batch_free(b);
+                    continue;
+                }
+                b->next = running;
+                running = b;
+                inflight++;
+                qpud_jobs += b->n;
+                qpud_submissions++;
+                continue;
+            }
+            if (b) qpud_batch_free(b);
+        }
+        qpu_sched_timedwait(&qpud_shm->work, qpud_shm, QPUD_POLL_MS);
+    }
+
+    // Tenants still queued see the daemon gone and fail their jobs
+    qpud_shm->daemon = 0;
+    for (unsigned int k = 0; k < qpud_shm->nslots; k++) {
+        if (qpud_shm->slots[k].state == NYMYA_QPUD_QUEUED) qpud_settle(k, NYMYA_QPUD_FAILED);
+    }
+    pthread_mutex_unlock(&qpud_shm->lock);
+    shm_unlink(name);
+    nymya_qpu_set_device(NULL);
+    printf("[QPU] Ran %lu jobs in %lu submissions.\n", qpud_jobs, qpud_submissions);
+    return 0;
+}
@@ -0,0 +1,115 @@
+#ifndef NYMYA_QPUD_H
+#define NYMYA_QPUD_H
+
+// Shared-memory queue between tenant processes and the QPU scheduler daemon
+// (nymya_qpud). The daemon creates one POSIX shared memory object per QPU
+// it serves and every tenant maps it:
+//
+//     offset 0            nymya_qpud_shm, with one nymya_qpud_slot per job
+//     data_offset         slot_bytes of job data per slot, page aligned
+//
+// A slot's data holds its request: nymya_op ops[nops], then uint64_t
+// ids[nqubits], then uint64_t bits[shots * words] for the result, laid out
+// as in nymya_qpu_request. A tenant claims a FREE slot, fills it and marks
+// it QUEUED; the daemon takes QUEUED slots by priority, runs several of
+// them side by side as one circuit when they fit the device, and marks
+// each DONE or FAILED with its own shots filled in; the tenant copies the
+// result out and frees the slot. Everything in the header is guarded by
+// @lock, a robust process-shared mutex, so a tenant that dies holding it
+// does not stall the rest.
+//
+// Both sides must be built from the same runtime: the pthread objects are
+// shared as they are. A tenant rejects a version it does not know.
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+
+#define NYMYA_QPUD_MAGIC   0x4450514Eu // "NQPD"
+#define NYMYA_QPUD_VERSION 1
+
+// Shared memory object name when none is given (NYMYA_QPUD overrides it)
+#define NYMYA_QPUD_DEFAULT_NAME "/nymya-qpud"
+
+// Job slots, and the data each can hold (ops, ids and result bits)
+#define NYMYA_QPUD_SLOTS      64
+#define NYMYA_QPUD_SLOT_BYTES ((uint64_t)1 << 20)
+
+// Slot states
+#define NYMYA_QPUD_FREE    0
+#define NYMYA_QPUD_QUEUED  1
+#define NYMYA_QPUD_RUNNING 2
+#define NYMYA_QPUD_DONE    3
+#define NYMYA_QPUD_FAILED  4
+
+/**
+ * nymya_qpud_slot - One tenant job.
+ * @done: Broadcast when @state becomes DONE or FAILED.
+ * @state: NYMYA_QPUD_* state.
+ * @priority: Higher runs first; equal priorities run in @seq order.
+ * @owner: Process ID of the tenant; the daemon frees slots of dead ones.
+ * @shots: Measurements to take.
+ * @seq: Queue order, from nymya_qpud_shm.seq.
+ * @nops: Records in the slot's ops.
+ * @nqubits: Entries in the slot's ids, and bits per shot.
+ * @words: 64-bit words per shot in the slot's bits.
+ */
+typedef struct nymya_qpud_slot {
+    pthread_cond_t done;
+    uint32_t state;
+    int32_t priority;
+    int32_t owner;
+    uint32_t shots;
+    uint64_t seq;
+    uint64_t nops;
+    uint64_t nqubits;
+    uint64_t words;
+} nymya_qpud_slot;
+
+/**
+ * nymya_qpud_shm - Header of the shared memory object.
+ * @magic: NYMYA_QPUD_MAGIC, stored last by the daemon once the rest is set.
+ * @version: NYMYA_QPUD_VERSION.
+ * @header_size: sizeof(nymya_qpud_shm) of the daemon.
+ * @daemon: Process ID of the daemon.
+ * @nslots: Entries of @slots in use.
+ * @slot_bytes: Data bytes per slot.
+ * @data_offset: Offset of slot 0's data, a multiple of the page size.
+ * @seq: Next queue order number.
+ * @lock: Guards every field below and the slots.
+ * @work: Signalled when a slot is queued or freed; the daemon waits on it.
+ * @space: Broadcast when a slot becomes FREE; tenants wait on it.
+ * @slots: The job slots.
+ */
+typedef struct nymya_qpud_shm {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    int32_t daemon;
+    uint32_t nslots;
+    uint64_t slot_bytes;
+    uint64_t data_offset;
+    uint64_t seq;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t space;
+    nymya_qpud_slot slots[NYMYA_QPUD_SLOTS];
+} nymya_qpud_shm;
+
+// Bytes of job data a request of this shape takes in a slot
+static inline uint64_t nymya_qpud_data_bytes(uint64_t nops, uint64_t nqubits, uint64_t shots) {
+    return nops * sizeof(nymya_op) + nqubits * sizeof(uint64_t) +
+           shots * ((nqubits + 63) / 64) * sizeof(uint64_t);
+}
+
+// Shared helpers of the tenant side (qpu_sched.c) and the daemon
+nymya_qpud_shm* qpu_sched_map(const char* name, int create, unsigned int mode, size_t* len);
+void qpu_sched_lock(nymya_qpud_shm* shm);
+int qpu_sched_timedwait(pthread_cond_t* cond, nymya_qpud_shm* shm, unsigned int ms);
+nymya_op* qpu_sched_ops(nymya_qpud_shm* shm, unsigned int slot);
+uint64_t* qpu_sched_ids(nymya_qpud_shm* shm, unsigned int slot);
+uint64_t* qpu_sched_bits(nymya_qpud_shm* shm, unsigned int slot);
+int qpu_sched_alive(int32_t pid);
+
+#endif // NYMYA_QPUD_H
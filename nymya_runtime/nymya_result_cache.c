@@ -0,0 +1,619 @@
+// nymya_result_cache.c
+//
+// Opt-in cache of results. Calibration and regression suites run the same
+// circuits with the same parameters over and over; with the cache on, a
+// repeat of a memoised call copies out the stored result instead of running.
+//
+// The key of a call is its kind, the backend and register precision, the
+// circuit's structural key and gate values (see nymya_circuit_values()), and
+// the call's own arguments: shots, measured qubits, observable, noise model.
+// Results that are drawn at random are memoised only when NYMYA_SIM_SEED
+// makes them reproducible, and their key also holds the calling thread's
+// generator state. The entry keeps the state the run left behind, and a hit
+// restores it, so later draws go on as if the call had run.
+//
+// Two tiers. Memory is process-wide and bounded: entries plus their keys
+// never exceed the limit, and the least recently used entry goes first. The
+// optional disk tier keeps one file per entry in a directory, shared by every
+// process that names it; a memory miss reads the file, and every new result
+// is written there. Files are replaced whole through a rename and checked
+// against the full key when read; the runtime never deletes them.
+//
+// NYMYA_RESULT_CACHE (bytes with an optional K, M, G or T suffix) and
+// NYMYA_RESULT_CACHE_DIR turn the tiers on at startup.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "nymya_result_cache.h"
+#include "nymya_memory.h"
+#include "nymya_rng.h"
+
+// Hash buckets of the memory tier
+#define RCACHE_BUCKETS 1024
+
+// Leads every key, so a change of layout never matches old files
+#define RCACHE_KEY_VERSION 1
+
+#define RCACHE_FILE_MAGIC   0x4643524Eu // "NRCF"
+#define RCACHE_FILE_VERSION 1
+
+/**
+ * rcache_entry - One stored result.
+ * @hash: Hash of @key.
+ * @key: Key words.
+ * @key_len: Entries of @key.
+ * @value: Result bytes.
+ * @value_bytes: Size of @value.
+ * @rng: Generator state the run left behind, if @has_rng.
+ * @has_rng: Set for a result drawn at random.
+ * @bytes: Memory charged to the entry.
+ * @chain: Next entry in the same bucket.
+ * @prev: More recently used neighbour.
+ * @next: Less recently used neighbour.
+ */
+typedef struct rcache_entry {
+    uint64_t hash;
+    uint64_t* key;
+    size_t key_len;
+    void* value;
+    size_t value_bytes;
+    uint64_t rng[NYMYA_RNG_STATE_WORDS];
+    int has_rng;
+    size_t bytes;
+    struct rcache_entry* chain;
+    struct rcache_entry* prev;
+    struct rcache_entry* next;
+} rcache_entry;
+
+/**
+ * rcache_file - Header of a disk-tier file, followed by the key words, the
+ * generator state (@rng_words words) and the value.
+ * @magic: RCACHE_FILE_MAGIC.
+ * @version: RCACHE_FILE_VERSION.
+ * @rng_words: NYMYA_RNG_STATE_WORDS for a random result, else 0.
+ * @key_len: Key words.
+ * @value_bytes: Value size.
+ */
+typedef struct rcache_file {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rng_words;
+    uint64_t key_len;
+    uint64_t value_bytes;
+} rcache_file;
+
+static struct {
+    pthread_mutex_t lock;
+    rcache_entry* buckets[RCACHE_BUCKETS];
+    rcache_entry* mru;
+    rcache_entry* lru;
+    size_t bytes;
+    size_t limit;
+    size_t entries;
+    char* dir;
+    int enabled;
+    int seeded;
+    uint64_t hits;
+    uint64_t disk_hits;
+    uint64_t misses;
+    uint64_t evictions;
+} rcache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static pthread_once_t rcache_once = PTHREAD_ONCE_INIT;
+
+// Whether either tier is on; read without the lock on every memoised call
+static void rcache_update_enabled(void) {
+    __atomic_store_n(&rcache.enabled, rcache.limit || rcache.dir, __ATOMIC_RELAXED);
+}
+
+// Reads NYMYA_RESULT_CACHE, NYMYA_RESULT_CACHE_DIR and NYMYA_SIM_SEED once
+static void rcache_init(void) {
+    const char* env = getenv("NYMYA_RESULT_CACHE");
+    size_t bytes = 0;
+
+    if (env && *env && nymya_mem_parse_size(env, &bytes)) {
+        fprintf(stderr, "[nymya_runtime] Ignoring NYMYA_RESULT_CACHE=%s; expected bytes, "
+                "e.g. 256M.\n", env);
+        bytes = 0;
+    }
+    env = getenv("NYMYA_RESULT_CACHE_DIR");
+    pthread_mutex_lock(&rcache.lock);
+    rcache.limit = bytes;
+    if (env && *env) rcache.dir = strdup(env);
+    rcache_update_enabled();
+    pthread_mutex_unlock(&rcache.lock);
+
+    env = getenv("NYMYA_SIM_SEED");
+    rcache.seeded = env && *env;
+}
+
+// FNV-1a over 64-bit words with a final avalanche, as nymya_circuit_seal()
+static uint64_t rcache_hash(const uint64_t* w, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < n; i++)
+        h = (h ^ w[i]) * 0x100000001b3ull;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+// FNV-1a of a string, 0 for NULL
+static uint64_t rcache_str_hash(const char* s) {
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    if (!s) return 0;
+    while (*s)
+        h = (h ^ (unsigned char)*s++) * 0x100000001b3ull;
+    return h;
+}
+
+// Makes room for @n more words, or deactivates the key
+static int rcache_reserve(nymya_rcache_key* k, size_t n) {
+    size_t cap = k->cap ? k->cap : 64;
+    uint64_t* w;
+
+    if (!k->active) return -1;
+    if (k->len + n <= k->cap) return 0;
+    while (cap < k->len + n) cap *= 2;
+    w = realloc(k->words, cap * sizeof(*w));
+    if (!w) {
+        nymya_rcache_end(k);
+        return -1;
+    }
+    k->words = w;
+    k->cap = cap;
+    return 0;
+}
+
+/**
+ * nymya_rcache_begin - Starts the key of a call if the call is memoised.
+ * @k: Key to set up; pass it to nymya_rcache_end() in every case.
+ * @kind: What the call computes.
+ * @backend: Name of the backend it runs on.
+ * @c: Sealed circuit it runs.
+ * @random: Set if the result depends on the calling thread's generator.
+ *
+ * Returns 0 with @k active, or -1 when the cache is off, @c has no key, a
+ * random result is not reproducible or memory runs out.
+ */
+int nymya_rcache_begin(nymya_rcache_key* k, nymya_rcache_kind kind, const char* backend,
+                       const nymya_circuit* c, int random) {
+    size_t nvals;
+
+    memset(k, 0, sizeof(*k));
+    pthread_once(&rcache_once, rcache_init);
+    if (!__atomic_load_n(&rcache.enabled, __ATOMIC_RELAXED) || !c || !c->key) return -1;
+    if (random && !rcache.seeded) return -1;
+
+    k->active = 1;
+    k->random = random;
+    nymya_rcache_add(k, (uint64_t)RCACHE_KEY_VERSION << 32 | kind);
+    nymya_rcache_add(k, rcache_str_hash(backend));
+    nymya_rcache_add(k, c->precision);
+    if (c->precision == NYMYA_PRECISION_DEFAULT)
+        nymya_rcache_add(k, rcache_str_hash(getenv("NYMYA_SIM_PRECISION")));
+
+    nvals = nymya_circuit_values(c, NULL);
+    if (rcache_reserve(k, 2 + c->key_len + nvals)) return -1;
+    k->words[k->len++] = c->key_len;
+    memcpy(&k->words[k->len], c->key, c->key_len * sizeof(*k->words));
+    k->len += c->key_len;
+    k->words[k->len++] = nvals;
+    k->len += nymya_circuit_values(c, &k->words[k->len]);
+
+    if (random) {
+        if (rcache_reserve(k, NYMYA_RNG_STATE_WORDS)) return -1;
+        nymya_rng_save(&k->words[k->len]);
+        k->len += NYMYA_RNG_STATE_WORDS;
+    }
+    return k->active ? 0 : -1;
+}
+
+void nymya_rcache_add(nymya_rcache_key* k, uint64_t word) {
+    if (!rcache_reserve(k, 1))
+        k->words[k->len++] = word;
+}
+
+void nymya_rcache_add_double(nymya_rcache_key* k, double v) {
+    uint64_t bits;
+
+    memcpy(&bits, &v, sizeof(bits));
+    nymya_rcache_add(k, bits);
+}
+
+// Count, then the ID of every qubit (all ones for a NULL entry)
+void nymya_rcache_add_qubits(nymya_rcache_key* k, nymya_qubit* const* qubits, size_t n) {
+    nymya_rcache_add(k, n);
+    for (size_t i = 0; i < n; i++)
+        nymya_rcache_add(k, qubits[i] ? qubits[i]->id : ~0ull);
+}
+
+void nymya_rcache_add_observable(nymya_rcache_key* k, const nymya_observable* obs) {
+    nymya_rcache_add(k, obs->count);
+    for (size_t t = 0; t < obs->count; t++) {
+        const nymya_pauli_term* term = &obs->terms[t];
+
+        nymya_rcache_add_double(k, term->coeff);
+        nymya_rcache_add(k, term->count);
+        for (size_t i = 0; i < term->count; i++) {
+            nymya_rcache_add(k, (unsigned char)term->ops[i]);
+            nymya_rcache_add(k, term->qubits[i] ? term->qubits[i]->id : ~0ull);
+        }
+    }
+}
+
+void nymya_rcache_add_noise(nymya_rcache_key* k, const nymya_noise* noise) {
+    nymya_rcache_add(k, noise->count);
+    for (size_t i = 0; i < noise->count; i++) {
+        nymya_rcache_add(k, (uint64_t)noise->rules[i].gate_code);
+        nymya_rcache_add(k, noise->rules[i].channel);
+        nymya_rcache_add_double(k, noise->rules[i].p);
+    }
+    nymya_rcache_add_double(k, noise->p01);
+    nymya_rcache_add_double(k, noise->p10);
+}
+
+static void rcache_unlink(rcache_entry* e) {
+    if (e->prev) e->prev->next = e->next; else rcache.mru = e->next;
+    if (e->next) e->next->prev = e->prev; else rcache.lru = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void rcache_push_front(rcache_entry* e) {
+    e->prev = NULL;
+    e->next = rcache.mru;
+    if (rcache.mru) rcache.mru->prev = e;
+    rcache.mru = e;
+    if (!rcache.lru) rcache.lru = e;
+}
+
+static void rcache_free(rcache_entry* e) {
+    if (!e) return;
+    free(e->key);
+    free(e->value);
+    free(e);
+}
+
+// Unlinks and frees an entry; called with the lock held
+static void rcache_drop(rcache_entry* e) {
+    rcache_entry** p = &rcache.buckets[e->hash % RCACHE_BUCKETS];
+
+    while (*p != e) p = &(*p)->chain;
+    *p = e->chain;
+    rcache_unlink(e);
+
+    rcache.bytes -= e->bytes;
+    rcache.entries--;
+    rcache_free(e);
+}
+
+// Evicts from the LRU end until @need more bytes fit; called with the lock held
+static void rcache_make_room(size_t need) {
+    while (rcache.lru && rcache.bytes + need > rcache.limit) {
+        rcache_drop(rcache.lru);
+        rcache.evictions++;
+    }
+}
+
+// Entry with this key, or NULL; called with the lock held
+static rcache_entry* rcache_find(uint64_t hash, const uint64_t* key, size_t key_len) {
+    rcache_entry* e;
+
+    for (e = rcache.buckets[hash % RCACHE_BUCKETS]; e; e = e->chain) {
+        if (e->hash == hash && e->key_len == key_len &&
+            memcmp(e->key, key, key_len * sizeof(*key)) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/**
+ * rcache_insert - Adds an entry to the memory tier.
+ * @e: Entry; the tier takes it over, or frees it if it does not fit.
+ *
+ * An entry with the same key, from a thread that ran the same call at the
+ * same time, is replaced. Called with the lock held.
+ */
+static void rcache_insert(rcache_entry* e) {
+    rcache_entry* old = rcache_find(e->hash, e->key, e->key_len);
+
+    if (old) rcache_drop(old);
+    if (e->bytes > rcache.limit) {
+        rcache_free(e);
+        return;
+    }
+    rcache_make_room(e->bytes);
+    e->chain = rcache.buckets[e->hash % RCACHE_BUCKETS];
+    rcache.buckets[e->hash % RCACHE_BUCKETS] = e;
+    rcache_push_front(e);
+    rcache.bytes += e->bytes;
+    rcache.entries++;
+}
+
+// Copies an entry's result out and restores its generator state
+static void rcache_serve(const rcache_entry* e, void* out) {
+    memcpy(out, e->value, e->value_bytes);
+    if (e->has_rng) nymya_rng_restore(e->rng);
+}
+
+// Path of the disk-tier file for a key hash; the caller frees it
+static char* rcache_path(const char* dir, uint64_t hash) {
+    char* path = malloc(strlen(dir) + 32);
+
+    if (path) sprintf(path, "%s/%016" PRIx64 ".nrc", dir, hash);
+    return path;
+}
+
+/**
+ * rcache_load - Reads an entry from the disk tier.
+ * @dir: Cache directory.
+ * @k: Key of the call.
+ * @hash: Hash of @k.
+ * @bytes: Size of the result the call expects.
+ *
+ * Returns the entry, or NULL if there is no file for the key, the file
+ * holds another key or result size, or it cannot be read.
+ */
+static rcache_entry* rcache_load(const char* dir, const nymya_rcache_key* k, uint64_t hash,
+                                 size_t bytes) {
+    char* path = rcache_path(dir, hash);
+    rcache_entry* e = NULL;
+    uint64_t* key = NULL;
+    rcache_file h;
+    FILE* f;
+
+    if (!path) return NULL;
+    f = fopen(path, "rb");
+    free(path);
+    if (!f) return NULL;
+
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != RCACHE_FILE_MAGIC ||
+        h.version != RCACHE_FILE_VERSION || h.key_len != k->len || h.value_bytes != bytes ||
+        (h.rng_words != 0 && h.rng_words != NYMYA_RNG_STATE_WORDS))
+        goto out;
+    key = malloc(k->len * sizeof(*key));
+    e = calloc(1, sizeof(*e));
+    if (!key || !e || fread(key, sizeof(*key), k->len, f) != k->len ||
+        memcmp(key, k->words, k->len * sizeof(*key)) != 0)
+        goto fail;
+    if (h.rng_words && fread(e->rng, sizeof(*e->rng), h.rng_words, f) != h.rng_words)
+        goto fail;
+    e->value = malloc(bytes ? bytes : 1);
+    if (!e->value || fread(e->value, 1, bytes, f) != bytes)
+        goto fail;
+
+    e->hash = hash;
+    e->key = key;
+    e->key_len = k->len;
+    e->value_bytes = bytes;
+    e->has_rng = h.rng_words != 0;
+    e->bytes = sizeof(*e) + k->len * sizeof(*key) + bytes;
+    goto out;
+
+fail:
+    if (e) free(e->value);
+    free(e);
+    free(key);
+    e = NULL;
+out:
+    fclose(f);
+    return e;
+}
+
+// Writes an entry to the disk tier, replacing any file with its hash
+static void rcache_store(const char* dir, const rcache_entry* e) {
+    static unsigned int seq;
+    rcache_file h = { .magic = RCACHE_FILE_MAGIC, .version = RCACHE_FILE_VERSION,
+                      .rng_words = e->has_rng ? NYMYA_RNG_STATE_WORDS : 0,
+                      .key_len = e->key_len, .value_bytes = e->value_bytes };
+    char* path = rcache_path(dir, e->hash);
+    char* tmp = malloc(strlen(dir) + 64);
+    FILE* f = NULL;
+    int ok = 0;
+
+    if (!path || !tmp) goto out;
+    sprintf(tmp, "%s/.%016" PRIx64 ".%ld.%u.tmp", dir, e->hash, (long)getpid(),
+            __atomic_fetch_add(&seq, 1, __ATOMIC_RELAXED));
+    f = fopen(tmp, "wbx");
+    if (!f) goto out;
+    ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+         fwrite(e->key, sizeof(*e->key), e->key_len, f) == e->key_len &&
+         fwrite(e->rng, sizeof(*e->rng), h.rng_words, f) == h.rng_words &&
+         fwrite(e->value, 1, e->value_bytes, f) == e->value_bytes;
+    if (fclose(f)) ok = 0;
+    if (ok && rename(tmp, path)) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "[nymya_runtime] Failed to write result cache file %s.\n", path);
+        unlink(tmp);
+    }
+
+out:
+    free(path);
+    free(tmp);
+}
+
+// Copy of the disk-tier directory, or NULL without one
+static char* rcache_dir(void) {
+    char* dir = NULL;
+
+    pthread_mutex_lock(&rcache.lock);
+    if (rcache.dir) dir = strdup(rcache.dir);
+    pthread_mutex_unlock(&rcache.lock);
+    return dir;
+}
+
+/**
+ * nymya_rcache_get - Looks a call up.
+ * @k: Key of the call.
+ * @out: Receives the stored result on a hit.
+ * @bytes: Size of the result.
+ *
+ * Tries memory, then the disk tier, which fills memory on a hit. A hit on a
+ * random result restores the generator state its run left behind.
+ *
+ * Returns 0 on a hit, -1 on a miss or for an inactive key.
+ */
+int nymya_rcache_get(nymya_rcache_key* k, void* out, size_t bytes) {
+    uint64_t hash;
+    rcache_entry* e;
+    char* dir;
+
+    if (!k->active) return -1;
+    hash = rcache_hash(k->words, k->len);
+
+    pthread_mutex_lock(&rcache.lock);
+    e = rcache_find(hash, k->words, k->len);
+    if (e && e->value_bytes == bytes) {
+        rcache.hits++;
+        rcache_unlink(e);
+        rcache_push_front(e);
+        rcache_serve(e, out);
+        pthread_mutex_unlock(&rcache.lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&rcache.lock);
+
+    // The file is read without the lock, so other lookups carry on meanwhile
+    dir = rcache_dir();
+    e = dir ? rcache_load(dir, k, hash, bytes) : NULL;
+    free(dir);
+
+    pthread_mutex_lock(&rcache.lock);
+    if (e) {
+        rcache.disk_hits++;
+        rcache_serve(e, out);
+        rcache_insert(e);
+    } else {
+        rcache.misses++;
+    }
+    pthread_mutex_unlock(&rcache.lock);
+    return e ? 0 : -1;
+}
+
+/**
+ * nymya_rcache_put - Stores the result of a call that missed.
+ * @k: Key of the call.
+ * @value: Result.
+ * @bytes: Size of @value.
+ *
+ * Called right after the run, so a random result records the generator
+ * state the run left behind. The entry goes to memory if it fits the limit
+ * and to the disk tier if there is one.
+ */
+void nymya_rcache_put(nymya_rcache_key* k, const void* value, size_t bytes) {
+    rcache_entry* e;
+    char* dir;
+
+    if (!k->active) return;
+    e = calloc(1, sizeof(*e));
+    if (!e) return;
+    e->key = malloc(k->len * sizeof(*e->key));
+    e->value = malloc(bytes ? bytes : 1);
+    if (!e->key || !e->value) {
+        rcache_free(e);
+        return;
+    }
+    memcpy(e->key, k->words, k->len * sizeof(*e->key));
+    memcpy(e->value, value, bytes);
+    e->key_len = k->len;
+    e->hash = rcache_hash(k->words, k->len);
+    e->value_bytes = bytes;
+    e->has_rng = k->random;
+    if (e->has_rng) nymya_rng_save(e->rng);
+    e->bytes = sizeof(*e) + k->len * sizeof(*e->key) + bytes;
+
+    dir = rcache_dir();
+    if (dir) rcache_store(dir, e);
+    free(dir);
+
+    pthread_mutex_lock(&rcache.lock);
+    rcache_insert(e);
+    pthread_mutex_unlock(&rcache.lock);
+}
+
+void nymya_rcache_end(nymya_rcache_key* k) {
+    free(k->words);
+    memset(k, 0, sizeof(*k));
+}
+
+/**
+ * nymya_result_cache_set_limit - Sets the memory tier's budget, evicting as needed.
+ * @bytes: New budget; 0 keeps nothing in memory.
+ *
+ * Overrides NYMYA_RESULT_CACHE. The cache is on while either tier is.
+ */
+void nymya_result_cache_set_limit(size_t bytes) {
+    pthread_once(&rcache_once, rcache_init);
+    pthread_mutex_lock(&rcache.lock);
+    rcache.limit = bytes;
+    rcache_make_room(0);
+    rcache_update_enabled();
+    pthread_mutex_unlock(&rcache.lock);
+}
+
+/**
+ * nymya_result_cache_set_dir - Sets the directory of the disk tier.
+ * @dir: Existing directory, or NULL to turn the disk tier off.
+ *
+ * Overrides NYMYA_RESULT_CACHE_DIR.
+ *
+ * Returns 0 on success, -1 if @dir is not a directory.
+ */
+int nymya_result_cache_set_dir(const char* dir) {
+    struct stat st;
+    char* copy = NULL;
+
+    pthread_once(&rcache_once, rcache_init);
+    if (dir) {
+        if (stat(dir, &st) || !S_ISDIR(st.st_mode)) {
+            fprintf(stderr, "[nymya_runtime] Result cache directory %s does not exist.\n", dir);
+            return -1;
+        }
+        copy = strdup(dir);
+        if (!copy) return -1;
+    }
+    pthread_mutex_lock(&rcache.lock);
+    free(rcache.dir);
+    rcache.dir = copy;
+    rcache_update_enabled();
+    pthread_mutex_unlock(&rcache.lock);
+    return 0;
+}
+
+/**
+ * nymya_result_cache_get_stats - Reads the cache counters.
+ * @out: Receives the counters.
+ */
+void nymya_result_cache_get_stats(nymya_result_cache_stats* out) {
+    if (!out) return;
+    pthread_once(&rcache_once, rcache_init);
+    pthread_mutex_lock(&rcache.lock);
+    out->hits = rcache.hits;
+    out->disk_hits = rcache.disk_hits;
+    out->misses = rcache.misses;
+    out->evictions = rcache.evictions;
+    out->entries = rcache.entries;
+    out->bytes = rcache.bytes;
+    out->limit = rcache.limit;
+    pthread_mutex_unlock(&rcache.lock);
+}
+
+/**
+ * nymya_result_cache_clear - Drops the memory tier and resets the counters.
+ *
+ * Files of the disk tier stay where they are.
+ */
+void nymya_result_cache_clear(void) {
+    pthread_mutex_lock(&rcache.lock);
+    while (rcache.lru)
+        rcache_drop(rcache.lru);
+    rcache.hits = rcache.disk_hits = rcache.misses = rcache.evictions = 0;
+    pthread_mutex_unlock(&rcache.lock);
+}
@@ -0,0 +1,46 @@
+#ifndef NYMYA_RESULT_CACHE_H
+#define NYMYA_RESULT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "nymya_circuit.h"
+#include "nymya_noise.h"
+
+// Kinds of memoised result; part of every key
+typedef enum nymya_rcache_kind {
+    NYMYA_RCACHE_NOISY_SAMPLE = 1,
+    NYMYA_RCACHE_NOISY_EXPECTATION,
+    NYMYA_RCACHE_GRADIENT,
+    NYMYA_RCACHE_EXPECTATION,
+    NYMYA_RCACHE_PROBABILITIES
+} nymya_rcache_kind;
+
+/**
+ * nymya_rcache_key - Key of one call, built up before the lookup.
+ * @words: Key words.
+ * @len: Used entries of @words.
+ * @cap: Allocated entries of @words.
+ * @active: Set when the call is memoised; every other function is a no-op
+ *          on an inactive key.
+ * @random: Set when the result depends on the thread's generator.
+ */
+typedef struct nymya_rcache_key {
+    uint64_t* words;
+    size_t len;
+    size_t cap;
+    int active;
+    int random;
+} nymya_rcache_key;
+
+int nymya_rcache_begin(nymya_rcache_key* k, nymya_rcache_kind kind, const char* backend,
+                       const nymya_circuit* c, int random);
+void nymya_rcache_add(nymya_rcache_key* k, uint64_t word);
+void nymya_rcache_add_double(nymya_rcache_key* k, double v);
+void nymya_rcache_add_qubits(nymya_rcache_key* k, nymya_qubit* const* qubits, size_t n);
+void nymya_rcache_add_observable(nymya_rcache_key* k, const nymya_observable* obs);
+void nymya_rcache_add_noise(nymya_rcache_key* k, const nymya_noise* noise);
+int nymya_rcache_get(nymya_rcache_key* k, void* out, size_t bytes);
+void nymya_rcache_put(nymya_rcache_key* k, const void* value, size_t bytes);
+void nymya_rcache_end(nymya_rcache_key* k);
+
+#endif // NYMYA_RESULT_CACHE_H
@@ -0,0 +1,237 @@
+// nymya_rng.c
+//
+// Thread-local pseudo-random numbers for the simulator: the 3361 QRNG
+// fallback and measurement sampling. Each thread owns NYMYA_RNG_LANES
+// xoshiro256** generators, seeded on first use from getrandom(), or from
+// NYMYA_SIM_SEED for reproducible runs. Nothing is shared between threads,
+// so concurrent samplers never contend.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/random.h>
+#include "nymya_rng.h"
+
+// s[k][l] is word k of lane l's state, so one step is four lane-wise loops
+typedef struct rng_state {
+    uint64_t s[4][NYMYA_RNG_LANES];
+    int ready;
+} rng_state;
+
+static __thread rng_state rng_tls;
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64; expands a single seed into state words
+static uint64_t rng_splitmix(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Seeds the calling thread's lanes; an all-zero lane would stay zero, so
+// the entropy is run through splitmix64 rather than used as is
+static void rng_seed(rng_state* r) {
+    const char* env = getenv("NYMYA_SIM_SEED");
+    uint64_t seed[4 * NYMYA_RNG_LANES];
+    uint64_t x = 0;
+    size_t got = 0;
+    ssize_t n;
+
+    if (env && *env) {
+        x = strtoull(env, NULL, 0);
+    } else {
+        while (got < sizeof(seed)) {
+            n = getrandom((char*)seed + got, sizeof(seed) - got, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            got += (size_t)n;
+        }
+        if (got < sizeof(seed)) {
+            struct timespec ts;
+
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            x = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+            x ^= (uint64_t)(uintptr_t)r;
+            got = 0;
+        }
+    }
+
+    for (int k = 0; k < 4; k++)
+        for (int l = 0; l < NYMYA_RNG_LANES; l++)
+            r->s[k][l] = got ? rng_splitmix(&seed[k * NYMYA_RNG_LANES + l])
+                             : rng_splitmix(&x);
+    r->ready = 1;
+}
+
+static inline rng_state* rng_get(void) {
+    rng_state* r = &rng_tls;
+
+    if (!r->ready) rng_seed(r);
+    return r;
+}
+
+/**
+ * nymya_rng_next - Next 64-bit word of the calling thread's first lane.
+ */
+uint64_t nymya_rng_next(void) {
+    rng_state* r = rng_get();
+    uint64_t* s0 = &r->s[0][0], *s1 = &r->s[1][0], *s2 = &r->s[2][0], *s3 = &r->s[3][0];
+    uint64_t v = rng_rotl(*s1 * 5, 7) * 9;
+    uint64_t t = *s1 << 17;
+
+    *s2 ^= *s0;
+    *s3 ^= *s1;
+    *s1 ^= *s2;
+    *s0 ^= *s3;
+    *s2 ^= t;
+    *s3 = rng_rotl(*s3, 45);
+    return v;
+}
+
+/**
+ * nymya_rng_unit - Uniform double in (0, 1], safe to pass to log().
+ */
+double nymya_rng_unit(void) {
+    return ((nymya_rng_next() >> 11) + 1) * 0x1.0p-53;
+}
+
+// Lemire's multiply-shift: high word of x * range, redrawing the few x
+// whose low word lands in the band that would bias the result
+static inline uint64_t rng_bounded(uint64_t x, uint64_t range) {
+    __uint128_t m = (__uint128_t)x * range;
+
+    if ((uint64_t)m < range) {
+        uint64_t floor = -range % range;
+
+        while ((uint64_t)m < floor)
+            m = (__uint128_t)nymya_rng_next() * range;
+    }
+    return (uint64_t)(m >> 64);
+}
+
+/**
+ * nymya_rng_below - Uniform integer in [0, @range), without modulo bias.
+ * @range: Size of the range; 0 stands for 2^64.
+ */
+uint64_t nymya_rng_below(uint64_t range) {
+    uint64_t x = nymya_rng_next();
+
+    return range ? rng_bounded(x, range) : x;
+}
+
+/**
+ * nymya_rng_fill - Fills @out with @n uniform 64-bit words.
+ * @out: Destination.
+ * @n: Number of words.
+ *
+ * Steps all NYMYA_RNG_LANES generators together, one block of words per
+ * step, with the state held in locals so the loop vectorises.
+ */
+void nymya_rng_fill(uint64_t* out, size_t n) {
+    rng_state* r = rng_get();
+    uint64_t s0[NYMYA_RNG_LANES], s1[NYMYA_RNG_LANES], s2[NYMYA_RNG_LANES], s3[NYMYA_RNG_LANES];
+    size_t i = 0;
+
+    memcpy(s0, r->s[0], sizeof(s0));
+    memcpy(s1, r->s[1], sizeof(s1));
+    memcpy(s2, r->s[2], sizeof(s2));
+    memcpy(s3, r->s[3], sizeof(s3));
+
+    for (; i + NYMYA_RNG_LANES <= n; i += NYMYA_RNG_LANES) {
+        for (int l = 0; l < NYMYA_RNG_LANES; l++) {
+            uint64_t t = s1[l] << 17;
+
+            out[i + l] = rng_rotl(s1[l] * 5, 7) * 9;
+            s2[l] ^= s0[l];
+            s3[l] ^= s1[l];
+            s1[l] ^= s2[l];
+            s0[l] ^= s3[l];
+            s2[l] ^= t;
+            s3[l] = rng_rotl(s3[l], 45);
+        }
+    }
+
+    memcpy(r->s[0], s0, sizeof(s0));
+    memcpy(r->s[1], s1, sizeof(s1));
+    memcpy(r->s[2], s2, sizeof(s2));
+    memcpy(r->s[3], s3, sizeof(s3));
+
+    for (; i < n; i++)
+        out[i] = nymya_rng_next();
+}
+
+/**
+ * nymya_rng_range - Fills @out with @n uniform integers in [@min, @max].
+ * @out: Destination.
+ * @n: Number of values.
+ * @min: Smallest value (inclusive).
+ * @max: Largest value (inclusive), at least @min.
+ *
+ * Draws the words in bulk with nymya_rng_fill() and maps them without bias.
+ */
+void nymya_rng_range(uint64_t* out, size_t n, uint64_t min, uint64_t max) {
+    // range wraps to 0 when [min, max] is all of uint64_t
+    uint64_t range = max - min + 1;
+
+    nymya_rng_fill(out, n);
+    if (!range) return;
+    for (size_t i = 0; i < n; i++)
+        out[i] = min + rng_bounded(out[i], range);
+}
+
+/**
+ * nymya_rng_stream - Reseeds the calling thread with stream @stream of @seed.
+ * @seed: Seed shared by a family of streams.
+ * @stream: Index of the stream.
+ *
+ * Lets a job split into numbered tasks draw the same numbers for task
+ * @stream whichever thread runs it.
+ */
+void nymya_rng_stream(uint64_t seed, uint64_t stream) {
+    rng_state* r = &rng_tls;
+    uint64_t x = seed ^ rng_splitmix(&stream);
+
+    for (int k = 0; k < 4; k++)
+        for (int l = 0; l < NYMYA_RNG_LANES; l++)
+            r->s[k][l] = rng_splitmix(&x);
+    r->ready = 1;
+}
+
+/**
+ * nymya_rng_save - Copies out the calling thread's generator state.
+ * @state: Receives NYMYA_RNG_STATE_WORDS words, lane state word k of lane l
+ *         at k * NYMYA_RNG_LANES + l.
+ *
+ * The thread is seeded first if it has not drawn yet, so a restore repeats
+ * exactly the words the thread would have drawn next.
+ */
+void nymya_rng_save(uint64_t state[NYMYA_RNG_STATE_WORDS]) {
+    memcpy(state, rng_get()->s, sizeof(rng_tls.s));
+}
+
+/**
+ * nymya_rng_restore - Continues the calling thread's draws from a saved state.
+ * @state: Words written by nymya_rng_save(), on this or another thread.
+ *
+ * An all-zero lane would never leave zero, so such a state is ignored.
+ */
+void nymya_rng_restore(const uint64_t state[NYMYA_RNG_STATE_WORDS]) {
+    rng_state* r = &rng_tls;
+
+    for (int l = 0; l < NYMYA_RNG_LANES; l++) {
+        if (!(state[l] | state[NYMYA_RNG_LANES + l] | state[2 * NYMYA_RNG_LANES + l] |
+              state[3 * NYMYA_RNG_LANES + l]))
+            return;
+    }
+    memcpy(r->s, state, sizeof(r->s));
+    r->ready = 1;
+}
@@ -0,0 +1,23 @@
+#ifndef NYMYA_RNG_H
+#define NYMYA_RNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Independent xoshiro256** streams per thread; nymya_rng_fill() steps them
+// side by side so the compiler can keep one stream per vector lane
+#define NYMYA_RNG_LANES 4
+
+// Words of generator state per thread, as nymya_rng_save() stores them
+#define NYMYA_RNG_STATE_WORDS (4 * NYMYA_RNG_LANES)
+
+uint64_t nymya_rng_next(void);
+double nymya_rng_unit(void);
+uint64_t nymya_rng_below(uint64_t range);
+void nymya_rng_fill(uint64_t* out, size_t n);
+void nymya_rng_range(uint64_t* out, size_t n, uint64_t min, uint64_t max);
+void nymya_rng_stream(uint64_t seed, uint64_t stream);
+void nymya_rng_save(uint64_t state[NYMYA_RNG_STATE_WORDS]);
+void nymya_rng_restore(const uint64_t state[NYMYA_RNG_STATE_WORDS]);
+
+#endif // NYMYA_RNG_H
@@ -1,38 +1,1369 @@
 // nymya_runtime.c
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <dlfcn.h>
+#include <pthread.h>
 #include <nymya/nymya.h>
 #include "backend_sim.h"
 #include "backend_gateqpu.h"
+#include "backend_stabilizer.h"
+#include "backend_mps.h"
+#include "backend_sparse.h"
+#ifdef NYMYA_WITH_MPI
+#include "backend_dist.h"
+#endif
+#ifdef NYMYA_WITH_CUDA
+#include "backend_gpu.h"
+#endif
+#include "nymya_circuit.h"
+#include "nymya_ckpt.h"
+#include "nymya_noise.h"
+#include "nymya_rng.h"
+#include "nymya_backend.h"
+#include "nymya_memory.h"
+#include "nymya_profile.h"
+#include "nymya_result_cache.h"
+#include "sim_pool.h"
 
-// Runtime context
-typedef enum {
-    NYMYA_BACKEND_SIM,
-    NYMYA_BACKEND_GATEQPU
-} nymya_backend_t;
+#define NYMYA_MAX_BACKENDS 16
 
-static nymya_backend_t active_backend = NYMYA_BACKEND_SIM;
+// A registered backend with its gate table resolved
+typedef struct nymya_backend_slot {
+    const nymya_backend* b;
+    nymya_gate_fn gates[NYMYA_GATE_COUNT];
+} nymya_backend_slot;
+
+// Registry shared by all threads; slots never move once added
+static nymya_backend_slot backends[NYMYA_MAX_BACKENDS];
+static size_t nbackends;
+static pthread_mutex_t backends_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t backends_once = PTHREAD_ONCE_INIT;
+
+/**
+ * nymya_runtime_ctx - Runtime state of one thread.
+ * @active: Backend that gate calls go to.
+ * @recording: Circuit that gate calls are recorded into, or NULL to execute them.
+ * @sim_on_stabilizer: Set once the simulator routed a Clifford circuit to the
+ *                     stabilizer backend, which then holds the simulator's state
+ *                     until nymya_reset().
+ * @sim_on_mps: Set once a circuit over the memory budget was moved from the
+ *              simulator to the MPS backend, which then holds the simulator's
+ *              state until nymya_reset().
+ * @pool: Private simulator worker pool, or NULL for the process pool.
+ *
+ * Backend state (registers, tableaus, chains) and the circuit cache are
+ * thread-local, so together with this struct a thread shares nothing mutable
+ * with other threads.
+ */
+struct nymya_runtime_ctx {
+    const nymya_backend_slot* active;
+    nymya_circuit* recording;
+    int sim_on_stabilizer;
+    int sim_on_mps;
+    sim_pool* pool;
+};
+
+// Context of the calling thread: an explicit one, or the thread's default
+static __thread nymya_runtime_ctx* ctx_cur;
+static __thread nymya_runtime_ctx ctx_default;
+
+// Tears the thread's context down when the thread exits
+static pthread_key_t ctx_key;
+
+// The "sim" backend follows its state onto the stabilizer or MPS backend
+static int nymya_sim_apply_gate(int gate_code, void* args) {
+    if (ctx_cur->sim_on_mps)
+        return backend_mps_apply_gate(gate_code, args);
+    if (!ctx_cur->sim_on_stabilizer)
+        return backend_sim_apply_gate(gate_code, args);
+    if (!backend_stabilizer_supports(gate_code)) {
+        fprintf(stderr, "[nymya_runtime] Gate %d is not Clifford; the simulator state is on "
+                "the stabilizer backend until nymya_reset().\n", gate_code);
+        return -1;
+    }
+    return backend_stabilizer_apply_gate(gate_code, args);
+}
+
+static int nymya_sim_prob_one(const nymya_qubit* q, double* p) {
+    if (ctx_cur->sim_on_mps) return backend_mps_prob_one(q, p);
+    return ctx_cur->sim_on_stabilizer ? backend_stabilizer_prob_one(q, p) : backend_sim_prob_one(q, p);
+}
+
+// Built-in backends; the first one is active until nymya_set_backend()
+static const nymya_backend builtin_backends[] = {
+    { .name = "sim", .label = "simulator", .apply_gate = nymya_sim_apply_gate,
+      .prob_one = nymya_sim_prob_one, .reset = backend_sim_reset },
+    { .name = "stabilizer", .label = "stabilizer", .apply_gate = backend_stabilizer_apply_gate,
+      .prob_one = backend_stabilizer_prob_one, .reset = backend_stabilizer_reset },
+    { .name = "mps", .label = "MPS", .apply_gate = backend_mps_apply_gate,
+      .prob_one = backend_mps_prob_one, .reset = backend_mps_reset },
+    { .name = "sparse", .label = "sparse", .apply_gate = backend_sparse_apply_gate,
+      .prob_one = backend_sparse_prob_one, .reset = backend_sparse_reset },
+#ifdef NYMYA_WITH_MPI
+    { .name = "dist", .label = "distributed", .apply_gate = backend_dist_apply_gate,
+      .prob_one = backend_dist_prob_one, .reset = backend_dist_reset },
+#endif
+#ifdef NYMYA_WITH_CUDA
+    { .name = "gpu", .label = "GPU", .apply_gate = backend_gpu_apply_gate,
+      .prob_one = backend_gpu_prob_one, .reset = backend_gpu_reset },
+#endif
+    { .name = "gateqpu", .label = "gate-based QPU", .apply_gate = backend_gateqpu_apply_gate,
+      .reset = backend_gateqpu_reset, .flush = backend_gateqpu_flush },
+};
+
+static int nymya_backend_add(const nymya_backend* b) {
+    nymya_backend_slot* s;
+
+    if (!b || !b->name || !b->label || !b->apply_gate) return -1;
+    for (size_t i = 0; i < nbackends; i++) {
+        if (strcmp(backends[i].b->name, b->name) == 0) {
+            fprintf(stderr, "[nymya_runtime] Backend %s is already registered.\n", b->name);
+            return -1;
+        }
+    }
+    if (nbackends == NYMYA_MAX_BACKENDS) {
+        fprintf(stderr, "[nymya_runtime] No room to register backend %s.\n", b->name);
+        return -1;
+    }
+
+    s = &backends[nbackends++];
+    s->b = b;
+    for (size_t i = 0; i < NYMYA_GATE_COUNT; i++)
+        s->gates[i] = b->gates[i] ? b->gates[i] : b->apply_gate;
+    return 0;
+}
+
+static void nymya_ctx_exit(void* ctx);
+
+static void nymya_backends_init(void) {
+    for (size_t i = 0; i < sizeof(builtin_backends) / sizeof(builtin_backends[0]); i++)
+        nymya_backend_add(&builtin_backends[i]);
+    pthread_key_create(&ctx_key, nymya_ctx_exit);
+    nymya_profile_init();
+}
+
+// The calling thread's context, set up on first use
+static nymya_runtime_ctx* nymya_ctx(void) {
+    if (ctx_cur) return ctx_cur;
+
+    pthread_once(&backends_once, nymya_backends_init);
+    ctx_default.active = &backends[0];
+    ctx_cur = &ctx_default;
+    pthread_setspecific(ctx_key, ctx_cur);
+    return ctx_cur;
+}
+
+int nymya_register_backend(const nymya_backend* b) {
+    int ret;
+
+    pthread_once(&backends_once, nymya_backends_init);
+    pthread_mutex_lock(&backends_lock);
+    ret = nymya_backend_add(b);
+    pthread_mutex_unlock(&backends_lock);
+    return ret;
+}
+
+static const nymya_backend_slot* nymya_backend_find(const char* name) {
+    for (size_t i = 0; i < nbackends; i++) {
+        if (strcmp(backends[i].b->name, name) == 0) return &backends[i];
+    }
+    return NULL;
+}
+
+/**
+ * nymya_backend_load - Registers an out-of-tree backend from a shared object.
+ * @name: Backend name, or a path if it contains a '/'.
+ *
+ * The object stays loaded for the life of the process.
+ *
+ * Returns the new slot, or NULL if the object cannot be loaded or does not
+ * export a usable backend.
+ */
+static const nymya_backend_slot* nymya_backend_load(const char* name) {
+    char path[256];
+    nymya_backend_entry_fn entry;
+    const nymya_backend* b;
+    void* h;
+
+    if (strchr(name, '/'))
+        snprintf(path, sizeof(path), "%s", name);
+    else
+        snprintf(path, sizeof(path), "libnymya-backend-%s.so", name);
+
+    h = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!h) {
+        fprintf(stderr, "[nymya_runtime] Unknown backend: %s (%s)\n", name, dlerror());
+        return NULL;
+    }
+    *(void**)&entry = dlsym(h, NYMYA_BACKEND_ENTRY);
+    b = entry ? entry() : NULL;
+    if (nymya_backend_add(b)) {
+        fprintf(stderr, "[nymya_runtime] %s does not provide a usable backend.\n", path);
+        dlclose(h);
+        return NULL;
+    }
+    return &backends[nbackends - 1];
+}
 
 void nymya_set_backend(const char* backend_name) {
-    if (strcmp(backend_name, "sim") == 0) {
-        active_backend = NYMYA_BACKEND_SIM;
-        printf("[nymya_runtime] Switched to simulator backend.\n");
-    } else if (strcmp(backend_name, "gateqpu") == 0) {
-        active_backend = NYMYA_BACKEND_GATEQPU;
-        printf("[nymya_runtime] Switched to gate-based QPU backend.\n");
-    } else {
-        fprintf(stderr, "[nymya_runtime] Unknown backend: %s\n", backend_name);
+    nymya_runtime_ctx* ctx = nymya_ctx();
+    const nymya_backend_slot* s;
+
+    if (!backend_name) return;
+    pthread_mutex_lock(&backends_lock);
+    s = nymya_backend_find(backend_name);
+    if (!s) s = nymya_backend_load(backend_name);
+    pthread_mutex_unlock(&backends_lock);
+    if (!s) return;
+
+    if (s != ctx->active) nymya_flush();
+    ctx->active = s;
+    printf("[nymya_runtime] Switched to %s backend.\n", s->b->label);
+}
+
+int nymya_flush(void) {
+    const nymya_backend* b = nymya_ctx()->active->b;
+
+    return b->flush ? b->flush() : 0;
+}
+
+void nymya_set_threads(unsigned int threads) {
+    int n = backend_sim_set_threads(threads);
+
+    printf("[nymya_runtime] Simulator uses %d thread%s.\n", n, n == 1 ? "" : "s");
+}
+
+// Maps the public precision onto the state-vector storage mode (-1 = default)
+static int nymya_sim_precision(nymya_precision precision) {
+    switch (precision) {
+        case NYMYA_PRECISION_DOUBLE: return SIM_SV_DOUBLE;
+        case NYMYA_PRECISION_FLOAT: return SIM_SV_FLOAT;
+        case NYMYA_PRECISION_MIXED: return SIM_SV_MIXED;
+        default: return -1;
     }
 }
 
-int nymya_apply_gate(int gate_code, void* args) {
-    switch (active_backend) {
-        case NYMYA_BACKEND_SIM:
-            return backend_sim_apply_gate(gate_code, args);
-        case NYMYA_BACKEND_GATEQPU:
-            return backend_gateqpu_apply_gate(gate_code, args);
-        default:
-            fprintf(stderr, "[nymya_runtime] Invalid backend selected.\n");
+int nymya_set_precision(nymya_precision precision) {
+    if (backend_sim_set_precision(nymya_sim_precision(precision))) {
+        fprintf(stderr, "[nymya_runtime] Not enough memory to convert the simulator register.\n");
+        return -1;
+    }
+    return 0;
+}
+
+void nymya_circuit_set_precision(nymya_circuit* c, nymya_precision precision) {
+    if (c) c->precision = precision;
+}
+
+void nymya_mps_set_limits(unsigned int max_bond, double cutoff) {
+    backend_mps_set_limits(max_bond, cutoff);
+}
+
+void nymya_mps_get_stats(nymya_mps_stats* out) {
+    if (out) backend_mps_get_stats(out);
+}
+
+void nymya_sparse_set_threshold(size_t support) {
+    backend_sparse_set_threshold(support);
+}
+
+size_t nymya_sparse_support(void) {
+    return backend_sparse_support();
+}
+
+int nymya_dist_rank(void) {
+#ifdef NYMYA_WITH_MPI
+    return backend_dist_rank();
+#else
+    return 0;
+#endif
+}
+
+int nymya_circuit_begin(void) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+
+    if (ctx->recording) {
+        fprintf(stderr, "[nymya_runtime] A circuit is already being recorded.\n");
+        return -1;
+    }
+    ctx->recording = nymya_circuit_new();
+    return ctx->recording ? 0 : -1;
+}
+
+nymya_circuit* nymya_circuit_end(void) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+    nymya_circuit* c = ctx->recording;
+
+    if (!c) fprintf(stderr, "[nymya_runtime] No circuit is being recorded.\n");
+    ctx->recording = NULL;
+    // A failed pass leaves the circuit as recorded; without a key it still
+    // runs, it just never hits the cache
+    if (c) {
+        nymya_circuit_optimize(c);
+        nymya_circuit_seal(c);
+    }
+    return c;
+}
+
+static int nymya_circuit_is_clifford(const nymya_circuit* c) {
+    for (size_t i = 0; i < c->count; i++) {
+        if (!backend_stabilizer_supports(c->nodes[i].gate_code)) return 0;
+    }
+    return 1;
+}
+
+// Reports a job the memory budget refused
+static int nymya_mem_reject(const char* what, const nymya_mem_estimate* e) {
+    fprintf(stderr, "[nymya_runtime] %s needs %.0f MiB on the %s backend, over the %.0f MiB "
+            "memory budget.\n", what, nymya_mem_mib(e->total), e->backend,
+            nymya_mem_mib(nymya_mem_budget()));
+    return -1;
+}
+
+static const char* nymya_precision_name(nymya_precision precision) {
+    return precision == NYMYA_PRECISION_DOUBLE ? "double" :
+           precision == NYMYA_PRECISION_FLOAT ? "float" : "mixed";
+}
+
+/**
+ * nymya_sim_admit - Fits a "sim" job into the memory budget.
+ * @c: Circuit, or NULL for the live register only.
+ * @mode: Registers the job uses.
+ * @nw: Worker threads of the job; lowered if a downgrade needs fewer.
+ * @shots: Draws that follow the run, or 0.
+ * @precision: Storage the job asks for; becomes NYMYA_PRECISION_FLOAT if a
+ *             downgrade needs it.
+ * @e: Receives the estimate of the job as asked.
+ *
+ * Under NYMYA_MEM_DOWNGRADE, fewer workers at the asked storage are tried
+ * first, then float storage for a job that would run in double. An estimate
+ * that cannot be made admits the job, which then fails on its own.
+ *
+ * Returns 0 if the job fits as updated, -1 otherwise.
+ */
+static int nymya_sim_admit(const nymya_circuit* c, nymya_mem_mode mode, unsigned int* nw,
+                           unsigned int shots, nymya_precision* precision, nymya_mem_estimate* e) {
+    size_t budget = nymya_mem_budget();
+    nymya_precision tries[2] = { *precision, NYMYA_PRECISION_FLOAT };
+    nymya_mem_estimate d;
+
+    if (!budget || nymya_mem_estimate_sim(c, *precision, mode, *nw, shots, e)) return 0;
+    if (e->total <= budget) return 0;
+    if (nymya_mem_get_policy() != NYMYA_MEM_DOWNGRADE) return -1;
+
+    for (int t = 0; t < 2; t++) {
+        if (t && e->precision != NYMYA_PRECISION_DOUBLE) break;
+        for (unsigned int w = *nw; w >= 1; w--) {
+            if (nymya_mem_estimate_sim(c, tries[t], mode, w, shots, &d)) return 0;
+            if (d.total > budget) continue;
+            fprintf(stderr, "[nymya_runtime] Job runs in %s storage on %u worker%s to stay within "
+                    "the %.0f MiB memory budget.\n", nymya_precision_name(d.precision), w,
+                    w == 1 ? "" : "s", nymya_mem_mib(budget));
+            *nw = w;
+            if (t) *precision = NYMYA_PRECISION_FLOAT;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * nymya_circuit_estimate - Peak memory of running and sampling a circuit.
+ * @c: Circuit, or NULL for the state the thread already holds.
+ * @shots: Draws of a following nymya_sample(), or 0.
+ * @out: Receives the estimate.
+ *
+ * The estimate is for the backend the circuit would run on: the stabilizer
+ * backend for a Clifford circuit on a fresh simulator, the backend holding
+ * the simulator's state, or the active backend. Sampling always reads the
+ * state vector.
+ *
+ * Returns 0 on success, -1 if the backend has no estimate or memory runs out.
+ */
+int nymya_circuit_estimate(const nymya_circuit* c, unsigned int shots, nymya_mem_estimate* out) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+    const char* name = ctx->active->b->name;
+
+    if (!out) return -1;
+    if (ctx->active == &backends[0]) {
+        if (ctx->sim_on_mps) name = "mps";
+        else if (ctx->sim_on_stabilizer) name = "stabilizer";
+        else if (c && !shots && backend_sim_num_qubits() == 0 && !getenv("NYMYA_SIM_NOSTAB") &&
+                 nymya_circuit_is_clifford(c))
+            name = "stabilizer";
+        else
+            return nymya_mem_estimate_sim(c, c ? c->precision : NYMYA_PRECISION_DEFAULT,
+                                          NYMYA_MEM_LIVE, 1, shots, out);
+    }
+    if (strcmp(name, "mps") == 0) {
+        nymya_mem_estimate_mps(c, out);
+        return 0;
+    }
+    if (strcmp(name, "stabilizer") == 0) {
+        nymya_mem_estimate_stabilizer(c, out);
+        return 0;
+    }
+    fprintf(stderr, "[nymya_runtime] The %s backend has no memory estimate.\n", name);
+    return -1;
+}
+
+static int nymya_circuit_run_body(nymya_runtime_ctx* ctx, const nymya_circuit* c) {
+    nymya_precision precision;
+    nymya_mem_estimate e, m;
+    unsigned int nw = 1;
+
+    if (!c) return -1;
+    if (ctx->recording) return nymya_circuit_replay(c);
+    if (nymya_circuit_unbound(c)) return -1;
+    if (ctx->active != &backends[0]) {
+        int ret = nymya_circuit_replay(c);
+        int fl = nymya_flush();
+        return ret ? ret : fl;
+    }
+
+    // A Clifford-only circuit on a fresh simulator runs in polynomial time
+    if (!ctx->sim_on_stabilizer && !ctx->sim_on_mps && backend_sim_num_qubits() == 0 &&
+        !getenv("NYMYA_SIM_NOSTAB") && nymya_circuit_is_clifford(c))
+        ctx->sim_on_stabilizer = 1;
+    if (ctx->sim_on_stabilizer || ctx->sim_on_mps)
+        return nymya_circuit_replay(c);
+
+    precision = c->precision;
+    if (nymya_sim_admit(c, NYMYA_MEM_LIVE, &nw, 0, &precision, &e)) {
+        // An empty register can hand the whole circuit to the MPS backend
+        if (nymya_mem_get_policy() == NYMYA_MEM_DOWNGRADE && backend_sim_num_qubits() == 0) {
+            nymya_mem_estimate_mps(c, &m);
+            if (m.total <= nymya_mem_budget()) {
+                fprintf(stderr, "[nymya_runtime] Circuit runs on the MPS backend to stay within "
+                        "the %.0f MiB memory budget.\n", nymya_mem_mib(nymya_mem_budget()));
+                ctx->sim_on_mps = 1;
+                return nymya_circuit_replay(c);
+            }
+        }
+        return nymya_mem_reject("Circuit", &e);
+    }
+    if (precision != NYMYA_PRECISION_DEFAULT && nymya_set_precision(precision))
+        return -1;
+    return backend_sim_run_circuit(c);
+}
+
+int nymya_circuit_run(const nymya_circuit* c) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+
+    return NYMYA_PROFILE_CALL("circuit_run", ctx->active->b->name, c,
+                              nymya_circuit_run_body(ctx, c));
+}
+
+// Work callback of nymya_run_workers(); runs once per worker
+typedef int (*nymya_worker_fn)(void* arg, unsigned int w, unsigned int nw);
+
+typedef struct nymya_worker {
+    pthread_t thread;
+    nymya_worker_fn fn;
+    void* arg;
+    unsigned int w;
+    unsigned int nw;
+    int ret;
+} nymya_worker;
+
+static void* nymya_worker_main(void* arg) {
+    nymya_worker* wk = arg;
+    nymya_runtime_ctx* ctx = nymya_ctx_new(1);
+
+    wk->ret = ctx ? wk->fn(wk->arg, wk->w, wk->nw) : -1;
+    if (ctx) nymya_ctx_free(ctx);
+    return NULL;
+}
+
+/**
+ * nymya_workers - One nymya_run_workers() call on the simulator pool.
+ * @fn: Callback.
+ * @arg: Callback argument.
+ * @ret: Result of each task.
+ */
+typedef struct nymya_workers {
+    nymya_worker_fn fn;
+    void* arg;
+    int ret[SIM_POOL_MAX_THREADS];
+} nymya_workers;
+
+// Exclusive pool task: a context of its own whose sweeps stay on the pool
+static void nymya_worker_task(void* arg, unsigned int w, unsigned int nw) {
+    nymya_workers* ws = arg;
+    sim_pool* pool = sim_pool_current();
+    nymya_runtime_ctx* ctx = nymya_ctx_new(0);
+
+    if (!ctx) {
+        ws->ret[w] = -1;
+        return;
+    }
+    sim_pool_use(pool);
+    ws->ret[w] = ws->fn(ws->arg, w, nw);
+    nymya_ctx_free(ctx);
+}
+
+/**
+ * nymya_run_workers - Runs @fn(arg, w, nw) as @nw tasks and waits for them.
+ * @nw: Number of tasks, 1 to SIM_POOL_MAX_THREADS.
+ * @fn: Callback.
+ * @arg: Callback argument.
+ *
+ * The tasks run on the calling thread's simulator pool, each on a worker
+ * with a context of its own, so none of the caller's state is touched. A
+ * task's own gates are swept by the workers the other tasks leave idle, so
+ * few large tasks use the whole pool and many small ones do not
+ * oversubscribe it. A pool without workers, or a call from inside a task,
+ * gets @nw new threads without simulator workers instead. A pool with
+ * fewer workers runs fewer tasks and passes the smaller @nw to @fn; threads
+ * that fail to start have their share run by the others only if @fn claims
+ * work dynamically.
+ *
+ * Returns 0, or the first nonzero callback result.
+ */
+static int nymya_run_workers(unsigned int nw, nymya_worker_fn fn, void* arg) {
+    nymya_worker wk[SIM_POOL_MAX_THREADS];
+    nymya_workers ws = { .fn = fn, .arg = arg };
+    unsigned int started = 0;
+    int ret = 0;
+
+    if (nw > SIM_POOL_MAX_THREADS) nw = SIM_POOL_MAX_THREADS;
+    if (sim_pool_run_exclusive(nw, nymya_worker_task, &ws) == 0) {
+        for (unsigned int w = 0; w < nw && !ret; w++)
+            ret = ws.ret[w];
+        return ret;
+    }
+
+    for (unsigned int w = 0; w < nw; w++) {
+        wk[w] = (nymya_worker){ .fn = fn, .arg = arg, .w = w, .nw = nw };
+        if (pthread_create(&wk[w].thread, NULL, nymya_worker_main, &wk[w]) != 0) break;
+        started++;
+    }
+    if (started < nw) ret = -1;
+    for (unsigned int w = 0; w < started; w++) {
+        pthread_join(wk[w].thread, NULL);
+        if (!ret) ret = wk[w].ret;
+    }
+    return ret;
+}
+
+// Worker threads for @n independent items: the calling thread's pool size, at most @n
+static unsigned int nymya_worker_count(size_t n) {
+    unsigned int nw = sim_pool_threads();
+
+    if (nw > n) nw = (unsigned int)n;
+    return nw < 1 ? 1 : nw;
+}
+
+/**
+ * nymya_batch - One nymya_circuit_run_batch() call, shared by its workers.
+ * @c: Circuit.
+ * @plan: Its compiled plan, read by every worker.
+ * @precision: Storage of the workers' registers.
+ * @params: Parameter sets, c->nparams values each.
+ * @nsets: Number of sets.
+ * @fn: Per-set callback, or NULL.
+ * @user: Passed to @fn.
+ * @next: Next set to claim.
+ */
+typedef struct nymya_batch {
+    const nymya_circuit* c;
+    const sim_plan* plan;
+    nymya_precision precision;
+    const double* params;
+    size_t nsets;
+    nymya_batch_fn fn;
+    void* user;
+    size_t next;
+} nymya_batch;
+
+static int nymya_batch_worker(void* arg, unsigned int w, unsigned int nw) {
+    nymya_batch* b = arg;
+
+    (void)w;
+    (void)nw;
+    if (b->precision != NYMYA_PRECISION_DEFAULT && nymya_set_precision(b->precision))
+        return -1;
+    for (;;) {
+        size_t i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED);
+        int ret;
+
+        if (i >= b->nsets) return 0;
+        ret = backend_sim_run_bound(b->c, b->plan, b->params ? b->params + i * b->c->nparams : NULL);
+        if (!ret && b->fn) ret = b->fn(i, b->user);
+        if (ret) {
+            // Stop every worker at its next claim
+            __atomic_store_n(&b->next, b->nsets, __ATOMIC_RELAXED);
+            return ret;
+        }
+    }
+}
+
+/**
+ * nymya_batch_run - Compiles a batch's circuit once and runs its sets on workers.
+ * @b: Batch, with its circuit, parameters, set count and callback set.
+ * @what: Job name for messages and the profile.
+ *
+ * Returns 0 when every set ran, otherwise the first failing gate or
+ * callback result.
+ */
+static int nymya_batch_run(nymya_batch* b, const char* what) {
+    const nymya_circuit* c = b->c;
+    sim_ops ops = { 0 };
+    sim_plan* plan = NULL;
+    nymya_mem_estimate e;
+    unsigned int nw;
+    int owned = 0, ret;
+
+    nymya_ctx();
+
+    nw = nymya_worker_count(b->nsets);
+    b->precision = c->precision;
+    if (nymya_sim_admit(c, NYMYA_MEM_BATCH, &nw, 0, &b->precision, &e))
+        return nymya_mem_reject("Batch", &e);
+
+    if (backend_sim_lower_circuit(c, b->params, &ops) == 0)
+        plan = backend_sim_compile(c, &ops, &owned);
+    sim_ops_free(&ops);
+    if (!plan) {
+        fprintf(stderr, "[nymya_runtime] Circuit cannot be compiled for a batch run.\n");
+        return -1;
+    }
+    b->plan = plan;
+    ret = NYMYA_PROFILE_CALL(what, backends[0].b->name, c,
+                             nymya_run_workers(nw, nymya_batch_worker, b));
+
+    if (owned) sim_plan_free(plan);
+    return ret;
+}
+
+/**
+ * nymya_circuit_run_batch - Runs a parametric circuit once per parameter set.
+ * @c: Sealed circuit.
+ * @params: @nsets rows of nymya_circuit_num_params(@c) values.
+ * @nsets: Number of parameter sets.
+ * @fn: Called as @fn(set, @user) on the worker that ran the set, while its
+ *      final state is that thread's simulator state; may be NULL.
+ * @user: Passed to @fn.
+ *
+ * The circuit is lowered and its fusion plan built once, on the calling
+ * thread; tasks on the calling thread's simulator pool, one per worker,
+ * then claim sets and rebuild only the gate matrices for each. The caller's
+ * own state is not touched.
+ *
+ * Returns 0 when every set ran, otherwise the first failing gate or
+ * callback result (later sets may then be skipped).
+ */
+int nymya_circuit_run_batch(const nymya_circuit* c, const double* params, size_t nsets,
+                            nymya_batch_fn fn, void* user) {
+    nymya_batch b = { .c = c, .params = params, .nsets = nsets, .fn = fn, .user = user };
+
+    if (!c || (c->nparams && !params)) return -1;
+    if (!nsets) return 0;
+    return nymya_batch_run(&b, "run_batch");
+}
+
+// Reads of nymya_circuit_expectation() and nymya_circuit_probabilities()
+typedef struct nymya_reads {
+    const nymya_observable* obs;
+    nymya_qubit* const* qubits;
+    size_t nqubits;
+    double* out;
+} nymya_reads;
+
+static int nymya_reads_fn(size_t set, void* user) {
+    nymya_reads* r = user;
+
+    (void)set;
+    if (r->obs) return backend_sim_expectation(r->obs, r->out);
+    for (size_t i = 0; i < r->nqubits; i++) {
+        r->out[i] = 0;
+        if (backend_sim_has_qubit(r->qubits[i]->id) && backend_sim_prob_one(r->qubits[i], &r->out[i]))
             return -1;
     }
+    return 0;
+}
+
+/**
+ * nymya_circuit_expectation - Expectation value of an observable after a circuit.
+ * @c: Sealed circuit, run from |0...0> with its bound values.
+ * @obs: Observable.
+ * @out: Receives <@obs>.
+ *
+ * The run takes a worker thread of its own, so the caller's state is not
+ * touched. Memoised by the result cache.
+ *
+ * Returns 0 on success, -1 otherwise.
+ */
+int nymya_circuit_expectation(const nymya_circuit* c, const nymya_observable* obs, double* out) {
+    nymya_reads r = { .obs = obs, .out = out };
+    nymya_batch b = { .c = c, .nsets = 1, .fn = nymya_reads_fn, .user = &r };
+    nymya_rcache_key key;
+    int ret;
+
+    if (!c || !obs || !out || nymya_circuit_unbound(c)) return -1;
+    if (!nymya_rcache_begin(&key, NYMYA_RCACHE_EXPECTATION, backends[0].b->name, c, 0)) {
+        nymya_rcache_add_observable(&key, obs);
+        if (!nymya_rcache_get(&key, out, sizeof(*out))) {
+            nymya_rcache_end(&key);
+            return 0;
+        }
+    }
+    ret = nymya_batch_run(&b, "expectation");
+    if (!ret) nymya_rcache_put(&key, out, sizeof(*out));
+    nymya_rcache_end(&key);
+    return ret ? -1 : 0;
+}
+
+/**
+ * nymya_circuit_probabilities - Probability of |1> of each qubit after a circuit.
+ * @c: Sealed circuit, run from |0...0> with its bound values.
+ * @qubits: Qubits to read.
+ * @nqubits: Number of entries in @qubits.
+ * @out: Receives @nqubits probabilities; a qubit no gate has used reads 0.
+ *
+ * As nymya_circuit_expectation(), on a worker thread and memoised.
+ *
+ * Returns 0 on success, -1 otherwise.
+ */
+int nymya_circuit_probabilities(const nymya_circuit* c, nymya_qubit* const* qubits,
+                                size_t nqubits, double* out) {
+    nymya_reads r = { .qubits = qubits, .nqubits = nqubits, .out = out };
+    nymya_batch b = { .c = c, .nsets = 1, .fn = nymya_reads_fn, .user = &r };
+    nymya_rcache_key key;
+    int ret;
+
+    if (!c || (nqubits && (!qubits || !out)) || nymya_circuit_unbound(c)) return -1;
+    for (size_t i = 0; i < nqubits; i++)
+        if (!qubits[i]) return -1;
+    if (!nymya_rcache_begin(&key, NYMYA_RCACHE_PROBABILITIES, backends[0].b->name, c, 0)) {
+        nymya_rcache_add_qubits(&key, qubits, nqubits);
+        if (!nymya_rcache_get(&key, out, nqubits * sizeof(*out))) {
+            nymya_rcache_end(&key);
+            return 0;
+        }
+    }
+    ret = nymya_batch_run(&b, "probabilities");
+    if (!ret) nymya_rcache_put(&key, out, nqubits * sizeof(*out));
+    nymya_rcache_end(&key);
+    return ret ? -1 : 0;
+}
+
+/**
+ * nymya_traj - One noisy sampling or expectation job, shared by its workers.
+ * @c: Circuit.
+ * @ops: @c lowered, read by every worker.
+ * @noise: Noise model.
+ * @precision: Storage of the workers' registers.
+ * @count: Number of trajectories.
+ * @seed: Seed of the trajectories' random streams.
+ * @shots: Total shots to draw, or 0 for an expectation job.
+ * @qubits: Measured qubits.
+ * @nqubits: Number of entries in @qubits.
+ * @out: Packed shots, each trajectory filling its own rows.
+ * @obs: Observable of an expectation job.
+ * @values: <@obs> of each trajectory.
+ * @next: Next trajectory to claim.
+ */
+typedef struct nymya_traj {
+    const nymya_circuit* c;
+    const sim_ops* ops;
+    const nymya_noise* noise;
+    nymya_precision precision;
+    unsigned int count;
+    uint64_t seed;
+    unsigned int shots;
+    nymya_qubit* const* qubits;
+    size_t nqubits;
+    uint64_t* out;
+    const nymya_observable* obs;
+    double* values;
+    unsigned int next;
+} nymya_traj;
+
+static int nymya_traj_worker(void* arg, unsigned int w, unsigned int nw) {
+    nymya_traj* tr = arg;
+    size_t words = (tr->nqubits + 63) / 64;
+
+    (void)w;
+    (void)nw;
+    if (tr->precision != NYMYA_PRECISION_DEFAULT && nymya_set_precision(tr->precision))
+        return -1;
+    for (;;) {
+        unsigned int t = __atomic_fetch_add(&tr->next, 1, __ATOMIC_RELAXED);
+        // Trajectory t draws shots [lo, hi)
+        uint64_t lo = (uint64_t)tr->shots * t / tr->count;
+        uint64_t hi = (uint64_t)tr->shots * (t + 1) / tr->count;
+        int ret;
+
+        if (t >= tr->count) return 0;
+        nymya_rng_stream(tr->seed, t);
+        ret = backend_sim_run_noisy(tr->c, tr->ops, tr->noise);
+        if (!ret && tr->obs) ret = backend_sim_expectation(tr->obs, &tr->values[t]);
+        if (!ret && hi > lo) {
+            ret = backend_sim_sample(tr->qubits, tr->nqubits, (unsigned int)(hi - lo),
+                                     tr->out + lo * words);
+            if (!ret) nymya_noise_readout(tr->noise, tr->out + lo * words, (unsigned int)(hi - lo),
+                                          tr->nqubits);
+        }
+        if (ret) {
+            __atomic_store_n(&tr->next, tr->count, __ATOMIC_RELAXED);
+            return ret;
+        }
+    }
+}
+
+/**
+ * nymya_traj_run - Runs the trajectories of a noisy job on worker threads.
+ * @tr: Job, with its circuit, noise, trajectory count and outputs set.
+ * @what: Job name for messages and the profile.
+ *
+ * Returns 0 when every trajectory ran, -1 otherwise.
+ */
+static int nymya_traj_run(nymya_traj* tr, const char* what) {
+    const nymya_circuit* c = tr->c;
+    sim_ops ops = { 0 };
+    nymya_mem_estimate e;
+    unsigned int nw;
+    int ret;
+
+    if (!c || !tr->noise || nymya_circuit_unbound(c)) return -1;
+    nymya_ctx();
+
+    nw = nymya_worker_count(tr->count);
+    tr->precision = c->precision;
+    if (nymya_sim_admit(c, NYMYA_MEM_BATCH, &nw, tr->shots / tr->count + 1, &tr->precision, &e))
+        return nymya_mem_reject(what, &e);
+    if (backend_sim_lower_circuit(c, NULL, &ops)) {
+        fprintf(stderr, "[nymya_runtime] Circuit cannot be lowered for a noisy run.\n");
+        sim_ops_free(&ops);
+        return -1;
+    }
+    // Drawn from the caller's generator, so NYMYA_SIM_SEED fixes the whole job
+    tr->seed = nymya_rng_next();
+    tr->ops = &ops;
+    ret = NYMYA_PROFILE_CALL(what, backends[0].b->name, c,
+                             nymya_run_workers(nw, nymya_traj_worker, tr));
+    sim_ops_free(&ops);
+    return ret ? -1 : 0;
+}
+
+/**
+ * nymya_noisy_sample - Draws shots of a circuit under noise.
+ * @c: Sealed circuit, run from |0...0>.
+ * @noise: Noise model.
+ * @trajectories: Independent noisy runs; 0 or more than @shots gives one per shot.
+ * @shots: Number of shots, split evenly over the trajectories.
+ * @qubits: Qubits to measure.
+ * @nqubits: Number of entries in @qubits.
+ * @out: Packed results, see nymya_sample(); a trajectory's shots are adjacent.
+ *
+ * Returns 0 on success, -1 otherwise.
+ */
+int nymya_noisy_sample(const nymya_circuit* c, const nymya_noise* noise,
+                       unsigned int trajectories, unsigned int shots,
+                       nymya_qubit* const* qubits, size_t nqubits, uint64_t* out) {
+    nymya_traj tr = { .c = c, .noise = noise, .count = trajectories, .shots = shots,
+                      .qubits = qubits, .nqubits = nqubits, .out = out };
+
+    size_t bytes = (size_t)shots * ((nqubits + 63) / 64) * sizeof(*out);
+    nymya_rcache_key key;
+    int ret;
+
+    if ((nqubits && !qubits) || !out || !noise) return -1;
+    if (!shots) return 0;
+    if (!tr.count || tr.count > shots) tr.count = shots;
+    memset(out, 0, bytes);
+    if (!nymya_rcache_begin(&key, NYMYA_RCACHE_NOISY_SAMPLE, backends[0].b->name, c, 1)) {
+        nymya_rcache_add_noise(&key, noise);
+        nymya_rcache_add(&key, tr.count);
+        nymya_rcache_add(&key, shots);
+        nymya_rcache_add_qubits(&key, qubits, nqubits);
+        if (!nymya_rcache_get(&key, out, bytes)) {
+            nymya_rcache_end(&key);
+            return 0;
+        }
+    }
+    ret = nymya_traj_run(&tr, "noisy_sample");
+    if (!ret) nymya_rcache_put(&key, out, bytes);
+    nymya_rcache_end(&key);
+    return ret;
+}
+
+/**
+ * nymya_noisy_expectation - Mean of an observable over noisy trajectories.
+ * @c: Sealed circuit, run from |0...0>.
+ * @noise: Noise model; its readout error does not apply.
+ * @trajectories: Independent noisy runs, at least 1.
+ * @obs: Observable.
+ * @out: Receives the mean of <@obs> over the trajectories.
+ *
+ * The values are summed in trajectory order, so the mean does not depend
+ * on which worker ran which trajectory.
+ *
+ * Returns 0 on success, -1 otherwise.
+ */
+int nymya_noisy_expectation(const nymya_circuit* c, const nymya_noise* noise,
+                            unsigned int trajectories, const nymya_observable* obs,
+                            double* out) {
+    nymya_traj tr = { .c = c, .noise = noise, .count = trajectories, .obs = obs };
+    nymya_rcache_key key;
+    double sum = 0;
+    int ret;
+
+    if (!obs || !out || !trajectories || !noise) return -1;
+    if (!nymya_rcache_begin(&key, NYMYA_RCACHE_NOISY_EXPECTATION, backends[0].b->name, c, 1)) {
+        nymya_rcache_add_noise(&key, noise);
+        nymya_rcache_add(&key, trajectories);
+        nymya_rcache_add_observable(&key, obs);
+        if (!nymya_rcache_get(&key, out, sizeof(*out))) {
+            nymya_rcache_end(&key);
+            return 0;
+        }
+    }
+    tr.values = malloc(trajectories * sizeof(*tr.values));
+    if (!tr.values) {
+        nymya_rcache_end(&key);
+        return -1;
+    }
+    ret = nymya_traj_run(&tr, "noisy_expectation");
+    if (!ret) {
+        for (unsigned int t = 0; t < trajectories; t++)
+            sum += tr.values[t];
+        *out = sum / trajectories;
+        nymya_rcache_put(&key, out, sizeof(*out));
+    }
+    nymya_rcache_end(&key);
+    free(tr.values);
+    return ret;
+}
+
+/**
+ * nymya_grad - One nymya_gradient() call, split across its workers.
+ * @c: Circuit.
+ * @params: Parameter values.
+ * @precision: Storage of the workers' registers.
+ * @ops: @c lowered with @params, shared read-only.
+ * @occ: Parametric nodes to differentiate, in circuit order.
+ * @nocc: Number of entries in @occ.
+ * @obs: Observable.
+ * @deriv: Derivative of each node in @occ.
+ */
+typedef struct nymya_grad {
+    const nymya_circuit* c;
+    const double* params;
+    nymya_precision precision;
+    const sim_ops* ops;
+    const size_t* occ;
+    size_t nocc;
+    const nymya_observable* obs;
+    double* deriv;
+} nymya_grad;
+
+// Each worker takes a contiguous run of nodes and carries one prefix through it
+static int nymya_grad_worker(void* arg, unsigned int w, unsigned int nw) {
+    nymya_grad* g = arg;
+    size_t lo = g->nocc * w / nw, hi = g->nocc * (w + 1) / nw;
+
+    if (g->precision != NYMYA_PRECISION_DEFAULT && nymya_set_precision(g->precision))
+        return -1;
+    return backend_sim_shift_derivs(g->c, g->params, g->ops, g->occ + lo, hi - lo,
+                                    g->obs, g->deriv + lo);
+}
+
+/**
+ * nymya_gradient - Gradient of an expectation value by the parameter-shift rule.
+ * @c: Sealed parametric circuit, run from |0...0>.
+ * @params: Its nymya_circuit_num_params() parameter values.
+ * @obs: Observable.
+ * @grad_out: Receives d<obs>/dparams[k] for every parameter.
+ *
+ * Every use of a parameter is shifted on its own and the uses summed, so a
+ * parameter may appear in several gates. All 2 x uses evaluations form one
+ * batch spread over pool tasks, each carrying a shared prefix state
+ * through its share of the circuit. The caller's own state is not touched.
+ *
+ * Returns 0 on success, -1 for a gate without a two-term shift rule
+ * (givens, deutsch) or when a run fails.
+ */
+int nymya_gradient(const nymya_circuit* c, const double* params,
+                   const nymya_observable* obs, double* grad_out) {
+    nymya_grad g = { .c = c, .params = params, .precision = c ? c->precision : 0, .obs = obs };
+    sim_ops ops = { 0 };
+    nymya_mem_estimate e;
+    nymya_rcache_key key;
+    size_t* occ = NULL;
+    double* deriv = NULL;
+    unsigned int nw;
+    int ret = -1;
+
+    if (!c || !obs || !grad_out || (c->nparams && !params)) return -1;
+    if (!nymya_rcache_begin(&key, NYMYA_RCACHE_GRADIENT, backends[0].b->name, c, 0)) {
+        for (size_t k = 0; k < c->nparams; k++)
+            nymya_rcache_add_double(&key, params[k]);
+        nymya_rcache_add_observable(&key, obs);
+        if (!nymya_rcache_get(&key, grad_out, c->nparams * sizeof(*grad_out))) {
+            nymya_rcache_end(&key);
+            return 0;
+        }
+    }
+    for (size_t k = 0; k < c->nparams; k++)
+        grad_out[k] = 0;
+    nymya_ctx();
+
+    occ = malloc((c->count ? c->count : 1) * sizeof(*occ));
+    deriv = malloc((c->count ? c->count : 1) * sizeof(*deriv));
+    if (!occ || !deriv) goto out;
+    for (size_t i = 0; i < c->count; i++) {
+        const nymya_circuit_node* n = &c->nodes[i];
+        double gap = n->param ? backend_sim_shift_gap(n->gate_code) : 0;
+
+        if (n->gate_code == NYMYA_DEUTSCH_CODE || gap < 0) {
+            fprintf(stderr, "[nymya_runtime] Gate %d has no parameter-shift rule.\n", n->gate_code);
+            goto out;
+        }
+        if (gap > 0) occ[g.nocc++] = i;
+    }
+    if (!g.nocc) {
+        ret = 0;
+        goto out;
+    }
+    nw = nymya_worker_count(g.nocc);
+    if (nymya_sim_admit(c, NYMYA_MEM_SHIFT, &nw, 0, &g.precision, &e)) {
+        nymya_mem_reject("Gradient", &e);
+        goto out;
+    }
+    if (backend_sim_lower_circuit(c, params, &ops)) {
+        fprintf(stderr, "[nymya_runtime] Circuit cannot be lowered for a gradient.\n");
+        goto out;
+    }
+
+    g.ops = &ops;
+    g.occ = occ;
+    g.deriv = deriv;
+    ret = NYMYA_PROFILE_CALL("gradient", backends[0].b->name, c,
+                             nymya_run_workers(nw, nymya_grad_worker, &g));
+    if (!ret) {
+        for (size_t j = 0; j < g.nocc; j++)
+            grad_out[c->nodes[occ[j]].param - 1] += deriv[j];
+    }
+
+out:
+    if (!ret) nymya_rcache_put(&key, grad_out, c->nparams * sizeof(*grad_out));
+    nymya_rcache_end(&key);
+    sim_ops_free(&ops);
+    free(occ);
+    free(deriv);
+    return ret;
+}
+
+int nymya_expectation(const nymya_observable* obs, double* out) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+
+    if (ctx->active != &backends[0] || ctx->sim_on_stabilizer || ctx->sim_on_mps) {
+        fprintf(stderr, "[nymya_runtime] Expectation values need the \"sim\" state vector.\n");
+        return -1;
+    }
+    return backend_sim_expectation(obs, out);
+}
+
+/**
+ * nymya_checkpoint_save - Saves the simulator state of the calling thread.
+ * @path: File to create or replace.
+ * @position: Caller's position in its circuit, returned by the restore.
+ * @flags: NYMYA_CHECKPOINT_* bits.
+ *
+ * Returns 0 on success, -1 outside the "sim" state vector or if the file
+ * cannot be written.
+ */
+int nymya_checkpoint_save(const char* path, uint64_t position, unsigned int flags) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+
+    if (ctx->recording || ctx->active != &backends[0] || ctx->sim_on_stabilizer ||
+        ctx->sim_on_mps) {
+        fprintf(stderr, "[nymya_runtime] Checkpoints need the \"sim\" state vector.\n");
+        return -1;
+    }
+    return backend_sim_save(path, position,
+                            flags & NYMYA_CHECKPOINT_COMPRESS ? NYMYA_CKPT_ZSTD : 0);
+}
+
+/**
+ * nymya_checkpoint_restore - Continues from a saved simulator state.
+ * @path: File written by nymya_checkpoint_save().
+ * @position: Receives the saved position, if not NULL.
+ *
+ * The restored register replaces whatever state the simulator held, on the
+ * stabilizer or MPS backend included.
+ *
+ * Returns 0 on success, -1 outside "sim" or if the file cannot be restored.
+ */
+int nymya_checkpoint_restore(const char* path, uint64_t* position) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+
+    if (ctx->recording || ctx->active != &backends[0]) {
+        fprintf(stderr, "[nymya_runtime] Checkpoints need the \"sim\" state vector.\n");
+        return -1;
+    }
+    if (backend_sim_restore(path, position)) return -1;
+    if (ctx->sim_on_stabilizer) backend_stabilizer_reset();
+    if (ctx->sim_on_mps) backend_mps_reset();
+    ctx->sim_on_stabilizer = 0;
+    ctx->sim_on_mps = 0;
+    return 0;
+}
+
+struct nymya_snapshot {
+    sim_snap snap;
+};
+
+/**
+ * nymya_snapshot_take - Snapshots the simulator state of the calling thread.
+ *
+ * The thread's register continues as a branch of the snapshot.
+ *
+ * Returns the snapshot, to be released with nymya_snapshot_free(), or NULL
+ * outside the "sim" state vector or if memory runs out.
+ */
+nymya_snapshot* nymya_snapshot_take(void) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+    nymya_snapshot* s;
+
+    if (ctx->recording || ctx->active != &backends[0] || ctx->sim_on_stabilizer ||
+        ctx->sim_on_mps) {
+        fprintf(stderr, "[nymya_runtime] Snapshots need the \"sim\" state vector.\n");
+        return NULL;
+    }
+    s = malloc(sizeof(*s));
+    if (!s) return NULL;
+    if (backend_sim_snapshot(&s->snap)) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/**
+ * nymya_snapshot_restore - Branches the calling thread off a snapshot.
+ * @s: Snapshot from nymya_snapshot_take(), on this or another thread.
+ *
+ * The branch replaces whatever state the simulator held, on the stabilizer
+ * or MPS backend included. Threads may branch off one snapshot at once.
+ *
+ * Returns 0 on success, -1 outside "sim" or if @s cannot be mapped.
+ */
+int nymya_snapshot_restore(const nymya_snapshot* s) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+
+    if (!s) return -1;
+    if (ctx->recording || ctx->active != &backends[0]) {
+        fprintf(stderr, "[nymya_runtime] Snapshots need the \"sim\" state vector.\n");
+        return -1;
+    }
+    if (backend_sim_branch(&s->snap)) return -1;
+    if (ctx->sim_on_stabilizer) backend_stabilizer_reset();
+    if (ctx->sim_on_mps) backend_mps_reset();
+    ctx->sim_on_stabilizer = 0;
+    ctx->sim_on_mps = 0;
+    return 0;
+}
+
+/**
+ * nymya_snapshot_free - Releases a snapshot.
+ * @s: Snapshot, or NULL.
+ *
+ * Branches already made from @s stay valid; their shared pages are freed
+ * with the last of them.
+ */
+void nymya_snapshot_free(nymya_snapshot* s) {
+    if (!s) return;
+    sim_snap_close(&s->snap);
+    free(s);
+}
+
+// Bytes of amplitudes a snapshot holds, shared by all of its branches
+size_t nymya_snapshot_size(const nymya_snapshot* s) {
+    return s ? sim_snap_bytes(&s->snap) : 0;
+}
+
+/**
+ * nymya_snapshot_private_bytes - Memory the calling thread's branch owns.
+ * @out: Receives the bytes of the register copied out of its snapshot; a
+ *       register not made by a snapshot owns all of its array.
+ *
+ * Returns 0 on success, -1 if @out is NULL or /proc/self/smaps cannot be read.
+ */
+int nymya_snapshot_private_bytes(size_t* out) {
+    if (!out) return -1;
+    return backend_sim_private_bytes(out);
+}
+
+int nymya_prob_one(const nymya_qubit* q, double* p) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+
+    if (!ctx->active->b->prob_one) {
+        fprintf(stderr, "[nymya_runtime] The active backend has no readable state.\n");
+        return -1;
+    }
+    return ctx->active->b->prob_one(q, p);
+}
+
+/**
+ * nymya_sample - Runs a circuit once and draws many measurement shots from it.
+ * @c: Circuit to run first, or NULL to sample the current state.
+ * @shots: Number of shots.
+ * @qubits: Qubits to measure.
+ * @nqubits: Number of entries in @qubits.
+ * @out: Packed results, see nymya_runtime.h.
+ *
+ * The circuit always runs on the state vector, even when it is Clifford-only,
+ * because the draws read its amplitudes. The run and the draws are admitted
+ * against the memory budget together.
+ *
+ * Returns 0 on success, -1 otherwise.
+ */
+int nymya_sample(const nymya_circuit* c, unsigned int shots,
+                 nymya_qubit* const* qubits, size_t nqubits, uint64_t* out) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+    nymya_precision precision = c ? c->precision : NYMYA_PRECISION_DEFAULT;
+    nymya_mem_estimate e;
+    unsigned int nw = 1;
+
+    if (ctx->recording || ctx->active != &backends[0] || ctx->sim_on_stabilizer ||
+        ctx->sim_on_mps) {
+        fprintf(stderr, "[nymya_runtime] Sampling needs the \"sim\" state vector.\n");
+        return -1;
+    }
+    if (c && nymya_circuit_unbound(c)) return -1;
+    if (nymya_sim_admit(c, NYMYA_MEM_LIVE, &nw, shots, &precision, &e))
+        return nymya_mem_reject("Sample", &e);
+    if (c) {
+        if (precision != NYMYA_PRECISION_DEFAULT && nymya_set_precision(precision))
+            return -1;
+        if (NYMYA_PROFILE_CALL("sample", backends[0].b->name, c, backend_sim_run_circuit(c)))
+            return -1;
+    }
+    return NYMYA_PROFILE_CALL("sample", backends[0].b->name, NULL,
+                              backend_sim_sample(qubits, nqubits, shots, out));
+}
+
+_Static_assert(offsetof(nymya_qubit_c, id) == offsetof(nymya_qubit, id),
+               "compact qubits must keep the id where backends read it");
+
+int nymya_run_ops(const nymya_op* ops, size_t nops, nymya_qubit* qubits, size_t nqubits) {
+    if (!ops || !qubits) return -1;
+    return backend_gateqpu_run_ops(ops, nops, qubits, nqubits);
+}
+
+int nymya_run_ops_compact(const nymya_op* ops, size_t nops, nymya_qubit_c* qubits, size_t nqubits) {
+    if (!ops || !qubits) return -1;
+    return backend_gateqpu_run_ops_strided(ops, nops, qubits, sizeof(*qubits), nqubits);
+}
+
+void nymya_reset(void) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+    size_t n;
+
+    pthread_mutex_lock(&backends_lock);
+    n = nbackends;
+    pthread_mutex_unlock(&backends_lock);
+    for (size_t i = 0; i < n; i++) {
+        if (backends[i].b->reset) backends[i].b->reset();
+    }
+    ctx->sim_on_stabilizer = 0;
+    ctx->sim_on_mps = 0;
+}
+
+int nymya_apply_gate(int gate_code, void* args) {
+    nymya_runtime_ctx* ctx = nymya_ctx();
+    unsigned int i = (unsigned int)(gate_code - NYMYA_GATE_FIRST);
+    uint64_t t0;
+    int ret;
+
+    if (ctx->recording)
+        return nymya_circuit_record(ctx->recording, gate_code, args);
+    if (!nymya_profile_on)
+        return i < NYMYA_GATE_COUNT ? ctx->active->gates[i](gate_code, args)
+                                    : ctx->active->b->apply_gate(gate_code, args);
+
+    t0 = nymya_profile_ticks();
+    ret = i < NYMYA_GATE_COUNT ? ctx->active->gates[i](gate_code, args)
+                               : ctx->active->b->apply_gate(gate_code, args);
+    nymya_profile_gate(gate_code, ctx->active->b->name, t0);
+    return ret;
+}
+
+/**
+ * nymya_ctx_new - Gives the calling thread a context of its own.
+ * @threads: Simulator workers reserved for the context: 0 shares the process
+ *           pool, 1 runs on the calling thread only, more starts a private
+ *           pool pinned to CPUs no other private pool uses.
+ *
+ * The thread's previous state is discarded; the context starts on "sim"
+ * with empty registers.
+ *
+ * Returns the context, or NULL if the thread already has one or memory
+ * runs out.
+ */
+nymya_runtime_ctx* nymya_ctx_new(unsigned int threads) {
+    nymya_runtime_ctx* cur = nymya_ctx();
+    nymya_runtime_ctx* ctx;
+
+    if (cur != &ctx_default) {
+        fprintf(stderr, "[nymya_runtime] This thread already has a context.\n");
+        return NULL;
+    }
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+    if (threads && !(ctx->pool = sim_pool_new(threads))) {
+        free(ctx);
+        return NULL;
+    }
+
+    nymya_circuit_free(cur->recording);
+    cur->recording = NULL;
+    nymya_reset();
+    nymya_circuit_cache_clear();
+
+    ctx->active = &backends[0];
+    sim_pool_use(ctx->pool);
+    ctx_cur = ctx;
+    pthread_setspecific(ctx_key, ctx);
+    return ctx;
+}
+
+// Drops the state of the calling thread's context and the context itself
+static void nymya_ctx_teardown(nymya_runtime_ctx* ctx) {
+    nymya_circuit_free(ctx->recording);
+    ctx->recording = NULL;
+    nymya_reset();
+    nymya_circuit_cache_clear();
+    sim_pool_use(NULL);
+    if (ctx != &ctx_default) {
+        sim_pool_free(ctx->pool);
+        free(ctx);
+    }
+    ctx_cur = NULL;
+}
+
+/**
+ * nymya_ctx_free - Discards a context and everything run on it.
+ * @ctx: Context from nymya_ctx_new() on the calling thread, or NULL.
+ *
+ * The thread continues on a fresh default context.
+ */
+void nymya_ctx_free(nymya_runtime_ctx* ctx) {
+    if (!ctx) return;
+    if (ctx != ctx_cur) {
+        fprintf(stderr, "[nymya_runtime] A context can only be freed on its own thread.\n");
+        return;
+    }
+    nymya_ctx_teardown(ctx);
+    pthread_setspecific(ctx_key, NULL);
+}
+
+// Thread exit: the thread-local state would otherwise leak
+static void nymya_ctx_exit(void* ctx) {
+    if (ctx == ctx_cur) nymya_ctx_teardown(ctx);
 }
@@ -1,13 +1,486 @@
 #ifndef NYMYA_RUNTIME_H
 #define NYMYA_RUNTIME_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <nymya/nymya.h>
+#include "nymya_gates.h"
 
-// Set backend: "sim" or "gateqpu"
+// Set backend: "sim", "stabilizer", "mps", "sparse", "dist" (MPI builds),
+// "gpu" (CUDA builds), "gateqpu", or any other name, which loads
+// libnymya-backend-<name>.so (see nymya_backend.h)
 void nymya_set_backend(const char* backend_name);
 
-// Unified gate execution entry point
+// Lets the active backend complete queued work, e.g. sends the "gateqpu"
+// program built so far (see nymya_qpu.h); circuit runs do this themselves
+int nymya_flush(void);
+
+// Set simulator worker threads of the calling thread's pool:
+// 0 = NYMYA_SIM_THREADS or one per online CPU
+void nymya_set_threads(unsigned int threads);
+
+// Runtime contexts. Everything below acts on the calling thread's context:
+// its backend, recording, simulator state, settings and circuit cache, so
+// threads run independent simulations without sharing mutable state. A
+// thread starts on a default context that uses the process worker pool.
+// nymya_ctx_new() replaces it (discarding its state) with one that owns
+// @threads simulator workers (0 = share the process pool, 1 = none); a
+// context is torn down by nymya_ctx_free() on its thread or at thread exit.
+// The "dist" backend is process-wide and must stay on one thread.
+typedef struct nymya_runtime_ctx nymya_runtime_ctx;
+
+nymya_runtime_ctx* nymya_ctx_new(unsigned int threads);
+void nymya_ctx_free(nymya_runtime_ctx* ctx);
+
+// Simulator amplitude storage. Float halves memory and bandwidth; mixed
+// stores floats but sums reductions such as probabilities in double.
+// DEFAULT follows NYMYA_SIM_PRECISION ("double", "float" or "mixed").
+typedef enum nymya_precision {
+    NYMYA_PRECISION_DEFAULT,
+    NYMYA_PRECISION_DOUBLE,
+    NYMYA_PRECISION_FLOAT,
+    NYMYA_PRECISION_MIXED
+} nymya_precision;
+
+// Converts the live register, if any, and sets the mode for new ones
+int nymya_set_precision(nymya_precision precision);
+
+// Huge pages for simulator amplitude arrays of 2 MiB or more: registers,
+// the per-worker registers of batches, gradients and trajectories, and
+// decompressed checkpoints. Each is mapped 2 MiB aligned so that a gate on
+// a high qubit strides through a few TLB entries rather than one per 4 KiB.
+// NYMYA_HUGEPAGES sets the mode at startup: "thp" (the default) asks for
+// transparent huge pages with madvise(MADV_HUGEPAGE); "hugetlb" takes
+// reserved pages (vm.nr_hugepages) with MAP_HUGETLB and falls back to
+// transparent ones; "off" keeps normal pages. nymya_hugepages_get_stats()
+// reads /proc/self/smaps for what the kernel actually backs with huge pages,
+// for the simulator's arrays and for the whole process (libnymya lattices
+// and scratch arenas allocated with NYMYA_ALLOC_HUGE included).
+typedef enum nymya_hugepages {
+    NYMYA_HUGEPAGES_OFF,
+    NYMYA_HUGEPAGES_THP,
+    NYMYA_HUGEPAGES_HUGETLB
+} nymya_hugepages;
+
+typedef struct nymya_hugepage_stats {
+    size_t arrays;              // live simulator arrays mapped for huge pages
+    size_t array_bytes;         // their size
+    size_t array_huge_bytes;    // of which huge pages back now
+    uint64_t hugetlb_fallbacks; // "hugetlb" arrays that got transparent pages instead
+    size_t hugetlb_bytes;       // process memory in reserved huge pages
+    size_t thp_bytes;           // process memory marked for transparent huge pages
+    size_t thp_backed_bytes;    // of which huge pages back now
+} nymya_hugepage_stats;
+
+void nymya_hugepages_set_mode(nymya_hugepages mode);
+int nymya_hugepages_get_stats(nymya_hugepage_stats* out);
+
+// Unified gate execution entry point; @args is the gate's nymya_arg_* struct
+//
+// NYMYA_PROFILE=1 (or =<file>) times every executed gate call and every
+// circuit run, batch, gradient and sample, and at exit writes folded stacks
+// for flamegraph tools to nymya-profile.<pid>.folded (or <file>) and a
+// per-gate and per-circuit summary to stderr.
 int nymya_apply_gate(int gate_code, void* args);
 
+// Typed entry points generated from NYMYA_GATE_LIST, e.g. nymya_rt_cnot(q1, q2)
+// or nymya_rt_rotate_x(q, theta): qubits first, then parameters. Each packs
+// its argument struct on the stack and calls nymya_apply_gate().
+#define NYMYA_RT_GATE(name, code, args) NYMYA_RT_GATE_##args(name, code)
+#define NYMYA_RT_GATE_Q(name, code) \
+    static inline int nymya_rt_##name(nymya_qubit* q) { \
+        nymya_arg_q a = { q }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q_THETA(name, code) \
+    static inline int nymya_rt_##name(nymya_qubit* q, double theta) { \
+        nymya_arg_q_theta a = { q, theta }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q_AXIS_THETA(name, code) \
+    static inline int nymya_rt_##name(nymya_qubit* q, char axis, double theta) { \
+        nymya_arg_q_axis_theta a = { q, axis, theta }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q2(name, code) \
+    static inline int nymya_rt_##name(nymya_qubit* q1, nymya_qubit* q2) { \
+        nymya_arg_q2 a = { q1, q2 }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q2_THETA(name, code) \
+    static inline int nymya_rt_##name(nymya_qubit* q1, nymya_qubit* q2, double theta) { \
+        nymya_arg_q2_theta a = { q1, q2, theta }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q3(name, code) \
+    static inline int nymya_rt_##name(nymya_qubit* q1, nymya_qubit* q2, nymya_qubit* q3) { \
+        nymya_arg_q3 a = { q1, q2, q3 }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q_ARR(name, code) \
+    static inline int nymya_rt_##name(nymya_qubit** qs, size_t count) { \
+        nymya_arg_q_arr a = { qs, count }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q3D(name, code) \
+    static inline int nymya_rt_##name(nymya_qpos3d* qs, size_t count) { \
+        nymya_arg_q3d a = { qs, count }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q4D(name, code) \
+    static inline int nymya_rt_##name(nymya_qpos4d* qs, size_t count) { \
+        nymya_arg_q4d a = { qs, count }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_Q5D(name, code) \
+    static inline int nymya_rt_##name(nymya_qpos5d* qs, size_t count) { \
+        nymya_arg_q5d a = { qs, count }; \
+        return nymya_apply_gate(code, &a); \
+    }
+#define NYMYA_RT_GATE_QRNG(name, code) \
+    static inline int nymya_rt_##name(uint64_t* out, uint64_t min, uint64_t max, size_t count) { \
+        nymya_arg_qrng a = { out, min, max, count }; \
+        return nymya_apply_gate(code, &a); \
+    }
+// The oracle callback has no runtime argument slot; call nymya_3342_deutsch()
+#define NYMYA_RT_GATE_DEUTSCH(name, code)
+
+NYMYA_GATE_LIST(NYMYA_RT_GATE)
+
+// Batches of nymya_op records (see nymya.h) run through nymya_apply_gate(),
+// on nymya_qubit or on compact nymya_qubit_c registers. Backends only read
+// qubit IDs, so a compact qubit may stand in for a nymya_qubit anywhere
+// through nymya_qubit_c_as(); its tag and amplitude are never touched.
+int nymya_run_ops(const nymya_op* ops, size_t nops, nymya_qubit* qubits, size_t nqubits);
+int nymya_run_ops_compact(const nymya_op* ops, size_t nops, nymya_qubit_c* qubits, size_t nqubits);
+
+static inline nymya_qubit* nymya_qubit_c_as(nymya_qubit_c* q) {
+    return (nymya_qubit*)q;
+}
+
+// Simulated state: probability of |1> for a qubit, and discarding all state.
+// On "sim", a Clifford-only circuit run on an empty register moves to the
+// stabilizer backend (NYMYA_SIM_NOSTAB=1 disables this); later gates must
+// then be Clifford too until nymya_reset().
+int nymya_prob_one(const nymya_qubit* q, double* p);
+void nymya_reset(void);
+
+// Deferred execution: between begin and end, nymya_apply_gate() records
+// instead of running. Qubits passed by pointer must outlive the circuit.
+typedef struct nymya_circuit nymya_circuit;
+
+// Multi-shot sampling on "sim": runs c once (NULL = the current state), then
+// draws shots measurements of qubits[] from the final state without
+// collapsing it, in O(2^n + shots). Qubit i of shot s is bit i % 64 of
+// out[s * ((nqubits + 63) / 64) + i / 64]; a qubit no gate has used reads 0.
+// NYMYA_SIM_SEED makes the draws of a thread reproducible.
+int nymya_sample(const nymya_circuit* c, unsigned int shots,
+                 nymya_qubit* const* qubits, size_t nqubits, uint64_t* out);
+
+// nymya_circuit_end() cancels self-inverse pairs and merges rotations across
+// commuting gates, so nymya_circuit_size() may be below the calls recorded;
+// NYMYA_CIRCUIT_NOOPT keeps the recording as it is
+int nymya_circuit_begin(void);
+nymya_circuit* nymya_circuit_end(void);
+int nymya_circuit_run(const nymya_circuit* c);
+size_t nymya_circuit_size(const nymya_circuit* c);
+size_t nymya_circuit_depth(const nymya_circuit* c);
+void nymya_circuit_free(nymya_circuit* c);
+
+// Precision the simulator register takes when this circuit runs on it
+void nymya_circuit_set_precision(nymya_circuit* c, nymya_precision precision);
+
+// Parametric circuits: while recording, nymya_param(k) passed as a gate's
+// theta makes it parameter k of the circuit. The structure, and so the
+// compiled plan, is the same for every value. nymya_circuit_bind() sets the
+// values plain runs use; a circuit with parameters must be bound before
+// nymya_circuit_run(), nymya_sample() or nymya_submit_async().
+double nymya_param(unsigned int index);
+size_t nymya_circuit_num_params(const nymya_circuit* c);
+int nymya_circuit_bind(nymya_circuit* c, const double* params);
+
+// Batched binding on "sim": runs c from |0...0> once per row of params
+// (nymya_circuit_num_params(c) values each), in parallel as tasks on the
+// calling thread's pool, one per worker; a set's gates are swept by the
+// workers the other sets leave idle, so a short batch of wide circuits still
+// uses the whole pool. fn(set, user) runs on the worker that ran the set,
+// where nymya_prob_one() and nymya_sample() read that set's final state; a
+// nonzero return stops the batch. fn must not call nymya_set_threads().
+// Workers take the circuit's precision, else NYMYA_SIM_PRECISION.
+typedef int (*nymya_batch_fn)(size_t set, void* user);
+
+int nymya_circuit_run_batch(const nymya_circuit* c, const double* params, size_t nsets,
+                            nymya_batch_fn fn, void* user);
+
+// Observables on "sim": a real-weighted sum of Pauli strings. A term acts
+// with ops[i] ('I', 'X', 'Y' or 'Z') on qubits[i] for i < count.
+// nymya_expectation() reads the current state in place; terms that flip the
+// same qubits (all the Z-only terms, say) share one pass over it.
+typedef struct nymya_pauli_term {
+    double coeff;
+    size_t count;
+    const char* ops;
+    nymya_qubit* const* qubits;
+} nymya_pauli_term;
+
+typedef struct nymya_observable {
+    const nymya_pauli_term* terms;
+    size_t count;
+} nymya_observable;
+
+int nymya_expectation(const nymya_observable* obs, double* out);
+
+// The same reads for c run from |0...0> on a worker thread, leaving the
+// caller's own state alone: <obs>, and the probability of |1> of each of
+// qubits[] (a qubit no gate has used reads 0)
+int nymya_circuit_expectation(const nymya_circuit* c, const nymya_observable* obs, double* out);
+int nymya_circuit_probabilities(const nymya_circuit* c, nymya_qubit* const* qubits,
+                                size_t nqubits, double* out);
+
+// d<obs>/dparams[k] of c run from |0...0>, for every parameter, by the exact
+// two-term parameter-shift rule. All shifted runs form one batch of pool
+// tasks that share state prefixes. Givens rotations have no two-term rule
+// and are rejected.
+int nymya_gradient(const nymya_circuit* c, const double* params,
+                   const nymya_observable* obs, double* grad_out);
+
+// Noisy simulation by quantum trajectories on "sim". A noise model attaches
+// channels to gate codes (0 = every gate); after each matching gate, the
+// channel acts on every qubit the gate touched, independently. Depolarizing
+// noise of strength p applies X, Y or Z with probability p / 3 each;
+// amplitude damping of strength gamma relaxes |1> to |0>. Readout error
+// flips each sampled 0 with probability p01 and each 1 with p10. Channels
+// follow the gates left after nymya_circuit_end() optimised the circuit;
+// record with NYMYA_CIRCUIT_NOOPT set to keep, say, identity gates that
+// carry idle noise.
+//
+// Each trajectory is a pure-state run from |0...0> in which every channel
+// picks one outcome at random, so a job needs one register per worker
+// thread rather than a density matrix. Trajectories run as tasks on the
+// calling thread's pool, one per worker, and wide registers are swept by
+// idle workers as for batches; trajectory t draws from its own random
+// stream, so with NYMYA_SIM_SEED a job gives the same results on any pool
+// of the same size, and on other sizes up to rounding of the sweeps' sums.
+// nymya_noisy_sample() splits shots evenly over the trajectories (0, or
+// more trajectories than shots, gives one per shot) and fills out as
+// nymya_sample() does; nymya_noisy_expectation() averages <obs> over them.
+// The caller's own state is not touched.
+typedef struct nymya_noise nymya_noise;
+
+typedef enum nymya_noise_channel {
+    NYMYA_NOISE_DEPOLARIZING,
+    NYMYA_NOISE_AMPLITUDE_DAMPING
+} nymya_noise_channel;
+
+nymya_noise* nymya_noise_new(void);
+void nymya_noise_free(nymya_noise* noise);
+int nymya_noise_add(nymya_noise* noise, int gate_code, nymya_noise_channel channel, double p);
+int nymya_noise_set_readout(nymya_noise* noise, double p01, double p10);
+
+int nymya_noisy_sample(const nymya_circuit* c, const nymya_noise* noise,
+                       unsigned int trajectories, unsigned int shots,
+                       nymya_qubit* const* qubits, size_t nqubits, uint64_t* out);
+int nymya_noisy_expectation(const nymya_circuit* c, const nymya_noise* noise,
+                            unsigned int trajectories, const nymya_observable* obs,
+                            double* out);
+
+// Asynchronous QPU jobs: the circuit is serialized at submission (it may be
+// freed right after) and sent to the device attached with
+// nymya_qpu_set_device() (see nymya_qpu.h) as one request. Many jobs can be
+// in flight; only gates with fixed qubit operands are accepted, and
+// submission fails without a device. The callback runs on a dispatcher
+// thread once the job is DONE or FAILED and must not wait on or free it.
+typedef struct nymya_job nymya_job;
+
+typedef enum nymya_job_state {
+    NYMYA_JOB_QUEUED,
+    NYMYA_JOB_RUNNING,
+    NYMYA_JOB_DONE,
+    NYMYA_JOB_FAILED
+} nymya_job_state;
+
+typedef void (*nymya_job_fn)(nymya_job* job, void* user);
+
+// Measurements of a DONE job, valid until nymya_job_free(): qubit ids[i]
+// of shot s is bit i % 64 of bits[s * words + i / 64]. Qubits are in order
+// of first use in the circuit.
+typedef struct nymya_job_result {
+    unsigned int shots;
+    size_t nqubits;
+    size_t words;
+    const uint64_t* ids;
+    const uint64_t* bits;
+} nymya_job_result;
+
+nymya_job* nymya_submit_async(const nymya_circuit* c, unsigned int shots,
+                              nymya_job_fn done, void* user);
+nymya_job_state nymya_job_poll(const nymya_job* job);
+int nymya_job_wait(nymya_job* job);
+int nymya_job_get_result(const nymya_job* job, nymya_job_result* out);
+void nymya_job_free(nymya_job* job);
+
+// Hardware entropy: on the "gateqpu" backend, qrng_range (3361) reads words
+// measured on the attached device (physical qubits $0 to $63 after an H),
+// prefetched through the job queue into a ring of depth words (0 turns
+// prefetch off). Words the ring cannot supply come from the kernel
+// generator and are counted as fallback.
+typedef struct nymya_entropy_stats {
+    size_t depth;
+    size_t level;
+    int inflight;
+    uint64_t refills;
+    uint64_t refill_failures;
+    uint64_t served;
+    uint64_t fallback;
+} nymya_entropy_stats;
+
+void nymya_entropy_set_depth(size_t words);
+void nymya_entropy_get_stats(nymya_entropy_stats* out);
+
+// Binary circuit files (format in nymya_cfile.h). A file is mapped, not
+// parsed, and runs or submits from the mapping: nymya_cfile_run() sends its
+// gates through nymya_apply_gate() on the file's own qubits (record it
+// between nymya_circuit_begin()/_end() to get a cached compiled circuit),
+// and a submitted job reads the records in place, so the file must stay
+// open until the job is freed.
+typedef struct nymya_cfile nymya_cfile;
+
+int nymya_circuit_save(const nymya_circuit* c, const char* path);
+nymya_cfile* nymya_cfile_open(const char* path);
+void nymya_cfile_close(nymya_cfile* f);
+size_t nymya_cfile_size(const nymya_cfile* f);
+nymya_qubit* nymya_cfile_qubits(nymya_cfile* f, size_t* count);
+int nymya_cfile_run(nymya_cfile* f);
+nymya_job* nymya_cfile_submit_async(nymya_cfile* f, unsigned int shots,
+                                    nymya_job_fn done, void* user);
+
+// Checkpoints of the calling thread's "sim" state vector: amplitudes, qubit
+// IDs, the random generator and a position the caller chooses (e.g. the index
+// of the next gate). A save replaces @path only once the new file is on disk.
+// A restore maps the file copy-on-write and pages it in as gates run, so it
+// returns at once, and several threads or processes restoring one prefix
+// state for a parameter sweep share its pages until they write.
+// NYMYA_CHECKPOINT_COMPRESS stores zstd frames in builds made with ZSTD=1
+// (restoring them decompresses the whole state); other builds write the file
+// uncompressed.
+#define NYMYA_CHECKPOINT_COMPRESS 1u
+
+int nymya_checkpoint_save(const char* path, uint64_t position, unsigned int flags);
+int nymya_checkpoint_restore(const char* path, uint64_t* position);
+
+// Snapshots of the calling thread's "sim" state vector for branching runs.
+// A snapshot copies the amplitudes once into sealed shared memory; each
+// nymya_snapshot_restore(), on any thread and any number of times, maps it
+// copy-on-write, so a branch costs no copy up front and later only the 4 KiB
+// pages its gates write. The thread that took the snapshot continues as a
+// branch of it. The random generator is not part of a snapshot: branches
+// keep their own and sample independently. Freeing a snapshot leaves the
+// branches made from it running. nymya_snapshot_private_bytes() reports how
+// much of the calling thread's register it has copied so far.
+typedef struct nymya_snapshot nymya_snapshot;
+
+nymya_snapshot* nymya_snapshot_take(void);
+int nymya_snapshot_restore(const nymya_snapshot* s);
+void nymya_snapshot_free(nymya_snapshot* s);
+size_t nymya_snapshot_size(const nymya_snapshot* s);
+int nymya_snapshot_private_bytes(size_t* out);
+
+// Compiled-circuit cache of the calling thread, keyed by circuit structure
+// (parameters ignored)
+typedef struct nymya_circuit_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t bytes;
+    size_t limit;
+} nymya_circuit_cache_stats;
+
+void nymya_circuit_cache_get_stats(nymya_circuit_cache_stats* out);
+void nymya_circuit_cache_set_limit(size_t bytes);
+void nymya_circuit_cache_clear(void);
+
+// Result cache, off by default. Once on, nymya_circuit_expectation(),
+// nymya_circuit_probabilities(), nymya_gradient(), nymya_noisy_sample() and
+// nymya_noisy_expectation() return the stored result of an earlier call with
+// the same circuit, gate values, arguments and backend instead of running.
+// The noisy calls are random and so memoised only under NYMYA_SIM_SEED,
+// keyed by the calling thread's generator state; a hit moves the generator on
+// as the run did. Results live in memory, process-wide and least recently
+// used first out once over the limit, and in an optional directory of files
+// shared between processes, which the runtime adds to but never prunes.
+// NYMYA_RESULT_CACHE (bytes with an optional K, M, G or T suffix) and
+// NYMYA_RESULT_CACHE_DIR set both at startup. nymya_sample() runs on the
+// caller's live state and is never memoised; sample a circuit from |0...0>
+// through nymya_noisy_sample() with an empty noise model instead.
+typedef struct nymya_result_cache_stats {
+    uint64_t hits;
+    uint64_t disk_hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t bytes;
+    size_t limit;
+} nymya_result_cache_stats;
+
+void nymya_result_cache_set_limit(size_t bytes);
+int nymya_result_cache_set_dir(const char* dir);
+void nymya_result_cache_get_stats(nymya_result_cache_stats* out);
+void nymya_result_cache_clear(void);
+
+// Matrix-product-state backend: each SVD keeps at most max_bond singular
+// values (0 = 64) and drops the smallest while their relative weight stays
+// below cutoff (negative = 1e-10). Applies to gates run after the call.
+typedef struct nymya_mps_stats {
+    size_t qubits;
+    size_t max_bond;
+    size_t bytes;
+    double discarded;
+} nymya_mps_stats;
+
+void nymya_mps_set_limits(unsigned int max_bond, double cutoff);
+void nymya_mps_get_stats(nymya_mps_stats* out);
+
+// Sparse backend: the state moves to the dense simulator once it holds
+// more than support amplitudes (0 = 2^n / 16, at least 4096).
+// nymya_sparse_support() is the current amplitude count, or 0 after the switch.
+void nymya_sparse_set_threshold(size_t support);
+size_t nymya_sparse_support(void);
+
+// Memory estimates and admission. nymya_circuit_estimate() reports the peak
+// memory nymya_circuit_run(c) followed by nymya_sample() with shots draws
+// (0 = none) would take on the calling thread's backend, including the state
+// the thread already holds; the caller's result buffer is not counted. Over a
+// budget (bytes, 0 = none), "sim" runs, batches, gradients, samples and
+// register growth are refused under NYMYA_MEM_REJECT. NYMYA_MEM_DOWNGRADE
+// first tries fewer batch or gradient workers, then float storage, and for
+// a circuit run on an empty register the MPS backend, which then holds the
+// simulator's state until nymya_reset(). The budget is process-wide and
+// applies to each job; NYMYA_MEM_BUDGET (bytes with an optional K, M, G or T
+// suffix, or "auto" for the memory of the host or its cgroup) and
+// NYMYA_MEM_POLICY ("reject" or "downgrade", the default) set it at startup.
+typedef enum nymya_mem_policy {
+    NYMYA_MEM_DOWNGRADE,
+    NYMYA_MEM_REJECT
+} nymya_mem_policy;
+
+typedef struct nymya_mem_estimate {
+    size_t qubits;              // register width after the run
+    size_t state;               // state vectors, chain or tableau
+    size_t scratch;             // transient copies while a register grows or converts
+    size_t matrices;            // lowered gate matrices and fusion plan
+    size_t sampling;            // shot tables of nymya_sample()
+    size_t total;               // sum of the above
+    nymya_precision precision;  // amplitude storage the estimate assumes
+    const char* backend;        // backend the job would run on
+} nymya_mem_estimate;
+
+int nymya_circuit_estimate(const nymya_circuit* c, unsigned int shots, nymya_mem_estimate* out);
+void nymya_set_mem_budget(size_t bytes, nymya_mem_policy policy);
+size_t nymya_get_mem_budget(nymya_mem_policy* policy);
+
+// Distributed backend: every rank runs the same program and gate sequence;
+// results are available on all ranks. Returns 0 outside MPI builds.
+int nymya_dist_rank(void);
+
 #endif // NYMYA_RUNTIME_H
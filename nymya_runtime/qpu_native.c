@@ -0,0 +1,760 @@
+// runtime/qpu_native.c
+//
+// Lowering of gate calls to the native gate set of a gate-based QPU: rz,
+// sx and x on one qubit, and one entangler, cx or cz. Once a set is chosen
+// with NYMYA_QPU_NATIVE=cx|cz or nymya_qpu_set_native(), the "gateqpu"
+// backend writes its OpenQASM 3 program in these terms and job submissions
+// carry them as nymya_op records.
+//
+// A two-qubit gate goes through a KAK decomposition
+//     U = (A1 (x) A0) exp(i(a XX + b YY + c ZZ)) (B1 (x) B0)
+// and its interaction term takes as few entanglers as the coefficients
+// allow: none for a product gate, one when it is locally a CNOT, two when
+// a coefficient vanishes, three otherwise. Three-qubit gates use the
+// six-CNOT Toffoli construction. Global phase is dropped.
+//
+// Decompositions are memoised by gate set, gate code and angle, so a gate
+// a job repeats, or an angle a variational loop comes back to, is
+// decomposed once per process.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <pthread.h>
+#include <nymya/nymya.h>
+#include "nymya_qpu.h"
+#include "qpu_native.h"
+#include "backend_sim.h"
+#include "sim_fuse.h"
+
+// Angles and coefficients closer than this to a special value take its form
+#define QPU_NATIVE_EPS 1e-9
+
+// Memoised decompositions: direct-mapped, 1 << QPU_NATIVE_CACHE_BITS entries
+#define QPU_NATIVE_CACHE_BITS 7
+
+static const double complex QPU_X[4]  = { 0, 1, 1, 0 };
+static const double complex QPU_Y[4]  = { 0, -I, I, 0 };
+static const double complex QPU_Z[4]  = { 1, 0, 0, -1 };
+static const double complex QPU_SX[4] = { (1 + I) / 2, (1 - I) / 2, (1 - I) / 2, (1 + I) / 2 };
+static const double complex QPU_H[4]  = { M_SQRT1_2, M_SQRT1_2, M_SQRT1_2, -M_SQRT1_2 };
+
+static pthread_once_t qpu_native_once = PTHREAD_ONCE_INIT;
+static int qpu_native_sel;
+
+static void qpu_native_init(void) {
+    const char* env = getenv("NYMYA_QPU_NATIVE");
+
+    if (!env || strcmp(env, "none") == 0) return;
+    if (strcmp(env, "cx") == 0) qpu_native_sel = NYMYA_QPU_NATIVE_CX;
+    else if (strcmp(env, "cz") == 0) qpu_native_sel = NYMYA_QPU_NATIVE_CZ;
+    else fprintf(stderr, "[QPU] Unknown NYMYA_QPU_NATIVE \"%s\"; writing stdgates.\n", env);
+}
+
+/**
+ * nymya_qpu_set_native - Chooses the gate set QPU programs and jobs are lowered to.
+ * @set: NYMYA_QPU_NATIVE_NONE, NYMYA_QPU_NATIVE_CX or NYMYA_QPU_NATIVE_CZ.
+ *
+ * Overrides NYMYA_QPU_NATIVE. A program the gateqpu backend has already
+ * begun keeps the set it began with.
+ *
+ * Returns 0, or -1 for an unknown @set.
+ */
+int nymya_qpu_set_native(int set) {
+    if (set < NYMYA_QPU_NATIVE_NONE || set > NYMYA_QPU_NATIVE_CZ) return -1;
+    pthread_once(&qpu_native_once, qpu_native_init);
+    __atomic_store_n(&qpu_native_sel, set, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int qpu_native_target(void) {
+    pthread_once(&qpu_native_once, qpu_native_init);
+    return __atomic_load_n(&qpu_native_sel, __ATOMIC_RELAXED);
+}
+
+static void qpu_native_push(qpu_native_builder* b, uint32_t code, size_t q0, size_t q1, double theta) {
+    qpu_native_seq* s = b->out;
+
+    if (b->err) return;
+    if (s->n == s->cap) {
+        size_t cap = s->cap ? 2 * s->cap : 32;
+        qpu_native_op* p = realloc(s->op, cap * sizeof(*p));
+
+        if (!p) {
+            b->err = 1;
+            return;
+        }
+        s->op = p;
+        s->cap = cap;
+    }
+    s->op[s->n++] = (qpu_native_op){ code, { (uint32_t)q0, (uint32_t)q1 }, theta };
+}
+
+// rz(theta), folded into (-pi, pi]; nothing for a zero angle
+static void qpu_native_rz(qpu_native_builder* b, size_t q, double theta) {
+    theta = remainder(theta, 2 * M_PI);
+    if (fabs(theta) > QPU_NATIVE_EPS) qpu_native_push(b, NYMYA_ROTATE_Z_CODE, q, 0, theta);
+}
+
+/**
+ * qpu_native_flush1 - Writes the pending single-qubit product on slot @q.
+ * @b: Builder.
+ * @q: Slot.
+ *
+ * U = Rz(phi) Ry(theta) Rz(lambda) up to phase, written as one rz when
+ * theta is 0, rz sx rz or rz x rz at pi/2 and pi, and
+ * rz(lambda) sx rz(theta + pi) sx rz(phi + pi) otherwise.
+ */
+static void qpu_native_flush1(qpu_native_builder* b, size_t q) {
+    const double complex* m = b->pend[q];
+    double complex r, u00, u10, u11;
+    double theta, sum, diff, phi, lambda;
+
+    if (!b->has[q]) return;
+    b->has[q] = 0;
+
+    r = csqrt(m[0] * m[3] - m[1] * m[2]);
+    u00 = m[0] / r;
+    u10 = m[2] / r;
+    u11 = m[3] / r;
+    theta = 2 * atan2(cabs(u10), cabs(u00));
+    sum = cabs(u11) > QPU_NATIVE_EPS ? 2 * carg(u11) : 0;
+    diff = cabs(u10) > QPU_NATIVE_EPS ? 2 * carg(u10) : 0;
+    phi = (sum + diff) / 2;
+    lambda = (sum - diff) / 2;
+
+    if (theta < QPU_NATIVE_EPS) {
+        qpu_native_rz(b, q, phi + lambda);
+    } else if (fabs(theta - M_PI_2) < QPU_NATIVE_EPS || fabs(theta - M_PI) < QPU_NATIVE_EPS) {
+        // Ry(t) = Rz(pi/2) Rx(t) Rz(-pi/2), with Rx(pi/2) ~ sx and Rx(pi) ~ x
+        qpu_native_rz(b, q, lambda - M_PI_2);
+        qpu_native_push(b, theta < 3 * M_PI_4 ? NYMYA_SQRT_X_CODE : NYMYA_PAULI_X_CODE, q, 0, 0);
+        qpu_native_rz(b, q, phi + M_PI_2);
+    } else {
+        qpu_native_rz(b, q, lambda);
+        qpu_native_push(b, NYMYA_SQRT_X_CODE, q, 0, 0);
+        qpu_native_rz(b, q, theta + M_PI);
+        qpu_native_push(b, NYMYA_SQRT_X_CODE, q, 0, 0);
+        qpu_native_rz(b, q, phi + M_PI);
+    }
+}
+
+/**
+ * qpu_native_begin - Starts a builder.
+ * @b: Builder.
+ * @set: NYMYA_QPU_NATIVE_CX or NYMYA_QPU_NATIVE_CZ.
+ * @nslots: Qubits the gates may name.
+ * @out: Sequence the gates are appended to.
+ *
+ * Returns 0, or -1 if the pending table could not be allocated.
+ */
+int qpu_native_begin(qpu_native_builder* b, int set, size_t nslots, qpu_native_seq* out) {
+    *b = (qpu_native_builder){ .out = out, .set = set, .nslots = nslots };
+    b->pend = malloc((nslots ? nslots : 1) * sizeof(*b->pend));
+    b->has = calloc(nslots ? nslots : 1, 1);
+    if (!b->pend || !b->has) {
+        free(b->pend);
+        free(b->has);
+        *b = (qpu_native_builder){ 0 };
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * qpu_native_end - Writes the pending single-qubit gates and frees the builder.
+ * @b: Builder.
+ *
+ * Returns 0, or -1 if the sequence could not grow at some point.
+ */
+int qpu_native_end(qpu_native_builder* b) {
+    for (size_t q = 0; q < b->nslots; q++) qpu_native_flush1(b, q);
+    free(b->pend);
+    free(b->has);
+    b->pend = NULL;
+    b->has = NULL;
+    return b->err ? -1 : 0;
+}
+
+// Appends a 2x2 gate on slot @q to the pending product
+void qpu_native_u1(qpu_native_builder* b, size_t q, const double complex m[4]) {
+    if (b->has[q]) {
+        sim_fuse_lmul(b->pend[q], m, 2);
+    } else {
+        memcpy(b->pend[q], m, sizeof(b->pend[q]));
+        b->has[q] = 1;
+    }
+}
+
+void qpu_native_h(qpu_native_builder* b, size_t q) {
+    qpu_native_u1(b, q, QPU_H);
+}
+
+// CNOT; on a cz target it is H cz H on the target
+void qpu_native_cx(qpu_native_builder* b, size_t c, size_t t) {
+    if (b->set == NYMYA_QPU_NATIVE_CZ) {
+        qpu_native_u1(b, t, QPU_H);
+        qpu_native_cz(b, c, t);
+        qpu_native_u1(b, t, QPU_H);
+        return;
+    }
+    qpu_native_flush1(b, c);
+    qpu_native_flush1(b, t);
+    qpu_native_push(b, NYMYA_CNOT_CODE, c, t, 0);
+}
+
+void qpu_native_cz(qpu_native_builder* b, size_t c, size_t t) {
+    if (b->set == NYMYA_QPU_NATIVE_CX) {
+        qpu_native_u1(b, t, QPU_H);
+        qpu_native_cx(b, c, t);
+        qpu_native_u1(b, t, QPU_H);
+        return;
+    }
+    qpu_native_flush1(b, c);
+    qpu_native_flush1(b, t);
+    qpu_native_push(b, NYMYA_CZ_CODE, c, t, 0);
+}
+
+static void qpu_rz_m(double complex m[4], double t) {
+    m[0] = cexp(-I * t / 2); m[1] = 0; m[2] = 0; m[3] = cexp(I * t / 2);
+}
+
+static void qpu_rx_m(double complex m[4], double t) {
+    m[0] = m[3] = cos(t / 2); m[1] = m[2] = -I * sin(t / 2);
+}
+
+static void qpu_ry_m(double complex m[4], double t) {
+    m[0] = m[3] = cos(t / 2); m[1] = -sin(t / 2); m[2] = sin(t / 2);
+}
+
+/**
+ * qpu_native_replay - Appends a decomposed gate to a builder.
+ * @b: Builder.
+ * @s: Gates from qpu_native_gate().
+ * @slot: Builder slot of each operand slot of @s.
+ *
+ * Its single-qubit gates join the pending products, so they merge with
+ * those of the gates around it.
+ */
+void qpu_native_replay(qpu_native_builder* b, const qpu_native_seq* s, const uint32_t* slot) {
+    for (size_t i = 0; i < s->n; i++) {
+        const qpu_native_op* op = &s->op[i];
+        double complex m[4];
+
+        switch (op->gate_code) {
+            case NYMYA_ROTATE_Z_CODE:
+                qpu_rz_m(m, op->theta);
+                qpu_native_u1(b, slot[op->qubit[0]], m);
+                break;
+            case NYMYA_SQRT_X_CODE: qpu_native_u1(b, slot[op->qubit[0]], QPU_SX); break;
+            case NYMYA_PAULI_X_CODE: qpu_native_u1(b, slot[op->qubit[0]], QPU_X); break;
+            case NYMYA_CNOT_CODE: qpu_native_cx(b, slot[op->qubit[0]], slot[op->qubit[1]]); break;
+            default: qpu_native_cz(b, slot[op->qubit[0]], slot[op->qubit[1]]); break;
+        }
+    }
+}
+
+// Magic basis: local SU(2) x SU(2) gates are real in it, XX, YY and ZZ diagonal
+static const double complex QPU_MAGIC[16] = {
+    M_SQRT1_2, 0,             0,          I * M_SQRT1_2,
+    0,         I * M_SQRT1_2, M_SQRT1_2,  0,
+    0,         I * M_SQRT1_2, -M_SQRT1_2, 0,
+    M_SQRT1_2, 0,             0,          -I * M_SQRT1_2,
+};
+
+// Diagonals of XX, YY and ZZ in the magic basis
+static const double QPU_MAGIC_XX[4] = { 1, 1, -1, -1 };
+static const double QPU_MAGIC_YY[4] = { -1, 1, -1, 1 };
+static const double QPU_MAGIC_ZZ[4] = { 1, -1, -1, 1 };
+
+static void qpu_adjoint4(double complex out[16], const double complex m[16]) {
+    for (unsigned int r = 0; r < 4; r++) {
+        for (unsigned int c = 0; c < 4; c++) out[r * 4 + c] = conj(m[c * 4 + r]);
+    }
+}
+
+// Determinant by elimination with partial pivoting
+static double complex qpu_det4(const double complex m[16]) {
+    double complex a[16], det = 1;
+
+    memcpy(a, m, sizeof(a));
+    for (unsigned int k = 0; k < 4; k++) {
+        unsigned int p = k;
+
+        for (unsigned int r = k + 1; r < 4; r++) {
+            if (cabs(a[r * 4 + k]) > cabs(a[p * 4 + k])) p = r;
+        }
+        if (cabs(a[p * 4 + k]) == 0) return 0;
+        if (p != k) {
+            for (unsigned int c = 0; c < 4; c++) {
+                double complex t = a[k * 4 + c];
+                a[k * 4 + c] = a[p * 4 + c];
+                a[p * 4 + c] = t;
+            }
+            det = -det;
+        }
+        det *= a[k * 4 + k];
+        for (unsigned int r = k + 1; r < 4; r++) {
+            double complex f = a[r * 4 + k] / a[k * 4 + k];
+
+            for (unsigned int c = k; c < 4; c++) a[r * 4 + c] -= f * a[k * 4 + c];
+        }
+    }
+    return det;
+}
+
+// Cyclic Jacobi: @a (real symmetric) is diagonalised in place, @v receives the eigenvectors
+static void qpu_jacobi4(double a[16], double v[16]) {
+    for (unsigned int i = 0; i < 16; i++) v[i] = (i % 5 == 0);
+
+    for (int sweep = 0; sweep < 64; sweep++) {
+        double off = 0;
+
+        for (unsigned int p = 0; p < 4; p++) {
+            for (unsigned int q = p + 1; q < 4; q++) off += a[p * 4 + q] * a[p * 4 + q];
+        }
+        if (off < 1e-30) return;
+
+        for (unsigned int p = 0; p < 4; p++) {
+            for (unsigned int q = p + 1; q < 4; q++) {
+                double apq = a[p * 4 + q], th, t, c, s;
+
+                if (fabs(apq) < 1e-300) continue;
+                th = (a[q * 4 + q] - a[p * 4 + p]) / (2 * apq);
+                t = (th >= 0 ? 1.0 : -1.0) / (fabs(th) + sqrt(th * th + 1));
+                c = 1 / sqrt(t * t + 1);
+                s = t * c;
+                for (unsigned int k = 0; k < 4; k++) {
+                    double kp = a[k * 4 + p], kq = a[k * 4 + q];
+                    a[k * 4 + p] = c * kp - s * kq;
+                    a[k * 4 + q] = s * kp + c * kq;
+                }
+                for (unsigned int k = 0; k < 4; k++) {
+                    double pk = a[p * 4 + k], qk = a[q * 4 + k];
+                    a[p * 4 + k] = c * pk - s * qk;
+                    a[q * 4 + k] = s * pk + c * qk;
+                }
+                for (unsigned int k = 0; k < 4; k++) {
+                    double kp = v[k * 4 + p], kq = v[k * 4 + q];
+                    v[k * 4 + p] = c * kp - s * kq;
+                    v[k * 4 + q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * qpu_kron_factor - Splits a 4x4 product gate into hi (x) lo.
+ * @m: Matrix, known to be a tensor product up to phase.
+ * @hi: Receives the factor on the high index bit.
+ * @lo: Receives the factor on the low index bit, scaled to determinant 1.
+ */
+static void qpu_kron_factor(const double complex m[16], double complex hi[4], double complex lo[4]) {
+    unsigned int bi = 0, bj = 0;
+    double best = -1;
+    double complex r;
+
+    // The 2x2 block of largest norm is the best-conditioned copy of lo
+    for (unsigned int i = 0; i < 2; i++) {
+        for (unsigned int j = 0; j < 2; j++) {
+            double n = 0;
+
+            for (unsigned int k = 0; k < 4; k++) {
+                double complex e = m[(2 * i + (k >> 1)) * 4 + 2 * j + (k & 1)];
+                n += creal(e) * creal(e) + cimag(e) * cimag(e);
+            }
+            if (n > best) {
+                best = n;
+                bi = i;
+                bj = j;
+            }
+        }
+    }
+    for (unsigned int k = 0; k < 4; k++) lo[k] = m[(2 * bi + (k >> 1)) * 4 + 2 * bj + (k & 1)];
+    r = csqrt(lo[0] * lo[3] - lo[1] * lo[2]);
+    for (unsigned int k = 0; k < 4; k++) lo[k] /= r;
+
+    // hi_ij = tr(lo^dagger block_ij) / 2
+    for (unsigned int i = 0; i < 2; i++) {
+        for (unsigned int j = 0; j < 2; j++) {
+            double complex acc = 0;
+
+            for (unsigned int k = 0; k < 4; k++)
+                acc += conj(lo[k]) * m[(2 * i + (k >> 1)) * 4 + 2 * j + (k & 1)];
+            hi[i * 2 + j] = acc / 2;
+        }
+    }
+}
+
+/**
+ * qpu_kak - KAK decomposition of a two-qubit unitary.
+ * @u: Row-major 4x4, first operand as the high index bit.
+ * @a: Receives the 2x2 factors applied after the interaction, [0] on the
+ *     high bit and [1] on the low bit.
+ * @b: The same for the factors applied before it.
+ * @k: Receives a, b, c of exp(i(a XX + b YY + c ZZ)), each in [-pi/4, pi/4].
+ *
+ * In the magic basis u' = K1 D K2 with K1, K2 real orthogonal and D
+ * diagonal: u'^T u' = K2^T D^2 K2 is symmetric and unitary, so its real and
+ * imaginary parts commute and one real rotation diagonalises both.
+ *
+ * Returns 0, or -1 if u'^T u' could not be diagonalised.
+ */
+static int qpu_kak(const double complex u[16], double complex a[2][4], double complex b[2][4], double k[3]) {
+    static const double complex* const pauli[3] = { QPU_X, QPU_Y, QPU_Z };
+    double complex un[16], bd[16], t[16], up[16], m2[16], p[16], d[16], k1[16], pt[16];
+    double complex scale = cpow(qpu_det4(u), 0.25);
+    double h[4], hsum = 0;
+    int ok = 0;
+
+    for (unsigned int i = 0; i < 16; i++) un[i] = u[i] / scale;
+    qpu_adjoint4(bd, QPU_MAGIC);
+    sim_fuse_mul(t, bd, un, 4);
+    sim_fuse_mul(up, t, QPU_MAGIC, 4);
+    for (unsigned int r = 0; r < 4; r++) {
+        for (unsigned int c = 0; c < 4; c++) {
+            double complex acc = 0;
+
+            for (unsigned int i = 0; i < 4; i++) acc += up[i * 4 + r] * up[i * 4 + c];
+            m2[r * 4 + c] = acc;
+        }
+    }
+
+    // A generic real mix of the two parts has no repeated eigenvalue by accident
+    for (int attempt = 0; attempt < 8 && !ok; attempt++) {
+        double phi = 0.37 + 0.71 * attempt, mix[16], v[16], off = 0;
+
+        for (unsigned int i = 0; i < 16; i++)
+            mix[i] = cos(phi) * creal(m2[i]) + sin(phi) * cimag(m2[i]);
+        qpu_jacobi4(mix, v);
+        for (unsigned int i = 0; i < 16; i++) p[i] = v[i];
+        qpu_adjoint4(pt, p);
+        sim_fuse_mul(t, pt, m2, 4);
+        sim_fuse_mul(d, t, p, 4);
+        for (unsigned int r = 0; r < 4; r++) {
+            for (unsigned int c = 0; c < 4; c++) {
+                if (r != c && cabs(d[r * 4 + c]) > off) off = cabs(d[r * 4 + c]);
+            }
+        }
+        ok = off < 1e-8;
+    }
+    if (!ok) return -1;
+
+    // Keep K2 = P^T in SO(4), then pick the square roots of D so det K1 = 1
+    if (creal(qpu_det4(p)) < 0) {
+        for (unsigned int r = 0; r < 4; r++) p[r * 4] = -p[r * 4];
+    }
+    for (unsigned int i = 0; i < 4; i++) {
+        h[i] = carg(d[i * 5]) / 2;
+        hsum += h[i];
+    }
+    if (fabs(remainder(hsum, 2 * M_PI)) > M_PI_2) h[0] += M_PI;
+
+    // K1 = u' P D^{-1/2}; back in the computational basis both K's are local
+    sim_fuse_mul(k1, up, p, 4);
+    for (unsigned int r = 0; r < 4; r++) {
+        for (unsigned int c = 0; c < 4; c++) k1[r * 4 + c] *= cexp(-I * h[c]);
+    }
+    sim_fuse_mul(t, QPU_MAGIC, k1, 4);
+    sim_fuse_mul(k1, t, bd, 4);
+    qpu_kron_factor(k1, a[0], a[1]);
+    qpu_adjoint4(pt, p);
+    sim_fuse_mul(t, QPU_MAGIC, pt, 4);
+    sim_fuse_mul(pt, t, bd, 4);
+    qpu_kron_factor(pt, b[0], b[1]);
+
+    for (unsigned int i = 0; i < 3; i++) k[i] = 0;
+    for (unsigned int i = 0; i < 4; i++) {
+        k[0] += QPU_MAGIC_XX[i] * h[i] / 4;
+        k[1] += QPU_MAGIC_YY[i] * h[i] / 4;
+        k[2] += QPU_MAGIC_ZZ[i] * h[i] / 4;
+    }
+
+    // exp(i pi/2 PP) = i P (x) P is local: fold whole quarter turns into B
+    for (unsigned int i = 0; i < 3; i++) {
+        while (k[i] > M_PI_4 + QPU_NATIVE_EPS || k[i] < -M_PI_4 - QPU_NATIVE_EPS) {
+            k[i] += k[i] > 0 ? -M_PI_2 : M_PI_2;
+            sim_fuse_lmul(b[0], pauli[i], 2);
+            sim_fuse_lmul(b[1], pauli[i], 2);
+        }
+    }
+    return 0;
+}
+
+/**
+ * qpu_native_u4 - Decomposes a two-qubit unitary on slots 0 (high bit) and 1.
+ * @b: Builder.
+ * @u: Row-major 4x4.
+ *
+ * Returns 0, or -1 if the KAK decomposition failed.
+ */
+static int qpu_native_u4(qpu_native_builder* b, const double complex u[16]) {
+    static const double complex S[4] = { 1, 0, 0, I };
+    double complex ka[2][4], kb[2][4], v[4], vd[4], m[4];
+    double k[3];
+    unsigned int nz = 0, which = 0;
+
+    if (qpu_kak(u, ka, kb, k)) return -1;
+    for (unsigned int i = 0; i < 3; i++) {
+        if (fabs(k[i]) > QPU_NATIVE_EPS) {
+            nz++;
+            which = i;
+        }
+    }
+
+    qpu_native_u1(b, 0, kb[0]);
+    qpu_native_u1(b, 1, kb[1]);
+
+    if (nz == 1) {
+        // exp(i t PP) = (V (x) V) exp(i t ZZ) (V^dagger (x) V^dagger), V Z V^dagger = P
+        double t = k[which];
+
+        if (which == 0) {
+            memcpy(v, QPU_H, sizeof(v));
+        } else if (which == 1) {
+            sim_fuse_mul(v, S, QPU_H, 2);
+        } else {
+            v[0] = v[3] = 1;
+            v[1] = v[2] = 0;
+        }
+        for (unsigned int i = 0; i < 4; i++) vd[i] = conj(v[(i & 1) * 2 + (i >> 1)]);
+        qpu_native_u1(b, 0, vd);
+        qpu_native_u1(b, 1, vd);
+        qpu_rz_m(m, -2 * t);
+        if (fabs(fabs(t) - M_PI_4) < QPU_NATIVE_EPS) {
+            // exp(+-i pi/4 ZZ) is CZ after rz(-+pi/2) on both
+            qpu_native_u1(b, 0, m);
+            qpu_native_u1(b, 1, m);
+            qpu_native_cz(b, 0, 1);
+        } else {
+            qpu_native_cx(b, 0, 1);
+            qpu_native_u1(b, 1, m);
+            qpu_native_cx(b, 0, 1);
+        }
+        qpu_native_u1(b, 0, v);
+        qpu_native_u1(b, 1, v);
+    } else if (nz == 2) {
+        // exp(i(s XX + t ZZ)) = CX01 (Rx(-2s) (x) Rz(-2t)) CX01, after a basis
+        // change V (x) V taking X and Z to the two terms present
+        double s, t;
+
+        if (fabs(k[1]) <= QPU_NATIVE_EPS) {
+            v[0] = v[3] = 1;
+            v[1] = v[2] = 0;
+            s = k[0];
+            t = k[2];
+        } else if (fabs(k[0]) <= QPU_NATIVE_EPS) {
+            memcpy(v, S, sizeof(v));
+            s = k[1];
+            t = k[2];
+        } else {
+            qpu_rx_m(v, -M_PI_2);
+            s = k[0];
+            t = k[1];
+        }
+        for (unsigned int i = 0; i < 4; i++) vd[i] = conj(v[(i & 1) * 2 + (i >> 1)]);
+        qpu_native_u1(b, 0, vd);
+        qpu_native_u1(b, 1, vd);
+        qpu_native_cx(b, 0, 1);
+        qpu_rx_m(m, -2 * s);
+        qpu_native_u1(b, 0, m);
+        qpu_rz_m(m, -2 * t);
+        qpu_native_u1(b, 1, m);
+        qpu_native_cx(b, 0, 1);
+        qpu_native_u1(b, 0, v);
+        qpu_native_u1(b, 1, v);
+    } else if (nz == 3) {
+        // Vatan-Williams three-CNOT form of exp(i(a XX + b YY + c ZZ))
+        qpu_rz_m(m, M_PI_2);
+        qpu_native_u1(b, 0, m);
+        qpu_native_cx(b, 1, 0);
+        qpu_ry_m(m, 2 * k[1] - M_PI_2);
+        qpu_native_u1(b, 1, m);
+        qpu_native_cx(b, 0, 1);
+        qpu_rz_m(m, M_PI_2 - 2 * k[2]);
+        qpu_native_u1(b, 0, m);
+        qpu_ry_m(m, M_PI_2 - 2 * k[0]);
+        qpu_native_u1(b, 1, m);
+        qpu_native_cx(b, 1, 0);
+        qpu_rz_m(m, -M_PI_2);
+        qpu_native_u1(b, 1, m);
+    }
+
+    qpu_native_u1(b, 0, ka[0]);
+    qpu_native_u1(b, 1, ka[1]);
+    return 0;
+}
+
+// Phase flip of |111>: the Toffoli construction without its H's
+static void qpu_native_ccz(qpu_native_builder* b, size_t a, size_t c, size_t t) {
+    double complex tg[4], tdg[4];
+
+    qpu_rz_m(tg, M_PI_4);
+    qpu_rz_m(tdg, -M_PI_4);
+    qpu_native_cx(b, c, t);
+    qpu_native_u1(b, t, tdg);
+    qpu_native_cx(b, a, t);
+    qpu_native_u1(b, t, tg);
+    qpu_native_cx(b, c, t);
+    qpu_native_u1(b, t, tdg);
+    qpu_native_cx(b, a, t);
+    qpu_native_u1(b, c, tg);
+    qpu_native_u1(b, t, tg);
+    qpu_native_cx(b, a, c);
+    qpu_native_u1(b, a, tg);
+    qpu_native_u1(b, c, tdg);
+    qpu_native_cx(b, a, c);
+}
+
+static void qpu_native_ccx(qpu_native_builder* b, size_t a, size_t c, size_t t) {
+    qpu_native_h(b, t);
+    qpu_native_ccz(b, a, c, t);
+    qpu_native_h(b, t);
+}
+
+// SWAP of @x and @y when @c is |1>
+static void qpu_native_cswap(qpu_native_builder* b, size_t c, size_t x, size_t y) {
+    qpu_native_cx(b, y, x);
+    qpu_native_ccx(b, c, x, y);
+    qpu_native_cx(b, y, x);
+}
+
+// Decomposes one gate call onto slots 0-2; -1 for gates with no fixed operands
+static int qpu_native_build(qpu_native_builder* b, int gate_code, double theta, char axis) {
+    double complex m[16];
+
+    // The entanglers themselves, which KAK would only surround with locals
+    switch (gate_code) {
+        case 3309: qpu_native_cx(b, 0, 1); return 0;
+        case 3311: qpu_native_cz(b, 0, 1); return 0;
+        case 3313:
+            qpu_native_cx(b, 0, 1);
+            qpu_native_cx(b, 1, 0);
+            qpu_native_cx(b, 0, 1);
+            return 0;
+    }
+
+    switch (backend_sim_gate_matrix(gate_code, theta, axis, m)) {
+        case 1: qpu_native_u1(b, 0, m); return 0;
+        case 2: return qpu_native_u4(b, m);
+    }
+
+    switch (gate_code) {
+        case 3312:   // double_controlled_not
+        case 3331:   // barenco
+            qpu_native_ccx(b, 0, 1, 2);
+            return 0;
+        case 3329:   // fredkin
+        case 3335:   // dagwood
+            qpu_native_cswap(b, 0, 1, 2);
+            return 0;
+        case 3343:   // margolis
+            qpu_native_ccz(b, 0, 1, 2);
+            return 0;
+        case 3344:   // peres: CNOT(q1, q3), then Margolis
+            qpu_native_cx(b, 0, 2);
+            qpu_native_ccz(b, 0, 1, 2);
+            return 0;
+        case 3345:   // cf_swap: controlled SWAP, then the controlled CZ of the fermionic sign
+            qpu_native_cswap(b, 0, 1, 2);
+            qpu_native_ccz(b, 0, 1, 2);
+            return 0;
+        case 3346:   // lattice_triangle
+            qpu_native_h(b, 0);
+            qpu_native_cx(b, 0, 1);
+            qpu_native_cx(b, 1, 2);
+            qpu_native_cx(b, 2, 0);
+            return 0;
+    }
+    return -1;
+}
+
+/**
+ * qpu_native_entry - One memoised decomposition.
+ * @set: Gate set; 0 marks an empty entry.
+ * @gate_code: Gate.
+ * @theta: Bit pattern of the angle.
+ * @axis: Axis of a generic rotation, else 0.
+ * @seq: The gates, owned by the cache.
+ */
+typedef struct qpu_native_entry {
+    int set;
+    int gate_code;
+    uint64_t theta;
+    char axis;
+    qpu_native_seq seq;
+} qpu_native_entry;
+
+static pthread_mutex_t qpu_native_lock = PTHREAD_MUTEX_INITIALIZER;
+static qpu_native_entry qpu_native_cache[1u << QPU_NATIVE_CACHE_BITS];
+
+static int qpu_native_copy(qpu_native_seq* dst, const qpu_native_seq* src) {
+    if (dst->cap < src->n) {
+        qpu_native_op* p = realloc(dst->op, src->n * sizeof(*p));
+
+        if (!p) return -1;
+        dst->op = p;
+        dst->cap = src->n;
+    }
+    if (src->n) memcpy(dst->op, src->op, src->n * sizeof(*src->op));
+    dst->n = src->n;
+    return 0;
+}
+
+/**
+ * qpu_native_gate - Decomposes one gate call into a native gate set.
+ * @set: NYMYA_QPU_NATIVE_CX or NYMYA_QPU_NATIVE_CZ.
+ * @gate_code: Gate with one to three qubit operands.
+ * @theta: Its angle, if it has one.
+ * @axis: Axis of the generic rotation (3330), else 0.
+ * @out: Replaced by the gates; operand slot i is the gate's (i+1)th qubit.
+ *
+ * The first call for a (set, gate, angle) decomposes it and keeps a copy;
+ * later ones copy that out. Runs of single-qubit gates come out merged, so
+ * the sequence is as short as the construction allows.
+ *
+ * Returns 0, or -1 for a gate without fixed operands or on memory failure.
+ */
+int qpu_native_gate(int set, int gate_code, double theta, char axis, qpu_native_seq* out) {
+    qpu_native_builder b;
+    qpu_native_entry* e;
+    uint64_t bits, h;
+    int ret;
+
+    memcpy(&bits, &theta, sizeof(bits));
+    h = (bits ^ (bits >> 29) ^ (uint64_t)gate_code ^ ((uint64_t)set << 16) ^ (uint64_t)(unsigned char)axis << 24) *
+        0x9E3779B97F4A7C15ULL;
+    e = &qpu_native_cache[h >> (64 - QPU_NATIVE_CACHE_BITS)];
+
+    pthread_mutex_lock(&qpu_native_lock);
+    if (e->set == set && e->gate_code == gate_code && e->theta == bits && e->axis == axis) {
+        ret = qpu_native_copy(out, &e->seq);
+        pthread_mutex_unlock(&qpu_native_lock);
+        return ret;
+    }
+    pthread_mutex_unlock(&qpu_native_lock);
+
+    out->n = 0;
+    if (qpu_native_begin(&b, set, 3, out)) return -1;
+    ret = qpu_native_build(&b, gate_code, theta, axis);
+    if (qpu_native_end(&b) || ret) return -1;
+
+    pthread_mutex_lock(&qpu_native_lock);
+    e->set = 0;
+    if (qpu_native_copy(&e->seq, out) == 0) {
+        e->set = set;
+        e->gate_code = gate_code;
+        e->theta = bits;
+        e->axis = axis;
+    }
+    pthread_mutex_unlock(&qpu_native_lock);
+    return 0;
+}
+
+void qpu_native_seq_free(qpu_native_seq* s) {
+    free(s->op);
+    *s = (qpu_native_seq){ 0 };
+}
@@ -0,0 +1,70 @@
+#ifndef NYMYA_QPU_NATIVE_H
+#define NYMYA_QPU_NATIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex.h>
+
+/**
+ * qpu_native_op - One gate of a native gate set.
+ * @gate_code: NYMYA_ROTATE_Z_CODE, NYMYA_SQRT_X_CODE, NYMYA_PAULI_X_CODE,
+ *             NYMYA_CNOT_CODE or NYMYA_CZ_CODE.
+ * @qubit: Operand slots; @qubit[1] is used by the two-qubit gates only.
+ * @theta: Angle of an rz.
+ */
+typedef struct qpu_native_op {
+    uint32_t gate_code;
+    uint32_t qubit[2];
+    double theta;
+} qpu_native_op;
+
+/**
+ * qpu_native_seq - Growable list of native gates, in circuit order.
+ * @op: Gates.
+ * @n: Entries used.
+ * @cap: Entries allocated.
+ */
+typedef struct qpu_native_seq {
+    qpu_native_op* op;
+    size_t n;
+    size_t cap;
+} qpu_native_seq;
+
+/**
+ * qpu_native_builder - Writes gates into a qpu_native_seq.
+ * @out: Receives the gates.
+ * @set: NYMYA_QPU_NATIVE_CX or NYMYA_QPU_NATIVE_CZ.
+ * @pend: Product of the single-qubit gates not yet written, by slot.
+ * @has: Non-zero where @pend holds a gate.
+ * @nslots: Entries of @pend and @has.
+ * @err: Set when @out could not grow.
+ *
+ * Single-qubit gates are held back and multiplied together until an
+ * entangler touches their slot or the builder ends, so a run of them costs
+ * at most five native gates.
+ */
+typedef struct qpu_native_builder {
+    qpu_native_seq* out;
+    int set;
+    double complex (*pend)[4];
+    unsigned char* has;
+    size_t nslots;
+    int err;
+} qpu_native_builder;
+
+// Gate set chosen with NYMYA_QPU_NATIVE or nymya_qpu_set_native()
+int qpu_native_target(void);
+
+int qpu_native_begin(qpu_native_builder* b, int set, size_t nslots, qpu_native_seq* out);
+void qpu_native_u1(qpu_native_builder* b, size_t q, const double complex m[4]);
+void qpu_native_h(qpu_native_builder* b, size_t q);
+void qpu_native_cx(qpu_native_builder* b, size_t c, size_t t);
+void qpu_native_cz(qpu_native_builder* b, size_t c, size_t t);
+void qpu_native_replay(qpu_native_builder* b, const qpu_native_seq* s, const uint32_t* slot);
+int qpu_native_end(qpu_native_builder* b);
+
+// Memoised decomposition of one gate call; operands are slots 0-2
+int qpu_native_gate(int set, int gate_code, double theta, char axis, qpu_native_seq* out);
+void qpu_native_seq_free(qpu_native_seq* s);
+
+#endif // NYMYA_QPU_NATIVE_H
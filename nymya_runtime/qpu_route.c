@@ -0,0 +1,761 @@
+// runtime/qpu_route.c
+//
+// Qubit routing of gate-QPU jobs for devices with restricted connectivity.
+// A device that lists its coupling map (nymya_qpu_device.coupling) receives
+// each request placed on its physical qubits, with SWAPs inserted wherever
+// a two-qubit gate's operands are not coupled. The search follows SABRE
+// (Li, Ding and Xie, ASPLOS 2019): the gates whose predecessors have all
+// run form the front layer; when none of them can run, the SWAP on a
+// coupler next to a front gate that brings the front layer closest
+// together, and at half weight the gates queued behind it, is taken. A
+// decay on recently swapped qubits keeps the search from oscillating.
+//
+// The initial placement first tries to embed the circuit's interaction
+// graph in the coupling graph, so a lattice, ring or chain circuit whose
+// shape the device has runs without a single SWAP. Failing that, it comes
+// from a forward and a backward routing pass, whose final placement suits
+// the start of the circuit.
+//
+// Three-qubit records are expanded into CNOTs and single-qubit gates first.
+// SWAPs are written as swap records, or in the request's own entangler when
+// it is already in a native gate set.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <nymya/nymya.h>
+#include "nymya_qpu.h"
+#include "qpu_native.h"
+#include "qpu_route.h"
+#include "backend_gateqpu.h"
+
+// Largest device routed; distances take 2 bytes per pair of its qubits
+#define QPU_ROUTE_MAX_PHYSICAL 4096
+
+// Two-qubit gates behind the front layer that the SWAP score looks ahead to
+#define QPU_ROUTE_EXTENDED 20
+#define QPU_ROUTE_EXTENDED_WEIGHT 0.5
+
+// Score penalty per recent SWAP on a qubit, cleared every few SWAPs
+#define QPU_ROUTE_DECAY 0.001
+#define QPU_ROUTE_DECAY_RESET 5
+
+// Placement attempts the embedding search may make
+#define QPU_ROUTE_EMBED_BUDGET 200000
+
+#define QPU_ROUTE_NONE UINT32_MAX
+#define QPU_ROUTE_FAR UINT16_MAX
+
+/**
+ * qpu_route_ctx - Device, circuit and placement of one routing.
+ * @np: Physical qubits.
+ * @adj_off: Start of each qubit's neighbours in @adj, @np + 1 entries.
+ * @adj: Coupled qubits.
+ * @dist: Coupler hops between physical qubits, @np * @np entries.
+ * @usable: Non-zero on the qubits of the largest connected part.
+ * @op: Records on slots, three-qubit ones expanded.
+ * @arity: Operands of each record.
+ * @n: Records.
+ * @cap: Records allocated at @op.
+ * @nq: Slots.
+ * @succ: Next record on each operand, or QPU_ROUTE_NONE.
+ * @pred: Previous record on each operand, or QPU_ROUTE_NONE.
+ * @l2p: Physical qubit of each slot.
+ * @p2l: Slot on each physical qubit, or QPU_ROUTE_NONE.
+ * @need: Operands of each record whose previous record has not run.
+ * @front: Records free to run once their operands are coupled.
+ * @walk: Queue of the look-ahead.
+ * @seen: Look-ahead visit stamps.
+ * @stamp: Stamp of the current look-ahead.
+ * @decay: SWAP penalty of each physical qubit.
+ * @native: NYMYA_QPU_NATIVE_* SWAPs are written in.
+ * @seq: Scratch for native decompositions.
+ * @out: Routed records.
+ * @outcap: Records allocated at @out->ops.
+ * @err: Set when @op or @out could not grow.
+ */
+typedef struct qpu_route_ctx {
+    uint32_t np;
+    uint32_t* adj_off;
+    uint32_t* adj;
+    uint16_t* dist;
+    unsigned char* usable;
+    nymya_op* op;
+    unsigned char* arity;
+    size_t n;
+    size_t cap;
+    uint32_t nq;
+    uint32_t (*succ)[2];
+    uint32_t (*pred)[2];
+    uint32_t* l2p;
+    uint32_t* p2l;
+    uint32_t* need;
+    uint32_t* front;
+    uint32_t* walk;
+    uint32_t* seen;
+    uint32_t stamp;
+    double* decay;
+    int native;
+    qpu_native_seq seq;
+    qpu_routed* out;
+    size_t outcap;
+    int err;
+} qpu_route_ctx;
+
+static uint16_t qpu_dist(const qpu_route_ctx* r, uint32_t a, uint32_t b) {
+    return r->dist[(size_t)a * r->np + b];
+}
+
+static void qpu_route_add(qpu_route_ctx* r, const nymya_op* op, unsigned char arity) {
+    if (r->err) return;
+    if (r->n == r->cap) {
+        size_t cap = r->cap ? 2 * r->cap : 64;
+        nymya_op* p = realloc(r->op, cap * sizeof(*p));
+        unsigned char* a = realloc(r->arity, cap);
+
+        if (p) r->op = p;
+        if (a) r->arity = a;
+        if (!p || !a) {
+            r->err = 1;
+            return;
+        }
+        r->cap = cap;
+    }
+    r->op[r->n] = *op;
+    r->arity[r->n++] = arity;
+}
+
+static void qpu_route_put(qpu_route_ctx* r, const nymya_op* op) {
+    qpu_routed* o = r->out;
+
+    if (r->err) return;
+    if (o->nops == r->outcap) {
+        size_t cap = r->outcap ? 2 * r->outcap : 64;
+        nymya_op* p = realloc(o->ops, cap * sizeof(*p));
+
+        if (!p) {
+            r->err = 1;
+            return;
+        }
+        o->ops = p;
+        r->outcap = cap;
+    }
+    o->ops[o->nops++] = *op;
+}
+
+// Record of a native gate on the qubits @slot names
+static nymya_op qpu_route_native_op(const qpu_native_op* n, const uint32_t* slot) {
+    nymya_op op = { 0 };
+
+    op.gate_code = n->gate_code;
+    op.param = (int64_t)llround(n->theta * (double)FIXED_POINT_SCALE);
+    op.qubit[0] = slot[n->qubit[0]];
+    if (n->gate_code == NYMYA_CNOT_CODE || n->gate_code == NYMYA_CZ_CODE) op.qubit[1] = slot[n->qubit[1]];
+    return op;
+}
+
+/**
+ * qpu_route_device - Reads the coupling map of @dev.
+ *
+ * Builds the neighbour lists and all-pairs distances, and marks the largest
+ * connected part of the device as the qubits slots may be placed on.
+ *
+ * Returns 0, or -1 after reporting a map that cannot be used.
+ */
+static int qpu_route_device(qpu_route_ctx* r, const nymya_qpu_device* dev) {
+    const char* name = dev->name ? dev->name : "device";
+    uint32_t np = dev->nphysical;
+    uint32_t* deg;
+    uint32_t best = 0, best_size = 0;
+
+    if (!np) {
+        for (size_t e = 0; e < dev->ncoupling; e++) {
+            if (dev->coupling[e][0] >= np) np = dev->coupling[e][0] + 1;
+            if (dev->coupling[e][1] >= np) np = dev->coupling[e][1] + 1;
+        }
+    }
+    if (!np || np > QPU_ROUTE_MAX_PHYSICAL) {
+        fprintf(stderr, "[QPU] Coupling map of %s has %u qubits; routing takes 1 to %u.\n",
+                name, np, QPU_ROUTE_MAX_PHYSICAL);
+        return -1;
+    }
+    r->np = np;
+    r->adj_off = calloc((size_t)np + 1, sizeof(*r->adj_off));
+    r->adj = malloc((2 * dev->ncoupling + 1) * sizeof(*r->adj));
+    r->dist = malloc((size_t)np * np * sizeof(*r->dist));
+    r->usable = calloc(np, 1);
+    deg = calloc(np, sizeof(*deg));
+    if (!r->adj_off || !r->adj || !r->dist || !r->usable || !deg) {
+        free(deg);
+        return -1;
+    }
+
+    for (size_t e = 0; e < dev->ncoupling; e++) {
+        uint32_t a = dev->coupling[e][0], b = dev->coupling[e][1];
+
+        if (a >= np || b >= np) {
+            fprintf(stderr, "[QPU] Coupling map of %s names qubit %u of %u.\n", name, a >= np ? a : b, np);
+            free(deg);
+            return -1;
+        }
+        if (a == b) continue;
+        r->adj_off[a + 1]++;
+        r->adj_off[b + 1]++;
+    }
+    for (uint32_t p = 0; p < np; p++) r->adj_off[p + 1] += r->adj_off[p];
+    for (size_t e = 0; e < dev->ncoupling; e++) {
+        uint32_t a = dev->coupling[e][0], b = dev->coupling[e][1];
+
+        if (a == b) continue;
+        r->adj[r->adj_off[a] + deg[a]++] = b;
+        r->adj[r->adj_off[b] + deg[b]++] = a;
+    }
+
+    // Breadth-first search from every qubit; @deg is reused as the queue
+    for (uint32_t s = 0; s < np; s++) {
+        uint16_t* d = &r->dist[(size_t)s * np];
+        uint32_t head = 0, tail = 0, size = 0;
+
+        for (uint32_t p = 0; p < np; p++) d[p] = QPU_ROUTE_FAR;
+        d[s] = 0;
+        deg[tail++] = s;
+        while (head < tail) {
+            uint32_t p = deg[head++];
+
+            size++;
+            for (uint32_t k = r->adj_off[p]; k < r->adj_off[p + 1]; k++) {
+                if (d[r->adj[k]] == QPU_ROUTE_FAR) {
+                    d[r->adj[k]] = d[p] + 1;
+                    deg[tail++] = r->adj[k];
+                }
+            }
+        }
+        if (size > best_size) {
+            best = s;
+            best_size = size;
+        }
+    }
+    for (uint32_t p = 0; p < np; p++) r->usable[p] = qpu_dist(r, best, p) != QPU_ROUTE_FAR;
+    free(deg);
+
+    if (best_size < r->nq) {
+        fprintf(stderr, "[QPU] Circuit of %u qubits does not fit the %u connected qubits of %s.\n",
+                r->nq, best_size, name);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * qpu_route_circuit - Reads the records of @req.
+ *
+ * Three-qubit records are expanded into cx and single-qubit gates. Links
+ * each record to its neighbours on every operand and picks the entangler
+ * SWAPs are written in: the request's own when it uses only native gates.
+ *
+ * Returns the number of two-qubit records, or -1.
+ */
+static long qpu_route_circuit(qpu_route_ctx* r, const nymya_qpu_request* req) {
+    uint32_t* last;
+    long n2 = 0;
+    int native = 1, cz_only = 1;
+
+    r->nq = (uint32_t)req->nqubits;
+    for (size_t i = 0; i < req->nops; i++) {
+        const nymya_op* op = &req->ops[i];
+        int arity = backend_gateqpu_arity(op->gate_code);
+
+        if (!arity) return -1;
+        for (int k = 0; k < arity; k++) {
+            if (op->qubit[k] >= r->nq) return -1;
+        }
+        if (arity < 3) {
+            qpu_route_add(r, op, (unsigned char)arity);
+        } else {
+            double theta = (double)op->param / (double)FIXED_POINT_SCALE;
+
+            if (qpu_native_gate(NYMYA_QPU_NATIVE_CX, (int)op->gate_code, theta, (char)op->axis, &r->seq)) return -1;
+            for (size_t j = 0; j < r->seq.n; j++) {
+                nymya_op e = qpu_route_native_op(&r->seq.op[j], op->qubit);
+                int cx = e.gate_code == NYMYA_CNOT_CODE;
+
+                qpu_route_add(r, &e, (unsigned char)(cx ? 2 : 1));
+            }
+        }
+    }
+    if (r->err) return -1;
+
+    r->succ = malloc((r->n ? r->n : 1) * sizeof(*r->succ));
+    r->pred = malloc((r->n ? r->n : 1) * sizeof(*r->pred));
+    last = malloc((r->nq ? r->nq : 1) * sizeof(*last));
+    if (!r->succ || !r->pred || !last) {
+        free(last);
+        return -1;
+    }
+    for (uint32_t q = 0; q < r->nq; q++) last[q] = QPU_ROUTE_NONE;
+    for (size_t i = 0; i < r->n; i++) {
+        const nymya_op* op = &r->op[i];
+
+        switch (op->gate_code) {
+            case NYMYA_ROTATE_Z_CODE:
+            case NYMYA_SQRT_X_CODE:
+            case NYMYA_PAULI_X_CODE:
+                break;
+            case NYMYA_CNOT_CODE:
+                cz_only = 0;
+                break;
+            case NYMYA_CZ_CODE:
+                break;
+            default:
+                native = 0;
+        }
+        r->succ[i][0] = r->succ[i][1] = QPU_ROUTE_NONE;
+        r->pred[i][0] = r->pred[i][1] = QPU_ROUTE_NONE;
+        for (int k = 0; k < r->arity[i]; k++) {
+            uint32_t q = op->qubit[k], p = last[q];
+
+            r->pred[i][k] = p;
+            if (p != QPU_ROUTE_NONE) r->succ[p][r->op[p].qubit[0] == q ? 0 : 1] = (uint32_t)i;
+            last[q] = (uint32_t)i;
+        }
+        if (r->arity[i] == 2) n2++;
+    }
+    free(last);
+    r->native = !native ? NYMYA_QPU_NATIVE_NONE : cz_only ? NYMYA_QPU_NATIVE_CZ : NYMYA_QPU_NATIVE_CX;
+    return n2;
+}
+
+static void qpu_route_place(qpu_route_ctx* r, uint32_t l, uint32_t p) {
+    r->l2p[l] = p;
+    r->p2l[p] = l;
+}
+
+/**
+ * qpu_route_embed - Places the slots so that every two-qubit gate is coupled.
+ * @r: Context, with every slot unplaced.
+ *
+ * Backtracking search over the slots in breadth-first order of the
+ * interaction graph; a slot goes next to the one it was reached from, on a
+ * free qubit with couplers enough for its partners and coupled to those
+ * already placed. Gives up after QPU_ROUTE_EMBED_BUDGET attempts.
+ *
+ * Returns 1 if an embedding was found, 0 (with nothing placed) if not, or
+ * -1 if memory ran out.
+ */
+static int qpu_route_embed(qpu_route_ctx* r) {
+    uint32_t nq = r->nq;
+    uint32_t* off = calloc((size_t)nq + 1, sizeof(*off));
+    uint32_t *nb = NULL, *deg = NULL, *order = NULL, *parent = NULL, *it = NULL;
+    uint32_t m = 0;
+    size_t npairs = 0, steps = 0;
+    int ret = -1;
+
+    if (!off) return -1;
+    for (size_t i = 0; i < r->n; i++) {
+        if (r->arity[i] != 2 || r->op[i].qubit[0] == r->op[i].qubit[1]) continue;
+        off[r->op[i].qubit[0] + 1]++;
+        off[r->op[i].qubit[1] + 1]++;
+        npairs++;
+    }
+    for (uint32_t q = 0; q < nq; q++) off[q + 1] += off[q];
+    nb = malloc((2 * npairs + 1) * sizeof(*nb));
+    deg = calloc(nq ? nq : 1, sizeof(*deg));
+    order = malloc((nq ? nq : 1) * sizeof(*order));
+    parent = malloc((nq ? nq : 1) * sizeof(*parent));
+    it = calloc((size_t)nq + 1, sizeof(*it));
+    if (!nb || !deg || !order || !parent || !it) goto out;
+
+    // Interaction graph: each slot's distinct partners, @deg of them from off[]
+    for (size_t i = 0; i < r->n; i++) {
+        uint32_t a = r->op[i].qubit[0], b = r->op[i].qubit[1];
+
+        if (r->arity[i] != 2 || a == b) continue;
+        nb[off[a] + deg[a]++] = b;
+        nb[off[b] + deg[b]++] = a;
+    }
+    for (uint32_t q = 0; q < nq; q++) parent[q] = QPU_ROUTE_NONE;
+    for (uint32_t q = 0; q < nq; q++) {
+        uint32_t n = 0;
+
+        for (uint32_t k = off[q]; k < off[q] + deg[q]; k++) {
+            if (parent[nb[k]] == q) continue;
+            parent[nb[k]] = q;
+            nb[off[q] + n++] = nb[k];
+        }
+        deg[q] = n;
+    }
+
+    // Breadth-first order, each part of the graph from its busiest slot;
+    // @it marks the slots taken until the search starts
+    for (uint32_t q = 0; q < nq; q++) parent[q] = QPU_ROUTE_NONE;
+    for (;;) {
+        uint32_t root = QPU_ROUTE_NONE, head = m;
+
+        for (uint32_t q = 0; q < nq; q++) {
+            if (!it[q] && deg[q] && (root == QPU_ROUTE_NONE || deg[q] > deg[root])) root = q;
+        }
+        if (root == QPU_ROUTE_NONE) break;
+        it[root] = 1;
+        order[m++] = root;
+        while (head < m) {
+            uint32_t v = order[head++];
+
+            for (uint32_t k = off[v]; k < off[v] + deg[v]; k++) {
+                if (!it[nb[k]]) {
+                    it[nb[k]] = 1;
+                    parent[nb[k]] = v;
+                    order[m++] = nb[k];
+                }
+            }
+        }
+    }
+    memset(it, 0, ((size_t)nq + 1) * sizeof(*it));
+
+    for (uint32_t level = 0; level < m;) {
+        uint32_t v = order[level], base = parent[v];
+        uint32_t from = base == QPU_ROUTE_NONE ? 0 : r->adj_off[r->l2p[base]];
+        uint32_t len = base == QPU_ROUTE_NONE ? r->np : r->adj_off[r->l2p[base] + 1] - from;
+        int placed = 0;
+
+        for (; it[level] < len && !placed; it[level]++) {
+            uint32_t p = base == QPU_ROUTE_NONE ? it[level] : r->adj[from + it[level]];
+            int ok = r->usable[p] && r->p2l[p] == QPU_ROUTE_NONE &&
+                     r->adj_off[p + 1] - r->adj_off[p] >= deg[v];
+
+            if (++steps > QPU_ROUTE_EMBED_BUDGET) {
+                ret = 0;
+                goto out;
+            }
+            for (uint32_t k = off[v]; ok && k < off[v] + deg[v]; k++) {
+                uint32_t w = r->l2p[nb[k]];
+                if (w != QPU_ROUTE_NONE && qpu_dist(r, p, w) != 1) ok = 0;
+            }
+            if (ok) {
+                qpu_route_place(r, v, p);
+                placed = 1;
+            }
+        }
+        if (placed) {
+            it[++level] = 0;
+            continue;
+        }
+        if (!level) {
+            ret = 0;
+            goto out;
+        }
+        it[level--] = 0;
+        r->p2l[r->l2p[order[level]]] = QPU_ROUTE_NONE;
+        r->l2p[order[level]] = QPU_ROUTE_NONE;
+    }
+    ret = 1;
+out:
+    if (ret != 1) {
+        for (uint32_t q = 0; q < nq; q++) r->l2p[q] = QPU_ROUTE_NONE;
+        for (uint32_t p = 0; p < r->np; p++) r->p2l[p] = QPU_ROUTE_NONE;
+    }
+    free(off);
+    free(nb);
+    free(deg);
+    free(order);
+    free(parent);
+    free(it);
+    return ret;
+}
+
+static void qpu_route_swap(qpu_route_ctx* r, uint32_t p, uint32_t q) {
+    uint32_t a = r->p2l[p], b = r->p2l[q];
+
+    r->p2l[p] = b;
+    r->p2l[q] = a;
+    if (a != QPU_ROUTE_NONE) r->l2p[a] = q;
+    if (b != QPU_ROUTE_NONE) r->l2p[b] = p;
+}
+
+// Writes a SWAP of physical qubits @p and @q and applies it to the placement
+static void qpu_route_put_swap(qpu_route_ctx* r, uint32_t p, uint32_t q, int emit) {
+    qpu_route_swap(r, p, q);
+    if (!emit) return;
+    r->out->nswaps++;
+    if (r->native) {
+        uint32_t slot[2] = { p, q };
+
+        if (qpu_native_gate(r->native, NYMYA_SWAP_CODE, 0.0, 0, &r->seq)) {
+            r->err = 1;
+            return;
+        }
+        for (size_t i = 0; i < r->seq.n; i++) {
+            nymya_op op = qpu_route_native_op(&r->seq.op[i], slot);
+            qpu_route_put(r, &op);
+        }
+    } else {
+        nymya_op op = { .gate_code = NYMYA_SWAP_CODE, .qubit = { p, q } };
+        qpu_route_put(r, &op);
+    }
+}
+
+/**
+ * qpu_route_ahead - Collects the two-qubit gates queued behind the front layer.
+ * @r: Context.
+ * @front: Front records, @nfront of them.
+ * @next: Successor links of the pass.
+ * @ext: Receives up to QPU_ROUTE_EXTENDED records.
+ *
+ * Returns the number collected.
+ */
+static size_t qpu_route_ahead(qpu_route_ctx* r, const uint32_t* front, size_t nfront,
+                              uint32_t (*next)[2], uint32_t* ext) {
+    size_t head = 0, tail = 0, n = 0;
+
+    if (++r->stamp == 0) {
+        memset(r->seen, 0, r->n * sizeof(*r->seen));
+        r->stamp = 1;
+    }
+    for (size_t f = 0; f < nfront; f++) {
+        for (int k = 0; k < r->arity[front[f]]; k++) {
+            uint32_t j = next[front[f]][k];
+            if (j != QPU_ROUTE_NONE && r->seen[j] != r->stamp) {
+                r->seen[j] = r->stamp;
+                r->walk[tail++] = j;
+            }
+        }
+    }
+    while (head < tail && n < QPU_ROUTE_EXTENDED) {
+        uint32_t i = r->walk[head++];
+
+        if (r->arity[i] == 2) ext[n++] = i;
+        for (int k = 0; k < r->arity[i]; k++) {
+            uint32_t j = next[i][k];
+            if (j != QPU_ROUTE_NONE && r->seen[j] != r->stamp) {
+                r->seen[j] = r->stamp;
+                r->walk[tail++] = j;
+            }
+        }
+    }
+    return n;
+}
+
+// Mean operand distance of two-qubit records @set under the current placement
+static double qpu_route_spread(const qpu_route_ctx* r, const uint32_t* set, size_t n) {
+    double sum = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const nymya_op* op = &r->op[set[i]];
+        sum += qpu_dist(r, r->l2p[op->qubit[0]], r->l2p[op->qubit[1]]);
+    }
+    return n ? sum / (double)n : 0;
+}
+
+/**
+ * qpu_route_pick - Takes the SWAP that best serves the blocked front layer.
+ * @r: Context.
+ * @front: Front records, all two-qubit and blocked, @nfront of them.
+ * @ext: Look-ahead records, @next of them.
+ * @emit: Write the SWAP to the output.
+ */
+static void qpu_route_pick(qpu_route_ctx* r, const uint32_t* front, size_t nfront,
+                           const uint32_t* ext, size_t next, int emit) {
+    double best = HUGE_VAL;
+    uint32_t bp = 0, bq = 0;
+
+    for (size_t f = 0; f < nfront; f++) {
+        for (int k = 0; k < 2; k++) {
+            uint32_t p = r->l2p[r->op[front[f]].qubit[k]];
+
+            for (uint32_t e = r->adj_off[p]; e < r->adj_off[p + 1]; e++) {
+                uint32_t q = r->adj[e];
+                double score;
+
+                qpu_route_swap(r, p, q);
+                score = qpu_route_spread(r, front, nfront) +
+                        QPU_ROUTE_EXTENDED_WEIGHT * qpu_route_spread(r, ext, next);
+                score *= r->decay[p] > r->decay[q] ? r->decay[p] : r->decay[q];
+                qpu_route_swap(r, p, q);
+                if (score < best) {
+                    best = score;
+                    bp = p;
+                    bq = q;
+                }
+            }
+        }
+    }
+    r->decay[bp] += QPU_ROUTE_DECAY;
+    r->decay[bq] += QPU_ROUTE_DECAY;
+    qpu_route_put_swap(r, bp, bq, emit);
+}
+
+/**
+ * qpu_route_pass - Runs the circuit once over the placement in @r.
+ * @r: Context; the placement is updated to where the slots end up.
+ * @rev: Walk the records last to first.
+ * @emit: Write the routed records and SWAPs to the output.
+ *
+ * After more SWAPs than the device has qubits without a gate running, the
+ * first blocked gate is walked along a shortest path instead, so a pass
+ * always ends.
+ */
+static void qpu_route_pass(qpu_route_ctx* r, int rev, int emit) {
+    uint32_t (*next)[2] = rev ? r->pred : r->succ;
+    uint32_t (*prev)[2] = rev ? r->succ : r->pred;
+    uint32_t ext[QPU_ROUTE_EXTENDED];
+    size_t nfront = 0, stalled = 0, swaps = 0;
+
+    for (uint32_t p = 0; p < r->np; p++) r->decay[p] = 1.0;
+    for (size_t s = 0; s < r->n; s++) {
+        size_t i = rev ? r->n - 1 - s : s;
+
+        r->need[i] = 0;
+        for (int k = 0; k < r->arity[i]; k++) {
+            if (prev[i][k] != QPU_ROUTE_NONE) r->need[i]++;
+        }
+        if (!r->need[i]) r->front[nfront++] = (uint32_t)i;
+    }
+
+    while (nfront && !r->err) {
+        int ran = 0;
+
+        for (size_t f = 0; f < nfront;) {
+            uint32_t i = r->front[f];
+            const nymya_op* op = &r->op[i];
+
+            if (r->arity[i] == 2 && qpu_dist(r, r->l2p[op->qubit[0]], r->l2p[op->qubit[1]]) > 1) {
+                f++;
+                continue;
+            }
+            // Front records are independent, so their order is free
+            r->front[f] = r->front[--nfront];
+            if (emit) {
+                nymya_op out = *op;
+                for (int k = 0; k < r->arity[i]; k++) out.qubit[k] = r->l2p[op->qubit[k]];
+                qpu_route_put(r, &out);
+            }
+            for (int k = 0; k < r->arity[i]; k++) {
+                uint32_t j = next[i][k];
+                if (j != QPU_ROUTE_NONE && --r->need[j] == 0) r->front[nfront++] = j;
+            }
+            ran = 1;
+        }
+        if (ran) {
+            for (uint32_t p = 0; p < r->np; p++) r->decay[p] = 1.0;
+            stalled = 0;
+            continue;
+        }
+        if (!nfront) break;
+
+        if (++stalled > r->np) {
+            const nymya_op* op = &r->op[r->front[0]];
+            uint32_t p = r->l2p[op->qubit[0]], t = r->l2p[op->qubit[1]];
+
+            for (uint32_t e = r->adj_off[p]; e < r->adj_off[p + 1]; e++) {
+                if (qpu_dist(r, r->adj[e], t) < qpu_dist(r, p, t)) {
+                    qpu_route_put_swap(r, p, r->adj[e], emit);
+                    break;
+                }
+            }
+            continue;
+        }
+        qpu_route_pick(r, r->front, nfront, ext, qpu_route_ahead(r, r->front, nfront, next, ext), emit);
+        if (++swaps % QPU_ROUTE_DECAY_RESET == 0) {
+            for (uint32_t p = 0; p < r->np; p++) r->decay[p] = 1.0;
+        }
+    }
+}
+
+/**
+ * qpu_route - Places a request on a device's qubits and inserts SWAPs.
+ * @req: Request, its records on slots.
+ * @dev: Device; nothing is done without a coupling map.
+ * @out: Receives the routed records and final placement, owned by the caller.
+ *
+ * Requests without a two-qubit gate are left as they are, so single-qubit
+ * work such as the entropy prefetch keeps its physical qubits.
+ *
+ * Returns 0, or -1 after reporting why the request does not fit the device.
+ */
+int qpu_route(const nymya_qpu_request* req, const nymya_qpu_device* dev, qpu_routed* out) {
+    qpu_route_ctx r = { .out = out };
+    long n2;
+    int ret = -1;
+
+    *out = (qpu_routed){ 0 };
+    if (!dev->coupling || !dev->ncoupling) return 0;
+    n2 = qpu_route_circuit(&r, req);
+    if (n2 < 0) {
+        fprintf(stderr, "[QPU] Request cannot be routed: malformed records or out of memory.\n");
+        goto out;
+    }
+    if (!n2) {
+        ret = 0;
+        goto out;
+    }
+    if (qpu_route_device(&r, dev)) goto out;
+
+    r.l2p = malloc(r.nq * sizeof(*r.l2p));
+    r.p2l = malloc(r.np * sizeof(*r.p2l));
+    r.need = malloc(r.n * sizeof(*r.need));
+    r.front = malloc(r.n * sizeof(*r.front));
+    r.walk = malloc(r.n * sizeof(*r.walk));
+    r.seen = calloc(r.n, sizeof(*r.seen));
+    r.decay = malloc(r.np * sizeof(*r.decay));
+    if (!r.l2p || !r.p2l || !r.need || !r.front || !r.walk || !r.seen || !r.decay) goto out;
+    for (uint32_t q = 0; q < r.nq; q++) r.l2p[q] = QPU_ROUTE_NONE;
+    for (uint32_t p = 0; p < r.np; p++) r.p2l[p] = QPU_ROUTE_NONE;
+
+    switch (qpu_route_embed(&r)) {
+        case -1:
+            goto out;
+        case 0: {
+            uint32_t p = 0;
+
+            // Start anywhere; a forward and a backward pass settle the placement
+            for (uint32_t q = 0; q < r.nq; q++) {
+                while (!r.usable[p]) p++;
+                qpu_route_place(&r, q, p++);
+            }
+            qpu_route_pass(&r, 0, 0);
+            qpu_route_pass(&r, 1, 0);
+            break;
+        }
+        default: {
+            uint32_t p = 0;
+
+            // Slots without two-qubit gates take the free qubits left
+            for (uint32_t q = 0; q < r.nq; q++) {
+                if (r.l2p[q] != QPU_ROUTE_NONE) continue;
+                while (!r.usable[p] || r.p2l[p] != QPU_ROUTE_NONE) p++;
+                qpu_route_place(&r, q, p);
+            }
+        }
+    }
+    qpu_route_pass(&r, 0, 1);
+    if (r.err) goto out;
+    if (out->nops > NYMYA_SUBMIT_MAX_OPS) {
+        fprintf(stderr, "[QPU] Routed circuit of %zu records exceeds one submission.\n", out->nops);
+        goto out;
+    }
+    out->phys = r.l2p;
+    r.l2p = NULL;
+    ret = 0;
+out:
+    if (ret) {
+        free(out->ops);
+        *out = (qpu_routed){ 0 };
+    }
+    free(r.adj_off);
+    free(r.adj);
+    free(r.dist);
+    free(r.usable);
+    free(r.op);
+    free(r.arity);
+    free(r.succ);
+    free(r.pred);
+    free(r.l2p);
+    free(r.p2l);
+    free(r.need);
+    free(r.front);
+    free(r.walk);
+    free(r.seen);
+    free(r.decay);
+    qpu_native_seq_free(&r.seq);
+    return ret;
+}
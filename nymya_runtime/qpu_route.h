@@ -0,0 +1,28 @@
+#ifndef NYMYA_QPU_ROUTE_H
+#define NYMYA_QPU_ROUTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <nymya/nymya.h>
+#include "nymya_qpu.h"
+
+/**
+ * qpu_routed - A request placed on the physical qubits of a device.
+ * @ops: Records on physical qubits, SWAPs included.
+ * @nops: Number of records.
+ * @phys: Physical qubit each slot of the request ends on.
+ * @nswaps: SWAPs inserted.
+ */
+typedef struct qpu_routed {
+    nymya_op* ops;
+    size_t nops;
+    uint32_t* phys;
+    size_t nswaps;
+} qpu_routed;
+
+// Routes @req for the coupling map of @dev. Returns 0, with @out->ops NULL
+// when @req has no two-qubit gate or @dev no map, or -1 after reporting
+// why the request does not fit the device.
+int qpu_route(const nymya_qpu_request* req, const nymya_qpu_device* dev, qpu_routed* out);
+
+#endif // NYMYA_QPU_ROUTE_H
@@ -0,0 +1,327 @@
+// runtime/qpu_sched.c
+//
+// Tenant side of the QPU scheduler daemon (nymya_qpud.c). Processes that
+// share a QPU do not each attach its driver: nymya_qpu_use_scheduler()
+// attaches a stand-in device whose run() hands the request to the daemon
+// through the shared-memory queue of nymya_qpud.h and waits for its shots.
+// The job queue of nymya_job.c is unchanged above it, so circuits, circuit
+// files and their callbacks behave as with a local device, while the daemon
+// orders the jobs of all tenants and packs small ones into one submission.
+//
+// The helpers that map the queue and take its lock are shared with the
+// daemon.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "nymya_qpu.h"
+#include "nymya_qpud.h"
+
+// Requests a tenant keeps in the daemon's queue at once
+#define QPU_SCHED_INFLIGHT 16
+
+// How often a waiting tenant checks that the daemon is still there
+#define QPU_SCHED_POLL_MS 1000
+
+/**
+ * qpu_sched_client - The scheduler this process submits to.
+ * @shm: Mapped queue.
+ * @len: Length of the mapping.
+ * @priority: Priority of this process's jobs.
+ * @dev: Stand-in device attached to the job queue.
+ */
+typedef struct qpu_sched_client {
+    nymya_qpud_shm* shm;
+    size_t len;
+    int priority;
+    nymya_qpu_device dev;
+} qpu_sched_client;
+
+static qpu_sched_client qpu_sched;
+
+static size_t qpu_sched_page(void) {
+    long page = sysconf(_SC_PAGESIZE);
+
+    return page > 0 ? (size_t)page : 4096;
+}
+
+// Sets up the header of a new queue: process-shared, robust lock and conditions
+static int qpu_sched_init(nymya_qpud_shm* shm, size_t data_offset) {
+    pthread_mutexattr_t ma;
+    pthread_condattr_t ca;
+    int rc = 0;
+
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST);
+    pthread_condattr_init(&ca);
+    pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+
+    if (pthread_mutex_init(&shm->lock, &ma) || pthread_cond_init(&shm->work, &ca) ||
+        pthread_cond_init(&shm->space, &ca))
+        rc = -1;
+    for (unsigned int k = 0; !rc && k < NYMYA_QPUD_SLOTS; k++) {
+        if (pthread_cond_init(&shm->slots[k].done, &ca)) rc = -1;
+    }
+    pthread_condattr_destroy(&ca);
+    pthread_mutexattr_destroy(&ma);
+    if (rc) return -1;
+
+    shm->version = NYMYA_QPUD_VERSION;
+    shm->header_size = sizeof(*shm);
+    shm->daemon = (int32_t)getpid();
+    shm->nslots = NYMYA_QPUD_SLOTS;
+    shm->slot_bytes = NYMYA_QPUD_SLOT_BYTES;
+    shm->data_offset = data_offset;
+    // Tenants look at the magic first; it goes in once the rest is set
+    __atomic_store_n(&shm->magic, NYMYA_QPUD_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * qpu_sched_map - Maps the queue of a scheduler.
+ * @name: Shared memory object name, e.g. NYMYA_QPUD_DEFAULT_NAME.
+ * @create: Nonzero for the daemon, which replaces any stale object of that
+ *          name with a new, empty queue.
+ * @mode: Permissions of a new object; tenants need read and write access.
+ * @len: Receives the length of the mapping.
+ *
+ * Returns the queue, or NULL after reporting why it cannot be mapped.
+ */
+nymya_qpud_shm* qpu_sched_map(const char* name, int create, unsigned int mode, size_t* len) {
+    size_t page = qpu_sched_page();
+    size_t data_offset = (sizeof(nymya_qpud_shm) + page - 1) / page * page;
+    nymya_qpud_shm* shm;
+    struct stat st;
+    int fd;
+
+    if (create) {
+        shm_unlink(name);
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, mode);
+        if (fd >= 0 && fchmod(fd, mode)) {
+            close(fd);
+            fd = -1;
+        }
+        *len = data_offset + (size_t)NYMYA_QPUD_SLOTS * NYMYA_QPUD_SLOT_BYTES;
+        if (fd >= 0 && ftruncate(fd, (off_t)*len)) {
+            close(fd);
+            shm_unlink(name);
+            fd = -1;
+        }
+    } else {
+        fd = shm_open(name, O_RDWR, 0);
+        if (fd >= 0 && fstat(fd, &st)) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd >= 0) *len = (size_t)st.st_size;
+    }
+    if (fd < 0) {
+        fprintf(stderr, "[QPU] Cannot open scheduler queue %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    if (*len < sizeof(*shm)) {
+        close(fd);
+        fprintf(stderr, "[QPU] %s is not a scheduler queue.\n", name);
+        return NULL;
+    }
+
+    shm = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        fprintf(stderr, "[QPU] Cannot map scheduler queue %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+
+    if (create) {
+        if (qpu_sched_init(shm, data_offset) == 0) return shm;
+        fprintf(stderr, "[QPU] Cannot set up scheduler queue %s.\n", name);
+        munmap(shm, *len);
+        shm_unlink(name);
+        return NULL;
+    }
+    if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != NYMYA_QPUD_MAGIC ||
+        shm->version != NYMYA_QPUD_VERSION || shm->header_size != sizeof(*shm) ||
+        shm->nslots > NYMYA_QPUD_SLOTS ||
+        shm->data_offset + shm->nslots * shm->slot_bytes > *len) {
+        fprintf(stderr, "[QPU] %s is not a scheduler queue of this runtime version.\n", name);
+        munmap(shm, *len);
+        return NULL;
+    }
+    return shm;
+}
+
+// Takes the queue lock, recovering it from a process that died holding it
+void qpu_sched_lock(nymya_qpud_shm* shm) {
+    if (pthread_mutex_lock(&shm->lock) == EOWNERDEAD)
+        pthread_mutex_consistent(&shm->lock);
+}
+
+/**
+ * qpu_sched_timedwait - Waits on a condition of the queue for at most @ms.
+ * @cond: Condition in @shm.
+ * @shm: Queue, locked by the caller.
+ * @ms: Longest wait.
+ *
+ * Returns 0 if woken, ETIMEDOUT otherwise; the lock is held again either way.
+ */
+int qpu_sched_timedwait(pthread_cond_t* cond, nymya_qpud_shm* shm, unsigned int ms) {
+    struct timespec ts;
+    int rc;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    rc = pthread_cond_timedwait(cond, &shm->lock, &ts);
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&shm->lock);
+        rc = 0;
+    }
+    return rc;
+}
+
+static char* qpu_sched_data(nymya_qpud_shm* shm, unsigned int slot) {
+    return (char*)shm + shm->data_offset + (size_t)slot * shm->slot_bytes;
+}
+
+nymya_op* qpu_sched_ops(nymya_qpud_shm* shm, unsigned int slot) {
+    return (nymya_op*)qpu_sched_data(shm, slot);
+}
+
+uint64_t* qpu_sched_ids(nymya_qpud_shm* shm, unsigned int slot) {
+    return (uint64_t*)(qpu_sched_ops(shm, slot) + shm->slots[slot].nops);
+}
+
+uint64_t* qpu_sched_bits(nymya_qpud_shm* shm, unsigned int slot) {
+    return qpu_sched_ids(shm, slot) + shm->slots[slot].nqubits;
+}
+
+// Nonzero while process @pid exists, whoever owns it
+int qpu_sched_alive(int32_t pid) {
+    return pid > 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+}
+
+/**
+ * qpu_sched_run - run() of the stand-in device: one request through the daemon.
+ * @ctx: The qpu_sched_client.
+ * @conn: Unused; the queue needs no connection.
+ * @req: Request to run; its bits are filled on success.
+ *
+ * Waits for a free slot, queues the request in it and waits for the daemon
+ * to finish it. Called on the job queue's dispatcher threads, up to
+ * QPU_SCHED_INFLIGHT at a time.
+ *
+ * Returns 0, or -1 if the request does not fit a slot, the daemon failed
+ * it or the daemon went away.
+ */
+static int qpu_sched_run(void* ctx, void* conn, nymya_qpu_request* req) {
+    qpu_sched_client* cl = ctx;
+    nymya_qpud_shm* shm = cl->shm;
+    nymya_qpud_slot* s = NULL;
+    unsigned int k;
+    int rc;
+
+    (void)conn;
+    if (nymya_qpud_data_bytes(req->nops, req->nqubits, req->shots) > shm->slot_bytes) {
+        fprintf(stderr, "[QPU] Job of %zu gates on %zu qubits does not fit a scheduler slot.\n",
+                req->nops, req->nqubits);
+        return -1;
+    }
+
+    qpu_sched_lock(shm);
+    for (;;) {
+        for (k = 0; k < shm->nslots; k++) {
+            if (shm->slots[k].state == NYMYA_QPUD_FREE) {
+                s = &shm->slots[k];
+                break;
+            }
+        }
+        if (s) break;
+        if (!qpu_sched_alive(shm->daemon)) goto gone;
+        qpu_sched_timedwait(&shm->space, shm, QPU_SCHED_POLL_MS);
+    }
+
+    s->priority = cl->priority;
+    s->owner = (int32_t)getpid();
+    s->shots = req->shots;
+    s->nops = req->nops;
+    s->nqubits = req->nqubits;
+    s->words = req->words;
+    s->seq = shm->seq++;
+    memcpy(qpu_sched_ops(shm, k), req->ops, req->nops * sizeof(*req->ops));
+    memcpy(qpu_sched_ids(shm, k), req->ids, req->nqubits * sizeof(*req->ids));
+    s->state = NYMYA_QPUD_QUEUED;
+    pthread_cond_signal(&shm->work);
+
+    while (s->state == NYMYA_QPUD_QUEUED || s->state == NYMYA_QPUD_RUNNING) {
+        if (!qpu_sched_alive(shm->daemon)) {
+            s->state = NYMYA_QPUD_FREE;
+            goto gone;
+        }
+        qpu_sched_timedwait(&s->done, shm, QPU_SCHED_POLL_MS);
+    }
+    rc = s->state == NYMYA_QPUD_DONE ? 0 : -1;
+    if (!rc)
+        memcpy(req->bits, qpu_sched_bits(shm, k), (size_t)s->shots * s->words * sizeof(uint64_t));
+    s->state = NYMYA_QPUD_FREE;
+    pthread_cond_broadcast(&shm->space);
+    pthread_mutex_unlock(&shm->lock);
+    return rc;
+
+gone:
+    pthread_mutex_unlock(&shm->lock);
+    fprintf(stderr, "[QPU] The scheduler daemon is not running.\n");
+    return -1;
+}
+
+/**
+ * nymya_qpu_use_scheduler - Sends QPU jobs through the local scheduler daemon.
+ * @name: Shared memory object the daemon serves, or NULL for $NYMYA_QPUD,
+ *        or NYMYA_QPUD_DEFAULT_NAME if that is unset.
+ * @priority: Priority of this process's jobs; higher ones run first.
+ *
+ * Attaches a device that forwards every request to nymya_qpud, which runs
+ * the jobs of all its tenants on the one device it drives. Routing and
+ * retries happen in the daemon, for the device as a whole.
+ *
+ * Returns 0, or -1 if the queue cannot be mapped or a device cannot be
+ * attached now (see nymya_qpu_set_device()).
+ */
+int nymya_qpu_use_scheduler(const char* name, int priority) {
+    qpu_sched_client old = qpu_sched;
+    nymya_qpud_shm* shm;
+    size_t len;
+
+    if (!name) name = getenv("NYMYA_QPUD");
+    if (!name || !*name) name = NYMYA_QPUD_DEFAULT_NAME;
+    shm = qpu_sched_map(name, 0, 0, &len);
+    if (!shm) return -1;
+
+    // Detach first so no dispatcher still reads the old settings
+    if (nymya_qpu_set_device(NULL)) {
+        munmap(shm, len);
+        return -1;
+    }
+    qpu_sched.shm = shm;
+    qpu_sched.len = len;
+    qpu_sched.priority = priority;
+    memset(&qpu_sched.dev, 0, sizeof(qpu_sched.dev));
+    qpu_sched.dev.name = "nymya_qpud";
+    qpu_sched.dev.run = qpu_sched_run;
+    qpu_sched.dev.ctx = &qpu_sched;
+    qpu_sched.dev.max_inflight = QPU_SCHED_INFLIGHT;
+    nymya_qpu_set_device(&qpu_sched.dev);
+    if (old.shm) munmap(old.shm, old.len);
+    return 0;
+}
@@ -0,0 +1,415 @@
+// sim_ckpt.c
+//
+// Checkpoints of the state-vector register (format in nymya_ckpt.h). A save
+// writes a new file next to the target and renames it into place once it is
+// on disk, so a node killed mid-save still leaves the previous checkpoint
+// whole. The file is written with pwrite() rather than through a shared
+// mapping, because a full disk then fails the save instead of raising SIGBUS.
+//
+// A restore maps the file privately and hands the mapping to the register:
+// nothing is read up front, pages load as the first gates touch them and
+// are copied only when written. Many threads or processes warm-starting from
+// one prefix state share its page cache until their states diverge.
+//
+// Builds with NYMYA_WITH_ZSTD can store the amplitudes as independent zstd
+// frames, compressed and expanded by the sim_pool workers one frame each.
+// A compressed checkpoint costs a full decompression to restore.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <complex.h>
+#include "sim_ckpt.h"
+#include "sim_pool.h"
+#include "sim_mem.h"
+#include "nymya_rng.h"
+#ifdef NYMYA_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "checkpoints are mapped in place and need a little-endian host"
+#endif
+
+_Static_assert(NYMYA_RNG_STATE_WORDS <= NYMYA_CKPT_RNG_WORDS,
+               "checkpoint header must hold the generator state");
+
+// zstd level of compressed checkpoints; the fastest, since saves sit on the run's critical path
+#define SIM_CKPT_ZSTD_LEVEL 1
+
+// Alignment of a decompressed array, as sim_statevec.c aligns its own
+#define SIM_CKPT_AMP_ALIGN 64
+
+// Bytes of a register's amplitude array
+static size_t sim_ckpt_amp_bytes(uint64_t nqubits, uint32_t precision) {
+    size_t esz = precision == SIM_SV_DOUBLE ? sizeof(double complex) : sizeof(float complex);
+
+    return ((size_t)1 << nqubits) * esz;
+}
+
+// Writes all of @buf at @off, across short writes and signals
+static int sim_ckpt_pwrite(int fd, const void *buf, size_t n, uint64_t off) {
+    const char *p = buf;
+
+    while (n) {
+        ssize_t w = pwrite(fd, p, n > ((size_t)1 << 30) ? (size_t)1 << 30 : n, (off_t)off);
+
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        off += (uint64_t)w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+#ifdef NYMYA_WITH_ZSTD
+/**
+ * sim_ckpt_zjob - One batch of frames, one frame per worker.
+ * @src: Raw amplitude bytes of the register.
+ * @dst: Decompressed array (restore), or @nframes slots of @bound bytes (save).
+ * @raw: Bytes of @src, or of @dst on restore.
+ * @first: Index of the batch's first frame.
+ * @nframes: Frames in the batch.
+ * @bound: Slot size, ZSTD_compressBound(NYMYA_CKPT_FRAME).
+ * @csize: Compressed length of each frame of the batch (save), or each
+ *         frame of the file (restore).
+ * @cdata: Start of each compressed frame of the file (restore).
+ * @bad: Set by a worker whose frame failed.
+ */
+typedef struct sim_ckpt_zjob {
+    const char *src;
+    char *dst;
+    uint64_t raw;
+    uint64_t first;
+    unsigned int nframes;
+    size_t bound;
+    uint64_t *csize;
+    const char **cdata;
+    int bad;
+} sim_ckpt_zjob;
+
+// Raw length of frame @f of an array of @raw bytes
+static size_t sim_ckpt_frame_len(uint64_t raw, uint64_t f) {
+    uint64_t left = raw - f * NYMYA_CKPT_FRAME;
+
+    return (size_t)(left < NYMYA_CKPT_FRAME ? left : NYMYA_CKPT_FRAME);
+}
+
+static void sim_ckpt_compress_slice(void *ctx, unsigned int w, unsigned int nw) {
+    sim_ckpt_zjob *job = ctx;
+
+    for (unsigned int i = w; i < job->nframes; i += nw) {
+        uint64_t f = job->first + i;
+        size_t r = ZSTD_compress(job->dst + i * job->bound, job->bound,
+                                 job->src + f * NYMYA_CKPT_FRAME,
+                                 sim_ckpt_frame_len(job->raw, f), SIM_CKPT_ZSTD_LEVEL);
+
+        if (ZSTD_isError(r)) __atomic_store_n(&job->bad, 1, __ATOMIC_RELAXED);
+        job->csize[i] = r;
+    }
+}
+
+static void sim_ckpt_expand_slice(void *ctx, unsigned int w, unsigned int nw) {
+    sim_ckpt_zjob *job = ctx;
+
+    for (uint64_t f = w; f < job->nframes; f += nw) {
+        size_t len = sim_ckpt_frame_len(job->raw, f);
+        size_t r = ZSTD_decompress(job->dst + f * NYMYA_CKPT_FRAME, len,
+                                   job->cdata[f], (size_t)job->csize[f]);
+
+        if (r != len) __atomic_store_n(&job->bad, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * sim_ckpt_compress - Writes an amplitude array as zstd frames.
+ * @fd: Checkpoint file.
+ * @src: Amplitude bytes.
+ * @raw: Length of @src.
+ * @off: File offset of the first frame.
+ * @size: Receives the bytes written.
+ *
+ * The workers compress one batch of frames while nothing is written; the
+ * batch then goes out in frame order.
+ *
+ * Returns 0 on success, -1 on allocation, compression or write failure.
+ */
+static int sim_ckpt_compress(int fd, const void *src, uint64_t raw, uint64_t off, uint64_t *size) {
+    uint64_t frames = (raw + NYMYA_CKPT_FRAME - 1) / NYMYA_CKPT_FRAME;
+    unsigned int nw = sim_pool_threads();
+    sim_ckpt_zjob job = { .src = src, .raw = raw };
+    uint64_t pos = off;
+    int ret = -1;
+
+    if (nw > frames) nw = (unsigned int)frames;
+    if (!nw) nw = 1;
+    job.bound = ZSTD_compressBound(NYMYA_CKPT_FRAME);
+    job.dst = malloc(nw * job.bound);
+    job.csize = malloc(nw * sizeof(*job.csize));
+    if (!job.dst || !job.csize) goto out;
+
+    for (job.first = 0; job.first < frames; job.first += job.nframes) {
+        job.nframes = frames - job.first < nw ? (unsigned int)(frames - job.first) : nw;
+        sim_pool_run(job.nframes, sim_ckpt_compress_slice, &job);
+        if (job.bad) goto out;
+        for (unsigned int i = 0; i < job.nframes; i++) {
+            if (sim_ckpt_pwrite(fd, &job.csize[i], sizeof(uint64_t), pos) ||
+                sim_ckpt_pwrite(fd, job.dst + i * job.bound, job.csize[i], pos + sizeof(uint64_t)))
+                goto out;
+            pos += sizeof(uint64_t) + job.csize[i];
+        }
+    }
+    *size = pos - off;
+    ret = 0;
+
+out:
+    free(job.dst);
+    free(job.csize);
+    return ret;
+}
+
+/**
+ * sim_ckpt_expand - Decompresses the amplitudes of an opened checkpoint.
+ * @ck: Checkpoint with NYMYA_CKPT_ZSTD set.
+ * @raw: Bytes of the register's array.
+ * @map: Receives the mapping that holds the array, as sim_mem_alloc() returns it.
+ * @map_len: Receives the length of @map.
+ *
+ * Returns the array from sim_mem_alloc(), or NULL if a frame is truncated
+ * or corrupt, or memory runs out.
+ */
+static void *sim_ckpt_expand(const sim_ckpt *ck, size_t raw, void **map, size_t *map_len) {
+    uint64_t frames = (raw + NYMYA_CKPT_FRAME - 1) / NYMYA_CKPT_FRAME;
+    const char *p = (const char *)ck->map + ck->h.amps_offset;
+    uint64_t left = ck->h.amps_size;
+    sim_ckpt_zjob job = { .raw = raw, .nframes = (unsigned int)frames };
+    void *amp = NULL;
+
+    job.csize = malloc((frames ? frames : 1) * sizeof(*job.csize));
+    job.cdata = malloc((frames ? frames : 1) * sizeof(*job.cdata));
+    if (!job.csize || !job.cdata) goto out;
+    for (uint64_t f = 0; f < frames; f++) {
+        if (left < sizeof(uint64_t)) goto out;
+        memcpy(&job.csize[f], p, sizeof(uint64_t));
+        p += sizeof(uint64_t);
+        left -= sizeof(uint64_t);
+        if (job.csize[f] > left) goto out;
+        job.cdata[f] = p;
+        p += job.csize[f];
+        left -= job.csize[f];
+    }
+
+    amp = sim_mem_alloc(raw, SIM_CKPT_AMP_ALIGN, map, map_len);
+    if (!amp) goto out;
+    job.dst = amp;
+    sim_pool_run(frames < sim_pool_threads() ? (unsigned int)frames : sim_pool_threads(),
+                 sim_ckpt_expand_slice, &job);
+    if (job.bad) {
+        sim_mem_release(amp, *map, *map_len);
+        amp = NULL;
+    }
+
+out:
+    free(job.csize);
+    free(job.cdata);
+    return amp;
+}
+#endif
+
+/**
+ * sim_ckpt_save - Writes a register and the thread's generator to a checkpoint.
+ * @sv: Register, with no gates pending.
+ * @path: File to create or replace.
+ * @position: Caller's position in its circuit, stored as given.
+ * @flags: NYMYA_CKPT_ZSTD to compress; ignored, with a message, in builds
+ *         without zstd.
+ *
+ * Returns 0 on success, -1 if the file cannot be written (@path is then
+ * left as it was).
+ */
+int sim_ckpt_save(const sim_sv *sv, const char *path, uint64_t position, unsigned int flags) {
+    static unsigned int seq;
+    nymya_ckpt_header h = { 0 };
+    size_t raw = sim_ckpt_amp_bytes(sv->nqubits, sv->precision);
+    char *tmp;
+    int fd, err, ret = -1;
+
+    if (!path) return -1;
+#ifndef NYMYA_WITH_ZSTD
+    if (flags & NYMYA_CKPT_ZSTD) {
+        fprintf(stderr, "[sim backend] Checkpoint compression needs a build with ZSTD=1; "
+                "%s is written uncompressed.\n", path);
+        flags &= ~NYMYA_CKPT_ZSTD;
+    }
+#endif
+    h.magic = NYMYA_CKPT_MAGIC;
+    h.version = NYMYA_CKPT_VERSION;
+    h.header_size = sizeof(h);
+    h.flags = flags & NYMYA_CKPT_ZSTD;
+    h.precision = sv->precision;
+    h.nqubits = sv->nqubits;
+    h.position = position;
+    h.rng_words = NYMYA_RNG_STATE_WORDS;
+    nymya_rng_save(h.rng);
+    h.ids_offset = sizeof(h);
+    h.amps_offset = (h.ids_offset + sv->nqubits * sizeof(uint64_t) + NYMYA_CKPT_ALIGN - 1) &
+                    ~(uint64_t)(NYMYA_CKPT_ALIGN - 1);
+    h.amps_size = raw;
+
+    tmp = malloc(strlen(path) + 32);
+    if (!tmp) return -1;
+    sprintf(tmp, "%s.%ld.%u.tmp", path, (long)getpid(),
+            __atomic_fetch_add(&seq, 1, __ATOMIC_RELAXED));
+    fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "[sim backend] Cannot create checkpoint file %s.\n", tmp);
+        free(tmp);
+        return -1;
+    }
+
+    if (sim_ckpt_pwrite(fd, sv->ids, sv->nqubits * sizeof(uint64_t), h.ids_offset))
+        goto out;
+#ifdef NYMYA_WITH_ZSTD
+    if (h.flags & NYMYA_CKPT_ZSTD)
+        err = sim_ckpt_compress(fd, sv->amp, raw, h.amps_offset, &h.amps_size);
+    else
+#endif
+        err = sim_ckpt_pwrite(fd, sv->amp, raw, h.amps_offset);
+    if (err) goto out;
+    // The header goes last, so a file cut short never looks complete
+    if (sim_ckpt_pwrite(fd, &h, sizeof(h), 0) || fsync(fd)) goto out;
+    ret = 0;
+
+out:
+    if (close(fd)) ret = -1;
+    if (!ret && rename(tmp, path)) ret = -1;
+    if (ret) {
+        fprintf(stderr, "[sim backend] Failed to write checkpoint file %s.\n", path);
+        unlink(tmp);
+    }
+    free(tmp);
+    return ret;
+}
+
+// Table of @count @size-byte entries at @off lies inside a file of @len bytes, aligned
+static int sim_ckpt_table_ok(uint64_t off, uint64_t count, size_t size, size_t len) {
+    return off % 8 == 0 && off <= len && count <= (len - off) / size;
+}
+
+/**
+ * sim_ckpt_open - Maps a checkpoint file and checks its header.
+ * @ck: Receives the opened file.
+ * @path: File written by sim_ckpt_save().
+ *
+ * Returns 0 on success, -1 if the file cannot be read, is not a checkpoint
+ * of a known version, or is compressed and this build has no zstd.
+ */
+int sim_ckpt_open(sim_ckpt *ck, const char *path) {
+    const nymya_ckpt_header *h;
+    unsigned int known = 0;
+    struct stat st;
+    int fd, ok;
+
+    memset(ck, 0, sizeof(*ck));
+    if (!path) return -1;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) || (size_t)st.st_size < sizeof(*h)) {
+        fprintf(stderr, "[sim backend] Cannot read checkpoint file %s.\n", path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    // Private and writable: the register keeps working in the mapping
+    ck->len = (size_t)st.st_size;
+    ck->map = mmap(NULL, ck->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ck->map == MAP_FAILED) {
+        ck->map = NULL;
+        return -1;
+    }
+
+#ifdef NYMYA_WITH_ZSTD
+    known = NYMYA_CKPT_ZSTD;
+#endif
+    h = ck->map;
+    ok = h->magic == NYMYA_CKPT_MAGIC && h->version == NYMYA_CKPT_VERSION &&
+         h->header_size >= sizeof(*h) && !(h->flags & ~NYMYA_CKPT_ZSTD) &&
+         h->precision <= SIM_SV_MIXED && h->nqubits <= SIM_SV_MAX_QUBITS &&
+         h->rng_words <= NYMYA_CKPT_RNG_WORDS &&
+         sim_ckpt_table_ok(h->ids_offset, h->nqubits, sizeof(uint64_t), ck->len) &&
+         h->amps_offset % NYMYA_CKPT_ALIGN == 0 && h->amps_offset <= ck->len &&
+         h->amps_size <= ck->len - h->amps_offset &&
+         ((h->flags & NYMYA_CKPT_ZSTD) ||
+          h->amps_size == sim_ckpt_amp_bytes(h->nqubits, h->precision));
+    for (uint64_t i = 0; ok && i < h->nqubits; i++) {
+        const uint64_t *ids = (const uint64_t *)((const char *)ck->map + h->ids_offset);
+
+        for (uint64_t j = 0; j < i; j++)
+            ok &= ids[i] != ids[j];
+    }
+    if (!ok) {
+        fprintf(stderr, "[sim backend] %s is not a version %d checkpoint file.\n",
+                path, NYMYA_CKPT_VERSION);
+        sim_ckpt_close(ck);
+        return -1;
+    }
+    if (h->flags & ~known) {
+        fprintf(stderr, "[sim backend] %s is compressed; restoring it needs a build with "
+                "ZSTD=1.\n", path);
+        sim_ckpt_close(ck);
+        return -1;
+    }
+    ck->h = *h;
+    ck->ids = (const uint64_t *)((const char *)ck->map + h->ids_offset);
+    return 0;
+}
+
+/**
+ * sim_ckpt_take - Makes a register the state of an opened checkpoint.
+ * @ck: Checkpoint; an uncompressed one hands its mapping to @sv.
+ * @sv: Initialised register; its amplitudes are replaced.
+ *
+ * @ck may only be closed afterwards.
+ *
+ * Returns 0 on success, -1 if the amplitudes cannot be decompressed (@sv
+ * is then unchanged).
+ */
+int sim_ckpt_take(sim_ckpt *ck, sim_sv *sv) {
+    size_t raw = sim_ckpt_amp_bytes(ck->h.nqubits, ck->h.precision);
+    char *amp = (char *)ck->map + ck->h.amps_offset;
+
+#ifdef NYMYA_WITH_ZSTD
+    if (ck->h.flags & NYMYA_CKPT_ZSTD) {
+        void *map;
+        size_t map_len;
+
+        amp = sim_ckpt_expand(ck, raw, &map, &map_len);
+        if (!amp) return -1;
+        sim_sv_adopt(sv, amp, map, map_len);
+    } else
+#endif
+    {
+        // Start reading ahead, but let the gates fault the pages in
+        madvise(amp, raw, MADV_WILLNEED);
+        sim_sv_adopt(sv, amp, ck->map, ck->len);
+        ck->map = NULL;
+    }
+    memset(sv->ids, 0, sizeof(sv->ids));
+    memcpy(sv->ids, ck->ids, ck->h.nqubits * sizeof(uint64_t));
+    sv->dim = (size_t)1 << ck->h.nqubits;
+    sv->nqubits = (unsigned int)ck->h.nqubits;
+    sv->precision = (sim_sv_precision)ck->h.precision;
+    return 0;
+}
+
+void sim_ckpt_close(sim_ckpt *ck) {
+    if (ck->map) munmap(ck->map, ck->len);
+    ck->map = NULL;
+}
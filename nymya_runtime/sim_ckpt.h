@@ -0,0 +1,29 @@
+#ifndef NYMYA_SIM_CKPT_H
+#define NYMYA_SIM_CKPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sim_statevec.h"
+#include "nymya_ckpt.h"
+
+/**
+ * sim_ckpt - An opened checkpoint file.
+ * @h: Copy of its header.
+ * @ids: Qubit ID table inside @map.
+ * @map: Private writable mapping of the whole file, or NULL once the
+ *       register took it over.
+ * @len: Length of @map.
+ */
+typedef struct sim_ckpt {
+    nymya_ckpt_header h;
+    const uint64_t *ids;
+    void *map;
+    size_t len;
+} sim_ckpt;
+
+int sim_ckpt_save(const sim_sv *sv, const char *path, uint64_t position, unsigned int flags);
+int sim_ckpt_open(sim_ckpt *ck, const char *path);
+int sim_ckpt_take(sim_ckpt *ck, sim_sv *sv);
+void sim_ckpt_close(sim_ckpt *ck);
+
+#endif // NYMYA_SIM_CKPT_H
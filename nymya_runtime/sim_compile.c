@@ -0,0 +1,501 @@
+// sim_compile.c
+//
+// Compiled form of a circuit for the state-vector engine. A circuit is first
+// lowered to dense 1-, 2- and 3-qubit gates (sim_ops). sim_plan_build() then
+// works out, once per circuit structure, how those gates fuse: which gates are
+// multiplied into which 2x2 or 4x4 block, and when each block is applied. The
+// plan depends only on gate shapes and qubit IDs, not on the matrices, so a
+// cached plan replays for any parameter values of the same circuit.
+//
+// Unlike the streaming buffer in sim_fuse.c, a plan sees the whole circuit and
+// keeps one open block per qubit, so fusion on disjoint pairs never forces a
+// block out early.
+
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include "sim_compile.h"
+#include "sim_fuse.h"
+
+typedef enum {
+    SIM_I_OPEN1,     // block = op
+    SIM_I_OPEN2,     // block = op * (hi (x) lo), hi/lo: absorbed 1-qubit blocks or identity
+    SIM_I_ACC1,      // 2x2 block = op * block
+    SIM_I_ACC_HI,    // 4x4 block = (op (x) I) * block
+    SIM_I_ACC_LO,    // 4x4 block = (I (x) op) * block
+    SIM_I_ACC2,      // 4x4 block = op * block
+    SIM_I_ACC2_SWAP, // 4x4 block = op, targets reversed, * block
+    SIM_I_APPLY,     // apply block to the register
+    SIM_I_APPLY3,    // apply a 3-qubit op directly
+    SIM_I_PASS       // run the op's circuit node on the backend
+} sim_instr_kind;
+
+/**
+ * sim_instr - One step of a plan.
+ * @kind: sim_instr_kind.
+ * @block: Block the step writes or applies.
+ * @op: Lowered gate the step reads.
+ * @hi: For SIM_I_OPEN2, the 1-qubit block absorbed on the high slot, or -1.
+ * @lo: For SIM_I_OPEN2, the 1-qubit block absorbed on the low slot, or -1.
+ */
+typedef struct sim_instr {
+    uint32_t kind;
+    uint32_t block;
+    uint32_t op;
+    int32_t hi;
+    int32_t lo;
+} sim_instr;
+
+/**
+ * sim_block - A fused gate of a plan.
+ * @k: 1 or 2 targets.
+ * @ids: Qubit IDs of the targets; ids[0] is the high index bit.
+ */
+typedef struct sim_block {
+    unsigned int k;
+    uint64_t ids[2];
+} sim_block;
+
+/**
+ * sim_plan - Fusion schedule of one circuit structure.
+ * @code: Steps in execution order.
+ * @ncode: Number of steps.
+ * @blocks: Fused gates.
+ * @nblocks: Number of blocks.
+ * @nops: Number of lowered gates the plan was built for.
+ * @op_k: Target count of every lowered gate, checked before a run.
+ */
+struct sim_plan {
+    sim_instr* code;
+    size_t ncode;
+    sim_block* blocks;
+    size_t nblocks;
+    size_t nops;
+    unsigned char* op_k;
+};
+
+/**
+ * sim_ops_push - Appends a lowered gate.
+ * @ops: List.
+ * @k: Number of targets, or 0 for a pass-through node (@ids and @m unused).
+ * @ids: @k qubit IDs.
+ * @m: Row-major 2^k x 2^k matrix.
+ * @node: Circuit node the gate came from.
+ *
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int sim_ops_push(sim_ops* ops, unsigned int k, const uint64_t* ids,
+                 const double complex* m, size_t node) {
+    size_t dim = k ? (size_t)1 << (2 * k) : 0;
+    sim_op* op;
+
+    if (ops->count == ops->cap) {
+        size_t cap = ops->cap ? ops->cap * 2 : 64;
+        sim_op* p = realloc(ops->ops, cap * sizeof(*p));
+
+        if (!p) return -1;
+        ops->ops = p;
+        ops->cap = cap;
+    }
+    if (ops->nmats + dim > ops->mats_cap) {
+        size_t cap = ops->mats_cap ? ops->mats_cap : 1024;
+        double complex* p;
+
+        while (cap < ops->nmats + dim) cap *= 2;
+        p = realloc(ops->mats, cap * sizeof(*p));
+        if (!p) return -1;
+        ops->mats = p;
+        ops->mats_cap = cap;
+    }
+
+    op = &ops->ops[ops->count++];
+    memset(op, 0, sizeof(*op));
+    op->k = k;
+    op->node = node;
+    op->m = ops->nmats;
+    if (k) {
+        memcpy(op->ids, ids, k * sizeof(*ids));
+        memcpy(ops->mats + ops->nmats, m, dim * sizeof(*m));
+        ops->nmats += dim;
+    }
+    return 0;
+}
+
+/**
+ * sim_ops_free - Releases a lowered circuit.
+ * @ops: List; left empty.
+ */
+void sim_ops_free(sim_ops* ops) {
+    free(ops->ops);
+    free(ops->mats);
+    memset(ops, 0, sizeof(*ops));
+}
+
+/**
+ * sim_plan_free - Releases a plan.
+ * @plan: Plan; may be NULL.
+ */
+void sim_plan_free(void* plan) {
+    sim_plan* p = plan;
+
+    if (!p) return;
+    free(p->code);
+    free(p->blocks);
+    free(p->op_k);
+    free(p);
+}
+
+/**
+ * sim_open_map - Open block of each qubit ID during plan construction.
+ * @key: Qubit IDs.
+ * @val: Open block of the ID, or -1.
+ * @used: Non-zero where @key is valid.
+ * @mask: Table size - 1.
+ */
+typedef struct sim_open_map {
+    uint64_t* key;
+    int32_t* val;
+    unsigned char* used;
+    size_t mask;
+} sim_open_map;
+
+static int32_t* sim_open_slot(sim_open_map* map, uint64_t id) {
+    size_t i = (size_t)(id * 0x9E3779B97F4A7C15ull) & map->mask;
+
+    while (map->used[i] && map->key[i] != id)
+        i = (i + 1) & map->mask;
+    if (!map->used[i]) {
+        map->used[i] = 1;
+        map->key[i] = id;
+        map->val[i] = -1;
+    }
+    return &map->val[i];
+}
+
+/**
+ * sim_plan_builder - State of sim_plan_build().
+ * @plan: Plan being built.
+ * @open: Open block per qubit ID.
+ * @is_open: Per block, non-zero until it is applied or absorbed.
+ */
+typedef struct sim_plan_builder {
+    sim_plan* plan;
+    sim_open_map open;
+    unsigned char* is_open;
+} sim_plan_builder;
+
+static void sim_emit(sim_plan_builder* b, uint32_t kind, uint32_t block, uint32_t op,
+                     int32_t hi, int32_t lo) {
+    sim_instr* in = &b->plan->code[b->plan->ncode++];
+
+    in->kind = kind;
+    in->block = block;
+    in->op = op;
+    in->hi = hi;
+    in->lo = lo;
+}
+
+// Marks a block as no longer open, clearing it from its qubits
+static void sim_retire(sim_plan_builder* b, int32_t blk) {
+    const sim_block* bl = &b->plan->blocks[blk];
+
+    for (unsigned int i = 0; i < bl->k; i++)
+        *sim_open_slot(&b->open, bl->ids[i]) = -1;
+    b->is_open[blk] = 0;
+}
+
+static void sim_close(sim_plan_builder* b, int32_t blk) {
+    if (blk < 0 || !b->is_open[blk]) return;
+    sim_emit(b, SIM_I_APPLY, (uint32_t)blk, 0, -1, -1);
+    sim_retire(b, blk);
+}
+
+static int32_t sim_new_block(sim_plan_builder* b, unsigned int k, const uint64_t* ids) {
+    int32_t blk = (int32_t)b->plan->nblocks++;
+    sim_block* bl = &b->plan->blocks[blk];
+
+    bl->k = k;
+    bl->ids[0] = ids[0];
+    bl->ids[1] = k > 1 ? ids[1] : 0;
+    for (unsigned int i = 0; i < k; i++)
+        *sim_open_slot(&b->open, ids[i]) = blk;
+    b->is_open[blk] = 1;
+    return blk;
+}
+
+/**
+ * sim_plan_bytes - Peak memory sim_plan_build() and one run of its plan take.
+ * @ops: Lowered circuit.
+ *
+ * An upper bound from the gate count alone: the plan, the builder's tables
+ * and the fused blocks a run keeps, as if every gate opened its own block.
+ */
+size_t sim_plan_bytes(const sim_ops* ops) {
+    size_t n = ops->count, cap = 16;
+
+    while (cap < 6 * n + 2) cap *= 2;
+    return sizeof(sim_plan) + (3 * n + 1) * sizeof(sim_instr) + (n + 1) * sizeof(sim_block) +
+           2 * (n + 1) + cap * (sizeof(uint64_t) + sizeof(int32_t) + 1) +
+           (n + 1) * 16 * sizeof(double complex);
+}
+
+/**
+ * sim_plan_build - Builds the fusion schedule of a lowered circuit.
+ * @ops: Lowered circuit; only gate shapes and qubit IDs are read.
+ * @bytes: Receives the memory held by the plan.
+ *
+ * Each qubit has at most one open block. A 1-qubit gate joins the open block
+ * of its qubit, or opens a 1-qubit block. A 2-qubit gate joins the open block
+ * of its pair, or opens a 2-qubit block that absorbs the open 1-qubit blocks
+ * of both qubits and applies any other open block on them first. Three-qubit
+ * gates and pass-through nodes apply the open blocks they depend on and then
+ * run unfused. Open blocks on disjoint qubits commute, so the blocks still
+ * open at the end are applied in creation order.
+ *
+ * Returns the plan, or NULL on allocation failure.
+ */
+sim_plan* sim_plan_build(const sim_ops* ops, size_t* bytes) {
+    sim_plan_builder b = { 0 };
+    size_t n = ops->count, cap = 16;
+    sim_plan* plan = calloc(1, sizeof(*plan));
+
+    if (!plan) return NULL;
+    while (cap < 6 * n + 2) cap *= 2;
+
+    // Each gate emits one step and opens at most one block; each block is applied once
+    plan->code = malloc((3 * n + 1) * sizeof(*plan->code));
+    plan->blocks = malloc((n + 1) * sizeof(*plan->blocks));
+    plan->op_k = malloc(n + 1);
+    b.is_open = calloc(n + 1, 1);
+    b.open.key = malloc(cap * sizeof(*b.open.key));
+    b.open.val = malloc(cap * sizeof(*b.open.val));
+    b.open.used = calloc(cap, 1);
+    b.open.mask = cap - 1;
+    b.plan = plan;
+    if (!plan->code || !plan->blocks || !plan->op_k || !b.is_open ||
+        !b.open.key || !b.open.val || !b.open.used) {
+        sim_plan_free(plan);
+        plan = NULL;
+        goto out;
+    }
+    plan->nops = n;
+
+    for (size_t i = 0; i < n; i++) {
+        const sim_op* op = &ops->ops[i];
+
+        plan->op_k[i] = (unsigned char)op->k;
+
+        if (op->k == 0) {
+            // Pass-through nodes see the state as if nothing were deferred
+            for (size_t blk = 0; blk < plan->nblocks; blk++)
+                sim_close(&b, (int32_t)blk);
+            sim_emit(&b, SIM_I_PASS, 0, (uint32_t)i, -1, -1);
+        } else if (op->k == 1) {
+            int32_t blk = *sim_open_slot(&b.open, op->ids[0]);
+
+            if (blk < 0) {
+                blk = sim_new_block(&b, 1, op->ids);
+                sim_emit(&b, SIM_I_OPEN1, (uint32_t)blk, (uint32_t)i, -1, -1);
+            } else if (plan->blocks[blk].k == 1) {
+                sim_emit(&b, SIM_I_ACC1, (uint32_t)blk, (uint32_t)i, -1, -1);
+            } else {
+                sim_emit(&b, plan->blocks[blk].ids[0] == op->ids[0] ? SIM_I_ACC_HI : SIM_I_ACC_LO,
+                         (uint32_t)blk, (uint32_t)i, -1, -1);
+            }
+        } else if (op->k == 2) {
+            int32_t ba = *sim_open_slot(&b.open, op->ids[0]);
+            int32_t bb = *sim_open_slot(&b.open, op->ids[1]);
+            int32_t hi = -1, lo = -1, blk;
+
+            if (ba >= 0 && ba == bb) {
+                sim_emit(&b, plan->blocks[ba].ids[0] == op->ids[0] ? SIM_I_ACC2 : SIM_I_ACC2_SWAP,
+                         (uint32_t)ba, (uint32_t)i, -1, -1);
+                continue;
+            }
+            if (ba >= 0 && plan->blocks[ba].k == 1) { hi = ba; sim_retire(&b, ba); } else sim_close(&b, ba);
+            if (bb >= 0 && plan->blocks[bb].k == 1) { lo = bb; sim_retire(&b, bb); } else sim_close(&b, bb);
+
+            blk = sim_new_block(&b, 2, op->ids);
+            sim_emit(&b, SIM_I_OPEN2, (uint32_t)blk, (uint32_t)i, hi, lo);
+        } else {
+            for (unsigned int t = 0; t < 3; t++)
+                sim_close(&b, *sim_open_slot(&b.open, op->ids[t]));
+            sim_emit(&b, SIM_I_APPLY3, 0, (uint32_t)i, -1, -1);
+        }
+    }
+    for (size_t blk = 0; blk < plan->nblocks; blk++)
+        sim_close(&b, (int32_t)blk);
+
+    if (bytes)
+        *bytes = sizeof(*plan) + (3 * n + 1) * sizeof(*plan->code) +
+                 (n + 1) * sizeof(*plan->blocks) + n + 1;
+
+out:
+    free(b.is_open);
+    free(b.open.key);
+    free(b.open.val);
+    free(b.open.used);
+    return plan;
+}
+
+// Receives each fused gate of a plan (k 0 is a pass-through node)
+typedef int (*sim_emit_fn)(void* ctx, unsigned int k, const uint64_t* ids,
+                           const double complex* m, size_t node);
+
+/**
+ * sim_plan_walk - Accumulates the fused matrices of a plan and hands them out.
+ * @plan: Plan built for a circuit of the same structure.
+ * @ops: The circuit lowered with the current parameters.
+ * @emit: Called for every fused gate and pass-through node, in order.
+ * @ctx: Context for @emit.
+ *
+ * Returns 0 on success, -1 if @ops does not match @plan or memory runs out;
+ * otherwise the first failure of @emit.
+ */
+static int sim_plan_walk(const sim_plan* plan, const sim_ops* ops,
+                         sim_emit_fn emit, void* ctx) {
+    double complex (*B)[16];
+    double complex tmp[16];
+    int ret = 0;
+
+    if (ops->count != plan->nops) return -1;
+    for (size_t i = 0; i < ops->count; i++) {
+        if (ops->ops[i].k != plan->op_k[i]) return -1;
+    }
+
+    B = malloc((plan->nblocks + 1) * sizeof(*B));
+    if (!B) return -1;
+
+    for (size_t pc = 0; pc < plan->ncode && !ret; pc++) {
+        const sim_instr* in = &plan->code[pc];
+        const sim_op* op = &ops->ops[in->op];
+        const double complex* m = ops->mats + op->m;
+        double complex* blk = B[in->block];
+
+        switch (in->kind) {
+            case SIM_I_OPEN1:
+                memcpy(blk, m, 4 * sizeof(*m));
+                break;
+            case SIM_I_OPEN2:
+                sim_fuse_kron(tmp, in->hi >= 0 ? B[in->hi] : NULL, in->lo >= 0 ? B[in->lo] : NULL);
+                sim_fuse_mul(blk, m, tmp, 4);
+                break;
+            case SIM_I_ACC1:
+                sim_fuse_lmul(blk, m, 2);
+                break;
+            case SIM_I_ACC_HI:
+            case SIM_I_ACC_LO:
+                sim_fuse_kron(tmp, in->kind == SIM_I_ACC_HI ? m : NULL, in->kind == SIM_I_ACC_LO ? m : NULL);
+                sim_fuse_lmul(blk, tmp, 4);
+                break;
+            case SIM_I_ACC2:
+                sim_fuse_lmul(blk, m, 4);
+                break;
+            case SIM_I_ACC2_SWAP:
+                sim_fuse_swap_order(tmp, m);
+                sim_fuse_lmul(blk, tmp, 4);
+                break;
+            case SIM_I_APPLY: {
+                const sim_block* bl = &plan->blocks[in->block];
+
+                ret = emit(ctx, bl->k, bl->ids, blk, op->node);
+                break;
+            }
+            case SIM_I_APPLY3:
+                ret = emit(ctx, 3, op->ids, m, op->node);
+                break;
+            case SIM_I_PASS:
+                ret = emit(ctx, 0, op->ids, NULL, op->node);
+                break;
+        }
+    }
+
+    free(B);
+    return ret;
+}
+
+/**
+ * sim_run_ctx - State of sim_plan_run().
+ * @sv: Register.
+ * @pass: Runs pass-through nodes.
+ * @ctx: Context for @pass.
+ * @diag: Fused gates that came out diagonal, not yet applied.
+ */
+typedef struct sim_run_ctx {
+    sim_sv* sv;
+    sim_pass_fn pass;
+    void* ctx;
+    sim_fuse_diag diag;
+} sim_run_ctx;
+
+static int sim_run_emit(void* ctx, unsigned int k, const uint64_t* ids,
+                        const double complex* m, size_t node) {
+    sim_run_ctx* r = ctx;
+    int t[3] = { 0, 0, 0 };
+    uint32_t slots = 0;
+    double complex d[4];
+
+    if (k == 0) return sim_fuse_diag_flush(&r->diag, r->sv) ? -1 : r->pass(r->ctx, node);
+    for (unsigned int i = 0; i < k; i++) {
+        t[i] = sim_sv_qubit(r->sv, ids[i]);
+        if (t[i] < 0) return -1;
+        slots |= 1u << t[i];
+    }
+    if (k < 3 && sim_fuse_diagonal(m, k, d))
+        return sim_fuse_diag_add(&r->diag, r->sv, k, (unsigned int[]){ t[0], t[1] }, d);
+    // Diagonal blocks on other qubits commute with this one and stay pending
+    if ((r->diag.slots & slots) && sim_fuse_diag_flush(&r->diag, r->sv)) return -1;
+    if (k == 1) return sim_sv_apply1(r->sv, t[0], m);
+    if (k == 2) return sim_sv_apply2(r->sv, t[0], t[1], m);
+    return sim_sv_apply3(r->sv, t[0], t[1], t[2], m);
+}
+
+/**
+ * sim_plan_run - Executes a plan with the matrices of a lowered circuit.
+ * @plan: Plan built for a circuit of the same structure.
+ * @ops: The circuit lowered with the current parameters.
+ * @sv: Register; qubits join it on first use.
+ * @pass: Runs pass-through nodes.
+ * @ctx: Context for @pass.
+ *
+ * Fused blocks whose matrix is diagonal (phase and ZZ layers) are collected
+ * and applied together in one sweep, as in sim_fuse.c.
+ *
+ * Returns 0 on success, -1 if @ops does not match @plan, a qubit cannot join
+ * the register, or memory runs out; otherwise the first failure of @pass.
+ */
+int sim_plan_run(const sim_plan* plan, const sim_ops* ops, sim_sv* sv,
+                 sim_pass_fn pass, void* ctx) {
+    sim_run_ctx* r = malloc(sizeof(*r));
+    int ret;
+
+    if (!r) return -1;
+    r->sv = sv;
+    r->pass = pass;
+    r->ctx = ctx;
+    r->diag.slots = 0;
+    r->diag.count = 0;
+    ret = sim_plan_walk(plan, ops, sim_run_emit, r);
+    if (!ret) ret = sim_fuse_diag_flush(&r->diag, sv);
+    free(r);
+    return ret;
+}
+
+static int sim_lower_emit(void* ctx, unsigned int k, const uint64_t* ids,
+                          const double complex* m, size_t node) {
+    return sim_ops_push(ctx, k, ids, m, node);
+}
+
+/**
+ * sim_plan_lower - Writes the fused gates of a plan out as a new gate list.
+ * @plan: Plan built for a circuit of the same structure.
+ * @ops: The circuit lowered with the current parameters.
+ * @out: Receives the fused gates; pass-through nodes keep k 0.
+ *
+ * For backends that run the fused gates somewhere other than a host sim_sv.
+ *
+ * Returns 0 on success, -1 if @ops does not match @plan or memory runs out.
+ */
+int sim_plan_lower(const sim_plan* plan, const sim_ops* ops, sim_ops* out) {
+    return sim_plan_walk(plan, ops, sim_lower_emit, out);
+}
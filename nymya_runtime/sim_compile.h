@@ -0,0 +1,57 @@
+#ifndef NYMYA_SIM_COMPILE_H
+#define NYMYA_SIM_COMPILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex.h>
+#include "sim_statevec.h"
+
+/**
+ * sim_op - One dense gate of a lowered circuit.
+ * @k: Number of targets (1 to 3), or 0 for a node the backend runs as is.
+ * @ids: Qubit IDs of the targets; ids[0] is the high index bit.
+ * @node: Circuit node the gate was lowered from.
+ * @m: Offset of the row-major matrix in sim_ops.mats.
+ */
+typedef struct sim_op {
+    unsigned int k;
+    uint64_t ids[3];
+    size_t node;
+    size_t m;
+} sim_op;
+
+/**
+ * sim_ops - A circuit lowered to dense gates, with its parameters bound.
+ * @ops: Gates in circuit order.
+ * @count: Number of gates.
+ * @cap: Allocated gates.
+ * @mats: Matrix storage.
+ * @nmats: Used entries of @mats.
+ * @mats_cap: Allocated entries of @mats.
+ */
+typedef struct sim_ops {
+    sim_op* ops;
+    size_t count;
+    size_t cap;
+    double complex* mats;
+    size_t nmats;
+    size_t mats_cap;
+} sim_ops;
+
+typedef struct sim_plan sim_plan;
+
+// Callback that runs circuit node @node directly on the backend
+typedef int (*sim_pass_fn)(void* ctx, size_t node);
+
+int sim_ops_push(sim_ops* ops, unsigned int k, const uint64_t* ids,
+                 const double complex* m, size_t node);
+void sim_ops_free(sim_ops* ops);
+
+sim_plan* sim_plan_build(const sim_ops* ops, size_t* bytes);
+size_t sim_plan_bytes(const sim_ops* ops);
+void sim_plan_free(void* plan);
+int sim_plan_run(const sim_plan* plan, const sim_ops* ops, sim_sv* sv,
+                 sim_pass_fn pass, void* ctx);
+int sim_plan_lower(const sim_plan* plan, const sim_ops* ops, sim_ops* out);
+
+#endif // NYMYA_SIM_COMPILE_H
@@ -0,0 +1,370 @@
+// sim_fuse.c
+//
+// Gate fusion for the state-vector engine. Every gate applied to the register
+// is one full pass over 2^n amplitudes, while multiplying two small matrices is
+// a few dozen flops. Consecutive 1-qubit gates on a slot are multiplied into
+// one 2x2, and gates on the same pair (along with the pending 1-qubit gates on
+// either slot) into one 4x4. The product is applied only when a gate that can
+// not be absorbed touches one of its slots, or when the register is read.
+//
+// Diagonal gates (Z, S, phases, RZ, CZ, controlled phases, ZZ) that land on
+// slots with nothing pending are held apart: they commute with each other, so
+// a run of them on any number of pairs is applied in a single phase sweep.
+
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include "sim_fuse.h"
+
+/**
+ * sim_fuse_mul - Multiplies two n x n row-major matrices.
+ * @out: Receives a * b; may alias neither input.
+ * @a: Left factor.
+ * @b: Right factor.
+ * @n: Dimension, at most 4.
+ */
+void sim_fuse_mul(double complex *out, const double complex *a,
+                  const double complex *b, unsigned int n) {
+    for (unsigned int r = 0; r < n; r++) {
+        for (unsigned int c = 0; c < n; c++) {
+            double complex acc = 0;
+
+            for (unsigned int i = 0; i < n; i++)
+                acc += a[r * n + i] * b[i * n + c];
+            out[r * n + c] = acc;
+        }
+    }
+}
+
+/**
+ * sim_fuse_lmul - Left-multiplies @m by @g in place (m = g * m).
+ * @m: n x n matrix.
+ * @g: n x n matrix.
+ * @n: Dimension, at most 4.
+ */
+void sim_fuse_lmul(double complex *m, const double complex *g, unsigned int n) {
+    double complex tmp[16];
+
+    sim_fuse_mul(tmp, g, m, n);
+    memcpy(m, tmp, n * n * sizeof(*m));
+}
+
+/**
+ * sim_fuse_kron - Tensor product hi (x) lo of two 2x2 matrices.
+ * @out: Receives the 4x4 product; @hi acts on the high index bit.
+ * @hi: 2x2 matrix, or NULL for the identity.
+ * @lo: 2x2 matrix, or NULL for the identity.
+ */
+void sim_fuse_kron(double complex out[16], const double complex *hi, const double complex *lo) {
+    static const double complex id[4] = { 1, 0, 0, 1 };
+
+    if (!hi) hi = id;
+    if (!lo) lo = id;
+    for (unsigned int r = 0; r < 4; r++) {
+        for (unsigned int c = 0; c < 4; c++)
+            out[r * 4 + c] = hi[(r >> 1) * 2 + (c >> 1)] * lo[(r & 1) * 2 + (c & 1)];
+    }
+}
+
+/**
+ * sim_fuse_swap_order - Re-expresses a 4x4 on (t1, t2) as the same gate on (t2, t1).
+ * @out: Receives the matrix with the two index bits swapped.
+ * @m: Matrix.
+ */
+void sim_fuse_swap_order(double complex out[16], const double complex m[16]) {
+    static const unsigned int p[4] = { 0, 2, 1, 3 };
+
+    for (unsigned int r = 0; r < 4; r++) {
+        for (unsigned int c = 0; c < 4; c++)
+            out[p[r] * 4 + p[c]] = m[r * 4 + c];
+    }
+}
+
+/**
+ * sim_fuse_diagonal - Checks whether a gate matrix is diagonal.
+ * @m: Row-major 2^k x 2^k matrix.
+ * @k: Number of targets, 1 or 2.
+ * @d: Receives the diagonal when it is.
+ *
+ * Returns 1 if every off-diagonal entry of @m is exactly zero, else 0.
+ */
+int sim_fuse_diagonal(const double complex *m, unsigned int k, double complex *d) {
+    unsigned int n = 1u << k;
+
+    for (unsigned int r = 0; r < n; r++) {
+        for (unsigned int c = 0; c < n; c++) {
+            if (r != c && m[r * n + c] != 0) return 0;
+        }
+    }
+    for (unsigned int r = 0; r < n; r++)
+        d[r] = m[r * n + r];
+    return 1;
+}
+
+// Multiplies a gate into a pending one on the same slots; returns 1 if it found one
+static int sim_fuse_diag_merge(sim_fuse_diag *q, unsigned int k, const unsigned int *t,
+                               const double complex *d) {
+    for (unsigned int i = 0; i < q->count; i++) {
+        sim_fuse_diag_gate *g = &q->g[i];
+
+        if (k == 1 && g->k == 1 && g->t[0] == t[0]) {
+            g->d[0] *= d[0];
+            g->d[1] *= d[1];
+            return 1;
+        }
+        if (k == 1 && g->k == 2 && (g->t[0] == t[0] || g->t[1] == t[0])) {
+            unsigned int shift = g->t[0] == t[0];
+
+            for (unsigned int r = 0; r < 4; r++)
+                g->d[r] *= d[(r >> shift) & 1];
+            return 1;
+        }
+        if (k == 2 && g->k == 2 && g->t[0] == t[0] && g->t[1] == t[1]) {
+            for (unsigned int r = 0; r < 4; r++)
+                g->d[r] *= d[r];
+            return 1;
+        }
+        if (k == 2 && g->k == 2 && g->t[0] == t[1] && g->t[1] == t[0]) {
+            for (unsigned int r = 0; r < 4; r++)
+                g->d[r] *= d[((r & 1) << 1) | (r >> 1)];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * sim_fuse_diag_add - Accepts a diagonal gate.
+ * @q: Pending diagonal gates.
+ * @sv: Register.
+ * @k: Number of targets, 1 or 2.
+ * @t: Target slots; t[0] is the high bit of the index into @d.
+ * @d: Diagonal of the gate's matrix.
+ *
+ * The pending gates are applied first if this one would take them over
+ * SIM_FUSE_DIAG_GATES gates or SIM_SV_DIAG_MAX_SLOTS slots.
+ *
+ * Returns 0 on success, -1 on an out-of-range or repeated target.
+ */
+int sim_fuse_diag_add(sim_fuse_diag *q, sim_sv *sv, unsigned int k, const unsigned int *t,
+                      const double complex *d) {
+    uint32_t bits = 1u << t[0];
+    sim_fuse_diag_gate *g;
+
+    if (t[0] >= sv->nqubits || (k == 2 && (t[1] >= sv->nqubits || t[1] == t[0]))) return -1;
+    if (k == 2) bits |= 1u << t[1];
+    if (sim_fuse_diag_merge(q, k, t, d)) return 0;
+
+    if ((q->count == SIM_FUSE_DIAG_GATES ||
+         __builtin_popcount(q->slots | bits) > SIM_SV_DIAG_MAX_SLOTS) &&
+        sim_fuse_diag_flush(q, sv))
+        return -1;
+
+    g = &q->g[q->count++];
+    g->k = k;
+    g->t[0] = t[0];
+    g->t[1] = k == 2 ? t[1] : 0;
+    memcpy(g->d, d, ((size_t)1 << k) * sizeof(*d));
+    q->slots |= bits;
+    return 0;
+}
+
+/**
+ * sim_fuse_diag_flush - Applies the pending diagonal gates in one sweep.
+ * @q: Pending diagonal gates; left empty.
+ * @sv: Register.
+ *
+ * The gates are multiplied into one phase per combination of their slots,
+ * at most 2^SIM_SV_DIAG_MAX_SLOTS of them, before the register is touched.
+ *
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int sim_fuse_diag_flush(sim_fuse_diag *q, sim_sv *sv) {
+    unsigned int rank[SIM_SV_MAX_QUBITS], j = 0;
+    size_t size = (size_t)1 << __builtin_popcount(q->slots);
+    double complex *table;
+    int ret;
+
+    if (!q->count) return 0;
+    table = malloc(size * sizeof(*table));
+    if (!table) return -1;
+
+    for (uint32_t rest = q->slots; rest; rest &= rest - 1)
+        rank[__builtin_ctz(rest)] = j++;
+    for (size_t e = 0; e < size; e++)
+        table[e] = 1;
+    for (unsigned int i = 0; i < q->count; i++) {
+        const sim_fuse_diag_gate *g = &q->g[i];
+
+        for (size_t e = 0; e < size; e++) {
+            size_t r = (e >> rank[g->t[0]]) & 1;
+
+            if (g->k == 2) r = (r << 1) | ((e >> rank[g->t[1]]) & 1);
+            table[e] *= g->d[r];
+        }
+    }
+
+    ret = sim_sv_apply_diag(sv, q->slots, table);
+    free(table);
+    q->slots = 0;
+    q->count = 0;
+    return ret;
+}
+
+/**
+ * sim_fuse_init - Empties a fusion buffer.
+ * @f: Buffer.
+ */
+void sim_fuse_init(sim_fuse *f) {
+    memset(f, 0, sizeof(*f));
+}
+
+static int sim_fuse_flush2(sim_fuse *f, sim_sv *sv) {
+    if (!f->has2) return 0;
+    f->has2 = 0;
+    // Diagonal gates on the pair were accepted before it
+    if ((f->diag.slots & ((1u << f->t2[0]) | (1u << f->t2[1]))) &&
+        sim_fuse_diag_flush(&f->diag, sv))
+        return -1;
+    return sim_sv_apply2(sv, f->t2[0], f->t2[1], f->m2);
+}
+
+/**
+ * sim_fuse_flush_slots - Applies every pending gate that acts on one of @slots.
+ * @f: Buffer.
+ * @sv: Register the gates were accepted for.
+ * @slots: Bit mask of slots.
+ *
+ * Pending diagonal gates go as one sweep, including those on other slots.
+ *
+ * Returns 0 on success, -1 if a gate could not be applied.
+ */
+int sim_fuse_flush_slots(sim_fuse *f, sim_sv *sv, uint32_t slots) {
+    uint32_t due = f->pending1 & slots;
+    int ret = 0;
+
+    if (f->diag.slots & slots)
+        ret |= sim_fuse_diag_flush(&f->diag, sv);
+    if (f->has2 && (slots & ((1u << f->t2[0]) | (1u << f->t2[1]))))
+        ret |= sim_fuse_flush2(f, sv);
+
+    while (due) {
+        unsigned int t = (unsigned int)__builtin_ctz(due);
+
+        due &= due - 1;
+        f->pending1 &= ~(1u << t);
+        ret |= sim_sv_apply1(sv, t, f->m1[t]);
+    }
+    return ret ? -1 : 0;
+}
+
+/**
+ * sim_fuse_flush - Applies every pending gate.
+ * @f: Buffer.
+ * @sv: Register the gates were accepted for.
+ *
+ * Returns 0 on success, -1 if a gate could not be applied.
+ */
+int sim_fuse_flush(sim_fuse *f, sim_sv *sv) {
+    return sim_fuse_flush_slots(f, sv, ~(uint32_t)0);
+}
+
+/**
+ * sim_fuse_apply1 - Accepts a 2x2 gate on slot @t.
+ * @f: Buffer.
+ * @sv: Register.
+ * @t: Target slot.
+ * @m: Row-major matrix.
+ *
+ * The gate joins the pending pair if @t is one of its slots, otherwise the
+ * pending product on @t. A diagonal gate on a slot with neither joins the
+ * pending diagonal gates.
+ *
+ * Returns 0 on success, -1 if @t is out of range.
+ */
+int sim_fuse_apply1(sim_fuse *f, sim_sv *sv, unsigned int t, const double complex m[4]) {
+    double complex d[2];
+    uint32_t bit;
+
+    if (t >= sv->nqubits) return -1;
+    bit = 1u << t;
+
+    if (!(f->pending1 & bit) && !(f->has2 && (t == f->t2[0] || t == f->t2[1])) &&
+        sim_fuse_diagonal(m, 1, d))
+        return sim_fuse_diag_add(&f->diag, sv, 1, &t, d);
+
+    if (f->has2 && (t == f->t2[0] || t == f->t2[1])) {
+        double complex lift[16];
+
+        sim_fuse_kron(lift, t == f->t2[0] ? m : NULL, t == f->t2[1] ? m : NULL);
+        sim_fuse_lmul(f->m2, lift, 4);
+    } else if (f->pending1 & bit) {
+        sim_fuse_lmul(f->m1[t], m, 2);
+    } else {
+        memcpy(f->m1[t], m, sizeof(f->m1[t]));
+        f->pending1 |= bit;
+    }
+    return 0;
+}
+
+/**
+ * sim_fuse_apply2 - Accepts a 4x4 gate on slots @t1 (high index bit) and @t2.
+ * @f: Buffer.
+ * @sv: Register.
+ * @t1: First target slot.
+ * @t2: Second target slot.
+ * @m: Row-major matrix.
+ *
+ * On the pending pair, in either order, the gate is multiplied in. Otherwise
+ * the pending pair is applied first and this gate, absorbing the pending
+ * 1-qubit products on @t1 and @t2, becomes the new pending pair.
+ *
+ * A diagonal gate off the pending pair joins the pending diagonal gates
+ * instead. Pending 1-qubit products on its slots are applied first, in one
+ * pass, unless diagonal gates already wait on the same slots.
+ *
+ * Returns 0 on success, -1 on an out-of-range or repeated target.
+ */
+int sim_fuse_apply2(sim_fuse *f, sim_sv *sv, unsigned int t1, unsigned int t2,
+                    const double complex m[16]) {
+    uint32_t pair = (1u << t1) | (1u << t2);
+    double complex g[16], pre[16], d[4];
+
+    if (t1 >= sv->nqubits || t2 >= sv->nqubits || t1 == t2) return -1;
+
+    if (!(f->has2 && (pair & ((1u << f->t2[0]) | (1u << f->t2[1])))) &&
+        !(f->diag.slots & f->pending1 & pair) && sim_fuse_diagonal(m, 2, d)) {
+        if ((f->pending1 & pair) == pair) {
+            sim_fuse_kron(pre, f->m1[t1], f->m1[t2]);
+            if (sim_sv_apply2(sv, t1, t2, pre)) return -1;
+        } else if (f->pending1 & pair) {
+            unsigned int t = (f->pending1 & (1u << t1)) ? t1 : t2;
+
+            if (sim_sv_apply1(sv, t, f->m1[t])) return -1;
+        }
+        f->pending1 &= ~pair;
+        return sim_fuse_diag_add(&f->diag, sv, 2, (unsigned int[]){ t1, t2 }, d);
+    }
+
+    if (f->has2 && t1 == f->t2[0] && t2 == f->t2[1]) {
+        sim_fuse_lmul(f->m2, m, 4);
+        return 0;
+    }
+    if (f->has2 && t1 == f->t2[1] && t2 == f->t2[0]) {
+        sim_fuse_swap_order(g, m);
+        sim_fuse_lmul(f->m2, g, 4);
+        return 0;
+    }
+
+    if (sim_fuse_flush2(f, sv)) return -1;
+
+    sim_fuse_kron(pre, (f->pending1 & (1u << t1)) ? f->m1[t1] : NULL,
+                  (f->pending1 & (1u << t2)) ? f->m1[t2] : NULL);
+    f->pending1 &= ~((1u << t1) | (1u << t2));
+
+    sim_fuse_mul(f->m2, m, pre, 4);
+    f->t2[0] = t1;
+    f->t2[1] = t2;
+    f->has2 = 1;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef NYMYA_SIM_FUSE_H
+#define NYMYA_SIM_FUSE_H
+
+#include <stdint.h>
+#include <complex.h>
+#include "sim_statevec.h"
+
+// Diagonal gates a sim_fuse_diag holds before it has to sweep the register
+#define SIM_FUSE_DIAG_GATES 64
+
+/**
+ * sim_fuse_diag_gate - One pending diagonal gate.
+ * @k: 1 or 2 targets.
+ * @t: Target slots; t[0] is the high bit of the index into @d.
+ * @d: Diagonal of the gate's matrix.
+ */
+typedef struct sim_fuse_diag_gate {
+    unsigned int k;
+    unsigned int t[2];
+    double complex d[4];
+} sim_fuse_diag_gate;
+
+/**
+ * sim_fuse_diag - Diagonal gates accepted but not yet applied to a register.
+ * @slots: Mask of the slots the gates act on.
+ * @count: Number of gates.
+ * @g: The gates; gates on the same slots are multiplied into one entry.
+ *
+ * Diagonal gates commute, so any run of them is applied as one phase sweep
+ * (sim_sv_apply_diag()) whatever qubits they act on.
+ */
+typedef struct sim_fuse_diag {
+    uint32_t slots;
+    unsigned int count;
+    sim_fuse_diag_gate g[SIM_FUSE_DIAG_GATES];
+} sim_fuse_diag;
+
+/**
+ * sim_fuse - Gates accepted but not yet applied to a register.
+ * @m1: Pending product of 1-qubit gates, by slot.
+ * @pending1: Bit s is set when @m1[s] holds a gate.
+ * @m2: Pending product of gates on the pair @t2[0] (high index bit), @t2[1].
+ * @t2: Slots of the pending pair.
+ * @has2: Non-zero when @m2 holds a gate.
+ * @diag: Pending diagonal gates, which act before @m1 and @m2.
+ *
+ * A slot with a pending 1-qubit product is never one of the pending pair's
+ * slots, so the pending products act on disjoint qubits and commute.
+ */
+typedef struct sim_fuse {
+    double complex m1[SIM_SV_MAX_QUBITS][4];
+    uint32_t pending1;
+    double complex m2[16];
+    unsigned int t2[2];
+    int has2;
+    sim_fuse_diag diag;
+} sim_fuse;
+
+void sim_fuse_mul(double complex *out, const double complex *a,
+                  const double complex *b, unsigned int n);
+void sim_fuse_lmul(double complex *m, const double complex *g, unsigned int n);
+void sim_fuse_kron(double complex out[16], const double complex *hi, const double complex *lo);
+void sim_fuse_swap_order(double complex out[16], const double complex m[16]);
+
+int sim_fuse_diagonal(const double complex *m, unsigned int k, double complex *d);
+int sim_fuse_diag_add(sim_fuse_diag *q, sim_sv *sv, unsigned int k, const unsigned int *t,
+                      const double complex *d);
+int sim_fuse_diag_flush(sim_fuse_diag *q, sim_sv *sv);
+
+void sim_fuse_init(sim_fuse *f);
+
+int sim_fuse_apply1(sim_fuse *f, sim_sv *sv, unsigned int t, const double complex m[4]);
+int sim_fuse_apply2(sim_fuse *f, sim_sv *sv, unsigned int t1, unsigned int t2,
+                    const double complex m[16]);
+
+int sim_fuse_flush_slots(sim_fuse *f, sim_sv *sv, uint32_t slots);
+int sim_fuse_flush(sim_fuse *f, sim_sv *sv);
+
+#endif // NYMYA_SIM_FUSE_H
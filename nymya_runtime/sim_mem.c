@@ -0,0 +1,302 @@
+// sim_mem.c
+//
+// Amplitude arrays of the state-vector engine. A register of 2^n amplitudes
+// spans 2^n * 16 bytes; with 4 KiB pages, a gate on a high qubit pairs
+// amplitudes whole megabytes apart and takes a TLB miss on nearly every
+// access. Arrays of at least SIM_MEM_HUGE_PAGE are therefore mapped on their
+// own, aligned and rounded to 2 MiB, and backed by huge pages as
+// NYMYA_HUGEPAGES (or nymya_hugepages_set_mode()) chooses:
+//
+//   "thp"      madvise(MADV_HUGEPAGE), the default; the kernel backs the
+//              range with transparent huge pages when its THP setting is
+//              "always" or "madvise" and it finds free 2 MiB blocks
+//   "hugetlb"  reserved pages (vm.nr_hugepages) through MAP_HUGETLB, and
+//              "thp" for an array the reserve cannot hold
+//   "off"      normal pages, heap allocated like the small arrays
+//
+// Either way a request only succeeds or fails as a normal allocation would;
+// whether the pages really are huge is up to the kernel, so
+// nymya_hugepages_get_stats() reads it back from /proc/self/smaps.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "sim_mem.h"
+#include "nymya_runtime.h"
+
+/**
+ * sim_mem_region - A live array mapped for huge pages.
+ * @base: Start of the mapping, 2 MiB aligned.
+ * @len: Length of the mapping, a multiple of 2 MiB.
+ * @hugetlb: Non-zero if it holds reserved hugetlb pages.
+ */
+typedef struct sim_mem_region {
+    uintptr_t base;
+    size_t len;
+    int hugetlb;
+} sim_mem_region;
+
+/**
+ * sim_mem_state - Mode and the arrays mapped under it.
+ * @lock: Protects everything below.
+ * @mode: Mode for arrays allocated from now on.
+ * @regions: Live arrays, in no order.
+ * @count: Used entries of @regions.
+ * @cap: Allocated entries of @regions.
+ * @fallbacks: "hugetlb" arrays that had to take transparent pages.
+ */
+static struct {
+    pthread_mutex_t lock;
+    nymya_hugepages mode;
+    sim_mem_region *regions;
+    size_t count;
+    size_t cap;
+    uint64_t fallbacks;
+} sim_mem = { .lock = PTHREAD_MUTEX_INITIALIZER, .mode = NYMYA_HUGEPAGES_THP };
+
+static pthread_once_t sim_mem_once = PTHREAD_ONCE_INIT;
+
+// Reads NYMYA_HUGEPAGES once
+static void sim_mem_init(void) {
+    const char *env = getenv("NYMYA_HUGEPAGES");
+
+    if (!env || !*env) return;
+    if (strcmp(env, "off") == 0 || strcmp(env, "0") == 0) sim_mem.mode = NYMYA_HUGEPAGES_OFF;
+    else if (strcmp(env, "thp") == 0) sim_mem.mode = NYMYA_HUGEPAGES_THP;
+    else if (strcmp(env, "hugetlb") == 0) sim_mem.mode = NYMYA_HUGEPAGES_HUGETLB;
+    else fprintf(stderr, "[sim mem] Unknown NYMYA_HUGEPAGES \"%s\"; using \"thp\"\n", env);
+}
+
+/**
+ * nymya_hugepages_set_mode - Chooses how large amplitude arrays get their pages.
+ * @mode: NYMYA_HUGEPAGES_OFF, _THP or _HUGETLB.
+ *
+ * Overrides NYMYA_HUGEPAGES. Applies to arrays allocated from now on; a
+ * register keeps its pages until it grows or changes precision.
+ */
+void nymya_hugepages_set_mode(nymya_hugepages mode) {
+    pthread_once(&sim_mem_once, sim_mem_init);
+    pthread_mutex_lock(&sim_mem.lock);
+    sim_mem.mode = mode;
+    pthread_mutex_unlock(&sim_mem.lock);
+}
+
+// A 2 MiB aligned anonymous mapping of @len bytes (a multiple of 2 MiB) marked for THP
+static void *sim_mem_map_thp(size_t len) {
+    char *raw = mmap(NULL, len + SIM_MEM_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    char *p;
+    size_t head;
+
+    if (raw == MAP_FAILED) return NULL;
+    // Trim to the aligned window so every 2 MiB of the array can be one page
+    p = (char *)(((uintptr_t)raw + SIM_MEM_HUGE_PAGE - 1) & ~(uintptr_t)(SIM_MEM_HUGE_PAGE - 1));
+    head = (size_t)(p - raw);
+    if (head) munmap(raw, head);
+    if (SIM_MEM_HUGE_PAGE - head) munmap(p + len, SIM_MEM_HUGE_PAGE - head);
+#ifdef MADV_HUGEPAGE
+    madvise(p, len, MADV_HUGEPAGE);
+#endif
+    return p;
+}
+
+// Records a new mapping; returns -1 if the table cannot grow
+static int sim_mem_track(void *p, size_t len, int hugetlb) {
+    if (sim_mem.count == sim_mem.cap) {
+        size_t cap = sim_mem.cap ? 2 * sim_mem.cap : 16;
+        sim_mem_region *r = realloc(sim_mem.regions, cap * sizeof(*r));
+
+        if (!r) return -1;
+        sim_mem.regions = r;
+        sim_mem.cap = cap;
+    }
+    sim_mem.regions[sim_mem.count].base = (uintptr_t)p;
+    sim_mem.regions[sim_mem.count].len = len;
+    sim_mem.regions[sim_mem.count].hugetlb = hugetlb;
+    sim_mem.count++;
+    return 0;
+}
+
+/**
+ * sim_mem_alloc - Allocates an amplitude array.
+ * @bytes: Size of the array.
+ * @align: Alignment for a heap array, a power of two.
+ * @map: Receives the mapping that holds the array, or NULL if it is heap memory.
+ * @map_len: Receives the length of @map, or 0.
+ *
+ * Arrays of SIM_MEM_HUGE_PAGE bytes or more are mapped for huge pages,
+ * unless the mode is NYMYA_HUGEPAGES_OFF; the others come from
+ * posix_memalign(). Mapped arrays are zeroed, heap arrays are not. Release
+ * with sim_mem_release(), or hand the three values to sim_sv_adopt().
+ *
+ * Returns the array, or NULL on allocation failure.
+ */
+void *sim_mem_alloc(size_t bytes, size_t align, void **map, size_t *map_len) {
+    nymya_hugepages mode;
+    size_t len;
+    void *p = NULL;
+    int hugetlb = 0;
+
+    pthread_once(&sim_mem_once, sim_mem_init);
+    *map = NULL;
+    *map_len = 0;
+    pthread_mutex_lock(&sim_mem.lock);
+    mode = sim_mem.mode;
+    pthread_mutex_unlock(&sim_mem.lock);
+
+    if (bytes < SIM_MEM_HUGE_PAGE || mode == NYMYA_HUGEPAGES_OFF ||
+        bytes > SIZE_MAX - SIM_MEM_HUGE_PAGE) {
+        if (posix_memalign(&p, align, bytes < align ? align : bytes) != 0) return NULL;
+        return p;
+    }
+
+    len = (bytes + SIM_MEM_HUGE_PAGE - 1) & ~(SIM_MEM_HUGE_PAGE - 1);
+#ifdef MAP_HUGETLB
+    if (mode == NYMYA_HUGEPAGES_HUGETLB) {
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) p = NULL;
+        else hugetlb = 1;
+    }
+#endif
+    if (!p) p = sim_mem_map_thp(len);
+    if (!p) return NULL;
+
+    pthread_mutex_lock(&sim_mem.lock);
+    if (sim_mem_track(p, len, hugetlb) != 0) {
+        pthread_mutex_unlock(&sim_mem.lock);
+        munmap(p, len);
+        return NULL;
+    }
+    if (mode == NYMYA_HUGEPAGES_HUGETLB && !hugetlb) sim_mem.fallbacks++;
+    pthread_mutex_unlock(&sim_mem.lock);
+
+    *map = p;
+    *map_len = len;
+    return p;
+}
+
+/**
+ * sim_mem_release - Releases an amplitude array.
+ * @amp: The array.
+ * @map: Mapping that holds it, as sim_mem_alloc() returned or a checkpoint
+ *       mapping, or NULL for heap memory.
+ * @map_len: Length of @map.
+ */
+void sim_mem_release(void *amp, void *map, size_t map_len) {
+    if (!map) {
+        free(amp);
+        return;
+    }
+    pthread_mutex_lock(&sim_mem.lock);
+    for (size_t i = 0; i < sim_mem.count; i++) {
+        if (sim_mem.regions[i].base == (uintptr_t)map) {
+            sim_mem.regions[i] = sim_mem.regions[--sim_mem.count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_mem.lock);
+    munmap(map, map_len);
+}
+
+/**
+ * sim_mem_vma - One mapping of /proc/self/smaps, as far as it has been read.
+ * @start, @end: Address range.
+ * @huge: AnonHugePages, in bytes.
+ * @flags: Set once its VmFlags line has been seen: bit 0 for "hg" (marked
+ *         for transparent huge pages), bit 1 for "ht" (hugetlb).
+ */
+typedef struct sim_mem_vma {
+    uintptr_t start;
+    uintptr_t end;
+    size_t huge;
+    unsigned int flags;
+} sim_mem_vma;
+
+// Adds a finished mapping to @out; @regions are the arrays tracked at the time
+static void sim_mem_account(const sim_mem_vma *v, const sim_mem_region *regions, size_t count,
+                            nymya_hugepage_stats *out) {
+    size_t len = (size_t)(v->end - v->start);
+
+    if (!(v->flags & 3)) return;
+    if (v->flags & 2) out->hugetlb_bytes += len;
+    else {
+        out->thp_bytes += len;
+        out->thp_backed_bytes += v->huge;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uintptr_t lo = regions[i].base > v->start ? regions[i].base : v->start;
+        uintptr_t hi = regions[i].base + regions[i].len < v->end ? regions[i].base + regions[i].len : v->end;
+        size_t overlap;
+
+        if (hi <= lo) continue;
+        overlap = (size_t)(hi - lo);
+        // Adjacent arrays can share one mapping; its huge pages are not split out per array
+        if (v->flags & 2) out->array_huge_bytes += overlap;
+        else out->array_huge_bytes += v->huge < overlap ? v->huge : overlap;
+    }
+}
+
+/**
+ * nymya_hugepages_get_stats - Reports how much memory huge pages back.
+ * @out: Receives the figures.
+ *
+ * The array figures cover the simulator's own arrays; the others cover
+ * every mapping of the process marked for huge pages, the simulator's and
+ * any libnymya buffer allocated with NYMYA_ALLOC_HUGE included. Huge page
+ * backing is read from /proc/self/smaps at the time of the call: the kernel
+ * may still collapse pages later (khugepaged) or split them.
+ *
+ * Returns 0 on success, -1 if /proc/self/smaps cannot be read (then only
+ * @arrays, @array_bytes and @hugetlb_fallbacks are filled in).
+ */
+int nymya_hugepages_get_stats(nymya_hugepage_stats *out) {
+    sim_mem_region *regions = NULL;
+    sim_mem_vma v = { 0 };
+    size_t count;
+    char line[512];
+    FILE *f;
+
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    pthread_once(&sim_mem_once, sim_mem_init);
+
+    pthread_mutex_lock(&sim_mem.lock);
+    count = sim_mem.count;
+    out->arrays = count;
+    out->hugetlb_fallbacks = sim_mem.fallbacks;
+    for (size_t i = 0; i < count; i++) out->array_bytes += sim_mem.regions[i].len;
+    if (count) {
+        regions = malloc(count * sizeof(*regions));
+        if (regions) memcpy(regions, sim_mem.regions, count * sizeof(*regions));
+        else count = 0;
+    }
+    pthread_mutex_unlock(&sim_mem.lock);
+
+    f = fopen("/proc/self/smaps", "r");
+    if (!f) {
+        free(regions);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long start, end, kb;
+
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            sim_mem_account(&v, regions, count, out);
+            memset(&v, 0, sizeof(v));
+            v.start = start;
+            v.end = end;
+        } else if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            v.huge = (size_t)kb << 10;
+        } else if (strncmp(line, "VmFlags:", 8) == 0) {
+            if (strstr(line, " hg")) v.flags |= 1;
+            if (strstr(line, " ht")) v.flags |= 2;
+        }
+    }
+    sim_mem_account(&v, regions, count, out);
+    fclose(f);
+    free(regions);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef NYMYA_SIM_MEM_H
+#define NYMYA_SIM_MEM_H
+
+#include <stddef.h>
+
+// Huge page size the arrays are aligned and rounded to; smaller arrays stay on the heap
+#define SIM_MEM_HUGE_PAGE ((size_t)2 << 20)
+
+void *sim_mem_alloc(size_t bytes, size_t align, void **map, size_t *map_len);
+void sim_mem_release(void *amp, void *map, size_t map_len);
+
+#endif // NYMYA_SIM_MEM_H
@@ -0,0 +1,709 @@
+// sim_pool.c
+//
+// Persistent work-stealing scheduler for the runtime. Everything in the
+// runtime that runs in parallel goes through it: state-vector sweeps, and
+// the batch, trajectory and gradient runs whose tasks each simulate a
+// whole circuit. A job is split into slices, and every slice becomes one
+// entry in a queue. Each worker owns a deque (Chase-Lev): it pushes and pops
+// entries at the bottom without locks, and idle workers steal from the top
+// of other workers' deques with a single compare-and-swap. Threads outside
+// the pool post their jobs to a shared injection queue instead, and sleep
+// until the job finishes.
+//
+// A worker that submits a job while running a task pushes the slices onto
+// its own deque and runs them itself until the others steal some, so
+// nested parallelism (a batch task whose gates sweep a large register)
+// uses idle workers and never adds threads. While it waits it runs only
+// sweep slices: they touch nothing but their job, whereas a whole-circuit
+// task takes over the worker's simulator state (sim_pool_run_exclusive).
+//
+// A slice does not name the worker that runs it, but whoever takes an entry
+// claims slice w if it is worker w and slice w is free. On an idle pool
+// worker w therefore sweeps slice w on every gate, as the pages it first
+// touched when the register grew, and with the workers pinned to distinct
+// CPUs first-touch placement keeps each slice on that CPU's NUMA node
+// without a libnuma dependency. The CPUs are taken node by node, and a
+// process pool smaller than the machine is spread over every node so that
+// all memory controllers serve the register; NYMYA_NUMA selects the policy
+// as for libnymya ("off", "spread", "compact"; "interleave" spreads like
+// "spread").
+//
+// There is one process pool; a runtime context may create a private pool for
+// its thread instead (sim_pool_new), pinned to the next free CPUs so that
+// concurrent contexts do not share cores.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "sim_pool.h"
+
+// Entries per worker deque; a full deque runs further slices inline
+#define SIM_POOL_DEQUE 512
+
+// Failed searches before an idle worker sleeps
+#define SIM_POOL_SPIN 64
+
+/**
+ * sim_job - One sim_pool_run() or sim_pool_run_exclusive() call.
+ * @fn: Callback.
+ * @ctx: Callback context.
+ * @nw: Number of slices.
+ * @pending: Slices not yet finished.
+ * @unposted: Injection-queue entries not yet taken by a worker.
+ * @external: Set if the submitter sleeps on the pool's @done_cv.
+ * @done: Set, under the pool's @lock, when @pending reaches 0 (external only).
+ * @next: Next job in the injection queue.
+ * @claimed: Nonzero for each slice a thread has claimed.
+ *
+ * The job lives on the submitter's stack. Every slice has exactly one entry,
+ * and the entry is consumed by the claim, so no entry outlives the job.
+ */
+typedef struct sim_job {
+    sim_pool_fn fn;
+    void *ctx;
+    unsigned int nw;
+    unsigned int pending;
+    unsigned int unposted;
+    int external;
+    int done;
+    struct sim_job *next;
+    unsigned char claimed[SIM_POOL_MAX_THREADS];
+} sim_job;
+
+/**
+ * sim_deque - Work-stealing deque of one worker.
+ * @top: Next entry to steal; advanced by compare-and-swap.
+ * @bottom: Next free slot; written only by the owner.
+ * @buf: Ring of entries.
+ */
+typedef struct sim_deque {
+    long top __attribute__((aligned(64)));
+    long bottom __attribute__((aligned(64)));
+    sim_job *buf[SIM_POOL_DEQUE];
+} sim_deque;
+
+/**
+ * sim_pool - Simulator worker pool.
+ * @lock: Protects the injection queue, @quit and the sleep/wake handshake.
+ * @work_cv: Signals sleeping workers that entries were posted or that they
+ *           must exit.
+ * @done_cv: Signals external submitters that a job finished.
+ * @busy: Read-held by every external job, write-held to stop the workers.
+ * @submit: Serialises (re)configuration and starting the workers.
+ * @tid: Worker threads.
+ * @want: Configured thread count; 0 until resolved.
+ * @threads: Number of running workers.
+ * @quit: Set to make the workers exit.
+ * @epoch: Bumped whenever entries are posted; idle workers sleep only if it
+ *         did not move since they last looked for work.
+ * @sleepers: Workers sleeping on @work_cv.
+ * @injected: Entries in the injection queue.
+ * @head: First job in the injection queue.
+ * @tail: Last job in the injection queue.
+ * @first_cpu: Index of the usable CPU that worker 0 is pinned to.
+ * @seat: State of each worker thread.
+ */
+typedef struct sim_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+    pthread_rwlock_t busy;
+    pthread_mutex_t submit;
+    pthread_t tid[SIM_POOL_MAX_THREADS];
+    unsigned int want;
+    unsigned int threads;
+    int quit;
+    unsigned int epoch;
+    unsigned int sleepers;
+    unsigned int injected;
+    sim_job *head;
+    sim_job *tail;
+    unsigned int first_cpu;
+    struct sim_pool_seat {
+        sim_deque dq;
+        struct sim_pool *pool;
+        unsigned int w;
+        unsigned int rng;
+    } seat[SIM_POOL_MAX_THREADS];
+} sim_pool;
+
+typedef struct sim_pool_seat sim_pool_seat;
+
+static sim_pool sim_workers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work_cv = PTHREAD_COND_INITIALIZER,
+    .done_cv = PTHREAD_COND_INITIALIZER,
+    .busy = PTHREAD_RWLOCK_INITIALIZER,
+    .submit = PTHREAD_MUTEX_INITIALIZER,
+};
+
+// Pool the calling thread submits to; NULL means the process pool
+static __thread sim_pool *sim_pool_cur;
+
+// Seat of the calling thread if it is a worker, else NULL
+static __thread sim_pool_seat *sim_pool_self;
+
+// Usable-CPU index the next private pool starts pinning at
+static unsigned int sim_pool_next_cpu;
+
+static sim_pool *sim_pool_get(void) {
+    return sim_pool_cur ? sim_pool_cur : &sim_workers;
+}
+
+// Owner side: appends an entry; returns -1 if the deque is full
+static int sim_deque_push(sim_deque *dq, sim_job *job) {
+    long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+    long t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+
+    if (b - t >= SIM_POOL_DEQUE) return -1;
+    __atomic_store_n(&dq->buf[b & (SIM_POOL_DEQUE - 1)], job, __ATOMIC_RELAXED);
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Owner side: takes the newest entry, racing thieves only for the last one
+static sim_job *sim_deque_pop(sim_deque *dq) {
+    long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1;
+    long t;
+    sim_job *job;
+
+    __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+    if (t > b) {
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    job = __atomic_load_n(&dq->buf[b & (SIM_POOL_DEQUE - 1)], __ATOMIC_RELAXED);
+    if (t == b) {
+        if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0, __ATOMIC_SEQ_CST,
+                                         __ATOMIC_RELAXED))
+            job = NULL;
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return job;
+}
+
+// Thief side: takes the oldest entry, or NULL if empty or another thief won
+static sim_job *sim_deque_steal(sim_deque *dq) {
+    long t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+    long b;
+    sim_job *job;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return NULL;
+    job = __atomic_load_n(&dq->buf[t & (SIM_POOL_DEQUE - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_RELAXED))
+        return NULL;
+    return job;
+}
+
+// Wakes sleeping workers after entries were posted
+static void sim_pool_wake(sim_pool *pool) {
+    __atomic_add_fetch(&pool->epoch, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->work_cv);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Takes one entry from the injection queue, or NULL if it is empty
+static sim_job *sim_pool_take_injected(sim_pool *pool) {
+    sim_job *job = NULL;
+
+    if (!__atomic_load_n(&pool->injected, __ATOMIC_ACQUIRE)) return NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->head) {
+        job = pool->head;
+        __atomic_sub_fetch(&pool->injected, 1, __ATOMIC_RELEASE);
+        if (--job->unposted == 0) {
+            pool->head = job->next;
+            if (!pool->head) pool->tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return job;
+}
+
+// Steals one entry from another worker, starting at a random victim
+static sim_job *sim_pool_steal(sim_pool_seat *self) {
+    sim_pool *pool = self->pool;
+    unsigned int n = __atomic_load_n(&pool->threads, __ATOMIC_ACQUIRE);
+    unsigned int start;
+
+    self->rng = self->rng * 1103515245u + 12345u;
+    start = (self->rng >> 16) % n;
+    for (unsigned int i = 0; i < n; i++) {
+        sim_pool_seat *victim = &pool->seat[(start + i) % n];
+        sim_job *job;
+
+        if (victim == self) continue;
+        job = sim_deque_steal(&victim->dq);
+        if (job) return job;
+    }
+    return NULL;
+}
+
+/**
+ * sim_pool_exec - Claims one slice of a job and runs it.
+ * @pool: Pool the job was posted to.
+ * @job: Job of the entry just taken.
+ * @w: Worker index of the calling thread; slice @w is preferred if free.
+ *
+ * There are as many entries as slices, so a free slice always remains.
+ */
+static void sim_pool_exec(sim_pool *pool, sim_job *job, unsigned int w) {
+    unsigned int nw = job->nw;
+    unsigned int s = w < nw ? w : 0;
+    int external = job->external;
+
+    while (__atomic_exchange_n(&job->claimed[s], 1, __ATOMIC_ACQ_REL))
+        s = s + 1 < nw ? s + 1 : 0;
+    job->fn(job->ctx, s, nw);
+
+    // A job without an external submitter may be gone once @pending is 0
+    if (__atomic_sub_fetch(&job->pending, 1, __ATOMIC_ACQ_REL) == 0 && external) {
+        pthread_mutex_lock(&pool->lock);
+        job->done = 1;
+        pthread_cond_broadcast(&pool->done_cv);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *sim_pool_worker(void *arg) {
+    sim_pool_seat *self = arg;
+    sim_pool *pool = self->pool;
+    unsigned int idle = 0;
+
+    sim_pool_self = self;
+    self->rng = self->w * 2654435761u + 1;
+    for (;;) {
+        unsigned int epoch = __atomic_load_n(&pool->epoch, __ATOMIC_SEQ_CST);
+        sim_job *job = sim_deque_pop(&self->dq);
+
+        if (!job) job = sim_pool_take_injected(pool);
+        if (!job) job = sim_pool_steal(self);
+        if (job) {
+            // Exclusive tasks may replace the context, and with it the pool
+            sim_pool_cur = pool;
+            sim_pool_exec(pool, job, self->w);
+            idle = 0;
+            continue;
+        }
+        if (++idle < SIM_POOL_SPIN) {
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (pool->quit) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&pool->epoch, __ATOMIC_SEQ_CST) == epoch)
+            pthread_cond_wait(&pool->work_cv, &pool->lock);
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->lock);
+        idle = 0;
+    }
+    return NULL;
+}
+
+// Thread count when none was set: NYMYA_SIM_THREADS, else one per online CPU
+static unsigned int sim_pool_default_threads(void) {
+    const char *s = getenv("NYMYA_SIM_THREADS");
+    long n = 0;
+
+    if (s && *s) n = strtol(s, NULL, 10);
+    if (n <= 0) n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n <= 0) n = 1;
+    return n > SIM_POOL_MAX_THREADS ? SIM_POOL_MAX_THREADS : (unsigned int)n;
+}
+
+// Called with @submit held
+static unsigned int sim_pool_resolve(sim_pool *pool) {
+    if (!pool->want) pool->want = sim_pool_default_threads();
+    return pool->want;
+}
+
+/*
+ * Usable CPUs node by node, read from the sysfs node lists like
+ * nymya_numa.c in nymya-core does (the runtime does not link libnymya).
+ * Returns the number stored in @cpus, or 0 if sysfs lists no nodes.
+ */
+static unsigned int sim_pool_node_cpus(const cpu_set_t *allowed, int *cpus, unsigned int max) {
+    unsigned int n = 0;
+
+    for (int node = 0; node < 64; node++) {
+        char path[64], line[4096], *p, *end;
+        cpu_set_t set;
+        FILE *f;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        f = fopen(path, "r");
+        if (!f) continue;
+        if (!fgets(line, sizeof(line), f)) line[0] = '\0';
+        fclose(f);
+
+        CPU_ZERO(&set);
+        for (p = line; *p && *p != '\n';) {
+            long lo = strtol(p, &end, 10), hi = lo;
+
+            if (end == p) break;
+            if (*end == '-') {
+                p = end + 1;
+                hi = strtol(p, &end, 10);
+            }
+            for (long c = lo; c <= hi && c < CPU_SETSIZE; c++) {
+                if (c >= 0 && CPU_ISSET(c, allowed)) CPU_SET(c, &set);
+            }
+            p = *end == ',' ? end + 1 : end;
+        }
+        for (int c = 0; c < CPU_SETSIZE && n < max; c++) {
+            if (CPU_ISSET(c, &set)) cpus[n++] = c;
+        }
+    }
+    return n;
+}
+
+/**
+ * sim_pool_start - Starts the workers, pinning worker i to usable CPU
+ *                  @first_cpu + i (wrapping around).
+ * @pool: The pool; @submit must be held.
+ *
+ * Usable CPUs are counted node by node unless NYMYA_NUMA is "off". Under
+ * the default spread policy the process pool instead takes every
+ * (ncpus / want)-th of them, so slice w lands on the node the same fraction
+ * of the way through the machine; private pools keep to consecutive CPUs.
+ *
+ * Workers are pinned only if there are enough CPUs for one each. If a thread
+ * cannot be created the pool runs with the workers started so far.
+ */
+static void sim_pool_start(sim_pool *pool) {
+    unsigned int want = sim_pool_resolve(pool);
+    const char *numa = getenv("NYMYA_NUMA");
+    int off = numa && strcmp(numa, "off") == 0;
+    int spread = !off && !(numa && strcmp(numa, "compact") == 0) && pool == &sim_workers;
+    int cpus[SIM_POOL_MAX_THREADS];
+    unsigned int ncpus = 0;
+    cpu_set_t allowed;
+
+    if (want <= 1) return;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        if (!off) ncpus = sim_pool_node_cpus(&allowed, cpus, SIM_POOL_MAX_THREADS);
+        // No sysfs node lists (or "off"): CPU number order
+        if (!ncpus) {
+            for (int c = 0; c < CPU_SETSIZE && ncpus < SIM_POOL_MAX_THREADS; c++) {
+                if (CPU_ISSET(c, &allowed)) cpus[ncpus++] = c;
+            }
+        }
+    }
+
+    pool->quit = 0;
+    for (unsigned int w = 0; w < want; w++) {
+        pool->seat[w].pool = pool;
+        pool->seat[w].w = w;
+        pool->seat[w].dq.top = pool->seat[w].dq.bottom = 0;
+    }
+    // Thieves scan seats below @threads, so it grows only once a seat is ready
+    for (pool->threads = 0; pool->threads < want;) {
+        unsigned int w = pool->threads;
+        pthread_attr_t attr;
+        int ret;
+
+        pthread_attr_init(&attr);
+        if (ncpus >= want) {
+            cpu_set_t one;
+
+            CPU_ZERO(&one);
+            if (spread)
+                CPU_SET(cpus[(unsigned long long)w * ncpus / want], &one);
+            else
+                CPU_SET(cpus[(pool->first_cpu + w) % ncpus], &one);
+            pthread_attr_setaffinity_np(&attr, sizeof(one), &one);
+        }
+        __atomic_store_n(&pool->threads, w + 1, __ATOMIC_RELEASE);
+        ret = pthread_create(&pool->tid[w], &attr, sim_pool_worker, &pool->seat[w]);
+        pthread_attr_destroy(&attr);
+        if (ret != 0) {
+            __atomic_store_n(&pool->threads, w, __ATOMIC_RELEASE);
+            fprintf(stderr, "[sim pool] Started %u of %u worker threads\n", w, want);
+            break;
+        }
+    }
+}
+
+// Called with @busy write-held and @submit held
+static void sim_pool_stop(sim_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->work_cv);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned int i = 0; i < pool->threads; i++)
+        pthread_join(pool->tid[i], NULL);
+    pool->threads = 0;
+}
+
+/**
+ * sim_pool_new - Creates a private pool.
+ * @threads: Worker count, as for sim_pool_set_threads().
+ *
+ * Each private pool is pinned to the CPUs after those of the previous one.
+ * No threads start until the pool's first large job.
+ *
+ * Returns the pool, or NULL if memory runs out.
+ */
+sim_pool *sim_pool_new(unsigned int threads) {
+    sim_pool *pool;
+    unsigned int n;
+
+    // The deques are cache-line aligned, which calloc() does not promise
+    if (posix_memalign((void **)&pool, 64, sizeof(*pool))) return NULL;
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cv, NULL);
+    pthread_cond_init(&pool->done_cv, NULL);
+    pthread_rwlock_init(&pool->busy, NULL);
+    pthread_mutex_init(&pool->submit, NULL);
+    pool->want = threads > SIM_POOL_MAX_THREADS ? SIM_POOL_MAX_THREADS : threads;
+    n = sim_pool_resolve(pool);
+    pool->first_cpu = __atomic_fetch_add(&sim_pool_next_cpu, n, __ATOMIC_RELAXED);
+    return pool;
+}
+
+/**
+ * sim_pool_free - Stops and releases a private pool.
+ * @pool: Pool from sim_pool_new(), or NULL; no thread may be using it.
+ */
+void sim_pool_free(sim_pool *pool) {
+    if (!pool) return;
+    if (pool->threads) sim_pool_stop(pool);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cv);
+    pthread_cond_destroy(&pool->done_cv);
+    pthread_rwlock_destroy(&pool->busy);
+    pthread_mutex_destroy(&pool->submit);
+    free(pool);
+}
+
+/**
+ * sim_pool_use - Selects the pool the calling thread's jobs run on.
+ * @pool: Private pool, or NULL for the process pool.
+ */
+void sim_pool_use(sim_pool *pool) {
+    sim_pool_cur = pool;
+}
+
+/**
+ * sim_pool_current - Returns the pool the calling thread's jobs run on.
+ *
+ * On a worker running a task this is the worker's own pool.
+ */
+sim_pool *sim_pool_current(void) {
+    return sim_pool_cur;
+}
+
+/**
+ * sim_pool_set_threads - Sets the number of simulator worker threads.
+ * @threads: Thread count; 0 restores the default (NYMYA_SIM_THREADS, else one
+ *           per online CPU). Values above SIM_POOL_MAX_THREADS are clamped.
+ *
+ * Running workers are stopped once the jobs in flight finish; the new pool
+ * starts with the next large job. A pool's own workers cannot resize it.
+ *
+ * Returns the thread count now in effect.
+ */
+int sim_pool_set_threads(unsigned int threads) {
+    sim_pool *pool = sim_pool_get();
+    unsigned int n;
+
+    if (sim_pool_self && sim_pool_self->pool == pool) {
+        fprintf(stderr, "[sim pool] A worker task cannot resize its own pool\n");
+        return (int)sim_pool_threads();
+    }
+    pthread_rwlock_wrlock(&pool->busy);
+    pthread_mutex_lock(&pool->submit);
+    if (pool->threads) sim_pool_stop(pool);
+    pool->want = threads > SIM_POOL_MAX_THREADS ? SIM_POOL_MAX_THREADS : threads;
+    n = sim_pool_resolve(pool);
+    pthread_mutex_unlock(&pool->submit);
+    pthread_rwlock_unlock(&pool->busy);
+    return (int)n;
+}
+
+/**
+ * sim_pool_threads - Returns the configured number of worker threads.
+ */
+unsigned int sim_pool_threads(void) {
+    sim_pool *pool = sim_pool_get();
+    unsigned int n;
+
+    pthread_mutex_lock(&pool->submit);
+    n = sim_pool_resolve(pool);
+    pthread_mutex_unlock(&pool->submit);
+    return n;
+}
+
+/**
+ * sim_pool_workers - Number of slices to cut a sweep over @amps amplitudes into.
+ * @amps: Amplitudes the job touches.
+ *
+ * Returns 1, meaning run on the calling thread, for registers below
+ * SIM_POOL_MIN_AMPS amplitudes per worker.
+ */
+unsigned int sim_pool_workers(size_t amps) {
+    size_t nw = amps / SIM_POOL_MIN_AMPS;
+    unsigned int threads;
+
+    if (nw <= 1) return 1;
+    threads = sim_pool_threads();
+    return nw < threads ? (unsigned int)nw : threads;
+}
+
+/**
+ * sim_pool_split - Start of slice @w when [0, @n) is cut into @nw slices.
+ * @n: Number of items.
+ * @w: Slice index, 0 to @nw; sim_pool_split(n, nw, nw) is @n.
+ * @nw: Number of slices.
+ *
+ * Interior split points are rounded down to SIM_POOL_CHUNK_AMPS, so slices
+ * never share a page and every slice length is a multiple of the widest
+ * vector kernel.
+ */
+size_t sim_pool_split(size_t n, unsigned int w, unsigned int nw) {
+    if (w >= nw) return n;
+    return (n * w / nw) & ~(SIM_POOL_CHUNK_AMPS - 1);
+}
+
+/*
+ * Runs a job posted by one of @pool's own workers: the slices go onto its
+ * deque, and it works through them, and through sweep slices stolen from
+ * other workers, until every slice finished. Exclusive entries never reach
+ * a deque, so nothing it runs here disturbs the task it is nested in.
+ */
+static void sim_pool_run_nested(sim_pool_seat *self, sim_job *job) {
+    sim_pool *pool = self->pool;
+    unsigned int posted = 0;
+
+    while (posted < job->nw && sim_deque_push(&self->dq, job) == 0)
+        posted++;
+    if (posted > 1) sim_pool_wake(pool);
+    // Entries that did not fit run here before any of the posted ones
+    while (posted++ < job->nw)
+        sim_pool_exec(pool, job, self->w);
+
+    while (__atomic_load_n(&job->pending, __ATOMIC_ACQUIRE)) {
+        sim_job *other = sim_deque_pop(&self->dq);
+
+        if (!other) other = sim_pool_steal(self);
+        if (other) sim_pool_exec(pool, other, self->w);
+        else sched_yield();
+    }
+}
+
+/*
+ * Runs a job posted from outside @pool: the slices go to the injection
+ * queue and the caller sleeps until they finished. @busy is read-held.
+ */
+static void sim_pool_run_external(sim_pool *pool, sim_job *job) {
+    job->external = 1;
+    job->unposted = job->nw;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) pool->tail->next = job;
+    else pool->head = job;
+    pool->tail = job;
+    __atomic_add_fetch(&pool->injected, job->nw, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&pool->lock);
+    sim_pool_wake(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (!job->done)
+        pthread_cond_wait(&pool->done_cv, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Posts @nw slices of @fn to the calling thread's pool and waits for them.
+ * Returns -1, without running anything, if the pool has fewer than two
+ * workers; @nw is capped to the number of workers.
+ */
+static int sim_pool_post(unsigned int nw, sim_pool_fn fn, void *ctx, int exclusive) {
+    sim_pool *pool = sim_pool_get();
+    sim_job job = { .fn = fn, .ctx = ctx };
+
+    if (sim_pool_self && sim_pool_self->pool == pool && !exclusive) {
+        job.nw = nw > pool->threads ? pool->threads : nw;
+        job.pending = job.nw;
+        memset(job.claimed, 0, job.nw);
+        sim_pool_run_nested(sim_pool_self, &job);
+        return 0;
+    }
+
+    pthread_rwlock_rdlock(&pool->busy);
+    pthread_mutex_lock(&pool->submit);
+    if (!pool->threads) sim_pool_start(pool);
+    job.nw = nw > pool->threads ? pool->threads : nw;
+    pthread_mutex_unlock(&pool->submit);
+    if (pool->threads <= 1 || job.nw < 1) {
+        pthread_rwlock_unlock(&pool->busy);
+        return -1;
+    }
+    job.pending = job.nw;
+    memset(job.claimed, 0, job.nw);
+    sim_pool_run_external(pool, &job);
+    pthread_rwlock_unlock(&pool->busy);
+    return 0;
+}
+
+/**
+ * sim_pool_run - Runs @fn(ctx, w, nw) for every slice w and waits for all of them.
+ * @nw: Number of slices requested; capped to the number of workers.
+ * @fn: Callback; it may touch only @ctx and what @ctx points to.
+ * @ctx: Callback context.
+ *
+ * On an idle pool slice w runs on worker w, so a caller that partitions its
+ * data with sim_pool_split() gets the same worker for the same memory on
+ * every call; busy workers leave their slices to be stolen. Called from a
+ * worker task, the job runs on that worker and whichever workers are idle.
+ * With one slice, or no pool, @fn runs once on the calling thread as
+ * @fn(ctx, 0, 1).
+ */
+void sim_pool_run(unsigned int nw, sim_pool_fn fn, void *ctx) {
+    if (nw <= 1 || sim_pool_post(nw, fn, ctx, 0))
+        fn(ctx, 0, 1);
+}
+
+/**
+ * sim_pool_run_exclusive - Runs @nw tasks that each take over a worker.
+ * @nw: Number of tasks; capped to the number of workers.
+ * @fn: Callback, run as @fn(ctx, w, nw) for every task w. It may set up
+ *      thread-local state (a runtime context) and submit sweeps of its own,
+ *      which then run on the worker and on idle workers.
+ * @ctx: Callback context.
+ *
+ * A worker runs at most one exclusive task at a time and never starts one
+ * while it waits inside another, so the state a task sets up is its own
+ * until it returns.
+ *
+ * Returns 0 once every task ran, or -1 without running any if the pool has
+ * fewer than two workers or the caller is a pool worker; the caller must
+ * then provide threads of its own.
+ */
+int sim_pool_run_exclusive(unsigned int nw, sim_pool_fn fn, void *ctx) {
+    if (sim_pool_self || nw < 1) return -1;
+    return sim_pool_post(nw, fn, ctx, 1);
+}
@@ -0,0 +1,40 @@
+#ifndef NYMYA_SIM_POOL_H
+#define NYMYA_SIM_POOL_H
+
+#include <stddef.h>
+
+// Upper bound on simulator worker threads
+#define SIM_POOL_MAX_THREADS 256
+
+// Amplitudes per worker below which a register sweep stays on one thread (256 KiB)
+#define SIM_POOL_MIN_AMPS ((size_t)1 << 14)
+
+// Split points are rounded to this many amplitudes, one 4 KiB page
+#define SIM_POOL_CHUNK_AMPS ((size_t)256)
+
+/**
+ * sim_pool_fn - Work callback; runs once per slice.
+ * @ctx: Job context.
+ * @w: Slice index, 0 to @nw - 1.
+ * @nw: Number of slices in the job.
+ */
+typedef void (*sim_pool_fn)(void *ctx, unsigned int w, unsigned int nw);
+
+typedef struct sim_pool sim_pool;
+
+sim_pool *sim_pool_new(unsigned int threads);
+void sim_pool_free(sim_pool *pool);
+void sim_pool_use(sim_pool *pool);
+sim_pool *sim_pool_current(void);
+
+// The functions below act on the calling thread's pool
+
+int sim_pool_set_threads(unsigned int threads);
+unsigned int sim_pool_threads(void);
+
+unsigned int sim_pool_workers(size_t amps);
+size_t sim_pool_split(size_t n, unsigned int w, unsigned int nw);
+void sim_pool_run(unsigned int nw, sim_pool_fn fn, void *ctx);
+int sim_pool_run_exclusive(unsigned int nw, sim_pool_fn fn, void *ctx);
+
+#endif // NYMYA_SIM_POOL_H
@@ -0,0 +1,194 @@
+// sim_snap.c
+//
+// In-memory snapshots of the state-vector register for branching runs. A
+// snapshot copies the amplitudes once into an anonymous memory file (memfd)
+// and seals it against writes. A branch maps that file privately and adopts
+// the mapping as its register, as a checkpoint restore adopts a file
+// mapping (see sim_ckpt.c): reads come from the snapshot's pages, and the
+// kernel copies a 4 KiB page only when a branch first writes it. Hundreds
+// of branches off one wide prefix state each pay for the pages their own
+// gates touch, not for the whole array.
+//
+// The register a snapshot is taken from becomes a branch too, so the
+// prefix state is held once, by the memfd, however many branches follow.
+// The memfd stays in normal pages: huge pages would make every first write
+// copy 2 MiB. Closing a snapshot drops the file; branches that map it keep
+// it alive until they are freed or grow.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <complex.h>
+#include "sim_snap.h"
+#include "sim_pool.h"
+
+/**
+ * sim_snap_job - Parallel copy of the register into the memfd.
+ * @src: Register amplitudes.
+ * @dst: Shared mapping of the memfd.
+ * @bytes: Length of @src.
+ * @esz: Bytes per amplitude.
+ */
+typedef struct sim_snap_job {
+    const char *src;
+    char *dst;
+    size_t bytes;
+    size_t esz;
+} sim_snap_job;
+
+static void sim_snap_copy_slice(void *ctx, unsigned int w, unsigned int nw) {
+    sim_snap_job *job = ctx;
+    size_t n = job->bytes / job->esz;
+    size_t lo = sim_pool_split(n, w, nw) * job->esz;
+    size_t hi = sim_pool_split(n, w + 1, nw) * job->esz;
+
+    memcpy(job->dst + lo, job->src + lo, hi - lo);
+}
+
+// Bytes per amplitude at a precision
+static size_t sim_snap_amp_size(sim_sv_precision precision) {
+    return precision == SIM_SV_DOUBLE ? sizeof(double complex) : sizeof(float complex);
+}
+
+/**
+ * sim_snap_map - Maps a snapshot privately and hands it to a register.
+ * @s: Snapshot.
+ * @sv: Register; its old array is released.
+ *
+ * Returns 0 on success, -1 if the mapping fails (@sv is then unchanged).
+ */
+static int sim_snap_map(const sim_snap *s, sim_sv *sv) {
+    void *map = mmap(NULL, s->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, s->fd, 0);
+
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[sim snap] Cannot map a snapshot of %u qubits: %s\n", s->nqubits,
+                strerror(errno));
+        return -1;
+    }
+    sim_sv_adopt(sv, map, map, s->len);
+    sv->dim = s->dim;
+    sv->nqubits = s->nqubits;
+    sv->precision = s->precision;
+    memcpy(sv->ids, s->ids, sizeof(sv->ids));
+    return 0;
+}
+
+/**
+ * sim_snap_take - Freezes a register into a snapshot.
+ * @s: Receives the snapshot; release it with sim_snap_close().
+ * @sv: Register; on success it continues as a branch of @s.
+ *
+ * The sim_pool workers copy the array into a new memfd, which is then
+ * sealed so no mapping can write it. @sv drops its own array for a private
+ * mapping of the file. Pending fused gates must be flushed first.
+ *
+ * Returns 0 on success, -1 if the memfd cannot be created, sized or mapped.
+ */
+int sim_snap_take(sim_snap *s, sim_sv *sv) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    sim_snap_job job = { .src = (const char *)sv->amp, .esz = sim_snap_amp_size(sv->precision) };
+    void *dst;
+
+    memset(s, 0, sizeof(*s));
+    job.bytes = sv->dim * job.esz;
+    s->len = (job.bytes + page - 1) / page * page;
+    s->dim = sv->dim;
+    s->nqubits = sv->nqubits;
+    s->precision = sv->precision;
+    memcpy(s->ids, sv->ids, sizeof(s->ids));
+
+    s->fd = memfd_create("nymya-snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (s->fd < 0 || ftruncate(s->fd, (off_t)s->len)) goto fail;
+    dst = mmap(NULL, s->len, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (dst == MAP_FAILED) goto fail;
+    job.dst = dst;
+    sim_pool_run(sim_pool_workers(sv->dim), sim_snap_copy_slice, &job);
+    munmap(dst, s->len);
+
+    // Only private mappings remain possible; a branch's writes stay its own
+    if (fcntl(s->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL))
+        goto fail;
+    if (sim_snap_map(s, sv)) {
+        sim_snap_close(s);
+        return -1;
+    }
+    return 0;
+
+fail:
+    fprintf(stderr, "[sim snap] Cannot snapshot a register of %u qubits: %s\n", sv->nqubits,
+            strerror(errno));
+    sim_snap_close(s);
+    return -1;
+}
+
+/**
+ * sim_snap_branch - Starts a register from a snapshot.
+ * @s: Snapshot from sim_snap_take(); only read, so threads share it.
+ * @sv: Register; its old array is released.
+ *
+ * Nothing is copied: pages load from @s as gates read them and become
+ * private to @sv as gates write them.
+ *
+ * Returns 0 on success, -1 if the mapping fails.
+ */
+int sim_snap_branch(const sim_snap *s, sim_sv *sv) {
+    return sim_snap_map(s, sv);
+}
+
+/**
+ * sim_snap_close - Releases a snapshot.
+ * @s: Snapshot; may be one sim_snap_take() failed on.
+ *
+ * Branches keep their mappings and stay valid.
+ */
+void sim_snap_close(sim_snap *s) {
+    if (s->fd >= 0) close(s->fd);
+    s->fd = -1;
+}
+
+// Amplitude bytes a snapshot holds, rounded to whole pages
+size_t sim_snap_bytes(const sim_snap *s) {
+    return s->len;
+}
+
+/**
+ * sim_snap_private - Bytes a branch has copied out of its snapshot.
+ * @sv: Register.
+ * @out: Receives the bytes of @sv's array that are private copies, read
+ *       from /proc/self/smaps; all of the array if it is not a mapping.
+ *
+ * Returns 0 on success, -1 if /proc/self/smaps cannot be read.
+ */
+int sim_snap_private(const sim_sv *sv, size_t *out) {
+    unsigned long lo = (unsigned long)(uintptr_t)sv->map;
+    unsigned long hi = lo + sv->map_len;
+    int inside = 0;
+    char line[512];
+    FILE *f;
+
+    *out = 0;
+    if (!sv->map) {
+        *out = sv->dim * sim_snap_amp_size(sv->precision);
+        return 0;
+    }
+    f = fopen("/proc/self/smaps", "r");
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long start, end, kb;
+
+        // The kernel may split the mapping; every piece inside it counts
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+            inside = start >= lo && end <= hi;
+        else if (inside && sscanf(line, "Anonymous: %lu kB", &kb) == 1)
+            *out += (size_t)kb << 10;
+    }
+    fclose(f);
+    return 0;
+}
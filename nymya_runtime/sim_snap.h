@@ -0,0 +1,32 @@
+#ifndef NYMYA_SIM_SNAP_H
+#define NYMYA_SIM_SNAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sim_statevec.h"
+
+/**
+ * sim_snap - A frozen copy of a register that branches map copy-on-write.
+ * @fd: Sealed memfd holding the amplitude array.
+ * @len: Length of the memfd, the array rounded up to whole pages.
+ * @dim: Amplitudes in the array.
+ * @nqubits: Register width.
+ * @precision: Amplitude storage.
+ * @ids: Qubit ID of each slot.
+ */
+typedef struct sim_snap {
+    int fd;
+    size_t len;
+    size_t dim;
+    unsigned int nqubits;
+    sim_sv_precision precision;
+    uint64_t ids[SIM_SV_MAX_QUBITS];
+} sim_snap;
+
+int sim_snap_take(sim_snap *s, sim_sv *sv);
+int sim_snap_branch(const sim_snap *s, sim_sv *sv);
+void sim_snap_close(sim_snap *s);
+size_t sim_snap_bytes(const sim_snap *s);
+int sim_snap_private(const sim_sv *sv, size_t *out);
+
+#endif // NYMYA_SIM_SNAP_H
@@ -0,0 +1,1512 @@
+// sim_statevec.c
+//
+// State-vector engine behind the simulator backend. Holds a dense 2^n
+// complex register and applies dense 1-, 2- and 3-qubit unitaries to it.
+//
+// Every kernel walks the register in runs of 2^p contiguous basis states,
+// where p is the lowest target bit. Each run touches 2^k contiguous streams
+// (k = number of targets), so every amplitude is loaded and stored exactly once
+// per gate and the inner loop is unit-stride. The inner loop is vectorised
+// over the run: AVX-512 or AVX2+FMA on x86 (selected at run time), NEON on
+// AArch64, with a portable scalar loop for runs shorter than one vector.
+// Gates that only permute basis states, with phases of +-1 or +-i (X, CNOT,
+// SWAP, Toffoli, Fredkin, ...), skip the matrix: each run just moves the
+// amplitudes the gate changes.
+//
+// A register stores double or float amplitudes (sim_sv_precision). The float
+// kernels mirror the double ones with twice the amplitudes per vector, so a
+// float register needs half the memory and half the bandwidth per gate.
+//
+// Large registers are swept by the sim_pool workers, one slice each. Slices
+// are cut in the same place for every sweep, and because the lowest target
+// bits stay inside a slice, a gate that acts below the slice size only
+// touches memory its worker owns. Arrays of 2 MiB and up come from sim_mem.c
+// on huge pages, so gates on the high qubits are not TLB-bound.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include "sim_statevec.h"
+#include "sim_pool.h"
+#include "sim_mem.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIM_SV_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SIM_SV_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Alignment of the amplitude array; one cache line, and one AVX-512 vector
+#define SIM_SV_ALIGN 64
+
+typedef void (*sim_sv_run_fn)(double complex *amp, size_t base, size_t run,
+                              const size_t *off, const double complex *m);
+typedef void (*sim_sv_runf_fn)(float complex *amp, size_t base, size_t run,
+                               const size_t *off, const float complex *m);
+
+/**
+ * sim_sv_run_scalar - Applies an MxM matrix to one run of basis states (portable).
+ * @amp: Register.
+ * @base: First basis state of the run, with every target bit clear.
+ * @run: Number of consecutive basis states in the run.
+ * @off: Index offset of each of the M target bit patterns.
+ * @m: Row-major MxM matrix.
+ * @dim_m: M, the matrix dimension (2, 4 or 8).
+ */
+static inline void sim_sv_run_scalar(double complex *amp, size_t base, size_t run,
+                                     const size_t *off, const double complex *m,
+                                     unsigned int dim_m) {
+    for (size_t j = 0; j < run; j++) {
+        double complex *a = amp + base + j;
+        double complex x[8];
+
+        for (unsigned int s = 0; s < dim_m; s++)
+            x[s] = a[off[s]];
+        for (unsigned int r = 0; r < dim_m; r++) {
+            double complex acc = 0;
+
+            for (unsigned int s = 0; s < dim_m; s++)
+                acc += m[r * dim_m + s] * x[s];
+            a[off[r]] = acc;
+        }
+    }
+}
+
+static void sim_sv_run2_scalar(double complex *amp, size_t base, size_t run,
+                               const size_t *off, const double complex *m) {
+    sim_sv_run_scalar(amp, base, run, off, m, 2);
+}
+
+static void sim_sv_run4_scalar(double complex *amp, size_t base, size_t run,
+                               const size_t *off, const double complex *m) {
+    sim_sv_run_scalar(amp, base, run, off, m, 4);
+}
+
+static void sim_sv_run8_scalar(double complex *amp, size_t base, size_t run,
+                               const size_t *off, const double complex *m) {
+    sim_sv_run_scalar(amp, base, run, off, m, 8);
+}
+
+// Float counterpart of sim_sv_run_scalar()
+static inline void sim_sv_runf_scalar(float complex *amp, size_t base, size_t run,
+                                      const size_t *off, const float complex *m,
+                                      unsigned int dim_m) {
+    for (size_t j = 0; j < run; j++) {
+        float complex *a = amp + base + j;
+        float complex x[8];
+
+        for (unsigned int s = 0; s < dim_m; s++)
+            x[s] = a[off[s]];
+        for (unsigned int r = 0; r < dim_m; r++) {
+            float complex acc = 0;
+
+            for (unsigned int s = 0; s < dim_m; s++)
+                acc += m[r * dim_m + s] * x[s];
+            a[off[r]] = acc;
+        }
+    }
+}
+
+static void sim_sv_runf2_scalar(float complex *amp, size_t base, size_t run,
+                                const size_t *off, const float complex *m) {
+    sim_sv_runf_scalar(amp, base, run, off, m, 2);
+}
+
+static void sim_sv_runf4_scalar(float complex *amp, size_t base, size_t run,
+                                const size_t *off, const float complex *m) {
+    sim_sv_runf_scalar(amp, base, run, off, m, 4);
+}
+
+static void sim_sv_runf8_scalar(float complex *amp, size_t base, size_t run,
+                                const size_t *off, const float complex *m) {
+    sim_sv_runf_scalar(amp, base, run, off, m, 8);
+}
+
+/*
+ * The vector kernels hold interleaved (re, im) pairs. For a matrix entry
+ * a + bi they keep A = (a, a, ...) and B = (-b, b, ...), so that
+ * x * (a + bi) = x * A + swap(x) * B, where swap() exchanges re and im.
+ * That is two FMAs per entry with no shuffles in the accumulation.
+ */
+
+#ifdef SIM_SV_X86
+
+__attribute__((target("avx2,fma")))
+static inline void sim_sv_run_avx2(double complex *amp, size_t base, size_t run,
+                                   const size_t *off, const double complex *m,
+                                   unsigned int dim_m) {
+    __m256d ma[64], mb[64];
+    double *p = (double *)(amp + base);
+
+    for (unsigned int e = 0; e < dim_m * dim_m; e++) {
+        double re = creal(m[e]), im = cimag(m[e]);
+
+        ma[e] = _mm256_set1_pd(re);
+        mb[e] = _mm256_setr_pd(-im, im, -im, im);
+    }
+
+    // Two amplitudes per vector; run is a power of two >= 2 here
+    for (size_t j = 0; j < run; j += 2) {
+        __m256d x[8], xs[8];
+
+        for (unsigned int s = 0; s < dim_m; s++) {
+            x[s] = _mm256_loadu_pd(p + 2 * (j + off[s]));
+            xs[s] = _mm256_permute_pd(x[s], 0x5);
+        }
+        for (unsigned int r = 0; r < dim_m; r++) {
+            const __m256d *ra = ma + r * dim_m, *rb = mb + r * dim_m;
+            __m256d acc = _mm256_mul_pd(x[0], ra[0]);
+
+            acc = _mm256_fmadd_pd(xs[0], rb[0], acc);
+            for (unsigned int s = 1; s < dim_m; s++) {
+                acc = _mm256_fmadd_pd(x[s], ra[s], acc);
+                acc = _mm256_fmadd_pd(xs[s], rb[s], acc);
+            }
+            _mm256_storeu_pd(p + 2 * (j + off[r]), acc);
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void sim_sv_run2_avx2(double complex *amp, size_t base, size_t run,
+                             const size_t *off, const double complex *m) {
+    sim_sv_run_avx2(amp, base, run, off, m, 2);
+}
+
+__attribute__((target("avx2,fma")))
+static void sim_sv_run4_avx2(double complex *amp, size_t base, size_t run,
+                             const size_t *off, const double complex *m) {
+    sim_sv_run_avx2(amp, base, run, off, m, 4);
+}
+
+__attribute__((target("avx2,fma")))
+static void sim_sv_run8_avx2(double complex *amp, size_t base, size_t run,
+                             const size_t *off, const double complex *m) {
+    sim_sv_run_avx2(amp, base, run, off, m, 8);
+}
+
+__attribute__((target("avx512f")))
+static inline void sim_sv_run_avx512(double complex *amp, size_t base, size_t run,
+                                     const size_t *off, const double complex *m,
+                                     unsigned int dim_m) {
+    __m512d ma[64], mb[64];
+    double *p = (double *)(amp + base);
+
+    for (unsigned int e = 0; e < dim_m * dim_m; e++) {
+        double re = creal(m[e]), im = cimag(m[e]);
+
+        ma[e] = _mm512_set1_pd(re);
+        mb[e] = _mm512_setr_pd(-im, im, -im, im, -im, im, -im, im);
+    }
+
+    // Four amplitudes per vector; run is a power of two >= 4 here
+    for (size_t j = 0; j < run; j += 4) {
+        __m512d x[8], xs[8];
+
+        for (unsigned int s = 0; s < dim_m; s++) {
+            x[s] = _mm512_loadu_pd(p + 2 * (j + off[s]));
+            xs[s] = _mm512_permute_pd(x[s], 0x55);
+        }
+        for (unsigned int r = 0; r < dim_m; r++) {
+            const __m512d *ra = ma + r * dim_m, *rb = mb + r * dim_m;
+            __m512d acc = _mm512_mul_pd(x[0], ra[0]);
+
+            acc = _mm512_fmadd_pd(xs[0], rb[0], acc);
+            for (unsigned int s = 1; s < dim_m; s++) {
+                acc = _mm512_fmadd_pd(x[s], ra[s], acc);
+                acc = _mm512_fmadd_pd(xs[s], rb[s], acc);
+            }
+            _mm512_storeu_pd(p + 2 * (j + off[r]), acc);
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static void sim_sv_run2_avx512(double complex *amp, size_t base, size_t run,
+                               const size_t *off, const double complex *m) {
+    sim_sv_run_avx512(amp, base, run, off, m, 2);
+}
+
+__attribute__((target("avx512f")))
+static void sim_sv_run4_avx512(double complex *amp, size_t base, size_t run,
+                               const size_t *off, const double complex *m) {
+    sim_sv_run_avx512(amp, base, run, off, m, 4);
+}
+
+__attribute__((target("avx512f")))
+static void sim_sv_run8_avx512(double complex *amp, size_t base, size_t run,
+                               const size_t *off, const double complex *m) {
+    sim_sv_run_avx512(amp, base, run, off, m, 8);
+}
+
+__attribute__((target("avx2,fma")))
+static inline void sim_sv_runf_avx2(float complex *amp, size_t base, size_t run,
+                                    const size_t *off, const float complex *m,
+                                    unsigned int dim_m) {
+    __m256 ma[64], mb[64];
+    float *p = (float *)(amp + base);
+
+    for (unsigned int e = 0; e < dim_m * dim_m; e++) {
+        float re = crealf(m[e]), im = cimagf(m[e]);
+
+        ma[e] = _mm256_set1_ps(re);
+        mb[e] = _mm256_setr_ps(-im, im, -im, im, -im, im, -im, im);
+    }
+
+    // Four amplitudes per vector; run is a power of two >= 4 here
+    for (size_t j = 0; j < run; j += 4) {
+        __m256 x[8], xs[8];
+
+        for (unsigned int s = 0; s < dim_m; s++) {
+            x[s] = _mm256_loadu_ps(p + 2 * (j + off[s]));
+            xs[s] = _mm256_permute_ps(x[s], 0xB1);
+        }
+        for (unsigned int r = 0; r < dim_m; r++) {
+            const __m256 *ra = ma + r * dim_m, *rb = mb + r * dim_m;
+            __m256 acc = _mm256_mul_ps(x[0], ra[0]);
+
+            acc = _mm256_fmadd_ps(xs[0], rb[0], acc);
+            for (unsigned int s = 1; s < dim_m; s++) {
+                acc = _mm256_fmadd_ps(x[s], ra[s], acc);
+                acc = _mm256_fmadd_ps(xs[s], rb[s], acc);
+            }
+            _mm256_storeu_ps(p + 2 * (j + off[r]), acc);
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void sim_sv_runf2_avx2(float complex *amp, size_t base, size_t run,
+                              const size_t *off, const float complex *m) {
+    sim_sv_runf_avx2(amp, base, run, off, m, 2);
+}
+
+__attribute__((target("avx2,fma")))
+static void sim_sv_runf4_avx2(float complex *amp, size_t base, size_t run,
+                              const size_t *off, const float complex *m) {
+    sim_sv_runf_avx2(amp, base, run, off, m, 4);
+}
+
+__attribute__((target("avx2,fma")))
+static void sim_sv_runf8_avx2(float complex *amp, size_t base, size_t run,
+                              const size_t *off, const float complex *m) {
+    sim_sv_runf_avx2(amp, base, run, off, m, 8);
+}
+
+__attribute__((target("avx512f")))
+static inline void sim_sv_runf_avx512(float complex *amp, size_t base, size_t run,
+                                      const size_t *off, const float complex *m,
+                                      unsigned int dim_m) {
+    __m512 ma[64], mb[64];
+    float *p = (float *)(amp + base);
+
+    for (unsigned int e = 0; e < dim_m * dim_m; e++) {
+        float re = crealf(m[e]), im = cimagf(m[e]);
+
+        ma[e] = _mm512_set1_ps(re);
+        mb[e] = _mm512_setr_ps(-im, im, -im, im, -im, im, -im, im,
+                               -im, im, -im, im, -im, im, -im, im);
+    }
+
+    // Eight amplitudes per vector; run is a power of two >= 8 here
+    for (size_t j = 0; j < run; j += 8) {
+        __m512 x[8], xs[8];
+
+        for (unsigned int s = 0; s < dim_m; s++) {
+            x[s] = _mm512_loadu_ps(p + 2 * (j + off[s]));
+            xs[s] = _mm512_permute_ps(x[s], 0xB1);
+        }
+        for (unsigned int r = 0; r < dim_m; r++) {
+            const __m512 *ra = ma + r * dim_m, *rb = mb + r * dim_m;
+            __m512 acc = _mm512_mul_ps(x[0], ra[0]);
+
+            acc = _mm512_fmadd_ps(xs[0], rb[0], acc);
+            for (unsigned int s = 1; s < dim_m; s++) {
+                acc = _mm512_fmadd_ps(x[s], ra[s], acc);
+                acc = _mm512_fmadd_ps(xs[s], rb[s], acc);
+            }
+            _mm512_storeu_ps(p + 2 * (j + off[r]), acc);
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static void sim_sv_runf2_avx512(float complex *amp, size_t base, size_t run,
+                                const size_t *off, const float complex *m) {
+    sim_sv_runf_avx512(amp, base, run, off, m, 2);
+}
+
+__attribute__((target("avx512f")))
+static void sim_sv_runf4_avx512(float complex *amp, size_t base, size_t run,
+                                const size_t *off, const float complex *m) {
+    sim_sv_runf_avx512(amp, base, run, off, m, 4);
+}
+
+__attribute__((target("avx512f")))
+static void sim_sv_runf8_avx512(float complex *amp, size_t base, size_t run,
+                                const size_t *off, const float complex *m) {
+    sim_sv_runf_avx512(amp, base, run, off, m, 8);
+}
+
+#endif // SIM_SV_X86
+
+#ifdef SIM_SV_NEON
+
+static inline void sim_sv_run_neon(double complex *amp, size_t base, size_t run,
+                                   const size_t *off, const double complex *m,
+                                   unsigned int dim_m) {
+    float64x2_t ma[64], mb[64];
+    double *p = (double *)(amp + base);
+
+    for (unsigned int e = 0; e < dim_m * dim_m; e++) {
+        double re = creal(m[e]), im = cimag(m[e]);
+        double b[2] = { -im, im };
+
+        ma[e] = vdupq_n_f64(re);
+        mb[e] = vld1q_f64(b);
+    }
+
+    // One amplitude per vector, so any run length works
+    for (size_t j = 0; j < run; j++) {
+        float64x2_t x[8], xs[8];
+
+        for (unsigned int s = 0; s < dim_m; s++) {
+            x[s] = vld1q_f64(p + 2 * (j + off[s]));
+            xs[s] = vextq_f64(x[s], x[s], 1);
+        }
+        for (unsigned int r = 0; r < dim_m; r++) {
+            const float64x2_t *ra = ma + r * dim_m, *rb = mb + r * dim_m;
+            float64x2_t acc = vmulq_f64(x[0], ra[0]);
+
+            acc = vfmaq_f64(acc, xs[0], rb[0]);
+            for (unsigned int s = 1; s < dim_m; s++) {
+                acc = vfmaq_f64(acc, x[s], ra[s]);
+                acc = vfmaq_f64(acc, xs[s], rb[s]);
+            }
+            vst1q_f64(p + 2 * (j + off[r]), acc);
+        }
+    }
+}
+
+static void sim_sv_run2_neon(double complex *amp, size_t base, size_t run,
+                             const size_t *off, const double complex *m) {
+    sim_sv_run_neon(amp, base, run, off, m, 2);
+}
+
+static void sim_sv_run4_neon(double complex *amp, size_t base, size_t run,
+                             const size_t *off, const double complex *m) {
+    sim_sv_run_neon(amp, base, run, off, m, 4);
+}
+
+static void sim_sv_run8_neon(double complex *amp, size_t base, size_t run,
+                             const size_t *off, const double complex *m) {
+    sim_sv_run_neon(amp, base, run, off, m, 8);
+}
+
+static inline void sim_sv_runf_neon(float complex *amp, size_t base, size_t run,
+                                    const size_t *off, const float complex *m,
+                                    unsigned int dim_m) {
+    float32x4_t ma[64], mb[64];
+    float *p = (float *)(amp + base);
+
+    for (unsigned int e = 0; e < dim_m * dim_m; e++) {
+        float re = crealf(m[e]), im = cimagf(m[e]);
+        float b[4] = { -im, im, -im, im };
+
+        ma[e] = vdupq_n_f32(re);
+        mb[e] = vld1q_f32(b);
+    }
+
+    // Two amplitudes per vector; run is a power of two >= 2 here
+    for (size_t j = 0; j < run; j += 2) {
+        float32x4_t x[8], xs[8];
+
+        for (unsigned int s = 0; s < dim_m; s++) {
+            x[s] = vld1q_f32(p + 2 * (j + off[s]));
+            xs[s] = vrev64q_f32(x[s]);
+        }
+        for (unsigned int r = 0; r < dim_m; r++) {
+            const float32x4_t *ra = ma + r * dim_m, *rb = mb + r * dim_m;
+            float32x4_t acc = vmulq_f32(x[0], ra[0]);
+
+            acc = vfmaq_f32(acc, xs[0], rb[0]);
+            for (unsigned int s = 1; s < dim_m; s++) {
+                acc = vfmaq_f32(acc, x[s], ra[s]);
+                acc = vfmaq_f32(acc, xs[s], rb[s]);
+            }
+            vst1q_f32(p + 2 * (j + off[r]), acc);
+        }
+    }
+}
+
+static void sim_sv_runf2_neon(float complex *amp, size_t base, size_t run,
+                              const size_t *off, const float complex *m) {
+    sim_sv_runf_neon(amp, base, run, off, m, 2);
+}
+
+static void sim_sv_runf4_neon(float complex *amp, size_t base, size_t run,
+                              const size_t *off, const float complex *m) {
+    sim_sv_runf_neon(amp, base, run, off, m, 4);
+}
+
+static void sim_sv_runf8_neon(float complex *amp, size_t base, size_t run,
+                              const size_t *off, const float complex *m) {
+    sim_sv_runf_neon(amp, base, run, off, m, 8);
+}
+
+#endif // SIM_SV_NEON
+
+/**
+ * sim_sv_kernels - Run kernels for one instruction set, indexed by target count - 1.
+ * @name: Instruction set name reported by sim_sv_isa().
+ * @min_run: Shortest run the double kernels handle.
+ * @min_runf: Shortest run the float kernels handle.
+ * @narrower: Kernels used for runs shorter than @min_run (or @min_runf).
+ * @run: Double kernels for 1, 2 and 3 targets.
+ * @runf: Float kernels for 1, 2 and 3 targets.
+ */
+typedef struct sim_sv_kernels {
+    const char *name;
+    size_t min_run;
+    size_t min_runf;
+    const struct sim_sv_kernels *narrower;
+    sim_sv_run_fn run[3];
+    sim_sv_runf_fn runf[3];
+} sim_sv_kernels;
+
+static const sim_sv_kernels sim_sv_scalar_kernels = {
+    "scalar", 1, 1, NULL,
+    { sim_sv_run2_scalar, sim_sv_run4_scalar, sim_sv_run8_scalar },
+    { sim_sv_runf2_scalar, sim_sv_runf4_scalar, sim_sv_runf8_scalar },
+};
+
+#ifdef SIM_SV_X86
+static const sim_sv_kernels sim_sv_avx2_kernels = {
+    "avx2", 2, 4, &sim_sv_scalar_kernels,
+    { sim_sv_run2_avx2, sim_sv_run4_avx2, sim_sv_run8_avx2 },
+    { sim_sv_runf2_avx2, sim_sv_runf4_avx2, sim_sv_runf8_avx2 },
+};
+static const sim_sv_kernels sim_sv_avx512_kernels = {
+    "avx512", 4, 8, &sim_sv_avx2_kernels,
+    { sim_sv_run2_avx512, sim_sv_run4_avx512, sim_sv_run8_avx512 },
+    { sim_sv_runf2_avx512, sim_sv_runf4_avx512, sim_sv_runf8_avx512 },
+};
+#endif
+
+#ifdef SIM_SV_NEON
+static const sim_sv_kernels sim_sv_neon_kernels = {
+    "neon", 1, 2, &sim_sv_scalar_kernels,
+    { sim_sv_run2_neon, sim_sv_run4_neon, sim_sv_run8_neon },
+    { sim_sv_runf2_neon, sim_sv_runf4_neon, sim_sv_runf8_neon },
+};
+#endif
+
+static const sim_sv_kernels *sim_sv_best;
+
+// Picks the widest instruction set the CPU supports, once
+static const sim_sv_kernels *sim_sv_kernels_get(void) {
+    const sim_sv_kernels *k = __atomic_load_n(&sim_sv_best, __ATOMIC_ACQUIRE);
+
+    if (k) return k;
+
+    k = &sim_sv_scalar_kernels;
+#if defined(SIM_SV_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        k = &sim_sv_avx512_kernels;
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        k = &sim_sv_avx2_kernels;
+#elif defined(SIM_SV_NEON)
+    k = &sim_sv_neon_kernels;
+#endif
+    if (getenv("NYMYA_SIM_SCALAR"))
+        k = &sim_sv_scalar_kernels;
+
+    __atomic_store_n(&sim_sv_best, k, __ATOMIC_RELEASE);
+    return k;
+}
+
+/**
+ * sim_sv_isa - Names the instruction set the kernels run with.
+ *
+ * Returns "avx512", "avx2", "neon" or "scalar". Setting NYMYA_SIM_SCALAR in
+ * the environment forces the scalar kernels.
+ */
+const char *sim_sv_isa(void) {
+    return sim_sv_kernels_get()->name;
+}
+
+/**
+ * sim_sv_init - Initialises an empty register in the state |> (one amplitude, 1).
+ * @sv: Register to initialise.
+ *
+ * Returns 0 on success, -1 on allocation failure.
+ */
+int sim_sv_init(sim_sv *sv) {
+    memset(sv, 0, sizeof(*sv));
+    if (posix_memalign((void **)&sv->amp, SIM_SV_ALIGN, SIM_SV_ALIGN) != 0) {
+        sv->amp = NULL;
+        return -1;
+    }
+    sv->amp[0] = 1.0;
+    sv->dim = 1;
+    return 0;
+}
+
+// Frees or unmaps the amplitude array, whichever way the register got it
+static void sim_sv_release(sim_sv *sv) {
+    sim_mem_release(sv->amp, sv->map, sv->map_len);
+    sv->amp = NULL;
+    sv->map = NULL;
+    sv->map_len = 0;
+}
+
+/**
+ * sim_sv_free - Releases the amplitudes of a register.
+ * @sv: Register; left empty and must be re-initialised before reuse.
+ */
+void sim_sv_free(sim_sv *sv) {
+    sim_sv_release(sv);
+    memset(sv, 0, sizeof(*sv));
+}
+
+/**
+ * sim_sv_adopt - Gives a register an amplitude array it did not allocate.
+ * @sv: Register; its old array is released.
+ * @amp: Amplitudes, SIM_SV_ALIGN-aligned, from sim_mem_alloc() or inside @map.
+ * @map: Writable private mapping that holds @amp, unmapped once the register
+ *       replaces or frees the array; NULL if @amp is heap memory.
+ * @map_len: Length of @map.
+ *
+ * The caller sets dim, nqubits, precision and ids to describe @amp.
+ */
+void sim_sv_adopt(sim_sv *sv, void *amp, void *map, size_t map_len) {
+    sim_sv_release(sv);
+    sv->amp = amp;
+    sv->map = map;
+    sv->map_len = map_len;
+}
+
+/**
+ * sim_sv_find - Looks up the slot of a qubit.
+ * @sv: Register.
+ * @id: nymya_qubit ID.
+ *
+ * Returns the slot, or -1 if the qubit has not joined the register.
+ */
+int sim_sv_find(const sim_sv *sv, uint64_t id) {
+    for (unsigned int i = 0; i < sv->nqubits; i++) {
+        if (sv->ids[i] == id) return (int)i;
+    }
+    return -1;
+}
+
+// Bytes per amplitude of a register
+static size_t sim_sv_amp_size(const sim_sv *sv) {
+    return sv->precision == SIM_SV_DOUBLE ? sizeof(double complex) : sizeof(float complex);
+}
+
+/**
+ * sim_sv_grow_job - Copy of a register into its doubled array.
+ * @dst: New array of 2 * @old_dim amplitudes.
+ * @src: Old array.
+ * @old_dim: Amplitudes in @src; the upper half of @dst is zeroed.
+ * @esz: Bytes per amplitude.
+ */
+typedef struct sim_sv_grow_job {
+    char *dst;
+    const char *src;
+    size_t old_dim;
+    size_t esz;
+} sim_sv_grow_job;
+
+static void sim_sv_grow_slice(void *ctx, unsigned int w, unsigned int nw) {
+    sim_sv_grow_job *job = ctx;
+    size_t start = sim_pool_split(2 * job->old_dim, w, nw);
+    size_t end = sim_pool_split(2 * job->old_dim, w + 1, nw);
+    size_t mid = end < job->old_dim ? end : (start > job->old_dim ? start : job->old_dim);
+    size_t esz = job->esz;
+
+    if (mid > start) memcpy(job->dst + start * esz, job->src + start * esz, (mid - start) * esz);
+    if (end > mid) memset(job->dst + mid * esz, 0, (end - mid) * esz);
+}
+
+/**
+ * sim_sv_qubit - Looks up the slot of a qubit, adding it in |0> if it is new.
+ * @sv: Register.
+ * @id: nymya_qubit ID.
+ *
+ * Adding a qubit doubles the register; the existing amplitudes stay in place
+ * and the new upper half is zeroed.
+ *
+ * Returns the slot, or -1 if the register is full or cannot grow.
+ */
+int sim_sv_qubit(sim_sv *sv, uint64_t id) {
+    int slot = sim_sv_find(sv, id);
+    sim_sv_grow_job job;
+    void *map;
+    size_t map_len;
+
+    if (slot >= 0) return slot;
+    if (sv->nqubits >= SIM_SV_MAX_QUBITS) return -1;
+
+    job.esz = sim_sv_amp_size(sv);
+    job.dst = sim_mem_alloc(2 * sv->dim * job.esz, SIM_SV_ALIGN, &map, &map_len);
+    if (!job.dst) return -1;
+
+    // The workers fill the new array so each slice is first touched by its owner
+    job.src = (const char *)sv->amp;
+    job.old_dim = sv->dim;
+    sim_pool_run(sim_pool_workers(2 * sv->dim), sim_sv_grow_slice, &job);
+    sim_sv_adopt(sv, job.dst, map, map_len);
+    sv->dim *= 2;
+    sv->ids[sv->nqubits] = id;
+    return (int)sv->nqubits++;
+}
+
+/**
+ * sim_sv_convert_job - Copy of a register into an array of another precision.
+ * @sv: Register, still holding the old array.
+ * @dst: New array of @sv->dim amplitudes.
+ * @to_float: Non-zero for double -> float, zero for float -> double.
+ */
+typedef struct sim_sv_convert_job {
+    const sim_sv *sv;
+    void *dst;
+    int to_float;
+} sim_sv_convert_job;
+
+static void sim_sv_convert_slice(void *ctx, unsigned int w, unsigned int nw) {
+    sim_sv_convert_job *job = ctx;
+    size_t end = sim_pool_split(job->sv->dim, w + 1, nw);
+
+    for (size_t i = sim_pool_split(job->sv->dim, w, nw); i < end; i++) {
+        if (job->to_float) ((float complex *)job->dst)[i] = (float complex)job->sv->amp[i];
+        else ((double complex *)job->dst)[i] = job->sv->ampf[i];
+    }
+}
+
+/**
+ * sim_sv_set_precision - Changes how a register stores its amplitudes.
+ * @sv: Register.
+ * @precision: New storage mode.
+ *
+ * Moving between double and float storage converts the amplitudes in
+ * parallel; SIM_SV_FLOAT and SIM_SV_MIXED share the same array.
+ *
+ * Returns 0 on success, -1 on allocation failure (the register is unchanged).
+ */
+int sim_sv_set_precision(sim_sv *sv, sim_sv_precision precision) {
+    sim_sv_convert_job job = { .sv = sv };
+    void *map;
+    size_t esz, map_len;
+
+    if ((precision == SIM_SV_DOUBLE) == (sv->precision == SIM_SV_DOUBLE)) {
+        sv->precision = precision;
+        return 0;
+    }
+
+    job.to_float = precision != SIM_SV_DOUBLE;
+    esz = job.to_float ? sizeof(float complex) : sizeof(double complex);
+    job.dst = sim_mem_alloc(sv->dim * esz, SIM_SV_ALIGN, &map, &map_len);
+    if (!job.dst) return -1;
+
+    sim_pool_run(sim_pool_workers(sv->dim), sim_sv_convert_slice, &job);
+    sim_sv_adopt(sv, job.dst, map, map_len);
+    sv->precision = precision;
+    return 0;
+}
+
+/**
+ * sim_sv_set - Overwrites one amplitude, in the register's precision.
+ * @sv: Register.
+ * @i: Basis state, below @sv->dim.
+ * @a: Amplitude.
+ */
+void sim_sv_set(sim_sv *sv, size_t i, double complex a) {
+    if (sv->precision == SIM_SV_DOUBLE) sv->amp[i] = a;
+    else sv->ampf[i] = (float complex)a;
+}
+
+/**
+ * sim_sv_apply_job - One gate, as shared by the workers sweeping it.
+ * @sv: Register.
+ * @kern: Kernel set, already narrowed for @run.
+ * @k: Number of targets.
+ * @sorted: Target slots, ascending.
+ * @off: Index offset of each target bit pattern.
+ * @run: Contiguous basis states per run (1 << @sorted[0]).
+ * @groups: Basis states with every target bit clear (dim >> @k).
+ * @m: Row-major matrix.
+ * @mf: @m rounded to float, used when the register stores floats.
+ * @nmoved: For a permutation gate, the number of amplitudes it moves or
+ *          turns; 0 runs @kern instead.
+ * @src: Offset each moved amplitude is read from.
+ * @dst: Offset it is written to.
+ * @turn: Quarter turns it is rotated by.
+ */
+typedef struct sim_sv_apply_job {
+    sim_sv *sv;
+    const sim_sv_kernels *kern;
+    unsigned int k;
+    unsigned int sorted[3];
+    size_t off[8];
+    size_t run;
+    size_t groups;
+    const double complex *m;
+    float complex mf[64];
+    unsigned int nmoved;
+    size_t src[8];
+    size_t dst[8];
+    unsigned char turn[8];
+} sim_sv_apply_job;
+
+/**
+ * sim_sv_perm_of - Checks whether a gate only permutes basis states.
+ * @m: Row-major 2^k x 2^k matrix.
+ * @k: Number of targets, 1 to 3.
+ * @p: Receives the permutation when it does.
+ *
+ * X, CNOT, SWAP, Toffoli, Fredkin and the like, and their products, have one
+ * nonzero entry per row and column, each 1, i, -1 or -i; iSWAP and the
+ * fermionic swaps qualify through their phases.
+ *
+ * Returns 1 if @m is such a matrix, else 0.
+ */
+int sim_sv_perm_of(const double complex *m, unsigned int k, sim_sv_perm *p) {
+    static const double complex turns[4] = { 1, I, -1, -I };
+    unsigned int n = 1u << k, rows = 0;
+
+    for (unsigned int x = 0; x < n; x++) {
+        int hit = -1;
+
+        for (unsigned int y = 0; y < n; y++) {
+            double complex v = m[y * n + x];
+
+            if (v == 0) continue;
+            if (hit >= 0 || (rows & (1u << y))) return 0;
+            for (hit = 0; hit < 4 && v != turns[hit]; hit++)
+                ;
+            if (hit == 4) return 0;
+            p->turn[x] = (unsigned char)hit;
+            p->to[x] = (unsigned char)y;
+            rows |= 1u << y;
+        }
+        if (hit < 0) return 0;
+    }
+    return 1;
+}
+
+// Moves the amplitudes of a permutation gate along one run, without multiplies
+static void sim_sv_perm_run(const sim_sv_apply_job *job, size_t base, size_t run) {
+    unsigned int n = job->nmoved;
+
+    if (job->sv->precision == SIM_SV_DOUBLE) {
+        double *a = (double *)job->sv->amp;
+
+        for (size_t j = base; j < base + run; j++) {
+            double v[16];
+
+            for (unsigned int i = 0; i < n; i++) {
+                v[2 * i] = a[2 * (j + job->src[i])];
+                v[2 * i + 1] = a[2 * (j + job->src[i]) + 1];
+            }
+            for (unsigned int i = 0; i < n; i++) {
+                double *d = a + 2 * (j + job->dst[i]), re = v[2 * i], im = v[2 * i + 1];
+
+                switch (job->turn[i]) {
+                    case 0: d[0] = re;  d[1] = im;  break;
+                    case 1: d[0] = -im; d[1] = re;  break;
+                    case 2: d[0] = -re; d[1] = -im; break;
+                    case 3: d[0] = im;  d[1] = -re; break;
+                }
+            }
+        }
+    } else {
+        float *a = (float *)job->sv->ampf;
+
+        for (size_t j = base; j < base + run; j++) {
+            float v[16];
+
+            for (unsigned int i = 0; i < n; i++) {
+                v[2 * i] = a[2 * (j + job->src[i])];
+                v[2 * i + 1] = a[2 * (j + job->src[i]) + 1];
+            }
+            for (unsigned int i = 0; i < n; i++) {
+                float *d = a + 2 * (j + job->dst[i]), re = v[2 * i], im = v[2 * i + 1];
+
+                switch (job->turn[i]) {
+                    case 0: d[0] = re;  d[1] = im;  break;
+                    case 1: d[0] = -im; d[1] = re;  break;
+                    case 2: d[0] = -re; d[1] = -im; break;
+                    case 3: d[0] = im;  d[1] = -re; break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * sim_sv_apply_slice - Applies a gate to groups [start, end) of slice @w.
+ * @ctx: The sim_sv_apply_job.
+ * @w: Slice index.
+ * @nw: Number of slices.
+ *
+ * A slice boundary may fall inside a run; the run is then split and each half
+ * is passed to the kernel on its own. Boundaries are multiples of
+ * SIM_POOL_CHUNK_AMPS, so a split part is still a whole number of vectors.
+ */
+static void sim_sv_apply_slice(void *ctx, unsigned int w, unsigned int nw) {
+    const sim_sv_apply_job *job = ctx;
+    size_t g = sim_pool_split(job->groups, w, nw);
+    size_t end = sim_pool_split(job->groups, w + 1, nw);
+
+    while (g < end) {
+        size_t len = job->run - (g & (job->run - 1));
+        size_t base = g;
+
+        if (len > end - g) len = end - g;
+
+        // Spread g over the non-target bits: insert a zero at each target slot
+        for (unsigned int i = 0; i < job->k; i++) {
+            size_t low = base & (((size_t)1 << job->sorted[i]) - 1);
+            base = ((base >> job->sorted[i]) << (job->sorted[i] + 1)) | low;
+        }
+        if (job->nmoved)
+            sim_sv_perm_run(job, base, len);
+        else if (job->sv->precision == SIM_SV_DOUBLE)
+            job->kern->run[job->k - 1](job->sv->amp, base, len, job->off, job->m);
+        else
+            job->kern->runf[job->k - 1](job->sv->ampf, base, len, job->off, job->mf);
+        g += len;
+    }
+}
+
+/**
+ * sim_sv_apply - Applies a dense 2^k x 2^k unitary to @k target slots.
+ * @sv: Register.
+ * @t: Target slots; t[0] is the most significant bit of the matrix index.
+ * @k: Number of targets (1 to 3).
+ * @m: Row-major matrix.
+ *
+ * A permutation gate (sim_sv_perm_of()) only moves the amplitudes it
+ * changes, and an identity leaves the register alone.
+ *
+ * Returns 0 on success, -1 on an out-of-range or repeated target.
+ */
+static int sim_sv_apply(sim_sv *sv, const unsigned int *t, unsigned int k,
+                        const double complex *m) {
+    sim_sv_apply_job job = { .sv = sv, .kern = sim_sv_kernels_get(), .k = k, .m = m };
+    unsigned int dim_m = 1u << k;
+    sim_sv_perm perm;
+
+    for (unsigned int i = 0; i < k; i++) {
+        if (t[i] >= sv->nqubits) return -1;
+        for (unsigned int j = 0; j < i; j++) {
+            if (t[i] == t[j]) return -1;
+        }
+        job.sorted[i] = t[i];
+    }
+
+    // Insertion sort of at most three slots, ascending
+    for (unsigned int i = 1; i < k; i++) {
+        for (unsigned int j = i; j > 0 && job.sorted[j - 1] > job.sorted[j]; j--) {
+            unsigned int tmp = job.sorted[j];
+            job.sorted[j] = job.sorted[j - 1];
+            job.sorted[j - 1] = tmp;
+        }
+    }
+
+    for (unsigned int s = 0; s < dim_m; s++) {
+        job.off[s] = 0;
+        for (unsigned int i = 0; i < k; i++) {
+            if (s & (1u << (k - 1 - i)))
+                job.off[s] |= (size_t)1 << t[i];
+        }
+    }
+
+    // The lowest target bit bounds the run of contiguous basis states
+    job.run = (size_t)1 << job.sorted[0];
+    job.groups = sv->dim >> k;
+    if (sim_sv_perm_of(m, k, &perm)) {
+        for (unsigned int x = 0; x < dim_m; x++) {
+            if (perm.to[x] == x && !perm.turn[x]) continue;
+            job.src[job.nmoved] = job.off[x];
+            job.dst[job.nmoved] = job.off[perm.to[x]];
+            job.turn[job.nmoved++] = perm.turn[x];
+        }
+        if (!job.nmoved) return 0;
+    } else if (sv->precision == SIM_SV_DOUBLE) {
+        while (job.run < job.kern->min_run)
+            job.kern = job.kern->narrower;
+    } else {
+        for (unsigned int e = 0; e < dim_m * dim_m; e++)
+            job.mf[e] = (float complex)m[e];
+        while (job.run < job.kern->min_runf)
+            job.kern = job.kern->narrower;
+    }
+
+    sim_pool_run(sim_pool_workers(sv->dim), sim_sv_apply_slice, &job);
+    return 0;
+}
+
+/**
+ * sim_sv_apply1 - Applies a 2x2 unitary to slot @t.
+ * @sv: Register.
+ * @t: Target slot.
+ * @m: Row-major matrix.
+ *
+ * Returns 0 on success, -1 if @t is out of range.
+ */
+int sim_sv_apply1(sim_sv *sv, unsigned int t, const double complex m[4]) {
+    return sim_sv_apply(sv, &t, 1, m);
+}
+
+/**
+ * sim_sv_apply2 - Applies a 4x4 unitary to slots @t1 (high index bit) and @t2.
+ * @sv: Register.
+ * @t1: First target slot.
+ * @t2: Second target slot.
+ * @m: Row-major matrix.
+ *
+ * Returns 0 on success, -1 on an out-of-range or repeated target.
+ */
+int sim_sv_apply2(sim_sv *sv, unsigned int t1, unsigned int t2, const double complex m[16]) {
+    unsigned int t[2] = { t1, t2 };
+
+    return sim_sv_apply(sv, t, 2, m);
+}
+
+/**
+ * sim_sv_apply3 - Applies an 8x8 unitary to slots @t1 (high index bit), @t2 and @t3.
+ * @sv: Register.
+ * @t1: First target slot.
+ * @t2: Second target slot.
+ * @t3: Third target slot.
+ * @m: Row-major matrix.
+ *
+ * Returns 0 on success, -1 on an out-of-range or repeated target.
+ */
+int sim_sv_apply3(sim_sv *sv, unsigned int t1, unsigned int t2, unsigned int t3,
+                  const double complex m[64]) {
+    unsigned int t[3] = { t1, t2, t3 };
+
+    return sim_sv_apply(sv, t, 3, m);
+}
+
+// Amplitudes per row of a keyed sweep: the slots below 8 are looked up directly
+#define SIM_SV_ROW_BITS 8
+
+/**
+ * sim_sv_keymap - Gathers the bits of a basis index at some slots into a key.
+ * @row: Amplitudes per row (1 << row bits, or the whole register if smaller).
+ * @low: Key bits of each offset within a row, from the slots below the row bits.
+ * @high: Slots at or above the row bits.
+ * @rank: Key bit of each entry of @high.
+ * @nhigh: Number of entries in @high.
+ *
+ * Bit j of the key is the j-th lowest slot of the mask. A sweep reads the
+ * high slots once per row (sim_sv_keymap_row()); inside a row the key is
+ * that value or'ed with @low[offset].
+ */
+typedef struct sim_sv_keymap {
+    size_t row;
+    uint16_t low[1u << SIM_SV_ROW_BITS];
+    unsigned int high[SIM_SV_DIAG_MAX_SLOTS];
+    unsigned int rank[SIM_SV_DIAG_MAX_SLOTS];
+    unsigned int nhigh;
+} sim_sv_keymap;
+
+// Sets up @km for the slots in @slots, at most SIM_SV_DIAG_MAX_SLOTS of them
+static void sim_sv_keymap_init(sim_sv_keymap *km, const sim_sv *sv, uint32_t slots) {
+    unsigned int row_bits = sv->nqubits < SIM_SV_ROW_BITS ? sv->nqubits : SIM_SV_ROW_BITS, j = 0;
+
+    km->row = (size_t)1 << row_bits;
+    km->nhigh = 0;
+    memset(km->low, 0, sizeof(km->low));
+    for (uint32_t rest = slots; rest; rest &= rest - 1, j++) {
+        unsigned int s = (unsigned int)__builtin_ctz(rest);
+
+        if (s < row_bits) {
+            for (size_t o = 0; o < km->row; o++)
+                km->low[o] |= (uint16_t)(((o >> s) & 1) << j);
+        } else {
+            km->high[km->nhigh] = s;
+            km->rank[km->nhigh++] = j;
+        }
+    }
+}
+
+// Key bits of the row starting at basis state @base
+static inline unsigned int sim_sv_keymap_row(const sim_sv_keymap *km, size_t base) {
+    unsigned int hk = 0;
+
+    for (unsigned int h = 0; h < km->nhigh; h++)
+        hk |= (unsigned int)((base >> km->high[h]) & 1) << km->rank[h];
+    return hk;
+}
+
+/**
+ * sim_sv_diag_job - A diagonal gate, as shared by the workers sweeping it.
+ * @sv: Register.
+ * @d: Phase of each key, double registers.
+ * @df: The same rounded to float.
+ * @key: Key of each basis state.
+ */
+typedef struct sim_sv_diag_job {
+    sim_sv *sv;
+    const double complex *d;
+    float complex df[1u << SIM_SV_DIAG_MAX_SLOTS];
+    sim_sv_keymap key;
+} sim_sv_diag_job;
+
+/**
+ * sim_sv_diag_slice - Multiplies the amplitudes of slice @w by their phases.
+ * @ctx: The sim_sv_diag_job.
+ * @w: Slice index.
+ * @nw: Number of slices.
+ *
+ * Slice boundaries are multiples of SIM_POOL_CHUNK_AMPS, so every slice is a
+ * whole number of rows.
+ */
+static void sim_sv_diag_slice(void *ctx, unsigned int w, unsigned int nw) {
+    const sim_sv_diag_job *job = ctx;
+    const sim_sv_keymap *km = &job->key;
+    size_t end = sim_pool_split(job->sv->dim, w + 1, nw);
+
+    for (size_t base = sim_pool_split(job->sv->dim, w, nw); base < end; base += km->row) {
+        unsigned int hk = sim_sv_keymap_row(km, base);
+
+        if (job->sv->precision == SIM_SV_DOUBLE) {
+            double *a = (double *)(job->sv->amp + base);
+            const double *p = (const double *)job->d;
+
+            for (size_t j = 0; j < km->row; j++) {
+                size_t e = 2 * (hk | km->low[j]);
+                double re = a[2 * j], im = a[2 * j + 1];
+
+                a[2 * j] = re * p[e] - im * p[e + 1];
+                a[2 * j + 1] = re * p[e + 1] + im * p[e];
+            }
+        } else {
+            float *a = (float *)(job->sv->ampf + base);
+            const float *p = (const float *)job->df;
+
+            for (size_t j = 0; j < km->row; j++) {
+                size_t e = 2 * (hk | km->low[j]);
+                float re = a[2 * j], im = a[2 * j + 1];
+
+                a[2 * j] = re * p[e] - im * p[e + 1];
+                a[2 * j + 1] = re * p[e + 1] + im * p[e];
+            }
+        }
+    }
+}
+
+/**
+ * sim_sv_apply_diag - Multiplies every amplitude by a phase picked by some of its bits.
+ * @sv: Register.
+ * @slots: Mask of at most SIM_SV_DIAG_MAX_SLOTS slots.
+ * @d: Phase of each key; bit j of a key is the j-th lowest slot in @slots.
+ *
+ * A run of diagonal gates on any qubits multiplies out to one such table,
+ * so this sweeps the register once for all of them.
+ *
+ * Returns 0 on success, -1 on too many or out-of-range slots.
+ */
+int sim_sv_apply_diag(sim_sv *sv, uint32_t slots, const double complex *d) {
+    unsigned int k = (unsigned int)__builtin_popcount(slots);
+    sim_sv_diag_job *job;
+
+    if (k > SIM_SV_DIAG_MAX_SLOTS || (sv->nqubits < 32 && (slots >> sv->nqubits)))
+        return -1;
+    if (!slots) return 0;
+
+    job = malloc(sizeof(*job));
+    if (!job) return -1;
+    job->sv = sv;
+    job->d = d;
+    sim_sv_keymap_init(&job->key, sv, slots);
+    if (sv->precision != SIM_SV_DOUBLE) {
+        for (size_t e = 0; e < ((size_t)1 << k); e++)
+            job->df[e] = (float complex)d[e];
+    }
+
+    sim_pool_run(sim_pool_workers(sv->dim), sim_sv_diag_slice, job);
+    free(job);
+    return 0;
+}
+
+/**
+ * sim_sv_prob_job - Per-slice partial sums of |amp|^2 over states with @bit set.
+ * @sv: Register.
+ * @bit: Basis-state bit of the measured slot; 0 sums every state.
+ * @partial: Sum of slice w.
+ * @nw: Number of slices the pool actually ran.
+ */
+typedef struct sim_sv_prob_job {
+    const sim_sv *sv;
+    size_t bit;
+    double partial[SIM_POOL_MAX_THREADS];
+    unsigned int nw;
+} sim_sv_prob_job;
+
+static void sim_sv_prob_slice(void *ctx, unsigned int w, unsigned int nw) {
+    sim_sv_prob_job *job = ctx;
+    const sim_sv *sv = job->sv;
+    size_t start = sim_pool_split(sv->dim, w, nw), end = sim_pool_split(sv->dim, w + 1, nw);
+    double p = 0;
+
+    if (sv->precision == SIM_SV_DOUBLE) {
+        for (size_t i = start; i < end; i++) {
+            if ((i & job->bit) == job->bit) {
+                double re = creal(sv->amp[i]), im = cimag(sv->amp[i]);
+                p += re * re + im * im;
+            }
+        }
+    } else if (sv->precision == SIM_SV_MIXED) {
+        for (size_t i = start; i < end; i++) {
+            if ((i & job->bit) == job->bit) {
+                double re = crealf(sv->ampf[i]), im = cimagf(sv->ampf[i]);
+                p += re * re + im * im;
+            }
+        }
+    } else {
+        float pf = 0;
+
+        for (size_t i = start; i < end; i++) {
+            if ((i & job->bit) == job->bit) {
+                float re = crealf(sv->ampf[i]), im = cimagf(sv->ampf[i]);
+                pf += re * re + im * im;
+            }
+        }
+        p = pf;
+    }
+    job->partial[w] = p;
+    if (w == 0) job->nw = nw;
+}
+
+/**
+ * sim_sv_prob_one - Probability of measuring slot @t as |1>.
+ * @sv: Register.
+ * @t: Slot.
+ *
+ * Returns the probability, or 0 if @t is out of range.
+ */
+double sim_sv_prob_one(const sim_sv *sv, unsigned int t) {
+    sim_sv_prob_job job = { .sv = sv, .bit = (size_t)1 << t };
+    unsigned int nw = sim_pool_workers(sv->dim);
+    double p = 0;
+
+    if (t >= sv->nqubits) return 0;
+    sim_pool_run(nw, sim_sv_prob_slice, &job);
+    // Unused slots stay 0 when the pool ran with fewer workers
+    for (unsigned int w = 0; w < nw; w++)
+        p += job.partial[w];
+    return p;
+}
+
+/**
+ * sim_sv_sample_job - Inverse-CDF walk of sim_sv_sample(), one slice per worker.
+ * @off: Probability mass below slice w, then the total at @off[nw].
+ */
+typedef struct sim_sv_sample_job {
+    const sim_sv *sv;
+    const double *u;
+    const uint32_t *row;
+    size_t shots;
+    const int *slots;
+    unsigned int nbits;
+    size_t words;
+    uint64_t *out;
+    double off[SIM_POOL_MAX_THREADS + 1];
+} sim_sv_sample_job;
+
+// First of the sorted uniforms at or above @x
+static size_t sim_sv_lower_bound(const double *u, size_t n, double x) {
+    size_t lo = 0, hi = n;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (u[mid] < x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void sim_sv_sample_emit(const sim_sv_sample_job *job, size_t k, size_t i) {
+    uint64_t *dst = job->out + (size_t)job->row[k] * job->words;
+
+    for (unsigned int b = 0; b < job->nbits; b++) {
+        if (job->slots[b] >= 0 && ((i >> job->slots[b]) & 1))
+            dst[b / 64] |= 1ull << (b % 64);
+    }
+}
+
+static void sim_sv_sample_slice(void *ctx, unsigned int w, unsigned int nw) {
+    sim_sv_sample_job *job = ctx;
+    const sim_sv *sv = job->sv;
+    size_t start = sim_pool_split(sv->dim, w, nw), end = sim_pool_split(sv->dim, w + 1, nw);
+    size_t k = sim_sv_lower_bound(job->u, job->shots, job->off[w]);
+    size_t kend = w + 1 == nw ? job->shots : sim_sv_lower_bound(job->u, job->shots, job->off[w + 1]);
+    size_t last = start;
+    double acc = job->off[w];
+
+    for (size_t i = start; i < end && k < kend; i++) {
+        double p;
+
+        if (sv->precision == SIM_SV_DOUBLE) {
+            double re = creal(sv->amp[i]), im = cimag(sv->amp[i]);
+            p = re * re + im * im;
+        } else {
+            double re = crealf(sv->ampf[i]), im = cimagf(sv->ampf[i]);
+            p = re * re + im * im;
+        }
+        if (p == 0) continue;
+        last = i;
+        acc += p;
+        while (k < kend && job->u[k] < acc)
+            sim_sv_sample_emit(job, k++, i);
+    }
+    // Rounding between the two sweeps can leave the top few draws unassigned
+    while (k < kend)
+        sim_sv_sample_emit(job, k++, last);
+}
+
+/**
+ * sim_sv_sample - Measures a subset of slots over many shots, without collapse.
+ * @sv: Register.
+ * @u: @shots sorted uniforms in [0, 1), one per shot.
+ * @row: Output row of the shot drawn with each entry of @u.
+ * @shots: Number of shots.
+ * @slots: Slot of each output bit, or -1 for a bit that always reads 0.
+ * @nbits: Output bits per shot.
+ * @out: Zeroed rows of (@nbits + 63) / 64 words; output bit b of a shot is
+ *       bit b % 64 of word b / 64.
+ *
+ * Sorted uniforms turn inverse-CDF sampling into two sweeps of the register,
+ * a parallel sum of each slice's mass and one merge walk per slice, so the
+ * cost is O(2^n + shots) with no table the size of the register.
+ *
+ * Returns 0, or -1 for an empty or all-zero register.
+ */
+int sim_sv_sample(const sim_sv *sv, const double *u, const uint32_t *row, size_t shots,
+                  const int *slots, unsigned int nbits, uint64_t *out) {
+    sim_sv_prob_job mass = { .sv = sv, .bit = 0 };
+    sim_sv_sample_job *job;
+    double total = 0;
+
+    if (!sv->dim) return -1;
+    job = malloc(sizeof(*job));
+    if (!job) return -1;
+    mass.nw = 1;
+    sim_pool_run(sim_pool_workers(sv->dim), sim_sv_prob_slice, &mass);
+    for (unsigned int w = 0; w < mass.nw; w++) {
+        job->off[w] = total;
+        total += mass.partial[w];
+    }
+    job->off[mass.nw] = total;
+    if (!(total > 0)) {
+        free(job);
+        return -1;
+    }
+
+    // Scale the draws to the register's norm rather than renormalising it
+    double *su = malloc((shots ? shots : 1) * sizeof(*su));
+    if (!su) {
+        free(job);
+        return -1;
+    }
+    for (size_t k = 0; k < shots; k++)
+        su[k] = u[k] * total;
+
+    job->sv = sv;
+    job->u = su;
+    job->row = row;
+    job->shots = shots;
+    job->slots = slots;
+    job->nbits = nbits;
+    job->words = ((size_t)nbits + 63) / 64;
+    job->out = out;
+    sim_pool_run(mass.nw, sim_sv_sample_slice, job);
+    free(su);
+    free(job);
+    return 0;
+}
+
+/**
+ * sim_sv_copy - Makes @dst a copy of @src.
+ * @dst: Initialised register; its array is reused when it has the right size.
+ * @src: Register to copy.
+ *
+ * Returns 0 on success, -1 on allocation failure (@dst is then unchanged).
+ */
+int sim_sv_copy(sim_sv *dst, const sim_sv *src) {
+    size_t bytes = src->dim * sim_sv_amp_size(src);
+
+    if (dst->dim * sim_sv_amp_size(dst) != bytes) {
+        void *amp, *map;
+        size_t map_len;
+
+        amp = sim_mem_alloc(bytes, SIM_SV_ALIGN, &map, &map_len);
+        if (!amp) return -1;
+        sim_sv_adopt(dst, amp, map, map_len);
+    }
+    memcpy(dst->amp, src->amp, bytes);
+    dst->dim = src->dim;
+    dst->nqubits = src->nqubits;
+    dst->precision = src->precision;
+    memcpy(dst->ids, src->ids, sizeof(dst->ids));
+    return 0;
+}
+
+/**
+ * sim_sv_pauli_chunk - Strings of one group whose sign slots fit in one key.
+ * @key: Key over the union of their Z and Y slots.
+ * @w: Summed weight of the strings for each key, signs included.
+ */
+typedef struct sim_sv_pauli_chunk {
+    sim_sv_keymap key;
+    double complex *w;
+} sim_sv_pauli_chunk;
+
+/**
+ * sim_sv_pauli_job - Per-slice partial sums of a group of Pauli strings sharing X.
+ * @x: Slots every string flips (X or Y).
+ * @chunks: The strings, as weight tables over their sign slots.
+ * @nchunks: Number of chunks.
+ * @z: Sign slots of the strings too wide for a chunk.
+ * @w: Their weights.
+ * @nwide: Number of such strings.
+ * @hk: Scratch, @nchunks row keys per slice.
+ */
+typedef struct sim_sv_pauli_job {
+    const sim_sv *sv;
+    size_t x;
+    const sim_sv_pauli_chunk *chunks;
+    size_t nchunks;
+    const size_t *z;
+    const double complex *w;
+    size_t nwide;
+    unsigned int *hk;
+    double partial[SIM_POOL_MAX_THREADS];
+} sim_sv_pauli_job;
+
+static void sim_sv_pauli_slice(void *ctx, unsigned int w, unsigned int nw) {
+    sim_sv_pauli_job *job = ctx;
+    const sim_sv *sv = job->sv;
+    size_t start = sim_pool_split(sv->dim, w, nw), end = sim_pool_split(sv->dim, w + 1, nw);
+    size_t row = job->nchunks ? job->chunks[0].key.row : end - start;
+    unsigned int *hk = job->hk + (size_t)w * job->nchunks;
+    double s = 0;
+
+    for (size_t base = start; base < end; base += row) {
+        for (size_t c = 0; c < job->nchunks; c++)
+            hk[c] = sim_sv_keymap_row(&job->chunks[c].key, base);
+
+        for (size_t i = base; i < base + row && i < end; i++) {
+            double complex a, b, wt = 0;
+            double pr, pi;
+
+            if (sv->precision == SIM_SV_DOUBLE) {
+                a = sv->amp[i];
+                b = sv->amp[i ^ job->x];
+            } else {
+                a = sv->ampf[i];
+                b = sv->ampf[i ^ job->x];
+            }
+            // conj(b) * a, shared by every string of the group
+            pr = creal(b) * creal(a) + cimag(b) * cimag(a);
+            pi = creal(b) * cimag(a) - cimag(b) * creal(a);
+            for (size_t c = 0; c < job->nchunks; c++)
+                wt += job->chunks[c].w[hk[c] | job->chunks[c].key.low[i - base]];
+            for (size_t t = 0; t < job->nwide; t++)
+                wt += __builtin_parityll(i & job->z[t]) ? -job->w[t] : job->w[t];
+            s += creal(wt) * pr - cimag(wt) * pi;
+        }
+    }
+    job->partial[w] = s;
+}
+
+/**
+ * sim_sv_expect_paulis - Weighted sum of expectation values of Pauli strings with one X part.
+ * @sv: Register.
+ * @x: Slots where every string has X or Y.
+ * @z: Slots where string t has Z or Y.
+ * @w: Weight of string t: its coefficient times i^(number of Y factors).
+ * @n: Number of strings.
+ *
+ * P|i> = i^ny (-1)^|i & z| |i ^ x>, so strings that flip the same slots pair
+ * every amplitude with the same partner, and one sweep serves the group with
+ * no copy of the state. The strings are packed into chunks whose sign slots
+ * fit in SIM_SV_DIAG_MAX_SLOTS bits; each chunk's signed weights are summed
+ * per key up front, so an amplitude costs one lookup per chunk rather than
+ * one parity per string.
+ *
+ * Returns sum_t Re(@w[t] sum_i (-1)^|i & @z[t]| conj(psi[i ^ @x]) psi[i]), which
+ * is sum_t coeff_t <P_t>, or NaN on allocation failure.
+ */
+double sim_sv_expect_paulis(const sim_sv *sv, size_t x, const size_t *z,
+                            const double complex *w, size_t n) {
+    sim_sv_pauli_job job = { .sv = sv, .x = x };
+    unsigned int nw = sim_pool_workers(sv->dim);
+    sim_sv_pauli_chunk *chunks = calloc(n ? n : 1, sizeof(*chunks));
+    size_t *wide_z = malloc((n ? n : 1) * sizeof(*wide_z));
+    double complex *wide_w = malloc((n ? n : 1) * sizeof(*wide_w));
+    double s = NAN;
+
+    if (!chunks || !wide_z || !wide_w) goto out;
+
+    for (size_t t = 0; t < n;) {
+        uint32_t mask = 0;
+        size_t first = t, size;
+        sim_sv_pauli_chunk *c;
+
+        if (__builtin_popcountll(z[t]) > SIM_SV_DIAG_MAX_SLOTS) {
+            wide_z[job.nwide] = z[t];
+            wide_w[job.nwide++] = w[t++];
+            continue;
+        }
+        while (t < n && __builtin_popcountll(z[t]) <= SIM_SV_DIAG_MAX_SLOTS &&
+               __builtin_popcount(mask | (uint32_t)z[t]) <= SIM_SV_DIAG_MAX_SLOTS)
+            mask |= (uint32_t)z[t++];
+
+        c = &chunks[job.nchunks++];
+        size = (size_t)1 << __builtin_popcount(mask);
+        c->w = calloc(size, sizeof(*c->w));
+        if (!c->w) goto out;
+        sim_sv_keymap_init(&c->key, sv, mask);
+        for (size_t u = first; u < t; u++) {
+            unsigned int zk = 0, j = 0;
+
+            // The string's sign slots as key bits
+            for (uint32_t rest = mask; rest; rest &= rest - 1, j++) {
+                if (z[u] & ((size_t)1 << __builtin_ctz(rest))) zk |= 1u << j;
+            }
+            for (size_t e = 0; e < size; e++)
+                c->w[e] += __builtin_parity((unsigned int)e & zk) ? -w[u] : w[u];
+        }
+    }
+
+    job.chunks = chunks;
+    job.z = wide_z;
+    job.w = wide_w;
+    job.hk = malloc(((size_t)nw * job.nchunks + 1) * sizeof(*job.hk));
+    if (!job.hk) goto out;
+    sim_pool_run(nw, sim_sv_pauli_slice, &job);
+    s = 0;
+    for (unsigned int i = 0; i < nw; i++)
+        s += job.partial[i];
+
+out:
+    for (size_t c = 0; chunks && c < job.nchunks; c++)
+        free(chunks[c].w);
+    free(chunks);
+    free(wide_z);
+    free(wide_w);
+    free(job.hk);
+    return s;
+}
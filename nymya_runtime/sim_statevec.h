@@ -0,0 +1,93 @@
+#ifndef NYMYA_SIM_STATEVEC_H
+#define NYMYA_SIM_STATEVEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex.h>
+
+// Hard limit on register width; 2^32 amplitudes are 64 GiB of double complex
+#define SIM_SV_MAX_QUBITS 32
+
+// Most slots one diagonal sweep covers; its phase table has 2^12 entries, 64 KiB
+#define SIM_SV_DIAG_MAX_SLOTS 12
+
+/**
+ * sim_sv_precision - How a register stores and sums its amplitudes.
+ * @SIM_SV_DOUBLE: double complex storage and arithmetic.
+ * @SIM_SV_FLOAT: float complex storage and arithmetic, half the memory.
+ * @SIM_SV_MIXED: float complex storage and gates, double accumulation in
+ *                reductions such as probabilities.
+ */
+typedef enum sim_sv_precision {
+    SIM_SV_DOUBLE,
+    SIM_SV_FLOAT,
+    SIM_SV_MIXED
+} sim_sv_precision;
+
+/**
+ * sim_sv - Dense 2^n complex state vector.
+ * @amp: Amplitudes when @precision is SIM_SV_DOUBLE, indexed by basis
+ *       state; bit k is the qubit at slot k.
+ * @ampf: The same for the float precisions.
+ * @dim: Number of amplitudes (1 << @nqubits).
+ * @nqubits: Number of qubits in the register.
+ * @precision: Storage mode.
+ * @ids: nymya_qubit IDs of the qubits, by slot.
+ * @map: File mapping that holds the amplitudes (a restored checkpoint), or
+ *       NULL when they were allocated with posix_memalign().
+ * @map_len: Length of @map.
+ *
+ * Qubits join on first use in |0>, in the next free (highest) slot, so a
+ * join only zero-fills the new upper half and never moves an amplitude.
+ */
+typedef struct sim_sv {
+    union {
+        double complex *amp;
+        float complex *ampf;
+    };
+    size_t dim;
+    unsigned int nqubits;
+    sim_sv_precision precision;
+    uint64_t ids[SIM_SV_MAX_QUBITS];
+    void *map;
+    size_t map_len;
+} sim_sv;
+
+/**
+ * sim_sv_perm - A gate that maps every basis state to one basis state.
+ * @to: Row of the nonzero entry in each column.
+ * @turn: That entry as i^turn.
+ */
+typedef struct sim_sv_perm {
+    unsigned char to[8];
+    unsigned char turn[8];
+} sim_sv_perm;
+
+int sim_sv_init(sim_sv *sv);
+void sim_sv_free(sim_sv *sv);
+void sim_sv_adopt(sim_sv *sv, void *amp, void *map, size_t map_len);
+
+int sim_sv_find(const sim_sv *sv, uint64_t id);
+int sim_sv_qubit(sim_sv *sv, uint64_t id);
+
+int sim_sv_set_precision(sim_sv *sv, sim_sv_precision precision);
+void sim_sv_set(sim_sv *sv, size_t i, double complex a);
+
+// Matrices are row-major; the first target is the most significant bit of the row/column index
+int sim_sv_apply1(sim_sv *sv, unsigned int t, const double complex m[4]);
+int sim_sv_apply2(sim_sv *sv, unsigned int t1, unsigned int t2, const double complex m[16]);
+int sim_sv_apply3(sim_sv *sv, unsigned int t1, unsigned int t2, unsigned int t3,
+                  const double complex m[64]);
+int sim_sv_perm_of(const double complex *m, unsigned int k, sim_sv_perm *p);
+int sim_sv_apply_diag(sim_sv *sv, uint32_t slots, const double complex *d);
+
+double sim_sv_prob_one(const sim_sv *sv, unsigned int t);
+int sim_sv_copy(sim_sv *dst, const sim_sv *src);
+double sim_sv_expect_paulis(const sim_sv *sv, size_t x, const size_t *z,
+                            const double complex *w, size_t n);
+int sim_sv_sample(const sim_sv *sv, const double *u, const uint32_t *row, size_t shots,
+                  const int *slots, unsigned int nbits, uint64_t *out);
+
+const char *sim_sv_isa(void);
+
+#endif // NYMYA_SIM_STATEVEC_H